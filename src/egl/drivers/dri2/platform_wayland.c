@@ -265,6 +265,9 @@ dri2_release_buffers(struct dri2_egl_surface *dri2_surf)
                                        dri2_surf->dri_buffers[i]);
 }
 
+/* Number of frames an unused buffer is kept around before it's freed */
+#define BUFFER_TRIM_AGE_HYSTERESIS 20
+
 static int
 get_back_bo(struct dri2_egl_surface *dri2_surf)
 {
@@ -281,7 +284,7 @@ get_back_bo(struct dri2_egl_surface *dri2_surf)
                                     dri2_dpy->wl_queue) == -1)
          return -1;
 
-   if (dri2_surf->back == NULL) {
+   while (dri2_surf->back == NULL) {
       for (i = 0; i < ARRAY_SIZE(dri2_surf->color_buffers); i++) {
          /* Get an unlocked buffer, preferrably one with a dri_buffer
           * already allocated. */
@@ -292,10 +295,16 @@ get_back_bo(struct dri2_egl_surface *dri2_surf)
          else if (dri2_surf->back->dri_image == NULL)
             dri2_surf->back = &dri2_surf->color_buffers[i];
       }
-   }
 
-   if (dri2_surf->back == NULL)
-      return -1;
+      if (dri2_surf->back != NULL)
+         break;
+
+      /* All buffers are held by the compositor, wait for it to release
+       * one instead of failing the allocation. */
+      if (wl_display_dispatch_queue(dri2_dpy->wl_dpy,
+                                    dri2_dpy->wl_queue) == -1)
+         return -1;
+   }
    if (dri2_surf->back->dri_image == NULL) {
       dri2_surf->back->dri_image = 
          dri2_dpy->image->createImage(dri2_dpy->dri_screen,
@@ -384,10 +393,14 @@ update_buffers(struct dri2_egl_surface *dri2_surf)
 
    /* If we have an extra unlocked buffer at this point, we had to do triple
     * buffering for a while, but now can go back to just double buffering.
-    * That means we can free any unlocked buffer now. */
+    * That means we can free any unlocked buffer now. To avoid toggling
+    * between freeing a buffer and allocating a new one every few frames
+    * when the compositor is just a bit late, only free buffers which
+    * haven't been used for a while. */
    for (i = 0; i < ARRAY_SIZE(dri2_surf->color_buffers); i++) {
       if (!dri2_surf->color_buffers[i].locked &&
-          dri2_surf->color_buffers[i].wl_buffer) {
+          dri2_surf->color_buffers[i].wl_buffer &&
+          dri2_surf->color_buffers[i].age > BUFFER_TRIM_AGE_HYSTERESIS) {
          wl_buffer_destroy(dri2_surf->color_buffers[i].wl_buffer);
          dri2_dpy->image->destroyImage(dri2_surf->color_buffers[i].dri_image);
          dri2_surf->color_buffers[i].wl_buffer = NULL;
@@ -770,6 +770,92 @@ _eglFallbackCompare(const _EGLConfig *conf1, const _EGLConfig *conf2,
 }
 
 
+#define _EGL_CONFIG_CACHE_SIZE 4
+
+/**
+ * The sorted results of the last few eglChooseConfig calls of a display.
+ * The configs of a display don't change between eglInitialize and
+ * eglTerminate, so the results only depend on the criteria.
+ */
+struct _egl_config_cache
+{
+   struct {
+      _EGLConfig Criteria;
+      _EGLConfig **Configs;
+      EGLint Count;
+   } Entries[_EGL_CONFIG_CACHE_SIZE];
+   EGLint NumEntries;
+   EGLint Next; /**< entry to replace next */
+};
+
+
+void
+_eglDestroyConfigCache(_EGLDisplay *disp)
+{
+   struct _egl_config_cache *cache = disp->ConfigCache;
+   EGLint i;
+
+   if (!cache)
+      return;
+
+   for (i = 0; i < cache->NumEntries; i++)
+      free(cache->Entries[i].Configs);
+   free(cache);
+   disp->ConfigCache = NULL;
+}
+
+
+/**
+ * Return the index of the cache entry with the sorted configs matching the
+ * criteria, creating it if needed.  Return -1 when out of memory.
+ */
+static EGLint
+_eglLookupConfigCache(_EGLDisplay *disp, const _EGLConfig *criteria)
+{
+   struct _egl_config_cache *cache = disp->ConfigCache;
+   _EGLConfig **configList;
+   EGLint i, count;
+
+   if (!cache) {
+      cache = calloc(1, sizeof(*cache));
+      if (!cache)
+         return -1;
+      disp->ConfigCache = cache;
+   }
+
+   /* the criteria come from _eglParseConfigAttribList and are zeroed
+    * before being filled in, so they can be compared as a whole
+    */
+   for (i = 0; i < cache->NumEntries; i++) {
+      if (!memcmp(&cache->Entries[i].Criteria, criteria, sizeof(*criteria)))
+         return i;
+   }
+
+   count = disp->Configs ? disp->Configs->Size : 0;
+   configList = malloc(sizeof(*configList) * (count ? count : 1));
+   if (!configList)
+      return -1;
+
+   count = _eglFilterArray(disp->Configs, (void **) configList, count,
+         (_EGLArrayForEach) _eglFallbackMatch, (void *) criteria);
+   _eglSortConfigs((const _EGLConfig **) configList, count,
+                   _eglFallbackCompare, (void *) criteria);
+
+   i = cache->Next;
+   if (i < cache->NumEntries)
+      free(cache->Entries[i].Configs);
+   else
+      cache->NumEntries++;
+   cache->Next = (i + 1) % _EGL_CONFIG_CACHE_SIZE;
+
+   memcpy(&cache->Entries[i].Criteria, criteria, sizeof(*criteria));
+   cache->Entries[i].Configs = configList;
+   cache->Entries[i].Count = count;
+
+   return i;
+}
+
+
 /**
  * Typical fallback routine for eglChooseConfig
  */
@@ -778,14 +864,31 @@ _eglChooseConfig(_EGLDriver *drv, _EGLDisplay *disp, const EGLint *attrib_list,
                  EGLConfig *configs, EGLint config_size, EGLint *num_configs)
 {
    _EGLConfig criteria;
+   _EGLConfig **configList;
+   EGLint i, count;
 
    if (!_eglParseConfigAttribList(&criteria, disp, attrib_list))
       return _eglError(EGL_BAD_ATTRIBUTE, "eglChooseConfig");
 
-   return _eglFilterConfigArray(disp->Configs,
-         configs, config_size, num_configs,
-         _eglFallbackMatch, _eglFallbackCompare,
-         (void *) &criteria);
+   if (!num_configs)
+      return _eglError(EGL_BAD_PARAMETER, "eglChooseConfigs");
+
+   i = _eglLookupConfigCache(disp, &criteria);
+   if (i < 0)
+      return _eglError(EGL_BAD_ALLOC, "eglChooseConfig(out of memory)");
+
+   configList = disp->ConfigCache->Entries[i].Configs;
+   count = disp->ConfigCache->Entries[i].Count;
+
+   if (configs) {
+      count = MIN2(count, config_size);
+      for (i = 0; i < count; i++)
+         configs[i] = _eglGetConfigHandle(configList[i]);
+   }
+
+   *num_configs = count;
+
+   return EGL_TRUE;
 }
 
 
@@ -211,6 +211,10 @@ _eglFilterConfigArray(_EGLArray *array, EGLConfig *configs,
                       void *filter_data);
 
 
+extern void
+_eglDestroyConfigCache(_EGLDisplay *dpy);
+
+
 extern EGLBoolean
 _eglChooseConfig(_EGLDriver *drv, _EGLDisplay *dpy, const EGLint *attrib_list, EGLConfig *configs, EGLint config_size, EGLint *num_config);
 
@@ -55,6 +55,8 @@ struct _egl_thread_info
    _EGLContext *CurrentContexts[_EGL_API_NUM_APIS];
    /* use index for fast access to current context */
    EGLint CurrentAPIIndex;
+   /* the display last found valid by _eglCheckDisplayHandle */
+   _EGLDisplay *LastDisplay;
 };
 
 
@@ -35,7 +35,9 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
+#include "eglconfig.h"
 #include "eglcontext.h"
+#include "eglcurrent.h"
 #include "eglsurface.h"
 #include "egldisplay.h"
 #include "egldriver.h"
@@ -326,6 +328,8 @@ _eglCleanupDisplay(_EGLDisplay *disp)
       disp->Configs = NULL;
    }
 
+   _eglDestroyConfigCache(disp);
+
    /* XXX incomplete */
 }
 
@@ -336,8 +340,16 @@ _eglCleanupDisplay(_EGLDisplay *disp)
 EGLBoolean
 _eglCheckDisplayHandle(EGLDisplay dpy)
 {
+   _EGLThreadInfo *t = _eglGetCurrentThread();
    _EGLDisplay *cur;
 
+   /* Displays stay linked until _eglFiniDisplay, so once a thread has found
+    * a handle in the list it is valid for good.  Remembering it saves the
+    * global lock on nearly every EGL call.
+    */
+   if (dpy && t->LastDisplay == (_EGLDisplay *) dpy)
+      return EGL_TRUE;
+
    _eglLockMutex(_eglGlobal.Mutex);
    cur = _eglGlobal.DisplayList;
    while (cur) {
@@ -346,6 +358,10 @@ _eglCheckDisplayHandle(EGLDisplay dpy)
       cur = cur->Next;
    }
    _eglUnlockMutex(_eglGlobal.Mutex);
+
+   if (cur && !_eglIsCurrentThreadDummy())
+      t->LastDisplay = cur;
+
    return (cur != NULL);
 }
 
@@ -154,6 +154,7 @@ struct _egl_display
 
    _EGLArray *Screens;
    _EGLArray *Configs;
+   struct _egl_config_cache *ConfigCache; /**< see _eglChooseConfig */
 
    /* lists of resources */
    _EGLResource *ResourceLists[_EGL_NUM_RESOURCES];
@@ -105,6 +105,15 @@ struct cso_context {
    void *blend, *blend_saved;
    void *depth_stencil, *depth_stencil_saved;
    void *rasterizer, *rasterizer_saved;
+
+   /** The CSOs the above were last set from, if they still are bound.
+    * Setting an identical template again is detected by comparing against
+    * these, without hashing it and looking it up.
+    */
+   const struct cso_blend *blend_cso;
+   const struct cso_depth_stencil_alpha *depth_stencil_cso;
+   const struct cso_rasterizer *rasterizer_cso;
+
    void *fragment_shader, *fragment_shader_saved;
    void *vertex_shader, *vertex_shader_saved;
    void *geometry_shader, *geometry_shader_saved;
@@ -360,6 +369,10 @@ void cso_release_all( struct cso_context *ctx )
       pipe_so_target_reference(&ctx->so_targets_saved[i], NULL);
    }
 
+   ctx->blend_cso = NULL;
+   ctx->depth_stencil_cso = NULL;
+   ctx->rasterizer_cso = NULL;
+
    if (ctx->cache) {
       cso_cache_delete( ctx->cache );
       ctx->cache = NULL;
@@ -396,17 +409,22 @@ enum pipe_error cso_set_blend(struct cso_context *ctx,
 {
    unsigned key_size, hash_key;
    struct cso_hash_iter iter;
+   struct cso_blend *cso;
    void *handle;
 
    key_size = templ->independent_blend_enable ?
       sizeof(struct pipe_blend_state) :
       (char *)&(templ->rt[1]) - (char *)templ;
+
+   if (ctx->blend_cso && !memcmp(&ctx->blend_cso->state, templ, key_size))
+      return PIPE_OK;
+
    hash_key = cso_construct_key((void*)templ, key_size);
    iter = cso_find_state_template(ctx->cache, hash_key, CSO_BLEND,
                                   (void*)templ, key_size);
 
    if (cso_hash_iter_is_null(iter)) {
-      struct cso_blend *cso = MALLOC(sizeof(struct cso_blend));
+      cso = MALLOC(sizeof(struct cso_blend));
       if (!cso)
          return PIPE_ERROR_OUT_OF_MEMORY;
 
@@ -421,13 +439,12 @@ enum pipe_error cso_set_blend(struct cso_context *ctx,
          FREE(cso);
          return PIPE_ERROR_OUT_OF_MEMORY;
       }
-
-      handle = cso->data;
-   }
-   else {
-      handle = ((struct cso_blend *)cso_hash_iter_data(iter))->data;
    }
 
+   cso = (struct cso_blend *)cso_hash_iter_data(iter);
+   handle = cso->data;
+   ctx->blend_cso = cso;
+
    if (ctx->blend != handle) {
       ctx->blend = handle;
       ctx->pipe->bind_blend_state(ctx->pipe, handle);
@@ -445,6 +462,7 @@ void cso_restore_blend(struct cso_context *ctx)
 {
    if (ctx->blend != ctx->blend_saved) {
       ctx->blend = ctx->blend_saved;
+      ctx->blend_cso = NULL;
       ctx->pipe->bind_blend_state(ctx->pipe, ctx->blend_saved);
    }
    ctx->blend_saved = NULL;
@@ -457,16 +475,22 @@ cso_set_depth_stencil_alpha(struct cso_context *ctx,
                             const struct pipe_depth_stencil_alpha_state *templ)
 {
    unsigned key_size = sizeof(struct pipe_depth_stencil_alpha_state);
-   unsigned hash_key = cso_construct_key((void*)templ, key_size);
-   struct cso_hash_iter iter = cso_find_state_template(ctx->cache,
-                                                       hash_key,
-                                                       CSO_DEPTH_STENCIL_ALPHA,
-                                                       (void*)templ, key_size);
+   unsigned hash_key;
+   struct cso_hash_iter iter;
+   struct cso_depth_stencil_alpha *cso;
    void *handle;
 
+   if (ctx->depth_stencil_cso &&
+       !memcmp(&ctx->depth_stencil_cso->state, templ, key_size))
+      return PIPE_OK;
+
+   hash_key = cso_construct_key((void*)templ, key_size);
+   iter = cso_find_state_template(ctx->cache, hash_key,
+                                  CSO_DEPTH_STENCIL_ALPHA,
+                                  (void*)templ, key_size);
+
    if (cso_hash_iter_is_null(iter)) {
-      struct cso_depth_stencil_alpha *cso =
-         MALLOC(sizeof(struct cso_depth_stencil_alpha));
+      cso = MALLOC(sizeof(struct cso_depth_stencil_alpha));
       if (!cso)
          return PIPE_ERROR_OUT_OF_MEMORY;
 
@@ -483,14 +507,12 @@ cso_set_depth_stencil_alpha(struct cso_context *ctx,
          FREE(cso);
          return PIPE_ERROR_OUT_OF_MEMORY;
       }
-
-      handle = cso->data;
-   }
-   else {
-      handle = ((struct cso_depth_stencil_alpha *)
-                cso_hash_iter_data(iter))->data;
    }
 
+   cso = (struct cso_depth_stencil_alpha *)cso_hash_iter_data(iter);
+   handle = cso->data;
+   ctx->depth_stencil_cso = cso;
+
    if (ctx->depth_stencil != handle) {
       ctx->depth_stencil = handle;
       ctx->pipe->bind_depth_stencil_alpha_state(ctx->pipe, handle);
@@ -508,6 +530,7 @@ void cso_restore_depth_stencil_alpha(struct cso_context *ctx)
 {
    if (ctx->depth_stencil != ctx->depth_stencil_saved) {
       ctx->depth_stencil = ctx->depth_stencil_saved;
+      ctx->depth_stencil_cso = NULL;
       ctx->pipe->bind_depth_stencil_alpha_state(ctx->pipe,
                                                 ctx->depth_stencil_saved);
    }
@@ -520,15 +543,21 @@ enum pipe_error cso_set_rasterizer(struct cso_context *ctx,
                                    const struct pipe_rasterizer_state *templ)
 {
    unsigned key_size = sizeof(struct pipe_rasterizer_state);
-   unsigned hash_key = cso_construct_key((void*)templ, key_size);
-   struct cso_hash_iter iter = cso_find_state_template(ctx->cache,
-                                                       hash_key,
-                                                       CSO_RASTERIZER,
-                                                       (void*)templ, key_size);
+   unsigned hash_key;
+   struct cso_hash_iter iter;
+   struct cso_rasterizer *cso;
    void *handle = NULL;
 
+   if (ctx->rasterizer_cso &&
+       !memcmp(&ctx->rasterizer_cso->state, templ, key_size))
+      return PIPE_OK;
+
+   hash_key = cso_construct_key((void*)templ, key_size);
+   iter = cso_find_state_template(ctx->cache, hash_key, CSO_RASTERIZER,
+                                  (void*)templ, key_size);
+
    if (cso_hash_iter_is_null(iter)) {
-      struct cso_rasterizer *cso = MALLOC(sizeof(struct cso_rasterizer));
+      cso = MALLOC(sizeof(struct cso_rasterizer));
       if (!cso)
          return PIPE_ERROR_OUT_OF_MEMORY;
 
@@ -543,13 +572,12 @@ enum pipe_error cso_set_rasterizer(struct cso_context *ctx,
          FREE(cso);
          return PIPE_ERROR_OUT_OF_MEMORY;
       }
-
-      handle = cso->data;
-   }
-   else {
-      handle = ((struct cso_rasterizer *)cso_hash_iter_data(iter))->data;
    }
 
+   cso = (struct cso_rasterizer *)cso_hash_iter_data(iter);
+   handle = cso->data;
+   ctx->rasterizer_cso = cso;
+
    if (ctx->rasterizer != handle) {
       ctx->rasterizer = handle;
       ctx->pipe->bind_rasterizer_state(ctx->pipe, handle);
@@ -567,6 +595,7 @@ void cso_restore_rasterizer(struct cso_context *ctx)
 {
    if (ctx->rasterizer != ctx->rasterizer_saved) {
       ctx->rasterizer = ctx->rasterizer_saved;
+      ctx->rasterizer_cso = NULL;
       ctx->pipe->bind_rasterizer_state(ctx->pipe, ctx->rasterizer_saved);
    }
    ctx->rasterizer_saved = NULL;
@@ -740,6 +769,47 @@ void cso_restore_stencil_ref(struct cso_context *ctx)
    }
 }
 
+
+/**
+ * Set the states selected by mask from the block.  All of them are set
+ * even if one fails, the first error is returned.
+ */
+enum pipe_error
+cso_set_state_block(struct cso_context *ctx, unsigned mask,
+                    const struct cso_state_block *block)
+{
+   enum pipe_error ret = PIPE_OK, err;
+
+   if (mask & CSO_BIT_BLEND) {
+      err = cso_set_blend(ctx, block->blend);
+      if (ret == PIPE_OK)
+         ret = err;
+   }
+
+   if (mask & CSO_BIT_DEPTH_STENCIL_ALPHA) {
+      err = cso_set_depth_stencil_alpha(ctx, block->depth_stencil_alpha);
+      if (ret == PIPE_OK)
+         ret = err;
+   }
+
+   if (mask & CSO_BIT_RASTERIZER) {
+      err = cso_set_rasterizer(ctx, block->rasterizer);
+      if (ret == PIPE_OK)
+         ret = err;
+   }
+
+   if (mask & CSO_BIT_BLEND_COLOR)
+      cso_set_blend_color(ctx, block->blend_color);
+
+   if (mask & CSO_BIT_SAMPLE_MASK)
+      cso_set_sample_mask(ctx, block->sample_mask);
+
+   if (mask & CSO_BIT_STENCIL_REF)
+      cso_set_stencil_ref(ctx, block->stencil_ref);
+
+   return ret;
+}
+
 void cso_set_render_condition(struct cso_context *ctx,
                               struct pipe_query *query,
                               boolean condition, uint mode)
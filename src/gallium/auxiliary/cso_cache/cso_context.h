@@ -169,6 +169,31 @@ void cso_set_stencil_ref(struct cso_context *cso,
 void cso_save_stencil_ref(struct cso_context *cso);
 void cso_restore_stencil_ref(struct cso_context *cso);
 
+
+/* Setting several of the above in one call.  Only the states whose bits
+ * are in the mask are looked at.
+ */
+
+#define CSO_BIT_BLEND               (1 << 0)
+#define CSO_BIT_DEPTH_STENCIL_ALPHA (1 << 1)
+#define CSO_BIT_RASTERIZER          (1 << 2)
+#define CSO_BIT_BLEND_COLOR         (1 << 3)
+#define CSO_BIT_SAMPLE_MASK         (1 << 4)
+#define CSO_BIT_STENCIL_REF         (1 << 5)
+
+struct cso_state_block {
+   const struct pipe_blend_state *blend;
+   const struct pipe_depth_stencil_alpha_state *depth_stencil_alpha;
+   const struct pipe_rasterizer_state *rasterizer;
+   const struct pipe_blend_color *blend_color;
+   unsigned sample_mask;
+   const struct pipe_stencil_ref *stencil_ref;
+};
+
+enum pipe_error
+cso_set_state_block(struct cso_context *cso, unsigned mask,
+                    const struct cso_state_block *block);
+
 void cso_set_render_condition(struct cso_context *cso,
                               struct pipe_query *query,
                               boolean condition, uint mode);
@@ -31,409 +31,336 @@
   */
 
 #include "util/u_debug.h"
+#include "util/u_math.h"
 #include "util/u_memory.h"
 
 #include "cso_hash.h"
 
-#define MAX(a, b) ((a > b) ? (a) : (b))
-
-static const int MinNumBits = 4;
-
-static const unsigned char prime_deltas[] = {
-   0,  0,  1,  3,  1,  5,  3,  3,  1,  9,  7,  5,  3,  9, 25,  3,
-   1, 21,  3, 21,  7, 15,  9,  5,  3, 29, 15,  0,  0,  0,  0,  0
-};
-
-static int primeForNumBits(int numBits)
-{
-   return (1 << numBits) + prime_deltas[numBits];
-}
 
 /*
-    Returns the smallest integer n such that
-    primeForNumBits(n) >= hint.
-*/
-static int countBits(int hint)
-{
-   int numBits = 0;
-   int bits = hint;
+ * The table is a flat array of slots with the keys stored inline, using
+ * open addressing with linear probing.  Probing never wraps around: the
+ * array has a small overflow tail past the last bucket which is grown on
+ * demand instead.  That keeps all the entries with a given key in array
+ * order after the first one cso_hash_find() returns, so walking forward
+ * with cso_hash_iter_next() still visits every one of them.
+ *
+ * Removed entries leave a tombstone behind so that probe runs stay intact.
+ * Tombstones are dropped whenever the table is rehashed, or right away if
+ * no probe run continues past them.
+ */
 
-   while (bits > 1) {
-      bits >>= 1;
-      numBits++;
-   }
+static const int MinNumBits = 4;
+static const int MinTailSlots = 8;
 
-   if (numBits >= (int)sizeof(prime_deltas)) {
-      numBits = sizeof(prime_deltas) - 1;
-   } else if (primeForNumBits(numBits) < hint) {
-      ++numBits;
-   }
-   return numBits;
-}
+#define CSO_SLOT_EMPTY   0
+#define CSO_SLOT_USED    1
+#define CSO_SLOT_DELETED 2
 
 struct cso_node {
-   struct cso_node *next;
    unsigned key;
+   unsigned state;
    void *value;
 };
 
-struct cso_hash_data {
-   struct cso_node *fakeNext;
-   struct cso_node **buckets;
+struct cso_hash {
+   struct cso_node *slots;
+   int numSlots;     /**< numBuckets plus the overflow tail */
+   int numBuckets;   /**< always a power of two, or zero */
+   int numBits;
    int size;
-   int nodeSize;
-   short userNumBits;
-   short numBits;
-   int numBuckets;
+   int numDeleted;
+   int firstUsed;    /**< no slot below this is in use */
 };
 
-struct cso_hash {
-   union {
-      struct cso_hash_data *d;
-      struct cso_node      *e;
-   } data;
-};
 
-static void *cso_data_allocate_node(struct cso_hash_data *hash)
+/**
+ * Map the key to its bucket.  The keys aren't necessarily well
+ * distributed hashes (some callers use pointers or handles) so they are
+ * mixed with a multiplicative hash first.
+ */
+static INLINE int cso_hash_bucket(const struct cso_hash *hash, unsigned key)
 {
-   return MALLOC(hash->nodeSize);
+   return (int)((key * 0x9e3779b9u) >> (32 - hash->numBits));
 }
 
-static void cso_free_node(struct cso_node *node)
+static boolean cso_data_grow_tail(struct cso_hash *hash)
 {
-   FREE(node);
+   int tail = hash->numSlots - hash->numBuckets;
+   int numSlots = hash->numSlots + MAX2(tail, MinTailSlots);
+   struct cso_node *slots;
+
+   slots = REALLOC(hash->slots,
+                   hash->numSlots * sizeof(struct cso_node),
+                   numSlots * sizeof(struct cso_node));
+   if (!slots)
+      return FALSE;
+
+   memset(slots + hash->numSlots, 0,
+          (numSlots - hash->numSlots) * sizeof(struct cso_node));
+   hash->slots = slots;
+   hash->numSlots = numSlots;
+   return TRUE;
 }
 
-static struct cso_node *
-cso_hash_create_node(struct cso_hash *hash,
-                      unsigned akey, void *avalue,
-                      struct cso_node **anextNode)
+/**
+ * Put the entry in the first free slot of its probe run.
+ */
+static struct cso_node *cso_data_place(struct cso_hash *hash,
+                                       unsigned key, void *value)
 {
-   struct cso_node *node = cso_data_allocate_node(hash->data.d);
-
-   if (!node)
-      return NULL;
-
-   node->key = akey;
-   node->value = avalue;
+   int i = cso_hash_bucket(hash, key);
+   struct cso_node *node;
+
+   for (;;) {
+      if (i == hash->numSlots && !cso_data_grow_tail(hash))
+         return NULL;
+      if (hash->slots[i].state != CSO_SLOT_USED)
+         break;
+      ++i;
+   }
 
-   node->next = (struct cso_node*)(*anextNode);
-   *anextNode = node;
-   ++hash->data.d->size;
+   node = &hash->slots[i];
+   if (node->state == CSO_SLOT_DELETED)
+      --hash->numDeleted;
+   node->key = key;
+   node->state = CSO_SLOT_USED;
+   node->value = value;
+   ++hash->size;
+   if (i < hash->firstUsed)
+      hash->firstUsed = i;
    return node;
 }
 
-static void cso_data_rehash(struct cso_hash_data *hash, int hint)
+static boolean cso_data_rehash(struct cso_hash *hash, int numBits)
 {
-   if (hint < 0) {
-      hint = countBits(-hint);
-      if (hint < MinNumBits)
-         hint = MinNumBits;
-      hash->userNumBits = (short)hint;
-      while (primeForNumBits(hint) < (hash->size >> 1))
-         ++hint;
-   } else if (hint < MinNumBits) {
-      hint = MinNumBits;
+   struct cso_hash old = *hash;
+   int i;
+
+   hash->numBits = numBits;
+   hash->numBuckets = 1 << numBits;
+   hash->numSlots = hash->numBuckets + MinTailSlots;
+   hash->slots = CALLOC(hash->numSlots, sizeof(struct cso_node));
+   hash->size = 0;
+   hash->numDeleted = 0;
+   hash->firstUsed = hash->numSlots;
+   if (!hash->slots) {
+      *hash = old;
+      return FALSE;
    }
 
-   if (hash->numBits != hint) {
-      struct cso_node *e = (struct cso_node *)(hash);
-      struct cso_node **oldBuckets = hash->buckets;
-      int oldNumBuckets = hash->numBuckets;
-      int  i = 0;
-
-      hash->numBits = (short)hint;
-      hash->numBuckets = primeForNumBits(hint);
-      hash->buckets = MALLOC(sizeof(struct cso_node*) * hash->numBuckets);
-      for (i = 0; i < hash->numBuckets; ++i)
-         hash->buckets[i] = e;
-
-      for (i = 0; i < oldNumBuckets; ++i) {
-         struct cso_node *firstNode = oldBuckets[i];
-         while (firstNode != e) {
-            unsigned h = firstNode->key;
-            struct cso_node *lastNode = firstNode;
-            struct cso_node *afterLastNode;
-            struct cso_node **beforeFirstNode;
-            
-            while (lastNode->next != e && lastNode->next->key == h)
-               lastNode = lastNode->next;
-
-            afterLastNode = lastNode->next;
-            beforeFirstNode = &hash->buckets[h % hash->numBuckets];
-            while (*beforeFirstNode != e)
-               beforeFirstNode = &(*beforeFirstNode)->next;
-            lastNode->next = *beforeFirstNode;
-            *beforeFirstNode = firstNode;
-            firstNode = afterLastNode;
-         }
+   for (i = old.firstUsed; i < old.numSlots; ++i) {
+      struct cso_node *node = &old.slots[i];
+      if (node->state == CSO_SLOT_USED &&
+          !cso_data_place(hash, node->key, node->value)) {
+         FREE(hash->slots);
+         *hash = old;
+         return FALSE;
       }
-      FREE(oldBuckets);
    }
+
+   FREE(old.slots);
+   return TRUE;
 }
 
-static void cso_data_might_grow(struct cso_hash_data *hash)
+static void cso_data_might_grow(struct cso_hash *hash)
 {
-   if (hash->size >= hash->numBuckets)
-      cso_data_rehash(hash, hash->numBits + 1);
+   if (!hash->numBuckets) {
+      cso_data_rehash(hash, MinNumBits);
+   }
+   else if ((hash->size + hash->numDeleted + 1) * 2 > hash->numBuckets) {
+      /* Grow unless it's mostly tombstones which filled the table up */
+      int numBits = hash->numBits;
+      if ((hash->size + 1) * 4 > hash->numBuckets)
+         ++numBits;
+      cso_data_rehash(hash, numBits);
+   }
 }
 
-static void cso_data_has_shrunk(struct cso_hash_data *hash)
+static void cso_data_has_shrunk(struct cso_hash *hash)
 {
    if (hash->size <= (hash->numBuckets >> 3) &&
-       hash->numBits > hash->userNumBits) {
-      int max = MAX(hash->numBits-2, hash->userNumBits);
-      cso_data_rehash(hash,  max);
+       hash->numBits > MinNumBits) {
+      cso_data_rehash(hash, MAX2(hash->numBits - 2, MinNumBits));
    }
 }
 
-static struct cso_node *cso_data_first_node(struct cso_hash_data *hash)
+/**
+ * Turn the slot into a tombstone, or into a free slot when no probe run
+ * goes past it.  Later slots are left untouched, so iterators stay valid.
+ */
+static void cso_data_remove_node(struct cso_hash *hash, struct cso_node *node)
 {
-   struct cso_node *e = (struct cso_node *)(hash);
-   struct cso_node **bucket = hash->buckets;
-   int n = hash->numBuckets;
-   while (n--) {
-      if (*bucket != e)
-         return *bucket;
-      ++bucket;
+   struct cso_node *end = hash->slots + hash->numSlots;
+
+   node->state = CSO_SLOT_DELETED;
+   node->value = NULL;
+   --hash->size;
+   ++hash->numDeleted;
+
+   while (node->state == CSO_SLOT_DELETED &&
+          (node + 1 == end || node[1].state == CSO_SLOT_EMPTY)) {
+      node->state = CSO_SLOT_EMPTY;
+      --hash->numDeleted;
+      if (node == hash->slots)
+         break;
+      --node;
    }
-   return e;
 }
 
-static struct cso_node **cso_hash_find_node(struct cso_hash *hash, unsigned akey)
+static struct cso_node *cso_hash_find_node(struct cso_hash *hash, unsigned akey)
 {
-   struct cso_node **node;
-
-   if (hash->data.d->numBuckets) {
-      node = (struct cso_node **)(&hash->data.d->buckets[akey % hash->data.d->numBuckets]);
-      assert(*node == hash->data.e || (*node)->next);
-      while (*node != hash->data.e && (*node)->key != akey)
-         node = &(*node)->next;
-   } else {
-      node = (struct cso_node **)((const struct cso_node * const *)(&hash->data.e));
+   struct cso_node *node, *end;
+
+   if (!hash->numBuckets)
+      return NULL;
+
+   node = &hash->slots[cso_hash_bucket(hash, akey)];
+   end = hash->slots + hash->numSlots;
+   for (; node != end && node->state != CSO_SLOT_EMPTY; ++node) {
+      if (node->key == akey && node->state == CSO_SLOT_USED)
+         return node;
    }
-   return node;
+   return NULL;
 }
 
 struct cso_hash_iter cso_hash_insert(struct cso_hash *hash,
                                        unsigned key, void *data)
 {
-   cso_data_might_grow(hash->data.d);
-
-   {
-      struct cso_node **nextNode = cso_hash_find_node(hash, key);
-      struct cso_node *node = cso_hash_create_node(hash, key, data, nextNode);
-      if (!node) {
-         struct cso_hash_iter null_iter = {hash, 0};
-         return null_iter;
-      }
+   struct cso_hash_iter iter = {hash, NULL};
 
-      {
-         struct cso_hash_iter iter = {hash, node};
-         return iter;
-      }
-   }
+   /* If growing fails there may still be room left */
+   cso_data_might_grow(hash);
+   if (hash->numBuckets)
+      iter.node = cso_data_place(hash, key, data);
+
+   return iter;
 }
 
 struct cso_hash * cso_hash_create(void)
 {
-   struct cso_hash *hash = MALLOC_STRUCT(cso_hash);
-   if (!hash)
-      return NULL;
-
-   hash->data.d = MALLOC_STRUCT(cso_hash_data);
-   if (!hash->data.d) {
-      FREE(hash);
-      return NULL;
-   }
-
-   hash->data.d->fakeNext = 0;
-   hash->data.d->buckets = 0;
-   hash->data.d->size = 0;
-   hash->data.d->nodeSize = sizeof(struct cso_node);
-   hash->data.d->userNumBits = (short)MinNumBits;
-   hash->data.d->numBits = 0;
-   hash->data.d->numBuckets = 0;
-
-   return hash;
+   return CALLOC_STRUCT(cso_hash);
 }
 
 void cso_hash_delete(struct cso_hash *hash)
 {
-   struct cso_node *e_for_x = (struct cso_node *)(hash->data.d);
-   struct cso_node **bucket = (struct cso_node **)(hash->data.d->buckets);
-   int n = hash->data.d->numBuckets;
-   while (n--) {
-      struct cso_node *cur = *bucket++;
-      while (cur != e_for_x) {
-         struct cso_node *next = cur->next;
-         cso_free_node(cur);
-         cur = next;
-      }
-   }
-   FREE(hash->data.d->buckets);
-   FREE(hash->data.d);
+   FREE(hash->slots);
    FREE(hash);
 }
 
 struct cso_hash_iter cso_hash_find(struct cso_hash *hash,
                                      unsigned key)
 {
-   struct cso_node **nextNode = cso_hash_find_node(hash, key);
-   struct cso_hash_iter iter = {hash, *nextNode};
+   struct cso_hash_iter iter = {hash, cso_hash_find_node(hash, key)};
    return iter;
 }
 
 unsigned cso_hash_iter_key(struct cso_hash_iter iter)
 {
-   if (!iter.node || iter.hash->data.e == iter.node)
+   if (!iter.node)
       return 0;
    return iter.node->key;
 }
 
 void * cso_hash_iter_data(struct cso_hash_iter iter)
 {
-   if (!iter.node || iter.hash->data.e == iter.node)
+   if (!iter.node)
       return 0;
    return iter.node->value;
 }
 
-static struct cso_node *cso_hash_data_next(struct cso_node *node)
+struct cso_hash_iter cso_hash_iter_next(struct cso_hash_iter iter)
 {
-   union {
-      struct cso_node *next;
-      struct cso_node *e;
-      struct cso_hash_data *d;
-   } a;
-   int start;
-   struct cso_node **bucket;
-   int n;
-
-   a.next = node->next;
-   if (!a.next) {
+   struct cso_hash_iter next = {iter.hash, NULL};
+   struct cso_node *node = iter.node;
+   struct cso_node *end;
+
+   if (!node) {
       debug_printf("iterating beyond the last element\n");
-      return 0;
+      return next;
    }
-   if (a.next->next)
-      return a.next;
-
-   start = (node->key % a.d->numBuckets) + 1;
-   bucket = a.d->buckets + start;
-   n = a.d->numBuckets - start;
-   while (n--) {
-      if (*bucket != a.e)
-         return *bucket;
-      ++bucket;
+
+   end = iter.hash->slots + iter.hash->numSlots;
+   while (++node != end) {
+      if (node->state == CSO_SLOT_USED) {
+         next.node = node;
+         break;
+      }
    }
-   return a.e;
+   return next;
 }
 
-
-static struct cso_node *cso_hash_data_prev(struct cso_node *node)
+struct cso_hash_iter cso_hash_iter_prev(struct cso_hash_iter iter)
 {
-   union {
-      struct cso_node *e;
-      struct cso_hash_data *d;
-   } a;
-   int start;
-   struct cso_node *sentinel;
-   struct cso_node **bucket;
-
-   a.e = node;
-   while (a.e->next)
-      a.e = a.e->next;
-
-   if (node == a.e)
-      start = a.d->numBuckets - 1;
-   else
-      start = node->key % a.d->numBuckets;
-
-   sentinel = node;
-   bucket = a.d->buckets + start;
-   while (start >= 0) {
-      if (*bucket != sentinel) {
-         struct cso_node *prev = *bucket;
-         while (prev->next != sentinel)
-            prev = prev->next;
+   struct cso_hash_iter prev = {iter.hash, NULL};
+   struct cso_hash *hash = iter.hash;
+   struct cso_node *node;
+
+   /* Stepping back from the end gives the last element */
+   node = iter.node ? iter.node : hash->slots + hash->numSlots;
+
+   while (node > hash->slots + hash->firstUsed) {
+      --node;
+      if (node->state == CSO_SLOT_USED) {
+         prev.node = node;
          return prev;
       }
-
-      sentinel = a.e;
-      --bucket;
-      --start;
    }
    debug_printf("iterating backward beyond first element\n");
-   return a.e;
-}
-
-struct cso_hash_iter cso_hash_iter_next(struct cso_hash_iter iter)
-{
-   struct cso_hash_iter next = {iter.hash, cso_hash_data_next(iter.node)};
-   return next;
+   return prev;
 }
 
 int cso_hash_iter_is_null(struct cso_hash_iter iter)
 {
-   if (!iter.node || iter.node == iter.hash->data.e)
-      return 1;
-   return 0;
+   return !iter.node;
 }
 
 void * cso_hash_take(struct cso_hash *hash,
                       unsigned akey)
 {
-   struct cso_node **node = cso_hash_find_node(hash, akey);
-   if (*node != hash->data.e) {
-      void *t = (*node)->value;
-      struct cso_node *next = (*node)->next;
-      cso_free_node(*node);
-      *node = next;
-      --hash->data.d->size;
-      cso_data_has_shrunk(hash->data.d);
+   struct cso_node *node = cso_hash_find_node(hash, akey);
+   if (node) {
+      void *t = node->value;
+      cso_data_remove_node(hash, node);
+      cso_data_has_shrunk(hash);
       return t;
    }
    return 0;
 }
 
-struct cso_hash_iter cso_hash_iter_prev(struct cso_hash_iter iter)
-{
-   struct cso_hash_iter prev = {iter.hash,
-                                 cso_hash_data_prev(iter.node)};
-   return prev;
-}
-
 struct cso_hash_iter cso_hash_first_node(struct cso_hash *hash)
 {
-   struct cso_hash_iter iter = {hash, cso_data_first_node(hash->data.d)};
+   struct cso_hash_iter iter = {hash, NULL};
+   int i;
+
+   for (i = hash->firstUsed; i < hash->numSlots; ++i) {
+      if (hash->slots[i].state == CSO_SLOT_USED) {
+         iter.node = &hash->slots[i];
+         break;
+      }
+   }
+   hash->firstUsed = i;
    return iter;
 }
 
 int cso_hash_size(struct cso_hash *hash)
 {
-   return hash->data.d->size;
+   return hash->size;
 }
 
 struct cso_hash_iter cso_hash_erase(struct cso_hash *hash, struct cso_hash_iter iter)
 {
-   struct cso_hash_iter ret = iter;
-   struct cso_node *node = iter.node;
-   struct cso_node **node_ptr;
+   struct cso_hash_iter ret;
 
-   if (node == hash->data.e)
+   if (!iter.node)
       return iter;
 
-   ret = cso_hash_iter_next(ret);
-   node_ptr = (struct cso_node**)(&hash->data.d->buckets[node->key % hash->data.d->numBuckets]);
-   while (*node_ptr != node)
-      node_ptr = &(*node_ptr)->next;
-   *node_ptr = node->next;
-   cso_free_node(node);
-   --hash->data.d->size;
+   ret = cso_hash_iter_next(iter);
+   cso_data_remove_node(hash, iter.node);
    return ret;
 }
 
 boolean cso_hash_contains(struct cso_hash *hash, unsigned key)
 {
-   struct cso_node **node = cso_hash_find_node(hash, key);
-   return (*node != hash->data.e);
+   return cso_hash_find_node(hash, key) != NULL;
 }
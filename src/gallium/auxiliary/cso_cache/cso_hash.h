@@ -30,13 +30,13 @@
  * Hash table implementation.
  * 
  * This file provides a hash implementation that is capable of dealing
- * with collisions. It stores colliding entries in linked list. All
- * functions operating on the hash return an iterator. The iterator
- * itself points to the collision list. If there wasn't any collision
- * the list will have just one entry, otherwise client code should
- * iterate over the entries to find the exact entry among ones that
- * had the same key (e.g. memcmp could be used on the data to check
- * that)
+ * with collisions. It uses open addressing, storing the keys inline in a
+ * flat array of slots. All functions operating on the hash return an
+ * iterator. Entries with colliding keys are found by starting from the
+ * iterator cso_hash_find returns and stepping with cso_hash_iter_next,
+ * which visits all of them but may also return entries with other keys in
+ * between, so client code should check the data to find the exact entry
+ * (e.g. memcmp could be used on the data to check that)
  * 
  * @author Zack Rusin <zackr@vmware.com>
  */
@@ -70,8 +70,8 @@ int              cso_hash_size(struct cso_hash *hash);
 
 /**
  * Adds a data with the given key to the hash. If entry with the given
- * key is already in the hash, this current entry is instered before it
- * in the collision list.
+ * key is already in the hash, this entry is added as another one with the
+ * same key.
  * Function returns iterator pointing to the inserted item in the hash.
  */
 struct cso_hash_iter cso_hash_insert(struct cso_hash *hash, unsigned key,
@@ -92,7 +92,7 @@ void  *cso_hash_take(struct cso_hash *hash, unsigned key);
 struct cso_hash_iter cso_hash_first_node(struct cso_hash *hash);
 
 /**
- * Return an iterator pointing to the first entry in the collision list.
+ * Return an iterator pointing to the first entry with the given key.
  */
 struct cso_hash_iter cso_hash_find(struct cso_hash *hash, unsigned key);
 
@@ -40,6 +40,9 @@ static boolean TAG(do_cliptest)( struct pt_post_vs *pvs,
    unsigned need_pipeline = 0;
    unsigned j;
    unsigned i;
+   unsigned masks[4];
+   boolean have_masks = FALSE;
+   unsigned ucp_vertex_enable;
    bool have_cd = false;
    unsigned viewport_index_output =
       draw_current_shader_viewport_index_output(pvs->draw);
@@ -62,6 +65,12 @@ static boolean TAG(do_cliptest)( struct pt_post_vs *pvs,
       ucp_enable = (1 << num_written_clipdistance) - 1;
    }
 
+   /* The user planes which are tested with the clip vertex rather than
+    * with clip distances */
+   ucp_vertex_enable = 0;
+   if ((flags & DO_CLIP_USER) && !(have_cd && num_written_clipdistance))
+      ucp_vertex_enable = ucp_enable;
+
    for (j = 0; j < info->count; j++) {
       float *position = out->data[pos];
       unsigned mask = 0x0;
@@ -92,60 +101,45 @@ static boolean TAG(do_cliptest)( struct pt_post_vs *pvs,
             out->pre_clip_pos[i] = position[i];
          }
 
-         /* Do the hardwired planes first:
+         /* The fixed planes and the user planes using the clip vertex
+          * are tested four vertices at a time, except at the end.
           */
-         if (flags & DO_CLIP_XY_GUARD_BAND) {
-            if (-0.50 * position[0] + position[3] < 0) mask |= (1<<0);
-            if ( 0.50 * position[0] + position[3] < 0) mask |= (1<<1);
-            if (-0.50 * position[1] + position[3] < 0) mask |= (1<<2);
-            if ( 0.50 * position[1] + position[3] < 0) mask |= (1<<3);
-         }
-         else if (flags & DO_CLIP_XY) {
-            if (-position[0] + position[3] < 0) mask |= (1<<0);
-            if ( position[0] + position[3] < 0) mask |= (1<<1);
-            if (-position[1] + position[3] < 0) mask |= (1<<2);
-            if ( position[1] + position[3] < 0) mask |= (1<<3);
+         if ((j & 3) == 0) {
+            have_masks = j + 4 <= info->count;
+            if (have_masks)
+               cliptest_4(out, info->stride, pos, cv, flags,
+                          ucp_vertex_enable, plane, masks);
          }
 
-         /* Clip Z planes according to full cube, half cube or none.
-          */
-         if (flags & DO_CLIP_FULL_Z) {
-            if ( position[2] + position[3] < 0) mask |= (1<<4);
-            if (-position[2] + position[3] < 0) mask |= (1<<5);
-         }
-         else if (flags & DO_CLIP_HALF_Z) {
-            if ( position[2]               < 0) mask |= (1<<4);
-            if (-position[2] + position[3] < 0) mask |= (1<<5);
-         }
+         if (have_masks)
+            mask = masks[j & 3];
+         else
+            mask = cliptest_1(position, clipvertex, flags,
+                              ucp_vertex_enable, plane);
 
-         if (flags & DO_CLIP_USER) {
+         if ((flags & DO_CLIP_USER) && have_cd && num_written_clipdistance) {
             unsigned ucp_mask = ucp_enable;
 
+            /*
+             * for user clipping check if we have a clip distance output
+             * and the shader has written to it, otherwise use clipvertex
+             * to decide when the plane is clipping.
+             */
             while (ucp_mask) {
                unsigned plane_idx = ffs(ucp_mask)-1;
+               float clipdist;
                ucp_mask &= ~(1 << plane_idx);
                plane_idx += 6;
 
-               /*
-                * for user clipping check if we have a clip distance output
-                * and the shader has written to it, otherwise use clipvertex
-                * to decide when the plane is clipping.
-                */
-               if (have_cd && num_written_clipdistance) {
-                  float clipdist;
-                  i = plane_idx - 6;
-                  out->have_clipdist = 1;
-                  /* first four clip distance in first vector etc. */
-                  if (i < 4)
-                     clipdist = out->data[cd[0]][i];
-                  else
-                     clipdist = out->data[cd[1]][i-4];
-                  if (clipdist < 0 || util_is_inf_or_nan(clipdist))
-                     mask |= 1 << plane_idx;
-               } else {
-                  if (dot4(clipvertex, plane[plane_idx]) < 0)
-                     mask |= 1 << plane_idx;
-               }
+               i = plane_idx - 6;
+               out->have_clipdist = 1;
+               /* first four clip distance in first vector etc. */
+               if (i < 4)
+                  clipdist = out->data[cd[0]][i];
+               else
+                  clipdist = out->data[cd[1]][i-4];
+               if (clipdist < 0 || util_is_inf_or_nan(clipdist))
+                  mask |= 1 << plane_idx;
             }
          }
 
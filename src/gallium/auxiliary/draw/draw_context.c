@@ -1014,6 +1014,21 @@ draw_get_shader_param(unsigned shader, enum pipe_shader_cap param)
    return draw_get_shader_param_no_llvm(shader, param);
 }
 
+/**
+ * Use the given on-disk cache for the code generated for vertex and
+ * geometry shader variants, so it doesn't need to be compiled again by
+ * later processes.  The cache must outlive the draw context.
+ */
+void
+draw_set_disk_cache(struct draw_context *draw,
+                    struct util_disk_cache *cache)
+{
+#ifdef HAVE_LLVM
+   if (draw->llvm)
+      draw->llvm->disk_cache = cache;
+#endif
+}
+
 /**
  * Enables or disables collection of statistics.
  *
@@ -1031,6 +1046,17 @@ draw_collect_pipeline_statistics(struct draw_context *draw,
    draw->collect_statistics = enable;
 }
 
+/**
+ * Returns how many vertex shader invocations the vertex cache of the
+ * index splitter saved so far, that is how many indices referred to a
+ * vertex which had already been shaded in the same segment.
+ */
+uint64_t
+draw_get_vertex_cache_hits(const struct draw_context *draw)
+{
+   return draw->pt.vcache_hits;
+}
+
 /**
  * Computes clipper invocation statistics.
  *
@@ -195,6 +195,10 @@ void draw_vs_reset_so(struct draw_vertex_shader *dvs);
 struct draw_fragment_shader *
 draw_create_fragment_shader(struct draw_context *draw,
                             const struct pipe_shader_state *shader);
+struct draw_fragment_shader *
+draw_create_fragment_shader_info(struct draw_context *draw,
+                                 const struct pipe_shader_state *shader,
+                                 const struct tgsi_shader_info *info);
 void draw_bind_fragment_shader(struct draw_context *draw,
                                struct draw_fragment_shader *dvs);
 void draw_delete_fragment_shader(struct draw_context *draw,
@@ -276,6 +280,8 @@ void draw_set_force_passthrough( struct draw_context *draw,
 void draw_collect_pipeline_statistics(struct draw_context *draw,
                                       boolean enable);
 
+uint64_t draw_get_vertex_cache_hits(const struct draw_context *draw);
+
 /*******************************************************************************
  * Draw pipeline 
  */
@@ -294,4 +300,10 @@ boolean
 draw_get_option_use_llvm(void);
 #endif
 
+struct util_disk_cache;
+
+void
+draw_set_disk_cache(struct draw_context *draw,
+                    struct util_disk_cache *cache);
+
 #endif /* DRAW_CONTEXT_H */
@@ -41,13 +41,30 @@
 struct draw_fragment_shader *
 draw_create_fragment_shader(struct draw_context *draw,
                             const struct pipe_shader_state *shader)
+{
+   return draw_create_fragment_shader_info(draw, shader, NULL);
+}
+
+
+/**
+ * As draw_create_fragment_shader(), for drivers which have scanned the
+ * shader already, so that it needn't be scanned twice.
+ * \param info  the result of tgsi_scan_shader() on the tokens, or NULL
+ */
+struct draw_fragment_shader *
+draw_create_fragment_shader_info(struct draw_context *draw,
+                                 const struct pipe_shader_state *shader,
+                                 const struct tgsi_shader_info *info)
 {
    struct draw_fragment_shader *dfs;
 
    dfs = CALLOC_STRUCT(draw_fragment_shader);
    if (dfs) {
       dfs->base = *shader;
-      tgsi_scan_shader(shader->tokens, &dfs->info);
+      if (info)
+         dfs->info = *info;
+      else
+         tgsi_scan_shader(shader->tokens, &dfs->info);
    }
 
    return dfs;
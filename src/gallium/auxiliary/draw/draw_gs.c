@@ -674,9 +674,9 @@ void draw_geometry_shader_prepare(struct draw_geometry_shader *shader,
    boolean use_llvm = FALSE;
 #endif
    if (!use_llvm && shader && shader->machine->Tokens != shader->state.tokens) {
-      tgsi_exec_machine_bind_shader(shader->machine,
-                                    shader->state.tokens,
-                                    draw->gs.tgsi.sampler);
+      tgsi_exec_machine_bind_decoded_shader(shader->machine,
+                                            shader->decoded,
+                                            draw->gs.tgsi.sampler);
    }
 }
 
@@ -744,7 +744,14 @@ draw_create_geometry_shader(struct draw_context *draw,
       return NULL;
    }
 
-   tgsi_scan_shader(state->tokens, &gs->info);
+   gs->decoded = tgsi_decode_shader(gs->state.tokens);
+   if (!gs->decoded) {
+      FREE((void*) gs->state.tokens);
+      FREE(gs);
+      return NULL;
+   }
+
+   tgsi_scan_decoded_shader(gs->decoded, &gs->info);
 
    /* setup the defaults */
    gs->input_primitive = PIPE_PRIM_TRIANGLES;
@@ -894,6 +901,11 @@ void draw_delete_geometry_shader(struct draw_context *draw,
    }
 #endif
 
+   /* the machine only borrows the decoded shader */
+   if (dgs->machine && dgs->machine->Tokens == dgs->state.tokens)
+      tgsi_exec_machine_bind_shader(dgs->machine, NULL, NULL);
+
+   tgsi_free_decoded_shader(dgs->decoded);
    FREE(dgs->primitive_lengths);
    FREE((void*) dgs->state.tokens);
    FREE(dgs);
@@ -50,8 +50,10 @@
 
 #include "tgsi/tgsi_exec.h"
 #include "tgsi/tgsi_dump.h"
+#include "tgsi/tgsi_parse.h"
 
 #include "util/u_math.h"
+#include "util/u_memory.h"
 #include "util/u_pointer.h"
 #include "util/u_string.h"
 #include "util/u_simple_list.h"
@@ -561,6 +563,54 @@ draw_llvm_destroy(struct draw_llvm *llvm)
 }
 
 
+/**
+ * Attach the on-disk cache to the gallivm state of a new variant.  The key
+ * is made out of a build stamp, since the generated code changes with the
+ * driver itself, the draw state baked into the code which isn't part of
+ * the variant key, the variant key and the shader tokens.
+ */
+static void
+draw_llvm_set_cache_key(struct draw_llvm *llvm,
+                        struct gallivm_state *gallivm,
+                        const void *state, unsigned state_size,
+                        const void *variant_key, unsigned variant_key_size,
+                        const struct tgsi_token *tokens)
+{
+   static const char build_id[] =
+#ifdef PACKAGE_VERSION
+      PACKAGE_VERSION " "
+#endif
+      __DATE__ " " __TIME__;
+   unsigned tokens_size;
+   unsigned key_size;
+   uint8_t *key;
+   uint8_t *p;
+
+   if (!llvm->disk_cache)
+      return;
+
+   tokens_size = tgsi_num_tokens(tokens) * sizeof(struct tgsi_token);
+   key_size = sizeof build_id + state_size + variant_key_size + tokens_size;
+
+   key = MALLOC(key_size);
+   if (!key)
+      return;
+
+   p = key;
+   memcpy(p, build_id, sizeof build_id);
+   p += sizeof build_id;
+   memcpy(p, state, state_size);
+   p += state_size;
+   memcpy(p, variant_key, variant_key_size);
+   p += variant_key_size;
+   memcpy(p, tokens, tokens_size);
+
+   gallivm_set_cache_key(gallivm, llvm->disk_cache, key, key_size);
+
+   FREE(key);
+}
+
+
 /**
  * Create LLVM-generated code for a vertex shader.
  */
@@ -584,6 +634,29 @@ draw_llvm_create_variant(struct draw_llvm *llvm,
 
    variant->gallivm = gallivm_create();
 
+   if (llvm->disk_cache) {
+      struct draw_context *draw = llvm->draw;
+      struct {
+         unsigned stage;
+         unsigned num_inputs;
+         unsigned start_instance;
+         unsigned pos, cv, cd[2];
+      } state;
+
+      memset(&state, 0, sizeof state);
+      state.stage = PIPE_SHADER_VERTEX;
+      state.num_inputs = num_inputs;
+      state.start_instance = draw->start_instance;
+      state.pos = draw_current_shader_position_output(draw);
+      state.cv = draw_current_shader_clipvertex_output(draw);
+      state.cd[0] = draw_current_shader_clipdistance_output(draw, 0);
+      state.cd[1] = draw_current_shader_clipdistance_output(draw, 1);
+
+      draw_llvm_set_cache_key(llvm, variant->gallivm, &state, sizeof state,
+                              key, shader->variant_key_size,
+                              shader->base.state.tokens);
+   }
+
    create_jit_types(variant);
 
    memcpy(&variant->key, key, shader->variant_key_size);
@@ -651,6 +724,7 @@ generate_vs(struct draw_llvm_variant *variant,
                      outputs,
                      sampler,
                      &llvm->draw->vs.vertex_shader->info,
+                     NULL,
                      NULL);
 
    {
@@ -2206,7 +2280,8 @@ draw_gs_llvm_generate(struct draw_llvm *llvm,
                      outputs,
                      sampler,
                      &llvm->draw->gs.geometry_shader->info,
-                     (const struct lp_build_tgsi_gs_iface *)&gs_iface);
+                     (const struct lp_build_tgsi_gs_iface *)&gs_iface,
+                     NULL);
 
    sampler->destroy(sampler);
 
@@ -2239,6 +2314,21 @@ draw_gs_llvm_create_variant(struct draw_llvm *llvm,
 
    variant->gallivm = gallivm_create();
 
+   if (llvm->disk_cache) {
+      struct {
+         unsigned stage;
+         unsigned num_outputs;
+      } state;
+
+      memset(&state, 0, sizeof state);
+      state.stage = PIPE_SHADER_GEOMETRY;
+      state.num_outputs = num_outputs;
+
+      draw_llvm_set_cache_key(llvm, variant->gallivm, &state, sizeof state,
+                              key, shader->variant_key_size,
+                              shader->base.state.tokens);
+   }
+
    create_gs_jit_types(variant);
 
    memcpy(&variant->key, key, shader->variant_key_size);
@@ -456,9 +456,14 @@ struct llvm_geometry_shader {
 };
 
 
+struct util_disk_cache;
+
 struct draw_llvm {
    struct draw_context *draw;
 
+   /** on-disk cache of the generated code, may be NULL */
+   struct util_disk_cache *disk_cache;
+
    struct draw_jit_context jit_context;
    struct draw_gs_jit_context gs_jit_context;
 
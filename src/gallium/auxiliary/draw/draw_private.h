@@ -211,6 +211,9 @@ struct draw_context
 
       boolean test_fse;         /* enable FSE even though its not correct (eg for softpipe) */
       boolean no_fse;           /* disable FSE even when it is correct */
+
+      /** vertex shader invocations saved by the vsplit vertex cache */
+      uint64_t vcache_hits;
    } pt;
 
    struct {
@@ -25,9 +25,11 @@
  *
  **************************************************************************/
 
+#include "util/u_debug.h"
 #include "util/u_math.h"
 #include "util/u_memory.h"
 #include "util/u_prim.h"
+#include "os/os_thread.h"
 #include "draw/draw_context.h"
 #include "draw/draw_gs.h"
 #include "draw/draw_vbuf.h"
@@ -39,6 +41,44 @@
 #include "gallivm/lp_bld_init.h"
 
 
+/** Maximum number of threads running the vertex shader, see DRAW_NUM_VS_THREADS */
+#define DRAW_MAX_VS_THREADS 8
+
+/** Don't bother distributing fewer vertices per thread than this */
+#define DRAW_MIN_VS_THREAD_VERTICES 128
+
+/**
+ * Maximum number of alternating runs of clipped and unclipped triangles
+ * for which the unclipped ones bypass the pipeline.
+ */
+#define LLVM_MAX_SPLIT_RUNS 8
+
+
+struct llvm_middle_end;
+
+
+/**
+ * A vertex shading thread.  Each of them fetches and shades a consecutive
+ * range of the vertices of a draw_fetch_info straight into the shared
+ * output buffer, so the results are in order without any copying.
+ */
+struct llvm_vs_thread {
+   struct llvm_middle_end *fpme;
+
+   /* The job: vertices [start, start + count) of fetch_info */
+   const struct draw_fetch_info *fetch_info;
+   unsigned start, count;
+   struct vertex_header *verts;
+   unsigned fpstate;                /**< of the application thread */
+   int clipped;                     /**< result */
+
+   boolean exit;
+   pipe_thread thread;
+   pipe_semaphore work_ready;
+   pipe_semaphore work_done;
+};
+
+
 struct llvm_middle_end {
    struct draw_pt_middle_end base;
    struct draw_context *draw;
@@ -56,6 +96,11 @@ struct llvm_middle_end {
 
    struct draw_llvm *llvm;
    struct draw_llvm_variant *current_variant;
+
+   /* Threads for shading large vertex ranges, the first one is the
+    * application thread */
+   struct llvm_vs_thread *threads[DRAW_MAX_VS_THREADS];
+   unsigned num_threads;
 };
 
 
@@ -311,6 +356,143 @@ llvm_middle_end_bind_parameters(struct draw_pt_middle_end *middle)
 }
 
 
+/**
+ * Fetch and shade count vertices of fetch_info, starting at start, into
+ * verts.
+ * \return non-zero if any vertex needs clipping
+ */
+static int
+llvm_middle_end_shade(struct llvm_middle_end *fpme,
+                      const struct draw_fetch_info *fetch_info,
+                      unsigned start,
+                      unsigned count,
+                      struct vertex_header *verts)
+{
+   struct draw_context *draw = fpme->draw;
+
+   if (fetch_info->linear)
+      return fpme->current_variant->jit_func( &fpme->llvm->jit_context,
+                                       verts,
+                                       draw->pt.user.vbuffer,
+                                       fetch_info->start + start,
+                                       count,
+                                       fpme->vertex_size,
+                                       draw->pt.vertex_buffer,
+                                       draw->instance_id,
+                                       draw->start_index);
+   else
+      return fpme->current_variant->jit_func_elts( &fpme->llvm->jit_context,
+                                            verts,
+                                            draw->pt.user.vbuffer,
+                                            fetch_info->elts + start,
+                                            draw->pt.user.eltMax,
+                                            count,
+                                            fpme->vertex_size,
+                                            draw->pt.vertex_buffer,
+                                            draw->instance_id,
+                                            draw->pt.user.eltBias);
+}
+
+
+static void
+llvm_vs_thread_shade(struct llvm_vs_thread *thread)
+{
+   thread->clipped = llvm_middle_end_shade(thread->fpme,
+                                           thread->fetch_info,
+                                           thread->start,
+                                           thread->count,
+                                           thread->verts);
+}
+
+
+static PIPE_THREAD_ROUTINE( llvm_vs_thread_func, init_data )
+{
+   struct llvm_vs_thread *thread = (struct llvm_vs_thread *) init_data;
+
+   while (1) {
+      pipe_semaphore_wait(&thread->work_ready);
+
+      if (thread->exit)
+         break;
+
+      /* Run the shader with the same denorm handling as the application */
+      util_fpstate_set(thread->fpstate);
+
+      llvm_vs_thread_shade(thread);
+
+      pipe_semaphore_signal(&thread->work_done);
+   }
+
+   return 0;
+}
+
+
+/**
+ * Fetch and shade all the vertices of fetch_info into verts, splitting
+ * them between the vertex shading threads if there are enough of them.
+ *
+ * The generated code processes whole SIMD vectors of vertices and writes
+ * the outputs of the last, partial one too, so all but the last range are
+ * multiples of the vector length to keep the threads from writing into
+ * each other's vertices.
+ *
+ * \return non-zero if any vertex needs clipping
+ */
+static int
+llvm_middle_end_shade_threaded(struct llvm_middle_end *fpme,
+                               const struct draw_fetch_info *fetch_info,
+                               struct vertex_header *verts)
+{
+   const unsigned vector_length = lp_native_vector_width / 32;
+   const unsigned count = fetch_info->count;
+   unsigned n = MIN2(fpme->num_threads, count / DRAW_MIN_VS_THREAD_VERTICES);
+   unsigned fpstate, start, i;
+   int clipped;
+
+   /*
+    * The elts variant compares element positions against eltMax, which
+    * can't be rebased for the later ranges when eltMax is small.
+    */
+   if (!fetch_info->linear && fpme->draw->pt.user.eltMax < count)
+      n = 1;
+
+   if (n < 2)
+      return llvm_middle_end_shade(fpme, fetch_info, 0, count, verts);
+
+   fpstate = util_fpstate_get();
+
+   start = 0;
+   for (i = 0; i < n; i++) {
+      struct llvm_vs_thread *thread = fpme->threads[i];
+      unsigned end = i + 1 == n ? count :
+                     align(count * (i + 1) / n, vector_length);
+
+      thread->fetch_info = fetch_info;
+      thread->start = start;
+      thread->count = end - start;
+      thread->verts = (struct vertex_header *)
+         ((char *)verts + start * fpme->vertex_size);
+      thread->fpstate = fpstate;
+
+      start = end;
+   }
+
+   for (i = 1; i < n; i++) {
+      pipe_semaphore_signal(&fpme->threads[i]->work_ready);
+   }
+
+   llvm_vs_thread_shade(fpme->threads[0]);
+
+   clipped = fpme->threads[0]->clipped;
+   for (i = 1; i < n; i++) {
+      pipe_semaphore_wait(&fpme->threads[i]->work_done);
+      clipped |= fpme->threads[i]->clipped;
+   }
+
+   return clipped;
+}
+
+
 static void
 pipeline(struct llvm_middle_end *llvm,
          const struct draw_vertex_info *vert_info,
@@ -341,6 +523,93 @@ emit(struct pt_emit *emit,
 }
 
 
+/**
+ * Run only the triangles which actually need clipping through the
+ * pipeline, and emit the others straight to the backend.
+ *
+ * The triangles are split into runs of consecutive clipped or unclipped
+ * ones, processed in order so the rendering order is preserved.  This
+ * only works for plain triangle lists, when no pipeline stage other than
+ * clipping is needed, and isn't worth it when clipped and unclipped
+ * triangles alternate a lot.  Indexed runs emit all the vertices each
+ * time, linear ones just theirs.
+ *
+ * \return FALSE if the whole draw must go through the pipeline
+ */
+static boolean
+llvm_pipeline_split(struct llvm_middle_end *fpme,
+                    const struct draw_vertex_info *vert_info,
+                    const struct draw_prim_info *prim_info)
+{
+   const char *verts = (const char *) vert_info->verts;
+   const unsigned stride = vert_info->stride;
+   const unsigned num_tris = prim_info->count / 3;
+   unsigned run_start[LLVM_MAX_SPLIT_RUNS + 1];
+   boolean run_clipped[LLVM_MAX_SPLIT_RUNS];
+   unsigned num_runs = 0;
+   unsigned i;
+
+   if (prim_info->prim != PIPE_PRIM_TRIANGLES ||
+       prim_info->primitive_count != 1 ||
+       prim_info->count % 3 != 0)
+      return FALSE;
+
+   for (i = 0; i < num_tris; i++) {
+      unsigned v[3], clipmask;
+
+      if (prim_info->linear) {
+         v[0] = i * 3 + 0;
+         v[1] = i * 3 + 1;
+         v[2] = i * 3 + 2;
+      }
+      else {
+         v[0] = prim_info->elts[i * 3 + 0];
+         v[1] = prim_info->elts[i * 3 + 1];
+         v[2] = prim_info->elts[i * 3 + 2];
+      }
+
+      clipmask =
+         ((const struct vertex_header *)(verts + v[0] * stride))->clipmask |
+         ((const struct vertex_header *)(verts + v[1] * stride))->clipmask |
+         ((const struct vertex_header *)(verts + v[2] * stride))->clipmask;
+
+      if (num_runs == 0 || run_clipped[num_runs - 1] != (clipmask != 0)) {
+         if (num_runs == LLVM_MAX_SPLIT_RUNS)
+            return FALSE;
+         run_start[num_runs] = i;
+         run_clipped[num_runs] = clipmask != 0;
+         num_runs++;
+      }
+   }
+   run_start[num_runs] = num_tris;
+
+   for (i = 0; i < num_runs; i++) {
+      struct draw_vertex_info run_vert_info = *vert_info;
+      struct draw_prim_info run_prim_info = *prim_info;
+      unsigned count = (run_start[i + 1] - run_start[i]) * 3;
+
+      run_prim_info.count = count;
+      run_prim_info.primitive_lengths = &count;
+
+      if (prim_info->linear) {
+         run_vert_info.verts = (struct vertex_header *)
+            (verts + run_start[i] * 3 * stride);
+         run_vert_info.count = count;
+      }
+      else {
+         run_prim_info.elts = prim_info->elts + run_start[i] * 3;
+      }
+
+      if (run_clipped[i])
+         pipeline( fpme, &run_vert_info, &run_prim_info );
+      else
+         emit( fpme->emit, &run_vert_info, &run_prim_info );
+   }
+
+   return TRUE;
+}
+
+
 static void
 llvm_pipeline_generic(struct draw_pt_middle_end *middle,
                       const struct draw_fetch_info *fetch_info,
@@ -378,27 +647,8 @@ llvm_pipeline_generic(struct draw_pt_middle_end *middle,
       draw->statistics.vs_invocations += fetch_info->count;
    }
 
-   if (fetch_info->linear)
-      clipped = fpme->current_variant->jit_func( &fpme->llvm->jit_context,
-                                       llvm_vert_info.verts,
-                                       draw->pt.user.vbuffer,
-                                       fetch_info->start,
-                                       fetch_info->count,
-                                       fpme->vertex_size,
-                                       draw->pt.vertex_buffer,
-                                       draw->instance_id,
-                                       draw->start_index);
-   else
-      clipped = fpme->current_variant->jit_func_elts( &fpme->llvm->jit_context,
-                                            llvm_vert_info.verts,
-                                            draw->pt.user.vbuffer,
-                                            fetch_info->elts,
-                                            draw->pt.user.eltMax,
-                                            fetch_info->count,
-                                            fpme->vertex_size,
-                                            draw->pt.vertex_buffer,
-                                            draw->instance_id,
-                                            draw->pt.user.eltBias);
+   clipped = llvm_middle_end_shade_threaded(fpme, fetch_info,
+                                            llvm_vert_info.verts);
 
    /* Finished with fetch and vs:
     */
@@ -462,7 +712,13 @@ llvm_pipeline_generic(struct draw_pt_middle_end *middle,
       /* Do we need to run the pipeline? Now will come here if clipped
        */
       if (opt & PT_PIPELINE) {
-         pipeline( fpme, vert_info, prim_info );
+         if (!(fpme->opt & PT_PIPELINE) &&
+             llvm_pipeline_split( fpme, vert_info, prim_info )) {
+            /* only the clipped triangles went through the pipeline */
+         }
+         else {
+            pipeline( fpme, vert_info, prim_info );
+         }
       }
       else {
          emit( fpme->emit, vert_info, prim_info );
@@ -572,11 +828,72 @@ llvm_middle_end_finish(struct draw_pt_middle_end *middle)
 }
 
 
+/**
+ * Create the vertex shading threads.  The first of them runs on the
+ * application thread, so num_threads - 1 new threads are started.
+ */
+static boolean
+llvm_middle_end_init_threads(struct llvm_middle_end *fpme,
+                             unsigned num_threads)
+{
+   unsigned i;
+
+   num_threads = MIN2(num_threads, DRAW_MAX_VS_THREADS);
+   if (num_threads < 2)
+      return TRUE;
+
+   for (i = 0; i < num_threads; i++) {
+      struct llvm_vs_thread *thread = CALLOC_STRUCT(llvm_vs_thread);
+      if (!thread)
+         return FALSE;
+
+      thread->fpme = fpme;
+
+      if (i > 0) {
+         pipe_semaphore_init(&thread->work_ready, 0);
+         pipe_semaphore_init(&thread->work_done, 0);
+         thread->thread = pipe_thread_create(llvm_vs_thread_func, thread);
+      }
+
+      fpme->threads[i] = thread;
+      fpme->num_threads = i + 1;
+   }
+
+   return TRUE;
+}
+
+
+static void
+llvm_middle_end_destroy_threads(struct llvm_middle_end *fpme)
+{
+   unsigned i;
+
+   for (i = 0; i < fpme->num_threads; i++) {
+      struct llvm_vs_thread *thread = fpme->threads[i];
+
+      if (i > 0) {
+         thread->exit = TRUE;
+         pipe_semaphore_signal(&thread->work_ready);
+         pipe_thread_wait(thread->thread);
+         pipe_semaphore_destroy(&thread->work_ready);
+         pipe_semaphore_destroy(&thread->work_done);
+      }
+
+      FREE(thread);
+      fpme->threads[i] = NULL;
+   }
+
+   fpme->num_threads = 0;
+}
+
+
 static void
 llvm_middle_end_destroy(struct draw_pt_middle_end *middle)
 {
    struct llvm_middle_end *fpme = llvm_middle_end(middle);
 
+   llvm_middle_end_destroy_threads(fpme);
+
    if (fpme->fetch)
       draw_pt_fetch_destroy( fpme->fetch );
 
@@ -637,6 +954,11 @@ draw_pt_fetch_pipeline_or_emit_llvm(struct draw_context *draw)
 
    fpme->current_variant = NULL;
 
+   if (!llvm_middle_end_init_threads(fpme,
+                                     debug_get_num_option("DRAW_NUM_VS_THREADS",
+                                                          0)))
+      goto fail;
+
    return &fpme->base;
 
  fail:
@@ -28,6 +28,7 @@
 #include "util/u_memory.h"
 #include "util/u_math.h"
 #include "util/u_prim.h"
+#include "util/u_sse.h"
 #include "pipe/p_context.h"
 #include "draw/draw_context.h"
 #include "draw/draw_private.h"
@@ -71,6 +72,174 @@ dot4(const float *a, const float *b)
            a[3]*b[3]);
 }
 
+
+/**
+ * Clip mask of a vertex against the fixed planes, and against the user
+ * planes in ucp_enable using the clip vertex.
+ */
+static INLINE unsigned
+cliptest_1(const float *position, const float *clipvertex,
+           unsigned flags, unsigned ucp_enable, float (*plane)[4])
+{
+   unsigned mask = 0;
+
+   /* Do the hardwired planes first:
+    */
+   if (flags & DO_CLIP_XY_GUARD_BAND) {
+      if (-0.50 * position[0] + position[3] < 0) mask |= (1<<0);
+      if ( 0.50 * position[0] + position[3] < 0) mask |= (1<<1);
+      if (-0.50 * position[1] + position[3] < 0) mask |= (1<<2);
+      if ( 0.50 * position[1] + position[3] < 0) mask |= (1<<3);
+   }
+   else if (flags & DO_CLIP_XY) {
+      if (-position[0] + position[3] < 0) mask |= (1<<0);
+      if ( position[0] + position[3] < 0) mask |= (1<<1);
+      if (-position[1] + position[3] < 0) mask |= (1<<2);
+      if ( position[1] + position[3] < 0) mask |= (1<<3);
+   }
+
+   /* Clip Z planes according to full cube, half cube or none.
+    */
+   if (flags & DO_CLIP_FULL_Z) {
+      if ( position[2] + position[3] < 0) mask |= (1<<4);
+      if (-position[2] + position[3] < 0) mask |= (1<<5);
+   }
+   else if (flags & DO_CLIP_HALF_Z) {
+      if ( position[2]               < 0) mask |= (1<<4);
+      if (-position[2] + position[3] < 0) mask |= (1<<5);
+   }
+
+   while (ucp_enable) {
+      unsigned plane_idx = ffs(ucp_enable)-1;
+      ucp_enable &= ~(1 << plane_idx);
+      plane_idx += 6;
+
+      if (dot4(clipvertex, plane[plane_idx]) < 0)
+         mask |= 1 << plane_idx;
+   }
+
+   return mask;
+}
+
+
+#if defined(PIPE_ARCH_SSE)
+
+/**
+ * Load a vec4 attribute of four vertices, transposed to SoA.
+ */
+static INLINE void
+load_soa_4(const struct vertex_header *vert, unsigned stride,
+           unsigned attrib, __m128 soa[4])
+{
+   soa[0] = _mm_loadu_ps(vert->data[attrib]);
+   vert = (const struct vertex_header *)((const char *)vert + stride);
+   soa[1] = _mm_loadu_ps(vert->data[attrib]);
+   vert = (const struct vertex_header *)((const char *)vert + stride);
+   soa[2] = _mm_loadu_ps(vert->data[attrib]);
+   vert = (const struct vertex_header *)((const char *)vert + stride);
+   soa[3] = _mm_loadu_ps(vert->data[attrib]);
+
+   _MM_TRANSPOSE4_PS(soa[0], soa[1], soa[2], soa[3]);
+}
+
+
+/**
+ * Set the bit of plane_idx in the masks of the vertices where dist < 0.
+ */
+static INLINE void
+cliptest_plane_4(__m128 dist, unsigned plane_idx, unsigned mask[4])
+{
+   unsigned bits = _mm_movemask_ps(_mm_cmplt_ps(dist, _mm_setzero_ps()));
+
+   mask[0] |= ((bits >> 0) & 1) << plane_idx;
+   mask[1] |= ((bits >> 1) & 1) << plane_idx;
+   mask[2] |= ((bits >> 2) & 1) << plane_idx;
+   mask[3] |= ((bits >> 3) & 1) << plane_idx;
+}
+
+#endif /* PIPE_ARCH_SSE */
+
+
+/**
+ * Same as cliptest_1() for the four consecutive vertices starting at vert,
+ * testing each plane for all of them at once.
+ */
+static INLINE void
+cliptest_4(const struct vertex_header *vert, unsigned stride,
+           unsigned pos, unsigned cv,
+           unsigned flags, unsigned ucp_enable, float (*plane)[4],
+           unsigned mask[4])
+{
+#if defined(PIPE_ARCH_SSE)
+   __m128 p[4], c[4];
+
+   mask[0] = mask[1] = mask[2] = mask[3] = 0;
+
+   load_soa_4(vert, stride, pos, p);
+
+   if (flags & DO_CLIP_XY_GUARD_BAND) {
+      const __m128 half = _mm_set1_ps(0.5f);
+      const __m128 hx = _mm_mul_ps(half, p[0]);
+      const __m128 hy = _mm_mul_ps(half, p[1]);
+      cliptest_plane_4(_mm_sub_ps(p[3], hx), 0, mask);
+      cliptest_plane_4(_mm_add_ps(hx, p[3]), 1, mask);
+      cliptest_plane_4(_mm_sub_ps(p[3], hy), 2, mask);
+      cliptest_plane_4(_mm_add_ps(hy, p[3]), 3, mask);
+   }
+   else if (flags & DO_CLIP_XY) {
+      cliptest_plane_4(_mm_sub_ps(p[3], p[0]), 0, mask);
+      cliptest_plane_4(_mm_add_ps(p[0], p[3]), 1, mask);
+      cliptest_plane_4(_mm_sub_ps(p[3], p[1]), 2, mask);
+      cliptest_plane_4(_mm_add_ps(p[1], p[3]), 3, mask);
+   }
+
+   if (flags & DO_CLIP_FULL_Z) {
+      cliptest_plane_4(_mm_add_ps(p[2], p[3]), 4, mask);
+      cliptest_plane_4(_mm_sub_ps(p[3], p[2]), 5, mask);
+   }
+   else if (flags & DO_CLIP_HALF_Z) {
+      cliptest_plane_4(p[2], 4, mask);
+      cliptest_plane_4(_mm_sub_ps(p[3], p[2]), 5, mask);
+   }
+
+   if (ucp_enable) {
+      if (cv != pos) {
+         load_soa_4(vert, stride, cv, c);
+      }
+      else {
+         c[0] = p[0];
+         c[1] = p[1];
+         c[2] = p[2];
+         c[3] = p[3];
+      }
+
+      while (ucp_enable) {
+         unsigned plane_idx = ffs(ucp_enable)-1;
+         __m128 dist;
+         ucp_enable &= ~(1 << plane_idx);
+         plane_idx += 6;
+
+         /* same evaluation order as dot4() */
+         dist = _mm_mul_ps(c[0], _mm_set1_ps(plane[plane_idx][0]));
+         dist = _mm_add_ps(dist, _mm_mul_ps(c[1], _mm_set1_ps(plane[plane_idx][1])));
+         dist = _mm_add_ps(dist, _mm_mul_ps(c[2], _mm_set1_ps(plane[plane_idx][2])));
+         dist = _mm_add_ps(dist, _mm_mul_ps(c[3], _mm_set1_ps(plane[plane_idx][3])));
+         cliptest_plane_4(dist, plane_idx, mask);
+      }
+   }
+#else
+   unsigned i;
+
+   for (i = 0; i < 4; i++) {
+      const float *position = vert->data[pos];
+      const float *clipvertex = ucp_enable ? vert->data[cv] : position;
+      mask[i] = cliptest_1(position, clipvertex, flags, ucp_enable, plane);
+      vert = (const struct vertex_header *)((const char *)vert + stride);
+   }
+#endif
+}
+
+
 #define FLAGS (0)
 #define TAG(x) x##_none
 #include "draw_cliptest_tmp.h"
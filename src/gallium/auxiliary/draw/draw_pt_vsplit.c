@@ -23,6 +23,7 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include "util/u_debug.h"
 #include "util/u_math.h"
 #include "util/u_memory.h"
 
@@ -31,7 +32,17 @@
 #include "draw/draw_pt.h"
 
 #define SEGMENT_SIZE 1024
-#define MAP_SIZE     256
+
+/*
+ * The cache of fetched vertices is a hash table with linear probing over
+ * at most MAP_WAYS slots.  The default size is large enough for every
+ * vertex of a segment, so each vertex is shaded only once per segment;
+ * smaller sizes, set with DRAW_VSPLIT_CACHE_SIZE, make it behave like a
+ * MAP_WAYS-way set associative cache.
+ */
+#define MAP_WAYS          4
+#define MAP_MAX_SIZE      (4 * SEGMENT_SIZE)
+#define MAP_DEFAULT_SIZE  (2 * SEGMENT_SIZE)
 
 /* The largest possible index withing an index buffer */
 #define MAX_ELT_IDX 0xffffffff
@@ -54,9 +65,12 @@ struct vsplit_frontend {
 
    struct {
       /* map a fetch element to a draw element */
-      unsigned fetches[MAP_SIZE];
-      ushort draws[MAP_SIZE];
-      boolean has_max_fetch;
+      unsigned fetches[MAP_MAX_SIZE];
+      ushort draws[MAP_MAX_SIZE];
+      /* a slot is only valid in the segment whose stamp it carries */
+      unsigned stamps[MAP_MAX_SIZE];
+      unsigned stamp;
+      unsigned mask;
 
       ushort num_fetch_elts;
       ushort num_draw_elts;
@@ -67,8 +81,10 @@ struct vsplit_frontend {
 static void
 vsplit_clear_cache(struct vsplit_frontend *vsplit)
 {
-   memset(vsplit->cache.fetches, 0xff, sizeof(vsplit->cache.fetches));
-   vsplit->cache.has_max_fetch = FALSE;
+   if (++vsplit->cache.stamp == 0) {
+      memset(vsplit->cache.stamps, 0, sizeof(vsplit->cache.stamps));
+      vsplit->cache.stamp = 1;
+   }
    vsplit->cache.num_fetch_elts = 0;
    vsplit->cache.num_draw_elts = 0;
 }
@@ -76,6 +92,9 @@ vsplit_clear_cache(struct vsplit_frontend *vsplit)
 static void
 vsplit_flush_cache(struct vsplit_frontend *vsplit, unsigned flags)
 {
+   vsplit->draw->pt.vcache_hits +=
+      vsplit->cache.num_draw_elts - vsplit->cache.num_fetch_elts;
+
    vsplit->middle->run(vsplit->middle,
          vsplit->fetch_elts, vsplit->cache.num_fetch_elts,
          vsplit->draw_elts, vsplit->cache.num_draw_elts, flags);
@@ -87,23 +106,45 @@ vsplit_flush_cache(struct vsplit_frontend *vsplit, unsigned flags)
 static INLINE void
 vsplit_add_cache(struct vsplit_frontend *vsplit, unsigned fetch, unsigned ofbias)
 {
-   unsigned hash;
+   const unsigned mask = vsplit->cache.mask;
+   const unsigned stamp = vsplit->cache.stamp;
+   unsigned hash, slot, i;
+
+   hash = fetch & mask;
+   slot = hash;
+
+   /* Overflows due to the element bias are never looked up */
+   if (!ofbias) {
+      for (i = 0; i < MAP_WAYS; i++) {
+         slot = (hash + i) & mask;
+
+         if (vsplit->cache.stamps[slot] != stamp) {
+            /* free slot, the value isn't in the cache */
+            break;
+         }
+
+         if (vsplit->cache.fetches[slot] == fetch) {
+            vsplit->draw_elts[vsplit->cache.num_draw_elts++] =
+               vsplit->cache.draws[slot];
+            return;
+         }
+      }
 
-   hash = fetch % MAP_SIZE;
+      /* all ways taken, evict the first one */
+      if (i == MAP_WAYS)
+         slot = hash;
+   }
 
-   /* If the value isn't in the cache of it's an overflow due to the
-    * element bias */
-   if (vsplit->cache.fetches[hash] != fetch || ofbias) {
-      /* update cache */
-      vsplit->cache.fetches[hash] = fetch;
-      vsplit->cache.draws[hash] = vsplit->cache.num_fetch_elts;
+   /* update cache */
+   vsplit->cache.stamps[slot] = stamp;
+   vsplit->cache.fetches[slot] = fetch;
+   vsplit->cache.draws[slot] = vsplit->cache.num_fetch_elts;
 
-      /* add fetch */
-      assert(vsplit->cache.num_fetch_elts < vsplit->segment_size);
-      vsplit->fetch_elts[vsplit->cache.num_fetch_elts++] = fetch;
-   }
+   /* add fetch */
+   assert(vsplit->cache.num_fetch_elts < vsplit->segment_size);
+   vsplit->fetch_elts[vsplit->cache.num_fetch_elts++] = fetch;
 
-   vsplit->draw_elts[vsplit->cache.num_draw_elts++] = vsplit->cache.draws[hash];
+   vsplit->draw_elts[vsplit->cache.num_draw_elts++] = vsplit->cache.draws[slot];
 }
 
 /**
@@ -198,16 +239,7 @@ vsplit_add_cache_uint(struct vsplit_frontend *vsplit, const uint *elts,
                       unsigned start, unsigned fetch, int elt_bias)
 {
    struct draw_context *draw = vsplit->draw;
-   unsigned raw_elem_idx = start + fetch + elt_bias;
    VSPLIT_CREATE_IDX(elts, start, fetch, elt_bias);
-
-   /* special care for DRAW_MAX_FETCH_IDX */
-   if (raw_elem_idx == DRAW_MAX_FETCH_IDX && !vsplit->cache.has_max_fetch) {
-      unsigned hash = fetch % MAP_SIZE;
-      vsplit->cache.fetches[hash] = raw_elem_idx - 1; /* force update */
-      vsplit->cache.has_max_fetch = TRUE;
-   }
-
    vsplit_add_cache(vsplit, elt_idx, ofbias);
 }
 
@@ -286,11 +318,17 @@ static void vsplit_destroy(struct draw_pt_front_end *frontend)
 struct draw_pt_front_end *draw_pt_vsplit(struct draw_context *draw)
 {
    struct vsplit_frontend *vsplit = CALLOC_STRUCT(vsplit_frontend);
+   unsigned map_size;
    ushort i;
 
    if (!vsplit)
       return NULL;
 
+   map_size = debug_get_num_option("DRAW_VSPLIT_CACHE_SIZE", MAP_DEFAULT_SIZE);
+   map_size = util_next_power_of_two(CLAMP(map_size, MAP_WAYS, MAP_MAX_SIZE));
+   vsplit->cache.mask = map_size - 1;
+   vsplit->cache.stamp = 1;
+
    vsplit->base.prepare = vsplit_prepare;
    vsplit->base.run     = NULL;
    vsplit->base.flush   = vsplit_flush;
@@ -47,6 +47,7 @@
 struct exec_vertex_shader {
    struct draw_vertex_shader base;
    struct tgsi_exec_machine *machine;
+   struct tgsi_decoded_shader *decoded;
 };
 
 static struct exec_vertex_shader *exec_vertex_shader( struct draw_vertex_shader *vs )
@@ -67,9 +68,9 @@ vs_exec_prepare( struct draw_vertex_shader *shader,
     * Avoid rebinding when possible.
     */
    if (evs->machine->Tokens != shader->state.tokens) {
-      tgsi_exec_machine_bind_shader(evs->machine,
-                                    shader->state.tokens,
-                                    draw->vs.tgsi.sampler);
+      tgsi_exec_machine_bind_decoded_shader(evs->machine,
+                                            evs->decoded,
+                                            draw->vs.tgsi.sampler);
    }
 }
 
@@ -200,6 +201,13 @@ vs_exec_run_linear( struct draw_vertex_shader *shader,
 static void
 vs_exec_delete( struct draw_vertex_shader *dvs )
 {
+   struct exec_vertex_shader *evs = exec_vertex_shader(dvs);
+
+   /* the machine only borrows the decoded shader */
+   if (evs->machine->Tokens == dvs->state.tokens)
+      tgsi_exec_machine_bind_shader(evs->machine, NULL, NULL);
+
+   tgsi_free_decoded_shader(evs->decoded);
    FREE((void*) dvs->state.tokens);
    FREE( dvs );
 }
@@ -221,7 +229,15 @@ draw_create_vs_exec(struct draw_context *draw,
       return NULL;
    }
 
-   tgsi_scan_shader(state->tokens, &vs->base.info);
+   /* decode once, for the scan and for every bind to the machine */
+   vs->decoded = tgsi_decode_shader(vs->base.state.tokens);
+   if (!vs->decoded) {
+      FREE((void*) vs->base.state.tokens);
+      FREE(vs);
+      return NULL;
+   }
+
+   tgsi_scan_decoded_shader(vs->decoded, &vs->base.info);
 
    vs->base.state.stream_output = state->stream_output;
    vs->base.draw = draw;
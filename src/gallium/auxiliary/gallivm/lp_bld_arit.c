@@ -80,6 +80,11 @@
 
 #define LOG_POLY_DEGREE 4
 
+/* Polynomial degrees used with gallivm_state::fast_math */
+#define EXP_POLY_DEGREE_FAST 3
+
+#define LOG_POLY_DEGREE_FAST 3
+
 
 /**
  * Generate min(a, b)
@@ -2444,11 +2449,15 @@ lp_build_rcp(struct lp_build_context *bld,
     * We could still use it on certain processors if benchmarks show that the
     * RCPPS plus necessary workarounds are still preferrable to DIVPS; or for
     * particular uses that require less workarounds.
+    *
+    * In fast math mode we do use it, with one Newton-Raphson step, which
+    * gives about 22 bits of precision for finite non-zero values.
     */
 
-   if (FALSE && ((util_cpu_caps.has_sse && type.width == 32 && type.length == 4) ||
-         (util_cpu_caps.has_avx && type.width == 32 && type.length == 8))){
-      const unsigned num_iterations = 0;
+   if (bld->gallivm->fast_math &&
+       ((util_cpu_caps.has_sse && type.width == 32 && type.length == 4) ||
+        (util_cpu_caps.has_avx && type.width == 32 && type.length == 8))){
+      const unsigned num_iterations = 1;
       LLVMValueRef res;
       unsigned i;
       const char *intrinsic = NULL;
@@ -2515,6 +2524,14 @@ lp_build_rsqrt(struct lp_build_context *bld,
 
    assert(type.floating);
 
+   /*
+    * In fast math mode, RSQRTPS plus one Newton-Raphson step.  Zero,
+    * infinity and denormals give undefined results.
+    */
+   if (bld->gallivm->fast_math && lp_build_fast_rsqrt_available(type)) {
+      return lp_build_rsqrt_refine(bld, a, lp_build_fast_rsqrt(bld, a));
+   }
+
    /*
     * This should be faster but all denormals will end up as infinity.
     */
@@ -3027,6 +3044,21 @@ const double lp_build_exp2_polynomial[] = {
 };
 
 
+/**
+ * Lower degree fit of 2**x for fast math mode, about 13 bits of precision.
+ */
+static const double lp_build_exp2_polynomial_fast[] = {
+#if EXP_POLY_DEGREE_FAST == 3
+   0.999925218562710312959,
+   0.695833540494823811697,
+   0.226067155427249155588,
+   0.0780245226406372992967
+#else
+#error
+#endif
+};
+
+
 LLVMValueRef
 lp_build_exp2(struct lp_build_context *bld,
               LLVMValueRef x)
@@ -3072,8 +3104,14 @@ lp_build_exp2(struct lp_build_context *bld,
    expipart = LLVMBuildBitCast(builder, expipart, vec_type, "");
 
 
-   expfpart = lp_build_polynomial(bld, fpart, lp_build_exp2_polynomial,
-                                  Elements(lp_build_exp2_polynomial));
+   if (bld->gallivm->fast_math) {
+      expfpart = lp_build_polynomial(bld, fpart, lp_build_exp2_polynomial_fast,
+                                     Elements(lp_build_exp2_polynomial_fast));
+   }
+   else {
+      expfpart = lp_build_polynomial(bld, fpart, lp_build_exp2_polynomial,
+                                     Elements(lp_build_exp2_polynomial));
+   }
 
    res = LLVMBuildFMul(builder, expipart, expfpart, "");
 
@@ -3183,6 +3221,20 @@ const double lp_build_log2_polynomial[] = {
 #endif
 };
 
+/**
+ * Lower degree fit of the above for fast math mode.
+ */
+static const double lp_build_log2_polynomial_fast[] = {
+#if LOG_POLY_DEGREE_FAST == 3
+   2.88538959748872753838L,
+   0.961932915889597772928L,
+   0.571118517972136195241L,
+   0.493997535084709500285L,
+#else
+#error
+#endif
+};
+
 /**
  * See http://www.devmaster.net/forums/showthread.php?p=43580
  * http://en.wikipedia.org/wiki/Logarithm#Calculation
@@ -3271,8 +3323,14 @@ lp_build_log2_approx(struct lp_build_context *bld,
       z = lp_build_mul(bld, y, y);
 
       /* compute P(z) */
-      logmant = lp_build_polynomial(bld, z, lp_build_log2_polynomial,
-                                    Elements(lp_build_log2_polynomial));
+      if (bld->gallivm->fast_math) {
+         logmant = lp_build_polynomial(bld, z, lp_build_log2_polynomial_fast,
+                                       Elements(lp_build_log2_polynomial_fast));
+      }
+      else {
+         logmant = lp_build_polynomial(bld, z, lp_build_log2_polynomial,
+                                       Elements(lp_build_log2_polynomial));
+      }
 
       /* logmant = y * P(z) */
       logmant = lp_build_mul(bld, y, logmant);
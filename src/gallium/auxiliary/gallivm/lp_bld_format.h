@@ -169,5 +169,10 @@ lp_build_srgb_to_linear(struct gallivm_state *gallivm,
                         struct lp_type src_type,
                         LLVMValueRef src);
 
+LLVMValueRef
+lp_build_linear_to_srgb(struct gallivm_state *gallivm,
+                        struct lp_type src_type,
+                        LLVMValueRef src);
+
 
 #endif /* !LP_BLD_FORMAT_H */
@@ -47,6 +47,7 @@
 #include "lp_bld_conv.h"
 #include "lp_bld_swizzle.h"
 #include "lp_bld_gather.h"
+#include "lp_bld_pack.h"
 #include "lp_bld_debug.h"
 #include "lp_bld_format.h"
 #include "lp_bld_intr.h"
@@ -139,56 +140,113 @@ format_matches_type(const struct util_format_description *desc,
 
 
 /**
- * Unpack a single pixel into its XYZW components.
+ * Whether channel chan of an sRGB format is subject to sRGB decoding.
+ * Only the color channels are, alpha is always linear.
+ */
+static INLINE boolean
+is_srgb_channel(const struct util_format_description *desc,
+                unsigned chan)
+{
+   return desc->colorspace == UTIL_FORMAT_COLORSPACE_SRGB &&
+          desc->channel[chan].type != UTIL_FORMAT_TYPE_VOID &&
+          desc->swizzle[3] != chan;
+}
+
+
+/**
+ * Whether the sRGB channels of the format can be converted with
+ * lp_build_srgb_to_linear() / lp_build_linear_to_srgb(), which only deal
+ * with 8 bit values.
+ */
+static INLINE boolean
+srgb_channels_supported(const struct util_format_description *desc)
+{
+   unsigned chan;
+
+   for (chan = 0; chan < 4; ++chan) {
+      if (is_srgb_channel(desc, chan) && desc->channel[chan].size != 8) {
+         return FALSE;
+      }
+   }
+
+   return TRUE;
+}
+
+
+/**
+ * Unpack several pixels into their XYZW components.
+ *
+ * All the pixels are unpacked at once, by replicating each packed pixel
+ * four times and shifting and masking every channel in its own lane.
+ * The color channels of sRGB formats are converted to linear.
  *
  * @param desc  the pixel format for the packed pixel value
- * @param packed integer pixel in a format such as PIPE_FORMAT_B8G8R8A8_UNORM
+ * @param num_pixels  number of pixels
+ * @param packed  integer pixels in a format such as
+ *                PIPE_FORMAT_B8G8R8A8_UNORM, an i32 if num_pixels is one or
+ *                a num_pixels x i32 vector otherwise
  *
- * @return XYZW in a float[4] or ubyte[4] or ushort[4] vector.
+ * @return XYZW of all pixels in a float[4*num_pixels] vector.
  */
 static INLINE LLVMValueRef
 lp_build_unpack_arith_rgba_aos(struct gallivm_state *gallivm,
                                const struct util_format_description *desc,
+                               unsigned num_pixels,
                                LLVMValueRef packed)
 {
    LLVMBuilderRef builder = gallivm->builder;
+   LLVMTypeRef i32t = LLVMInt32TypeInContext(gallivm->context);
+   const unsigned length = num_pixels * 4;
+   LLVMTypeRef float_vec_type =
+      LLVMVectorType(LLVMFloatTypeInContext(gallivm->context), length);
    LLVMValueRef shifted, casted, scaled, masked;
-   LLVMValueRef shifts[4];
-   LLVMValueRef masks[4];
-   LLVMValueRef scales[4];
+   LLVMValueRef shifts[LP_MAX_VECTOR_LENGTH];
+   LLVMValueRef masks[LP_MAX_VECTOR_LENGTH];
+   LLVMValueRef scales[LP_MAX_VECTOR_LENGTH];
+   LLVMValueRef elems[LP_MAX_VECTOR_LENGTH];
 
    boolean normalized;
    boolean needs_uitofp;
-   unsigned i;
+   boolean srgb;
+   unsigned i, k;
 
    /* TODO: Support more formats */
    assert(desc->layout == UTIL_FORMAT_LAYOUT_PLAIN);
    assert(desc->block.width == 1);
    assert(desc->block.height == 1);
    assert(desc->block.bits <= 32);
+   assert(length <= LP_MAX_VECTOR_LENGTH);
 
    /* Do the intermediate integer computations with 32bit integers since it
     * matches floating point size */
-   assert (LLVMTypeOf(packed) == LLVMInt32TypeInContext(gallivm->context));
+   assert(LLVMTypeOf(packed) == (num_pixels == 1 ? i32t :
+                                 LLVMVectorType(i32t, num_pixels)));
+
+   if (num_pixels == 1) {
+      packed = LLVMBuildInsertElement(builder,
+                                      LLVMGetUndef(LLVMVectorType(i32t, 1)),
+                                      packed,
+                                      LLVMConstNull(i32t),
+                                      "");
+   }
 
-   /* Broadcast the packed value to all four channels
-    * before: packed = BGRA
-    * after: packed = {BGRA, BGRA, BGRA, BGRA}
+   /* Broadcast each packed value to four channels
+    * before: packed = {BGRA, BGRA', ...}
+    * after: packed = {BGRA, BGRA, BGRA, BGRA, BGRA', BGRA', ...}
     */
-   packed = LLVMBuildInsertElement(builder,
-                                   LLVMGetUndef(LLVMVectorType(LLVMInt32TypeInContext(gallivm->context), 4)),
-                                   packed,
-                                   LLVMConstNull(LLVMInt32TypeInContext(gallivm->context)),
-                                   "");
+   for (k = 0; k < length; ++k) {
+      elems[k] = lp_build_const_int32(gallivm, k / 4);
+   }
    packed = LLVMBuildShuffleVector(builder,
                                    packed,
-                                   LLVMGetUndef(LLVMVectorType(LLVMInt32TypeInContext(gallivm->context), 4)),
-                                   LLVMConstNull(LLVMVectorType(LLVMInt32TypeInContext(gallivm->context), 4)),
+                                   LLVMGetUndef(LLVMTypeOf(packed)),
+                                   LLVMConstVector(elems, length),
                                    "");
 
    /* Initialize vector constants */
    normalized = FALSE;
    needs_uitofp = FALSE;
+   srgb = FALSE;
 
    /* Loop over 4 color components */
    for (i = 0; i < 4; ++i) {
@@ -196,8 +254,8 @@ lp_build_unpack_arith_rgba_aos(struct gallivm_state *gallivm,
       unsigned shift = desc->channel[i].shift;
 
       if (desc->channel[i].type == UTIL_FORMAT_TYPE_VOID) {
-         shifts[i] = LLVMGetUndef(LLVMInt32TypeInContext(gallivm->context));
-         masks[i] = LLVMConstNull(LLVMInt32TypeInContext(gallivm->context));
+         shifts[i] = LLVMGetUndef(i32t);
+         masks[i] = LLVMConstNull(i32t);
          scales[i] =  LLVMConstNull(LLVMFloatTypeInContext(gallivm->context));
       }
       else {
@@ -218,20 +276,31 @@ lp_build_unpack_arith_rgba_aos(struct gallivm_state *gallivm,
          }
          else
             scales[i] =  lp_build_const_float(gallivm, 1.0);
+
+         if (is_srgb_channel(desc, i)) {
+            srgb = TRUE;
+         }
       }
    }
 
+   /* Replicate the constants for all pixels */
+   for (k = 4; k < length; ++k) {
+      shifts[k] = shifts[k % 4];
+      masks[k] = masks[k % 4];
+      scales[k] = scales[k % 4];
+   }
+
    /* Ex: convert packed = {XYZW, XYZW, XYZW, XYZW}
     * into masked = {X, Y, Z, W}
     */
-   shifted = LLVMBuildLShr(builder, packed, LLVMConstVector(shifts, 4), "");
-   masked = LLVMBuildAnd(builder, shifted, LLVMConstVector(masks, 4), "");
+   shifted = LLVMBuildLShr(builder, packed, LLVMConstVector(shifts, length), "");
+   masked = LLVMBuildAnd(builder, shifted, LLVMConstVector(masks, length), "");
 
    if (!needs_uitofp) {
       /* UIToFP can't be expressed in SSE2 */
-      casted = LLVMBuildSIToFP(builder, masked, LLVMVectorType(LLVMFloatTypeInContext(gallivm->context), 4), "");
+      casted = LLVMBuildSIToFP(builder, masked, float_vec_type, "");
    } else {
-      casted = LLVMBuildUIToFP(builder, masked, LLVMVectorType(LLVMFloatTypeInContext(gallivm->context), 4), "");
+      casted = LLVMBuildUIToFP(builder, masked, float_vec_type, "");
    }
 
    /* At this point 'casted' may be a vector of floats such as
@@ -240,21 +309,41 @@ lp_build_unpack_arith_rgba_aos(struct gallivm_state *gallivm,
     */
 
    if (normalized)
-      scaled = LLVMBuildFMul(builder, casted, LLVMConstVector(scales, 4), "");
+      scaled = LLVMBuildFMul(builder, casted, LLVMConstVector(scales, length), "");
    else
       scaled = casted;
 
+   if (srgb) {
+      /*
+       * Decode all lanes and pick the decoded color channels, the alpha
+       * lanes keep the plain unorm value.
+       */
+      LLVMValueRef linear;
+
+      linear = lp_build_srgb_to_linear(gallivm, lp_type_int_vec(32, 32 * length),
+                                       masked);
+
+      for (k = 0; k < length; ++k) {
+         unsigned src = is_srgb_channel(desc, k % 4) ? k : k + length;
+         elems[k] = lp_build_const_int32(gallivm, src);
+      }
+      scaled = LLVMBuildShuffleVector(builder, linear, scaled,
+                                      LLVMConstVector(elems, length), "");
+   }
+
    return scaled;
 }
 
 
 /**
- * Pack a single pixel.
+ * Pack one or several pixels.
+ *
+ * The color channels of sRGB formats are converted from linear.
  *
- * @param rgba 4 float vector with the unpacked components.
+ * @param rgba float[4*n] vector with the unpacked components of n pixels.
  *
- * XXX: This is mostly for reference and testing -- operating a single pixel at
- * a time is rarely if ever needed.
+ * @return the packed pixel as an integer of the format's block size if n is
+ * one, or a vector of n such integers otherwise.
  */
 LLVMValueRef
 lp_build_pack_rgba_aos(struct gallivm_state *gallivm,
@@ -262,18 +351,25 @@ lp_build_pack_rgba_aos(struct gallivm_state *gallivm,
                        LLVMValueRef rgba)
 {
    LLVMBuilderRef builder = gallivm->builder;
+   LLVMTypeRef i32t = LLVMInt32TypeInContext(gallivm->context);
+   const unsigned length = LLVMGetVectorSize(LLVMTypeOf(rgba));
+   const unsigned num_pixels = length / 4;
    LLVMTypeRef type;
    LLVMValueRef packed = NULL;
-   LLVMValueRef swizzles[4];
+   LLVMValueRef swizzles[LP_MAX_VECTOR_LENGTH];
+   LLVMValueRef elems[LP_MAX_VECTOR_LENGTH];
    LLVMValueRef shifted, casted, scaled, unswizzled;
-   LLVMValueRef shifts[4];
-   LLVMValueRef scales[4];
+   LLVMValueRef shifts[LP_MAX_VECTOR_LENGTH];
+   LLVMValueRef scales[LP_MAX_VECTOR_LENGTH];
    boolean normalized;
-   unsigned i, j;
+   boolean srgb;
+   unsigned i, j, k;
 
    assert(desc->layout == UTIL_FORMAT_LAYOUT_PLAIN);
    assert(desc->block.width == 1);
    assert(desc->block.height == 1);
+   assert(length % 4 == 0 && length <= LP_MAX_VECTOR_LENGTH);
+   assert(srgb_channels_supported(desc));
 
    type = LLVMIntTypeInContext(gallivm->context, desc->block.bits);
 
@@ -283,23 +379,26 @@ lp_build_pack_rgba_aos(struct gallivm_state *gallivm,
          if (desc->swizzle[j] == i)
             break;
       }
-      if (j < 4)
-         swizzles[i] = lp_build_const_int32(gallivm, j);
-      else
-         swizzles[i] = LLVMGetUndef(LLVMInt32TypeInContext(gallivm->context));
+      for (k = 0; k < num_pixels; ++k) {
+         if (j < 4)
+            swizzles[k * 4 + i] = lp_build_const_int32(gallivm, k * 4 + j);
+         else
+            swizzles[k * 4 + i] = LLVMGetUndef(i32t);
+      }
    }
 
    unswizzled = LLVMBuildShuffleVector(builder, rgba,
-                                       LLVMGetUndef(LLVMVectorType(LLVMFloatTypeInContext(gallivm->context), 4)),
-                                       LLVMConstVector(swizzles, 4), "");
+                                       LLVMGetUndef(LLVMTypeOf(rgba)),
+                                       LLVMConstVector(swizzles, length), "");
 
    normalized = FALSE;
+   srgb = FALSE;
    for (i = 0; i < 4; ++i) {
       unsigned bits = desc->channel[i].size;
       unsigned shift = desc->channel[i].shift;
 
       if (desc->channel[i].type == UTIL_FORMAT_TYPE_VOID) {
-         shifts[i] = LLVMGetUndef(LLVMInt32TypeInContext(gallivm->context));
+         shifts[i] = LLVMGetUndef(i32t);
          scales[i] =  LLVMGetUndef(LLVMFloatTypeInContext(gallivm->context));
       }
       else {
@@ -316,23 +415,59 @@ lp_build_pack_rgba_aos(struct gallivm_state *gallivm,
          }
          else
             scales[i] = lp_build_const_float(gallivm, 1.0);
+
+         if (is_srgb_channel(desc, i)) {
+            srgb = TRUE;
+         }
       }
    }
 
+   for (k = 4; k < length; ++k) {
+      shifts[k] = shifts[k % 4];
+      scales[k] = scales[k % 4];
+   }
+
    if (normalized)
-      scaled = LLVMBuildFMul(builder, unswizzled, LLVMConstVector(scales, 4), "");
+      scaled = LLVMBuildFMul(builder, unswizzled, LLVMConstVector(scales, length), "");
    else
       scaled = unswizzled;
 
-   casted = LLVMBuildFPToSI(builder, scaled, LLVMVectorType(LLVMInt32TypeInContext(gallivm->context), 4), "");
+   casted = LLVMBuildFPToSI(builder, scaled, LLVMVectorType(i32t, length), "");
 
-   shifted = LLVMBuildShl(builder, casted, LLVMConstVector(shifts, 4), "");
-   
-   /* Bitwise or all components */
+   if (srgb) {
+      LLVMValueRef encoded;
+
+      encoded = lp_build_linear_to_srgb(gallivm, lp_type_float_vec(32, 32 * length),
+                                        unswizzled);
+
+      for (k = 0; k < length; ++k) {
+         unsigned src = is_srgb_channel(desc, k % 4) ? k : k + length;
+         elems[k] = lp_build_const_int32(gallivm, src);
+      }
+      casted = LLVMBuildShuffleVector(builder, encoded, casted,
+                                      LLVMConstVector(elems, length), "");
+   }
+
+   shifted = LLVMBuildShl(builder, casted, LLVMConstVector(shifts, length), "");
+
+   /* Bitwise or the same component of all pixels at once */
    for (i = 0; i < 4; ++i) {
       if (desc->channel[i].type == UTIL_FORMAT_TYPE_UNSIGNED) {
-         LLVMValueRef component = LLVMBuildExtractElement(builder, shifted,
-                                               lp_build_const_int32(gallivm, i), "");
+         LLVMValueRef component;
+
+         if (num_pixels == 1) {
+            component = LLVMBuildExtractElement(builder, shifted,
+                                                lp_build_const_int32(gallivm, i), "");
+         }
+         else {
+            for (k = 0; k < num_pixels; ++k) {
+               elems[k] = lp_build_const_int32(gallivm, k * 4 + i);
+            }
+            component = LLVMBuildShuffleVector(builder, shifted,
+                                               LLVMGetUndef(LLVMTypeOf(shifted)),
+                                               LLVMConstVector(elems, num_pixels), "");
+         }
+
          if (packed)
             packed = LLVMBuildOr(builder, packed, component, "");
          else
@@ -340,11 +475,21 @@ lp_build_pack_rgba_aos(struct gallivm_state *gallivm,
       }
    }
 
-   if (!packed)
-      packed = LLVMGetUndef(LLVMInt32TypeInContext(gallivm->context));
+   if (num_pixels > 1) {
+      if (!packed)
+         packed = LLVMGetUndef(LLVMVectorType(i32t, num_pixels));
 
-   if (desc->block.bits < 32)
-      packed = LLVMBuildTrunc(builder, packed, type, "");
+      if (desc->block.bits < 32)
+         packed = LLVMBuildTrunc(builder, packed,
+                                 LLVMVectorType(type, num_pixels), "");
+   }
+   else {
+      if (!packed)
+         packed = LLVMGetUndef(i32t);
+
+      if (desc->block.bits < 32)
+         packed = LLVMBuildTrunc(builder, packed, type, "");
+   }
 
    return packed;
 }
@@ -410,10 +555,14 @@ lp_build_fetch_rgba_aos(struct gallivm_state *gallivm,
 
    /*
     * Bit arithmetic
+    *
+    * sRGB decoding is approximate, so it is only done here when the result
+    * is quantized to 8 bits anyway.
     */
 
    if (format_desc->layout == UTIL_FORMAT_LAYOUT_PLAIN &&
        (format_desc->colorspace == UTIL_FORMAT_COLORSPACE_RGB ||
+        format_desc->colorspace == UTIL_FORMAT_COLORSPACE_SRGB ||
         format_desc->colorspace == UTIL_FORMAT_COLORSPACE_ZS) &&
        format_desc->block.width == 1 &&
        format_desc->block.height == 1 &&
@@ -423,26 +572,41 @@ lp_build_fetch_rgba_aos(struct gallivm_state *gallivm,
        !format_desc->is_mixed &&
        (format_desc->channel[0].type == UTIL_FORMAT_TYPE_UNSIGNED ||
         format_desc->channel[1].type == UTIL_FORMAT_TYPE_UNSIGNED) &&
-       !format_desc->channel[0].pure_integer) {
+       !format_desc->channel[0].pure_integer &&
+       (format_desc->colorspace != UTIL_FORMAT_COLORSPACE_SRGB ||
+        (!type.floating && srgb_channels_supported(format_desc)))) {
 
       LLVMValueRef tmps[LP_MAX_VECTOR_LENGTH/4];
-      LLVMValueRef res;
-      unsigned k;
+      LLVMValueRef packed, unpacked, res;
+      unsigned chunk_length, num_chunks, k;
 
       /*
-       * Unpack a pixel at a time into a <4 x float> RGBA vector
+       * Unpack all pixels at once into a <4*n x float> RGBA vector
        */
 
-      for (k = 0; k < num_pixels; ++k) {
-         LLVMValueRef packed;
+      packed = lp_build_gather(gallivm, num_pixels,
+                               format_desc->block.bits, 32,
+                               base_ptr, offset, FALSE);
 
-         packed = lp_build_gather_elem(gallivm, num_pixels,
-                                       format_desc->block.bits, 32,
-                                       base_ptr, offset, k, FALSE);
+      unpacked = lp_build_unpack_arith_rgba_aos(gallivm,
+                                                format_desc,
+                                                num_pixels,
+                                                packed);
 
-         tmps[k] = lp_build_unpack_arith_rgba_aos(gallivm,
-                                                  format_desc,
-                                                  packed);
+      /*
+       * Split into native sized vectors for the conversion.
+       */
+
+      chunk_length = MIN2(num_pixels * 4, lp_native_vector_width / 32);
+      num_chunks = num_pixels * 4 / chunk_length;
+      if (num_chunks == 1) {
+         tmps[0] = unpacked;
+      }
+      else {
+         for (k = 0; k < num_chunks; ++k) {
+            tmps[k] = lp_build_extract_range(gallivm, unpacked,
+                                             k * chunk_length, chunk_length);
+         }
       }
 
       /*
@@ -458,9 +622,9 @@ lp_build_fetch_rgba_aos(struct gallivm_state *gallivm,
       }
 
       lp_build_conv(gallivm,
-                    lp_float32_vec4_type(),
+                    lp_type_float_vec(32, 32 * chunk_length),
                     type,
-                    tmps, num_pixels, &res, 1);
+                    tmps, num_chunks, &res, 1);
 
       return lp_build_format_swizzle_aos(format_desc, &bld, res);
    }
@@ -110,6 +110,42 @@ lp_build_gather_elem(struct gallivm_state *gallivm,
 }
 
 
+/**
+ * Gather elements with the AVX2 gather instructions, which fetch a whole
+ * vector of 32 or 64 bit elements addressed by 32 bit offsets at once.
+ */
+static LLVMValueRef
+lp_build_gather_avx2(struct gallivm_state *gallivm,
+                     unsigned length,
+                     unsigned src_width,
+                     LLVMValueRef base_ptr,
+                     LLVMValueRef offsets)
+{
+   LLVMTypeRef elem_type = LLVMIntTypeInContext(gallivm->context, src_width);
+   LLVMTypeRef vec_type = LLVMVectorType(elem_type, length);
+   LLVMTypeRef i8t = LLVMInt8TypeInContext(gallivm->context);
+   const char *intrinsic;
+   LLVMValueRef args[5];
+
+   if (src_width == 32) {
+      intrinsic = length == 8 ? "llvm.x86.avx2.gather.d.d.256"
+                              : "llvm.x86.avx2.gather.d.d";
+   }
+   else {
+      assert(src_width == 64 && length == 4);
+      intrinsic = "llvm.x86.avx2.gather.d.q.256";
+   }
+
+   args[0] = LLVMGetUndef(vec_type);      /* pass-through for masked lanes */
+   args[1] = base_ptr;
+   args[2] = offsets;
+   args[3] = LLVMConstAllOnes(vec_type);  /* mask, fetch all lanes */
+   args[4] = LLVMConstInt(i8t, 1, 0);     /* offsets are in bytes */
+
+   return lp_build_intrinsic(gallivm->builder, intrinsic, vec_type, args, 5);
+}
+
+
 /**
  * Gather elements from scatter positions in memory into a single vector.
  * Use for fetching texels from a texture.
@@ -129,6 +165,9 @@ lp_build_gather_elem(struct gallivm_state *gallivm,
  * @param base_ptr base pointer, should be a i8 pointer type.
  * @param offsets vector with offsets
  * @param vector_justify select vector rather than integer justification
+ *
+ * With AVX2, whole vectors of 32 and 64 bit elements are fetched with a
+ * single gather instruction, otherwise one element is loaded at a time.
  */
 LLVMValueRef
 lp_build_gather(struct gallivm_state *gallivm,
@@ -146,6 +185,15 @@ lp_build_gather(struct gallivm_state *gallivm,
       return lp_build_gather_elem(gallivm, length,
                                   src_width, dst_width,
                                   base_ptr, offsets, 0, vector_justify);
+   } else if (lp_native_gather &&
+              src_width == dst_width &&
+              ((src_width == 32 && (length == 4 || length == 8)) ||
+               (src_width == 64 && length == 4))) {
+      /* Native gather */
+      assert(LLVMTypeOf(offsets) ==
+             LLVMVectorType(LLVMInt32TypeInContext(gallivm->context), length));
+      res = lp_build_gather_avx2(gallivm, length, src_width,
+                                 base_ptr, offsets);
    } else {
       /* Vector */
 
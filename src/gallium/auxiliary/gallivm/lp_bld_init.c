@@ -30,6 +30,7 @@
 #include "pipe/p_compiler.h"
 #include "util/u_cpu_detect.h"
 #include "util/u_debug.h"
+#include "util/u_disk_cache.h"
 #include "util/u_memory.h"
 #include "util/u_simple_list.h"
 #include "lp_bld.h"
@@ -64,10 +65,22 @@
 #endif
 
 
-#if USE_MCJIT
+#if USE_MCJIT || HAVE_LLVM >= 0x0303
 void LLVMLinkInMCJIT();
 #endif
 
+/*
+ * The on-disk object cache relies on MC-JIT, so use it whenever the cache
+ * is enabled, even where the old JIT is the default.
+ */
+#if HAVE_LLVM >= 0x0303
+#  define CAN_USE_MCJIT 1
+#else
+#  define CAN_USE_MCJIT USE_MCJIT
+#endif
+
+static boolean gallivm_use_mcjit = USE_MCJIT;
+
 
 #ifdef DEBUG
 unsigned gallivm_debug = 0;
@@ -91,8 +104,23 @@ DEBUG_GET_ONCE_FLAGS_OPTION(gallivm_debug, "GALLIVM_DEBUG", lp_bld_debug_flags,
 
 static boolean gallivm_initialized = FALSE;
 
+/**
+ * Default for gallivm_state::fast_math.
+ *
+ * In fast math mode divisions, reciprocals and reciprocal square roots use
+ * the approximate SSE/AVX instructions refined by one Newton-Raphson step
+ * (about 22 bits of precision), exp2 and log2, and hence pow, use lower
+ * degree polynomials (about 13 bits), and LLVM may reassociate, contract
+ * and otherwise assume that no NaNs or infinities occur.  Results for
+ * zero, infinite, NaN or denormal inputs of these operations are
+ * undefined.
+ */
+static boolean gallivm_fast_math = FALSE;
+
 unsigned lp_native_vector_width;
 
+boolean lp_native_gather = FALSE;
+
 
 /*
  * Optimization values are:
@@ -219,13 +247,19 @@ free_gallivm_state(struct gallivm_state *gallivm)
       LLVMDisposeModule(gallivm->module);
    }
 
-#if !USE_MCJIT
-   /* Don't free the TargetData, it's owned by the exec engine */
-#else
-   if (gallivm->target) {
+#if HAVE_LLVM >= 0x0301
+   /* Only now that the engine is gone can its machine code be freed */
+   lp_free_generated_code(gallivm->code);
+#endif
+
+   /* Without MC-JIT the TargetData is owned by the exec engine */
+   if (gallivm_use_mcjit && gallivm->target) {
       LLVMDisposeTargetData(gallivm->target);
    }
-#endif
+
+   if (gallivm->object_cache) {
+      lp_object_cache_destroy(gallivm->object_cache);
+   }
 
    /* Never free the LLVM context.
     */
@@ -238,6 +272,8 @@ free_gallivm_state(struct gallivm_state *gallivm)
       LLVMDisposeBuilder(gallivm->builder);
 
    gallivm->engine = NULL;
+   gallivm->object_cache = NULL;
+   gallivm->code = NULL;
    gallivm->target = NULL;
    gallivm->module = NULL;
    gallivm->provider = NULL;
@@ -267,7 +303,10 @@ init_gallivm_engine(struct gallivm_state *gallivm)
       ret = lp_build_create_jit_compiler_for_module(&gallivm->engine,
                                                     gallivm->module,
                                                     (unsigned) optlevel,
-                                                    USE_MCJIT,
+                                                    gallivm_use_mcjit,
+                                                    gallivm->fast_math,
+                                                    gallivm->object_cache,
+                                                    &gallivm->code,
                                                     &error);
 #else
       ret = LLVMCreateJITCompiler(&gallivm->engine, gallivm->provider,
@@ -282,12 +321,12 @@ init_gallivm_engine(struct gallivm_state *gallivm)
 
    LLVMAddModuleProvider(gallivm->engine, gallivm->provider);//new
 
-#if !USE_MCJIT
-   gallivm->target = LLVMGetExecutionEngineTargetData(gallivm->engine);
-   if (!gallivm->target)
-      goto fail;
-#else
-   if (0) {
+   if (!gallivm_use_mcjit) {
+      gallivm->target = LLVMGetExecutionEngineTargetData(gallivm->engine);
+      if (!gallivm->target)
+         goto fail;
+   }
+   else if (0) {
        /*
         * Dump the data layout strings.
         */
@@ -307,7 +346,6 @@ init_gallivm_engine(struct gallivm_state *gallivm)
        free(data_layout);
        free(engine_data_layout);
    }
-#endif
 
    return TRUE;
 
@@ -334,7 +372,7 @@ static LLVMContextRef gallivm_context = NULL;
  * \return  TRUE for success, FALSE for failure
  */
 static boolean
-init_gallivm_state(struct gallivm_state *gallivm)
+init_gallivm_state(struct gallivm_state *gallivm, LLVMContextRef context)
 {
    assert(!gallivm->context);
    assert(!gallivm->module);
@@ -342,10 +380,15 @@ init_gallivm_state(struct gallivm_state *gallivm)
 
    lp_build_init();
 
-   if (!gallivm_context) {
-      gallivm_context = LLVMContextCreate();
+   gallivm->fast_math = gallivm_fast_math;
+
+   if (!context) {
+      if (!gallivm_context) {
+         gallivm_context = LLVMContextCreate();
+      }
+      context = gallivm_context;
    }
-   gallivm->context = gallivm_context;
+   gallivm->context = context;
    if (!gallivm->context)
       goto fail;
 
@@ -367,28 +410,28 @@ init_gallivm_state(struct gallivm_state *gallivm)
     * complete when MC-JIT is created. So defer the MC-JIT engine creation for
     * now.
     */
-#if !USE_MCJIT
-   if (!init_gallivm_engine(gallivm)) {
-      goto fail;
+   if (!gallivm_use_mcjit) {
+      if (!init_gallivm_engine(gallivm)) {
+         goto fail;
+      }
    }
-#else
-   /*
-    * MC-JIT engine compiles the module immediately on creation, so we can't
-    * obtain the target data from it.  Instead we create a target data layout
-    * from a string.
-    *
-    * The produced layout strings are not precisely the same, but should make
-    * no difference for the kind of optimization passes we run.
-    *
-    * For reference this is the layout string on x64:
-    *
-    *   e-p:64:64:64-S128-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f16:16:16-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-f128:128:128-n8:16:32:64
-    *
-    * See also:
-    * - http://llvm.org/docs/LangRef.html#datalayout
-    */
+   else {
+      /*
+       * MC-JIT engine compiles the module immediately on creation, so we can't
+       * obtain the target data from it.  Instead we create a target data layout
+       * from a string.
+       *
+       * The produced layout strings are not precisely the same, but should make
+       * no difference for the kind of optimization passes we run.
+       *
+       * For reference this is the layout string on x64:
+       *
+       *   e-p:64:64:64-S128-i1:8:8-i8:8:8-i16:16:16-i32:32:32-i64:64:64-f16:16:16-f32:32:32-f64:64:64-v64:64:64-v128:128:128-a0:0:64-s0:64:64-f80:128:128-f128:128:128-n8:16:32:64
+       *
+       * See also:
+       * - http://llvm.org/docs/LangRef.html#datalayout
+       */
 
-   {
       const unsigned pointer_size = 8 * sizeof(void *);
       char layout[512];
       util_snprintf(layout, sizeof layout, "%c-p:%u:%u:%u-i64:64:64-a0:0:%u-s0:%u:%u",
@@ -406,7 +449,6 @@ init_gallivm_state(struct gallivm_state *gallivm)
          return FALSE;
       }
    }
-#endif
 
    if (!create_pass_manager(gallivm))
       goto fail;
@@ -435,7 +477,16 @@ lp_build_init(void)
    LLVMLinkInMCJIT();
 #else
    LLVMLinkInJIT();
+#if CAN_USE_MCJIT
+   LLVMLinkInMCJIT();
 #endif
+#endif
+
+   if (CAN_USE_MCJIT && util_disk_cache_enabled()) {
+      gallivm_use_mcjit = TRUE;
+   }
+
+   gallivm_fast_math = debug_get_bool_option("GALLIVM_FAST_MATH", FALSE);
 
    util_cpu_detect();
 
@@ -482,6 +533,17 @@ lp_build_init(void)
       util_cpu_caps.has_xop = 0;
    }
 
+   /*
+    * The gather intrinsics exist since LLVM 3.3, but only MC-JIT can
+    * encode the VSIB memory operands they need.  LP_NATIVE_GATHER=0 can
+    * be used to compare against the scalar fallback.
+    */
+#if HAVE_LLVM >= 0x0303
+   lp_native_gather = gallivm_use_mcjit &&
+                      util_cpu_caps.has_avx2 &&
+                      debug_get_bool_option("LP_NATIVE_GATHER", TRUE);
+#endif
+
 #ifdef PIPE_ARCH_PPC_64
    /* Set the NJ bit in VSCR to 0 so denormalized values are handled as
     * specified by IEEE standard (PowerISA 2.06 - Section 6.3). This guarantees
@@ -535,7 +597,7 @@ gallivm_create(void)
 
    gallivm = CALLOC_STRUCT(gallivm_state);
    if (gallivm) {
-      if (!init_gallivm_state(gallivm)) {
+      if (!init_gallivm_state(gallivm, NULL)) {
          FREE(gallivm);
          gallivm = NULL;
       }
@@ -549,6 +611,30 @@ gallivm_create(void)
 }
 
 
+/**
+ * Create a new gallivm_state object in the given LLVM context, rather than
+ * the global one, so that it can be used from another thread.  A context
+ * must never be used by more than one thread at a time.
+ */
+struct gallivm_state *
+gallivm_create_in_context(LLVMContextRef context)
+{
+   struct gallivm_state *gallivm;
+
+   assert(context);
+
+   gallivm = CALLOC_STRUCT(gallivm_state);
+   if (gallivm) {
+      if (!init_gallivm_state(gallivm, context)) {
+         FREE(gallivm);
+         gallivm = NULL;
+      }
+   }
+
+   return gallivm;
+}
+
+
 /**
  * Destroy a gallivm_state object.
  */
@@ -607,7 +693,11 @@ gallivm_verify_function(struct gallivm_state *gallivm,
    }
 #endif
 
-   gallivm_optimize_function(gallivm, func);
+   /* Machine code from the object cache was generated from optimized IR
+    * already, don't bother optimizing this copy.
+    */
+   if (!gallivm->cache_hit)
+      gallivm_optimize_function(gallivm, func);
 
    if (gallivm_debug & GALLIVM_DEBUG_IR) {
       /* Print the LLVM IR to stderr */
@@ -617,6 +707,64 @@ gallivm_verify_function(struct gallivm_state *gallivm,
 }
 
 
+/**
+ * Look up the machine code for this gallivm state in the on-disk object
+ * cache, and store it there once compiled.
+ *
+ * The key must uniquely identify the code which is going to be generated
+ * into the module for the given CPU, as it's directly used instead of
+ * compiling the IR.  LLVM version and CPU capabilities are added to the
+ * key here.  Must be called right after gallivm_create(), before any IR is
+ * generated, and the generated functions must have the same names every
+ * time.
+ *
+ * \return TRUE if the object was found in the cache.
+ */
+boolean
+gallivm_set_cache_key(struct gallivm_state *gallivm,
+                      struct util_disk_cache *cache,
+                      const void *key, unsigned key_size)
+{
+   struct {
+      unsigned llvm_version;
+      unsigned native_vector_width;
+      unsigned debug;
+      unsigned fast_math;
+      struct util_cpu_caps caps;
+   } header;
+   uint8_t *full_key;
+
+   assert(!gallivm->compiled);
+   assert(!gallivm->object_cache);
+
+   if (!gallivm_use_mcjit || !cache)
+      return FALSE;
+
+   full_key = MALLOC(sizeof header + key_size);
+   if (!full_key)
+      return FALSE;
+
+   memset(&header, 0, sizeof header);
+   header.llvm_version = HAVE_LLVM;
+   header.native_vector_width = lp_native_vector_width;
+   header.debug = gallivm_debug;
+   header.fast_math = gallivm->fast_math;
+   header.caps = util_cpu_caps;
+
+   memcpy(full_key, &header, sizeof header);
+   memcpy(full_key + sizeof header, key, key_size);
+
+   gallivm->object_cache = lp_object_cache_create(cache, full_key,
+                                                  sizeof header + key_size);
+   FREE(full_key);
+
+   gallivm->cache_hit = gallivm->object_cache &&
+                        lp_object_cache_has_object(gallivm->object_cache);
+
+   return gallivm->cache_hit;
+}
+
+
 void
 gallivm_compile_module(struct gallivm_state *gallivm)
 {
@@ -631,12 +779,12 @@ gallivm_compile_module(struct gallivm_state *gallivm)
       debug_printf("Invoke as \"llc -o - llvmpipe.bc\"\n");
    }
 
-#if USE_MCJIT
-   assert(!gallivm->engine);
-   if (!init_gallivm_engine(gallivm)) {
-      assert(0);
+   if (gallivm_use_mcjit) {
+      assert(!gallivm->engine);
+      if (!init_gallivm_engine(gallivm)) {
+         assert(0);
+      }
    }
-#endif
    assert(gallivm->engine);
 
    ++gallivm->compiled;
@@ -681,11 +829,11 @@ gallivm_free_function(struct gallivm_state *gallivm,
                       LLVMValueRef func,
                       const void *code)
 {
-#if !USE_MCJIT
-   if (code) {
-      LLVMFreeMachineCodeForFunction(gallivm->engine, func);
-   }
+   if (!gallivm_use_mcjit) {
+      if (code) {
+         LLVMFreeMachineCodeForFunction(gallivm->engine, func);
+      }
 
-   LLVMDeleteFunction(func);
-#endif
+      LLVMDeleteFunction(func);
+   }
 }
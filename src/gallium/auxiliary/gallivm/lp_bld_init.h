@@ -45,10 +45,23 @@ struct gallivm_state
    LLVMPassManagerRef passmgr;
    LLVMContextRef context;
    LLVMBuilderRef builder;
+   struct lp_object_cache *object_cache;
+   struct lp_generated_code *code;  /**< owned by the shared JIT memory */
+   boolean cache_hit;  /**< machine code will come from object_cache */
+   boolean fast_math;  /**< relaxed precision, see GALLIVM_FAST_MATH */
    unsigned compiled;
 };
 
 
+struct util_disk_cache;
+
+
+/**
+ * Whether lp_build_gather() may use the AVX2 gather instructions.
+ */
+extern boolean lp_native_gather;
+
+
 void
 lp_build_init(void);
 
@@ -56,6 +69,9 @@ lp_build_init(void);
 struct gallivm_state *
 gallivm_create(void);
 
+struct gallivm_state *
+gallivm_create_in_context(LLVMContextRef context);
+
 void
 gallivm_destroy(struct gallivm_state *gallivm);
 
@@ -64,6 +80,11 @@ void
 gallivm_verify_function(struct gallivm_state *gallivm,
                         LLVMValueRef func);
 
+boolean
+gallivm_set_cache_key(struct gallivm_state *gallivm,
+                      struct util_disk_cache *cache,
+                      const void *key, unsigned key_size);
+
 void
 gallivm_compile_module(struct gallivm_state *gallivm);
 
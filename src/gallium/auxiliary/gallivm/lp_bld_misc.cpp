@@ -49,6 +49,7 @@
 
 
 #include <stddef.h>
+#include <vector>
 
 #include <llvm-c/Core.h>
 #include <llvm-c/ExecutionEngine.h>
@@ -70,12 +71,18 @@
 #if HAVE_LLVM >= 0x0303
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/Module.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/ExecutionEngine/ObjectCache.h>
 #include <llvm/Support/CBindingWrapping.h>
+#include <llvm/Support/MemoryBuffer.h>
 #endif
 
 #include "pipe/p_config.h"
+#include "os/os_thread.h"
 #include "util/u_debug.h"
 #include "util/u_cpu_detect.h"
+#include "util/u_disk_cache.h"
+#include "util/u_memory.h"
 
 #include "lp_bld_misc.h"
 
@@ -243,12 +250,497 @@ lp_set_store_alignment(LLVMValueRef Inst,
 }
 
 
+#if HAVE_LLVM >= 0x0303
+
+/**
+ * MC-JIT object cache backed by a util_disk_cache.
+ *
+ * Each instance caches the machine code of a single module, under the key
+ * given at creation.  The cached object, if any, is read in up front, so
+ * that callers know beforehand whether the IR is going to be compiled at
+ * all.
+ */
+class DiskObjectCache : public llvm::ObjectCache {
+public:
+   DiskObjectCache(struct util_disk_cache *cache,
+                   const void *key, unsigned key_size)
+      : cache(cache), key_size(key_size), object(NULL), object_size(0)
+   {
+      this->key = MALLOC(key_size);
+      if (this->key) {
+         memcpy(this->key, key, key_size);
+         object = util_disk_cache_get(cache, key, key_size, &object_size);
+      }
+   }
+
+   virtual ~DiskObjectCache()
+   {
+      FREE(key);
+      FREE(object);
+   }
+
+   bool hasObject() const
+   {
+      return object != NULL;
+   }
+
+   virtual void notifyObjectCompiled(const llvm::Module *M,
+                                     const llvm::MemoryBuffer *Obj)
+   {
+      if (key && !object && isRelocatable(M)) {
+         util_disk_cache_put(cache, key, key_size,
+                             Obj->getBufferStart(), Obj->getBufferSize());
+      }
+   }
+
+#if HAVE_LLVM >= 0x0304
+   virtual llvm::MemoryBuffer *getObject(const llvm::Module *M)
+   {
+      if (!object)
+         return NULL;
+      /* The caller takes ownership */
+      return llvm::MemoryBuffer::getMemBufferCopy(
+                llvm::StringRef((const char *)object, object_size));
+   }
+#else
+protected:
+   virtual const llvm::MemoryBuffer *getObject(const llvm::Module *M)
+   {
+      if (!object)
+         return NULL;
+      if (!buffer) {
+         buffer.reset(llvm::MemoryBuffer::getMemBuffer(
+                         llvm::StringRef((const char *)object, object_size),
+                         "", false));
+      }
+      return buffer.get();
+   }
+
+private:
+   llvm::OwningPtr<llvm::MemoryBuffer> buffer;
+#endif
+
+private:
+   /**
+    * Absolute addresses (format tables, debug_printf, etc.) are baked into
+    * the IR as integer constants cast to pointers.  They're only valid in
+    * the current process, so modules using them must never be stored.
+    */
+   static bool hasAbsoluteAddress(const llvm::Constant *C)
+   {
+      const llvm::ConstantExpr *CE = llvm::dyn_cast<llvm::ConstantExpr>(C);
+      if (CE && CE->getOpcode() == llvm::Instruction::IntToPtr)
+         return true;
+      for (unsigned i = 0; i < C->getNumOperands(); ++i) {
+         const llvm::Constant *Op =
+            llvm::dyn_cast<llvm::Constant>(C->getOperand(i));
+         if (Op && !llvm::isa<llvm::GlobalValue>(Op) && hasAbsoluteAddress(Op))
+            return true;
+      }
+      return false;
+   }
+
+   static bool isRelocatable(const llvm::Module *M)
+   {
+      llvm::Module::const_iterator F;
+      llvm::Function::const_iterator BB;
+      llvm::BasicBlock::const_iterator I;
+
+      for (F = M->begin(); F != M->end(); ++F) {
+         for (BB = F->begin(); BB != F->end(); ++BB) {
+            for (I = BB->begin(); I != BB->end(); ++I) {
+               if (I->getOpcode() == llvm::Instruction::IntToPtr)
+                  return false;
+               for (unsigned i = 0; i < I->getNumOperands(); ++i) {
+                  const llvm::Constant *C =
+                     llvm::dyn_cast<llvm::Constant>(I->getOperand(i));
+                  if (C && !llvm::isa<llvm::GlobalValue>(C) &&
+                      hasAbsoluteAddress(C))
+                     return false;
+               }
+            }
+         }
+      }
+      return true;
+   }
+
+   struct util_disk_cache *cache;
+   void *key;
+   unsigned key_size;
+   void *object;
+   unsigned object_size;
+};
+
+#endif /* HAVE_LLVM >= 0x0303 */
+
+
+extern "C"
+struct lp_object_cache *
+lp_object_cache_create(struct util_disk_cache *cache,
+                       const void *key, unsigned key_size)
+{
+#if HAVE_LLVM >= 0x0303
+   return reinterpret_cast<struct lp_object_cache *>(
+             new DiskObjectCache(cache, key, key_size));
+#else
+   return NULL;
+#endif
+}
+
+
+extern "C"
+boolean
+lp_object_cache_has_object(struct lp_object_cache *cache)
+{
+#if HAVE_LLVM >= 0x0303
+   return reinterpret_cast<DiskObjectCache *>(cache)->hasObject();
+#else
+   return FALSE;
+#endif
+}
+
+
+extern "C"
+void
+lp_object_cache_destroy(struct lp_object_cache *cache)
+{
+#if HAVE_LLVM >= 0x0303
+   delete reinterpret_cast<DiskObjectCache *>(cache);
+#endif
+}
+
+
 #if HAVE_LLVM >= 0x301
 
+/**
+ * Code memory shared by all the old JIT engines.
+ *
+ * Giving every engine a default memory manager of its own means every
+ * variant pays for its own code, data and stub slabs, most of which stay
+ * empty.  Instead all engines allocate from one DefaultJITMemoryManager,
+ * through a ShaderMemoryManager which remembers the function bodies of its
+ * engine so that they can be freed again once the engine is gone.
+ *
+ * Engines are created and destroyed from several threads, so all the calls
+ * into the shared manager take a lock.  That lock is held from
+ * startFunctionBody() to endFunctionBody(), as the default manager can only
+ * emit one function at a time, and it is recursive because the JIT
+ * allocates stubs and globals in between.
+ */
+struct lp_generated_code {
+   std::vector<void *> FunctionBody;
+};
+
+
+namespace {
+
+class DelegatingJITMemoryManager : public llvm::JITMemoryManager {
+
+   protected:
+      virtual llvm::JITMemoryManager *mgr() const = 0;
+
+   public:
+      /*
+       * From JITMemoryManager
+       */
+      virtual void setMemoryWritable() {
+         mgr()->setMemoryWritable();
+      }
+      virtual void setMemoryExecutable() {
+         mgr()->setMemoryExecutable();
+      }
+      virtual void setPoisonMemory(bool poison) {
+         mgr()->setPoisonMemory(poison);
+      }
+      virtual void AllocateGOT() {
+         mgr()->AllocateGOT();
+         /*
+          * isManagingGOT() is not virtual in base class so we can't delegate.
+          * Instead we mirror the value of HasGOT in our instance.
+          */
+         HasGOT = mgr()->isManagingGOT();
+      }
+      virtual uint8_t *getGOTBase() const {
+         return mgr()->getGOTBase();
+      }
+      virtual uint8_t *startFunctionBody(const llvm::Function *F,
+                                         uintptr_t &ActualSize) {
+         return mgr()->startFunctionBody(F, ActualSize);
+      }
+      virtual uint8_t *allocateStub(const llvm::GlobalValue *F,
+                                    unsigned StubSize,
+                                    unsigned Alignment) {
+         return mgr()->allocateStub(F, StubSize, Alignment);
+      }
+      virtual void endFunctionBody(const llvm::Function *F,
+                                   uint8_t *FunctionStart,
+                                   uint8_t *FunctionEnd) {
+         mgr()->endFunctionBody(F, FunctionStart, FunctionEnd);
+      }
+      virtual uint8_t *allocateSpace(intptr_t Size, unsigned Alignment) {
+         return mgr()->allocateSpace(Size, Alignment);
+      }
+      virtual uint8_t *allocateGlobal(uintptr_t Size, unsigned Alignment) {
+         return mgr()->allocateGlobal(Size, Alignment);
+      }
+      virtual void deallocateFunctionBody(void *Body) {
+         mgr()->deallocateFunctionBody(Body);
+      }
+#if HAVE_LLVM < 0x0304
+      virtual uint8_t *startExceptionTable(const llvm::Function *F,
+                                           uintptr_t &ActualSize) {
+         return mgr()->startExceptionTable(F, ActualSize);
+      }
+      virtual void endExceptionTable(const llvm::Function *F,
+                                     uint8_t *TableStart,
+                                     uint8_t *TableEnd,
+                                     uint8_t *FrameRegister) {
+         mgr()->endExceptionTable(F, TableStart, TableEnd, FrameRegister);
+      }
+      virtual void deallocateExceptionTable(void *ET) {
+         mgr()->deallocateExceptionTable(ET);
+      }
+#endif
+      virtual bool CheckInvariants(std::string &s) {
+         return mgr()->CheckInvariants(s);
+      }
+      virtual size_t GetDefaultCodeSlabSize() {
+         return mgr()->GetDefaultCodeSlabSize();
+      }
+      virtual size_t GetDefaultDataSlabSize() {
+         return mgr()->GetDefaultDataSlabSize();
+      }
+      virtual size_t GetDefaultStubSlabSize() {
+         return mgr()->GetDefaultStubSlabSize();
+      }
+      virtual unsigned GetNumCodeSlabs() {
+         return mgr()->GetNumCodeSlabs();
+      }
+      virtual unsigned GetNumDataSlabs() {
+         return mgr()->GetNumDataSlabs();
+      }
+      virtual unsigned GetNumStubSlabs() {
+         return mgr()->GetNumStubSlabs();
+      }
+
+      /*
+       * From RTDyldMemoryManager
+       */
+#if HAVE_LLVM >= 0x0304
+      virtual uint8_t *allocateCodeSection(uintptr_t Size,
+                                           unsigned Alignment,
+                                           unsigned SectionID,
+                                           llvm::StringRef SectionName) {
+         return mgr()->allocateCodeSection(Size, Alignment, SectionID,
+                                           SectionName);
+      }
+#else
+      virtual uint8_t *allocateCodeSection(uintptr_t Size,
+                                           unsigned Alignment,
+                                           unsigned SectionID) {
+         return mgr()->allocateCodeSection(Size, Alignment, SectionID);
+      }
+#endif
+#if HAVE_LLVM >= 0x0303
+      virtual uint8_t *allocateDataSection(uintptr_t Size,
+                                           unsigned Alignment,
+                                           unsigned SectionID,
+#if HAVE_LLVM >= 0x0304
+                                           llvm::StringRef SectionName,
+#endif
+                                           bool IsReadOnly) {
+         return mgr()->allocateDataSection(Size, Alignment, SectionID,
+#if HAVE_LLVM >= 0x0304
+                                           SectionName,
+#endif
+                                           IsReadOnly);
+      }
+#if HAVE_LLVM >= 0x0304
+      virtual void registerEHFrames(uint8_t *Addr, uint64_t LoadAddr,
+                                    size_t Size) {
+         mgr()->registerEHFrames(Addr, LoadAddr, Size);
+      }
+      virtual void deregisterEHFrames(uint8_t *Addr, uint64_t LoadAddr,
+                                      size_t Size) {
+         mgr()->deregisterEHFrames(Addr, LoadAddr, Size);
+      }
+#else
+      virtual void registerEHFrames(llvm::StringRef SectionData) {
+         mgr()->registerEHFrames(SectionData);
+      }
+#endif
+#else
+      virtual uint8_t *allocateDataSection(uintptr_t Size,
+                                           unsigned Alignment,
+                                           unsigned SectionID) {
+         return mgr()->allocateDataSection(Size, Alignment, SectionID);
+      }
+#endif
+      virtual void *getPointerToNamedFunction(const std::string &Name,
+                                              bool AbortOnFailure=true) {
+         return mgr()->getPointerToNamedFunction(Name, AbortOnFailure);
+      }
+#if HAVE_LLVM == 0x0303
+      virtual bool applyPermissions(std::string *ErrMsg = 0) {
+         return mgr()->applyPermissions(ErrMsg);
+      }
+#elif HAVE_LLVM > 0x0303
+      virtual bool finalizeMemory(std::string *ErrMsg = 0) {
+         return mgr()->finalizeMemory(ErrMsg);
+      }
+#endif
+};
+
+
+/**
+ * Locks the shared memory manager for the lifetime of the object.
+ */
+class SharedMemoryLock {
+   public:
+      static mtx_t Mutex;
+
+      SharedMemoryLock() { mtx_lock(&Mutex); }
+      ~SharedMemoryLock() { mtx_unlock(&Mutex); }
+};
+
+mtx_t SharedMemoryLock::Mutex;
+
+class SharedMemoryLockInit {
+   public:
+      SharedMemoryLockInit() {
+         mtx_init(&SharedMemoryLock::Mutex, mtx_plain | mtx_recursive);
+      }
+};
+
+static SharedMemoryLockInit sharedMemoryLockInit;
+
+
+/**
+ * Memory manager of one engine, allocating from the shared one.
+ *
+ * The engine deletes its memory manager when it is destroyed, but the
+ * function bodies are only freed by lp_free_generated_code(), once the
+ * engine can no longer reference them.
+ */
+class ShaderMemoryManager : public DelegatingJITMemoryManager {
+
+      static llvm::JITMemoryManager *TheMM;
+      static unsigned NumUsers;
+
+      lp_generated_code *code;
+
+      virtual llvm::JITMemoryManager *mgr() const {
+         return TheMM;
+      }
+
+   public:
+      ShaderMemoryManager(lp_generated_code *code) : code(code) {
+         SharedMemoryLock lock;
+         if (!TheMM) {
+            TheMM = llvm::JITMemoryManager::CreateDefaultMemManager();
+         }
+         ++NumUsers;
+      }
+
+      static void freeGeneratedCode(lp_generated_code *code) {
+         SharedMemoryLock lock;
+         std::vector<void *>::iterator i;
+
+         for (i = code->FunctionBody.begin();
+              i != code->FunctionBody.end(); ++i) {
+            TheMM->deallocateFunctionBody(*i);
+         }
+         delete code;
+
+         /* Give everything back once the last engine is gone */
+         assert(NumUsers > 0);
+         if (--NumUsers == 0) {
+            delete TheMM;
+            TheMM = NULL;
+         }
+      }
+
+      virtual uint8_t *startFunctionBody(const llvm::Function *F,
+                                         uintptr_t &ActualSize) {
+         /* Released in endFunctionBody() */
+         mtx_lock(&SharedMemoryLock::Mutex);
+         return mgr()->startFunctionBody(F, ActualSize);
+      }
+      virtual void endFunctionBody(const llvm::Function *F,
+                                   uint8_t *FunctionStart,
+                                   uint8_t *FunctionEnd) {
+         mgr()->endFunctionBody(F, FunctionStart, FunctionEnd);
+         code->FunctionBody.push_back(FunctionStart);
+         mtx_unlock(&SharedMemoryLock::Mutex);
+      }
+      virtual void deallocateFunctionBody(void *Body) {
+         SharedMemoryLock lock;
+         std::vector<void *>::iterator i;
+
+         /* The JIT frees the body itself when it has to re-emit a function */
+         for (i = code->FunctionBody.begin();
+              i != code->FunctionBody.end(); ++i) {
+            if (*i == Body) {
+               code->FunctionBody.erase(i);
+               break;
+            }
+         }
+         mgr()->deallocateFunctionBody(Body);
+      }
+      virtual uint8_t *allocateStub(const llvm::GlobalValue *F,
+                                    unsigned StubSize,
+                                    unsigned Alignment) {
+         SharedMemoryLock lock;
+         return mgr()->allocateStub(F, StubSize, Alignment);
+      }
+      virtual uint8_t *allocateSpace(intptr_t Size, unsigned Alignment) {
+         SharedMemoryLock lock;
+         return mgr()->allocateSpace(Size, Alignment);
+      }
+      virtual uint8_t *allocateGlobal(uintptr_t Size, unsigned Alignment) {
+         SharedMemoryLock lock;
+         return mgr()->allocateGlobal(Size, Alignment);
+      }
+      virtual void setMemoryWritable() {
+         SharedMemoryLock lock;
+         mgr()->setMemoryWritable();
+      }
+      virtual void setMemoryExecutable() {
+         SharedMemoryLock lock;
+         mgr()->setMemoryExecutable();
+      }
+      virtual void AllocateGOT() {
+         SharedMemoryLock lock;
+         DelegatingJITMemoryManager::AllocateGOT();
+      }
+};
+
+llvm::JITMemoryManager *ShaderMemoryManager::TheMM = NULL;
+unsigned ShaderMemoryManager::NumUsers = 0;
+
+}
+
+
+/**
+ * Free the code generated by an engine, after the engine was destroyed.
+ */
+extern "C"
+void
+lp_free_generated_code(struct lp_generated_code *code)
+{
+   if (code) {
+      ShaderMemoryManager::freeGeneratedCode(code);
+   }
+}
+
+
 /**
  * Same as LLVMCreateJITCompilerForModule, but:
  * - allows using MCJIT and enabling AVX feature where available.
- * - set target options
+ * - set target options, including relaxed floating point in fast math mode
+ * - allocates the code of the old JIT from the shared memory manager, the
+ *   returned generated code must be freed with lp_free_generated_code()
+ *   after the engine.
  *
  * See also:
  * - llvm/lib/ExecutionEngine/ExecutionEngineBindings.cpp
@@ -261,9 +753,13 @@ lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
                                         LLVMModuleRef M,
                                         unsigned OptLevel,
                                         int useMCJIT,
+                                        int fastMath,
+                                        struct lp_object_cache *cache,
+                                        struct lp_generated_code **OutCode,
                                         char **OutError)
 {
    using namespace llvm;
+   lp_generated_code *code = NULL;
 
    std::string Error;
    EngineBuilder builder(unwrap(M));
@@ -291,6 +787,16 @@ lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
    options.NoFramePointerElim = true;
 #endif
 
+   if (fastMath) {
+      options.UnsafeFPMath = true;
+      options.NoInfsFPMath = true;
+      options.NoNaNsFPMath = true;
+      options.LessPreciseFPMADOption = true;
+#if HAVE_LLVM >= 0x0302
+      options.AllowFPOpFusion = FPOpFusion::Fast;
+#endif
+   }
+
    builder.setEngineKind(EngineKind::JIT)
           .setErrorStr(&Error)
           .setTargetOptions(options)
@@ -312,9 +818,22 @@ lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
       if (util_cpu_caps.has_f16c) {
          MAttrs.push_back("+f16c");
       }
+      if (util_cpu_caps.has_avx2) {
+         MAttrs.push_back("+avx2");
+      }
       builder.setMAttrs(MAttrs);
    }
-   builder.setJITMemoryManager(JITMemoryManager::CreateDefaultMemManager());
+   if (useMCJIT) {
+      /*
+       * MC-JIT has no way of freeing sections individually, so the memory
+       * can only be given back with the whole manager.
+       */
+      builder.setJITMemoryManager(JITMemoryManager::CreateDefaultMemManager());
+   }
+   else {
+      code = new lp_generated_code;
+      builder.setJITMemoryManager(new ShaderMemoryManager(code));
+   }
 
    ExecutionEngine *JIT;
 #if 0
@@ -329,9 +848,18 @@ lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
    JIT = builder.create(builder.selectTarget(TT, MArch, MCPU, MAttrs));
 #endif
    if (JIT) {
+#if HAVE_LLVM >= 0x0303
+      if (useMCJIT && cache) {
+         JIT->setObjectCache(reinterpret_cast<DiskObjectCache *>(cache));
+      }
+#else
+      (void)cache;
+#endif
       *OutJIT = wrap(JIT);
+      *OutCode = code;
       return 0;
    }
+   lp_free_generated_code(code);
    *OutError = strdup(Error.c_str());
    return 1;
 }
@@ -30,6 +30,7 @@
 #define LP_BLD_MISC_H
 
 
+#include "pipe/p_compiler.h"
 #include "lp_bld.h"
 #include <llvm-c/ExecutionEngine.h>
 
@@ -52,13 +53,34 @@ extern LLVMValueRef
 lp_build_load_volatile(LLVMBuilderRef B, LLVMValueRef PointerVal,
                        const char *Name);
 
+struct util_disk_cache;
+struct lp_object_cache;
+struct lp_generated_code;
+
+
+extern struct lp_object_cache *
+lp_object_cache_create(struct util_disk_cache *cache,
+                       const void *key, unsigned key_size);
+
+extern boolean
+lp_object_cache_has_object(struct lp_object_cache *cache);
+
+extern void
+lp_object_cache_destroy(struct lp_object_cache *cache);
+
 extern int
 lp_build_create_jit_compiler_for_module(LLVMExecutionEngineRef *OutJIT,
                                         LLVMModuleRef M,
                                         unsigned OptLevel,
                                         int useMCJIT,
+                                        int fastMath,
+                                        struct lp_object_cache *cache,
+                                        struct lp_generated_code **OutCode,
                                         char **OutError);
 
+extern void
+lp_free_generated_code(struct lp_generated_code *code);
+
 
 #ifdef __cplusplus
 }
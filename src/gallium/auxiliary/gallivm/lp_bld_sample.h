@@ -312,14 +312,17 @@ struct lp_build_sample_context
 /**
  * We only support a few wrap modes in lp_build_sample_wrap_linear_int() at
  * this time.  Return whether the given mode is supported by that function.
+ * Mirrored repeat is only supported for power of two sizes.
  */
 static INLINE boolean
-lp_is_simple_wrap_mode(unsigned mode)
+lp_is_simple_wrap_mode(unsigned mode, boolean is_pot)
 {
    switch (mode) {
    case PIPE_TEX_WRAP_REPEAT:
    case PIPE_TEX_WRAP_CLAMP_TO_EDGE:
       return TRUE;
+   case PIPE_TEX_WRAP_MIRROR_REPEAT:
+      return is_pot;
    default:
       return FALSE;
    }
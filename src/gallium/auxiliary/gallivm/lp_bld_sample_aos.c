@@ -59,6 +59,31 @@
 #include "lp_bld_quad.h"
 
 
+/**
+ * Mirrored repeat of integer texel coordinates, for power of two lengths.
+ * The coordinate is taken modulo 2 * length first; texels in the upper
+ * half are then reflected, which for a power of two length is just an
+ * xor with length - 1.
+ */
+static LLVMValueRef
+lp_build_coord_mirror_int_pot(struct lp_build_sample_context *bld,
+                              LLVMValueRef coord,
+                              LLVMValueRef length,
+                              LLVMValueRef length_minus_one)
+{
+   struct lp_build_context *int_coord_bld = &bld->int_coord_bld;
+   LLVMBuilderRef builder = bld->gallivm->builder;
+   LLVMValueRef odd;
+
+   odd = LLVMBuildAnd(builder, coord, length, "");
+   odd = lp_build_compare(bld->gallivm, int_coord_bld->type,
+                          PIPE_FUNC_NOTEQUAL, odd, int_coord_bld->zero);
+   coord = LLVMBuildAnd(builder, coord, length_minus_one, "");
+   return LLVMBuildXor(builder, coord,
+                       LLVMBuildAnd(builder, odd, length_minus_one, ""), "");
+}
+
+
 /**
  * Build LLVM code for texture coord wrapping, for nearest filtering,
  * for scaled integer texcoords.
@@ -116,9 +141,14 @@ lp_build_sample_wrap_nearest_int(struct lp_build_sample_context *bld,
       coord = lp_build_min(int_coord_bld, coord, length_minus_one);
       break;
 
+   case PIPE_TEX_WRAP_MIRROR_REPEAT:
+      assert(is_pot);
+      coord = lp_build_coord_mirror_int_pot(bld, coord, length,
+                                            length_minus_one);
+      break;
+
    case PIPE_TEX_WRAP_CLAMP:
    case PIPE_TEX_WRAP_CLAMP_TO_BORDER:
-   case PIPE_TEX_WRAP_MIRROR_REPEAT:
    case PIPE_TEX_WRAP_MIRROR_CLAMP:
    case PIPE_TEX_WRAP_MIRROR_CLAMP_TO_EDGE:
    case PIPE_TEX_WRAP_MIRROR_CLAMP_TO_BORDER:
@@ -181,9 +211,22 @@ lp_build_sample_wrap_nearest_float(struct lp_build_sample_context *bld,
       *icoord = lp_build_itrunc(coord_bld, coord);
       break;
 
+   case PIPE_TEX_WRAP_MIRROR_REPEAT:
+      assert(is_pot);
+      coord = lp_build_mul(coord_bld, coord, length);
+      *icoord = lp_build_ifloor(coord_bld, coord);
+      if (offset) {
+         *icoord = lp_build_add(&bld->int_coord_bld, *icoord, offset);
+      }
+      length = lp_build_itrunc(coord_bld, length);
+      *icoord = lp_build_coord_mirror_int_pot(bld, *icoord, length,
+                                              lp_build_sub(&bld->int_coord_bld,
+                                                           length,
+                                                           bld->int_coord_bld.one));
+      break;
+
    case PIPE_TEX_WRAP_CLAMP:
    case PIPE_TEX_WRAP_CLAMP_TO_BORDER:
-   case PIPE_TEX_WRAP_MIRROR_REPEAT:
    case PIPE_TEX_WRAP_MIRROR_CLAMP:
    case PIPE_TEX_WRAP_MIRROR_CLAMP_TO_EDGE:
    case PIPE_TEX_WRAP_MIRROR_CLAMP_TO_BORDER:
@@ -280,9 +323,17 @@ lp_build_sample_wrap_linear_int(struct lp_build_sample_context *bld,
                                 length_minus_one);
          break;
 
+      case PIPE_TEX_WRAP_MIRROR_REPEAT:
+         assert(is_pot);
+         coord1 = lp_build_add(int_coord_bld, coord0, int_coord_bld->one);
+         coord0 = lp_build_coord_mirror_int_pot(bld, coord0, length,
+                                                length_minus_one);
+         coord1 = lp_build_coord_mirror_int_pot(bld, coord1, length,
+                                                length_minus_one);
+         break;
+
       case PIPE_TEX_WRAP_CLAMP:
       case PIPE_TEX_WRAP_CLAMP_TO_BORDER:
-      case PIPE_TEX_WRAP_MIRROR_REPEAT:
       case PIPE_TEX_WRAP_MIRROR_CLAMP:
       case PIPE_TEX_WRAP_MIRROR_CLAMP_TO_EDGE:
       case PIPE_TEX_WRAP_MIRROR_CLAMP_TO_BORDER:
@@ -353,9 +404,27 @@ lp_build_sample_wrap_linear_int(struct lp_build_sample_context *bld,
                               LLVMBuildAnd(builder, stride, mask, ""));
       break;
 
+   case PIPE_TEX_WRAP_MIRROR_REPEAT:
+      {
+         LLVMValueRef coord1;
+
+         /*
+          * Both texels can land on either side of a reflection, so there's
+          * no shortcut for the second offset.
+          */
+         assert(is_pot);
+         coord1 = lp_build_add(int_coord_bld, coord0, int_coord_bld->one);
+         coord0 = lp_build_coord_mirror_int_pot(bld, coord0, length,
+                                                length_minus_one);
+         coord1 = lp_build_coord_mirror_int_pot(bld, coord1, length,
+                                                length_minus_one);
+         *offset0 = lp_build_mul(int_coord_bld, coord0, stride);
+         *offset1 = lp_build_mul(int_coord_bld, coord1, stride);
+      }
+      break;
+
    case PIPE_TEX_WRAP_CLAMP:
    case PIPE_TEX_WRAP_CLAMP_TO_BORDER:
-   case PIPE_TEX_WRAP_MIRROR_REPEAT:
    case PIPE_TEX_WRAP_MIRROR_CLAMP:
    case PIPE_TEX_WRAP_MIRROR_CLAMP_TO_EDGE:
    case PIPE_TEX_WRAP_MIRROR_CLAMP_TO_BORDER:
@@ -473,6 +542,30 @@ lp_build_sample_wrap_linear_float(struct lp_build_sample_context *bld,
       *coord1 = lp_build_min(coord_bld, *coord1, length_minus_one);
       *coord1 = lp_build_itrunc(coord_bld, *coord1);
       break;
+   case PIPE_TEX_WRAP_MIRROR_REPEAT:
+      {
+         LLVMValueRef ilength;
+
+         assert(is_pot);
+         coord = lp_build_mul(coord_bld, coord, length);
+         if (offset) {
+            offset = lp_build_int_to_float(coord_bld, offset);
+            coord = lp_build_add(coord_bld, coord, offset);
+         }
+         if (!force_nearest)
+            coord = lp_build_sub(coord_bld, coord, half);
+         /* convert to int, compute lerp weight */
+         lp_build_ifloor_fract(coord_bld, coord, coord0, weight);
+         *coord1 = lp_build_add(int_coord_bld, *coord0, int_coord_bld->one);
+         /* mirror both texels */
+         ilength = lp_build_itrunc(coord_bld, length);
+         length_minus_one = lp_build_itrunc(coord_bld, length_minus_one);
+         *coord0 = lp_build_coord_mirror_int_pot(bld, *coord0, ilength,
+                                                 length_minus_one);
+         *coord1 = lp_build_coord_mirror_int_pot(bld, *coord1, ilength,
+                                                 length_minus_one);
+      }
+      break;
    default:
       assert(0);
       *coord0 = int_coord_bld->zero;
@@ -1578,11 +1671,14 @@ lp_build_sample_aos(struct lp_build_sample_context *bld,
    struct lp_build_context u8n_bld;
 
    /* we only support the common/simple wrap modes at this time */
-   assert(lp_is_simple_wrap_mode(bld->static_sampler_state->wrap_s));
+   assert(lp_is_simple_wrap_mode(bld->static_sampler_state->wrap_s,
+                                 bld->static_texture_state->pot_width));
    if (dims >= 2)
-      assert(lp_is_simple_wrap_mode(bld->static_sampler_state->wrap_t));
+      assert(lp_is_simple_wrap_mode(bld->static_sampler_state->wrap_t,
+                                    bld->static_texture_state->pot_height));
    if (dims >= 3)
-      assert(lp_is_simple_wrap_mode(bld->static_sampler_state->wrap_r));
+      assert(lp_is_simple_wrap_mode(bld->static_sampler_state->wrap_r,
+                                    bld->static_texture_state->pot_depth));
 
 
    /* make 8-bit unorm builder context */
@@ -2600,15 +2600,18 @@ lp_build_sample_soa(struct gallivm_state *gallivm,
       boolean use_aos = util_format_fits_8unorm(bld.format_desc) &&
                         /* not sure this is strictly needed or simply impossible */
                         derived_sampler_state.compare_mode == PIPE_TEX_COMPARE_NONE &&
-                        lp_is_simple_wrap_mode(derived_sampler_state.wrap_s);
+                        lp_is_simple_wrap_mode(derived_sampler_state.wrap_s,
+                                               static_texture_state->pot_width);
 
       use_aos &= bld.num_lods <= num_quads ||
                  derived_sampler_state.min_img_filter ==
                     derived_sampler_state.mag_img_filter;
       if (dims > 1) {
-         use_aos &= lp_is_simple_wrap_mode(derived_sampler_state.wrap_t);
+         use_aos &= lp_is_simple_wrap_mode(derived_sampler_state.wrap_t,
+                                            static_texture_state->pot_height);
          if (dims > 2) {
-            use_aos &= lp_is_simple_wrap_mode(derived_sampler_state.wrap_r);
+            use_aos &= lp_is_simple_wrap_mode(derived_sampler_state.wrap_r,
+                                               static_texture_state->pot_depth);
          }
       }
       if (static_texture_state->target == PIPE_TEXTURE_CUBE &&
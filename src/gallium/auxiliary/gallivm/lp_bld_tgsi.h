@@ -63,6 +63,7 @@ struct lp_build_mask_context;
 struct gallivm_state;
 struct lp_derivatives;
 struct lp_build_tgsi_gs_iface;
+struct lp_build_tgsi_cs_iface;
 
 
 enum lp_build_tex_modifier {
@@ -231,7 +232,8 @@ lp_build_tgsi_soa(struct gallivm_state *gallivm,
                   LLVMValueRef (*outputs)[4],
                   struct lp_build_sampler_soa *sampler,
                   const struct tgsi_shader_info *info,
-                  const struct lp_build_tgsi_gs_iface *gs_iface);
+                  const struct lp_build_tgsi_gs_iface *gs_iface,
+                  const struct lp_build_tgsi_cs_iface *cs_iface);
 
 
 void
@@ -422,6 +424,71 @@ struct lp_build_tgsi_gs_iface
                        LLVMValueRef emitted_prims_vec);
 };
 
+/**
+ * Compute shader interface, implemented by the driver.
+ *
+ * The driver runs the threads of a block one vector at a time.  A
+ * BARRIER ends the loop over the vectors and starts a new one, so the
+ * temporaries must then live in memory private to each vector. Barriers
+ * are only supported outside of flow control, and address and predicate
+ * registers don't survive them.
+ */
+/** Bits of the byte offset within a buffer in GLOBAL addresses */
+#define LP_BLD_GLOBAL_OFFSET_BITS 24
+
+struct lp_build_tgsi_cs_iface
+{
+   /** Instruction to start executing at */
+   unsigned start_pc;
+
+   /**
+    * Return component chan of a TGSI_SEMANTIC_GRID_SIZE, BLOCK_ID,
+    * BLOCK_SIZE or THREAD_ID system value as an integer vector.
+    */
+   LLVMValueRef (*fetch_system_value)(const struct lp_build_tgsi_cs_iface *cs_iface,
+                                      struct lp_build_tgsi_context *bld_base,
+                                      unsigned semantic,
+                                      unsigned chan);
+
+   /**
+    * Describe RES[index], or one of the TGSI_RESOURCE_x memory spaces: its
+    * base pointer (i8 *), and row stride and size in bytes (i32).  Nothing
+    * at or beyond size is ever accessed.
+    */
+   void (*get_resource)(const struct lp_build_tgsi_cs_iface *cs_iface,
+                        struct lp_build_tgsi_context *bld_base,
+                        unsigned index,
+                        LLVMValueRef *base,
+                        LLVMValueRef *stride,
+                        LLVMValueRef *size);
+
+   /**
+    * Describe global buffer number buffer (an i32 scalar): its base
+    * pointer and size, as for get_resource().  Addresses in the GLOBAL
+    * memory space are made of the buffer number in the bits above
+    * LP_BLD_GLOBAL_OFFSET_BITS and of the byte offset within the buffer
+    * in the bits below.  If NULL, GLOBAL goes through get_resource().
+    */
+   void (*get_global_buffer)(const struct lp_build_tgsi_cs_iface *cs_iface,
+                             struct lp_build_tgsi_context *bld_base,
+                             LLVMValueRef buffer,
+                             LLVMValueRef *base,
+                             LLVMValueRef *size);
+
+   /**
+    * Return storage for num_vectors temporaries private to the current
+    * vector of threads.  Only used when the shader has barriers, and
+    * called again after each of them.
+    */
+   LLVMValueRef (*get_temps_array)(const struct lp_build_tgsi_cs_iface *cs_iface,
+                                   struct lp_build_tgsi_context *bld_base,
+                                   unsigned num_vectors);
+
+   /** Make all the threads of the block get here before any goes on */
+   void (*barrier)(const struct lp_build_tgsi_cs_iface *cs_iface,
+                   struct lp_build_tgsi_context *bld_base);
+};
+
 struct lp_build_tgsi_soa_context
 {
    struct lp_build_tgsi_context bld_base;
@@ -430,6 +497,8 @@ struct lp_build_tgsi_soa_context
    struct lp_build_context elem_bld;
 
    const struct lp_build_tgsi_gs_iface *gs_iface;
+   const struct lp_build_tgsi_cs_iface *cs_iface;
+   unsigned resource_2d_mask;       /**< RES[] declared with 2D targets */
    LLVMValueRef emitted_prims_vec_ptr;
    LLVMValueRef total_emitted_vertices_vec_ptr;
    LLVMValueRef emitted_vertices_vec_ptr;
@@ -1535,6 +1535,17 @@ emit_fetch_system_value(
       atype = TGSI_TYPE_UNSIGNED;
       break;
 
+   case TGSI_SEMANTIC_GRID_SIZE:
+   case TGSI_SEMANTIC_BLOCK_ID:
+   case TGSI_SEMANTIC_BLOCK_SIZE:
+   case TGSI_SEMANTIC_THREAD_ID:
+      assert(bld->cs_iface);
+      res = bld->cs_iface->fetch_system_value(bld->cs_iface, bld_base,
+               info->system_value_semantic_name[reg->Register.Index],
+               swizzle);
+      atype = TGSI_TYPE_UNSIGNED;
+      break;
+
    default:
       assert(!"unexpected semantic in emit_fetch_system_value");
       res = bld_base->base.zero;
@@ -1836,7 +1847,8 @@ emit_store(
    unsigned chan_index;
    struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
 
-   if(info->num_dst) {
+   /* STORE writes its RES[] destination itself */
+   if(info->num_dst && inst->Dst[0].Register.File != TGSI_FILE_RESOURCE) {
       LLVMValueRef pred[TGSI_NUM_CHANNELS];
 
       emit_fetch_predicate( bld, inst, pred );
@@ -2723,6 +2735,14 @@ lp_emit_declaration_soa(
          bld->sv[idx] = decl->SamplerView;
          break;
 
+      case TGSI_FILE_RESOURCE:
+         if (idx < 32 &&
+             (decl->Resource.Resource == TGSI_TEXTURE_2D ||
+              decl->Resource.Resource == TGSI_TEXTURE_RECT)) {
+            bld->resource_2d_mask |= 1u << idx;
+         }
+         break;
+
       default:
          /* don't need to declare other vars */
          break;
@@ -3483,18 +3503,286 @@ nrm_emit(
    }
 }
 
+/**
+ * Load or store the channels in writemask of RES[index] at the given per
+ * lane byte offsets (plus rows for 2D resources), one lane at a time.
+ * Lanes whose access isn't entirely within the resource read zeros and
+ * don't write anything.
+ */
+static void
+emit_resource_access(struct lp_build_tgsi_soa_context *bld,
+                     unsigned index,
+                     LLVMValueRef offset_x,
+                     LLVMValueRef offset_y,
+                     unsigned writemask,
+                     LLVMValueRef values[TGSI_NUM_CHANNELS],
+                     boolean is_store)
+{
+   struct gallivm_state *gallivm = bld->bld_base.base.gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   struct lp_build_context *uint_bld = &bld->bld_base.uint_bld;
+   LLVMTypeRef i32_ptr_type =
+      LLVMPointerType(LLVMInt32TypeInContext(gallivm->context), 0);
+   LLVMTypeRef i8_ptr_type =
+      LLVMPointerType(LLVMInt8TypeInContext(gallivm->context), 0);
+   LLVMValueRef base = NULL, stride = NULL, size, size_vec;
+   LLVMValueRef offset, end, active;
+   LLVMValueRef bases_ptr = NULL;
+   LLVMValueRef result_ptr[TGSI_NUM_CHANNELS];
+   unsigned length = uint_bld->type.length;
+   unsigned i, chan;
+
+   assert(bld->cs_iface);
+
+   if (index == TGSI_RESOURCE_GLOBAL && bld->cs_iface->get_global_buffer) {
+      /*
+       * The upper bits of GLOBAL addresses select one of the global
+       * buffers, which may differ across the lanes.
+       */
+      LLVMValueRef buffers =
+         LLVMBuildLShr(builder, offset_x,
+                       lp_build_const_int_vec(gallivm, uint_bld->type,
+                                              LP_BLD_GLOBAL_OFFSET_BITS), "");
+
+      offset_x = LLVMBuildAnd(builder, offset_x,
+                              lp_build_const_int_vec(gallivm, uint_bld->type,
+                                 (1 << LP_BLD_GLOBAL_OFFSET_BITS) - 1), "");
+      offset_y = NULL;
+
+      bases_ptr = lp_build_array_alloca(gallivm, i8_ptr_type,
+                                        lp_build_const_int32(gallivm, length),
+                                        "global_bases");
+      size_vec = uint_bld->undef;
+
+      for (i = 0; i < length; i++) {
+         LLVMValueRef ii = lp_build_const_int32(gallivm, i);
+         LLVMValueRef buffer, lane_base, lane_size;
+
+         buffer = LLVMBuildExtractElement(builder, buffers, ii, "");
+         bld->cs_iface->get_global_buffer(bld->cs_iface, &bld->bld_base,
+                                          buffer, &lane_base, &lane_size);
+
+         LLVMBuildStore(builder, lane_base,
+                        LLVMBuildGEP(builder, bases_ptr, &ii, 1, ""));
+         size_vec = LLVMBuildInsertElement(builder, size_vec, lane_size,
+                                           ii, "");
+      }
+   }
+   else {
+      bld->cs_iface->get_resource(bld->cs_iface, &bld->bld_base, index,
+                                  &base, &stride, &size);
+      size_vec = lp_build_broadcast_scalar(uint_bld, size);
+   }
+
+   offset = offset_x;
+   if (offset_y) {
+      offset = lp_build_add(uint_bld, offset,
+                            lp_build_mul(uint_bld, offset_y,
+                                         lp_build_broadcast_scalar(uint_bld,
+                                                                   stride)));
+   }
+
+   end = lp_build_add(uint_bld, offset,
+                      lp_build_const_int_vec(gallivm, uint_bld->type,
+                                             4 * util_last_bit(writemask)));
+   active = lp_build_cmp(uint_bld, PIPE_FUNC_LEQUAL, end, size_vec);
+   active = LLVMBuildAnd(builder, active,
+                         lp_build_cmp(uint_bld, PIPE_FUNC_GREATER,
+                                      end, offset), "");
+   if (is_store) {
+      active = LLVMBuildAnd(builder, active, mask_vec(&bld->bld_base), "");
+   }
+
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+      if (writemask & (1 << chan)) {
+         if (is_store) {
+            values[chan] = LLVMBuildBitCast(builder, values[chan],
+                                            uint_bld->vec_type, "");
+         }
+         else {
+            result_ptr[chan] = lp_build_alloca(gallivm, uint_bld->vec_type,
+                                               "load");
+            LLVMBuildStore(builder, uint_bld->zero, result_ptr[chan]);
+         }
+      }
+   }
+
+   for (i = 0; i < length; i++) {
+      LLVMValueRef ii = lp_build_const_int32(gallivm, i);
+      LLVMValueRef cond, lane_offset, ptr;
+      struct lp_build_if_state ifthen;
+
+      cond = LLVMBuildExtractElement(builder, active, ii, "");
+      cond = LLVMBuildICmp(builder, LLVMIntNE, cond,
+                           lp_build_const_int32(gallivm, 0), "");
+
+      lp_build_if(&ifthen, gallivm, cond);
+
+      if (bases_ptr) {
+         base = LLVMBuildLoad(builder,
+                              LLVMBuildGEP(builder, bases_ptr, &ii, 1, ""),
+                              "");
+      }
+
+      lane_offset = LLVMBuildExtractElement(builder, offset, ii, "");
+      ptr = LLVMBuildGEP(builder, base, &lane_offset, 1, "");
+      ptr = LLVMBuildBitCast(builder, ptr, i32_ptr_type, "");
+
+      for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+         LLVMValueRef chan_index, chan_ptr, value;
+
+         if (!(writemask & (1 << chan)))
+            continue;
+
+         chan_index = lp_build_const_int32(gallivm, chan);
+         chan_ptr = LLVMBuildGEP(builder, ptr, &chan_index, 1, "");
+
+         if (is_store) {
+            value = LLVMBuildExtractElement(builder, values[chan], ii, "");
+            LLVMBuildStore(builder, value, chan_ptr);
+         }
+         else {
+            LLVMValueRef vec = LLVMBuildLoad(builder, result_ptr[chan], "");
+            value = LLVMBuildLoad(builder, chan_ptr, "");
+            vec = LLVMBuildInsertElement(builder, vec, value, ii, "");
+            LLVMBuildStore(builder, vec, result_ptr[chan]);
+         }
+      }
+
+      lp_build_endif(&ifthen);
+   }
+
+   if (!is_store) {
+      for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+         if (writemask & (1 << chan)) {
+            values[chan] = LLVMBuildLoad(builder, result_ptr[chan], "");
+            values[chan] = LLVMBuildBitCast(builder, values[chan],
+                                            bld->bld_base.base.vec_type, "");
+         }
+      }
+   }
+}
+
+
+/**
+ * Fetch the byte offset, and the row for 2D resources, of a RES[] access.
+ */
+static void
+fetch_resource_address(struct lp_build_tgsi_soa_context *bld,
+                       const struct tgsi_full_instruction *inst,
+                       unsigned src,
+                       unsigned index,
+                       LLVMValueRef *x,
+                       LLVMValueRef *y)
+{
+   struct lp_build_tgsi_context *bld_base = &bld->bld_base;
+   LLVMBuilderRef builder = bld_base->base.gallivm->builder;
+
+   *x = lp_build_emit_fetch(bld_base, inst, src, TGSI_CHAN_X);
+   *x = LLVMBuildBitCast(builder, *x, bld_base->uint_bld.vec_type, "");
+
+   *y = NULL;
+   if (index < 32 && (bld->resource_2d_mask & (1u << index))) {
+      *y = lp_build_emit_fetch(bld_base, inst, src, TGSI_CHAN_Y);
+      *y = LLVMBuildBitCast(builder, *y, bld_base->uint_bld.vec_type, "");
+   }
+}
+
+
+static void
+load_emit(
+   const struct lp_build_tgsi_action * action,
+   struct lp_build_tgsi_context * bld_base,
+   struct lp_build_emit_data * emit_data)
+{
+   struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
+   const struct tgsi_full_instruction *inst = emit_data->inst;
+   const unsigned index = inst->Src[0].Register.Index;
+   LLVMValueRef x, y;
+
+   fetch_resource_address(bld, inst, 1, index, &x, &y);
+
+   emit_resource_access(bld, index, x, y, inst->Dst[0].Register.WriteMask,
+                        emit_data->output, FALSE);
+}
+
+
+static void
+store_emit(
+   const struct lp_build_tgsi_action * action,
+   struct lp_build_tgsi_context * bld_base,
+   struct lp_build_emit_data * emit_data)
+{
+   struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
+   const struct tgsi_full_instruction *inst = emit_data->inst;
+   const unsigned index = inst->Dst[0].Register.Index;
+   const unsigned writemask = inst->Dst[0].Register.WriteMask;
+   LLVMValueRef values[TGSI_NUM_CHANNELS];
+   LLVMValueRef x, y;
+   unsigned chan;
+
+   fetch_resource_address(bld, inst, 0, index, &x, &y);
+
+   for (chan = 0; chan < TGSI_NUM_CHANNELS; chan++) {
+      if (writemask & (1 << chan)) {
+         values[chan] = lp_build_emit_fetch(bld_base, inst, 1, chan);
+      }
+   }
+
+   emit_resource_access(bld, index, x, y, writemask, values, TRUE);
+}
+
+
+static void
+barrier_emit(
+   const struct lp_build_tgsi_action * action,
+   struct lp_build_tgsi_context * bld_base,
+   struct lp_build_emit_data * emit_data)
+{
+   struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
+   struct function_ctx *ctx = func_ctx(&bld->exec_mask);
+
+   if (!bld->cs_iface)
+      return;
+
+   if (bld->exec_mask.function_stack_size > 1 ||
+       ctx->cond_stack_size || ctx->loop_stack_size ||
+       ctx->switch_stack_size || bld->exec_mask.ret_in_main) {
+      debug_printf("%s: barrier in flow control not supported\n",
+                   __FUNCTION__);
+      return;
+   }
+
+   bld->cs_iface->barrier(bld->cs_iface, bld_base);
+
+   if (bld->indirect_files & (1 << TGSI_FILE_TEMPORARY)) {
+      bld->temps_array = bld->cs_iface->get_temps_array(bld->cs_iface,
+            bld_base, bld_base->info->file_max[TGSI_FILE_TEMPORARY] * 4 + 4);
+   }
+}
+
+
 static void emit_prologue(struct lp_build_tgsi_context * bld_base)
 {
    struct lp_build_tgsi_soa_context * bld = lp_soa_context(bld_base);
    struct gallivm_state * gallivm = bld_base->base.gallivm;
 
    if (bld->indirect_files & (1 << TGSI_FILE_TEMPORARY)) {
-      LLVMValueRef array_size =
-         lp_build_const_int32(gallivm,
-                         bld_base->info->file_max[TGSI_FILE_TEMPORARY] * 4 + 4);
-      bld->temps_array = lp_build_array_alloca(gallivm,
-                                              bld_base->base.vec_type, array_size,
-                                              "temp_array");
+      const unsigned num_temps =
+         bld_base->info->file_max[TGSI_FILE_TEMPORARY] * 4 + 4;
+      if (bld->cs_iface &&
+          bld_base->info->opcode_count[TGSI_OPCODE_BARRIER]) {
+         bld->temps_array = bld->cs_iface->get_temps_array(bld->cs_iface,
+                                                           bld_base,
+                                                           num_temps);
+      }
+      else {
+         LLVMValueRef array_size = lp_build_const_int32(gallivm, num_temps);
+         bld->temps_array = lp_build_array_alloca(gallivm,
+                                                 bld_base->base.vec_type,
+                                                 array_size,
+                                                 "temp_array");
+      }
    }
 
    if (bld->indirect_files & (1 << TGSI_FILE_OUTPUT)) {
@@ -3623,7 +3911,8 @@ lp_build_tgsi_soa(struct gallivm_state *gallivm,
                   LLVMValueRef (*outputs)[TGSI_NUM_CHANNELS],
                   struct lp_build_sampler_soa *sampler,
                   const struct tgsi_shader_info *info,
-                  const struct lp_build_tgsi_gs_iface *gs_iface)
+                  const struct lp_build_tgsi_gs_iface *gs_iface,
+                  const struct lp_build_tgsi_cs_iface *cs_iface)
 {
    struct lp_build_tgsi_soa_context bld;
 
@@ -3658,6 +3947,13 @@ lp_build_tgsi_soa(struct gallivm_state *gallivm,
    if (info->file_max[TGSI_FILE_TEMPORARY] >= LP_MAX_INLINED_TEMPS) {
       bld.indirect_files |= (1 << TGSI_FILE_TEMPORARY);
    }
+   /*
+    * Temporaries must be kept apart for every vector of threads across
+    * compute shader barriers.
+    */
+   if (cs_iface && info->opcode_count[TGSI_OPCODE_BARRIER]) {
+      bld.indirect_files |= (1 << TGSI_FILE_TEMPORARY);
+   }
    /*
     * For performance reason immediates are always backed in a static
     * array, but if their number is too great, we have to use just
@@ -3728,6 +4024,14 @@ lp_build_tgsi_soa(struct gallivm_state *gallivm,
    bld.bld_base.op_actions[TGSI_OPCODE_SAMPLE_L].emit = sample_l_emit;
    bld.bld_base.op_actions[TGSI_OPCODE_SVIEWINFO].emit = sviewinfo_emit;
 
+   if (cs_iface) {
+      bld.cs_iface = cs_iface;
+      bld.bld_base.pc = cs_iface->start_pc;
+      bld.bld_base.op_actions[TGSI_OPCODE_LOAD].emit = load_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_STORE].emit = store_emit;
+      bld.bld_base.op_actions[TGSI_OPCODE_BARRIER].emit = barrier_emit;
+   }
+
    if (gs_iface) {
       /* There's no specific value for this because it should always
        * be set, but apps using ext_geometry_shader4 quite often
@@ -34,12 +34,14 @@
  */
 
 #include <stdio.h>
+#include <inttypes.h>
 
 #include "hud/hud_context.h"
 #include "hud/hud_private.h"
 #include "hud/font.h"
 
 #include "cso_cache/cso_context.h"
+#include "os/os_time.h"
 #include "util/u_draw_quad.h"
 #include "util/u_inlines.h"
 #include "util/u_memory.h"
@@ -58,6 +60,11 @@ struct hud_context {
 
    struct list_head pane_list;
 
+   /* every sample is also written here, see the "csv=" option */
+   FILE *csv_file;
+   /* only sample, don't draw, see the "nodraw" option */
+   boolean nodraw;
+
    /* states */
    struct pipe_blend_state alpha_blend;
    struct pipe_depth_stencil_alpha_state dsa;
@@ -405,6 +412,15 @@ hud_draw(struct hud_context *hud, struct pipe_resource *tex)
    struct hud_pane *pane;
    struct hud_graph *gr;
 
+   if (hud->nodraw) {
+      LIST_FOR_EACH_ENTRY(pane, &hud->pane_list, head) {
+         LIST_FOR_EACH_ENTRY(gr, &pane->graph_list, head) {
+            gr->query_new_value(gr);
+         }
+      }
+      return;
+   }
+
    hud->fb_width = tex->width0;
    hud->fb_height = tex->height0;
    hud->constants.two_div_fb_width = 2.0f / hud->fb_width;
@@ -568,7 +584,8 @@ hud_pane_set_max_value(struct hud_pane *pane, uint64_t value)
 }
 
 static struct hud_pane *
-hud_pane_create(unsigned x1, unsigned y1, unsigned x2, unsigned y2,
+hud_pane_create(struct hud_context *hud,
+                unsigned x1, unsigned y1, unsigned x2, unsigned y2,
                 unsigned period, uint64_t max_value)
 {
    struct hud_pane *pane = CALLOC_STRUCT(hud_pane);
@@ -576,6 +593,7 @@ hud_pane_create(unsigned x1, unsigned y1, unsigned x2, unsigned y2,
    if (!pane)
       return NULL;
 
+   pane->hud = hud;
    pane->x1 = x1;
    pane->y1 = y1;
    pane->x2 = x2;
@@ -648,6 +666,11 @@ hud_graph_add_value(struct hud_graph *gr, uint64_t value)
    if (value > gr->pane->max_value) {
       hud_pane_set_max_value(gr->pane, value);
    }
+
+   if (gr->pane->hud->csv_file) {
+      fprintf(gr->pane->hud->csv_file, "%"PRIi64",%s,%"PRIu64"\n",
+              os_time_get(), gr->name, value);
+   }
 }
 
 static void
@@ -699,6 +722,47 @@ has_pipeline_stats_query(struct pipe_screen *screen)
    return screen->get_param(screen, PIPE_CAP_QUERY_PIPELINE_STATISTICS) != 0;
 }
 
+/**
+ * Parse the options which may precede the graph names, each followed by
+ * ',' or ';'.
+ * Return the number of read characters.
+ */
+static int
+parse_options(struct hud_context *hud, const char *env)
+{
+   const char *s = env;
+
+   while (1) {
+      unsigned len = strcspn(s, ",;");
+
+      if (strncmp(s, "csv=", 4) == 0 && len > 4) {
+         char filename[256];
+
+         util_snprintf(filename, sizeof(filename), "%.*s",
+                       (int) len - 4, s + 4);
+         if (hud->csv_file && hud->csv_file != stdout)
+            fclose(hud->csv_file);
+         hud->csv_file = strcmp(filename, "-") == 0 ? stdout :
+                                                      fopen(filename, "w");
+         if (hud->csv_file)
+            fputs("time_us,name,value\n", hud->csv_file);
+         else
+            fprintf(stderr, "gallium_hud: can't open '%s'\n", filename);
+      }
+      else if (len == 6 && strncmp(s, "nodraw", 6) == 0) {
+         hud->nodraw = TRUE;
+      }
+      else
+         break;
+
+      s += len;
+      if (*s)
+         s++;
+   }
+
+   return s - env;
+}
+
 static void
 hud_parse_env_var(struct hud_context *hud, const char *env)
 {
@@ -723,11 +787,13 @@ hud_parse_env_var(struct hud_context *hud, const char *env)
       }
    }
 
+   env += parse_options(hud, env);
+
    while ((num = parse_string(env, name)) != 0) {
       env += num;
 
       if (!pane) {
-         pane = hud_pane_create(x, y, x + width, y + height, period, 10);
+         pane = hud_pane_create(hud, x, y, x + width, y + height, period, 10);
          if (!pane)
             return;
       }
@@ -743,6 +809,18 @@ hud_parse_env_var(struct hud_context *hud, const char *env)
       else if (sscanf(name, "cpu%u%s", &i, s) == 1) {
          hud_cpu_graph_install(pane, i);
       }
+      else if (strcmp(name, "queue-depth") == 0) {
+         hud_queue_graph_install(pane, NULL, FALSE);
+      }
+      else if (strncmp(name, "queue-depth-", 12) == 0) {
+         hud_queue_graph_install(pane, name + 12, FALSE);
+      }
+      else if (strcmp(name, "queue-wait") == 0) {
+         hud_queue_graph_install(pane, NULL, TRUE);
+      }
+      else if (strncmp(name, "queue-wait-", 11) == 0) {
+         hud_queue_graph_install(pane, name + 11, TRUE);
+      }
       else if (strcmp(name, "samples-passed") == 0 &&
                has_occlusion_query(hud->pipe->screen)) {
          hud_pipe_query_install(pane, hud->pipe, "samples-passed",
@@ -862,7 +940,7 @@ print_help(struct pipe_screen *screen)
 {
    int i, num_queries, num_cpus = hud_get_num_cpus();
 
-   puts("Syntax: GALLIUM_HUD=name1[+name2][...][:value1][,nameI...][;nameJ...]");
+   puts("Syntax: GALLIUM_HUD=[option,...]name1[+name2][...][:value1][,nameI...][;nameJ...]");
    puts("");
    puts("  Names are identifiers of data sources which will be drawn as graphs");
    puts("  in panes. Multiple graphs can be drawn in the same pane.");
@@ -876,6 +954,13 @@ print_help(struct pipe_screen *screen)
    puts("");
    puts("  Example: GALLIUM_HUD=\"cpu,fps;primitives-generated\"");
    puts("");
+   puts("  Options:");
+   puts("    csv=<file>  also write each sample of every graph to <file>, or");
+   puts("                stdout for '-', as lines of time_us,name,value");
+   puts("    nodraw      only take the samples, don't draw anything");
+   puts("");
+   puts("  Example: GALLIUM_HUD=\"csv=/tmp/hud.csv,nodraw,fps+cpu\"");
+   puts("");
    puts("  Available names:");
    puts("    fps");
    puts("    cpu");
@@ -883,6 +968,9 @@ print_help(struct pipe_screen *screen)
    for (i = 0; i < num_cpus; i++)
       printf("    cpu%i\n", i);
 
+   puts("    queue-depth, queue-depth-<name>");
+   puts("    queue-wait, queue-wait-<name> (average usecs a job waited)");
+
    if (has_occlusion_query(screen))
       puts("    samples-passed");
    if (has_streamout(screen))
@@ -1094,5 +1182,7 @@ hud_destroy(struct hud_context *hud)
    pipe_sampler_view_reference(&hud->font_sampler_view, NULL);
    pipe_resource_reference(&hud->font.texture, NULL);
    u_upload_destroy(hud->uploader);
+   if (hud->csv_file && hud->csv_file != stdout)
+      fclose(hud->csv_file);
    FREE(hud);
 }
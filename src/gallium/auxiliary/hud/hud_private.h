@@ -31,6 +31,8 @@
 #include "pipe/p_context.h"
 #include "util/u_double_list.h"
 
+struct hud_context;
+
 struct hud_graph {
    /* initialized by common code */
    struct list_head head;
@@ -52,6 +54,7 @@ struct hud_graph {
 
 struct hud_pane {
    struct list_head head;
+   struct hud_context *hud;
    unsigned x1, y1, x2, y2;
    unsigned inner_x1;
    unsigned inner_y1;
@@ -82,6 +85,8 @@ int hud_get_num_cpus(void);
 
 void hud_fps_graph_install(struct hud_pane *pane);
 void hud_cpu_graph_install(struct hud_pane *pane, unsigned cpu_index);
+void hud_queue_graph_install(struct hud_pane *pane, const char *queue_name,
+                             boolean wait_time);
 void hud_pipe_query_install(struct hud_pane *pane, struct pipe_context *pipe,
                             const char *name, unsigned query_type,
                             unsigned result_index,
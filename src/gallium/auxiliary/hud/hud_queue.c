@@ -0,0 +1,123 @@
+/**************************************************************************
+ *
+ * Copyright 2014 The Mesa Authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/* This file contains code for reading util_queue statistics for displaying
+ * on the HUD.
+ */
+
+#include "hud/hud_private.h"
+#include "os/os_time.h"
+#include "util/u_memory.h"
+#include "util/u_queue.h"
+#include "util/u_string.h"
+
+struct queue_info {
+   char queue_name[64]; /* empty for all queues */
+   boolean wait_time;
+   uint64_t last_started, last_wait_time, last_time;
+};
+
+static void
+query_queue_stats(struct hud_graph *gr)
+{
+   struct queue_info *info = gr->query_data;
+   struct util_queue_stats stats;
+   uint64_t now = os_time_get();
+
+   if (info->last_time && info->last_time + gr->pane->period > now)
+      return;
+
+   util_queue_get_stats(info->queue_name[0] ? info->queue_name : NULL,
+                        &stats);
+
+   if (info->last_time) {
+      if (info->wait_time) {
+         /* average wait of the jobs started in the last period */
+         uint64_t started = stats.num_started - info->last_started;
+
+         hud_graph_add_value(gr, started ?
+                             (stats.wait_time - info->last_wait_time) /
+                             started : 0);
+      }
+      else {
+         hud_graph_add_value(gr, stats.num_queued);
+      }
+   }
+
+   info->last_started = stats.num_started;
+   info->last_wait_time = stats.wait_time;
+   info->last_time = now;
+}
+
+static void
+free_query_data(void *p)
+{
+   FREE(p);
+}
+
+/**
+ * Show the number of queued jobs, or the average time in usecs jobs waited
+ * for a thread if \p wait_time is set, of the util_queues called
+ * \p queue_name or of all queues if it's NULL.
+ */
+void
+hud_queue_graph_install(struct hud_pane *pane, const char *queue_name,
+                        boolean wait_time)
+{
+   struct hud_graph *gr;
+   struct queue_info *info;
+
+   gr = CALLOC_STRUCT(hud_graph);
+   if (!gr)
+      return;
+
+   if (queue_name)
+      util_snprintf(gr->name, sizeof(gr->name), "%s-%s",
+                    wait_time ? "queue-wait" : "queue-depth", queue_name);
+   else
+      strcpy(gr->name, wait_time ? "queue-wait" : "queue-depth");
+
+   gr->query_data = CALLOC_STRUCT(queue_info);
+   if (!gr->query_data) {
+      FREE(gr);
+      return;
+   }
+
+   gr->query_new_value = query_queue_stats;
+
+   /* Don't use free() as our callback as that messes up Gallium's
+    * memory debugger.  Use simple free_query_data() wrapper.
+    */
+   gr->free_query_data = free_query_data;
+
+   info = gr->query_data;
+   info->wait_time = wait_time;
+   if (queue_name)
+      strncpy(info->queue_name, queue_name, sizeof(info->queue_name) - 1);
+
+   hud_pane_add_graph(pane, gr);
+}
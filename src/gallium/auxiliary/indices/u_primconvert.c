@@ -49,13 +49,38 @@
 #include "indices/u_indices.h"
 #include "indices/u_primconvert.h"
 
+/** Number of generated index buffers kept around for non-indexed draws */
+#define PRIMCONVERT_CACHE_SIZE 8
+
+/**
+ * The indices generated for a non-indexed draw only depend on the
+ * primitive type, the vertex range and the provoking vertex, so the index
+ * buffers can be reused by later draws with the same parameters.
+ */
+struct primconvert_cache_entry
+{
+   /* key */
+   unsigned mode;
+   unsigned start;
+   unsigned count;
+   unsigned api_pv;
+
+   /* result */
+   unsigned out_mode;
+   unsigned out_index_size;
+   unsigned out_count;
+   struct pipe_resource *buffer;
+};
+
 struct primconvert_context
 {
    struct pipe_context *pipe;
    struct pipe_index_buffer saved_ib;
    uint32_t primtypes_mask;
    unsigned api_pv;
-   // TODO we could cache/recycle the indexbuf created to translate prims..
+
+   struct primconvert_cache_entry cache[PRIMCONVERT_CACHE_SIZE];
+   unsigned cache_next;  /**< entry to be replaced next */
 };
 
 
@@ -73,6 +98,11 @@ util_primconvert_create(struct pipe_context *pipe, uint32_t primtypes_mask)
 void
 util_primconvert_destroy(struct primconvert_context *pc)
 {
+   unsigned i;
+
+   for (i = 0; i < PRIMCONVERT_CACHE_SIZE; i++)
+      pipe_resource_reference(&pc->cache[i].buffer, NULL);
+
    util_primconvert_save_index_buffer(pc, NULL);
    FREE(pc);
 }
@@ -105,6 +135,75 @@ util_primconvert_save_rasterizer_state(struct primconvert_context *pc,
                  && !rast->flatshade_first) ? PV_LAST : PV_FIRST;
 }
 
+/**
+ * Get an index buffer with the indices for a non-indexed draw, either
+ * from the cache or by generating them.
+ * \return a new reference to the buffer, or NULL if out of memory
+ */
+static struct pipe_resource *
+primconvert_generate(struct primconvert_context *pc,
+                     const struct pipe_draw_info *info,
+                     struct pipe_draw_info *new_info,
+                     struct pipe_index_buffer *new_ib)
+{
+   struct primconvert_cache_entry *entry;
+   struct pipe_resource *buffer = NULL;
+   struct pipe_transfer *transfer;
+   u_generate_func gen_func;
+   unsigned i;
+   void *dst;
+
+   for (i = 0; i < PRIMCONVERT_CACHE_SIZE; i++) {
+      entry = &pc->cache[i];
+      if (entry->buffer &&
+          entry->mode == info->mode &&
+          entry->start == info->start &&
+          entry->count == info->count &&
+          entry->api_pv == pc->api_pv) {
+         new_info->mode = entry->out_mode;
+         new_info->count = entry->out_count;
+         new_ib->index_size = entry->out_index_size;
+         pipe_resource_reference(&buffer, entry->buffer);
+         return buffer;
+      }
+   }
+
+   u_index_generator(pc->primtypes_mask,
+                     info->mode, info->start, info->count,
+                     pc->api_pv, pc->api_pv,
+                     &new_info->mode, &new_ib->index_size, &new_info->count,
+                     &gen_func);
+
+   buffer = pipe_buffer_create(pc->pipe->screen,
+                               PIPE_BIND_INDEX_BUFFER,
+                               PIPE_USAGE_IMMUTABLE,
+                               new_ib->index_size * new_info->count);
+   if (!buffer)
+      return NULL;
+
+   dst = pipe_buffer_map(pc->pipe, buffer, PIPE_TRANSFER_WRITE, &transfer);
+   if (!dst) {
+      pipe_resource_reference(&buffer, NULL);
+      return NULL;
+   }
+   gen_func(info->start, new_info->count, dst);
+   pipe_buffer_unmap(pc->pipe, transfer);
+
+   entry = &pc->cache[pc->cache_next];
+   pc->cache_next = (pc->cache_next + 1) % PRIMCONVERT_CACHE_SIZE;
+
+   entry->mode = info->mode;
+   entry->start = info->start;
+   entry->count = info->count;
+   entry->api_pv = pc->api_pv;
+   entry->out_mode = new_info->mode;
+   entry->out_index_size = new_ib->index_size;
+   entry->out_count = new_info->count;
+   pipe_resource_reference(&entry->buffer, buffer);
+
+   return buffer;
+}
+
 void
 util_primconvert_draw_vbo(struct primconvert_context *pc,
                           const struct pipe_draw_info *info)
@@ -114,7 +213,6 @@ util_primconvert_draw_vbo(struct primconvert_context *pc,
    struct pipe_draw_info new_info;
    struct pipe_transfer *src_transfer = NULL, *dst_transfer = NULL;
    u_translate_func trans_func;
-   u_generate_func gen_func;
    const void *src;
    void *dst;
 
@@ -133,41 +231,33 @@ util_primconvert_draw_vbo(struct primconvert_context *pc,
          src = pipe_buffer_map(pc->pipe, ib->buffer,
                                PIPE_TRANSFER_READ, &src_transfer);
       }
-   }
-   else {
-      u_index_generator(pc->primtypes_mask,
-                        info->mode, info->start, info->count,
-                        pc->api_pv, pc->api_pv,
-                        &new_info.mode, &new_ib.index_size, &new_info.count,
-                        &gen_func);
-   }
 
+      new_ib.buffer = pipe_buffer_create(pc->pipe->screen,
+                                         PIPE_BIND_INDEX_BUFFER,
+                                         PIPE_USAGE_IMMUTABLE,
+                                         new_ib.index_size * new_info.count);
+      dst = pipe_buffer_map(pc->pipe, new_ib.buffer, PIPE_TRANSFER_WRITE,
+                            &dst_transfer);
 
-   new_ib.buffer = pipe_buffer_create(pc->pipe->screen,
-                                      PIPE_BIND_INDEX_BUFFER,
-                                      PIPE_USAGE_IMMUTABLE,
-                                      new_ib.index_size * new_info.count);
-   dst =
-      pipe_buffer_map(pc->pipe, new_ib.buffer, PIPE_TRANSFER_WRITE,
-                      &dst_transfer);
-
-   if (info->indexed) {
       new_info.min_index = 0;
       new_info.max_index = ~0;
       trans_func(src, info->start, new_info.count, dst);
+
+      if (src_transfer)
+         pipe_buffer_unmap(pc->pipe, src_transfer);
+
+      if (dst_transfer)
+         pipe_buffer_unmap(pc->pipe, dst_transfer);
    }
    else {
+      new_ib.buffer = primconvert_generate(pc, info, &new_info, &new_ib);
+      if (!new_ib.buffer)
+         return;
+
       new_info.min_index = info->start;
       new_info.max_index = info->start + new_info.count;
-      gen_func(info->start, new_info.count, dst);
    }
 
-   if (src_transfer)
-      pipe_buffer_unmap(pc->pipe, src_transfer);
-
-   if (dst_transfer)
-      pipe_buffer_unmap(pc->pipe, dst_transfer);
-
    /* bind new index buffer: */
    pc->pipe->set_index_buffer(pc->pipe, &new_ib);
 
@@ -85,6 +85,34 @@ static INLINE int pipe_thread_destroy( pipe_thread thread )
    return thrd_detach( thread );
 }
 
+/**
+ * Restrict the thread to run on the given CPU only.
+ * Returns FALSE if that's not supported or failed, in which case the
+ * thread keeps running wherever the OS schedules it.
+ */
+static INLINE boolean pipe_thread_set_affinity( pipe_thread thread, unsigned cpu )
+{
+#if defined(PIPE_OS_LINUX) && defined(HAVE_PTHREAD) && !defined(PIPE_OS_ANDROID)
+   cpu_set_t set;
+
+   if (cpu >= CPU_SETSIZE)
+      return FALSE;
+
+   CPU_ZERO(&set);
+   CPU_SET(cpu, &set);
+   return pthread_setaffinity_np(thread, sizeof set, &set) == 0;
+#elif defined(PIPE_OS_WINDOWS)
+   if (cpu >= sizeof(DWORD_PTR) * 8)
+      return FALSE;
+
+   return SetThreadAffinityMask(thread, (DWORD_PTR)1 << cpu) != 0;
+#else
+   (void) thread;
+   (void) cpu;
+   return FALSE;
+#endif
+}
+
 
 /* pipe_mutex
  */
@@ -295,6 +323,15 @@ pipe_tsd_set(pipe_tsd *tsd, void *value)
    }
 }
 
+static INLINE void
+pipe_tsd_destroy(pipe_tsd *tsd)
+{
+   if (tsd->initMagic == (int) PIPE_TSD_INIT_MAGIC) {
+      tss_delete(tsd->key);
+      tsd->initMagic = 0;
+   }
+}
+
 
 
 #endif /* OS_THREAD_H_ */
@@ -27,6 +27,9 @@
 
 #include "pipe_loader_priv.h"
 
+#include "pipe/p_screen.h"
+#include "os/os_thread.h"
+#include "util/u_double_list.h"
 #include "util/u_inlines.h"
 #include "util/u_memory.h"
 #include "util/u_string.h"
@@ -34,6 +37,26 @@
 
 #define MODULE_PREFIX "pipe_"
 
+/**
+ * A screen handed out to one or more devices.
+ */
+struct shared_screen {
+   struct list_head head;
+   const struct pipe_loader_ops *ops;
+   char driver_name[32];
+   intptr_t key;
+
+   struct pipe_screen *screen;
+   void (*destroy)(struct pipe_screen *screen); /**< the driver's */
+   unsigned refcount;
+
+   /** Keeps the driver loaded while devices come and go */
+   struct util_dl_library *lib;
+};
+
+static struct list_head shared_screens = { &shared_screens, &shared_screens };
+pipe_static_mutex(shared_screens_mutex);
+
 static int (*backends[])(struct pipe_loader_device **, int) = {
 #ifdef HAVE_PIPE_LOADER_DRM
    &pipe_loader_drm_probe,
@@ -61,11 +84,80 @@ pipe_loader_release(struct pipe_loader_device **devs, int ndev)
       devs[i]->ops->release(&devs[i]);
 }
 
+/**
+ * pipe_screen::destroy of shared screens, which destroys the screen when
+ * the last reference goes away.
+ */
+static void
+shared_screen_destroy(struct pipe_screen *screen)
+{
+   struct shared_screen *shared;
+
+   pipe_mutex_lock(shared_screens_mutex);
+
+   LIST_FOR_EACH_ENTRY(shared, &shared_screens, head) {
+      if (shared->screen == screen) {
+         if (--shared->refcount == 0) {
+            LIST_DEL(&shared->head);
+            pipe_mutex_unlock(shared_screens_mutex);
+
+            screen->destroy = shared->destroy;
+            screen->destroy(screen);
+            if (shared->lib)
+               util_dl_close(shared->lib);
+            FREE(shared);
+            return;
+         }
+         break;
+      }
+   }
+
+   pipe_mutex_unlock(shared_screens_mutex);
+}
+
 struct pipe_screen *
 pipe_loader_create_screen(struct pipe_loader_device *dev,
                           const char *library_paths)
 {
-   return dev->ops->create_screen(dev, library_paths);
+   struct shared_screen *shared;
+   struct pipe_screen *screen;
+   intptr_t key;
+
+   if (!dev->ops->screen_key)
+      return dev->ops->create_screen(dev, library_paths);
+
+   key = dev->ops->screen_key(dev);
+
+   pipe_mutex_lock(shared_screens_mutex);
+
+   LIST_FOR_EACH_ENTRY(shared, &shared_screens, head) {
+      if (shared->ops == dev->ops && shared->key == key &&
+          strcmp(shared->driver_name, dev->driver_name) == 0) {
+         shared->refcount++;
+         pipe_mutex_unlock(shared_screens_mutex);
+         return shared->screen;
+      }
+   }
+
+   screen = dev->ops->create_screen(dev, library_paths);
+   if (screen) {
+      shared = CALLOC_STRUCT(shared_screen);
+      if (shared) {
+         shared->ops = dev->ops;
+         util_snprintf(shared->driver_name, sizeof(shared->driver_name), "%s",
+                       dev->driver_name);
+         shared->key = key;
+         shared->lib = pipe_loader_find_module(dev, library_paths);
+         shared->screen = screen;
+         shared->destroy = screen->destroy;
+         shared->refcount = 1;
+         screen->destroy = shared_screen_destroy;
+         LIST_ADDTAIL(&shared->head, &shared_screens);
+      }
+   }
+
+   pipe_mutex_unlock(shared_screens_mutex);
+   return screen;
 }
 
 struct util_dl_library *
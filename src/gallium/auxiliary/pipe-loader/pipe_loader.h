@@ -79,6 +79,12 @@ pipe_loader_probe(struct pipe_loader_device **devs, int ndev);
 /**
  * Create a pipe_screen for the specified device.
  *
+ * Devices of the same driver on the same DRM fd or software winsys get
+ * the same reference counted screen, so state trackers in one process
+ * share its shader, buffer caches and winsys threads; the screen is
+ * destroyed when pipe_screen::destroy has been called for every
+ * reference.
+ *
  * \param dev Device the screen will be created for.
  * \param library_paths Colon-separated list of filesystem paths that
  *                      will be used to look for the pipe driver
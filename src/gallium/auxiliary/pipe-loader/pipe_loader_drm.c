@@ -279,7 +279,14 @@ pipe_loader_drm_create_screen(struct pipe_loader_device *dev,
    return dd->create_screen(ddev->fd);
 }
 
+static intptr_t
+pipe_loader_drm_screen_key(struct pipe_loader_device *dev)
+{
+   return pipe_loader_drm_device(dev)->fd;
+}
+
 static struct pipe_loader_ops pipe_loader_drm_ops = {
    .create_screen = pipe_loader_drm_create_screen,
+   .screen_key = pipe_loader_drm_screen_key,
    .release = pipe_loader_drm_release
 };
@@ -34,6 +34,12 @@ struct pipe_loader_ops {
    struct pipe_screen *(*create_screen)(struct pipe_loader_device *dev,
                                         const char *library_paths);
 
+   /**
+    * Identify what a screen of the device is created on (DRM fd, software
+    * winsys), devices with the same key and driver share their screen.
+    */
+   intptr_t (*screen_key)(struct pipe_loader_device *dev);
+
    void (*release)(struct pipe_loader_device **dev);
 };
 
@@ -104,7 +104,14 @@ pipe_loader_sw_create_screen(struct pipe_loader_device *dev,
    return init(sdev->ws);
 }
 
+static intptr_t
+pipe_loader_sw_screen_key(struct pipe_loader_device *dev)
+{
+   return (intptr_t) pipe_loader_sw_device(dev)->ws;
+}
+
 static struct pipe_loader_ops pipe_loader_sw_ops = {
    .create_screen = pipe_loader_sw_create_screen,
+   .screen_key = pipe_loader_sw_screen_key,
    .release = pipe_loader_sw_release
 };
@@ -158,10 +158,14 @@ pb_slab_range_manager_create(struct pb_manager *provider,
  * Time-based buffer cache.
  *
  * This manager keeps a cache of destroyed buffers during a time interval. 
+ * The cached buffers are looked up by size class.  The least recently
+ * cached ones are dropped when their total size would exceed
+ * maximum_cache_size, unless that is zero.
  */
 struct pb_manager *
 pb_cache_manager_create(struct pb_manager *provider, 
-                     	unsigned usecs); 
+                     	unsigned usecs,
+                        uint64_t maximum_cache_size);
 
 
 struct pb_fence_ops;
@@ -40,6 +40,7 @@
 #include "util/u_memory.h"
 #include "util/u_double_list.h"
 #include "util/u_time.h"
+#include "util/u_math.h"
 
 #include "pb_buffer.h"
 #include "pb_bufmgr.h"
@@ -51,6 +52,13 @@
 #define SUPER(__derived) (&(__derived)->base)
 
 
+/**
+ * Number of size classes.  Class n holds the buffers whose size is in
+ * [2^n, 2^(n+1)), the last one everything bigger.
+ */
+#define PB_CACHE_NUM_BUCKETS 32
+
+
 struct pb_cache_manager;
 
 
@@ -67,7 +75,11 @@ struct pb_cache_buffer
    /** Caching time interval */
    int64_t start, end;
 
+   /** In the manager's list of all cached buffers, oldest first */
    struct list_head head;
+
+   /** In the list of the buffer's size class, oldest first */
+   struct list_head bucket_head;
 };
 
 
@@ -82,9 +94,22 @@ struct pb_cache_manager
    
    struct list_head delayed;
    pb_size numDelayed;
+
+   struct list_head buckets[PB_CACHE_NUM_BUCKETS];
+
+   /** Total size of the cached buffers and its limit, 0 for none */
+   uint64_t cache_size;
+   uint64_t max_cache_size;
+
+   /** Statistics */
+   unsigned num_hits;
+   unsigned num_misses;
 };
 
 
+DEBUG_GET_ONCE_BOOL_OPTION(cache_stats, "PB_CACHE_STATS", FALSE)
+
+
 static INLINE struct pb_cache_buffer *
 pb_cache_buffer(struct pb_buffer *buf)
 {
@@ -101,17 +126,37 @@ pb_cache_manager(struct pb_manager *mgr)
 }
 
 
+static INLINE unsigned
+pb_cache_bucket(pb_size size)
+{
+   return size ? MIN2(util_logbase2(size), PB_CACHE_NUM_BUCKETS - 1) : 0;
+}
+
+
 /**
- * Actually destroy the buffer.
+ * Take the buffer off the cache lists.
  */
 static INLINE void
-_pb_cache_buffer_destroy(struct pb_cache_buffer *buf)
+_pb_cache_buffer_remove(struct pb_cache_buffer *buf)
 {
    struct pb_cache_manager *mgr = buf->mgr;
 
    LIST_DEL(&buf->head);
+   LIST_DEL(&buf->bucket_head);
    assert(mgr->numDelayed);
    --mgr->numDelayed;
+   assert(mgr->cache_size >= buf->base.size);
+   mgr->cache_size -= buf->base.size;
+}
+
+
+/**
+ * Actually destroy the buffer.
+ */
+static INLINE void
+_pb_cache_buffer_destroy(struct pb_cache_buffer *buf)
+{
+   _pb_cache_buffer_remove(buf);
    assert(!pipe_is_referenced(&buf->base.reference));
    pb_reference(&buf->buffer, NULL);
    FREE(buf);
@@ -156,11 +201,30 @@ pb_cache_buffer_destroy(struct pb_buffer *_buf)
    assert(!pipe_is_referenced(&buf->base.reference));
    
    _pb_cache_buffer_list_check_free(mgr);
+
+   if (mgr->max_cache_size) {
+      if (buf->base.size > mgr->max_cache_size) {
+         pipe_mutex_unlock(mgr->mutex);
+         pb_reference(&buf->buffer, NULL);
+         FREE(buf);
+         return;
+      }
+
+      /* Make room by dropping the least recently cached buffers */
+      while (mgr->cache_size + buf->base.size > mgr->max_cache_size) {
+         assert(!LIST_IS_EMPTY(&mgr->delayed));
+         _pb_cache_buffer_destroy(LIST_ENTRY(struct pb_cache_buffer,
+                                             mgr->delayed.next, head));
+      }
+   }
    
    buf->start = os_time_get();
    buf->end = buf->start + mgr->usecs;
    LIST_ADDTAIL(&buf->head, &mgr->delayed);
+   LIST_ADDTAIL(&buf->bucket_head,
+                &mgr->buckets[pb_cache_bucket(buf->base.size)]);
    ++mgr->numDelayed;
+   mgr->cache_size += buf->base.size;
    pipe_mutex_unlock(mgr->mutex);
 }
 
@@ -256,6 +320,33 @@ pb_cache_is_buffer_compat(struct pb_cache_buffer *buf,
 }
 
 
+/**
+ * Look for a compatible idle buffer in the size class.
+ */
+static struct pb_cache_buffer *
+pb_cache_find_buffer(struct pb_cache_manager *mgr, unsigned bucket,
+                     pb_size size, const struct pb_desc *desc)
+{
+   struct list_head *curr;
+
+   /* Oldest first, as those are the most likely to be idle */
+   for (curr = mgr->buckets[bucket].next; curr != &mgr->buckets[bucket];
+        curr = curr->next) {
+      struct pb_cache_buffer *buf =
+         LIST_ENTRY(struct pb_cache_buffer, curr, bucket_head);
+      int ret = pb_cache_is_buffer_compat(buf, size, desc);
+
+      if (ret > 0)
+         return buf;
+      /* The more recent buffers are busy too */
+      if (ret == -1)
+         break;
+   }
+
+   return NULL;
+}
+
+
 static struct pb_buffer *
 pb_cache_manager_create_buffer(struct pb_manager *_mgr, 
                                pb_size size,
@@ -263,60 +354,27 @@ pb_cache_manager_create_buffer(struct pb_manager *_mgr,
 {
    struct pb_cache_manager *mgr = pb_cache_manager(_mgr);
    struct pb_cache_buffer *buf;
-   struct pb_cache_buffer *curr_buf;
-   struct list_head *curr, *next;
-   int64_t now;
-   int ret = 0;
+   unsigned bucket = pb_cache_bucket(size);
 
    pipe_mutex_lock(mgr->mutex);
 
-   buf = NULL;
-   curr = mgr->delayed.next;
-   next = curr->next;
-   
-   /* search in the expired buffers, freeing them in the process */
-   now = os_time_get();
-   while(curr != &mgr->delayed) {
-      curr_buf = LIST_ENTRY(struct pb_cache_buffer, curr, head);
-      if(!buf && (ret = pb_cache_is_buffer_compat(curr_buf, size, desc) > 0))
-         buf = curr_buf;
-      else if(os_time_timeout(curr_buf->start, curr_buf->end, now))
-         _pb_cache_buffer_destroy(curr_buf);
-      else
-         /* This buffer (and all hereafter) are still hot in cache */
-         break;
-      if (ret == -1)
-         break;
-      curr = next; 
-      next = curr->next;
-   }
+   _pb_cache_buffer_list_check_free(mgr);
+
+   /* The compatible sizes, [size, 2 * size), span two size classes */
+   buf = pb_cache_find_buffer(mgr, bucket, size, desc);
+   if (!buf && bucket + 1 < PB_CACHE_NUM_BUCKETS)
+      buf = pb_cache_find_buffer(mgr, bucket + 1, size, desc);
 
-   /* keep searching in the hot buffers */
-   if(!buf && ret != -1) {
-      while(curr != &mgr->delayed) {
-         curr_buf = LIST_ENTRY(struct pb_cache_buffer, curr, head);
-         ret = pb_cache_is_buffer_compat(curr_buf, size, desc);
-         if (ret > 0) {
-            buf = curr_buf;
-            break;
-         }
-         if (ret == -1)
-            break;
-         /* no need to check the timeout here */
-         curr = next;
-         next = curr->next;
-      }
-   }
-   
    if(buf) {
-      LIST_DEL(&buf->head);
-      --mgr->numDelayed;
+      _pb_cache_buffer_remove(buf);
+      ++mgr->num_hits;
       pipe_mutex_unlock(mgr->mutex);
       /* Increase refcount */
       pipe_reference_init(&buf->base.reference, 1);
       return &buf->base;
    }
-   
+
+   ++mgr->num_misses;
    pipe_mutex_unlock(mgr->mutex);
 
    buf = CALLOC_STRUCT(pb_cache_buffer);
@@ -378,18 +436,29 @@ pb_cache_manager_flush(struct pb_manager *_mgr)
 
 
 static void
-pb_cache_manager_destroy(struct pb_manager *mgr)
+pb_cache_manager_destroy(struct pb_manager *_mgr)
 {
-   pb_cache_manager_flush(mgr);
+   struct pb_cache_manager *mgr = pb_cache_manager(_mgr);
+
+   if (debug_get_option_cache_stats()) {
+      unsigned total = mgr->num_hits + mgr->num_misses;
+      debug_printf("pb_cache: %u hits, %u misses (%u%% hit rate)\n",
+                   mgr->num_hits, mgr->num_misses,
+                   total ? mgr->num_hits * 100 / total : 0);
+   }
+
+   pb_cache_manager_flush(_mgr);
    FREE(mgr);
 }
 
 
 struct pb_manager *
 pb_cache_manager_create(struct pb_manager *provider, 
-                     	unsigned usecs) 
+                     	unsigned usecs,
+                        uint64_t maximum_cache_size)
 {
    struct pb_cache_manager *mgr;
+   unsigned i;
 
    if(!provider)
       return NULL;
@@ -403,8 +472,11 @@ pb_cache_manager_create(struct pb_manager *provider,
    mgr->base.flush = pb_cache_manager_flush;
    mgr->provider = provider;
    mgr->usecs = usecs;
+   mgr->max_cache_size = maximum_cache_size;
    LIST_INITHEAD(&mgr->delayed);
    mgr->numDelayed = 0;
+   for (i = 0; i < PB_CACHE_NUM_BUCKETS; i++)
+      LIST_INITHEAD(&mgr->buckets[i]);
    pipe_mutex_init(mgr->mutex);
       
    return &mgr->base;
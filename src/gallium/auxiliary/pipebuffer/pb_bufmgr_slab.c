@@ -51,6 +51,10 @@
 struct pb_slab;
 
 
+/** Number of free buffers each thread keeps of a slab manager */
+#define PB_SLAB_THREAD_CACHE_SIZE 16
+
+
 /**
  * Buffer in a slab.
  * 
@@ -95,6 +99,22 @@ struct pb_slab
 };
 
 
+/**
+ * A thread's cache of free buffers.
+ *
+ * Buffers are allocated from and freed into it without taking the manager
+ * mutex, which is only needed to move half of the cache at once from or to
+ * the slabs.  The cached buffers count as allocated for the slabs.
+ */
+struct pb_slab_thread_cache
+{
+   struct pb_slab_thread_cache *next;
+
+   unsigned numBuffers;
+   struct pb_slab_buffer *buffers[PB_SLAB_THREAD_CACHE_SIZE];
+};
+
+
 /**
  * It adds/removes slabs as needed in order to meet the allocation/destruction 
  * of individual buffers.
@@ -129,6 +149,10 @@ struct pb_slab_manager
    struct list_head slabs;
    
    pipe_mutex mutex;
+
+   /** Per-thread caches of free buffers, all of them listed in caches */
+   pipe_tsd cache_tsd;
+   struct pb_slab_thread_cache *caches;
 };
 
 
@@ -190,21 +214,15 @@ pb_slab_range_manager(struct pb_manager *mgr)
 /**
  * Delete a buffer from the slab delayed list and put
  * it on the slab FREE list.
+ * Must be called with the manager mutex held.
  */
 static void
-pb_slab_buffer_destroy(struct pb_buffer *_buf)
+pb_slab_buffer_free_locked(struct pb_slab_buffer *buf)
 {
-   struct pb_slab_buffer *buf = pb_slab_buffer(_buf);
    struct pb_slab *slab = buf->slab;
    struct pb_slab_manager *mgr = slab->mgr;
    struct list_head *list = &buf->head;
 
-   pipe_mutex_lock(mgr->mutex);
-   
-   assert(!pipe_is_referenced(&buf->base.reference));
-   
-   buf->mapCount = 0;
-
    LIST_DEL(list);
    LIST_ADDTAIL(list, &slab->freeBuffers);
    slab->numFree++;
@@ -220,8 +238,61 @@ pb_slab_buffer_destroy(struct pb_buffer *_buf)
       FREE(slab->buffers);
       FREE(slab);
    }
+}
+
+
+/**
+ * Get the calling thread's buffer cache, creating it if needed.
+ */
+static struct pb_slab_thread_cache *
+pb_slab_get_thread_cache(struct pb_slab_manager *mgr)
+{
+   struct pb_slab_thread_cache *cache = pipe_tsd_get(&mgr->cache_tsd);
+
+   if (!cache) {
+      cache = CALLOC_STRUCT(pb_slab_thread_cache);
+      if (!cache)
+         return NULL;
+
+      pipe_mutex_lock(mgr->mutex);
+      cache->next = mgr->caches;
+      mgr->caches = cache;
+      pipe_mutex_unlock(mgr->mutex);
+
+      pipe_tsd_set(&mgr->cache_tsd, cache);
+   }
 
-   pipe_mutex_unlock(mgr->mutex);
+   return cache;
+}
+
+
+static void
+pb_slab_buffer_destroy(struct pb_buffer *_buf)
+{
+   struct pb_slab_buffer *buf = pb_slab_buffer(_buf);
+   struct pb_slab_manager *mgr = buf->slab->mgr;
+   struct pb_slab_thread_cache *cache = pb_slab_get_thread_cache(mgr);
+
+   assert(!pipe_is_referenced(&buf->base.reference));
+   
+   buf->mapCount = 0;
+
+   if (!cache) {
+      pipe_mutex_lock(mgr->mutex);
+      pb_slab_buffer_free_locked(buf);
+      pipe_mutex_unlock(mgr->mutex);
+      return;
+   }
+
+   /* Give half of a full cache back to the slabs */
+   if (cache->numBuffers == PB_SLAB_THREAD_CACHE_SIZE) {
+      pipe_mutex_lock(mgr->mutex);
+      while (cache->numBuffers > PB_SLAB_THREAD_CACHE_SIZE / 2)
+         pb_slab_buffer_free_locked(cache->buffers[--cache->numBuffers]);
+      pipe_mutex_unlock(mgr->mutex);
+   }
+
+   cache->buffers[cache->numBuffers++] = buf;
 }
 
 
@@ -369,15 +440,46 @@ out_err0:
 }
 
 
+/**
+ * Take a free buffer from a partial slab, creating one if needed.
+ * Must be called with the manager mutex held.
+ */
+static struct pb_slab_buffer *
+pb_slab_buffer_alloc_locked(struct pb_slab_manager *mgr)
+{
+   struct pb_slab *slab;
+   struct list_head *list;
+
+   /* Create a new slab, if we run out of partial slabs */
+   if (mgr->slabs.next == &mgr->slabs) {
+      (void) pb_slab_create(mgr);
+      if (mgr->slabs.next == &mgr->slabs)
+         return NULL;
+   }
+   
+   /* Allocate the buffer from a partial (or just created) slab */
+   list = mgr->slabs.next;
+   slab = LIST_ENTRY(struct pb_slab, list, head);
+   
+   /* If totally full remove from the partial slab list */
+   if (--slab->numFree == 0)
+      LIST_DELINIT(list);
+
+   list = slab->freeBuffers.next;
+   LIST_DELINIT(list);
+
+   return LIST_ENTRY(struct pb_slab_buffer, list, head);
+}
+
+
 static struct pb_buffer *
 pb_slab_manager_create_buffer(struct pb_manager *_mgr,
                               pb_size size,
                               const struct pb_desc *desc)
 {
    struct pb_slab_manager *mgr = pb_slab_manager(_mgr);
-   static struct pb_slab_buffer *buf;
-   struct pb_slab *slab;
-   struct list_head *list;
+   struct pb_slab_thread_cache *cache;
+   struct pb_slab_buffer *buf;
 
    /* check size */
    assert(size <= mgr->bufSize);
@@ -396,30 +498,30 @@ pb_slab_manager_create_buffer(struct pb_manager *_mgr,
    if(!pb_check_usage(desc->usage, mgr->desc.usage))
       return NULL;
 
-   pipe_mutex_lock(mgr->mutex);
-   
-   /* Create a new slab, if we run out of partial slabs */
-   if (mgr->slabs.next == &mgr->slabs) {
-      (void) pb_slab_create(mgr);
-      if (mgr->slabs.next == &mgr->slabs) {
-	 pipe_mutex_unlock(mgr->mutex);
-	 return NULL;
+   cache = pb_slab_get_thread_cache(mgr);
+   if (cache) {
+      /* Refill half of an empty cache from the slabs */
+      if (!cache->numBuffers) {
+         pipe_mutex_lock(mgr->mutex);
+         while (cache->numBuffers < PB_SLAB_THREAD_CACHE_SIZE / 2) {
+            buf = pb_slab_buffer_alloc_locked(mgr);
+            if (!buf)
+               break;
+            cache->buffers[cache->numBuffers++] = buf;
+         }
+         pipe_mutex_unlock(mgr->mutex);
       }
-   }
-   
-   /* Allocate the buffer from a partial (or just created) slab */
-   list = mgr->slabs.next;
-   slab = LIST_ENTRY(struct pb_slab, list, head);
-   
-   /* If totally full remove from the partial slab list */
-   if (--slab->numFree == 0)
-      LIST_DELINIT(list);
 
-   list = slab->freeBuffers.next;
-   LIST_DELINIT(list);
+      buf = cache->numBuffers ? cache->buffers[--cache->numBuffers] : NULL;
+   }
+   else {
+      pipe_mutex_lock(mgr->mutex);
+      buf = pb_slab_buffer_alloc_locked(mgr);
+      pipe_mutex_unlock(mgr->mutex);
+   }
 
-   pipe_mutex_unlock(mgr->mutex);
-   buf = LIST_ENTRY(struct pb_slab_buffer, list, head);
+   if (!buf)
+      return NULL;
    
    pipe_reference_init(&buf->base.reference, 1);
    buf->base.alignment = desc->alignment;
@@ -444,8 +546,19 @@ static void
 pb_slab_manager_destroy(struct pb_manager *_mgr)
 {
    struct pb_slab_manager *mgr = pb_slab_manager(_mgr);
+   struct pb_slab_thread_cache *cache, *next;
+
+   /* Hand the cached buffers back, which frees the slabs they kept alive */
+   for (cache = mgr->caches; cache; cache = next) {
+      next = cache->next;
+      while (cache->numBuffers)
+         pb_slab_buffer_free_locked(cache->buffers[--cache->numBuffers]);
+      FREE(cache);
+   }
+   pipe_tsd_destroy(&mgr->cache_tsd);
 
    /* TODO: cleanup all allocated buffers */
+   pipe_mutex_destroy(mgr->mutex);
    FREE(mgr);
 }
 
@@ -474,6 +587,7 @@ pb_slab_manager_create(struct pb_manager *provider,
    LIST_INITHEAD(&mgr->slabs);
    
    pipe_mutex_init(mgr->mutex);
+   pipe_tsd_init(&mgr->cache_tsd);
 
    return &mgr->base;
 }
@@ -71,7 +71,15 @@ up_consts(struct pp_queue_t *ppq)
                                sizeof(constants));
 }
 
-/** Run function of the MLAA filter. */
+/**
+ * Run function of the MLAA filter.
+ *
+ * Only the edge detection pass runs on every pixel.  It marks the edge
+ * pixels in the stencil buffer, and the blend weight and neighborhood
+ * blending passes are stencil tested against that mask.  Their cost,
+ * which is most of the filter, therefore scales with the number of edges
+ * rather than with the screen size on hardware with early stencil.
+ */
 static void
 pp_jimenezmlaa_run(struct pp_queue_t *ppq, struct pipe_resource *in,
                    struct pipe_resource *out, unsigned int n, bool iscolor)
@@ -191,10 +199,13 @@ pp_jimenezmlaa_run(struct pp_queue_t *ppq, struct pipe_resource *in,
 
    pp_filter_set_fb(p);
 
-   /* Blit the input to the output */
-   pp_blit(p->pipe, in, 0, 0,
-           w, h, 0, p->framebuffer.cbufs[0],
-           0, 0, w, h);
+   /* Blit the input to the output, unless it's there already.  Only the
+    * edges are drawn below.
+    */
+   if (!ppq->out_has_input)
+      pp_blit(p->pipe, in, 0, 0,
+              w, h, 0, p->framebuffer.cbufs[0],
+              0, 0, w, h);
 
    u_sampler_view_default_template(&v_tmp, in, in->format);
    arr[0] = p->pipe->create_sampler_view(p->pipe, in, &v_tmp);
@@ -86,6 +86,12 @@ struct pp_queue_t
    struct pp_program *p;
 
    bool fbos_init;
+
+   /* The output already holds the input image of the filter, because the
+    * queue input and output were the same buffer.  Set by pp_run() for
+    * the duration of a single-filter run.
+    */
+   bool out_has_input;
 };
 
 
@@ -112,6 +112,7 @@ pp_run(struct pp_queue_t *ppq, struct pipe_resource *in,
               0, 0, w, h);
 
       in = ppq->tmp[0];
+      ppq->out_has_input = true;
    }
 
    /* save state (restored below) */
@@ -199,6 +200,8 @@ pp_run(struct pp_queue_t *ppq, struct pipe_resource *in,
    cso_restore_constant_buffer_slot0(cso, PIPE_SHADER_FRAGMENT);
    cso_restore_render_condition(cso);
 
+   ppq->out_has_input = false;
+
    pipe_resource_reference(&ppq->depth, NULL);
    pipe_resource_reference(&refin, NULL);
    pipe_resource_reference(&refout, NULL);
@@ -72,14 +72,93 @@
 #define TILE_BOTTOM_LEFT  2
 #define TILE_BOTTOM_RIGHT 3
 
+
+/*
+ * Vector versions of the most common micro ops.  A channel holds exactly
+ * one 4-wide float vector, so these map 1:1 onto SSE and NEON registers.
+ * Channels aren't necessarily 16-byte aligned, hence the unaligned loads.
+ * All of them must give bit-identical results to the scalar versions,
+ * including for NaNs, so min/max/compares are expressed in terms of the
+ * C operators' semantics.
+ */
+#if defined(PIPE_ARCH_SSE)
+
+#include "util/u_sse.h"
+
+#define TGSI_EXEC_SIMD 1
+
+typedef __m128 simd_float;
+typedef __m128 simd_mask;
+
+#define simd_load(c)          _mm_loadu_ps((c)->f)
+#define simd_store(c, v)      _mm_storeu_ps((c)->f, v)
+#define simd_splat(f)         _mm_set1_ps(f)
+#define simd_add(a, b)        _mm_add_ps(a, b)
+#define simd_sub(a, b)        _mm_sub_ps(a, b)
+#define simd_mul(a, b)        _mm_mul_ps(a, b)
+/* MAXPS/MINPS return the second operand for NaNs, just like a > b ? a : b */
+#define simd_max(a, b)        _mm_max_ps(a, b)
+#define simd_min(a, b)        _mm_min_ps(a, b)
+#define simd_neg(a)           _mm_xor_ps(a, _mm_set1_ps(-0.0f))
+#define simd_abs(a)           _mm_andnot_ps(_mm_set1_ps(-0.0f), a)
+#define simd_cmpeq(a, b)      _mm_cmpeq_ps(a, b)
+#define simd_cmpne(a, b)      _mm_cmpneq_ps(a, b)
+#define simd_cmplt(a, b)      _mm_cmplt_ps(a, b)
+#define simd_cmple(a, b)      _mm_cmple_ps(a, b)
+#define simd_cmpgt(a, b)      _mm_cmpgt_ps(a, b)
+#define simd_cmpge(a, b)      _mm_cmpge_ps(a, b)
+/* mask ? a : b */
+#define simd_select(m, a, b)  _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b))
+/* mask ? 1.0f : 0.0f */
+#define simd_bool(m)          _mm_and_ps(m, _mm_set1_ps(1.0f))
+
+#elif defined(PIPE_ARCH_ARM) && defined(__ARM_NEON__)
+
+#include <arm_neon.h>
+
+#define TGSI_EXEC_SIMD 1
+
+typedef float32x4_t simd_float;
+typedef uint32x4_t simd_mask;
+
+#define simd_load(c)          vld1q_f32((c)->f)
+#define simd_store(c, v)      vst1q_f32((c)->f, v)
+#define simd_splat(f)         vdupq_n_f32(f)
+#define simd_add(a, b)        vaddq_f32(a, b)
+#define simd_sub(a, b)        vsubq_f32(a, b)
+#define simd_mul(a, b)        vmulq_f32(a, b)
+/* VMAX/VMIN propagate NaNs, which the C versions don't */
+#define simd_max(a, b)        simd_select(vcgtq_f32(a, b), a, b)
+#define simd_min(a, b)        simd_select(vcltq_f32(a, b), a, b)
+#define simd_neg(a)           vnegq_f32(a)
+#define simd_abs(a)           vabsq_f32(a)
+#define simd_cmpeq(a, b)      vceqq_f32(a, b)
+#define simd_cmpne(a, b)      vmvnq_u32(vceqq_f32(a, b))
+#define simd_cmplt(a, b)      vcltq_f32(a, b)
+#define simd_cmple(a, b)      vcleq_f32(a, b)
+#define simd_cmpgt(a, b)      vcgtq_f32(a, b)
+#define simd_cmpge(a, b)      vcgeq_f32(a, b)
+#define simd_select(m, a, b)  vbslq_f32(m, a, b)
+#define simd_bool(m)          simd_select(m, vdupq_n_f32(1.0f), vdupq_n_f32(0.0f))
+
+#else
+
+#define TGSI_EXEC_SIMD 0
+
+#endif
+
 static void
 micro_abs(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src)
 {
+#if TGSI_EXEC_SIMD
+   simd_store(dst, simd_abs(simd_load(src)));
+#else
    dst->f[0] = fabsf(src->f[0]);
    dst->f[1] = fabsf(src->f[1]);
    dst->f[2] = fabsf(src->f[2]);
    dst->f[3] = fabsf(src->f[3]);
+#endif
 }
 
 static void
@@ -130,10 +209,15 @@ micro_cmp(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src1,
           const union tgsi_exec_channel *src2)
 {
+#if TGSI_EXEC_SIMD
+   simd_mask m = simd_cmplt(simd_load(src0), simd_splat(0.0f));
+   simd_store(dst, simd_select(m, simd_load(src1), simd_load(src2)));
+#else
    dst->f[0] = src0->f[0] < 0.0f ? src1->f[0] : src2->f[0];
    dst->f[1] = src0->f[1] < 0.0f ? src1->f[1] : src2->f[1];
    dst->f[2] = src0->f[2] < 0.0f ? src1->f[2] : src2->f[2];
    dst->f[3] = src0->f[3] < 0.0f ? src1->f[3] : src2->f[3];
+#endif
 }
 
 static void
@@ -275,10 +359,16 @@ micro_lrp(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src1,
           const union tgsi_exec_channel *src2)
 {
+#if TGSI_EXEC_SIMD
+   simd_float s2 = simd_load(src2);
+   simd_float d = simd_sub(simd_load(src1), s2);
+   simd_store(dst, simd_add(simd_mul(simd_load(src0), d), s2));
+#else
    dst->f[0] = src0->f[0] * (src1->f[0] - src2->f[0]) + src2->f[0];
    dst->f[1] = src0->f[1] * (src1->f[1] - src2->f[1]) + src2->f[1];
    dst->f[2] = src0->f[2] * (src1->f[2] - src2->f[2]) + src2->f[2];
    dst->f[3] = src0->f[3] * (src1->f[3] - src2->f[3]) + src2->f[3];
+#endif
 }
 
 static void
@@ -287,10 +377,15 @@ micro_mad(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src1,
           const union tgsi_exec_channel *src2)
 {
+#if TGSI_EXEC_SIMD
+   simd_store(dst, simd_add(simd_mul(simd_load(src0), simd_load(src1)),
+                            simd_load(src2)));
+#else
    dst->f[0] = src0->f[0] * src1->f[0] + src2->f[0];
    dst->f[1] = src0->f[1] * src1->f[1] + src2->f[1];
    dst->f[2] = src0->f[2] * src1->f[2] + src2->f[2];
    dst->f[3] = src0->f[3] * src1->f[3] + src2->f[3];
+#endif
 }
 
 static void
@@ -360,10 +455,14 @@ micro_seq(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#if TGSI_EXEC_SIMD
+   simd_store(dst, simd_bool(simd_cmpeq(simd_load(src0), simd_load(src1))));
+#else
    dst->f[0] = src0->f[0] == src1->f[0] ? 1.0f : 0.0f;
    dst->f[1] = src0->f[1] == src1->f[1] ? 1.0f : 0.0f;
    dst->f[2] = src0->f[2] == src1->f[2] ? 1.0f : 0.0f;
    dst->f[3] = src0->f[3] == src1->f[3] ? 1.0f : 0.0f;
+#endif
 }
 
 static void
@@ -371,10 +470,14 @@ micro_sge(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#if TGSI_EXEC_SIMD
+   simd_store(dst, simd_bool(simd_cmpge(simd_load(src0), simd_load(src1))));
+#else
    dst->f[0] = src0->f[0] >= src1->f[0] ? 1.0f : 0.0f;
    dst->f[1] = src0->f[1] >= src1->f[1] ? 1.0f : 0.0f;
    dst->f[2] = src0->f[2] >= src1->f[2] ? 1.0f : 0.0f;
    dst->f[3] = src0->f[3] >= src1->f[3] ? 1.0f : 0.0f;
+#endif
 }
 
 static void
@@ -402,10 +505,14 @@ micro_sgt(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#if TGSI_EXEC_SIMD
+   simd_store(dst, simd_bool(simd_cmpgt(simd_load(src0), simd_load(src1))));
+#else
    dst->f[0] = src0->f[0] > src1->f[0] ? 1.0f : 0.0f;
    dst->f[1] = src0->f[1] > src1->f[1] ? 1.0f : 0.0f;
    dst->f[2] = src0->f[2] > src1->f[2] ? 1.0f : 0.0f;
    dst->f[3] = src0->f[3] > src1->f[3] ? 1.0f : 0.0f;
+#endif
 }
 
 static void
@@ -423,10 +530,14 @@ micro_sle(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#if TGSI_EXEC_SIMD
+   simd_store(dst, simd_bool(simd_cmple(simd_load(src0), simd_load(src1))));
+#else
    dst->f[0] = src0->f[0] <= src1->f[0] ? 1.0f : 0.0f;
    dst->f[1] = src0->f[1] <= src1->f[1] ? 1.0f : 0.0f;
    dst->f[2] = src0->f[2] <= src1->f[2] ? 1.0f : 0.0f;
    dst->f[3] = src0->f[3] <= src1->f[3] ? 1.0f : 0.0f;
+#endif
 }
 
 static void
@@ -434,10 +545,14 @@ micro_slt(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#if TGSI_EXEC_SIMD
+   simd_store(dst, simd_bool(simd_cmplt(simd_load(src0), simd_load(src1))));
+#else
    dst->f[0] = src0->f[0] < src1->f[0] ? 1.0f : 0.0f;
    dst->f[1] = src0->f[1] < src1->f[1] ? 1.0f : 0.0f;
    dst->f[2] = src0->f[2] < src1->f[2] ? 1.0f : 0.0f;
    dst->f[3] = src0->f[3] < src1->f[3] ? 1.0f : 0.0f;
+#endif
 }
 
 static void
@@ -445,10 +560,14 @@ micro_sne(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#if TGSI_EXEC_SIMD
+   simd_store(dst, simd_bool(simd_cmpne(simd_load(src0), simd_load(src1))));
+#else
    dst->f[0] = src0->f[0] != src1->f[0] ? 1.0f : 0.0f;
    dst->f[1] = src0->f[1] != src1->f[1] ? 1.0f : 0.0f;
    dst->f[2] = src0->f[2] != src1->f[2] ? 1.0f : 0.0f;
    dst->f[3] = src0->f[3] != src1->f[3] ? 1.0f : 0.0f;
+#endif
 }
 
 static void
@@ -633,53 +752,22 @@ tgsi_check_soa_dependencies(const struct tgsi_full_instruction *inst)
 
 
 /**
- * Initialize machine state by expanding tokens to full instructions,
- * allocating temporary storage, setting up constants, etc.
- * After this, we can call tgsi_exec_machine_run() many times.
+ * Common part of binding a shader: point the machine at the decoded
+ * instructions, set up the immediates, allocate temporary storage, etc.
  */
-void 
-tgsi_exec_machine_bind_shader(
-   struct tgsi_exec_machine *mach,
-   const struct tgsi_token *tokens,
-   struct tgsi_sampler *sampler)
+static boolean
+bind_decoded_shader(struct tgsi_exec_machine *mach,
+                    const struct tgsi_decoded_shader *shader,
+                    struct tgsi_sampler *sampler)
 {
-   uint k;
-   struct tgsi_parse_context parse;
-   struct tgsi_full_instruction *instructions;
-   struct tgsi_full_declaration *declarations;
-   uint maxInstructions = 10, numInstructions = 0;
-   uint maxDeclarations = 10, numDeclarations = 0;
-
-#if 0
-   tgsi_dump(tokens, 0);
-#endif
+   uint i, j;
 
    util_init_math();
 
-
-   mach->Tokens = tokens;
+   mach->Tokens = shader->Tokens;
    mach->Sampler = sampler;
 
-   if (!tokens) {
-      /* unbind and free all */
-      FREE(mach->Declarations);
-      mach->Declarations = NULL;
-      mach->NumDeclarations = 0;
-
-      FREE(mach->Instructions);
-      mach->Instructions = NULL;
-      mach->NumInstructions = 0;
-
-      return;
-   }
-
-   k = tgsi_parse_init (&parse, mach->Tokens);
-   if (k != TGSI_PARSE_OK) {
-      debug_printf( "Problem parsing!\n" );
-      return;
-   }
-
-   mach->Processor = parse.FullHeader.Processor.Processor;
+   mach->Processor = shader->FullHeader.Processor.Processor;
    mach->ImmLimit = 0;
    mach->NumOutputs = 0;
 
@@ -693,14 +781,14 @@ tgsi_exec_machine_bind_shader(
                             16);
 
       if (!inputs)
-         return;
+         return FALSE;
 
       outputs = align_malloc(sizeof(struct tgsi_exec_vector) *
                              TGSI_MAX_TOTAL_VERTICES, 16);
 
       if (!outputs) {
          align_free(inputs);
-         return;
+         return FALSE;
       }
 
       align_free(mach->Inputs);
@@ -711,99 +799,103 @@ tgsi_exec_machine_bind_shader(
       mach->UsedGeometryShader = TRUE;
    }
 
-   declarations = (struct tgsi_full_declaration *)
-      MALLOC( maxDeclarations * sizeof(struct tgsi_full_declaration) );
+   for (i = 0; i < shader->NumDeclarations; i++) {
+      const struct tgsi_full_declaration *decl = &shader->Declarations[i];
 
-   if (!declarations) {
-      return;
+      if (decl->Declaration.File == TGSI_FILE_OUTPUT) {
+         mach->NumOutputs += decl->Range.Last - decl->Range.First + 1;
+      }
    }
 
-   instructions = (struct tgsi_full_instruction *)
-      MALLOC( maxInstructions * sizeof(struct tgsi_full_instruction) );
+   for (i = 0; i < shader->NumImmediates; i++) {
+      const struct tgsi_full_immediate *imm = &shader->Immediates[i];
+      uint size = imm->Immediate.NrTokens - 1;
+      assert( size <= 4 );
+      assert( mach->ImmLimit + 1 <= TGSI_EXEC_NUM_IMMEDIATES );
 
-   if (!instructions) {
-      FREE( declarations );
-      return;
+      for (j = 0; j < size; j++) {
+         mach->Imms[mach->ImmLimit][j] = imm->u[j].Float;
+      }
+      mach->ImmLimit += 1;
    }
 
-   while( !tgsi_parse_end_of_tokens( &parse ) ) {
-      uint i;
+   mach->Declarations = shader->Declarations;
+   mach->NumDeclarations = shader->NumDeclarations;
 
-      tgsi_parse_token( &parse );
-      switch( parse.FullToken.Token.Type ) {
-      case TGSI_TOKEN_TYPE_DECLARATION:
-         /* save expanded declaration */
-         if (numDeclarations == maxDeclarations) {
-            declarations = REALLOC(declarations,
-                                   maxDeclarations
-                                   * sizeof(struct tgsi_full_declaration),
-                                   (maxDeclarations + 10)
-                                   * sizeof(struct tgsi_full_declaration));
-            maxDeclarations += 10;
-         }
-         if (parse.FullToken.FullDeclaration.Declaration.File == TGSI_FILE_OUTPUT) {
-            unsigned reg;
-            for (reg = parse.FullToken.FullDeclaration.Range.First;
-                 reg <= parse.FullToken.FullDeclaration.Range.Last;
-                 ++reg) {
-               ++mach->NumOutputs;
-            }
-         }
-         memcpy(declarations + numDeclarations,
-                &parse.FullToken.FullDeclaration,
-                sizeof(declarations[0]));
-         numDeclarations++;
-         break;
+   mach->Instructions = shader->Instructions;
+   mach->NumInstructions = shader->NumInstructions;
 
-      case TGSI_TOKEN_TYPE_IMMEDIATE:
-         {
-            uint size = parse.FullToken.FullImmediate.Immediate.NrTokens - 1;
-            assert( size <= 4 );
-            assert( mach->ImmLimit + 1 <= TGSI_EXEC_NUM_IMMEDIATES );
+   return TRUE;
+}
 
-            for( i = 0; i < size; i++ ) {
-               mach->Imms[mach->ImmLimit][i] = 
-		  parse.FullToken.FullImmediate.u[i].Float;
-            }
-            mach->ImmLimit += 1;
-         }
-         break;
 
-      case TGSI_TOKEN_TYPE_INSTRUCTION:
+/**
+ * Initialize machine state by expanding tokens to full instructions,
+ * allocating temporary storage, setting up constants, etc.
+ * After this, we can call tgsi_exec_machine_run() many times.
+ */
+void 
+tgsi_exec_machine_bind_shader(
+   struct tgsi_exec_machine *mach,
+   const struct tgsi_token *tokens,
+   struct tgsi_sampler *sampler)
+{
+   struct tgsi_decoded_shader *shader;
 
-         /* save expanded instruction */
-         if (numInstructions == maxInstructions) {
-            instructions = REALLOC(instructions,
-                                   maxInstructions
-                                   * sizeof(struct tgsi_full_instruction),
-                                   (maxInstructions + 10)
-                                   * sizeof(struct tgsi_full_instruction));
-            maxInstructions += 10;
-         }
+#if 0
+   tgsi_dump(tokens, 0);
+#endif
 
-         memcpy(instructions + numInstructions,
-                &parse.FullToken.FullInstruction,
-                sizeof(instructions[0]));
+   if (!tokens) {
+      /* unbind and free all */
+      tgsi_free_decoded_shader(mach->OwnDecoded);
+      mach->OwnDecoded = NULL;
 
-         numInstructions++;
-         break;
+      mach->Tokens = NULL;
+      mach->Sampler = sampler;
 
-      case TGSI_TOKEN_TYPE_PROPERTY:
-         break;
+      mach->Declarations = NULL;
+      mach->NumDeclarations = 0;
 
-      default:
-         assert( 0 );
-      }
+      mach->Instructions = NULL;
+      mach->NumInstructions = 0;
+
+      return;
+   }
+
+   shader = tgsi_decode_shader(tokens);
+   if (!shader) {
+      debug_printf( "Problem parsing!\n" );
+      return;
+   }
+
+   if (!bind_decoded_shader(mach, shader, sampler)) {
+      tgsi_free_decoded_shader(shader);
+      return;
    }
-   tgsi_parse_free (&parse);
 
-   FREE(mach->Declarations);
-   mach->Declarations = declarations;
-   mach->NumDeclarations = numDeclarations;
+   tgsi_free_decoded_shader(mach->OwnDecoded);
+   mach->OwnDecoded = shader;
+}
+
+
+/**
+ * Like tgsi_exec_machine_bind_shader(), but for a shader the caller has
+ * decoded once with tgsi_decode_shader() and keeps around, so that binding
+ * it again doesn't need to parse the tokens.  The shader must outlive the
+ * binding.
+ */
+void
+tgsi_exec_machine_bind_decoded_shader(
+   struct tgsi_exec_machine *mach,
+   const struct tgsi_decoded_shader *shader,
+   struct tgsi_sampler *sampler)
+{
+   if (!bind_decoded_shader(mach, shader, sampler))
+      return;
 
-   FREE(mach->Instructions);
-   mach->Instructions = instructions;
-   mach->NumInstructions = numInstructions;
+   tgsi_free_decoded_shader(mach->OwnDecoded);
+   mach->OwnDecoded = NULL;
 }
 
 
@@ -864,8 +956,7 @@ void
 tgsi_exec_machine_destroy(struct tgsi_exec_machine *mach)
 {
    if (mach) {
-      FREE(mach->Instructions);
-      FREE(mach->Declarations);
+      tgsi_free_decoded_shader(mach->OwnDecoded);
 
       align_free(mach->Inputs);
       align_free(mach->Outputs);
@@ -879,10 +970,14 @@ micro_add(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#if TGSI_EXEC_SIMD
+   simd_store(dst, simd_add(simd_load(src0), simd_load(src1)));
+#else
    dst->f[0] = src0->f[0] + src1->f[0];
    dst->f[1] = src0->f[1] + src1->f[1];
    dst->f[2] = src0->f[2] + src1->f[2];
    dst->f[3] = src0->f[3] + src1->f[3];
+#endif
 }
 
 static void
@@ -940,10 +1035,14 @@ micro_max(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#if TGSI_EXEC_SIMD
+   simd_store(dst, simd_max(simd_load(src0), simd_load(src1)));
+#else
    dst->f[0] = src0->f[0] > src1->f[0] ? src0->f[0] : src1->f[0];
    dst->f[1] = src0->f[1] > src1->f[1] ? src0->f[1] : src1->f[1];
    dst->f[2] = src0->f[2] > src1->f[2] ? src0->f[2] : src1->f[2];
    dst->f[3] = src0->f[3] > src1->f[3] ? src0->f[3] : src1->f[3];
+#endif
 }
 
 static void
@@ -951,10 +1050,14 @@ micro_min(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#if TGSI_EXEC_SIMD
+   simd_store(dst, simd_min(simd_load(src0), simd_load(src1)));
+#else
    dst->f[0] = src0->f[0] < src1->f[0] ? src0->f[0] : src1->f[0];
    dst->f[1] = src0->f[1] < src1->f[1] ? src0->f[1] : src1->f[1];
    dst->f[2] = src0->f[2] < src1->f[2] ? src0->f[2] : src1->f[2];
    dst->f[3] = src0->f[3] < src1->f[3] ? src0->f[3] : src1->f[3];
+#endif
 }
 
 static void
@@ -962,10 +1065,14 @@ micro_mul(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#if TGSI_EXEC_SIMD
+   simd_store(dst, simd_mul(simd_load(src0), simd_load(src1)));
+#else
    dst->f[0] = src0->f[0] * src1->f[0];
    dst->f[1] = src0->f[1] * src1->f[1];
    dst->f[2] = src0->f[2] * src1->f[2];
    dst->f[3] = src0->f[3] * src1->f[3];
+#endif
 }
 
 static void
@@ -973,10 +1080,14 @@ micro_neg(
    union tgsi_exec_channel *dst,
    const union tgsi_exec_channel *src )
 {
+#if TGSI_EXEC_SIMD
+   simd_store(dst, simd_neg(simd_load(src)));
+#else
    dst->f[0] = -src->f[0];
    dst->f[1] = -src->f[1];
    dst->f[2] = -src->f[2];
    dst->f[3] = -src->f[3];
+#endif
 }
 
 static void
@@ -1003,10 +1114,14 @@ micro_sub(union tgsi_exec_channel *dst,
           const union tgsi_exec_channel *src0,
           const union tgsi_exec_channel *src1)
 {
+#if TGSI_EXEC_SIMD
+   simd_store(dst, simd_sub(simd_load(src0), simd_load(src1)));
+#else
    dst->f[0] = src0->f[0] - src1->f[0];
    dst->f[1] = src0->f[1] - src1->f[1];
    dst->f[2] = src0->f[2] - src1->f[2];
    dst->f[3] = src0->f[3] - src1->f[3];
+#endif
 }
 
 static void
@@ -1514,6 +1629,11 @@ store_dest(struct tgsi_exec_machine *mach,
 
    switch (inst->Instruction.Saturate) {
    case TGSI_SAT_NONE:
+      if (execmask == (1 << TGSI_QUAD_SIZE) - 1) {
+         /* the common case: no flow control in effect */
+         *dst = *chan;
+         break;
+      }
       for (i = 0; i < TGSI_QUAD_SIZE; i++)
          if (execmask & (1 << i))
             dst->i[i] = chan->i[i];
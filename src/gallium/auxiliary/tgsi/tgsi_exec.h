@@ -37,6 +37,8 @@
 extern "C" {
 #endif
 
+struct tgsi_decoded_shader;
+
 #define TGSI_CHAN_X 0
 #define TGSI_CHAN_Y 1
 #define TGSI_CHAN_Z 2
@@ -347,12 +349,15 @@ struct tgsi_exec_machine
    struct tgsi_call_record CallStack[TGSI_EXEC_MAX_CALL_NESTING];
    int CallStackTop;
 
-   struct tgsi_full_instruction *Instructions;
+   const struct tgsi_full_instruction *Instructions;
    uint NumInstructions;
 
-   struct tgsi_full_declaration *Declarations;
+   const struct tgsi_full_declaration *Declarations;
    uint NumDeclarations;
 
+   /** The decoded shader, if the machine decoded it itself */
+   struct tgsi_decoded_shader *OwnDecoded;
+
    struct tgsi_declaration_sampler_view
       SamplerViews[PIPE_MAX_SHADER_SAMPLER_VIEWS];
 
@@ -372,6 +377,12 @@ tgsi_exec_machine_bind_shader(
    const struct tgsi_token *tokens,
    struct tgsi_sampler *sampler);
 
+void
+tgsi_exec_machine_bind_decoded_shader(
+   struct tgsi_exec_machine *mach,
+   const struct tgsi_decoded_shader *shader,
+   struct tgsi_sampler *sampler);
+
 uint
 tgsi_exec_machine_run(
    struct tgsi_exec_machine *mach );
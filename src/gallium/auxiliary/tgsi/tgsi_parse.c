@@ -264,6 +264,132 @@ tgsi_parse_token(
 
 
 
+/**
+ * Decode a whole shader.  The top-level tokens are counted first by
+ * hopping over them with their NrTokens field, which is much cheaper than
+ * parsing, so that the decoded shader can be allocated in one go.
+ * \return the decoded shader, or NULL on error
+ */
+struct tgsi_decoded_shader *
+tgsi_decode_shader(const struct tgsi_token *tokens)
+{
+   struct tgsi_decoded_shader *shader;
+   struct tgsi_parse_context parse;
+   struct tgsi_decoded_token *order;
+   struct tgsi_full_declaration *declarations;
+   struct tgsi_full_immediate *immediates;
+   struct tgsi_full_instruction *instructions;
+   struct tgsi_full_property *properties;
+   unsigned count[TGSI_TOKEN_TYPE_PROPERTY + 1] = { 0 };
+   unsigned num_tokens = 0;
+   unsigned pos, end;
+   char *mem;
+
+   if (tgsi_parse_init(&parse, tokens) != TGSI_PARSE_OK)
+      return NULL;
+
+   pos = parse.FullHeader.Header.HeaderSize;
+   end = pos + parse.FullHeader.Header.BodySize;
+   while (pos < end) {
+      struct tgsi_token token;
+
+      copy_token(&token, &tokens[pos]);
+      if (token.Type > TGSI_TOKEN_TYPE_PROPERTY || token.NrTokens == 0) {
+         assert(0);
+         tgsi_parse_free(&parse);
+         return NULL;
+      }
+      count[token.Type]++;
+      num_tokens++;
+      pos += token.NrTokens;
+   }
+
+   mem = MALLOC(sizeof *shader +
+                num_tokens * sizeof *order +
+                count[TGSI_TOKEN_TYPE_DECLARATION] * sizeof *declarations +
+                count[TGSI_TOKEN_TYPE_IMMEDIATE] * sizeof *immediates +
+                count[TGSI_TOKEN_TYPE_INSTRUCTION] * sizeof *instructions +
+                count[TGSI_TOKEN_TYPE_PROPERTY] * sizeof *properties);
+   if (!mem) {
+      tgsi_parse_free(&parse);
+      return NULL;
+   }
+
+   shader = (struct tgsi_decoded_shader *) mem;
+   mem += sizeof *shader;
+   declarations = (struct tgsi_full_declaration *) mem;
+   mem += count[TGSI_TOKEN_TYPE_DECLARATION] * sizeof *declarations;
+   immediates = (struct tgsi_full_immediate *) mem;
+   mem += count[TGSI_TOKEN_TYPE_IMMEDIATE] * sizeof *immediates;
+   instructions = (struct tgsi_full_instruction *) mem;
+   mem += count[TGSI_TOKEN_TYPE_INSTRUCTION] * sizeof *instructions;
+   properties = (struct tgsi_full_property *) mem;
+   mem += count[TGSI_TOKEN_TYPE_PROPERTY] * sizeof *properties;
+   order = (struct tgsi_decoded_token *) mem;
+
+   shader->Tokens = tokens;
+   shader->FullHeader = parse.FullHeader;
+   shader->Order = order;
+   shader->NumTokens = 0;
+   shader->Declarations = declarations;
+   shader->NumDeclarations = 0;
+   shader->Immediates = immediates;
+   shader->NumImmediates = 0;
+   shader->Instructions = instructions;
+   shader->NumInstructions = 0;
+   shader->Properties = properties;
+   shader->NumProperties = 0;
+
+   while (!tgsi_parse_end_of_tokens(&parse)) {
+      unsigned index;
+
+      tgsi_parse_token(&parse);
+
+      switch (parse.FullToken.Token.Type) {
+      case TGSI_TOKEN_TYPE_DECLARATION:
+         index = shader->NumDeclarations++;
+         declarations[index] = parse.FullToken.FullDeclaration;
+         break;
+      case TGSI_TOKEN_TYPE_IMMEDIATE:
+         index = shader->NumImmediates++;
+         immediates[index] = parse.FullToken.FullImmediate;
+         break;
+      case TGSI_TOKEN_TYPE_INSTRUCTION:
+         index = shader->NumInstructions++;
+         instructions[index] = parse.FullToken.FullInstruction;
+         break;
+      case TGSI_TOKEN_TYPE_PROPERTY:
+         index = shader->NumProperties++;
+         properties[index] = parse.FullToken.FullProperty;
+         break;
+      default:
+         assert(0);
+         index = 0;
+      }
+
+      order[shader->NumTokens].Type = parse.FullToken.Token.Type;
+      order[shader->NumTokens].Index = index;
+      shader->NumTokens++;
+   }
+
+   tgsi_parse_free(&parse);
+
+   assert(shader->NumTokens == num_tokens);
+   assert(shader->NumDeclarations == count[TGSI_TOKEN_TYPE_DECLARATION]);
+   assert(shader->NumImmediates == count[TGSI_TOKEN_TYPE_IMMEDIATE]);
+   assert(shader->NumInstructions == count[TGSI_TOKEN_TYPE_INSTRUCTION]);
+   assert(shader->NumProperties == count[TGSI_TOKEN_TYPE_PROPERTY]);
+
+   return shader;
+}
+
+
+void
+tgsi_free_decoded_shader(struct tgsi_decoded_shader *shader)
+{
+   FREE(shader);
+}
+
 
 /**
  * Make a new copy of a token array.
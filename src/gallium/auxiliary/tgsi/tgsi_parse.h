@@ -113,6 +113,42 @@ struct tgsi_parse_context
    union tgsi_full_token      FullToken;
 };
 
+/**
+ * Position of a token of the original stream in the decoded shader.
+ */
+struct tgsi_decoded_token
+{
+   unsigned Type  : 4;  /**< TGSI_TOKEN_TYPE_x */
+   unsigned Index : 28; /**< into the array of decoded tokens of that type */
+};
+
+/**
+ * A shader decoded once into arrays of full tokens, for passes which want
+ * to walk a shader repeatedly or need random access to its instructions,
+ * e.g. by label.  Order lists every token in the original stream order.
+ * Everything lives in a single allocation.
+ */
+struct tgsi_decoded_shader
+{
+   const struct tgsi_token          *Tokens;
+   struct tgsi_full_header          FullHeader;
+
+   const struct tgsi_decoded_token  *Order;
+   unsigned                         NumTokens;
+
+   const struct tgsi_full_declaration *Declarations;
+   unsigned                         NumDeclarations;
+
+   const struct tgsi_full_immediate *Immediates;
+   unsigned                         NumImmediates;
+
+   const struct tgsi_full_instruction *Instructions;
+   unsigned                         NumInstructions;
+
+   const struct tgsi_full_property  *Properties;
+   unsigned                         NumProperties;
+};
+
 #define TGSI_PARSE_OK      0
 #define TGSI_PARSE_ERROR   1
 
@@ -133,6 +169,12 @@ void
 tgsi_parse_token(
    struct tgsi_parse_context *ctx );
 
+struct tgsi_decoded_shader *
+tgsi_decode_shader(const struct tgsi_token *tokens);
+
+void
+tgsi_free_decoded_shader(struct tgsi_decoded_shader *shader);
+
 static INLINE unsigned
 tgsi_num_tokens(const struct tgsi_token *tokens)
 {
@@ -33,6 +33,8 @@
 #include "pipe/p_state.h"
 #include "pipe/p_shader_tokens.h"
 
+struct tgsi_decoded_shader;
+
 /**
  * Shader summary info
  */
@@ -102,6 +104,10 @@ extern void
 tgsi_scan_shader(const struct tgsi_token *tokens,
                  struct tgsi_shader_info *info);
 
+extern void
+tgsi_scan_decoded_shader(const struct tgsi_decoded_shader *shader,
+                         struct tgsi_shader_info *info);
+
 
 extern boolean
 tgsi_is_passthrough_shader(const struct tgsi_token *tokens);
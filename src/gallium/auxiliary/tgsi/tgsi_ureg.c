@@ -82,6 +82,14 @@ struct ureg_tokens {
 #define UREG_MAX_PRED 1
 #define UREG_MAX_ARRAY_TEMPS 256
 
+/* Instruction tokens allocated up front by ureg_create(), enough for
+ * most internal shaders to never grow the buffer.
+ */
+#define UREG_DEFAULT_TOKENS 256
+
+/* Upper bound of the tokens of a declaration, property or immediate. */
+#define UREG_MAX_DECL_TOKENS 5
+
 struct const_decl {
    struct {
       unsigned first;
@@ -1654,10 +1662,48 @@ emit_header( struct ureg_program *ureg )
 }
 
 
+/**
+ * Upper bound of the number of tokens emit_decls() will emit.
+ */
+static unsigned
+max_decl_tokens( const struct ureg_program *ureg )
+{
+   unsigned nr_decls = 7; /* properties */
+   unsigned i;
+
+   for (i = 0; i < Elements(ureg->vs_inputs); i++)
+      nr_decls += util_bitcount(ureg->vs_inputs[i]);
+
+   nr_decls += ureg->nr_fs_inputs;
+   nr_decls += ureg->nr_gs_inputs;
+   nr_decls += ureg->nr_system_values;
+   nr_decls += ureg->nr_outputs;
+   nr_decls += ureg->nr_samplers;
+   nr_decls += ureg->nr_sampler_views;
+   nr_decls += ureg->const_decls.nr_constant_ranges;
+   for (i = 0; i < PIPE_MAX_CONSTANT_BUFFERS; i++)
+      nr_decls += ureg->const_decls2D[i].nr_constant_ranges;
+   nr_decls += ureg->nr_temps;
+   nr_decls += 2; /* addresses, predicates */
+   nr_decls += ureg->nr_immediates;
+
+   return nr_decls * UREG_MAX_DECL_TOKENS;
+}
+
+
 const struct tgsi_token *ureg_finalize( struct ureg_program *ureg )
 {
    const struct tgsi_token *tokens;
 
+   /* Grow the declaration domain once to hold the whole shader, so that
+    * emitting the declarations and appending the instructions never
+    * reallocates it.
+    */
+   if (ureg->domain[DOMAIN_DECL].count == 0)
+      tokens_expand( &ureg->domain[DOMAIN_DECL],
+                     2 + max_decl_tokens( ureg ) +
+                     ureg->domain[DOMAIN_INSN].count );
+
    emit_header( ureg );
    emit_decls( ureg );
    copy_instructions( ureg );
@@ -1741,11 +1787,23 @@ void ureg_free_tokens( const struct tgsi_token *tokens )
 
 
 struct ureg_program *ureg_create( unsigned processor )
+{
+   return ureg_create_with_size_hint( processor, UREG_DEFAULT_TOKENS );
+}
+
+
+struct ureg_program *ureg_create_with_size_hint( unsigned processor,
+                                                 unsigned nr_tokens )
 {
    struct ureg_program *ureg = CALLOC_STRUCT( ureg_program );
    if (ureg == NULL)
       goto no_ureg;
 
+   tokens_expand( &ureg->domain[DOMAIN_INSN],
+                  MAX2(nr_tokens, UREG_DEFAULT_TOKENS) );
+   if (ureg->domain[DOMAIN_INSN].tokens == error_tokens)
+      goto no_tokens;
+
    ureg->processor = processor;
    ureg->property_gs_input_prim = ~0;
    ureg->property_gs_output_prim = ~0;
@@ -1770,6 +1828,8 @@ no_decl_temps:
 no_local_temps:
    util_bitmask_destroy(ureg->free_temps);
 no_free_temps:
+   FREE(ureg->domain[DOMAIN_INSN].tokens);
+no_tokens:
    FREE(ureg);
 no_ureg:
    return NULL;
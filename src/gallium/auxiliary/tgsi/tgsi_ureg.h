@@ -94,6 +94,14 @@ struct pipe_context;
 struct ureg_program *
 ureg_create( unsigned processor );
 
+/**
+ * Like ureg_create(), but allocates room for at least nr_tokens
+ * instruction tokens up front, so that building a large shader doesn't
+ * keep growing the token buffer.
+ */
+struct ureg_program *
+ureg_create_with_size_hint( unsigned processor, unsigned nr_tokens );
+
 const struct tgsi_token *
 ureg_finalize( struct ureg_program * );
 
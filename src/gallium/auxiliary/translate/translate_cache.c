@@ -26,6 +26,9 @@
  **************************************************************************/
 
 #include "util/u_memory.h"
+#include "util/u_atomic.h"
+#include "util/u_debug.h"
+#include "util/u_double_list.h"
 #include "pipe/p_state.h"
 #include "translate.h"
 #include "translate_cache.h"
@@ -33,32 +36,54 @@
 #include "cso_cache/cso_cache.h"
 #include "cso_cache/cso_hash.h"
 
+
+/** Default number of translates each cache keeps, 0 means no limit */
+#define TRANSLATE_CACHE_DEFAULT_SIZE 128
+
+DEBUG_GET_ONCE_NUM_OPTION(translate_cache_size, "TRANSLATE_CACHE_SIZE",
+                          TRANSLATE_CACHE_DEFAULT_SIZE)
+
+struct translate_cache_entry {
+   struct list_head lru;         /**< most recently used first */
+   unsigned hash_key;
+   struct translate *translate;
+};
+
 struct translate_cache {
    struct cso_hash *hash;
+   struct list_head lru;
+   unsigned size;
+   unsigned max_size;
+   struct translate_cache_stats stats;
 };
 
+/** Totals over all caches, for the driver queries */
+static int32_t total_hits;
+static int32_t total_misses;
+static int32_t total_evictions;
+
+
 struct translate_cache * translate_cache_create( void )
 {
-   struct translate_cache *cache = MALLOC_STRUCT(translate_cache);
+   struct translate_cache *cache = CALLOC_STRUCT(translate_cache);
    if (cache == NULL) {
       return NULL;
    }
 
    cache->hash = cso_hash_create();
+   LIST_INITHEAD(&cache->lru);
+   cache->max_size = debug_get_option_translate_cache_size();
    return cache;
 }
 
 
 static INLINE void delete_translates(struct translate_cache *cache)
 {
-   struct cso_hash *hash = cache->hash;
-   struct cso_hash_iter iter = cso_hash_first_node(hash);
-   while (!cso_hash_iter_is_null(iter)) {
-      struct translate *state = (struct translate*)cso_hash_iter_data(iter);
-      iter = cso_hash_iter_next(iter);
-      if (state) {
-         state->release(state);
-      }
+   struct translate_cache_entry *entry, *next;
+
+   LIST_FOR_EACH_ENTRY_SAFE(entry, next, &cache->lru, lru) {
+      entry->translate->release(entry->translate);
+      FREE(entry);
    }
 }
 
@@ -87,20 +112,92 @@ static INLINE unsigned create_key(struct translate_key *key)
    return hash_key;
 }
 
+
+/**
+ * Drop the least recently used translate.  The callers only ever hold on
+ * to the translate they got from the last lookup, which is the most
+ * recently used one, so this never pulls one from under their feet.
+ */
+static void evict_translate(struct translate_cache *cache)
+{
+   struct translate_cache_entry *entry =
+      LIST_ENTRY(struct translate_cache_entry, cache->lru.prev, lru);
+   struct cso_hash_iter iter = cso_hash_find(cache->hash, entry->hash_key);
+
+   while (cso_hash_iter_data(iter) != entry) {
+      assert(!cso_hash_iter_is_null(iter));
+      iter = cso_hash_iter_next(iter);
+   }
+   cso_hash_erase(cache->hash, iter);
+
+   LIST_DEL(&entry->lru);
+   entry->translate->release(entry->translate);
+   FREE(entry);
+
+   cache->size--;
+   cache->stats.evictions++;
+   p_atomic_inc(&total_evictions);
+}
+
+
 struct translate * translate_cache_find(struct translate_cache *cache,
                                         struct translate_key *key)
 {
    unsigned hash_key = create_key(key);
-   struct translate *translate = (struct translate*)
-      cso_hash_find_data_from_template(cache->hash,
-                                       hash_key,
-                                       key, sizeof(*key));
-
-   if (!translate) {
-      /* create/insert */
-      translate = translate_create(key);
-      cso_hash_insert(cache->hash, hash_key, translate);
+   struct cso_hash_iter iter = cso_hash_find(cache->hash, hash_key);
+   struct translate_cache_entry *entry;
+
+   while (!cso_hash_iter_is_null(iter)) {
+      entry = (struct translate_cache_entry *) cso_hash_iter_data(iter);
+      if (!memcmp(&entry->translate->key, key, sizeof(*key))) {
+         /* move to the front of the LRU list */
+         LIST_DEL(&entry->lru);
+         LIST_ADD(&entry->lru, &cache->lru);
+         cache->stats.hits++;
+         p_atomic_inc(&total_hits);
+         return entry->translate;
+      }
+      iter = cso_hash_iter_next(iter);
    }
 
-   return translate;
+   /* create/insert */
+   entry = CALLOC_STRUCT(translate_cache_entry);
+   if (!entry)
+      return NULL;
+
+   entry->translate = translate_create(key);
+   if (!entry->translate) {
+      FREE(entry);
+      return NULL;
+   }
+   entry->hash_key = hash_key;
+
+   if (cache->max_size && cache->size >= cache->max_size)
+      evict_translate(cache);
+
+   cso_hash_insert(cache->hash, hash_key, entry);
+   LIST_ADD(&entry->lru, &cache->lru);
+   cache->size++;
+   cache->stats.misses++;
+   p_atomic_inc(&total_misses);
+
+   return entry->translate;
+}
+
+
+/**
+ * Get the hit, miss and eviction counts of a cache, or with a NULL cache,
+ * the totals over all caches of the process.  The counts wrap around.
+ */
+void translate_cache_get_stats(const struct translate_cache *cache,
+                               struct translate_cache_stats *stats)
+{
+   if (cache) {
+      *stats = cache->stats;
+   }
+   else {
+      stats->hits = (unsigned) p_atomic_read(&total_hits);
+      stats->misses = (unsigned) p_atomic_read(&total_misses);
+      stats->evictions = (unsigned) p_atomic_read(&total_evictions);
+   }
 }
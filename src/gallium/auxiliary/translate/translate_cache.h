@@ -29,7 +29,9 @@
  * Translate cache.
  * Simply used to cache created translates. Avoids unecessary creation of
  * translate's if one suitable for a given translate_key has already been
- * created.
+ * created.  The least recently used translates are dropped once a cache
+ * holds TRANSLATE_CACHE_SIZE of them, so only the last translate returned
+ * by translate_cache_find() is guaranteed to stay valid.
  *
  * Note: this functionality depends and requires the CSO module.
  */
@@ -38,6 +40,12 @@ struct translate_cache;
 struct translate_key;
 struct translate;
 
+struct translate_cache_stats {
+   unsigned hits;
+   unsigned misses;
+   unsigned evictions;
+};
+
 struct translate_cache *translate_cache_create( void );
 void translate_cache_destroy(struct translate_cache *cache);
 
@@ -51,4 +59,7 @@ void translate_cache_destroy(struct translate_cache *cache);
 struct translate *translate_cache_find(struct translate_cache *cache,
                                        struct translate_key *key);
 
+void translate_cache_get_stats(const struct translate_cache *cache,
+                               struct translate_cache_stats *stats);
+
 #endif
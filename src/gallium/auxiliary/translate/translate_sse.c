@@ -64,7 +64,8 @@ struct translate_buffer_variant
 
 #define ELEMENT_BUFFER_INSTANCE_ID  1001
 
-#define NUM_CONSTS 7
+#define NUM_FLOAT_CONSTS 15
+#define NUM_CONSTS (NUM_FLOAT_CONSTS + 1)
 
 enum
 {
@@ -74,22 +75,47 @@ enum
    CONST_INV_32767,
    CONST_INV_65535,
    CONST_INV_2147483647,
-   CONST_255
+   CONST_255,
+   CONST_SIGN,
+   CONST_HALF_SCALE,
+   CONST_HALF_INFNAN,
+   CONST_1010102_SCALE,
+   CONST_1010102_SIGN,
+   CONST_1010102_BIAS,
+   CONST_INV_1010102_UNORM,
+   CONST_INV_1010102_SNORM,
+   /* integer constants */
+   CONST_1010102_MASK
 };
 
 #define C(v) {(float)(v), (float)(v), (float)(v), (float)(v)}
-static float consts[NUM_CONSTS][4] = {
+static float consts[NUM_FLOAT_CONSTS][4] = {
    {0, 0, 0, 1},
    C(1.0 / 127.0),
    C(1.0 / 255.0),
    C(1.0 / 32767.0),
    C(1.0 / 65535.0),
    C(1.0 / 2147483647.0),
-   C(255.0)
+   C(255.0),
+   C(-0.0),
+   /* 2^112, rebiases a half float exponent into a float one */
+   C(5192296858534827628530496329220096.0),
+   /* 2^-96, i.e. 0x7c00 << 13 reinterpreted as a float */
+   C(1.0 / 79228162514264337593543950336.0),
+   /* the 10_10_10_2 channels after masking sit at bits 0, 10, 18 and 28 */
+   {1.0, 1.0 / 1024.0, 1.0 / 262144.0, 1.0 / 268435456.0},
+   {512.0, 512.0, 512.0, 2.0},
+   {1024.0, 1024.0, 1024.0, 4.0},
+   {1.0 / 1023.0, 1.0 / 1023.0, 1.0 / 1023.0, 1.0 / 3.0},
+   {1.0 / 511.0, 1.0 / 511.0, 1.0 / 511.0, 1.0}
 };
 
 #undef C
 
+static const uint32_t int_consts[NUM_CONSTS - NUM_FLOAT_CONSTS][4] = {
+   {0x3ff, 0x3ff << 10, 0x3ff << 18, 0x3 << 28}
+};
+
 struct translate_sse
 {
    struct translate translate;
@@ -329,6 +355,107 @@ emit_load_float64to32(struct translate_sse *p, struct x86_reg data,
 }
 
 
+/* load chans half floats, converting them to 32-bit floats and padding
+ * the register with zeroes.  This is done with plain integer arithmetic:
+ * the exponent and mantissa are shifted into place and the exponent
+ * rebiased with a multiplication, which also takes care of denormals,
+ * and infinities and NaNs get their exponent set to all ones.
+ */
+static void
+emit_load_float16to32(struct translate_sse *p, struct x86_reg data,
+                      struct x86_reg arg0, unsigned chans)
+{
+   struct x86_reg tmpXMM = x86_make_reg(file_XMM, 1);
+
+   emit_load_sse2(p, data, arg0, chans * 2);
+   sse2_punpcklwd(p->func, data, get_const(p, CONST_IDENTITY));
+
+   /* tmp = (h & 0x7fff) << 13 */
+   sse2_movdqa(p->func, tmpXMM, data);
+   sse2_pslld_imm(p->func, tmpXMM, 17);
+   sse2_psrld_imm(p->func, tmpXMM, 4);
+
+   /* data = sign | tmp, rebiased */
+   sse2_pslld_imm(p->func, data, 16);
+   sse_andps(p->func, data, get_const(p, CONST_SIGN));
+   sse_orps(p->func, data, tmpXMM);
+   sse_mulps(p->func, data, get_const(p, CONST_HALF_SCALE));
+
+   /* tmp = exponent == 0x1f ? 0x7f800000 : 0 */
+   sse_cmpps(p->func, tmpXMM, get_const(p, CONST_HALF_INFNAN),
+             cc_NotLessThan);
+   sse2_psrld_imm(p->func, tmpXMM, 24);
+   sse2_pslld_imm(p->func, tmpXMM, 23);
+   sse_orps(p->func, data, tmpXMM);
+}
+
+
+/* load a 10_10_10_2 value, converting its channels to 32-bit floats.
+ * There is no per-lane shift in SSE2, so the dword is broadcast, shifted
+ * right by two in the upper half, so that no channel touches the sign
+ * bit, masked, converted and then scaled by the remaining shifts.
+ */
+static void
+emit_load_10_10_10_2(struct translate_sse *p, struct x86_reg data,
+                     struct x86_reg arg0,
+                     const struct util_format_channel_description *chan)
+{
+   struct x86_reg tmpXMM = x86_make_reg(file_XMM, 1);
+
+   sse2_movd(p->func, data, arg0);
+   sse2_pshufd(p->func, data, data, SHUF(X, X, X, X));
+   sse2_movdqa(p->func, tmpXMM, data);
+   sse2_psrld_imm(p->func, tmpXMM, 2);
+   sse_shufps(p->func, data, tmpXMM, SHUF(X, X, X, X));
+   sse_andps(p->func, data, get_const(p, CONST_1010102_MASK));
+   sse2_cvtdq2ps(p->func, data, data);
+   sse_mulps(p->func, data, get_const(p, CONST_1010102_SCALE));
+
+   if (chan->type == UTIL_FORMAT_TYPE_SIGNED) {
+      /* data -= data >= 2^(n-1) ? 2^n : 0 */
+      sse_movaps(p->func, tmpXMM, data);
+      sse_cmpps(p->func, tmpXMM, get_const(p, CONST_1010102_SIGN),
+                cc_NotLessThan);
+      sse_andps(p->func, tmpXMM, get_const(p, CONST_1010102_BIAS));
+      sse_subps(p->func, data, tmpXMM);
+   }
+
+   if (chan->normalized) {
+      sse_mulps(p->func, data,
+                get_const(p, chan->type == UTIL_FORMAT_TYPE_SIGNED ?
+                             CONST_INV_1010102_SNORM :
+                             CONST_INV_1010102_UNORM));
+   }
+}
+
+
+/* whether the format is one of the [RB]10G10[BR]10A2 unorm/snorm/scaled
+ * vertex formats
+ */
+static boolean
+is_10_10_10_2(const struct util_format_description *desc)
+{
+   unsigned i;
+
+   if (desc->layout != UTIL_FORMAT_LAYOUT_PLAIN ||
+       desc->block.bits != 32 ||
+       desc->nr_channels != 4)
+      return FALSE;
+
+   for (i = 0; i < 4; i++) {
+      if (desc->channel[i].type != desc->channel[0].type ||
+          desc->channel[i].normalized != desc->channel[0].normalized ||
+          desc->channel[i].pure_integer ||
+          desc->channel[i].size != (i < 3 ? 10 : 2) ||
+          desc->channel[i].shift != i * 10)
+         return FALSE;
+   }
+
+   return desc->channel[0].type == UTIL_FORMAT_TYPE_UNSIGNED ||
+          desc->channel[0].type == UTIL_FORMAT_TYPE_SIGNED;
+}
+
+
 static void
 emit_mov64(struct translate_sse *p, struct x86_reg dst_gpr,
            struct x86_reg dst_xmm, struct x86_reg src_gpr,
@@ -471,18 +598,21 @@ translate_attr_convert(struct translate_sse *p,
         UTIL_FORMAT_SWIZZLE_NONE, UTIL_FORMAT_SWIZZLE_NONE };
    unsigned needed_chans = 0;
    unsigned imms[2] = { 0, 0x3f800000 };
+   boolean packed_10_10_10_2;
 
    if (a->output_format == PIPE_FORMAT_NONE
        || a->input_format == PIPE_FORMAT_NONE)
       return FALSE;
 
-   if (input_desc->channel[0].size & 7)
+   packed_10_10_10_2 = is_10_10_10_2(input_desc);
+
+   if ((input_desc->channel[0].size & 7) && !packed_10_10_10_2)
       return FALSE;
 
    if (input_desc->colorspace != output_desc->colorspace)
       return FALSE;
 
-   for (i = 1; i < input_desc->nr_channels; ++i) {
+   for (i = 1; i < input_desc->nr_channels && !packed_10_10_10_2; ++i) {
       if (memcmp
           (&input_desc->channel[i], &input_desc->channel[0],
            sizeof(input_desc->channel[0])))
@@ -527,6 +657,10 @@ translate_attr_convert(struct translate_sse *p,
          case UTIL_FORMAT_TYPE_UNSIGNED:
             if (!(x86_target_caps(p->func) & X86_SSE2))
                return FALSE;
+            if (packed_10_10_10_2) {
+               emit_load_10_10_10_2(p, dataXMM, src, &input_desc->channel[0]);
+               break;
+            }
             emit_load_sse2(p, dataXMM, src,
                            input_desc->channel[0].size *
                            input_desc->nr_channels >> 3);
@@ -579,6 +713,10 @@ translate_attr_convert(struct translate_sse *p,
          case UTIL_FORMAT_TYPE_SIGNED:
             if (!(x86_target_caps(p->func) & X86_SSE2))
                return FALSE;
+            if (packed_10_10_10_2) {
+               emit_load_10_10_10_2(p, dataXMM, src, &input_desc->channel[0]);
+               break;
+            }
             emit_load_sse2(p, dataXMM, src,
                            input_desc->channel[0].size *
                            input_desc->nr_channels >> 3);
@@ -626,6 +764,13 @@ translate_attr_convert(struct translate_sse *p,
 
             break;
          case UTIL_FORMAT_TYPE_FLOAT:
+            if (input_desc->channel[0].size == 16) {
+               if (!(x86_target_caps(p->func) & X86_SSE2))
+                  return FALSE;
+               emit_load_float16to32(p, dataXMM, src,
+                                     input_desc->nr_channels);
+               break;
+            }
             if (input_desc->channel[0].size != 32
                 && input_desc->channel[0].size != 64) {
                return FALSE;
@@ -725,6 +870,10 @@ translate_attr_convert(struct translate_sse *p,
       }
       return TRUE;
    }
+   else if (packed_10_10_10_2) {
+      /* only the conversion to floats is implemented */
+      return FALSE;
+   }
    else if ((x86_target_caps(p->func) & X86_SSE2)
             && input_desc->channel[0].size == 8
             && output_desc->channel[0].size == 16
@@ -1489,6 +1638,7 @@ translate_sse2_create(const struct translate_key *key)
 
    memset(p, 0, sizeof(*p));
    memcpy(p->consts, consts, sizeof(consts));
+   memcpy(p->consts[NUM_FLOAT_CONSTS], int_consts, sizeof(int_consts));
 
    p->translate.key = *key;
    p->translate.release = translate_sse_release;
@@ -584,9 +584,9 @@ static void blitter_restore_textures(struct blitter_context_priv *ctx)
    ctx->base.saved_num_sampler_views = ~0;
 }
 
-static void blitter_set_rectangle(struct blitter_context_priv *ctx,
-                                  int x1, int y1, int x2, int y2,
-                                  float depth)
+static void blitter_set_rectangle_pos(struct blitter_context_priv *ctx,
+                                      int x1, int y1, int x2, int y2,
+                                      float depth)
 {
    int i;
 
@@ -605,8 +605,10 @@ static void blitter_set_rectangle(struct blitter_context_priv *ctx,
 
    for (i = 0; i < 4; i++)
       ctx->vertices[i][0][2] = depth; /*z*/
+}
 
-   /* viewport */
+static void blitter_set_viewport(struct blitter_context_priv *ctx)
+{
    ctx->viewport.scale[0] = 0.5f * ctx->dst_width;
    ctx->viewport.scale[1] = 0.5f * ctx->dst_height;
    ctx->viewport.scale[2] = 1.0f;
@@ -618,6 +620,14 @@ static void blitter_set_rectangle(struct blitter_context_priv *ctx,
    ctx->base.pipe->set_viewport_states(ctx->base.pipe, 0, 1, &ctx->viewport);
 }
 
+static void blitter_set_rectangle(struct blitter_context_priv *ctx,
+                                  int x1, int y1, int x2, int y2,
+                                  float depth)
+{
+   blitter_set_rectangle_pos(ctx, x1, y1, x2, y2, depth);
+   blitter_set_viewport(ctx);
+}
+
 static void blitter_set_clear_color(struct blitter_context_priv *ctx,
                                     const union pipe_color_union *color)
 {
@@ -1057,6 +1067,67 @@ void util_blitter_draw_rectangle(struct blitter_context *blitter,
    blitter_draw(ctx, x1, y1, x2, y2, depth, 1);
 }
 
+/**
+ * Draw several rectangles, with either texcoords (one set per rectangle)
+ * or a clear color (the same for all of them) as the generic attrib.
+ * Unless the driver overrides draw_rectangle, they all go into one vertex
+ * buffer and are drawn as a triangle list with a single draw call.
+ */
+static void blitter_draw_rects(struct blitter_context_priv *ctx,
+                               const struct pipe_box *boxes,
+                               unsigned num_rects,
+                               enum blitter_attrib_type type,
+                               const union pipe_color_union *attribs)
+{
+   static const unsigned quad_to_tris[6] = {0, 1, 2, 0, 2, 3};
+   struct pipe_context *pipe = ctx->base.pipe;
+   struct pipe_vertex_buffer vb = {0};
+   float (*verts)[2][4];
+   unsigned i, j;
+
+   if (num_rects == 1 ||
+       ctx->base.draw_rectangle != util_blitter_draw_rectangle) {
+      for (i = 0; i < num_rects; i++) {
+         const struct pipe_box *box = &boxes[i];
+         ctx->base.draw_rectangle(&ctx->base, box->x, box->y,
+                                  box->x + box->width, box->y + box->height,
+                                  0, type,
+                                  type == UTIL_BLITTER_ATTRIB_TEXCOORD ?
+                                  &attribs[i] : attribs);
+      }
+      return;
+   }
+
+   vb.stride = 8 * sizeof(float);
+
+   if (u_upload_alloc(ctx->upload, 0, num_rects * 6 * vb.stride,
+                      &vb.buffer_offset, &vb.buffer,
+                      (void **)&verts) != PIPE_OK)
+      return;
+
+   if (type == UTIL_BLITTER_ATTRIB_COLOR)
+      blitter_set_clear_color(ctx, attribs);
+
+   for (i = 0; i < num_rects; i++) {
+      const struct pipe_box *box = &boxes[i];
+
+      blitter_set_rectangle_pos(ctx, box->x, box->y,
+                                box->x + box->width, box->y + box->height, 0);
+      if (type == UTIL_BLITTER_ATTRIB_TEXCOORD)
+         set_texcoords_in_vertices(attribs[i].f, &ctx->vertices[0][1][0], 8);
+
+      for (j = 0; j < 6; j++)
+         memcpy(verts[i * 6 + j], ctx->vertices[quad_to_tris[j]],
+                sizeof(ctx->vertices[0]));
+   }
+   u_upload_unmap(ctx->upload);
+
+   blitter_set_viewport(ctx);
+   pipe->set_vertex_buffers(pipe, ctx->base.vb_slot, 1, &vb);
+   util_draw_arrays(pipe, PIPE_PRIM_TRIANGLES, 0, num_rects * 6);
+   pipe_resource_reference(&vb.buffer, NULL);
+}
+
 static void *get_clear_blend_state(struct blitter_context_priv *ctx,
                                    unsigned clear_buffers)
 {
@@ -1338,6 +1409,73 @@ void util_blitter_copy_texture(struct blitter_context *blitter,
    pipe_sampler_view_reference(&src_view, NULL);
 }
 
+/* Draw one rectangle of a blit, layer by layer and sample by sample. */
+static void blitter_draw_blit_layers(struct blitter_context_priv *ctx,
+                                     struct pipe_framebuffer_state *fb_state,
+                                     boolean blit_zs,
+                                     struct pipe_surface *dst,
+                                     const struct pipe_box *dstbox,
+                                     struct pipe_sampler_view *src,
+                                     const struct pipe_box *srcbox,
+                                     unsigned src_width0, unsigned src_height0)
+{
+   struct pipe_context *pipe = ctx->base.pipe;
+   unsigned src_samples = src->texture->nr_samples;
+   unsigned dst_samples = dst->texture->nr_samples;
+   int z;
+
+   for (z = 0; z < dstbox->depth; z++) {
+      struct pipe_surface *old;
+
+      /* Set framebuffer state. */
+      if (blit_zs) {
+         fb_state->zsbuf = dst;
+      } else {
+         fb_state->cbufs[0] = dst;
+      }
+      pipe->set_framebuffer_state(pipe, fb_state);
+
+      /* See if we need to blit a multisample or singlesample buffer. */
+      if (src_samples == dst_samples && dst_samples > 1) {
+         /* MSAA copy. */
+         unsigned i, max_sample = dst_samples - 1;
+
+         for (i = 0; i <= max_sample; i++) {
+            pipe->set_sample_mask(pipe, 1 << i);
+            blitter_set_texcoords(ctx, src, src_width0, src_height0,
+                                  srcbox->z + z,
+                                  i, srcbox->x, srcbox->y,
+                                  srcbox->x + srcbox->width,
+                                  srcbox->y + srcbox->height);
+            blitter_draw(ctx, dstbox->x, dstbox->y,
+                         dstbox->x + dstbox->width,
+                         dstbox->y + dstbox->height, 0, 1);
+         }
+      } else {
+         /* Normal copy, MSAA upsampling, or MSAA resolve. */
+         pipe->set_sample_mask(pipe, ~0);
+         blitter_set_texcoords(ctx, src, src_width0, src_height0,
+                               srcbox->z + z, 0,
+                               srcbox->x, srcbox->y,
+                               srcbox->x + srcbox->width,
+                               srcbox->y + srcbox->height);
+         blitter_draw(ctx, dstbox->x, dstbox->y,
+                      dstbox->x + dstbox->width,
+                      dstbox->y + dstbox->height, 0, 1);
+      }
+
+      /* Get the next surface or (if this is the last iteration)
+       * just unreference the last one. */
+      old = dst;
+      if (z < dstbox->depth-1) {
+         dst = ctx->base.get_next_surface_layer(ctx->base.pipe, dst);
+      }
+      if (z) {
+         pipe_surface_reference(&old, NULL);
+      }
+   }
+}
+
 void util_blitter_blit_generic(struct blitter_context *blitter,
                                struct pipe_surface *dst,
                                const struct pipe_box *dstbox,
@@ -1346,6 +1484,23 @@ void util_blitter_blit_generic(struct blitter_context *blitter,
                                unsigned src_width0, unsigned src_height0,
                                unsigned mask, unsigned filter,
                                const struct pipe_scissor_state *scissor)
+{
+   util_blitter_blit_rects(blitter, dst, dstbox, src, srcbox, 1,
+                           src_width0, src_height0, mask, filter, scissor);
+}
+
+/** Maximum number of rectangles drawn with one draw call */
+#define BLITTER_MAX_BATCH_RECTS 32
+
+void util_blitter_blit_rects(struct blitter_context *blitter,
+                             struct pipe_surface *dst,
+                             const struct pipe_box *dstboxes,
+                             struct pipe_sampler_view *src,
+                             const struct pipe_box *srcboxes,
+                             unsigned num_rects,
+                             unsigned src_width0, unsigned src_height0,
+                             unsigned mask, unsigned filter,
+                             const struct pipe_scissor_state *scissor)
 {
    struct blitter_context_priv *ctx = (struct blitter_context_priv*)blitter;
    struct pipe_context *pipe = ctx->base.pipe;
@@ -1355,7 +1510,9 @@ void util_blitter_blit_generic(struct blitter_context *blitter,
    unsigned dst_samples = dst->texture->nr_samples;
    boolean has_depth, has_stencil, has_color;
    boolean blit_stencil, blit_depth, blit_color;
+   boolean scaled;
    void *sampler_state;
+   unsigned i;
    const struct util_format_description *src_desc =
          util_format_description(src->format);
    const struct util_format_description *dst_desc =
@@ -1377,9 +1534,16 @@ void util_blitter_blit_generic(struct blitter_context *blitter,
       return;
    }
 
-   if (blit_stencil ||
-       (dstbox->width == abs(srcbox->width) &&
-        dstbox->height == abs(srcbox->height))) {
+   scaled = FALSE;
+   for (i = 0; i < num_rects; i++) {
+      if (dstboxes[i].width != abs(srcboxes[i].width) ||
+          dstboxes[i].height != abs(srcboxes[i].height)) {
+         scaled = TRUE;
+         break;
+      }
+   }
+
+   if (blit_stencil || !scaled) {
       filter = PIPE_TEX_FILTER_NEAREST;
    }
 
@@ -1496,16 +1660,13 @@ void util_blitter_blit_generic(struct blitter_context *blitter,
         src_target == PIPE_TEXTURE_2D ||
         src_target == PIPE_TEXTURE_RECT) &&
        src_samples <= 1) {
-      /* Draw the quad with the draw_rectangle callback. */
+      /* Draw the quads with the draw_rectangle callback, or all at once. */
 
-      /* Set texture coordinates. - use a pipe color union
-       * for interface purposes.
+      /* Texture coordinates are passed in a pipe color union.
        * XXX pipe_color_union is a wrong name since we use that to set
        * texture coordinates too.
        */
-      union pipe_color_union coord;
-      get_texcoords(src, src_width0, src_height0, srcbox->x, srcbox->y,
-                    srcbox->x+srcbox->width, srcbox->y+srcbox->height, coord.f);
+      union pipe_color_union coords[BLITTER_MAX_BATCH_RECTS];
 
       /* Set framebuffer state. */
       if (blit_depth || blit_stencil) {
@@ -1517,62 +1678,26 @@ void util_blitter_blit_generic(struct blitter_context *blitter,
 
       /* Draw. */
       pipe->set_sample_mask(pipe, ~0);
-      blitter->draw_rectangle(blitter, dstbox->x, dstbox->y,
-                              dstbox->x + dstbox->width,
-                              dstbox->y + dstbox->height, 0,
-                              UTIL_BLITTER_ATTRIB_TEXCOORD, &coord);
-   } else {
-      /* Draw the quad with the generic codepath. */
-      int z;
-      for (z = 0; z < dstbox->depth; z++) {
-         struct pipe_surface *old;
-
-         /* Set framebuffer state. */
-         if (blit_depth || blit_stencil) {
-            fb_state.zsbuf = dst;
-         } else {
-            fb_state.cbufs[0] = dst;
-         }
-         pipe->set_framebuffer_state(pipe, &fb_state);
-
-         /* See if we need to blit a multisample or singlesample buffer. */
-         if (src_samples == dst_samples && dst_samples > 1) {
-            /* MSAA copy. */
-            unsigned i, max_sample = dst_samples - 1;
-
-            for (i = 0; i <= max_sample; i++) {
-               pipe->set_sample_mask(pipe, 1 << i);
-               blitter_set_texcoords(ctx, src, src_width0, src_height0,
-                                     srcbox->z + z,
-                                     i, srcbox->x, srcbox->y,
-                                     srcbox->x + srcbox->width,
-                                     srcbox->y + srcbox->height);
-               blitter_draw(ctx, dstbox->x, dstbox->y,
-                            dstbox->x + dstbox->width,
-                            dstbox->y + dstbox->height, 0, 1);
-            }
-         } else {
-            /* Normal copy, MSAA upsampling, or MSAA resolve. */
-            pipe->set_sample_mask(pipe, ~0);
-            blitter_set_texcoords(ctx, src, src_width0, src_height0,
-                                  srcbox->z + z, 0,
-                                  srcbox->x, srcbox->y,
-                                  srcbox->x + srcbox->width,
-                                  srcbox->y + srcbox->height);
-            blitter_draw(ctx, dstbox->x, dstbox->y,
-                         dstbox->x + dstbox->width,
-                         dstbox->y + dstbox->height, 0, 1);
-         }
-
-         /* Get the next surface or (if this is the last iteration)
-          * just unreference the last one. */
-         old = dst;
-         if (z < dstbox->depth-1) {
-            dst = ctx->base.get_next_surface_layer(ctx->base.pipe, dst);
-         }
-         if (z) {
-            pipe_surface_reference(&old, NULL);
+      for (i = 0; i < num_rects; i += BLITTER_MAX_BATCH_RECTS) {
+         unsigned n = MIN2(num_rects - i, BLITTER_MAX_BATCH_RECTS);
+         unsigned j;
+
+         for (j = 0; j < n; j++) {
+            const struct pipe_box *srcbox = &srcboxes[i + j];
+            get_texcoords(src, src_width0, src_height0,
+                          srcbox->x, srcbox->y,
+                          srcbox->x + srcbox->width,
+                          srcbox->y + srcbox->height, coords[j].f);
          }
+         blitter_draw_rects(ctx, &dstboxes[i], n,
+                            UTIL_BLITTER_ATTRIB_TEXCOORD, coords);
+      }
+   } else {
+      /* Draw the quads with the generic codepath. */
+      for (i = 0; i < num_rects; i++) {
+         blitter_draw_blit_layers(ctx, &fb_state, blit_depth || blit_stencil,
+                                  dst, &dstboxes[i], src, &srcboxes[i],
+                                  src_width0, src_height0);
       }
    }
 
@@ -1625,6 +1750,19 @@ void util_blitter_clear_render_target(struct blitter_context *blitter,
                                       const union pipe_color_union *color,
                                       unsigned dstx, unsigned dsty,
                                       unsigned width, unsigned height)
+{
+   struct pipe_box box;
+
+   u_box_2d(dstx, dsty, width, height, &box);
+   util_blitter_clear_render_target_rects(blitter, dstsurf, color, &box, 1);
+}
+
+/* Clear several regions of a color surface to a constant value. */
+void util_blitter_clear_render_target_rects(struct blitter_context *blitter,
+                                            struct pipe_surface *dstsurf,
+                                            const union pipe_color_union *color,
+                                            const struct pipe_box *boxes,
+                                            unsigned num_rects)
 {
    struct blitter_context_priv *ctx = (struct blitter_context_priv*)blitter;
    struct pipe_context *pipe = ctx->base.pipe;
@@ -1658,8 +1796,7 @@ void util_blitter_clear_render_target(struct blitter_context *blitter,
 
    blitter_set_common_draw_rect_state(ctx, FALSE, FALSE);
    blitter_set_dst_dimensions(ctx, dstsurf->width, dstsurf->height);
-   blitter->draw_rectangle(blitter, dstx, dsty, dstx+width, dsty+height, 0,
-                           UTIL_BLITTER_ATTRIB_COLOR, color);
+   blitter_draw_rects(ctx, boxes, num_rects, UTIL_BLITTER_ATTRIB_COLOR, color);
 
    blitter_restore_vertex_states(ctx);
    blitter_restore_fragment_states(ctx);
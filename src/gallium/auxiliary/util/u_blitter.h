@@ -248,6 +248,25 @@ void util_blitter_blit_generic(struct blitter_context *blitter,
                                unsigned mask, unsigned filter,
                                const struct pipe_scissor_state *scissor);
 
+/**
+ * Like util_blitter_blit_generic, for several rectangles sharing the
+ * source, the destination, the mask, the filter and the scissor.
+ *
+ * The states are set up once for the whole batch, and unless the driver
+ * overrides draw_rectangle, the rectangles of 1D, 2D and RECT blits from
+ * single-sampled sources are drawn with a single draw call.  The filter is
+ * only used if at least one of the rectangles is scaled.
+ */
+void util_blitter_blit_rects(struct blitter_context *blitter,
+                             struct pipe_surface *dst,
+                             const struct pipe_box *dstboxes,
+                             struct pipe_sampler_view *src,
+                             const struct pipe_box *srcboxes,
+                             unsigned num_rects,
+                             unsigned src_width0, unsigned src_height0,
+                             unsigned mask, unsigned filter,
+                             const struct pipe_scissor_state *scissor);
+
 void util_blitter_blit(struct blitter_context *blitter,
 		       const struct pipe_blit_info *info);
 
@@ -311,6 +330,17 @@ void util_blitter_clear_render_target(struct blitter_context *blitter,
                                       unsigned dstx, unsigned dsty,
                                       unsigned width, unsigned height);
 
+/**
+ * Clear several regions of a color surface to a constant value, with all
+ * the rectangles drawn at once.  Only the x, y, width and height of the
+ * boxes are used.
+ */
+void util_blitter_clear_render_target_rects(struct blitter_context *blitter,
+                                            struct pipe_surface *dst,
+                                            const union pipe_color_union *color,
+                                            const struct pipe_box *boxes,
+                                            unsigned num_rects);
+
 /**
  * Clear a region of a depth-stencil surface, both stencil and depth
  * or only one of them if this is a combined depth-stencil surface.
@@ -705,7 +705,9 @@ debug_print_transfer_flags(const char *msg, unsigned usage)
       FLAG(PIPE_TRANSFER_DONTBLOCK),
       FLAG(PIPE_TRANSFER_UNSYNCHRONIZED),
       FLAG(PIPE_TRANSFER_FLUSH_EXPLICIT),
-      FLAG(PIPE_TRANSFER_DISCARD_WHOLE_RESOURCE)
+      FLAG(PIPE_TRANSFER_DISCARD_WHOLE_RESOURCE),
+      FLAG(PIPE_TRANSFER_PERSISTENT),
+      FLAG(PIPE_TRANSFER_COHERENT)
    };
    unsigned i;
 
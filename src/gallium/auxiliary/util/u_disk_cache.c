@@ -0,0 +1,323 @@
+/**************************************************************************
+ *
+ * Copyright 2014 The Mesa Authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Persistent on-disk cache.  See u_disk_cache.h.
+ */
+
+
+#include "pipe/p_config.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#if defined(PIPE_OS_WINDOWS)
+#include <direct.h>
+#include <process.h>
+#elif defined(PIPE_OS_UNIX)
+#include <unistd.h>
+#endif
+
+#include "util/u_debug.h"
+#include "util/u_disk_cache.h"
+#include "util/u_hash.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "util/u_string.h"
+
+
+#define CACHE_MAGIC 0x4d444331  /* "MDC1" */
+
+
+struct util_disk_cache
+{
+   char path[1024];
+};
+
+
+/** Header of every cache file, followed by the key and then the data */
+struct cache_entry_header
+{
+   uint32_t magic;
+   uint32_t key_size;
+   uint32_t data_size;
+   uint32_t data_crc;
+};
+
+
+static boolean
+make_dir(const char *path)
+{
+   int ret;
+#if defined(PIPE_OS_WINDOWS)
+   ret = _mkdir(path);
+#else
+   ret = mkdir(path, 0755);
+#endif
+   return ret == 0 || errno == EEXIST;
+}
+
+
+/**
+ * Create a directory and all its missing parents.
+ */
+static boolean
+make_path(char *path)
+{
+   char *p;
+
+   for (p = path + 1; *p; p++) {
+      if (*p == '/' || *p == '\\') {
+         char c = *p;
+         *p = '\0';
+         make_dir(path);
+         *p = c;
+      }
+   }
+
+   return make_dir(path);
+}
+
+
+static unsigned
+get_pid(void)
+{
+#if defined(PIPE_OS_WINDOWS)
+   return (unsigned) _getpid();
+#elif defined(PIPE_OS_UNIX)
+   return (unsigned) getpid();
+#else
+   return 0;
+#endif
+}
+
+
+static const char *
+get_cache_dir(void)
+{
+   const char *dir = debug_get_option("MESA_SHADER_CACHE_DIR", NULL);
+   return dir && *dir ? dir : NULL;
+}
+
+
+boolean
+util_disk_cache_enabled(void)
+{
+   return get_cache_dir() != NULL;
+}
+
+
+struct util_disk_cache *
+util_disk_cache_create(const char *name)
+{
+   struct util_disk_cache *cache;
+   const char *dir;
+
+   dir = get_cache_dir();
+   if (!dir)
+      return NULL;
+
+   cache = CALLOC_STRUCT(util_disk_cache);
+   if (!cache)
+      return NULL;
+
+   util_snprintf(cache->path, sizeof cache->path, "%s/%s", dir, name);
+
+   if (!make_path(cache->path)) {
+      debug_printf("%s: failed to create %s\n", __FUNCTION__, cache->path);
+      FREE(cache);
+      return NULL;
+   }
+
+   return cache;
+}
+
+
+void
+util_disk_cache_destroy(struct util_disk_cache *cache)
+{
+   FREE(cache);
+}
+
+
+static void
+entry_filename(const struct util_disk_cache *cache,
+               const void *key, unsigned key_size,
+               char *filename, size_t size)
+{
+   util_snprintf(filename, size, "%s/%08x-%x",
+                 cache->path, util_hash_crc32(key, key_size), key_size);
+}
+
+
+/**
+ * Open an entry and check that it is for the given key.
+ * On success the file position is at the start of the data.
+ */
+static FILE *
+open_entry(struct util_disk_cache *cache,
+           const void *key, unsigned key_size,
+           struct cache_entry_header *header)
+{
+   char filename[1100];
+   void *stored_key;
+   FILE *f;
+
+   entry_filename(cache, key, key_size, filename, sizeof filename);
+
+   f = fopen(filename, "rb");
+   if (!f)
+      return NULL;
+
+   if (fread(header, sizeof *header, 1, f) != 1 ||
+       header->magic != CACHE_MAGIC ||
+       header->key_size != key_size) {
+      goto fail;
+   }
+
+   stored_key = MALLOC(key_size);
+   if (!stored_key)
+      goto fail;
+
+   if (fread(stored_key, 1, key_size, f) != key_size ||
+       memcmp(stored_key, key, key_size) != 0) {
+      FREE(stored_key);
+      goto fail;
+   }
+
+   FREE(stored_key);
+   return f;
+
+fail:
+   fclose(f);
+   return NULL;
+}
+
+
+boolean
+util_disk_cache_has(struct util_disk_cache *cache,
+                    const void *key, unsigned key_size)
+{
+   struct cache_entry_header header;
+   FILE *f;
+
+   if (!cache)
+      return FALSE;
+
+   f = open_entry(cache, key, key_size, &header);
+   if (!f)
+      return FALSE;
+
+   fclose(f);
+   return TRUE;
+}
+
+
+void *
+util_disk_cache_get(struct util_disk_cache *cache,
+                    const void *key, unsigned key_size,
+                    unsigned *size)
+{
+   struct cache_entry_header header;
+   void *data;
+   FILE *f;
+
+   if (!cache)
+      return NULL;
+
+   f = open_entry(cache, key, key_size, &header);
+   if (!f)
+      return NULL;
+
+   data = MALLOC(MAX2(header.data_size, 1));
+   if (!data ||
+       fread(data, 1, header.data_size, f) != header.data_size ||
+       util_hash_crc32(data, header.data_size) != header.data_crc) {
+      /* truncated or corrupted entry */
+      FREE(data);
+      fclose(f);
+      return NULL;
+   }
+
+   fclose(f);
+
+   *size = header.data_size;
+   return data;
+}
+
+
+boolean
+util_disk_cache_put(struct util_disk_cache *cache,
+                    const void *key, unsigned key_size,
+                    const void *data, unsigned size)
+{
+   struct cache_entry_header header;
+   char filename[1100];
+   char tmp_filename[1200];
+   boolean ok;
+   FILE *f;
+
+   if (!cache)
+      return FALSE;
+
+   entry_filename(cache, key, key_size, filename, sizeof filename);
+   util_snprintf(tmp_filename, sizeof tmp_filename, "%s.%u.tmp",
+                 filename, get_pid());
+
+   f = fopen(tmp_filename, "wb");
+   if (!f)
+      return FALSE;
+
+   header.magic = CACHE_MAGIC;
+   header.key_size = key_size;
+   header.data_size = size;
+   header.data_crc = util_hash_crc32(data, size);
+
+   ok = fwrite(&header, sizeof header, 1, f) == 1 &&
+        fwrite(key, 1, key_size, f) == key_size &&
+        fwrite(data, 1, size, f) == size;
+
+   if (fclose(f) != 0)
+      ok = FALSE;
+
+#if defined(PIPE_OS_WINDOWS)
+   /* rename() doesn't replace existing files on Windows */
+   if (ok)
+      remove(filename);
+#endif
+
+   if (!ok || rename(tmp_filename, filename) != 0) {
+      remove(tmp_filename);
+      return FALSE;
+   }
+
+   return TRUE;
+}
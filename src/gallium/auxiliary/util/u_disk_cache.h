@@ -0,0 +1,106 @@
+/**************************************************************************
+ *
+ * Copyright 2014 The Mesa Authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Simple persistent on-disk cache for compiled shaders and other blobs.
+ *
+ * Entries are stored one per file, named after a hash of the key.  The
+ * whole key is stored in the file too and compared on lookup, so hash
+ * collisions only cost a cache miss.  Files are written to a temporary
+ * name and renamed into place, so concurrent processes sharing the cache
+ * never see partial entries.
+ *
+ * The cache is only enabled when MESA_SHADER_CACHE_DIR is set.
+ */
+
+#ifndef U_DISK_CACHE_H_
+#define U_DISK_CACHE_H_
+
+
+#include "pipe/p_compiler.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+struct util_disk_cache;
+
+
+/**
+ * Whether MESA_SHADER_CACHE_DIR is set.
+ */
+boolean
+util_disk_cache_enabled(void);
+
+
+/**
+ * Open the cache in the given subdirectory of MESA_SHADER_CACHE_DIR.
+ *
+ * @return NULL if the cache is disabled or unusable
+ */
+struct util_disk_cache *
+util_disk_cache_create(const char *name);
+
+void
+util_disk_cache_destroy(struct util_disk_cache *cache);
+
+
+/**
+ * Look up an entry.
+ *
+ * @return a MALLOC'ed copy of the data, which the caller must FREE, or
+ * NULL on a miss
+ */
+void *
+util_disk_cache_get(struct util_disk_cache *cache,
+                    const void *key, unsigned key_size,
+                    unsigned *size);
+
+/**
+ * Check whether an entry exists, without reading its data.
+ */
+boolean
+util_disk_cache_has(struct util_disk_cache *cache,
+                    const void *key, unsigned key_size);
+
+/**
+ * Store an entry, replacing any previous entry with the same key.
+ */
+boolean
+util_disk_cache_put(struct util_disk_cache *cache,
+                    const void *key, unsigned key_size,
+                    const void *data, unsigned size);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* U_DISK_CACHE_H_ */
@@ -558,6 +558,142 @@ def generate_pack_kernel(format, src_channel, src_native_type):
         print '         memcpy(dst, &pixel, sizeof pixel);'
     
 
+def is_format_sse2_unorm(format):
+    '''Whether rows of the format can be converted four pixels at a time with
+    SSE2: 16 or 32 bit pixels made of unsigned normalized channels only.'''
+
+    if format.layout != PLAIN or format.colorspace != RGB:
+        return False
+    if format.block_width != 1 or format.block_height != 1:
+        return False
+    if format.block_size() not in (16, 32):
+        return False
+    for channel in format.channels:
+        if channel.type == VOID:
+            continue
+        if channel.type != UNSIGNED or not channel.norm or channel.size > 16:
+            return False
+    return True
+
+
+def is_format_sse2_8unorm(format):
+    '''Whether the format has 8 bit unorm channels in 32 bit pixels, so that
+    conversions from and to rgba_8unorm only move bytes around.'''
+
+    if not is_format_sse2_unorm(format) or format.block_size() != 32:
+        return False
+    for channel in format.channels:
+        if channel.type != VOID and channel.size != 8:
+            return False
+    return True
+
+
+def sse2_move_byte(value, src_shift, dst_shift):
+    '''Expression moving the byte at src_shift of each 32 bit lane to
+    dst_shift, clearing all the other bits.'''
+
+    if src_shift > dst_shift:
+        value = '_mm_srli_epi32(%s, %u)' % (value, src_shift - dst_shift)
+    elif src_shift < dst_shift:
+        value = '_mm_slli_epi32(%s, %u)' % (value, dst_shift - src_shift)
+    if abs(src_shift - dst_shift) != 24:
+        value = '_mm_and_si128(%s, _mm_set1_epi32(0x%x))' % (value, 0xff << dst_shift)
+    return value
+
+
+def sse2_or(terms):
+    if not terms:
+        return '_mm_setzero_si128()'
+    value = terms[0]
+    for term in terms[1:]:
+        value = '_mm_or_si128(%s, %s)' % (value, term)
+    return value
+
+
+def generate_sse2_unpack_float_kernel(format):
+    '''Unpack four pixels to floats, one channel per vector, and transpose
+    them.  The results are identical to the scalar code's.'''
+
+    if format.block_size() == 32:
+        print '         __m128i value = _mm_loadu_si128((const __m128i *)src);'
+    else:
+        print '         __m128i value = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i *)src), _mm_setzero_si128());'
+
+    for i in range(4):
+        swizzle = format.swizzles[i]
+        if swizzle < 4:
+            channel = format.channels[swizzle]
+            value = 'value'
+            if channel.shift:
+                value = '_mm_srli_epi32(%s, %u)' % (value, channel.shift)
+            if channel.shift + channel.size < 32:
+                value = '_mm_and_si128(%s, _mm_set1_epi32(0x%x))' % (value, (1 << channel.size) - 1)
+            value = '_mm_mul_ps(_mm_cvtepi32_ps(%s), _mm_set1_ps(1.0f/0x%x))' % (value, get_one(channel))
+        elif swizzle == SWIZZLE_1:
+            value = '_mm_set1_ps(1.0f)'
+        else:
+            value = '_mm_setzero_ps()'
+        print '         __m128 %s = %s;' % ('rgba'[i], value)
+
+    print '         _MM_TRANSPOSE4_PS(r, g, b, a);'
+    print '         _mm_storeu_ps(dst + 0, r);'
+    print '         _mm_storeu_ps(dst + 4, g);'
+    print '         _mm_storeu_ps(dst + 8, b);'
+    print '         _mm_storeu_ps(dst + 12, a);'
+
+
+def generate_sse2_unpack_8unorm_kernel(format):
+    '''Unpack four pixels to rgba_8unorm.'''
+
+    print '         __m128i value = _mm_loadu_si128((const __m128i *)src);'
+
+    terms = []
+    ones = 0
+    for i in range(4):
+        swizzle = format.swizzles[i]
+        if swizzle < 4:
+            terms.append(sse2_move_byte('value', format.channels[swizzle].shift, 8*i))
+        elif swizzle == SWIZZLE_1:
+            ones |= 0xff << (8*i)
+    if ones:
+        terms.append('_mm_set1_epi32(0x%x)' % ones)
+
+    print '         _mm_storeu_si128((__m128i *)dst, %s);' % sse2_or(terms)
+
+
+def generate_sse2_pack_8unorm_kernel(format):
+    '''Pack four rgba_8unorm pixels.'''
+
+    print '         __m128i value = _mm_loadu_si128((const __m128i *)src);'
+
+    terms = []
+    inv_swizzle = format.inv_swizzles()
+    for i in range(4):
+        if inv_swizzle[i] is not None:
+            terms.append(sse2_move_byte('value', 8*inv_swizzle[i], format.channels[i].shift))
+
+    print '         _mm_storeu_si128((__m128i *)dst, %s);' % sse2_or(terms)
+
+
+def generate_format_loops(format, sse2_kernel, src_stride, dst_stride):
+    '''Open the loops over the pixels, with a loop over groups of four pixels
+    done with the given kernel first if there is one.'''
+
+    if sse2_kernel is None:
+        print '      for(x = 0; x < width; x += %u) {' % (format.block_width,)
+        return
+
+    print '      x = 0;'
+    print '#ifdef PIPE_ARCH_SSE'
+    print '      for(; x + 4 <= width; x += 4) {'
+    sse2_kernel(format)
+    print '         src += %u;' % (4 * src_stride,)
+    print '         dst += %u;' % (4 * dst_stride,)
+    print '      }'
+    print '#endif'
+    print '      for(; x < width; x += %u) {' % (format.block_width,)
+
+
 def generate_format_unpack(format, dst_channel, dst_native_type, dst_suffix):
     '''Generate the function to unpack pixels from a particular format'''
 
@@ -568,12 +704,18 @@ def generate_format_unpack(format, dst_channel, dst_native_type, dst_suffix):
     print '{'
 
     if is_format_supported(format):
+        sse2_kernel = None
+        if dst_suffix == 'rgba_float' and is_format_sse2_unorm(format):
+            sse2_kernel = generate_sse2_unpack_float_kernel
+        elif dst_suffix == 'rgba_8unorm' and is_format_sse2_8unorm(format):
+            sse2_kernel = generate_sse2_unpack_8unorm_kernel
+
         print '   unsigned x, y;'
         print '   for(y = 0; y < height; y += %u) {' % (format.block_height,)
         print '      %s *dst = dst_row;' % (dst_native_type)
         print '      const uint8_t *src = src_row;'
-        print '      for(x = 0; x < width; x += %u) {' % (format.block_width,)
-        
+
+        generate_format_loops(format, sse2_kernel, format.block_size() / 8, 4)
         generate_unpack_kernel(format, dst_channel, dst_native_type)
     
         print '         src += %u;' % (format.block_size() / 8,)
@@ -597,12 +739,16 @@ def generate_format_pack(format, src_channel, src_native_type, src_suffix):
     print '{'
     
     if is_format_supported(format):
+        sse2_kernel = None
+        if src_suffix == 'rgba_8unorm' and is_format_sse2_8unorm(format):
+            sse2_kernel = generate_sse2_pack_8unorm_kernel
+
         print '   unsigned x, y;'
         print '   for(y = 0; y < height; y += %u) {' % (format.block_height,)
         print '      const %s *src = src_row;' % (src_native_type)
         print '      uint8_t *dst = dst_row;'
-        print '      for(x = 0; x < width; x += %u) {' % (format.block_width,)
-    
+
+        generate_format_loops(format, sse2_kernel, 4, format.block_size() / 8)
         generate_pack_kernel(format, src_channel, src_native_type)
             
         print '         src += 4;'
@@ -646,6 +792,7 @@ def generate(formats):
     print '#include "u_format_srgb.h"'
     print '#include "u_format_yuv.h"'
     print '#include "u_format_zs.h"'
+    print '#include "u_sse.h"'
     print
 
     for format in formats:
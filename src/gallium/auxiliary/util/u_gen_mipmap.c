@@ -903,7 +903,12 @@ do_row_3D(enum dtype datatype, uint comps, int srcWidth,
 
 
 
-static void
+/**
+ * Map the format to one of the hand-written filters of do_row() and
+ * do_row_3D().
+ * \return FALSE if there's none for the format
+ */
+static boolean
 format_to_type_comps(enum pipe_format pformat,
                      enum dtype *datatype, uint *comps)
 {
@@ -922,41 +927,119 @@ format_to_type_comps(enum pipe_format pformat,
    case PIPE_FORMAT_R8G8B8_SRGB:
       *datatype = DTYPE_UBYTE;
       *comps = 4;
-      return;
+      return TRUE;
    case PIPE_FORMAT_B5G5R5X1_UNORM:
    case PIPE_FORMAT_B5G5R5A1_UNORM:
       *datatype = DTYPE_USHORT_1_5_5_5_REV;
       *comps = 4;
-      return;
+      return TRUE;
    case PIPE_FORMAT_B4G4R4A4_UNORM:
       *datatype = DTYPE_USHORT_4_4_4_4;
       *comps = 4;
-      return;
+      return TRUE;
    case PIPE_FORMAT_B5G6R5_UNORM:
       *datatype = DTYPE_USHORT_5_6_5;
       *comps = 3;
-      return;
+      return TRUE;
    case PIPE_FORMAT_L8_UNORM:
    case PIPE_FORMAT_L8_SRGB:
    case PIPE_FORMAT_A8_UNORM:
    case PIPE_FORMAT_I8_UNORM:
       *datatype = DTYPE_UBYTE;
       *comps = 1;
-      return;
+      return TRUE;
    case PIPE_FORMAT_L8A8_UNORM:
    case PIPE_FORMAT_L8A8_SRGB:
       *datatype = DTYPE_UBYTE;
       *comps = 2;
-      return;
+      return TRUE;
    default:
-      assert(0);
       *datatype = DTYPE_UBYTE;
       *comps = 0;
-      break;
+      return FALSE;
    }
 }
 
 
+/**
+ * Whether do_row_float() can filter the format.
+ */
+static boolean
+is_format_float_filterable(enum pipe_format pformat)
+{
+   const struct util_format_description *desc =
+      util_format_description(pformat);
+
+   return desc &&
+          desc->block.width == 1 &&
+          desc->block.height == 1 &&
+          desc->colorspace != UTIL_FORMAT_COLORSPACE_ZS &&
+          desc->unpack_rgba_float &&
+          desc->pack_rgba_float &&
+          !util_format_is_pure_integer(pformat);
+}
+
+
+/**
+ * Format-independent version of do_row() and do_row_3D(), for the formats
+ * which have no hand-written filter.  The source rows are unpacked to
+ * floats and averaged, then packed into the dest row.  The unpack and pack
+ * functions have SIMD row loops for the common formats, so this isn't much
+ * slower than the integer filters.
+ * \param srcRowC, srcRowD  NULL unless filtering between two images
+ * \param tmp  scratch space for 2 * srcWidth pixels
+ */
+static void
+do_row_float(const struct util_format_description *desc, int srcWidth,
+             const void *srcRowA, const void *srcRowB,
+             const void *srcRowC, const void *srcRowD,
+             int dstWidth, void *dstRow, float (*tmp)[4])
+{
+   const uint k0 = (srcWidth == dstWidth) ? 0 : 1;
+   const uint colStride = (srcWidth == dstWidth) ? 1 : 2;
+   const void *rows[4];
+   float (*sum)[4] = tmp;
+   float (*row)[4] = tmp + srcWidth;
+   uint num_rows = 2, r, i, j, k;
+   float scale;
+
+   rows[0] = srcRowA;
+   rows[1] = srcRowB;
+   if (srcRowC) {
+      rows[2] = srcRowC;
+      rows[3] = srcRowD;
+      num_rows = 4;
+   }
+
+   desc->unpack_rgba_float(&sum[0][0], 0, rows[0], 0, srcWidth, 1);
+   for (r = 1; r < num_rows; r++) {
+      desc->unpack_rgba_float(&row[0][0], 0, rows[r], 0, srcWidth, 1);
+      for (i = 0; i < (uint) srcWidth; i++) {
+         sum[i][0] += row[i][0];
+         sum[i][1] += row[i][1];
+         sum[i][2] += row[i][2];
+         sum[i][3] += row[i][3];
+      }
+   }
+
+   /* Horizontal pass, in place since j >= i */
+   scale = 1.0f / (float) (2 * num_rows);
+   for (i = j = 0, k = k0; i < (uint) dstWidth;
+        i++, j += colStride, k += colStride) {
+      float p0 = (sum[j][0] + sum[k][0]) * scale;
+      float p1 = (sum[j][1] + sum[k][1]) * scale;
+      float p2 = (sum[j][2] + sum[k][2]) * scale;
+      float p3 = (sum[j][3] + sum[k][3]) * scale;
+      sum[i][0] = p0;
+      sum[i][1] = p1;
+      sum[i][2] = p2;
+      sum[i][3] = p3;
+   }
+
+   desc->pack_rgba_float(dstRow, 0, &sum[0][0], 0, dstWidth, 1);
+}
+
+
 static void
 reduce_1d(enum pipe_format pformat,
           int srcWidth, const ubyte *srcPtr,
@@ -965,7 +1048,15 @@ reduce_1d(enum pipe_format pformat,
    enum dtype datatype;
    uint comps;
 
-   format_to_type_comps(pformat, &datatype, &comps);
+   if (!format_to_type_comps(pformat, &datatype, &comps)) {
+      float (*tmp)[4] = MALLOC(2 * srcWidth * sizeof *tmp);
+      if (tmp) {
+         do_row_float(util_format_description(pformat), srcWidth,
+                      srcPtr, srcPtr, NULL, NULL, dstWidth, dstPtr, tmp);
+         FREE(tmp);
+      }
+      return;
+   }
 
    /* we just duplicate the input row, kind of hack, saves code */
    do_row(datatype, comps,
@@ -990,8 +1081,13 @@ reduce_2d(enum pipe_format pformat,
    const ubyte *srcA, *srcB;
    ubyte *dst;
    int row;
+   float (*tmp)[4] = NULL;
 
-   format_to_type_comps(pformat, &datatype, &comps);
+   if (!format_to_type_comps(pformat, &datatype, &comps)) {
+      tmp = MALLOC(2 * srcWidth * sizeof *tmp);
+      if (!tmp)
+         return;
+   }
 
    if (!srcRowStride)
       srcRowStride = bpt * srcWidth;
@@ -1008,13 +1104,19 @@ reduce_2d(enum pipe_format pformat,
    dst = dstPtr;
 
    for (row = 0; row < dstHeight; row++) {
-      do_row(datatype, comps,
-             srcWidth, srcA, srcB,
-             dstWidth, dst);
+      if (tmp)
+         do_row_float(util_format_description(pformat), srcWidth,
+                      srcA, srcB, NULL, NULL, dstWidth, dst, tmp);
+      else
+         do_row(datatype, comps,
+                srcWidth, srcA, srcB,
+                dstWidth, dst);
       srcA += 2 * srcRowStride;
       srcB += 2 * srcRowStride;
       dst += dstRowStride;
    }
+
+   FREE(tmp);
 }
 
 
@@ -1030,8 +1132,13 @@ reduce_3d(enum pipe_format pformat,
    int srcImageOffset, srcRowOffset;
    enum dtype datatype;
    uint comps;
+   float (*tmp)[4] = NULL;
 
-   format_to_type_comps(pformat, &datatype, &comps);
+   if (!format_to_type_comps(pformat, &datatype, &comps)) {
+      tmp = MALLOC(2 * srcWidth * sizeof *tmp);
+      if (!tmp)
+         return;
+   }
 
    /* XXX I think we should rather assert those strides */
    if (!srcImageStride)
@@ -1080,19 +1187,27 @@ reduce_3d(enum pipe_format pformat,
       ubyte *dstImgRow = imgDst;
 
       for (row = 0; row < dstHeight; row++) {
-         do_row_3D(datatype, comps, srcWidth, 
-                   srcImgARowA, srcImgARowB,
-                   srcImgBRowA, srcImgBRowB,
-                   dstWidth, dstImgRow);
+         if (tmp)
+            do_row_float(util_format_description(pformat), srcWidth,
+                         srcImgARowA, srcImgARowB,
+                         srcImgBRowA, srcImgBRowB,
+                         dstWidth, dstImgRow, tmp);
+         else
+            do_row_3D(datatype, comps, srcWidth,
+                      srcImgARowA, srcImgARowB,
+                      srcImgBRowA, srcImgBRowB,
+                      dstWidth, dstImgRow);
 
          /* advance to next rows */
          srcImgARowA += srcRowStride + srcRowOffset;
          srcImgARowB += srcRowStride + srcRowOffset;
          srcImgBRowA += srcRowStride + srcRowOffset;
          srcImgBRowB += srcRowStride + srcRowOffset;
-         dstImgRow += dstImageStride;
+         dstImgRow += dstRowStride;
       }
    }
+
+   FREE(tmp);
 }
 
 
@@ -1219,6 +1334,16 @@ fallback_gen_mipmap(struct gen_mipmap_state *ctx,
                     struct pipe_resource *pt,
                     uint layer, uint baseLevel, uint lastLevel)
 {
+   enum dtype datatype;
+   uint comps;
+
+   if (!format_to_type_comps(pt->format, &datatype, &comps) &&
+       !is_format_float_filterable(pt->format)) {
+      debug_printf("%s: can't generate mipmaps for %s\n", __FUNCTION__,
+                   util_format_name(pt->format));
+      return;
+   }
+
    switch (pt->target) {
    case PIPE_TEXTURE_1D:
       make_1d_mipmap(ctx, pt, layer, baseLevel, lastLevel);
@@ -742,6 +742,21 @@ util_bswap32(uint32_t n)
 }
 
 
+/**
+ * Reverse byte order of a 64 bit word.
+ */
+static INLINE uint64_t
+util_bswap64(uint64_t n)
+{
+#if defined(PIPE_CC_GCC) && (PIPE_CC_GCC_VERSION >= 403)
+   return __builtin_bswap64(n);
+#else
+   return ((uint64_t)util_bswap32((uint32_t)n) << 32) |
+          util_bswap32((uint32_t)(n >> 32));
+#endif
+}
+
+
 /**
  * Reverse byte order of a 16 bit word.
  */
@@ -0,0 +1,325 @@
+/**************************************************************************
+ *
+ * Copyright 2014 The Mesa Authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+#include "util/u_queue.h"
+#include "util/u_memory.h"
+#include "os/os_time.h"
+
+
+/** All queues, for util_queue_get_stats() */
+static struct list_head all_queues = { &all_queues, &all_queues };
+pipe_static_mutex(all_queues_mutex);
+
+
+/*
+ * Fences
+ */
+
+void
+util_queue_fence_init(struct util_queue_fence *fence)
+{
+   pipe_mutex_init(fence->mutex);
+   pipe_condvar_init(fence->cond);
+   fence->signalled = 1;
+}
+
+void
+util_queue_fence_destroy(struct util_queue_fence *fence)
+{
+   assert(fence->signalled);
+   pipe_condvar_destroy(fence->cond);
+   pipe_mutex_destroy(fence->mutex);
+}
+
+static void
+util_queue_fence_signal(struct util_queue_fence *fence)
+{
+   pipe_mutex_lock(fence->mutex);
+   fence->signalled = 1;
+   pipe_condvar_broadcast(fence->cond);
+   pipe_mutex_unlock(fence->mutex);
+}
+
+/**
+ * Wait until the job of the fence has been executed.
+ */
+void
+util_queue_fence_wait(struct util_queue_fence *fence)
+{
+   pipe_mutex_lock(fence->mutex);
+   while (!fence->signalled)
+      pipe_condvar_wait(fence->cond, fence->mutex);
+   pipe_mutex_unlock(fence->mutex);
+}
+
+
+/*
+ * Queue
+ */
+
+struct thread_input
+{
+   struct util_queue *queue;
+   int thread_index;
+};
+
+/**
+ * Return the first job of the highest priority which \p thread_index may
+ * execute, or NULL.  Called with the queue lock held.
+ */
+static struct util_queue_job *
+get_job(struct util_queue *queue, int thread_index)
+{
+   int prio;
+
+   for (prio = UTIL_QUEUE_NUM_PRIORITIES - 1; prio >= 0; prio--) {
+      struct util_queue_job *job;
+
+      LIST_FOR_EACH_ENTRY(job, &queue->queued[prio], head) {
+         if (job->thread_index == UTIL_QUEUE_ANY_THREAD ||
+             job->thread_index == thread_index)
+            return job;
+      }
+   }
+
+   return NULL;
+}
+
+static PIPE_THREAD_ROUTINE(util_queue_thread_func, param)
+{
+   struct util_queue *queue = ((struct thread_input *) param)->queue;
+   int thread_index = ((struct thread_input *) param)->thread_index;
+
+   FREE(param);
+
+   pipe_mutex_lock(queue->lock);
+
+   for (;;) {
+      struct util_queue_job *entry = get_job(queue, thread_index);
+      struct util_queue_job job;
+
+      if (!entry) {
+         /* the queued jobs are executed before exiting */
+         if (queue->kill_threads)
+            break;
+
+         pipe_condvar_wait(queue->has_queued_cond, queue->lock);
+         continue;
+      }
+
+      job = *entry;
+      LIST_DEL(&entry->head);
+      LIST_ADD(&entry->head, &queue->free_jobs);
+
+      queue->stats.num_queued--;
+      queue->stats.num_started++;
+      queue->stats.wait_time += os_time_get() - job.enqueue_time;
+
+      pipe_condvar_signal(queue->has_space_cond);
+      pipe_mutex_unlock(queue->lock);
+
+      job.execute(job.job, thread_index);
+      util_queue_fence_signal(job.fence);
+
+      pipe_mutex_lock(queue->lock);
+   }
+
+   pipe_mutex_unlock(queue->lock);
+   return 0;
+}
+
+/**
+ * Start \p num_threads worker threads with room for \p max_jobs queued
+ * jobs.  \p name identifies the queue in the statistics.
+ */
+boolean
+util_queue_init(struct util_queue *queue,
+                const char *name,
+                unsigned max_jobs,
+                unsigned num_threads)
+{
+   unsigned i;
+
+   assert(max_jobs && num_threads);
+
+   memset(queue, 0, sizeof(*queue));
+   queue->name = name;
+   queue->max_jobs = max_jobs;
+
+   queue->jobs = CALLOC(max_jobs, sizeof(struct util_queue_job));
+   if (!queue->jobs)
+      return FALSE;
+
+   queue->threads = CALLOC(num_threads, sizeof(pipe_thread));
+   if (!queue->threads) {
+      FREE(queue->jobs);
+      return FALSE;
+   }
+
+   LIST_INITHEAD(&queue->free_jobs);
+   for (i = 0; i < max_jobs; i++)
+      LIST_ADDTAIL(&queue->jobs[i].head, &queue->free_jobs);
+   for (i = 0; i < UTIL_QUEUE_NUM_PRIORITIES; i++)
+      LIST_INITHEAD(&queue->queued[i]);
+
+   pipe_mutex_init(queue->lock);
+   pipe_condvar_init(queue->has_queued_cond);
+   pipe_condvar_init(queue->has_space_cond);
+
+   for (i = 0; i < num_threads; i++) {
+      struct thread_input *input = MALLOC_STRUCT(thread_input);
+
+      if (!input)
+         break;
+
+      input->queue = queue;
+      input->thread_index = i;
+
+      queue->threads[i] = pipe_thread_create(util_queue_thread_func, input);
+      if (!queue->threads[i]) {
+         FREE(input);
+         break;
+      }
+   }
+   queue->num_threads = i;
+
+   if (!queue->num_threads) {
+      util_queue_destroy(queue);
+      return FALSE;
+   }
+
+   pipe_mutex_lock(all_queues_mutex);
+   LIST_ADDTAIL(&queue->head, &all_queues);
+   pipe_mutex_unlock(all_queues_mutex);
+   return TRUE;
+}
+
+/**
+ * Execute the remaining jobs and stop the worker threads.
+ */
+void
+util_queue_destroy(struct util_queue *queue)
+{
+   unsigned i;
+
+   if (queue->head.next) {
+      pipe_mutex_lock(all_queues_mutex);
+      LIST_DEL(&queue->head);
+      pipe_mutex_unlock(all_queues_mutex);
+   }
+
+   pipe_mutex_lock(queue->lock);
+   queue->kill_threads = TRUE;
+   pipe_condvar_broadcast(queue->has_queued_cond);
+   pipe_mutex_unlock(queue->lock);
+
+   for (i = 0; i < queue->num_threads; i++)
+      pipe_thread_wait(queue->threads[i]);
+
+   pipe_condvar_destroy(queue->has_space_cond);
+   pipe_condvar_destroy(queue->has_queued_cond);
+   pipe_mutex_destroy(queue->lock);
+   FREE(queue->threads);
+   FREE(queue->jobs);
+}
+
+/**
+ * Queue a job, blocking while the queue is full.
+ *
+ * \param fence         signalled once execute() has returned
+ * \param thread_index  worker thread which has to execute the job, or
+ *                      UTIL_QUEUE_ANY_THREAD
+ */
+void
+util_queue_add_job(struct util_queue *queue,
+                   void *job,
+                   struct util_queue_fence *fence,
+                   util_queue_execute_func execute,
+                   enum util_queue_priority priority,
+                   int thread_index)
+{
+   struct util_queue_job *entry;
+
+   assert(priority < UTIL_QUEUE_NUM_PRIORITIES);
+   assert(thread_index == UTIL_QUEUE_ANY_THREAD ||
+          (unsigned) thread_index < queue->num_threads);
+   assert(fence->signalled);
+
+   fence->signalled = 0;
+
+   pipe_mutex_lock(queue->lock);
+
+   while (LIST_IS_EMPTY(&queue->free_jobs))
+      pipe_condvar_wait(queue->has_space_cond, queue->lock);
+
+   entry = LIST_ENTRY(struct util_queue_job, queue->free_jobs.next, head);
+   LIST_DEL(&entry->head);
+
+   entry->job = job;
+   entry->fence = fence;
+   entry->execute = execute;
+   entry->thread_index = thread_index;
+   entry->enqueue_time = os_time_get();
+   LIST_ADDTAIL(&entry->head, &queue->queued[priority]);
+
+   queue->stats.num_queued++;
+
+   /* only the right thread can take a pinned job */
+   if (thread_index == UTIL_QUEUE_ANY_THREAD)
+      pipe_condvar_signal(queue->has_queued_cond);
+   else
+      pipe_condvar_broadcast(queue->has_queued_cond);
+
+   pipe_mutex_unlock(queue->lock);
+}
+
+/**
+ * Sum the statistics of the queues called \p name, or of all queues if
+ * \p name is NULL.
+ */
+void
+util_queue_get_stats(const char *name, struct util_queue_stats *stats)
+{
+   struct util_queue *queue;
+
+   memset(stats, 0, sizeof(*stats));
+
+   pipe_mutex_lock(all_queues_mutex);
+
+   LIST_FOR_EACH_ENTRY(queue, &all_queues, head) {
+      if (name && strcmp(name, queue->name) != 0)
+         continue;
+
+      pipe_mutex_lock(queue->lock);
+      stats->num_queued += queue->stats.num_queued;
+      stats->num_started += queue->stats.num_started;
+      stats->wait_time += queue->stats.wait_time;
+      pipe_mutex_unlock(queue->lock);
+   }
+
+   pipe_mutex_unlock(all_queues_mutex);
+}
@@ -0,0 +1,152 @@
+/**************************************************************************
+ *
+ * Copyright 2014 The Mesa Authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Job queue with a fixed pool of worker threads.
+ *
+ * Jobs are executed in priority order, first in first out within a
+ * priority.  A job can be pinned to one worker thread, e.g. when it uses
+ * per-thread data.  Completion of a job is signalled through a fence the
+ * caller provides.
+ *
+ * Every queue keeps some statistics, see util_queue_get_stats(), which
+ * the HUD shows as the "queue-depth" and "queue-wait" graphs.
+ */
+
+#ifndef U_QUEUE_H
+#define U_QUEUE_H
+
+#include "pipe/p_compiler.h"
+#include "os/os_thread.h"
+#include "util/u_atomic.h"
+#include "util/u_double_list.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+enum util_queue_priority
+{
+   UTIL_QUEUE_PRIORITY_LOW,
+   UTIL_QUEUE_PRIORITY_NORMAL,
+   UTIL_QUEUE_PRIORITY_HIGH,
+   UTIL_QUEUE_NUM_PRIORITIES
+};
+
+/** Value of thread_index for jobs any worker thread may execute */
+#define UTIL_QUEUE_ANY_THREAD -1
+
+struct util_queue_fence
+{
+   pipe_mutex mutex;
+   pipe_condvar cond;
+   int signalled;
+};
+
+typedef void (*util_queue_execute_func)(void *job, int thread_index);
+
+struct util_queue_job
+{
+   struct list_head head;
+   void *job;
+   struct util_queue_fence *fence;
+   util_queue_execute_func execute;
+   int thread_index;
+   int64_t enqueue_time;
+};
+
+struct util_queue_stats
+{
+   unsigned num_queued;    /**< jobs waiting for a thread */
+   uint64_t num_started;   /**< jobs taken by a thread so far */
+   uint64_t wait_time;     /**< total time in usecs jobs spent waiting */
+};
+
+struct util_queue
+{
+   const char *name;
+   pipe_mutex lock;
+   pipe_condvar has_queued_cond;
+   pipe_condvar has_space_cond;
+   pipe_thread *threads;
+   unsigned num_threads;
+   boolean kill_threads;
+
+   struct util_queue_job *jobs;  /**< max_jobs entries */
+   unsigned max_jobs;
+   struct list_head free_jobs;
+   struct list_head queued[UTIL_QUEUE_NUM_PRIORITIES];
+
+   struct util_queue_stats stats;
+   struct list_head head;        /**< in the list of all queues */
+};
+
+
+boolean
+util_queue_init(struct util_queue *queue,
+                const char *name,
+                unsigned max_jobs,
+                unsigned num_threads);
+
+void
+util_queue_destroy(struct util_queue *queue);
+
+void
+util_queue_add_job(struct util_queue *queue,
+                   void *job,
+                   struct util_queue_fence *fence,
+                   util_queue_execute_func execute,
+                   enum util_queue_priority priority,
+                   int thread_index);
+
+void
+util_queue_get_stats(const char *name, struct util_queue_stats *stats);
+
+
+void
+util_queue_fence_init(struct util_queue_fence *fence);
+
+void
+util_queue_fence_destroy(struct util_queue_fence *fence);
+
+void
+util_queue_fence_wait(struct util_queue_fence *fence);
+
+static INLINE boolean
+util_queue_fence_is_signalled(struct util_queue_fence *fence)
+{
+   return p_atomic_read(&fence->signalled) != 0;
+}
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* U_QUEUE_H */
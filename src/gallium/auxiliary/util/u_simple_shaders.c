@@ -41,13 +41,166 @@
 #include "util/u_simple_shaders.h"
 #include "util/u_debug.h"
 #include "util/u_memory.h"
+#include "util/u_string.h"
+#include "os/os_thread.h"
 #include "tgsi/tgsi_dump.h"
+#include "tgsi/tgsi_parse.h"
 #include "tgsi/tgsi_strings.h"
 #include "tgsi/tgsi_ureg.h"
 #include "tgsi/tgsi_text.h"
 #include <stdio.h> /* include last */
 
 
+/*
+ * Cache of the generated shader tokens.
+ *
+ * Shader CSOs belong to one context, but the TGSI built for a given set of
+ * parameters is the same in every context, so it is only generated (or
+ * parsed from text) once per process and just handed to create_*_state
+ * afterwards.  Entries are keyed by a string naming the shader and its
+ * parameters.  There are few distinct keys, so the entries are simply kept
+ * until the process exits.
+ */
+struct cached_tokens
+{
+   struct cached_tokens *next;
+   struct tgsi_token *tokens;
+   char key[1];
+};
+
+static struct cached_tokens *tokens_cache = NULL;
+pipe_static_mutex(tokens_cache_mutex);
+
+
+static struct cached_tokens *
+find_cached_tokens_locked(const char *key)
+{
+   struct cached_tokens *entry;
+
+   for (entry = tokens_cache; entry; entry = entry->next) {
+      if (strcmp(entry->key, key) == 0)
+         return entry;
+   }
+   return NULL;
+}
+
+
+static const struct tgsi_token *
+get_cached_tokens(const char *key)
+{
+   struct cached_tokens *entry;
+
+   pipe_mutex_lock(tokens_cache_mutex);
+   entry = find_cached_tokens_locked(key);
+   pipe_mutex_unlock(tokens_cache_mutex);
+
+   return entry ? entry->tokens : NULL;
+}
+
+
+/**
+ * Add a copy of the tokens to the cache.
+ * \return the cached tokens, or the passed ones if they can't be cached
+ */
+static const struct tgsi_token *
+add_cached_tokens(const char *key, const struct tgsi_token *tokens)
+{
+   struct cached_tokens *entry;
+
+   if (!key)
+      return tokens;
+
+   pipe_mutex_lock(tokens_cache_mutex);
+   entry = find_cached_tokens_locked(key);
+   if (!entry) {
+      entry = MALLOC(sizeof(*entry) + strlen(key));
+      if (entry) {
+         entry->tokens = tgsi_dup_tokens(tokens);
+         if (entry->tokens) {
+            strcpy(entry->key, key);
+            entry->next = tokens_cache;
+            tokens_cache = entry;
+         }
+         else {
+            FREE(entry);
+            entry = NULL;
+         }
+      }
+   }
+   pipe_mutex_unlock(tokens_cache_mutex);
+
+   return entry ? entry->tokens : tokens;
+}
+
+
+static void *
+create_shader(struct pipe_context *pipe,
+              const struct tgsi_token *tokens,
+              const struct pipe_stream_output_info *so)
+{
+   const struct tgsi_processor *processor =
+      (const struct tgsi_processor *) &tokens[1];
+   struct pipe_shader_state state;
+
+   state.tokens = tokens;
+   if (so)
+      state.stream_output = *so;
+   else
+      memset(&state.stream_output, 0, sizeof(state.stream_output));
+
+#if 0
+   tgsi_dump(state.tokens, 0);
+#endif
+
+   if (processor->Processor == TGSI_PROCESSOR_VERTEX)
+      return pipe->create_vs_state(pipe, &state);
+   else
+      return pipe->create_fs_state(pipe, &state);
+}
+
+
+/**
+ * Finalize and destroy the ureg program and create the shader from it,
+ * caching the tokens under the key unless it is NULL.
+ */
+static void *
+create_shader_from_ureg(struct pipe_context *pipe,
+                        const char *key,
+                        struct ureg_program *ureg,
+                        const struct pipe_stream_output_info *so)
+{
+   const struct tgsi_token *tokens = ureg_finalize(ureg);
+   void *shader = NULL;
+
+   if (tokens)
+      shader = create_shader(pipe, add_cached_tokens(key, tokens), so);
+
+   ureg_destroy(ureg);
+   return shader;
+}
+
+
+/**
+ * Create a shader from TGSI text, which is also the cache key.
+ */
+static void *
+create_shader_from_text(struct pipe_context *pipe, const char *text)
+{
+   const struct tgsi_token *tokens = get_cached_tokens(text);
+   struct tgsi_token text_tokens[1000];
+
+   if (!tokens) {
+      if (!tgsi_text_translate(text, text_tokens, Elements(text_tokens))) {
+         puts(text);
+         assert(0);
+         return NULL;
+      }
+      tokens = add_cached_tokens(text, text_tokens);
+   }
+
+   return create_shader(pipe, tokens, NULL);
+}
+
 
 /**
  * Make simple vertex pass-through shader.
@@ -74,8 +227,22 @@ util_make_vertex_passthrough_shader_with_so(struct pipe_context *pipe,
 				    const struct pipe_stream_output_info *so)
 {
    struct ureg_program *ureg;
+   const struct tgsi_token *tokens;
+   char key[256];
+   unsigned len;
    uint i;
 
+   len = util_snprintf(key, sizeof(key), "vs_passthrough");
+   for (i = 0; i < num_attribs && len < sizeof(key); i++)
+      len += util_snprintf(key + len, sizeof(key) - len, " %u:%u",
+                           semantic_names[i], semantic_indexes[i]);
+
+   if (len < sizeof(key)) {
+      tokens = get_cached_tokens(key);
+      if (tokens)
+         return create_shader(pipe, tokens, so);
+   }
+
    ureg = ureg_create( TGSI_PROCESSOR_VERTEX );
    if (ureg == NULL)
       return NULL;
@@ -95,7 +262,8 @@ util_make_vertex_passthrough_shader_with_so(struct pipe_context *pipe,
 
    ureg_END( ureg );
 
-   return ureg_create_shader_with_so_and_destroy( ureg, pipe, so );
+   return create_shader_from_ureg(pipe, len < sizeof(key) ? key : NULL,
+                                  ureg, so);
 }
 
 
@@ -114,14 +282,8 @@ void *util_make_layered_clear_vertex_shader(struct pipe_context *pipe)
          "MOV OUT[1], IN[1]\n"
          "MOV OUT[2], SV[0]\n"
          "END\n";
-   struct tgsi_token tokens[1000];
-   struct pipe_shader_state state = {tokens};
 
-   if (!tgsi_text_translate(text, tokens, Elements(tokens))) {
-      assert(0);
-      return NULL;
-   }
-   return pipe->create_vs_state(pipe, &state);
+   return create_shader_from_text(pipe, text);
 }
 
 
@@ -146,10 +308,18 @@ util_make_fragment_tex_shader_writemask(struct pipe_context *pipe,
    struct ureg_src sampler;
    struct ureg_src tex;
    struct ureg_dst out;
+   const struct tgsi_token *tokens;
+   char key[64];
 
    assert(interp_mode == TGSI_INTERPOLATE_LINEAR ||
           interp_mode == TGSI_INTERPOLATE_PERSPECTIVE);
 
+   util_snprintf(key, sizeof(key), "fs_tex %u %u %u",
+                 tex_target, interp_mode, writemask);
+   tokens = get_cached_tokens(key);
+   if (tokens)
+      return create_shader(pipe, tokens, NULL);
+
    ureg = ureg_create( TGSI_PROCESSOR_FRAGMENT );
    if (ureg == NULL)
       return NULL;
@@ -175,7 +345,7 @@ util_make_fragment_tex_shader_writemask(struct pipe_context *pipe,
              tex_target, tex, sampler );
    ureg_END( ureg );
 
-   return ureg_create_shader_and_destroy( ureg, pipe );
+   return create_shader_from_ureg(pipe, key, ureg, NULL);
 }
 
 
@@ -209,6 +379,14 @@ util_make_fragment_tex_shader_writedepth(struct pipe_context *pipe,
    struct ureg_src tex;
    struct ureg_dst out, depth;
    struct ureg_src imm;
+   const struct tgsi_token *tokens;
+   char key[64];
+
+   util_snprintf(key, sizeof(key), "fs_tex_writedepth %u %u",
+                 tex_target, interp_mode);
+   tokens = get_cached_tokens(key);
+   if (tokens)
+      return create_shader(pipe, tokens, NULL);
 
    ureg = ureg_create( TGSI_PROCESSOR_FRAGMENT );
    if (ureg == NULL)
@@ -237,7 +415,7 @@ util_make_fragment_tex_shader_writedepth(struct pipe_context *pipe,
              tex_target, tex, sampler );
    ureg_END( ureg );
 
-   return ureg_create_shader_and_destroy( ureg, pipe );
+   return create_shader_from_ureg(pipe, key, ureg, NULL);
 }
 
 
@@ -255,6 +433,14 @@ util_make_fragment_tex_shader_writedepthstencil(struct pipe_context *pipe,
    struct ureg_src tex;
    struct ureg_dst out, depth, stencil;
    struct ureg_src imm;
+   const struct tgsi_token *tokens;
+   char key[64];
+
+   util_snprintf(key, sizeof(key), "fs_tex_writedepthstencil %u %u",
+                 tex_target, interp_mode);
+   tokens = get_cached_tokens(key);
+   if (tokens)
+      return create_shader(pipe, tokens, NULL);
 
    ureg = ureg_create( TGSI_PROCESSOR_FRAGMENT );
    if (ureg == NULL)
@@ -291,7 +477,7 @@ util_make_fragment_tex_shader_writedepthstencil(struct pipe_context *pipe,
              tex_target, tex, stencil_sampler );
    ureg_END( ureg );
 
-   return ureg_create_shader_and_destroy( ureg, pipe );
+   return create_shader_from_ureg(pipe, key, ureg, NULL);
 }
 
 
@@ -309,6 +495,14 @@ util_make_fragment_tex_shader_writestencil(struct pipe_context *pipe,
    struct ureg_src tex;
    struct ureg_dst out, stencil;
    struct ureg_src imm;
+   const struct tgsi_token *tokens;
+   char key[64];
+
+   util_snprintf(key, sizeof(key), "fs_tex_writestencil %u %u",
+                 tex_target, interp_mode);
+   tokens = get_cached_tokens(key);
+   if (tokens)
+      return create_shader(pipe, tokens, NULL);
 
    ureg = ureg_create( TGSI_PROCESSOR_FRAGMENT );
    if (ureg == NULL)
@@ -337,7 +531,7 @@ util_make_fragment_tex_shader_writestencil(struct pipe_context *pipe,
              tex_target, tex, stencil_sampler );
    ureg_END( ureg );
 
-   return ureg_create_shader_and_destroy( ureg, pipe );
+   return create_shader_from_ureg(pipe, key, ureg, NULL);
 }
 
 
@@ -361,35 +555,31 @@ util_make_fragment_passthrough_shader(struct pipe_context *pipe,
          "END\n";
 
    char text[sizeof(shader_templ)+100];
-   struct tgsi_token tokens[1000];
-   struct pipe_shader_state state = {tokens};
 
    sprintf(text, shader_templ,
            write_all_cbufs ? "PROPERTY FS_COLOR0_WRITES_ALL_CBUFS 1\n" : "",
            tgsi_semantic_names[input_semantic],
            tgsi_interpolate_names[input_interpolate]);
 
-   if (!tgsi_text_translate(text, tokens, Elements(tokens))) {
-      assert(0);
-      return NULL;
-   }
-#if 0
-   tgsi_dump(state.tokens, 0);
-#endif
-
-   return pipe->create_fs_state(pipe, &state);
+   return create_shader_from_text(pipe, text);
 }
 
 
 void *
 util_make_empty_fragment_shader(struct pipe_context *pipe)
 {
-   struct ureg_program *ureg = ureg_create(TGSI_PROCESSOR_FRAGMENT);
+   struct ureg_program *ureg;
+   const struct tgsi_token *tokens = get_cached_tokens("fs_empty");
+
+   if (tokens)
+      return create_shader(pipe, tokens, NULL);
+
+   ureg = ureg_create(TGSI_PROCESSOR_FRAGMENT);
    if (ureg == NULL)
       return NULL;
 
    ureg_END(ureg);
-   return ureg_create_shader_and_destroy(ureg, pipe);
+   return create_shader_from_ureg(pipe, "fs_empty", ureg, NULL);
 }
 
 
@@ -404,10 +594,18 @@ util_make_fragment_cloneinput_shader(struct pipe_context *pipe, int num_cbufs,
    struct ureg_program *ureg;
    struct ureg_src src;
    struct ureg_dst dst[PIPE_MAX_COLOR_BUFS];
+   const struct tgsi_token *tokens;
+   char key[64];
    int i;
 
    assert(num_cbufs <= PIPE_MAX_COLOR_BUFS);
 
+   util_snprintf(key, sizeof(key), "fs_cloneinput %d %d %d",
+                 num_cbufs, input_semantic, input_interpolate);
+   tokens = get_cached_tokens(key);
+   if (tokens)
+      return create_shader(pipe, tokens, NULL);
+
    ureg = ureg_create( TGSI_PROCESSOR_FRAGMENT );
    if (ureg == NULL)
       return NULL;
@@ -423,7 +621,7 @@ util_make_fragment_cloneinput_shader(struct pipe_context *pipe, int num_cbufs,
 
    ureg_END( ureg );
 
-   return ureg_create_shader_and_destroy( ureg, pipe );
+   return create_shader_from_ureg(pipe, key, ureg, NULL);
 }
 
 
@@ -446,24 +644,13 @@ util_make_fs_blit_msaa_gen(struct pipe_context *pipe,
 
    const char *type = tgsi_texture_names[tgsi_tex];
    char text[sizeof(shader_templ)+100];
-   struct tgsi_token tokens[1000];
-   struct pipe_shader_state state = {tokens};
 
    assert(tgsi_tex == TGSI_TEXTURE_2D_MSAA ||
           tgsi_tex == TGSI_TEXTURE_2D_ARRAY_MSAA);
 
    sprintf(text, shader_templ, output_semantic, output_mask, type);
 
-   if (!tgsi_text_translate(text, tokens, Elements(tokens))) {
-      puts(text);
-      assert(0);
-      return NULL;
-   }
-#if 0
-   tgsi_dump(state.tokens, 0);
-#endif
-
-   return pipe->create_fs_state(pipe, &state);
+   return create_shader_from_text(pipe, text);
 }
 
 
@@ -535,23 +722,13 @@ util_make_fs_blit_msaa_depthstencil(struct pipe_context *pipe,
 
    const char *type = tgsi_texture_names[tgsi_tex];
    char text[sizeof(shader_templ)+100];
-   struct tgsi_token tokens[1000];
-   struct pipe_shader_state state = {tokens};
 
    assert(tgsi_tex == TGSI_TEXTURE_2D_MSAA ||
           tgsi_tex == TGSI_TEXTURE_2D_ARRAY_MSAA);
 
    sprintf(text, shader_templ, type, type);
 
-   if (!tgsi_text_translate(text, tokens, Elements(tokens))) {
-      assert(0);
-      return NULL;
-   }
-#if 0
-   tgsi_dump(state.tokens, 0);
-#endif
-
-   return pipe->create_fs_state(pipe, &state);
+   return create_shader_from_text(pipe, text);
 }
 
 
@@ -563,8 +740,16 @@ util_make_fs_msaa_resolve(struct pipe_context *pipe,
    struct ureg_program *ureg;
    struct ureg_src sampler, coord;
    struct ureg_dst out, tmp_sum, tmp_coord, tmp;
+   const struct tgsi_token *tokens;
+   char key[64];
    int i;
 
+   util_snprintf(key, sizeof(key), "fs_msaa_resolve %u %u %u %u",
+                 tgsi_tex, nr_samples, is_uint, is_sint);
+   tokens = get_cached_tokens(key);
+   if (tokens)
+      return create_shader(pipe, tokens, NULL);
+
    ureg = ureg_create(TGSI_PROCESSOR_FRAGMENT);
    if (!ureg)
       return NULL;
@@ -610,7 +795,7 @@ util_make_fs_msaa_resolve(struct pipe_context *pipe,
 
    ureg_END(ureg);
 
-   return ureg_create_shader_and_destroy(ureg, pipe);
+   return create_shader_from_ureg(pipe, key, ureg, NULL);
 }
 
 
@@ -623,8 +808,16 @@ util_make_fs_msaa_resolve_bilinear(struct pipe_context *pipe,
    struct ureg_src sampler, coord;
    struct ureg_dst out, tmp, top, bottom;
    struct ureg_dst tmp_coord[4], tmp_sum[4];
+   const struct tgsi_token *tokens;
+   char key[64];
    int i, c;
 
+   util_snprintf(key, sizeof(key), "fs_msaa_resolve_bilinear %u %u %u %u",
+                 tgsi_tex, nr_samples, is_uint, is_sint);
+   tokens = get_cached_tokens(key);
+   if (tokens)
+      return create_shader(pipe, tokens, NULL);
+
    ureg = ureg_create(TGSI_PROCESSOR_FRAGMENT);
    if (!ureg)
       return NULL;
@@ -705,5 +898,5 @@ util_make_fs_msaa_resolve_bilinear(struct pipe_context *pipe,
 
    ureg_END(ureg);
 
-   return ureg_create_shader_and_destroy(ureg, pipe);
+   return create_shader_from_ureg(pipe, key, ureg, NULL);
 }
@@ -30,6 +30,9 @@
 
 #define UTIL_SLAB_MAGIC 0xcafe4321
 
+/* The number of free blocks a thread can cache. */
+#define UTIL_SLAB_MAGAZINE_SIZE 32
+
 /* The block is either allocated memory or free space. */
 struct util_slab_block {
    /* The header. */
@@ -42,6 +45,15 @@ struct util_slab_block {
     * The allocated size is always larger than this structure. */
 };
 
+/* A thread's cache of free blocks. */
+struct util_slab_magazine {
+   /* The next magazine of the pool. */
+   struct util_slab_magazine *next;
+
+   unsigned num_blocks;
+   struct util_slab_block *blocks[UTIL_SLAB_MAGAZINE_SIZE];
+};
+
 static struct util_slab_block *
 util_slab_get_block(struct util_slab_mempool *pool,
                     struct util_slab_page *page, unsigned index)
@@ -103,21 +115,103 @@ static void util_slab_free_st(struct util_slab_mempool *pool, void *ptr)
    pool->first_free = block;
 }
 
+static struct util_slab_magazine *
+util_slab_get_magazine(struct util_slab_mempool *pool)
+{
+   struct util_slab_magazine *mag = pipe_tsd_get(&pool->magazine_tsd);
+
+   if (!mag) {
+      mag = CALLOC_STRUCT(util_slab_magazine);
+      if (!mag)
+         return NULL;
+
+      pipe_mutex_lock(pool->mutex);
+      mag->next = pool->magazines;
+      pool->magazines = mag;
+      pipe_mutex_unlock(pool->mutex);
+
+      pipe_tsd_set(&pool->magazine_tsd, mag);
+   }
+   return mag;
+}
+
+/* Hand the blocks of all magazines back to the pool.
+ * No other thread may be using the pool. */
+static void util_slab_drain_magazines(struct util_slab_mempool *pool)
+{
+   struct util_slab_magazine *mag;
+
+   for (mag = pool->magazines; mag; mag = mag->next) {
+      while (mag->num_blocks) {
+         struct util_slab_block *block = mag->blocks[--mag->num_blocks];
+         block->next_free = pool->first_free;
+         pool->first_free = block;
+      }
+   }
+}
+
 static void *util_slab_alloc_mt(struct util_slab_mempool *pool)
 {
-   void *mem;
+   struct util_slab_magazine *mag = util_slab_get_magazine(pool);
+   struct util_slab_block *block;
+
+   if (!mag) {
+      void *mem;
+
+      pipe_mutex_lock(pool->mutex);
+      mem = util_slab_alloc_st(pool);
+      pipe_mutex_unlock(pool->mutex);
+      return mem;
+   }
+
+   if (!mag->num_blocks) {
+      /* Refill half of the magazine. */
+      pipe_mutex_lock(pool->mutex);
+      while (mag->num_blocks < UTIL_SLAB_MAGAZINE_SIZE / 2) {
+         if (!pool->first_free)
+            util_slab_add_new_page(pool);
 
-   pipe_mutex_lock(pool->mutex);
-   mem = util_slab_alloc_st(pool);
-   pipe_mutex_unlock(pool->mutex);
-   return mem;
+         block = pool->first_free;
+         pool->first_free = block->next_free;
+         mag->blocks[mag->num_blocks++] = block;
+      }
+      pipe_mutex_unlock(pool->mutex);
+   }
+
+   block = mag->blocks[--mag->num_blocks];
+   assert(block->magic == UTIL_SLAB_MAGIC);
+
+   return (uint8_t*)block + sizeof(struct util_slab_block);
 }
 
 static void util_slab_free_mt(struct util_slab_mempool *pool, void *ptr)
 {
-   pipe_mutex_lock(pool->mutex);
-   util_slab_free_st(pool, ptr);
-   pipe_mutex_unlock(pool->mutex);
+   struct util_slab_magazine *mag = util_slab_get_magazine(pool);
+   struct util_slab_block *block =
+         (struct util_slab_block*)
+         ((uint8_t*)ptr - sizeof(struct util_slab_block));
+
+   if (!mag) {
+      pipe_mutex_lock(pool->mutex);
+      util_slab_free_st(pool, ptr);
+      pipe_mutex_unlock(pool->mutex);
+      return;
+   }
+
+   assert(block->magic == UTIL_SLAB_MAGIC);
+
+   if (mag->num_blocks == UTIL_SLAB_MAGAZINE_SIZE) {
+      /* Give half of the magazine back to the pool. */
+      pipe_mutex_lock(pool->mutex);
+      while (mag->num_blocks > UTIL_SLAB_MAGAZINE_SIZE / 2) {
+         struct util_slab_block *free_block = mag->blocks[--mag->num_blocks];
+         free_block->next_free = pool->first_free;
+         pool->first_free = free_block;
+      }
+      pipe_mutex_unlock(pool->mutex);
+   }
+
+   mag->blocks[mag->num_blocks++] = block;
 }
 
 void util_slab_set_thread_safety(struct util_slab_mempool *pool,
@@ -126,9 +220,15 @@ void util_slab_set_thread_safety(struct util_slab_mempool *pool,
    pool->threading = threading;
 
    if (threading) {
+      /* Create the key now rather than racing on it in the first allocs. */
+      if (pool->magazine_tsd.initMagic != (int) PIPE_TSD_INIT_MAGIC)
+         pipe_tsd_init(&pool->magazine_tsd);
+
       pool->alloc = util_slab_alloc_mt;
       pool->free = util_slab_free_mt;
    } else {
+      util_slab_drain_magazines(pool);
+
       pool->alloc = util_slab_alloc_st;
       pool->free = util_slab_free_st;
    }
@@ -148,6 +248,8 @@ void util_slab_create(struct util_slab_mempool *pool,
    pool->page_size = sizeof(struct util_slab_page) +
                      num_blocks * pool->block_size;
    pool->first_free = NULL;
+   pool->magazines = NULL;
+   memset(&pool->magazine_tsd, 0, sizeof(pool->magazine_tsd));
 
    make_empty_list(&pool->list);
 
@@ -159,6 +261,14 @@ void util_slab_create(struct util_slab_mempool *pool,
 void util_slab_destroy(struct util_slab_mempool *pool)
 {
    struct util_slab_page *page, *temp;
+   struct util_slab_magazine *mag, *next_mag;
+
+   for (mag = pool->magazines; mag; mag = next_mag) {
+      next_mag = mag->next;
+      FREE(mag);
+   }
+   pool->magazines = NULL;
+   pipe_tsd_destroy(&pool->magazine_tsd);
 
    if (pool->list.next) {
       foreach_s(page, temp, &pool->list) {
@@ -30,6 +30,12 @@
  *
  * Candidates: transfer_map
  *
+ * In the multithreaded mode every thread keeps a small magazine of free
+ * blocks, so that most allocations and frees don't take the pool mutex.
+ * The mutex is only taken to move half a magazine from or to the pool's
+ * free list.  Blocks may be freed by a different thread than the one which
+ * allocated them.
+ *
  * @author Marek Olšák
  */
 
@@ -52,6 +58,8 @@ struct util_slab_page {
     * The allocated size is always larger than this structure. */
 };
 
+struct util_slab_magazine;
+
 struct util_slab_mempool {
    /* Public members. */
    void *(*alloc)(struct util_slab_mempool *pool);
@@ -69,6 +77,10 @@ struct util_slab_mempool {
    enum util_slab_threading threading;
 
    pipe_mutex mutex;
+
+   /* The per-thread magazines, for the multithreaded mode. */
+   pipe_tsd magazine_tsd;
+   struct util_slab_magazine *magazines;
 };
 
 void util_slab_create(struct util_slab_mempool *pool,
@@ -37,6 +37,10 @@
 #include "u_suballoc.h"
 
 
+/** Maximum number of filled buffers kept around for reuse */
+#define U_SUBALLOC_MAX_RETIRED 8
+
+
 struct u_suballocator {
    struct pipe_context *pipe;
 
@@ -48,6 +52,11 @@ struct u_suballocator {
 
    struct pipe_resource *buffer;   /* The buffer we suballocate from. */
    unsigned offset; /* Aligned offset pointing at the first unused byte. */
+
+   /* Filled buffers, oldest first, see u_suballocator_recycle_buffers. */
+   struct pipe_resource *retired[U_SUBALLOC_MAX_RETIRED];
+   unsigned num_retired;
+   unsigned max_retired;
 };
 
 
@@ -75,13 +84,100 @@ u_suballocator_create(struct pipe_context *pipe, unsigned size,
    return allocator;
 }
 
+void
+u_suballocator_recycle_buffers(struct u_suballocator *allocator,
+                               unsigned num_buffers)
+{
+   allocator->max_retired = MIN2(num_buffers, U_SUBALLOC_MAX_RETIRED);
+
+   while (allocator->num_retired > allocator->max_retired) {
+      pipe_resource_reference(&allocator->retired[0], NULL);
+      allocator->num_retired--;
+      memmove(allocator->retired, allocator->retired + 1,
+              allocator->num_retired * sizeof(allocator->retired[0]));
+      allocator->retired[allocator->num_retired] = NULL;
+   }
+}
+
 void
 u_suballocator_destroy(struct u_suballocator *allocator)
 {
+   unsigned i;
+
    pipe_resource_reference(&allocator->buffer, NULL);
+   for (i = 0; i < allocator->num_retired; i++)
+      pipe_resource_reference(&allocator->retired[i], NULL);
    FREE(allocator);
 }
 
+
+/* Drop the current buffer, keeping it for later reuse if recycling is
+ * enabled.
+ */
+static void
+u_suballocator_retire_buffer(struct u_suballocator *allocator)
+{
+   if (allocator->buffer && allocator->max_retired) {
+      if (allocator->num_retired == allocator->max_retired) {
+         pipe_resource_reference(&allocator->retired[0], NULL);
+         allocator->num_retired--;
+         memmove(allocator->retired, allocator->retired + 1,
+                 allocator->num_retired * sizeof(allocator->retired[0]));
+      }
+
+      /* Hand our reference over to the retired list */
+      allocator->retired[allocator->num_retired++] = allocator->buffer;
+      allocator->buffer = NULL;
+   }
+
+   pipe_resource_reference(&allocator->buffer, NULL);
+}
+
+
+/* Find a retired buffer all of whose suballocations have been released and
+ * which the GPU is done with, and make it the current buffer again.  The
+ * former holds when the list has the only reference to it, the latter when
+ * it can be mapped without waiting.
+ */
+static boolean
+u_suballocator_reuse_buffer(struct u_suballocator *allocator)
+{
+   unsigned i;
+
+   for (i = 0; i < allocator->num_retired; i++) {
+      struct pipe_resource *buffer = allocator->retired[i];
+      struct pipe_transfer *transfer;
+      void *ptr;
+
+      if (p_atomic_read(&buffer->reference.count) != 1)
+         continue;
+
+      ptr = pipe_buffer_map(allocator->pipe, buffer,
+                            PIPE_TRANSFER_WRITE | PIPE_TRANSFER_DONTBLOCK,
+                            &transfer);
+      if (!ptr)
+         continue;
+
+      if (allocator->zero_buffer_memory)
+         memset(ptr, 0, allocator->size);
+      pipe_buffer_unmap(allocator->pipe, transfer);
+
+      allocator->num_retired--;
+      memmove(allocator->retired + i, allocator->retired + i + 1,
+              (allocator->num_retired - i) * sizeof(allocator->retired[0]));
+      allocator->retired[allocator->num_retired] = NULL;
+
+      u_suballocator_retire_buffer(allocator);
+
+      /* The reference moves from the retired list */
+      allocator->buffer = buffer;
+      allocator->offset = 0;
+      return TRUE;
+   }
+
+   return FALSE;
+}
+
 void
 u_suballocator_alloc(struct u_suballocator *allocator, unsigned size,
                      unsigned *out_offset, struct pipe_resource **outbuf)
@@ -92,11 +188,13 @@ u_suballocator_alloc(struct u_suballocator *allocator, unsigned size,
    if (alloc_size > allocator->size)
       goto fail;
 
-   /* Make sure we have enough space in the buffer. */
-   if (!allocator->buffer ||
-       allocator->offset + alloc_size > allocator->size) {
+   /* Make sure we have enough space in the buffer, starting over in an
+    * emptied one if possible. */
+   if ((!allocator->buffer ||
+        allocator->offset + alloc_size > allocator->size) &&
+       !u_suballocator_reuse_buffer(allocator)) {
       /* Allocate a new buffer. */
-      pipe_resource_reference(&allocator->buffer, NULL);
+      u_suballocator_retire_buffer(allocator);
       allocator->offset = 0;
       allocator->buffer =
          pipe_buffer_create(allocator->pipe->screen, allocator->bind,
@@ -41,6 +41,19 @@ u_suballocator_create(struct pipe_context *pipe, unsigned size,
 void
 u_suballocator_destroy(struct u_suballocator *allocator);
 
+/**
+ * Keep up to num_buffers filled buffers around and start over in one of
+ * them once all its suballocations have been released and the GPU is done
+ * with it, rather than allocating a new buffer each time the current one
+ * fills up.  Disabled (0) by default.
+ *
+ * Idleness is checked by mapping with PIPE_TRANSFER_DONTBLOCK, so this
+ * only helps drivers which honour that flag for buffers.
+ */
+void
+u_suballocator_recycle_buffers(struct u_suballocator *allocator,
+                               unsigned num_buffers);
+
 void
 u_suballocator_alloc(struct u_suballocator *allocator, unsigned size,
                      unsigned *out_offset, struct pipe_resource **outbuf);
@@ -0,0 +1,1481 @@
+/**************************************************************************
+ *
+ * Copyright 2014 The Mesa Authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Threaded pipe_context wrapper, see u_threaded_context.h.
+ */
+
+
+#include "pipe/p_context.h"
+#include "pipe/p_defines.h"
+#include "pipe/p_state.h"
+#include "os/os_thread.h"
+#include "util/u_atomic.h"
+#include "util/u_inlines.h"
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "util/u_threaded_context.h"
+
+
+/** Size of a batch of recorded calls, in 8-byte slots */
+#define TC_SLOTS_PER_BATCH (64 * 1024 / 8)
+
+/** Number of batches, the application can run this many ahead */
+#define TC_NUM_BATCHES 4
+
+
+struct threaded_context;
+
+typedef void (*tc_execute)(struct threaded_context *tc, void *payload);
+
+/** The header of a recorded call, followed by its payload */
+struct tc_call
+{
+   tc_execute execute;
+   unsigned num_slots;  /**< of the call, including this header */
+};
+
+#define TC_CALL_SLOTS ((sizeof(struct tc_call) + 7) / 8)
+
+
+struct tc_batch
+{
+   unsigned num_slots;
+   uint64_t slots[TC_SLOTS_PER_BATCH];
+};
+
+
+struct threaded_context
+{
+   struct pipe_context base;
+
+   /** The wrapped context */
+   struct pipe_context *pipe;
+
+   /**
+    * The batches form a ring.  Batches num_executed to num_submitted - 1
+    * are waiting for or being executed by the worker, and calls are
+    * recorded into batch num_submitted.  Both counters only increase and
+    * are written with the mutex held.
+    */
+   struct tc_batch batches[TC_NUM_BATCHES];
+   unsigned num_submitted;
+   unsigned num_executed;
+   boolean exit;
+
+   pipe_mutex mutex;
+   pipe_condvar cond;
+   pipe_thread thread;
+
+   /** Set to the context on the worker thread only */
+   pipe_tsd worker_tsd;
+
+   /* Application thread state */
+   uint32_t user_vbuf_mask;   /**< vertex buffer slots bound to user memory */
+   boolean user_index_buffer;
+
+   /**
+    * Worker thread state: copies of the user constant buffers, which the
+    * driver may read until they're replaced.
+    */
+   void *const_buffers[PIPE_SHADER_TYPES][PIPE_MAX_CONSTANT_BUFFERS];
+};
+
+
+static INLINE struct threaded_context *
+threaded_context(struct pipe_context *pipe)
+{
+   assert(pipe);
+   return (struct threaded_context *)pipe;
+}
+
+
+static INLINE struct tc_batch *
+tc_current_batch(struct threaded_context *tc)
+{
+   return &tc->batches[tc->num_submitted % TC_NUM_BATCHES];
+}
+
+
+static void
+tc_execute_batch(struct threaded_context *tc, struct tc_batch *batch)
+{
+   unsigned i = 0;
+
+   while (i < batch->num_slots) {
+      struct tc_call *call = (struct tc_call *) &batch->slots[i];
+
+      call->execute(tc, &batch->slots[i + TC_CALL_SLOTS]);
+      i += call->num_slots;
+   }
+
+   batch->num_slots = 0;
+}
+
+
+static PIPE_THREAD_ROUTINE( tc_worker_thread, init_data )
+{
+   struct threaded_context *tc = (struct threaded_context *) init_data;
+
+   pipe_tsd_set(&tc->worker_tsd, tc);
+
+   pipe_mutex_lock(tc->mutex);
+   while (1) {
+      struct tc_batch *batch;
+
+      while (tc->num_executed == tc->num_submitted && !tc->exit)
+         pipe_condvar_wait(tc->cond, tc->mutex);
+
+      if (tc->num_executed == tc->num_submitted)
+         break;
+
+      batch = &tc->batches[tc->num_executed % TC_NUM_BATCHES];
+      pipe_mutex_unlock(tc->mutex);
+
+      tc_execute_batch(tc, batch);
+
+      pipe_mutex_lock(tc->mutex);
+      tc->num_executed++;
+      pipe_condvar_broadcast(tc->cond);
+   }
+   pipe_mutex_unlock(tc->mutex);
+
+   return 0;
+}
+
+
+/**
+ * Hand the current batch over to the worker and wait for the next one to
+ * be free.
+ */
+static void
+tc_submit(struct threaded_context *tc)
+{
+   if (!tc_current_batch(tc)->num_slots)
+      return;
+
+   pipe_mutex_lock(tc->mutex);
+   tc->num_submitted++;
+   pipe_condvar_broadcast(tc->cond);
+
+   while (tc->num_submitted - tc->num_executed >= TC_NUM_BATCHES)
+      pipe_condvar_wait(tc->cond, tc->mutex);
+   pipe_mutex_unlock(tc->mutex);
+}
+
+
+/**
+ * Execute all recorded calls, so that the driver can be called directly.
+ */
+static void
+tc_sync(struct threaded_context *tc)
+{
+   tc_submit(tc);
+
+   pipe_mutex_lock(tc->mutex);
+   while (tc->num_executed != tc->num_submitted)
+      pipe_condvar_wait(tc->cond, tc->mutex);
+   pipe_mutex_unlock(tc->mutex);
+}
+
+
+/**
+ * Whether the driver may be called directly from the calling thread
+ * without breaking the order of the calls.
+ */
+static boolean
+tc_is_direct(struct threaded_context *tc)
+{
+   if (pipe_tsd_get(&tc->worker_tsd))
+      return TRUE;
+
+   return !tc_current_batch(tc)->num_slots &&
+          p_atomic_read(&tc->num_executed) == tc->num_submitted;
+}
+
+
+/**
+ * Record a call.
+ * \return the memory for its payload, or NULL if it's too large for a batch
+ */
+static void *
+tc_add_call(struct threaded_context *tc, tc_execute execute,
+            unsigned payload_size)
+{
+   unsigned num_slots = TC_CALL_SLOTS + (payload_size + 7) / 8;
+   struct tc_batch *batch = tc_current_batch(tc);
+   struct tc_call *call;
+
+   if (num_slots > TC_SLOTS_PER_BATCH)
+      return NULL;
+
+   if (batch->num_slots + num_slots > TC_SLOTS_PER_BATCH) {
+      tc_submit(tc);
+      batch = tc_current_batch(tc);
+   }
+
+   call = (struct tc_call *) &batch->slots[batch->num_slots];
+   call->execute = execute;
+   call->num_slots = num_slots;
+   batch->num_slots += num_slots;
+
+   return (uint64_t *) call + TC_CALL_SLOTS;
+}
+
+#define tc_add_struct(tc, execute, type) \
+   ((type *) tc_add_call(tc, execute, sizeof(type)))
+
+
+/*
+ * Calls with no or a fixed size payload.
+ */
+
+struct tc_state
+{
+   void *state;
+};
+
+#define TC_STATE_CALL(func) \
+   static void \
+   tc_call_##func(struct threaded_context *tc, void *payload) \
+   { \
+      tc->pipe->func(tc->pipe, ((struct tc_state *) payload)->state); \
+   } \
+   \
+   static void \
+   tc_##func(struct pipe_context *_pipe, void *state) \
+   { \
+      struct threaded_context *tc = threaded_context(_pipe); \
+      tc_add_struct(tc, tc_call_##func, struct tc_state)->state = state; \
+   }
+
+TC_STATE_CALL(bind_blend_state)
+TC_STATE_CALL(delete_blend_state)
+TC_STATE_CALL(delete_sampler_state)
+TC_STATE_CALL(bind_rasterizer_state)
+TC_STATE_CALL(delete_rasterizer_state)
+TC_STATE_CALL(bind_depth_stencil_alpha_state)
+TC_STATE_CALL(delete_depth_stencil_alpha_state)
+TC_STATE_CALL(bind_fs_state)
+TC_STATE_CALL(delete_fs_state)
+TC_STATE_CALL(bind_vs_state)
+TC_STATE_CALL(delete_vs_state)
+TC_STATE_CALL(bind_gs_state)
+TC_STATE_CALL(delete_gs_state)
+TC_STATE_CALL(bind_vertex_elements_state)
+TC_STATE_CALL(delete_vertex_elements_state)
+
+
+#define TC_STRUCT_CALL(func, type) \
+   static void \
+   tc_call_##func(struct threaded_context *tc, void *payload) \
+   { \
+      tc->pipe->func(tc->pipe, (const type *) payload); \
+   } \
+   \
+   static void \
+   tc_##func(struct pipe_context *_pipe, const type *state) \
+   { \
+      struct threaded_context *tc = threaded_context(_pipe); \
+      *tc_add_struct(tc, tc_call_##func, type) = *state; \
+   }
+
+TC_STRUCT_CALL(set_blend_color, struct pipe_blend_color)
+TC_STRUCT_CALL(set_stencil_ref, struct pipe_stencil_ref)
+TC_STRUCT_CALL(set_clip_state, struct pipe_clip_state)
+TC_STRUCT_CALL(set_polygon_stipple, struct pipe_poly_stipple)
+
+
+struct tc_sample_mask
+{
+   unsigned sample_mask;
+};
+
+static void
+tc_call_set_sample_mask(struct threaded_context *tc, void *payload)
+{
+   struct tc_sample_mask *p = (struct tc_sample_mask *) payload;
+   tc->pipe->set_sample_mask(tc->pipe, p->sample_mask);
+}
+
+static void
+tc_set_sample_mask(struct pipe_context *_pipe, unsigned sample_mask)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+   tc_add_struct(tc, tc_call_set_sample_mask,
+                 struct tc_sample_mask)->sample_mask = sample_mask;
+}
+
+
+static void
+tc_call_texture_barrier(struct threaded_context *tc, void *payload)
+{
+   tc->pipe->texture_barrier(tc->pipe);
+}
+
+static void
+tc_texture_barrier(struct pipe_context *_pipe)
+{
+   tc_add_call(threaded_context(_pipe), tc_call_texture_barrier, 0);
+}
+
+
+/*
+ * Object creation: wait for the worker, then call the driver.
+ */
+
+#define TC_CREATE_CALL(func, type) \
+   static void * \
+   tc_##func(struct pipe_context *_pipe, const type *state) \
+   { \
+      struct threaded_context *tc = threaded_context(_pipe); \
+      tc_sync(tc); \
+      return tc->pipe->func(tc->pipe, state); \
+   }
+
+TC_CREATE_CALL(create_blend_state, struct pipe_blend_state)
+TC_CREATE_CALL(create_sampler_state, struct pipe_sampler_state)
+TC_CREATE_CALL(create_rasterizer_state, struct pipe_rasterizer_state)
+TC_CREATE_CALL(create_depth_stencil_alpha_state,
+               struct pipe_depth_stencil_alpha_state)
+TC_CREATE_CALL(create_fs_state, struct pipe_shader_state)
+TC_CREATE_CALL(create_vs_state, struct pipe_shader_state)
+TC_CREATE_CALL(create_gs_state, struct pipe_shader_state)
+
+static void *
+tc_create_vertex_elements_state(struct pipe_context *_pipe,
+                                unsigned num_elements,
+                                const struct pipe_vertex_element *elements)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+
+   tc_sync(tc);
+   return tc->pipe->create_vertex_elements_state(tc->pipe, num_elements,
+                                                 elements);
+}
+
+
+/*
+ * Queries
+ */
+
+static struct pipe_query *
+tc_create_query(struct pipe_context *_pipe, unsigned query_type)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+
+   tc_sync(tc);
+   return tc->pipe->create_query(tc->pipe, query_type);
+}
+
+
+struct tc_query
+{
+   struct pipe_query *query;
+};
+
+#define TC_QUERY_CALL(func) \
+   static void \
+   tc_call_##func(struct threaded_context *tc, void *payload) \
+   { \
+      tc->pipe->func(tc->pipe, ((struct tc_query *) payload)->query); \
+   } \
+   \
+   static void \
+   tc_##func(struct pipe_context *_pipe, struct pipe_query *query) \
+   { \
+      struct threaded_context *tc = threaded_context(_pipe); \
+      tc_add_struct(tc, tc_call_##func, struct tc_query)->query = query; \
+   }
+
+TC_QUERY_CALL(destroy_query)
+TC_QUERY_CALL(begin_query)
+TC_QUERY_CALL(end_query)
+
+
+static boolean
+tc_get_query_result(struct pipe_context *_pipe,
+                    struct pipe_query *query,
+                    boolean wait,
+                    union pipe_query_result *result)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+
+   tc_sync(tc);
+   return tc->pipe->get_query_result(tc->pipe, query, wait, result);
+}
+
+
+struct tc_render_condition
+{
+   struct pipe_query *query;
+   boolean condition;
+   uint mode;
+};
+
+static void
+tc_call_render_condition(struct threaded_context *tc, void *payload)
+{
+   struct tc_render_condition *p = (struct tc_render_condition *) payload;
+   tc->pipe->render_condition(tc->pipe, p->query, p->condition, p->mode);
+}
+
+static void
+tc_render_condition(struct pipe_context *_pipe,
+                    struct pipe_query *query,
+                    boolean condition,
+                    uint mode)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+   struct tc_render_condition *p =
+      tc_add_struct(tc, tc_call_render_condition, struct tc_render_condition);
+
+   p->query = query;
+   p->condition = condition;
+   p->mode = mode;
+}
+
+
+/*
+ * Calls with arrays
+ */
+
+struct tc_sampler_states
+{
+   unsigned shader, start, count;
+   void *states[PIPE_MAX_SAMPLERS];
+};
+
+static void
+tc_call_bind_sampler_states(struct threaded_context *tc, void *payload)
+{
+   struct tc_sampler_states *p = (struct tc_sampler_states *) payload;
+   tc->pipe->bind_sampler_states(tc->pipe, p->shader, p->start, p->count,
+                                 p->states);
+}
+
+static void
+tc_bind_sampler_states(struct pipe_context *_pipe,
+                       unsigned shader, unsigned start, unsigned count,
+                       void **states)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+   struct tc_sampler_states *p;
+
+   assert(count <= PIPE_MAX_SAMPLERS);
+   p = tc_add_call(tc, tc_call_bind_sampler_states,
+                   offsetof(struct tc_sampler_states, states) +
+                   count * sizeof(void *));
+   p->shader = shader;
+   p->start = start;
+   p->count = count;
+   if (states)
+      memcpy(p->states, states, count * sizeof(void *));
+   else
+      memset(p->states, 0, count * sizeof(void *));
+}
+
+
+struct tc_scissors
+{
+   unsigned start, count;
+   struct pipe_scissor_state states[PIPE_MAX_VIEWPORTS];
+};
+
+static void
+tc_call_set_scissor_states(struct threaded_context *tc, void *payload)
+{
+   struct tc_scissors *p = (struct tc_scissors *) payload;
+   tc->pipe->set_scissor_states(tc->pipe, p->start, p->count, p->states);
+}
+
+static void
+tc_set_scissor_states(struct pipe_context *_pipe,
+                      unsigned start, unsigned count,
+                      const struct pipe_scissor_state *states)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+   struct tc_scissors *p;
+
+   assert(count <= PIPE_MAX_VIEWPORTS);
+   p = tc_add_call(tc, tc_call_set_scissor_states,
+                   offsetof(struct tc_scissors, states) +
+                   count * sizeof(states[0]));
+   p->start = start;
+   p->count = count;
+   memcpy(p->states, states, count * sizeof(states[0]));
+}
+
+
+struct tc_viewports
+{
+   unsigned start, count;
+   struct pipe_viewport_state states[PIPE_MAX_VIEWPORTS];
+};
+
+static void
+tc_call_set_viewport_states(struct threaded_context *tc, void *payload)
+{
+   struct tc_viewports *p = (struct tc_viewports *) payload;
+   tc->pipe->set_viewport_states(tc->pipe, p->start, p->count, p->states);
+}
+
+static void
+tc_set_viewport_states(struct pipe_context *_pipe,
+                       unsigned start, unsigned count,
+                       const struct pipe_viewport_state *states)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+   struct tc_viewports *p;
+
+   assert(count <= PIPE_MAX_VIEWPORTS);
+   p = tc_add_call(tc, tc_call_set_viewport_states,
+                   offsetof(struct tc_viewports, states) +
+                   count * sizeof(states[0]));
+   p->start = start;
+   p->count = count;
+   memcpy(p->states, states, count * sizeof(states[0]));
+}
+
+
+/*
+ * Calls referencing resources and views
+ */
+
+struct tc_sampler_views
+{
+   unsigned shader, start, count;
+   struct pipe_sampler_view *views[PIPE_MAX_SHADER_SAMPLER_VIEWS];
+};
+
+static void
+tc_call_set_sampler_views(struct threaded_context *tc, void *payload)
+{
+   struct tc_sampler_views *p = (struct tc_sampler_views *) payload;
+   unsigned i;
+
+   tc->pipe->set_sampler_views(tc->pipe, p->shader, p->start, p->count,
+                               p->views);
+   for (i = 0; i < p->count; i++)
+      pipe_sampler_view_reference(&p->views[i], NULL);
+}
+
+static void
+tc_set_sampler_views(struct pipe_context *_pipe,
+                     unsigned shader, unsigned start, unsigned count,
+                     struct pipe_sampler_view **views)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+   struct tc_sampler_views *p;
+   unsigned i;
+
+   assert(count <= PIPE_MAX_SHADER_SAMPLER_VIEWS);
+   p = tc_add_call(tc, tc_call_set_sampler_views,
+                   offsetof(struct tc_sampler_views, views) +
+                   count * sizeof(views[0]));
+   p->shader = shader;
+   p->start = start;
+   p->count = count;
+   for (i = 0; i < count; i++) {
+      p->views[i] = NULL;
+      pipe_sampler_view_reference(&p->views[i], views ? views[i] : NULL);
+   }
+}
+
+
+struct tc_constant_buffer
+{
+   uint shader, index;
+   boolean is_null;
+   struct pipe_constant_buffer cb;
+};
+
+static void
+tc_call_set_constant_buffer(struct threaded_context *tc, void *payload)
+{
+   struct tc_constant_buffer *p = (struct tc_constant_buffer *) payload;
+   void *old_copy = tc->const_buffers[p->shader][p->index];
+
+   tc->pipe->set_constant_buffer(tc->pipe, p->shader, p->index,
+                                 p->is_null ? NULL : &p->cb);
+
+   /* The driver no longer sees the previous user data */
+   tc->const_buffers[p->shader][p->index] = (void *) p->cb.user_buffer;
+   FREE(old_copy);
+
+   pipe_resource_reference(&p->cb.buffer, NULL);
+}
+
+static void
+tc_set_constant_buffer(struct pipe_context *_pipe,
+                       uint shader, uint index,
+                       struct pipe_constant_buffer *cb)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+   struct tc_constant_buffer *p;
+   void *copy = NULL;
+
+   assert(shader < PIPE_SHADER_TYPES);
+   assert(index < PIPE_MAX_CONSTANT_BUFFERS);
+
+   if (cb && cb->user_buffer) {
+      copy = MALLOC(cb->buffer_size);
+      if (!copy) {
+         tc_sync(tc);
+         tc->pipe->set_constant_buffer(tc->pipe, shader, index, cb);
+         return;
+      }
+      memcpy(copy, cb->user_buffer, cb->buffer_size);
+   }
+
+   p = tc_add_struct(tc, tc_call_set_constant_buffer,
+                     struct tc_constant_buffer);
+   p->shader = shader;
+   p->index = index;
+   p->is_null = cb == NULL;
+   if (cb) {
+      p->cb = *cb;
+      p->cb.buffer = NULL;
+      pipe_resource_reference(&p->cb.buffer, cb->buffer);
+   }
+   else {
+      memset(&p->cb, 0, sizeof(p->cb));
+   }
+   p->cb.user_buffer = copy;
+}
+
+
+static void
+tc_call_set_framebuffer_state(struct threaded_context *tc, void *payload)
+{
+   struct pipe_framebuffer_state *fb =
+      (struct pipe_framebuffer_state *) payload;
+   unsigned i;
+
+   tc->pipe->set_framebuffer_state(tc->pipe, fb);
+   for (i = 0; i < fb->nr_cbufs; i++)
+      pipe_surface_reference(&fb->cbufs[i], NULL);
+   pipe_surface_reference(&fb->zsbuf, NULL);
+}
+
+static void
+tc_set_framebuffer_state(struct pipe_context *_pipe,
+                         const struct pipe_framebuffer_state *state)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+   struct pipe_framebuffer_state *fb =
+      tc_add_struct(tc, tc_call_set_framebuffer_state,
+                    struct pipe_framebuffer_state);
+   unsigned i;
+
+   fb->width = state->width;
+   fb->height = state->height;
+   fb->nr_cbufs = state->nr_cbufs;
+   for (i = 0; i < state->nr_cbufs; i++) {
+      fb->cbufs[i] = NULL;
+      pipe_surface_reference(&fb->cbufs[i], state->cbufs[i]);
+   }
+   fb->zsbuf = NULL;
+   pipe_surface_reference(&fb->zsbuf, state->zsbuf);
+}
+
+
+struct tc_vertex_buffers
+{
+   unsigned start, count;
+   boolean unbind;
+   struct pipe_vertex_buffer buffers[PIPE_MAX_ATTRIBS];
+};
+
+static void
+tc_call_set_vertex_buffers(struct threaded_context *tc, void *payload)
+{
+   struct tc_vertex_buffers *p = (struct tc_vertex_buffers *) payload;
+   unsigned i;
+
+   tc->pipe->set_vertex_buffers(tc->pipe, p->start, p->count,
+                                p->unbind ? NULL : p->buffers);
+   if (!p->unbind) {
+      for (i = 0; i < p->count; i++)
+         pipe_resource_reference(&p->buffers[i].buffer, NULL);
+   }
+}
+
+static void
+tc_set_vertex_buffers(struct pipe_context *_pipe,
+                      unsigned start, unsigned count,
+                      const struct pipe_vertex_buffer *buffers)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+   uint32_t slots = count ? ((~0u >> (32 - count)) << start) : 0;
+   uint32_t user_mask = 0;
+   struct tc_vertex_buffers *p;
+   unsigned i;
+
+   assert(start + count <= PIPE_MAX_ATTRIBS);
+
+   if (buffers) {
+      for (i = 0; i < count; i++) {
+         if (buffers[i].user_buffer)
+            user_mask |= 1u << (start + i);
+      }
+   }
+
+   tc->user_vbuf_mask = (tc->user_vbuf_mask & ~slots) | user_mask;
+
+   /* The user memory is only valid during the call */
+   if (user_mask) {
+      tc_sync(tc);
+      tc->pipe->set_vertex_buffers(tc->pipe, start, count, buffers);
+      return;
+   }
+
+   p = tc_add_call(tc, tc_call_set_vertex_buffers,
+                   offsetof(struct tc_vertex_buffers, buffers) +
+                   (buffers ? count * sizeof(buffers[0]) : 0));
+   p->start = start;
+   p->count = count;
+   p->unbind = buffers == NULL;
+   if (buffers) {
+      for (i = 0; i < count; i++) {
+         p->buffers[i] = buffers[i];
+         p->buffers[i].buffer = NULL;
+         pipe_resource_reference(&p->buffers[i].buffer, buffers[i].buffer);
+      }
+   }
+}
+
+
+struct tc_index_buffer
+{
+   boolean unbind;
+   struct pipe_index_buffer ib;
+};
+
+static void
+tc_call_set_index_buffer(struct threaded_context *tc, void *payload)
+{
+   struct tc_index_buffer *p = (struct tc_index_buffer *) payload;
+
+   tc->pipe->set_index_buffer(tc->pipe, p->unbind ? NULL : &p->ib);
+   pipe_resource_reference(&p->ib.buffer, NULL);
+}
+
+static void
+tc_set_index_buffer(struct pipe_context *_pipe,
+                    const struct pipe_index_buffer *ib)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+   struct tc_index_buffer *p;
+
+   tc->user_index_buffer = ib && ib->user_buffer;
+
+   if (tc->user_index_buffer) {
+      tc_sync(tc);
+      tc->pipe->set_index_buffer(tc->pipe, ib);
+      return;
+   }
+
+   p = tc_add_struct(tc, tc_call_set_index_buffer, struct tc_index_buffer);
+   p->unbind = ib == NULL;
+   if (ib) {
+      p->ib = *ib;
+      p->ib.buffer = NULL;
+      pipe_resource_reference(&p->ib.buffer, ib->buffer);
+   }
+   else {
+      memset(&p->ib, 0, sizeof(p->ib));
+   }
+}
+
+
+struct tc_stream_outputs
+{
+   unsigned count;
+   unsigned append_bitmask;
+   struct pipe_stream_output_target *targets[PIPE_MAX_SO_BUFFERS];
+};
+
+static void
+tc_call_set_stream_output_targets(struct threaded_context *tc, void *payload)
+{
+   struct tc_stream_outputs *p = (struct tc_stream_outputs *) payload;
+   unsigned i;
+
+   tc->pipe->set_stream_output_targets(tc->pipe, p->count, p->targets,
+                                       p->append_bitmask);
+   for (i = 0; i < p->count; i++)
+      pipe_so_target_reference(&p->targets[i], NULL);
+}
+
+static void
+tc_set_stream_output_targets(struct pipe_context *_pipe,
+                             unsigned count,
+                             struct pipe_stream_output_target **targets,
+                             unsigned append_bitmask)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+   struct tc_stream_outputs *p =
+      tc_add_struct(tc, tc_call_set_stream_output_targets,
+                    struct tc_stream_outputs);
+   unsigned i;
+
+   assert(count <= PIPE_MAX_SO_BUFFERS);
+   p->count = count;
+   p->append_bitmask = append_bitmask;
+   for (i = 0; i < count; i++) {
+      p->targets[i] = NULL;
+      pipe_so_target_reference(&p->targets[i], targets[i]);
+   }
+}
+
+
+static void
+tc_call_draw_vbo(struct threaded_context *tc, void *payload)
+{
+   struct pipe_draw_info *info = (struct pipe_draw_info *) payload;
+
+   tc->pipe->draw_vbo(tc->pipe, info);
+   pipe_so_target_reference(&info->count_from_stream_output, NULL);
+}
+
+static void
+tc_draw_vbo(struct pipe_context *_pipe, const struct pipe_draw_info *info)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+   struct pipe_draw_info *p;
+
+   if (tc->user_vbuf_mask || (info->indexed && tc->user_index_buffer)) {
+      tc_sync(tc);
+      tc->pipe->draw_vbo(tc->pipe, info);
+      return;
+   }
+
+   p = tc_add_struct(tc, tc_call_draw_vbo, struct pipe_draw_info);
+   *p = *info;
+   p->count_from_stream_output = NULL;
+   pipe_so_target_reference(&p->count_from_stream_output,
+                            info->count_from_stream_output);
+}
+
+
+struct tc_resource_copy_region
+{
+   struct pipe_resource *dst;
+   unsigned dst_level;
+   unsigned dstx, dsty, dstz;
+   struct pipe_resource *src;
+   unsigned src_level;
+   struct pipe_box src_box;
+};
+
+static void
+tc_call_resource_copy_region(struct threaded_context *tc, void *payload)
+{
+   struct tc_resource_copy_region *p =
+      (struct tc_resource_copy_region *) payload;
+
+   tc->pipe->resource_copy_region(tc->pipe, p->dst, p->dst_level,
+                                  p->dstx, p->dsty, p->dstz,
+                                  p->src, p->src_level, &p->src_box);
+   pipe_resource_reference(&p->dst, NULL);
+   pipe_resource_reference(&p->src, NULL);
+}
+
+static void
+tc_resource_copy_region(struct pipe_context *_pipe,
+                        struct pipe_resource *dst, unsigned dst_level,
+                        unsigned dstx, unsigned dsty, unsigned dstz,
+                        struct pipe_resource *src, unsigned src_level,
+                        const struct pipe_box *src_box)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+   struct tc_resource_copy_region *p =
+      tc_add_struct(tc, tc_call_resource_copy_region,
+                    struct tc_resource_copy_region);
+
+   p->dst = NULL;
+   pipe_resource_reference(&p->dst, dst);
+   p->dst_level = dst_level;
+   p->dstx = dstx;
+   p->dsty = dsty;
+   p->dstz = dstz;
+   p->src = NULL;
+   pipe_resource_reference(&p->src, src);
+   p->src_level = src_level;
+   p->src_box = *src_box;
+}
+
+
+static void
+tc_call_blit(struct threaded_context *tc, void *payload)
+{
+   struct pipe_blit_info *info = (struct pipe_blit_info *) payload;
+
+   tc->pipe->blit(tc->pipe, info);
+   pipe_resource_reference(&info->dst.resource, NULL);
+   pipe_resource_reference(&info->src.resource, NULL);
+}
+
+static void
+tc_blit(struct pipe_context *_pipe, const struct pipe_blit_info *info)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+   struct pipe_blit_info *p =
+      tc_add_struct(tc, tc_call_blit, struct pipe_blit_info);
+
+   *p = *info;
+   p->dst.resource = NULL;
+   p->src.resource = NULL;
+   pipe_resource_reference(&p->dst.resource, info->dst.resource);
+   pipe_resource_reference(&p->src.resource, info->src.resource);
+}
+
+
+struct tc_clear
+{
+   unsigned buffers;
+   boolean has_color;
+   union pipe_color_union color;
+   double depth;
+   unsigned stencil;
+};
+
+static void
+tc_call_clear(struct threaded_context *tc, void *payload)
+{
+   struct tc_clear *p = (struct tc_clear *) payload;
+
+   tc->pipe->clear(tc->pipe, p->buffers, p->has_color ? &p->color : NULL,
+                   p->depth, p->stencil);
+}
+
+static void
+tc_clear(struct pipe_context *_pipe, unsigned buffers,
+         const union pipe_color_union *color, double depth, unsigned stencil)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+   struct tc_clear *p = tc_add_struct(tc, tc_call_clear, struct tc_clear);
+
+   p->buffers = buffers;
+   p->has_color = color != NULL;
+   if (color)
+      p->color = *color;
+   p->depth = depth;
+   p->stencil = stencil;
+}
+
+
+struct tc_clear_render_target
+{
+   struct pipe_surface *dst;
+   union pipe_color_union color;
+   unsigned dstx, dsty, width, height;
+};
+
+static void
+tc_call_clear_render_target(struct threaded_context *tc, void *payload)
+{
+   struct tc_clear_render_target *p =
+      (struct tc_clear_render_target *) payload;
+
+   tc->pipe->clear_render_target(tc->pipe, p->dst, &p->color,
+                                 p->dstx, p->dsty, p->width, p->height);
+   pipe_surface_reference(&p->dst, NULL);
+}
+
+static void
+tc_clear_render_target(struct pipe_context *_pipe,
+                       struct pipe_surface *dst,
+                       const union pipe_color_union *color,
+                       unsigned dstx, unsigned dsty,
+                       unsigned width, unsigned height)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+   struct tc_clear_render_target *p =
+      tc_add_struct(tc, tc_call_clear_render_target,
+                    struct tc_clear_render_target);
+
+   p->dst = NULL;
+   pipe_surface_reference(&p->dst, dst);
+   p->color = *color;
+   p->dstx = dstx;
+   p->dsty = dsty;
+   p->width = width;
+   p->height = height;
+}
+
+
+struct tc_clear_depth_stencil
+{
+   struct pipe_surface *dst;
+   unsigned clear_flags;
+   double depth;
+   unsigned stencil;
+   unsigned dstx, dsty, width, height;
+};
+
+static void
+tc_call_clear_depth_stencil(struct threaded_context *tc, void *payload)
+{
+   struct tc_clear_depth_stencil *p =
+      (struct tc_clear_depth_stencil *) payload;
+
+   tc->pipe->clear_depth_stencil(tc->pipe, p->dst, p->clear_flags,
+                                 p->depth, p->stencil,
+                                 p->dstx, p->dsty, p->width, p->height);
+   pipe_surface_reference(&p->dst, NULL);
+}
+
+static void
+tc_clear_depth_stencil(struct pipe_context *_pipe,
+                       struct pipe_surface *dst,
+                       unsigned clear_flags,
+                       double depth,
+                       unsigned stencil,
+                       unsigned dstx, unsigned dsty,
+                       unsigned width, unsigned height)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+   struct tc_clear_depth_stencil *p =
+      tc_add_struct(tc, tc_call_clear_depth_stencil,
+                    struct tc_clear_depth_stencil);
+
+   p->dst = NULL;
+   pipe_surface_reference(&p->dst, dst);
+   p->clear_flags = clear_flags;
+   p->depth = depth;
+   p->stencil = stencil;
+   p->dstx = dstx;
+   p->dsty = dsty;
+   p->width = width;
+   p->height = height;
+}
+
+
+struct tc_resource
+{
+   struct pipe_resource *resource;
+};
+
+static void
+tc_call_flush_resource(struct threaded_context *tc, void *payload)
+{
+   struct tc_resource *p = (struct tc_resource *) payload;
+
+   tc->pipe->flush_resource(tc->pipe, p->resource);
+   pipe_resource_reference(&p->resource, NULL);
+}
+
+static void
+tc_flush_resource(struct pipe_context *_pipe, struct pipe_resource *resource)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+   struct tc_resource *p =
+      tc_add_struct(tc, tc_call_flush_resource, struct tc_resource);
+
+   p->resource = NULL;
+   pipe_resource_reference(&p->resource, resource);
+}
+
+
+/*
+ * Views, surfaces and stream output targets
+ *
+ * Their context member points to the wrapper, so pipe_*_reference()
+ * destroys them through it.
+ */
+
+static struct pipe_sampler_view *
+tc_create_sampler_view(struct pipe_context *_pipe,
+                       struct pipe_resource *resource,
+                       const struct pipe_sampler_view *templ)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+   struct pipe_sampler_view *view;
+
+   tc_sync(tc);
+   view = tc->pipe->create_sampler_view(tc->pipe, resource, templ);
+   if (view)
+      view->context = &tc->base;
+   return view;
+}
+
+struct tc_sampler_view
+{
+   struct pipe_sampler_view *view;
+};
+
+static void
+tc_call_sampler_view_destroy(struct threaded_context *tc, void *payload)
+{
+   struct tc_sampler_view *p = (struct tc_sampler_view *) payload;
+
+   p->view->context = tc->pipe;
+   tc->pipe->sampler_view_destroy(tc->pipe, p->view);
+}
+
+static void
+tc_sampler_view_destroy(struct pipe_context *_pipe,
+                        struct pipe_sampler_view *view)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+
+   if (tc_is_direct(tc)) {
+      view->context = tc->pipe;
+      tc->pipe->sampler_view_destroy(tc->pipe, view);
+      return;
+   }
+
+   tc_add_struct(tc, tc_call_sampler_view_destroy,
+                 struct tc_sampler_view)->view = view;
+}
+
+
+static struct pipe_surface *
+tc_create_surface(struct pipe_context *_pipe,
+                  struct pipe_resource *resource,
+                  const struct pipe_surface *templ)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+   struct pipe_surface *surf;
+
+   tc_sync(tc);
+   surf = tc->pipe->create_surface(tc->pipe, resource, templ);
+   if (surf)
+      surf->context = &tc->base;
+   return surf;
+}
+
+struct tc_surface
+{
+   struct pipe_surface *surf;
+};
+
+static void
+tc_call_surface_destroy(struct threaded_context *tc, void *payload)
+{
+   struct tc_surface *p = (struct tc_surface *) payload;
+
+   p->surf->context = tc->pipe;
+   tc->pipe->surface_destroy(tc->pipe, p->surf);
+}
+
+static void
+tc_surface_destroy(struct pipe_context *_pipe, struct pipe_surface *surf)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+
+   if (tc_is_direct(tc)) {
+      surf->context = tc->pipe;
+      tc->pipe->surface_destroy(tc->pipe, surf);
+      return;
+   }
+
+   tc_add_struct(tc, tc_call_surface_destroy, struct tc_surface)->surf = surf;
+}
+
+
+static struct pipe_stream_output_target *
+tc_create_stream_output_target(struct pipe_context *_pipe,
+                               struct pipe_resource *resource,
+                               unsigned buffer_offset,
+                               unsigned buffer_size)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+   struct pipe_stream_output_target *target;
+
+   tc_sync(tc);
+   target = tc->pipe->create_stream_output_target(tc->pipe, resource,
+                                                  buffer_offset, buffer_size);
+   if (target)
+      target->context = &tc->base;
+   return target;
+}
+
+struct tc_so_target
+{
+   struct pipe_stream_output_target *target;
+};
+
+static void
+tc_call_stream_output_target_destroy(struct threaded_context *tc,
+                                     void *payload)
+{
+   struct tc_so_target *p = (struct tc_so_target *) payload;
+
+   p->target->context = tc->pipe;
+   tc->pipe->stream_output_target_destroy(tc->pipe, p->target);
+}
+
+static void
+tc_stream_output_target_destroy(struct pipe_context *_pipe,
+                                struct pipe_stream_output_target *target)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+
+   if (tc_is_direct(tc)) {
+      target->context = tc->pipe;
+      tc->pipe->stream_output_target_destroy(tc->pipe, target);
+      return;
+   }
+
+   tc_add_struct(tc, tc_call_stream_output_target_destroy,
+                 struct tc_so_target)->target = target;
+}
+
+
+/*
+ * Transfers and flushes: wait for the worker, then call the driver.
+ */
+
+static void *
+tc_transfer_map(struct pipe_context *_pipe,
+                struct pipe_resource *resource,
+                unsigned level,
+                unsigned usage,
+                const struct pipe_box *box,
+                struct pipe_transfer **transfer)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+
+   tc_sync(tc);
+   return tc->pipe->transfer_map(tc->pipe, resource, level, usage, box,
+                                 transfer);
+}
+
+static void
+tc_transfer_flush_region(struct pipe_context *_pipe,
+                         struct pipe_transfer *transfer,
+                         const struct pipe_box *box)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+
+   tc_sync(tc);
+   tc->pipe->transfer_flush_region(tc->pipe, transfer, box);
+}
+
+static void
+tc_transfer_unmap(struct pipe_context *_pipe, struct pipe_transfer *transfer)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+
+   tc_sync(tc);
+   tc->pipe->transfer_unmap(tc->pipe, transfer);
+}
+
+static void
+tc_transfer_inline_write(struct pipe_context *_pipe,
+                         struct pipe_resource *resource,
+                         unsigned level,
+                         unsigned usage,
+                         const struct pipe_box *box,
+                         const void *data,
+                         unsigned stride,
+                         unsigned layer_stride)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+
+   tc_sync(tc);
+   tc->pipe->transfer_inline_write(tc->pipe, resource, level, usage, box,
+                                   data, stride, layer_stride);
+}
+
+static void
+tc_flush(struct pipe_context *_pipe,
+         struct pipe_fence_handle **fence,
+         unsigned flags)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+
+   tc_sync(tc);
+   tc->pipe->flush(tc->pipe, fence, flags);
+}
+
+
+static void
+tc_set_shader_resources(struct pipe_context *_pipe,
+                        unsigned start, unsigned count,
+                        struct pipe_surface **resources)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+
+   tc_sync(tc);
+   tc->pipe->set_shader_resources(tc->pipe, start, count, resources);
+}
+
+static void
+tc_get_sample_position(struct pipe_context *_pipe,
+                       unsigned sample_count,
+                       unsigned sample_index,
+                       float *out_value)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+
+   tc_sync(tc);
+   tc->pipe->get_sample_position(tc->pipe, sample_count, sample_index,
+                                 out_value);
+}
+
+
+static void
+tc_destroy(struct pipe_context *_pipe)
+{
+   struct threaded_context *tc = threaded_context(_pipe);
+   unsigned i, j;
+
+   tc_sync(tc);
+
+   pipe_mutex_lock(tc->mutex);
+   tc->exit = TRUE;
+   pipe_condvar_broadcast(tc->cond);
+   pipe_mutex_unlock(tc->mutex);
+   pipe_thread_wait(tc->thread);
+
+   tc->pipe->destroy(tc->pipe);
+
+   for (i = 0; i < PIPE_SHADER_TYPES; i++) {
+      for (j = 0; j < PIPE_MAX_CONSTANT_BUFFERS; j++)
+         FREE(tc->const_buffers[i][j]);
+   }
+
+   pipe_tsd_destroy(&tc->worker_tsd);
+   pipe_condvar_destroy(tc->cond);
+   pipe_mutex_destroy(tc->mutex);
+   FREE(tc);
+}
+
+
+struct pipe_context *
+u_threaded_context_create(struct pipe_context *pipe)
+{
+   struct threaded_context *tc;
+
+   if (!pipe)
+      return NULL;
+
+   tc = CALLOC_STRUCT(threaded_context);
+   if (!tc)
+      return NULL;
+
+   tc->pipe = pipe;
+   tc->base.screen = pipe->screen;
+   tc->base.priv = pipe->priv; /* expose wrapped priv data */
+   tc->base.draw = pipe->draw;
+
+   pipe_mutex_init(tc->mutex);
+   pipe_condvar_init(tc->cond);
+   pipe_tsd_init(&tc->worker_tsd);
+
+   tc->thread = pipe_thread_create(tc_worker_thread, tc);
+   if (!tc->thread) {
+      pipe_tsd_destroy(&tc->worker_tsd);
+      pipe_condvar_destroy(tc->cond);
+      pipe_mutex_destroy(tc->mutex);
+      FREE(tc);
+      return NULL;
+   }
+
+#define TC_FUNC(func) \
+   if (pipe->func) \
+      tc->base.func = tc_##func
+
+   tc->base.destroy = tc_destroy;
+   TC_FUNC(draw_vbo);
+   TC_FUNC(render_condition);
+   TC_FUNC(create_query);
+   TC_FUNC(destroy_query);
+   TC_FUNC(begin_query);
+   TC_FUNC(end_query);
+   TC_FUNC(get_query_result);
+   TC_FUNC(create_blend_state);
+   TC_FUNC(bind_blend_state);
+   TC_FUNC(delete_blend_state);
+   TC_FUNC(create_sampler_state);
+   TC_FUNC(bind_sampler_states);
+   TC_FUNC(delete_sampler_state);
+   TC_FUNC(create_rasterizer_state);
+   TC_FUNC(bind_rasterizer_state);
+   TC_FUNC(delete_rasterizer_state);
+   TC_FUNC(create_depth_stencil_alpha_state);
+   TC_FUNC(bind_depth_stencil_alpha_state);
+   TC_FUNC(delete_depth_stencil_alpha_state);
+   TC_FUNC(create_fs_state);
+   TC_FUNC(bind_fs_state);
+   TC_FUNC(delete_fs_state);
+   TC_FUNC(create_vs_state);
+   TC_FUNC(bind_vs_state);
+   TC_FUNC(delete_vs_state);
+   TC_FUNC(create_gs_state);
+   TC_FUNC(bind_gs_state);
+   TC_FUNC(delete_gs_state);
+   TC_FUNC(create_vertex_elements_state);
+   TC_FUNC(bind_vertex_elements_state);
+   TC_FUNC(delete_vertex_elements_state);
+   TC_FUNC(set_blend_color);
+   TC_FUNC(set_stencil_ref);
+   TC_FUNC(set_sample_mask);
+   TC_FUNC(set_clip_state);
+   TC_FUNC(set_constant_buffer);
+   TC_FUNC(set_framebuffer_state);
+   TC_FUNC(set_polygon_stipple);
+   TC_FUNC(set_scissor_states);
+   TC_FUNC(set_viewport_states);
+   TC_FUNC(set_sampler_views);
+   TC_FUNC(set_shader_resources);
+   TC_FUNC(set_vertex_buffers);
+   TC_FUNC(set_index_buffer);
+   TC_FUNC(create_stream_output_target);
+   TC_FUNC(stream_output_target_destroy);
+   TC_FUNC(set_stream_output_targets);
+   TC_FUNC(resource_copy_region);
+   TC_FUNC(blit);
+   TC_FUNC(clear);
+   TC_FUNC(clear_render_target);
+   TC_FUNC(clear_depth_stencil);
+   TC_FUNC(flush);
+   TC_FUNC(create_sampler_view);
+   TC_FUNC(sampler_view_destroy);
+   TC_FUNC(create_surface);
+   TC_FUNC(surface_destroy);
+   TC_FUNC(transfer_map);
+   TC_FUNC(transfer_flush_region);
+   TC_FUNC(transfer_unmap);
+   TC_FUNC(transfer_inline_write);
+   TC_FUNC(texture_barrier);
+   TC_FUNC(get_sample_position);
+   TC_FUNC(flush_resource);
+
+#undef TC_FUNC
+
+   /* Video and compute objects call into the driver context on their own,
+    * so they aren't offered through the wrapper.
+    */
+
+   return &tc->base;
+}
@@ -0,0 +1,74 @@
+/**************************************************************************
+ *
+ * Copyright 2014 The Mesa Authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Threaded pipe_context wrapper.
+ *
+ * The wrapper records most pipe_context calls into batches, which a worker
+ * thread replays into the wrapped context.  The application thread can
+ * then run the state tracker while the driver translates the previous calls
+ * into commands.
+ *
+ * Calls which return something or access resources with the CPU, i.e.
+ * object creation, query results, transfers and flushes, first wait for
+ * the worker to drain the queue and then call the driver directly.  So do
+ * draws while user vertex or index buffers are bound, as their memory is
+ * only valid during the call.  Everything the recorded calls point to is
+ * either copied or referenced until the call has been executed.
+ *
+ * The sampler views, surfaces and stream output targets created through
+ * the wrapper point back to it with their context member, so that their
+ * destruction is recorded too, unless it happens on the worker thread.
+ */
+
+#ifndef U_THREADED_CONTEXT_H
+#define U_THREADED_CONTEXT_H
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+struct pipe_context;
+
+
+/**
+ * Wrap the context, which is then owned by the wrapper and destroyed with
+ * it.
+ * \return NULL on failure, in which case the context is left untouched
+ */
+struct pipe_context *
+u_threaded_context_create(struct pipe_context *pipe);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* U_THREADED_CONTEXT_H */
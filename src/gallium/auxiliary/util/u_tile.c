@@ -41,6 +41,23 @@
 #include "util/u_tile.h"
 
 
+/**
+ * Whether tiles of the format can be converted straight from / to the
+ * mapped transfer, rather than through a packed copy of the tile.
+ * The format's pack and unpack functions then work on the rows in place.
+ */
+static INLINE boolean
+is_direct_tile_format(enum pipe_format format)
+{
+   const struct util_format_description *desc = util_format_description(format);
+
+   return desc &&
+          desc->block.width == 1 &&
+          desc->block.height == 1 &&
+          desc->colorspace != UTIL_FORMAT_COLORSPACE_ZS;
+}
+
+
 /**
  * Move raw block of pixels from transfer object to user memory.
  */
@@ -448,6 +465,14 @@ pipe_get_tile_rgba_format(struct pipe_transfer *pt,
       return;
    }
 
+   if (is_direct_tile_format(format)) {
+      util_format_read_4f(format,
+                          p, dst_stride * sizeof(float),
+                          src, pt->stride,
+                          x, y, w, h);
+      return;
+   }
+
    packed = MALLOC(util_format_get_nblocks(format, w, h) * util_format_get_blocksize(format));
    if (!packed) {
       return;
@@ -488,6 +513,14 @@ pipe_put_tile_rgba_format(struct pipe_transfer *pt,
    if (u_clip_tile(x, y, &w, &h, &pt->box))
       return;
 
+   if (is_direct_tile_format(format)) {
+      util_format_write_4f(format,
+                           p, src_stride * sizeof(float),
+                           dst, pt->stride,
+                           x, y, w, h);
+      return;
+   }
+
    packed = MALLOC(util_format_get_nblocks(format, w, h) * util_format_get_blocksize(format));
 
    if (!packed)
@@ -539,6 +572,14 @@ pipe_put_tile_i_format(struct pipe_transfer *pt,
    if (u_clip_tile(x, y, &w, &h, &pt->box))
       return;
 
+   if (is_direct_tile_format(format)) {
+      util_format_write_4i(format,
+                           p, src_stride * sizeof(float),
+                           dst, pt->stride,
+                           x, y, w, h);
+      return;
+   }
+
    packed = MALLOC(util_format_get_nblocks(format, w, h) * util_format_get_blocksize(format));
 
    if (!packed)
@@ -567,6 +608,14 @@ pipe_put_tile_ui_format(struct pipe_transfer *pt,
    if (u_clip_tile(x, y, &w, &h, &pt->box))
       return;
 
+   if (is_direct_tile_format(format)) {
+      util_format_write_4ui(format,
+                            p, src_stride * sizeof(float),
+                            dst, pt->stride,
+                            x, y, w, h);
+      return;
+   }
+
    packed = MALLOC(util_format_get_nblocks(format, w, h) * util_format_get_blocksize(format));
 
    if (!packed)
@@ -847,6 +896,14 @@ pipe_get_tile_ui_format(struct pipe_transfer *pt,
       return;
    }
 
+   if (is_direct_tile_format(format)) {
+      util_format_read_4ui(format,
+                           p, dst_stride * sizeof(float),
+                           src, pt->stride,
+                           x, y, w, h);
+      return;
+   }
+
    packed = MALLOC(util_format_get_nblocks(format, w, h) * util_format_get_blocksize(format));
    if (!packed) {
       return;
@@ -878,6 +935,14 @@ pipe_get_tile_i_format(struct pipe_transfer *pt,
       return;
    }
 
+   if (is_direct_tile_format(format)) {
+      util_format_read_4i(format,
+                          p, dst_stride * sizeof(float),
+                          src, pt->stride,
+                          x, y, w, h);
+      return;
+   }
+
    packed = MALLOC(util_format_get_nblocks(format, w, h) * util_format_get_blocksize(format));
    if (!packed) {
       return;
@@ -0,0 +1,191 @@
+/**************************************************************************
+ *
+ * Copyright 2014 The Mesa Authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "os/os_thread.h"
+#include "os/os_time.h"
+#include "util/u_debug.h"
+#include "util/u_double_list.h"
+#include "util/u_memory.h"
+#include "util/u_trace_events.h"
+
+
+#define EVENTS_PER_BUFFER 4096
+
+struct trace_event
+{
+   const char *name;
+   int64_t time;
+   char phase;
+};
+
+/** Per-thread event buffer */
+struct trace_buffer
+{
+   struct list_head head;
+   unsigned thread_id;
+   unsigned num_events;
+   struct trace_event events[EVENTS_PER_BUFFER];
+};
+
+
+int util_trace_events_state = UTIL_TRACE_EVENTS_UNKNOWN;
+
+pipe_static_mutex(trace_mutex);
+static FILE *trace_file;
+static boolean trace_file_empty = TRUE;
+static pipe_tsd trace_tsd;
+static struct list_head trace_buffers;
+static unsigned next_thread_id;
+
+
+/**
+ * Write out the events of \p buffer.  Called with trace_mutex held.
+ */
+static void
+write_buffer(struct trace_buffer *buffer)
+{
+   unsigned i;
+
+   if (trace_file) {
+      for (i = 0; i < buffer->num_events; i++) {
+         const struct trace_event *event = &buffer->events[i];
+
+         fprintf(trace_file,
+                 "%s{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%lld,"
+                 "\"pid\":0,\"tid\":%u}",
+                 trace_file_empty ? "\n" : ",\n",
+                 event->name, event->phase, (long long) event->time,
+                 buffer->thread_id);
+         trace_file_empty = FALSE;
+      }
+   }
+
+   buffer->num_events = 0;
+}
+
+static void
+trace_events_exit(void)
+{
+   struct trace_buffer *buffer;
+
+   pipe_mutex_lock(trace_mutex);
+
+   LIST_FOR_EACH_ENTRY(buffer, &trace_buffers, head)
+      write_buffer(buffer);
+
+   fputs("\n]\n", trace_file);
+   fclose(trace_file);
+   trace_file = NULL;
+
+   pipe_mutex_unlock(trace_mutex);
+}
+
+static void
+trace_events_init(void)
+{
+   pipe_mutex_lock(trace_mutex);
+
+   if (util_trace_events_state == UTIL_TRACE_EVENTS_UNKNOWN) {
+      const char *filename = debug_get_option("GALLIUM_TRACE_EVENTS", NULL);
+
+      if (filename) {
+         trace_file = fopen(filename, "w");
+         if (!trace_file)
+            debug_printf("gallium: couldn't open %s for writing trace "
+                         "events\n", filename);
+      }
+
+      if (trace_file) {
+         fputs("[", trace_file);
+         LIST_INITHEAD(&trace_buffers);
+         pipe_tsd_init(&trace_tsd);
+         atexit(trace_events_exit);
+         util_trace_events_state = UTIL_TRACE_EVENTS_ENABLED;
+      }
+      else {
+         util_trace_events_state = UTIL_TRACE_EVENTS_DISABLED;
+      }
+   }
+
+   pipe_mutex_unlock(trace_mutex);
+}
+
+static struct trace_buffer *
+create_buffer(void)
+{
+   struct trace_buffer *buffer = CALLOC_STRUCT(trace_buffer);
+
+   if (!buffer)
+      return NULL;
+
+   pipe_mutex_lock(trace_mutex);
+   buffer->thread_id = next_thread_id++;
+   LIST_ADDTAIL(&buffer->head, &trace_buffers);
+   pipe_mutex_unlock(trace_mutex);
+
+   pipe_tsd_set(&trace_tsd, buffer);
+   return buffer;
+}
+
+/**
+ * Record an event of the calling thread, \p phase is 'B' for the begin
+ * and 'E' for the end of a span.  Use util_trace_event_begin/end().
+ */
+void
+util_trace_event_record(const char *name, char phase)
+{
+   struct trace_buffer *buffer;
+   struct trace_event *event;
+
+   if (util_trace_events_state == UTIL_TRACE_EVENTS_UNKNOWN) {
+      trace_events_init();
+      if (util_trace_events_state != UTIL_TRACE_EVENTS_ENABLED)
+         return;
+   }
+
+   buffer = pipe_tsd_get(&trace_tsd);
+   if (!buffer) {
+      buffer = create_buffer();
+      if (!buffer)
+         return;
+   }
+
+   if (buffer->num_events == EVENTS_PER_BUFFER) {
+      pipe_mutex_lock(trace_mutex);
+      write_buffer(buffer);
+      pipe_mutex_unlock(trace_mutex);
+   }
+
+   event = &buffer->events[buffer->num_events];
+   event->name = name;
+   event->time = os_time_get();
+   event->phase = phase;
+   buffer->num_events++;
+}
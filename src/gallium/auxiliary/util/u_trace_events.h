@@ -0,0 +1,84 @@
+/**************************************************************************
+ *
+ * Copyright 2014 The Mesa Authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Timeline tracing.
+ *
+ * Begin/end events of interesting spans of work (state validation, shader
+ * compiles, flushes, rasterization, command submission, fence waits) are
+ * recorded when GALLIUM_TRACE_EVENTS names an output file, and written in
+ * the JSON format of Chrome's trace viewer (chrome://tracing), one row per
+ * thread.
+ *
+ * Every thread records into its own buffer, which is only written out when
+ * full and at exit.  An event costs a timestamp and a store when enabled
+ * and a compare when not.  Event names must be string literals.
+ */
+
+#ifndef U_TRACE_EVENTS_H
+#define U_TRACE_EVENTS_H
+
+#include "pipe/p_compiler.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+enum util_trace_events_state
+{
+   UTIL_TRACE_EVENTS_UNKNOWN,   /**< GALLIUM_TRACE_EVENTS not read yet */
+   UTIL_TRACE_EVENTS_DISABLED,
+   UTIL_TRACE_EVENTS_ENABLED
+};
+
+extern int util_trace_events_state;
+
+void
+util_trace_event_record(const char *name, char phase);
+
+static INLINE void
+util_trace_event_begin(const char *name)
+{
+   if (unlikely(util_trace_events_state != UTIL_TRACE_EVENTS_DISABLED))
+      util_trace_event_record(name, 'B');
+}
+
+static INLINE void
+util_trace_event_end(const char *name)
+{
+   if (unlikely(util_trace_events_state != UTIL_TRACE_EVENTS_DISABLED))
+      util_trace_event_record(name, 'E');
+}
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* U_TRACE_EVENTS_H */
@@ -38,6 +38,10 @@
 #include "u_upload_mgr.h"
 
 
+/** Maximum number of filled buffers kept around for reuse */
+#define U_UPLOAD_MAX_RETIRED 8
+
+
 struct u_upload_mgr {
    struct pipe_context *pipe;
 
@@ -51,6 +55,11 @@ struct u_upload_mgr {
    unsigned size;   /* Actual size of the upload buffer. */
    unsigned offset; /* Aligned offset to the upload buffer, pointing
                      * at the first unused byte. */
+
+   /* Filled upload buffers, oldest first, see u_upload_recycle_buffers. */
+   struct pipe_resource *retired[U_UPLOAD_MAX_RETIRED];
+   unsigned num_retired;
+   unsigned max_retired;
 };
 
 
@@ -72,6 +81,20 @@ struct u_upload_mgr *u_upload_create( struct pipe_context *pipe,
    return upload;
 }
 
+void u_upload_recycle_buffers( struct u_upload_mgr *upload,
+                               unsigned num_buffers )
+{
+   upload->max_retired = MIN2(num_buffers, U_UPLOAD_MAX_RETIRED);
+
+   while (upload->num_retired > upload->max_retired) {
+      pipe_resource_reference(&upload->retired[0], NULL);
+      upload->num_retired--;
+      memmove(upload->retired, upload->retired + 1,
+              upload->num_retired * sizeof(upload->retired[0]));
+      upload->retired[upload->num_retired] = NULL;
+   }
+}
+
 void u_upload_unmap( struct u_upload_mgr *upload )
 {
    if (upload->transfer) {
@@ -97,9 +120,80 @@ static void u_upload_release_buffer(struct u_upload_mgr *upload)
 }
 
 
+/* Like u_upload_release_buffer, but keep the buffer for later reuse if
+ * recycling is enabled.
+ */
+static void u_upload_retire_buffer(struct u_upload_mgr *upload)
+{
+   u_upload_unmap(upload);
+
+   if (upload->buffer && upload->max_retired) {
+      if (upload->num_retired == upload->max_retired) {
+         pipe_resource_reference(&upload->retired[0], NULL);
+         upload->num_retired--;
+         memmove(upload->retired, upload->retired + 1,
+                 upload->num_retired * sizeof(upload->retired[0]));
+      }
+
+      /* Hand our reference over to the retired list */
+      upload->retired[upload->num_retired++] = upload->buffer;
+      upload->buffer = NULL;
+   }
+
+   u_upload_release_buffer(upload);
+}
+
+
+/* Map the oldest retired buffer without waiting and make it the upload
+ * buffer again.  That only succeeds once the GPU is done with it, and the
+ * oldest buffer is only tried once the list is full so that it has had
+ * the time to get there.
+ */
+static boolean u_upload_reuse_buffer(struct u_upload_mgr *upload,
+                                     unsigned size)
+{
+   struct pipe_resource *buffer = upload->retired[0];
+   struct pipe_transfer *transfer;
+   uint8_t *map;
+
+   if (!upload->max_retired ||
+       upload->num_retired != upload->max_retired ||
+       buffer->width0 < size)
+      return FALSE;
+
+   map = pipe_buffer_map_range(upload->pipe, buffer,
+                               0, buffer->width0,
+                               PIPE_TRANSFER_WRITE |
+                               PIPE_TRANSFER_FLUSH_EXPLICIT |
+                               PIPE_TRANSFER_DONTBLOCK,
+                               &transfer);
+   if (!map)
+      return FALSE;
+
+   upload->num_retired--;
+   memmove(upload->retired, upload->retired + 1,
+           upload->num_retired * sizeof(upload->retired[0]));
+   upload->retired[upload->num_retired] = NULL;
+
+   u_upload_retire_buffer(upload);
+
+   /* The reference moves from the retired list */
+   upload->buffer = buffer;
+   upload->transfer = transfer;
+   upload->map = map;
+   upload->size = buffer->width0;
+   upload->offset = 0;
+   return TRUE;
+}
+
+
 void u_upload_destroy( struct u_upload_mgr *upload )
 {
+   unsigned i;
+
    u_upload_release_buffer( upload );
+   for (i = 0; i < upload->num_retired; i++)
+      pipe_resource_reference(&upload->retired[i], NULL);
    FREE( upload );
 }
 
@@ -108,16 +202,17 @@ static enum pipe_error
 u_upload_alloc_buffer( struct u_upload_mgr *upload,
                        unsigned min_size )
 {
-   unsigned size;
+   unsigned size = align(MAX2(upload->default_size, min_size), 4096);
+
+   if (u_upload_reuse_buffer(upload, size))
+      return PIPE_OK;
 
    /* Release the old buffer, if present:
     */
-   u_upload_release_buffer( upload );
+   u_upload_retire_buffer( upload );
 
    /* Allocate a new one: 
     */
-   size = align(MAX2(upload->default_size, min_size), 4096);
-
    upload->buffer = pipe_buffer_create( upload->pipe->screen,
                                         upload->bind,
                                         PIPE_USAGE_STREAM,
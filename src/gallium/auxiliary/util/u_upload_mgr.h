@@ -56,6 +56,18 @@ struct u_upload_mgr *u_upload_create( struct pipe_context *pipe,
  */
 void u_upload_destroy( struct u_upload_mgr *upload );
 
+/**
+ * Keep up to num_buffers filled upload buffers around and reuse the oldest
+ * of them once the GPU is done with it, rather than allocating a new buffer
+ * every time the current one fills up.  Disabled (0) by default.
+ *
+ * Idleness is checked by mapping with PIPE_TRANSFER_DONTBLOCK, so this
+ * only helps drivers which honour that flag for buffers; others would
+ * wait for the GPU instead.
+ */
+void u_upload_recycle_buffers( struct u_upload_mgr *upload,
+                               unsigned num_buffers );
+
 /**
  * Unmap upload buffer
  *
@@ -46,6 +46,14 @@
  * only the subset of vertices needed for that draw command is uploaded or
  * translated. (the module never translates whole buffers)
  *
+ * Nothing is cached from one draw command to the next.  Buffers can be
+ * written by the CPU through transfers, by the GPU (stream output, copies,
+ * blits) and by other contexts sharing them, none of which this module
+ * sees, so a translated copy could never be trusted to be up to date.
+ * Index bounds are usually provided by the state tracker (st/mesa caches
+ * them in the GL buffer objects), in which case the index buffer is not
+ * mapped here either.
+ *
  *
  * The module consists of two main parts:
  *
@@ -685,29 +685,83 @@ gen_vertex_data(struct vl_compositor *c, struct vl_compositor_state *s, struct u
    u_upload_unmap(c->upload);
 }
 
+static INLINE unsigned
+num_layer_sampler_views(struct vl_compositor_layer *layer)
+{
+   struct pipe_sampler_view **samplers = &layer->sampler_views[0];
+
+   return !samplers[1] ? 1 : !samplers[2] ? 2 : 3;
+}
+
+static INLINE void *
+layer_blend(struct vl_compositor *c, struct vl_compositor_layer *layer, unsigned i)
+{
+   return layer->blend ? layer->blend : i ? c->blend_add : c->blend_clear;
+}
+
+/**
+ * Can layer b be drawn together with layer a, in the same draw call?
+ */
+static INLINE bool
+same_layer_state(struct vl_compositor_layer *a, void *a_blend,
+                 struct vl_compositor_layer *b, void *b_blend)
+{
+   unsigned num_sampler_views = num_layer_sampler_views(a);
+
+   return a->fs == b->fs && a_blend == b_blend &&
+          num_sampler_views == num_layer_sampler_views(b) &&
+          !memcmp(a->sampler_views, b->sampler_views,
+                  num_sampler_views * sizeof(a->sampler_views[0])) &&
+          !memcmp(a->samplers, b->samplers,
+                  num_sampler_views * sizeof(a->samplers[0])) &&
+          !memcmp(&a->viewport, &b->viewport, sizeof(a->viewport));
+}
+
 static void
 draw_layers(struct vl_compositor *c, struct vl_compositor_state *s, struct u_rect *dirty)
 {
-   unsigned vb_index, i;
+   struct vl_compositor_layer *prev = NULL;
+   void *prev_blend = NULL;
+   unsigned vb_index, first = 0, i;
 
    assert(c);
 
+   /*
+    * The quads of all the layers are in the vertex buffer already, so
+    * consecutive layers which only differ in their rectangles, e.g. the
+    * sub-rectangles of the same surface or subtitles sharing a palette,
+    * are drawn with a single draw call.  Only the state which differs
+    * from the previous batch gets bound.
+    */
    for (i = 0, vb_index = 0; i < VL_COMPOSITOR_MAX_LAYERS; ++i) {
       if (s->used_layers & (1 << i)) {
          struct vl_compositor_layer *layer = &s->layers[i];
          struct pipe_sampler_view **samplers = &layer->sampler_views[0];
-         unsigned num_sampler_views = !samplers[1] ? 1 : !samplers[2] ? 2 : 3;
-         void *blend = layer->blend ? layer->blend : i ? c->blend_add : c->blend_clear;
-
-         c->pipe->bind_blend_state(c->pipe, blend);
-         c->pipe->set_viewport_states(c->pipe, 0, 1, &layer->viewport);
-         c->pipe->bind_fs_state(c->pipe, layer->fs);
-         c->pipe->bind_sampler_states(c->pipe, PIPE_SHADER_FRAGMENT, 0,
-                                      num_sampler_views, layer->samplers);
-         c->pipe->set_sampler_views(c->pipe, PIPE_SHADER_FRAGMENT, 0,
-                                    num_sampler_views, samplers);
-
-         util_draw_arrays(c->pipe, PIPE_PRIM_QUADS, vb_index * 4, 4);
+         unsigned num_sampler_views = num_layer_sampler_views(layer);
+         void *blend = layer_blend(c, layer, i);
+
+         if (!prev || !same_layer_state(prev, prev_blend, layer, blend)) {
+            if (prev)
+               util_draw_arrays(c->pipe, PIPE_PRIM_QUADS, first * 4,
+                                (vb_index - first) * 4);
+
+            if (!prev || blend != prev_blend)
+               c->pipe->bind_blend_state(c->pipe, blend);
+            if (!prev || memcmp(&layer->viewport, &prev->viewport,
+                                sizeof(layer->viewport)))
+               c->pipe->set_viewport_states(c->pipe, 0, 1, &layer->viewport);
+            if (!prev || layer->fs != prev->fs)
+               c->pipe->bind_fs_state(c->pipe, layer->fs);
+            c->pipe->bind_sampler_states(c->pipe, PIPE_SHADER_FRAGMENT, 0,
+                                         num_sampler_views, layer->samplers);
+            c->pipe->set_sampler_views(c->pipe, PIPE_SHADER_FRAGMENT, 0,
+                                       num_sampler_views, samplers);
+
+            prev = layer;
+            prev_blend = blend;
+            first = vb_index;
+         }
+
          vb_index++;
 
          if (dirty) {
@@ -720,6 +774,10 @@ draw_layers(struct vl_compositor *c, struct vl_compositor_state *s, struct u_rec
          }
       }
    }
+
+   if (prev)
+      util_draw_arrays(c->pipe, PIPE_PRIM_QUADS, first * 4,
+                       (vb_index - first) * 4);
 }
 
 void
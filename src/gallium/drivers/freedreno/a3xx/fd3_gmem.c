@@ -110,6 +110,18 @@ static bool
 use_hw_binning(struct fd_context *ctx)
 {
 	struct fd_gmem_stateobj *gmem = &ctx->gmem;
+
+	/* The binning pass sorts primitives into bins laid out from the
+	 * framebuffer origin, while with the scissor optimization the tiles
+	 * start at the top-left corner of the maximal scissor.  The
+	 * visibility streams wouldn't match the tiles in that case, so
+	 * don't use binning when the tiles are offset.  Scissor-optimized
+	 * batches are mostly window-system updates with few vertices, which
+	 * don't gain much from binning anyway.
+	 */
+	if (gmem->minx || gmem->miny)
+		return false;
+
 	return fd_binning_enabled && ((gmem->nbins_x * gmem->nbins_y) > 2);
 }
 
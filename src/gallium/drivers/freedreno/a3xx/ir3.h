@@ -365,6 +365,7 @@ int ir3_block_flatten(struct ir3_block *block);
 /* depth calculation: */
 int ir3_delayslots(struct ir3_instruction *assigner,
 		struct ir3_instruction *consumer, unsigned n);
+unsigned ir3_sync_latency(struct ir3_instruction *assigner);
 void ir3_block_depth(struct ir3_block *block);
 
 /* copy-propagate: */
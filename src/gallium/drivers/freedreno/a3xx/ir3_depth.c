@@ -79,6 +79,22 @@ int ir3_delayslots(struct ir3_instruction *assigner,
 	}
 }
 
+/* approximate # of instructions it takes for the result of an sfu or
+ * texture fetch instruction to become available.  These are handled by
+ * the (ss)/(sy) sync bits, so consuming the result earlier is not wrong,
+ * it just stalls the thread until the result arrives.  Used as a soft
+ * latency, to give the scheduler a chance to fill it with independent
+ * work:
+ */
+unsigned ir3_sync_latency(struct ir3_instruction *assigner)
+{
+	if (is_tex(assigner))
+		return 10;
+	if (is_sfu(assigner))
+		return 4;
+	return 0;
+}
+
 static void insert_by_depth(struct ir3_instruction *instr)
 {
 	struct ir3_block *block = instr->block;
@@ -115,7 +131,12 @@ static void ir3_instr_depth(struct ir3_instruction *instr)
 			/* visit child to compute it's depth: */
 			ir3_instr_depth(src->instr);
 
+			/* count the sync latency too, so that paths through
+			 * texture fetches are scheduled first and the fetches
+			 * are issued early:
+			 */
 			sd = ir3_delayslots(src->instr, instr, i-1) +
+					ir3_sync_latency(src->instr) +
 					src->instr->depth;
 
 			instr->depth = MAX2(instr->depth, sd);
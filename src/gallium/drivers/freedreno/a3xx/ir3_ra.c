@@ -197,21 +197,47 @@ static bool compute_clobbers(struct ir3_ra_ctx *ctx,
 	return live || was_live;
 }
 
+/* Find the smallest hole of free registers that fits, so that single
+ * register allocations don't fragment the larger holes needed later for
+ * texture fetch results and input/output ranges.  Otherwise those have
+ * to be placed above everything else, increasing the register footprint
+ * (and reducing the number of waves that can be in flight).  The free
+ * range above the highest live register is only used if there is no
+ * hole that fits.
+ */
 static int find_available(regmask_t *liveregs, int size)
 {
-	unsigned i;
-	for (i = 0; i < MAX_REG - size; i++) {
-		if (!regmask_get(liveregs, &REG(i, X))) {
-			unsigned start = i++;
-			for (; (i < MAX_REG) && ((i - start) < size); i++)
-				if (regmask_get(liveregs, &REG(i, X)))
-					break;
-			if ((i - start) >= size)
-				return start;
+	int best = -1;
+	unsigned i = 0, best_size = ~0;
+
+	while (i < MAX_REG) {
+		unsigned start, n;
+
+		if (regmask_get(liveregs, &REG(i, X))) {
+			i++;
+			continue;
+		}
+
+		start = i;
+		while ((i < MAX_REG) && !regmask_get(liveregs, &REG(i, X)))
+			i++;
+		n = i - start;
+
+		if (n < (unsigned)size)
+			continue;
+
+		if (i == MAX_REG) {
+			/* the unbounded range at the top: */
+			if (best < 0)
+				best = start;
+		} else if (n < best_size) {
+			best = start;
+			best_size = n;
 		}
 	}
-	assert(0);
-	return -1;
+
+	assert(best >= 0);
+	return best;
 }
 
 static int alloc_block(struct ir3_ra_ctx *ctx,
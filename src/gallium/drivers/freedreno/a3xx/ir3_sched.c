@@ -43,11 +43,21 @@
  * reach the end of depth sorted list without being able to insert any
  * instruction, insert nop's.  Repeat until no more unscheduled
  * instructions.
+ *
+ * The results of sfu and texture fetch instructions are waited for
+ * with the (ss)/(sy) sync bits rather than delay slots, so they need
+ * no nop's.  But consuming them right away stalls the thread, so while
+ * scheduling the sync latency is treated as a soft delay: it is filled
+ * with other instructions if there are any that can be scheduled, and
+ * otherwise ignored.  Since a (sy) waits for all outstanding fetches,
+ * this also tends to group the texture fetches ahead of a single sync
+ * point.
  */
 
 struct ir3_sched_ctx {
 	struct ir3_instruction *scheduled;
 	unsigned cnt;
+	bool sync_latency;   /* account for (ss)/(sy) latency */
 };
 
 static struct ir3_instruction *
@@ -153,6 +163,8 @@ static unsigned delay_calc2(struct ir3_sched_ctx *ctx,
 		}
 	} else {
 		delay = ir3_delayslots(assigner, consumer, srcn);
+		if (ctx->sync_latency)
+			delay = MAX2(delay, ir3_sync_latency(assigner));
 		delay -= distance(ctx, assigner, delay);
 	}
 
@@ -270,11 +282,21 @@ static void block_sched(struct ir3_sched_ctx *ctx, struct ir3_block *block)
 			instr = next;
 		}
 
-		/* and if we run out of instructions that can be scheduled,
-		 * then it is time for nop's:
+		/* if we run out of instructions that can be scheduled, try
+		 * again without the soft sync latency, which doesn't need
+		 * nop's:
+		 */
+		if ((cnt > ctx->cnt) && ctx->sync_latency) {
+			ctx->sync_latency = false;
+			continue;
+		}
+
+		/* and if that still doesn't help, then it is time for nop's:
 		 */
 		while (cnt > ctx->cnt)
 			schedule(ctx, ir3_instr_create(block, 0, OPC_NOP), false);
+
+		ctx->sync_latency = true;
 	}
 
 	/* at this point, scheduled list is in reverse order, so fix that: */
@@ -283,7 +305,9 @@ static void block_sched(struct ir3_sched_ctx *ctx, struct ir3_block *block)
 
 void ir3_block_sched(struct ir3_block *block)
 {
-	struct ir3_sched_ctx ctx = {0};
+	struct ir3_sched_ctx ctx = {
+			.sync_latency = true,
+	};
 	ir3_shader_clear_mark(block->shader);
 	block_sched(&ctx, block);
 }
@@ -79,7 +79,7 @@ const static struct {
    [ TGSI_OPCODE_ABS     ] = { false,  false,                  0,  1,  1 },
    [ TGSI_OPCODE_ADD     ] = { false,   true,  TGSI_SWIZZLE_ZERO,  1,  2 },
    [ TGSI_OPCODE_CEIL    ] = { false,  false,                  0,  1,  1 },
-   [ TGSI_OPCODE_CMP     ] = { false,  false,                  0,  1,  2 },
+   [ TGSI_OPCODE_CMP     ] = { false,  false,                  0,  1,  3 },
    [ TGSI_OPCODE_COS     ] = { false,  false,                  0,  1,  1 },
    [ TGSI_OPCODE_DDX     ] = { false,  false,                  0,  1,  0 },
    [ TGSI_OPCODE_DDY     ] = { false,  false,                  0,  1,  0 },
@@ -180,6 +180,87 @@ static boolean op_is_texture(unsigned opcode)
    return op_table[opcode].is_texture;
 }
 
+/* Whether the instruction runs on the texture unit, and so takes part in
+ * the texture indirection phases.
+ */
+static boolean op_uses_tex_unit(unsigned opcode)
+{
+   return (op_is_texture(opcode) ||
+           opcode == TGSI_OPCODE_KILL ||
+           opcode == TGSI_OPCODE_KILL_IF);
+}
+
+static boolean op_is_known(unsigned opcode)
+{
+   switch(opcode)
+   {
+      case TGSI_OPCODE_END:
+      case TGSI_OPCODE_KILL:
+      case TGSI_OPCODE_NOP:
+         return TRUE;
+      default:
+         return (opcode < TGSI_OPCODE_LAST &&
+                 (op_num_dst(opcode) > 0 || op_num_src(opcode) > 0));
+   }
+}
+
+/* Whether each channel of the result only depends on the same channel of
+ * the (swizzled) sources.
+ */
+static boolean op_is_per_channel(unsigned opcode)
+{
+   switch(opcode)
+   {
+      case TGSI_OPCODE_ABS:
+      case TGSI_OPCODE_ADD:
+      case TGSI_OPCODE_CEIL:
+      case TGSI_OPCODE_CMP:
+      case TGSI_OPCODE_FLR:
+      case TGSI_OPCODE_FRC:
+      case TGSI_OPCODE_LRP:
+      case TGSI_OPCODE_MAD:
+      case TGSI_OPCODE_MAX:
+      case TGSI_OPCODE_MIN:
+      case TGSI_OPCODE_MOV:
+      case TGSI_OPCODE_MUL:
+      case TGSI_OPCODE_SEQ:
+      case TGSI_OPCODE_SGE:
+      case TGSI_OPCODE_SGT:
+      case TGSI_OPCODE_SLE:
+      case TGSI_OPCODE_SLT:
+      case TGSI_OPCODE_SNE:
+      case TGSI_OPCODE_SSG:
+      case TGSI_OPCODE_SUB:
+      case TGSI_OPCODE_TRUNC:
+         return TRUE;
+      default:
+         return FALSE;
+   }
+}
+
+/* Whether the opcode translates to a single i915 instruction reading its
+ * sources as they are, so that reading a constant instead of a temporary
+ * doesn't add instructions.
+ */
+static boolean op_takes_constants(unsigned opcode)
+{
+   switch(opcode)
+   {
+      case TGSI_OPCODE_ADD:
+      case TGSI_OPCODE_CMP:
+      case TGSI_OPCODE_DP3:
+      case TGSI_OPCODE_DP4:
+      case TGSI_OPCODE_MAD:
+      case TGSI_OPCODE_MAX:
+      case TGSI_OPCODE_MIN:
+      case TGSI_OPCODE_MOV:
+      case TGSI_OPCODE_MUL:
+         return TRUE;
+      default:
+         return FALSE;
+   }
+}
+
 static unsigned op_neutral_element(unsigned opcode)
 {
    unsigned ne = op_table[opcode].neutral_element;
@@ -219,6 +300,68 @@ static void set_neutral_element_swizzle(struct i915_full_src_register *r,
       r->Register.SwizzleW = TGSI_SWIZZLE_W;
 }
 
+static unsigned get_swizzle(const struct i915_src_register *r, unsigned chan)
+{
+   switch(chan)
+   {
+      case 0:
+         return r->SwizzleX;
+      case 1:
+         return r->SwizzleY;
+      case 2:
+         return r->SwizzleZ;
+      default:
+         return r->SwizzleW;
+   }
+}
+
+static void set_swizzle(struct i915_src_register *r, unsigned chan,
+                        unsigned swizzle)
+{
+   switch(chan)
+   {
+      case 0:
+         r->SwizzleX = swizzle;
+         break;
+      case 1:
+         r->SwizzleY = swizzle;
+         break;
+      case 2:
+         r->SwizzleZ = swizzle;
+         break;
+      default:
+         r->SwizzleW = swizzle;
+         break;
+   }
+}
+
+/*
+ * Makes o read what outer reads, when outer reads the register written
+ * with inner.  Neither may have the absolute flag set.
+ */
+static void compose_src_reg(struct i915_full_src_register *o,
+                            const struct i915_full_src_register *inner,
+                            const struct i915_full_src_register *outer)
+{
+   struct i915_full_src_register r = *inner;
+   unsigned chan, swizzle;
+
+   for (chan = 0; chan < 4; chan++) {
+      swizzle = get_swizzle(&outer->Register, chan);
+      if (swizzle <= TGSI_SWIZZLE_W)
+         swizzle = get_swizzle(&inner->Register, swizzle);
+      set_swizzle(&r.Register, chan, swizzle);
+   }
+   r.Register.Negate = inner->Register.Negate ^ outer->Register.Negate;
+
+   *o = r;
+}
+
+static boolean is_const_file(unsigned file)
+{
+   return (file == TGSI_FILE_CONSTANT || file == TGSI_FILE_IMMEDIATE);
+}
+
 static void copy_src_reg(struct i915_src_register *o, const struct tgsi_src_register *i)
 {
    o->File      = i->File;
@@ -272,7 +415,7 @@ static void liveness_mark_written(struct i915_optimize_context *ctx,
       dst_reg_index = dst_reg->Register.Index;
       assert(dst_reg_index < TGSI_EXEC_NUM_TEMPS);
       /* dead -> live transition */
-      if (ctx->first_write[dst_reg_index] != -1)
+      if (ctx->first_write[dst_reg_index] == -1)
          ctx->first_write[dst_reg_index] = pos;
    }
 }
@@ -286,7 +429,7 @@ static void liveness_mark_read(struct i915_optimize_context *ctx,
       src_reg_index = src_reg->Register.Index;
       assert(src_reg_index < TGSI_EXEC_NUM_TEMPS);
       /* live -> dead transition */
-      if (ctx->last_read[src_reg_index] != -1)
+      if (ctx->last_read[src_reg_index] == -1)
          ctx->last_read[src_reg_index] = pos;
    }
 }
@@ -416,6 +559,7 @@ static void i915_fpc_optimize_mov_before_tex(struct i915_optimize_context *ctx,
         op_is_texture(next->FullInstruction.Instruction.Opcode) &&
         target_is_texture2d(next->FullInstruction.Texture.Texture) &&
         same_src_dst_reg(&next->FullInstruction.Src[0], &current->FullInstruction.Dst[0]) &&
+        (current->FullInstruction.Dst[0].Register.WriteMask & i915_tex_mask(next)) == i915_tex_mask(next) &&
         is_unswizzled(&current->FullInstruction.Src[0], i915_tex_mask(next)) &&
         unused_from(ctx, &current->FullInstruction.Dst[0], index))
    {
@@ -598,11 +742,647 @@ static void i915_fpc_optimize_useless_mov_after_inst(struct i915_optimize_contex
    }
 }
 
+/* Returns the mask of the texture coordinate components the hardware uses */
+static unsigned tex_coord_mask(struct i915_full_instruction *inst)
+{
+   unsigned mask = mask_for_unswizzled(i915_num_coords(inst->Texture.Texture));
+
+   /* The projection and the LOD bias come from W */
+   if (inst->Instruction.Opcode == TGSI_OPCODE_TXP ||
+       inst->Instruction.Opcode == TGSI_OPCODE_TXB)
+      mask |= TGSI_WRITEMASK_W;
+
+   return mask;
+}
+
+/* Returns the mask of the register components an instruction reads from
+ * one of its sources.
+ */
+static unsigned src_read_mask(struct i915_full_instruction *inst, unsigned src)
+{
+   struct i915_src_register *r = &inst->Src[src].Register;
+   unsigned chan_mask, mask = 0;
+   unsigned chan, swizzle;
+
+   if (op_is_per_channel(inst->Instruction.Opcode))
+      chan_mask = inst->Dst[0].Register.WriteMask;
+   else if (op_is_texture(inst->Instruction.Opcode) && src == 0)
+      chan_mask = tex_coord_mask(inst);
+   else
+      chan_mask = TGSI_WRITEMASK_XYZW;
+
+   for (chan = 0; chan < 4; chan++) {
+      swizzle = get_swizzle(r, chan);
+      if ((chan_mask & (1 << chan)) && swizzle <= TGSI_SWIZZLE_W)
+         mask |= 1 << swizzle;
+   }
+   return mask;
+}
+
+static boolean reads_reg(struct i915_full_instruction *inst,
+                         unsigned file, int index)
+{
+   int i;
+
+   for (i = 0; i < op_num_src(inst->Instruction.Opcode); i++) {
+      if (inst->Src[i].Register.File == file &&
+          inst->Src[i].Register.Index == index)
+         return TRUE;
+   }
+   return FALSE;
+}
+
+static boolean writes_reg(struct i915_full_instruction *inst,
+                          unsigned file, int index)
+{
+   return (op_has_dst(inst->Instruction.Opcode) &&
+           inst->Dst[0].Register.File == file &&
+           inst->Dst[0].Register.Index == index);
+}
+
+/* Number of different constant registers an instruction reads.  The
+ * translator has to copy all but one of them to temporaries first.
+ */
+static unsigned num_const_regs(struct i915_full_instruction *inst)
+{
+   unsigned num = 0;
+   int i, j;
+
+   for (i = 0; i < op_num_src(inst->Instruction.Opcode); i++) {
+      if (!is_const_file(inst->Src[i].Register.File))
+         continue;
+      for (j = 0; j < i; j++) {
+         if (inst->Src[j].Register.File == inst->Src[i].Register.File &&
+             inst->Src[j].Register.Index == inst->Src[i].Register.Index)
+            break;
+      }
+      if (j == i)
+         num++;
+   }
+   return num;
+}
+
+/*
+ * Returns whether the program only uses opcodes this file knows about, no
+ * indirect addressing, and ends with its only END.  Otherwise only the
+ * peephole optimizations are done.
+ */
+static boolean is_straight_line(struct i915_token_list *tokens)
+{
+   struct i915_full_instruction *inst;
+   boolean ended = FALSE;
+   int i, j;
+
+   for(i = 0; i < tokens->NumTokens; i++)
+   {
+      if (tokens->Tokens[i].Token.Type != TGSI_TOKEN_TYPE_INSTRUCTION)
+         continue;
+
+      inst = &tokens->Tokens[i].FullInstruction;
+
+      if (ended || !op_is_known(inst->Instruction.Opcode))
+         return FALSE;
+
+      if (op_has_dst(inst->Instruction.Opcode) &&
+          (inst->Dst[0].Register.Indirect ||
+           (inst->Dst[0].Register.File == TGSI_FILE_TEMPORARY &&
+            inst->Dst[0].Register.Index >= TGSI_EXEC_NUM_TEMPS)))
+         return FALSE;
+
+      for (j = 0; j < op_num_src(inst->Instruction.Opcode); j++) {
+         if (inst->Src[j].Register.Indirect ||
+             (inst->Src[j].Register.File == TGSI_FILE_TEMPORARY &&
+              inst->Src[j].Register.Index >= TGSI_EXEC_NUM_TEMPS))
+            return FALSE;
+      }
+
+      if (inst->Instruction.Opcode == TGSI_OPCODE_END)
+         ended = TRUE;
+   }
+
+   return ended;
+}
+
+/*
+ * Returns whether the components in mask of a temporary are overwritten
+ * after instruction "from" before being read again.
+ */
+static boolean temp_dead_after(struct i915_token_list *tokens,
+                               int index, unsigned mask, int from)
+{
+   struct i915_full_instruction *inst;
+   int i, j;
+
+   for(i = from + 1; i < tokens->NumTokens && mask; i++)
+   {
+      if (tokens->Tokens[i].Token.Type != TGSI_TOKEN_TYPE_INSTRUCTION)
+         continue;
+
+      inst = &tokens->Tokens[i].FullInstruction;
+
+      for (j = 0; j < op_num_src(inst->Instruction.Opcode); j++) {
+         if (inst->Src[j].Register.File == TGSI_FILE_TEMPORARY &&
+             inst->Src[j].Register.Index == index &&
+             (src_read_mask(inst, j) & mask))
+            return FALSE;
+      }
+
+      if (writes_reg(inst, TGSI_FILE_TEMPORARY, index))
+         mask &= ~inst->Dst[0].Register.WriteMask;
+   }
+
+   return TRUE;
+}
+
+/*
+ * Finds the first instruction after "from" reading the temporary written
+ * by "from", as long as neither that temporary nor, if keep_srcs is set,
+ * any of the sources of "from" are written in between.  Returns -1
+ * otherwise.
+ */
+static int find_next_reader(struct i915_token_list *tokens, int from,
+                            boolean keep_srcs)
+{
+   struct i915_full_instruction *def = &tokens->Tokens[from].FullInstruction;
+   struct i915_full_instruction *inst;
+   int index = def->Dst[0].Register.Index;
+   int i, j;
+
+   for(i = from + 1; i < tokens->NumTokens; i++)
+   {
+      if (tokens->Tokens[i].Token.Type != TGSI_TOKEN_TYPE_INSTRUCTION)
+         continue;
+
+      inst = &tokens->Tokens[i].FullInstruction;
+
+      if (reads_reg(inst, TGSI_FILE_TEMPORARY, index))
+         return i;
+
+      if (inst->Instruction.Opcode == TGSI_OPCODE_END ||
+          writes_reg(inst, TGSI_FILE_TEMPORARY, index))
+         return -1;
+
+      for (j = 0; keep_srcs && j < op_num_src(def->Instruction.Opcode); j++) {
+         if (writes_reg(inst, def->Src[j].Register.File,
+                        def->Src[j].Register.Index))
+            return -1;
+      }
+   }
+
+   return -1;
+}
+
+/*
+ * Returns whether the value written by instruction "from" is only read by
+ * the instruction "use", and only from the components it wrote.
+ */
+static boolean is_only_reader(struct i915_token_list *tokens, int from, int use)
+{
+   struct i915_full_instruction *def = &tokens->Tokens[from].FullInstruction;
+   struct i915_full_instruction *inst = &tokens->Tokens[use].FullInstruction;
+   int index = def->Dst[0].Register.Index;
+   unsigned mask = def->Dst[0].Register.WriteMask;
+   int j;
+
+   for (j = 0; j < op_num_src(inst->Instruction.Opcode); j++) {
+      if (inst->Src[j].Register.File == TGSI_FILE_TEMPORARY &&
+          inst->Src[j].Register.Index == index &&
+          (src_read_mask(inst, j) & ~mask))
+         return FALSE;
+   }
+
+   if (writes_reg(inst, TGSI_FILE_TEMPORARY, index))
+      mask &= ~inst->Dst[0].Register.WriteMask;
+
+   return temp_dead_after(tokens, index, mask, use);
+}
+
+/*
+ * Copy propagation, optimize away things like:
+ *    MOV TEMP[0].xy, IN[0].yxxx
+ *    ADD TEMP[1].xy, TEMP[0].xyyy, CONST[0]
+ * into:
+ *    NOP
+ *    ADD TEMP[1].xy, IN[0].yxxx, CONST[0]
+ */
+static boolean i915_fpc_optimize_copy_propagation(struct i915_token_list *tokens,
+                                                  int index)
+{
+   union i915_full_token *current = &tokens->Tokens[index];
+   struct i915_full_instruction *mov, *use, inst;
+   int next, i;
+
+   if (current->Token.Type != TGSI_TOKEN_TYPE_INSTRUCTION)
+      return FALSE;
+
+   mov = &current->FullInstruction;
+   if (mov->Instruction.Opcode != TGSI_OPCODE_MOV ||
+       mov->Instruction.Saturate != TGSI_SAT_NONE ||
+       mov->Dst[0].Register.File != TGSI_FILE_TEMPORARY ||
+       mov->Src[0].Register.Absolute)
+      return FALSE;
+
+   next = find_next_reader(tokens, index, TRUE);
+   if (next < 0)
+      return FALSE;
+
+   use = &tokens->Tokens[next].FullInstruction;
+   inst = *use;
+
+   for (i = 0; i < op_num_src(use->Instruction.Opcode); i++) {
+      if (!same_src_dst_reg(&use->Src[i], &mov->Dst[0]))
+         continue;
+      if (use->Src[i].Register.Absolute)
+         return FALSE;
+      compose_src_reg(&inst.Src[i], &mov->Src[0], &use->Src[i]);
+   }
+
+   if (op_is_texture(use->Instruction.Opcode)) {
+      /* Texture coordinates can't be swizzled, see
+       * i915_fpc_optimize_mov_before_tex() */
+      if (!target_is_texture2d(use->Texture.Texture) ||
+          inst.Src[0].Register.Negate ||
+          !is_unswizzled(&inst.Src[0], i915_tex_mask(&tokens->Tokens[next])))
+         return FALSE;
+   }
+   else if (is_const_file(mov->Src[0].Register.File) &&
+            (!op_takes_constants(use->Instruction.Opcode) ||
+             num_const_regs(&inst) > 1)) {
+      return FALSE;
+   }
+
+   if (!is_only_reader(tokens, index, next))
+      return FALSE;
+
+   *use = inst;
+   mov->Instruction.Opcode = TGSI_OPCODE_NOP;
+   return TRUE;
+}
+
+/*
+ * Optimize away moves of a result to its final register, even if other
+ * instructions come in between:
+ *    ADD TEMP[0].xyz, TEMP[1], TEMP[2]
+ *    MUL TEMP[3], TEMP[1], CONST[0]
+ *    MOV OUT[0].xyz, TEMP[0]
+ * into:
+ *    ADD OUT[0].xyz, TEMP[1], TEMP[2]
+ *    MUL TEMP[3], TEMP[1], CONST[0]
+ *    NOP
+ */
+static boolean i915_fpc_optimize_dst_propagation(struct i915_token_list *tokens,
+                                                 int index)
+{
+   union i915_full_token *current = &tokens->Tokens[index];
+   struct i915_full_instruction *def, *mov, *inst;
+   int next, i;
+
+   if (current->Token.Type != TGSI_TOKEN_TYPE_INSTRUCTION)
+      return FALSE;
+
+   def = &current->FullInstruction;
+   if (!op_has_dst(def->Instruction.Opcode) ||
+       op_uses_tex_unit(def->Instruction.Opcode) ||
+       def->Dst[0].Register.File != TGSI_FILE_TEMPORARY)
+      return FALSE;
+
+   next = find_next_reader(tokens, index, FALSE);
+   if (next < 0)
+      return FALSE;
+
+   mov = &tokens->Tokens[next].FullInstruction;
+   if (mov->Instruction.Opcode != TGSI_OPCODE_MOV ||
+       mov->Instruction.Saturate != TGSI_SAT_NONE ||
+       mov->Src[0].Register.Absolute ||
+       mov->Src[0].Register.Negate ||
+       mov->Dst[0].Register.WriteMask != def->Dst[0].Register.WriteMask ||
+       !is_unswizzled(&mov->Src[0], mov->Dst[0].Register.WriteMask) ||
+       !is_only_reader(tokens, index, next))
+      return FALSE;
+
+   /* The final register must not be used in between */
+   for (i = index + 1; i < next; i++) {
+      if (tokens->Tokens[i].Token.Type != TGSI_TOKEN_TYPE_INSTRUCTION)
+         continue;
+      inst = &tokens->Tokens[i].FullInstruction;
+      if (reads_reg(inst, mov->Dst[0].Register.File, mov->Dst[0].Register.Index) ||
+          writes_reg(inst, mov->Dst[0].Register.File, mov->Dst[0].Register.Index))
+         return FALSE;
+   }
+
+   def->Dst[0] = mov->Dst[0];
+   mov->Instruction.Opcode = TGSI_OPCODE_NOP;
+   return TRUE;
+}
+
+/*
+ * Fuse a multiplication into the addition reading it:
+ *    MUL TEMP[0].xyz, IN[0], CONST[0]
+ *    ADD OUT[0].xyz, TEMP[0], -IN[1]
+ * into:
+ *    NOP
+ *    MAD OUT[0].xyz, IN[0], CONST[0], -IN[1]
+ */
+static boolean i915_fpc_optimize_mad(struct i915_token_list *tokens,
+                                     int index)
+{
+   union i915_full_token *current = &tokens->Tokens[index];
+   struct i915_full_instruction *mul, *add, inst;
+   struct i915_full_src_register *product;
+   unsigned chan;
+   int next, i;
+
+   if (current->Token.Type != TGSI_TOKEN_TYPE_INSTRUCTION)
+      return FALSE;
+
+   mul = &current->FullInstruction;
+   if (mul->Instruction.Opcode != TGSI_OPCODE_MUL ||
+       mul->Instruction.Saturate != TGSI_SAT_NONE ||
+       mul->Dst[0].Register.File != TGSI_FILE_TEMPORARY ||
+       mul->Src[0].Register.Absolute ||
+       mul->Src[1].Register.Absolute)
+      return FALSE;
+
+   next = find_next_reader(tokens, index, TRUE);
+   if (next < 0)
+      return FALSE;
+
+   add = &tokens->Tokens[next].FullInstruction;
+   if (add->Instruction.Opcode != TGSI_OPCODE_ADD)
+      return FALSE;
+
+   /* Exactly one of the addends must be the product */
+   if (same_src_dst_reg(&add->Src[0], &mul->Dst[0]) ==
+       same_src_dst_reg(&add->Src[1], &mul->Dst[0]))
+      return FALSE;
+
+   i = same_src_dst_reg(&add->Src[0], &mul->Dst[0]) ? 0 : 1;
+   product = &add->Src[i];
+   if (product->Register.Absolute)
+      return FALSE;
+
+   /* A product can't be swizzled to a constant */
+   for (chan = 0; chan < 4; chan++) {
+      if ((add->Dst[0].Register.WriteMask & (1 << chan)) &&
+          get_swizzle(&product->Register, chan) > TGSI_SWIZZLE_W)
+         return FALSE;
+   }
+
+   inst = *add;
+   inst.Instruction.Opcode = TGSI_OPCODE_MAD;
+   inst.Instruction.NumSrcRegs = 3;
+   compose_src_reg(&inst.Src[0], &mul->Src[0], product);
+   compose_src_reg(&inst.Src[1], &mul->Src[1], product);
+   inst.Src[1].Register.Negate = mul->Src[1].Register.Negate;
+   inst.Src[2] = add->Src[1 - i];
+
+   if (num_const_regs(&inst) > 1 ||
+       !is_only_reader(tokens, index, next))
+      return FALSE;
+
+   *add = inst;
+   mul->Instruction.Opcode = TGSI_OPCODE_NOP;
+   return TRUE;
+}
+
+/*
+ * Dead code elimination: turn the instructions whose results are never
+ * read into NOPs.  Liveness is tracked for each temporary component,
+ * walking the program backwards.
+ */
+static void i915_fpc_optimize_dead_code(struct i915_token_list *tokens)
+{
+   unsigned live[TGSI_EXEC_NUM_TEMPS];
+   struct i915_full_instruction *inst;
+   int dst_reg_index;
+   int i, j;
+
+   memset(live, 0, sizeof(live));
+
+   for(i = tokens->NumTokens - 1; i >= 0; i--)
+   {
+      if (tokens->Tokens[i].Token.Type != TGSI_TOKEN_TYPE_INSTRUCTION)
+         continue;
+
+      inst = &tokens->Tokens[i].FullInstruction;
+
+      if (op_has_dst(inst->Instruction.Opcode) &&
+          inst->Dst[0].Register.File == TGSI_FILE_TEMPORARY) {
+         dst_reg_index = inst->Dst[0].Register.Index;
+         if (!(inst->Dst[0].Register.WriteMask & live[dst_reg_index])) {
+            inst->Instruction.Opcode = TGSI_OPCODE_NOP;
+            continue;
+         }
+         live[dst_reg_index] &= ~inst->Dst[0].Register.WriteMask;
+      }
+
+      for (j = 0; j < op_num_src(inst->Instruction.Opcode); j++) {
+         if (inst->Src[j].Register.File == TGSI_FILE_TEMPORARY)
+            live[inst->Src[j].Register.Index] |= src_read_mask(inst, j);
+      }
+   }
+}
+
+/* Whether the translator can use the texture coordinate register as it is */
+static boolean tex_coord_is_plain(union i915_full_token *instr)
+{
+   struct i915_full_instruction *inst = &instr->FullInstruction;
+   unsigned mask;
+
+   switch(inst->Instruction.Opcode)
+   {
+      case TGSI_OPCODE_KILL:
+         return FALSE;
+      case TGSI_OPCODE_KILL_IF:
+         mask = TGSI_WRITEMASK_X;
+         break;
+      default:
+         mask = i915_tex_mask(instr);
+         break;
+   }
+
+   return (!inst->Src[0].Register.Negate &&
+           is_unswizzled(&inst->Src[0], mask));
+}
+
+/*
+ * Counts the texture indirection phases the translator will use for the
+ * program, following the rules in i915_emit_texld().
+ */
+static unsigned count_tex_phases(struct i915_token_list *tokens)
+{
+   unsigned register_phases[TGSI_EXEC_NUM_TEMPS];
+   unsigned phase = 1;
+   struct i915_full_instruction *inst;
+   int i;
+
+   memset(register_phases, 0, sizeof(register_phases));
+
+   for(i = 0; i < tokens->NumTokens; i++)
+   {
+      if (tokens->Tokens[i].Token.Type != TGSI_TOKEN_TYPE_INSTRUCTION)
+         continue;
+
+      inst = &tokens->Tokens[i].FullInstruction;
+
+      if (op_uses_tex_unit(inst->Instruction.Opcode)) {
+         if (op_has_dst(inst->Instruction.Opcode) &&
+             inst->Dst[0].Register.File == TGSI_FILE_OUTPUT)
+            phase++;
+
+         /* Swizzled coordinates are copied to a temporary first */
+         if (!tex_coord_is_plain(&tokens->Tokens[i]))
+            phase++;
+         else if (inst->Src[0].Register.File == TGSI_FILE_TEMPORARY &&
+                  register_phases[inst->Src[0].Register.Index] == phase)
+            phase++;
+      }
+
+      if (op_has_dst(inst->Instruction.Opcode) &&
+          inst->Dst[0].Register.File == TGSI_FILE_TEMPORARY)
+         register_phases[inst->Dst[0].Register.Index] = phase;
+   }
+
+   return phase;
+}
+
+/* Order of the instructions of the same phase */
+static unsigned tex_phase_class(struct i915_full_instruction *inst)
+{
+   if (!op_uses_tex_unit(inst->Instruction.Opcode))
+      return 1;
+   /* Writing the texture unit result to an output ends the phase */
+   if (op_has_dst(inst->Instruction.Opcode) &&
+       inst->Dst[0].Register.File == TGSI_FILE_OUTPUT)
+      return 2;
+   return 0;
+}
+
+/*
+ * Texture indirection scheduling.
+ *
+ * The i915 runs a fragment program in at most I915_MAX_TEX_INDIRECT phases,
+ * each made of texture loads followed by arithmetic, and a new phase starts
+ * whenever a texture load reads a coordinate computed in the current phase.
+ * Interleaved independent arithmetic and texture loads thus waste phases:
+ *    TEX TEMP[0], IN[0], SAMP[0], 2D
+ *    MUL TEMP[1], TEMP[0], CONST[0]
+ *    TEX TEMP[1], TEMP[1], SAMP[1], 2D     (phase 2)
+ *    MUL TEMP[2], IN[1], CONST[1]
+ *    TEX TEMP[2], TEMP[2], SAMP[2], 2D     (phase 3)
+ * Order the instructions by the first phase they can run in, texture loads
+ * before arithmetic, so that the second MUL moves before the first TEX and
+ * the last TEX joins phase 2.  The new order is only kept if it takes fewer
+ * phases.
+ */
+static void i915_fpc_optimize_tex_phases(struct i915_token_list *tokens)
+{
+   struct i915_token_list sorted;
+   struct i915_full_instruction *inst_i, *inst_j;
+   int *order, *phase, *class;
+   int num = 0, min;
+   int i, j, k;
+
+   order = MALLOC(tokens->NumTokens * sizeof(int));
+   phase = MALLOC(tokens->NumTokens * sizeof(int));
+   class = MALLOC(tokens->NumTokens * sizeof(int));
+   sorted.NumTokens = tokens->NumTokens;
+   sorted.Tokens = MALLOC(tokens->NumTokens * sizeof(union i915_full_token));
+   if (!order || !phase || !class || !sorted.Tokens)
+      goto out;
+
+   for(i = 0; i < tokens->NumTokens; i++)
+   {
+      if (tokens->Tokens[i].Token.Type == TGSI_TOKEN_TYPE_INSTRUCTION &&
+          tokens->Tokens[i].FullInstruction.Instruction.Opcode != TGSI_OPCODE_NOP &&
+          tokens->Tokens[i].FullInstruction.Instruction.Opcode != TGSI_OPCODE_END)
+         order[num++] = i;
+   }
+
+   /* Find the first phase of each instruction, making sure it still comes
+    * after the ones it depends on once sorted.
+    */
+   for (j = 0; j < num; j++) {
+      inst_j = &tokens->Tokens[order[j]].FullInstruction;
+      class[j] = tex_phase_class(inst_j);
+      phase[j] = 1;
+
+      if (op_uses_tex_unit(inst_j->Instruction.Opcode) &&
+          !tex_coord_is_plain(&tokens->Tokens[order[j]]))
+         phase[j] = 2;
+
+      for (i = 0; i < j; i++) {
+         inst_i = &tokens->Tokens[order[i]].FullInstruction;
+         min = -1;
+
+         if (op_has_dst(inst_i->Instruction.Opcode) &&
+             inst_i->Dst[0].Register.File == TGSI_FILE_TEMPORARY &&
+             reads_reg(inst_j, TGSI_FILE_TEMPORARY,
+                       inst_i->Dst[0].Register.Index)) {
+            /* read after write */
+            min = phase[i];
+            if (op_uses_tex_unit(inst_j->Instruction.Opcode))
+               min++;
+         }
+         if (op_has_dst(inst_j->Instruction.Opcode) &&
+             (reads_reg(inst_i, inst_j->Dst[0].Register.File,
+                        inst_j->Dst[0].Register.Index) ||
+              writes_reg(inst_i, inst_j->Dst[0].Register.File,
+                         inst_j->Dst[0].Register.Index))) {
+            /* write after read or write */
+            min = MAX2(min, phase[i]);
+         }
+
+         if (min < 0)
+            continue;
+         if (min == phase[i] && class[j] < class[i])
+            min++;
+         phase[j] = MAX2(phase[j], min);
+      }
+   }
+
+   /* Stable insertion sort of the instructions by phase and class */
+   for (j = 1; j < num; j++) {
+      int o = order[j], p = phase[j], c = class[j];
+
+      for (i = j; i > 0 && (phase[i - 1] > p ||
+                            (phase[i - 1] == p && class[i - 1] > c)); i--) {
+         order[i] = order[i - 1];
+         phase[i] = phase[i - 1];
+         class[i] = class[i - 1];
+      }
+      order[i] = o;
+      phase[i] = p;
+      class[i] = c;
+   }
+
+   memcpy(sorted.Tokens, tokens->Tokens,
+          tokens->NumTokens * sizeof(union i915_full_token));
+   for(i = 0, k = 0; i < tokens->NumTokens; i++)
+   {
+      if (tokens->Tokens[i].Token.Type == TGSI_TOKEN_TYPE_INSTRUCTION &&
+          tokens->Tokens[i].FullInstruction.Instruction.Opcode != TGSI_OPCODE_NOP &&
+          tokens->Tokens[i].FullInstruction.Instruction.Opcode != TGSI_OPCODE_END)
+         sorted.Tokens[i] = tokens->Tokens[order[k++]];
+   }
+
+   if (count_tex_phases(&sorted) < count_tex_phases(tokens))
+      memcpy(tokens->Tokens, sorted.Tokens,
+             tokens->NumTokens * sizeof(union i915_full_token));
+
+out:
+   FREE(order);
+   FREE(phase);
+   FREE(class);
+   FREE(sorted.Tokens);
+}
+
 struct i915_token_list* i915_optimize(const struct tgsi_token *tokens)
 {
    struct i915_token_list *out_tokens = MALLOC(sizeof(struct i915_token_list));
    struct tgsi_parse_context parse;
    struct i915_optimize_context *ctx;
+   boolean progress;
    int i = 0;
 
    ctx = malloc(sizeof(*ctx));
@@ -646,6 +1426,20 @@ struct i915_token_list* i915_optimize(const struct tgsi_token *tokens)
       i++;
    }
 
+   if (is_straight_line(out_tokens)) {
+      do {
+         progress = FALSE;
+         for (i = 0; i < out_tokens->NumTokens; i++) {
+            progress |= i915_fpc_optimize_copy_propagation(out_tokens, i);
+            progress |= i915_fpc_optimize_mad(out_tokens, i);
+            progress |= i915_fpc_optimize_dst_propagation(out_tokens, i);
+         }
+      } while (progress);
+
+      i915_fpc_optimize_dead_code(out_tokens);
+      i915_fpc_optimize_tex_phases(out_tokens);
+   }
+
    free(ctx);
 
    return out_tokens;
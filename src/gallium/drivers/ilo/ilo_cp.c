@@ -147,6 +147,55 @@ ilo_cp_upload_buffer(struct ilo_cp *cp)
    return err;
 }
 
+/**
+ * Take an idle bo out of the pool of executed batch bos.
+ */
+static struct intel_bo *
+ilo_cp_get_pooled_bo(struct ilo_cp *cp)
+{
+   int i;
+
+   for (i = 0; i < Elements(cp->bo_pool); i++) {
+      struct intel_bo *bo = cp->bo_pool[i];
+
+      if (bo && !intel_bo_is_busy(bo)) {
+         cp->bo_pool[i] = NULL;
+         /* drop the relocs of the last execution */
+         intel_bo_clear_relocs(bo, 0);
+
+         return bo;
+      }
+   }
+
+   return NULL;
+}
+
+/**
+ * Put an executed batch bo into the pool.  The reference is transferred.
+ */
+static void
+ilo_cp_pool_bo(struct ilo_cp *cp, struct intel_bo *bo)
+{
+   int i, slot = -1;
+
+   for (i = 0; i < Elements(cp->bo_pool); i++) {
+      if (!cp->bo_pool[i]) {
+         slot = i;
+         break;
+      }
+   }
+
+   /* replace the entries in a round-robin fashion when the pool is full */
+   if (slot < 0) {
+      slot = cp->bo_pool_next;
+      cp->bo_pool_next = (slot + 1) % Elements(cp->bo_pool);
+
+      intel_bo_unreference(cp->bo_pool[slot]);
+   }
+
+   cp->bo_pool[slot] = bo;
+}
+
 /**
  * Reallocate the parser bo.
  */
@@ -159,16 +208,23 @@ ilo_cp_realloc_bo(struct ilo_cp *cp)
     * allocate the new bo before unreferencing the old one so that they
     * won't point at the same address, which is needed for jmpbuf
     */
-   bo = intel_winsys_alloc_buffer(cp->winsys,
-         "batch buffer", cp->bo_size * 4, 0);
+   bo = ilo_cp_get_pooled_bo(cp);
+   if (!bo) {
+      bo = intel_winsys_alloc_buffer(cp->winsys,
+            "batch buffer", cp->bo_size * 4, 0);
+   }
    if (unlikely(!bo)) {
       /* reuse the old one */
       bo = cp->bo;
       intel_bo_reference(bo);
    }
 
-   if (cp->bo)
-      intel_bo_unreference(cp->bo);
+   if (cp->bo) {
+      if (cp->bo != bo)
+         ilo_cp_pool_bo(cp, cp->bo);
+      else
+         intel_bo_unreference(cp->bo);
+   }
    cp->bo = bo;
 
    if (!cp->sys) {
@@ -256,6 +312,13 @@ ilo_cp_flush_internal(struct ilo_cp *cp)
 void
 ilo_cp_destroy(struct ilo_cp *cp)
 {
+   int i;
+
+   for (i = 0; i < Elements(cp->bo_pool); i++) {
+      if (cp->bo_pool[i])
+         intel_bo_unreference(cp->bo_pool[i]);
+   }
+
    if (cp->bo) {
       if (!cp->sys)
          intel_bo_unmap(cp->bo);
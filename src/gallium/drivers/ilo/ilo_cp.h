@@ -69,6 +69,10 @@ struct ilo_cp {
    struct intel_bo *bo;
    uint32_t *sys;
 
+   /* executed batch bos kept for reuse */
+   struct intel_bo *bo_pool[4];
+   int bo_pool_next;
+
    uint32_t *ptr;
    int size, used, stolen;
 
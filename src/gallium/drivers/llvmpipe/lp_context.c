@@ -44,6 +44,7 @@
 #include "lp_state.h"
 #include "lp_surface.h"
 #include "lp_query.h"
+#include "lp_screen.h"
 #include "lp_setup.h"
 
 
@@ -85,6 +86,14 @@ static void llvmpipe_destroy( struct pipe_context *pipe )
       pipe_sampler_view_reference(&llvmpipe->sampler_views[PIPE_SHADER_GEOMETRY][i], NULL);
    }
 
+   for (i = 0; i < Elements(llvmpipe->cs_resources); i++) {
+      pipe_surface_reference(&llvmpipe->cs_resources[i], NULL);
+   }
+
+   for (i = 0; i < Elements(llvmpipe->cs_globals); i++) {
+      pipe_resource_reference(&llvmpipe->cs_globals[i], NULL);
+   }
+
    for (i = 0; i < Elements(llvmpipe->constants); i++) {
       for (j = 0; j < Elements(llvmpipe->constants[i]); j++) {
          pipe_resource_reference(&llvmpipe->constants[i][j].buffer, NULL);
@@ -161,6 +170,7 @@ llvmpipe_create_context( struct pipe_screen *screen, void *priv )
    llvmpipe_init_fs_funcs(llvmpipe);
    llvmpipe_init_vs_funcs(llvmpipe);
    llvmpipe_init_gs_funcs(llvmpipe);
+   llvmpipe_init_compute_funcs(llvmpipe);
    llvmpipe_init_rasterizer_funcs(llvmpipe);
    llvmpipe_init_context_resource_funcs( &llvmpipe->pipe );
    llvmpipe_init_surface_functions(llvmpipe);
@@ -172,6 +182,9 @@ llvmpipe_create_context( struct pipe_screen *screen, void *priv )
    if (!llvmpipe->draw)
       goto fail;
 
+   draw_set_disk_cache(llvmpipe->draw,
+                       llvmpipe_screen(screen)->disk_cache);
+
    /* FIXME: devise alternative to draw_texture_samplers */
 
    llvmpipe->setup = lp_setup_create( &llvmpipe->pipe,
@@ -28,6 +28,7 @@
 
 #include "pipe/p_screen.h"
 #include "util/u_memory.h"
+#include "util/u_trace_events.h"
 #include "lp_debug.h"
 #include "lp_fence.h"
 
@@ -116,12 +117,16 @@ lp_fence_wait(struct lp_fence *f)
    if (LP_DEBUG & DEBUG_FENCE)
       debug_printf("%s %d\n", __FUNCTION__, f->id);
 
+   util_trace_event_begin("lp_fence_wait");
+
    pipe_mutex_lock(f->mutex);
    assert(f->issued);
    while (f->count < f->rank) {
       pipe_condvar_wait(f->signalled, f->mutex);
    }
    pipe_mutex_unlock(f->mutex);
+
+   util_trace_event_end("lp_fence_wait");
 }
 
 
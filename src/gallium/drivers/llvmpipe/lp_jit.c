@@ -38,6 +38,7 @@
 #include "gallivm/lp_bld_debug.h"
 #include "lp_context.h"
 #include "lp_jit.h"
+#include "lp_state_cs.h"
 
 
 static void
@@ -252,6 +253,112 @@ lp_jit_create_types(struct lp_fragment_shader_variant *lp)
 }
 
 
+static void
+lp_jit_create_cs_types(struct lp_compute_shader_variant *lp)
+{
+   struct gallivm_state *gallivm = lp->gallivm;
+   LLVMContextRef lc = gallivm->context;
+   LLVMTypeRef resource_type;
+
+   /* struct lp_jit_cs_resource */
+   {
+      LLVMTypeRef elem_types[LP_JIT_CS_RESOURCE_NUM_FIELDS];
+
+      elem_types[LP_JIT_CS_RESOURCE_BASE] =
+         LLVMPointerType(LLVMInt8TypeInContext(lc), 0);
+      elem_types[LP_JIT_CS_RESOURCE_STRIDE] =
+      elem_types[LP_JIT_CS_RESOURCE_SIZE] = LLVMInt32TypeInContext(lc);
+
+      resource_type = LLVMStructTypeInContext(lc, elem_types,
+                                              Elements(elem_types), 0);
+#if HAVE_LLVM < 0x0300
+      LLVMAddTypeName(gallivm->module, "cs_resource", resource_type);
+
+      LLVMInvalidateStructLayout(gallivm->target, resource_type);
+#endif
+
+      LP_CHECK_MEMBER_OFFSET(struct lp_jit_cs_resource, base,
+                             gallivm->target, resource_type,
+                             LP_JIT_CS_RESOURCE_BASE);
+      LP_CHECK_MEMBER_OFFSET(struct lp_jit_cs_resource, stride,
+                             gallivm->target, resource_type,
+                             LP_JIT_CS_RESOURCE_STRIDE);
+      LP_CHECK_MEMBER_OFFSET(struct lp_jit_cs_resource, size,
+                             gallivm->target, resource_type,
+                             LP_JIT_CS_RESOURCE_SIZE);
+      LP_CHECK_STRUCT_SIZE(struct lp_jit_cs_resource,
+                           gallivm->target, resource_type);
+   }
+
+   /* struct lp_jit_cs_context */
+   {
+      LLVMTypeRef elem_types[LP_JIT_CS_CTX_COUNT];
+      LLVMTypeRef context_type;
+
+      elem_types[LP_JIT_CS_CTX_CONSTANTS] =
+         LLVMArrayType(LLVMPointerType(LLVMFloatTypeInContext(lc), 0), LP_MAX_TGSI_CONST_BUFFERS);
+      elem_types[LP_JIT_CS_CTX_NUM_CONSTANTS] =
+            LLVMArrayType(LLVMInt32TypeInContext(lc), LP_MAX_TGSI_CONST_BUFFERS);
+      elem_types[LP_JIT_CS_CTX_RESOURCES] =
+         LLVMArrayType(resource_type, PIPE_MAX_SHADER_RESOURCES);
+      elem_types[LP_JIT_CS_CTX_GLOBALS] =
+         LLVMArrayType(resource_type, LP_MAX_CS_GLOBAL_BUFFERS);
+      elem_types[LP_JIT_CS_CTX_INPUT] =
+         LLVMPointerType(LLVMInt8TypeInContext(lc), 0);
+      elem_types[LP_JIT_CS_CTX_INPUT_SIZE] =
+      elem_types[LP_JIT_CS_CTX_LOCAL_SIZE] = LLVMInt32TypeInContext(lc);
+      elem_types[LP_JIT_CS_CTX_GRID_SIZE] =
+      elem_types[LP_JIT_CS_CTX_BLOCK_SIZE] =
+         LLVMArrayType(LLVMInt32TypeInContext(lc), 3);
+
+      context_type = LLVMStructTypeInContext(lc, elem_types,
+                                             Elements(elem_types), 0);
+
+#if HAVE_LLVM < 0x0300
+      LLVMInvalidateStructLayout(gallivm->target, context_type);
+
+      LLVMAddTypeName(gallivm->module, "cs_context", context_type);
+#endif
+
+      LP_CHECK_MEMBER_OFFSET(struct lp_jit_cs_context, constants,
+                             gallivm->target, context_type,
+                             LP_JIT_CS_CTX_CONSTANTS);
+      LP_CHECK_MEMBER_OFFSET(struct lp_jit_cs_context, num_constants,
+                             gallivm->target, context_type,
+                             LP_JIT_CS_CTX_NUM_CONSTANTS);
+      LP_CHECK_MEMBER_OFFSET(struct lp_jit_cs_context, resources,
+                             gallivm->target, context_type,
+                             LP_JIT_CS_CTX_RESOURCES);
+      LP_CHECK_MEMBER_OFFSET(struct lp_jit_cs_context, globals,
+                             gallivm->target, context_type,
+                             LP_JIT_CS_CTX_GLOBALS);
+      LP_CHECK_MEMBER_OFFSET(struct lp_jit_cs_context, input,
+                             gallivm->target, context_type,
+                             LP_JIT_CS_CTX_INPUT);
+      LP_CHECK_MEMBER_OFFSET(struct lp_jit_cs_context, input_size,
+                             gallivm->target, context_type,
+                             LP_JIT_CS_CTX_INPUT_SIZE);
+      LP_CHECK_MEMBER_OFFSET(struct lp_jit_cs_context, local_size,
+                             gallivm->target, context_type,
+                             LP_JIT_CS_CTX_LOCAL_SIZE);
+      LP_CHECK_MEMBER_OFFSET(struct lp_jit_cs_context, grid_size,
+                             gallivm->target, context_type,
+                             LP_JIT_CS_CTX_GRID_SIZE);
+      LP_CHECK_MEMBER_OFFSET(struct lp_jit_cs_context, block_size,
+                             gallivm->target, context_type,
+                             LP_JIT_CS_CTX_BLOCK_SIZE);
+      LP_CHECK_STRUCT_SIZE(struct lp_jit_cs_context,
+                           gallivm->target, context_type);
+
+      lp->jit_context_ptr_type = LLVMPointerType(context_type, 0);
+   }
+
+   if (gallivm_debug & GALLIVM_DEBUG_IR) {
+      LLVMDumpModule(gallivm->module);
+   }
+}
+
+
 void
 lp_jit_screen_cleanup(struct llvmpipe_screen *screen)
 {
@@ -272,3 +379,11 @@ lp_jit_init_types(struct lp_fragment_shader_variant *lp)
    if (!lp->jit_context_ptr_type)
       lp_jit_create_types(lp);
 }
+
+
+void
+lp_jit_init_cs_types(struct lp_compute_shader_variant *lp)
+{
+   if (!lp->jit_context_ptr_type)
+      lp_jit_create_cs_types(lp);
+}
@@ -44,6 +44,7 @@
 
 
 struct lp_fragment_shader_variant;
+struct lp_compute_shader_variant;
 struct llvmpipe_screen;
 
 
@@ -248,6 +249,121 @@ typedef void
                     unsigned depth_stride);
 
 
+/**
+ * A compute resource, RES[] in the TGSI code.
+ *
+ * Nothing at or beyond size bytes from base is ever accessed.
+ */
+struct lp_jit_cs_resource
+{
+   uint8_t *base;
+   uint32_t stride;       /* row stride in bytes, for 2D resources */
+   uint32_t size;
+};
+
+
+enum {
+   LP_JIT_CS_RESOURCE_BASE = 0,
+   LP_JIT_CS_RESOURCE_STRIDE,
+   LP_JIT_CS_RESOURCE_SIZE,
+   LP_JIT_CS_RESOURCE_NUM_FIELDS  /* number of fields above */
+};
+
+
+/**
+ * This structure is passed directly to the generated compute shader.
+ *
+ * Changes here must be reflected in the lp_jit_cs_context_* macros and
+ * lp_jit_init_cs_types function.
+ */
+struct lp_jit_cs_context
+{
+   const float *constants[LP_MAX_TGSI_CONST_BUFFERS];
+   int num_constants[LP_MAX_TGSI_CONST_BUFFERS];
+
+   struct lp_jit_cs_resource resources[PIPE_MAX_SHADER_RESOURCES];
+
+   /** The buffers of the GLOBAL resource */
+   struct lp_jit_cs_resource globals[LP_MAX_CS_GLOBAL_BUFFERS];
+
+   /** The INPUT resource, and the sizes of it and of LOCAL */
+   const uint8_t *input;
+   uint32_t input_size;
+   uint32_t local_size;
+
+   uint32_t grid_size[3];
+   uint32_t block_size[3];
+};
+
+
+/**
+ * These enum values must match the position of the fields in the
+ * lp_jit_cs_context struct above.
+ */
+enum {
+   LP_JIT_CS_CTX_CONSTANTS = 0,
+   LP_JIT_CS_CTX_NUM_CONSTANTS,
+   LP_JIT_CS_CTX_RESOURCES,
+   LP_JIT_CS_CTX_GLOBALS,
+   LP_JIT_CS_CTX_INPUT,
+   LP_JIT_CS_CTX_INPUT_SIZE,
+   LP_JIT_CS_CTX_LOCAL_SIZE,
+   LP_JIT_CS_CTX_GRID_SIZE,
+   LP_JIT_CS_CTX_BLOCK_SIZE,
+   LP_JIT_CS_CTX_COUNT
+};
+
+
+#define lp_jit_cs_context_constants(_gallivm, _ptr) \
+   lp_build_struct_get_ptr(_gallivm, _ptr, LP_JIT_CS_CTX_CONSTANTS, "constants")
+
+#define lp_jit_cs_context_num_constants(_gallivm, _ptr) \
+   lp_build_struct_get_ptr(_gallivm, _ptr, LP_JIT_CS_CTX_NUM_CONSTANTS, "num_constants")
+
+#define lp_jit_cs_context_resources(_gallivm, _ptr) \
+   lp_build_struct_get_ptr(_gallivm, _ptr, LP_JIT_CS_CTX_RESOURCES, "resources")
+
+#define lp_jit_cs_context_globals(_gallivm, _ptr) \
+   lp_build_struct_get_ptr(_gallivm, _ptr, LP_JIT_CS_CTX_GLOBALS, "globals")
+
+#define lp_jit_cs_context_input(_gallivm, _ptr) \
+   lp_build_struct_get(_gallivm, _ptr, LP_JIT_CS_CTX_INPUT, "input")
+
+#define lp_jit_cs_context_input_size(_gallivm, _ptr) \
+   lp_build_struct_get(_gallivm, _ptr, LP_JIT_CS_CTX_INPUT_SIZE, "input_size")
+
+#define lp_jit_cs_context_local_size(_gallivm, _ptr) \
+   lp_build_struct_get(_gallivm, _ptr, LP_JIT_CS_CTX_LOCAL_SIZE, "local_size")
+
+#define lp_jit_cs_context_grid_size(_gallivm, _ptr) \
+   lp_build_struct_get_ptr(_gallivm, _ptr, LP_JIT_CS_CTX_GRID_SIZE, "grid_size")
+
+#define lp_jit_cs_context_block_size(_gallivm, _ptr) \
+   lp_build_struct_get_ptr(_gallivm, _ptr, LP_JIT_CS_CTX_BLOCK_SIZE, "block_size")
+
+
+/**
+ * typedef for compute shader function
+ *
+ * Runs all the threads of one block.
+ *
+ * @param context       jit context
+ * @param block_x       block id x
+ * @param block_y       block id y
+ * @param block_z       block id z
+ * @param local         LOCAL resource memory of the block
+ * @param temps         scratch memory for the temporaries of each vector
+ *                      of threads, if the shader has barriers
+ */
+typedef void
+(*lp_jit_cs_func)(const struct lp_jit_cs_context *context,
+                  uint32_t block_x,
+                  uint32_t block_y,
+                  uint32_t block_z,
+                  uint8_t *local,
+                  void *temps);
+
+
 void
 lp_jit_screen_cleanup(struct llvmpipe_screen *screen);
 
@@ -260,4 +376,8 @@ void
 lp_jit_init_types(struct lp_fragment_shader_variant *lp);
 
 
+void
+lp_jit_init_cs_types(struct lp_compute_shader_variant *lp);
+
+
 #endif /* LP_JIT_H */
@@ -35,6 +35,10 @@
 
 /**
  * Tile size (width and height). This needs to be a power of two.
+ *
+ * Note that the triangle rasterizer splits tiles into a 4x4 grid of 16x16
+ * blocks (see lp_rast_tri_tmp.h and the 32_3_16 functions), so changing
+ * it takes more than changing this value.
  */
 #define TILE_ORDER 6
 #define TILE_SIZE (1 << TILE_ORDER)
@@ -61,7 +65,14 @@
 #define LP_MAX_WIDTH  (1 << (LP_MAX_TEXTURE_LEVELS - 1))
 
 
-#define LP_MAX_THREADS 16
+/**
+ * Max number of rasterizer threads.  The number actually used is
+ * determined at runtime (see LP_NUM_THREADS); this only sizes the
+ * per-thread arrays and may be overridden at build time.
+ */
+#ifndef LP_MAX_THREADS
+#define LP_MAX_THREADS 64
+#endif
 
 
 /**
@@ -91,4 +102,21 @@
  */
 #define LP_MAX_SETUP_VARIANTS 64
 
+
+/**
+ * Max number of threads in a compute block, and max size of the LOCAL
+ * and INPUT compute resources, in bytes.
+ */
+#define LP_MAX_CS_THREADS_PER_BLOCK 1024
+#define LP_MAX_CS_LOCAL_SIZE (32 * 1024)
+#define LP_MAX_CS_INPUT_SIZE 4096
+
+/**
+ * Max number of buffers bound to the GLOBAL compute memory space, and max
+ * size of each of them: GLOBAL addresses are the buffer number above the
+ * LP_BLD_GLOBAL_OFFSET_BITS (24) bits of offset within the buffer.
+ */
+#define LP_MAX_CS_GLOBAL_BUFFERS 32
+#define LP_MAX_CS_GLOBAL_BUFFER_SIZE (1 << 24)
+
 #endif /* LP_LIMITS_H */
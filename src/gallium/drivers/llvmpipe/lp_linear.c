@@ -0,0 +1,451 @@
+/**************************************************************************
+ *
+ * Copyright 2014 The Mesa Authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/*
+ * Linear fast path for fragment shaders which merely copy or composite a
+ * texture onto the color buffer, as desktop compositors do.
+ *
+ * Variants are analysed when created.  When setup then finds that the
+ * texture coordinates of a triangle map texels one to one onto pixels,
+ * and that no texel outside the texture is addressed, fully covered tiles
+ * and blocks are shaded here by walking the rows of the texture and of
+ * the color buffer, instead of running the SoA shader on each 4x4 block
+ * with its per-pixel interpolation and sampling.
+ */
+
+#include "pipe/p_shader_tokens.h"
+#include "util/u_debug.h"
+#include "util/u_format.h"
+#include "util/u_math.h"
+#include "util/u_rect.h"
+#include "tgsi/tgsi_parse.h"
+#include "lp_bld_interp.h"
+#include "lp_jit.h"
+#include "lp_linear.h"
+#include "lp_rast_priv.h"
+#include "lp_state_fs.h"
+
+
+DEBUG_GET_ONCE_BOOL_OPTION(no_linear, "LP_NO_LINEAR", FALSE)
+
+
+static boolean
+is_bgra8_unorm(enum pipe_format format)
+{
+   return format == PIPE_FORMAT_B8G8R8A8_UNORM ||
+          format == PIPE_FORMAT_B8G8R8X8_UNORM;
+}
+
+
+static boolean
+is_plain_src(const struct tgsi_full_src_register *src, unsigned file)
+{
+   return src->Register.File == file &&
+          !src->Register.Indirect &&
+          !src->Register.Dimension &&
+          !src->Register.Absolute &&
+          !src->Register.Negate;
+}
+
+
+/**
+ * Match "TEX dst, IN[n], SAMP[0], 2D" optionally followed by
+ * "MOV OUT[color], dst", and return the input index.
+ */
+static boolean
+match_texture_copy(const struct lp_fragment_shader *shader,
+                   unsigned *input)
+{
+   const struct tgsi_shader_info *info = &shader->info.base;
+   struct tgsi_parse_context parse;
+   unsigned step = 0;
+   unsigned temp = 0;
+   int output = -1;
+   boolean ok = TRUE;
+
+   if (info->num_outputs != 1 ||
+       info->output_semantic_name[0] != TGSI_SEMANTIC_COLOR ||
+       info->output_semantic_index[0] != 0 ||
+       info->num_instructions > 3) {
+      return FALSE;
+   }
+
+   tgsi_parse_init(&parse, shader->base.tokens);
+
+   while (ok && !tgsi_parse_end_of_tokens(&parse)) {
+      const struct tgsi_full_instruction *inst;
+
+      tgsi_parse_token(&parse);
+      if (parse.FullToken.Token.Type != TGSI_TOKEN_TYPE_INSTRUCTION)
+         continue;
+
+      inst = &parse.FullToken.FullInstruction;
+
+      if (inst->Instruction.Predicate ||
+          (inst->Instruction.NumDstRegs &&
+           (inst->Dst[0].Register.Indirect ||
+            inst->Dst[0].Register.WriteMask != TGSI_WRITEMASK_XYZW))) {
+         ok = FALSE;
+         break;
+      }
+
+      switch (step) {
+      case 0:
+         ok = inst->Instruction.Opcode == TGSI_OPCODE_TEX &&
+              (inst->Texture.Texture == TGSI_TEXTURE_2D ||
+               inst->Texture.Texture == TGSI_TEXTURE_RECT) &&
+              inst->Texture.NumOffsets == 0 &&
+              is_plain_src(&inst->Src[0], TGSI_FILE_INPUT) &&
+              inst->Src[0].Register.SwizzleX == TGSI_SWIZZLE_X &&
+              inst->Src[0].Register.SwizzleY == TGSI_SWIZZLE_Y &&
+              is_plain_src(&inst->Src[1], TGSI_FILE_SAMPLER) &&
+              inst->Src[1].Register.Index == 0;
+         if (!ok)
+            break;
+         *input = inst->Src[0].Register.Index;
+         if (inst->Dst[0].Register.File == TGSI_FILE_OUTPUT) {
+            output = inst->Dst[0].Register.Index;
+            step = 2;
+         }
+         else if (inst->Dst[0].Register.File == TGSI_FILE_TEMPORARY) {
+            temp = inst->Dst[0].Register.Index;
+            step = 1;
+         }
+         else {
+            ok = FALSE;
+         }
+         break;
+      case 1:
+         ok = inst->Instruction.Opcode == TGSI_OPCODE_MOV &&
+              inst->Dst[0].Register.File == TGSI_FILE_OUTPUT &&
+              is_plain_src(&inst->Src[0], TGSI_FILE_TEMPORARY) &&
+              inst->Src[0].Register.Index == temp &&
+              inst->Src[0].Register.SwizzleX == TGSI_SWIZZLE_X &&
+              inst->Src[0].Register.SwizzleY == TGSI_SWIZZLE_Y &&
+              inst->Src[0].Register.SwizzleZ == TGSI_SWIZZLE_Z &&
+              inst->Src[0].Register.SwizzleW == TGSI_SWIZZLE_W;
+         output = inst->Dst[0].Register.Index;
+         step = 2;
+         break;
+      case 2:
+         ok = inst->Instruction.Opcode == TGSI_OPCODE_END;
+         step = 3;
+         break;
+      default:
+         ok = FALSE;
+         break;
+      }
+   }
+
+   tgsi_parse_free(&parse);
+
+   return ok && step == 3 && output == 0;
+}
+
+
+/**
+ * Determine whether the variant's shader and state can be run by the
+ * linear path, and how.
+ */
+void
+lp_linear_check_variant(const struct lp_fragment_shader *shader,
+                        struct lp_fragment_shader_variant *variant)
+{
+   const struct lp_fragment_shader_variant_key *key = &variant->key;
+   const struct pipe_rt_blend_state *rt = &key->blend.rt[0];
+   const struct lp_static_texture_state *texture = &key->state[0].texture_state;
+   const struct lp_static_sampler_state *sampler = &key->state[0].sampler_state;
+   unsigned input;
+
+   variant->linear_op = LP_LINEAR_NONE;
+
+   if (debug_get_option_no_linear())
+      return;
+
+#ifdef PIPE_ARCH_LITTLE_ENDIAN
+   if (key->depth.enabled ||
+       key->stencil[0].enabled ||
+       key->alpha.enabled ||
+       key->occlusion_count ||
+       key->blend.logicop_enable ||
+       key->blend.alpha_to_coverage ||
+       key->nr_cbufs != 1 ||
+       key->nr_samplers != 1 ||
+       !is_bgra8_unorm(key->cbuf_format[0]) ||
+       !util_format_colormask_full(util_format_description(key->cbuf_format[0]),
+                                   rt->colormask)) {
+      return;
+   }
+
+   if (!is_bgra8_unorm(texture->format) ||
+       texture->swizzle_r != PIPE_SWIZZLE_RED ||
+       texture->swizzle_g != PIPE_SWIZZLE_GREEN ||
+       texture->swizzle_b != PIPE_SWIZZLE_BLUE ||
+       texture->swizzle_a != PIPE_SWIZZLE_ALPHA ||
+       (texture->target != PIPE_TEXTURE_2D &&
+        texture->target != PIPE_TEXTURE_RECT) ||
+       sampler->min_img_filter != PIPE_TEX_FILTER_NEAREST ||
+       sampler->mag_img_filter != PIPE_TEX_FILTER_NEAREST ||
+       sampler->min_mip_filter != PIPE_TEX_MIPFILTER_NONE ||
+       sampler->compare_mode != PIPE_TEX_COMPARE_NONE) {
+      return;
+   }
+
+   if (!match_texture_copy(shader, &input) ||
+       (shader->inputs[input].interp != LP_INTERP_LINEAR &&
+        shader->inputs[input].interp != LP_INTERP_PERSPECTIVE)) {
+      return;
+   }
+
+   if (!rt->blend_enable) {
+      variant->linear_op = LP_LINEAR_COPY;
+   }
+   else if (rt->rgb_func == PIPE_BLEND_ADD &&
+            rt->alpha_func == PIPE_BLEND_ADD &&
+            rt->rgb_src_factor == PIPE_BLENDFACTOR_ONE &&
+            rt->alpha_src_factor == PIPE_BLENDFACTOR_ONE &&
+            rt->rgb_dst_factor == PIPE_BLENDFACTOR_INV_SRC_ALPHA &&
+            rt->alpha_dst_factor == PIPE_BLENDFACTOR_INV_SRC_ALPHA) {
+      /* An opaque source simply replaces the destination */
+      variant->linear_op = texture->format == PIPE_FORMAT_B8G8R8X8_UNORM ?
+                           LP_LINEAR_COPY : LP_LINEAR_OVER;
+   }
+   else {
+      return;
+   }
+
+   variant->linear_input = input;
+   variant->linear_normalized = sampler->normalized_coords;
+   variant->linear_alpha_one = texture->format == PIPE_FORMAT_B8G8R8X8_UNORM;
+#endif
+}
+
+
+/**
+ * Texel coordinate mapping of a triangle, relative to the pixel position.
+ */
+struct texel_map {
+   float s, t;        /* texel coords at pixel 0,0 */
+   float dtdy;        /* +1 or -1 */
+   const uint8_t *data;
+   int stride;
+   int width, height;
+};
+
+
+static void
+get_texel_map(const struct lp_fragment_shader_variant *variant,
+              const struct lp_jit_texture *texture,
+              const struct lp_rast_shader_inputs *inputs,
+              struct texel_map *map,
+              float *dsdx, float *dsdy, float *dtdx)
+{
+   const unsigned attrib = 1 + variant->linear_input;
+   const unsigned level = texture->first_level;
+   const float (*a0)[4] = (const float (*)[4])GET_A0(inputs);
+   const float (*dadx)[4] = (const float (*)[4])GET_DADX(inputs);
+   const float (*dady)[4] = (const float (*)[4])GET_DADY(inputs);
+   float scale_s = 1.0f, scale_t = 1.0f;
+
+   map->width = u_minify(texture->width, level);
+   map->height = u_minify(texture->height, level);
+   if (variant->linear_normalized) {
+      scale_s = (float)map->width;
+      scale_t = (float)map->height;
+   }
+
+   map->s = a0[attrib][0] * scale_s;
+   map->t = a0[attrib][1] * scale_t;
+   map->dtdy = dady[attrib][1] * scale_t;
+   map->data = (const uint8_t *)texture->base + texture->mip_offsets[level];
+   map->stride = texture->row_stride[level];
+
+   *dsdx = dadx[attrib][0] * scale_s;
+   *dsdy = dady[attrib][0] * scale_s;
+   *dtdx = dadx[attrib][1] * scale_t;
+}
+
+
+/**
+ * Whether a texel coordinate lies close enough to a texel center that all
+ * ways of rounding it agree.
+ */
+static INLINE boolean
+near_texel_center(float coord, float max_error)
+{
+   float frac = coord - floorf(coord);
+   return fabsf(frac - 0.5f) + max_error < 0.25f;
+}
+
+
+/**
+ * Called by setup: whether the pixels of the triangle within box can be
+ * shaded with lp_linear_shade_rect().
+ */
+boolean
+lp_linear_check_inputs(const struct lp_fragment_shader_variant *variant,
+                       const struct lp_jit_texture *texture,
+                       const struct lp_rast_shader_inputs *inputs,
+                       const struct u_rect *box)
+{
+   struct texel_map map;
+   float dsdx, dsdy, dtdx;
+   float error;
+   float s0, s1, t0, t1;
+
+   if (variant->linear_op == LP_LINEAR_NONE || !texture->base)
+      return FALSE;
+
+   /* Perspective correct inputs get divided by the interpolated 1/w */
+   if (variant->shader->inputs[variant->linear_input].interp == LP_INTERP_PERSPECTIVE) {
+      if (GET_A0(inputs)[0][3] != 1.0f ||
+          GET_DADX(inputs)[0][3] != 0.0f ||
+          GET_DADY(inputs)[0][3] != 0.0f)
+         return FALSE;
+   }
+
+   get_texel_map(variant, texture, inputs, &map, &dsdx, &dsdy, &dtdx);
+
+   /* Texels must map one to one onto pixels, possibly flipped vertically */
+   if (fabsf(dsdx - 1.0f) > 1.0f / 4096 ||
+       fabsf(fabsf(map.dtdy) - 1.0f) > 1.0f / 4096 ||
+       fabsf(dsdy) > 1.0f / 4096 ||
+       fabsf(dtdx) > 1.0f / 4096) {
+      return FALSE;
+   }
+
+   /*
+    * The drift from the ideal mapping over the box, plus some slack for the
+    * rounding of the plane evaluation itself.
+    */
+   error = (fabsf(dsdx - 1.0f) + fabsf(dsdy) +
+            fabsf(dtdx) + fabsf(fabsf(map.dtdy) - 1.0f)) *
+           (float)(MAX2(box->x1, box->y1) + 1) +
+           (fabsf(map.s) + fabsf(map.t)) * (1.0f / (1 << 20));
+
+   s0 = map.s + dsdx * box->x0 + dsdy * box->y0;
+   t0 = map.t + dtdx * box->x0 + map.dtdy * box->y0;
+   s1 = map.s + dsdx * box->x1 + dsdy * box->y1;
+   t1 = map.t + dtdx * box->x1 + map.dtdy * box->y1;
+
+   if (!near_texel_center(s0, error) ||
+       !near_texel_center(t0, error)) {
+      return FALSE;
+   }
+
+   /* No wrapping nor clamping must be involved */
+   return MIN2(s0, s1) >= 0.0f && MAX2(s0, s1) < (float)map.width &&
+          MIN2(t0, t1) >= 0.0f && MAX2(t0, t1) < (float)map.height;
+}
+
+
+/**
+ * dst = src + dst * (1 - src.a), on four packed unorm8 channels.
+ */
+static INLINE uint32_t
+over_pixel(uint32_t src, uint32_t dst)
+{
+   const uint32_t ia = 255 - (src >> 24);
+   uint32_t rb = (dst & 0x00ff00ff) * ia + 0x00800080;
+   uint32_t ag = ((dst >> 8) & 0x00ff00ff) * ia + 0x00800080;
+
+   /* divide by 255, rounding */
+   rb = ((rb + ((rb >> 8) & 0x00ff00ff)) >> 8) & 0x00ff00ff;
+   ag = ((ag + ((ag >> 8) & 0x00ff00ff)) >> 8) & 0x00ff00ff;
+
+   /* saturated add */
+   rb += src & 0x00ff00ff;
+   ag += (src >> 8) & 0x00ff00ff;
+   rb |= 0x01000100 - ((rb >> 8) & 0x00010001);
+   ag |= 0x01000100 - ((ag >> 8) & 0x00010001);
+
+   return (rb & 0x00ff00ff) | ((ag & 0x00ff00ff) << 8);
+}
+
+
+/**
+ * Shade a width x height rectangle at x,y (in window coords), fully
+ * covered by a triangle accepted by lp_linear_check_inputs().
+ */
+void
+lp_linear_shade_rect(struct lp_rasterizer_task *task,
+                     const struct lp_rast_shader_inputs *inputs,
+                     int x, int y, int width, int height)
+{
+   const struct lp_rast_state *state = task->state;
+   const struct lp_fragment_shader_variant *variant = state->variant;
+   const unsigned dst_stride = task->scene->cbufs[0].stride;
+   struct texel_map map;
+   float dsdx, dsdy, dtdx;
+   const uint8_t *src;
+   uint8_t *dst;
+   int src_stride;
+   int i, j;
+
+   get_texel_map(variant, &state->jit_context.textures[0], inputs,
+                 &map, &dsdx, &dsdy, &dtdx);
+
+   src = map.data +
+         util_ifloor(map.t + dtdx * x + map.dtdy * y) * map.stride +
+         util_ifloor(map.s + dsdx * x + dsdy * y) * 4;
+   src_stride = map.dtdy > 0.0f ? map.stride : -map.stride;
+
+   dst = lp_rast_get_unswizzled_color_block_pointer(task, 0, x, y,
+                                                    inputs->layer);
+
+   for (j = 0; j < height; j++) {
+      const uint32_t *s = (const uint32_t *)src;
+      uint32_t *d = (uint32_t *)dst;
+
+      switch (variant->linear_op) {
+      case LP_LINEAR_COPY:
+         if (variant->linear_alpha_one) {
+            for (i = 0; i < width; i++)
+               d[i] = s[i] | 0xff000000;
+         }
+         else {
+            memcpy(d, s, width * 4);
+         }
+         break;
+      case LP_LINEAR_OVER:
+         for (i = 0; i < width; i++) {
+            const uint32_t texel = s[i];
+            if ((texel >> 24) == 0xff)
+               d[i] = texel;
+            else if (texel)
+               d[i] = over_pixel(texel, d[i]);
+         }
+         break;
+      default:
+         assert(0);
+         break;
+      }
+
+      src += src_stride;
+      dst += dst_stride;
+   }
+}
@@ -0,0 +1,67 @@
+/**************************************************************************
+ *
+ * Copyright 2014 The Mesa Authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+#ifndef LP_LINEAR_H
+#define LP_LINEAR_H
+
+#include "pipe/p_compiler.h"
+
+
+struct u_rect;
+struct lp_fragment_shader;
+struct lp_fragment_shader_variant;
+struct lp_jit_texture;
+struct lp_rast_shader_inputs;
+struct lp_rasterizer_task;
+
+
+/** How the linear path shades, see lp_linear.c */
+enum lp_linear_op
+{
+   LP_LINEAR_NONE = 0,
+   LP_LINEAR_COPY,      /**< dst = texel */
+   LP_LINEAR_OVER       /**< dst = texel + dst * (1 - texel.a) */
+};
+
+
+void
+lp_linear_check_variant(const struct lp_fragment_shader *shader,
+                        struct lp_fragment_shader_variant *variant);
+
+boolean
+lp_linear_check_inputs(const struct lp_fragment_shader_variant *variant,
+                       const struct lp_jit_texture *texture,
+                       const struct lp_rast_shader_inputs *inputs,
+                       const struct u_rect *box);
+
+void
+lp_linear_shade_rect(struct lp_rasterizer_task *task,
+                     const struct lp_rast_shader_inputs *inputs,
+                     int x, int y, int width, int height);
+
+
+#endif /* LP_LINEAR_H */
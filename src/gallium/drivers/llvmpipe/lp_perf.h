@@ -68,6 +68,23 @@ struct lp_counters
 extern struct lp_counters lp_count;
 
 
+/**
+ * Rasterizer counters.  Unlike the above these are always enabled, and kept
+ * per thread and per tile, like the other binned query counters.  They're
+ * exposed as driver specific queries.
+ */
+enum lp_rast_counter
+{
+   LP_RAST_COUNTER_BINS,
+   LP_RAST_COUNTER_TRIANGLES,       /**< triangle commands executed */
+   LP_RAST_COUNTER_BLOCKS_FULL,     /**< fully covered 16x16 blocks */
+   LP_RAST_COUNTER_BLOCKS_PARTIAL,  /**< partially covered 16x16 blocks */
+   LP_RAST_COUNTER_BUSY_TIME,       /**< nanoseconds spent in bins */
+   LP_RAST_COUNTER_IDLE_TIME,       /**< nanoseconds spent between bins */
+   LP_RAST_COUNTER_COUNT
+};
+
+
 /** Increment the named counter (only for debug builds) */
 #ifdef DEBUG
 #define LP_COUNT(counter) lp_count.counter++
@@ -32,8 +32,10 @@
 
 #include "draw/draw_context.h"
 #include "pipe/p_defines.h"
+#include "util/u_math.h"
 #include "util/u_memory.h"
 #include "os/os_time.h"
+#include "translate/translate_cache.h"
 #include "lp_context.h"
 #include "lp_flush.h"
 #include "lp_fence.h"
@@ -48,13 +50,38 @@ static struct llvmpipe_query *llvmpipe_query( struct pipe_query *p )
    return (struct llvmpipe_query *)p;
 }
 
+/**
+ * Current value of a translate cache statistic, summed over all caches.
+ */
+static unsigned
+translate_cache_counter(unsigned type)
+{
+   struct translate_cache_stats stats;
+
+   translate_cache_get_stats(NULL, &stats);
+
+   switch (type) {
+   case LP_QUERY_TRANSLATE_CACHE_HITS:
+      return stats.hits;
+   case LP_QUERY_TRANSLATE_CACHE_MISSES:
+      return stats.misses;
+   case LP_QUERY_TRANSLATE_CACHE_EVICTIONS:
+      return stats.evictions;
+   default:
+      assert(0);
+      return 0;
+   }
+}
+
+
 static struct pipe_query *
 llvmpipe_create_query(struct pipe_context *pipe, 
                       unsigned type)
 {
    struct llvmpipe_query *pq;
 
-   assert(type < PIPE_QUERY_TYPES);
+   assert(type < PIPE_QUERY_TYPES ||
+          (type >= PIPE_QUERY_DRIVER_SPECIFIC && type < LP_QUERY_DRIVER_END));
 
    pq = CALLOC_STRUCT( llvmpipe_query );
 
@@ -174,8 +201,32 @@ llvmpipe_get_query_result(struct pipe_context *pipe,
       *stats = pq->stats;
    }
       break;
+   case LP_QUERY_RAST_COUNTER(LP_RAST_COUNTER_BUSY_TIME):
+   case LP_QUERY_RAST_COUNTER(LP_RAST_COUNTER_IDLE_TIME):
+      /* in microseconds */
+      for (i = 0; i < num_threads; i++) {
+         *result += pq->end[i];
+      }
+      *result /= 1000;
+      break;
+   case LP_QUERY_RAST_IMBALANCE: {
+      uint64_t max = 0, total = 0;
+      for (i = 0; i < num_threads; i++) {
+         max = MAX2(max, pq->end[i]);
+         total += pq->end[i];
+      }
+      *result = total ? max * 100 * num_threads / total : 0;
+   }
+      break;
    default:
-      assert(0);
+      if (pq->type >= PIPE_QUERY_DRIVER_SPECIFIC) {
+         for (i = 0; i < num_threads; i++) {
+            *result += pq->end[i];
+         }
+      }
+      else {
+         assert(0);
+      }
       break;
    }
 
@@ -226,6 +277,11 @@ llvmpipe_begin_query(struct pipe_context *pipe, struct pipe_query *q)
       memcpy(&pq->stats, &llvmpipe->pipeline_statistics, sizeof(pq->stats));
       llvmpipe->active_statistics_queries++;
       break;
+   case LP_QUERY_TRANSLATE_CACHE_HITS:
+   case LP_QUERY_TRANSLATE_CACHE_MISSES:
+   case LP_QUERY_TRANSLATE_CACHE_EVICTIONS:
+      pq->start[0] = translate_cache_counter(pq->type);
+      break;
    case PIPE_QUERY_OCCLUSION_COUNTER:
    case PIPE_QUERY_OCCLUSION_PREDICATE:
       llvmpipe->active_occlusion_queries++;
@@ -293,6 +349,13 @@ llvmpipe_end_query(struct pipe_context *pipe, struct pipe_query *q)
       llvmpipe->active_occlusion_queries--;
       llvmpipe->dirty |= LP_NEW_OCCLUSION_QUERY;
       break;
+   case LP_QUERY_TRANSLATE_CACHE_HITS:
+   case LP_QUERY_TRANSLATE_CACHE_MISSES:
+   case LP_QUERY_TRANSLATE_CACHE_EVICTIONS:
+      /* the counters wrap around */
+      pq->end[0] = (unsigned)(translate_cache_counter(pq->type) -
+                              (unsigned)pq->start[0]);
+      break;
    default:
       break;
    }
@@ -318,6 +381,40 @@ llvmpipe_check_render_cond(struct llvmpipe_context *lp)
       return TRUE;
 }
 
+/**
+ * Driver specific queries, for the HUD.  These are all summed over the
+ * rasterizer threads, except for the imbalance.
+ */
+static const struct pipe_driver_query_info driver_query_list[] = {
+   {"rast-bins", LP_QUERY_RAST_COUNTER(LP_RAST_COUNTER_BINS), 0, FALSE},
+   {"rast-triangles", LP_QUERY_RAST_COUNTER(LP_RAST_COUNTER_TRIANGLES), 0, FALSE},
+   {"rast-blocks-full", LP_QUERY_RAST_COUNTER(LP_RAST_COUNTER_BLOCKS_FULL), 0, FALSE},
+   {"rast-blocks-partial", LP_QUERY_RAST_COUNTER(LP_RAST_COUNTER_BLOCKS_PARTIAL), 0, FALSE},
+   {"rast-busy-us", LP_QUERY_RAST_COUNTER(LP_RAST_COUNTER_BUSY_TIME), 0, FALSE},
+   {"rast-idle-us", LP_QUERY_RAST_COUNTER(LP_RAST_COUNTER_IDLE_TIME), 0, FALSE},
+   {"rast-imbalance", LP_QUERY_RAST_IMBALANCE, 0, FALSE},
+   {"translate-cache-hits", LP_QUERY_TRANSLATE_CACHE_HITS, 0, FALSE},
+   {"translate-cache-misses", LP_QUERY_TRANSLATE_CACHE_MISSES, 0, FALSE},
+   {"translate-cache-evictions", LP_QUERY_TRANSLATE_CACHE_EVICTIONS, 0, FALSE},
+};
+
+
+int
+llvmpipe_get_driver_query_info(struct pipe_screen *screen,
+                               unsigned index,
+                               struct pipe_driver_query_info *info)
+{
+   if (!info)
+      return Elements(driver_query_list);
+
+   if (index >= Elements(driver_query_list))
+      return 0;
+
+   *info = driver_query_list[index];
+   return 1;
+}
+
+
 void llvmpipe_init_query_funcs(struct llvmpipe_context *llvmpipe )
 {
    llvmpipe->pipe.create_query = llvmpipe_create_query;
@@ -35,10 +35,57 @@
 
 #include <limits.h>
 #include "os/os_thread.h"
+#include "pipe/p_defines.h"
 #include "lp_limits.h"
+#include "lp_perf.h"
 
 
 struct llvmpipe_context;
+struct pipe_screen;
+struct pipe_driver_query_info;
+
+
+/**
+ * Driver specific queries: one per rasterizer counter, then the busy time
+ * of the busiest thread relative to the average, in percent, then the
+ * statistics of the translate caches, which draw uses for vertex fetch and
+ * emit.
+ */
+#define LP_QUERY_RAST_COUNTER(counter) (PIPE_QUERY_DRIVER_SPECIFIC + (counter))
+#define LP_QUERY_RAST_IMBALANCE        LP_QUERY_RAST_COUNTER(LP_RAST_COUNTER_COUNT)
+#define LP_QUERY_TRANSLATE_CACHE_HITS  (LP_QUERY_RAST_IMBALANCE + 1)
+#define LP_QUERY_TRANSLATE_CACHE_MISSES (LP_QUERY_RAST_IMBALANCE + 2)
+#define LP_QUERY_TRANSLATE_CACHE_EVICTIONS (LP_QUERY_RAST_IMBALANCE + 3)
+#define LP_QUERY_DRIVER_END            (LP_QUERY_TRANSLATE_CACHE_EVICTIONS + 1)
+
+
+/**
+ * The rasterizer counter a driver specific query is computed from.
+ */
+static INLINE enum lp_rast_counter
+lp_query_rast_counter(unsigned type)
+{
+   assert(type >= PIPE_QUERY_DRIVER_SPECIFIC &&
+          type <= LP_QUERY_RAST_IMBALANCE);
+   if (type == LP_QUERY_RAST_IMBALANCE)
+      return LP_RAST_COUNTER_BUSY_TIME;
+   return (enum lp_rast_counter)(type - PIPE_QUERY_DRIVER_SPECIFIC);
+}
+
+
+/**
+ * Whether the query is counted by the rasterizer threads, through begin and
+ * end query commands in all bins.
+ */
+static INLINE boolean
+lp_query_is_binned(unsigned type)
+{
+   return type == PIPE_QUERY_OCCLUSION_COUNTER ||
+          type == PIPE_QUERY_OCCLUSION_PREDICATE ||
+          type == PIPE_QUERY_PIPELINE_STATISTICS ||
+          (type >= PIPE_QUERY_DRIVER_SPECIFIC &&
+           type <= LP_QUERY_RAST_IMBALANCE);
+}
 
 
 struct llvmpipe_query {
@@ -57,4 +104,9 @@ extern void llvmpipe_init_query_funcs(struct llvmpipe_context * );
 
 extern boolean llvmpipe_check_render_cond(struct llvmpipe_context *);
 
+extern int
+llvmpipe_get_driver_query_info(struct pipe_screen *screen,
+                               unsigned index,
+                               struct pipe_driver_query_info *info);
+
 #endif /* LP_QUERY_H */
@@ -26,14 +26,22 @@
  **************************************************************************/
 
 #include <limits.h>
+#include "util/u_cpu_detect.h"
 #include "util/u_memory.h"
 #include "util/u_math.h"
 #include "util/u_rect.h"
 #include "util/u_surface.h"
 #include "util/u_pack_color.h"
+#include "util/u_string.h"
+#include "util/u_trace_events.h"
 
 #include "os/os_time.h"
 
+#if defined(PIPE_OS_LINUX)
+#include <stdio.h>
+#include <unistd.h>
+#endif
+
 #include "lp_scene_queue.h"
 #include "lp_context.h"
 #include "lp_debug.h"
@@ -67,15 +75,21 @@ lp_rast_begin( struct lp_rasterizer *rast,
    LP_DBG(DEBUG_RAST, "%s\n", __FUNCTION__);
 
    lp_scene_begin_rasterization( scene );
-   lp_scene_bin_iter_begin( scene );
+   lp_scene_bin_iter_begin( scene,
+                            rast->no_bin_stealing ? 1 :
+                            MAX2(rast->num_threads, 1),
+                            rast->bin_order );
 }
 
 
+/**
+ * Done rasterizing a scene.
+ * The scene's fence has been signalled by then and the scene may already
+ * be reset and reused by the setup code, so it must not be touched here.
+ */
 static void
 lp_rast_end( struct lp_rasterizer *rast )
 {
-   lp_scene_end_rasterization( rast->curr_scene );
-
    rast->curr_scene = NULL;
 }
 
@@ -103,9 +117,19 @@ lp_rast_tile_begin(struct lp_rasterizer_task *task,
    task->thread_data.vis_counter = 0;
    task->ps_invocations = 0;
 
+   memset(task->counters, 0, sizeof(task->counters));
+   task->counters[LP_RAST_COUNTER_BINS] = 1;
+   task->tile_start_time = os_time_get_nano();
+   if (task->tile_end_time) {
+      task->counters[LP_RAST_COUNTER_IDLE_TIME] =
+         task->tile_start_time - task->tile_end_time;
+   }
+
    /* reset pointers to color and depth tile(s) */
    memset(task->color_tiles, 0, sizeof(task->color_tiles));
    task->depth_tile = NULL;
+
+   lp_rast_hiz_reset(task);
 }
 
 
@@ -330,6 +354,29 @@ lp_rast_clear_zstencil(struct lp_rasterizer_task *task,
          }
          dst_layer += scene->zsbuf.layer_stride;
       }
+
+      /*
+       * Update the depth bounds.  Note that the whole tile was cleared, so
+       * reading back any value will do.
+       */
+      if (task->hiz) {
+         enum pipe_format format = scene->fb.zsbuf->format;
+         uint64_t depth_mask = util_pack64_mask_z(format, 0xffffffff);
+
+         if ((clear_mask64 & depth_mask) == depth_mask) {
+            const struct util_format_description *desc =
+               util_format_description(format);
+            float z;
+
+            dst = lp_rast_get_unswizzled_depth_tile_pointer(task, LP_TEX_USAGE_READ);
+            desc->unpack_z_float(&z, 0, dst, 0, 1, 1);
+            for (i = 0; i < Elements(task->hiz_zmax); i++)
+               task->hiz_zmax[i] = z;
+         }
+         else if (clear_mask64 & depth_mask) {
+            lp_rast_hiz_reset(task);
+         }
+      }
    }
 }
 
@@ -365,6 +412,18 @@ lp_rast_shade_tile(struct lp_rasterizer_task *task,
    }
    variant = state->variant;
 
+   if (lp_rast_hiz_cull(task, inputs, tile_x, tile_y, TILE_SIZE))
+      return;
+
+   task->counters[LP_RAST_COUNTER_BLOCKS_FULL] +=
+      ((task->width + 15) / 16) * ((task->height + 15) / 16);
+
+   if (inputs->linear) {
+      lp_linear_shade_rect(task, inputs, tile_x, tile_y,
+                           task->width, task->height);
+      return;
+   }
+
    /* render the whole 64x64 tile in 4x4 chunks */
    for (y = 0; y < task->height; y += 4){
       for (x = 0; x < task->width; x += 4) {
@@ -408,6 +467,9 @@ lp_rast_shade_tile(struct lp_rasterizer_task *task,
          END_JIT_CALL();
       }
    }
+
+   if (task->width == TILE_SIZE && task->height == TILE_SIZE)
+      lp_rast_hiz_update(task, inputs, tile_x, tile_y, TILE_SIZE);
 }
 
 
@@ -536,7 +598,9 @@ lp_rast_begin_query(struct lp_rasterizer_task *task,
       pq->start[task->thread_index] = task->ps_invocations;
       break;
    default:
-      assert(0);
+      assert(pq->type >= PIPE_QUERY_DRIVER_SPECIFIC);
+      pq->start[task->thread_index] =
+         task->counters[lp_query_rast_counter(pq->type)];
       break;
    }
 }
@@ -569,7 +633,11 @@ lp_rast_end_query(struct lp_rasterizer_task *task,
       pq->start[task->thread_index] = 0;
       break;
    default:
-      assert(0);
+      assert(pq->type >= PIPE_QUERY_DRIVER_SPECIFIC);
+      pq->end[task->thread_index] +=
+         task->counters[lp_query_rast_counter(pq->type)] -
+         pq->start[task->thread_index];
+      pq->start[task->thread_index] = 0;
       break;
    }
 }
@@ -579,7 +647,18 @@ void
 lp_rast_set_state(struct lp_rasterizer_task *task,
                   const union lp_rast_cmd_arg arg)
 {
+   const struct lp_fragment_shader_variant *variant = arg.state->variant;
+
    task->state = arg.state;
+
+   /* The shader may still be compiling, when compiled asynchronously */
+   if (variant && variant->ready && !lp_fence_signalled(variant->ready)) {
+      lp_fence_wait(variant->ready);
+   }
+
+   /* Depth values may go up, so the current bounds can't be trusted */
+   if (variant && variant->hiz_invalidate)
+      lp_rast_hiz_reset(task);
 }
 
 
@@ -592,6 +671,10 @@ lp_rast_tile_end(struct lp_rasterizer_task *task)
 {
    unsigned i;
 
+   task->tile_end_time = os_time_get_nano();
+   task->counters[LP_RAST_COUNTER_BUSY_TIME] =
+      task->tile_end_time - task->tile_start_time;
+
    for (i = 0; i < task->scene->num_active_queries; ++i) {
       lp_rast_end_query(task, lp_rast_arg_query(task->scene->active_queries[i]));
    }
@@ -637,6 +720,14 @@ static lp_rast_cmd_func dispatch[LP_RAST_OP_MAX] =
 };
 
 
+/** Bitmask of the LP_RAST_OP_TRIANGLE_x commands */
+#define LP_RAST_TRIANGLE_OPS \
+   ((((1 << (LP_RAST_OP_TRIANGLE_4_16 + 1)) - 1) & \
+     ~((1 << LP_RAST_OP_TRIANGLE_1) - 1)) | \
+    (((1 << (LP_RAST_OP_TRIANGLE_32_4_16 + 1)) - 1) & \
+     ~((1 << LP_RAST_OP_TRIANGLE_32_1) - 1)))
+
+
 static void
 do_rasterize_bin(struct lp_rasterizer_task *task,
                  const struct cmd_bin *bin,
@@ -650,6 +741,8 @@ do_rasterize_bin(struct lp_rasterizer_task *task,
 
    for (block = bin->head; block; block = block->next) {
       for (k = 0; k < block->count; k++) {
+         task->counters[LP_RAST_COUNTER_TRIANGLES] +=
+            (LP_RAST_TRIANGLE_OPS >> block->cmd[k]) & 1;
          dispatch[block->cmd[k]]( task, block->arg[k] );
       }
    }
@@ -707,8 +800,25 @@ static void
 rasterize_scene(struct lp_rasterizer_task *task,
                 struct lp_scene *scene)
 {
+   util_trace_event_begin("lp rasterize");
+
    task->scene = scene;
 
+   task->hiz = FALSE;
+   if (!task->rast->no_hiz && scene->fb.zsbuf &&
+       util_format_has_depth(util_format_description(scene->fb.zsbuf->format))) {
+      const struct util_format_description *desc =
+         util_format_description(scene->fb.zsbuf->format);
+      unsigned bits = desc->channel[desc->swizzle[0]].size;
+
+      task->hiz = TRUE;
+      if (desc->channel[desc->swizzle[0]].type == UTIL_FORMAT_TYPE_FLOAT)
+         task->hiz_eps = 0.0f;
+      else
+         /* allow for the rounding of both the fragment and the stored depth */
+         task->hiz_eps = (float)(2.0 / ((double)((uint64_t)1 << bits) - 1.0));
+   }
+
    if (!task->rast->no_rast && !scene->discard) {
       /* loop over scene bins, rasterize each */
       {
@@ -716,7 +826,8 @@ rasterize_scene(struct lp_rasterizer_task *task,
          int i, j;
 
          assert(scene);
-         while ((bin = lp_scene_bin_iter_next(scene, &i, &j))) {
+         while ((bin = lp_scene_bin_iter_next(scene, task->thread_index,
+                                              &i, &j))) {
             if (!is_empty_bin( bin ))
                rasterize_bin(task, bin, i, j);
          }
@@ -729,6 +840,8 @@ rasterize_scene(struct lp_rasterizer_task *task,
    }
 
    task->scene = NULL;
+
+   util_trace_event_end("lp rasterize");
 }
 
 
@@ -776,19 +889,43 @@ lp_rast_queue_scene( struct lp_rasterizer *rast,
 }
 
 
+/**
+ * Run func on every rasterizer thread, once all the scenes queued before
+ * are done, and wait for it to complete.  This is how compute grids get
+ * executed.  The caller must hold the screen's rast_mutex.
+ */
 void
-lp_rast_finish( struct lp_rasterizer *rast )
+lp_rast_run_job( struct lp_rasterizer *rast,
+                 lp_rast_job_func func,
+                 void *data )
 {
    if (rast->num_threads == 0) {
-      /* nothing to do */
+      /* no threading */
+      unsigned fpstate = util_fpstate_get();
+
+      util_fpstate_set_denorms_to_zero(fpstate);
+
+      func(data, 0);
+
+      util_fpstate_set(fpstate);
    }
    else {
-      int i;
+      unsigned i;
+
+      rast->job_func = func;
+      rast->job_data = data;
+
+      /* keep the job in order with the scenes */
+      lp_scene_enqueue( rast->full_scenes, NULL );
 
-      /* wait for work to complete */
       for (i = 0; i < rast->num_threads; i++) {
-         pipe_semaphore_wait(&rast->tasks[i].work_done);
+         pipe_semaphore_signal(&rast->tasks[i].work_ready);
       }
+
+      pipe_semaphore_wait(&rast->job_done);
+
+      rast->job_func = NULL;
+      rast->job_data = NULL;
    }
 }
 
@@ -798,7 +935,7 @@ lp_rast_finish( struct lp_rasterizer *rast )
  * It's a simple loop:
  *   1. wait for work
  *   2. do work
- *   3. signal that we're done
+ * Completion is signalled through the scene's fence.
  */
 static PIPE_THREAD_ROUTINE( thread_function, init_data )
 {
@@ -825,9 +962,11 @@ static PIPE_THREAD_ROUTINE( thread_function, init_data )
          /* thread[0]:
           *  - get next scene to rasterize
           *  - map the framebuffer surfaces
+          * An empty queue entry stands for rast->job_func.
           */
-         lp_rast_begin( rast, 
-                        lp_scene_dequeue( rast->full_scenes, TRUE ) );
+         struct lp_scene *scene = lp_scene_dequeue( rast->full_scenes, TRUE );
+         if (scene)
+            lp_rast_begin( rast, scene );
       }
 
       /* Wait for all threads to get here so that threads[1+] don't
@@ -839,8 +978,13 @@ static PIPE_THREAD_ROUTINE( thread_function, init_data )
       if (debug)
          debug_printf("thread %d doing work\n", task->thread_index);
 
-      rasterize_scene(task,
-                      rast->curr_scene);
+      if (rast->curr_scene) {
+         rasterize_scene(task,
+                         rast->curr_scene);
+      }
+      else {
+         rast->job_func(rast->job_data, task->thread_index);
+      }
       
       /* wait for all threads to finish with this scene */
       pipe_barrier_wait( &rast->barrier );
@@ -848,34 +992,95 @@ static PIPE_THREAD_ROUTINE( thread_function, init_data )
       /* XXX: shouldn't be necessary:
        */
       if (task->thread_index == 0) {
-         lp_rast_end( rast );
+         if (rast->curr_scene)
+            lp_rast_end( rast );
+         else
+            pipe_semaphore_signal(&rast->job_done);
       }
 
-      /* signal done with work */
       if (debug)
          debug_printf("thread %d done working\n", task->thread_index);
-
-      pipe_semaphore_signal(&task->work_done);
    }
 
    return 0;
 }
 
 
+#define LP_MAX_NUMA_NODES 64
+
+/**
+ * Return the NUMA node of the given CPU, or zero if unknown.
+ */
+static unsigned
+get_cpu_node(unsigned cpu)
+{
+#if defined(PIPE_OS_LINUX)
+   unsigned node;
+
+   for (node = 0; node < LP_MAX_NUMA_NODES; node++) {
+      char path[64];
+      util_snprintf(path, sizeof path,
+                    "/sys/devices/system/cpu/cpu%u/node%u", cpu, node);
+      if (access(path, F_OK) == 0)
+         return node;
+   }
+#endif
+   return 0;
+}
+
+
+/**
+ * Fill in the order in which CPUs are given to the rasterizer threads
+ * when they are pinned: all the CPUs of the first NUMA node, then all
+ * those of the next one, and so on.  That way the neighbouring threads,
+ * which steal work from each other first, share a node too.
+ */
+static unsigned
+get_cpu_order(unsigned *cpus, unsigned max_cpus)
+{
+   unsigned nr_cpus = MIN2((unsigned) util_cpu_caps.nr_cpus, max_cpus);
+   unsigned cpu_node[LP_MAX_THREADS];
+   unsigned cpu, node, n = 0;
+
+   for (cpu = 0; cpu < nr_cpus; cpu++) {
+      cpu_node[cpu] = get_cpu_node(cpu);
+   }
+
+   for (node = 0; node < LP_MAX_NUMA_NODES && n < nr_cpus; node++) {
+      for (cpu = 0; cpu < nr_cpus; cpu++) {
+         if (cpu_node[cpu] == node)
+            cpus[n++] = cpu;
+      }
+   }
+
+   return n;
+}
+
+
 /**
  * Initialize semaphores and spawn the threads.
  */
 static void
 create_rast_threads(struct lp_rasterizer *rast)
 {
+   unsigned cpus[LP_MAX_THREADS];
+   unsigned nr_cpus = 0;
    unsigned i;
 
+   if (rast->pin_threads && rast->num_threads)
+      nr_cpus = get_cpu_order(cpus, Elements(cpus));
+
    /* NOTE: if num_threads is zero, we won't use any threads */
    for (i = 0; i < rast->num_threads; i++) {
       pipe_semaphore_init(&rast->tasks[i].work_ready, 0);
-      pipe_semaphore_init(&rast->tasks[i].work_done, 0);
       rast->threads[i] = pipe_thread_create(thread_function,
                                             (void *) &rast->tasks[i]);
+
+      if (nr_cpus && rast->threads[i]) {
+         if (!pipe_thread_set_affinity(rast->threads[i], cpus[i % nr_cpus]))
+            debug_printf("llvmpipe: failed to pin thread %u to cpu %u\n",
+                         i, cpus[i % nr_cpus]);
+      }
    }
 }
 
@@ -911,6 +1116,27 @@ lp_rast_create( unsigned num_threads )
    rast->num_threads = num_threads;
 
    rast->no_rast = debug_get_bool_option("LP_NO_RAST", FALSE);
+   rast->no_bin_stealing = debug_get_bool_option("LP_NO_BIN_STEALING", FALSE);
+
+   {
+      const char *order = debug_get_option("LP_BIN_ORDER", "raster");
+      if (strcmp(order, "morton") == 0)
+         rast->bin_order = LP_BIN_ORDER_MORTON;
+      else if (strcmp(order, "hilbert") == 0)
+         rast->bin_order = LP_BIN_ORDER_HILBERT;
+      else
+         rast->bin_order = LP_BIN_ORDER_RASTER;
+   }
+
+   rast->pin_threads = debug_get_bool_option("LP_PIN_THREADS", FALSE);
+   rast->no_hiz = debug_get_bool_option("LP_NO_HIZ", FALSE);
+
+   /* Use the AVX2 triangle rasterization functions, where available */
+   if (util_cpu_caps.has_avx2) {
+      lp_rast_tri_init_avx2(dispatch);
+   }
+
+   pipe_semaphore_init(&rast->job_done, 0);
 
    create_rast_threads(rast);
 
@@ -951,9 +1177,10 @@ void lp_rast_destroy( struct lp_rasterizer *rast )
    /* Clean up per-thread data */
    for (i = 0; i < rast->num_threads; i++) {
       pipe_semaphore_destroy(&rast->tasks[i].work_ready);
-      pipe_semaphore_destroy(&rast->tasks[i].work_done);
    }
 
+   pipe_semaphore_destroy(&rast->job_done);
+
    /* for synchronizing rasterization threads */
    pipe_barrier_destroy( &rast->barrier );
 
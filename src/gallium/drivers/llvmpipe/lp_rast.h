@@ -87,6 +87,11 @@ struct lp_rast_state {
     * the tile color/z/stencil data somehow
      */
    struct lp_fragment_shader_variant *variant;
+
+   /* Rough relative cost of shading one pixel with this state, used to
+    * schedule the most expensive bins first.
+    */
+   unsigned shade_cost;
 };
 
 
@@ -99,7 +104,8 @@ struct lp_rast_shader_inputs {
    unsigned frontfacing:1;      /** True for front-facing */
    unsigned disable:1;          /** Partially binned, disable this command */
    unsigned opaque:1;           /** Is opaque */
-   unsigned pad0:29;            /* wasted space */
+   unsigned linear:1;           /** Full blocks can use lp_linear_shade_rect() */
+   unsigned pad0:28;            /* wasted space */
    unsigned stride;             /* how much to advance data between a0, dadx, dady */
    unsigned layer;              /* the layer to render to (from gs, already clamped) */
    unsigned viewport_index;     /* the active viewport index (from gs, already clamped) */
@@ -153,8 +159,16 @@ void
 lp_rast_queue_scene( struct lp_rasterizer *rast,
                      struct lp_scene *scene );
 
+
+/**
+ * Work run by every rasterizer thread, in place of a scene.
+ */
+typedef void (*lp_rast_job_func)(void *data, unsigned thread_index);
+
 void
-lp_rast_finish( struct lp_rasterizer *rast );
+lp_rast_run_job( struct lp_rasterizer *rast,
+                 lp_rast_job_func func,
+                 void *data );
 
 
 union lp_rast_cmd_arg {
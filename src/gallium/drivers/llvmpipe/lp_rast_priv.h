@@ -28,8 +28,11 @@
 #ifndef LP_RAST_PRIV_H
 #define LP_RAST_PRIV_H
 
+#include <float.h>
+
 #include "os/os_thread.h"
 #include "util/u_format.h"
+#include "util/u_math.h"
 #include "gallivm/lp_bld_debug.h"
 #include "lp_memory.h"
 #include "lp_rast.h"
@@ -37,11 +40,21 @@
 #include "lp_state.h"
 #include "lp_texture.h"
 #include "lp_limits.h"
+#include "lp_linear.h"
+#include "lp_perf.h"
 
 
 #define TILE_VECTOR_HEIGHT 4
 #define TILE_VECTOR_WIDTH 4
 
+/** Increment one of the task's rasterizer counters */
+#define LP_RAST_COUNT(task, counter) \
+   ((task)->counters[LP_RAST_COUNTER_##counter]++)
+
+/* Granularity of the hierarchical depth culling */
+#define LP_HIZ_BLOCK_SIZE 16
+#define LP_HIZ_BLOCKS (TILE_SIZE / LP_HIZ_BLOCK_SIZE)
+
 /* If we crash in a jitted function, we can examine jit_line and jit_state
  * to get some info.  This is not thread-safe, however.
  */
@@ -102,8 +115,21 @@ struct lp_rasterizer_task
    uint64_t ps_invocations;
    uint8_t ps_inv_multiplier;
 
+   /** Per tile counters for the driver specific queries */
+   uint64_t counters[LP_RAST_COUNTER_COUNT];
+   int64_t tile_start_time;
+   int64_t tile_end_time;    /**< of the previous tile, zero if none */
+
+   /**
+    * Hierarchical depth culling: conservative upper bound of the depth
+    * values of each 16x16 block of the tile (in layer 0), FLT_MAX if
+    * unknown.
+    */
+   boolean hiz;
+   float hiz_eps;   /**< depth buffer precision */
+   float hiz_zmax[LP_HIZ_BLOCKS * LP_HIZ_BLOCKS];
+
    pipe_semaphore work_ready;
-   pipe_semaphore work_done;
 };
 
 
@@ -116,6 +142,10 @@ struct lp_rasterizer
 {
    boolean exit_flag;
    boolean no_rast;  /**< For debugging/profiling */
+   boolean no_bin_stealing;  /**< Hand out bins from one shared queue */
+   enum lp_bin_order bin_order;
+   boolean pin_threads;  /**< Pin each thread to a CPU, NUMA node by node */
+   boolean no_hiz;  /**< Disable hierarchical depth culling */
 
    /** The incoming queue of scenes ready to rasterize */
    struct lp_scene_queue *full_scenes;
@@ -131,6 +161,11 @@ struct lp_rasterizer
 
    /** For synchronizing the rasterization threads */
    pipe_barrier barrier;
+
+   /** The job queued by lp_rast_run_job(), and its completion */
+   lp_rast_job_func job_func;
+   void *job_data;
+   pipe_semaphore job_done;
 };
 
 
@@ -339,6 +374,147 @@ lp_rast_shade_quads_all( struct lp_rasterizer_task *task,
    }
 }
 
+
+/**
+ * Shade a fully covered size x size block with the linear path.
+ * \param x, y location of the block in window coords
+ */
+static INLINE void
+lp_rast_shade_linear(struct lp_rasterizer_task *task,
+                     const struct lp_rast_shader_inputs *inputs,
+                     unsigned x, unsigned y, unsigned size)
+{
+   unsigned width, height;
+
+   if (x >= task->x + task->width || y >= task->y + task->height)
+      return;
+
+   width = MIN2(size, task->x + task->width - x);
+   height = MIN2(size, task->y + task->height - y);
+
+   task->ps_invocations += ((width + 3) / 4) * ((height + 3) / 4) *
+                           task->state->variant->ps_inv_multiplier;
+
+   lp_linear_shade_rect(task, inputs, x, y, width, height);
+}
+
+
+/*
+ * Hierarchical depth culling.
+ *
+ * Each task keeps an upper bound of the depth values of every 16x16 block
+ * of the current tile.  Depth clears set it, blocks fully covered by a
+ * triangle which writes depth with a LESS/LEQUAL test lower it, and states
+ * which could make depth values increase reset it.  Triangles whose depth
+ * plane lies behind that bound over a whole block are then known to fail
+ * the depth test, and are culled before running the shader.
+ */
+
+static INLINE void
+lp_rast_hiz_reset(struct lp_rasterizer_task *task)
+{
+   unsigned i;
+   for (i = 0; i < Elements(task->hiz_zmax); i++)
+      task->hiz_zmax[i] = FLT_MAX;
+}
+
+
+/**
+ * Range of the interpolated depth over a size x size block at x,y, with
+ * some slack for float rounding.
+ */
+static INLINE void
+lp_rast_depth_plane_range(const struct lp_rast_shader_inputs *inputs,
+                          int x, int y, int size,
+                          float *zmin, float *zmax)
+{
+   const float a0 = GET_A0(inputs)[0][2];
+   const float dzdx = GET_DADX(inputs)[0][2];
+   const float dzdy = GET_DADY(inputs)[0][2];
+   const float zx = dzdx * x;
+   const float zy = dzdy * y;
+   const float z = a0 + zx + zy;
+   const float slack = (fabsf(a0) + fabsf(zx) + fabsf(zy)) * (1.0f / (1 << 18));
+
+   *zmin = z + MIN2(dzdx * size, 0.0f) + MIN2(dzdy * size, 0.0f) - slack;
+   *zmax = z + MAX2(dzdx * size, 0.0f) + MAX2(dzdy * size, 0.0f) + slack;
+}
+
+
+/**
+ * Whether all fragments of the inputs' triangle within the size x size
+ * block at x,y (in window coords) will fail the depth test.
+ */
+static INLINE boolean
+lp_rast_hiz_cull(const struct lp_rasterizer_task *task,
+                 const struct lp_rast_shader_inputs *inputs,
+                 int x, int y, int size)
+{
+   const int bx0 = (x - (int)task->x) / LP_HIZ_BLOCK_SIZE;
+   const int by0 = (y - (int)task->y) / LP_HIZ_BLOCK_SIZE;
+   const int bx1 = MIN2((x - (int)task->x + size - 1) / LP_HIZ_BLOCK_SIZE,
+                        LP_HIZ_BLOCKS - 1);
+   const int by1 = MIN2((y - (int)task->y + size - 1) / LP_HIZ_BLOCK_SIZE,
+                        LP_HIZ_BLOCKS - 1);
+   float zmin, zmax, tile_zmax = 0.0f;
+   int bx, by;
+
+   if (!task->hiz || !task->state->variant->hiz_cull || inputs->layer != 0)
+      return FALSE;
+
+   for (by = by0; by <= by1; by++) {
+      for (bx = bx0; bx <= bx1; bx++) {
+         tile_zmax = MAX2(tile_zmax, task->hiz_zmax[by * LP_HIZ_BLOCKS + bx]);
+      }
+   }
+
+   if (tile_zmax == FLT_MAX)
+      return FALSE;
+
+   lp_rast_depth_plane_range(inputs, x, y, size, &zmin, &zmax);
+
+   return zmin > tile_zmax + task->hiz_eps;
+}
+
+
+/**
+ * Lower the depth bounds of a block-aligned region which has been fully
+ * covered by the inputs' triangle.
+ */
+static INLINE void
+lp_rast_hiz_update(struct lp_rasterizer_task *task,
+                   const struct lp_rast_shader_inputs *inputs,
+                   int x, int y, int size)
+{
+   const int bx0 = (x - (int)task->x) / LP_HIZ_BLOCK_SIZE;
+   const int by0 = (y - (int)task->y) / LP_HIZ_BLOCK_SIZE;
+   const int n = size / LP_HIZ_BLOCK_SIZE;
+   int bx, by;
+
+   if (!task->hiz || !task->state->variant->hiz_update || inputs->layer != 0)
+      return;
+
+   assert((x - task->x) % LP_HIZ_BLOCK_SIZE == 0);
+   assert((y - task->y) % LP_HIZ_BLOCK_SIZE == 0);
+
+   for (by = by0; by < by0 + n; by++) {
+      for (bx = bx0; bx < bx0 + n; bx++) {
+         float *block_zmax = &task->hiz_zmax[by * LP_HIZ_BLOCKS + bx];
+         float zmin, zmax;
+
+         lp_rast_depth_plane_range(inputs,
+                                   task->x + bx * LP_HIZ_BLOCK_SIZE,
+                                   task->y + by * LP_HIZ_BLOCK_SIZE,
+                                   LP_HIZ_BLOCK_SIZE,
+                                   &zmin, &zmax);
+
+         /* Stored values may have been clamped to zero, but not below */
+         *block_zmax = MIN2(*block_zmax, MAX2(zmax, 0.0f));
+      }
+   }
+}
+
+
 void lp_rast_triangle_1( struct lp_rasterizer_task *, 
                          const union lp_rast_cmd_arg );
 void lp_rast_triangle_2( struct lp_rasterizer_task *, 
@@ -392,6 +568,9 @@ void lp_rast_triangle_32_3_16( struct lp_rasterizer_task *,
 void lp_rast_triangle_32_4_16( struct lp_rasterizer_task *, 
                             const union lp_rast_cmd_arg );
 
+boolean
+lp_rast_tri_init_avx2(lp_rast_cmd_func *dispatch);
+
 void
 lp_rast_set_state(struct lp_rasterizer_task *task,
                   const union lp_rast_cmd_arg arg);
@@ -58,9 +58,17 @@ block_full_16(struct lp_rasterizer_task *task,
    unsigned ix, iy;
    assert(x % 16 == 0);
    assert(y % 16 == 0);
+   if (lp_rast_hiz_cull(task, &tri->inputs, x, y, 16))
+      return;
+   LP_RAST_COUNT(task, BLOCKS_FULL);
+   if (tri->inputs.linear) {
+      lp_rast_shade_linear(task, &tri->inputs, x, y, 16);
+      return;
+   }
    for (iy = 0; iy < 16; iy += 4)
       for (ix = 0; ix < 16; ix += 4)
 	 block_full_4(task, tri, x + ix, y + iy);
+   lp_rast_hiz_update(task, &tri->inputs, x, y, 16);
 }
 
 static INLINE unsigned
@@ -305,6 +313,11 @@ lp_rast_triangle_32_3_16(struct lp_rasterizer_task *task,
    transpose4_epi32(&p0, &p1, &p2, &zero,
                     &c, &dcdx, &dcdy, &rej4);
 
+   if (lp_rast_hiz_cull(task, &tri->inputs, x, y, 16))
+      return;
+
+   LP_RAST_COUNT(task, BLOCKS_PARTIAL);
+
    /* Adjust dcdx;
     */
    dcdx = _mm_sub_epi32(zero, dcdx);
@@ -414,6 +427,11 @@ lp_rast_triangle_32_3_4(struct lp_rasterizer_task *task,
    transpose4_epi32(&p0, &p1, &p2, &zero,
                     &c, &dcdx, &dcdy, &unused);
 
+   if (lp_rast_hiz_cull(task, &tri->inputs, x, y, 4))
+      return;
+
+   LP_RAST_COUNT(task, BLOCKS_PARTIAL);
+
    /* Adjust dcdx;
     */
    dcdx = _mm_sub_epi32(zero, dcdx);
@@ -0,0 +1,316 @@
+/**************************************************************************
+ *
+ * Copyright 2014 The Mesa Authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/*
+ * AVX2 versions of the 32-bit triangle rasterization functions of
+ * lp_rast_tri.c.  This file is built with -mavx2 where the compiler
+ * supports it, and the functions are only used when the CPU has AVX2.
+ *
+ * A 4x4 block of edge function values fits in two 8-wide vectors, so the
+ * coverage masks are computed with half the instructions, and without the
+ * pack-down steps which the SSE2 paths need to gather the sign bits.
+ */
+
+#include "util/u_math.h"
+#include "lp_debug.h"
+#include "lp_perf.h"
+#include "lp_rast_priv.h"
+
+
+#if defined(PIPE_ARCH_SSE) && defined(__AVX2__)
+
+#include <immintrin.h>
+
+
+/**
+ * Sign bits of the 8 elements of v.
+ */
+static INLINE unsigned
+sign_bits8(__m256i v)
+{
+   return _mm256_movemask_ps(_mm256_castsi256_ps(v));
+}
+
+
+/**
+ * Offsets of the first two rows of a 4x4 grid, relative to its top left
+ * value.
+ */
+static INLINE __m256i
+span_4x2(int dcdx, int dcdy)
+{
+   return _mm256_setr_epi32(0, dcdx, dcdx*2, dcdx*3,
+                            dcdy, dcdy + dcdx, dcdy + dcdx*2, dcdy + dcdx*3);
+}
+
+
+/**
+ * Sign bits of c + span over a 4x4 grid, with the given two-row span and
+ * the offset between rows 0-1 and rows 2-3.
+ */
+static INLINE unsigned
+sign_bits16(int c, __m256i span, __m256i dcdy2)
+{
+   __m256i c01 = _mm256_add_epi32(_mm256_set1_epi32(c), span);
+   __m256i c23 = _mm256_add_epi32(c01, dcdy2);
+
+   return sign_bits8(c01) | (sign_bits8(c23) << 8);
+}
+
+
+static INLINE void
+build_masks_32_avx2(int c,
+                    int cdiff,
+                    int dcdx,
+                    int dcdy,
+                    unsigned *outmask,
+                    unsigned *partmask)
+{
+   __m256i span = span_4x2(dcdx, dcdy);
+   __m256i dcdy2 = _mm256_set1_epi32(dcdy * 2);
+
+   *outmask |= sign_bits16(c, span, dcdy2);
+   *partmask |= sign_bits16(c + cdiff, span, dcdy2);
+}
+
+
+static INLINE unsigned
+build_mask_linear_32_avx2(int c, int dcdx, int dcdy)
+{
+   return sign_bits16(c, span_4x2(dcdx, dcdy), _mm256_set1_epi32(dcdy * 2));
+}
+
+
+/**
+ * Shade all pixels in a 4x4 block.
+ */
+static void
+block_full_4(struct lp_rasterizer_task *task,
+             const struct lp_rast_triangle *tri,
+             int x, int y)
+{
+   lp_rast_shade_quads_all(task, &tri->inputs, x, y);
+}
+
+
+/**
+ * Shade all pixels in a 16x16 block.
+ */
+static void
+block_full_16(struct lp_rasterizer_task *task,
+              const struct lp_rast_triangle *tri,
+              int x, int y)
+{
+   unsigned ix, iy;
+   assert(x % 16 == 0);
+   assert(y % 16 == 0);
+   if (lp_rast_hiz_cull(task, &tri->inputs, x, y, 16))
+      return;
+   LP_RAST_COUNT(task, BLOCKS_FULL);
+   if (tri->inputs.linear) {
+      lp_rast_shade_linear(task, &tri->inputs, x, y, 16);
+      return;
+   }
+   for (iy = 0; iy < 16; iy += 4)
+      for (ix = 0; ix < 16; ix += 4)
+	 block_full_4(task, tri, x + ix, y + iy);
+   lp_rast_hiz_update(task, &tri->inputs, x, y, 16);
+}
+
+
+#define BUILD_MASKS(c, cdiff, dcdx, dcdy, omask, pmask) build_masks_32_avx2((int)c, (int)cdiff, dcdx, dcdy, omask, pmask)
+#define BUILD_MASK_LINEAR(c, dcdx, dcdy) build_mask_linear_32_avx2((int)c, dcdx, dcdy)
+
+#define TAG(x) x##_32_1_avx2
+#define NR_PLANES 1
+#include "lp_rast_tri_tmp.h"
+
+#define TAG(x) x##_32_2_avx2
+#define NR_PLANES 2
+#include "lp_rast_tri_tmp.h"
+
+#define TAG(x) x##_32_3_avx2
+#define NR_PLANES 3
+#include "lp_rast_tri_tmp.h"
+
+#define TAG(x) x##_32_4_avx2
+#define NR_PLANES 4
+#include "lp_rast_tri_tmp.h"
+
+#define TAG(x) x##_32_5_avx2
+#define NR_PLANES 5
+#include "lp_rast_tri_tmp.h"
+
+#define TAG(x) x##_32_6_avx2
+#define NR_PLANES 6
+#include "lp_rast_tri_tmp.h"
+
+#define TAG(x) x##_32_7_avx2
+#define NR_PLANES 7
+#include "lp_rast_tri_tmp.h"
+
+#define TAG(x) x##_32_8_avx2
+#define NR_PLANES 8
+#include "lp_rast_tri_tmp.h"
+
+
+#define NR_PLANES 3
+
+/**
+ * Rasterize a triangle with three planes within a 16x16 block.
+ */
+static void
+lp_rast_triangle_32_3_16_avx2(struct lp_rasterizer_task *task,
+                              const union lp_rast_cmd_arg arg)
+{
+   const struct lp_rast_triangle *tri = arg.triangle.tri;
+   const struct lp_rast_plane *plane = GET_PLANES(tri);
+   const int x = (arg.triangle.plane_mask & 0xff) + task->x;
+   const int y = (arg.triangle.plane_mask >> 8) + task->y;
+   __m256i span[NR_PLANES];
+   __m256i dcdy2[NR_PLANES];
+   int c[NR_PLANES];
+   int dcdx4[NR_PLANES];
+   int dcdy4[NR_PLANES];
+   unsigned outmask = 0;
+   unsigned partial_mask;
+   unsigned j;
+
+   if (lp_rast_hiz_cull(task, &tri->inputs, x, y, 16))
+      return;
+
+   LP_RAST_COUNT(task, BLOCKS_PARTIAL);
+
+   for (j = 0; j < NR_PLANES; j++) {
+      const int dcdx = -plane[j].dcdx;
+      const int dcdy = plane[j].dcdy;
+
+      /* Subtract one so we can just check the sign bit (< 0 comparison),
+       * instead of having to do a less efficient <= 0 comparison.
+       */
+      c[j] = (int)plane[j].c + dcdx * x + dcdy * y - 1;
+      dcdx4[j] = dcdx * 4;
+      dcdy4[j] = dcdy * 4;
+
+      /* Trivially reject the 4x4 blocks outside this plane */
+      outmask |= sign_bits16(c[j] + 1 + (int)plane[j].eo * 4,
+                             span_4x2(dcdx4[j], dcdy4[j]),
+                             _mm256_set1_epi32(dcdy4[j] * 2));
+
+      span[j] = span_4x2(dcdx, dcdy);
+      dcdy2[j] = _mm256_set1_epi32(dcdy * 2);
+   }
+
+   partial_mask = 0xffff & ~outmask;
+
+   while (partial_mask) {
+      int i = ffs(partial_mask) - 1;
+      int ix = i & 3;
+      int iy = i >> 2;
+      unsigned mask = 0;
+
+      partial_mask &= ~(1 << i);
+
+      for (j = 0; j < NR_PLANES; j++) {
+         mask |= sign_bits16(c[j] + dcdx4[j] * ix + dcdy4[j] * iy,
+                             span[j], dcdy2[j]);
+      }
+
+      if (mask != 0xffff)
+         lp_rast_shade_quads_mask(task,
+                                  &tri->inputs,
+                                  x + 4 * ix,
+                                  y + 4 * iy,
+                                  0xffff & ~mask);
+   }
+}
+
+
+/**
+ * Rasterize a triangle with three planes within a 4x4 block.
+ */
+static void
+lp_rast_triangle_32_3_4_avx2(struct lp_rasterizer_task *task,
+                             const union lp_rast_cmd_arg arg)
+{
+   const struct lp_rast_triangle *tri = arg.triangle.tri;
+   const struct lp_rast_plane *plane = GET_PLANES(tri);
+   const int x = (arg.triangle.plane_mask & 0xff) + task->x;
+   const int y = (arg.triangle.plane_mask >> 8) + task->y;
+   unsigned mask = 0;
+   unsigned j;
+
+   if (lp_rast_hiz_cull(task, &tri->inputs, x, y, 4))
+      return;
+
+   LP_RAST_COUNT(task, BLOCKS_PARTIAL);
+
+   for (j = 0; j < NR_PLANES; j++) {
+      const int dcdx = -plane[j].dcdx;
+      const int dcdy = plane[j].dcdy;
+      const int c = (int)plane[j].c + dcdx * x + dcdy * y - 1;
+
+      mask |= build_mask_linear_32_avx2(c, dcdx, dcdy);
+   }
+
+   if (mask != 0xffff)
+      lp_rast_shade_quads_mask(task,
+                               &tri->inputs,
+                               x,
+                               y,
+                               0xffff & ~mask);
+}
+
+#undef NR_PLANES
+
+
+boolean
+lp_rast_tri_init_avx2(lp_rast_cmd_func *dispatch)
+{
+   dispatch[LP_RAST_OP_TRIANGLE_32_1] = lp_rast_triangle_32_1_avx2;
+   dispatch[LP_RAST_OP_TRIANGLE_32_2] = lp_rast_triangle_32_2_avx2;
+   dispatch[LP_RAST_OP_TRIANGLE_32_3] = lp_rast_triangle_32_3_avx2;
+   dispatch[LP_RAST_OP_TRIANGLE_32_4] = lp_rast_triangle_32_4_avx2;
+   dispatch[LP_RAST_OP_TRIANGLE_32_5] = lp_rast_triangle_32_5_avx2;
+   dispatch[LP_RAST_OP_TRIANGLE_32_6] = lp_rast_triangle_32_6_avx2;
+   dispatch[LP_RAST_OP_TRIANGLE_32_7] = lp_rast_triangle_32_7_avx2;
+   dispatch[LP_RAST_OP_TRIANGLE_32_8] = lp_rast_triangle_32_8_avx2;
+   dispatch[LP_RAST_OP_TRIANGLE_32_3_4] = lp_rast_triangle_32_3_4_avx2;
+   dispatch[LP_RAST_OP_TRIANGLE_32_3_16] = lp_rast_triangle_32_3_16_avx2;
+   return TRUE;
+}
+
+#else /* !(PIPE_ARCH_SSE && __AVX2__) */
+
+boolean
+lp_rast_tri_init_avx2(lp_rast_cmd_func *dispatch)
+{
+   (void)dispatch;
+   return FALSE;
+}
+
+#endif
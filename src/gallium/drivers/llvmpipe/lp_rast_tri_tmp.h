@@ -198,6 +198,9 @@ TAG(lp_rast_triangle)(struct lp_rasterizer_task *task,
    if (outmask == 0xffff)
       return;
 
+   if (lp_rast_hiz_cull(task, &tri->inputs, x, y, TILE_SIZE))
+      return;
+
    /* Mask of sub-blocks which are inside all trivial accept planes:
     */
    inmask = ~partmask & 0xffff;
@@ -228,7 +231,11 @@ TAG(lp_rast_triangle)(struct lp_rasterizer_task *task,
 
       partial_mask &= ~(1 << i);
 
+      if (lp_rast_hiz_cull(task, &tri->inputs, px, py, 16))
+         continue;
+
       LP_COUNT(nr_partially_covered_16);
+      LP_RAST_COUNT(task, BLOCKS_PARTIAL);
       TAG(do_block_16)(task, tri, plane, px, py, cx);
    }
 
@@ -272,6 +279,11 @@ TRI_16(struct lp_rasterizer_task *task,
    x += task->x;
    y += task->y;
 
+   if (lp_rast_hiz_cull(task, &tri->inputs, x, y, 16))
+      return;
+
+   LP_RAST_COUNT(task, BLOCKS_PARTIAL);
+
    for (j = 0; j < NR_PLANES; j++) {
       const int dcdx = -plane[j].dcdx * 4;
       const int dcdy = plane[j].dcdy * 4;
@@ -337,6 +349,11 @@ TRI_4(struct lp_rasterizer_task *task,
    const int y = task->y + (mask >> 8);
    unsigned j;
 
+   if (lp_rast_hiz_cull(task, &tri->inputs, x, y, 4))
+      return;
+
+   LP_RAST_COUNT(task, BLOCKS_PARTIAL);
+
    /* Iterate over partials:
     */
    {
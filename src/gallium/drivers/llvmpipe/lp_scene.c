@@ -29,8 +29,10 @@
 #include "util/u_math.h"
 #include "util/u_memory.h"
 #include "util/u_inlines.h"
+#include "util/u_atomic.h"
 #include "util/u_simple_list.h"
 #include "util/u_format.h"
+#include "os/os_thread.h"
 #include "lp_scene.h"
 #include "lp_fence.h"
 #include "lp_debug.h"
@@ -38,6 +40,51 @@
 
 #define RESOURCE_REF_SZ 32
 
+#if defined(PIPE_OS_LINUX)
+#include <sys/mman.h>
+#endif
+
+/** Size and alignment of the slabs backing a huge page block pool */
+#define LP_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+/**
+ * Approximate number of 4x4 blocks shaded by each command.  Partially
+ * covered tiles are guessed to be a quarter covered.
+ */
+const uint16_t lp_rast_op_cost[LP_RAST_OP_MAX] =
+{
+   0,    /* clear_color */
+   0,    /* clear_zstencil */
+   64,   /* triangle_1 */
+   64,   /* triangle_2 */
+   64,   /* triangle_3 */
+   64,   /* triangle_4 */
+   64,   /* triangle_5 */
+   64,   /* triangle_6 */
+   64,   /* triangle_7 */
+   64,   /* triangle_8 */
+   1,    /* triangle_3_4 */
+   8,    /* triangle_3_16 */
+   8,    /* triangle_4_16 */
+   256,  /* shade_tile */
+   256,  /* shade_tile_opaque */
+   0,    /* begin_query */
+   0,    /* end_query */
+   0,    /* set_state */
+   64,   /* triangle_32_1 */
+   64,   /* triangle_32_2 */
+   64,   /* triangle_32_3 */
+   64,   /* triangle_32_4 */
+   64,   /* triangle_32_5 */
+   64,   /* triangle_32_6 */
+   64,   /* triangle_32_7 */
+   64,   /* triangle_32_8 */
+   1,    /* triangle_32_3_4 */
+   8,    /* triangle_32_3_16 */
+   8     /* triangle_32_4_16 */
+};
+
+
 /** List of resource references */
 struct resource_ref {
    struct pipe_resource *resource[RESOURCE_REF_SZ];
@@ -46,23 +93,206 @@ struct resource_ref {
 };
 
 
+/**
+ * Header of a huge page slab, followed by the data blocks carved out of it.
+ */
+struct block_slab {
+   struct block_slab *next;
+};
+
+
+/**
+ * Data blocks released by scenes at the end of rasterization are kept
+ * here rather than freed, so that once the pool has grown to the high
+ * water mark of the application's scenes no more allocations happen.
+ * The setup workers take blocks concurrently, hence the mutex.
+ */
+struct lp_block_pool {
+   pipe_mutex mutex;
+   struct data_block *free;      /**< list of free blocks */
+   unsigned num_free;
+   unsigned num_blocks;          /**< all the blocks owned by the pool */
+   boolean huge_pages;
+   struct block_slab *slabs;     /**< huge page backing store */
+};
+
+
+/**
+ * \param huge_pages  allocate the blocks in slabs marked as candidates
+ *                    for transparent huge pages
+ */
+struct lp_block_pool *
+lp_block_pool_create(boolean huge_pages)
+{
+   struct lp_block_pool *pool = CALLOC_STRUCT(lp_block_pool);
+   if (!pool)
+      return NULL;
+
+   pipe_mutex_init(pool->mutex);
+#if defined(PIPE_OS_LINUX) && defined(MADV_HUGEPAGE)
+   pool->huge_pages = huge_pages;
+#else
+   (void) huge_pages;
+#endif
+
+   return pool;
+}
+
+
+/**
+ * Free the pool and all its blocks.  All the scenes using the pool must
+ * have been destroyed already.
+ */
+void
+lp_block_pool_destroy(struct lp_block_pool *pool)
+{
+   assert(pool->num_free == pool->num_blocks);
+
+   if (pool->huge_pages) {
+      struct block_slab *slab, *next;
+
+      for (slab = pool->slabs; slab; slab = next) {
+         next = slab->next;
+         os_free_aligned(slab);
+      }
+   }
+   else {
+      struct data_block *block, *next;
+
+      for (block = pool->free; block; block = next) {
+         next = block->next;
+         FREE(block);
+      }
+   }
+
+   pipe_mutex_destroy(pool->mutex);
+   FREE(pool);
+}
+
+
+/**
+ * Add a slab's worth of blocks to the free list.  Called with the mutex
+ * held.
+ */
+static void
+block_pool_grow_huge(struct lp_block_pool *pool)
+{
+#if defined(PIPE_OS_LINUX) && defined(MADV_HUGEPAGE)
+   const unsigned offset = align(sizeof(struct block_slab), 64);
+   const unsigned count = (LP_HUGE_PAGE_SIZE - offset) /
+                          sizeof(struct data_block);
+   struct block_slab *slab;
+   unsigned i;
+
+   slab = os_malloc_aligned(LP_HUGE_PAGE_SIZE, LP_HUGE_PAGE_SIZE);
+   if (!slab)
+      return;
+
+   /* Only a hint, so failure is harmless */
+   madvise(slab, LP_HUGE_PAGE_SIZE, MADV_HUGEPAGE);
+
+   slab->next = pool->slabs;
+   pool->slabs = slab;
+
+   for (i = 0; i < count; i++) {
+      struct data_block *block = (struct data_block *)
+         ((ubyte *) slab + offset + i * sizeof(struct data_block));
+      block->next = pool->free;
+      pool->free = block;
+   }
+
+   pool->num_free += count;
+   pool->num_blocks += count;
+#else
+   (void) pool;
+#endif
+}
+
+
+/**
+ * Get an empty data block from the pool, allocating more memory if the
+ * pool has run dry.
+ */
+static struct data_block *
+block_pool_get(struct lp_block_pool *pool)
+{
+   struct data_block *block;
+
+   pipe_mutex_lock(pool->mutex);
+
+   if (!pool->free && pool->huge_pages)
+      block_pool_grow_huge(pool);
+
+   block = pool->free;
+   if (block) {
+      pool->free = block->next;
+      pool->num_free--;
+   }
+
+   pipe_mutex_unlock(pool->mutex);
+
+   if (!block && !pool->huge_pages) {
+      block = MALLOC_STRUCT(data_block);
+      if (block) {
+         pipe_mutex_lock(pool->mutex);
+         pool->num_blocks++;
+         pipe_mutex_unlock(pool->mutex);
+      }
+   }
+
+   if (!block)
+      return NULL;
+
+   block->used = 0;
+   block->next = NULL;
+
+   return block;
+}
+
+
+/**
+ * Return a list of data blocks to the pool.
+ */
+static void
+block_pool_put(struct lp_block_pool *pool, struct data_block *list)
+{
+   struct data_block *last;
+   unsigned count = 1;
+
+   if (!list)
+      return;
+
+   for (last = list; last->next; last = last->next)
+      count++;
+
+   pipe_mutex_lock(pool->mutex);
+   last->next = pool->free;
+   pool->free = list;
+   pool->num_free += count;
+   pipe_mutex_unlock(pool->mutex);
+}
+
+
 /**
  * Create a new scene object.
  * \param queue  the queue to put newly rendered/emptied scenes into
  */
 struct lp_scene *
-lp_scene_create( struct pipe_context *pipe )
+lp_scene_create( struct pipe_context *pipe,
+                 struct lp_block_pool *pool )
 {
    struct lp_scene *scene = CALLOC_STRUCT(lp_scene);
    if (!scene)
       return NULL;
 
    scene->pipe = pipe;
+   scene->pool = pool;
 
-   scene->data.head =
-      CALLOC_STRUCT(data_block);
-
-   pipe_mutex_init(scene->mutex);
+   scene->data.head = block_pool_get(pool);
+   if (!scene->data.head) {
+      FREE(scene);
+      return NULL;
+   }
 
 #ifdef DEBUG
    /* Do some scene limit sanity checks here */
@@ -90,9 +320,8 @@ void
 lp_scene_destroy(struct lp_scene *scene)
 {
    lp_fence_reference(&scene->fence, NULL);
-   pipe_mutex_destroy(scene->mutex);
-   assert(scene->data.head->next == NULL);
-   FREE(scene->data.head);
+   assert(!scene->data.head || scene->data.head->next == NULL);
+   block_pool_put(scene->pool, scene->data.head);
    FREE(scene);
 }
 
@@ -138,6 +367,8 @@ lp_scene_bin_reset(struct lp_scene *scene, unsigned x, unsigned y)
    struct cmd_bin *bin = lp_scene_get_bin(scene, x, y);
 
    bin->last_state = NULL;
+   bin->cost = 0;
+   bin->reset = TRUE;
    bin->head = bin->tail;
    if (bin->tail) {
       bin->tail->next = NULL;
@@ -146,6 +377,132 @@ lp_scene_bin_reset(struct lp_scene *scene, unsigned x, unsigned y)
 }
 
 
+/**
+ * Prepare a private scene which a setup worker bins triangles into on
+ * behalf of the given scene.  The private scene may use at most max_size
+ * bytes before it runs out of memory.
+ * \return FALSE if we're out of memory
+ */
+boolean
+lp_scene_begin_private(struct lp_scene *priv,
+                       const struct lp_scene *scene,
+                       unsigned max_size)
+{
+   if (!priv->data.head) {
+      priv->data.head = block_pool_get(priv->pool);
+      if (!priv->data.head)
+         return FALSE;
+   }
+
+   assert(priv->data.head->used == 0);
+   assert(priv->data.head->next == NULL);
+
+   /* The bins may refer to the framebuffer but never own a reference to
+    * it, see lp_scene_discard_private().
+    */
+   memcpy(&priv->fb, &scene->fb, sizeof priv->fb);
+   priv->fb_max_layer = scene->fb_max_layer;
+   priv->had_queries = scene->had_queries;
+   priv->tiles_x = scene->tiles_x;
+   priv->tiles_y = scene->tiles_y;
+
+   priv->alloc_failed = FALSE;
+   priv->scene_size = LP_SCENE_MAX_SIZE - MIN2(max_size, LP_SCENE_MAX_SIZE);
+   priv->private_base = priv->scene_size;
+
+   return TRUE;
+}
+
+
+static void
+reset_private_bins(struct lp_scene *priv)
+{
+   unsigned x, y;
+
+   for (y = 0; y < priv->tiles_y; y++) {
+      for (x = 0; x < priv->tiles_x; x++) {
+         struct cmd_bin *bin = lp_scene_get_bin(priv, x, y);
+         bin->head = NULL;
+         bin->tail = NULL;
+         bin->last_state = NULL;
+         bin->cost = 0;
+         bin->reset = FALSE;
+      }
+   }
+
+   memset(&priv->fb, 0, sizeof priv->fb);
+}
+
+
+/**
+ * Append the commands binned into a private scene to the end of the
+ * scene's bins, as if they had been binned there directly.  Ownership
+ * of the private scene's data blocks passes to the scene.
+ */
+void
+lp_scene_append_private(struct lp_scene *scene, struct lp_scene *priv)
+{
+   struct data_block *block;
+   unsigned x, y;
+
+   assert(priv->tiles_x == scene->tiles_x);
+   assert(priv->tiles_y == scene->tiles_y);
+
+   for (y = 0; y < priv->tiles_y; y++) {
+      for (x = 0; x < priv->tiles_x; x++) {
+         struct cmd_bin *src = lp_scene_get_bin(priv, x, y);
+         struct cmd_bin *dst;
+
+         if (!src->head && !src->reset)
+            continue;
+
+         if (src->reset)
+            lp_scene_bin_reset(scene, x, y);
+
+         if (src->head) {
+            dst = lp_scene_get_bin(scene, x, y);
+            if (dst->tail)
+               dst->tail->next = src->head;
+            else
+               dst->head = src->head;
+            dst->tail = src->tail;
+            dst->last_state = src->last_state;
+            dst->cost += src->cost;
+         }
+      }
+   }
+
+   reset_private_bins(priv);
+
+   /* Splice the private data blocks in behind the scene's current head
+    * block so that lp_scene_alloc() keeps allocating from the latter.
+    */
+   for (block = priv->data.head; block->next; block = block->next)
+      ;
+   block->next = scene->data.head->next;
+   scene->data.head->next = priv->data.head;
+   scene->scene_size += priv->scene_size - priv->private_base;
+
+   /* lp_scene_begin_private() retries the allocation should this fail */
+   priv->data.head = block_pool_get(priv->pool);
+}
+
+
+/**
+ * Throw away everything binned into a private scene.
+ */
+void
+lp_scene_discard_private(struct lp_scene *priv)
+{
+   reset_private_bins(priv);
+
+   block_pool_put(priv->pool, priv->data.head->next);
+
+   priv->data.head->next = NULL;
+   priv->data.head->used = 0;
+}
+
+
 void
 lp_scene_begin_rasterization(struct lp_scene *scene)
 {
@@ -238,6 +595,8 @@ lp_scene_end_rasterization(struct lp_scene *scene )
          bin->head = NULL;
          bin->tail = NULL;
          bin->last_state = NULL;
+         bin->cost = 0;
+         bin->reset = FALSE;
       }
    }
 
@@ -271,16 +630,12 @@ lp_scene_end_rasterization(struct lp_scene *scene )
                       j, scene->resource_reference_size);
    }
 
-   /* Free all scene data blocks:
+   /* Return all but the current scene data block to the pool:
     */
    {
       struct data_block_list *list = &scene->data;
-      struct data_block *block, *tmp;
 
-      for (block = list->head->next; block; block = tmp) {
-         tmp = block->next;
-	 FREE(block);
-      }
+      block_pool_put(scene->pool, list->head->next);
 
       list->head->next = NULL;
       list->head->used = 0;
@@ -334,13 +689,12 @@ lp_scene_new_data_block( struct lp_scene *scene )
       return NULL;
    }
    else {
-      struct data_block *block = MALLOC_STRUCT(data_block);
+      struct data_block *block = block_pool_get(scene->pool);
       if (block == NULL)
          return NULL;
       
       scene->scene_size += sizeof *block;
 
-      block->used = 0;
       block->next = scene->data.head;
       scene->data.head = block;
 
@@ -447,61 +801,214 @@ lp_scene_is_resource_referenced(const struct lp_scene *scene,
 
 
 
-/** advance curr_x,y to the next bin */
-static boolean
-next_bin(struct lp_scene *scene)
+/** Number of cost classes used for sorting the bins */
+#define NUM_COST_BUCKETS 32
+
+
+static INLINE unsigned
+bin_cost_bucket(const struct lp_scene *scene, uint32_t pos)
+{
+   unsigned cost = scene->tile[pos & 0xffff][pos >> 16].cost;
+   return cost ? MIN2(util_logbase2(cost) + 1, NUM_COST_BUCKETS - 1) : 0;
+}
+
+
+/**
+ * Map distance d along a Z-order curve to bin coordinates.
+ */
+static INLINE void
+morton_d2xy(unsigned d, unsigned *x, unsigned *y)
 {
-   scene->curr_x++;
-   if (scene->curr_x >= scene->tiles_x) {
-      scene->curr_x = 0;
-      scene->curr_y++;
+   unsigned bit;
+
+   *x = *y = 0;
+   for (bit = 0; d >> (2 * bit); bit++) {
+      *x |= ((d >> (2 * bit)) & 1) << bit;
+      *y |= ((d >> (2 * bit + 1)) & 1) << bit;
    }
-   if (scene->curr_y >= scene->tiles_y) {
-      /* no more bins */
-      return FALSE;
+}
+
+
+/**
+ * Map distance d along a Hilbert curve filling a side x side square,
+ * side being a power of two, to bin coordinates.
+ */
+static INLINE void
+hilbert_d2xy(unsigned side, unsigned d, unsigned *x, unsigned *y)
+{
+   unsigned s, t = d;
+
+   *x = *y = 0;
+   for (s = 1; s < side; s *= 2) {
+      const unsigned rx = 1 & (t / 2);
+      const unsigned ry = 1 & (t ^ rx);
+
+      /* rotate the quadrant */
+      if (ry == 0) {
+         unsigned tmp;
+         if (rx == 1) {
+            *x = s - 1 - *x;
+            *y = s - 1 - *y;
+         }
+         tmp = *x;
+         *x = *y;
+         *y = tmp;
+      }
+
+      *x += s * rx;
+      *y += s * ry;
+      t /= 4;
    }
-   return TRUE;
 }
 
 
-void
-lp_scene_bin_iter_begin( struct lp_scene *scene )
+/** Queue which the i-th most expensive bin is dealt to */
+static INLINE unsigned
+deal_queue(unsigned i, unsigned num_queues)
 {
-   scene->curr_x = scene->curr_y = -1;
+   unsigned q = i % num_queues;
+   return (i / num_queues) & 1 ? num_queues - 1 - q : q;
 }
 
 
 /**
- * Return pointer to next bin to be rendered.
- * The lp_scene::curr_x and ::curr_y fields will be advanced.
- * Multiple rendering threads will call this function to get a chunk
- * of work (a bin) to work on.
+ * Prepare the list of bins to be rasterized and split it into one queue
+ * per rasterizer thread.
+ *
+ * Empty bins are dropped and the remaining ones are ordered by decreasing
+ * estimated cost (longest-processing-time first), so that an expensive
+ * bin doesn't end up being started last and hold up all the other
+ * threads at the end of the scene.  Bins are sorted into power-of-two
+ * cost classes only, which keeps this linear and keeps the chosen
+ * traversal order within each class.  Space filling curves keep the bins
+ * processed close in time close on screen too, which helps texture and
+ * framebuffer cache reuse.
+ *
+ * The sorted bins are then dealt out to the queues in a back-and-forth
+ * order, so that every queue starts with its most expensive bins and the
+ * heavy bins are spread across the workers.  With a single queue this
+ * degenerates into one shared atomic counter.
+ *
+ * Called by one thread, before the rasterizer threads are released.
  */
-struct cmd_bin *
-lp_scene_bin_iter_next( struct lp_scene *scene , int *x, int *y)
+void
+lp_scene_bin_iter_begin( struct lp_scene *scene, unsigned num_queues,
+                         enum lp_bin_order order )
 {
-   struct cmd_bin *bin = NULL;
+   unsigned count[NUM_COST_BUCKETS];
+   unsigned start[NUM_COST_BUCKETS];
+   unsigned offset[LP_MAX_THREADS];
+   unsigned x, y, i, b, q;
+   unsigned num_bins = 0;
+
+   assert(num_queues >= 1 && num_queues <= LP_MAX_THREADS);
+
+   memset(count, 0, sizeof count);
+
+   if (order == LP_BIN_ORDER_RASTER) {
+      for (y = 0; y < scene->tiles_y; y++) {
+         for (x = 0; x < scene->tiles_x; x++) {
+            const struct cmd_bin *bin = lp_scene_get_bin(scene, x, y);
+            if (bin->head) {
+               uint32_t pos = (y << 16) | x;
+               scene->bin_order[num_bins++] = pos;
+               count[bin_cost_bucket(scene, pos)]++;
+            }
+         }
+      }
+   }
+   else {
+      /* Walk the curve over the smallest power-of-two square covering
+       * the bins, skipping the positions outside the framebuffer.
+       */
+      const unsigned side =
+         util_next_power_of_two(MAX2(scene->tiles_x, scene->tiles_y));
+      unsigned d;
 
-   pipe_mutex_lock(scene->mutex);
+      for (d = 0; d < side * side; d++) {
+         const struct cmd_bin *bin;
 
-   if (scene->curr_x < 0) {
-      /* first bin */
-      scene->curr_x = 0;
-      scene->curr_y = 0;
+         if (order == LP_BIN_ORDER_MORTON)
+            morton_d2xy(d, &x, &y);
+         else
+            hilbert_d2xy(side, d, &x, &y);
+
+         if (x >= scene->tiles_x || y >= scene->tiles_y)
+            continue;
+
+         bin = lp_scene_get_bin(scene, x, y);
+         if (bin->head) {
+            uint32_t pos = (y << 16) | x;
+            scene->bin_order[num_bins++] = pos;
+            count[bin_cost_bucket(scene, pos)]++;
+         }
+      }
+   }
+
+   /* Counting sort by decreasing cost class */
+   start[NUM_COST_BUCKETS - 1] = 0;
+   for (b = NUM_COST_BUCKETS - 1; b > 0; b--) {
+      start[b - 1] = start[b] + count[b];
+   }
+   for (i = 0; i < num_bins; i++) {
+      uint32_t pos = scene->bin_order[i];
+      scene->bin_sorted[start[bin_cost_bucket(scene, pos)]++] = pos;
+   }
+
+   /* Queue q receives sorted bins q, 2n-1-q, 2n+q, 4n-1-q, ...
+    */
+   memset(offset, 0, sizeof offset);
+   for (i = 0; i < num_bins; i++) {
+      offset[deal_queue(i, num_queues)]++;
+   }
+
+   scene->num_bins = num_bins;
+   scene->num_bin_queues = num_queues;
+   for (q = 0; q < num_queues; q++) {
+      unsigned size = offset[q];
+      offset[q] = q ? scene->bin_queues[q - 1].end : 0;
+      scene->bin_queues[q].head = offset[q];
+      scene->bin_queues[q].end = offset[q] + size;
    }
-   else if (!next_bin(scene)) {
-      /* no more bins left */
-      goto end;
+
+   for (i = 0; i < num_bins; i++) {
+      q = deal_queue(i, num_queues);
+      scene->bin_order[offset[q]++] = scene->bin_sorted[i];
    }
+}
 
-   bin = lp_scene_get_bin(scene, scene->curr_x, scene->curr_y);
-   *x = scene->curr_x;
-   *y = scene->curr_y;
 
-end:
-   /*printf("return bin %p at %d, %d\n", (void *) bin, *bin_x, *bin_y);*/
-   pipe_mutex_unlock(scene->mutex);
-   return bin;
+/**
+ * Return pointer to next bin to be rendered, or NULL when all bins have
+ * been claimed.
+ * Multiple rendering threads will call this function to get a chunk
+ * of work (a bin) to work on.  Each thread first drains its own queue
+ * and then steals from the other threads' queues.
+ */
+struct cmd_bin *
+lp_scene_bin_iter_next( struct lp_scene *scene, unsigned thread,
+                        int *x, int *y )
+{
+   unsigned num_queues = scene->num_bin_queues;
+   unsigned i;
+
+   for (i = 0; i < num_queues; i++) {
+      struct lp_bin_queue *queue =
+         &scene->bin_queues[(thread + i) % num_queues];
+
+      /* Avoid the atomic once a queue is known to be exhausted */
+      if (p_atomic_read(&queue->head) < queue->end) {
+         int32_t slot = p_atomic_inc_return(&queue->head) - 1;
+         if (slot < queue->end) {
+            uint32_t pos = scene->bin_order[slot];
+            *x = pos & 0xffff;
+            *y = pos >> 16;
+            return lp_scene_get_bin(scene, *x, *y);
+         }
+      }
+   }
+
+   return NULL;
 }
 
 
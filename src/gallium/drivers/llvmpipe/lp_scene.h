@@ -62,12 +62,22 @@ struct lp_rast_state;
  */
 #define LP_SCENE_MAX_SIZE (9*1024*1024)
 
+/* Scenes which have been queued for rasterization may hold on to this
+ * much temporary storage in total before the binner waits for them:
+ */
+#define LP_SCENE_MAX_INFLIGHT_SIZE (2 * LP_SCENE_MAX_SIZE)
+
 /* The maximum amount of texture storage referenced by a scene is
  * clamped ot this size:
  */
 #define LP_SCENE_MAX_RESOURCE_SIZE (64*1024*1024)
 
 
+/* Relative cost of each shading command, indexed by LP_RAST_OP_x.
+ */
+extern const uint16_t lp_rast_op_cost[LP_RAST_OP_MAX];
+
+
 /* switch to a non-pointer value for this:
  */
 typedef void (*lp_rast_cmd_func)( struct lp_rasterizer_task *,
@@ -97,6 +107,8 @@ struct cmd_bin {
    const struct lp_rast_state *last_state;       /* most recent state set in bin */
    struct cmd_block *head;
    struct cmd_block *tail;
+   unsigned cost;       /**< estimated work to rasterize this bin */
+   boolean reset;       /**< bin was reset, see lp_scene_append_private() */
 };
    
 
@@ -117,6 +129,25 @@ struct data_block_list {
 
 struct resource_ref;
 
+/** Free data blocks shared by the scenes of a setup context */
+struct lp_block_pool;
+
+
+/**
+ * A range of lp_scene::bin_order handed out to the rasterizer threads.
+ *
+ * Every thread owns one queue and claims bins from it by atomically
+ * incrementing 'head'.  Once its own queue is drained a thread steals from
+ * the other queues in exactly the same way, so no lock is needed at all.
+ * Padded to a cache line to avoid false sharing between the threads.
+ */
+struct lp_bin_queue {
+   int32_t head;
+   int32_t end;
+   char pad[64 - 2 * sizeof(int32_t)];
+};
+
+
 /**
  * All bins and bin data are contained here.
  * Per-bin data goes into the 'tile' bins.
@@ -128,6 +159,7 @@ struct resource_ref;
 struct lp_scene {
    struct pipe_context *pipe;
    struct lp_fence *fence;
+   struct lp_block_pool *pool;   /**< where the data blocks come from */
 
    /* The queries still active at end of scene */
    struct llvmpipe_query *active_queries[LP_MAX_ACTIVE_BINNED_QUERIES];
@@ -164,6 +196,9 @@ struct lp_scene {
     */
    unsigned resource_reference_size;
 
+   /** scene_size when a private scene was begun, for setup workers */
+   unsigned private_base;
+
    boolean alloc_failed;
    boolean has_depthstencil_clear;
    boolean discard;
@@ -173,8 +208,14 @@ struct lp_scene {
     */
    unsigned tiles_x, tiles_y;
 
-   int curr_x, curr_y;  /**< for iterating over bins */
-   pipe_mutex mutex;
+   /** Non-empty bins to rasterize, packed as (y << 16) | x */
+   uint32_t bin_order[TILES_X * TILES_Y];
+   uint32_t bin_sorted[TILES_X * TILES_Y];  /**< scratch for sorting */
+   unsigned num_bins;
+
+   /** Per-thread ranges of bin_order, for iterating over bins */
+   struct lp_bin_queue bin_queues[LP_MAX_THREADS];
+   unsigned num_bin_queues;
 
    struct cmd_bin tile[TILES_X][TILES_Y];
    struct data_block_list data;
@@ -182,7 +223,12 @@ struct lp_scene {
 
 
 
-struct lp_scene *lp_scene_create(struct pipe_context *pipe);
+struct lp_block_pool *lp_block_pool_create(boolean huge_pages);
+
+void lp_block_pool_destroy(struct lp_block_pool *pool);
+
+struct lp_scene *lp_scene_create(struct pipe_context *pipe,
+                                 struct lp_block_pool *pool);
 
 void lp_scene_destroy(struct lp_scene *scene);
 
@@ -294,6 +340,18 @@ void
 lp_scene_bin_reset(struct lp_scene *scene, unsigned x, unsigned y);
 
 
+boolean
+lp_scene_begin_private(struct lp_scene *priv,
+                       const struct lp_scene *scene,
+                       unsigned max_size);
+
+void
+lp_scene_append_private(struct lp_scene *scene, struct lp_scene *priv);
+
+void
+lp_scene_discard_private(struct lp_scene *priv);
+
+
 /* Add a command to bin[x][y].
  */
 static INLINE boolean
@@ -348,6 +406,11 @@ lp_scene_bin_cmd_with_state( struct lp_scene *scene,
    if (!lp_scene_bin_command( scene, x, y, cmd, arg ))
       return FALSE;
 
+   /* Only shading commands are weighted.  Clears and the like are binned
+    * everywhere and so don't change the relative cost of the bins.
+    */
+   bin->cost += lp_rast_op_cost[cmd & LP_RAST_OP_MASK] * state->shade_cost;
+
    return TRUE;
 }
 
@@ -378,11 +441,21 @@ lp_scene_get_num_bins( const struct lp_scene *scene )
 }
 
 
+/** Order in which the bins of a cost class are visited */
+enum lp_bin_order {
+   LP_BIN_ORDER_RASTER,    /**< row by row */
+   LP_BIN_ORDER_MORTON,    /**< Z-order curve */
+   LP_BIN_ORDER_HILBERT    /**< Hilbert curve */
+};
+
+
 void
-lp_scene_bin_iter_begin( struct lp_scene *scene );
+lp_scene_bin_iter_begin( struct lp_scene *scene, unsigned num_queues,
+                         enum lp_bin_order order );
 
 struct cmd_bin *
-lp_scene_bin_iter_next( struct lp_scene *scene, int *x, int *y );
+lp_scene_bin_iter_next( struct lp_scene *scene, unsigned thread,
+                        int *x, int *y );
 
 
 
@@ -32,6 +32,7 @@
 #include "util/u_format.h"
 #include "util/u_string.h"
 #include "util/u_format_s3tc.h"
+#include "util/u_disk_cache.h"
 #include "pipe/p_defines.h"
 #include "pipe/p_screen.h"
 #include "draw/draw_context.h"
@@ -45,8 +46,10 @@
 #include "lp_context.h"
 #include "lp_debug.h"
 #include "lp_public.h"
+#include "lp_query.h"
 #include "lp_limits.h"
 #include "lp_rast.h"
+#include "lp_state_fs.h"
 
 #include "state_tracker/sw_winsys.h"
 
@@ -202,7 +205,7 @@ llvmpipe_get_param(struct pipe_screen *screen, enum pipe_cap param)
    case PIPE_CAP_QUADS_FOLLOW_PROVOKING_VERTEX_CONVENTION:
       return 0;
    case PIPE_CAP_COMPUTE:
-      return 0;
+      return 1;
    case PIPE_CAP_USER_VERTEX_BUFFERS:
    case PIPE_CAP_USER_INDEX_BUFFERS:
       return 1;
@@ -236,6 +239,8 @@ llvmpipe_get_param(struct pipe_screen *screen, enum pipe_cap param)
       return PIPE_ENDIAN_NATIVE;
    case PIPE_CAP_TGSI_VS_LAYER:
       return 0;
+   case PIPE_CAP_BUFFER_MAP_PERSISTENT_COHERENT:
+      return 1;
    }
    /* should only get here on unhandled cases */
    debug_printf("Unexpected PIPE_CAP %d query\n", param);
@@ -272,11 +277,88 @@ llvmpipe_get_shader_param(struct pipe_screen *screen, unsigned shader, enum pipe
       default:
          return draw_get_shader_param(shader, param);
       }
+   case PIPE_SHADER_COMPUTE:
+      switch (param) {
+      case PIPE_SHADER_CAP_MAX_TEXTURE_SAMPLERS:
+      case PIPE_SHADER_CAP_MAX_SAMPLER_VIEWS:
+         /* no sampling yet */
+         return 0;
+      case PIPE_SHADER_CAP_MAX_INPUTS:
+         return 0;
+      default:
+         return gallivm_get_shader_param(param);
+      }
    default:
       return 0;
    }
 }
 
+
+static int
+llvmpipe_get_compute_param(struct pipe_screen *screen,
+                           enum pipe_compute_cap param,
+                           void *ret)
+{
+   uint64_t *ret64 = (uint64_t *)ret;
+
+   switch (param) {
+   case PIPE_COMPUTE_CAP_IR_TARGET:
+      if (ret)
+         strcpy((char *)ret, "tgsi");
+      return sizeof("tgsi");
+   case PIPE_COMPUTE_CAP_GRID_DIMENSION:
+      if (ret)
+         ret64[0] = 3;
+      return sizeof(uint64_t);
+   case PIPE_COMPUTE_CAP_MAX_GRID_SIZE:
+      if (ret) {
+         ret64[0] = 65535;
+         ret64[1] = 65535;
+         ret64[2] = 65535;
+      }
+      return 3 * sizeof(uint64_t);
+   case PIPE_COMPUTE_CAP_MAX_BLOCK_SIZE:
+      if (ret) {
+         ret64[0] = LP_MAX_CS_THREADS_PER_BLOCK;
+         ret64[1] = LP_MAX_CS_THREADS_PER_BLOCK;
+         ret64[2] = LP_MAX_CS_THREADS_PER_BLOCK;
+      }
+      return 3 * sizeof(uint64_t);
+   case PIPE_COMPUTE_CAP_MAX_THREADS_PER_BLOCK:
+      if (ret)
+         ret64[0] = LP_MAX_CS_THREADS_PER_BLOCK;
+      return sizeof(uint64_t);
+   case PIPE_COMPUTE_CAP_MAX_LOCAL_SIZE:
+      if (ret)
+         ret64[0] = LP_MAX_CS_LOCAL_SIZE;
+      return sizeof(uint64_t);
+   case PIPE_COMPUTE_CAP_MAX_INPUT_SIZE:
+      if (ret)
+         ret64[0] = LP_MAX_CS_INPUT_SIZE;
+      return sizeof(uint64_t);
+   case PIPE_COMPUTE_CAP_MAX_GLOBAL_SIZE:
+      if (ret)
+         ret64[0] = (uint64_t)LP_MAX_CS_GLOBAL_BUFFERS *
+                    LP_MAX_CS_GLOBAL_BUFFER_SIZE;
+      return sizeof(uint64_t);
+   case PIPE_COMPUTE_CAP_MAX_MEM_ALLOC_SIZE:
+      if (ret)
+         ret64[0] = LP_MAX_CS_GLOBAL_BUFFER_SIZE;
+      return sizeof(uint64_t);
+   case PIPE_COMPUTE_CAP_MAX_COMPUTE_UNITS:
+      /* blocks are spread across the rasterizer threads */
+      if (ret)
+         *(uint32_t *)ret = MAX2(1, llvmpipe_screen(screen)->num_threads);
+      return sizeof(uint32_t);
+   case PIPE_COMPUTE_CAP_MAX_PRIVATE_SIZE:
+      /* PRIVATE isn't supported */
+      if (ret)
+         ret64[0] = 0;
+      return sizeof(uint64_t);
+   }
+   return 0;
+}
+
 static float
 llvmpipe_get_paramf(struct pipe_screen *screen, enum pipe_capf param)
 {
@@ -434,6 +516,11 @@ llvmpipe_destroy_screen( struct pipe_screen *_screen )
 
    lp_jit_screen_cleanup(screen);
 
+   lp_fs_compiler_cleanup(screen);
+
+   if (screen->disk_cache)
+      util_disk_cache_destroy(screen->disk_cache);
+
    if(winsys->destroy)
       winsys->destroy(winsys);
 
@@ -528,6 +615,7 @@ llvmpipe_create_screen(struct sw_winsys *winsys)
    screen->base.get_param = llvmpipe_get_param;
    screen->base.get_shader_param = llvmpipe_get_shader_param;
    screen->base.get_paramf = llvmpipe_get_paramf;
+   screen->base.get_compute_param = llvmpipe_get_compute_param;
    screen->base.is_format_supported = llvmpipe_is_format_supported;
 
    screen->base.context_create = llvmpipe_create_context;
@@ -537,6 +625,7 @@ llvmpipe_create_screen(struct sw_winsys *winsys)
    screen->base.fence_finish = llvmpipe_fence_finish;
 
    screen->base.get_timestamp = llvmpipe_get_timestamp;
+   screen->base.get_driver_query_info = llvmpipe_get_driver_query_info;
 
    llvmpipe_init_screen_resource_funcs(&screen->base);
 
@@ -557,6 +646,10 @@ llvmpipe_create_screen(struct sw_winsys *winsys)
    }
    pipe_mutex_init(screen->rast_mutex);
 
+   screen->disk_cache = util_disk_cache_create("llvmpipe");
+
+   lp_fs_compiler_init(screen);
+
    util_format_s3tc_init();
 
    return &screen->base;
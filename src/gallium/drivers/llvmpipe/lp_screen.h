@@ -41,6 +41,7 @@
 
 
 struct sw_winsys;
+struct util_disk_cache;
 
 
 struct llvmpipe_screen
@@ -57,6 +58,27 @@ struct llvmpipe_screen
 
    struct lp_rasterizer *rast;
    pipe_mutex rast_mutex;
+
+   /** Persistent cache of fragment shader machine code, may be NULL */
+   struct util_disk_cache *disk_cache;
+
+   /*
+    * Asynchronous fragment shader compilation (LP_ASYNC_COMPILE).  Variants
+    * are queued to a single compiler thread, which has its own LLVM context.
+    */
+   boolean async_compile;
+   pipe_thread compile_thread;
+   pipe_mutex compile_mutex;   /**< protects the queue and compile_exit */
+   pipe_condvar compile_cond;
+   struct lp_fragment_shader_variant *compile_head, *compile_tail;
+   boolean compile_exit;
+   /** Held while compile_context is in use, also to free variants in it */
+   pipe_mutex compile_llvm_mutex;
+   LLVMContextRef compile_context;
+
+   /** Compiled fragment shader code, shared by the contexts */
+   pipe_mutex code_mutex;
+   struct lp_fs_code *code;
 };
 
 
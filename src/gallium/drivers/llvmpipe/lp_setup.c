@@ -39,6 +39,7 @@
 #include "util/u_inlines.h"
 #include "util/u_memory.h"
 #include "util/u_pack_color.h"
+#include "util/u_trace_events.h"
 #include "draw/draw_pipe.h"
 #include "os/os_time.h"
 #include "lp_context.h"
@@ -63,22 +64,66 @@ static boolean set_scene_state( struct lp_setup_context *, enum setup_state,
 static boolean try_update_scene_state( struct lp_setup_context *setup );
 
 
+/**
+ * Wait for a queued scene to be rasterized, then release everything it
+ * holds so that it can be reused.
+ * Scenes are only ever reset here, on the thread building them, so that
+ * lp_setup_is_resource_referenced() can look at them at any time.
+ */
+static void
+lp_setup_retire_scene(struct lp_scene *scene)
+{
+   if (scene->fence && scene->fence->issued) {
+      if (LP_DEBUG & DEBUG_SETUP)
+         debug_printf("%s: wait for scene %d\n",
+                      __FUNCTION__, scene->fence->id);
+
+      lp_fence_wait(scene->fence);
+      lp_scene_end_rasterization(scene);
+   }
+}
+
+
+/**
+ * Pick the next scene to bin into.
+ *
+ * The scenes form a pipeline: while the rasterizer threads work on the
+ * oldest queued scenes we can keep binning into the next one.  Rather
+ * than blocking as soon as all the scenes are in use, throttle on the
+ * memory held by queued scenes, so that several small scenes can be in
+ * flight but a couple of big ones are enough to stall the binner.
+ */
 static void
 lp_setup_get_empty_scene(struct lp_setup_context *setup)
 {
+   unsigned in_flight = 0;
+   unsigned i;
+
    assert(setup->scene == NULL);
 
    setup->scene_idx++;
-   setup->scene_idx %= Elements(setup->scenes);
+   setup->scene_idx %= setup->num_scenes;
 
    setup->scene = setup->scenes[setup->scene_idx];
 
-   if (setup->scene->fence) {
-      if (LP_DEBUG & DEBUG_SETUP)
-         debug_printf("%s: wait for scene %d\n",
-                      __FUNCTION__, setup->scene->fence->id);
+   /* This is the oldest scene, always wait for it */
+   lp_setup_retire_scene(setup->scene);
+
+   /* Sum up what the others, oldest first, still hold */
+   for (i = 1; i < setup->num_scenes; i++) {
+      struct lp_scene *scene =
+         setup->scenes[(setup->scene_idx + i) % setup->num_scenes];
+      if (scene->fence && lp_fence_signalled(scene->fence))
+         lp_setup_retire_scene(scene);
+      in_flight += scene->scene_size;
+   }
 
-      lp_fence_wait(setup->scene->fence);
+   for (i = 1; i < setup->num_scenes &&
+               in_flight + LP_SCENE_MAX_SIZE > LP_SCENE_MAX_INFLIGHT_SIZE; i++) {
+      struct lp_scene *scene =
+         setup->scenes[(setup->scene_idx + i) % setup->num_scenes];
+      in_flight -= scene->scene_size;
+      lp_setup_retire_scene(scene);
    }
 
    lp_scene_begin_binning(setup->scene, &setup->fb, setup->rasterizer_discard);
@@ -164,12 +209,13 @@ lp_setup_rasterize_scene( struct lp_setup_context *setup )
    if (setup->last_fence)
       setup->last_fence->issued = TRUE;
 
+   /* Don't wait for the scene here, the rasterizer threads will work on
+    * it while we go on binning the next one.
+    */
    pipe_mutex_lock(screen->rast_mutex);
    lp_rast_queue_scene(screen->rast, scene);
-   lp_rast_finish(screen->rast);
    pipe_mutex_unlock(screen->rast_mutex);
 
-   lp_scene_end_rasterization(setup->scene);
    lp_setup_reset( setup );
 
    LP_DBG(DEBUG_SETUP, "%s done \n", __FUNCTION__);
@@ -284,6 +330,9 @@ set_scene_state( struct lp_setup_context *setup,
          lp_debug_draw_bins_by_cmd_length(setup->scene);
    }
 
+   if (old_state == SETUP_ACTIVE)
+      util_trace_event_end("lp binning");
+
    /* wait for a free/empty scene
     */
    if (old_state == SETUP_FLUSHED) 
@@ -296,6 +345,7 @@ set_scene_state( struct lp_setup_context *setup,
    case SETUP_ACTIVE:
       if (!begin_binning( setup ))
          goto fail;
+      util_trace_event_begin("lp binning");
       break;
 
    case SETUP_FLUSHED:
@@ -534,6 +584,7 @@ lp_setup_set_fs_variant( struct lp_setup_context *setup,
    /* FIXME: reference count */
 
    setup->fs.current.variant = variant;
+   setup->fs.current.shade_cost = variant ? variant->shade_cost : 1;
    setup->dirty |= LP_SETUP_NEW_FS;
 }
 
@@ -890,7 +941,12 @@ lp_setup_is_resource_referenced( const struct lp_setup_context *setup,
    }
 
    /* check textures referenced by the scene */
-   for (i = 0; i < Elements(setup->scenes); i++) {
+   for (i = 0; i < setup->num_scenes; i++) {
+      /* scenes which are done don't need to be flushed or waited for */
+      if (setup->scenes[i]->fence &&
+          lp_fence_signalled(setup->scenes[i]->fence))
+         lp_setup_retire_scene(setup->scenes[i]);
+
       if (lp_scene_is_resource_referenced(setup->scenes[i], texture)) {
          return LP_REFERENCED_FOR_READ;
       }
@@ -1187,15 +1243,18 @@ lp_setup_destroy( struct lp_setup_context *setup )
    }
 
    /* free the scenes in the 'empty' queue */
-   for (i = 0; i < Elements(setup->scenes); i++) {
+   for (i = 0; i < setup->num_scenes; i++) {
       struct lp_scene *scene = setup->scenes[i];
 
-      if (scene->fence)
-         lp_fence_wait(scene->fence);
+      lp_setup_retire_scene(scene);
 
       lp_scene_destroy(scene);
    }
 
+   lp_setup_destroy_workers(setup);
+
+   lp_block_pool_destroy(setup->block_pool);
+
    lp_fence_reference(&setup->last_fence, NULL);
 
    FREE( setup );
@@ -1220,12 +1279,22 @@ lp_setup_create( struct pipe_context *pipe,
       goto no_setup;
    }
 
-   lp_setup_init_vbuf(setup);
-   
    /* Used only in update_state():
     */
    setup->pipe = pipe;
 
+   setup->block_pool =
+      lp_block_pool_create(debug_get_bool_option("LP_HUGE_PAGES", FALSE));
+   if (!setup->block_pool) {
+      goto no_pool;
+   }
+
+   if (!lp_setup_init_workers(setup,
+                              debug_get_num_option("LP_NUM_SETUP_THREADS", 0))) {
+      goto no_workers;
+   }
+
+   lp_setup_init_vbuf(setup);
 
    setup->num_threads = screen->num_threads;
    setup->vbuf = draw_vbuf_stage(draw, &setup->base);
@@ -1237,8 +1306,10 @@ lp_setup_create( struct pipe_context *pipe,
    draw_set_render(draw, &setup->base);
 
    /* create some empty scenes */
-   for (i = 0; i < MAX_SCENES; i++) {
-      setup->scenes[i] = lp_scene_create( pipe );
+   setup->num_scenes = debug_get_num_option("LP_NUM_SCENES", 3);
+   setup->num_scenes = CLAMP(setup->num_scenes, 1, MAX_SCENES);
+   for (i = 0; i < setup->num_scenes; i++) {
+      setup->scenes[i] = lp_scene_create( pipe, setup->block_pool );
       if (!setup->scenes[i]) {
          goto no_scenes;
       }
@@ -1253,7 +1324,7 @@ lp_setup_create( struct pipe_context *pipe,
    return setup;
 
 no_scenes:
-   for (i = 0; i < MAX_SCENES; i++) {
+   for (i = 0; i < setup->num_scenes; i++) {
       if (setup->scenes[i]) {
          lp_scene_destroy(setup->scenes[i]);
       }
@@ -1261,6 +1332,10 @@ no_scenes:
 
    setup->vbuf->destroy(setup->vbuf);
 no_vbuf:
+   lp_setup_destroy_workers(setup);
+no_workers:
+   lp_block_pool_destroy(setup->block_pool);
+no_pool:
    FREE(setup);
 no_setup:
    return NULL;
@@ -1277,9 +1352,7 @@ lp_setup_begin_query(struct lp_setup_context *setup,
 
    set_scene_state(setup, SETUP_ACTIVE, "begin_query");
 
-   if (!(pq->type == PIPE_QUERY_OCCLUSION_COUNTER ||
-         pq->type == PIPE_QUERY_OCCLUSION_PREDICATE ||
-         pq->type == PIPE_QUERY_PIPELINE_STATISTICS))
+   if (!lp_query_is_binned(pq->type))
       return;
 
    /* init the query to its beginning state */
@@ -1327,9 +1400,7 @@ lp_setup_end_query(struct lp_setup_context *setup, struct llvmpipe_query *pq)
        */
       lp_fence_reference(&pq->fence, setup->scene->fence);
 
-      if (pq->type == PIPE_QUERY_OCCLUSION_COUNTER ||
-          pq->type == PIPE_QUERY_OCCLUSION_PREDICATE ||
-          pq->type == PIPE_QUERY_PIPELINE_STATISTICS ||
+      if (lp_query_is_binned(pq->type) ||
           pq->type == PIPE_QUERY_TIMESTAMP) {
          if (pq->type == PIPE_QUERY_TIMESTAMP &&
                !(setup->scene->tiles_x | setup->scene->tiles_y)) {
@@ -1363,9 +1434,7 @@ fail:
    /* Need to do this now not earlier since it still needs to be marked as
     * active when binning it would cause a flush.
     */
-   if (pq->type == PIPE_QUERY_OCCLUSION_COUNTER ||
-      pq->type == PIPE_QUERY_OCCLUSION_PREDICATE ||
-      pq->type == PIPE_QUERY_PIPELINE_STATISTICS) {
+   if (lp_query_is_binned(pq->type)) {
       unsigned i;
 
       /* remove from active binned query list */
@@ -51,10 +51,14 @@
 
 
 struct lp_setup_variant;
+struct lp_setup_worker;
 
 
-/** Max number of scenes */
-#define MAX_SCENES 2
+/** Max number of scenes, see lp_setup_context::num_scenes */
+#define MAX_SCENES 8
+
+/** Max number of setup worker threads, see lp_setup_worker.c */
+#define LP_MAX_SETUP_THREADS 8
 
 
 
@@ -85,9 +89,18 @@ struct lp_setup_context
     */
    struct draw_stage *vbuf;
    unsigned num_threads;
+   unsigned num_scenes;                  /**< scenes in the pipeline */
    unsigned scene_idx;
    struct lp_scene *scenes[MAX_SCENES];  /**< all the scenes */
    struct lp_scene *scene;               /**< current scene being built */
+   struct lp_block_pool *block_pool;     /**< data blocks for the scenes */
+
+   /** Parallel triangle binning, see lp_setup_worker.c.  workers[0] runs
+    * on the application thread, the others each have their own thread.
+    */
+   unsigned num_workers;
+   struct lp_setup_worker *workers[LP_MAX_SETUP_THREADS + 1];
+   boolean is_worker;                    /**< this is a worker's copy */
 
    struct lp_fence *last_fence;
    struct llvmpipe_query *active_queries[LP_MAX_ACTIVE_BINNED_QUERIES];
@@ -178,6 +191,18 @@ void lp_setup_destroy( struct lp_setup_context *setup );
 
 boolean lp_setup_flush_and_restart(struct lp_setup_context *setup);
 
+boolean lp_setup_init_workers(struct lp_setup_context *setup,
+                              unsigned num_threads);
+
+void lp_setup_destroy_workers(struct lp_setup_context *setup);
+
+unsigned
+lp_setup_bin_triangles_parallel(struct lp_setup_context *setup,
+                                const void *vertex_buffer,
+                                const ushort *indices,
+                                unsigned stride,
+                                unsigned nr);
+
 void
 lp_setup_print_triangle(struct lp_setup_context *setup,
                         const float (*v0)[4],
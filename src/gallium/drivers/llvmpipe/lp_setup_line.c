@@ -634,6 +634,7 @@ try_setup_line( struct lp_setup_context *setup,
 
    line->inputs.disable = FALSE;
    line->inputs.opaque = FALSE;
+   line->inputs.linear = FALSE;
    line->inputs.layer = layer;
    line->inputs.viewport_index = viewport_index;
 
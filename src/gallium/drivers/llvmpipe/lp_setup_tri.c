@@ -39,6 +39,7 @@
 #include "lp_state_fs.h"
 #include "lp_state_setup.h"
 #include "lp_context.h"
+#include "lp_linear.h"
 
 #include <inttypes.h>
 
@@ -571,6 +572,20 @@ do_triangle_ccw(struct lp_setup_context *setup,
       plane[6].eo = 0;
    }
 
+   /*
+    * Texture copies and composites of screen aligned rectangles can be
+    * shaded by walking rows, see lp_linear.c.
+    */
+   tri->inputs.linear = FALSE;
+   if (setup->fs.current.variant->linear_op != LP_LINEAR_NONE) {
+      struct u_rect box = bbox;
+      u_rect_find_intersection(&setup->draw_regions[viewport_index], &box);
+      tri->inputs.linear =
+         lp_linear_check_inputs(setup->fs.current.variant,
+                                &setup->fs.current.jit_context.textures[0],
+                                &tri->inputs, &box);
+   }
+
    return lp_setup_bin_triangle(setup, tri, &bbox, nr_planes, viewport_index);
 }
 
@@ -830,6 +845,14 @@ static void retry_triangle_ccw( struct lp_setup_context *setup,
 {
    if (!do_triangle_ccw( setup, position, v0, v1, v2, front ))
    {
+      /* Setup workers can't flush; flag the failure so that the
+       * application thread bins this triangle again.
+       */
+      if (setup->is_worker) {
+         setup->scene->alloc_failed = TRUE;
+         return;
+      }
+
       if (!lp_setup_flush_and_restart(setup))
          return;
 
@@ -46,6 +46,10 @@
 #define LP_MAX_VBUF_INDEXES 1024
 #define LP_MAX_VBUF_SIZE    4096
 
+/** Larger limits for parallel binning, see lp_setup_worker.c */
+#define LP_MAX_VBUF_INDEXES_PARALLEL (16 * 1024)
+#define LP_MAX_VBUF_SIZE_PARALLEL    (512 * 1024)
+
   
 
 /** cast wrapper */
@@ -184,7 +188,9 @@ lp_setup_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
       break;
 
    case PIPE_PRIM_TRIANGLES:
-      for (i = 2; i < nr; i += 3) {
+      i = 2 + lp_setup_bin_triangles_parallel(setup, vertex_buffer, indices,
+                                              stride, nr);
+      for (; i < nr; i += 3) {
          setup->triangle( setup,
                           get_vert(vertex_buffer, indices[i-2], stride),
                           get_vert(vertex_buffer, indices[i-1], stride),
@@ -382,7 +388,9 @@ lp_setup_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
       break;
 
    case PIPE_PRIM_TRIANGLES:
-      for (i = 2; i < nr; i += 3) {
+      i = 2 + lp_setup_bin_triangles_parallel(setup, vertex_buffer, NULL,
+                                              stride, nr);
+      for (; i < nr; i += 3) {
          setup->triangle( setup,
                           get_vert(vertex_buffer, i-2, stride),
                           get_vert(vertex_buffer, i-1, stride),
@@ -585,8 +593,14 @@ lp_setup_pipeline_statistics(
 void
 lp_setup_init_vbuf(struct lp_setup_context *setup)
 {
-   setup->base.max_indices = LP_MAX_VBUF_INDEXES;
-   setup->base.max_vertex_buffer_bytes = LP_MAX_VBUF_SIZE;
+   if (setup->num_workers) {
+      setup->base.max_indices = LP_MAX_VBUF_INDEXES_PARALLEL;
+      setup->base.max_vertex_buffer_bytes = LP_MAX_VBUF_SIZE_PARALLEL;
+   }
+   else {
+      setup->base.max_indices = LP_MAX_VBUF_INDEXES;
+      setup->base.max_vertex_buffer_bytes = LP_MAX_VBUF_SIZE;
+   }
 
    setup->base.get_vertex_info = lp_setup_get_vertex_info;
    setup->base.allocate_vertices = lp_setup_allocate_vertices;
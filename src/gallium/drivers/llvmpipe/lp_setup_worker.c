@@ -0,0 +1,303 @@
+/**************************************************************************
+ *
+ * Copyright 2014 The Mesa Authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * Parallel triangle binning.
+ *
+ * Large triangle lists are split into consecutive ranges which are set up
+ * and binned concurrently by several threads.  Each worker bins into a
+ * private scene of its own, using a copy of the setup context, so the
+ * workers never touch shared state.  Afterwards the private command lists
+ * are appended to the current scene's bins in submission order, which
+ * yields exactly the same commands as binning the whole list on one thread
+ * would, save for some redundant SET_STATE commands.
+ *
+ * The workers can't flush the scene when they run out of memory.  Instead
+ * all the triangles up to the first one that failed are merged and the
+ * remaining ones are left for the caller to bin the usual way.
+ */
+
+#include "util/u_math.h"
+#include "util/u_memory.h"
+#include "os/os_thread.h"
+#include "lp_context.h"
+#include "lp_debug.h"
+#include "lp_scene.h"
+#include "lp_setup_context.h"
+
+
+/** Don't bother distributing fewer triangles per worker than this */
+#define LP_SETUP_MIN_WORKER_TRIANGLES 64
+
+
+struct lp_setup_worker
+{
+   struct lp_setup_context setup;   /**< private copy of the context */
+   struct lp_scene *scene;          /**< private scene to bin into */
+
+   /* The job: triangles [start, end) of a list */
+   const void *vertex_buffer;
+   const ushort *indices;           /**< NULL if not indexed */
+   unsigned stride;
+   unsigned start, end;
+   unsigned failed_at;              /**< first triangle not binned */
+   unsigned fpstate;                /**< of the application thread */
+
+   boolean exit;
+   pipe_thread thread;
+   pipe_semaphore work_ready;
+   pipe_semaphore work_done;
+};
+
+
+typedef const float (*const_float4_ptr)[4];
+
+static INLINE const_float4_ptr
+get_vert(const void *vertex_buffer, int index, int stride)
+{
+   return (const_float4_ptr)((char *)vertex_buffer + index * stride);
+}
+
+
+/**
+ * Bin the worker's range of triangles, stopping at the first one which
+ * couldn't be binned.
+ */
+static void
+bin_triangles(struct lp_setup_worker *worker)
+{
+   struct lp_setup_context *setup = &worker->setup;
+   const void *vertex_buffer = worker->vertex_buffer;
+   const ushort *indices = worker->indices;
+   const unsigned stride = worker->stride;
+   unsigned i;
+
+   worker->failed_at = worker->end;
+
+   for (i = worker->start; i < worker->end; i++) {
+      const unsigned v = i * 3;
+
+      if (indices) {
+         setup->triangle( setup,
+                          get_vert(vertex_buffer, indices[v + 0], stride),
+                          get_vert(vertex_buffer, indices[v + 1], stride),
+                          get_vert(vertex_buffer, indices[v + 2], stride) );
+      }
+      else {
+         setup->triangle( setup,
+                          get_vert(vertex_buffer, v + 0, stride),
+                          get_vert(vertex_buffer, v + 1, stride),
+                          get_vert(vertex_buffer, v + 2, stride) );
+      }
+
+      if (lp_scene_is_oom(worker->scene)) {
+         worker->failed_at = i;
+         break;
+      }
+   }
+}
+
+
+static PIPE_THREAD_ROUTINE( worker_thread, init_data )
+{
+   struct lp_setup_worker *worker = (struct lp_setup_worker *) init_data;
+
+   while (1) {
+      pipe_semaphore_wait(&worker->work_ready);
+
+      if (worker->exit)
+         break;
+
+      /* Setup must round exactly like it does on the application thread */
+      util_fpstate_set(worker->fpstate);
+
+      bin_triangles(worker);
+
+      pipe_semaphore_signal(&worker->work_done);
+   }
+
+   return 0;
+}
+
+
+/**
+ * Bin the triangle list of nr vertices, possibly indexed, on all setup
+ * workers.
+ * \return the number of vertices binned, the caller must bin the rest
+ */
+unsigned
+lp_setup_bin_triangles_parallel(struct lp_setup_context *setup,
+                                const void *vertex_buffer,
+                                const ushort *indices,
+                                unsigned stride,
+                                unsigned nr)
+{
+   struct lp_scene *scene = setup->scene;
+   const unsigned num_tris = nr / 3;
+   unsigned n = setup->num_workers;
+   unsigned fpstate, budget, done, i;
+
+   if (n < 2 || !scene || setup->state != SETUP_ACTIVE)
+      return 0;
+
+   /* The primitive counter isn't per-worker */
+   if (llvmpipe_context(setup->pipe)->active_statistics_queries)
+      return 0;
+
+   n = MIN2(n, num_tris / LP_SETUP_MIN_WORKER_TRIANGLES);
+   if (n < 2)
+      return 0;
+
+   /* Share the remaining scene memory out between the workers */
+   if (scene->scene_size + n * 2 * DATA_BLOCK_SIZE > LP_SCENE_MAX_SIZE)
+      return 0;
+   budget = (LP_SCENE_MAX_SIZE - scene->scene_size) / n;
+
+   for (i = 0; i < n; i++) {
+      if (!lp_scene_begin_private(setup->workers[i]->scene, scene, budget)) {
+         while (i--)
+            lp_scene_discard_private(setup->workers[i]->scene);
+         return 0;
+      }
+   }
+
+   fpstate = util_fpstate_get();
+
+   for (i = 0; i < n; i++) {
+      struct lp_setup_worker *worker = setup->workers[i];
+
+      worker->setup = *setup;
+      worker->setup.scene = worker->scene;
+      worker->setup.is_worker = TRUE;
+
+      worker->vertex_buffer = vertex_buffer;
+      worker->indices = indices;
+      worker->stride = stride;
+      worker->start = num_tris * i / n;
+      worker->end = num_tris * (i + 1) / n;
+      worker->fpstate = fpstate;
+   }
+
+   for (i = 1; i < n; i++) {
+      pipe_semaphore_signal(&setup->workers[i]->work_ready);
+   }
+
+   bin_triangles(setup->workers[0]);
+
+   for (i = 1; i < n; i++) {
+      pipe_semaphore_wait(&setup->workers[i]->work_done);
+   }
+
+   /* Merge in submission order, up to the first triangle which failed */
+   done = num_tris;
+   for (i = 0; i < n; i++) {
+      struct lp_setup_worker *worker = setup->workers[i];
+
+      if (done == num_tris) {
+         lp_scene_append_private(scene, worker->scene);
+         if (worker->failed_at != worker->end) {
+            done = worker->failed_at;
+         }
+      }
+      else {
+         lp_scene_discard_private(worker->scene);
+      }
+   }
+
+   if (done != num_tris)
+      LP_DBG(DEBUG_SETUP, "%s: rebinning from triangle %u of %u\n",
+             __FUNCTION__, done, num_tris);
+
+   return done * 3;
+}
+
+
+/**
+ * Create the setup workers.  The first of them runs on the application
+ * thread, so num_threads - 1 new threads are started.
+ */
+boolean
+lp_setup_init_workers(struct lp_setup_context *setup, unsigned num_threads)
+{
+   unsigned i;
+
+   num_threads = MIN2(num_threads, LP_MAX_SETUP_THREADS);
+   if (num_threads < 2)
+      return TRUE;
+
+   for (i = 0; i < num_threads; i++) {
+      struct lp_setup_worker *worker = CALLOC_STRUCT(lp_setup_worker);
+      if (!worker)
+         goto fail;
+
+      worker->scene = lp_scene_create(setup->pipe, setup->block_pool);
+      if (!worker->scene) {
+         FREE(worker);
+         goto fail;
+      }
+
+      if (i > 0) {
+         pipe_semaphore_init(&worker->work_ready, 0);
+         pipe_semaphore_init(&worker->work_done, 0);
+         worker->thread = pipe_thread_create(worker_thread, worker);
+      }
+
+      setup->workers[i] = worker;
+      setup->num_workers = i + 1;
+   }
+
+   return TRUE;
+
+fail:
+   lp_setup_destroy_workers(setup);
+   return FALSE;
+}
+
+
+void
+lp_setup_destroy_workers(struct lp_setup_context *setup)
+{
+   unsigned i;
+
+   for (i = 0; i < setup->num_workers; i++) {
+      struct lp_setup_worker *worker = setup->workers[i];
+
+      if (i > 0) {
+         worker->exit = TRUE;
+         pipe_semaphore_signal(&worker->work_ready);
+         pipe_thread_wait(worker->thread);
+         pipe_semaphore_destroy(&worker->work_ready);
+         pipe_semaphore_destroy(&worker->work_done);
+      }
+
+      lp_scene_destroy(worker->scene);
+      FREE(worker);
+      setup->workers[i] = NULL;
+   }
+
+   setup->num_workers = 0;
+}
@@ -0,0 +1,833 @@
+/**************************************************************************
+ *
+ * Copyright 2014 The Mesa Authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * Compute shaders.
+ *
+ * A grid is run on the rasterizer threads, which take its blocks one at a
+ * time.  The generated function runs all the threads of a block, one
+ * vector of threads after the other, so a barrier simply ends the loop
+ * over the vectors and starts another one.  Temporaries then live in
+ * memory private to each vector of threads.
+ *
+ * RES[] accesses are bounds checked against the bound surfaces, LOCAL is
+ * private to each block and INPUT is a copy of the launch_grid input.
+ * GLOBAL addresses are made of the number of a buffer bound through
+ * set_global_binding and of the offset within it, see
+ * LP_BLD_GLOBAL_OFFSET_BITS.  PRIVATE is not supported.
+ */
+
+#include "pipe/p_defines.h"
+#include "util/u_inlines.h"
+#include "util/u_memory.h"
+#include "util/u_math.h"
+#include "util/u_atomic.h"
+#include "util/u_format.h"
+#include "util/u_string.h"
+#include "pipe/p_shader_tokens.h"
+#include "tgsi/tgsi_dump.h"
+#include "tgsi/tgsi_scan.h"
+#include "tgsi/tgsi_parse.h"
+#include "gallivm/lp_bld_type.h"
+#include "gallivm/lp_bld_const.h"
+#include "gallivm/lp_bld_init.h"
+#include "gallivm/lp_bld_logic.h"
+#include "gallivm/lp_bld_arit.h"
+#include "gallivm/lp_bld_flow.h"
+#include "gallivm/lp_bld_debug.h"
+#include "gallivm/lp_bld_struct.h"
+#include "gallivm/lp_bld_tgsi.h"
+
+#include "lp_context.h"
+#include "lp_debug.h"
+#include "lp_flush.h"
+#include "lp_jit.h"
+#include "lp_limits.h"
+#include "lp_rast.h"
+#include "lp_screen.h"
+#include "lp_state.h"
+#include "lp_state_cs.h"
+#include "lp_texture.h"
+
+
+/** Compute shader number (for debugging) */
+static unsigned cs_no = 0;
+
+
+/**
+ * State of the code generation, behind the TGSI compute interface.
+ */
+struct lp_cs_build_iface
+{
+   struct lp_build_tgsi_cs_iface base;
+
+   struct lp_compute_shader_variant *variant;
+   struct lp_build_mask_context *mask;
+
+   LLVMValueRef context_ptr;
+   LLVMValueRef block_id[3];
+   LLVMValueRef block_size[3];
+   LLVMValueRef grid_size[3];
+   LLVMValueRef num_threads;
+   LLVMValueRef num_vectors;
+   LLVMValueRef local_ptr;
+   LLVMValueRef temps_ptr;
+
+   /** Loop over the vectors of threads of the block */
+   struct lp_build_loop_state loop;
+};
+
+
+static INLINE struct lp_cs_build_iface *
+lp_cs_build_iface(const struct lp_build_tgsi_cs_iface *iface)
+{
+   return (struct lp_cs_build_iface *)iface;
+}
+
+
+/**
+ * Return the linear index of each thread of the current vector.
+ */
+static LLVMValueRef
+thread_index_vec(struct lp_cs_build_iface *cs,
+                 struct lp_build_context *uint_bld)
+{
+   struct gallivm_state *gallivm = uint_bld->gallivm;
+   LLVMValueRef lanes[LP_MAX_VECTOR_LENGTH];
+   LLVMValueRef first;
+   unsigned i;
+
+   for (i = 0; i < uint_bld->type.length; i++) {
+      lanes[i] = lp_build_const_int32(gallivm, i);
+   }
+
+   first = LLVMBuildMul(gallivm->builder, cs->loop.counter,
+                        lp_build_const_int32(gallivm, uint_bld->type.length),
+                        "");
+
+   return lp_build_add(uint_bld,
+                       lp_build_broadcast_scalar(uint_bld, first),
+                       LLVMConstVector(lanes, uint_bld->type.length));
+}
+
+
+/**
+ * Start on a new vector of threads: enable the lanes of threads which
+ * exist in the block.
+ */
+static void
+thread_vector_begin(struct lp_cs_build_iface *cs,
+                    struct lp_build_context *uint_bld)
+{
+   LLVMValueRef active;
+
+   active = lp_build_cmp(uint_bld, PIPE_FUNC_LESS,
+                         thread_index_vec(cs, uint_bld),
+                         lp_build_broadcast_scalar(uint_bld, cs->num_threads));
+
+   LLVMBuildStore(uint_bld->gallivm->builder, active, cs->mask->var);
+}
+
+
+static LLVMValueRef
+cs_fetch_system_value(const struct lp_build_tgsi_cs_iface *iface,
+                      struct lp_build_tgsi_context *bld_base,
+                      unsigned semantic,
+                      unsigned chan)
+{
+   struct lp_cs_build_iface *cs = lp_cs_build_iface(iface);
+   struct lp_build_context *uint_bld = &bld_base->uint_bld;
+   LLVMValueRef index, res;
+   unsigned i;
+
+   if (chan > 2) {
+      /* grids and blocks are 3 dimensional */
+      return semantic == TGSI_SEMANTIC_GRID_SIZE ||
+             semantic == TGSI_SEMANTIC_BLOCK_SIZE ? uint_bld->one
+                                                  : uint_bld->zero;
+   }
+
+   switch (semantic) {
+   case TGSI_SEMANTIC_GRID_SIZE:
+      return lp_build_broadcast_scalar(uint_bld, cs->grid_size[chan]);
+
+   case TGSI_SEMANTIC_BLOCK_ID:
+      return lp_build_broadcast_scalar(uint_bld, cs->block_id[chan]);
+
+   case TGSI_SEMANTIC_BLOCK_SIZE:
+      return lp_build_broadcast_scalar(uint_bld, cs->block_size[chan]);
+
+   case TGSI_SEMANTIC_THREAD_ID:
+      /* x varies fastest */
+      index = thread_index_vec(cs, uint_bld);
+      for (i = 0; i < chan; i++) {
+         index = lp_build_div(uint_bld, index,
+                              lp_build_broadcast_scalar(uint_bld,
+                                                        cs->block_size[i]));
+      }
+      res = index;
+      if (chan < 2) {
+         LLVMValueRef size = lp_build_broadcast_scalar(uint_bld,
+                                                       cs->block_size[chan]);
+         res = lp_build_sub(uint_bld, index,
+                            lp_build_mul(uint_bld,
+                                         lp_build_div(uint_bld, index, size),
+                                         size));
+      }
+      return res;
+
+   default:
+      assert(0);
+      return uint_bld->zero;
+   }
+}
+
+
+static void
+cs_get_resource(const struct lp_build_tgsi_cs_iface *iface,
+                struct lp_build_tgsi_context *bld_base,
+                unsigned index,
+                LLVMValueRef *base,
+                LLVMValueRef *stride,
+                LLVMValueRef *size)
+{
+   struct lp_cs_build_iface *cs = lp_cs_build_iface(iface);
+   struct gallivm_state *gallivm = bld_base->base.gallivm;
+   LLVMTypeRef i8_ptr_type =
+      LLVMPointerType(LLVMInt8TypeInContext(gallivm->context), 0);
+
+   *stride = lp_build_const_int32(gallivm, 0);
+
+   if (index < PIPE_MAX_SHADER_RESOURCES) {
+      LLVMValueRef res_ptr =
+         lp_build_array_get_ptr(gallivm,
+                                lp_jit_cs_context_resources(gallivm,
+                                                            cs->context_ptr),
+                                lp_build_const_int32(gallivm, index));
+
+      *base = lp_build_struct_get(gallivm, res_ptr,
+                                  LP_JIT_CS_RESOURCE_BASE, "base");
+      *stride = lp_build_struct_get(gallivm, res_ptr,
+                                    LP_JIT_CS_RESOURCE_STRIDE, "stride");
+      *size = lp_build_struct_get(gallivm, res_ptr,
+                                  LP_JIT_CS_RESOURCE_SIZE, "size");
+   }
+   else if (index == TGSI_RESOURCE_LOCAL) {
+      *base = cs->local_ptr;
+      *size = lp_jit_cs_context_local_size(gallivm, cs->context_ptr);
+   }
+   else if (index == TGSI_RESOURCE_INPUT) {
+      *base = lp_jit_cs_context_input(gallivm, cs->context_ptr);
+      *size = lp_jit_cs_context_input_size(gallivm, cs->context_ptr);
+   }
+   else {
+      /* PRIVATE: reads return zero, writes are dropped */
+      *base = LLVMConstNull(i8_ptr_type);
+      *size = lp_build_const_int32(gallivm, 0);
+   }
+}
+
+
+static void
+cs_get_global_buffer(const struct lp_build_tgsi_cs_iface *iface,
+                     struct lp_build_tgsi_context *bld_base,
+                     LLVMValueRef buffer,
+                     LLVMValueRef *base,
+                     LLVMValueRef *size)
+{
+   struct lp_cs_build_iface *cs = lp_cs_build_iface(iface);
+   struct gallivm_state *gallivm = bld_base->base.gallivm;
+   LLVMBuilderRef builder = gallivm->builder;
+   LLVMValueRef in_range, res_ptr;
+
+   /* Addresses past the last buffer access nothing */
+   in_range = LLVMBuildICmp(builder, LLVMIntULT, buffer,
+                            lp_build_const_int32(gallivm,
+                                                 LP_MAX_CS_GLOBAL_BUFFERS), "");
+   buffer = LLVMBuildSelect(builder, in_range, buffer,
+                            lp_build_const_int32(gallivm, 0), "");
+
+   res_ptr = lp_build_array_get_ptr(gallivm,
+                                    lp_jit_cs_context_globals(gallivm,
+                                                              cs->context_ptr),
+                                    buffer);
+
+   *base = lp_build_struct_get(gallivm, res_ptr,
+                               LP_JIT_CS_RESOURCE_BASE, "base");
+   *size = lp_build_struct_get(gallivm, res_ptr,
+                               LP_JIT_CS_RESOURCE_SIZE, "size");
+   *size = LLVMBuildSelect(builder, in_range, *size,
+                           lp_build_const_int32(gallivm, 0), "");
+}
+
+
+static LLVMValueRef
+cs_get_temps_array(const struct lp_build_tgsi_cs_iface *iface,
+                   struct lp_build_tgsi_context *bld_base,
+                   unsigned num_vectors)
+{
+   struct lp_cs_build_iface *cs = lp_cs_build_iface(iface);
+   struct gallivm_state *gallivm = bld_base->base.gallivm;
+   LLVMValueRef offset;
+
+   cs->variant->num_temps = num_vectors;
+
+   offset = LLVMBuildMul(gallivm->builder, cs->loop.counter,
+                         lp_build_const_int32(gallivm, num_vectors), "");
+
+   return LLVMBuildGEP(gallivm->builder, cs->temps_ptr, &offset, 1,
+                       "temp_array");
+}
+
+
+static void
+cs_barrier(const struct lp_build_tgsi_cs_iface *iface,
+           struct lp_build_tgsi_context *bld_base)
+{
+   struct lp_cs_build_iface *cs = lp_cs_build_iface(iface);
+   struct gallivm_state *gallivm = bld_base->base.gallivm;
+
+   /*
+    * All the threads of the block have got here once the loop is done,
+    * so just start over for the rest of the shader.
+    */
+   lp_build_loop_end_cond(&cs->loop, cs->num_vectors, NULL, LLVMIntUGE);
+
+   lp_build_loop_begin(&cs->loop, gallivm, lp_build_const_int32(gallivm, 0));
+
+   thread_vector_begin(cs, &bld_base->uint_bld);
+}
+
+
+static void
+generate_compute(struct lp_compute_shader *shader,
+                 struct lp_compute_shader_variant *variant)
+{
+   struct gallivm_state *gallivm = variant->gallivm;
+   LLVMContextRef lc = gallivm->context;
+   LLVMBuilderRef builder = gallivm->builder;
+   const struct tgsi_token *tokens = shader->base.prog;
+   struct lp_cs_build_iface cs;
+   struct lp_build_mask_context mask;
+   struct lp_bld_tgsi_system_values system_values;
+   LLVMValueRef outputs[PIPE_MAX_SHADER_OUTPUTS][TGSI_NUM_CHANNELS];
+   struct lp_build_context uint_bld;
+   struct lp_type cs_type;
+   char func_name[64];
+   LLVMTypeRef arg_types[6];
+   LLVMTypeRef func_type;
+   LLVMTypeRef int32_type = LLVMInt32TypeInContext(lc);
+   LLVMValueRef function;
+   LLVMValueRef consts_ptr, num_consts_ptr;
+   LLVMValueRef block_size_ptr, grid_size_ptr;
+   LLVMBasicBlockRef block;
+   unsigned i;
+
+   memset(&cs_type, 0, sizeof cs_type);
+   cs_type.floating = TRUE;      /* floating point values */
+   cs_type.sign = TRUE;          /* values are signed */
+   cs_type.norm = FALSE;         /* values are not limited to [0,1] or [-1,1] */
+   cs_type.width = 32;           /* 32-bit float */
+   cs_type.length = MIN2(lp_native_vector_width / 32, 16); /* n*4 elements per vector */
+
+   variant->vector_length = cs_type.length;
+
+   util_snprintf(func_name, sizeof(func_name), "cs%u_variant%u",
+                 shader->no, variant->no);
+
+   /*
+    * Generate the function prototype. Any change here must be reflected in
+    * lp_jit.h's lp_jit_cs_func function pointer type, and vice-versa.
+    */
+   arg_types[0] = variant->jit_context_ptr_type;            /* context */
+   arg_types[1] = int32_type;                               /* block_x */
+   arg_types[2] = int32_type;                               /* block_y */
+   arg_types[3] = int32_type;                               /* block_z */
+   arg_types[4] = LLVMPointerType(LLVMInt8TypeInContext(lc), 0); /* local */
+   arg_types[5] = LLVMPointerType(lp_build_vec_type(gallivm, cs_type), 0); /* temps */
+
+   func_type = LLVMFunctionType(LLVMVoidTypeInContext(lc),
+                                arg_types, Elements(arg_types), 0);
+
+   function = LLVMAddFunction(gallivm->module, func_name, func_type);
+   LLVMSetFunctionCallConv(function, LLVMCCallConv);
+
+   variant->function = function;
+
+   memset(&cs, 0, sizeof cs);
+   cs.base.start_pc = variant->pc;
+   cs.base.fetch_system_value = cs_fetch_system_value;
+   cs.base.get_resource = cs_get_resource;
+   cs.base.get_global_buffer = cs_get_global_buffer;
+   cs.base.get_temps_array = cs_get_temps_array;
+   cs.base.barrier = cs_barrier;
+   cs.variant = variant;
+   cs.mask = &mask;
+
+   cs.context_ptr = LLVMGetParam(function, 0);
+   cs.local_ptr   = LLVMGetParam(function, 4);
+   cs.temps_ptr   = LLVMGetParam(function, 5);
+   for (i = 0; i < 3; i++) {
+      cs.block_id[i] = LLVMGetParam(function, 1 + i);
+   }
+
+   lp_build_name(cs.context_ptr, "context");
+   lp_build_name(cs.block_id[0], "block_x");
+   lp_build_name(cs.block_id[1], "block_y");
+   lp_build_name(cs.block_id[2], "block_z");
+   lp_build_name(cs.local_ptr, "local");
+   lp_build_name(cs.temps_ptr, "temps");
+
+   /*
+    * Function body
+    */
+
+   block = LLVMAppendBasicBlockInContext(lc, function, "entry");
+   LLVMPositionBuilderAtEnd(builder, block);
+
+   lp_build_context_init(&uint_bld, gallivm, lp_uint_type(cs_type));
+
+   consts_ptr = lp_jit_cs_context_constants(gallivm, cs.context_ptr);
+   num_consts_ptr = lp_jit_cs_context_num_constants(gallivm, cs.context_ptr);
+
+   block_size_ptr = lp_jit_cs_context_block_size(gallivm, cs.context_ptr);
+   grid_size_ptr = lp_jit_cs_context_grid_size(gallivm, cs.context_ptr);
+   for (i = 0; i < 3; i++) {
+      LLVMValueRef index = lp_build_const_int32(gallivm, i);
+      cs.block_size[i] = lp_build_array_get(gallivm, block_size_ptr, index);
+      cs.grid_size[i] = lp_build_array_get(gallivm, grid_size_ptr, index);
+   }
+
+   cs.num_threads = LLVMBuildMul(builder, cs.block_size[0],
+                                 cs.block_size[1], "");
+   cs.num_threads = LLVMBuildMul(builder, cs.num_threads,
+                                 cs.block_size[2], "num_threads");
+   cs.num_vectors = LLVMBuildAdd(builder, cs.num_threads,
+                                 lp_build_const_int32(gallivm,
+                                                      cs_type.length - 1), "");
+   cs.num_vectors = LLVMBuildUDiv(builder, cs.num_vectors,
+                                  lp_build_const_int32(gallivm,
+                                                       cs_type.length),
+                                  "num_vectors");
+
+   lp_build_mask_begin(&mask, gallivm, cs_type,
+                       lp_build_const_int_vec(gallivm, cs_type, ~0));
+
+   lp_build_loop_begin(&cs.loop, gallivm, lp_build_const_int32(gallivm, 0));
+
+   thread_vector_begin(&cs, &uint_bld);
+
+   memset(&system_values, 0, sizeof system_values);
+   memset(outputs, 0, sizeof outputs);
+
+   lp_build_tgsi_soa(gallivm, tokens, cs_type, &mask,
+                     consts_ptr, num_consts_ptr, &system_values,
+                     NULL, outputs, NULL, &shader->info, NULL, &cs.base);
+
+   lp_build_loop_end_cond(&cs.loop, cs.num_vectors, NULL, LLVMIntUGE);
+
+   lp_build_mask_end(&mask);
+
+   LLVMBuildRetVoid(builder);
+
+   gallivm_verify_function(gallivm, function);
+}
+
+
+static struct lp_compute_shader_variant *
+generate_variant(struct lp_compute_shader *shader, unsigned pc)
+{
+   struct lp_compute_shader_variant *variant;
+
+   variant = CALLOC_STRUCT(lp_compute_shader_variant);
+   if (!variant)
+      return NULL;
+
+   variant->pc = pc;
+   variant->no = shader->variants_created++;
+
+   variant->gallivm = gallivm_create();
+   if (!variant->gallivm) {
+      FREE(variant);
+      return NULL;
+   }
+
+   lp_jit_init_cs_types(variant);
+
+   generate_compute(shader, variant);
+
+   gallivm_compile_module(variant->gallivm);
+
+   variant->jit_function = (lp_jit_cs_func)
+         gallivm_jit_function(variant->gallivm, variant->function);
+
+   return variant;
+}
+
+
+static void
+destroy_variant(struct lp_compute_shader_variant *variant)
+{
+   if (variant->function) {
+      gallivm_free_function(variant->gallivm,
+                            variant->function,
+                            variant->jit_function);
+   }
+
+   gallivm_destroy(variant->gallivm);
+
+   FREE(variant);
+}
+
+
+/**
+ * Return the variant of the shader starting at pc, creating it if needed.
+ */
+static struct lp_compute_shader_variant *
+get_variant(struct lp_compute_shader *shader, unsigned pc)
+{
+   struct lp_compute_shader_variant *variant;
+
+   for (variant = shader->variants; variant; variant = variant->next) {
+      if (variant->pc == pc)
+         return variant;
+   }
+
+   variant = generate_variant(shader, pc);
+   if (variant) {
+      variant->next = shader->variants;
+      shader->variants = variant;
+   }
+
+   return variant;
+}
+
+
+/**
+ * A grid being run by the rasterizer threads.
+ */
+struct lp_cs_job
+{
+   lp_jit_cs_func func;
+   struct lp_jit_cs_context context;
+
+   unsigned num_blocks;
+   int32_t next_block;
+
+   /** LOCAL, then temporaries, for every thread */
+   uint8_t *memory;
+   unsigned memory_stride;
+   unsigned temps_offset;
+};
+
+
+static void
+cs_job_run(void *data, unsigned thread_index)
+{
+   struct lp_cs_job *job = (struct lp_cs_job *)data;
+   const uint32_t *grid_size = job->context.grid_size;
+   uint8_t *local = job->memory + thread_index * job->memory_stride;
+   void *temps = local + job->temps_offset;
+   int32_t block;
+
+   while ((block = p_atomic_inc_return(&job->next_block) - 1) <
+          (int32_t)job->num_blocks) {
+      unsigned x = block % grid_size[0];
+      unsigned y = (block / grid_size[0]) % grid_size[1];
+      unsigned z = block / (grid_size[0] * grid_size[1]);
+
+      job->func(&job->context, x, y, z, local, temps);
+   }
+}
+
+
+/**
+ * Fill in the jit description of a bound compute resource, and map it.
+ */
+static void
+map_resource(struct pipe_surface *surf, struct lp_jit_cs_resource *jit_res)
+{
+   struct pipe_resource *res = surf->texture;
+   const unsigned blocksize = util_format_get_blocksize(surf->format);
+
+   if (llvmpipe_resource_is_texture(res)) {
+      const unsigned level = surf->u.tex.level;
+
+      jit_res->base = llvmpipe_resource_map(res, level,
+                                            surf->u.tex.first_layer,
+                                            LP_TEX_USAGE_READ_WRITE);
+      jit_res->stride = llvmpipe_resource_stride(res, level);
+      jit_res->size = jit_res->stride *
+                      util_format_get_nblocksy(res->format,
+                                               u_minify(res->height0, level));
+   }
+   else {
+      const unsigned offset = surf->u.buf.first_element * blocksize;
+      const unsigned size = (surf->u.buf.last_element -
+                             surf->u.buf.first_element + 1) * blocksize;
+
+      jit_res->base = (uint8_t *)llvmpipe_resource_data(res) + offset;
+      jit_res->stride = 0;
+      jit_res->size = MIN2(size, res->width0 - offset);
+   }
+
+   if (!jit_res->base)
+      jit_res->size = 0;
+}
+
+
+static void
+unmap_resource(struct pipe_surface *surf)
+{
+   if (llvmpipe_resource_is_texture(surf->texture)) {
+      llvmpipe_resource_unmap(surf->texture, surf->u.tex.level,
+                              surf->u.tex.first_layer);
+   }
+}
+
+
+static void
+llvmpipe_launch_grid(struct pipe_context *pipe,
+                     const uint *block_layout, const uint *grid_layout,
+                     uint32_t pc, const void *input)
+{
+   struct llvmpipe_context *llvmpipe = llvmpipe_context(pipe);
+   struct llvmpipe_screen *screen = llvmpipe_screen(pipe->screen);
+   struct lp_compute_shader *shader = llvmpipe->cs;
+   struct lp_compute_shader_variant *variant;
+   struct lp_cs_job *job;
+   const unsigned num_threads = MAX2(1, screen->num_threads);
+   unsigned block_threads, num_vectors, local_size, temps_size;
+   unsigned i;
+
+   if (!shader)
+      return;
+
+   block_threads = block_layout[0] * block_layout[1] * block_layout[2];
+   if (!block_threads || block_threads > LP_MAX_CS_THREADS_PER_BLOCK ||
+       !grid_layout[0] || !grid_layout[1] || !grid_layout[2])
+      return;
+
+   variant = get_variant(shader, pc);
+   if (!variant)
+      return;
+
+   job = CALLOC_STRUCT(lp_cs_job);
+   if (!job)
+      return;
+
+   num_vectors = (block_threads + variant->vector_length - 1) /
+                 variant->vector_length;
+   local_size = align(shader->base.req_local_mem, 64);
+   temps_size = num_vectors * variant->num_temps *
+                variant->vector_length * sizeof(float);
+
+   job->func = variant->jit_function;
+   job->num_blocks = grid_layout[0] * grid_layout[1] * grid_layout[2];
+   job->temps_offset = local_size;
+   job->memory_stride = align(local_size + temps_size, 64);
+   if (job->memory_stride) {
+      job->memory = align_malloc(num_threads * job->memory_stride, 64);
+      if (!job->memory) {
+         FREE(job);
+         return;
+      }
+   }
+
+   /* The kernel may use what was rendered, and vice versa */
+   llvmpipe_finish(pipe, __FUNCTION__);
+
+   for (i = 0; i < LP_MAX_TGSI_CONST_BUFFERS; i++) {
+      const struct pipe_constant_buffer *cb =
+         &llvmpipe->constants[PIPE_SHADER_COMPUTE][i];
+      const ubyte *data = NULL;
+
+      if (cb->buffer)
+         data = (const ubyte *)llvmpipe_resource_data(cb->buffer);
+      else if (cb->user_buffer)
+         data = (const ubyte *)cb->user_buffer;
+
+      if (data) {
+         job->context.constants[i] = (const float *)(data + cb->buffer_offset);
+         job->context.num_constants[i] = cb->buffer_size / (sizeof(float) * 4);
+      }
+   }
+
+   for (i = 0; i < PIPE_MAX_SHADER_RESOURCES; i++) {
+      if (llvmpipe->cs_resources[i])
+         map_resource(llvmpipe->cs_resources[i], &job->context.resources[i]);
+   }
+
+   for (i = 0; i < LP_MAX_CS_GLOBAL_BUFFERS; i++) {
+      struct pipe_resource *res = llvmpipe->cs_globals[i];
+
+      if (res) {
+         job->context.globals[i].base = llvmpipe_resource_data(res);
+         job->context.globals[i].size =
+            MIN2(res->width0, LP_MAX_CS_GLOBAL_BUFFER_SIZE);
+      }
+   }
+
+   job->context.input = input;
+   job->context.input_size = input ? shader->base.req_input_mem : 0;
+   job->context.local_size = shader->base.req_local_mem;
+
+   for (i = 0; i < 3; i++) {
+      job->context.grid_size[i] = grid_layout[i];
+      job->context.block_size[i] = block_layout[i];
+   }
+
+   pipe_mutex_lock(screen->rast_mutex);
+   lp_rast_run_job(screen->rast, cs_job_run, job);
+   pipe_mutex_unlock(screen->rast_mutex);
+
+   for (i = 0; i < PIPE_MAX_SHADER_RESOURCES; i++) {
+      if (llvmpipe->cs_resources[i])
+         unmap_resource(llvmpipe->cs_resources[i]);
+   }
+
+   align_free(job->memory);
+   FREE(job);
+}
+
+
+static void *
+llvmpipe_create_compute_state(struct pipe_context *pipe,
+                              const struct pipe_compute_state *templ)
+{
+   struct lp_compute_shader *shader;
+
+   if (templ->req_local_mem > LP_MAX_CS_LOCAL_SIZE ||
+       templ->req_input_mem > LP_MAX_CS_INPUT_SIZE)
+      return NULL;
+
+   shader = CALLOC_STRUCT(lp_compute_shader);
+   if (!shader)
+      return NULL;
+
+   shader->no = cs_no++;
+
+   if (LP_DEBUG & DEBUG_TGSI) {
+      debug_printf("llvmpipe: Create compute shader %p:\n", (void *)shader);
+      tgsi_dump(templ->prog, 0);
+   }
+
+   /* get/save the summary info for this shader */
+   tgsi_scan_shader(templ->prog, &shader->info);
+
+   /* we need to keep a local copy of the tokens */
+   shader->base = *templ;
+   shader->base.prog = tgsi_dup_tokens(templ->prog);
+   if (!shader->base.prog) {
+      FREE(shader);
+      return NULL;
+   }
+
+   return shader;
+}
+
+
+static void
+llvmpipe_bind_compute_state(struct pipe_context *pipe, void *cs)
+{
+   struct llvmpipe_context *llvmpipe = llvmpipe_context(pipe);
+
+   llvmpipe->cs = (struct lp_compute_shader *)cs;
+}
+
+
+static void
+llvmpipe_delete_compute_state(struct pipe_context *pipe, void *cs)
+{
+   struct lp_compute_shader *shader = (struct lp_compute_shader *)cs;
+   struct lp_compute_shader_variant *variant, *next;
+
+   /* grids are run synchronously, so nothing can be using the variants */
+   for (variant = shader->variants; variant; variant = next) {
+      next = variant->next;
+      destroy_variant(variant);
+   }
+
+   FREE((void *)shader->base.prog);
+   FREE(shader);
+}
+
+
+static void
+llvmpipe_set_compute_resources(struct pipe_context *pipe,
+                               unsigned start, unsigned count,
+                               struct pipe_surface **resources)
+{
+   struct llvmpipe_context *llvmpipe = llvmpipe_context(pipe);
+   unsigned i;
+
+   assert(start + count <= Elements(llvmpipe->cs_resources));
+
+   for (i = 0; i < count; i++) {
+      pipe_surface_reference(&llvmpipe->cs_resources[start + i],
+                             resources ? resources[i] : NULL);
+   }
+}
+
+
+/**
+ * Buffer first + i is number first + i of the GLOBAL memory space, so its
+ * handle is just that number in the upper bits of the address.
+ */
+static void
+llvmpipe_set_global_binding(struct pipe_context *pipe,
+                            unsigned first, unsigned count,
+                            struct pipe_resource **resources,
+                            uint32_t **handles)
+{
+   struct llvmpipe_context *llvmpipe = llvmpipe_context(pipe);
+   unsigned i;
+
+   for (i = 0; i < count; i++) {
+      /* Buffers past the limit get handles which access nothing */
+      unsigned n = MIN2(first + i, LP_MAX_CS_GLOBAL_BUFFERS);
+
+      if (n < LP_MAX_CS_GLOBAL_BUFFERS)
+         pipe_resource_reference(&llvmpipe->cs_globals[n],
+                                 resources ? resources[i] : NULL);
+
+      if (resources && handles)
+         *handles[i] = n << LP_BLD_GLOBAL_OFFSET_BITS;
+   }
+}
+
+
+void
+llvmpipe_init_compute_funcs(struct llvmpipe_context *llvmpipe)
+{
+   llvmpipe->pipe.create_compute_state = llvmpipe_create_compute_state;
+   llvmpipe->pipe.bind_compute_state = llvmpipe_bind_compute_state;
+   llvmpipe->pipe.delete_compute_state = llvmpipe_delete_compute_state;
+   llvmpipe->pipe.set_compute_resources = llvmpipe_set_compute_resources;
+   llvmpipe->pipe.set_global_binding = llvmpipe_set_global_binding;
+   llvmpipe->pipe.launch_grid = llvmpipe_launch_grid;
+}
@@ -67,6 +67,8 @@
 #include "util/u_string.h"
 #include "util/u_simple_list.h"
 #include "util/u_dual_blend.h"
+#include "util/u_hash.h"
+#include "util/u_trace_events.h"
 #include "os/os_time.h"
 #include "pipe/p_shader_tokens.h"
 #include "draw/draw_context.h"
@@ -98,9 +100,12 @@
 #include "lp_setup.h"
 #include "lp_state.h"
 #include "lp_tex_sample.h"
+#include "lp_fence.h"
 #include "lp_flush.h"
+#include "lp_linear.h"
 #include "lp_state_fs.h"
 #include "lp_rast.h"
+#include "lp_screen.h"
 
 
 /** Fragment shader number (for debugging) */
@@ -417,7 +422,7 @@ generate_fs_loop(struct gallivm_state *gallivm,
    lp_build_tgsi_soa(gallivm, tokens, type, &mask,
                      consts_ptr, num_consts_ptr, &system_values,
                      interp->inputs,
-                     outputs, sampler, &shader->info.base, NULL);
+                     outputs, sampler, &shader->info.base, NULL, NULL);
 
    /* Alpha test */
    if (key->alpha.enabled) {
@@ -2121,8 +2126,7 @@ generate_unswizzled_blend(struct gallivm_state *gallivm,
  * 2x2 pixels.
  */
 static void
-generate_fragment(struct llvmpipe_context *lp,
-                  struct lp_fragment_shader *shader,
+generate_fragment(struct lp_fragment_shader *shader,
                   struct lp_fragment_shader_variant *variant,
                   unsigned partial_mask)
 {
@@ -2216,8 +2220,15 @@ generate_fragment(struct llvmpipe_context *lp,
 
    blend_vec_type = lp_build_vec_type(gallivm, blend_type);
 
-   util_snprintf(func_name, sizeof(func_name), "fs%u_variant%u_%s", 
-		 shader->no, variant->no, partial_mask ? "partial" : "whole");
+   /* Cached machine code is looked up by function name */
+   if (gallivm->object_cache) {
+      util_snprintf(func_name, sizeof(func_name), "fs_variant_%s",
+                    partial_mask ? "partial" : "whole");
+   }
+   else {
+      util_snprintf(func_name, sizeof(func_name), "fs%u_variant%u_%s",
+                    shader->no, variant->no, partial_mask ? "partial" : "whole");
+   }
 
    arg_types[0] = variant->jit_context_ptr_type;       /* context */
    arg_types[1] = int32_type;                          /* x */
@@ -2511,10 +2522,249 @@ lp_debug_fs_variant(const struct lp_fragment_shader_variant *variant)
    tgsi_dump(variant->shader->base.tokens, 0);
    dump_fs_variant_key(&variant->key);
    debug_printf("variant->opaque = %u\n", variant->opaque);
+   debug_printf("variant->shade_cost = %u\n", variant->shade_cost);
+   debug_printf("variant->hiz_cull = %u\n", variant->hiz_cull);
+   debug_printf("variant->hiz_update = %u\n", variant->hiz_update);
+   debug_printf("variant->hiz_invalidate = %u\n", variant->hiz_invalidate);
+   debug_printf("variant->linear_op = %u\n", variant->linear_op);
    debug_printf("\n");
 }
 
 
+/**
+ * Attach the screen's disk cache to the variant's gallivm state.  The key
+ * is made out of the variant key and the shader tokens, plus a build
+ * stamp, since the generated code changes with the driver itself.
+ */
+static void
+set_variant_cache_key(struct util_disk_cache *cache,
+                      struct lp_fragment_shader_variant *variant)
+{
+   static const char build_id[] =
+#ifdef PACKAGE_VERSION
+      PACKAGE_VERSION " "
+#endif
+      __DATE__ " " __TIME__;
+   const struct lp_fragment_shader *shader = variant->shader;
+   unsigned tokens_size;
+   unsigned key_size;
+   uint8_t *key;
+   uint8_t *p;
+
+   if (!cache)
+      return;
+
+   tokens_size = tgsi_num_tokens(shader->base.tokens) * sizeof(struct tgsi_token);
+   key_size = sizeof build_id + shader->variant_key_size + tokens_size;
+
+   key = MALLOC(key_size);
+   if (!key)
+      return;
+
+   p = key;
+   memcpy(p, build_id, sizeof build_id);
+   p += sizeof build_id;
+   memcpy(p, &variant->key, shader->variant_key_size);
+   p += shader->variant_key_size;
+   memcpy(p, shader->base.tokens, tokens_size);
+
+   gallivm_set_cache_key(variant->gallivm, cache, key, key_size);
+
+   FREE(key);
+}
+
+
+/**
+ * Generate and compile the code of a variant.  If context is not NULL, the
+ * code is generated into that LLVM context instead of the global one.
+ */
+static boolean
+compile_variant(struct lp_fragment_shader_variant *variant,
+                struct util_disk_cache *cache,
+                LLVMContextRef context)
+{
+   struct lp_fragment_shader *shader = variant->shader;
+
+   variant->gallivm = context ? gallivm_create_in_context(context)
+                              : gallivm_create();
+   if (!variant->gallivm)
+      return FALSE;
+
+   set_variant_cache_key(cache, variant);
+
+   lp_jit_init_types(variant);
+   
+   if (variant->jit_function[RAST_EDGE_TEST] == NULL)
+      generate_fragment(shader, variant, RAST_EDGE_TEST);
+
+   if (variant->jit_function[RAST_WHOLE] == NULL) {
+      if (variant->opaque) {
+         /* Specialized shader, which doesn't need to read the color buffer. */
+         generate_fragment(shader, variant, RAST_WHOLE);
+      }
+   }
+
+   /*
+    * Compile everything
+    */
+
+   gallivm_compile_module(variant->gallivm);
+
+   if (variant->function[RAST_EDGE_TEST]) {
+      variant->jit_function[RAST_EDGE_TEST] = (lp_jit_frag_func)
+            gallivm_jit_function(variant->gallivm,
+                                 variant->function[RAST_EDGE_TEST]);
+   }
+
+   if (variant->function[RAST_WHOLE]) {
+      variant->jit_function[RAST_WHOLE] = (lp_jit_frag_func)
+            gallivm_jit_function(variant->gallivm,
+                                 variant->function[RAST_WHOLE]);
+   } else if (!variant->jit_function[RAST_WHOLE]) {
+      variant->jit_function[RAST_WHOLE] = variant->jit_function[RAST_EDGE_TEST];
+   }
+
+   return TRUE;
+}
+
+
+/**
+ * Make the key identifying the code of a variant: the variant key followed
+ * by the shader tokens.
+ */
+static uint8_t *
+make_code_key(const struct lp_fragment_shader *shader,
+              const struct lp_fragment_shader_variant_key *key,
+              unsigned *size)
+{
+   unsigned tokens_size;
+   uint8_t *code_key;
+
+   tokens_size = tgsi_num_tokens(shader->base.tokens) * sizeof(struct tgsi_token);
+   *size = shader->variant_key_size + tokens_size;
+
+   code_key = MALLOC(*size);
+   if (code_key) {
+      memcpy(code_key, key, shader->variant_key_size);
+      memcpy(code_key + shader->variant_key_size, shader->base.tokens,
+             tokens_size);
+   }
+   return code_key;
+}
+
+
+/**
+ * Look for code compiled for the same shader tokens and key, possibly by
+ * another context, and take a reference to it.
+ */
+static struct lp_fs_code *
+find_code(struct llvmpipe_screen *screen,
+          const uint8_t *key, unsigned key_size)
+{
+   unsigned hash = util_hash_crc32(key, key_size);
+   struct lp_fs_code *code;
+
+   pipe_mutex_lock(screen->code_mutex);
+   for (code = screen->code; code; code = code->next) {
+      if (code->hash == hash &&
+          code->key_size == key_size &&
+          memcmp(code->key, key, key_size) == 0) {
+         code->refcount++;
+         break;
+      }
+   }
+   pipe_mutex_unlock(screen->code_mutex);
+
+   return code;
+}
+
+
+/**
+ * Hand the code of a freshly compiled variant over to a lp_fs_code, so
+ * that other variants can share it.  The variant keeps its jit_function
+ * pointers.  If this fails, the variant just keeps owning its code.
+ */
+static void
+share_variant_code(struct llvmpipe_screen *screen,
+                   struct lp_fragment_shader_variant *variant,
+                   boolean async)
+{
+   struct lp_fs_code *code;
+   unsigned i;
+
+   if (!variant->gallivm)
+      return;
+
+   code = CALLOC_STRUCT(lp_fs_code);
+   if (!code)
+      return;
+
+   code->key = make_code_key(variant->shader, &variant->key, &code->key_size);
+   if (!code->key) {
+      FREE(code);
+      return;
+   }
+   code->hash = util_hash_crc32(code->key, code->key_size);
+   code->refcount = 1;
+   code->async = async;
+
+   code->gallivm = variant->gallivm;
+   code->nr_instrs = variant->nr_instrs;
+   for (i = 0; i < Elements(code->function); i++) {
+      code->function[i] = variant->function[i];
+      code->jit_function[i] = variant->jit_function[i];
+      variant->function[i] = NULL;
+   }
+   variant->gallivm = NULL;
+   variant->code = code;
+
+   pipe_mutex_lock(screen->code_mutex);
+   code->next = screen->code;
+   screen->code = code;
+   pipe_mutex_unlock(screen->code_mutex);
+}
+
+
+/**
+ * Drop a reference to shared code, freeing it with the last one.
+ */
+static void
+release_code(struct llvmpipe_screen *screen, struct lp_fs_code *code)
+{
+   struct lp_fs_code **p;
+   unsigned i;
+
+   pipe_mutex_lock(screen->code_mutex);
+   if (--code->refcount > 0) {
+      pipe_mutex_unlock(screen->code_mutex);
+      return;
+   }
+   for (p = &screen->code; *p != code; p = &(*p)->next)
+      ;
+   *p = code->next;
+   pipe_mutex_unlock(screen->code_mutex);
+
+   /* Code in the compiler thread's LLVM context is freed under its lock */
+   if (code->async)
+      pipe_mutex_lock(screen->compile_llvm_mutex);
+
+   for (i = 0; i < Elements(code->function); i++) {
+      if (code->function[i]) {
+         gallivm_free_function(code->gallivm,
+                               code->function[i],
+                               code->jit_function[i]);
+      }
+   }
+   gallivm_destroy(code->gallivm);
+
+   if (code->async)
+      pipe_mutex_unlock(screen->compile_llvm_mutex);
+
+   FREE(code->key);
+   FREE(code);
+}
+
+
 /**
  * Generate a new fragment shader variant from the shader code and
  * other state indicated by the key.
@@ -2524,20 +2774,17 @@ generate_variant(struct llvmpipe_context *lp,
                  struct lp_fragment_shader *shader,
                  const struct lp_fragment_shader_variant_key *key)
 {
+   struct llvmpipe_screen *screen = llvmpipe_screen(lp->pipe.screen);
    struct lp_fragment_shader_variant *variant;
    const struct util_format_description *cbuf0_format_desc;
    boolean fullcolormask;
+   uint8_t *code_key;
+   unsigned code_key_size;
 
    variant = CALLOC_STRUCT(lp_fragment_shader_variant);
    if(!variant)
       return NULL;
 
-   variant->gallivm = gallivm_create();
-   if (!variant->gallivm) {
-      FREE(variant);
-      return NULL;
-   }
-
    variant->shader = shader;
    variant->list_item_global.base = variant;
    variant->list_item_local.base = variant;
@@ -2565,6 +2812,46 @@ generate_variant(struct llvmpipe_context *lp,
          !shader->info.base.uses_kill
       ? TRUE : FALSE;
 
+   /*
+    * Rough per-pixel cost estimate, used to rasterize the most expensive
+    * bins first.  Longer shaders cost more, and blending or a partial
+    * colormask means the color buffer has to be read back too.
+    */
+   variant->shade_cost = 1 + MIN2(shader->info.base.num_instructions / 16, 15);
+   if (key->blend.logicop_enable ||
+       key->blend.rt[0].blend_enable ||
+       !fullcolormask) {
+      variant->shade_cost *= 2;
+   }
+   if (key->depth.enabled || key->stencil[0].enabled) {
+      variant->shade_cost += 1;
+   }
+
+   /*
+    * Depth values written with a LESS or LEQUAL test can only decrease, so
+    * fragments behind a tile's max depth are bound to fail.  Fully covered
+    * blocks are only known to have all their depth values written when no
+    * fragment can be discarded by other means.
+    */
+   if (key->depth.enabled) {
+      const boolean depth_decreases = key->depth.func == PIPE_FUNC_LESS ||
+                                      key->depth.func == PIPE_FUNC_LEQUAL;
+
+      variant->hiz_cull = depth_decreases &&
+                          !key->depth_clamp &&
+                          !shader->info.base.writes_z;
+      variant->hiz_update = variant->hiz_cull &&
+                            key->depth.writemask &&
+                            !key->stencil[0].enabled &&
+                            !key->alpha.enabled &&
+                            !key->blend.alpha_to_coverage &&
+                            !shader->info.base.uses_kill;
+      variant->hiz_invalidate = key->depth.writemask &&
+                                !depth_decreases &&
+                                key->depth.func != PIPE_FUNC_EQUAL &&
+                                key->depth.func != PIPE_FUNC_NEVER;
+   }
+
    if ((shader->info.base.num_tokens <= 1) &&
        !key->depth.enabled && !key->stencil[0].enabled) {
       variant->ps_inv_multiplier = 0;
@@ -2572,40 +2859,49 @@ generate_variant(struct llvmpipe_context *lp,
       variant->ps_inv_multiplier = 1;
    }
 
+   lp_linear_check_variant(shader, variant);
+
    if ((LP_DEBUG & DEBUG_FS) || (gallivm_debug & GALLIVM_DEBUG_IR)) {
       lp_debug_fs_variant(variant);
    }
 
-   lp_jit_init_types(variant);
-   
-   if (variant->jit_function[RAST_EDGE_TEST] == NULL)
-      generate_fragment(lp, shader, variant, RAST_EDGE_TEST);
-
-   if (variant->jit_function[RAST_WHOLE] == NULL) {
-      if (variant->opaque) {
-         /* Specialized shader, which doesn't need to read the color buffer. */
-         generate_fragment(lp, shader, variant, RAST_WHOLE);
-      }
-   }
-
-   /*
-    * Compile everything
+   /* The same shader may have been compiled with the same key already,
+    * possibly in another context.
     */
+   code_key = make_code_key(shader, key, &code_key_size);
+   if (code_key) {
+      variant->code = find_code(screen, code_key, code_key_size);
+      FREE(code_key);
+   }
 
-   gallivm_compile_module(variant->gallivm);
-
-   if (variant->function[RAST_EDGE_TEST]) {
-      variant->jit_function[RAST_EDGE_TEST] = (lp_jit_frag_func)
-            gallivm_jit_function(variant->gallivm,
-                                 variant->function[RAST_EDGE_TEST]);
+   if (variant->code) {
+      memcpy(variant->jit_function, variant->code->jit_function,
+             sizeof variant->jit_function);
+      variant->nr_instrs = variant->code->nr_instrs;
    }
+   else if (screen->async_compile) {
+      variant->ready = lp_fence_create(1);
+      if (!variant->ready) {
+         FREE(variant);
+         return NULL;
+      }
+      variant->ready->issued = TRUE;
 
-   if (variant->function[RAST_WHOLE]) {
-         variant->jit_function[RAST_WHOLE] = (lp_jit_frag_func)
-               gallivm_jit_function(variant->gallivm,
-                                    variant->function[RAST_WHOLE]);
-   } else if (!variant->jit_function[RAST_WHOLE]) {
-      variant->jit_function[RAST_WHOLE] = variant->jit_function[RAST_EDGE_TEST];
+      pipe_mutex_lock(screen->compile_mutex);
+      if (screen->compile_tail)
+         screen->compile_tail->compile_next = variant;
+      else
+         screen->compile_head = variant;
+      screen->compile_tail = variant;
+      pipe_condvar_signal(screen->compile_cond);
+      pipe_mutex_unlock(screen->compile_mutex);
+   }
+   else if (compile_variant(variant, screen->disk_cache, NULL)) {
+      share_variant_code(screen, variant, FALSE);
+   }
+   else {
+      FREE(variant);
+      return NULL;
    }
 
    return variant;
@@ -2635,7 +2931,8 @@ llvmpipe_create_fs_state(struct pipe_context *pipe,
    /* we need to keep a local copy of the tokens */
    shader->base.tokens = tgsi_dup_tokens(templ->tokens);
 
-   shader->draw_data = draw_create_fragment_shader(llvmpipe->draw, templ);
+   shader->draw_data = draw_create_fragment_shader_info(llvmpipe->draw, templ,
+                                                        &shader->info.base);
    if (shader->draw_data == NULL) {
       FREE((void *) shader->base.tokens);
       FREE(shader);
@@ -2732,6 +3029,7 @@ void
 llvmpipe_remove_shader_variant(struct llvmpipe_context *lp,
                                struct lp_fragment_shader_variant *variant)
 {
+   struct llvmpipe_screen *screen = llvmpipe_screen(lp->pipe.screen);
    unsigned i;
 
    if (gallivm_debug & GALLIVM_DEBUG_IR) {
@@ -2744,7 +3042,30 @@ llvmpipe_remove_shader_variant(struct llvmpipe_context *lp,
                    lp->nr_fs_variants);
    }
 
-   /* free all the variant's JIT'd functions */
+   if (variant->ready) {
+      struct lp_fragment_shader_variant **p, *prev = NULL;
+
+      /* Dequeue it if it wasn't compiled yet, or else wait for the compiler
+       * thread to finish with it, and keep it from using its LLVM context
+       * while we free the variant's code.
+       */
+      pipe_mutex_lock(screen->compile_mutex);
+      for (p = &screen->compile_head; *p; prev = *p, p = &(*p)->compile_next) {
+         if (*p == variant) {
+            *p = variant->compile_next;
+            if (screen->compile_tail == variant)
+               screen->compile_tail = prev;
+            break;
+         }
+      }
+      pipe_mutex_lock(screen->compile_llvm_mutex);
+      pipe_mutex_unlock(screen->compile_mutex);
+   }
+   else {
+      lp->nr_fs_instrs -= variant->nr_instrs;
+   }
+
+   /* free the variant's JIT'd functions, unless they are shared */
    for (i = 0; i < Elements(variant->function); i++) {
       if (variant->function[i]) {
          gallivm_free_function(variant->gallivm,
@@ -2753,7 +3074,16 @@ llvmpipe_remove_shader_variant(struct llvmpipe_context *lp,
       }
    }
 
-   gallivm_destroy(variant->gallivm);
+   if (variant->gallivm)
+      gallivm_destroy(variant->gallivm);
+
+   if (variant->ready) {
+      pipe_mutex_unlock(screen->compile_llvm_mutex);
+      lp_fence_reference(&variant->ready, NULL);
+   }
+
+   if (variant->code)
+      release_code(screen, variant->code);
 
    /* remove from shader's list */
    remove_from_list(&variant->list_item_local);
@@ -2762,7 +3092,6 @@ llvmpipe_remove_shader_variant(struct llvmpipe_context *lp,
    /* remove from context's list */
    remove_from_list(&variant->list_item_global);
    lp->nr_fs_variants--;
-   lp->nr_fs_instrs -= variant->nr_instrs;
 
    FREE(variant);
 }
@@ -3136,9 +3465,11 @@ llvmpipe_update_fs(struct llvmpipe_context *lp)
       /*
        * Generate the new variant.
        */
+      util_trace_event_begin("lp compile fs");
       t0 = os_time_get();
       variant = generate_variant(lp, shader, &key);
       t1 = os_time_get();
+      util_trace_event_end("lp compile fs");
       dt = t1 - t0;
       LP_COUNT_ADD(llvm_compile_time, dt);
       LP_COUNT_ADD(nr_llvm_compiles, 2);  /* emit vs. omit in/out test */
@@ -3150,7 +3481,11 @@ llvmpipe_update_fs(struct llvmpipe_context *lp)
          insert_at_head(&shader->variants, &variant->list_item_local);
          insert_at_head(&lp->fs_variants_list, &variant->list_item_global);
          lp->nr_fs_variants++;
-         lp->nr_fs_instrs += variant->nr_instrs;
+         /* Asynchronously compiled variants aren't counted, as their size
+          * isn't known yet.
+          */
+         if (!variant->ready)
+            lp->nr_fs_instrs += variant->nr_instrs;
          shader->variants_cached++;
       }
    }
@@ -3163,6 +3498,93 @@ llvmpipe_update_fs(struct llvmpipe_context *lp)
 
 
 
+static PIPE_THREAD_ROUTINE(fs_compile_thread, init_data)
+{
+   struct llvmpipe_screen *screen = (struct llvmpipe_screen *) init_data;
+
+   pipe_mutex_lock(screen->compile_mutex);
+   for (;;) {
+      struct lp_fragment_shader_variant *variant;
+
+      while (!screen->compile_head && !screen->compile_exit) {
+         pipe_condvar_wait(screen->compile_cond, screen->compile_mutex);
+      }
+      if (screen->compile_exit)
+         break;
+
+      variant = screen->compile_head;
+      screen->compile_head = variant->compile_next;
+      if (!screen->compile_head)
+         screen->compile_tail = NULL;
+      variant->compile_next = NULL;
+
+      /* Take the LLVM lock before dropping the queue lock, so the variant
+       * can't be freed in between.
+       */
+      pipe_mutex_lock(screen->compile_llvm_mutex);
+      pipe_mutex_unlock(screen->compile_mutex);
+
+      if (!screen->compile_context)
+         screen->compile_context = LLVMContextCreate();
+
+      if (screen->compile_context &&
+          compile_variant(variant, screen->disk_cache, screen->compile_context))
+         share_variant_code(screen, variant, TRUE);
+      lp_fence_signal(variant->ready);
+
+      pipe_mutex_unlock(screen->compile_llvm_mutex);
+      pipe_mutex_lock(screen->compile_mutex);
+   }
+   pipe_mutex_unlock(screen->compile_mutex);
+
+   return 0;
+}
+
+
+void
+lp_fs_compiler_init(struct llvmpipe_screen *screen)
+{
+   pipe_mutex_init(screen->code_mutex);
+
+   screen->async_compile = debug_get_bool_option("LP_ASYNC_COMPILE", FALSE);
+   if (!screen->async_compile)
+      return;
+
+   pipe_mutex_init(screen->compile_mutex);
+   pipe_mutex_init(screen->compile_llvm_mutex);
+   pipe_condvar_init(screen->compile_cond);
+
+   screen->compile_thread = pipe_thread_create(fs_compile_thread, screen);
+}
+
+
+void
+lp_fs_compiler_cleanup(struct llvmpipe_screen *screen)
+{
+   /* All the code was released with the variants */
+   assert(!screen->code);
+   pipe_mutex_destroy(screen->code_mutex);
+
+   if (!screen->async_compile)
+      return;
+
+   /* All variants were destroyed with their contexts */
+   assert(!screen->compile_head);
+
+   pipe_mutex_lock(screen->compile_mutex);
+   screen->compile_exit = TRUE;
+   pipe_condvar_broadcast(screen->compile_cond);
+   pipe_mutex_unlock(screen->compile_mutex);
+
+   pipe_thread_wait(screen->compile_thread);
+
+   /* The LLVM context is never freed, see lp_bld_init.c */
+   pipe_condvar_destroy(screen->compile_cond);
+   pipe_mutex_destroy(screen->compile_llvm_mutex);
+   pipe_mutex_destroy(screen->compile_mutex);
+}
+
+
 void
 llvmpipe_init_fs_funcs(struct llvmpipe_context *llvmpipe)
 {
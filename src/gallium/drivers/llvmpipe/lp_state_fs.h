@@ -40,6 +40,8 @@
 
 struct tgsi_token;
 struct lp_fragment_shader;
+struct lp_fence;
+struct llvmpipe_screen;
 
 
 /** Indexes into jit_function[] array */
@@ -85,6 +87,30 @@ struct lp_fragment_shader_variant_key
 };
 
 
+/**
+ * Compiled code of a fragment shader variant.  Variants with the same
+ * tokens and key share it, across all the contexts of a screen.
+ */
+struct lp_fs_code
+{
+   struct lp_fs_code *next;     /**< in the screen's list of code */
+   int refcount;                /**< protected by the screen's code_mutex */
+
+   /** Variant key followed by the shader tokens */
+   uint8_t *key;
+   unsigned key_size;
+   unsigned hash;
+
+   /** Compiled by the asynchronous compiler, in its LLVM context */
+   boolean async;
+
+   struct gallivm_state *gallivm;
+   LLVMValueRef function[2];
+   lp_jit_frag_func jit_function[2];
+   unsigned nr_instrs;
+};
+
+
 /** doubly-linked list item */
 struct lp_fs_variant_list_item
 {
@@ -100,6 +126,20 @@ struct lp_fragment_shader_variant
    boolean opaque;
    uint8_t ps_inv_multiplier;
 
+   /* Relative cost of shading a pixel, for bin scheduling */
+   unsigned shade_cost;
+
+   /* Hierarchical depth culling, see lp_rast_hiz_cull() */
+   unsigned hiz_cull:1;        /**< can cull against the max tile depth */
+   unsigned hiz_update:1;      /**< fully covered blocks lower it */
+   unsigned hiz_invalidate:1;  /**< depth values may increase */
+
+   /* Texture copy/composite fast path, see lp_linear.c */
+   unsigned linear_op:2;          /**< enum lp_linear_op */
+   unsigned linear_input:8;       /**< shader input with the texcoords */
+   unsigned linear_normalized:1;  /**< texcoords are normalized */
+   unsigned linear_alpha_one:1;   /**< texture has no alpha channel */
+
    struct gallivm_state *gallivm;
 
    LLVMTypeRef jit_context_ptr_type;
@@ -113,6 +153,15 @@ struct lp_fragment_shader_variant
    /* Total number of LLVM instructions generated */
    unsigned nr_instrs;
 
+   /* Once compiled, the code is owned by this rather than by the variant */
+   struct lp_fs_code *code;
+
+   /* When compiled asynchronously, signalled once the jit functions are
+    * ready, otherwise NULL.
+    */
+   struct lp_fence *ready;
+   struct lp_fragment_shader_variant *compile_next;
+
    struct lp_fs_variant_list_item list_item_global, list_item_local;
    struct lp_fragment_shader *shader;
 
@@ -153,5 +202,11 @@ llvmpipe_remove_shader_variant(struct llvmpipe_context *lp,
 boolean
 llvmpipe_rasterization_disabled(struct llvmpipe_context *lp);
 
+void
+lp_fs_compiler_init(struct llvmpipe_screen *screen);
+
+void
+lp_fs_compiler_cleanup(struct llvmpipe_screen *screen);
+
 
 #endif /* LP_STATE_FS_H_ */
@@ -0,0 +1,796 @@
+/**************************************************************************
+ *
+ * Copyright 2014 The Mesa Authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * @file
+ * Micro-benchmarks of the whole llvmpipe pipeline.
+ *
+ * Unlike the other lp_test_* programs, which exercise individual gallivm
+ * code generators, this one drives a complete llvmpipe context on top of
+ * the null winsys and times clears, triangle setup, rasterization of
+ * triangles of various sizes, texture sampling and blending.
+ *
+ * Every case is run LP_BENCH_NUM_SAMPLES times after an untimed warm-up
+ * run, which also takes care of compiling the shader variants.  The median
+ * and the 99th percentile of the cycle counts are reported, together with
+ * the median cycles per item, which is a triangle for the setup case and a
+ * pixel for all others.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "pipe/p_context.h"
+#include "pipe/p_defines.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_shader_tokens.h"
+#include "util/u_box.h"
+#include "util/u_draw.h"
+#include "util/u_inlines.h"
+#include "util/u_memory.h"
+#include "util/u_sampler.h"
+#include "util/u_simple_shaders.h"
+#include "state_tracker/sw_winsys.h"
+#include "sw/null/null_sw_winsys.h"
+
+#include "lp_flush.h"
+#include "lp_public.h"
+#include "lp_test.h"
+
+
+#define LP_BENCH_NUM_SAMPLES 100
+
+#define LP_BENCH_FB_SIZE 1024
+#define LP_BENCH_TEX_SIZE 1024
+
+/** Roughly how many pixels each timed sample covers */
+#define LP_BENCH_PIXELS (1 << 20)
+
+#define LP_BENCH_MAX_TRIANGLES (1 << 16)
+
+
+enum bench_kind
+{
+   BENCH_CLEAR,
+   BENCH_SETUP,
+   BENCH_TRIANGLES,
+   BENCH_TEXTURE,
+   BENCH_BLEND
+};
+
+
+enum bench_filter
+{
+   BENCH_FILTER_NONE,
+   BENCH_FILTER_NEAREST,
+   BENCH_FILTER_LINEAR,
+   BENCH_FILTER_TRILINEAR
+};
+
+
+enum bench_blend
+{
+   BENCH_BLEND_NONE,
+   BENCH_BLEND_OVER,
+   BENCH_BLEND_ADD
+};
+
+
+struct bench_case
+{
+   enum bench_kind kind;
+   enum pipe_format format;     /**< texture format, if any */
+   enum bench_filter filter;
+   enum bench_blend blend;
+   unsigned size;               /**< triangle edge or quad size in pixels */
+};
+
+
+static const struct bench_case bench_cases[] =
+{
+   { BENCH_CLEAR, PIPE_FORMAT_NONE, BENCH_FILTER_NONE, BENCH_BLEND_NONE, LP_BENCH_FB_SIZE },
+
+   { BENCH_SETUP, PIPE_FORMAT_NONE, BENCH_FILTER_NONE, BENCH_BLEND_NONE, 1 },
+
+   { BENCH_TRIANGLES, PIPE_FORMAT_NONE, BENCH_FILTER_NONE, BENCH_BLEND_NONE, 4 },
+   { BENCH_TRIANGLES, PIPE_FORMAT_NONE, BENCH_FILTER_NONE, BENCH_BLEND_NONE, 16 },
+   { BENCH_TRIANGLES, PIPE_FORMAT_NONE, BENCH_FILTER_NONE, BENCH_BLEND_NONE, 64 },
+   { BENCH_TRIANGLES, PIPE_FORMAT_NONE, BENCH_FILTER_NONE, BENCH_BLEND_NONE, 256 },
+
+   { BENCH_TEXTURE, PIPE_FORMAT_B8G8R8A8_UNORM, BENCH_FILTER_NEAREST, BENCH_BLEND_NONE, 512 },
+   { BENCH_TEXTURE, PIPE_FORMAT_B8G8R8A8_UNORM, BENCH_FILTER_LINEAR, BENCH_BLEND_NONE, 512 },
+   { BENCH_TEXTURE, PIPE_FORMAT_B8G8R8A8_UNORM, BENCH_FILTER_TRILINEAR, BENCH_BLEND_NONE, 512 },
+   { BENCH_TEXTURE, PIPE_FORMAT_R8G8B8A8_UNORM, BENCH_FILTER_NEAREST, BENCH_BLEND_NONE, 512 },
+   { BENCH_TEXTURE, PIPE_FORMAT_R8G8B8A8_UNORM, BENCH_FILTER_LINEAR, BENCH_BLEND_NONE, 512 },
+   { BENCH_TEXTURE, PIPE_FORMAT_R8G8B8A8_UNORM, BENCH_FILTER_TRILINEAR, BENCH_BLEND_NONE, 512 },
+   { BENCH_TEXTURE, PIPE_FORMAT_B5G6R5_UNORM, BENCH_FILTER_NEAREST, BENCH_BLEND_NONE, 512 },
+   { BENCH_TEXTURE, PIPE_FORMAT_B5G6R5_UNORM, BENCH_FILTER_LINEAR, BENCH_BLEND_NONE, 512 },
+   { BENCH_TEXTURE, PIPE_FORMAT_L8_UNORM, BENCH_FILTER_NEAREST, BENCH_BLEND_NONE, 512 },
+   { BENCH_TEXTURE, PIPE_FORMAT_L8_UNORM, BENCH_FILTER_LINEAR, BENCH_BLEND_NONE, 512 },
+   { BENCH_TEXTURE, PIPE_FORMAT_R32G32B32A32_FLOAT, BENCH_FILTER_NEAREST, BENCH_BLEND_NONE, 512 },
+   { BENCH_TEXTURE, PIPE_FORMAT_R32G32B32A32_FLOAT, BENCH_FILTER_LINEAR, BENCH_BLEND_NONE, 512 },
+
+   { BENCH_BLEND, PIPE_FORMAT_NONE, BENCH_FILTER_NONE, BENCH_BLEND_NONE, 512 },
+   { BENCH_BLEND, PIPE_FORMAT_NONE, BENCH_FILTER_NONE, BENCH_BLEND_OVER, 512 },
+   { BENCH_BLEND, PIPE_FORMAT_NONE, BENCH_FILTER_NONE, BENCH_BLEND_ADD, 512 },
+};
+
+
+static const char *bench_kind_names[] = {
+   "clear",
+   "setup",
+   "triangles",
+   "texture",
+   "blend"
+};
+
+static const char *bench_filter_names[] = {
+   "-",
+   "nearest",
+   "linear",
+   "trilinear"
+};
+
+static const char *bench_blend_names[] = {
+   "none",
+   "over",
+   "add"
+};
+
+
+/**
+ * A vertex: window position and a generic attribute, which is either a
+ * color or a texture coordinate.
+ */
+struct bench_vertex
+{
+   float position[4];
+   float generic[4];
+};
+
+
+struct bench_context
+{
+   struct pipe_screen *screen;
+   struct pipe_context *pipe;
+   struct pipe_resource *cbuf;
+   struct pipe_surface *surf;
+
+   void *vs;
+   void *fs_color;
+   void *fs_tex;
+   void *rasterizer;
+   void *dsa;
+   void *velems;
+};
+
+
+static boolean
+bench_init(struct bench_context *bench)
+{
+   static const uint semantic_names[] = { TGSI_SEMANTIC_POSITION,
+                                          TGSI_SEMANTIC_GENERIC };
+   static const uint semantic_indexes[] = { 0, 0 };
+   struct sw_winsys *winsys;
+   struct pipe_context *pipe;
+   struct pipe_resource templat;
+   struct pipe_surface surf_templ;
+   struct pipe_framebuffer_state fb;
+   struct pipe_viewport_state vp;
+   struct pipe_rasterizer_state rast;
+   struct pipe_depth_stencil_alpha_state dsa;
+   struct pipe_vertex_element velems[2];
+
+   memset(bench, 0, sizeof *bench);
+
+   winsys = null_sw_create();
+   if (!winsys)
+      return FALSE;
+
+   bench->screen = llvmpipe_create_screen(winsys);
+   if (!bench->screen) {
+      winsys->destroy(winsys);
+      return FALSE;
+   }
+
+   pipe = bench->screen->context_create(bench->screen, NULL);
+   if (!pipe)
+      return FALSE;
+   bench->pipe = pipe;
+
+   memset(&templat, 0, sizeof templat);
+   templat.target = PIPE_TEXTURE_2D;
+   templat.format = PIPE_FORMAT_B8G8R8A8_UNORM;
+   templat.width0 = LP_BENCH_FB_SIZE;
+   templat.height0 = LP_BENCH_FB_SIZE;
+   templat.depth0 = 1;
+   templat.array_size = 1;
+   templat.bind = PIPE_BIND_RENDER_TARGET;
+
+   bench->cbuf = bench->screen->resource_create(bench->screen, &templat);
+   if (!bench->cbuf)
+      return FALSE;
+
+   memset(&surf_templ, 0, sizeof surf_templ);
+   surf_templ.format = templat.format;
+   bench->surf = pipe->create_surface(pipe, bench->cbuf, &surf_templ);
+   if (!bench->surf)
+      return FALSE;
+
+   memset(&fb, 0, sizeof fb);
+   fb.width = LP_BENCH_FB_SIZE;
+   fb.height = LP_BENCH_FB_SIZE;
+   fb.nr_cbufs = 1;
+   fb.cbufs[0] = bench->surf;
+   pipe->set_framebuffer_state(pipe, &fb);
+
+   /* Map normalized device coordinates onto the whole framebuffer */
+   memset(&vp, 0, sizeof vp);
+   vp.scale[0] = LP_BENCH_FB_SIZE / 2.0f;
+   vp.scale[1] = LP_BENCH_FB_SIZE / 2.0f;
+   vp.scale[2] = 1.0f;
+   vp.scale[3] = 1.0f;
+   vp.translate[0] = LP_BENCH_FB_SIZE / 2.0f;
+   vp.translate[1] = LP_BENCH_FB_SIZE / 2.0f;
+   pipe->set_viewport_states(pipe, 0, 1, &vp);
+
+   memset(&rast, 0, sizeof rast);
+   rast.cull_face = PIPE_FACE_NONE;
+   rast.half_pixel_center = 1;
+   rast.bottom_edge_rule = 1;
+   rast.depth_clip = 1;
+   bench->rasterizer = pipe->create_rasterizer_state(pipe, &rast);
+   pipe->bind_rasterizer_state(pipe, bench->rasterizer);
+
+   memset(&dsa, 0, sizeof dsa);
+   bench->dsa = pipe->create_depth_stencil_alpha_state(pipe, &dsa);
+   pipe->bind_depth_stencil_alpha_state(pipe, bench->dsa);
+
+   memset(velems, 0, sizeof velems);
+   velems[0].src_offset = Offset(struct bench_vertex, position);
+   velems[0].src_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+   velems[1].src_offset = Offset(struct bench_vertex, generic);
+   velems[1].src_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+   bench->velems = pipe->create_vertex_elements_state(pipe, 2, velems);
+   pipe->bind_vertex_elements_state(pipe, bench->velems);
+
+   bench->vs = util_make_vertex_passthrough_shader(pipe, 2, semantic_names,
+                                                   semantic_indexes);
+   pipe->bind_vs_state(pipe, bench->vs);
+
+   bench->fs_color = util_make_fragment_passthrough_shader(pipe,
+                                                           TGSI_SEMANTIC_GENERIC,
+                                                           TGSI_INTERPOLATE_LINEAR,
+                                                           FALSE);
+   bench->fs_tex = util_make_fragment_tex_shader(pipe, TGSI_TEXTURE_2D,
+                                                 TGSI_INTERPOLATE_LINEAR);
+
+   return bench->vs && bench->fs_color && bench->fs_tex;
+}
+
+
+static void
+bench_fini(struct bench_context *bench)
+{
+   struct pipe_context *pipe = bench->pipe;
+
+   if (pipe) {
+      pipe->bind_vs_state(pipe, NULL);
+      pipe->bind_fs_state(pipe, NULL);
+      pipe->bind_rasterizer_state(pipe, NULL);
+      pipe->bind_depth_stencil_alpha_state(pipe, NULL);
+      pipe->bind_vertex_elements_state(pipe, NULL);
+
+      if (bench->vs)
+         pipe->delete_vs_state(pipe, bench->vs);
+      if (bench->fs_color)
+         pipe->delete_fs_state(pipe, bench->fs_color);
+      if (bench->fs_tex)
+         pipe->delete_fs_state(pipe, bench->fs_tex);
+      if (bench->rasterizer)
+         pipe->delete_rasterizer_state(pipe, bench->rasterizer);
+      if (bench->dsa)
+         pipe->delete_depth_stencil_alpha_state(pipe, bench->dsa);
+      if (bench->velems)
+         pipe->delete_vertex_elements_state(pipe, bench->velems);
+
+      pipe_surface_reference(&bench->surf, NULL);
+      pipe->destroy(pipe);
+   }
+
+   pipe_resource_reference(&bench->cbuf, NULL);
+
+   if (bench->screen)
+      bench->screen->destroy(bench->screen);
+}
+
+
+static INLINE float
+pixel_to_ndc(float x)
+{
+   return 2.0f * x / LP_BENCH_FB_SIZE - 1.0f;
+}
+
+
+static void
+set_vertex(struct bench_vertex *v, float x, float y,
+           float g0, float g1, float g2, float g3)
+{
+   v->position[0] = pixel_to_ndc(x);
+   v->position[1] = pixel_to_ndc(y);
+   v->position[2] = 0.0f;
+   v->position[3] = 1.0f;
+   v->generic[0] = g0;
+   v->generic[1] = g1;
+   v->generic[2] = g2;
+   v->generic[3] = g3;
+}
+
+
+/**
+ * Fill in right-angled triangles with legs of the given size, tiled over
+ * the framebuffer and wrapping around as often as necessary.
+ * \return the number of vertices
+ */
+static unsigned
+make_triangles(struct bench_vertex *verts, unsigned size, unsigned count)
+{
+   const unsigned per_row = MAX2(LP_BENCH_FB_SIZE / size, 1);
+   const unsigned per_fb = per_row * per_row;
+   unsigned i;
+
+   for (i = 0; i < count; i++) {
+      const unsigned j = i % per_fb;
+      const float x = (float)((j % per_row) * size);
+      const float y = (float)((j / per_row) * size);
+      const float s = (float)size;
+
+      set_vertex(&verts[i*3 + 0], x,     y,     1.0f, 0.0f, 0.0f, 0.5f);
+      set_vertex(&verts[i*3 + 1], x + s, y,     0.0f, 1.0f, 0.0f, 0.5f);
+      set_vertex(&verts[i*3 + 2], x,     y + s, 0.0f, 0.0f, 1.0f, 0.5f);
+   }
+
+   return count * 3;
+}
+
+
+/**
+ * Fill in an axis aligned quad, as two triangles, whose texture
+ * coordinates cover [0,1].
+ * \return the number of vertices
+ */
+static unsigned
+make_quad(struct bench_vertex *verts, unsigned size)
+{
+   const float x0 = 0.0f, y0 = 0.0f;
+   const float x1 = (float)size, y1 = (float)size;
+
+   set_vertex(&verts[0], x0, y0, 0.0f, 0.0f, 0.0f, 0.5f);
+   set_vertex(&verts[1], x1, y0, 1.0f, 0.0f, 0.0f, 0.5f);
+   set_vertex(&verts[2], x0, y1, 0.0f, 1.0f, 0.0f, 0.5f);
+   set_vertex(&verts[3], x0, y1, 0.0f, 1.0f, 0.0f, 0.5f);
+   set_vertex(&verts[4], x1, y0, 1.0f, 0.0f, 0.0f, 0.5f);
+   set_vertex(&verts[5], x1, y1, 1.0f, 1.0f, 0.0f, 0.5f);
+
+   return 6;
+}
+
+
+/**
+ * Create a texture with a full mipmap chain, filled with a checkerboard.
+ */
+static struct pipe_resource *
+create_texture(struct bench_context *bench, enum pipe_format format)
+{
+   struct pipe_screen *screen = bench->screen;
+   struct pipe_context *pipe = bench->pipe;
+   struct pipe_resource templat;
+   struct pipe_resource *tex;
+   uint8_t *rgba, *texels;
+   unsigned level;
+
+   memset(&templat, 0, sizeof templat);
+   templat.target = PIPE_TEXTURE_2D;
+   templat.format = format;
+   templat.width0 = LP_BENCH_TEX_SIZE;
+   templat.height0 = LP_BENCH_TEX_SIZE;
+   templat.depth0 = 1;
+   templat.array_size = 1;
+   templat.last_level = util_logbase2(LP_BENCH_TEX_SIZE);
+   templat.bind = PIPE_BIND_SAMPLER_VIEW;
+
+   tex = screen->resource_create(screen, &templat);
+   if (!tex)
+      return NULL;
+
+   rgba = MALLOC(LP_BENCH_TEX_SIZE * LP_BENCH_TEX_SIZE * 4);
+   texels = MALLOC(LP_BENCH_TEX_SIZE * LP_BENCH_TEX_SIZE * 16);
+   if (!rgba || !texels) {
+      FREE(rgba);
+      FREE(texels);
+      pipe_resource_reference(&tex, NULL);
+      return NULL;
+   }
+
+   for (level = 0; level <= templat.last_level; level++) {
+      const unsigned size = u_minify(LP_BENCH_TEX_SIZE, level);
+      const unsigned stride = util_format_get_stride(format, size);
+      struct pipe_box box;
+      unsigned x, y;
+
+      for (y = 0; y < size; y++) {
+         for (x = 0; x < size; x++) {
+            uint8_t *p = &rgba[(y * size + x) * 4];
+            const uint8_t c = ((x ^ y) & 8) ? 0xff : 0x20;
+            p[0] = c;
+            p[1] = (uint8_t)(x * 255 / size);
+            p[2] = (uint8_t)(y * 255 / size);
+            p[3] = 0xff;
+         }
+      }
+
+      util_format_write_4ub(format, rgba, size * 4, texels, stride,
+                            0, 0, size, size);
+
+      u_box_2d(0, 0, size, size, &box);
+      pipe->transfer_inline_write(pipe, tex, level, PIPE_TRANSFER_WRITE,
+                                  &box, texels, stride, 0);
+   }
+
+   FREE(rgba);
+   FREE(texels);
+
+   return tex;
+}
+
+
+static void *
+create_blend(struct pipe_context *pipe, enum bench_blend mode)
+{
+   struct pipe_blend_state blend;
+
+   memset(&blend, 0, sizeof blend);
+   blend.rt[0].colormask = PIPE_MASK_RGBA;
+
+   switch (mode) {
+   case BENCH_BLEND_NONE:
+      break;
+   case BENCH_BLEND_OVER:
+      blend.rt[0].blend_enable = 1;
+      blend.rt[0].rgb_func = PIPE_BLEND_ADD;
+      blend.rt[0].rgb_src_factor = PIPE_BLENDFACTOR_SRC_ALPHA;
+      blend.rt[0].rgb_dst_factor = PIPE_BLENDFACTOR_INV_SRC_ALPHA;
+      blend.rt[0].alpha_func = PIPE_BLEND_ADD;
+      blend.rt[0].alpha_src_factor = PIPE_BLENDFACTOR_ONE;
+      blend.rt[0].alpha_dst_factor = PIPE_BLENDFACTOR_INV_SRC_ALPHA;
+      break;
+   case BENCH_BLEND_ADD:
+      blend.rt[0].blend_enable = 1;
+      blend.rt[0].rgb_func = PIPE_BLEND_ADD;
+      blend.rt[0].rgb_src_factor = PIPE_BLENDFACTOR_ONE;
+      blend.rt[0].rgb_dst_factor = PIPE_BLENDFACTOR_ONE;
+      blend.rt[0].alpha_func = PIPE_BLEND_ADD;
+      blend.rt[0].alpha_src_factor = PIPE_BLENDFACTOR_ONE;
+      blend.rt[0].alpha_dst_factor = PIPE_BLENDFACTOR_ONE;
+      break;
+   }
+
+   return pipe->create_blend_state(pipe, &blend);
+}
+
+
+static void *
+create_sampler(struct pipe_context *pipe, enum bench_filter filter)
+{
+   struct pipe_sampler_state sampler;
+
+   memset(&sampler, 0, sizeof sampler);
+   sampler.wrap_s = PIPE_TEX_WRAP_REPEAT;
+   sampler.wrap_t = PIPE_TEX_WRAP_REPEAT;
+   sampler.wrap_r = PIPE_TEX_WRAP_REPEAT;
+   sampler.normalized_coords = 1;
+   sampler.max_lod = PIPE_MAX_TEXTURE_LEVELS - 1;
+
+   switch (filter) {
+   case BENCH_FILTER_NONE:
+   case BENCH_FILTER_NEAREST:
+      sampler.min_img_filter = PIPE_TEX_FILTER_NEAREST;
+      sampler.mag_img_filter = PIPE_TEX_FILTER_NEAREST;
+      sampler.min_mip_filter = PIPE_TEX_MIPFILTER_NONE;
+      break;
+   case BENCH_FILTER_LINEAR:
+      sampler.min_img_filter = PIPE_TEX_FILTER_LINEAR;
+      sampler.mag_img_filter = PIPE_TEX_FILTER_LINEAR;
+      sampler.min_mip_filter = PIPE_TEX_MIPFILTER_NONE;
+      break;
+   case BENCH_FILTER_TRILINEAR:
+      sampler.min_img_filter = PIPE_TEX_FILTER_LINEAR;
+      sampler.mag_img_filter = PIPE_TEX_FILTER_LINEAR;
+      sampler.min_mip_filter = PIPE_TEX_MIPFILTER_LINEAR;
+      break;
+   }
+
+   return pipe->create_sampler_state(pipe, &sampler);
+}
+
+
+static int
+compare_cycles(const void *a, const void *b)
+{
+   const uint64_t x = *(const uint64_t *)a;
+   const uint64_t y = *(const uint64_t *)b;
+
+   return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+
+void
+write_tsv_header(FILE *fp)
+{
+   fprintf(fp,
+           "case\t"
+           "format\t"
+           "filter\t"
+           "blend\t"
+           "size\t"
+           "items\t"
+           "median_cycles\t"
+           "p99_cycles\t"
+           "cycles_per_item\n");
+
+   fflush(fp);
+}
+
+
+static void
+write_tsv_row(FILE *fp,
+              const struct bench_case *bc,
+              unsigned items,
+              uint64_t median,
+              uint64_t p99)
+{
+   fprintf(fp, "%s\t%s\t%s\t%s\t%u\t%u\t%llu\t%llu\t%.3f\n",
+           bench_kind_names[bc->kind],
+           bc->format != PIPE_FORMAT_NONE ? util_format_short_name(bc->format) : "-",
+           bench_filter_names[bc->filter],
+           bench_blend_names[bc->blend],
+           bc->size,
+           items,
+           (unsigned long long)median,
+           (unsigned long long)p99,
+           (double)median / items);
+
+   fflush(fp);
+}
+
+
+static boolean
+run_case(struct bench_context *bench,
+         const struct bench_case *bc,
+         unsigned verbose,
+         FILE *fp)
+{
+   struct pipe_context *pipe = bench->pipe;
+   const union pipe_color_union clear_color = { { 0.25f, 0.5f, 0.75f, 1.0f } };
+   struct pipe_resource *tex = NULL;
+   struct pipe_sampler_view *view = NULL;
+   void *sampler = NULL;
+   void *blend;
+   struct bench_vertex *verts = NULL;
+   struct pipe_vertex_buffer vbuf;
+   uint64_t cycles[LP_BENCH_NUM_SAMPLES];
+   unsigned num_verts = 0;
+   unsigned items, repeat = 1;
+   unsigned i, j;
+
+   blend = create_blend(pipe, bc->blend);
+   pipe->bind_blend_state(pipe, blend);
+
+   switch (bc->kind) {
+   case BENCH_CLEAR:
+      items = LP_BENCH_FB_SIZE * LP_BENCH_FB_SIZE;
+      break;
+
+   case BENCH_SETUP:
+   case BENCH_TRIANGLES:
+      if (bc->kind == BENCH_SETUP)
+         items = LP_BENCH_MAX_TRIANGLES;
+      else
+         items = CLAMP(LP_BENCH_PIXELS * 2 / (bc->size * bc->size),
+                       1, LP_BENCH_MAX_TRIANGLES);
+      verts = MALLOC(items * 3 * sizeof *verts);
+      if (!verts)
+         goto fail;
+      num_verts = make_triangles(verts, bc->size, items);
+      if (bc->kind == BENCH_TRIANGLES)
+         items = items * bc->size * bc->size / 2;
+      break;
+
+   case BENCH_TEXTURE:
+   case BENCH_BLEND:
+      verts = MALLOC(6 * sizeof *verts);
+      if (!verts)
+         goto fail;
+      num_verts = make_quad(verts, bc->size);
+      repeat = MAX2(LP_BENCH_PIXELS / (bc->size * bc->size), 1);
+      items = bc->size * bc->size * repeat;
+      break;
+
+   default:
+      assert(0);
+      goto fail;
+   }
+
+   if (bc->kind == BENCH_TEXTURE) {
+      struct pipe_sampler_view templat;
+
+      tex = create_texture(bench, bc->format);
+      if (!tex)
+         goto fail;
+
+      u_sampler_view_default_template(&templat, tex, bc->format);
+      view = pipe->create_sampler_view(pipe, tex, &templat);
+      sampler = create_sampler(pipe, bc->filter);
+      if (!view || !sampler)
+         goto fail;
+
+      pipe->set_sampler_views(pipe, PIPE_SHADER_FRAGMENT, 0, 1, &view);
+      pipe->bind_sampler_states(pipe, PIPE_SHADER_FRAGMENT, 0, 1, &sampler);
+      pipe->bind_fs_state(pipe, bench->fs_tex);
+   }
+   else {
+      pipe->bind_fs_state(pipe, bench->fs_color);
+   }
+
+   if (verts) {
+      memset(&vbuf, 0, sizeof vbuf);
+      vbuf.stride = sizeof *verts;
+      vbuf.user_buffer = verts;
+      pipe->set_vertex_buffers(pipe, 0, 1, &vbuf);
+   }
+
+   /* The first run is untimed, it compiles the shader variants */
+   for (i = 0; i <= LP_BENCH_NUM_SAMPLES; i++) {
+      uint64_t start, end;
+
+      pipe->clear(pipe, PIPE_CLEAR_COLOR, &clear_color, 0.0, 0);
+      llvmpipe_finish(pipe, __FUNCTION__);
+
+      start = rdtsc();
+
+      if (bc->kind == BENCH_CLEAR) {
+         pipe->clear(pipe, PIPE_CLEAR_COLOR, &clear_color, 0.0, 0);
+      }
+      else {
+         for (j = 0; j < repeat; j++)
+            util_draw_arrays(pipe, PIPE_PRIM_TRIANGLES, 0, num_verts);
+      }
+      llvmpipe_finish(pipe, __FUNCTION__);
+
+      end = rdtsc();
+
+      if (i > 0)
+         cycles[i - 1] = end - start;
+   }
+
+   qsort(cycles, LP_BENCH_NUM_SAMPLES, sizeof cycles[0], compare_cycles);
+
+   if (fp)
+      write_tsv_row(fp, bc, items, cycles[LP_BENCH_NUM_SAMPLES / 2],
+                    cycles[LP_BENCH_NUM_SAMPLES * 99 / 100]);
+
+   if (verbose >= 1) {
+      printf("%-10s %-22s %-10s %-5s %4u: %10.3f cycles/%s\n",
+             bench_kind_names[bc->kind],
+             bc->format != PIPE_FORMAT_NONE ? util_format_short_name(bc->format) : "-",
+             bench_filter_names[bc->filter],
+             bench_blend_names[bc->blend],
+             bc->size,
+             (double)cycles[LP_BENCH_NUM_SAMPLES / 2] / items,
+             bc->kind == BENCH_SETUP ? "triangle" : "pixel");
+      fflush(stdout);
+   }
+
+   pipe->set_vertex_buffers(pipe, 0, 1, NULL);
+   if (bc->kind == BENCH_TEXTURE) {
+      pipe->set_sampler_views(pipe, PIPE_SHADER_FRAGMENT, 0, 1, NULL);
+      pipe->bind_sampler_states(pipe, PIPE_SHADER_FRAGMENT, 0, 1, NULL);
+   }
+   pipe->bind_blend_state(pipe, NULL);
+   pipe->delete_blend_state(pipe, blend);
+   if (sampler)
+      pipe->delete_sampler_state(pipe, sampler);
+   pipe_sampler_view_reference(&view, NULL);
+   pipe_resource_reference(&tex, NULL);
+   FREE(verts);
+   return TRUE;
+
+fail:
+   pipe->bind_blend_state(pipe, NULL);
+   pipe->delete_blend_state(pipe, blend);
+   if (sampler)
+      pipe->delete_sampler_state(pipe, sampler);
+   pipe_sampler_view_reference(&view, NULL);
+   pipe_resource_reference(&tex, NULL);
+   FREE(verts);
+   return FALSE;
+}
+
+
+boolean
+test_all(unsigned verbose, FILE *fp)
+{
+   struct bench_context bench;
+   boolean success = TRUE;
+   unsigned i;
+
+   if (!bench_init(&bench)) {
+      bench_fini(&bench);
+      return FALSE;
+   }
+
+   for (i = 0; i < Elements(bench_cases); i++) {
+      if (!run_case(&bench, &bench_cases[i], verbose, fp))
+         success = FALSE;
+   }
+
+   bench_fini(&bench);
+   return success;
+}
+
+
+boolean
+test_some(unsigned verbose, FILE *fp,
+          unsigned long n)
+{
+   struct bench_context bench;
+   boolean success = TRUE;
+   unsigned long i;
+
+   if (!bench_init(&bench)) {
+      bench_fini(&bench);
+      return FALSE;
+   }
+
+   for (i = 0; i < n; i++) {
+      const struct bench_case *bc = &bench_cases[rand() % Elements(bench_cases)];
+      if (!run_case(&bench, bc, verbose, fp))
+         success = FALSE;
+   }
+
+   bench_fini(&bench);
+   return success;
+}
+
+
+boolean
+test_single(unsigned verbose, FILE *fp)
+{
+   printf("no test_single()");
+   return TRUE;
+}
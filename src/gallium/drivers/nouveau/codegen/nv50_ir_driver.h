@@ -208,6 +208,9 @@ extern void nv50_ir_relocate_code(void *relocData, uint32_t *code,
                                   uint32_t libPos,
                                   uint32_t dataPos);
 
+/* size in bytes of the relocation data, for making copies of it */
+extern uint32_t nv50_ir_reloc_data_size(const void *relocData);
+
 /* obtain code that will be shared among programs */
 extern void nv50_ir_get_target_library(uint32_t chipset,
                                        const uint32_t **code, uint32_t *size);
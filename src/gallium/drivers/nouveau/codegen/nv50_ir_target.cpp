@@ -458,6 +458,15 @@ nv50_ir_relocate_code(void *relocData, uint32_t *code,
       info->entry[i].apply(code, info);
 }
 
+uint32_t
+nv50_ir_reloc_data_size(const void *relocData)
+{
+   const nv50_ir::RelocInfo *info =
+      reinterpret_cast<const nv50_ir::RelocInfo *>(relocData);
+
+   return sizeof(nv50_ir::RelocInfo) + info->count * sizeof(nv50_ir::RelocEntry);
+}
+
 void
 nv50_ir_get_target_library(uint32_t chipset,
                            const uint32_t **code, uint32_t *size)
@@ -327,6 +327,57 @@ nouveau_buffer_cache(struct nouveau_context *nv, struct nv04_resource *buf)
 #define NOUVEAU_TRANSFER_DISCARD \
    (PIPE_TRANSFER_DISCARD_RANGE | PIPE_TRANSFER_DISCARD_WHOLE_RESOURCE)
 
+/* After this many reads of VRAM contents that each required a GPU copy and
+ * a wait, the buffer is assumed to be read back regularly and moved to GART.
+ */
+#define NOUVEAU_BUFFER_VRAM_READS_MIGRATE 4
+
+/* Move a buffer that is read back by the CPU more than it is updated by it
+ * into GART, where all later reads can map the storage directly instead of
+ * going through a staging copy.
+ */
+static void
+nouveau_buffer_update_placement(struct nouveau_context *nv,
+                                struct nv04_resource *buf, unsigned usage)
+{
+   struct nouveau_screen *screen = nv->screen;
+   int ref;
+
+   if (usage & NOUVEAU_TRANSFER_DISCARD) {
+      buf->vram_reads = 0;
+      return;
+   }
+   /* only count reads that can't be served from the system memory copy */
+   if (!(usage & PIPE_TRANSFER_READ) ||
+       (buf->data && !(buf->status & (NOUVEAU_BUFFER_STATUS_GPU_WRITING |
+                                      NOUVEAU_BUFFER_STATUS_DIRTY))))
+      return;
+
+   if (buf->base.bind & ~screen->sysmem_bindings)
+      return;
+   if (++buf->vram_reads < NOUVEAU_BUFFER_VRAM_READS_MIGRATE)
+      return;
+   if (!nouveau_buffer_migrate(nv, buf, NOUVEAU_BO_GART))
+      return;
+
+   /* the copy was queued in the current pushbuf */
+   buf->status |= NOUVEAU_BUFFER_STATUS_GPU_WRITING;
+   nouveau_fence_ref(screen->fence.current, &buf->fence);
+   nouveau_fence_ref(screen->fence.current, &buf->fence_wr);
+
+   if (buf->data) {
+      align_free(buf->data);
+      buf->data = NULL;
+   }
+   buf->status &= ~NOUVEAU_BUFFER_STATUS_DIRTY;
+
+   ref = buf->base.reference.count - 1;
+   if (ref > 0)
+      nv->invalidate_resource_storage(nv, &buf->base, ref);
+
+   NOUVEAU_DRV_STAT(screen, buf_migrate_count_sys, 1);
+}
+
 /* Checks whether it is possible to completely discard the memory backing this
  * resource. This can be useful if we would otherwise have to wait for a read
  * operation to complete on this data.
@@ -387,6 +438,10 @@ nouveau_buffer_transfer_map(struct pipe_context *pipe,
    if (usage & PIPE_TRANSFER_WRITE)
       NOUVEAU_DRV_STAT(nv->screen, buf_transfers_wr, 1);
 
+   /* This may move the buffer to GART. */
+   if (buf->domain == NOUVEAU_BO_VRAM)
+      nouveau_buffer_update_placement(nv, buf, usage);
+
    if (buf->domain == NOUVEAU_BO_VRAM) {
       if (usage & NOUVEAU_TRANSFER_DISCARD) {
          /* Set up a staging area for the user to write to. It will be copied
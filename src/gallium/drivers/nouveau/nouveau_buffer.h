@@ -39,6 +39,8 @@ struct nv04_resource {
 
    uint8_t status;
    uint8_t domain;
+   /* number of CPU reads of VRAM contents since the last discarding map */
+   uint8_t vram_reads;
 
    struct nouveau_fence *fence;
    struct nouveau_fence *fence_wr;
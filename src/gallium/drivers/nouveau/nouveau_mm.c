@@ -4,6 +4,7 @@
 #include "util/u_inlines.h"
 #include "util/u_memory.h"
 #include "util/u_double_list.h"
+#include "os/os_thread.h"
 
 #include "nouveau_winsys.h"
 #include "nouveau_screen.h"
@@ -31,12 +32,21 @@ struct mm_bucket {
    int num_free;
 };
 
+/* Number of unused allocation structs kept around for reuse. */
+#define MM_MAX_SPARE_ALLOCS 256
+
 struct nouveau_mman {
    struct nouveau_device *dev;
    struct mm_bucket bucket[MM_NUM_BUCKETS];
    uint32_t domain;
    union nouveau_bo_config config;
    uint64_t allocated;
+   /* The buckets are shared by all contexts of the screen, and allocations
+    * are also released from fence callbacks, so protect them. */
+   pipe_mutex lock;
+   /* Recycled allocation structs, linked through next. */
+   struct nouveau_mm_allocation *spare;
+   int num_spare;
 };
 
 struct mm_slab {
@@ -181,11 +191,30 @@ nouveau_mm_allocate(struct nouveau_mman *cache,
       return NULL;
    }
 
+   pipe_mutex_lock(cache->lock);
+
+   if (cache->spare) {
+      alloc = cache->spare;
+      cache->spare = alloc->next;
+      cache->num_spare--;
+   } else {
+      alloc = MALLOC_STRUCT(nouveau_mm_allocation);
+      if (!alloc) {
+         pipe_mutex_unlock(cache->lock);
+         return NULL;
+      }
+   }
+
    if (!LIST_IS_EMPTY(&bucket->used)) {
       slab = LIST_ENTRY(struct mm_slab, bucket->used.next, head);
    } else {
-      if (LIST_IS_EMPTY(&bucket->free)) {
-         mm_slab_new(cache, MAX2(mm_get_order(size), MM_MIN_ORDER));
+      if (LIST_IS_EMPTY(&bucket->free) &&
+          mm_slab_new(cache, MAX2(mm_get_order(size), MM_MIN_ORDER))) {
+         alloc->next = cache->spare;
+         cache->spare = alloc;
+         cache->num_spare++;
+         pipe_mutex_unlock(cache->lock);
+         return NULL;
       }
       slab = LIST_ENTRY(struct mm_slab, bucket->free.next, head);
 
@@ -195,10 +224,6 @@ nouveau_mm_allocate(struct nouveau_mman *cache,
 
    *offset = mm_slab_alloc(slab) << slab->order;
 
-   alloc = MALLOC_STRUCT(nouveau_mm_allocation);
-   if (!alloc)
-      return NULL;
-
    nouveau_bo_ref(slab->bo, bo);
 
    if (slab->free == 0) {
@@ -206,6 +231,8 @@ nouveau_mm_allocate(struct nouveau_mman *cache,
       LIST_ADD(&slab->head, &bucket->full);
    }
 
+   pipe_mutex_unlock(cache->lock);
+
    alloc->next = NULL;
    alloc->offset = *offset;
    alloc->priv = (void *)slab;
@@ -217,7 +244,10 @@ void
 nouveau_mm_free(struct nouveau_mm_allocation *alloc)
 {
    struct mm_slab *slab = (struct mm_slab *)alloc->priv;
-   struct mm_bucket *bucket = mm_bucket_by_order(slab->cache, slab->order);
+   struct nouveau_mman *cache = slab->cache;
+   struct mm_bucket *bucket = mm_bucket_by_order(cache, slab->order);
+
+   pipe_mutex_lock(cache->lock);
 
    mm_slab_free(slab, alloc->offset >> slab->order);
 
@@ -230,6 +260,15 @@ nouveau_mm_free(struct nouveau_mm_allocation *alloc)
       LIST_ADDTAIL(&slab->head, &bucket->used);
    }
 
+   if (cache->num_spare < MM_MAX_SPARE_ALLOCS) {
+      alloc->next = cache->spare;
+      cache->spare = alloc;
+      cache->num_spare++;
+      alloc = NULL;
+   }
+
+   pipe_mutex_unlock(cache->lock);
+
    FREE(alloc);
 }
 
@@ -253,6 +292,9 @@ nouveau_mm_create(struct nouveau_device *dev, uint32_t domain,
    cache->domain = domain;
    cache->config = *config;
    cache->allocated = 0;
+   cache->spare = NULL;
+   cache->num_spare = 0;
+   pipe_mutex_init(cache->lock);
 
    for (i = 0; i < MM_NUM_BUCKETS; ++i) {
       LIST_INITHEAD(&cache->bucket[i].free);
@@ -294,5 +336,12 @@ nouveau_mm_destroy(struct nouveau_mman *cache)
       nouveau_mm_free_slabs(&cache->bucket[i].full);
    }
 
+   while (cache->spare) {
+      struct nouveau_mm_allocation *alloc = cache->spare;
+      cache->spare = alloc->next;
+      FREE(alloc);
+   }
+   pipe_mutex_destroy(cache->lock);
+
    FREE(cache);
 }
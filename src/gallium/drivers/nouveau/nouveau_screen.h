@@ -58,7 +58,7 @@ struct nouveau_screen {
 
 #ifdef NOUVEAU_ENABLE_DRIVER_STATISTICS
    union {
-      uint64_t v[29];
+      uint64_t v[32];
       struct {
          uint64_t tex_obj_current_count;
          uint64_t tex_obj_current_bytes;
@@ -77,6 +77,7 @@ struct nouveau_screen {
          uint64_t buf_write_bytes_staging_vid;
          uint64_t buf_write_bytes_staging_sys;
          uint64_t buf_copy_bytes;
+         uint64_t buf_migrate_count_sys;
          uint64_t buf_non_kernel_fence_sync_count;
          uint64_t any_non_kernel_fence_sync_count;
          uint64_t query_sync_count;
@@ -88,6 +89,8 @@ struct nouveau_screen {
          uint64_t constbuf_upload_count;
          uint64_t constbuf_upload_bytes;
          uint64_t pushbuf_count;
+         uint64_t state_words_emitted;
+         uint64_t state_words_elided;
          uint64_t resource_validate_count;
       } named;
    } stats;
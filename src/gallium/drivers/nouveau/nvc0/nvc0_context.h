@@ -92,6 +92,8 @@
 #define NVC0_BIND_M2MF          0
 #define NVC0_BIND_FENCE         1
 
+/* number of 3D methods below the macro range, which are shadowed */
+#define NVC0_3D_SHADOW_SIZE   (0x3800 / 4)
 
 struct nvc0_blitctx;
 
@@ -144,6 +146,14 @@ struct nvc0_context {
    struct nvc0_zsa_stateobj *zsa;
    struct nvc0_vertex_stateobj *vertex;
 
+   /* Last values written to the 3D methods emitted through
+    * nvc0_3d_shadow_update, so unchanged state isn't sent again.
+    */
+   struct {
+      uint32_t data[NVC0_3D_SHADOW_SIZE];
+      uint32_t valid[NVC0_3D_SHADOW_SIZE / 32];
+   } shadow_3d;
+
    struct nvc0_program *vertprog;
    struct nvc0_program *tctlprog;
    struct nvc0_program *tevlprog;
@@ -213,6 +223,34 @@ nvc0_context(struct pipe_context *pipe)
    return (struct nvc0_context *)pipe;
 }
 
+/* Returns TRUE if the method has to be emitted, i.e. if its value differs
+ * from the one the hardware was last sent, and records the new value.
+ * Macro methods aren't tracked and always have to be emitted.
+ */
+static INLINE boolean
+nvc0_3d_shadow_update(struct nvc0_context *nvc0, unsigned mthd, uint32_t data)
+{
+   const unsigned i = mthd / 4;
+
+   if (i >= NVC0_3D_SHADOW_SIZE)
+      return TRUE;
+   if ((nvc0->shadow_3d.valid[i / 32] & (1 << (i % 32))) &&
+       nvc0->shadow_3d.data[i] == data)
+      return FALSE;
+   nvc0->shadow_3d.data[i] = data;
+   nvc0->shadow_3d.valid[i / 32] |= 1 << (i % 32);
+   return TRUE;
+}
+
+/* Must be called whenever 3D methods are written without going through
+ * nvc0_3d_shadow_update, or when the hardware state is unknown.
+ */
+static INLINE void
+nvc0_3d_shadow_invalidate(struct nvc0_context *nvc0)
+{
+   memset(nvc0->shadow_3d.valid, 0, sizeof(nvc0->shadow_3d.valid));
+}
+
 static INLINE unsigned
 nvc0_shader_stage(unsigned pipe)
 {
@@ -241,6 +279,8 @@ extern struct draw_stage *nvc0_draw_render_stage(struct nvc0_context *);
 
 /* nvc0_program.c */
 boolean nvc0_program_translate(struct nvc0_program *, uint16_t chipset);
+boolean nvc0_program_translate_cached(struct nvc0_screen *, struct nvc0_program *);
+void nvc0_program_cache_destroy(struct nvc0_screen *);
 boolean nvc0_program_upload_code(struct nvc0_context *, struct nvc0_program *);
 void nvc0_program_destroy(struct nvc0_context *, struct nvc0_program *);
 void nvc0_program_library_upload(struct nvc0_context *);
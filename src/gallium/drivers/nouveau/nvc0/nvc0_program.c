@@ -22,6 +22,10 @@
 
 #include "pipe/p_defines.h"
 
+#include "tgsi/tgsi_parse.h"
+#include "util/u_hash.h"
+#include "util/u_hash_table.h"
+
 #include "nvc0/nvc0_context.h"
 
 #include "codegen/nv50_ir_driver.h"
@@ -649,6 +653,208 @@ out:
    return !ret;
 }
 
+/* Translated programs are kept in a per-screen cache, so that creating the
+ * same shader again (e.g. in another context, or after the state tracker
+ * dropped its CSO) doesn't have to go through the compiler again.
+ */
+#define NVC0_PROG_CACHE_MAX_SIZE 4096
+
+struct nvc0_program_key {
+   uint32_t hash;
+   unsigned size;
+   /* chipset, type, num_ucps, stream output info and TGSI tokens */
+   uint8_t data[0];
+};
+
+struct nvc0_program_cache_entry {
+   struct nvc0_program_key *key;
+   struct nvc0_program prog;
+};
+
+static unsigned
+nvc0_program_key_hash(void *key)
+{
+   return ((struct nvc0_program_key *)key)->hash;
+}
+
+static int
+nvc0_program_key_compare(void *key1, void *key2)
+{
+   struct nvc0_program_key *a = key1;
+   struct nvc0_program_key *b = key2;
+
+   if (a->size != b->size)
+      return 1;
+   return memcmp(a->data, b->data, a->size);
+}
+
+static struct nvc0_program_key *
+nvc0_program_key_create(struct nvc0_program *prog, uint16_t chipset)
+{
+   const unsigned num_tokens = tgsi_num_tokens(prog->pipe.tokens);
+   const unsigned size = 3 * sizeof(uint32_t) +
+      sizeof(prog->pipe.stream_output) + num_tokens * sizeof(struct tgsi_token);
+   struct nvc0_program_key *key;
+   uint32_t *data;
+
+   key = CALLOC(1, sizeof(*key) + size);
+   if (!key)
+      return NULL;
+   data = (uint32_t *)key->data;
+   data[0] = chipset;
+   data[1] = prog->type;
+   data[2] = prog->vp.num_ucps;
+   memcpy(&data[3], &prog->pipe.stream_output, sizeof(prog->pipe.stream_output));
+   memcpy(key->data + 3 * sizeof(uint32_t) + sizeof(prog->pipe.stream_output),
+          prog->pipe.tokens, num_tokens * sizeof(struct tgsi_token));
+
+   key->size = size;
+   key->hash = util_hash_crc32(key->data, size);
+   return key;
+}
+
+static void *
+nvc0_program_dup_data(const void *src, unsigned size)
+{
+   void *dst;
+
+   if (!src)
+      return NULL;
+   dst = MALLOC(size);
+   if (dst)
+      memcpy(dst, src, size);
+   return dst;
+}
+
+/* Like nvc0_program_destroy, but for programs that are not bound anywhere. */
+static void
+nvc0_program_free_translated(struct nvc0_program *prog)
+{
+   const struct pipe_shader_state pipe = prog->pipe;
+   const ubyte type = prog->type;
+
+   FREE(prog->code);
+   FREE(prog->immd_data);
+   FREE(prog->relocs);
+   FREE(prog->tfb);
+
+   memset(prog, 0, sizeof(*prog));
+
+   prog->pipe = pipe;
+   prog->type = type;
+}
+
+/* Copy the results of translation, but not the TGSI or state that depends
+ * on where the code is uploaded.
+ */
+static boolean
+nvc0_program_copy_translated(struct nvc0_program *dst,
+                             const struct nvc0_program *src)
+{
+   const struct pipe_shader_state pipe = dst->pipe;
+
+   *dst = *src;
+   dst->pipe = pipe;
+   dst->mem = NULL;
+   dst->code_base = 0;
+   dst->immd_base = 0;
+
+   dst->code = nvc0_program_dup_data(src->code, src->code_size);
+   dst->immd_data = nvc0_program_dup_data(src->immd_data, src->immd_size);
+   dst->relocs = src->relocs ?
+      nvc0_program_dup_data(src->relocs,
+                            nv50_ir_reloc_data_size(src->relocs)) : NULL;
+   dst->tfb = nvc0_program_dup_data(src->tfb, sizeof(*src->tfb));
+
+   if ((src->code && !dst->code) || (src->immd_data && !dst->immd_data) ||
+       (src->relocs && !dst->relocs) || (src->tfb && !dst->tfb)) {
+      nvc0_program_free_translated(dst);
+      return FALSE;
+   }
+   return TRUE;
+}
+
+boolean
+nvc0_program_translate_cached(struct nvc0_screen *screen,
+                              struct nvc0_program *prog)
+{
+   const uint16_t chipset = screen->base.device->chipset;
+   struct nvc0_program_cache_entry *entry;
+   struct nvc0_program_key *key;
+   const ubyte num_ucps = prog->vp.num_ucps;
+
+   if (!prog->pipe.tokens || prog->type == PIPE_SHADER_COMPUTE)
+      return nvc0_program_translate(prog, chipset);
+
+   if (!screen->prog_cache) {
+      screen->prog_cache = util_hash_table_create(nvc0_program_key_hash,
+                                                  nvc0_program_key_compare);
+      if (!screen->prog_cache)
+         return nvc0_program_translate(prog, chipset);
+   }
+
+   key = nvc0_program_key_create(prog, chipset);
+   if (!key)
+      return nvc0_program_translate(prog, chipset);
+
+   entry = util_hash_table_get(screen->prog_cache, key);
+   if (entry && nvc0_program_copy_translated(prog, &entry->prog)) {
+      FREE(key);
+      return TRUE;
+   }
+
+   prog->vp.num_ucps = num_ucps;
+   if (!nvc0_program_translate(prog, chipset)) {
+      FREE(key);
+      return FALSE;
+   }
+
+   if (entry || screen->prog_cache_size >= NVC0_PROG_CACHE_MAX_SIZE) {
+      FREE(key);
+      return TRUE;
+   }
+
+   entry = CALLOC_STRUCT(nvc0_program_cache_entry);
+   if (!entry || !nvc0_program_copy_translated(&entry->prog, prog)) {
+      FREE(entry);
+      FREE(key);
+      return TRUE;
+   }
+   entry->key = key;
+   if (util_hash_table_set(screen->prog_cache, key, entry) != PIPE_OK) {
+      nvc0_program_free_translated(&entry->prog);
+      FREE(entry);
+      FREE(key);
+      return TRUE;
+   }
+   screen->prog_cache_size++;
+   return TRUE;
+}
+
+static enum pipe_error
+nvc0_program_cache_entry_destroy(void *key, void *value, void *data)
+{
+   struct nvc0_program_cache_entry *entry = value;
+
+   nvc0_program_free_translated(&entry->prog);
+   FREE(entry->key);
+   FREE(entry);
+   return PIPE_OK;
+}
+
+void
+nvc0_program_cache_destroy(struct nvc0_screen *screen)
+{
+   if (!screen->prog_cache)
+      return;
+
+   util_hash_table_foreach(screen->prog_cache,
+                           nvc0_program_cache_entry_destroy, NULL);
+   util_hash_table_destroy(screen->prog_cache);
+   screen->prog_cache = NULL;
+   screen->prog_cache_size = 0;
+}
+
 boolean
 nvc0_program_upload_code(struct nvc0_context *nvc0, struct nvc0_program *prog)
 {
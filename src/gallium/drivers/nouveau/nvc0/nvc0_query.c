@@ -650,6 +650,7 @@ static const char *nvc0_drv_stat_names[] =
    "drv-buf_write_bytes_staging_vid",
    "drv-buf_write_bytes_staging_sys",
    "drv-buf_copy_bytes",
+   "drv-buf_migrate_count_sys",
    "drv-buf_non_kernel_fence_sync_count",
    "drv-any_non_kernel_fence_sync_count",
    "drv-query_sync_count",
@@ -661,6 +662,8 @@ static const char *nvc0_drv_stat_names[] =
    "drv-constbuf_upload_count",
    "drv-constbuf_upload_bytes",
    "drv-pushbuf_count",
+   "drv-state_words_emitted",
+   "drv-state_words_elided",
    "drv-resource_validate_count"
 };
 
@@ -11,6 +11,8 @@
 #include "nvc0/nvc0_winsys.h"
 #include "nvc0/nvc0_stateobj.h"
 
+struct util_hash_table;
+
 #define NVC0_TIC_MAX_ENTRIES 2048
 #define NVC0_TSC_MAX_ENTRIES 2048
 
@@ -29,6 +31,9 @@ struct nvc0_screen {
 
    struct nvc0_context *cur_ctx;
 
+   struct util_hash_table *prog_cache; /* translated programs, by TGSI */
+   unsigned prog_cache_size;
+
    int num_occlusion_queries_active;
 
    struct nouveau_bo *text;
@@ -201,7 +206,7 @@ nvc0_screen(struct pipe_screen *screen)
 #ifdef NOUVEAU_ENABLE_DRIVER_STATISTICS
 
 #define NVC0_QUERY_DRV_STAT(i)    (PIPE_QUERY_DRIVER_SPECIFIC + 1024 + (i))
-#define NVC0_QUERY_DRV_STAT_COUNT  29
+#define NVC0_QUERY_DRV_STAT_COUNT  32
 #define NVC0_QUERY_DRV_STAT_LAST   NVC0_QUERY_DRV_STAT(NVC0_QUERY_DRV_STAT_COUNT - 1)
 #define NVC0_QUERY_DRV_STAT_TEX_OBJECT_CURRENT_COUNT         0
 #define NVC0_QUERY_DRV_STAT_TEX_OBJECT_CURRENT_BYTES         1
@@ -352,31 +352,75 @@ nvc0_validate_clip(struct nvc0_context *nvc0)
    }
 }
 
+/* Emit a pre-built state object, leaving out the methods whose value the
+ * hardware already has. State objects only contain incrementing (SQ) and
+ * inline data (IL) packets, so the result never needs more space than the
+ * object itself.
+ */
 static void
-nvc0_validate_blend(struct nvc0_context *nvc0)
+nvc0_emit_stateobj(struct nvc0_context *nvc0,
+                   const uint32_t *state, unsigned size)
 {
    struct nouveau_pushbuf *push = nvc0->base.pushbuf;
+   unsigned i = 0;
+   NOUVEAU_DRV_STAT_IFD(uint32_t *start);
+
+   PUSH_SPACE(push, size);
+   NOUVEAU_DRV_STAT_IFD(start = push->cur);
+
+   while (i < size) {
+      const uint32_t hdr = state[i++];
+      const int subc = (hdr >> 13) & 7;
+      const int mthd = (hdr & 0x1fff) << 2;
+      const unsigned count = (hdr >> 16) & 0x1fff;
+      unsigned k, n;
+
+      if ((hdr >> 29) == 4) {
+         if (nvc0_3d_shadow_update(nvc0, mthd, count))
+            PUSH_DATA (push, hdr);
+         continue;
+      }
+      assert((hdr >> 29) == 1);
+
+      for (k = 0; k < count; k = n) {
+         if (!nvc0_3d_shadow_update(nvc0, mthd + k * 4, state[i + k])) {
+            n = k + 1;
+            continue;
+         }
+         for (n = k + 1; n < count; ++n)
+            if (!nvc0_3d_shadow_update(nvc0, mthd + n * 4, state[i + n]))
+               break;
+         PUSH_DATA (push, NVC0_FIFO_PKHDR_SQ(subc, mthd + k * 4, n - k));
+         PUSH_DATAp(push, &state[i + k], n - k);
+         /* the method that ended the run was found to be unchanged */
+         if (n < count)
+            ++n;
+      }
+      i += count;
+   }
 
-   PUSH_SPACE(push, nvc0->blend->size);
-   PUSH_DATAp(push, nvc0->blend->state, nvc0->blend->size);
+   NOUVEAU_DRV_STAT(&nvc0->screen->base, state_words_emitted,
+                    push->cur - start);
+   NOUVEAU_DRV_STAT(&nvc0->screen->base, state_words_elided,
+                    size - (push->cur - start));
 }
 
 static void
-nvc0_validate_zsa(struct nvc0_context *nvc0)
+nvc0_validate_blend(struct nvc0_context *nvc0)
 {
-   struct nouveau_pushbuf *push = nvc0->base.pushbuf;
+   nvc0_emit_stateobj(nvc0, nvc0->blend->state, nvc0->blend->size);
+}
 
-   PUSH_SPACE(push, nvc0->zsa->size);
-   PUSH_DATAp(push, nvc0->zsa->state, nvc0->zsa->size);
+static void
+nvc0_validate_zsa(struct nvc0_context *nvc0)
+{
+   nvc0_emit_stateobj(nvc0, nvc0->zsa->state, nvc0->zsa->size);
 }
 
 static void
 nvc0_validate_rasterizer(struct nvc0_context *nvc0)
 {
-   struct nouveau_pushbuf *push = nvc0->base.pushbuf;
-
-   PUSH_SPACE(push, nvc0->rast->size);
-   PUSH_DATAp(push, nvc0->rast->state, nvc0->rast->size);
+   nvc0_emit_stateobj(nvc0, nvc0->rast->state, nvc0->rast->size);
 }
 
 static void
@@ -502,6 +546,7 @@ nvc0_switch_pipe_context(struct nvc0_context *ctx_to)
       ctx_to->state = ctx_from->state;
 
    ctx_to->dirty = ~0;
+   nvc0_3d_shadow_invalidate(ctx_to);
 
    for (s = 0; s < 5; ++s) {
       ctx_to->samplers_dirty[s] = ~0;
@@ -26,6 +26,7 @@
 #include "pipe/p_state.h"
 #include "pipe/p_context.h"
 #include "util/u_blitter.h"
+#include "util/u_box.h"
 #include "util/u_double_list.h"
 #include "util/u_transfer.h"
 #include "util/u_surface.h"
@@ -42,6 +43,14 @@
 #include "evergreen_compute_internal.h"
 #include <inttypes.h>
 
+#define ITEM_ALIGNMENT 1024
+
+/* Chunks start on ITEM_ALIGNMENT dword boundaries. */
+static int64_t compute_memory_align(int64_t size_in_dw)
+{
+	return (size_in_dw + ITEM_ALIGNMENT - 1) & ~(int64_t)(ITEM_ALIGNMENT - 1);
+}
+
 /**
  * Creates a new pool
  */
@@ -54,6 +63,9 @@ struct compute_memory_pool* compute_memory_pool_new(
 	COMPUTE_DBG(rscreen, "* compute_memory_pool_new()\n");
 
 	pool->screen = rscreen;
+	pool->next_id = 1;
+	LIST_INITHEAD(&pool->item_list);
+	LIST_INITHEAD(&pool->unallocated_list);
 	return pool;
 }
 
@@ -64,8 +76,6 @@ static void compute_memory_pool_init(struct compute_memory_pool * pool,
 	COMPUTE_DBG(pool->screen, "* compute_memory_pool_init() initial_size_in_dw = %ld\n",
 		initial_size_in_dw);
 
-	pool->shadow = (uint32_t*)CALLOC(initial_size_in_dw, 4);
-	pool->next_id = 1;
 	pool->size_in_dw = initial_size_in_dw;
 	pool->bo = (struct r600_resource*)r600_compute_buffer_alloc_vram(pool->screen,
 							pool->size_in_dw * 4);
@@ -77,7 +87,6 @@ static void compute_memory_pool_init(struct compute_memory_pool * pool,
 void compute_memory_pool_delete(struct compute_memory_pool* pool)
 {
 	COMPUTE_DBG(pool->screen, "* compute_memory_pool_delete()\n");
-	free(pool->shadow);
 	if (pool->bo) {
 		pool->screen->b.b.resource_destroy((struct pipe_screen *)
 			pool->screen, (struct pipe_resource *)pool->bo);
@@ -86,125 +95,97 @@ void compute_memory_pool_delete(struct compute_memory_pool* pool)
 }
 
 /**
- * Searches for an empty space in the pool, return with the pointer to the
- * allocatable space in the pool, returns -1 on failure.
+ * Searches for an empty space in the pool, returns the start of the space
+ * and the item to link the new chunk after, or -1 on failure.
+ *
+ * The space after the last chunk is tried first, so allocations don't walk
+ * the list as long as the pool has room at the end.  The holes between the
+ * chunks are only searched if there is enough free space in total.
  */
 int64_t compute_memory_prealloc_chunk(
 	struct compute_memory_pool* pool,
-	int64_t size_in_dw)
+	int64_t size_in_dw,
+	struct compute_memory_item** after)
 {
-	struct compute_memory_item *item;
-
-	int last_end = 0;
-
-	assert(size_in_dw <= pool->size_in_dw);
+	struct compute_memory_item *item, *prev = NULL;
+	int64_t last_end = 0;
 
 	COMPUTE_DBG(pool->screen, "* compute_memory_prealloc_chunk() size_in_dw = %ld\n",
 		size_in_dw);
 
-	for (item = pool->item_list; item; item = item->next) {
-		if (item->start_in_dw > -1) {
-			if (item->start_in_dw-last_end > size_in_dw) {
-				return last_end;
-			}
-
-			last_end = item->start_in_dw + item->size_in_dw;
-			last_end += (1024 - last_end % 1024);
-		}
+	if (!LIST_IS_EMPTY(&pool->item_list)) {
+		prev = LIST_ENTRY(struct compute_memory_item,
+				  pool->item_list.prev, link);
+		last_end = compute_memory_align(prev->start_in_dw +
+						prev->size_in_dw);
 	}
 
-	if (pool->size_in_dw - last_end < size_in_dw) {
-		return -1;
+	if (pool->size_in_dw - last_end >= size_in_dw) {
+		*after = prev;
+		return last_end;
 	}
 
-	return last_end;
-}
-
-/**
- *  Search for the chunk where we can link our new chunk after it.
- */
-struct compute_memory_item* compute_memory_postalloc_chunk(
-	struct compute_memory_pool* pool,
-	int64_t start_in_dw)
-{
-	struct compute_memory_item* item;
-
-	COMPUTE_DBG(pool->screen, "* compute_memory_postalloc_chunck() start_in_dw = %ld\n",
-		start_in_dw);
-
-	/* Check if we can insert it in the front of the list */
-	if (pool->item_list && pool->item_list->start_in_dw > start_in_dw) {
-		return NULL;
+	if (pool->size_in_dw - pool->used_in_dw < size_in_dw) {
+		return -1;
 	}
 
-	for (item = pool->item_list; item; item = item->next) {
-		if (item->next) {
-			if (item->start_in_dw < start_in_dw
-				&& item->next->start_in_dw > start_in_dw) {
-				return item;
-			}
-		}
-		else {
-			/* end of chain */
-			assert(item->start_in_dw < start_in_dw);
-			return item;
+	prev = NULL;
+	last_end = 0;
+	LIST_FOR_EACH_ENTRY(item, &pool->item_list, link) {
+		if (item->start_in_dw - last_end >= size_in_dw) {
+			*after = prev;
+			return last_end;
 		}
+
+		last_end = compute_memory_align(item->start_in_dw +
+						item->size_in_dw);
+		prev = item;
 	}
 
-	assert(0 && "unreachable");
-	return NULL;
+	return -1;
 }
 
 /**
- * Reallocates pool, conserves data
+ * Moves all allocated chunks to the start of a new buffer of the given size
+ * with GPU copies, removing the holes between them.
  */
-void compute_memory_grow_pool(struct compute_memory_pool* pool,
-	struct pipe_context * pipe, int new_size_in_dw)
+void compute_memory_defrag(struct compute_memory_pool* pool,
+	struct pipe_context * pipe, int64_t new_size_in_dw)
 {
-	COMPUTE_DBG(pool->screen, "* compute_memory_grow_pool() "
-		"new_size_in_dw = %d (%d bytes)\n",
+	struct pipe_resource *old_bo = (struct pipe_resource *)pool->bo;
+	struct compute_memory_item *item;
+	int64_t last_end = 0;
+
+	new_size_in_dw = compute_memory_align(new_size_in_dw);
+
+	COMPUTE_DBG(pool->screen, "* compute_memory_defrag() "
+		"new_size_in_dw = %"PRIi64" (%"PRIi64" bytes)\n",
 		new_size_in_dw, new_size_in_dw * 4);
 
-	assert(new_size_in_dw >= pool->size_in_dw);
+	assert(new_size_in_dw >= pool->used_in_dw);
 
-	if (!pool->bo) {
-		compute_memory_pool_init(pool, MAX2(new_size_in_dw, 1024 * 16));
-	} else {
-		new_size_in_dw += 1024 - (new_size_in_dw % 1024);
-
-		COMPUTE_DBG(pool->screen, "  Aligned size = %d (%d bytes)\n",
-			new_size_in_dw, new_size_in_dw * 4);
-
-		compute_memory_shadow(pool, pipe, 1);
-		pool->shadow = realloc(pool->shadow, new_size_in_dw*4);
-		pool->size_in_dw = new_size_in_dw;
-		pool->screen->b.b.resource_destroy(
-			(struct pipe_screen *)pool->screen,
-			(struct pipe_resource *)pool->bo);
-		pool->bo = (struct r600_resource*)r600_compute_buffer_alloc_vram(
-							pool->screen,
-							pool->size_in_dw * 4);
-		compute_memory_shadow(pool, pipe, 0);
-	}
-}
+	pool->size_in_dw = new_size_in_dw;
+	pool->bo = (struct r600_resource*)r600_compute_buffer_alloc_vram(
+						pool->screen,
+						pool->size_in_dw * 4);
 
-/**
- * Copy pool from device to host, or host to device.
- */
-void compute_memory_shadow(struct compute_memory_pool* pool,
-	struct pipe_context * pipe, int device_to_host)
-{
-	struct compute_memory_item chunk;
+	LIST_FOR_EACH_ENTRY(item, &pool->item_list, link) {
+		struct pipe_box box;
 
-	COMPUTE_DBG(pool->screen, "* compute_memory_shadow() device_to_host = %d\n",
-		device_to_host);
+		/* The copies are done by CP DMA and don't go through
+		 * the CPU. */
+		u_box_1d(item->start_in_dw * 4, item->size_in_dw * 4, &box);
+		pipe->resource_copy_region(pipe,
+				(struct pipe_resource *)pool->bo, 0,
+				last_end * 4, 0, 0, old_bo, 0, &box);
 
-	chunk.id = 0;
-	chunk.start_in_dw = 0;
-	chunk.size_in_dw = pool->size_in_dw;
-	chunk.prev = chunk.next = NULL;
-	compute_memory_transfer(pool, pipe, device_to_host, &chunk,
-				pool->shadow, 0, pool->size_in_dw*4);
+		item->start_in_dw = last_end;
+		last_end = compute_memory_align(item->start_in_dw +
+						item->size_in_dw);
+	}
+
+	/* The pending copies keep the old buffer alive. */
+	pipe_resource_reference(&old_bo, NULL);
 }
 
 /**
@@ -213,178 +194,86 @@ void compute_memory_shadow(struct compute_memory_pool* pool,
 void compute_memory_finalize_pending(struct compute_memory_pool* pool,
 	struct pipe_context * pipe)
 {
-	struct compute_memory_item *pending_list = NULL, *end_p = NULL;
 	struct compute_memory_item *item, *next;
-
-	int64_t allocated = 0;
 	int64_t unallocated = 0;
 
-	int64_t start_in_dw = 0;
-
 	COMPUTE_DBG(pool->screen, "* compute_memory_finalize_pending()\n");
 
-	for (item = pool->item_list; item; item = item->next) {
+	LIST_FOR_EACH_ENTRY(item, &pool->item_list, link) {
 		COMPUTE_DBG(pool->screen, "  + list: offset = %i id = %i size = %i "
 			"(%i bytes)\n",item->start_in_dw, item->id,
 			item->size_in_dw, item->size_in_dw * 4);
 	}
 
-	/* Search through the list of memory items in the pool */
-	for (item = pool->item_list; item; item = next) {
-		next = item->next;
-
-		/* Check if the item is pending. */
-		if (item->start_in_dw == -1) {
-			/* It is pending, so add it to the pending_list... */
-			if (end_p) {
-				end_p->next = item;
-			}
-			else {
-				pending_list = item;
-			}
-
-			/* ... and then remove it from the item list. */
-			if (item->prev) {
-				item->prev->next = next;
-			}
-			else {
-				pool->item_list = next;
-			}
-
-			if (next) {
-				next->prev = item->prev;
-			}
-
-			/* This sequence makes the item be at the end of the list */
-			item->prev = end_p;
-			item->next = NULL;
-			end_p = item;
-
-			/* Update the amount of space we will need to allocate. */
-			unallocated += item->size_in_dw+1024;
-		}
-		else {
-			/* The item is not pendng, so update the amount of space
-			 * that has already been allocated. */
-			allocated += item->size_in_dw;
-		}
+	LIST_FOR_EACH_ENTRY(item, &pool->unallocated_list, link) {
+		unallocated += compute_memory_align(item->size_in_dw);
 	}
 
-	/* If we require more space than the size of the pool, then grow the
-	 * pool.
-	 *
-	 * XXX: I'm pretty sure this won't work.  Imagine this scenario:
-	 *
-	 * Offset Item Size
-	 *   0    A    50
-	 * 200    B    50
-	 * 400    C    50
-	 *
-	 * Total size = 450
-	 * Allocated size = 150
-	 * Pending Item D Size = 200
-	 *
-	 * In this case, there are 300 units of free space in the pool, but
-	 * they aren't contiguous, so it will be impossible to allocate Item D.
-	 */
-	if (pool->size_in_dw < allocated+unallocated) {
-		compute_memory_grow_pool(pool, pipe, allocated+unallocated);
+	if (!unallocated) {
+		return;
 	}
 
-	/* Loop through all the pending items, allocate space for them and
-	 * add them back to the item_list. */
-	for (item = pending_list; item; item = next) {
-		next = item->next;
-
-		/* Search for free space in the pool for this item. */
-		while ((start_in_dw=compute_memory_prealloc_chunk(pool,
-						item->size_in_dw)) == -1) {
-			int64_t need = item->size_in_dw+2048 -
-						(pool->size_in_dw - allocated);
-
-			need += 1024 - (need % 1024);
+	if (!pool->bo) {
+		compute_memory_pool_init(pool,
+			MAX2(compute_memory_align(unallocated), 1024 * 16));
+	}
 
-			if (need > 0) {
-				compute_memory_grow_pool(pool,
-						pipe,
-						pool->size_in_dw + need);
-			}
-			else {
-				need = pool->size_in_dw / 10;
-				need += 1024 - (need % 1024);
-				compute_memory_grow_pool(pool,
-						pipe,
-						pool->size_in_dw + need);
+	/* Place the pending items in the order they were created.
+	 * If an item doesn't fit anywhere, compact the pool once, growing it
+	 * so that all remaining items fit at its end. */
+	LIST_FOR_EACH_ENTRY_SAFE(item, next, &pool->unallocated_list, link) {
+		struct compute_memory_item *after = NULL;
+		int64_t start_in_dw;
+
+		start_in_dw = compute_memory_prealloc_chunk(pool,
+						item->size_in_dw, &after);
+		if (start_in_dw == -1) {
+			int64_t needed = pool->used_in_dw + unallocated;
+
+			if (needed > pool->size_in_dw) {
+				/* Grow by at least 10% to amortize the
+				 * copies. */
+				needed = MAX2(needed, pool->size_in_dw +
+						      pool->size_in_dw / 10);
 			}
+
+			compute_memory_defrag(pool, pipe,
+				MAX2(needed, pool->size_in_dw));
+			start_in_dw = compute_memory_prealloc_chunk(pool,
+						item->size_in_dw, &after);
+			assert(start_in_dw != -1);
 		}
+
 		COMPUTE_DBG(pool->screen, "  + Found space for Item %p id = %u "
 			"start_in_dw = %u (%u bytes) size_in_dw = %u (%u bytes)\n",
 			item, item->id, start_in_dw, start_in_dw * 4,
 			item->size_in_dw, item->size_in_dw * 4);
 
 		item->start_in_dw = start_in_dw;
-		item->next = NULL;
-		item->prev = NULL;
-
-		if (pool->item_list) {
-			struct compute_memory_item *pos;
-
-			pos = compute_memory_postalloc_chunk(pool, start_in_dw);
-			if (pos) {
-				item->prev = pos;
-				item->next = pos->next;
-				pos->next = item;
-				if (item->next) {
-					item->next->prev = item;
-				}
-			} else {
-				/* Add item to the front of the list */
-				item->next = pool->item_list;
-				item->prev = pool->item_list->prev;
-				pool->item_list->prev = item;
-				pool->item_list = item;
-			}
-		}
-		else {
-			pool->item_list = item;
+		LIST_DEL(&item->link);
+		if (after) {
+			LIST_ADD(&item->link, &after->link);
+		} else {
+			LIST_ADD(&item->link, &pool->item_list);
 		}
 
-		allocated += item->size_in_dw;
+		pool->used_in_dw += compute_memory_align(item->size_in_dw);
+		unallocated -= compute_memory_align(item->size_in_dw);
 	}
 }
 
 
-void compute_memory_free(struct compute_memory_pool* pool, int64_t id)
+void compute_memory_free(struct compute_memory_pool* pool,
+	struct compute_memory_item* item)
 {
-	struct compute_memory_item *item, *next;
-
-	COMPUTE_DBG(pool->screen, "* compute_memory_free() id + %ld \n", id);
-
-	for (item = pool->item_list; item; item = next) {
-		next = item->next;
+	COMPUTE_DBG(pool->screen, "* compute_memory_free() id + %ld \n", item->id);
 
-		if (item->id == id) {
-			if (item->prev) {
-				item->prev->next = item->next;
-			}
-			else {
-				pool->item_list = item->next;
-			}
-
-			if (item->next) {
-				item->next->prev = item->prev;
-			}
-
-			free(item);
-
-			return;
-		}
+	if (item->start_in_dw != -1) {
+		pool->used_in_dw -= compute_memory_align(item->size_in_dw);
 	}
 
-	fprintf(stderr, "Internal error, invalid id %"PRIi64" "
-		"for compute_memory_free\n", id);
-
-	assert(0 && "error");
+	LIST_DEL(&item->link);
+	free(item);
 }
 
 /**
@@ -394,7 +283,7 @@ struct compute_memory_item* compute_memory_alloc(
 	struct compute_memory_pool* pool,
 	int64_t size_in_dw)
 {
-	struct compute_memory_item *new_item = NULL, *last_item = NULL;
+	struct compute_memory_item *new_item = NULL;
 
 	COMPUTE_DBG(pool->screen, "* compute_memory_alloc() size_in_dw = %ld (%ld bytes)\n",
 			size_in_dw, 4 * size_in_dw);
@@ -406,16 +295,7 @@ struct compute_memory_item* compute_memory_alloc(
 	new_item->id = pool->next_id++;
 	new_item->pool = pool;
 
-	if (pool->item_list) {
-		for (last_item = pool->item_list; last_item->next;
-						last_item = last_item->next);
-
-		last_item->next = new_item;
-		new_item->prev = last_item;
-	}
-	else {
-		pool->item_list = new_item;
-	}
+	LIST_ADDTAIL(&new_item->link, &pool->unallocated_list);
 
 	COMPUTE_DBG(pool->screen, "  + Adding item %p id = %u size = %u (%u bytes)\n",
 			new_item, new_item->id, new_item->size_in_dw,
@@ -27,6 +27,8 @@
 
 #include <stdlib.h>
 
+#include "util/u_double_list.h"
+
 struct compute_memory_pool;
 
 struct compute_memory_item
@@ -40,8 +42,7 @@ struct compute_memory_item
 
 	struct compute_memory_pool* pool;
 
-	struct compute_memory_item* prev;
-	struct compute_memory_item* next;
+	struct list_head link; ///Link in the item_list or the unallocated_list of the pool
 };
 
 struct compute_memory_pool
@@ -49,40 +50,38 @@ struct compute_memory_pool
 	int64_t next_id; ///For generating unique IDs for memory chunks
 	int64_t size_in_dw; ///Size of the pool in dwords
 
+	int64_t used_in_dw; ///Size of the allocated chunks in dwords, including the alignment
+
 	struct r600_resource *bo; ///The pool buffer object resource
-	struct compute_memory_item* item_list; ///Allocated memory chunks in the buffer,they must be ordered by "start_in_dw"
+	struct list_head item_list; ///Allocated memory chunks in the buffer, they must be ordered by "start_in_dw"
+	struct list_head unallocated_list; ///Pending memory chunks, not placed in the buffer yet
 	struct r600_screen *screen;
-
-	uint32_t *shadow; ///host copy of the pool, used for defragmentation
 };
 
 
 struct compute_memory_pool* compute_memory_pool_new(struct r600_screen *rscreen); ///Creates a new pool
 void compute_memory_pool_delete(struct compute_memory_pool* pool); ///Frees all stuff in the pool and the pool struct itself too
 
-int64_t compute_memory_prealloc_chunk(struct compute_memory_pool* pool, int64_t size_in_dw); ///searches for an empty space in the pool, return with the pointer to the allocatable space in the pool, returns -1 on failure
-
-struct compute_memory_item* compute_memory_postalloc_chunk(struct compute_memory_pool* pool, int64_t start_in_dw); ///search for the chunk where we can link our new chunk after it
-
-/** 
- * reallocates pool, conserves data
+/**
+ * Searches for an empty space in the pool, returns the start of the space
+ * and the item to link the new chunk after, or -1 on failure
  */
-void compute_memory_grow_pool(struct compute_memory_pool* pool, struct pipe_context * pipe,
-	int new_size_in_dw);
+int64_t compute_memory_prealloc_chunk(struct compute_memory_pool* pool,
+	int64_t size_in_dw, struct compute_memory_item** after);
 
 /**
- * Copy pool from device to host, or host to device
+ * Moves all allocated chunks to the start of a new buffer of the given size
+ * with GPU copies, removing the holes between them
  */
-void compute_memory_shadow(struct compute_memory_pool* pool,
-	struct pipe_context * pipe, int device_to_host);
+void compute_memory_defrag(struct compute_memory_pool* pool,
+	struct pipe_context * pipe, int64_t new_size_in_dw);
 
 /**
  * Allocates pending allocations in the pool
  */
 void compute_memory_finalize_pending(struct compute_memory_pool* pool,
 	struct pipe_context * pipe);
-void compute_memory_defrag(struct compute_memory_pool* pool); ///Defragment the memory pool, always heavy memory usage
-void compute_memory_free(struct compute_memory_pool* pool, int64_t id);
+void compute_memory_free(struct compute_memory_pool* pool, struct compute_memory_item* item);
 struct compute_memory_item* compute_memory_alloc(struct compute_memory_pool* pool, int64_t size_in_dw); ///Creates pending allocations
 
 /**
@@ -565,7 +565,8 @@ static void evergreen_launch_grid(
 			   ctx->screen->has_compressed_msaa_texturing);
 		bc->type = TGSI_PROCESSOR_COMPUTE;
 		bc->isa = ctx->isa;
-		r600_llvm_compile(mod, ctx->b.family, bc, &use_kill, dump);
+		r600_llvm_compile(mod, ctx->b.family, bc, &use_kill, dump,
+				  NULL, NULL, 0);
 
 		if (dump && !sb_disasm) {
 			r600_bytecode_disasm(bc);
@@ -933,7 +934,7 @@ void r600_compute_global_buffer_destroy(
 	buffer = (struct r600_resource_global*)res;
 	rscreen = (struct r600_screen*)screen;
 
-	compute_memory_free(rscreen->global_pool, buffer->chunk->id);
+	compute_memory_free(rscreen->global_pool, buffer->chunk);
 
 	buffer->chunk = NULL;
 	free(res);
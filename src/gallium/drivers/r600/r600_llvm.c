@@ -824,7 +824,10 @@ unsigned r600_llvm_compile(
 	enum radeon_family family,
 	struct r600_bytecode *bc,
 	boolean *use_kill,
-	unsigned dump)
+	unsigned dump,
+	struct util_disk_cache *cache,
+	const void *cache_key,
+	unsigned cache_key_size)
 {
 	unsigned r;
 	struct radeon_llvm_binary binary;
@@ -832,7 +835,15 @@ unsigned r600_llvm_compile(
 	unsigned i;
 
 	memset(&binary, 0, sizeof(struct radeon_llvm_binary));
-	r = radeon_llvm_compile(mod, &binary, gpu_family, dump);
+	if (cache_key && radeon_llvm_cache_get(cache, cache_key, cache_key_size,
+					       &binary, NULL, 0)) {
+		r = 0;
+	} else {
+		r = radeon_llvm_compile(mod, &binary, gpu_family, dump);
+		if (r == 0 && cache_key)
+			radeon_llvm_cache_put(cache, cache_key, cache_key_size,
+					      &binary, NULL, 0);
+	}
 
 	assert(binary.code_size % 4 == 0);
 	bc->bytecode = CALLOC(1, binary.code_size);
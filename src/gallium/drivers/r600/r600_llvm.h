@@ -10,6 +10,7 @@
 struct r600_bytecode;
 struct r600_shader_ctx;
 struct radeon_llvm_context;
+struct util_disk_cache;
 enum radeon_family;
 
 LLVMModuleRef r600_tgsi_llvm(
@@ -21,7 +22,10 @@ unsigned r600_llvm_compile(
 	enum radeon_family family,
 	struct r600_bytecode *bc,
 	boolean *use_kill,
-	unsigned dump);
+	unsigned dump,
+	struct util_disk_cache *cache,
+	const void *cache_key,
+	unsigned cache_key_size);
 
 #endif /* defined R600_USE_LLVM || defined HAVE_OPENCL */
 
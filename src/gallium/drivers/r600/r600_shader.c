@@ -22,6 +22,9 @@
  */
 #include "r600_sq.h"
 #include "r600_llvm.h"
+#ifdef R600_USE_LLVM
+#include "radeon_llvm_emit.h"
+#endif
 #include "r600_formats.h"
 #include "r600_opcodes.h"
 #include "r600_shader.h"
@@ -1730,6 +1733,8 @@ static int r600_shader_from_tgsi(struct r600_context *rctx,
 		LLVMModuleRef mod;
 		bool dump = r600_can_dump_shader(&rscreen->b, tokens);
 		boolean use_kill = false;
+		void *cache_key = NULL;
+		unsigned cache_key_size = 0;
 
 		memset(&radeon_llvm_ctx, 0, sizeof(radeon_llvm_ctx));
 		radeon_llvm_ctx.type = ctx.type;
@@ -1750,7 +1755,35 @@ static int r600_shader_from_tgsi(struct r600_context *rctx,
 		ctx.shader->has_txq_cube_array_z_comp = radeon_llvm_ctx.has_txq_cube_array_z_comp;
 		ctx.shader->uses_tex_buffers = radeon_llvm_ctx.uses_tex_buffers;
 
-		if (r600_llvm_compile(mod, rscreen->b.family, ctx.bc, &use_kill, dump)) {
+		/* The module only depends on the tokens and the variant, so the
+		 * compiled code can come from the disk cache.  Dumping wants the
+		 * LLVM output, so it bypasses the cache. */
+		if (rscreen->b.disk_cache && !dump) {
+			struct {
+				unsigned color_two_side;
+				unsigned alpha_to_one;
+				unsigned nr_cbufs;
+				unsigned vs_as_es;
+				unsigned has_compressed_msaa_texturing;
+				struct pipe_stream_output_info so;
+			} state;
+
+			memset(&state, 0, sizeof(state));
+			state.color_two_side = key.color_two_side;
+			state.alpha_to_one = key.alpha_to_one;
+			state.nr_cbufs = key.nr_cbufs;
+			state.vs_as_es = key.vs_as_es;
+			state.has_compressed_msaa_texturing =
+				ctx.bc->has_compressed_msaa_texturing;
+			state.so = so;
+			cache_key = radeon_llvm_cache_key(
+				r600_get_llvm_processor_name(rscreen->b.family),
+				tokens, &state, sizeof(state), &cache_key_size);
+		}
+
+		if (r600_llvm_compile(mod, rscreen->b.family, ctx.bc, &use_kill, dump,
+				      rscreen->b.disk_cache, cache_key,
+				      cache_key_size)) {
 			radeon_llvm_dispose(&radeon_llvm_ctx);
 			use_llvm = 0;
 			fprintf(stderr, "R600 LLVM backend failed to compile "
@@ -1762,6 +1795,7 @@ static int r600_shader_from_tgsi(struct r600_context *rctx,
 		if (use_kill)
 			ctx.shader->uses_kill = use_kill;
 		radeon_llvm_dispose(&radeon_llvm_ctx);
+		FREE(cache_key);
 	}
 #endif
 /* End of LLVM backend setup */
@@ -1432,7 +1432,7 @@ bool post_scheduler::check_interferences() {
 
 // add instruction(s) (alu_node or contents of alu_packed_node) to current group
 // returns the number of added instructions on success
-unsigned post_scheduler::try_add_instruction(node *n) {
+unsigned post_scheduler::try_add_instruction(node *n, bool vec_trans) {
 
 	alu_group_tracker &rt = alu.grp();
 
@@ -1467,11 +1467,10 @@ unsigned post_scheduler::try_add_instruction(node *n) {
 			d = NULL;
 		}
 
-		unsigned allowed_slots = ctx.alu_slots_mask(a->bc.op_ptr);
+		unsigned op_slots = ctx.alu_slots_mask(a->bc.op_ptr);
+		unsigned allowed_slots = op_slots & avail_slots;
 		unsigned slot;
 
-		allowed_slots &= avail_slots;
-
 		if (!allowed_slots)
 			return 0;
 
@@ -1495,23 +1494,34 @@ unsigned post_scheduler::try_add_instruction(node *n) {
 			allowed_slots &= 0x0F;
 		}
 
+		// keep the trans slot for the ops that can't go anywhere else,
+		// vector ops may take it later if it's still free
+		if (!vec_trans && (op_slots & 0x0F))
+			allowed_slots &= 0x0F;
+
 		if (!allowed_slots) {
 			PSC_DUMP( sblog << "   no suitable slots\n"; );
 			return 0;
 		}
 
-		slot = __builtin_ctz(allowed_slots);
-		a->bc.slot = slot;
+		// if the vector slot can't be reserved (e.g. because of the bank
+		// swizzle or read port constraints), the trans slot might still work
+		while (allowed_slots) {
+			slot = __builtin_ctz(allowed_slots);
+			a->bc.slot = slot;
 
-		PSC_DUMP( sblog << "slot: " << slot << "\n"; );
+			PSC_DUMP( sblog << "slot: " << slot << "\n"; );
 
-		if (!rt.try_reserve(a)) {
-			PSC_DUMP( sblog << "   reservation failed\n"; );
-			return 0;
+			if (rt.try_reserve(a)) {
+				a->remove();
+				return 1;
+			}
+
+			allowed_slots &= ~(1 << slot);
 		}
 
-		a->remove();
-		return 1;
+		PSC_DUMP( sblog << "   reservation failed\n"; );
+		return 0;
 	}
 }
 
@@ -1624,32 +1634,45 @@ bool post_scheduler::prepare_alu_group() {
 
 		++i1;
 
-		for (node_iterator N, I = ready.begin(), E = ready.end(); I != E;
-				I = N) {
-			N = I; ++N;
-			node *n = *I;
+		// the first pass fills the vector slots and gives trans-only ops a
+		// chance to take the trans slot, the second pass lets the remaining
+		// vector ops use the trans slot if it's still free
+		for (unsigned pass = ctx.has_trans ? 0 : 1; pass < 2; ++pass) {
 
-			PSC_DUMP(
-				sblog << "p_a_g: ";
-				dump::dump_op(n);
-				sblog << "\n";
-			);
+			if (pass && !(rt.avail_slots() & (1 << SLOT_TRANS)) &&
+					ctx.has_trans)
+				break;
+
+			for (node_iterator N, I = ready.begin(), E = ready.end(); I != E;
+					I = N) {
+				N = I; ++N;
+				node *n = *I;
 
+				PSC_DUMP(
+					sblog << "p_a_g: ";
+					dump::dump_op(n);
+					sblog << "\n";
+				);
 
-			unsigned cnt = try_add_instruction(n);
 
-			if (!cnt)
-				continue;
+				unsigned cnt = try_add_instruction(n, pass);
 
-			PSC_DUMP(
-				sblog << "current group:\n";
-				dump_group(rt);
-			);
+				if (!cnt)
+					continue;
 
-			if (rt.inst_count() == ctx.num_slots) {
-				PSC_DUMP( sblog << " all slots used\n"; );
-				break;
+				PSC_DUMP(
+					sblog << "current group:\n";
+					dump_group(rt);
+				);
+
+				if (rt.inst_count() == ctx.num_slots) {
+					PSC_DUMP( sblog << " all slots used\n"; );
+					break;
+				}
 			}
+
+			if (rt.inst_count() == ctx.num_slots)
+				break;
 		}
 
 		if (!check_interferences())
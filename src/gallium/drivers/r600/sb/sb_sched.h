@@ -282,7 +282,7 @@ public:
 
 	bool check_interferences();
 
-	unsigned try_add_instruction(node *n);
+	unsigned try_add_instruction(node *n, bool vec_trans = true);
 
 	bool check_copy(node *n);
 	void dump_group(alu_group_tracker &rt);
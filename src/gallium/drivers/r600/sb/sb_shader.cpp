@@ -651,6 +651,11 @@ void shader_stats::dump() {
 			<< ", fetch clauses:" << fetch_clauses
 			<< ", cf:" << cf;
 
+	// average number of instructions per alu group, shows how well
+	// the scheduler fills the VLIW slots
+	if (alu_groups)
+		sblog << ", alu/group:" << (double)alu / alu_groups;
+
 	if (shaders > 1)
 		sblog << ", shaders:" << shaders;
 
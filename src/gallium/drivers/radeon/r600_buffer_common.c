@@ -122,6 +122,13 @@ bool r600_init_resource(struct r600_common_screen *rscreen,
 		break;
 	}
 
+	/* Persistent mappings are read by the CPU while the GPU uses them,
+	 * and they must not move.  Use GTT for them. */
+	if (res->b.b.flags & (PIPE_RESOURCE_FLAG_MAP_PERSISTENT |
+			      PIPE_RESOURCE_FLAG_MAP_COHERENT)) {
+		res->domains = RADEON_DOMAIN_GTT;
+	}
+
 	/* Tiled textures are unmappable. Always put them in VRAM. */
 	if (res->b.b.target != PIPE_BUFFER &&
 	    rtex->surface.level[0].mode >= RADEON_SURF_MODE_1D) {
@@ -210,6 +217,21 @@ static void *r600_buffer_transfer_map(struct pipe_context *ctx,
 		usage |= PIPE_TRANSFER_DISCARD_WHOLE_RESOURCE;
 	}
 
+	/* A buffer that may be persistently mapped can't be reallocated
+	 * or written through a staging buffer, because the application
+	 * keeps using the pointer of the mapping it got. */
+	if (resource->flags & PIPE_RESOURCE_FLAG_MAP_PERSISTENT) {
+		usage &= ~(PIPE_TRANSFER_DISCARD_WHOLE_RESOURCE |
+			   PIPE_TRANSFER_DISCARD_RANGE);
+	}
+
+	if (usage & PIPE_TRANSFER_PERSISTENT &&
+	    usage & PIPE_TRANSFER_WRITE) {
+		/* The buffer can be written at any time from now on. */
+		util_range_add(&rbuffer->valid_buffer_range, box->x,
+			       box->x + box->width);
+	}
+
 	if (usage & PIPE_TRANSFER_DISCARD_WHOLE_RESOURCE &&
 	    !(usage & PIPE_TRANSFER_UNSYNCHRONIZED)) {
 		assert(usage & PIPE_TRANSFER_WRITE);
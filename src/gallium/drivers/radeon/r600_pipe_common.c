@@ -39,6 +39,18 @@
  * pipe_context
  */
 
+static void r600_memory_barrier(struct pipe_context *ctx, unsigned flags)
+{
+	struct r600_common_context *rctx = (struct r600_common_context *)ctx;
+
+	/* Make CPU writes into persistent mappings visible to the next draw. */
+	if (flags & PIPE_BARRIER_MAPPED_BUFFER) {
+		rctx->flags |= R600_CONTEXT_INV_VERTEX_CACHE |
+			       R600_CONTEXT_INV_TEX_CACHE |
+			       R600_CONTEXT_INV_CONST_CACHE;
+	}
+}
+
 bool r600_common_context_init(struct r600_common_context *rctx,
 			      struct r600_common_screen *rscreen)
 {
@@ -56,6 +68,7 @@ bool r600_common_context_init(struct r600_common_context *rctx,
 	rctx->b.transfer_flush_region = u_default_transfer_flush_region;
 	rctx->b.transfer_unmap = u_transfer_unmap_vtbl;
 	rctx->b.transfer_inline_write = u_default_transfer_inline_write;
+	rctx->b.memory_barrier = r600_memory_barrier;
 
 	r600_streamout_init(rctx);
 	r600_query_init(rctx);
@@ -65,12 +78,18 @@ bool r600_common_context_init(struct r600_common_context *rctx,
 	if (!rctx->allocator_so_filled_size)
 		return false;
 
+	/* Streamout targets come and go, reuse their emptied buffers. */
+	u_suballocator_recycle_buffers(rctx->allocator_so_filled_size, 4);
+
 	rctx->uploader = u_upload_create(&rctx->b, 1024 * 1024, 256,
 					PIPE_BIND_INDEX_BUFFER |
 					PIPE_BIND_CONSTANT_BUFFER);
 	if (!rctx->uploader)
 		return false;
 
+	/* Reuse filled upload buffers once the GPU is done with them. */
+	u_upload_recycle_buffers(rctx->uploader, 4);
+
 	return true;
 }
 
@@ -89,6 +108,8 @@ void r600_common_context_cleanup(struct r600_common_context *rctx)
 
 	util_slab_destroy(&rctx->pool_transfers);
 
+	r600_query_cleanup(rctx);
+
 	if (rctx->allocator_so_filled_size) {
 		u_suballocator_destroy(rctx->allocator_so_filled_size);
 	}
@@ -140,6 +161,7 @@ static const struct debug_named_value common_debug_options[] = {
 	{ "hyperz", DBG_HYPERZ, "Enable Hyper-Z" },
 	/* GL uses the word INVALIDATE, gallium uses the word DISCARD */
 	{ "noinvalrange", DBG_NO_DISCARD_RANGE, "Disable handling of INVALIDATE_RANGE map flags" },
+	{ "nodma", DBG_NO_ASYNC_DMA, "Disable asynchronous DMA" },
 
 	DEBUG_NAMED_VALUE_END /* must be last */
 };
@@ -400,6 +422,10 @@ static int r600_get_compute_param(struct pipe_screen *screen,
 		}
 		return sizeof(uint64_t);
 
+	case PIPE_COMPUTE_CAP_MAX_COMPUTE_UNITS:
+		/* Not known yet, let the state tracker assume one. */
+		return 0;
+
 	default:
 		fprintf(stderr, "unknown PIPE_COMPUTE_CAP %d\n", param);
 		return 0;
@@ -621,6 +647,10 @@ bool r600_common_screen_init(struct r600_common_screen *rscreen,
 	util_format_s3tc_init();
 	pipe_mutex_init(rscreen->aux_context_lock);
 
+	/* The entries are keyed by the LLVM processor name, so all the
+	 * radeon drivers can share the directory. */
+	rscreen->disk_cache = util_disk_cache_create("radeon");
+
 	if (rscreen->info.drm_minor >= 28 && (rscreen->debug_flags & DBG_TRACE_CS)) {
 		rscreen->trace_bo = (struct r600_resource*)pipe_buffer_create(&rscreen->b,
 										PIPE_BIND_CUSTOM,
@@ -645,6 +675,9 @@ void r600_destroy_common_screen(struct r600_common_screen *rscreen)
 		pipe_resource_reference((struct pipe_resource**)&rscreen->trace_bo, NULL);
 	}
 
+	if (rscreen->disk_cache)
+		util_disk_cache_destroy(rscreen->disk_cache);
+
 	rscreen->ws->destroy(rscreen->ws);
 	FREE(rscreen);
 }
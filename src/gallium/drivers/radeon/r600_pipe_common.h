@@ -36,6 +36,7 @@
 
 #include "../../winsys/radeon/drm/radeon_winsys.h"
 
+#include "util/u_disk_cache.h"
 #include "util/u_double_list.h"
 #include "util/u_range.h"
 #include "util/u_slab.h"
@@ -85,11 +86,13 @@
 /* features */
 #define DBG_HYPERZ		(1 << 13)
 #define DBG_NO_DISCARD_RANGE	(1 << 14)
+#define DBG_NO_ASYNC_DMA	(1 << 15)
 /* The maximum allowed bit is 15. */
 
 #define R600_MAP_BUFFER_ALIGNMENT 64
 
 struct r600_common_context;
+struct r600_query_buffer;
 
 struct r600_resource {
 	struct u_resource		b;
@@ -185,6 +188,9 @@ struct r600_common_screen {
 	struct r600_resource		*trace_bo;
 	uint32_t			*trace_ptr;
 	unsigned			cs_count;
+
+	/* Compiled LLVM shaders, NULL if MESA_SHADER_CACHE_DIR isn't set. */
+	struct util_disk_cache		*disk_cache;
 };
 
 /* This encapsulates a state or an operation which can emitted into the GPU
@@ -267,6 +273,10 @@ struct r600_common_context {
 	unsigned			num_cs_dw_nontimer_queries_suspend;
 	/* If queries have been suspended. */
 	bool				nontimer_queries_suspended;
+	/* Idle or soon-to-be-idle query buffers which can be reused, so that
+	 * begin_query doesn't have to allocate a new buffer every time. */
+	struct r600_query_buffer	*query_buffer_pool;
+	unsigned			num_pooled_query_buffers;
 	/* Additional hardware info. */
 	unsigned			backend_mask;
 	unsigned			max_db; /* for OQ */
@@ -344,6 +354,7 @@ const char *r600_get_llvm_processor_name(enum radeon_family family);
 
 /* r600_query.c */
 void r600_query_init(struct r600_common_context *rctx);
+void r600_query_cleanup(struct r600_common_context *rctx);
 void r600_suspend_nontimer_queries(struct r600_common_context *ctx);
 void r600_resume_nontimer_queries(struct r600_common_context *ctx);
 void r600_query_init_backend_mask(struct r600_common_context *ctx);
@@ -68,10 +68,82 @@ static bool r600_query_needs_begin(unsigned type)
 	       type != PIPE_QUERY_TIMESTAMP;
 }
 
+/* The maximum number of query buffers kept around for reuse. */
+#define R600_MAX_POOLED_QUERY_BUFFERS 32
+
+/* Put an unused query buffer into the pool. The buffer reference and
+ * the r600_query_buffer structure are taken over by the pool. */
+static void r600_pool_query_buffer(struct r600_common_context *ctx,
+				   struct r600_query_buffer *qbuf)
+{
+	if (!qbuf->buf ||
+	    ctx->num_pooled_query_buffers >= R600_MAX_POOLED_QUERY_BUFFERS) {
+		pipe_resource_reference((struct pipe_resource**)&qbuf->buf, NULL);
+		FREE(qbuf);
+		return;
+	}
+
+	qbuf->results_end = 0;
+	qbuf->previous = ctx->query_buffer_pool;
+	ctx->query_buffer_pool = qbuf;
+	ctx->num_pooled_query_buffers++;
+}
+
+static void r600_pool_query_resource(struct r600_common_context *ctx,
+				     struct r600_resource *buf)
+{
+	struct r600_query_buffer *qbuf;
+
+	if (!buf)
+		return;
+
+	qbuf = MALLOC_STRUCT(r600_query_buffer);
+	if (!qbuf) {
+		pipe_resource_reference((struct pipe_resource**)&buf, NULL);
+		return;
+	}
+	qbuf->buf = buf;
+	r600_pool_query_buffer(ctx, qbuf);
+}
+
+/* Return a pooled query buffer which the GPU is done with or NULL. */
+static struct r600_resource *r600_get_pooled_query_buffer(struct r600_common_context *ctx)
+{
+	struct r600_query_buffer **p;
+
+	for (p = &ctx->query_buffer_pool; *p; p = &(*p)->previous) {
+		struct r600_query_buffer *qbuf = *p;
+		struct r600_resource *buf = qbuf->buf;
+
+		if (r600_rings_is_buffer_referenced(ctx, buf->cs_buf, RADEON_USAGE_READWRITE) ||
+		    ctx->ws->buffer_is_busy(buf->buf, RADEON_USAGE_READWRITE))
+			continue;
+
+		*p = qbuf->previous;
+		ctx->num_pooled_query_buffers--;
+		FREE(qbuf);
+		return buf;
+	}
+	return NULL;
+}
+
+void r600_query_cleanup(struct r600_common_context *ctx)
+{
+	while (ctx->query_buffer_pool) {
+		struct r600_query_buffer *qbuf = ctx->query_buffer_pool;
+
+		ctx->query_buffer_pool = qbuf->previous;
+		pipe_resource_reference((struct pipe_resource**)&qbuf->buf, NULL);
+		FREE(qbuf);
+	}
+	ctx->num_pooled_query_buffers = 0;
+}
+
 static struct r600_resource *r600_new_query_buffer(struct r600_common_context *ctx, unsigned type)
 {
 	unsigned j, i, num_results, buf_size = 4096;
 	uint32_t *results;
+	struct r600_resource *buf;
 
 	/* Non-GPU queries. */
 	switch (type) {
@@ -82,13 +154,18 @@ static struct r600_resource *r600_new_query_buffer(struct r600_common_context *c
 		return NULL;
 	}
 
+	/* All query buffers have the same size, so any idle buffer from
+	 * the pool will do. It only needs to be reinitialized. */
+	buf = r600_get_pooled_query_buffer(ctx);
+
 	/* Queries are normally read by the CPU after
 	 * being written by the gpu, hence staging is probably a good
 	 * usage pattern.
 	 */
-	struct r600_resource *buf = (struct r600_resource*)
-		pipe_buffer_create(ctx->b.screen, PIPE_BIND_CUSTOM,
-				   PIPE_USAGE_STAGING, buf_size);
+	if (!buf)
+		buf = (struct r600_resource*)
+			pipe_buffer_create(ctx->b.screen, PIPE_BIND_CUSTOM,
+					   PIPE_USAGE_STAGING, buf_size);
 
 	switch (type) {
 	case PIPE_QUERY_OCCLUSION_COUNTER:
@@ -394,18 +471,18 @@ static struct pipe_query *r600_create_query(struct pipe_context *ctx, unsigned q
 
 static void r600_destroy_query(struct pipe_context *ctx, struct pipe_query *query)
 {
+	struct r600_common_context *rctx = (struct r600_common_context *)ctx;
 	struct r600_query *rquery = (struct r600_query*)query;
 	struct r600_query_buffer *prev = rquery->buffer.previous;
 
-	/* Release all query buffers. */
+	/* Return all query buffers to the pool. */
 	while (prev) {
 		struct r600_query_buffer *qbuf = prev;
 		prev = prev->previous;
-		pipe_resource_reference((struct pipe_resource**)&qbuf->buf, NULL);
-		FREE(qbuf);
+		r600_pool_query_buffer(rctx, qbuf);
 	}
 
-	pipe_resource_reference((struct pipe_resource**)&rquery->buffer.buf, NULL);
+	r600_pool_query_resource(rctx, rquery->buffer.buf);
 	FREE(query);
 }
 
@@ -434,18 +511,17 @@ static void r600_begin_query(struct pipe_context *ctx, struct pipe_query *query)
 		return;
 	}
 
-	/* Discard the old query buffers. */
+	/* Return the old query buffers to the pool. */
 	while (prev) {
 		struct r600_query_buffer *qbuf = prev;
 		prev = prev->previous;
-		pipe_resource_reference((struct pipe_resource**)&qbuf->buf, NULL);
-		FREE(qbuf);
+		r600_pool_query_buffer(rctx, qbuf);
 	}
 
 	/* Obtain a new buffer if the current one can't be mapped without a stall. */
 	if (r600_rings_is_buffer_referenced(rctx, rquery->buffer.buf->cs_buf, RADEON_USAGE_READWRITE) ||
 	    rctx->ws->buffer_is_busy(rquery->buffer.buf->buf, RADEON_USAGE_READWRITE)) {
-		pipe_resource_reference((struct pipe_resource**)&rquery->buffer.buf, NULL);
+		r600_pool_query_resource(rctx, rquery->buffer.buf);
 		rquery->buffer.buf = r600_new_query_buffer(rctx, rquery->type);
 	}
 
@@ -24,6 +24,9 @@
  *
  */
 #include "radeon_llvm_emit.h"
+#include "os/os_thread.h"
+#include "tgsi/tgsi_parse.h"
+#include "util/u_disk_cache.h"
 #include "util/u_memory.h"
 
 #include <llvm-c/Target.h>
@@ -52,8 +55,12 @@ void radeon_llvm_shader_type(LLVMValueRef F, unsigned type)
   LLVMAddTargetDependentFunctionAttr(F, "ShaderType", Str);
 }
 
+/* Shaders may be compiled on several threads at once. */
+pipe_static_mutex(init_r600_target_mutex);
+
 static void init_r600_target() {
 	static unsigned initialized = 0;
+	pipe_mutex_lock(init_r600_target_mutex);
 	if (!initialized) {
 		LLVMInitializeR600TargetInfo();
 		LLVMInitializeR600Target();
@@ -61,6 +68,7 @@ static void init_r600_target() {
 		LLVMInitializeR600AsmPrinter();
 		initialized = 1;
 	}
+	pipe_mutex_unlock(init_r600_target_mutex);
 }
 
 static LLVMTargetRef get_r600_target() {
@@ -181,3 +189,148 @@ unsigned radeon_llvm_compile(LLVMModuleRef M, struct radeon_llvm_binary *binary,
 	LLVMDisposeTargetMachine(tm);
 	return 0;
 }
+
+/* Header of the disk cache entries, followed by the driver data, the code
+ * and the config. */
+struct radeon_llvm_cache_header {
+	uint32_t extra_size;
+	uint32_t code_size;
+	uint32_t config_size;
+};
+
+/**
+ * Build the disk cache key of a shader compiled for gpu_family.
+ *
+ * The key is made of the build and LLVM identity, the processor name,
+ * the driver's variant state and the TGSI tokens.
+ *
+ * @returns a MALLOC'ed key, or NULL if out of memory
+ */
+void *radeon_llvm_cache_key(const char *gpu_family,
+			    const struct tgsi_token *tokens,
+			    const void *state, unsigned state_size,
+			    unsigned *key_size)
+{
+	static const char build_id[] =
+#ifdef PACKAGE_VERSION
+		PACKAGE_VERSION " "
+#endif
+		__DATE__ " " __TIME__;
+	const unsigned llvm_version = HAVE_LLVM;
+	unsigned family_size = strlen(gpu_family) + 1;
+	unsigned tokens_size = tgsi_num_tokens(tokens) * sizeof(struct tgsi_token);
+	uint8_t *key, *p;
+
+	*key_size = sizeof(build_id) + sizeof(llvm_version) + family_size +
+		    state_size + tokens_size;
+	key = MALLOC(*key_size);
+	if (!key)
+		return NULL;
+
+	p = key;
+	memcpy(p, build_id, sizeof(build_id));
+	p += sizeof(build_id);
+	memcpy(p, &llvm_version, sizeof(llvm_version));
+	p += sizeof(llvm_version);
+	memcpy(p, gpu_family, family_size);
+	p += family_size;
+	memcpy(p, state, state_size);
+	p += state_size;
+	memcpy(p, tokens, tokens_size);
+	return key;
+}
+
+/**
+ * Look up a compiled shader in the disk cache.
+ *
+ * On a hit, the code and config are MALLOC'ed like the ones returned by
+ * radeon_llvm_compile, and the extra_size bytes of driver data stored with
+ * them are copied to extra.
+ *
+ * @returns true on a hit
+ */
+bool radeon_llvm_cache_get(struct util_disk_cache *cache,
+			   const void *key, unsigned key_size,
+			   struct radeon_llvm_binary *binary,
+			   void *extra, unsigned extra_size)
+{
+	struct radeon_llvm_cache_header header;
+	unsigned size;
+	uint8_t *data, *p;
+
+	data = util_disk_cache_get(cache, key, key_size, &size);
+	if (!data)
+		return false;
+
+	if (size < sizeof(header))
+		goto fail;
+	memcpy(&header, data, sizeof(header));
+	if (header.extra_size != extra_size ||
+	    size != sizeof(header) + header.extra_size +
+		    header.code_size + header.config_size)
+		goto fail;
+
+	memset(binary, 0, sizeof(*binary));
+	binary->code = MALLOC(header.code_size);
+	binary->config = MALLOC(header.config_size);
+	if ((header.code_size && !binary->code) ||
+	    (header.config_size && !binary->config)) {
+		FREE(binary->code);
+		FREE(binary->config);
+		goto fail;
+	}
+
+	p = data + sizeof(header);
+	if (extra_size)
+		memcpy(extra, p, extra_size);
+	p += extra_size;
+	memcpy(binary->code, p, header.code_size);
+	binary->code_size = header.code_size;
+	p += header.code_size;
+	memcpy(binary->config, p, header.config_size);
+	binary->config_size = header.config_size;
+
+	FREE(data);
+	return true;
+
+fail:
+	FREE(data);
+	return false;
+}
+
+/**
+ * Store a compiled shader and extra_size bytes of driver data in the disk
+ * cache.
+ */
+void radeon_llvm_cache_put(struct util_disk_cache *cache,
+			   const void *key, unsigned key_size,
+			   const struct radeon_llvm_binary *binary,
+			   const void *extra, unsigned extra_size)
+{
+	struct radeon_llvm_cache_header header;
+	unsigned size;
+	uint8_t *data, *p;
+
+	header.extra_size = extra_size;
+	header.code_size = binary->code_size;
+	header.config_size = binary->config_size;
+
+	size = sizeof(header) + extra_size + binary->code_size +
+	       binary->config_size;
+	data = MALLOC(size);
+	if (!data)
+		return;
+
+	p = data;
+	memcpy(p, &header, sizeof(header));
+	p += sizeof(header);
+	if (extra_size)
+		memcpy(p, extra, extra_size);
+	p += extra_size;
+	memcpy(p, binary->code, binary->code_size);
+	p += binary->code_size;
+	memcpy(p, binary->config, binary->config_size);
+
+	util_disk_cache_put(cache, key, key_size, data, size);
+	FREE(data);
+}
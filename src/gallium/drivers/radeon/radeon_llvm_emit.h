@@ -28,6 +28,10 @@
 #define RADEON_LLVM_EMIT_H
 
 #include <llvm-c/Core.h>
+#include <stdbool.h>
+
+struct tgsi_token;
+struct util_disk_cache;
 
 struct radeon_llvm_binary {
 	unsigned char *code;
@@ -45,4 +49,27 @@ unsigned  radeon_llvm_compile(
 	const char * gpu_family,
 	unsigned dump);
 
+void *radeon_llvm_cache_key(
+	const char *gpu_family,
+	const struct tgsi_token *tokens,
+	const void *state,
+	unsigned state_size,
+	unsigned *key_size);
+
+bool radeon_llvm_cache_get(
+	struct util_disk_cache *cache,
+	const void *key,
+	unsigned key_size,
+	struct radeon_llvm_binary *binary,
+	void *extra,
+	unsigned extra_size);
+
+void radeon_llvm_cache_put(
+	struct util_disk_cache *cache,
+	const void *key,
+	unsigned key_size,
+	const struct radeon_llvm_binary *binary,
+	const void *extra,
+	unsigned extra_size);
+
 #endif /* RADEON_LLVM_EMIT_H */
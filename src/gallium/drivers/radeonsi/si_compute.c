@@ -76,7 +76,7 @@ static void *si_create_compute_state(
 	for (i = 0; i < program->num_kernels; i++) {
 		LLVMModuleRef mod = radeon_llvm_get_kernel_module(program->llvm_ctx, i,
 							code, header->num_bytes);
-		si_compile_llvm(sctx, &program->kernels[i], mod);
+		si_compile_llvm(sctx, &program->kernels[i], mod, NULL, 0);
 		LLVMDisposeModule(mod);
 	}
 
@@ -111,14 +111,14 @@ static void si_init_descriptors(struct si_context *sctx,
 				unsigned shader_userdata_reg,
 				unsigned element_dw_size,
 				unsigned num_elements,
-				void (*emit_func)(struct si_context *ctx, struct r600_atom *state))
+				uint32_t **data)
 {
 	uint64_t va;
 
 	assert(num_elements <= sizeof(desc->enabled_mask)*8);
 	assert(num_elements <= sizeof(desc->dirty_mask)*8);
 
-	desc->atom.emit = (void*)emit_func;
+	desc->data = data;
 	desc->shader_userdata_reg = shader_userdata_reg;
 	desc->element_dw_size = element_dw_size;
 	desc->num_elements = num_elements;
@@ -143,25 +143,56 @@ static void si_release_descriptors(struct si_descriptors *desc)
 	pipe_resource_reference((struct pipe_resource**)&desc->buffer, NULL);
 }
 
+/* All descriptor arrays of the context, in the order they are emitted. */
+#define SI_NUM_DESCRIPTORS (3 * SI_NUM_SHADERS)
+
+static struct si_descriptors *si_get_descriptors(struct si_context *sctx,
+						 unsigned i)
+{
+	unsigned shader = i % SI_NUM_SHADERS;
+
+	switch (i / SI_NUM_SHADERS) {
+	case 0:
+		return &sctx->const_buffers[shader].desc;
+	case 1:
+		return &sctx->rw_buffers[shader].desc;
+	default:
+		return &sctx->samplers[shader].views.desc;
+	}
+}
+
+/* The elements which must be copied from the current context to the new
+ * one: those which have ever been written, and so may be non-zero, and
+ * aren't about to be overwritten. */
+static unsigned si_descriptors_copy_mask(struct si_descriptors *desc)
+{
+	return desc->used_mask & ~desc->dirty_mask;
+}
+
 static void si_update_descriptors(struct si_context *sctx,
 				  struct si_descriptors *desc)
 {
+	sctx->descriptors.num_dw -= desc->num_dw;
+
 	if (desc->dirty_mask) {
-		desc->atom.num_dw =
-			7 + /* copy */
+		desc->num_dw =
 			(4 + desc->element_dw_size) * util_bitcount(desc->dirty_mask) + /* update */
 			4; /* pointer update */
+		if (si_descriptors_copy_mask(desc))
+			desc->num_dw += 7; /* copy */
 #if HAVE_LLVM >= 0x0305
 		if (desc->shader_userdata_reg >= R_00B130_SPI_SHADER_USER_DATA_VS_0 &&
 		    desc->shader_userdata_reg < R_00B230_SPI_SHADER_USER_DATA_GS_0)
-			desc->atom.num_dw += 4; /* second pointer update */
+			desc->num_dw += 4; /* second pointer update */
 #endif
-		desc->atom.dirty = true;
 		/* The descriptors are read with the K cache. */
 		sctx->b.flags |= R600_CONTEXT_INV_CONST_CACHE;
 	} else {
-		desc->atom.dirty = false;
+		desc->num_dw = 0;
 	}
+
+	sctx->descriptors.num_dw += desc->num_dw;
+	sctx->descriptors.dirty = sctx->descriptors.num_dw != 0;
 }
 
 static void si_emit_shader_pointer(struct si_context *sctx,
@@ -190,9 +221,32 @@ static void si_emit_shader_pointer(struct si_context *sctx,
 #endif
 }
 
-static void si_emit_descriptors(struct si_context *sctx,
+/* Copy the elements which aren't dirty to a new context slot. */
+static void si_copy_descriptors(struct si_context *sctx,
 				struct si_descriptors *desc,
-				uint32_t **descriptors)
+				unsigned flags)
+{
+	unsigned copy_mask = si_descriptors_copy_mask(desc);
+	unsigned new_context_id = (desc->current_context_id + 1) % SI_NUM_CONTEXTS;
+	unsigned element_size = desc->element_dw_size * 4;
+	unsigned first = ffs(copy_mask) - 1;
+	unsigned last = util_last_bit(copy_mask);
+	uint64_t va_base;
+
+	va_base = r600_resource_va(sctx->b.b.screen, &desc->buffer->b.b) +
+		  first * element_size;
+
+	/* XXX Consider using TC or L2 for this copy on CIK. */
+	si_emit_cp_dma_copy_buffer(sctx,
+				   va_base + new_context_id * desc->context_size,
+				   va_base + desc->current_context_id * desc->context_size,
+				   (last - first) * element_size, flags);
+}
+
+/* Write the dirty elements to the new context slot and make that one
+ * current. */
+static void si_write_descriptors(struct si_context *sctx,
+				 struct si_descriptors *desc)
 {
 	struct radeon_winsys_cs *cs = sctx->b.rings.gfx.cs;
 	uint64_t va_base;
@@ -204,16 +258,8 @@ static void si_emit_descriptors(struct si_context *sctx,
 
 	assert(dirty_mask);
 
-	va_base = r600_resource_va(sctx->b.b.screen, &desc->buffer->b.b);
-
-	/* Copy the descriptors to a new context slot. */
-	/* XXX Consider using TC or L2 for this copy on CIK. */
-	si_emit_cp_dma_copy_buffer(sctx,
-				   va_base + new_context_id * desc->context_size,
-				   va_base + desc->current_context_id * desc->context_size,
-				   desc->context_size, R600_CP_DMA_SYNC);
-
-	va_base += new_context_id * desc->context_size;
+	va_base = r600_resource_va(sctx->b.b.screen, &desc->buffer->b.b) +
+		  new_context_id * desc->context_size;
 
 	/* Update the descriptors.
 	 * Updates of consecutive descriptors are merged to one WRITE_DATA packet.
@@ -245,18 +291,59 @@ static void si_emit_descriptors(struct si_context *sctx,
 			radeon_emit(cs, (va >> 32UL) & 0xFFFFFFFFUL);
 		}
 
-		radeon_emit_array(cs, descriptors[i], desc->element_dw_size);
+		radeon_emit_array(cs, desc->data[i], desc->element_dw_size);
 
 		last_index = i;
 	}
 
+	desc->used_mask |= desc->dirty_mask;
 	desc->dirty_mask = 0;
+	desc->num_dw = 0;
 	desc->current_context_id = new_context_id;
 
 	/* Now update the shader userdata pointer. */
 	si_emit_shader_pointer(sctx, desc);
 }
 
+/* Emit the updates of all dirty descriptor arrays.
+ *
+ * Each update goes to a new context slot, so the copies of the elements
+ * which don't change are done first, for all arrays at once, and only the
+ * last copy waits for CP DMA to finish.  The copy is skipped entirely if
+ * all elements in use are rewritten.
+ */
+static void si_emit_all_descriptors(struct si_context *sctx,
+				    struct r600_atom *atom)
+{
+	int i, last_copy = -1;
+
+	for (i = 0; i < SI_NUM_DESCRIPTORS; i++) {
+		struct si_descriptors *desc = si_get_descriptors(sctx, i);
+
+		if (desc->dirty_mask && si_descriptors_copy_mask(desc))
+			last_copy = i;
+	}
+
+	/* CP DMA packets are executed in order, so syncing the last one
+	 * waits for all of them. */
+	for (i = 0; i <= last_copy; i++) {
+		struct si_descriptors *desc = si_get_descriptors(sctx, i);
+
+		if (desc->dirty_mask && si_descriptors_copy_mask(desc))
+			si_copy_descriptors(sctx, desc,
+					    i == last_copy ? R600_CP_DMA_SYNC : 0);
+	}
+
+	for (i = 0; i < SI_NUM_DESCRIPTORS; i++) {
+		struct si_descriptors *desc = si_get_descriptors(sctx, i);
+
+		if (desc->dirty_mask)
+			si_write_descriptors(sctx, desc);
+	}
+
+	sctx->descriptors.num_dw = 0;
+}
+
 static unsigned si_get_shader_user_data_base(unsigned shader)
 {
 	switch (shader) {
@@ -274,13 +361,6 @@ static unsigned si_get_shader_user_data_base(unsigned shader)
 
 /* SAMPLER VIEWS */
 
-static void si_emit_sampler_views(struct si_context *sctx, struct r600_atom *atom)
-{
-	struct si_sampler_views *views = (struct si_sampler_views*)atom;
-
-	si_emit_descriptors(sctx, &views->desc, views->desc_data);
-}
-
 static void si_init_sampler_views(struct si_context *sctx,
 				  struct si_sampler_views *views,
 				  unsigned shader)
@@ -288,7 +368,7 @@ static void si_init_sampler_views(struct si_context *sctx,
 	si_init_descriptors(sctx, &views->desc,
 			    si_get_shader_user_data_base(shader) +
 			    SI_SGPR_RESOURCE * 4,
-			    8, NUM_SAMPLER_VIEWS, si_emit_sampler_views);
+			    8, NUM_SAMPLER_VIEWS, views->desc_data);
 }
 
 static void si_release_sampler_views(struct si_sampler_views *views)
@@ -320,12 +400,13 @@ static void si_sampler_views_begin_new_cs(struct si_context *sctx,
 	si_emit_shader_pointer(sctx, &views->desc);
 }
 
-void si_set_sampler_view(struct si_context *sctx, unsigned shader,
-			 unsigned slot, struct pipe_sampler_view *view,
-			 unsigned *view_desc)
+/* Bind a view without updating the descriptor state,
+ * so that binding several views only does that once. */
+static void si_bind_sampler_view(struct si_context *sctx,
+				 struct si_sampler_views *views,
+				 unsigned slot, struct pipe_sampler_view *view,
+				 unsigned *view_desc)
 {
-	struct si_sampler_views *views = &sctx->samplers[shader].views;
-
 	if (views->views[slot] == view)
 		return;
 
@@ -345,18 +426,94 @@ void si_set_sampler_view(struct si_context *sctx, unsigned shader,
 	}
 
 	views->desc.dirty_mask |= 1 << slot;
-	si_update_descriptors(sctx, &views->desc);
 }
 
-/* BUFFER RESOURCES */
+void si_set_sampler_view(struct si_context *sctx, unsigned shader,
+			 unsigned slot, struct pipe_sampler_view *view,
+			 unsigned *view_desc)
+{
+	struct si_sampler_views *views = &sctx->samplers[shader].views;
+
+	if (views->views[slot] == view)
+		return;
 
-static void si_emit_buffer_resources(struct si_context *sctx, struct r600_atom *atom)
+	si_bind_sampler_view(sctx, views, slot, view, view_desc);
+	si_update_descriptors(sctx, &views->desc);
+}
+
+static void si_set_sampler_views(struct pipe_context *ctx,
+				 unsigned shader, unsigned start,
+				 unsigned count,
+				 struct pipe_sampler_view **views)
 {
-	struct si_buffer_resources *buffers = (struct si_buffer_resources*)atom;
+	struct si_context *sctx = (struct si_context *)ctx;
+	struct si_textures_info *samplers;
+	struct si_sampler_views *descs;
+	struct si_pipe_sampler_view **rviews = (struct si_pipe_sampler_view **)views;
+	int i;
 
-	si_emit_descriptors(sctx, &buffers->desc, buffers->desc_data);
+	if (shader >= SI_NUM_SHADERS)
+		return;
+
+	samplers = &sctx->samplers[shader];
+	descs = &samplers->views;
+
+	assert(start == 0);
+
+	for (i = 0; i < count; i++) {
+		if (!views[i]) {
+			samplers->depth_texture_mask &= ~(1 << i);
+			samplers->compressed_colortex_mask &= ~(1 << i);
+			si_bind_sampler_view(sctx, descs, i, NULL, NULL);
+			si_bind_sampler_view(sctx, descs, FMASK_TEX_OFFSET + i,
+					     NULL, NULL);
+			continue;
+		}
+
+		si_bind_sampler_view(sctx, descs, i, views[i], rviews[i]->state);
+
+		if (views[i]->texture->target != PIPE_BUFFER) {
+			struct r600_texture *rtex =
+				(struct r600_texture*)views[i]->texture;
+
+			if (rtex->is_depth && !rtex->is_flushing_texture) {
+				samplers->depth_texture_mask |= 1 << i;
+			} else {
+				samplers->depth_texture_mask &= ~(1 << i);
+			}
+			if (rtex->cmask.size || rtex->fmask.size) {
+				samplers->compressed_colortex_mask |= 1 << i;
+			} else {
+				samplers->compressed_colortex_mask &= ~(1 << i);
+			}
+
+			if (rtex->fmask.size) {
+				si_bind_sampler_view(sctx, descs, FMASK_TEX_OFFSET + i,
+						     views[i], rviews[i]->fmask_state);
+			} else {
+				si_bind_sampler_view(sctx, descs, FMASK_TEX_OFFSET + i,
+						     NULL, NULL);
+			}
+		}
+	}
+	for (; i < samplers->n_views; i++) {
+		samplers->depth_texture_mask &= ~(1 << i);
+		samplers->compressed_colortex_mask &= ~(1 << i);
+		si_bind_sampler_view(sctx, descs, i, NULL, NULL);
+		si_bind_sampler_view(sctx, descs, FMASK_TEX_OFFSET + i,
+				     NULL, NULL);
+	}
+
+	samplers->n_views = count;
+
+	/* One descriptor update for all the views. It's a no-op if
+	 * none of them changed. */
+	si_update_descriptors(sctx, &descs->desc);
+	sctx->b.flags |= R600_CONTEXT_INV_TEX_CACHE;
 }
 
+/* BUFFER RESOURCES */
+
 static void si_init_buffer_resources(struct si_context *sctx,
 				     struct si_buffer_resources *buffers,
 				     unsigned num_buffers, unsigned shader,
@@ -370,7 +527,7 @@ static void si_init_buffer_resources(struct si_context *sctx,
 	buffers->buffers = CALLOC(num_buffers, sizeof(struct pipe_resource*));
 	buffers->desc_storage = CALLOC(num_buffers, sizeof(uint32_t) * 4);
 
-	/* si_emit_descriptors only accepts an array of arrays.
+	/* si_write_descriptors only accepts an array of arrays.
 	 * This adds such an array. */
 	buffers->desc_data = CALLOC(num_buffers, sizeof(uint32_t*));
 	for (i = 0; i < num_buffers; i++) {
@@ -380,7 +537,7 @@ static void si_init_buffer_resources(struct si_context *sctx,
 	si_init_descriptors(sctx, &buffers->desc,
 			    si_get_shader_user_data_base(shader) +
 			    shader_userdata_index*4, 4, num_buffers,
-			    si_emit_buffer_resources);
+			    buffers->desc_data);
 }
 
 static void si_release_buffer_resources(struct si_buffer_resources *buffers)
@@ -962,15 +1119,15 @@ void si_init_all_descriptors(struct si_context *sctx)
 					 RADEON_USAGE_READWRITE);
 
 		si_init_sampler_views(sctx, &sctx->samplers[i].views, i);
-
-		sctx->atoms.const_buffers[i] = &sctx->const_buffers[i].desc.atom;
-		sctx->atoms.rw_buffers[i] = &sctx->rw_buffers[i].desc.atom;
-		sctx->atoms.sampler_views[i] = &sctx->samplers[i].views.desc.atom;
 	}
 
+	sctx->descriptors.emit = (void*)si_emit_all_descriptors;
+	sctx->atoms.descriptors = &sctx->descriptors;
+
 
 	/* Set pipe_context functions. */
 	sctx->b.b.set_constant_buffer = si_set_constant_buffer;
+	sctx->b.b.set_sampler_views = si_set_sampler_views;
 	sctx->b.b.set_stream_output_targets = si_set_streamout_targets;
 	sctx->b.clear_buffer = si_clear_buffer;
 	sctx->b.invalidate_buffer = si_invalidate_buffer;
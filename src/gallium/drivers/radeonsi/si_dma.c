@@ -0,0 +1,176 @@
+/*
+ * Copyright 2013 Advanced Micro Devices, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * on the rights to use, copy, modify, merge, publish, distribute, sub
+ * license, and/or sell copies of the Software, and to permit persons to whom
+ * the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHOR(S) AND/OR THEIR SUPPLIERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE
+ * USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+#include "../radeon/r600_cs.h"
+#include "si_pipe.h"
+#include "sid.h"
+
+#include "util/u_format.h"
+
+static void si_need_dma_space(struct si_context *sctx, unsigned num_dw)
+{
+	/* The number of dwords we already used in the DMA so far. */
+	num_dw += sctx->b.rings.dma.cs->cdw;
+	/* Flush if there's not enough space. */
+	if (num_dw > RADEON_MAX_CMDBUF_DWORDS) {
+		sctx->b.rings.dma.flush(sctx, RADEON_FLUSH_ASYNC);
+	}
+}
+
+static void si_dma_copy_buffer(struct si_context *sctx,
+			       struct pipe_resource *dst,
+			       struct pipe_resource *src,
+			       uint64_t dst_offset,
+			       uint64_t src_offset,
+			       uint64_t size)
+{
+	struct radeon_winsys_cs *cs = sctx->b.rings.dma.cs;
+	unsigned i, ncopy, csize, max_csize, sub_cmd, shift;
+	struct r600_resource *rdst = (struct r600_resource*)dst;
+	struct r600_resource *rsrc = (struct r600_resource*)src;
+
+	/* Mark the buffer range of destination as valid (initialized),
+	 * so that transfer_map knows it should wait for the GPU when mapping
+	 * that range. */
+	util_range_add(&rdst->valid_buffer_range, dst_offset,
+		       dst_offset + size);
+
+	/* make sure that the dma ring is only one active */
+	sctx->b.rings.gfx.flush(sctx, RADEON_FLUSH_ASYNC);
+	dst_offset += r600_resource_va(&sctx->screen->b.b, dst);
+	src_offset += r600_resource_va(&sctx->screen->b.b, src);
+
+	/* see if we use dword or byte copy */
+	if (!(dst_offset & 0x3) && !(src_offset & 0x3) && !(size & 0x3)) {
+		size >>= 2;
+		sub_cmd = SI_DMA_COPY_DWORD_ALIGNED;
+		shift = 2;
+		max_csize = SI_DMA_COPY_MAX_SIZE_DW;
+	} else {
+		sub_cmd = SI_DMA_COPY_BYTE_ALIGNED;
+		shift = 0;
+		max_csize = SI_DMA_COPY_MAX_SIZE;
+	}
+	ncopy = (size / max_csize) + !!(size % max_csize);
+
+	si_need_dma_space(sctx, ncopy * 5);
+	for (i = 0; i < ncopy; i++) {
+		csize = size < max_csize ? size : max_csize;
+		/* emit reloc before writting cs so that cs is always in consistent state */
+		r600_context_bo_reloc(&sctx->b, &sctx->b.rings.dma, rsrc, RADEON_USAGE_READ);
+		r600_context_bo_reloc(&sctx->b, &sctx->b.rings.dma, rdst, RADEON_USAGE_WRITE);
+		cs->buf[cs->cdw++] = SI_DMA_PACKET(SI_DMA_PACKET_COPY, sub_cmd, csize);
+		cs->buf[cs->cdw++] = dst_offset & 0xffffffff;
+		cs->buf[cs->cdw++] = src_offset & 0xffffffff;
+		cs->buf[cs->cdw++] = (dst_offset >> 32UL) & 0xff;
+		cs->buf[cs->cdw++] = (src_offset >> 32UL) & 0xff;
+		dst_offset += csize << shift;
+		src_offset += csize << shift;
+		size -= csize;
+	}
+}
+
+boolean si_dma_copy(struct pipe_context *ctx,
+		    struct pipe_resource *dst,
+		    unsigned dst_level,
+		    unsigned dst_x, unsigned dst_y, unsigned dst_z,
+		    struct pipe_resource *src,
+		    unsigned src_level,
+		    const struct pipe_box *src_box)
+{
+	struct si_context *sctx = (struct si_context *)ctx;
+	struct r600_texture *rsrc = (struct r600_texture*)src;
+	struct r600_texture *rdst = (struct r600_texture*)dst;
+	unsigned dst_pitch, src_pitch, bpp, dst_mode, src_mode, copy_height;
+	unsigned src_w, dst_w, src_x, src_y, i;
+	uint64_t dst_offset, src_offset, copy_size;
+
+	if (sctx->b.rings.dma.cs == NULL) {
+		return FALSE;
+	}
+
+	if (dst->target == PIPE_BUFFER && src->target == PIPE_BUFFER) {
+		si_dma_copy_buffer(sctx, dst, src, dst_x, src_box->x, src_box->width);
+		return TRUE;
+	}
+
+	if (src->format != dst->format) {
+		return FALSE;
+	}
+	if (rdst->dirty_level_mask != 0) {
+		return FALSE;
+	}
+	if (rsrc->dirty_level_mask) {
+		ctx->flush_resource(ctx, src);
+	}
+
+	src_x = util_format_get_nblocksx(src->format, src_box->x);
+	dst_x = util_format_get_nblocksx(src->format, dst_x);
+	src_y = util_format_get_nblocksy(src->format, src_box->y);
+	dst_y = util_format_get_nblocksy(src->format, dst_y);
+
+	bpp = rdst->surface.bpe;
+	dst_pitch = rdst->surface.level[dst_level].pitch_bytes;
+	src_pitch = rsrc->surface.level[src_level].pitch_bytes;
+	src_w = rsrc->surface.level[src_level].npix_x;
+	dst_w = rdst->surface.level[dst_level].npix_x;
+	copy_height = src_box->height / rsrc->surface.blk_h;
+
+	dst_mode = rdst->surface.level[dst_level].mode;
+	src_mode = rsrc->surface.level[src_level].mode;
+	/* downcast linear aligned to linear to simplify test */
+	src_mode = src_mode == RADEON_SURF_MODE_LINEAR_ALIGNED ? RADEON_SURF_MODE_LINEAR : src_mode;
+	dst_mode = dst_mode == RADEON_SURF_MODE_LINEAR_ALIGNED ? RADEON_SURF_MODE_LINEAR : dst_mode;
+
+	/* Only whole rows of surfaces with the same layout can be copied
+	 * as a plain range of bytes. Tiled<->linear conversion needs the
+	 * L2T/T2L packets, which aren't implemented yet. */
+	if (src_mode != dst_mode || src_pitch != dst_pitch ||
+	    src_box->x || dst_x || src_w != dst_w) {
+		return FALSE;
+	}
+	/* Tiled rows are interleaved within (macro) tiles, so tiled
+	 * surfaces can only be copied as whole slices. */
+	if (src_mode != RADEON_SURF_MODE_LINEAR) {
+		if (src_y || dst_y ||
+		    copy_height != rsrc->surface.level[src_level].nblk_y ||
+		    rsrc->surface.level[src_level].slice_size !=
+		    rdst->surface.level[dst_level].slice_size) {
+			return FALSE;
+		}
+		copy_size = rsrc->surface.level[src_level].slice_size;
+	} else {
+		copy_size = (uint64_t)copy_height * src_pitch;
+	}
+
+	for (i = 0; i < src_box->depth; i++) {
+		src_offset = rsrc->surface.level[src_level].offset;
+		src_offset += rsrc->surface.level[src_level].slice_size * (src_box->z + i);
+		src_offset += src_y * src_pitch + src_x * bpp;
+		dst_offset = rdst->surface.level[dst_level].offset;
+		dst_offset += rdst->surface.level[dst_level].slice_size * (dst_z + i);
+		dst_offset += dst_y * dst_pitch + dst_x * bpp;
+		si_dma_copy_buffer(sctx, dst, src, dst_offset, src_offset,
+				   copy_size);
+	}
+	return TRUE;
+}
@@ -65,8 +65,16 @@ static void si_flush_from_st(struct pipe_context *ctx,
 			     struct pipe_fence_handle **fence,
 			     unsigned flags)
 {
-	si_flush(ctx, fence,
-		 flags & PIPE_FLUSH_END_OF_FRAME ? RADEON_FLUSH_END_OF_FRAME : 0);
+	struct si_context *sctx = (struct si_context *)ctx;
+	unsigned fflags;
+
+	fflags = flags & PIPE_FLUSH_END_OF_FRAME ? RADEON_FLUSH_END_OF_FRAME : 0;
+
+	/* flush gfx & dma ring, order does not matter as only one can be live */
+	if (sctx->b.rings.dma.cs) {
+		sctx->b.rings.dma.flush(sctx, fflags);
+	}
+	si_flush(ctx, fence, fflags);
 }
 
 static void si_flush_from_winsys(void *ctx, unsigned flags)
@@ -74,10 +82,32 @@ static void si_flush_from_winsys(void *ctx, unsigned flags)
 	si_flush((struct pipe_context*)ctx, NULL, flags);
 }
 
+static void si_flush_dma_ring(void *ctx, unsigned flags)
+{
+	struct si_context *sctx = (struct si_context *)ctx;
+	struct radeon_winsys_cs *cs = sctx->b.rings.dma.cs;
+
+	if (!cs->cdw) {
+		return;
+	}
+
+	sctx->b.rings.dma.flushing = true;
+	sctx->b.ws->cs_flush(cs, flags, 0);
+	sctx->b.rings.dma.flushing = false;
+}
+
+static void si_flush_dma_from_winsys(void *ctx, unsigned flags)
+{
+	struct si_context *sctx = (struct si_context *)ctx;
+
+	sctx->b.rings.dma.flush(sctx, flags);
+}
+
 static void si_destroy_context(struct pipe_context *context)
 {
 	struct si_context *sctx = (struct si_context *)context;
 
+	si_wait_compile_jobs(sctx);
 	si_release_all_descriptors(sctx);
 
 	pipe_resource_reference(&sctx->null_const_buf.buffer, NULL);
@@ -144,6 +174,18 @@ static struct pipe_context *si_create_context(struct pipe_screen *screen, void *
 	sctx->b.rings.gfx.cs = sctx->b.ws->cs_create(sctx->b.ws, RING_GFX, NULL);
 	sctx->b.rings.gfx.flush = si_flush_from_winsys;
 
+	/* CIK uses a different SDMA packet format, which isn't
+	 * implemented yet. */
+	sctx->b.rings.dma.cs = NULL;
+	if (sscreen->b.chip_class == SI &&
+	    sscreen->b.info.r600_has_dma &&
+	    !(sscreen->b.debug_flags & DBG_NO_ASYNC_DMA)) {
+		sctx->b.rings.dma.cs = sctx->b.ws->cs_create(sctx->b.ws, RING_DMA, NULL);
+		sctx->b.rings.dma.flush = si_flush_dma_ring;
+		sctx->b.ws->cs_set_flush_callback(sctx->b.rings.dma.cs, si_flush_dma_from_winsys, sctx);
+		sctx->b.rings.dma.flushing = false;
+	}
+
 	si_init_all_descriptors(sctx);
 
 	/* Initialize cache_flush. */
@@ -252,6 +294,7 @@ static int si_get_param(struct pipe_screen* pscreen, enum pipe_cap param)
 	case PIPE_CAP_TEXTURE_BUFFER_OBJECTS:
         case PIPE_CAP_TGSI_VS_LAYER:
 	case PIPE_CAP_QUERY_PIPELINE_STATISTICS:
+	case PIPE_CAP_BUFFER_MAP_PERSISTENT_COHERENT:
 		return 1;
 
 	case PIPE_CAP_TEXTURE_MULTISAMPLE:
@@ -417,6 +460,7 @@ static void si_destroy_screen(struct pipe_screen* pscreen)
 	if (!radeon_winsys_unref(sscreen->b.ws))
 		return;
 
+	si_destroy_compiler_threads(sscreen);
 	r600_destroy_common_screen(&sscreen->b);
 }
 
@@ -446,6 +490,8 @@ struct pipe_screen *radeonsi_screen_create(struct radeon_winsys *ws)
 	if (debug_get_bool_option("RADEON_DUMP_SHADERS", FALSE))
 		sscreen->b.debug_flags |= DBG_FS | DBG_VS | DBG_GS | DBG_PS | DBG_CS;
 
+	si_init_compiler_threads(sscreen);
+
 	/* Create the auxiliary context. This must be done last. */
 	sscreen->b.aux_context = sscreen->b.b.context_create(&sscreen->b.b, NULL);
 
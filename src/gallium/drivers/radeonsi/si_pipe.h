@@ -39,10 +39,25 @@
 
 #define SI_MAX_DRAW_CS_DWORDS 18
 
+#define SI_MAX_COMPILER_THREADS 4
+
 struct si_pipe_compute;
+struct si_pipe_shader;
 
 struct si_screen {
 	struct r600_common_screen	b;
+
+	/* Threads compiling the first variant of new shaders in the
+	 * background, see si_init_compiler_threads(). */
+	unsigned			num_compiler_threads;
+	pipe_thread			compiler_threads[SI_MAX_COMPILER_THREADS];
+	/* Protects the queue, compile_exit, the variants' compiling flags
+	 * and the contexts' num_compile_jobs. */
+	pipe_mutex			compile_mutex;
+	pipe_condvar			compile_cond; /* a job was queued */
+	pipe_condvar			compile_done_cond; /* a job finished */
+	struct si_pipe_shader		*compile_head, *compile_tail;
+	bool				compile_exit;
 };
 
 struct si_pipe_sampler_view {
@@ -90,13 +105,13 @@ struct si_context {
 	void				*custom_blend_resolve;
 	void				*custom_blend_decompress;
 	struct si_screen		*screen;
+	/* Variants of this context queued or being compiled. */
+	unsigned			num_compile_jobs;
 
 	union {
 		struct {
 			/* The order matters. */
-			struct r600_atom *const_buffers[SI_NUM_SHADERS];
-			struct r600_atom *rw_buffers[SI_NUM_SHADERS];
-			struct r600_atom *sampler_views[SI_NUM_SHADERS];
+			struct r600_atom *descriptors;
 			/* Caches must be flushed after resource descriptors are
 			 * updated in memory. */
 			struct r600_atom *cache_flush;
@@ -146,6 +161,8 @@ struct si_context {
 	struct si_pm4_state	*gs_off;
 	struct si_pm4_state	*gs_rings;
 	struct r600_atom	cache_flush;
+	/* Updates of all resource descriptor arrays. */
+	struct r600_atom	descriptors;
 	struct pipe_constant_buffer null_const_buf; /* used for set_constant_buffer(NULL) on CIK */
 	struct pipe_constant_buffer esgs_ring;
 	struct pipe_constant_buffer gsvs_ring;
@@ -153,6 +170,7 @@ struct si_context {
 	/* SI state handling */
 	union si_state	queued;
 	union si_state	emitted;
+	struct si_pm4_shadow	shadow;
 };
 
 /* si_blit.c */
@@ -162,6 +180,15 @@ void si_flush_depth_textures(struct si_context *sctx,
 void si_decompress_color_textures(struct si_context *sctx,
 				  struct si_textures_info *textures);
 
+/* si_dma.c */
+boolean si_dma_copy(struct pipe_context *ctx,
+		    struct pipe_resource *dst,
+		    unsigned dst_level,
+		    unsigned dst_x, unsigned dst_y, unsigned dst_z,
+		    struct pipe_resource *src,
+		    unsigned src_level,
+		    const struct pipe_box *src_box);
+
 /* si_hw_context.c */
 void si_context_flush(struct si_context *ctx, unsigned flags);
 void si_begin_new_cs(struct si_context *ctx);
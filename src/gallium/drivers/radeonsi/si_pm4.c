@@ -210,21 +210,113 @@ unsigned si_pm4_dirty_dw(struct si_context *sctx)
 	return count;
 }
 
+/* Context registers which are also written outside of si_pm4_emit, by the
+ * common streamout code or with COPY_DATA, and so can't be shadowed. */
+static bool si_pm4_reg_is_shadowed(unsigned reg)
+{
+	return reg < (R_028AB0_VGT_STRMOUT_EN - SI_CONTEXT_REG_OFFSET) >> 2 ||
+	       reg > (R_028B98_VGT_STRMOUT_BUFFER_CONFIG - SI_CONTEXT_REG_OFFSET) >> 2;
+}
+
+/* Update the shadowed value of a register and return true if it changed. */
+static bool si_pm4_shadow_reg(struct si_pm4_shadow *shadow,
+			      unsigned reg, uint32_t val)
+{
+	uint32_t bit = 1u << (reg % 32);
+
+	if (!si_pm4_reg_is_shadowed(reg))
+		return true;
+
+	if ((shadow->valid[reg / 32] & bit) && shadow->regs[reg] == val)
+		return false;
+
+	shadow->valid[reg / 32] |= bit;
+	shadow->regs[reg] = val;
+	return true;
+}
+
+/* Emit a SET_CONTEXT_REG packet without the registers which are already set.
+ * Runs of changed registers separated by up to two unchanged ones are kept
+ * in one packet, because a new packet costs two dwords.
+ */
+static void si_pm4_emit_context_regs(struct si_context *sctx,
+				     const uint32_t *pkt)
+{
+	struct radeon_winsys_cs *cs = sctx->b.rings.gfx.cs;
+	unsigned header = pkt[0] & ~PKT_COUNT_S(0x3FFF);
+	unsigned num_regs = ((pkt[0] >> 16) & 0x3FFF);
+	unsigned reg = pkt[1];
+	unsigned packet_start = 0, last_emitted = 0;
+	bool in_packet = false;
+
+	for (unsigned i = 0; i < num_regs; i++) {
+		uint32_t val = pkt[2 + i];
+
+		if (!si_pm4_shadow_reg(&sctx->shadow, reg + i, val))
+			continue;
+
+		if (in_packet && i - last_emitted <= 3) {
+			/* Append the skipped registers and this one. */
+			for (unsigned j = last_emitted + 1; j <= i; j++)
+				cs->buf[cs->cdw++] = pkt[2 + j];
+		} else {
+			packet_start = cs->cdw;
+			cs->buf[cs->cdw++] = 0;
+			cs->buf[cs->cdw++] = reg + i;
+			cs->buf[cs->cdw++] = val;
+			in_packet = true;
+		}
+		cs->buf[packet_start] = header |
+			PKT_COUNT_S(cs->cdw - packet_start - 2);
+		last_emitted = i;
+	}
+}
+
 void si_pm4_emit(struct si_context *sctx, struct si_pm4_state *state)
 {
 	struct radeon_winsys_cs *cs = sctx->b.rings.gfx.cs;
-	for (int i = 0; i < state->nbo; ++i) {
+	unsigned i;
+
+	for (i = 0; i < state->nbo; ++i) {
 		r600_context_bo_reloc(&sctx->b, &sctx->b.rings.gfx, state->bo[i],
 				      state->bo_usage[i]);
 	}
 
-	memcpy(&cs->buf[cs->cdw], state->pm4, state->ndw * 4);
+	if (state->nrelocs) {
+		/* The relocations are relative to the start of the state,
+		 * so copy it as is and only update the shadow. */
+		for (i = 0; i < state->ndw; i += ((state->pm4[i] >> 16) & 0x3FFF) + 2) {
+			const uint32_t *pkt = &state->pm4[i];
 
-	for (int i = 0; i < state->nrelocs; ++i) {
-		cs->buf[cs->cdw + state->relocs[i]] += cs->cdw << 2;
-	}
+			if (((pkt[0] >> 8) & 0xFF) == PKT3_SET_CONTEXT_REG) {
+				unsigned num_regs = (pkt[0] >> 16) & 0x3FFF;
 
-	cs->cdw += state->ndw;
+				for (unsigned j = 0; j < num_regs; j++)
+					si_pm4_shadow_reg(&sctx->shadow, pkt[1] + j, pkt[2 + j]);
+			}
+		}
+
+		memcpy(&cs->buf[cs->cdw], state->pm4, state->ndw * 4);
+
+		for (i = 0; i < state->nrelocs; ++i) {
+			cs->buf[cs->cdw + state->relocs[i]] += cs->cdw << 2;
+		}
+
+		cs->cdw += state->ndw;
+	} else {
+		for (i = 0; i < state->ndw; ) {
+			const uint32_t *pkt = &state->pm4[i];
+			unsigned size = ((pkt[0] >> 16) & 0x3FFF) + 2;
+
+			if (((pkt[0] >> 8) & 0xFF) == PKT3_SET_CONTEXT_REG) {
+				si_pm4_emit_context_regs(sctx, pkt);
+			} else {
+				memcpy(&cs->buf[cs->cdw], pkt, size * 4);
+				cs->cdw += size;
+			}
+			i += size;
+		}
+	}
 
 #if SI_TRACE_CS
 	if (sctx->screen->b.trace_bo) {
@@ -250,4 +342,6 @@ void si_pm4_emit_dirty(struct si_context *sctx)
 void si_pm4_reset_emitted(struct si_context *sctx)
 {
 	memset(&sctx->emitted, 0, sizeof(sctx->emitted));
+	/* The register values aren't preserved between command streams. */
+	memset(sctx->shadow.valid, 0, sizeof(sctx->shadow.valid));
 }
@@ -33,10 +33,22 @@
 #define SI_PM4_MAX_BO		32
 #define SI_PM4_MAX_RELOCS	4
 
+/* The number of context registers, from SI_CONTEXT_REG_OFFSET to
+ * SI_CONTEXT_REG_END. */
+#define SI_PM4_NUM_CONTEXT_REGS	1024
+
 // forward defines
 struct si_context;
 enum chip_class;
 
+/* The context register values the CS has set so far.  SET_CONTEXT_REG
+ * writes of values which are already set are dropped by si_pm4_emit. */
+struct si_pm4_shadow
+{
+	uint32_t	valid[SI_PM4_NUM_CONTEXT_REGS / 32];
+	uint32_t	regs[SI_PM4_NUM_CONTEXT_REGS];
+};
+
 struct si_pm4_state
 {
 	/* family specific handling */
@@ -2274,32 +2274,21 @@ static void preload_streamout_buffers(struct si_shader_context *si_shader_ctx)
 	}
 }
 
-int si_compile_llvm(struct si_context *sctx, struct si_pipe_shader *shader,
-							LLVMModuleRef mod)
+/* Read the register counts and SPI state from the config, and upload the
+ * code of a compiled shader. */
+static int si_shader_binary_read(struct si_context *sctx,
+				 struct si_pipe_shader *shader,
+				 const struct radeon_llvm_binary *binary)
 {
 	unsigned i;
 	uint32_t *ptr;
-	struct radeon_llvm_binary binary;
-	bool dump = r600_can_dump_shader(&sctx->screen->b,
-			shader->selector ? shader->selector->tokens : NULL);
-	memset(&binary, 0, sizeof(binary));
-	radeon_llvm_compile(mod, &binary,
-		r600_get_llvm_processor_name(sctx->screen->b.family), dump);
-	if (dump && ! binary.disassembled) {
-		fprintf(stderr, "SI CODE:\n");
-		for (i = 0; i < binary.code_size; i+=4 ) {
-			fprintf(stderr, "%02x%02x%02x%02x\n", binary.code[i + 3],
-				binary.code[i + 2], binary.code[i + 1],
-				binary.code[i]);
-		}
-	}
 
 	/* XXX: We may be able to emit some of these values directly rather than
 	 * extracting fields to be emitted later.
 	 */
-	for (i = 0; i < binary.config_size; i+= 8) {
-		unsigned reg = util_le32_to_cpu(*(uint32_t*)(binary.config + i));
-		unsigned value = util_le32_to_cpu(*(uint32_t*)(binary.config + i + 4));
+	for (i = 0; i < binary->config_size; i+= 8) {
+		unsigned reg = util_le32_to_cpu(*(uint32_t*)(binary->config + i));
+		unsigned value = util_le32_to_cpu(*(uint32_t*)(binary->config + i + 4));
 		switch (reg) {
 		case R_00B028_SPI_SHADER_PGM_RSRC1_PS:
 		case R_00B128_SPI_SHADER_PGM_RSRC1_VS:
@@ -2327,38 +2316,143 @@ int si_compile_llvm(struct si_context *sctx, struct si_pipe_shader *shader,
 	/* copy new shader */
 	r600_resource_reference(&shader->bo, NULL);
 	shader->bo = si_resource_create_custom(sctx->b.b.screen, PIPE_USAGE_IMMUTABLE,
-					       binary.code_size);
+					       binary->code_size);
 	if (shader->bo == NULL) {
 		return -ENOMEM;
 	}
 
-	ptr = (uint32_t*)sctx->b.ws->buffer_map(shader->bo->cs_buf, sctx->b.rings.gfx.cs, PIPE_TRANSFER_WRITE);
+	/* The buffer is new and not referenced by any CS, so this doesn't
+	 * touch the command stream and can run on a compiler thread. */
+	ptr = (uint32_t*)sctx->b.ws->buffer_map(shader->bo->cs_buf, NULL, PIPE_TRANSFER_WRITE);
 	if (0 /*SI_BIG_ENDIAN*/) {
-		for (i = 0; i < binary.code_size / 4; ++i) {
-			ptr[i] = util_bswap32(*(uint32_t*)(binary.code + i*4));
+		for (i = 0; i < binary->code_size / 4; ++i) {
+			ptr[i] = util_bswap32(*(uint32_t*)(binary->code + i*4));
 		}
 	} else {
-		memcpy(ptr, binary.code, binary.code_size);
+		memcpy(ptr, binary->code, binary->code_size);
 	}
 	sctx->b.ws->buffer_unmap(shader->bo->cs_buf);
 
+	return 0;
+}
+
+/* The state filled in while translating a shader, which is stored in the
+ * disk cache along with its binary. */
+struct si_shader_cache_extra {
+	struct si_shader	shader;
+	unsigned		spi_shader_col_format;
+	unsigned		cb_shader_mask;
+};
+
+/* Build the disk cache key of a shader variant, or of the copy shader of
+ * a geometry shader. */
+static void *si_shader_cache_key(struct si_context *sctx,
+				 struct si_pipe_shader *shader,
+				 bool gs_copy_shader, unsigned *key_size)
+{
+	struct si_pipe_shader_selector *sel = shader->selector;
+	struct {
+		unsigned			gs_copy_shader;
+		union si_shader_key		key;
+		struct pipe_stream_output_info	so;
+		/* The ES outputs are laid out for the inputs of the GS. */
+		unsigned			gs_ninput;
+		struct si_shader_input		gs_input[40];
+	} state;
+
+	memset(&state, 0, sizeof(state));
+	state.gs_copy_shader = gs_copy_shader;
+	state.key = shader->key;
+	state.so = sel->so;
+	if (sel->type == PIPE_SHADER_VERTEX && shader->key.vs.as_es) {
+		struct si_shader *gs = &sctx->gs_shader->current->shader;
+
+		STATIC_ASSERT(sizeof(state.gs_input) == sizeof(gs->input));
+		state.gs_ninput = gs->ninput;
+		memcpy(state.gs_input, gs->input,
+		       gs->ninput * sizeof(gs->input[0]));
+	}
+
+	return radeon_llvm_cache_key(r600_get_llvm_processor_name(sctx->screen->b.family),
+				     sel->tokens, &state, sizeof(state), key_size);
+}
+
+/* Set up a shader from the disk cache, returns true on a hit. */
+static bool si_shader_cache_load(struct si_context *sctx,
+				 struct si_pipe_shader *shader,
+				 const void *key, unsigned key_size)
+{
+	struct radeon_llvm_binary binary;
+	struct si_shader_cache_extra extra;
+	int r;
+
+	if (!radeon_llvm_cache_get(sctx->screen->b.disk_cache, key, key_size,
+				   &binary, &extra, sizeof(extra)))
+		return false;
+
+	shader->shader = extra.shader;
+	shader->spi_shader_col_format = extra.spi_shader_col_format;
+	shader->cb_shader_mask = extra.cb_shader_mask;
+	r = si_shader_binary_read(sctx, shader, &binary);
+
+	FREE(binary.code);
+	FREE(binary.config);
+	return r == 0;
+}
+
+int si_compile_llvm(struct si_context *sctx, struct si_pipe_shader *shader,
+		    LLVMModuleRef mod, const void *cache_key,
+		    unsigned cache_key_size)
+{
+	unsigned i;
+	int r;
+	struct radeon_llvm_binary binary;
+	bool dump = r600_can_dump_shader(&sctx->screen->b,
+			shader->selector ? shader->selector->tokens : NULL);
+	memset(&binary, 0, sizeof(binary));
+	radeon_llvm_compile(mod, &binary,
+		r600_get_llvm_processor_name(sctx->screen->b.family), dump);
+	if (dump && ! binary.disassembled) {
+		fprintf(stderr, "SI CODE:\n");
+		for (i = 0; i < binary.code_size; i+=4 ) {
+			fprintf(stderr, "%02x%02x%02x%02x\n", binary.code[i + 3],
+				binary.code[i + 2], binary.code[i + 1],
+				binary.code[i]);
+		}
+	}
+
+	r = si_shader_binary_read(sctx, shader, &binary);
+
+	if (r == 0 && cache_key) {
+		struct si_shader_cache_extra extra;
+
+		memset(&extra, 0, sizeof(extra));
+		extra.shader = shader->shader;
+		extra.spi_shader_col_format = shader->spi_shader_col_format;
+		extra.cb_shader_mask = shader->cb_shader_mask;
+		radeon_llvm_cache_put(sctx->screen->b.disk_cache,
+				      cache_key, cache_key_size,
+				      &binary, &extra, sizeof(extra));
+	}
+
 	free(binary.code);
 	free(binary.config);
 
-	return 0;
+	return r;
 }
 
 /* Generate code for the hardware VS shader stage to go with a geometry shader */
 static int si_generate_gs_copy_shader(struct si_context *sctx,
 				      struct si_shader_context *si_shader_ctx,
-				      bool dump)
+				      struct si_shader *gs,
+				      bool dump, const void *cache_key,
+				      unsigned cache_key_size)
 {
 	struct gallivm_state *gallivm = &si_shader_ctx->radeon_bld.gallivm;
 	struct lp_build_tgsi_context *bld_base = &si_shader_ctx->radeon_bld.soa.bld_base;
 	struct lp_build_context *base = &bld_base->base;
 	struct lp_build_context *uint = &bld_base->uint_bld;
 	struct si_shader *shader = &si_shader_ctx->shader->shader;
-	struct si_shader *gs = &si_shader_ctx->shader->selector->current->shader;
 	struct si_shader_output_values *outputs;
 	LLVMValueRef t_list_ptr, t_list;
 	LLVMValueRef args[9];
@@ -2430,7 +2524,8 @@ static int si_generate_gs_copy_shader(struct si_context *sctx,
 		fprintf(stderr, "Copy Vertex Shader for Geometry Shader:\n\n");
 
 	r = si_compile_llvm(sctx, si_shader_ctx->shader,
-			    bld_base->base.gallivm->module);
+			    bld_base->base.gallivm->module,
+			    cache_key, cache_key_size);
 
 	radeon_llvm_dispose(&si_shader_ctx->radeon_bld);
 
@@ -2450,6 +2545,8 @@ int si_pipe_shader_create(
 	LLVMModuleRef mod;
 	int r = 0;
 	bool dump = r600_can_dump_shader(&sctx->screen->b, sel->tokens);
+	void *key = NULL, *copy_key = NULL;
+	unsigned key_size = 0, copy_key_size = 0;
 
 	/* Dump TGSI code before doing TGSI->LLVM conversion in case the
 	 * conversion fails. */
@@ -2462,6 +2559,39 @@ int si_pipe_shader_create(
 	assert(shader->shader.nparam == 0);
 	assert(shader->shader.ninput == 0);
 
+	/* Skip the translation and the compilation if the variant is in the
+	 * disk cache.  Dumping wants the LLVM output, so it bypasses the cache.
+	 */
+	if (sctx->screen->b.disk_cache && !dump) {
+		key = si_shader_cache_key(sctx, shader, false, &key_size);
+		if (sel->type == PIPE_SHADER_GEOMETRY)
+			copy_key = si_shader_cache_key(sctx, shader, true,
+						       &copy_key_size);
+
+		if (key && si_shader_cache_load(sctx, shader, key, key_size)) {
+			if (sel->type != PIPE_SHADER_GEOMETRY)
+				goto out_cached;
+
+			shader->gs_copy_shader = CALLOC_STRUCT(si_pipe_shader);
+			shader->gs_copy_shader->selector = shader->selector;
+			shader->gs_copy_shader->key = shader->key;
+			if (copy_key &&
+			    si_shader_cache_load(sctx, shader->gs_copy_shader,
+						 copy_key, copy_key_size))
+				goto out_cached;
+
+			si_pipe_shader_destroy(ctx, shader->gs_copy_shader);
+			FREE(shader->gs_copy_shader);
+			shader->gs_copy_shader = NULL;
+		}
+
+		/* Compile from scratch. */
+		si_pipe_shader_destroy(ctx, shader);
+		memset(&shader->shader, 0, sizeof(shader->shader));
+		shader->spi_shader_col_format = 0;
+		shader->cb_shader_mask = 0;
+	}
+
 	memset(&si_shader_ctx, 0, sizeof(si_shader_ctx));
 	radeon_llvm_context_init(&si_shader_ctx.radeon_bld);
 	bld_base = &si_shader_ctx.radeon_bld.soa.bld_base;
@@ -2558,7 +2688,7 @@ int si_pipe_shader_create(
 	radeon_llvm_finalize_module(&si_shader_ctx.radeon_bld);
 
 	mod = bld_base->base.gallivm->module;
-	r = si_compile_llvm(sctx, shader, mod);
+	r = si_compile_llvm(sctx, shader, mod, key, key_size);
 	if (r) {
 		fprintf(stderr, "LLVM failed to compile shader\n");
 		goto out;
@@ -2571,7 +2701,9 @@ int si_pipe_shader_create(
 		shader->gs_copy_shader->selector = shader->selector;
 		shader->gs_copy_shader->key = shader->key;
 		si_shader_ctx.shader = shader->gs_copy_shader;
-		if ((r = si_generate_gs_copy_shader(sctx, &si_shader_ctx, dump))) {
+		if ((r = si_generate_gs_copy_shader(sctx, &si_shader_ctx,
+						     &shader->shader, dump,
+						     copy_key, copy_key_size))) {
 			free(shader->gs_copy_shader);
 			shader->gs_copy_shader = NULL;
 			goto out;
@@ -2586,6 +2718,9 @@ out:
 	FREE(si_shader_ctx.resources);
 	FREE(si_shader_ctx.samplers);
 
+out_cached:
+	FREE(key);
+	FREE(copy_key);
 	return r;
 }
 
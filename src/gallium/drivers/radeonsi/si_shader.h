@@ -183,6 +183,14 @@ struct si_pipe_shader {
 	bool				cb0_is_integer;
 	unsigned			sprite_coord_enable;
 	union si_shader_key		key;
+
+	/* Asynchronous compilation.  compile_ctx is set while the variant
+	 * hasn't been waited for and is only used by the context's thread,
+	 * the rest is protected by the screen's compile_mutex. */
+	struct si_context		*compile_ctx;
+	struct si_pipe_shader		*compile_next;
+	bool				compiling;
+	int				compile_result;
 };
 
 static inline struct si_shader* si_get_vs_state(struct si_context *sctx)
@@ -197,7 +205,8 @@ static inline struct si_shader* si_get_vs_state(struct si_context *sctx)
 int si_pipe_shader_create(struct pipe_context *ctx, struct si_pipe_shader *shader);
 int si_pipe_shader_create(struct pipe_context *ctx, struct si_pipe_shader *shader);
 int si_compile_llvm(struct si_context *sctx, struct si_pipe_shader *shader,
-							LLVMModuleRef mod);
+		    LLVMModuleRef mod, const void *cache_key,
+		    unsigned cache_key_size);
 void si_pipe_shader_destroy(struct pipe_context *ctx, struct si_pipe_shader *shader);
 
 #endif
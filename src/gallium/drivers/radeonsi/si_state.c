@@ -31,6 +31,7 @@
 
 #include "tgsi/tgsi_parse.h"
 #include "tgsi/tgsi_scan.h"
+#include "util/u_cpu_detect.h"
 #include "util/u_format.h"
 #include "util/u_format_s3tc.h"
 #include "util/u_framebuffer.h"
@@ -2217,10 +2218,229 @@ static INLINE void si_shader_selector_key(struct pipe_context *ctx,
 	}
 }
 
+/*
+ * Asynchronous shader compilation
+ *
+ * The first variant of a new shader, built for the state bound when the
+ * shader is created, is compiled by a pool of per-screen threads.  Each
+ * compilation uses an LLVM context of its own.  Variant selection at draw
+ * time only waits for it if it's still being compiled, and compiles it
+ * directly if no thread has picked it up yet.  ES variants depend on the
+ * bound GS and later variants on the draw-time state, so they are compiled
+ * synchronously.
+ */
+
+static PIPE_THREAD_ROUTINE(si_compiler_thread, init_data)
+{
+	struct si_screen *sscreen = (struct si_screen *)init_data;
+
+	pipe_mutex_lock(sscreen->compile_mutex);
+	for (;;) {
+		struct si_pipe_shader *shader;
+		struct si_context *sctx;
+		int r;
+
+		while (!sscreen->compile_head && !sscreen->compile_exit)
+			pipe_condvar_wait(sscreen->compile_cond, sscreen->compile_mutex);
+
+		/* Finish the queued jobs before exiting. */
+		if (!sscreen->compile_head)
+			break;
+
+		shader = sscreen->compile_head;
+		sscreen->compile_head = shader->compile_next;
+		if (!sscreen->compile_head)
+			sscreen->compile_tail = NULL;
+		shader->compile_next = NULL;
+		sctx = shader->compile_ctx;
+		pipe_mutex_unlock(sscreen->compile_mutex);
+
+		r = si_pipe_shader_create(&sctx->b.b, shader);
+
+		pipe_mutex_lock(sscreen->compile_mutex);
+		shader->compile_result = r;
+		shader->compiling = false;
+		sctx->num_compile_jobs--;
+		pipe_condvar_broadcast(sscreen->compile_done_cond);
+	}
+	pipe_mutex_unlock(sscreen->compile_mutex);
+
+	return 0;
+}
+
+void si_init_compiler_threads(struct si_screen *sscreen)
+{
+	unsigned i, num_threads;
+
+	util_cpu_detect();
+
+	/* Leave a CPU to the application thread. */
+	num_threads = MIN2(util_cpu_caps.nr_cpus - 1, SI_MAX_COMPILER_THREADS);
+	num_threads = debug_get_num_option("RADEONSI_COMPILER_THREADS", num_threads);
+	num_threads = MIN2(num_threads, SI_MAX_COMPILER_THREADS);
+	if (!num_threads)
+		return;
+
+	pipe_mutex_init(sscreen->compile_mutex);
+	pipe_condvar_init(sscreen->compile_cond);
+	pipe_condvar_init(sscreen->compile_done_cond);
+
+	for (i = 0; i < num_threads; i++) {
+		sscreen->compiler_threads[i] =
+			pipe_thread_create(si_compiler_thread, sscreen);
+	}
+	sscreen->num_compiler_threads = num_threads;
+}
+
+void si_destroy_compiler_threads(struct si_screen *sscreen)
+{
+	unsigned i;
+
+	if (!sscreen->num_compiler_threads)
+		return;
+
+	pipe_mutex_lock(sscreen->compile_mutex);
+	sscreen->compile_exit = true;
+	pipe_condvar_broadcast(sscreen->compile_cond);
+	pipe_mutex_unlock(sscreen->compile_mutex);
+
+	for (i = 0; i < sscreen->num_compiler_threads; i++)
+		pipe_thread_wait(sscreen->compiler_threads[i]);
+	sscreen->num_compiler_threads = 0;
+
+	assert(!sscreen->compile_head);
+	pipe_condvar_destroy(sscreen->compile_done_cond);
+	pipe_condvar_destroy(sscreen->compile_cond);
+	pipe_mutex_destroy(sscreen->compile_mutex);
+}
+
+/* Wait until none of the context's variants is queued or being compiled. */
+void si_wait_compile_jobs(struct si_context *sctx)
+{
+	struct si_screen *sscreen = sctx->screen;
+
+	if (!sscreen->num_compiler_threads)
+		return;
+
+	pipe_mutex_lock(sscreen->compile_mutex);
+	while (sctx->num_compile_jobs)
+		pipe_condvar_wait(sscreen->compile_done_cond, sscreen->compile_mutex);
+	pipe_mutex_unlock(sscreen->compile_mutex);
+}
+
+/* Remove a variant from the queue if no thread has picked it up yet.
+ * Must be called with the screen's compile_mutex held. */
+static bool si_dequeue_shader(struct si_screen *sscreen,
+			      struct si_pipe_shader *shader)
+{
+	struct si_pipe_shader **p, *prev = NULL;
+
+	for (p = &sscreen->compile_head; *p; prev = *p, p = &(*p)->compile_next) {
+		if (*p == shader) {
+			*p = shader->compile_next;
+			if (sscreen->compile_tail == shader)
+				sscreen->compile_tail = prev;
+			shader->compile_next = NULL;
+			return true;
+		}
+	}
+	return false;
+}
+
+/* Queue the compilation of a new shader's first variant.  Returns false if
+ * the variant must be compiled synchronously. */
+static bool si_shader_queue(struct pipe_context *ctx,
+			    struct si_pipe_shader_selector *sel)
+{
+	struct si_context *sctx = (struct si_context *)ctx;
+	struct si_screen *sscreen = sctx->screen;
+	struct si_pipe_shader *shader;
+	union si_shader_key key;
+
+	if (!sscreen->num_compiler_threads)
+		return false;
+
+	si_shader_selector_key(ctx, sel, &key);
+	if (sel->type == PIPE_SHADER_VERTEX && key.vs.as_es)
+		return false;
+
+	shader = CALLOC(1, sizeof(struct si_pipe_shader));
+	if (!shader)
+		return false;
+	shader->selector = sel;
+	shader->key = key;
+	shader->compile_ctx = sctx;
+	shader->compiling = true;
+
+	sel->current = shader;
+	sel->num_shaders++;
+
+	pipe_mutex_lock(sscreen->compile_mutex);
+	if (sscreen->compile_tail)
+		sscreen->compile_tail->compile_next = shader;
+	else
+		sscreen->compile_head = shader;
+	sscreen->compile_tail = shader;
+	sctx->num_compile_jobs++;
+	pipe_condvar_signal(sscreen->compile_cond);
+	pipe_mutex_unlock(sscreen->compile_mutex);
+
+	return true;
+}
+
+/* Wait for a queued variant, compiling it here if no thread has picked it
+ * up yet, and return the result of the compilation. */
+static int si_finish_shader(struct si_context *sctx,
+			    struct si_pipe_shader *shader)
+{
+	struct si_screen *sscreen = sctx->screen;
+	int r;
+
+	pipe_mutex_lock(sscreen->compile_mutex);
+	if (shader->compiling && si_dequeue_shader(sscreen, shader)) {
+		pipe_mutex_unlock(sscreen->compile_mutex);
+
+		r = si_pipe_shader_create(&sctx->b.b, shader);
+
+		pipe_mutex_lock(sscreen->compile_mutex);
+		shader->compile_result = r;
+		shader->compiling = false;
+		shader->compile_ctx->num_compile_jobs--;
+	}
+	while (shader->compiling)
+		pipe_condvar_wait(sscreen->compile_done_cond, sscreen->compile_mutex);
+	pipe_mutex_unlock(sscreen->compile_mutex);
+
+	shader->compile_ctx = NULL;
+	return shader->compile_result;
+}
+
+/* Make sure no thread uses a variant which is about to be freed. */
+static void si_cancel_shader(struct si_context *sctx,
+			     struct si_pipe_shader *shader)
+{
+	struct si_screen *sscreen = sctx->screen;
+
+	if (!shader->compile_ctx)
+		return;
+
+	pipe_mutex_lock(sscreen->compile_mutex);
+	if (shader->compiling && si_dequeue_shader(sscreen, shader)) {
+		shader->compiling = false;
+		shader->compile_ctx->num_compile_jobs--;
+	}
+	while (shader->compiling)
+		pipe_condvar_wait(sscreen->compile_done_cond, sscreen->compile_mutex);
+	pipe_mutex_unlock(sscreen->compile_mutex);
+
+	shader->compile_ctx = NULL;
+}
+
 /* Select the hw shader variant depending on the current state. */
 int si_shader_select(struct pipe_context *ctx,
 		     struct si_pipe_shader_selector *sel)
 {
+	struct si_context *sctx = (struct si_context *)ctx;
 	union si_shader_key key;
 	struct si_pipe_shader * shader = NULL;
 	int r;
@@ -2232,11 +2452,13 @@ int si_shader_select(struct pipe_context *ctx,
 	 * variants, it will cost just a computation of the key and this
 	 * test. */
 	if (likely(sel->current && memcmp(&sel->current->key, &key, sizeof(key)) == 0)) {
-		return 0;
+		if (likely(!sel->current->compile_ctx))
+			return 0;
+		shader = sel->current;
 	}
 
 	/* lookup if we have other variants in the list */
-	if (sel->num_shaders > 1) {
+	if (!shader && sel->num_shaders > 1) {
 		struct si_pipe_shader *p = sel->current, *c = p->next_variant;
 
 		while (c && memcmp(&c->key, &key, sizeof(key)) != 0) {
@@ -2246,14 +2468,26 @@ int si_shader_select(struct pipe_context *ctx,
 
 		if (c) {
 			p->next_variant = c->next_variant;
+			c->next_variant = sel->current;
+			sel->current = c;
 			shader = c;
 		}
 	}
 
-	if (shader) {
-		shader->next_variant = sel->current;
-		sel->current = shader;
-	} else {
+	/* The variant may still be compiled in the background. */
+	if (shader && unlikely(shader->compile_ctx)) {
+		r = si_finish_shader(sctx, shader);
+		if (unlikely(r)) {
+			/* Try again below, reporting the error if any. */
+			sel->current = shader->next_variant;
+			sel->num_shaders--;
+			si_pipe_shader_destroy(ctx, shader);
+			FREE(shader);
+			shader = NULL;
+		}
+	}
+
+	if (!shader) {
 		shader = CALLOC(1, sizeof(struct si_pipe_shader));
 		shader->selector = sel;
 		shader->key = key;
@@ -2292,6 +2526,9 @@ static void *si_create_shader_state(struct pipe_context *ctx,
 		sel->fs_write_all = info.color0_writes_all_cbufs;
 	}
 
+	if (si_shader_queue(ctx, sel))
+		return sel;
+
 	r = si_shader_select(ctx, sel);
 	if (r) {
 	    free(sel);
@@ -2374,6 +2611,7 @@ static void si_delete_shader_selector(struct pipe_context *ctx,
 
 	while (p) {
 		c = p->next_variant;
+		si_cancel_shader(sctx, p);
 		si_pm4_delete_state(sctx, vs, p->pm4);
 		si_pipe_shader_destroy(ctx, p);
 		free(p);
@@ -2744,71 +2982,6 @@ static void *si_create_sampler_state(struct pipe_context *ctx,
 	return rstate;
 }
 
-/* XXX consider moving this function to si_descriptors.c for gcc to inline
- *     the si_set_sampler_view calls. LTO might help too. */
-static void si_set_sampler_views(struct pipe_context *ctx,
-				 unsigned shader, unsigned start,
-                                 unsigned count,
-				 struct pipe_sampler_view **views)
-{
-	struct si_context *sctx = (struct si_context *)ctx;
-	struct si_textures_info *samplers = &sctx->samplers[shader];
-	struct si_pipe_sampler_view **rviews = (struct si_pipe_sampler_view **)views;
-	int i;
-
-	if (shader >= SI_NUM_SHADERS)
-		return;
-
-	assert(start == 0);
-
-	for (i = 0; i < count; i++) {
-		if (!views[i]) {
-			samplers->depth_texture_mask &= ~(1 << i);
-			samplers->compressed_colortex_mask &= ~(1 << i);
-			si_set_sampler_view(sctx, shader, i, NULL, NULL);
-			si_set_sampler_view(sctx, shader, FMASK_TEX_OFFSET + i,
-					    NULL, NULL);
-			continue;
-		}
-
-		si_set_sampler_view(sctx, shader, i, views[i], rviews[i]->state);
-
-		if (views[i]->texture->target != PIPE_BUFFER) {
-			struct r600_texture *rtex =
-				(struct r600_texture*)views[i]->texture;
-
-			if (rtex->is_depth && !rtex->is_flushing_texture) {
-				samplers->depth_texture_mask |= 1 << i;
-			} else {
-				samplers->depth_texture_mask &= ~(1 << i);
-			}
-			if (rtex->cmask.size || rtex->fmask.size) {
-				samplers->compressed_colortex_mask |= 1 << i;
-			} else {
-				samplers->compressed_colortex_mask &= ~(1 << i);
-			}
-
-			if (rtex->fmask.size) {
-				si_set_sampler_view(sctx, shader, FMASK_TEX_OFFSET + i,
-						    views[i], rviews[i]->fmask_state);
-			} else {
-				si_set_sampler_view(sctx, shader, FMASK_TEX_OFFSET + i,
-						    NULL, NULL);
-			}
-		}
-	}
-	for (; i < samplers->n_views; i++) {
-		samplers->depth_texture_mask &= ~(1 << i);
-		samplers->compressed_colortex_mask &= ~(1 << i);
-		si_set_sampler_view(sctx, shader, i, NULL, NULL);
-		si_set_sampler_view(sctx, shader, FMASK_TEX_OFFSET + i,
-				    NULL, NULL);
-	}
-
-	samplers->n_views = count;
-	sctx->b.flags |= R600_CONTEXT_INV_TEX_CACHE;
-}
-
 static void si_set_sampler_states(struct si_context *sctx,
 				  struct si_pm4_state *pm4,
 				  unsigned count, void **states,
@@ -3101,18 +3274,6 @@ static void r600_surface_destroy(struct pipe_context *pipe,
 	FREE(surface);
 }
 
-static boolean si_dma_copy(struct pipe_context *ctx,
-			   struct pipe_resource *dst,
-			   unsigned dst_level,
-			   unsigned dst_x, unsigned dst_y, unsigned dst_z,
-			   struct pipe_resource *src,
-			   unsigned src_level,
-			   const struct pipe_box *src_box)
-{
-	/* XXX implement this or share evergreen_dma_blit with r600g */
-	return FALSE;
-}
-
 static void si_set_occlusion_query_state(struct pipe_context *ctx, bool enable)
 {
 	/* XXX Turn this into a proper state. Right now the queries are
@@ -3177,7 +3338,6 @@ void si_init_state_functions(struct si_context *sctx)
 	sctx->b.b.delete_sampler_state = si_delete_sampler_state;
 
 	sctx->b.b.create_sampler_view = si_create_sampler_view;
-	sctx->b.b.set_sampler_views = si_set_sampler_views;
 	sctx->b.b.sampler_view_destroy = si_sampler_view_destroy;
 
 	sctx->b.b.set_sample_mask = si_set_sample_mask;
@@ -124,7 +124,8 @@ union si_state {
  * image resources, and sampler states.
  */
 struct si_descriptors {
-	struct r600_atom atom;
+	/* The CPU copy of the resource descriptors, one pointer per element. */
+	uint32_t **data;
 
 	/* The size of one resource descriptor. */
 	unsigned element_dw_size;
@@ -138,6 +139,11 @@ struct si_descriptors {
 	unsigned dirty_mask;
 	/* The i-th bit is set if that element is enabled (non-NULL resource). */
 	unsigned enabled_mask;
+	/* The i-th bit is set if that element has ever been written.
+	 * The other elements are zero in every context. */
+	unsigned used_mask;
+	/* The CS space the pending update needs, 0 if it's not dirty. */
+	unsigned num_dw;
 
 	/* We can't update descriptors directly because the GPU might be
 	 * reading them at the same time, so we have to update them
@@ -217,6 +223,7 @@ void si_upload_const_buffer(struct si_context *sctx, struct r600_resource **rbuf
 
 /* si_state.c */
 struct si_pipe_shader_selector;
+struct si_screen;
 struct si_surface;
 
 boolean si_is_format_supported(struct pipe_screen *screen,
@@ -226,6 +233,9 @@ boolean si_is_format_supported(struct pipe_screen *screen,
                                unsigned usage);
 int si_shader_select(struct pipe_context *ctx,
 		     struct si_pipe_shader_selector *sel);
+void si_init_compiler_threads(struct si_screen *sscreen);
+void si_destroy_compiler_threads(struct si_screen *sscreen);
+void si_wait_compile_jobs(struct si_context *sctx);
 void si_init_state_functions(struct si_context *sctx);
 void si_init_config(struct si_context *sctx);
 
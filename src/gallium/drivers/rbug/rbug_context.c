@@ -116,9 +116,16 @@ rbug_draw_vbo(struct pipe_context *_pipe, const struct pipe_draw_info *info)
 {
    struct rbug_context *rb_pipe = rbug_context(_pipe);
    struct pipe_context *pipe = rb_pipe->pipe;
-
-   pipe_mutex_lock(rb_pipe->draw_mutex);
-   rbug_draw_block_locked(rb_pipe, RBUG_BLOCK_BEFORE);
+   /* Only take the draw lock when the debugger asked for draws to be
+    * blocked.  The flags are checked without the lock, so a new block
+    * request takes effect at the latest on the next draw.
+    */
+   boolean blocking = rb_pipe->draw_blocker || rb_pipe->draw_blocked;
+
+   if (blocking) {
+      pipe_mutex_lock(rb_pipe->draw_mutex);
+      rbug_draw_block_locked(rb_pipe, RBUG_BLOCK_BEFORE);
+   }
 
    pipe_mutex_lock(rb_pipe->call_mutex);
    /* XXX loop over PIPE_SHADER_x here */
@@ -128,8 +135,10 @@ rbug_draw_vbo(struct pipe_context *_pipe, const struct pipe_draw_info *info)
       pipe->draw_vbo(pipe, info);
    pipe_mutex_unlock(rb_pipe->call_mutex);
 
-   rbug_draw_block_locked(rb_pipe, RBUG_BLOCK_AFTER);
-   pipe_mutex_unlock(rb_pipe->draw_mutex);
+   if (blocking) {
+      rbug_draw_block_locked(rb_pipe, RBUG_BLOCK_AFTER);
+      pipe_mutex_unlock(rb_pipe->draw_mutex);
+   }
 }
 
 static struct pipe_query *
@@ -54,7 +54,7 @@ softpipe_clear(struct pipe_context *pipe, unsigned buffers,
    struct pipe_surface *zsbuf = softpipe->framebuffer.zsbuf;
    unsigned zs_buffers = buffers & PIPE_CLEAR_DEPTHSTENCIL;
    uint64_t cv;
-   uint i;
+   uint i, t;
 
    if (softpipe->no_rast)
       return;
@@ -67,8 +67,10 @@ softpipe_clear(struct pipe_context *pipe, unsigned buffers,
 #endif
 
    if (buffers & PIPE_CLEAR_COLOR) {
-      for (i = 0; i < softpipe->framebuffer.nr_cbufs; i++) {
-         sp_tile_cache_clear(softpipe->cbuf_cache[i], color, 0);
+      for (t = 0; t < softpipe->num_threads; t++) {
+         for (i = 0; i < softpipe->framebuffer.nr_cbufs; i++) {
+            sp_tile_cache_clear(softpipe->rast[t]->cbuf_cache[i], color, 0);
+         }
       }
    }
 
@@ -83,7 +85,9 @@ softpipe_clear(struct pipe_context *pipe, unsigned buffers,
       static const union pipe_color_union zero;
 
       cv = util_pack64_z_stencil(zsbuf->format, depth, stencil);
-      sp_tile_cache_clear(softpipe->zsbuf_cache, &zero, cv);
+      for (t = 0; t < softpipe->num_threads; t++) {
+         sp_tile_cache_clear(softpipe->rast[t]->zsbuf_cache, &zero, cv);
+      }
    }
 
    softpipe->dirty_render_cache = TRUE;
@@ -37,6 +37,7 @@
 #include "draw/draw_vertex.h"
 
 #include "sp_quad_pipe.h"
+#include "sp_rast.h"
 
 
 /** Do polygon stipple in the draw module? */
@@ -151,22 +152,18 @@ struct softpipe_context {
       struct pipe_sampler_view *sampler_view;
    } pstipple;
 
-   /** Software quad rendering pipeline */
-   struct {
-      struct quad_stage *shade;
-      struct quad_stage *depth_test;
-      struct quad_stage *blend;
-      struct quad_stage *pstipple;
-      struct quad_stage *first; /**< points to one of the above stages */
-   } quad;
+   /**
+    * Rasterization threads, each with its own quad pipeline and caches.
+    * rast[0] runs on the application thread.
+    */
+   struct sp_rast_thread *rast[SP_MAX_THREADS];
+   unsigned num_threads;
 
    /** TGSI exec things */
    struct {
       struct sp_tgsi_sampler *sampler[PIPE_SHADER_TYPES];
    } tgsi;
 
-   struct tgsi_exec_machine *fs_machine;
-
    /** The primitive drawing context */
    struct draw_context *draw;
 
@@ -178,9 +175,6 @@ struct softpipe_context {
 
    boolean dirty_render_cache;
 
-   struct softpipe_tile_cache *cbuf_cache[PIPE_MAX_COLOR_BUFS];
-   struct softpipe_tile_cache *zsbuf_cache;
-
    unsigned tex_timestamp;
 
    /*
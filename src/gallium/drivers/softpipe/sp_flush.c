@@ -48,7 +48,7 @@ softpipe_flush( struct pipe_context *pipe,
                 struct pipe_fence_handle **fence )
 {
    struct softpipe_context *softpipe = softpipe_context(pipe);
-   uint i;
+   uint i, t;
 
    draw_flush(softpipe->draw);
 
@@ -60,6 +60,13 @@ softpipe_flush( struct pipe_context *pipe,
             sp_flush_tex_tile_cache(softpipe->tex_cache[sh][i]);
          }
       }
+
+      /* the other threads' copies of the fragment texture caches */
+      for (t = 1; t < softpipe->num_threads; t++) {
+         for (i = 0; i < softpipe->num_sampler_views[PIPE_SHADER_FRAGMENT]; i++) {
+            sp_flush_tex_tile_cache(softpipe->rast[t]->tex_cache[i]);
+         }
+      }
    }
 
    /* If this is a swapbuffers, just flush color buffers.
@@ -67,12 +74,16 @@ softpipe_flush( struct pipe_context *pipe,
     * The zbuffer changes are not discarded, but held in the cache
     * in the hope that a later clear will wipe them out.
     */
-   for (i = 0; i < softpipe->framebuffer.nr_cbufs; i++)
-      if (softpipe->cbuf_cache[i])
-         sp_flush_tile_cache(softpipe->cbuf_cache[i]);
+   for (t = 0; t < softpipe->num_threads; t++) {
+      struct sp_rast_thread *rast = softpipe->rast[t];
 
-   if (softpipe->zsbuf_cache)
-      sp_flush_tile_cache(softpipe->zsbuf_cache);
+      for (i = 0; i < softpipe->framebuffer.nr_cbufs; i++)
+         if (rast->cbuf_cache[i])
+            sp_flush_tile_cache(rast->cbuf_cache[i]);
+
+      if (rast->zsbuf_cache)
+         sp_flush_tile_cache(rast->zsbuf_cache);
+   }
 
    softpipe->dirty_render_cache = FALSE;
 
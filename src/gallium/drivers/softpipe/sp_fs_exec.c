@@ -67,9 +67,14 @@ exec_prepare( const struct sp_fragment_shader_variant *var,
    /*
     * Bind tokens/shader to the interpreter's machine state.
     */
-   tgsi_exec_machine_bind_shader(machine,
-                                 var->tokens,
-                                 sampler);
+   if (var->decoded)
+      tgsi_exec_machine_bind_decoded_shader(machine,
+                                            var->decoded,
+                                            sampler);
+   else
+      tgsi_exec_machine_bind_shader(machine,
+                                    var->tokens,
+                                    sampler);
 }
 
 
@@ -183,6 +188,7 @@ exec_delete(struct sp_fragment_shader_variant *var,
       tgsi_exec_machine_bind_shader(machine, NULL, NULL);
    }
 
+   tgsi_free_decoded_shader(var->decoded);
    FREE( (void *) var->tokens );
    FREE(var);
 }
@@ -51,6 +51,17 @@
 
 typedef const float (*cptrf4)[4];
 
+/**
+ * Arguments of draw_elements/draw_arrays, for the rasterization threads.
+ */
+struct sp_vbuf_draw
+{
+   struct softpipe_vbuf_render *cvbr;
+   const ushort *indices;
+   uint start;
+   uint nr;
+};
+
 /**
  * Subclass of vbuf_render.
  */
@@ -58,7 +69,6 @@ struct softpipe_vbuf_render
 {
    struct vbuf_render base;
    struct softpipe_context *softpipe;
-   struct setup_context *setup;
 
    uint prim;
    uint vertex_size;
@@ -136,9 +146,11 @@ static void
 sp_vbuf_set_primitive(struct vbuf_render *vbr, unsigned prim)
 {
    struct softpipe_vbuf_render *cvbr = softpipe_vbuf_render(vbr);
-   struct setup_context *setup_ctx = cvbr->setup;
-   
-   sp_setup_prepare( setup_ctx );
+   struct softpipe_context *softpipe = cvbr->softpipe;
+   unsigned i;
+
+   for (i = 0; i < softpipe->num_threads; i++)
+      sp_setup_prepare( softpipe->rast[i]->setup );
 
    cvbr->softpipe->reduced_prim = u_reduced_prim(prim);
    cvbr->prim = prim;
@@ -154,16 +166,19 @@ static INLINE cptrf4 get_vert( const void *vertex_buffer,
 
 
 /**
- * draw elements / indexed primitives
+ * draw elements / indexed primitives, on one thread
  */
 static void
-sp_vbuf_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
+sp_vbuf_rast_elements(struct sp_rast_thread *rast, void *data)
 {
-   struct softpipe_vbuf_render *cvbr = softpipe_vbuf_render(vbr);
+   const struct sp_vbuf_draw *draw = (const struct sp_vbuf_draw *) data;
+   struct softpipe_vbuf_render *cvbr = draw->cvbr;
    struct softpipe_context *softpipe = cvbr->softpipe;
    const unsigned stride = softpipe->vertex_info_vbuf.size * sizeof(float);
    const void *vertex_buffer = cvbr->vertex_buffer;
-   struct setup_context *setup = cvbr->setup;
+   const ushort *indices = draw->indices;
+   const uint nr = draw->nr;
+   struct setup_context *setup = rast->setup;
    const boolean flatshade_first = softpipe->rasterizer->flatshade_first;
    unsigned i;
 
@@ -348,19 +363,35 @@ sp_vbuf_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
 }
 
 
+static void
+sp_vbuf_draw_elements(struct vbuf_render *vbr, const ushort *indices, uint nr)
+{
+   struct softpipe_vbuf_render *cvbr = softpipe_vbuf_render(vbr);
+   struct sp_vbuf_draw draw;
+
+   draw.cvbr = cvbr;
+   draw.indices = indices;
+   draw.start = 0;
+   draw.nr = nr;
+
+   sp_rast_run(cvbr->softpipe, sp_vbuf_rast_elements, &draw);
+}
+
+
 /**
- * This function is hit when the draw module is working in pass-through mode.
- * It's up to us to convert the vertex array into point/line/tri prims.
+ * Non-indexed primitives, on one thread
  */
 static void
-sp_vbuf_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
+sp_vbuf_rast_arrays(struct sp_rast_thread *rast, void *data)
 {
-   struct softpipe_vbuf_render *cvbr = softpipe_vbuf_render(vbr);
+   const struct sp_vbuf_draw *draw = (const struct sp_vbuf_draw *) data;
+   struct softpipe_vbuf_render *cvbr = draw->cvbr;
    struct softpipe_context *softpipe = cvbr->softpipe;
-   struct setup_context *setup = cvbr->setup;
+   struct setup_context *setup = rast->setup;
    const unsigned stride = softpipe->vertex_info_vbuf.size * sizeof(float);
    const void *vertex_buffer =
-      (void *) get_vert(cvbr->vertex_buffer, start, stride);
+      (void *) get_vert(cvbr->vertex_buffer, draw->start, stride);
+   const uint nr = draw->nr;
    const boolean flatshade_first = softpipe->rasterizer->flatshade_first;
    unsigned i;
 
@@ -587,6 +618,25 @@ sp_vbuf_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
    }
 }
 
+/**
+ * This function is hit when the draw module is working in pass-through mode.
+ * It's up to us to convert the vertex array into point/line/tri prims.
+ */
+static void
+sp_vbuf_draw_arrays(struct vbuf_render *vbr, uint start, uint nr)
+{
+   struct softpipe_vbuf_render *cvbr = softpipe_vbuf_render(vbr);
+   struct sp_vbuf_draw draw;
+
+   draw.cvbr = cvbr;
+   draw.indices = NULL;
+   draw.start = start;
+   draw.nr = nr;
+
+   sp_rast_run(cvbr->softpipe, sp_vbuf_rast_arrays, &draw);
+}
+
+
 /*
  * FIXME: it is unclear if primitives_storage_needed (which is generally
  * the same as pipe query num_primitives_generated) should increase
@@ -635,7 +685,6 @@ sp_vbuf_destroy(struct vbuf_render *vbr)
    struct softpipe_vbuf_render *cvbr = softpipe_vbuf_render(vbr);
    if (cvbr->vertex_buffer)
       align_free(cvbr->vertex_buffer);
-   sp_setup_destroy_context(cvbr->setup);
    FREE(cvbr);
 }
 
@@ -651,7 +700,8 @@ sp_create_vbuf_backend(struct softpipe_context *sp)
    assert(sp->draw);
 
    cvbr->base.max_indices = SP_MAX_VBUF_INDEXES;
-   cvbr->base.max_vertex_buffer_bytes = SP_MAX_VBUF_SIZE;
+   /* bigger batches make up for waking the rasterization threads */
+   cvbr->base.max_vertex_buffer_bytes = SP_MAX_VBUF_SIZE * sp->num_threads;
 
    cvbr->base.get_vertex_info = sp_vbuf_get_vertex_info;
    cvbr->base.allocate_vertices = sp_vbuf_allocate_vertices;
@@ -667,7 +717,5 @@ sp_create_vbuf_backend(struct softpipe_context *sp)
 
    cvbr->softpipe = sp;
 
-   cvbr->setup = sp_setup_create_context(cvbr->softpipe);
-
    return &cvbr->base;
 }
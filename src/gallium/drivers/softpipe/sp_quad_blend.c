@@ -933,7 +933,7 @@ blend_fallback(struct quad_stage *qs,
          const uint blend_buf = blend->independent_blend_enable ? cbuf : 0;
          float dest[4][TGSI_QUAD_SIZE];
          struct softpipe_cached_tile *tile
-            = sp_get_cached_tile(softpipe->cbuf_cache[cbuf],
+            = sp_get_cached_tile(qs->rast->cbuf_cache[cbuf],
                                  quads[0]->input.x0, 
                                  quads[0]->input.y0);
          const boolean clamp = bqs->clamp[cbuf];
@@ -1036,7 +1036,7 @@ blend_single_add_src_alpha_inv_src_alpha(struct quad_stage *qs,
    uint i, j, q;
 
    struct softpipe_cached_tile *tile
-      = sp_get_cached_tile(qs->softpipe->cbuf_cache[0],
+      = sp_get_cached_tile(qs->rast->cbuf_cache[0],
                            quads[0]->input.x0, 
                            quads[0]->input.y0);
 
@@ -1110,7 +1110,7 @@ blend_single_add_one_one(struct quad_stage *qs,
    uint i, j, q;
 
    struct softpipe_cached_tile *tile
-      = sp_get_cached_tile(qs->softpipe->cbuf_cache[0],
+      = sp_get_cached_tile(qs->rast->cbuf_cache[0],
                            quads[0]->input.x0, 
                            quads[0]->input.y0);
 
@@ -1178,7 +1178,7 @@ single_output_color(struct quad_stage *qs,
    uint i, j, q;
 
    struct softpipe_cached_tile *tile
-      = sp_get_cached_tile(qs->softpipe->cbuf_cache[0],
+      = sp_get_cached_tile(qs->rast->cbuf_cache[0],
                            quads[0]->input.x0, 
                            quads[0]->input.y0);
 
@@ -1296,14 +1296,15 @@ static void blend_destroy(struct quad_stage *qs)
 }
 
 
-struct quad_stage *sp_quad_blend_stage( struct softpipe_context *softpipe )
+struct quad_stage *sp_quad_blend_stage( struct sp_rast_thread *rast )
 {
    struct blend_quad_stage *stage = CALLOC_STRUCT(blend_quad_stage);
 
    if (!stage)
       return NULL;
 
-   stage->base.softpipe = softpipe;
+   stage->base.softpipe = rast->softpipe;
+   stage->base.rast = rast;
    stage->base.begin = blend_begin;
    stage->base.run = choose_blend_quad;
    stage->base.destroy = blend_destroy;
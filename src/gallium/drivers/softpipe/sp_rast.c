@@ -0,0 +1,306 @@
+/**************************************************************************
+ *
+ * Copyright 2014 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+#include "util/u_memory.h"
+#include "tgsi/tgsi_exec.h"
+#include "sp_context.h"
+#include "sp_quad_pipe.h"
+#include "sp_rast.h"
+#include "sp_setup.h"
+#include "sp_tex_sample.h"
+#include "sp_tex_tile_cache.h"
+#include "sp_texture.h"
+#include "sp_tile_cache.h"
+
+
+/**
+ * Main loop of the threads other than thread 0: wait for a job, run it,
+ * tell the application thread we're done.
+ */
+static PIPE_THREAD_ROUTINE( sp_rast_thread_proc, init_data )
+{
+   struct sp_rast_thread *rast = (struct sp_rast_thread *) init_data;
+
+   while (1) {
+      pipe_semaphore_wait(&rast->work_ready);
+
+      if (rast->exit)
+         break;
+
+      rast->func(rast, rast->data);
+
+      pipe_semaphore_signal(&rast->work_done);
+   }
+
+   return 0;
+}
+
+
+static void
+sp_rast_destroy_thread(struct sp_rast_thread *rast)
+{
+   uint i;
+
+   if (rast->quad.shade)
+      rast->quad.shade->destroy( rast->quad.shade );
+
+   if (rast->quad.depth_test)
+      rast->quad.depth_test->destroy( rast->quad.depth_test );
+
+   if (rast->quad.blend)
+      rast->quad.blend->destroy( rast->quad.blend );
+
+   if (rast->quad.pstipple)
+      rast->quad.pstipple->destroy( rast->quad.pstipple );
+
+   for (i = 0; i < PIPE_MAX_COLOR_BUFS; i++)
+      sp_destroy_tile_cache(rast->cbuf_cache[i]);
+
+   sp_destroy_tile_cache(rast->zsbuf_cache);
+
+   /* thread 0 borrows the sampler and texture caches of the context */
+   if (rast->index) {
+      for (i = 0; i < Elements(rast->tex_cache); i++)
+         sp_destroy_tex_tile_cache(rast->tex_cache[i]);
+
+      FREE(rast->fs_sampler);
+   }
+
+   if (rast->fs_machine)
+      tgsi_exec_machine_destroy(rast->fs_machine);
+
+   if (rast->setup)
+      sp_setup_destroy_context(rast->setup);
+
+   FREE(rast);
+}
+
+
+static struct sp_rast_thread *
+sp_rast_create_thread(struct softpipe_context *sp,
+                      unsigned index, unsigned num_threads)
+{
+   struct sp_rast_thread *rast = CALLOC_STRUCT(sp_rast_thread);
+   uint i;
+
+   if (!rast)
+      return NULL;
+
+   rast->softpipe = sp;
+   rast->index = index;
+   rast->num_threads = num_threads;
+
+   /*
+    * Alloc caches for accessing drawing surfaces and textures.
+    * Must be before quad stage setup!
+    */
+   for (i = 0; i < PIPE_MAX_COLOR_BUFS; i++) {
+      rast->cbuf_cache[i] = sp_create_tile_cache( &sp->pipe );
+      if (!rast->cbuf_cache[i])
+         goto fail;
+      sp_tile_cache_set_rows(rast->cbuf_cache[i], index, num_threads);
+   }
+
+   rast->zsbuf_cache = sp_create_tile_cache( &sp->pipe );
+   if (!rast->zsbuf_cache)
+      goto fail;
+   sp_tile_cache_set_rows(rast->zsbuf_cache, index, num_threads);
+
+   if (index == 0) {
+      rast->fs_sampler = sp->tgsi.sampler[PIPE_SHADER_FRAGMENT];
+      for (i = 0; i < Elements(rast->tex_cache); i++)
+         rast->tex_cache[i] = sp->tex_cache[PIPE_SHADER_FRAGMENT][i];
+   }
+   else {
+      rast->fs_sampler = sp_create_tgsi_sampler();
+      if (!rast->fs_sampler)
+         goto fail;
+
+      for (i = 0; i < Elements(rast->tex_cache); i++) {
+         rast->tex_cache[i] = sp_create_tex_tile_cache(&sp->pipe);
+         if (!rast->tex_cache[i])
+            goto fail;
+      }
+   }
+
+   rast->fs_machine = tgsi_exec_machine_create();
+   if (!rast->fs_machine)
+      goto fail;
+
+   /* setup quad rendering stages */
+   rast->quad.shade = sp_quad_shade_stage(rast);
+   rast->quad.depth_test = sp_quad_depth_test_stage(rast);
+   rast->quad.blend = sp_quad_blend_stage(rast);
+   rast->quad.pstipple = sp_quad_polygon_stipple_stage(rast);
+   if (!rast->quad.shade || !rast->quad.depth_test ||
+       !rast->quad.blend || !rast->quad.pstipple)
+      goto fail;
+
+   rast->setup = sp_setup_create_context(rast);
+   if (!rast->setup)
+      goto fail;
+
+   return rast;
+
+fail:
+   sp_rast_destroy_thread(rast);
+   return NULL;
+}
+
+
+/**
+ * Create the rasterization threads.  Thread 0 is the application thread,
+ * the others are started here.
+ */
+boolean
+sp_rast_create_threads(struct softpipe_context *sp, unsigned num_threads)
+{
+   unsigned i;
+
+   num_threads = CLAMP(num_threads, 1, SP_MAX_THREADS);
+
+   for (i = 0; i < num_threads; i++) {
+      sp->rast[i] = sp_rast_create_thread(sp, i, num_threads);
+      if (!sp->rast[i]) {
+         sp_rast_destroy_threads(sp);
+         return FALSE;
+      }
+      sp->num_threads = i + 1;
+
+      if (i) {
+         struct sp_rast_thread *rast = sp->rast[i];
+
+         pipe_semaphore_init(&rast->work_ready, 0);
+         pipe_semaphore_init(&rast->work_done, 0);
+         rast->thread = pipe_thread_create(sp_rast_thread_proc, rast);
+      }
+   }
+
+   return TRUE;
+}
+
+
+void
+sp_rast_destroy_threads(struct softpipe_context *sp)
+{
+   unsigned i;
+
+   /* Set the exit flag and wake up each thread so that it leaves its
+    * main loop.
+    */
+   for (i = 1; i < sp->num_threads; i++) {
+      sp->rast[i]->exit = TRUE;
+      pipe_semaphore_signal(&sp->rast[i]->work_ready);
+   }
+
+   for (i = 1; i < sp->num_threads; i++) {
+      pipe_thread_wait(sp->rast[i]->thread);
+      pipe_semaphore_destroy(&sp->rast[i]->work_ready);
+      pipe_semaphore_destroy(&sp->rast[i]->work_done);
+   }
+
+   for (i = 0; i < SP_MAX_THREADS; i++) {
+      if (sp->rast[i]) {
+         sp_rast_destroy_thread(sp->rast[i]);
+         sp->rast[i] = NULL;
+      }
+   }
+
+   sp->num_threads = 0;
+}
+
+
+/**
+ * Run func on all threads and wait for them to finish.  Thread 0 runs on
+ * the calling thread.
+ */
+void
+sp_rast_run(struct softpipe_context *sp, sp_rast_func func, void *data)
+{
+   unsigned i;
+
+   for (i = 1; i < sp->num_threads; i++) {
+      struct sp_rast_thread *rast = sp->rast[i];
+
+      rast->func = func;
+      rast->data = data;
+      pipe_semaphore_signal(&rast->work_ready);
+   }
+
+   func(sp->rast[0], data);
+
+   for (i = 1; i < sp->num_threads; i++)
+      pipe_semaphore_wait(&sp->rast[i]->work_done);
+
+   for (i = 0; i < sp->num_threads; i++) {
+      struct sp_rast_thread *rast = sp->rast[i];
+
+      sp->occlusion_count += rast->occlusion_count;
+      sp->pipeline_statistics.ps_invocations += rast->ps_invocations;
+      rast->occlusion_count = 0;
+      rast->ps_invocations = 0;
+   }
+}
+
+
+/**
+ * Copy the fragment sampler state of the context to the other threads,
+ * pointing the views at their own texture caches.
+ */
+void
+sp_rast_update_samplers(struct softpipe_context *sp)
+{
+   const struct sp_tgsi_sampler *src = sp->tgsi.sampler[PIPE_SHADER_FRAGMENT];
+   unsigned i, j;
+
+   for (i = 1; i < sp->num_threads; i++) {
+      struct sp_rast_thread *rast = sp->rast[i];
+
+      memcpy(rast->fs_sampler->sp_sampler, src->sp_sampler,
+             sizeof(src->sp_sampler));
+
+      for (j = 0; j < Elements(rast->tex_cache); j++) {
+         struct pipe_sampler_view *view =
+            sp->sampler_views[PIPE_SHADER_FRAGMENT][j];
+         struct softpipe_tex_tile_cache *tc = rast->tex_cache[j];
+
+         sp_tex_tile_cache_set_sampler_view(tc, view);
+         if (tc->texture) {
+            struct softpipe_resource *spt = softpipe_resource(tc->texture);
+            if (spt->timestamp != tc->timestamp) {
+               sp_tex_tile_cache_validate_texture( tc );
+               tc->timestamp = spt->timestamp;
+            }
+         }
+
+         rast->fs_sampler->sp_sview[j] = src->sp_sview[j];
+         if (view)
+            rast->fs_sampler->sp_sview[j].cache = tc;
+      }
+   }
+}
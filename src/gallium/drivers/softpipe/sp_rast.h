@@ -0,0 +1,131 @@
+/**************************************************************************
+ *
+ * Copyright 2014 VMware, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * Rasterization threads.
+ *
+ * The framebuffer is split into rows of tiles (TILE_SIZE pixels high)
+ * which are dealt out to the threads round-robin.  Every thread sets up
+ * all the primitives of a vbuf batch but only emits the quads which fall
+ * into its own tile rows, through its own quad pipeline, shader machine,
+ * texture caches and framebuffer tile caches.  Since no tile is ever
+ * touched by two threads, rendering needs no locking at all.
+ */
+
+#ifndef SP_RAST_H
+#define SP_RAST_H
+
+
+#include "os/os_thread.h"
+#include "pipe/p_state.h"
+#include "sp_tile_cache.h"
+
+
+/** Max number of rasterization threads, including the application thread */
+#define SP_MAX_THREADS 8
+
+
+struct softpipe_context;
+struct setup_context;
+struct quad_stage;
+struct tgsi_exec_machine;
+struct sp_tgsi_sampler;
+struct softpipe_tex_tile_cache;
+struct sp_rast_thread;
+
+
+typedef void (*sp_rast_func)(struct sp_rast_thread *rast, void *data);
+
+
+struct sp_rast_thread {
+   struct softpipe_context *softpipe;
+   unsigned index;        /**< tile rows index, index + num_threads, ... */
+   unsigned num_threads;
+
+   struct setup_context *setup;
+
+   /** Software quad rendering pipeline */
+   struct {
+      struct quad_stage *shade;
+      struct quad_stage *depth_test;
+      struct quad_stage *blend;
+      struct quad_stage *pstipple;
+      struct quad_stage *first; /**< points to one of the above stages */
+   } quad;
+
+   struct tgsi_exec_machine *fs_machine;
+
+   /**
+    * Fragment shader sampler and texture caches.  Thread 0 uses the ones
+    * of the context, the other threads get copies of the sampler views.
+    */
+   struct sp_tgsi_sampler *fs_sampler;
+   struct softpipe_tex_tile_cache *tex_cache[PIPE_MAX_SHADER_SAMPLER_VIEWS];
+
+   struct softpipe_tile_cache *cbuf_cache[PIPE_MAX_COLOR_BUFS];
+   struct softpipe_tile_cache *zsbuf_cache;
+
+   /** Counters, summed into the context once the job is done */
+   uint64_t occlusion_count;
+   uint64_t ps_invocations;
+
+   /** The job, for threads other than 0 */
+   sp_rast_func func;
+   void *data;
+
+   boolean exit;
+   pipe_thread thread;
+   pipe_semaphore work_ready;
+   pipe_semaphore work_done;
+};
+
+
+boolean
+sp_rast_create_threads(struct softpipe_context *sp, unsigned num_threads);
+
+void
+sp_rast_destroy_threads(struct softpipe_context *sp);
+
+void
+sp_rast_run(struct softpipe_context *sp, sp_rast_func func, void *data);
+
+void
+sp_rast_update_samplers(struct softpipe_context *sp);
+
+
+/**
+ * Is window row y rendered by this thread?
+ */
+static INLINE boolean
+sp_rast_owns_row(const struct sp_rast_thread *rast, int y)
+{
+   return rast->num_threads == 1 ||
+          ((unsigned) y >> TILE_SIZE_LOG2) % rast->num_threads == rast->index;
+}
+
+
+#endif /* SP_RAST_H */
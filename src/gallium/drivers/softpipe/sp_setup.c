@@ -74,6 +74,7 @@ struct edge {
  */
 struct setup_context {
    struct softpipe_context *softpipe;
+   struct sp_rast_thread *rast;
 
    /* Vertices are just an array of floats making up each attribute in
     * turn.  Currently fixed at 4 floats, but should change in time.
@@ -136,8 +137,9 @@ quad_clip(struct setup_context *setup, struct quad_header *quad)
    if (quad->input.x0 >= maxx ||
        quad->input.y0 >= maxy ||
        quad->input.x0 + 1 < minx ||
-       quad->input.y0 + 1 < miny) {
-      /* totally clipped */
+       quad->input.y0 + 1 < miny ||
+       !sp_rast_owns_row(setup->rast, quad->input.y0)) {
+      /* totally clipped, or rendered by another thread */
       quad->inout.mask = 0x0;
       return;
    }
@@ -161,13 +163,13 @@ clip_emit_quad(struct setup_context *setup, struct quad_header *quad)
    quad_clip( setup, quad );
 
    if (quad->inout.mask) {
-      struct softpipe_context *sp = setup->softpipe;
+      struct sp_rast_thread *rast = setup->rast;
 
 #if DEBUG_FRAGS
       setup->numFragsEmitted += util_bitcount(quad->inout.mask);
 #endif
 
-      sp->quad.first->run( sp->quad.first, &quad, 1 );
+      rast->quad.first->run( rast->quad.first, &quad, 1 );
    }
 }
 
@@ -202,7 +204,7 @@ flush_spans(struct setup_context *setup)
    const int xleft1 = setup->span.left[1];
    const int xright0 = setup->span.right[0];
    const int xright1 = setup->span.right[1];
-   struct quad_stage *pipe = setup->softpipe->quad.first;
+   struct quad_stage *pipe = setup->rast->quad.first;
 
    const int minleft = block_x(MIN2(xleft0, xleft1));
    const int maxright = MAX2(xright0, xright1);
@@ -732,6 +734,10 @@ subtriangle(struct setup_context *setup,
    */
 
    for (y = start_y; y < finish_y; y++) {
+      int left, right;
+
+      if (!sp_rast_owns_row(setup->rast, sy + y))
+         continue;
 
       /* avoid accumulating adds as floats don't have the precision to
        * accurately iterate large triangle edges that way.  luckily we
@@ -739,8 +745,8 @@ subtriangle(struct setup_context *setup,
        *
        * this is all drowned out by the attribute interpolation anyway.
        */
-      int left = (int)(eleft->sx + y * eleft->dxdy);
-      int right = (int)(eright->sx + y * eright->dxdy);
+      left = (int)(eleft->sx + y * eleft->dxdy);
+      right = (int)(eright->sx + y * eright->dxdy);
 
       /* clip left/right */
       if (left < minx)
@@ -852,7 +858,8 @@ sp_setup_tri(struct setup_context *setup,
 
    flush_spans( setup );
 
-   if (setup->softpipe->active_statistics_queries) {
+   /* every thread sets up every triangle, count them once */
+   if (setup->softpipe->active_statistics_queries && setup->rast->index == 0) {
       setup->softpipe->pipeline_statistics.c_primitives++;
    }
 
@@ -1409,7 +1416,7 @@ sp_setup_prepare(struct setup_context *setup)
    /* Note: nr_attrs is only used for debugging (vertex printing) */
    setup->nr_vertex_attrs = draw_num_shader_outputs(sp->draw);
 
-   sp->quad.first->begin( sp->quad.first );
+   setup->rast->quad.first->begin( setup->rast->quad.first );
 
    if (sp->reduced_api_prim == PIPE_PRIM_TRIANGLES &&
        sp->rasterizer->fill_front == PIPE_POLYGON_MODE_FILL &&
@@ -1435,12 +1442,16 @@ sp_setup_destroy_context(struct setup_context *setup)
  * Create a new primitive setup/render stage.
  */
 struct setup_context *
-sp_setup_create_context(struct softpipe_context *softpipe)
+sp_setup_create_context(struct sp_rast_thread *rast)
 {
    struct setup_context *setup = CALLOC_STRUCT(setup_context);
    unsigned i;
 
-   setup->softpipe = softpipe;
+   if (!setup)
+      return NULL;
+
+   setup->softpipe = rast->softpipe;
+   setup->rast = rast;
 
    for (i = 0; i < MAX_QUADS; i++) {
       setup->quad[i].coef = setup->coef;
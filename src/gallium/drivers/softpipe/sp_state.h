@@ -69,6 +69,7 @@ struct sp_fragment_shader_variant_key
 struct sp_fragment_shader_variant
 {
    const struct tgsi_token *tokens;
+   struct tgsi_decoded_shader *decoded;   /**< tokens, decoded once */
    struct sp_fragment_shader_variant_key key;
    struct tgsi_shader_info info;
 
@@ -98,6 +99,7 @@ struct sp_fragment_shader_variant
 /** Subclass of pipe_shader_state */
 struct sp_fragment_shader {
    struct pipe_shader_state shader;
+   struct tgsi_shader_info info;
    struct sp_fragment_shader_variant *variants;
    struct draw_fragment_shader *draw_shader;
 };
@@ -38,6 +38,7 @@
 #include "draw/draw_vs.h"
 #include "draw/draw_gs.h"
 #include "tgsi/tgsi_dump.h"
+#include "tgsi/tgsi_exec.h"
 #include "tgsi/tgsi_scan.h"
 #include "tgsi/tgsi_parse.h"
 
@@ -71,7 +72,13 @@ create_fs_variant(struct softpipe_context *softpipe,
       var->tokens = tgsi_dup_tokens(curfs->tokens);
       var->stipple_sampler_unit = unit;
 
-      tgsi_scan_shader(var->tokens, &var->info);
+      var->decoded = tgsi_decode_shader(var->tokens);
+      if (curfs == &fs->shader)
+         var->info = fs->info;   /* same tokens, scanned at create time */
+      else if (var->decoded)
+         tgsi_scan_decoded_shader(var->decoded, &var->info);
+      else
+         tgsi_scan_shader(var->tokens, &var->info);
 
       /* See comments elsewhere about draw fragment shaders */
 #if 0
@@ -131,9 +138,12 @@ softpipe_create_fs_state(struct pipe_context *pipe,
    /* we need to keep a local copy of the tokens */
    state->shader.tokens = tgsi_dup_tokens(templ->tokens);
 
+   tgsi_scan_shader(state->shader.tokens, &state->info);
+
    /* draw's fs state */
-   state->draw_shader = draw_create_fragment_shader(softpipe->draw,
-                                                    &state->shader);
+   state->draw_shader = draw_create_fragment_shader_info(softpipe->draw,
+                                                         &state->shader,
+                                                         &state->info);
    if (!state->draw_shader) {
       FREE((void *) state->shader.tokens);
       FREE(state);
@@ -178,6 +188,7 @@ softpipe_delete_fs_state(struct pipe_context *pipe, void *fs)
    struct softpipe_context *softpipe = softpipe_context(pipe);
    struct sp_fragment_shader *state = fs;
    struct sp_fragment_shader_variant *var, *next_var;
+   unsigned i;
 
    assert(fs != softpipe->fs);
 
@@ -192,7 +203,14 @@ softpipe_delete_fs_state(struct pipe_context *pipe, void *fs)
       draw_delete_fragment_shader(softpipe->draw, var->draw_shader);
 #endif
 
-      var->delete(var, softpipe->fs_machine);
+      /* the variant unbinds itself from the machine it is given */
+      for (i = 1; i < softpipe->num_threads; i++) {
+         struct tgsi_exec_machine *machine = softpipe->rast[i]->fs_machine;
+         if (machine->Tokens == var->tokens)
+            tgsi_exec_machine_bind_shader(machine, NULL, NULL);
+      }
+
+      var->delete(var, softpipe->rast[0]->fs_machine);
    }
 
    draw_delete_fragment_shader(softpipe->draw, state->draw_shader);
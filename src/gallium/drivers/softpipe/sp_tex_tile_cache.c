@@ -32,6 +32,8 @@
  *    Brian Paul
  */
 
+#include <inttypes.h>  /* for PRIu64 macro */
+
 #include "util/u_inlines.h"
 #include "util/u_memory.h"
 #include "util/u_tile.h"
@@ -41,13 +43,58 @@
 #include "sp_texture.h"
 #include "sp_tex_tile_cache.h"
 
-   
+
+DEBUG_GET_ONCE_NUM_OPTION(tex_cache_tiles, "SOFTPIPE_TEX_CACHE_TILES",
+                          DEFAULT_TEX_TILE_ENTRIES)
+DEBUG_GET_ONCE_BOOL_OPTION(tex_cache_keep, "SOFTPIPE_TEX_CACHE_KEEP", FALSE)
+DEBUG_GET_ONCE_BOOL_OPTION(tex_cache_stats, "SOFTPIPE_TEX_CACHE_STATS", FALSE)
+
+
+/**
+ * Mark all the entries as empty.
+ */
+static void
+sp_tex_tile_cache_invalidate(struct softpipe_tex_tile_cache *tc)
+{
+   uint pos;
+
+   if (tc->entries) {
+      for (pos = 0; pos < tc->num_sets * NUM_TEX_TILE_WAYS; pos++) {
+         tc->entries[pos].addr.bits.invalid = 1;
+      }
+   }
+   tc->last_tile_addr.bits.invalid = 1;
+}
+
+
+/**
+ * Allocate the entries, giving up associativity rather than failing.
+ */
+static void
+sp_tex_tile_cache_alloc_entries(struct softpipe_tex_tile_cache *tc)
+{
+   unsigned num_sets = MAX2(debug_get_option_tex_cache_tiles() /
+                            NUM_TEX_TILE_WAYS, 1);
+
+   num_sets = util_next_power_of_two(num_sets);
+
+   do {
+      tc->entries = MALLOC(num_sets * NUM_TEX_TILE_WAYS *
+                           sizeof(struct softpipe_tex_cached_tile));
+      if (tc->entries)
+         break;
+      num_sets /= 2;
+   } while (num_sets);
+
+   tc->num_sets = num_sets;
+   sp_tex_tile_cache_invalidate(tc);
+}
+
 
 struct softpipe_tex_tile_cache *
 sp_create_tex_tile_cache( struct pipe_context *pipe )
 {
    struct softpipe_tex_tile_cache *tc;
-   uint pos;
 
    /* make sure max texture size works */
    assert((TEX_TILE_SIZE << TEX_ADDR_BITS) >= (1 << (SP_MAX_TEXTURE_2D_LEVELS-1)));
@@ -55,10 +102,8 @@ sp_create_tex_tile_cache( struct pipe_context *pipe )
    tc = CALLOC_STRUCT( softpipe_tex_tile_cache );
    if (tc) {
       tc->pipe = pipe;
-      for (pos = 0; pos < Elements(tc->entries); pos++) {
-         tc->entries[pos].addr.bits.invalid = 1;
-      }
-      tc->last_tile = &tc->entries[0]; /* any tile */
+      tc->keep_tiles = debug_get_option_tex_cache_keep();
+      tc->last_tile_addr.bits.invalid = 1;
    }
    return tc;
 }
@@ -68,11 +113,14 @@ void
 sp_destroy_tex_tile_cache(struct softpipe_tex_tile_cache *tc)
 {
    if (tc) {
-      uint pos;
-
-      for (pos = 0; pos < Elements(tc->entries); pos++) {
-         /*assert(tc->entries[pos].x < 0);*/
+      if (tc->misses && debug_get_option_tex_cache_stats()) {
+         debug_printf("softpipe: tex tile cache %p: %u x %u tiles, "
+                      "%"PRIu64" hits, %"PRIu64" misses\n",
+                      (void *) tc, tc->num_sets, NUM_TEX_TILE_WAYS,
+                      tc->hits, tc->misses);
       }
+
+      FREE( tc->entries );
       if (tc->transfer) {
          tc->pipe->transfer_unmap(tc->pipe, tc->transfer);
       }
@@ -92,14 +140,10 @@ sp_destroy_tex_tile_cache(struct softpipe_tex_tile_cache *tc)
 void
 sp_tex_tile_cache_validate_texture(struct softpipe_tex_tile_cache *tc)
 {
-   unsigned i;
-
    assert(tc);
    assert(tc->texture);
 
-   for (i = 0; i < Elements(tc->entries); i++) {
-      tc->entries[i].addr.bits.invalid = 1;
-   }
+   sp_tex_tile_cache_invalidate(tc);
 }
 
 static boolean
@@ -124,10 +168,12 @@ sp_tex_tile_cache_set_sampler_view(struct softpipe_tex_tile_cache *tc,
                                    struct pipe_sampler_view *view)
 {
    struct pipe_resource *texture = view ? view->texture : NULL;
-   uint i;
 
    assert(!tc->transfer);
 
+   if (view && !tc->entries)
+      sp_tex_tile_cache_alloc_entries(tc);
+
    if (!sp_tex_tile_is_compat_view(tc, view)) {
       pipe_resource_reference(&tc->texture, texture);
 
@@ -147,9 +193,7 @@ sp_tex_tile_cache_set_sampler_view(struct softpipe_tex_tile_cache *tc,
 
       /* mark as entries as invalid/empty */
       /* XXX we should try to avoid this when the teximage hasn't changed */
-      for (i = 0; i < Elements(tc->entries); i++) {
-         tc->entries[i].addr.bits.invalid = 1;
-      }
+      sp_tex_tile_cache_invalidate(tc);
 
       tc->tex_face = -1; /* any invalid value here */
    }
@@ -165,13 +209,16 @@ sp_tex_tile_cache_set_sampler_view(struct softpipe_tex_tile_cache *tc,
 void
 sp_flush_tex_tile_cache(struct softpipe_tex_tile_cache *tc)
 {
-   int pos;
-
    if (tc->texture) {
+      /* Writes to the texture bump its timestamp, so converted tiles of
+       * an unchanged texture can be kept if asked to.
+       */
+      if (tc->keep_tiles &&
+          softpipe_resource(tc->texture)->timestamp == tc->timestamp)
+         return;
+
       /* caching a texture, mark all entries as empty */
-      for (pos = 0; pos < Elements(tc->entries); pos++) {
-         tc->entries[pos].addr.bits.invalid = 1;
-      }
+      sp_tex_tile_cache_invalidate(tc);
       tc->tex_face = -1;
    }
 
@@ -180,21 +227,20 @@ sp_flush_tex_tile_cache(struct softpipe_tex_tile_cache *tc)
 
 /**
  * Given the texture face, level, zslice, x and y values, compute
- * the cache entry position/index where we'd hope to find the
- * cached texture tile.
- * This is basically a direct-map cache.
- * XXX There's probably lots of ways in which we can improve this.
+ * the set of cache entries where we'd hope to find the cached
+ * texture tile.
  */
 static INLINE uint
-tex_cache_pos( union tex_tile_address addr )
+tex_cache_set( const struct softpipe_tex_tile_cache *tc,
+               union tex_tile_address addr )
 {
-   uint entry = (addr.bits.x + 
-                 addr.bits.y * 9 + 
-                 addr.bits.z * 3 + 
-                 addr.bits.face + 
-                 addr.bits.level * 7);
+   uint set = (addr.bits.x +
+               addr.bits.y * 9 +
+               addr.bits.z * 3 +
+               addr.bits.face +
+               addr.bits.level * 7);
 
-   return entry % NUM_TEX_TILE_ENTRIES;
+   return set & (tc->num_sets - 1);
 }
 
 /**
@@ -205,12 +251,33 @@ const struct softpipe_tex_cached_tile *
 sp_find_cached_tile_tex(struct softpipe_tex_tile_cache *tc, 
                         union tex_tile_address addr )
 {
-   struct softpipe_tex_cached_tile *tile;
+   struct softpipe_tex_cached_tile *set, *tile;
    boolean zs = util_format_is_depth_or_stencil(tc->format);
+   uint way;
+
+   assert(tc->entries);
 
-   tile = tc->entries + tex_cache_pos( addr );
+   set = tc->entries + tex_cache_set( tc, addr ) * NUM_TEX_TILE_WAYS;
 
-   if (addr.value != tile->addr.value) {
+   /* look for the tile, and for the least recently used entry */
+   tile = set;
+   for (way = 0; way < NUM_TEX_TILE_WAYS; way++) {
+      if (set[way].addr.value == addr.value) {
+         tile = &set[way];
+         break;
+      }
+      if (set[way].addr.bits.invalid)
+         tile = &set[way];
+      else if (!tile->addr.bits.invalid &&
+               set[way].last_used < tile->last_used)
+         tile = &set[way];
+   }
+
+   if (addr.value == tile->addr.value) {
+      tc->hits++;
+   }
+   else {
+      tc->misses++;
 
       /* cache miss.  Most misses are because we've invalidated the
        * texture cache previously -- most commonly on binding a new
@@ -291,6 +358,9 @@ sp_find_cached_tile_tex(struct softpipe_tex_tile_cache *tc,
       tile->addr = addr;
    }
 
+   tile->last_used = ++tc->use_counter;
+
    tc->last_tile = tile;
+   tc->last_tile_addr = addr;
    return tile;
 }
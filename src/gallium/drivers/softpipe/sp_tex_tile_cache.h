@@ -66,6 +66,7 @@ union tex_tile_address {
 struct softpipe_tex_cached_tile
 {
    union tex_tile_address addr;
+   unsigned last_used;  /**< for LRU replacement within the set */
    union {
       float color[TEX_TILE_SIZE][TEX_TILE_SIZE][4];
       unsigned int colorui[TEX_TILE_SIZE][TEX_TILE_SIZE][4];
@@ -74,12 +75,13 @@ struct softpipe_tex_cached_tile
 };
 
 /*
- * The number of cache entries.
- * Should not be decreased to lower than 16, and even that
- * seems too low to avoid cache thrashing in some cases (because
- * the cache is direct mapped, see tex_cache_pos() function).
+ * The cache is set-associative: a tile may go into any of the
+ * NUM_TEX_TILE_WAYS entries of the set its address maps to (see
+ * tex_cache_set()), replacing the least recently used one.
+ * The total number of entries can be changed with SOFTPIPE_TEX_CACHE_TILES.
  */
-#define NUM_TEX_TILE_ENTRIES 16
+#define NUM_TEX_TILE_WAYS 4
+#define DEFAULT_TEX_TILE_ENTRIES 64
 
 struct softpipe_tex_tile_cache
 {
@@ -90,7 +92,16 @@ struct softpipe_tex_tile_cache
    struct pipe_resource *texture;  /**< if caching a texture */
    unsigned timestamp;
 
-   struct softpipe_tex_cached_tile entries[NUM_TEX_TILE_ENTRIES];
+   /** num_sets * NUM_TEX_TILE_WAYS entries, allocated on first bind */
+   struct softpipe_tex_cached_tile *entries;
+   unsigned num_sets;  /**< power of two */
+   unsigned use_counter;
+
+   /** Keep the tiles across flushes as long as the texture isn't changed */
+   boolean keep_tiles;
+
+   /** Lookups which missed the last tile */
+   uint64_t hits, misses;
 
    struct pipe_transfer *tex_trans;
    void *tex_trans_map;
@@ -102,6 +113,7 @@ struct softpipe_tex_tile_cache
    unsigned swizzle_a;
    enum pipe_format format;
 
+   union tex_tile_address last_tile_addr;
    struct softpipe_tex_cached_tile *last_tile;  /**< most recently retrieved tile */
 };
 
@@ -153,7 +165,7 @@ static INLINE const struct softpipe_tex_cached_tile *
 sp_get_cached_tile_tex(struct softpipe_tex_tile_cache *tc, 
                        union tex_tile_address addr )
 {
-   if (tc->last_tile->addr.value == addr.value)
+   if (tc->last_tile_addr.value == addr.value)
       return tc->last_tile;
 
    return sp_find_cached_tile_tex( tc, addr );
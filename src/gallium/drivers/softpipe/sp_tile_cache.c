@@ -103,6 +103,7 @@ sp_create_tile_cache( struct pipe_context *pipe )
          tc->tile_addrs[pos].bits.invalid = 1;
       }
       tc->last_tile_addr.bits.invalid = 1;
+      tc->row_step = 1;
 
       /* this allocation allows us to guarantee that allocation
        * failures are never fatal later
@@ -188,6 +189,19 @@ sp_tile_cache_set_surface(struct softpipe_tile_cache *tc,
 }
 
 
+/**
+ * Restrict the cache to the tile rows row_start, row_start + row_step, ...
+ * Clears are only ever applied to those rows.
+ */
+void
+sp_tile_cache_set_rows(struct softpipe_tile_cache *tc,
+                       uint row_start, uint row_step)
+{
+   tc->row_start = row_start;
+   tc->row_step = row_step;
+}
+
+
 /**
  * Return the transfer being cached.
  */
@@ -327,7 +341,7 @@ sp_tile_cache_flush_clear(struct softpipe_tile_cache *tc)
    }
 
    /* push the tile to all positions marked as clear */
-   for (y = 0; y < h; y += TILE_SIZE) {
+   for (y = tc->row_start * TILE_SIZE; y < h; y += tc->row_step * TILE_SIZE) {
       for (x = 0; x < w; x += TILE_SIZE) {
          union tile_address addr = tile_address(x, y);
 
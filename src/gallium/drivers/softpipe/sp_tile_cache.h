@@ -94,6 +94,11 @@ struct softpipe_tile_cache
 
    struct softpipe_cached_tile *tile;  /**< scratch tile for clears */
 
+   /** Only every row_step'th tile row, starting at row_start, goes through
+    * this cache.  Used to split the framebuffer among threads.
+    */
+   uint row_start, row_step;
+
    union tile_address last_tile_addr;
    struct softpipe_cached_tile *last_tile;  /**< most recently retrieved tile */
 };
@@ -112,6 +117,10 @@ sp_tile_cache_set_surface(struct softpipe_tile_cache *tc,
 extern struct pipe_surface *
 sp_tile_cache_get_surface(struct softpipe_tile_cache *tc);
 
+extern void
+sp_tile_cache_set_rows(struct softpipe_tile_cache *tc,
+                       uint row_start, uint row_step);
+
 extern void
 sp_flush_tile_cache(struct softpipe_tile_cache *tc);
 
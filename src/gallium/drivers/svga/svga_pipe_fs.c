@@ -61,7 +61,8 @@ svga_create_fs_state(struct pipe_context *pipe,
 
    svga_remap_generics(fs->generic_inputs, fs->generic_remap_table);
 
-   fs->draw_shader = draw_create_fragment_shader(svga->swtnl.draw, templ);
+   fs->draw_shader = draw_create_fragment_shader_info(svga->swtnl.draw, templ,
+                                                      &fs->base.info);
 
    if (SVGA_DEBUG & DEBUG_TGSI || 0) {
       debug_printf("%s id: %u, inputs: %u, outputs: %u\n",
@@ -107,6 +107,30 @@ svga_buffer_transfer_map(struct pipe_context *pipe,
 
             svga_buffer_destroy_hw_storage(ss, sbuf);
          }
+         else if (sbuf->hwbuf && !sbuf->map.count) {
+            struct svga_winsys_screen *sws = ss->sws;
+            void *map;
+
+            /*
+             * A DMA command already flushed to the host may still be
+             * reading the hwbuf, in which case mapping it would wait for
+             * the host.  Since the contents are being discarded anyway,
+             * just start a new hwbuf in that case.
+             */
+
+            map = sws->buffer_map(sws, sbuf->hwbuf,
+                                  PIPE_TRANSFER_WRITE |
+                                  PIPE_TRANSFER_DONTBLOCK);
+            if (map) {
+               sws->buffer_unmap(sws, sbuf->hwbuf);
+            }
+            else {
+               SVGA_DBG(DEBUG_DMA|DEBUG_PERF,
+                        "renaming busy hwbuf of %u bytes\n",
+                        sbuf->b.b.width0);
+               svga_buffer_destroy_hw_storage(ss, sbuf);
+            }
+         }
 
          sbuf->map.num_ranges = 0;
          sbuf->dma.flags.discard = TRUE;
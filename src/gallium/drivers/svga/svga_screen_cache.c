@@ -23,6 +23,7 @@
  *
  **********************************************************/
 
+#include "util/u_debug.h"
 #include "util/u_math.h"
 #include "util/u_memory.h"
 #include "util/u_hash.h"
@@ -145,6 +146,11 @@ svga_screen_cache_lookup(struct svga_screen *svgascreen,
       next = curr->next;
    }
 
+   if (handle)
+      cache->stats.hits++;
+   else
+      cache->stats.misses++;
+
    pipe_mutex_unlock(cache->mutex);
 
    if (SVGA_DEBUG & DEBUG_DMA)
@@ -185,6 +191,8 @@ svga_screen_cache_shrink(struct svga_screen *svgascreen,
          LIST_DEL(&entry->head);
          LIST_ADD(&entry->head, &cache->empty);
 
+         cache->stats.evictions++;
+
          if (cache->total_size <= target_size) {
             /* all done */
             break;
@@ -219,19 +227,20 @@ svga_screen_cache_add(struct svga_screen *svgascreen,
    *p_handle = NULL;
    pipe_mutex_lock(cache->mutex);
    
-   if (surf_size >= SVGA_HOST_SURFACE_CACHE_BYTES) {
+   if (surf_size >= cache->max_size) {
       /* this surface is too large to cache, just free it */
       sws->surface_reference(sws, &handle, NULL);
+      cache->stats.rejected++;
       pipe_mutex_unlock(cache->mutex);
       return;
    }
 
-   if (cache->total_size + surf_size > SVGA_HOST_SURFACE_CACHE_BYTES) {
+   if (cache->total_size + surf_size > cache->max_size) {
       /* Adding this surface would exceed the cache size.
        * Try to discard least recently used entries until we hit the
        * new target cache size.
        */
-      unsigned target_size = SVGA_HOST_SURFACE_CACHE_BYTES - surf_size;
+      unsigned target_size = cache->max_size - surf_size;
 
       svga_screen_cache_shrink(svgascreen, target_size);
 
@@ -240,6 +249,7 @@ svga_screen_cache_add(struct svga_screen *svgascreen,
           * just discard this surface.
           */
          sws->surface_reference(sws, &handle, NULL);
+         cache->stats.rejected++;
          pipe_mutex_unlock(cache->mutex);
          return;
       }
@@ -266,6 +276,8 @@ svga_screen_cache_add(struct svga_screen *svgascreen,
       LIST_DEL(&entry->bucket_head);
 
       LIST_DEL(&entry->head);
+
+      cache->stats.evictions++;
    }
 
    if (entry) {
@@ -342,6 +354,9 @@ svga_screen_cache_cleanup(struct svga_screen *svgascreen)
    struct svga_winsys_screen *sws = svgascreen->sws;
    unsigned i;
 
+   if (SVGA_DEBUG & DEBUG_CACHE)
+      svga_screen_cache_dump(svgascreen);
+
    for (i = 0; i < SVGA_HOST_SURFACE_CACHE_SIZE; ++i) {
       if (cache->entries[i].handle) {
 	 SVGA_DBG(DEBUG_CACHE|DEBUG_DMA,
@@ -370,6 +385,10 @@ svga_screen_cache_init(struct svga_screen *svgascreen)
 
    pipe_mutex_init(cache->mutex);
 
+   cache->max_size = debug_get_num_option("SVGA_SURFACE_CACHE_MB",
+                                          SVGA_HOST_SURFACE_CACHE_MB) *
+                     1024 * 1024;
+
    for (i = 0; i < SVGA_HOST_SURFACE_CACHE_BUCKETS; ++i)
       LIST_INITHEAD(&cache->bucket[i]);
 
@@ -522,5 +541,9 @@ svga_screen_cache_dump(const struct svga_screen *svgascreen)
       }
    }
 
-   debug_printf("%u surfaces, %u bytes\n", count, cache->total_size);
+   debug_printf("%u surfaces, %u bytes (max %u)\n", count, cache->total_size,
+                cache->max_size);
+   debug_printf("%u hits, %u misses, %u evictions, %u rejected\n",
+                cache->stats.hits, cache->stats.misses,
+                cache->stats.evictions, cache->stats.rejected);
 }
@@ -38,9 +38,9 @@
 
 
 /* Guess the storage size of cached surfaces and try and keep it under
- * this amount:
+ * this amount (in MB).  Can be overridden with SVGA_SURFACE_CACHE_MB.
  */ 
-#define SVGA_HOST_SURFACE_CACHE_BYTES (16 * 1024 * 1024)
+#define SVGA_HOST_SURFACE_CACHE_MB 16
 
 /* Maximum number of discrete surfaces in the cache:
  */
@@ -121,6 +121,17 @@ struct svga_host_surface_cache
 
    /** Sum of sizes of all surfaces (in bytes) */
    unsigned total_size;
+
+   /** Upper limit for total_size (in bytes) */
+   unsigned max_size;
+
+   /** Statistics, for svga_screen_cache_dump() */
+   struct {
+      unsigned hits;
+      unsigned misses;
+      unsigned evictions;   /**< unused surfaces freed to make room */
+      unsigned rejected;    /**< surfaces freed instead of being cached */
+   } stats;
 };
 
 
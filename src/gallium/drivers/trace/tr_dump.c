@@ -62,6 +62,10 @@ static FILE *stream = NULL;
 pipe_static_mutex(call_mutex);
 static long unsigned call_no = 0;
 static boolean dumping = FALSE;
+static boolean flush_calls = FALSE;
+
+/** Size of the stdio buffer of the trace stream */
+#define TRACE_BUFFER_SIZE (1 << 20)
 
 
 static INLINE void
@@ -97,23 +101,37 @@ static INLINE void
 trace_dump_escape(const char *str)
 {
    const unsigned char *p = (const unsigned char *)str;
+   const unsigned char *run = p;
    unsigned char c;
-   while((c = *p++) != 0) {
+
+   /* write runs of printable characters in one go */
+   while((c = *p) != 0) {
+      const char *entity;
       if(c == '<')
-         trace_dump_writes("&lt;");
+         entity = "&lt;";
       else if(c == '>')
-         trace_dump_writes("&gt;");
+         entity = "&gt;";
       else if(c == '&')
-         trace_dump_writes("&amp;");
+         entity = "&amp;";
       else if(c == '\'')
-         trace_dump_writes("&apos;");
+         entity = "&apos;";
       else if(c == '\"')
-         trace_dump_writes("&quot;");
-      else if(c >= 0x20 && c <= 0x7e)
-         trace_dump_writef("%c", c);
+         entity = "&quot;";
+      else if(c >= 0x20 && c <= 0x7e) {
+         ++p;
+         continue;
+      }
+      else
+         entity = NULL;
+
+      trace_dump_write((const char *)run, p - run);
+      if (entity)
+         trace_dump_writes(entity);
       else
          trace_dump_writef("&#%u;", c);
+      run = ++p;
    }
+   trace_dump_write((const char *)run, p - run);
 }
 
 
@@ -275,8 +293,18 @@ trace_dump_trace_begin(void)
          stream = fopen(filename, "wt");
          if (!stream)
             return FALSE;
+
+         /* The stream is flushed on every pipe_context::flush and at exit,
+          * use a big buffer in between.
+          */
+         setvbuf(stream, NULL, _IOFBF, TRACE_BUFFER_SIZE);
       }
 
+      /* Write each call out as soon as it's done, so that nothing is lost
+       * if the application crashes, at the cost of a much slower trace.
+       */
+      flush_calls = debug_get_bool_option("GALLIUM_TRACE_FLUSH", FALSE);
+
       trace_dump_writes("<?xml version='1.0' encoding='UTF-8'?>\n");
       trace_dump_writes("<?xml-stylesheet type='text/xsl' href='trace.xsl'?>\n");
       trace_dump_writes("<trace version='0.1'>\n");
@@ -390,7 +418,8 @@ void trace_dump_call_end_locked(void)
    trace_dump_indent(1);
    trace_dump_tag_end("call");
    trace_dump_newline();
-   fflush(stream);
+   if (flush_calls)
+      fflush(stream);
 }
 
 void trace_dump_call_begin(const char *klass, const char *method)
@@ -484,12 +513,16 @@ void trace_dump_bytes(const void *data,
       return;
 
    trace_dump_writes("<bytes>");
-   for(i = 0; i < size; ++i) {
-      uint8_t byte = *p++;
-      char hex[2];
-      hex[0] = hex_table[byte >> 4];
-      hex[1] = hex_table[byte & 0xf];
-      trace_dump_write(hex, 2);
+   while (size) {
+      char hex[1024];
+      size_t n = MIN2(size, sizeof(hex) / 2);
+      for(i = 0; i < n; ++i) {
+         uint8_t byte = *p++;
+         hex[2*i + 0] = hex_table[byte >> 4];
+         hex[2*i + 1] = hex_table[byte & 0xf];
+      }
+      trace_dump_write(hex, 2 * n);
+      size -= n;
    }
    trace_dump_writes("</bytes>");
 }
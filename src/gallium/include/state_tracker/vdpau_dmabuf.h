@@ -0,0 +1,72 @@
+/**************************************************************************
+ *
+ * Copyright 2014 Advanced Micro Devices, Inc.
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE COPYRIGHT HOLDER(S) OR AUTHOR(S) BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+#ifndef _VDPAU_DMABUF_H_
+#define _VDPAU_DMABUF_H_
+
+#include "state_tracker/vdpau_interop.h"
+
+/* driver specific functions for sharing surfaces as DMA-BUF */
+
+#define VDP_FUNC_ID_VIDEO_SURFACE_DMA_BUF (VDP_FUNC_ID_BASE_DRIVER + 2)
+#define VDP_FUNC_ID_OUTPUT_SURFACE_DMA_BUF (VDP_FUNC_ID_BASE_DRIVER + 3)
+
+/* formats of the planes of a video surface, VdpRGBAFormat has none */
+#define VDP_RGBA_FORMAT_R8          (-1)
+#define VDP_RGBA_FORMAT_R8G8        (-2)
+
+typedef enum VdpVideoSurfacePlane
+{
+   VDP_VIDEO_SURFACE_PLANE_LUMA,
+   VDP_VIDEO_SURFACE_PLANE_CHROMA
+} VdpVideoSurfacePlane;
+
+struct VdpSurfaceDMABufDesc
+{
+   /* DMA-BUF file descriptor, owned by the caller */
+   uint32_t handle;
+   /* width in pixel */
+   uint32_t width;
+   /* height in pixel */
+   uint32_t height;
+   /* offset in bytes */
+   uint32_t offset;
+   /* stride in bytes */
+   uint32_t stride;
+   /* VDP_RGBA_FORMAT_* as defined in the VDPAU headers or above */
+   uint32_t format;
+};
+
+typedef VdpStatus VdpVideoSurfaceDMABuf(VdpVideoSurface surface,
+                                        VdpVideoSurfacePlane plane,
+                                        struct VdpSurfaceDMABufDesc *result);
+
+typedef VdpStatus VdpOutputSurfaceDMABuf(VdpOutputSurface surface,
+                                         struct VdpSurfaceDMABufDesc *result);
+
+#endif /* _VDPAU_DMABUF_H_ */
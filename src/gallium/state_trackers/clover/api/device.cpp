@@ -78,7 +78,7 @@ clGetDeviceInfo(cl_device_id d_dev, cl_device_info param,
       break;
 
    case CL_DEVICE_MAX_COMPUTE_UNITS:
-      buf.as_scalar<cl_uint>() = 1;
+      buf.as_scalar<cl_uint>() = dev.max_compute_units();
       break;
 
    case CL_DEVICE_MAX_WORK_ITEM_DIMENSIONS:
@@ -228,7 +228,8 @@ clGetDeviceInfo(cl_device_id d_dev, cl_device_info param,
       break;
 
    case CL_DEVICE_QUEUE_PROPERTIES:
-      buf.as_scalar<cl_command_queue_properties>() = CL_QUEUE_PROFILING_ENABLE;
+      buf.as_scalar<cl_command_queue_properties>() =
+         CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE | CL_QUEUE_PROFILING_ENABLE;
       break;
 
    case CL_DEVICE_NAME:
@@ -182,9 +182,13 @@ clEnqueueMarker(cl_command_queue d_q, cl_event *rd_ev) try {
 
 CLOVER_API cl_int
 clEnqueueBarrier(cl_command_queue d_q) try {
-   obj(d_q);
+   auto &q = obj(d_q);
 
-   // No need to do anything, q preserves data ordering strictly.
+   // No need to do anything for in-order queues, they preserve data
+   // ordering strictly.  Out-of-order queues need a synchronization
+   // point subsequent commands will be serialized with respect to.
+   if (q.out_of_order())
+      transfer(new hard_event(q, 0, {}));
 
    return CL_SUCCESS;
 
@@ -205,7 +209,8 @@ clEnqueueWaitForEvents(cl_command_queue d_q, cl_uint num_evs,
 
    // Create a hard event that depends on the events in the wait list:
    // subsequent commands in the same queue will be implicitly
-   // serialized with respect to it -- hard events always are.
+   // serialized with respect to it -- hard events always are, even
+   // on out-of-order queues.
    ref_ptr<hard_event> hev = transfer(new hard_event(q, 0, evs));
 
    return CL_SUCCESS;
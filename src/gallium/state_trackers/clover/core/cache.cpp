@@ -0,0 +1,140 @@
+//
+// Copyright 2014 Francisco Jerez
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#include "core/cache.hpp"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <sstream>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace clover;
+
+namespace {
+   bool
+   make_dirs(const std::string &dir) {
+      for (size_t i = dir.find('/', 1); ; i = dir.find('/', i + 1)) {
+         std::string d = dir.substr(0, i);
+
+         if (mkdir(d.c_str(), 0755) && errno != EEXIST)
+            return false;
+
+         if (i == std::string::npos)
+            return true;
+      }
+   }
+
+   const char *
+   nonempty_env(const char *name) {
+      const char *s = std::getenv(name);
+      return s && *s ? s : NULL;
+   }
+
+   std::string
+   default_dir() {
+      if (const char *s = std::getenv("CLOVER_CACHE_DIR"))
+         return s;
+      else if (const char *s = nonempty_env("XDG_CACHE_HOME"))
+         return std::string(s) + "/mesa/clover";
+      else if (const char *s = nonempty_env("HOME"))
+         return std::string(s) + "/.cache/mesa/clover";
+      else
+         return "";
+   }
+}
+
+binary_cache::binary_cache() : dir(default_dir()) {
+   if (!dir.empty() && !make_dirs(dir))
+      dir.clear();
+}
+
+bool
+binary_cache::find(const std::string &key, buffer_t &bin) const {
+   if (dir.empty())
+      return false;
+
+   std::ifstream f(path(key), std::ios::binary);
+   if (!f)
+      return false;
+
+   // Entries consist of the length of the key, the key itself and
+   // the actual binary.
+   uint32_t n;
+   if (!f.read(reinterpret_cast<char *>(&n), sizeof(n)) || n != key.size())
+      return false;
+
+   std::string k(n, '\0');
+   if (!f.read(&k[0], n) || k != key)
+      return false;
+
+   std::vector<unsigned char> data { std::istreambuf_iterator<char>(f),
+                                     std::istreambuf_iterator<char>() };
+   if (data.empty())
+      return false;
+
+   bin = data;
+   return true;
+}
+
+void
+binary_cache::insert(const std::string &key, const buffer_t &bin) const {
+   if (dir.empty())
+      return;
+
+   // Write to a temporary file first and rename it into place, so
+   // concurrent processes never see a partial entry.
+   const std::string file = path(key);
+   std::ostringstream tmp;
+   tmp << file << ".tmp." << getpid();
+
+   {
+      std::ofstream f(tmp.str(), std::ios::binary);
+      uint32_t n = key.size();
+
+      f.write(reinterpret_cast<const char *>(&n), sizeof(n));
+      f.write(key.data(), n);
+      f.write(reinterpret_cast<const char *>(bin.begin()), bin.size());
+
+      if (!f) {
+         f.close();
+         std::remove(tmp.str().c_str());
+         return;
+      }
+   }
+
+   if (std::rename(tmp.str().c_str(), file.c_str()))
+      std::remove(tmp.str().c_str());
+}
+
+std::string
+binary_cache::path(const std::string &key) const {
+   std::ostringstream s;
+   s << dir << '/' << std::hex << std::hash<std::string>()(key);
+   return s.str();
+}
@@ -0,0 +1,61 @@
+//
+// Copyright 2014 Francisco Jerez
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+// OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+// ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+// OTHER DEALINGS IN THE SOFTWARE.
+//
+
+#ifndef CLOVER_CORE_CACHE_HPP
+#define CLOVER_CORE_CACHE_HPP
+
+#include <string>
+
+#include "util/compat.hpp"
+
+namespace clover {
+   ///
+   /// Persistent on-disk cache of serialized program binaries.
+   ///
+   /// Entries are looked up by an arbitrary key string which should
+   /// identify everything the binary depends on.  The full key is
+   /// stored along with each entry so hash collisions are harmless.
+   /// The cache lives in $CLOVER_CACHE_DIR, or in
+   /// $XDG_CACHE_HOME/mesa/clover (~/.cache/mesa/clover) if unset; an
+   /// empty CLOVER_CACHE_DIR disables it.
+   ///
+   class binary_cache {
+   public:
+      typedef compat::ostream::buffer_t buffer_t;
+
+      binary_cache();
+
+      binary_cache(const binary_cache &cache) = delete;
+      binary_cache &
+      operator=(const binary_cache &cache) = delete;
+
+      bool find(const std::string &key, buffer_t &bin) const;
+      void insert(const std::string &key, const buffer_t &bin) const;
+
+   private:
+      std::string path(const std::string &key) const;
+
+      std::string dir;
+   };
+}
+
+#endif
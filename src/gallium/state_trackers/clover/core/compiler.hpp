@@ -34,6 +34,10 @@ namespace clover {
                                const compat::string &target,
                                const compat::string &opts);
 
+   /// Version of the LLVM libraries compile_program_llvm() uses, as
+   /// the HAVE_LLVM hex number.
+   unsigned compiler_version_llvm();
+
    module compile_program_tgsi(const compat::string &source);
 }
 
@@ -33,7 +33,8 @@ namespace {
       int sz = pipe->get_compute_param(pipe, cap, NULL);
       std::vector<T> v(sz / sizeof(T));
 
-      pipe->get_compute_param(pipe, cap, &v.front());
+      if (!v.empty())
+         pipe->get_compute_param(pipe, cap, &v.front());
       return v;
    }
 }
@@ -153,6 +154,13 @@ device::max_mem_alloc_size() const {
                                       PIPE_COMPUTE_CAP_MAX_MEM_ALLOC_SIZE)[0];
 }
 
+cl_uint
+device::max_compute_units() const {
+   auto v = get_compute_param<uint32_t>(pipe,
+                                        PIPE_COMPUTE_CAP_MAX_COMPUTE_UNITS);
+   return v.empty() ? 1 : std::max(1u, v[0]);
+}
+
 std::vector<size_t>
 device::max_block_size() const {
    auto v = get_compute_param<uint64_t>(pipe, PIPE_COMPUTE_CAP_MAX_BLOCK_SIZE);
@@ -61,6 +61,7 @@ namespace clover {
       cl_uint max_const_buffers() const;
       size_t max_threads_per_block() const;
       cl_ulong max_mem_alloc_size() const;
+      cl_uint max_compute_units() const;
 
       std::vector<size_t> max_block_size() const;
       std::string device_name() const;
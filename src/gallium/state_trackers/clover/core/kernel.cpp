@@ -66,7 +66,7 @@ kernel::launch(command_queue &q,
                const std::vector<size_t> &grid_offset,
                const std::vector<size_t> &grid_size,
                const std::vector<size_t> &block_size) {
-   const auto m = prog.binary(q.dev);
+   const auto &m = prog.binary(q.dev);
    const auto reduced_grid_size =
       map(divides(), grid_size, block_size);
    void *st = exec.bind(&q);
@@ -77,17 +77,22 @@ kernel::launch(command_queue &q,
          return (uint32_t *)&exec.input[h];
       }, exec.g_handles);
 
+   // Plenty of kernels take nothing but scalars and global buffers,
+   // don't bother the driver with empty binding tables in that case.
    q.pipe->bind_compute_state(q.pipe, st);
-   q.pipe->bind_sampler_states(q.pipe, PIPE_SHADER_COMPUTE,
-                               0, exec.samplers.size(),
-                               exec.samplers.data());
-
-   q.pipe->set_sampler_views(q.pipe, PIPE_SHADER_COMPUTE, 0,
-                             exec.sviews.size(), exec.sviews.data());
-   q.pipe->set_compute_resources(q.pipe, 0, exec.resources.size(),
-                                 exec.resources.data());
-   q.pipe->set_global_binding(q.pipe, 0, exec.g_buffers.size(),
-                              exec.g_buffers.data(), g_handles.data());
+   if (!exec.samplers.empty())
+      q.pipe->bind_sampler_states(q.pipe, PIPE_SHADER_COMPUTE,
+                                  0, exec.samplers.size(),
+                                  exec.samplers.data());
+   if (!exec.sviews.empty())
+      q.pipe->set_sampler_views(q.pipe, PIPE_SHADER_COMPUTE, 0,
+                                exec.sviews.size(), exec.sviews.data());
+   if (!exec.resources.empty())
+      q.pipe->set_compute_resources(q.pipe, 0, exec.resources.size(),
+                                    exec.resources.data());
+   if (!exec.g_buffers.empty())
+      q.pipe->set_global_binding(q.pipe, 0, exec.g_buffers.size(),
+                                 exec.g_buffers.data(), g_handles.data());
 
    q.pipe->launch_grid(q.pipe,
                        pad_vector(q, block_size, 1).data(),
@@ -95,12 +100,17 @@ kernel::launch(command_queue &q,
                        find(name_equals(_name), m.syms).offset,
                        exec.input.data());
 
-   q.pipe->set_global_binding(q.pipe, 0, exec.g_buffers.size(), NULL, NULL);
-   q.pipe->set_compute_resources(q.pipe, 0, exec.resources.size(), NULL);
-   q.pipe->set_sampler_views(q.pipe, PIPE_SHADER_COMPUTE, 0,
-                             exec.sviews.size(), NULL);
-   q.pipe->bind_sampler_states(q.pipe, PIPE_SHADER_COMPUTE, 0,
-                               exec.samplers.size(), NULL);
+   if (!exec.g_buffers.empty())
+      q.pipe->set_global_binding(q.pipe, 0, exec.g_buffers.size(),
+                                 NULL, NULL);
+   if (!exec.resources.empty())
+      q.pipe->set_compute_resources(q.pipe, 0, exec.resources.size(), NULL);
+   if (!exec.sviews.empty())
+      q.pipe->set_sampler_views(q.pipe, PIPE_SHADER_COMPUTE, 0,
+                                exec.sviews.size(), NULL);
+   if (!exec.samplers.empty())
+      q.pipe->bind_sampler_states(q.pipe, PIPE_SHADER_COMPUTE, 0,
+                                  exec.samplers.size(), NULL);
    exec.unbind();
 }
 
@@ -168,9 +178,11 @@ kernel::exec_context::bind(command_queue *_q) {
    std::swap(q, _q);
 
    // Bind kernel arguments.
+   // Take references, copying the module would copy the whole
+   // binary on every launch.
    auto &m = kern.prog.binary(q->dev);
-   auto margs = find(name_equals(kern.name()), m.syms).args;
-   auto msec = find(type_equals(module::section::text), m.secs);
+   auto &margs = find(name_equals(kern.name()), m.syms).args;
+   auto &msec = find(type_equals(module::section::text), m.secs);
 
    for_each([=](kernel::argument &karg, const module::argument &marg) {
                karg.bind(*this, marg);
@@ -304,16 +316,26 @@ kernel::scalar_argument::set(size_t size, const void *value) {
       throw error(CL_INVALID_ARG_SIZE);
 
    v = { (uint8_t *)value, (uint8_t *)value + size };
+   w.clear();
    _set = true;
 }
 
 void
 kernel::scalar_argument::bind(exec_context &ctx,
                               const module::argument &marg) {
-   auto w = v;
+   // Kernels are typically launched many times with most of their
+   // arguments unchanged, only convert the value again to the target
+   // representation if it was set since the last launch.
+   if (w.empty() || w_ext != marg.ext_type ||
+       w_endian != ctx.q->dev.endianness() ||
+       w.size() != marg.target_size) {
+      w = v;
+      w_ext = marg.ext_type;
+      w_endian = ctx.q->dev.endianness();
+      extend(w, marg.ext_type, marg.target_size);
+      byteswap(w, ctx.q->dev.endianness());
+   }
 
-   extend(w, marg.ext_type, marg.target_size);
-   byteswap(w, ctx.q->dev.endianness());
    align(ctx.input, marg.target_align);
    insert(ctx.input, w);
 }
@@ -148,6 +148,11 @@ namespace clover {
       private:
          size_t size;
          std::vector<uint8_t> v;
+
+         /// Value converted to the target representation.
+         std::vector<uint8_t> w;
+         enum module::argument::ext_type w_ext;
+         enum pipe_endian w_endian;
       };
 
       class global_argument : public argument {
@@ -31,7 +31,9 @@ memory_obj::memory_obj(context &ctx, cl_mem_flags flags,
    ctx(ctx), _flags(flags),
    _size(size), _host_ptr(host_ptr),
    _destroy_notify([]{}) {
-   if (flags & (CL_MEM_COPY_HOST_PTR | CL_MEM_USE_HOST_PTR))
+   // The storage of CL_MEM_USE_HOST_PTR objects is guaranteed to stay
+   // valid for their whole lifetime, no need to copy it.
+   if (flags & CL_MEM_COPY_HOST_PTR)
       data.append((char *)host_ptr, size);
 }
 
@@ -64,6 +66,16 @@ memory_obj::host_ptr() const {
    return _host_ptr;
 }
 
+const void *
+memory_obj::initial_data() const {
+   if (!data.empty())
+      return data.data();
+   else if (_flags & CL_MEM_USE_HOST_PTR)
+      return _host_ptr;
+   else
+      return NULL;
+}
+
 buffer::buffer(context &ctx, cl_mem_flags flags,
                size_t size, void *host_ptr) :
    memory_obj(ctx, flags, size, host_ptr) {
@@ -85,7 +97,7 @@ root_buffer::resource(command_queue &q) {
    if (!resources.count(&q.dev)) {
       auto r = (!resources.empty() ?
                 new root_resource(q.dev, *this, *resources.begin()->second) :
-                new root_resource(q.dev, *this, q, data));
+                new root_resource(q.dev, *this, q, initial_data()));
 
       resources.insert(std::make_pair(&q.dev,
                                       std::unique_ptr<root_resource>(r)));
@@ -136,7 +148,7 @@ image::resource(command_queue &q) {
    if (!resources.count(&q.dev)) {
       auto r = (!resources.empty() ?
                 new root_resource(q.dev, *this, *resources.begin()->second) :
-                new root_resource(q.dev, *this, q, data));
+                new root_resource(q.dev, *this, q, initial_data()));
 
       resources.insert(std::make_pair(&q.dev,
                                       std::unique_ptr<root_resource>(r)));
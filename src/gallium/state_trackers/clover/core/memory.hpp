@@ -66,6 +66,8 @@ namespace clover {
       std::function<void ()> _destroy_notify;
 
    protected:
+      const void *initial_data() const;
+
       std::string data;
    };
 
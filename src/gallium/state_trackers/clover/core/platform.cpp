@@ -31,6 +31,17 @@ platform::platform() : adaptor_range(derefs(), devs) {
    pipe_loader_probe(&ldevs.front(), n);
 
    for (pipe_loader_device *ldev : ldevs) {
+      // Software devices are the same rasterizer behind different
+      // display winsyses, which compute doesn't care about: only
+      // expose the first one that works as the CPU device.
+      if (ldev->type == PIPE_LOADER_DEVICE_SOFTWARE &&
+          any_of([](const ref_ptr<device> &dev) {
+                return dev->type() == CL_DEVICE_TYPE_CPU;
+             }, devs)) {
+         pipe_loader_release(&ldev, 1);
+         continue;
+      }
+
       try {
          devs.push_back(transfer(new device(*this, ldev)));
       } catch (error &) {
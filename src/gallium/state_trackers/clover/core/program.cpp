@@ -22,9 +22,20 @@
 
 #include "core/program.hpp"
 #include "core/compiler.hpp"
+#include "core/cache.hpp"
+
+#include <sstream>
 
 using namespace clover;
 
+namespace {
+   binary_cache &
+   cache() {
+      static binary_cache c;
+      return c;
+   }
+}
+
 program::program(context &ctx, const std::string &source) :
    has_source(true), ctx(ctx), _source(source) {
 }
@@ -44,6 +55,7 @@ program::build(const ref_vector<device> &devs, const char *opts) {
    if (has_source) {
       for (auto &dev : devs) {
          _binaries.erase(&dev);
+         _serialized.erase(&dev);
          _logs.erase(&dev);
          _opts.erase(&dev);
 
@@ -52,8 +64,7 @@ program::build(const ref_vector<device> &devs, const char *opts) {
          try {
             auto module = (dev.ir_format() == PIPE_SHADER_IR_TGSI ?
                            compile_program_tgsi(_source) :
-                           compile_program_llvm(_source, dev.ir_format(),
-                                                dev.ir_target(), build_opts(dev)));
+                           compile_llvm(dev));
             _binaries.insert({ &dev, module });
 
          } catch (build_error &e) {
@@ -64,6 +75,53 @@ program::build(const ref_vector<device> &devs, const char *opts) {
    }
 }
 
+module
+program::compile_llvm(const device &dev) {
+   const std::string key = cache_key(dev);
+   compat::ostream::buffer_t bin;
+
+   if (cache().find(key, bin)) {
+      try {
+         compat::istream::buffer_t buf(bin);
+         compat::istream s(buf);
+         auto m = module::deserialize(s);
+
+         _serialized.insert({ &dev, bin });
+         return m;
+
+      } catch (compat::istream::error &e) {
+         // Stale or corrupt entry, build it again and overwrite it.
+         bin = compat::ostream::buffer_t();
+      }
+   }
+
+   auto m = compile_program_llvm(_source, dev.ir_format(),
+                                 dev.ir_target(), build_opts(dev));
+   compat::ostream s(bin);
+
+   m.serialize(s);
+   cache().insert(key, bin);
+   _serialized.insert({ &dev, bin });
+
+   return m;
+}
+
+std::string
+program::cache_key(const device &dev) const {
+   std::ostringstream key;
+
+   // Everything the output of compile_program_llvm() depends on.
+   key << PACKAGE_VERSION << '\0'
+       << std::hex << compiler_version_llvm() << '\0'
+       << dev.device_name() << '\0'
+       << dev.ir_format() << '\0'
+       << dev.ir_target() << '\0'
+       << build_opts(dev) << '\0'
+       << _source;
+
+   return key.str();
+}
+
 const std::string &
 program::source() const {
    return _source;
@@ -79,6 +137,21 @@ program::binary(const device &dev) const {
    return _binaries.find(const_cast<device *>(&dev))->second;
 }
 
+const compat::ostream::buffer_t &
+program::serialized_binary(const device &dev) const {
+   auto it = _serialized.find(&dev);
+
+   if (it == _serialized.end()) {
+      compat::ostream::buffer_t bin;
+      compat::ostream s(bin);
+
+      binary(dev).serialize(s);
+      it = _serialized.insert({ &dev, bin }).first;
+   }
+
+   return it->second;
+}
+
 cl_build_status
 program::build_status(const device &dev) const {
    if (_binaries.count(const_cast<device *>(&dev)))
@@ -55,6 +55,8 @@ namespace clover {
       device_range devices() const;
 
       const module &binary(const device &dev) const;
+      const compat::ostream::buffer_t &
+      serialized_binary(const device &dev) const;
       cl_build_status build_status(const device &dev) const;
       std::string build_opts(const device &dev) const;
       std::string build_log(const device &dev) const;
@@ -64,7 +66,12 @@ namespace clover {
       context &ctx;
 
    private:
+      module compile_llvm(const device &dev);
+      std::string cache_key(const device &dev) const;
+
       std::map<device *, module> _binaries;
+      mutable std::map<const device *,
+                       compat::ostream::buffer_t> _serialized;
       std::map<const device *, std::string> _logs;
       std::map<const device *, std::string> _opts;
       std::string _source;
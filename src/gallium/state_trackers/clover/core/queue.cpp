@@ -44,17 +44,29 @@ command_queue::flush() {
    pipe_screen *screen = dev.pipe;
    pipe_fence_handle *fence = NULL;
 
-   if (!queued_events.empty()) {
-      pipe->flush(pipe, &fence, 0);
+   // Nothing to submit if no event has been triggered yet, e.g. if
+   // all of them are still waiting for some user event.
+   if (!any_of([](const event_ptr &ev) {
+            return ev->signalled();
+         }, queued_events))
+      return;
 
-      while (!queued_events.empty() &&
-             queued_events.front()->signalled()) {
-         queued_events.front()->fence(fence);
-         queued_events.pop_front();
-      }
+   pipe->flush(pipe, &fence, 0);
 
-      screen->fence_reference(screen, &fence, NULL);
+   // Events of out-of-order queues may be triggered in any order,
+   // hand the fence to all the signalled ones and keep the rest.
+   std::deque<event_ptr> pending;
+
+   for (auto &ev : queued_events) {
+      if (ev->signalled())
+         ev->fence(fence);
+      else
+         pending.push_back(ev);
    }
+
+   queued_events.swap(pending);
+
+   screen->fence_reference(screen, &fence, NULL);
 }
 
 cl_command_queue_properties
@@ -67,10 +79,27 @@ command_queue::profiling_enabled() const {
    return _props & CL_QUEUE_PROFILING_ENABLE;
 }
 
+bool
+command_queue::out_of_order() const {
+   return _props & CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE;
+}
+
 void
 command_queue::sequence(hard_event *ev) {
-   if (!queued_events.empty())
-      queued_events.back()->chain(ev);
+   if (!out_of_order()) {
+      if (!queued_events.empty())
+         queued_events.back()->chain(ev);
+
+   } else if (ev->command() == CL_COMMAND_MARKER || !ev->command()) {
+      // Synchronization point: wait for everything enqueued so far.
+      for (auto &qev : queued_events)
+         qev->chain(ev);
+
+      sync_event = ev;
+
+   } else if (sync_event) {
+      sync_event->chain(ev);
+   }
 
    queued_events.push_back(ev);
 }
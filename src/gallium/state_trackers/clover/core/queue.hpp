@@ -49,6 +49,7 @@ namespace clover {
 
       cl_command_queue_properties props() const;
       bool profiling_enabled() const;
+      bool out_of_order() const;
 
       context &ctx;
       device &dev;
@@ -64,7 +65,11 @@ namespace clover {
 
    private:
       /// Serialize a hardware event with respect to the previous ones,
-      /// and push it to the pending list.
+      /// and push it to the pending list.  On out-of-order queues
+      /// only synchronization commands (markers, barriers and
+      /// waits) impose an order, every other event merely depends
+      /// on its explicit wait list and the last synchronization
+      /// point.
       void sequence(hard_event *ev);
 
       cl_command_queue_properties _props;
@@ -72,6 +77,7 @@ namespace clover {
 
       typedef ref_ptr<hard_event> event_ptr;
       std::deque<event_ptr> queued_events;
+      event_ptr sync_event;
    };
 }
 
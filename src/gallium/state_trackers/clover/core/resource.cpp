@@ -114,7 +114,7 @@ resource::unbind_surface(command_queue &q, pipe_surface *st) {
 }
 
 root_resource::root_resource(device &dev, memory_obj &obj,
-                             command_queue &q, const std::string &data) :
+                             command_queue &q, const void *data) :
    resource(dev, obj) {
    pipe_resource info {};
 
@@ -136,16 +136,22 @@ root_resource::root_resource(device &dev, memory_obj &obj,
                 PIPE_BIND_TRANSFER_READ |
                 PIPE_BIND_TRANSFER_WRITE);
 
+   // Objects the application asked to be host-accessible are going to
+   // be mapped frequently: ask for storage with fast CPU access, which
+   // lets drivers map them directly instead of through a staging copy.
+   if (obj.flags() & (CL_MEM_ALLOC_HOST_PTR | CL_MEM_USE_HOST_PTR))
+      info.usage = PIPE_USAGE_STAGING;
+
    pipe = dev.pipe->resource_create(dev.pipe, &info);
    if (!pipe)
       throw error(CL_OUT_OF_RESOURCES);
 
-   if (!data.empty()) {
+   if (data) {
       box rect { {{ 0, 0, 0 }}, {{ info.width0, info.height0, info.depth0 }} };
       unsigned cpp = util_format_get_blocksize(info.format);
 
       q.pipe->transfer_inline_write(q.pipe, pipe, 0, PIPE_TRANSFER_WRITE,
-                                    rect, data.data(), cpp * info.width0,
+                                    rect, data, cpp * info.width0,
                                     cpp * info.width0 * info.height0);
    }
 }
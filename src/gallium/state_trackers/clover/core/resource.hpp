@@ -85,7 +85,7 @@ namespace clover {
    class root_resource : public resource {
    public:
       root_resource(device &dev, memory_obj &obj,
-                    command_queue &q, const std::string &data);
+                    command_queue &q, const void *data);
       root_resource(device &dev, memory_obj &obj, root_resource &r);
       virtual ~root_resource();
    };
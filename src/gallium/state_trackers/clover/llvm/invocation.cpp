@@ -398,3 +398,8 @@ clover::compile_program_llvm(const compat::string &source,
          return build_module_llvm(mod, kernels, address_spaces);
    }
 }
+
+unsigned
+clover::compiler_version_llvm() {
+   return HAVE_LLVM;
+}
@@ -952,7 +952,7 @@ static void vid_dec_h264_Decode(vid_dec_PrivateType *priv, struct vl_vlc *vlc, u
       unsigned bits = vl_vlc_valid_bits(vlc);
       unsigned bytes = bits / 8 + 4;
       struct vl_rbsp rbsp;
-      uint8_t buf[8];
+      uint8_t buf[12];
       const void *ptr = buf;
       unsigned i;
 
@@ -961,7 +961,7 @@ static void vid_dec_h264_Decode(vid_dec_PrivateType *priv, struct vl_vlc *vlc, u
       buf[2] = 0x1;
       buf[3] = (nal_ref_idc << 5) | nal_unit_type;
       for (i = 4; i < bytes; ++i)
-         buf[i] = vl_vlc_peekbits(vlc, bits) >> ((bytes - i - 1) * 8);
+         buf[i] = vl_vlc_peekbits(vlc, (i - 3) * 8);
 
       priv->bytes_left = (vl_vlc_bits_left(vlc) - bits) / 8;
       priv->slice = vlc->data;
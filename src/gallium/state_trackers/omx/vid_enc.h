@@ -58,6 +58,7 @@
 #define OMX_VID_ENC_SCALING_WIDTH_DEFAULT 0xffffffff
 #define OMX_VID_ENC_SCALING_HEIGHT_DEFAULT 0xffffffff
 #define OMX_VID_ENC_IDR_PERIOD_DEFAULT 1000
+#define OMX_VID_ENC_NUM_SCALING_BUFFERS 4
 
 DERIVEDCLASS(vid_enc_PrivateType, omx_base_filter_PrivateType)
 #define vid_enc_PrivateType_FIELDS omx_base_filter_PrivateType_FIELDS \
@@ -72,7 +73,8 @@ DERIVEDCLASS(vid_enc_PrivateType, omx_base_filter_PrivateType)
 	OMX_CONFIG_INTRAREFRESHVOPTYPE force_pic_type; \
 	struct vl_compositor compositor; \
 	struct vl_compositor_state cstate; \
-	struct pipe_video_buffer *scale_buffer; \
+	struct pipe_video_buffer *scale_buffer[OMX_VID_ENC_NUM_SCALING_BUFFERS]; \
+	unsigned current_scale_buffer; \
 	OMX_CONFIG_SCALEFACTORTYPE scale; 
 ENDCLASS(vid_enc_PrivateType)
 
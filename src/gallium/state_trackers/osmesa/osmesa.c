@@ -363,10 +363,17 @@ osmesa_st_framebuffer_flush_front(struct st_context_iface *stctx,
       dst_stride = -dst_stride;
    }
 
-   for (y = 0; y < res->height0; y++) {
-      memcpy(dst, src, bytes);
-      dst += dst_stride;
-      src += transfer->stride;
+   if (!osmesa->y_up && dst_stride == (int) transfer->stride &&
+       dst_stride == (int) bytes) {
+      /* same layout, copy the whole image at once */
+      memcpy(dst, src, bytes * res->height0);
+   }
+   else {
+      for (y = 0; y < res->height0; y++) {
+         memcpy(dst, src, bytes);
+         dst += dst_stride;
+         src += transfer->stride;
+      }
    }
 
    pipe->transfer_unmap(pipe, transfer);
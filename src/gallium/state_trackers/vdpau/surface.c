@@ -36,6 +36,8 @@
 #include "util/u_surface.h"
 #include "vl/vl_defines.h"
 
+#include "state_tracker/drm_driver.h"
+
 #include "vdpau_private.h"
 
 enum getbits_conversion {
@@ -490,3 +492,78 @@ struct pipe_video_buffer *vlVdpVideoSurfaceGallium(VdpVideoSurface surface)
 
    return p_surf->video_buffer;
 }
+
+/**
+ * Export a plane of a video surface as DMA-BUF
+ */
+VdpStatus vlVdpVideoSurfaceDMABuf(VdpVideoSurface surface,
+                                  VdpVideoSurfacePlane plane,
+                                  struct VdpSurfaceDMABufDesc *result)
+{
+   vlVdpSurface *p_surf = vlGetDataHTAB(surface);
+
+   struct pipe_screen *pscreen;
+   struct pipe_sampler_view **samplers;
+   struct pipe_resource *res;
+   struct winsys_handle whandle;
+
+   if (!p_surf)
+      return VDP_STATUS_INVALID_HANDLE;
+
+   if (plane > VDP_VIDEO_SURFACE_PLANE_CHROMA)
+      return VDP_STATUS_INVALID_VALUE;
+
+   if (!result)
+      return VDP_STATUS_INVALID_POINTER;
+
+   memset(result, 0, sizeof(*result));
+   result->handle = -1;
+
+   pipe_mutex_lock(p_surf->device->mutex);
+   if (p_surf->video_buffer == NULL) {
+      struct pipe_context *pipe = p_surf->device->context;
+
+      /* try to create a video buffer if we don't already have one */
+      p_surf->video_buffer = pipe->create_video_buffer(pipe, &p_surf->templat);
+   }
+
+   /* Both fields of an interlaced buffer live in the layers of one
+    * resource, which can't be described by a single plane.
+    */
+   if (!p_surf->video_buffer || p_surf->video_buffer->interlaced ||
+       p_surf->video_buffer->buffer_format != PIPE_FORMAT_NV12) {
+      pipe_mutex_unlock(p_surf->device->mutex);
+      return VDP_STATUS_NO_IMPLEMENTATION;
+   }
+
+   samplers = p_surf->video_buffer->get_sampler_view_planes(p_surf->video_buffer);
+   if (!samplers || !samplers[plane]) {
+      pipe_mutex_unlock(p_surf->device->mutex);
+      return VDP_STATUS_RESOURCES;
+   }
+
+   res = samplers[plane]->texture;
+   pscreen = res->screen;
+
+   /* make sure the decoded content has landed before anybody else reads it */
+   p_surf->device->context->flush(p_surf->device->context, NULL, 0);
+
+   memset(&whandle, 0, sizeof(struct winsys_handle));
+   whandle.type = DRM_API_HANDLE_TYPE_FD;
+
+   if (!pscreen->resource_get_handle(pscreen, res, &whandle)) {
+      pipe_mutex_unlock(p_surf->device->mutex);
+      return VDP_STATUS_NO_IMPLEMENTATION;
+   }
+   pipe_mutex_unlock(p_surf->device->mutex);
+
+   result->handle = whandle.handle;
+   result->width = res->width0;
+   result->height = res->height0;
+   result->offset = 0;
+   result->stride = whandle.stride;
+   result->format = plane == VDP_VIDEO_SURFACE_PLANE_LUMA ?
+                    VDP_RGBA_FORMAT_R8 : VDP_RGBA_FORMAT_R8G8;
+
+   return VDP_STATUS_OK;
+}
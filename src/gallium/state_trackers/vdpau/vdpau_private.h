@@ -37,6 +37,7 @@
 #include "pipe/p_video_codec.h"
 
 #include "state_tracker/vdpau_interop.h"
+#include "state_tracker/vdpau_dmabuf.h"
 
 #include "util/u_debug.h"
 #include "util/u_rect.h"
@@ -514,6 +515,10 @@ VdpPresentationQueueTargetCreateX11 vlVdpPresentationQueueTargetCreateX11;
 VdpVideoSurfaceGallium vlVdpVideoSurfaceGallium;
 VdpOutputSurfaceGallium vlVdpOutputSurfaceGallium;
 
+/* interop with other APIs and processes through DMA-BUF */
+VdpVideoSurfaceDMABuf vlVdpVideoSurfaceDMABuf;
+VdpOutputSurfaceDMABuf vlVdpOutputSurfaceDMABuf;
+
 #define VDPAU_OUT   0
 #define VDPAU_ERR   1
 #define VDPAU_WARN  2
@@ -465,6 +465,98 @@ bind_samplers(struct xa_context *ctx,
 				   ctx->bound_sampler_views);
 }
 
+static boolean
+picture_same_state(const struct xa_picture *a, const struct xa_picture *b,
+		   const struct pipe_sampler_view *view)
+{
+    if (!a || !b)
+	return a == b;
+
+    if (a->srf != b->srf || a->pict_format != b->pict_format ||
+	a->has_transform != b->has_transform ||
+	a->component_alpha != b->component_alpha ||
+	a->wrap != b->wrap || a->filter != b->filter)
+	return FALSE;
+
+    /*
+     * The transform is applied to the vertices, but solid fills and
+     * the sampler views end up in the shader and sampler state.
+     */
+    if (a->src_pict || b->src_pict)
+	return a->src_pict && b->src_pict &&
+	    a->src_pict->type == xa_src_pict_solid_fill &&
+	    b->src_pict->type == xa_src_pict_solid_fill &&
+	    a->src_pict->solid_fill.color == b->src_pict->solid_fill.color;
+
+    /* The surface may have been redefined since the view was created. */
+    return view && view->texture == b->srf->tex;
+}
+
+/*
+ * Can comp be drawn with the state of the pending composite batch?
+ */
+static boolean
+composite_same_state(struct xa_context *ctx, const struct xa_composite *comp)
+{
+    const struct xa_composite *pending = &ctx->pending_comp;
+
+    if (comp->op != pending->op ||
+	comp->dst->srf != ctx->dst ||
+	comp->dst->srf->tex != ctx->pending_dst_tex ||
+	comp->dst->pict_format != pending->dst->pict_format)
+	return FALSE;
+
+    return picture_same_state(pending->src, comp->src,
+			      ctx->bound_sampler_views[0]) &&
+	picture_same_state(pending->mask, comp->mask,
+			   ctx->bound_sampler_views[1]);
+}
+
+static void
+composite_save_state(struct xa_context *ctx, const struct xa_composite *comp)
+{
+    struct xa_composite *pending = &ctx->pending_comp;
+
+    *pending = *comp;
+
+    ctx->pending_dst = *comp->dst;
+    pending->dst = &ctx->pending_dst;
+    ctx->pending_dst_tex = comp->dst->srf->tex;
+
+    if (comp->src) {
+	ctx->pending_src = *comp->src;
+	if (comp->src->src_pict) {
+	    ctx->pending_src_pict = *comp->src->src_pict;
+	    ctx->pending_src.src_pict = &ctx->pending_src_pict;
+	}
+	pending->src = &ctx->pending_src;
+    }
+
+    if (comp->mask) {
+	ctx->pending_mask = *comp->mask;
+	/* solid fill masks aren't accelerated */
+	ctx->pending_mask.src_pict = NULL;
+	pending->mask = &ctx->pending_mask;
+    }
+}
+
+/*
+ * Draw the composite batch left open by xa_composite_done. Needs to be
+ * called before anything else changes the state or reads the results.
+ */
+void
+xa_ctx_composite_flush(struct xa_context *ctx)
+{
+    if (!ctx->comp_pending)
+	return;
+
+    renderer_draw_flush(ctx);
+
+    ctx->comp_pending = FALSE;
+    ctx->has_solid_color = FALSE;
+    xa_ctx_sampler_views_destroy(ctx);
+}
+
 XA_EXPORT int
 xa_composite_prepare(struct xa_context *ctx,
 		     const struct xa_composite *comp)
@@ -472,6 +564,20 @@ xa_composite_prepare(struct xa_context *ctx,
     struct xa_surface *dst_srf = comp->dst->srf;
     int ret;
 
+    /*
+     * X servers tend to composite lots of tiny rectangles, e.g. glyphs,
+     * with the same pictures one after another. Just keep adding to the
+     * vertex buffer if nothing changed since the last composite.
+     */
+    if (ctx->comp_pending) {
+	if (composite_same_state(ctx, comp)) {
+	    ctx->comp_pending = FALSE;
+	    ctx->comp = comp;
+	    return XA_ERR_NONE;
+	}
+	xa_ctx_composite_flush(ctx);
+    }
+
     ret = xa_ctx_srf_create(ctx, dst_srf);
     if (ret != XA_ERR_NONE)
 	return ret;
@@ -495,6 +601,8 @@ xa_composite_prepare(struct xa_context *ctx,
 	ctx->comp = comp;
     }
 
+    composite_save_state(ctx, comp);
+
     xa_ctx_srf_destroy(ctx);
     return XA_ERR_NONE;
 }
@@ -526,11 +634,13 @@ xa_composite_rect(struct xa_context *ctx,
 XA_EXPORT void
 xa_composite_done(struct xa_context *ctx)
 {
-    renderer_draw_flush(ctx);
-
+    /*
+     * Don't draw yet, the next composite may use the same state.
+     * The batch is drawn by xa_ctx_composite_flush when the state
+     * changes, the results are needed or the context is flushed.
+     */
     ctx->comp = NULL;
-    ctx->has_solid_color = FALSE;
-    xa_ctx_sampler_views_destroy(ctx);
+    ctx->comp_pending = TRUE;
 }
 
 static const struct xa_composite_allocation a = {
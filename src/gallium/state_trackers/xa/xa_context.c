@@ -37,6 +37,7 @@
 XA_EXPORT void
 xa_context_flush(struct xa_context *ctx)
 {
+	xa_ctx_composite_flush(ctx);
 	ctx->pipe->flush(ctx->pipe, &ctx->last_fence, 0);
 }
 
@@ -66,6 +67,8 @@ xa_context_destroy(struct xa_context *r)
     struct pipe_resource **vsbuf = &r->vs_const_buffer;
     struct pipe_resource **fsbuf = &r->fs_const_buffer;
 
+    xa_ctx_composite_flush(r);
+
     if (*vsbuf)
 	pipe_resource_reference(vsbuf, NULL);
 
@@ -98,6 +101,8 @@ xa_surface_dma(struct xa_context *ctx,
     struct pipe_transfer *transfer;
     void *map;
     int w, h, i;
+
+    xa_ctx_composite_flush(ctx);
     enum pipe_transfer_usage transfer_direction;
     struct pipe_context *pipe = ctx->pipe;
 
@@ -141,6 +146,8 @@ xa_surface_map(struct xa_context *ctx,
     if (srf->transfer)
 	return NULL;
 
+    xa_ctx_composite_flush(ctx);
+
     if (usage & XA_MAP_READ)
 	gallium_usage |= PIPE_TRANSFER_READ;
     if (usage & XA_MAP_WRITE)
@@ -214,6 +221,8 @@ xa_copy_prepare(struct xa_context *ctx,
     if (src == dst || ctx->srf != NULL)
 	return -XA_ERR_INVAL;
 
+    xa_ctx_composite_flush(ctx);
+
     if (src->tex->format != dst->tex->format) {
 	int ret = xa_ctx_srf_create(ctx, dst);
 	if (ret != XA_ERR_NONE)
@@ -284,6 +293,8 @@ xa_solid_prepare(struct xa_context *ctx, struct xa_surface *dst,
     int width, height;
     int ret;
 
+    xa_ctx_composite_flush(ctx);
+
     ret = xa_ctx_srf_create(ctx, dst);
     if (ret != XA_ERR_NONE)
 	return ret;
@@ -112,6 +112,17 @@ struct xa_context {
     unsigned int num_bound_samplers;
     struct pipe_sampler_view *bound_sampler_views[XA_MAX_SAMPLERS];
     const struct xa_composite *comp;
+
+    /*
+     * State of the composite batch left open by xa_composite_done,
+     * so that following composites with the same state end up in
+     * the same draw.
+     */
+    int comp_pending;
+    struct xa_composite pending_comp;
+    struct xa_picture pending_src, pending_mask, pending_dst;
+    union xa_source_pict pending_src_pict;
+    struct pipe_resource *pending_dst_tex;
 };
 
 enum xa_vs_traits {
@@ -218,6 +229,12 @@ xa_ctx_srf_destroy(struct xa_context *ctx);
 extern void
 xa_ctx_sampler_views_destroy(struct xa_context *ctx);
 
+/*
+ * xa_composite.c
+ */
+extern void
+xa_ctx_composite_flush(struct xa_context *ctx);
+
 /*
  * xa_renderer.c
  */
@@ -0,0 +1,748 @@
+/**************************************************************************
+ *
+ * Copyright 2014 The Mesa Authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/*
+ * Headless performance regression suite.
+ *
+ * Renders offscreen through any device the pipe-loader finds (set
+ * GALLIUM_DRIVER to pick llvmpipe or softpipe on the software device) and
+ * measures the costs the GL state tracker ends up paying: draw call
+ * overhead, state and shader changes, streamed ("immediate mode") versus
+ * static ("display list") vertex data, texture upload and readback, shader
+ * compilation and fill rate.
+ *
+ * Every test is repeated, doubling the iteration count, until one run takes
+ * at least the minimum time, and the rate of that last run is reported.
+ * With -j the results are printed as JSON, for comparing runs by script.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pipe/p_state.h"
+#include "pipe/p_context.h"
+#include "pipe/p_screen.h"
+#include "pipe/p_defines.h"
+#include "pipe/p_shader_tokens.h"
+#include "cso_cache/cso_context.h"
+#include "tgsi/tgsi_text.h"
+#include "util/u_box.h"
+#include "util/u_draw.h"
+#include "util/u_inlines.h"
+#include "util/u_memory.h"
+#include "util/u_simple_shaders.h"
+#include "util/u_string.h"
+#include "util/u_upload_mgr.h"
+#include "os/os_time.h"
+#include "pipe-loader/pipe_loader.h"
+
+
+#define WIDTH 1024
+#define HEIGHT 1024
+
+#define MAX_DEVICES 8
+
+/** Vertices of the streamed/static strips */
+#define STRIP_VERTS 16
+
+/** Layout of the static vertex buffer */
+#define SMALL_TRI_START 0
+#define FULL_QUAD_START 3
+#define STRIP_START 7
+#define NUM_VERTS (STRIP_START + STRIP_VERTS)
+
+
+struct vertex
+{
+   float pos[4];
+   float color[4];
+};
+
+struct perf_context
+{
+   struct pipe_loader_device *dev;
+   struct pipe_screen *screen;
+   struct pipe_context *pipe;
+   struct cso_context *cso;
+   struct u_upload_mgr *upload;
+
+   struct pipe_resource *target;
+   struct pipe_resource *texture;
+   struct pipe_resource *vbuf;
+   struct pipe_framebuffer_state framebuffer;
+   struct pipe_viewport_state viewport;
+   struct pipe_vertex_element velem[2];
+
+   struct pipe_blend_state blend[2];
+   struct pipe_depth_stencil_alpha_state depthstencil;
+   struct pipe_rasterizer_state rasterizer[2];
+
+   void *vs;
+   void *fs[2];
+
+   /** Makes each compiled shader unique */
+   unsigned shader_seed;
+
+   void *data;                  /**< WIDTH x HEIGHT texels of scratch */
+};
+
+struct perf_test
+{
+   const char *name;
+   const char *unit;
+   /** Converts the work done to unit */
+   double scale;
+   /** Report the time per unit of work, rather than the work per second */
+   boolean time_per_work;
+   /** Runs count iterations, returns the amount of work done */
+   double (*run)(struct perf_context *ctx, unsigned count);
+};
+
+
+static void
+finish(struct perf_context *ctx)
+{
+   struct pipe_fence_handle *fence = NULL;
+
+   ctx->pipe->flush(ctx->pipe, &fence, 0);
+   if (fence) {
+      ctx->screen->fence_finish(ctx->screen, fence, PIPE_TIMEOUT_INFINITE);
+      ctx->screen->fence_reference(ctx->screen, &fence, NULL);
+   }
+}
+
+
+static void
+set_vertex(struct vertex *v, float x, float y, float r, float g, float b)
+{
+   v->pos[0] = x;
+   v->pos[1] = y;
+   v->pos[2] = 0.0f;
+   v->pos[3] = 1.0f;
+   v->color[0] = r;
+   v->color[1] = g;
+   v->color[2] = b;
+   v->color[3] = 1.0f;
+}
+
+
+/**
+ * A triangle strip zigzagging across a small area, offset by i.
+ */
+static void
+make_strip(struct vertex *verts, unsigned i)
+{
+   float x0 = -0.9f + (i % 16) * 0.1f;
+   float y0 = -0.9f + (i / 16 % 16) * 0.1f;
+   unsigned j;
+
+   for (j = 0; j < STRIP_VERTS; j++) {
+      set_vertex(&verts[j], x0 + (j / 2) * 0.01f, y0 + (j % 2) * 0.05f,
+                 0.5f, (float) j / STRIP_VERTS, 0.5f);
+   }
+}
+
+
+static void *
+create_color_fs(struct perf_context *ctx, float scale)
+{
+   struct tgsi_token tokens[100];
+   struct pipe_shader_state state;
+   char text[512];
+
+   util_snprintf(text, sizeof(text),
+                 "FRAG\n"
+                 "DCL IN[0], COLOR, PERSPECTIVE\n"
+                 "DCL OUT[0], COLOR\n"
+                 "DCL TEMP[0]\n"
+                 "IMM[0] FLT32 { %f, %f, %f, 1.0 }\n"
+                 "  0: MUL TEMP[0], IN[0], IMM[0]\n"
+                 "  1: MAD OUT[0], TEMP[0], IMM[0].xxxx, IN[0]\n"
+                 "  2: END\n",
+                 scale, 1.0f - scale, 0.5f * scale);
+
+   if (!tgsi_text_translate(text, tokens, Elements(tokens)))
+      return NULL;
+
+   memset(&state, 0, sizeof(state));
+   state.tokens = tokens;
+   return ctx->pipe->create_fs_state(ctx->pipe, &state);
+}
+
+
+static boolean
+init_context(struct perf_context *ctx, int device)
+{
+   struct pipe_loader_device *devs[MAX_DEVICES];
+   struct pipe_resource tmpl;
+   struct pipe_surface surf_tmpl;
+   struct vertex verts[NUM_VERTS];
+   int ndev, i;
+
+   ndev = pipe_loader_probe(devs, MAX_DEVICES);
+   if (device >= MIN2(ndev, MAX_DEVICES)) {
+      fprintf(stderr, "device %d not found, %d available\n", device, ndev);
+      pipe_loader_release(devs, MIN2(ndev, MAX_DEVICES));
+      return FALSE;
+   }
+
+   ctx->dev = devs[device];
+   devs[device] = NULL;
+   for (i = 0; i < MIN2(ndev, MAX_DEVICES); i++) {
+      if (devs[i])
+         pipe_loader_release(&devs[i], 1);
+   }
+
+   ctx->screen = pipe_loader_create_screen(ctx->dev, PIPE_SEARCH_DIR);
+   if (!ctx->screen) {
+      fprintf(stderr, "failed to create a screen for %s\n",
+              ctx->dev->driver_name);
+      return FALSE;
+   }
+
+   ctx->pipe = ctx->screen->context_create(ctx->screen, NULL);
+   if (!ctx->pipe)
+      return FALSE;
+   ctx->cso = cso_create_context(ctx->pipe);
+   ctx->upload = u_upload_create(ctx->pipe, 64 * 1024, 16,
+                                 PIPE_BIND_VERTEX_BUFFER);
+
+   ctx->data = MALLOC(WIDTH * HEIGHT * 4);
+   if (!ctx->cso || !ctx->upload || !ctx->data)
+      return FALSE;
+   memset(ctx->data, 0x80, WIDTH * HEIGHT * 4);
+
+   /* render target and texture, B8G8R8A8 is supported everywhere */
+   memset(&tmpl, 0, sizeof(tmpl));
+   tmpl.target = PIPE_TEXTURE_2D;
+   tmpl.format = PIPE_FORMAT_B8G8R8A8_UNORM;
+   tmpl.width0 = WIDTH;
+   tmpl.height0 = HEIGHT;
+   tmpl.depth0 = 1;
+   tmpl.array_size = 1;
+   tmpl.bind = PIPE_BIND_RENDER_TARGET;
+   ctx->target = ctx->screen->resource_create(ctx->screen, &tmpl);
+
+   tmpl.bind = PIPE_BIND_SAMPLER_VIEW;
+   ctx->texture = ctx->screen->resource_create(ctx->screen, &tmpl);
+
+   if (!ctx->target || !ctx->texture)
+      return FALSE;
+
+   memset(&surf_tmpl, 0, sizeof(surf_tmpl));
+   surf_tmpl.format = PIPE_FORMAT_B8G8R8A8_UNORM;
+   memset(&ctx->framebuffer, 0, sizeof(ctx->framebuffer));
+   ctx->framebuffer.width = WIDTH;
+   ctx->framebuffer.height = HEIGHT;
+   ctx->framebuffer.nr_cbufs = 1;
+   ctx->framebuffer.cbufs[0] = ctx->pipe->create_surface(ctx->pipe,
+                                                         ctx->target,
+                                                         &surf_tmpl);
+
+   ctx->viewport.scale[0] = WIDTH / 2.0f;
+   ctx->viewport.scale[1] = HEIGHT / 2.0f;
+   ctx->viewport.scale[2] = 0.5f;
+   ctx->viewport.scale[3] = 1.0f;
+   ctx->viewport.translate[0] = WIDTH / 2.0f;
+   ctx->viewport.translate[1] = HEIGHT / 2.0f;
+   ctx->viewport.translate[2] = 0.5f;
+   ctx->viewport.translate[3] = 0.0f;
+
+   /* static vertex data */
+   set_vertex(&verts[SMALL_TRI_START + 0], 0.0f, 0.0f, 1.0f, 0.0f, 0.0f);
+   set_vertex(&verts[SMALL_TRI_START + 1], 0.01f, 0.0f, 0.0f, 1.0f, 0.0f);
+   set_vertex(&verts[SMALL_TRI_START + 2], 0.0f, 0.01f, 0.0f, 0.0f, 1.0f);
+   set_vertex(&verts[FULL_QUAD_START + 0], -1.0f, -1.0f, 1.0f, 0.0f, 0.0f);
+   set_vertex(&verts[FULL_QUAD_START + 1], 1.0f, -1.0f, 0.0f, 1.0f, 0.0f);
+   set_vertex(&verts[FULL_QUAD_START + 2], -1.0f, 1.0f, 0.0f, 0.0f, 1.0f);
+   set_vertex(&verts[FULL_QUAD_START + 3], 1.0f, 1.0f, 1.0f, 1.0f, 1.0f);
+   make_strip(&verts[STRIP_START], 0);
+
+   ctx->vbuf = pipe_buffer_create(ctx->screen, PIPE_BIND_VERTEX_BUFFER,
+                                  PIPE_USAGE_DEFAULT, sizeof(verts));
+   if (!ctx->vbuf)
+      return FALSE;
+   pipe_buffer_write(ctx->pipe, ctx->vbuf, 0, sizeof(verts), verts);
+
+   memset(ctx->velem, 0, sizeof(ctx->velem));
+   ctx->velem[0].src_offset = Offset(struct vertex, pos);
+   ctx->velem[0].src_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+   ctx->velem[1].src_offset = Offset(struct vertex, color);
+   ctx->velem[1].src_format = PIPE_FORMAT_R32G32B32A32_FLOAT;
+
+   /* two of each state, for the state change tests */
+   memset(ctx->blend, 0, sizeof(ctx->blend));
+   ctx->blend[0].rt[0].colormask = PIPE_MASK_RGBA;
+   ctx->blend[1].rt[0].colormask = PIPE_MASK_RGBA;
+   ctx->blend[1].rt[0].blend_enable = 1;
+   ctx->blend[1].rt[0].rgb_func = PIPE_BLEND_ADD;
+   ctx->blend[1].rt[0].rgb_src_factor = PIPE_BLENDFACTOR_SRC_ALPHA;
+   ctx->blend[1].rt[0].rgb_dst_factor = PIPE_BLENDFACTOR_INV_SRC_ALPHA;
+   ctx->blend[1].rt[0].alpha_func = PIPE_BLEND_ADD;
+   ctx->blend[1].rt[0].alpha_src_factor = PIPE_BLENDFACTOR_ONE;
+   ctx->blend[1].rt[0].alpha_dst_factor = PIPE_BLENDFACTOR_ZERO;
+
+   memset(&ctx->depthstencil, 0, sizeof(ctx->depthstencil));
+
+   memset(ctx->rasterizer, 0, sizeof(ctx->rasterizer));
+   for (i = 0; i < 2; i++) {
+      ctx->rasterizer[i].cull_face = PIPE_FACE_NONE;
+      ctx->rasterizer[i].half_pixel_center = 1;
+      ctx->rasterizer[i].bottom_edge_rule = 1;
+      ctx->rasterizer[i].depth_clip = 1;
+   }
+   ctx->rasterizer[1].flatshade = 1;
+
+   {
+      const uint semantic_names[] = { TGSI_SEMANTIC_POSITION,
+                                      TGSI_SEMANTIC_COLOR };
+      const uint semantic_indexes[] = { 0, 0 };
+      ctx->vs = util_make_vertex_passthrough_shader(ctx->pipe, 2,
+                                                    semantic_names,
+                                                    semantic_indexes);
+   }
+   ctx->fs[0] = util_make_fragment_passthrough_shader(ctx->pipe,
+                                                      TGSI_SEMANTIC_COLOR,
+                                                      TGSI_INTERPOLATE_PERSPECTIVE,
+                                                      TRUE);
+   ctx->fs[1] = create_color_fs(ctx, 0.5f);
+
+   return ctx->vs && ctx->fs[0] && ctx->fs[1];
+}
+
+
+static void
+destroy_context(struct perf_context *ctx)
+{
+   if (ctx->cso)
+      cso_release_all(ctx->cso);
+
+   if (ctx->pipe) {
+      if (ctx->vs)
+         ctx->pipe->delete_vs_state(ctx->pipe, ctx->vs);
+      if (ctx->fs[0])
+         ctx->pipe->delete_fs_state(ctx->pipe, ctx->fs[0]);
+      if (ctx->fs[1])
+         ctx->pipe->delete_fs_state(ctx->pipe, ctx->fs[1]);
+   }
+
+   pipe_surface_reference(&ctx->framebuffer.cbufs[0], NULL);
+   pipe_resource_reference(&ctx->target, NULL);
+   pipe_resource_reference(&ctx->texture, NULL);
+   pipe_resource_reference(&ctx->vbuf, NULL);
+
+   if (ctx->upload)
+      u_upload_destroy(ctx->upload);
+   if (ctx->cso)
+      cso_destroy_context(ctx->cso);
+   if (ctx->pipe)
+      ctx->pipe->destroy(ctx->pipe);
+   if (ctx->screen)
+      ctx->screen->destroy(ctx->screen);
+   if (ctx->dev)
+      pipe_loader_release(&ctx->dev, 1);
+
+   FREE(ctx->data);
+}
+
+
+static void
+set_vertex_buffer(struct perf_context *ctx,
+                  struct pipe_resource *buffer, unsigned offset)
+{
+   struct pipe_vertex_buffer vb;
+
+   vb.stride = sizeof(struct vertex);
+   vb.buffer_offset = offset;
+   vb.buffer = buffer;
+   vb.user_buffer = NULL;
+   cso_set_vertex_buffers(ctx->cso, 0, 1, &vb);
+}
+
+
+/**
+ * Bind the default state, with the static vertex buffer.
+ */
+static void
+bind_state(struct perf_context *ctx)
+{
+   cso_set_framebuffer(ctx->cso, &ctx->framebuffer);
+   cso_set_blend(ctx->cso, &ctx->blend[0]);
+   cso_set_depth_stencil_alpha(ctx->cso, &ctx->depthstencil);
+   cso_set_rasterizer(ctx->cso, &ctx->rasterizer[0]);
+   cso_set_viewport(ctx->cso, &ctx->viewport);
+   cso_set_vertex_shader_handle(ctx->cso, ctx->vs);
+   cso_set_fragment_shader_handle(ctx->cso, ctx->fs[0]);
+   cso_set_vertex_elements(ctx->cso, 2, ctx->velem);
+   set_vertex_buffer(ctx, ctx->vbuf, 0);
+}
+
+
+/** Many tiny draws: the fixed cost of a draw call */
+static double
+run_draw_small(struct perf_context *ctx, unsigned count)
+{
+   unsigned i;
+
+   bind_state(ctx);
+   for (i = 0; i < count; i++)
+      util_draw_arrays(ctx->pipe, PIPE_PRIM_TRIANGLES, SMALL_TRI_START, 3);
+
+   return count;
+}
+
+
+/** Tiny draws, switching blend and rasterizer state in between */
+static double
+run_state_change(struct perf_context *ctx, unsigned count)
+{
+   unsigned i;
+
+   bind_state(ctx);
+   for (i = 0; i < count; i++) {
+      cso_set_blend(ctx->cso, &ctx->blend[i & 1]);
+      cso_set_rasterizer(ctx->cso, &ctx->rasterizer[(i >> 1) & 1]);
+      util_draw_arrays(ctx->pipe, PIPE_PRIM_TRIANGLES, SMALL_TRI_START, 3);
+   }
+
+   return count;
+}
+
+
+/** Tiny draws, switching between two fragment shaders */
+static double
+run_shader_change(struct perf_context *ctx, unsigned count)
+{
+   unsigned i;
+
+   bind_state(ctx);
+   for (i = 0; i < count; i++) {
+      cso_set_fragment_shader_handle(ctx->cso, ctx->fs[i & 1]);
+      util_draw_arrays(ctx->pipe, PIPE_PRIM_TRIANGLES, SMALL_TRI_START, 3);
+   }
+
+   return count;
+}
+
+
+/**
+ * Small strips whose vertices are written for every draw, the way the vbo
+ * module streams glBegin/glEnd.
+ */
+static double
+run_immediate(struct perf_context *ctx, unsigned count)
+{
+   struct vertex verts[STRIP_VERTS];
+   unsigned i;
+
+   bind_state(ctx);
+   for (i = 0; i < count; i++) {
+      struct pipe_resource *buf = NULL;
+      unsigned offset;
+
+      make_strip(verts, i);
+      if (u_upload_data(ctx->upload, 0, sizeof(verts), verts,
+                        &offset, &buf) != PIPE_OK)
+         break;
+      u_upload_unmap(ctx->upload);
+
+      set_vertex_buffer(ctx, buf, offset);
+      util_draw_arrays(ctx->pipe, PIPE_PRIM_TRIANGLE_STRIP, 0, STRIP_VERTS);
+      pipe_resource_reference(&buf, NULL);
+   }
+
+   return (double) i * STRIP_VERTS;
+}
+
+
+/**
+ * The same strips drawn from a buffer written once, the way compiled
+ * display lists and static VBOs are.
+ */
+static double
+run_display_list(struct perf_context *ctx, unsigned count)
+{
+   unsigned i;
+
+   bind_state(ctx);
+   for (i = 0; i < count; i++) {
+      util_draw_arrays(ctx->pipe, PIPE_PRIM_TRIANGLE_STRIP,
+                       STRIP_START, STRIP_VERTS);
+   }
+
+   return (double) count * STRIP_VERTS;
+}
+
+
+static double
+run_tex_upload(struct perf_context *ctx, unsigned count)
+{
+   struct pipe_box box;
+   unsigned i;
+
+   u_box_2d(0, 0, WIDTH, HEIGHT, &box);
+   for (i = 0; i < count; i++) {
+      ctx->pipe->transfer_inline_write(ctx->pipe, ctx->texture, 0,
+                                       PIPE_TRANSFER_WRITE, &box,
+                                       ctx->data, WIDTH * 4, 0);
+   }
+
+   return (double) count * WIDTH * HEIGHT * 4;
+}
+
+
+/** Render and read the result back, like glReadPixels after a frame */
+static double
+run_readback(struct perf_context *ctx, unsigned count)
+{
+   union pipe_color_union color;
+   unsigned i, y;
+
+   color.f[0] = 0.2f;
+   color.f[1] = 0.4f;
+   color.f[2] = 0.6f;
+   color.f[3] = 1.0f;
+
+   bind_state(ctx);
+   for (i = 0; i < count; i++) {
+      struct pipe_transfer *transfer;
+      const uint8_t *map;
+
+      ctx->pipe->clear(ctx->pipe, PIPE_CLEAR_COLOR, &color, 0.0, 0);
+      util_draw_arrays(ctx->pipe, PIPE_PRIM_TRIANGLES, SMALL_TRI_START, 3);
+
+      map = pipe_transfer_map(ctx->pipe, ctx->target, 0, 0,
+                              PIPE_TRANSFER_READ, 0, 0, WIDTH, HEIGHT,
+                              &transfer);
+      if (!map)
+         break;
+      for (y = 0; y < HEIGHT; y++) {
+         memcpy((uint8_t *) ctx->data + y * WIDTH * 4,
+                map + y * transfer->stride, WIDTH * 4);
+      }
+      pipe_transfer_unmap(ctx->pipe, transfer);
+   }
+
+   return (double) i * WIDTH * HEIGHT * 4;
+}
+
+
+/**
+ * Create, bind and first use of new fragment shaders.  Drivers compile
+ * lazily, so each shader is drawn with and waited for.
+ */
+static double
+run_shader_compile(struct perf_context *ctx, unsigned count)
+{
+   unsigned i;
+
+   bind_state(ctx);
+   for (i = 0; i < count; i++) {
+      void *fs;
+
+      /* never the same tokens twice, so no cache can help */
+      fs = create_color_fs(ctx, ctx->shader_seed++ / 1024.0f);
+      if (!fs)
+         break;
+
+      cso_set_fragment_shader_handle(ctx->cso, fs);
+      util_draw_arrays(ctx->pipe, PIPE_PRIM_TRIANGLES, SMALL_TRI_START, 3);
+      finish(ctx);
+
+      cso_set_fragment_shader_handle(ctx->cso, ctx->fs[0]);
+      ctx->pipe->delete_fs_state(ctx->pipe, fs);
+   }
+
+   return i;
+}
+
+
+/** Full screen quads */
+static double
+run_fill(struct perf_context *ctx, unsigned count)
+{
+   unsigned i;
+
+   bind_state(ctx);
+   for (i = 0; i < count; i++)
+      util_draw_arrays(ctx->pipe, PIPE_PRIM_TRIANGLE_STRIP, FULL_QUAD_START, 4);
+
+   return (double) count * WIDTH * HEIGHT;
+}
+
+
+static const struct perf_test tests[] = {
+   { "draw-small",     "draws/s",   1.0,  FALSE, run_draw_small },
+   { "state-change",   "draws/s",   1.0,  FALSE, run_state_change },
+   { "shader-change",  "draws/s",   1.0,  FALSE, run_shader_change },
+   { "immediate",      "Mverts/s",  1e-6, FALSE, run_immediate },
+   { "display-list",   "Mverts/s",  1e-6, FALSE, run_display_list },
+   { "tex-upload",     "MB/s",      1e-6, FALSE, run_tex_upload },
+   { "readback",       "MB/s",      1e-6, FALSE, run_readback },
+   { "shader-compile", "ms/shader", 1e3,  TRUE,  run_shader_compile },
+   { "fill",           "Mpixels/s", 1e-6, FALSE, run_fill },
+};
+
+
+/**
+ * Run a test with twice as many iterations each time, until it takes at
+ * least min_time seconds, and return the result of the last run.
+ */
+static double
+run_test(struct perf_context *ctx, const struct perf_test *test,
+         double min_time)
+{
+   unsigned count = 1;
+   double work, secs;
+
+   for (;;) {
+      int64_t start = os_time_get();
+
+      work = test->run(ctx, count);
+      finish(ctx);
+      secs = (os_time_get() - start) / 1e6;
+
+      if (secs >= min_time || count >= (1u << 30))
+         break;
+
+      count *= 2;
+   }
+
+   if (work <= 0.0 || secs <= 0.0)
+      return 0.0;
+
+   return test->time_per_work ? secs * test->scale / work
+                              : work * test->scale / secs;
+}
+
+
+static void
+usage(const char *prog)
+{
+   printf("Usage: %s [-d device] [-s seconds] [-j] [-l] [test...]\n"
+          "  -d device   index of the pipe-loader device to use (0)\n"
+          "  -s seconds  minimum duration of each test (0.5)\n"
+          "  -j          print the results as JSON\n"
+          "  -l          list the tests\n",
+          prog);
+}
+
+
+int
+main(int argc, char **argv)
+{
+   struct perf_context ctx;
+   boolean selected[Elements(tests)];
+   boolean any_selected = FALSE;
+   boolean json = FALSE;
+   double min_time = 0.5;
+   int device = 0;
+   unsigned i, n;
+   int arg;
+
+   memset(selected, 0, sizeof(selected));
+
+   for (arg = 1; arg < argc; arg++) {
+      if (strcmp(argv[arg], "-d") == 0 && arg + 1 < argc) {
+         device = atoi(argv[++arg]);
+      }
+      else if (strcmp(argv[arg], "-s") == 0 && arg + 1 < argc) {
+         min_time = atof(argv[++arg]);
+      }
+      else if (strcmp(argv[arg], "-j") == 0) {
+         json = TRUE;
+      }
+      else if (strcmp(argv[arg], "-l") == 0) {
+         for (i = 0; i < Elements(tests); i++)
+            printf("%s (%s)\n", tests[i].name, tests[i].unit);
+         return 0;
+      }
+      else if (argv[arg][0] != '-') {
+         for (i = 0; i < Elements(tests); i++) {
+            if (strcmp(argv[arg], tests[i].name) == 0)
+               break;
+         }
+         if (i == Elements(tests)) {
+            fprintf(stderr, "unknown test %s\n", argv[arg]);
+            return 1;
+         }
+         selected[i] = TRUE;
+         any_selected = TRUE;
+      }
+      else {
+         usage(argv[0]);
+         return 1;
+      }
+   }
+
+   memset(&ctx, 0, sizeof(ctx));
+   if (!init_context(&ctx, device)) {
+      destroy_context(&ctx);
+      return 1;
+   }
+
+   if (json) {
+      printf("{\n"
+             "  \"driver\": \"%s\",\n"
+             "  \"screen\": \"%s\",\n"
+             "  \"results\": [\n",
+             ctx.dev->driver_name, ctx.screen->get_name(ctx.screen));
+   }
+   else {
+      printf("%s (%s)\n", ctx.screen->get_name(ctx.screen),
+             ctx.dev->driver_name);
+   }
+
+   for (i = 0, n = 0; i < Elements(tests); i++) {
+      double value;
+
+      if (any_selected && !selected[i])
+         continue;
+
+      value = run_test(&ctx, &tests[i], min_time);
+
+      if (json) {
+         printf("%s    { \"test\": \"%s\", \"value\": %.3f, \"unit\": \"%s\" }",
+                n ? ",\n" : "", tests[i].name, value, tests[i].unit);
+      }
+      else {
+         printf("%-16s %14.3f %s\n", tests[i].name, value, tests[i].unit);
+      }
+      fflush(stdout);
+      n++;
+   }
+
+   if (json)
+      printf("\n  ]\n}\n");
+
+   destroy_context(&ctx);
+
+   return 0;
+}
@@ -0,0 +1,122 @@
+/**************************************************************************
+ *
+ * Copyright 2014 The Mesa Authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+
+/*
+ * Test case for util_queue.
+ *
+ * Queues jobs of all priorities, some pinned to a thread, and checks that
+ * each job ran exactly once, on the right thread, and signalled its fence.
+ */
+
+
+#include <stdio.h>
+
+#include "util/u_queue.h"
+#include "util/u_atomic.h"
+
+
+#define NUM_THREADS 4
+#define NUM_JOBS 256
+
+
+struct test_job {
+   int index;
+   int thread_index;     /* required thread or UTIL_QUEUE_ANY_THREAD */
+   int executed;
+   int ran_on;
+};
+
+static struct test_job jobs[NUM_JOBS];
+static struct util_queue_fence fences[NUM_JOBS];
+
+
+static void
+execute_job(void *data, int thread_index)
+{
+   struct test_job *job = data;
+
+   p_atomic_inc(&job->executed);
+   job->ran_on = thread_index;
+}
+
+
+int main()
+{
+   struct util_queue queue;
+   struct util_queue_stats stats;
+   int i, failures = 0;
+
+   printf("u_queue_test starting\n");
+
+   /* fewer slots than jobs, so util_queue_add_job has to wait */
+   if (!util_queue_init(&queue, "test", 16, NUM_THREADS)) {
+      printf("util_queue_init failed\n");
+      return 1;
+   }
+
+   for (i = 0; i < NUM_JOBS; i++) {
+      jobs[i].index = i;
+      jobs[i].thread_index = i % 5 == 0 ? i % NUM_THREADS
+                                        : UTIL_QUEUE_ANY_THREAD;
+
+      util_queue_fence_init(&fences[i]);
+      util_queue_add_job(&queue, &jobs[i], &fences[i], execute_job,
+                         i % UTIL_QUEUE_NUM_PRIORITIES,
+                         jobs[i].thread_index);
+   }
+
+   for (i = 0; i < NUM_JOBS; i++) {
+      util_queue_fence_wait(&fences[i]);
+
+      if (jobs[i].executed != 1) {
+         printf("job %d executed %d times\n", i, jobs[i].executed);
+         failures++;
+      }
+      if (jobs[i].thread_index != UTIL_QUEUE_ANY_THREAD &&
+          jobs[i].ran_on != jobs[i].thread_index) {
+         printf("job %d ran on thread %d instead of %d\n",
+                i, jobs[i].ran_on, jobs[i].thread_index);
+         failures++;
+      }
+
+      util_queue_fence_destroy(&fences[i]);
+   }
+
+   util_queue_get_stats("test", &stats);
+   if (stats.num_queued != 0 || stats.num_started != NUM_JOBS) {
+      printf("wrong stats: %u queued, %llu started\n", stats.num_queued,
+             (unsigned long long) stats.num_started);
+      failures++;
+   }
+
+   util_queue_destroy(&queue);
+
+   printf("u_queue_test %s\n", failures ? "failed" : "passed");
+
+   return failures ? 1 : 0;
+}
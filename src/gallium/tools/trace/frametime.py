@@ -0,0 +1,164 @@
+#!/usr/bin/env python
+##########################################################################
+#
+# Copyright 2014 VMware, Inc.
+# All Rights Reserved.
+#
+# Permission is hereby granted, free of charge, to any person obtaining a
+# copy of this software and associated documentation files (the
+# "Software"), to deal in the Software without restriction, including
+# without limitation the rights to use, copy, modify, merge, publish,
+# distribute, sub license, and/or sell copies of the Software, and to
+# permit persons to whom the Software is furnished to do so, subject to
+# the following conditions:
+#
+# The above copyright notice and this permission notice (including the
+# next paragraph) shall be included in all copies or substantial portions
+# of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+# OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+# MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+# IN NO EVENT SHALL VMWARE AND/OR ITS SUPPLIERS BE LIABLE FOR
+# ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+# TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+# SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#
+##########################################################################
+
+
+'''Report the driver time recorded in traces, per frame and per call.'''
+
+
+import sys
+import optparse
+
+import parse as parser
+
+
+class Profile:
+    '''Time spent in the driver, in microseconds.'''
+
+    def __init__(self):
+        self.frames = []
+        self.methods = {}
+        self.frame_time = 0
+        self.frame_calls = 0
+
+    def add_call(self, name, time):
+        self.frame_time += time
+        self.frame_calls += 1
+        try:
+            calls, total = self.methods[name]
+        except KeyError:
+            calls, total = 0, 0
+        self.methods[name] = calls + 1, total + time
+
+    def end_frame(self):
+        if self.frame_calls:
+            self.frames.append((self.frame_calls, self.frame_time))
+        self.frame_time = 0
+        self.frame_calls = 0
+
+    def total_time(self):
+        return sum([total for calls, total in self.methods.itervalues()])
+
+
+class Profiler(parser.TraceParser):
+
+    def __init__(self, fp, profile, frame_method):
+        parser.TraceParser.__init__(self, fp)
+        self.profile = profile
+        self.frame_method = frame_method
+
+    def handle_call(self, call):
+        if call.time is not None:
+            self.profile.add_call(call.klass + '::' + call.method,
+                                  call.time.value)
+        if call.method == self.frame_method:
+            self.profile.end_frame()
+
+
+class Main(parser.Main):
+
+    def get_optparser(self):
+        optparser = parser.Main.get_optparser(self)
+        optparser.add_option("-f", "--frame-method",
+                             action="store", type="string",
+                             dest="frame_method", default="flush_frontbuffer",
+                             help="method ending each frame [default: %default]")
+        optparser.add_option("-n", "--top",
+                             action="store", type="int",
+                             dest="top", default=20,
+                             help="number of methods to list [default: %default]")
+        optparser.add_option("-v", "--verbose",
+                             action="store_true",
+                             dest="verbose", default=False,
+                             help="list the time of every frame")
+        return optparser
+
+    def main(self):
+        self.profiles = []
+        parser.Main.main(self)
+
+        if len(self.profiles) > 1:
+            self.compare(self.profiles[0], self.profiles[1:])
+
+    def process_arg(self, stream, options):
+        profile = Profile()
+        profiler = Profiler(stream, profile, options.frame_method)
+        profiler.parse()
+        profile.end_frame()
+
+        self.report(profile, options)
+        self.profiles.append(profile)
+
+    def report(self, profile, options):
+        total = profile.total_time()
+        frames = profile.frames
+
+        if options.verbose:
+            for no, (calls, time) in enumerate(frames):
+                sys.stdout.write('frame %u: %u calls, %.3f ms\n' %
+                                 (no, calls, time / 1000.0))
+            sys.stdout.write('\n')
+
+        if frames:
+            times = [time for calls, time in frames]
+            sys.stdout.write('%u frames, %.3f ms/frame average, '
+                             '%.3f min, %.3f max\n' %
+                             (len(frames),
+                              total / 1000.0 / len(frames),
+                              min(times) / 1000.0,
+                              max(times) / 1000.0))
+        sys.stdout.write('%.3f ms total\n\n' % (total / 1000.0))
+
+        methods = profile.methods.items()
+        methods.sort(key=lambda item: item[1][1], reverse=True)
+        sys.stdout.write('%10s %12s %6s  %s\n' % ('calls', 'ms', '%', 'method'))
+        for name, (calls, time) in methods[:options.top]:
+            percent = total and 100.0 * time / total
+            sys.stdout.write('%10u %12.3f %6.2f  %s\n' %
+                             (calls, time / 1000.0, percent, name))
+        sys.stdout.write('\n')
+
+    def compare(self, reference, profiles):
+        '''Compare the average frame time of each trace to the first one.'''
+
+        def frame_time(profile):
+            if profile.frames:
+                return profile.total_time() / 1000.0 / len(profile.frames)
+            return profile.total_time() / 1000.0
+
+        ref = frame_time(reference)
+        for no, profile in enumerate(profiles):
+            time = frame_time(profile)
+            if ref:
+                sys.stdout.write('trace %u: %.3f ms/frame, %+.1f%% vs trace 0\n' %
+                                 (no + 1, time, 100.0 * (time - ref) / ref))
+            else:
+                sys.stdout.write('trace %u: %.3f ms/frame\n' % (no + 1, time))
+
+
+if __name__ == '__main__':
+    Main().main()
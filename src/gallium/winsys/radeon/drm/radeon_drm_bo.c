@@ -31,6 +31,7 @@
 #include "util/u_memory.h"
 #include "util/u_simple_list.h"
 #include "util/u_double_list.h"
+#include "util/u_trace_events.h"
 #include "os/os_thread.h"
 #include "os/os_mman.h"
 #include "os/os_time.h"
@@ -156,6 +157,8 @@ static void radeon_bo_wait(struct pb_buffer *_buf, enum radeon_bo_usage usage)
 {
     struct radeon_bo *bo = get_radeon_bo(_buf);
 
+    util_trace_event_begin("radeon_bo_wait");
+
     while (p_atomic_read(&bo->num_active_ioctls)) {
         sched_yield();
     }
@@ -174,6 +177,8 @@ static void radeon_bo_wait(struct pb_buffer *_buf, enum radeon_bo_usage usage)
         while (drmCommandWrite(bo->rws->fd, DRM_RADEON_GEM_WAIT_IDLE,
                                    &args, sizeof(args)) == -EBUSY);
     }
+
+    util_trace_event_end("radeon_bo_wait");
 }
 
 static boolean radeon_bo_is_busy(struct pb_buffer *_buf,
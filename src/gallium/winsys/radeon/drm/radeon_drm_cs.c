@@ -65,6 +65,7 @@
 #include "radeon_drm_cs.h"
 
 #include "util/u_memory.h"
+#include "util/u_trace_events.h"
 #include "os/os_time.h"
 
 #include <stdio.h>
@@ -111,9 +112,10 @@
 #define RELOC_DWORDS (sizeof(struct drm_radeon_cs_reloc) / sizeof(uint32_t))
 
 static boolean radeon_init_cs_context(struct radeon_cs_context *csc,
-                                      struct radeon_drm_winsys *ws)
+                                      struct radeon_drm_cs *cs)
 {
-    csc->fd = ws->fd;
+    csc->owner = cs;
+    csc->fd = cs->ws->fd;
     csc->nrelocs = 512;
     csc->relocs_bo = (struct radeon_bo**)
                      CALLOC(1, csc->nrelocs * sizeof(struct radeon_bo*));
@@ -178,29 +180,31 @@ static struct radeon_winsys_cs *radeon_drm_cs_create(struct radeon_winsys *rws,
 {
     struct radeon_drm_winsys *ws = radeon_drm_winsys(rws);
     struct radeon_drm_cs *cs;
+    unsigned i;
 
     cs = CALLOC_STRUCT(radeon_drm_cs);
     if (!cs) {
         return NULL;
     }
-    pipe_semaphore_init(&cs->flush_completed, 1);
 
     cs->ws = ws;
     cs->trace_buf = (struct radeon_bo*)trace_buf;
 
-    if (!radeon_init_cs_context(&cs->csc1, cs->ws)) {
-        FREE(cs);
-        return NULL;
-    }
-    if (!radeon_init_cs_context(&cs->csc2, cs->ws)) {
-        radeon_destroy_cs_context(&cs->csc1);
-        FREE(cs);
-        return NULL;
+    for (i = 0; i < RADEON_CS_NUM_CONTEXTS; i++) {
+        if (!radeon_init_cs_context(&cs->csc_array[i], cs)) {
+            while (i--)
+                radeon_destroy_cs_context(&cs->csc_array[i]);
+            FREE(cs);
+            return NULL;
+        }
     }
 
+    pipe_mutex_init(cs->flush_lock);
+    pipe_condvar_init(cs->flush_completed);
+
     /* Set the first command buffer as current. */
-    cs->csc = &cs->csc1;
-    cs->cst = &cs->csc2;
+    cs->csc = &cs->csc_array[0];
+    cs->csc_index = 0;
     cs->base.buf = cs->csc->buf;
     cs->base.ring_type = ring_type;
 
@@ -425,6 +429,8 @@ void radeon_drm_cs_emit_ioctl_oneshot(struct radeon_drm_cs *cs, struct radeon_cs
 {
     unsigned i;
 
+    util_trace_event_begin("radeon cs ioctl");
+
     if (drmCommandWriteRead(csc->fd, DRM_RADEON_CS,
                             &csc->cs, sizeof(struct drm_radeon_cs))) {
         if (debug_get_bool_option("RADEON_DUMP_CS", FALSE)) {
@@ -448,6 +454,8 @@ void radeon_drm_cs_emit_ioctl_oneshot(struct radeon_drm_cs *cs, struct radeon_cs
         p_atomic_dec(&csc->relocs_bo[i]->num_active_ioctls);
 
     radeon_cs_context_cleanup(csc);
+
+    util_trace_event_end("radeon cs ioctl");
 }
 
 /*
@@ -457,10 +465,12 @@ void radeon_drm_cs_sync_flush(struct radeon_winsys_cs *rcs)
 {
     struct radeon_drm_cs *cs = radeon_drm_cs(rcs);
 
-    /* Wait for any pending ioctl to complete. */
+    /* Wait for all pending ioctls to complete. */
     if (cs->ws->thread) {
-        pipe_semaphore_wait(&cs->flush_completed);
-        pipe_semaphore_signal(&cs->flush_completed);
+        pipe_mutex_lock(cs->flush_lock);
+        while (cs->num_pending_flushes)
+            pipe_condvar_wait(cs->flush_completed, cs->flush_lock);
+        pipe_mutex_unlock(cs->flush_lock);
     }
 }
 
@@ -469,7 +479,7 @@ DEBUG_GET_ONCE_BOOL_OPTION(noop, "RADEON_NOOP", FALSE)
 static void radeon_drm_cs_flush(struct radeon_winsys_cs *rcs, unsigned flags, uint32_t cs_trace_id)
 {
     struct radeon_drm_cs *cs = radeon_drm_cs(rcs);
-    struct radeon_cs_context *tmp;
+    struct radeon_cs_context *cst;
 
     switch (cs->base.ring_type) {
     case RING_DMA:
@@ -506,82 +516,93 @@ static void radeon_drm_cs_flush(struct radeon_winsys_cs *rcs, unsigned flags, ui
        fprintf(stderr, "radeon: command stream overflowed\n");
     }
 
-    radeon_drm_cs_sync_flush(rcs);
-
-    /* Flip command streams. */
-    tmp = cs->csc;
-    cs->csc = cs->cst;
-    cs->cst = tmp;
+    /* Switch to the next command buffer.  The submission thread consumes
+     * them in order, so this one is free unless all the others are
+     * pending. */
+    cst = cs->csc;
+    cs->csc_index = (cs->csc_index + 1) % RADEON_CS_NUM_CONTEXTS;
+    cs->csc = &cs->csc_array[cs->csc_index];
 
-    cs->cst->cs_trace_id = cs_trace_id;
+    cst->cs_trace_id = cs_trace_id;
 
     /* If the CS is not empty or overflowed, emit it in a separate thread. */
     if (cs->base.cdw && cs->base.cdw <= RADEON_MAX_CMDBUF_DWORDS && !debug_get_option_noop()) {
-        unsigned i, crelocs = cs->cst->crelocs;
+        unsigned i, crelocs = cst->crelocs;
 
-        cs->cst->chunks[0].length_dw = cs->base.cdw;
+        cst->chunks[0].length_dw = cs->base.cdw;
 
         for (i = 0; i < crelocs; i++) {
             /* Update the number of active asynchronous CS ioctls for the buffer. */
-            p_atomic_inc(&cs->cst->relocs_bo[i]->num_active_ioctls);
+            p_atomic_inc(&cst->relocs_bo[i]->num_active_ioctls);
         }
 
         switch (cs->base.ring_type) {
         case RING_DMA:
-            cs->cst->flags[0] = 0;
-            cs->cst->flags[1] = RADEON_CS_RING_DMA;
-            cs->cst->cs.num_chunks = 3;
+            cst->flags[0] = 0;
+            cst->flags[1] = RADEON_CS_RING_DMA;
+            cst->cs.num_chunks = 3;
             if (cs->ws->info.r600_virtual_address) {
-                cs->cst->flags[0] |= RADEON_CS_USE_VM;
+                cst->flags[0] |= RADEON_CS_USE_VM;
             }
             break;
 
         case RING_UVD:
-            cs->cst->flags[0] = 0;
-            cs->cst->flags[1] = RADEON_CS_RING_UVD;
-            cs->cst->cs.num_chunks = 3;
+            cst->flags[0] = 0;
+            cst->flags[1] = RADEON_CS_RING_UVD;
+            cst->cs.num_chunks = 3;
             break;
 
         case RING_VCE:
-            cs->cst->flags[0] = 0;
-            cs->cst->flags[1] = RADEON_CS_RING_VCE;
-            cs->cst->cs.num_chunks = 3;
+            cst->flags[0] = 0;
+            cst->flags[1] = RADEON_CS_RING_VCE;
+            cst->cs.num_chunks = 3;
             break;
 
         default:
         case RING_GFX:
-            cs->cst->flags[0] = 0;
-            cs->cst->flags[1] = RADEON_CS_RING_GFX;
-            cs->cst->cs.num_chunks = 2;
+            cst->flags[0] = 0;
+            cst->flags[1] = RADEON_CS_RING_GFX;
+            cst->cs.num_chunks = 2;
             if (flags & RADEON_FLUSH_KEEP_TILING_FLAGS) {
-                cs->cst->flags[0] |= RADEON_CS_KEEP_TILING_FLAGS;
-                cs->cst->cs.num_chunks = 3;
+                cst->flags[0] |= RADEON_CS_KEEP_TILING_FLAGS;
+                cst->cs.num_chunks = 3;
             }
             if (cs->ws->info.r600_virtual_address) {
-                cs->cst->flags[0] |= RADEON_CS_USE_VM;
-                cs->cst->cs.num_chunks = 3;
+                cst->flags[0] |= RADEON_CS_USE_VM;
+                cst->cs.num_chunks = 3;
             }
             if (flags & RADEON_FLUSH_END_OF_FRAME) {
-                cs->cst->flags[0] |= RADEON_CS_END_OF_FRAME;
-                cs->cst->cs.num_chunks = 3;
+                cst->flags[0] |= RADEON_CS_END_OF_FRAME;
+                cst->cs.num_chunks = 3;
             }
             if (flags & RADEON_FLUSH_COMPUTE) {
-                cs->cst->flags[1] = RADEON_CS_RING_COMPUTE;
-                cs->cst->cs.num_chunks = 3;
+                cst->flags[1] = RADEON_CS_RING_COMPUTE;
+                cst->cs.num_chunks = 3;
             }
             break;
         }
 
         if (cs->ws->thread) {
-            pipe_semaphore_wait(&cs->flush_completed);
-            radeon_drm_ws_queue_cs(cs->ws, cs);
+            pipe_mutex_lock(cs->flush_lock);
+            cs->num_pending_flushes++;
+            pipe_mutex_unlock(cs->flush_lock);
+
+            radeon_drm_ws_queue_cs(cs->ws, cst);
             if (!(flags & RADEON_FLUSH_ASYNC))
                 radeon_drm_cs_sync_flush(rcs);
         } else {
-            radeon_drm_cs_emit_ioctl_oneshot(cs, cs->cst);
+            radeon_drm_cs_emit_ioctl_oneshot(cs, cst);
         }
     } else {
-        radeon_cs_context_cleanup(cs->cst);
+        radeon_cs_context_cleanup(cst);
+    }
+
+    /* Wait until the new command buffer has been submitted. */
+    if (cs->ws->thread) {
+        pipe_mutex_lock(cs->flush_lock);
+        while (cs->num_pending_flushes >= RADEON_CS_NUM_CONTEXTS)
+            pipe_condvar_wait(cs->flush_completed, cs->flush_lock);
+        pipe_mutex_unlock(cs->flush_lock);
     }
 
     /* Prepare a new CS. */
@@ -593,13 +614,16 @@ static void radeon_drm_cs_destroy(struct radeon_winsys_cs *rcs)
 {
     struct radeon_drm_cs *cs = radeon_drm_cs(rcs);
 
+    unsigned i;
+
     radeon_drm_cs_sync_flush(rcs);
-    pipe_semaphore_destroy(&cs->flush_completed);
-    radeon_cs_context_cleanup(&cs->csc1);
-    radeon_cs_context_cleanup(&cs->csc2);
+    pipe_condvar_destroy(cs->flush_completed);
+    pipe_mutex_destroy(cs->flush_lock);
+    for (i = 0; i < RADEON_CS_NUM_CONTEXTS; i++)
+        radeon_cs_context_cleanup(&cs->csc_array[i]);
     p_atomic_dec(&cs->ws->num_cs);
-    radeon_destroy_cs_context(&cs->csc1);
-    radeon_destroy_cs_context(&cs->csc2);
+    for (i = 0; i < RADEON_CS_NUM_CONTEXTS; i++)
+        radeon_destroy_cs_context(&cs->csc_array[i]);
     FREE(cs);
 }
 
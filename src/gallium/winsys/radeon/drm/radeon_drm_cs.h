@@ -30,9 +30,16 @@
 #include "radeon_drm_bo.h"
 #include <radeon_drm.h>
 
+/* The number of command buffers per CS.  One is filled by the pipe driver,
+ * the others may wait in the submission queue or be consumed by the kernel. */
+#define RADEON_CS_NUM_CONTEXTS 4
+
+struct radeon_drm_cs;
+
 struct radeon_cs_context {
     uint32_t                    buf[RADEON_MAX_CMDBUF_DWORDS];
 
+    struct radeon_drm_cs        *owner; /* The CS this buffer belongs to. */
     int                         fd;
     struct drm_radeon_cs        cs;
     struct drm_radeon_cs_chunk  chunks[3];
@@ -59,15 +66,13 @@ struct radeon_cs_context {
 struct radeon_drm_cs {
     struct radeon_winsys_cs base;
 
-    /* We flip between these two CS. While one is being consumed
-     * by the kernel in another thread, the other one is being filled
-     * by the pipe driver. */
-    struct radeon_cs_context csc1;
-    struct radeon_cs_context csc2;
+    /* We cycle through these command buffers. While the older ones are
+     * queued for submission or consumed by the kernel in another thread,
+     * the current one is being filled by the pipe driver. */
+    struct radeon_cs_context csc_array[RADEON_CS_NUM_CONTEXTS];
     /* The currently-used CS. */
     struct radeon_cs_context *csc;
-    /* The CS being currently-owned by the other thread. */
-    struct radeon_cs_context *cst;
+    unsigned csc_index;
 
     /* The winsys. */
     struct radeon_drm_winsys *ws;
@@ -76,7 +81,10 @@ struct radeon_drm_cs {
     void (*flush_cs)(void *ctx, unsigned flags);
     void *flush_data;
 
-    pipe_semaphore flush_completed;
+    /* The number of command buffers owned by the submission thread. */
+    pipe_mutex flush_lock;
+    pipe_condvar flush_completed;
+    unsigned num_pending_flushes;
     struct radeon_bo                    *trace_buf;
 };
 
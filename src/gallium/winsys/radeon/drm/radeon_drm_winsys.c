@@ -567,24 +567,33 @@ static int compare_fd(void *key1, void *key2)
            stat1.st_rdev != stat2.st_rdev;
 }
 
-void radeon_drm_ws_queue_cs(struct radeon_drm_winsys *ws, struct radeon_drm_cs *cs)
+void radeon_drm_ws_queue_cs(struct radeon_drm_winsys *ws, struct radeon_cs_context *csc)
 {
 retry:
     pipe_mutex_lock(ws->cs_stack_lock);
-    if (ws->ncs >= RING_LAST) {
+    if (ws->ncs >= RADEON_MAX_QUEUED_CS) {
         /* no room left for a flush */
         pipe_mutex_unlock(ws->cs_stack_lock);
         goto retry;
     }
-    ws->cs_stack[ws->ncs++] = cs;
+    ws->cs_stack[(ws->cs_stack_head + ws->ncs++) % RADEON_MAX_QUEUED_CS] = csc;
     pipe_mutex_unlock(ws->cs_stack_lock);
     pipe_semaphore_signal(&ws->cs_queued);
 }
 
+/* Give a command buffer back to its CS. */
+static void radeon_drm_cs_flush_done(struct radeon_drm_cs *cs)
+{
+    pipe_mutex_lock(cs->flush_lock);
+    cs->num_pending_flushes--;
+    pipe_condvar_broadcast(cs->flush_completed);
+    pipe_mutex_unlock(cs->flush_lock);
+}
+
 static PIPE_THREAD_ROUTINE(radeon_drm_cs_emit_ioctl, param)
 {
     struct radeon_drm_winsys *ws = (struct radeon_drm_winsys *)param;
-    struct radeon_drm_cs *cs;
+    struct radeon_cs_context *csc;
     unsigned i;
 
     while (1) {
@@ -593,21 +602,23 @@ static PIPE_THREAD_ROUTINE(radeon_drm_cs_emit_ioctl, param)
             break;
 
         pipe_mutex_lock(ws->cs_stack_lock);
-        cs = ws->cs_stack[0];
-        for (i = 1; i < ws->ncs; i++)
-            ws->cs_stack[i - 1] = ws->cs_stack[i];
-        ws->cs_stack[--ws->ncs] = NULL;
+        csc = ws->cs_stack[ws->cs_stack_head];
+        ws->cs_stack[ws->cs_stack_head] = NULL;
+        ws->cs_stack_head = (ws->cs_stack_head + 1) % RADEON_MAX_QUEUED_CS;
+        ws->ncs--;
         pipe_mutex_unlock(ws->cs_stack_lock);
 
-        if (cs) {
-            radeon_drm_cs_emit_ioctl_oneshot(cs, cs->cst);
-            pipe_semaphore_signal(&cs->flush_completed);
+        if (csc) {
+            radeon_drm_cs_emit_ioctl_oneshot(csc->owner, csc);
+            radeon_drm_cs_flush_done(csc->owner);
         }
     }
     pipe_mutex_lock(ws->cs_stack_lock);
     for (i = 0; i < ws->ncs; i++) {
-        pipe_semaphore_signal(&ws->cs_stack[i]->flush_completed);
-        ws->cs_stack[i] = NULL;
+        unsigned index = (ws->cs_stack_head + i) % RADEON_MAX_QUEUED_CS;
+
+        radeon_drm_cs_flush_done(ws->cs_stack[index]->owner);
+        ws->cs_stack[index] = NULL;
     }
     ws->ncs = 0;
     pipe_mutex_unlock(ws->cs_stack_lock);
@@ -645,7 +656,9 @@ PUBLIC struct radeon_winsys *radeon_drm_winsys_create(int fd)
     ws->kman = radeon_bomgr_create(ws);
     if (!ws->kman)
         goto fail;
-    ws->cman = pb_cache_manager_create(ws->kman, 1000000);
+    ws->cman = pb_cache_manager_create(ws->kman, 1000000,
+                                       MIN2(ws->info.vram_size,
+                                            ws->info.gart_size));
     if (!ws->cman)
         goto fail;
 
@@ -674,6 +687,7 @@ PUBLIC struct radeon_winsys *radeon_drm_winsys_create(int fd)
     pipe_mutex_init(ws->cs_stack_lock);
 
     ws->ncs = 0;
+    ws->cs_stack_head = 0;
     pipe_semaphore_init(&ws->cs_queued, 0);
     if (ws->num_cpus > 1 && debug_get_option_thread())
         ws->thread = pipe_thread_create(radeon_drm_cs_emit_ioctl, ws);
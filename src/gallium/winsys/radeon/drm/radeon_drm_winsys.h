@@ -41,6 +41,11 @@ enum radeon_generation {
     DRV_SI
 };
 
+/* The size of the submission queue, shared by all CS. */
+#define RADEON_MAX_QUEUED_CS 64
+
+struct radeon_cs_context;
+
 struct radeon_drm_winsys {
     struct radeon_winsys base;
 
@@ -70,7 +75,8 @@ struct radeon_drm_winsys {
     pipe_thread thread;
     int kill_thread;
     int ncs;
-    struct radeon_drm_cs *cs_stack[RING_LAST];
+    unsigned cs_stack_head; /* The oldest queued command buffer. */
+    struct radeon_cs_context *cs_stack[RADEON_MAX_QUEUED_CS];
 };
 
 static INLINE struct radeon_drm_winsys *
@@ -79,6 +85,6 @@ radeon_drm_winsys(struct radeon_winsys *base)
     return (struct radeon_drm_winsys*)base;
 }
 
-void radeon_drm_ws_queue_cs(struct radeon_drm_winsys *ws, struct radeon_drm_cs *cs);
+void radeon_drm_ws_queue_cs(struct radeon_drm_winsys *ws, struct radeon_cs_context *csc);
 
 #endif
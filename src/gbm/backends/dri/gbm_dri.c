@@ -359,6 +359,82 @@ gbm_dri_bo_write(struct gbm_bo *_bo, const void *buf, size_t count)
    return 0;
 }
 
+static uint64_t
+bo_cache_entry_size(struct gbm_dri_bo *bo)
+{
+   return (uint64_t) bo->base.base.stride * bo->base.base.height;
+}
+
+static void
+bo_cache_release(struct gbm_dri_bo *bo)
+{
+   struct gbm_dri_device *dri = gbm_dri_device(bo->base.base.gbm);
+
+   dri->image->destroyImage(bo->image);
+   free(bo);
+}
+
+/* Frees the oldest cached buffers until the cache fits in max_size. */
+static void
+bo_cache_trim(struct gbm_dri_device *dri, uint64_t max_size)
+{
+   struct gbm_dri_bo **link, *bo;
+
+   while (dri->bo_cache && dri->bo_cache_size > max_size) {
+      link = &dri->bo_cache;
+      while ((*link)->next_cached)
+         link = &(*link)->next_cached;
+
+      bo = *link;
+      *link = NULL;
+      dri->bo_cache_size -= bo_cache_entry_size(bo);
+      bo_cache_release(bo);
+   }
+}
+
+static struct gbm_dri_bo *
+bo_cache_lookup(struct gbm_dri_device *dri,
+                uint32_t width, uint32_t height,
+                uint32_t format, uint32_t usage)
+{
+   struct gbm_dri_bo **link, *bo;
+
+   for (link = &dri->bo_cache; *link; link = &(*link)->next_cached) {
+      bo = *link;
+      if (bo->base.base.width == width &&
+          bo->base.base.height == height &&
+          bo->base.base.format == format &&
+          bo->usage == usage) {
+         *link = bo->next_cached;
+         bo->next_cached = NULL;
+         dri->bo_cache_size -= bo_cache_entry_size(bo);
+         return bo;
+      }
+   }
+
+   return NULL;
+}
+
+static int
+bo_cache_put(struct gbm_dri_device *dri, struct gbm_dri_bo *bo)
+{
+   uint64_t size = bo_cache_entry_size(bo);
+
+   if (!bo->cacheable || size > dri->bo_cache_max_size)
+      return 0;
+
+   bo->base.base.user_data = NULL;
+   bo->base.base.destroy_user_data = NULL;
+
+   bo->next_cached = dri->bo_cache;
+   dri->bo_cache = bo;
+   dri->bo_cache_size += size;
+
+   bo_cache_trim(dri, dri->bo_cache_max_size);
+
+   return 1;
+}
+
 static void
 gbm_dri_bo_destroy(struct gbm_bo *_bo)
 {
@@ -366,6 +442,9 @@ gbm_dri_bo_destroy(struct gbm_bo *_bo)
    struct gbm_dri_bo *bo = gbm_dri_bo(_bo);
    struct drm_mode_destroy_dumb arg;
 
+   if (bo_cache_put(dri, bo))
+      return;
+
    if (bo->image != NULL) {
       dri->image->destroyImage(bo->image);
    } else {
@@ -578,6 +657,10 @@ gbm_dri_bo_create(struct gbm_device *gbm,
    if (usage & GBM_BO_USE_WRITE)
       return create_dumb(gbm, width, height, format, usage);
 
+   bo = bo_cache_lookup(dri, width, height, format, usage);
+   if (bo != NULL)
+      return &bo->base.base;
+
    bo = calloc(1, sizeof *bo);
    if (bo == NULL)
       return NULL;
@@ -633,6 +716,9 @@ gbm_dri_bo_create(struct gbm_device *gbm,
    dri->image->queryImage(bo->image, __DRI_IMAGE_ATTRIB_STRIDE,
                           (int *) &bo->base.base.stride);
 
+   bo->usage = usage;
+   bo->cacheable = 1;
+
    return &bo->base.base;
 }
 
@@ -669,6 +755,7 @@ dri_destroy(struct gbm_device *gbm)
 {
    struct gbm_dri_device *dri = gbm_dri_device(gbm);
 
+   bo_cache_trim(dri, 0);
    dri->core->destroyScreen(dri->screen);
    free(dri->driver_configs);
    dlclose(dri->driver);
@@ -681,6 +768,7 @@ static struct gbm_device *
 dri_device_create(int fd)
 {
    struct gbm_dri_device *dri;
+   const char *cache_size;
    int ret;
 
    dri = calloc(1, sizeof *dri);
@@ -698,6 +786,11 @@ dri_device_create(int fd)
    dri->base.type = GBM_DRM_DRIVER_TYPE_DRI;
    dri->base.base.name = "drm";
 
+   /* Maximum size in KiB of destroyed buffers to keep around for reuse */
+   cache_size = getenv("GBM_BO_CACHE_SIZE");
+   if (cache_size)
+      dri->bo_cache_max_size = strtoull(cache_size, NULL, 10) * 1024;
+
    ret = dri_screen_create(dri);
    if (ret)
       goto err_dri;
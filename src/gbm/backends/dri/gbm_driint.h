@@ -36,6 +36,7 @@
 #include "GL/internal/dri_interface.h"
 
 struct gbm_dri_surface;
+struct gbm_dri_bo;
 
 struct gbm_dri_device {
    struct gbm_drm_device base;
@@ -74,6 +75,12 @@ struct gbm_dri_device {
                             struct __DRIimageList *buffers);
 
    struct wl_drm *wl_drm;
+
+   /* Recently destroyed buffers, most recent first, kept around for reuse
+    * by gbm_dri_bo_create().  Disabled unless GBM_BO_CACHE_SIZE is set.
+    */
+   struct gbm_dri_bo *bo_cache;
+   uint64_t bo_cache_size, bo_cache_max_size;
 };
 
 struct gbm_dri_bo {
@@ -81,6 +88,11 @@ struct gbm_dri_bo {
 
    __DRIimage *image;
 
+   /* Set for buffers from gbm_dri_bo_create(), which can be cached */
+   uint32_t usage;
+   int cacheable;
+   struct gbm_dri_bo *next_cached;
+
    /* Only used for cursors */
    uint32_t handle, size;
    void *map;
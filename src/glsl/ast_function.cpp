@@ -502,6 +502,8 @@ no_matching_function_error(const char *name,
 {
    gl_shader *sh = _mesa_glsl_get_builtin_function_shader();
 
+   _mesa_glsl_lock_builtin_functions();
+
    if (state->symbols->get_function(name) == NULL
       && (!state->uses_builtin_functions
           || sh->symbols->get_function(name) == NULL)) {
@@ -519,6 +521,8 @@ no_matching_function_error(const char *name,
          print_function_prototypes(state, loc, sh->symbols->get_function(name));
       }
    }
+
+   _mesa_glsl_unlock_builtin_functions();
 }
 
 /**
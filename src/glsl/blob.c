@@ -0,0 +1,226 @@
+/**************************************************************************
+ *
+ * Copyright 2014 The Mesa Authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+#include <string.h>
+
+#include "blob.h"
+#include "ralloc.h"
+
+#define BLOB_INITIAL_SIZE 4096
+
+
+/**
+ * Make sure there is room for to_write more bytes in the blob.
+ */
+static bool
+grow_to_fit(struct blob *blob, size_t to_write)
+{
+   size_t to_allocate;
+   uint8_t *new_data;
+
+   if (blob->size + to_write <= blob->allocated)
+      return true;
+
+   if (blob->allocated == 0)
+      to_allocate = BLOB_INITIAL_SIZE;
+   else
+      to_allocate = blob->allocated * 2;
+
+   while (to_allocate < blob->size + to_write)
+      to_allocate *= 2;
+
+   new_data = reralloc_size(blob, blob->data, to_allocate);
+   if (new_data == NULL)
+      return false;
+
+   blob->data = new_data;
+   blob->allocated = to_allocate;
+
+   return true;
+}
+
+
+struct blob *
+blob_create(void *mem_ctx)
+{
+   struct blob *blob = ralloc(mem_ctx, struct blob);
+
+   if (blob == NULL)
+      return NULL;
+
+   blob->data = NULL;
+   blob->size = 0;
+   blob->allocated = 0;
+
+   return blob;
+}
+
+
+bool
+blob_write_bytes(struct blob *blob, const void *bytes, size_t to_write)
+{
+   if (!grow_to_fit(blob, to_write))
+      return false;
+
+   memcpy(blob->data + blob->size, bytes, to_write);
+   blob->size += to_write;
+
+   return true;
+}
+
+
+bool
+blob_write_uint32(struct blob *blob, uint32_t value)
+{
+   return blob_write_bytes(blob, &value, sizeof(value));
+}
+
+
+bool
+blob_write_uint64(struct blob *blob, uint64_t value)
+{
+   return blob_write_bytes(blob, &value, sizeof(value));
+}
+
+
+bool
+blob_write_intptr(struct blob *blob, intptr_t value)
+{
+   return blob_write_bytes(blob, &value, sizeof(value));
+}
+
+
+bool
+blob_write_string(struct blob *blob, const char *str)
+{
+   return blob_write_bytes(blob, str, strlen(str) + 1);
+}
+
+
+void
+blob_reader_init(struct blob_reader *blob, const uint8_t *data, size_t size)
+{
+   blob->data = data;
+   blob->end = data + size;
+   blob->current = data;
+   blob->overrun = false;
+}
+
+
+/**
+ * Check that size more bytes can be read, flagging an overrun if not.
+ */
+static bool
+ensure_can_read(struct blob_reader *blob, size_t size)
+{
+   if (blob->overrun)
+      return false;
+
+   if (size <= (size_t) (blob->end - blob->current))
+      return true;
+
+   blob->overrun = true;
+   return false;
+}
+
+
+const void *
+blob_read_bytes(struct blob_reader *blob, size_t size)
+{
+   const void *ret;
+
+   if (!ensure_can_read(blob, size))
+      return NULL;
+
+   ret = blob->current;
+   blob->current += size;
+
+   return ret;
+}
+
+
+void
+blob_copy_bytes(struct blob_reader *blob, void *dest, size_t size)
+{
+   const void *bytes = blob_read_bytes(blob, size);
+
+   if (bytes)
+      memcpy(dest, bytes, size);
+   else
+      memset(dest, 0, size);
+}
+
+
+/* The values are unaligned in the blob, so they're always copied out. */
+
+uint32_t
+blob_read_uint32(struct blob_reader *blob)
+{
+   uint32_t value;
+   blob_copy_bytes(blob, &value, sizeof(value));
+   return value;
+}
+
+
+uint64_t
+blob_read_uint64(struct blob_reader *blob)
+{
+   uint64_t value;
+   blob_copy_bytes(blob, &value, sizeof(value));
+   return value;
+}
+
+
+intptr_t
+blob_read_intptr(struct blob_reader *blob)
+{
+   intptr_t value;
+   blob_copy_bytes(blob, &value, sizeof(value));
+   return value;
+}
+
+
+const char *
+blob_read_string(struct blob_reader *blob)
+{
+   const uint8_t *nul;
+   const char *ret;
+
+   if (blob->overrun)
+      return NULL;
+
+   nul = memchr(blob->current, 0, blob->end - blob->current);
+   if (nul == NULL) {
+      blob->overrun = true;
+      return NULL;
+   }
+
+   ret = (const char *) blob->current;
+   blob->current = nul + 1;
+
+   return ret;
+}
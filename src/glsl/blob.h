@@ -0,0 +1,131 @@
+/**************************************************************************
+ *
+ * Copyright 2014 The Mesa Authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * \file blob.h
+ *
+ * A growable byte buffer for serializing data, and a matching reader.
+ *
+ * Values are stored in host byte order without any padding, so a blob is
+ * only meant to be read back by the same build of Mesa that wrote it.
+ */
+
+#ifndef BLOB_H
+#define BLOB_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct blob {
+   uint8_t *data;
+   size_t size;        /**< bytes written so far */
+   size_t allocated;   /**< size of data, in bytes */
+};
+
+struct blob_reader {
+   const uint8_t *data;
+   const uint8_t *end;
+   const uint8_t *current;
+
+   /**
+    * Set whenever a read ran past the end of the data.  The failed read
+    * and all subsequent ones return zeros, so callers only need to check
+    * this once, after reading everything.
+    */
+   bool overrun;
+};
+
+/**
+ * Create an empty blob, as a ralloc child of mem_ctx.
+ */
+struct blob *
+blob_create(void *mem_ctx);
+
+/**
+ * Append bytes to the blob.
+ * \return false if out of memory
+ */
+bool
+blob_write_bytes(struct blob *blob, const void *bytes, size_t to_write);
+
+bool
+blob_write_uint32(struct blob *blob, uint32_t value);
+
+bool
+blob_write_uint64(struct blob *blob, uint64_t value);
+
+bool
+blob_write_intptr(struct blob *blob, intptr_t value);
+
+/**
+ * Append a NUL-terminated string, including the terminator.
+ */
+bool
+blob_write_string(struct blob *blob, const char *str);
+
+void
+blob_reader_init(struct blob_reader *blob, const uint8_t *data, size_t size);
+
+/**
+ * Read bytes from the blob.
+ * \return a pointer into the blob's data, or NULL on overrun
+ */
+const void *
+blob_read_bytes(struct blob_reader *blob, size_t size);
+
+/**
+ * Read bytes from the blob into dest; dest is zeroed on overrun.
+ */
+void
+blob_copy_bytes(struct blob_reader *blob, void *dest, size_t size);
+
+uint32_t
+blob_read_uint32(struct blob_reader *blob);
+
+uint64_t
+blob_read_uint64(struct blob_reader *blob);
+
+intptr_t
+blob_read_intptr(struct blob_reader *blob);
+
+/**
+ * Read a string written by blob_write_string().
+ * \return a pointer into the blob's data, or NULL on overrun
+ */
+const char *
+blob_read_string(struct blob_reader *blob);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BLOB_H */
@@ -39,7 +39,8 @@
  *
  *    The builtin_builder::create_builtins() function contains lists of all
  *    built-in function signatures, where they're available, what types they
- *    take, and so on.
+ *    take, and so on.  The IR of a built-in is only built the first time a
+ *    shader looks it up by name, see builtin_builder::get_function().
  *
  * 4. Implementations of built-in function signatures
  *
@@ -62,6 +63,10 @@
 #include "program/prog_instruction.h"
 #include <limits>
 
+extern "C" {
+#include "program/hash_table.h"
+}
+
 using namespace ir_builder;
 
 /**
@@ -370,6 +375,8 @@ public:
    ir_function_signature *find(_mesa_glsl_parse_state *state,
                                const char *name, exec_list *actual_parameters);
 
+   ir_function *get_function(const char *name);
+
    /**
     * A shader to hold all the built-in signatures; created by this module.
     *
@@ -382,6 +389,20 @@ public:
 private:
    void *mem_ctx;
 
+   /**
+    * The function currently being built by get_function(); the IR of all
+    * the others is skipped.
+    */
+   const char *wanted_function;
+
+   /** Names get_function() has already built, or found not to exist */
+   struct hash_table *built_functions;
+
+   bool wants_function(const char *name) const
+   {
+      return strcmp(name, wanted_function) == 0;
+   }
+
    /** Global variables used by built-in functions. */
    ir_variable *gl_ModelViewProjectionMatrix;
    ir_variable *gl_Vertex;
@@ -645,6 +666,8 @@ private:
  */
 builtin_builder::builtin_builder()
    : shader(NULL),
+     wanted_function(NULL),
+     built_functions(NULL),
      gl_ModelViewProjectionMatrix(NULL),
      gl_Vertex(NULL)
 {
@@ -653,6 +676,8 @@ builtin_builder::builtin_builder()
 
 builtin_builder::~builtin_builder()
 {
+   if (built_functions)
+      hash_table_dtor(built_functions);
    ralloc_free(mem_ctx);
 }
 
@@ -669,7 +694,7 @@ builtin_builder::find(_mesa_glsl_parse_state *state,
     */
    state->uses_builtin_functions = true;
 
-   ir_function *f = shader->symbols->get_function(name);
+   ir_function *f = get_function(name);
    if (f == NULL)
       return NULL;
 
@@ -688,14 +713,17 @@ builtin_builder::initialize()
       return;
 
    mem_ctx = ralloc_context(NULL);
+   built_functions = hash_table_ctor(0, hash_table_string_hash,
+                                     hash_table_string_compare);
    create_shader();
-   create_intrinsics();
-   create_builtins();
 }
 
 void
 builtin_builder::release()
 {
+   hash_table_dtor(built_functions);
+   built_functions = NULL;
+
    ralloc_free(mem_ctx);
    mem_ctx = NULL;
 
@@ -724,8 +752,45 @@ builtin_builder::create_shader()
    shader->symbols->add_variable(gl_Vertex);
 }
 
+/**
+ * Look up a built-in function or intrinsic by name, building its IR on the
+ * first lookup.
+ *
+ * Building the IR of every built-in of every GLSL version up front is a
+ * large part of the first compile, and most of it is never used.  So the
+ * lists in create_intrinsics() and create_builtins() are walked with just
+ * the one function wanted, the signatures of all the others aren't
+ * created.  Built-ins calling an intrinsic build it through here too.
+ */
+ir_function *
+builtin_builder::get_function(const char *name)
+{
+   ir_function *f = shader->symbols->get_function(name);
+
+   if (f == NULL && hash_table_find(built_functions, name) == NULL) {
+      const char *saved = wanted_function;
+
+      /* Mark it first, in case the function's IR looks itself up */
+      hash_table_insert(built_functions, (void *) 1,
+                        ralloc_strdup(mem_ctx, name));
+
+      wanted_function = name;
+      create_intrinsics();
+      create_builtins();
+      wanted_function = saved;
+
+      f = shader->symbols->get_function(name);
+   }
+
+   return f;
+}
+
 /** @} */
 
+/* Only build the IR of the function which is looked up, see get_function() */
+#define add_function(NAME, ...) \
+   if (wants_function(NAME)) add_function(NAME, __VA_ARGS__)
+
 /**
  * Create ir_function and ir_function_signature objects for each
  * intrinsic.
@@ -2234,6 +2299,8 @@ builtin_builder::create_builtins()
 #undef FIU2_MIXED
 }
 
+#undef add_function
+
 void
 builtin_builder::add_function(const char *name, ...)
 {
@@ -2266,6 +2333,9 @@ builtin_builder::add_image_function(const char *name,
                                     unsigned num_arguments,
                                     unsigned flags)
 {
+   if (!wants_function(name))
+      return;
+
    static const glsl_type *const types[] = {
       glsl_type::image1D_type,
       glsl_type::image2D_type,
@@ -4204,7 +4274,7 @@ builtin_builder::_atomic_op(const char *intrinsic,
    MAKE_SIG(glsl_type::uint_type, avail, 1, counter);
 
    ir_variable *retval = body.make_temp(glsl_type::uint_type, "atomic_retval");
-   body.emit(call(shader->symbols->get_function(intrinsic), retval,
+   body.emit(call(get_function(intrinsic), retval,
                   sig->parameters));
    body.emit(ret(retval));
    return sig;
@@ -4309,7 +4379,7 @@ builtin_builder::_image(const glsl_type *image_type,
 
    if (flags & IMAGE_FUNCTION_EMIT_STUB) {
       ir_factory body(&sig->body, mem_ctx);
-      ir_function *f = shader->symbols->get_function(intrinsic_name);
+      ir_function *f = get_function(intrinsic_name);
 
       if (flags & IMAGE_FUNCTION_RETURNS_VOID) {
          body.emit(call(f, NULL, sig->parameters));
@@ -4340,7 +4410,7 @@ ir_function_signature *
 builtin_builder::_memory_barrier(builtin_available_predicate avail)
 {
    MAKE_SIG(glsl_type::void_type, avail, 0);
-   body.emit(call(shader->symbols->get_function("__intrinsic_memory_barrier"),
+   body.emit(call(get_function("__intrinsic_memory_barrier"),
                   NULL, sig->parameters));
    return sig;
 }
@@ -4390,4 +4460,21 @@ _mesa_glsl_get_builtin_function_shader()
    return builtins.shader;
 }
 
+/**
+ * The built-in shader's functions are built on demand, by compiles which
+ * may be running on other threads.  Anything else looking at the shader
+ * must hold this lock.
+ */
+void
+_mesa_glsl_lock_builtin_functions()
+{
+   _glthread_LOCK_MUTEX(builtins_lock);
+}
+
+void
+_mesa_glsl_unlock_builtin_functions()
+{
+   _glthread_UNLOCK_MUTEX(builtins_lock);
+}
+
 /** @} */
@@ -48,6 +48,9 @@ _define_function_macro (glcpp_parser_t *parser,
 			string_list_t *parameters,
 			token_list_t *replacements);
 
+static macro_t *
+_glcpp_parser_find_macro (glcpp_parser_t *parser, const char *identifier);
+
 static string_list_t *
 _string_list_create (void *ctx);
 
@@ -260,10 +263,13 @@ control_line:
 |	HASH_UNDEF {
 		glcpp_parser_resolve_implicit_version(parser);
 	} IDENTIFIER NEWLINE {
-		macro_t *macro = hash_table_find (parser->defines, $3);
-		if (macro) {
-			hash_table_remove (parser->defines, $3);
-			ralloc_free (macro);
+		struct hash_entry *entry;
+		entry = _mesa_hash_table_search (parser->defines,
+						 _mesa_hash_string ($3), $3);
+		if (entry) {
+			ralloc_free (entry->data);
+			_mesa_hash_table_remove (parser->defines, entry);
+			parser->define_generation++;
 		}
 		ralloc_free ($3);
 	}
@@ -302,14 +308,14 @@ control_line:
 |	HASH_IFDEF {
 		glcpp_parser_resolve_implicit_version(parser);
 	} IDENTIFIER junk NEWLINE {
-		macro_t *macro = hash_table_find (parser->defines, $3);
+		macro_t *macro = _glcpp_parser_find_macro (parser, $3);
 		ralloc_free ($3);
 		_glcpp_parser_skip_stack_push_if (parser, & @1, macro != NULL);
 	}
 |	HASH_IFNDEF {
 		glcpp_parser_resolve_implicit_version(parser);
 	} IDENTIFIER junk NEWLINE {
-		macro_t *macro = hash_table_find (parser->defines, $3);
+		macro_t *macro = _glcpp_parser_find_macro (parser, $3);
 		ralloc_free ($3);
 		_glcpp_parser_skip_stack_push_if (parser, & @2, macro == NULL);
 	}
@@ -532,11 +538,11 @@ junk:
 conditional_token:
 	/* Handle "defined" operator */
 	DEFINED IDENTIFIER {
-		int v = hash_table_find (parser->defines, $2) ? 1 : 0;
+		int v = _glcpp_parser_find_macro (parser, $2) ? 1 : 0;
 		$$ = _token_create_ival (parser, INTEGER, v);
 	}
 |	DEFINED '(' IDENTIFIER ')' {
-		int v = hash_table_find (parser->defines, $3) ? 1 : 0;
+		int v = _glcpp_parser_find_macro (parser, $3) ? 1 : 0;
 		$$ = _token_create_ival (parser, INTEGER, v);
 	}
 |	preprocessing_token
@@ -1200,8 +1206,9 @@ glcpp_parser_create (const struct gl_extensions *extensions, gl_api api)
 	parser = ralloc (NULL, glcpp_parser_t);
 
 	glcpp_lex_init_extra (parser, &parser->scanner);
-	parser->defines = hash_table_ctor (32, hash_table_string_hash,
-					   hash_table_string_compare);
+	parser->defines = _mesa_hash_table_create (parser,
+						   _mesa_key_string_equal);
+	parser->define_generation = 1;
 	parser->active = NULL;
 	parser->lexing_if = 0;
 	parser->space_tokens = 1;
@@ -1237,7 +1244,7 @@ void
 glcpp_parser_destroy (glcpp_parser_t *parser)
 {
 	glcpp_lex_destroy (parser->scanner);
-	hash_table_dtor (parser->defines);
+	_mesa_hash_table_destroy (parser->defines, NULL);
 	ralloc_free (parser);
 }
 
@@ -1419,6 +1426,63 @@ _glcpp_parser_apply_pastes (glcpp_parser_t *parser, token_list_t *list)
 	list->non_space_tail = list->tail;
 }
 
+/* Compute the complete expansion of the object-like macro, as if it
+ * appeared on its own, and memoize it in macro->expansion.
+ *
+ * The result can't be memoized if it depends on its context. That is,
+ * if it still contains the name of a macro, as a function-like macro
+ * name may take its arguments from the tokens following the original
+ * one; or if expanding it reported anything, as it'd then have to be
+ * reported for each use.
+ */
+static void
+_glcpp_parser_memoize_object_macro (glcpp_parser_t *parser,
+				    macro_t *macro)
+{
+	token_list_t *expansion;
+	token_node_t *node;
+	size_t info_log_length = parser->info_log_length;
+	int error = parser->error;
+	active_list_t *active = parser->active;
+
+	ralloc_free (macro->expansion);
+	macro->expansion = NULL;
+	macro->expansion_generation = parser->define_generation;
+
+	expansion = _token_list_copy (parser, macro->replacements);
+	_glcpp_parser_apply_pastes (parser, expansion);
+
+	/* Expand with this macro marked active, so that it isn't
+	 * expanded recursively. The NULL marker is never reached. */
+	_parser_active_list_push (parser, macro->identifier, NULL);
+	_glcpp_parser_expand_token_list (parser, expansion);
+	_parser_active_list_pop (parser);
+	assert (parser->active == active);
+
+	if (parser->info_log_length != info_log_length) {
+		/* Drop the messages, the expansion is done again in
+		 * context which reports them as appropriate. */
+		parser->info_log[info_log_length] = '\0';
+		parser->info_log_length = info_log_length;
+		parser->error = error;
+		ralloc_free (expansion);
+		return;
+	}
+
+	for (node = expansion->head; node; node = node->next) {
+		if (node->token->type == IDENTIFIER &&
+		    _glcpp_parser_find_macro (parser, node->token->value.str))
+		{
+			ralloc_free (expansion);
+			return;
+		}
+	}
+
+	/* Keep the list itself, pasted tokens' strings belong to it. */
+	macro->expansion = expansion;
+	ralloc_steal (macro, expansion);
+}
+
 /* This is a helper function that's essentially part of the
  * implementation of _glcpp_parser_expand_node. It shouldn't be called
  * except for by that function.
@@ -1451,7 +1515,7 @@ _glcpp_parser_expand_function (glcpp_parser_t *parser,
 
 	identifier = node->token->value.str;
 
-	macro = hash_table_find (parser->defines, identifier);
+	macro = _glcpp_parser_find_macro (parser, identifier);
 
 	assert (macro->is_function);
 
@@ -1584,7 +1648,7 @@ _glcpp_parser_expand_node (glcpp_parser_t *parser,
 		return _token_list_create_with_one_integer (parser, node->token->location.source);
 
 	/* Look up this identifier in the hash table. */
-	macro = hash_table_find (parser->defines, identifier);
+	macro = _glcpp_parser_find_macro (parser, identifier);
 
 	/* Not a macro, so no expansion needed. */
 	if (macro == NULL)
@@ -1615,6 +1679,20 @@ _glcpp_parser_expand_node (glcpp_parser_t *parser,
 		if (macro->replacements == NULL)
 			return _token_list_create_with_one_space (parser);
 
+		/* Outside of other expansions, the result only depends on
+		 * the macro definitions, so it can be reused. The tokens
+		 * are copied as expansion modifies them in place. */
+		if (parser->active == NULL) {
+			if (macro->expansion_generation !=
+			    parser->define_generation)
+				_glcpp_parser_memoize_object_macro (parser,
+								    macro);
+
+			if (macro->expansion)
+				return _token_list_copy (parser,
+							 macro->expansion);
+		}
+
 		replacement = _token_list_copy (parser, macro->replacements);
 		_glcpp_parser_apply_pastes (parser, replacement);
 		return replacement;
@@ -1796,6 +1874,30 @@ _macro_equal (macro_t *a, macro_t *b)
 						 b->replacements);
 }
 
+static macro_t *
+_glcpp_parser_find_macro (glcpp_parser_t *parser, const char *identifier)
+{
+	struct hash_entry *entry;
+
+	entry = _mesa_hash_table_search (parser->defines,
+					 _mesa_hash_string (identifier),
+					 identifier);
+
+	return entry ? entry->data : NULL;
+}
+
+/* Add macro to the hash table, replacing any previous definition. */
+static void
+_glcpp_parser_add_macro (glcpp_parser_t *parser, macro_t *macro)
+{
+	_mesa_hash_table_insert (parser->defines,
+				 _mesa_hash_string (macro->identifier),
+				 macro->identifier, macro);
+
+	/* Any memoized expansion may depend on this macro. */
+	parser->define_generation++;
+}
+
 void
 _define_object_macro (glcpp_parser_t *parser,
 		      YYLTYPE *loc,
@@ -1813,9 +1915,11 @@ _define_object_macro (glcpp_parser_t *parser,
 	macro->parameters = NULL;
 	macro->identifier = ralloc_strdup (macro, identifier);
 	macro->replacements = replacements;
+	macro->expansion = NULL;
+	macro->expansion_generation = 0;
 	ralloc_steal (macro, replacements);
 
-	previous = hash_table_find (parser->defines, identifier);
+	previous = _glcpp_parser_find_macro (parser, identifier);
 	if (previous) {
 		if (_macro_equal (macro, previous)) {
 			ralloc_free (macro);
@@ -1825,7 +1929,7 @@ _define_object_macro (glcpp_parser_t *parser,
 			     identifier);
 	}
 
-	hash_table_insert (parser->defines, macro, identifier);
+	_glcpp_parser_add_macro (parser, macro);
 }
 
 void
@@ -1847,7 +1951,9 @@ _define_function_macro (glcpp_parser_t *parser,
 	macro->parameters = parameters;
 	macro->identifier = ralloc_strdup (macro, identifier);
 	macro->replacements = replacements;
-	previous = hash_table_find (parser->defines, identifier);
+	macro->expansion = NULL;
+	macro->expansion_generation = 0;
+	previous = _glcpp_parser_find_macro (parser, identifier);
 	if (previous) {
 		if (_macro_equal (macro, previous)) {
 			ralloc_free (macro);
@@ -1857,7 +1963,7 @@ _define_function_macro (glcpp_parser_t *parser,
 			     identifier);
 	}
 
-	hash_table_insert (parser->defines, macro, identifier);
+	_glcpp_parser_add_macro (parser, macro);
 }
 
 static int
@@ -1912,8 +2018,8 @@ glcpp_parser_lex (YYSTYPE *yylval, YYLTYPE *yylloc, glcpp_parser_t *parser)
 		else if (ret == IDENTIFIER)
 		{
 			macro_t *macro;
-			macro = hash_table_find (parser->defines,
-						 yylval->str);
+			macro = _glcpp_parser_find_macro (parser,
+							  yylval->str);
 			if (macro && macro->is_function) {
 				parser->newline_as_space = 1;
 				parser->paren_count = 0;
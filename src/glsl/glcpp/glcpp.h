@@ -31,7 +31,7 @@
 
 #include "../ralloc.h"
 
-#include "program/hash_table.h"
+#include "main/hash_table.h"
 
 #define yyscan_t void*
 
@@ -137,6 +137,12 @@ typedef struct {
 	string_list_t *parameters;
 	const char *identifier;
 	token_list_t *replacements;
+
+	/* Memoized complete expansion of an object-like macro, valid
+	 * while expansion_generation matches the parser's
+	 * define_generation. NULL if the expansion can't be memoized. */
+	token_list_t *expansion;
+	unsigned expansion_generation;
 } macro_t;
 
 typedef struct expansion_node {
@@ -167,6 +173,7 @@ typedef struct active_list {
 struct glcpp_parser {
 	yyscan_t scanner;
 	struct hash_table *defines;
+	unsigned define_generation; /* bumped by every #define and #undef */
 	active_list_t *active;
 	int lexing_if;
 	int space_tokens;
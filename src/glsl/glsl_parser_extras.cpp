@@ -37,6 +37,7 @@ extern "C" {
 #include "glsl_parser.h"
 #include "ir_optimization.h"
 #include "loop_analysis.h"
+#include "glsl_stats.h"
 
 /**
  * Format a short human-readable description of the given GLSL version.
@@ -63,6 +64,7 @@ _mesa_glsl_parse_state::_mesa_glsl_parse_state(struct gl_context *_ctx,
    this->stage = stage;
 
    this->scanner = NULL;
+   this->linalloc = linear_alloc_parent(this, 0);
    this->translation_unit.make_empty();
    this->symbols = new(mem_ctx) glsl_symbol_table;
 
@@ -1401,14 +1403,22 @@ _mesa_glsl_compile_shader(struct gl_context *ctx, struct gl_shader *shader,
    struct _mesa_glsl_parse_state *state =
       new(shader) _mesa_glsl_parse_state(ctx, shader->Stage, shader);
    const char *source = shader->Source;
+   const char *const stage_name = _mesa_shader_stage_to_string(shader->Stage);
+   struct glsl_stats_timer timer;
 
+   glsl_stats_begin(&timer);
    state->error = glcpp_preprocess(state, &source, &state->info_log,
                              &ctx->Extensions, ctx);
+   glsl_stats_end(&timer, GLSL_STATS_PREPROCESS, stage_name, shader->Name,
+                  NULL);
 
    if (!state->error) {
+     glsl_stats_begin(&timer);
      _mesa_glsl_lexer_ctor(state, source);
      _mesa_glsl_parse(state);
      _mesa_glsl_lexer_dtor(state);
+     glsl_stats_end(&timer, GLSL_STATS_PARSE, stage_name, shader->Name,
+                    NULL);
    }
 
    if (dump_ast) {
@@ -1421,8 +1431,12 @@ _mesa_glsl_compile_shader(struct gl_context *ctx, struct gl_shader *shader,
 
    ralloc_free(shader->ir);
    shader->ir = new(shader) exec_list;
-   if (!state->error && !state->translation_unit.is_empty())
+   if (!state->error && !state->translation_unit.is_empty()) {
+      glsl_stats_begin(&timer);
       _mesa_ast_to_hir(shader->ir, state);
+      glsl_stats_end(&timer, GLSL_STATS_AST_TO_HIR, stage_name, shader->Name,
+                     shader->ir);
+   }
 
    if (!state->error) {
       validate_ir_tree(shader->ir);
@@ -1441,8 +1455,10 @@ _mesa_glsl_compile_shader(struct gl_context *ctx, struct gl_shader *shader,
       /* Do some optimization at compile time to reduce shader IR size
        * and reduce later work if the same shader is linked multiple times
        */
-      while (do_common_optimization(shader->ir, false, false, 32, options))
-         ;
+      glsl_stats_begin(&timer);
+      do_common_optimization_loop(shader->ir, false, false, 32, options);
+      glsl_stats_end(&timer, GLSL_STATS_COMPILE_OPTIMIZE, stage_name,
+                     shader->Name, shader->ir);
 
       validate_ir_tree(shader->ir);
    }
@@ -1473,6 +1489,155 @@ _mesa_glsl_compile_shader(struct gl_context *ctx, struct gl_shader *shader,
 }
 
 } /* extern "C" */
+
+/** Upper bound of the number of passes run by do_common_optimization() */
+#define MAX_COMMON_PASSES 32
+
+/**
+ * Tracks which passes of do_common_optimization() can be skipped when the
+ * set of passes is run repeatedly until none of them makes progress.  The
+ * generation is bumped by every pass which makes progress.  A pass which
+ * made no progress at a generation will make none again until another pass
+ * has changed the IR, so it needn't be rerun before then.
+ */
+struct common_opt_tracker {
+   unsigned generation;
+   unsigned clean_at[MAX_COMMON_PASSES];  /**< 0 if not known to be clean */
+
+   /**
+    * Per pass statistics, gathered if MESA_GLSL contains "passes" or
+    * "time"
+    */
+   bool timing;
+   struct {
+      const char *name;
+      unsigned runs, skips, progress;
+      int64_t time;
+   } stats[MAX_COMMON_PASSES];
+};
+
+static void
+common_opt_tracker_update(struct common_opt_tracker *tracker, unsigned slot,
+                          const char *name, bool progress, int64_t start)
+{
+   if (progress) {
+      tracker->generation++;
+      tracker->clean_at[slot] = 0;
+   } else {
+      tracker->clean_at[slot] = tracker->generation;
+   }
+
+   if (tracker->timing) {
+      tracker->stats[slot].name = name;
+      tracker->stats[slot].runs++;
+      tracker->stats[slot].progress += progress;
+      tracker->stats[slot].time += glsl_stats_time() - start;
+   }
+}
+
+/**
+ * Run a pass unless the tracker knows it would make no progress.
+ */
+#define OPT(PASS, ...)                                                    \
+   do {                                                                   \
+      const unsigned slot = num_passes++;                                 \
+      assert(slot < MAX_COMMON_PASSES);                                   \
+      if (tracker && tracker->clean_at[slot] == tracker->generation) {    \
+         tracker->stats[slot].skips++;                                    \
+      } else {                                                            \
+         const int64_t start =                                            \
+            tracker && tracker->timing ? glsl_stats_time() : 0;           \
+         const bool pass_progress = PASS(__VA_ARGS__);                    \
+         if (tracker)                                                     \
+            common_opt_tracker_update(tracker, slot, #PASS,               \
+                                      pass_progress, start);              \
+         progress = pass_progress || progress;                            \
+      }                                                                   \
+   } while (false)
+
+static bool
+do_loop_optimizations(exec_list *ir, unsigned max_unroll_iterations,
+                      const struct gl_shader_compiler_options *options)
+{
+   bool progress = false;
+
+   loop_state *ls = analyze_loop_variables(ir);
+   if (ls->loop_found) {
+      progress = set_loop_controls(ir, ls) || progress;
+      progress = unroll_loops(ir, ls, max_unroll_iterations, options)
+         || progress;
+   }
+   delete ls;
+
+   return progress;
+}
+
+/**
+ * Run each of the common optimization passes once, or only the ones which
+ * may make progress if \c tracker is non-NULL.
+ *
+ * Whether a pass is run must only depend on the arguments, which stay the
+ * same across the rounds, so that the passes keep their tracker slots.
+ */
+static bool
+common_optimization_round(exec_list *ir, bool linked,
+                          bool uniform_locations_assigned,
+                          unsigned max_unroll_iterations,
+                          const struct gl_shader_compiler_options *options,
+                          struct common_opt_tracker *tracker)
+{
+   unsigned num_passes = 0;
+   bool progress = false;
+
+   OPT(lower_instructions, ir, SUB_TO_ADD_NEG);
+
+   if (linked) {
+      OPT(do_function_inlining, ir);
+      OPT(do_dead_functions, ir);
+      OPT(do_structure_splitting, ir);
+   }
+   OPT(do_if_simplification, ir);
+   OPT(opt_flatten_nested_if_blocks, ir);
+   OPT(do_copy_propagation, ir);
+   OPT(do_copy_propagation_elements, ir);
+
+   if (options->OptimizeForAOS && !linked)
+      OPT(opt_flip_matrices, ir);
+
+   if (linked && options->OptimizeForAOS) {
+      OPT(do_vectorize, ir);
+   }
+
+   if (linked)
+      OPT(do_dead_code, ir, uniform_locations_assigned);
+   else
+      OPT(do_dead_code_unlinked, ir);
+   OPT(do_dead_code_local, ir);
+   OPT(do_tree_grafting, ir);
+   OPT(do_constant_propagation, ir);
+   if (linked)
+      OPT(do_constant_variable, ir);
+   else
+      OPT(do_constant_variable_unlinked, ir);
+   OPT(do_constant_folding, ir);
+   OPT(do_cse, ir);
+   OPT(do_algebraic, ir);
+   OPT(do_lower_jumps, ir);
+   OPT(do_vec_index_to_swizzle, ir);
+   OPT(lower_vector_insert, ir, false);
+   OPT(do_swizzle_swizzle, ir);
+   OPT(do_noop_swizzle, ir);
+
+   OPT(optimize_split_arrays, ir, linked);
+   OPT(optimize_redundant_jumps, ir);
+
+   OPT(do_loop_optimizations, ir, max_unroll_iterations, options);
+
+   return progress;
+}
+
+#undef OPT
+
 /**
  * Do the set of common optimizations passes
  *
@@ -1497,56 +1662,64 @@ do_common_optimization(exec_list *ir, bool linked,
 		       unsigned max_unroll_iterations,
                        const struct gl_shader_compiler_options *options)
 {
-   GLboolean progress = GL_FALSE;
-
-   progress = lower_instructions(ir, SUB_TO_ADD_NEG) || progress;
+   return common_optimization_round(ir, linked, uniform_locations_assigned,
+                                    max_unroll_iterations, options, NULL);
+}
 
-   if (linked) {
-      progress = do_function_inlining(ir) || progress;
-      progress = do_dead_functions(ir) || progress;
-      progress = do_structure_splitting(ir) || progress;
+/**
+ * Run do_common_optimization() until it makes no more progress, skipping
+ * the passes which can't make progress since they last ran.
+ *
+ * If MESA_GLSL contains "passes", how often each pass ran and made progress
+ * and the (process CPU) time it took are printed to stderr.
+ *
+ * \return true if any progress was made
+ */
+bool
+do_common_optimization_loop(exec_list *ir, bool linked,
+                            bool uniform_locations_assigned,
+                            unsigned max_unroll_iterations,
+                            const struct gl_shader_compiler_options *options)
+{
+   struct common_opt_tracker tracker;
+   const char *env = getenv("MESA_GLSL");
+   unsigned rounds = 0;
+   bool progress = false;
+
+   memset(&tracker, 0, sizeof(tracker));
+   tracker.generation = 1;
+   const bool report = env && strstr(env, "passes");
+   tracker.timing = report || glsl_stats_enabled();
+
+   while (common_optimization_round(ir, linked, uniform_locations_assigned,
+                                    max_unroll_iterations, options,
+                                    &tracker)) {
+      progress = true;
+      rounds++;
    }
-   progress = do_if_simplification(ir) || progress;
-   progress = opt_flatten_nested_if_blocks(ir) || progress;
-   progress = do_copy_propagation(ir) || progress;
-   progress = do_copy_propagation_elements(ir) || progress;
 
-   if (options->OptimizeForAOS && !linked)
-      progress = opt_flip_matrices(ir) || progress;
+   if (report) {
+      fprintf(stderr, "GLSL optimization: %u rounds with progress\n", rounds);
+      for (unsigned i = 0; i < MAX_COMMON_PASSES; i++) {
+         if (!tracker.stats[i].name)
+            continue;
 
-   if (linked && options->OptimizeForAOS) {
-      progress = do_vectorize(ir) || progress;
+         fprintf(stderr, "  %-32s %3u runs %3u skipped %3u progress %8.3f ms\n",
+                 tracker.stats[i].name, tracker.stats[i].runs,
+                 tracker.stats[i].skips, tracker.stats[i].progress,
+                 tracker.stats[i].time / 1000000.0);
+      }
    }
 
-   if (linked)
-      progress = do_dead_code(ir, uniform_locations_assigned) || progress;
-   else
-      progress = do_dead_code_unlinked(ir) || progress;
-   progress = do_dead_code_local(ir) || progress;
-   progress = do_tree_grafting(ir) || progress;
-   progress = do_constant_propagation(ir) || progress;
-   if (linked)
-      progress = do_constant_variable(ir) || progress;
-   else
-      progress = do_constant_variable_unlinked(ir) || progress;
-   progress = do_constant_folding(ir) || progress;
-   progress = do_cse(ir) || progress;
-   progress = do_algebraic(ir) || progress;
-   progress = do_lower_jumps(ir) || progress;
-   progress = do_vec_index_to_swizzle(ir) || progress;
-   progress = lower_vector_insert(ir, false) || progress;
-   progress = do_swizzle_swizzle(ir) || progress;
-   progress = do_noop_swizzle(ir) || progress;
-
-   progress = optimize_split_arrays(ir, linked) || progress;
-   progress = optimize_redundant_jumps(ir) || progress;
-
-   loop_state *ls = analyze_loop_variables(ir);
-   if (ls->loop_found) {
-      progress = set_loop_controls(ir, ls) || progress;
-      progress = unroll_loops(ir, ls, max_unroll_iterations) || progress;
+   if (glsl_stats_enabled()) {
+      for (unsigned i = 0; i < MAX_COMMON_PASSES; i++) {
+         if (tracker.stats[i].name)
+            glsl_stats_add_pass(tracker.stats[i].name, tracker.stats[i].runs,
+                                tracker.stats[i].skips,
+                                tracker.stats[i].progress,
+                                tracker.stats[i].time);
+      }
    }
-   delete ls;
 
    return progress;
 }
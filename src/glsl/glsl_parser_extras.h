@@ -150,6 +150,13 @@ struct _mesa_glsl_parse_state {
 
    struct gl_context *const ctx;
    void *scanner;
+
+   /**
+    * Linear allocator for the AST nodes and identifiers, which live as long
+    * as the parse state.
+    */
+   void *linalloc;
+
    exec_list translation_unit;
    glsl_symbol_table *symbols;
 
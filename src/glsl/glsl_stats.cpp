@@ -0,0 +1,214 @@
+/**************************************************************************
+ *
+ * Copyright 2014 The Mesa Authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * \file glsl_stats.cpp
+ *
+ * Compile time statistics, see glsl_stats.h.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include "main/core.h"
+#include "c11/threads.h"
+#include "ir.h"
+#include "ralloc.h"
+#include "glsl_stats.h"
+
+/** Upper bound of the number of distinct optimization passes reported */
+#define MAX_STATS_PASSES 64
+
+static const char *const phase_names[GLSL_STATS_NUM_PHASES] = {
+   "preprocess",
+   "parse",
+   "ast_to_hir",
+   "compile optimize",
+   "link",
+   "link optimize",
+   "backend",
+};
+
+static bool enabled = false;
+static once_flag init_once = ONCE_FLAG_INIT;
+
+/** Protects the totals */
+_glthread_DECLARE_STATIC_MUTEX(stats_lock);
+
+static struct {
+   unsigned count;
+   int64_t time;
+   size_t allocated_bytes;
+   uint64_t ir_nodes;
+} phase_totals[GLSL_STATS_NUM_PHASES];
+
+static struct {
+   const char *name;
+   unsigned runs, skips, progress;
+   int64_t time;
+} pass_totals[MAX_STATS_PASSES];
+
+static void
+report_totals(void)
+{
+   fprintf(stderr, "GLSL time totals:\n");
+   for (unsigned i = 0; i < GLSL_STATS_NUM_PHASES; i++) {
+      if (phase_totals[i].count == 0)
+         continue;
+
+      fprintf(stderr, "  %-32s %5u runs %10.3f ms %10lu KB %10llu IR nodes\n",
+              phase_names[i], phase_totals[i].count,
+              phase_totals[i].time / 1000000.0,
+              (unsigned long) (phase_totals[i].allocated_bytes / 1024),
+              (unsigned long long) phase_totals[i].ir_nodes);
+   }
+
+   for (unsigned i = 0; i < MAX_STATS_PASSES && pass_totals[i].name; i++) {
+      fprintf(stderr, "  %-32s %5u runs %10.3f ms %5u skipped %5u progress\n",
+              pass_totals[i].name, pass_totals[i].runs,
+              pass_totals[i].time / 1000000.0,
+              pass_totals[i].skips, pass_totals[i].progress);
+   }
+}
+
+static void
+init_stats(void)
+{
+   const char *env = getenv("MESA_GLSL");
+
+   enabled = env && strstr(env, "time");
+   if (enabled) {
+      ralloc_count_bytes(true);
+      atexit(report_totals);
+   }
+}
+
+bool
+glsl_stats_enabled(void)
+{
+   call_once(&init_once, init_stats);
+   return enabled;
+}
+
+int64_t
+glsl_stats_time(void)
+{
+#if defined(_WIN32)
+   LARGE_INTEGER frequency, counter;
+
+   QueryPerformanceFrequency(&frequency);
+   QueryPerformanceCounter(&counter);
+   return counter.QuadPart * 1000000000 / frequency.QuadPart;
+#else
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+void
+glsl_stats_begin(struct glsl_stats_timer *timer)
+{
+   if (!glsl_stats_enabled())
+      return;
+
+   timer->start = glsl_stats_time();
+   timer->allocated_bytes = ralloc_allocated_bytes();
+}
+
+static void
+count_ir_node(ir_instruction *ir, void *data)
+{
+   (void) ir;
+   (*(unsigned *) data)++;
+}
+
+void
+glsl_stats_end(const struct glsl_stats_timer *timer,
+               enum glsl_stats_phase phase,
+               const char *kind, unsigned name,
+               struct exec_list *ir)
+{
+   if (!glsl_stats_enabled())
+      return;
+
+   const int64_t time = glsl_stats_time() - timer->start;
+   const size_t allocated_bytes =
+      ralloc_allocated_bytes() - timer->allocated_bytes;
+   unsigned ir_nodes = 0;
+
+   if (ir != NULL) {
+      foreach_list(node, ir)
+         visit_tree((ir_instruction *) node, count_ir_node, &ir_nodes);
+   }
+
+   fprintf(stderr, "GLSL time: %s %u: %-16s %10.3f ms %10lu KB",
+           kind, name, phase_names[phase], time / 1000000.0,
+           (unsigned long) (allocated_bytes / 1024));
+   if (ir != NULL)
+      fprintf(stderr, " %10u IR nodes", ir_nodes);
+   fprintf(stderr, "\n");
+
+   _glthread_LOCK_MUTEX(stats_lock);
+   phase_totals[phase].count++;
+   phase_totals[phase].time += time;
+   phase_totals[phase].allocated_bytes += allocated_bytes;
+   phase_totals[phase].ir_nodes += ir_nodes;
+   _glthread_UNLOCK_MUTEX(stats_lock);
+}
+
+void
+glsl_stats_add_pass(const char *name, unsigned runs, unsigned skips,
+                    unsigned progress, int64_t time)
+{
+   if (!glsl_stats_enabled())
+      return;
+
+   _glthread_LOCK_MUTEX(stats_lock);
+
+   for (unsigned i = 0; i < MAX_STATS_PASSES; i++) {
+      if (pass_totals[i].name == NULL)
+         pass_totals[i].name = name;
+      else if (strcmp(pass_totals[i].name, name) != 0)
+         continue;
+
+      pass_totals[i].runs += runs;
+      pass_totals[i].skips += skips;
+      pass_totals[i].progress += progress;
+      pass_totals[i].time += time;
+      break;
+   }
+
+   _glthread_UNLOCK_MUTEX(stats_lock);
+}
@@ -0,0 +1,108 @@
+/**************************************************************************
+ *
+ * Copyright 2014 The Mesa Authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * \file glsl_stats.h
+ *
+ * Compile time statistics, gathered if MESA_GLSL contains "time".
+ *
+ * Each compile and link phase of a shader or program is reported to stderr
+ * as it ends, with its wall time, the bytes ralloc'd meanwhile and the size
+ * of the resulting IR.  Totals of each phase and of each common optimization
+ * pass are reported at exit.
+ */
+
+#ifndef GLSL_STATS_H
+#define GLSL_STATS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct exec_list;
+
+enum glsl_stats_phase {
+   GLSL_STATS_PREPROCESS,
+   GLSL_STATS_PARSE,
+   GLSL_STATS_AST_TO_HIR,
+   GLSL_STATS_COMPILE_OPTIMIZE,
+   GLSL_STATS_LINK,
+   GLSL_STATS_LINK_OPTIMIZE,
+   GLSL_STATS_BACKEND,          /**< Driver code generation at link time */
+   GLSL_STATS_NUM_PHASES
+};
+
+struct glsl_stats_timer {
+   int64_t start;               /**< in nanoseconds */
+   size_t allocated_bytes;      /**< ralloc_allocated_bytes() at the start */
+};
+
+/**
+ * Return whether statistics are gathered.
+ */
+bool
+glsl_stats_enabled(void);
+
+/**
+ * Return a monotonic time in nanoseconds.
+ */
+int64_t
+glsl_stats_time(void);
+
+void
+glsl_stats_begin(struct glsl_stats_timer *timer);
+
+/**
+ * Record and report a phase of compiling shader or linking program \c name
+ * which began at \c timer.
+ *
+ * \param kind  "program", or the stage of the shader
+ * \param ir    the IR the phase resulted in, or NULL
+ */
+void
+glsl_stats_end(const struct glsl_stats_timer *timer,
+               enum glsl_stats_phase phase,
+               const char *kind, unsigned name,
+               struct exec_list *ir);
+
+/**
+ * Add the statistics of a run of do_common_optimization_loop() to the
+ * totals of pass \c name, which must be a string literal.
+ */
+void
+glsl_stats_add_pass(const char *name, unsigned runs, unsigned skips,
+                    unsigned progress, int64_t time);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* GLSL_STATS_H */
@@ -28,14 +28,159 @@
 #include "glsl_parser_extras.h"
 #include "glsl_types.h"
 extern "C" {
-#include "program/hash_table.h"
+#include "main/hash_table.h"
 }
 
-hash_table *glsl_type::array_types = NULL;
-hash_table *glsl_type::record_types = NULL;
-hash_table *glsl_type::interface_types = NULL;
+glsl_type_table *volatile glsl_type::array_types = NULL;
+glsl_type_table *volatile glsl_type::record_types = NULL;
+glsl_type_table *volatile glsl_type::interface_types = NULL;
 void *glsl_type::mem_ctx = NULL;
 
+/**
+ * Protects mem_ctx and updates of the type tables, so that shaders can be
+ * compiled and linked on several threads at once.
+ */
+_glthread_DECLARE_STATIC_MUTEX(glsl_type_lock);
+
+/**
+ * Lock-free searches need the stores to the type tables to become visible
+ * in order.  Without a way to order them, searches take the mutex.
+ */
+#if defined(__GNUC__)
+#define TYPE_TABLE_LOCKLESS_SEARCH 1
+#define type_table_write_barrier() __sync_synchronize()
+#else
+#define TYPE_TABLE_LOCKLESS_SEARCH 0
+#define type_table_write_barrier()
+#endif
+
+/**
+ * An insert-only open addressing table of derived types, which is searched
+ * without taking glsl_type_lock.
+ *
+ * Slots are only written with the lock held, and a type is completely
+ * constructed before its pointer is stored into a slot.  When the table
+ * grows, the old one may still be searched by other threads, so it's kept
+ * as a ralloc child of the new one until the types are released.  Types
+ * are never removed, so a search of an old table at worst misses a type
+ * which is then found again with the lock held.
+ */
+struct glsl_type_table_slot {
+   unsigned hash;
+   const glsl_type *volatile type;   /**< NULL if the slot is free */
+};
+
+struct glsl_type_table {
+   unsigned size;       /**< Number of slots, a power of two */
+   unsigned entries;    /**< Number of slots in use, at most size / 2 */
+   glsl_type_table_slot *slots;
+};
+
+typedef bool (*type_key_equal_func)(const glsl_type *type, const void *key);
+
+static const glsl_type *
+type_table_search(const glsl_type_table *table, unsigned hash,
+                  type_key_equal_func key_equal, const void *key)
+{
+   if (table == NULL)
+      return NULL;
+
+   const unsigned mask = table->size - 1;
+
+   for (unsigned i = hash & mask; ; i = (i + 1) & mask) {
+      const glsl_type *const t = table->slots[i].type;
+
+      if (t == NULL)
+         return NULL;
+
+      if (table->slots[i].hash == hash && key_equal(t, key))
+         return t;
+   }
+}
+
+/**
+ * Store type into a slot of table, which must have a free one.
+ */
+static void
+type_table_store(glsl_type_table *table, unsigned hash, const glsl_type *type)
+{
+   const unsigned mask = table->size - 1;
+   unsigned i = hash & mask;
+
+   while (table->slots[i].type != NULL)
+      i = (i + 1) & mask;
+
+   table->slots[i].hash = hash;
+   type_table_write_barrier();
+   table->slots[i].type = type;
+   table->entries++;
+}
+
+/**
+ * Look up the type matching key in *table, without taking the lock when
+ * possible.
+ */
+static const glsl_type *
+find_type(glsl_type_table *volatile *table, unsigned hash,
+          type_key_equal_func key_equal, const void *key)
+{
+#if TYPE_TABLE_LOCKLESS_SEARCH
+   return type_table_search(*table, hash, key_equal, key);
+#else
+   _glthread_LOCK_MUTEX(glsl_type_lock);
+   const glsl_type *const t = type_table_search(*table, hash, key_equal, key);
+   _glthread_UNLOCK_MUTEX(glsl_type_lock);
+   return t;
+#endif
+}
+
+/**
+ * Add type, which matches key, to *table.
+ *
+ * Another thread may have added a type matching the same key meanwhile, in
+ * which case that one is returned instead and type is dropped.
+ */
+static const glsl_type *
+add_type(glsl_type_table *volatile *table, unsigned hash,
+         type_key_equal_func key_equal, const void *key,
+         const glsl_type *type)
+{
+   _glthread_LOCK_MUTEX(glsl_type_lock);
+
+   glsl_type_table *old_table = *table;
+   const glsl_type *t = type_table_search(old_table, hash, key_equal, key);
+
+   if (t == NULL) {
+      if (old_table == NULL || (old_table->entries + 1) * 2 > old_table->size) {
+         glsl_type_table *const new_table = rzalloc(NULL, glsl_type_table);
+
+         new_table->size = old_table ? old_table->size * 2 : 64;
+         new_table->slots = rzalloc_array(new_table, glsl_type_table_slot,
+                                          new_table->size);
+
+         if (old_table != NULL) {
+            for (unsigned i = 0; i < old_table->size; i++) {
+               if (old_table->slots[i].type != NULL)
+                  type_table_store(new_table, old_table->slots[i].hash,
+                                   old_table->slots[i].type);
+            }
+
+            ralloc_steal(new_table, old_table);
+         }
+
+         type_table_write_barrier();
+         *table = new_table;
+      }
+
+      type_table_store(*table, hash, type);
+      t = type;
+   }
+
+   _glthread_UNLOCK_MUTEX(glsl_type_lock);
+
+   return t;
+}
+
 void
 glsl_type::init_ralloc_type_ctx(void)
 {
@@ -45,6 +190,34 @@ glsl_type::init_ralloc_type_ctx(void)
    }
 }
 
+void *
+glsl_type::operator new(size_t size)
+{
+   void *type;
+
+   _glthread_LOCK_MUTEX(glsl_type_lock);
+
+   if (glsl_type::mem_ctx == NULL) {
+      glsl_type::mem_ctx = ralloc_context(NULL);
+      assert(glsl_type::mem_ctx != NULL);
+   }
+
+   type = ralloc_size(glsl_type::mem_ctx, size);
+   assert(type != NULL);
+
+   _glthread_UNLOCK_MUTEX(glsl_type_lock);
+
+   return type;
+}
+
+void
+glsl_type::operator delete(void *type)
+{
+   _glthread_LOCK_MUTEX(glsl_type_lock);
+   ralloc_free(type);
+   _glthread_UNLOCK_MUTEX(glsl_type_lock);
+}
+
 glsl_type::glsl_type(GLenum gl_type,
 		     glsl_base_type base_type, unsigned vector_elements,
 		     unsigned matrix_columns, const char *name) :
@@ -55,9 +228,11 @@ glsl_type::glsl_type(GLenum gl_type,
    vector_elements(vector_elements), matrix_columns(matrix_columns),
    length(0)
 {
+   _glthread_LOCK_MUTEX(glsl_type_lock);
    init_ralloc_type_ctx();
    assert(name != NULL);
    this->name = ralloc_strdup(this->mem_ctx, name);
+   _glthread_UNLOCK_MUTEX(glsl_type_lock);
    /* Neither dimension is zero or both dimensions are zero.
     */
    assert((vector_elements == 0) == (matrix_columns == 0));
@@ -73,9 +248,11 @@ glsl_type::glsl_type(GLenum gl_type, glsl_base_type base_type,
    sampler_array(array), sampler_type(type), interface_packing(0),
    length(0)
 {
+   _glthread_LOCK_MUTEX(glsl_type_lock);
    init_ralloc_type_ctx();
    assert(name != NULL);
    this->name = ralloc_strdup(this->mem_ctx, name);
+   _glthread_UNLOCK_MUTEX(glsl_type_lock);
    memset(& fields, 0, sizeof(fields));
 
    if (base_type == GLSL_TYPE_SAMPLER) {
@@ -97,6 +274,7 @@ glsl_type::glsl_type(const glsl_struct_field *fields, unsigned num_fields,
 {
    unsigned int i;
 
+   _glthread_LOCK_MUTEX(glsl_type_lock);
    init_ralloc_type_ctx();
    assert(name != NULL);
    this->name = ralloc_strdup(this->mem_ctx, name);
@@ -112,6 +290,7 @@ glsl_type::glsl_type(const glsl_struct_field *fields, unsigned num_fields,
       this->fields.structure[i].sample = fields[i].sample;
       this->fields.structure[i].row_major = fields[i].row_major;
    }
+   _glthread_UNLOCK_MUTEX(glsl_type_lock);
 }
 
 glsl_type::glsl_type(const glsl_struct_field *fields, unsigned num_fields,
@@ -125,6 +304,7 @@ glsl_type::glsl_type(const glsl_struct_field *fields, unsigned num_fields,
 {
    unsigned int i;
 
+   _glthread_LOCK_MUTEX(glsl_type_lock);
    init_ralloc_type_ctx();
    assert(name != NULL);
    this->name = ralloc_strdup(this->mem_ctx, name);
@@ -140,6 +320,7 @@ glsl_type::glsl_type(const glsl_struct_field *fields, unsigned num_fields,
       this->fields.structure[i].sample = fields[i].sample;
       this->fields.structure[i].row_major = fields[i].row_major;
    }
+   _glthread_UNLOCK_MUTEX(glsl_type_lock);
 }
 
 
@@ -287,15 +468,18 @@ const glsl_type *glsl_type::get_scalar_type() const
 void
 _mesa_glsl_release_types(void)
 {
-   if (glsl_type::array_types != NULL) {
-      hash_table_dtor(glsl_type::array_types);
-      glsl_type::array_types = NULL;
-   }
+   _glthread_LOCK_MUTEX(glsl_type_lock);
 
-   if (glsl_type::record_types != NULL) {
-      hash_table_dtor(glsl_type::record_types);
-      glsl_type::record_types = NULL;
-   }
+   ralloc_free(glsl_type::array_types);
+   glsl_type::array_types = NULL;
+
+   ralloc_free(glsl_type::record_types);
+   glsl_type::record_types = NULL;
+
+   ralloc_free(glsl_type::interface_types);
+   glsl_type::interface_types = NULL;
+
+   _glthread_UNLOCK_MUTEX(glsl_type_lock);
 }
 
 
@@ -318,7 +502,10 @@ glsl_type::glsl_type(const glsl_type *array, unsigned length) :
     * NUL.
     */
    const unsigned name_length = strlen(array->name) + 10 + 3;
+
+   _glthread_LOCK_MUTEX(glsl_type_lock);
    char *const n = (char *) ralloc_size(this->mem_ctx, name_length);
+   _glthread_UNLOCK_MUTEX(glsl_type_lock);
 
    if (length == 0)
       snprintf(n, name_length, "%s[]", array->name);
@@ -451,28 +638,40 @@ glsl_type::get_instance(unsigned base_type, unsigned rows, unsigned columns)
 }
 
 
-const glsl_type *
-glsl_type::get_array_instance(const glsl_type *base, unsigned array_size)
+namespace {
+
+struct array_type_key {
+   const glsl_type *base;
+   unsigned length;
+};
+
+} /* anonymous namespace */
+
+static bool
+array_type_key_equal(const glsl_type *type, const void *data)
 {
+   const array_type_key *const key = (const array_type_key *) data;
+
+   return type->fields.array == key->base && type->length == key->length;
+}
 
-   if (array_types == NULL) {
-      array_types = hash_table_ctor(64, hash_table_string_hash,
-				    hash_table_string_compare);
-   }
 
-   /* Generate a name using the base type pointer in the key.  This is
-    * done because the name of the base type may not be unique across
-    * shaders.  For example, two shaders may have different record types
-    * named 'foo'.
+const glsl_type *
+glsl_type::get_array_instance(const glsl_type *base, unsigned array_size)
+{
+   /* Key the array type on the base type pointer.  The name of the base
+    * type may not be unique across shaders.  For example, two shaders may
+    * have different record types named 'foo'.
     */
-   char key[128];
-   snprintf(key, sizeof(key), "%p[%u]", (void *) base, array_size);
+   const array_type_key key = { base, array_size };
+   const unsigned hash = _mesa_hash_pointer(base) ^ (array_size * 0x9e3779b1u);
 
-   const glsl_type *t = (glsl_type *) hash_table_find(array_types, key);
+   const glsl_type *t = find_type(&array_types, hash,
+                                  array_type_key_equal, &key);
    if (t == NULL) {
-      t = new glsl_type(base, array_size);
-
-      hash_table_insert(array_types, (void *) t, ralloc_strdup(mem_ctx, key));
+      /* The constructor takes the lock itself. */
+      t = add_type(&array_types, hash, array_type_key_equal, &key,
+                   new glsl_type(base, array_size));
    }
 
    assert(t->base_type == GLSL_TYPE_ARRAY);
@@ -483,35 +682,24 @@ glsl_type::get_array_instance(const glsl_type *base, unsigned array_size)
 }
 
 
-bool
-glsl_type::record_compare(const glsl_type *b) const
+static bool
+struct_fields_equal(const glsl_struct_field *a, const glsl_struct_field *b,
+                    unsigned length)
 {
-   if (this->length != b->length)
-      return false;
-
-   if (this->interface_packing != b->interface_packing)
-      return false;
-
-   for (unsigned i = 0; i < this->length; i++) {
-      if (this->fields.structure[i].type != b->fields.structure[i].type)
-	 return false;
-      if (strcmp(this->fields.structure[i].name,
-		 b->fields.structure[i].name) != 0)
-	 return false;
-      if (this->fields.structure[i].row_major
-         != b->fields.structure[i].row_major)
-        return false;
-      if (this->fields.structure[i].location
-          != b->fields.structure[i].location)
+   for (unsigned i = 0; i < length; i++) {
+      if (a[i].type != b[i].type)
+         return false;
+      if (strcmp(a[i].name, b[i].name) != 0)
+         return false;
+      if (a[i].row_major != b[i].row_major)
+         return false;
+      if (a[i].location != b[i].location)
          return false;
-      if (this->fields.structure[i].interpolation
-          != b->fields.structure[i].interpolation)
+      if (a[i].interpolation != b[i].interpolation)
          return false;
-      if (this->fields.structure[i].centroid
-          != b->fields.structure[i].centroid)
+      if (a[i].centroid != b[i].centroid)
          return false;
-      if (this->fields.structure[i].sample
-          != b->fields.structure[i].sample)
+      if (a[i].sample != b[i].sample)
          return false;
    }
 
@@ -519,40 +707,56 @@ glsl_type::record_compare(const glsl_type *b) const
 }
 
 
-int
-glsl_type::record_key_compare(const void *a, const void *b)
+bool
+glsl_type::record_compare(const glsl_type *b) const
 {
-   const glsl_type *const key1 = (glsl_type *) a;
-   const glsl_type *const key2 = (glsl_type *) b;
+   if (this->length != b->length)
+      return false;
 
-   /* Return zero is the types match (there is zero difference) or non-zero
-    * otherwise.
-    */
-   if (strcmp(key1->name, key2->name) != 0)
-      return 1;
+   if (this->interface_packing != b->interface_packing)
+      return false;
 
-   return !key1->record_compare(key2);
+   return struct_fields_equal(this->fields.structure, b->fields.structure,
+                              this->length);
 }
 
 
-unsigned
-glsl_type::record_key_hash(const void *a)
+namespace {
+
+/**
+ * Key of record and interface types, which are looked up without building
+ * a glsl_type for the key.
+ */
+struct struct_type_key {
+   const glsl_struct_field *fields;
+   unsigned num_fields;
+   unsigned packing;
+   const char *name;
+};
+
+} /* anonymous namespace */
+
+static unsigned
+struct_type_key_hash(const struct_type_key *key)
 {
-   const glsl_type *const key = (glsl_type *) a;
-   char hash_key[128];
-   unsigned size = 0;
+   unsigned hash = _mesa_hash_string(key->name) ^ key->num_fields;
 
-   size = snprintf(hash_key, sizeof(hash_key), "%08x", key->length);
+   for (unsigned i = 0; i < key->num_fields; i++)
+      hash = hash * 31 + _mesa_hash_pointer(key->fields[i].type);
 
-   for (unsigned i = 0; i < key->length; i++) {
-      if (size >= sizeof(hash_key))
-	 break;
+   return hash;
+}
 
-      size += snprintf(& hash_key[size], sizeof(hash_key) - size,
-		       "%p", (void *) key->fields.structure[i].type);
-   }
+static bool
+struct_type_key_equal(const glsl_type *type, const void *data)
+{
+   const struct_type_key *const key = (const struct_type_key *) data;
 
-   return hash_table_string_hash(& hash_key);
+   return type->length == key->num_fields &&
+          type->interface_packing == key->packing &&
+          strcmp(type->name, key->name) == 0 &&
+          struct_fields_equal(type->fields.structure, key->fields,
+                              key->num_fields);
 }
 
 
@@ -561,17 +765,14 @@ glsl_type::get_record_instance(const glsl_struct_field *fields,
 			       unsigned num_fields,
 			       const char *name)
 {
-   const glsl_type key(fields, num_fields, name);
+   const struct_type_key key = { fields, num_fields, 0, name };
+   const unsigned hash = struct_type_key_hash(&key);
 
-   if (record_types == NULL) {
-      record_types = hash_table_ctor(64, record_key_hash, record_key_compare);
-   }
-
-   const glsl_type *t = (glsl_type *) hash_table_find(record_types, & key);
+   const glsl_type *t = find_type(&record_types, hash,
+                                  struct_type_key_equal, &key);
    if (t == NULL) {
-      t = new glsl_type(fields, num_fields, name);
-
-      hash_table_insert(record_types, (void *) t, t);
+      t = add_type(&record_types, hash, struct_type_key_equal, &key,
+                   new glsl_type(fields, num_fields, name));
    }
 
    assert(t->base_type == GLSL_TYPE_STRUCT);
@@ -588,17 +789,15 @@ glsl_type::get_interface_instance(const glsl_struct_field *fields,
 				  enum glsl_interface_packing packing,
 				  const char *block_name)
 {
-   const glsl_type key(fields, num_fields, packing, block_name);
+   const struct_type_key key = { fields, num_fields, (unsigned) packing,
+                                 block_name };
+   const unsigned hash = struct_type_key_hash(&key);
 
-   if (interface_types == NULL) {
-      interface_types = hash_table_ctor(64, record_key_hash, record_key_compare);
-   }
-
-   const glsl_type *t = (glsl_type *) hash_table_find(interface_types, & key);
+   const glsl_type *t = find_type(&interface_types, hash,
+                                  struct_type_key_equal, &key);
    if (t == NULL) {
-      t = new glsl_type(fields, num_fields, packing, block_name);
-
-      hash_table_insert(interface_types, (void *) t, t);
+      t = add_type(&interface_types, hash, struct_type_key_equal, &key,
+                   new glsl_type(fields, num_fields, packing, block_name));
    }
 
    assert(t->base_type == GLSL_TYPE_INTERFACE);
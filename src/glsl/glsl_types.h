@@ -36,6 +36,7 @@ extern "C" {
 
 struct _mesa_glsl_parse_state;
 struct glsl_symbol_table;
+struct glsl_type_table;
 
 extern void
 _mesa_glsl_initialize_types(struct _mesa_glsl_parse_state *state);
@@ -99,27 +100,11 @@ struct glsl_type {
 
    /* Callers of this ralloc-based new need not call delete. It's
     * easier to just ralloc_free 'mem_ctx' (or any of its ancestors). */
-   static void* operator new(size_t size)
-   {
-      if (glsl_type::mem_ctx == NULL) {
-	 glsl_type::mem_ctx = ralloc_context(NULL);
-	 assert(glsl_type::mem_ctx != NULL);
-      }
-
-      void *type;
-
-      type = ralloc_size(glsl_type::mem_ctx, size);
-      assert(type != NULL);
-
-      return type;
-   }
+   static void* operator new(size_t size);
 
    /* If the user *does* call delete, that's OK, we will just
     * ralloc_free in that case. */
-   static void operator delete(void *type)
-   {
-      ralloc_free(type);
-   }
+   static void operator delete(void *type);
 
    /**
     * \name Vector and matrix element counts
@@ -597,17 +582,14 @@ private:
    /** Constructor for array types */
    glsl_type(const glsl_type *array, unsigned length);
 
-   /** Hash table containing the known array types. */
-   static struct hash_table *array_types;
-
-   /** Hash table containing the known record types. */
-   static struct hash_table *record_types;
+   /** Table containing the known array types. */
+   static struct glsl_type_table *volatile array_types;
 
-   /** Hash table containing the known interface types. */
-   static struct hash_table *interface_types;
+   /** Table containing the known record types. */
+   static struct glsl_type_table *volatile record_types;
 
-   static int record_key_compare(const void *a, const void *b);
-   static unsigned record_key_hash(const void *key);
+   /** Table containing the known interface types. */
+   static struct glsl_type_table *volatile interface_types;
 
    /**
     * \name Built-in type flyweights
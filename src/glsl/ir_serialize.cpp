@@ -0,0 +1,1260 @@
+/**************************************************************************
+ *
+ * Copyright 2014 The Mesa Authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * \file ir_serialize.cpp
+ *
+ * The IR is written as a pre-order walk of the instruction tree.  Each
+ * node starts with its ir_node_type, ir_type_unset standing for a NULL
+ * rvalue, and instruction lists are written as a count followed by the
+ * nodes.
+ *
+ * Variables and function signatures are referenced from several places
+ * in the tree, so they're numbered.  The first reference to each one,
+ * wherever that is, also carries its definition; later references only
+ * carry the number.  Declarations in instruction lists are just another
+ * kind of reference, so variables may be used before they're declared.
+ *
+ * Types are numbered the same way, except that built-in types are
+ * identified by their index in builtin_type_macros.h and array types are
+ * written out in full every time.
+ */
+
+#include "ir.h"
+#include "ir_serialize.h"
+#include "glsl_types.h"
+#include "program/hash_table.h"
+
+#define IR_SERIALIZE_MAGIC   0x53524947  /* "GIRS" */
+#define IR_SERIALIZE_VERSION 1
+
+/**
+ * Type encodings, in the low bits of the first word of each type.
+ */
+enum type_encoding {
+   TYPE_BUILTIN,     /**< index into get_builtin_types() */
+   TYPE_SEEN,        /**< number of a record or interface written before */
+   TYPE_ARRAY,       /**< followed by the element type and the length */
+   TYPE_AGGREGATE,   /**< followed by a record or interface definition */
+};
+
+#define TYPE_ENCODING_BITS 2
+#define TYPE_ENCODING_MASK ((1u << TYPE_ENCODING_BITS) - 1)
+
+/** Low bit of references to variables and signatures */
+#define REF_HAS_DEFINITION 1
+
+#define MAX_BUILTIN_TYPES 256
+
+/**
+ * Fill in the table of built-in types.
+ * \return the number of built-in types
+ */
+static unsigned
+get_builtin_types(const glsl_type **types)
+{
+   unsigned n = 0;
+
+#undef  DECL_TYPE
+#define DECL_TYPE(NAME, ...) types[n++] = glsl_type::NAME##_type;
+#undef  STRUCT_TYPE
+#define STRUCT_TYPE(NAME) types[n++] = glsl_type::struct_##NAME##_type;
+#include "builtin_type_macros.h"
+#undef  DECL_TYPE
+#undef  STRUCT_TYPE
+
+   assert(n <= MAX_BUILTIN_TYPES);
+   return n;
+}
+
+
+namespace {
+
+class ir_serializer {
+public:
+   ir_serializer(struct blob *blob)
+      : blob(blob), ok(true), num_types(0), num_objects(0)
+   {
+      this->types = hash_table_ctor(0, hash_table_pointer_hash,
+                                    hash_table_pointer_compare);
+      this->objects = hash_table_ctor(0, hash_table_pointer_hash,
+                                      hash_table_pointer_compare);
+      this->num_builtin_types = get_builtin_types(this->builtin_types);
+   }
+
+   ~ir_serializer()
+   {
+      hash_table_dtor(this->types);
+      hash_table_dtor(this->objects);
+   }
+
+   void write_list(exec_list *list);
+   void write_node(ir_instruction *ir);
+
+   void write_uint32(uint32_t value)
+   {
+      ok = blob_write_uint32(blob, value) && ok;
+   }
+
+   struct blob *blob;
+   bool ok;
+
+private:
+   void write_bytes(const void *bytes, size_t size)
+   {
+      ok = blob_write_bytes(blob, bytes, size) && ok;
+   }
+
+   void write_string(const char *str)
+   {
+      ok = blob_write_string(blob, str) && ok;
+   }
+
+   void write_optional_string(const char *str)
+   {
+      write_uint32(str != NULL);
+      if (str != NULL)
+         write_string(str);
+   }
+
+   bool begin_reference(const void *object);
+   void write_type(const glsl_type *type);
+   void write_variable(ir_variable *var);
+   void write_signature(ir_function_signature *sig);
+   void write_texture(ir_texture *tex);
+   void write_constant(ir_constant *c);
+
+   /** Encoded types already written, plus one */
+   struct hash_table *types;
+   /** Numbers of variables and signatures already written, plus one */
+   struct hash_table *objects;
+   unsigned num_types;
+   unsigned num_objects;
+
+   const glsl_type *builtin_types[MAX_BUILTIN_TYPES];
+   unsigned num_builtin_types;
+};
+
+
+class ir_deserializer {
+public:
+   ir_deserializer(void *mem_ctx, struct blob_reader *blob)
+      : mem_ctx(mem_ctx), blob(blob),
+        types(NULL), num_types(0), objects(NULL), num_objects(0),
+        objects_size(0)
+   {
+      this->num_builtin_types = get_builtin_types(this->builtin_types);
+   }
+
+   ~ir_deserializer()
+   {
+      ralloc_free(this->types);
+      ralloc_free(this->objects);
+   }
+
+   bool read_list(exec_list *list);
+   ir_instruction *read_node();
+
+   uint32_t read_uint32()
+   {
+      return blob_read_uint32(blob);
+   }
+
+   /**
+    * Flag the data as corrupt.  Reads stop at the next check of
+    * blob->overrun.
+    */
+   void *fail()
+   {
+      blob->overrun = true;
+      return NULL;
+   }
+
+private:
+   const char *read_string()
+   {
+      return blob_read_string(blob);
+   }
+
+   const char *read_optional_string()
+   {
+      return read_uint32() ? read_string() : NULL;
+   }
+
+   ir_rvalue *read_rvalue();
+   ir_rvalue *read_optional_rvalue(bool *ok);
+   ir_constant *read_constant_node();
+   ir_dereference *read_dereference();
+
+   const glsl_type *read_type();
+   void add_type(const glsl_type *type);
+   ir_variable *read_variable();
+   ir_function_signature *read_signature();
+   void *find_object(uint32_t ref, ir_node_type ir_type);
+   void add_object(ir_instruction *ir);
+   ir_texture *read_texture();
+   ir_constant *read_constant();
+
+   void *mem_ctx;
+   struct blob_reader *blob;
+
+   const glsl_type **types;
+   unsigned num_types;
+   ir_instruction **objects;
+   unsigned num_objects;
+   unsigned objects_size;   /**< allocated entries of objects */
+
+   const glsl_type *builtin_types[MAX_BUILTIN_TYPES];
+   unsigned num_builtin_types;
+};
+
+} /* anonymous namespace */
+
+
+/**
+ * Write a reference to a variable or signature.
+ * \return true if the caller must write the definition after it
+ */
+bool
+ir_serializer::begin_reference(const void *object)
+{
+   uintptr_t n = (uintptr_t) hash_table_find(this->objects, object);
+
+   if (n != 0) {
+      write_uint32((n - 1) << 1);
+      return false;
+   }
+
+   n = this->num_objects++;
+   hash_table_insert(this->objects, (void *) (n + 1), object);
+   write_uint32((n << 1) | REF_HAS_DEFINITION);
+   return true;
+}
+
+
+void
+ir_serializer::write_type(const glsl_type *type)
+{
+   uintptr_t encoded = (uintptr_t) hash_table_find(this->types, type);
+   unsigned i;
+
+   if (encoded != 0) {
+      write_uint32(encoded - 1);
+      return;
+   }
+
+   if (type->is_array()) {
+      write_uint32(TYPE_ARRAY);
+      write_type(type->fields.array);
+      write_uint32(type->length);
+      return;
+   }
+
+   for (i = 0; i < this->num_builtin_types; i++) {
+      if (this->builtin_types[i] == type) {
+         encoded = (i << TYPE_ENCODING_BITS) | TYPE_BUILTIN;
+         hash_table_insert(this->types, (void *) (encoded + 1), type);
+         write_uint32(encoded);
+         return;
+      }
+   }
+
+   /* Only records and interfaces are created outside builtin_types.cpp */
+   assert(type->is_record() || type->is_interface());
+
+   encoded = (this->num_types++ << TYPE_ENCODING_BITS) | TYPE_SEEN;
+   hash_table_insert(this->types, (void *) (encoded + 1), type);
+
+   write_uint32(TYPE_AGGREGATE);
+   write_uint32(type->base_type);
+   write_string(type->name);
+   write_uint32(type->interface_packing);
+   write_uint32(type->length);
+   for (i = 0; i < type->length; i++) {
+      const glsl_struct_field *field = &type->fields.structure[i];
+
+      write_type(field->type);
+      write_string(field->name);
+      write_uint32(field->row_major);
+      write_uint32(field->location);
+      write_uint32(field->interpolation);
+      write_uint32(field->centroid);
+      write_uint32(field->sample);
+   }
+}
+
+
+void
+ir_serializer::write_variable(ir_variable *var)
+{
+   if (!begin_reference(var))
+      return;
+
+   write_type(var->type);
+   write_optional_string(var->name);
+   write_bytes(&var->data, sizeof(var->data));
+
+   const glsl_type *ifc_type = var->get_interface_type();
+   write_uint32(ifc_type != NULL);
+   if (ifc_type != NULL) {
+      write_type(ifc_type);
+      write_uint32(var->max_ifc_array_access != NULL);
+      if (var->max_ifc_array_access != NULL) {
+         write_bytes(var->max_ifc_array_access,
+                     ifc_type->length * sizeof(unsigned));
+      }
+   }
+
+   write_uint32(var->num_state_slots);
+   if (var->num_state_slots != 0) {
+      write_bytes(var->state_slots,
+                  var->num_state_slots * sizeof(ir_state_slot));
+   }
+
+   write_optional_string(var->warn_extension);
+   write_node(var->constant_value);
+   write_node(var->constant_initializer);
+}
+
+
+void
+ir_serializer::write_signature(ir_function_signature *sig)
+{
+   if (!begin_reference(sig))
+      return;
+
+   write_type(sig->return_type);
+   write_uint32(sig->is_defined);
+   write_uint32(sig->is_intrinsic);
+   write_uint32(sig->is_builtin());
+   write_list(&sig->parameters);
+   write_list(&sig->body);
+}
+
+
+void
+ir_serializer::write_texture(ir_texture *tex)
+{
+   write_uint32(tex->op);
+   write_type(tex->type);
+   write_node(tex->sampler);
+   write_node(tex->coordinate);
+   write_node(tex->projector);
+   write_node(tex->shadow_comparitor);
+   write_node(tex->offset);
+
+   switch (tex->op) {
+   case ir_tex:
+   case ir_lod:
+   case ir_query_levels:
+      break;
+   case ir_txb:
+      write_node(tex->lod_info.bias);
+      break;
+   case ir_txl:
+   case ir_txf:
+   case ir_txs:
+      write_node(tex->lod_info.lod);
+      break;
+   case ir_txf_ms:
+      write_node(tex->lod_info.sample_index);
+      break;
+   case ir_txd:
+      write_node(tex->lod_info.grad.dPdx);
+      write_node(tex->lod_info.grad.dPdy);
+      break;
+   case ir_tg4:
+      write_node(tex->lod_info.component);
+      break;
+   }
+}
+
+
+void
+ir_serializer::write_constant(ir_constant *c)
+{
+   write_type(c->type);
+
+   if (c->type->is_array()) {
+      for (unsigned i = 0; i < c->type->length; i++)
+         write_node(c->array_elements[i]);
+   } else if (c->type->is_record()) {
+      write_list(&c->components);
+   } else {
+      write_bytes(&c->value, sizeof(c->value));
+   }
+}
+
+
+void
+ir_serializer::write_list(exec_list *list)
+{
+   unsigned count = 0;
+
+   foreach_list(node, list)
+      count++;
+
+   write_uint32(count);
+
+   foreach_list(node, list)
+      write_node((ir_instruction *) node);
+}
+
+
+void
+ir_serializer::write_node(ir_instruction *ir)
+{
+   if (ir == NULL) {
+      write_uint32(ir_type_unset);
+      return;
+   }
+
+   write_uint32(ir->ir_type);
+
+   switch (ir->ir_type) {
+   case ir_type_variable:
+      write_variable((ir_variable *) ir);
+      break;
+
+   case ir_type_assignment: {
+      ir_assignment *assign = (ir_assignment *) ir;
+
+      write_node(assign->lhs);
+      write_node(assign->rhs);
+      write_node(assign->condition);
+      write_uint32(assign->write_mask);
+      break;
+   }
+
+   case ir_type_call: {
+      ir_call *call = (ir_call *) ir;
+
+      write_signature(call->callee);
+      write_node(call->return_deref);
+      write_list(&call->actual_parameters);
+      write_uint32(call->use_builtin);
+      break;
+   }
+
+   case ir_type_constant:
+      write_constant((ir_constant *) ir);
+      break;
+
+   case ir_type_dereference_array: {
+      ir_dereference_array *deref = (ir_dereference_array *) ir;
+
+      write_node(deref->array);
+      write_node(deref->array_index);
+      break;
+   }
+
+   case ir_type_dereference_record: {
+      ir_dereference_record *deref = (ir_dereference_record *) ir;
+
+      write_node(deref->record);
+      write_string(deref->field);
+      break;
+   }
+
+   case ir_type_dereference_variable:
+      write_variable(((ir_dereference_variable *) ir)->var);
+      break;
+
+   case ir_type_discard:
+      write_node(((ir_discard *) ir)->condition);
+      break;
+
+   case ir_type_expression: {
+      ir_expression *expr = (ir_expression *) ir;
+      unsigned num_operands = expr->get_num_operands();
+
+      write_uint32(expr->operation);
+      write_type(expr->type);
+      write_uint32(num_operands);
+      for (unsigned i = 0; i < num_operands; i++)
+         write_node(expr->operands[i]);
+      break;
+   }
+
+   case ir_type_function: {
+      ir_function *func = (ir_function *) ir;
+
+      write_string(func->name);
+      write_list(&func->signatures);
+      break;
+   }
+
+   case ir_type_function_signature:
+      write_signature((ir_function_signature *) ir);
+      break;
+
+   case ir_type_if: {
+      ir_if *iff = (ir_if *) ir;
+
+      write_node(iff->condition);
+      write_list(&iff->then_instructions);
+      write_list(&iff->else_instructions);
+      break;
+   }
+
+   case ir_type_loop:
+      write_list(&((ir_loop *) ir)->body_instructions);
+      break;
+
+   case ir_type_loop_jump:
+      write_uint32(((ir_loop_jump *) ir)->mode);
+      break;
+
+   case ir_type_return:
+      write_node(((ir_return *) ir)->value);
+      break;
+
+   case ir_type_swizzle: {
+      ir_swizzle *swiz = (ir_swizzle *) ir;
+
+      write_node(swiz->val);
+      write_uint32(swiz->mask.x);
+      write_uint32(swiz->mask.y);
+      write_uint32(swiz->mask.z);
+      write_uint32(swiz->mask.w);
+      write_uint32(swiz->mask.num_components);
+      break;
+   }
+
+   case ir_type_texture:
+      write_texture((ir_texture *) ir);
+      break;
+
+   case ir_type_emit_vertex:
+   case ir_type_end_primitive:
+      break;
+
+   case ir_type_unset:
+   case ir_type_max:
+      assert(!"Invalid IR node");
+      break;
+   }
+}
+
+
+void
+ir_deserializer::add_type(const glsl_type *type)
+{
+   this->types = reralloc(NULL, this->types, const glsl_type *,
+                          this->num_types + 1);
+   this->types[this->num_types++] = type;
+}
+
+
+const glsl_type *
+ir_deserializer::read_type()
+{
+   uint32_t encoded = read_uint32();
+   uint32_t index = encoded >> TYPE_ENCODING_BITS;
+
+   if (blob->overrun)
+      return NULL;
+
+   switch (encoded & TYPE_ENCODING_MASK) {
+   case TYPE_BUILTIN:
+      if (index >= this->num_builtin_types)
+         return (const glsl_type *) fail();
+      return this->builtin_types[index];
+
+   case TYPE_SEEN:
+      if (index >= this->num_types)
+         return (const glsl_type *) fail();
+      return this->types[index];
+
+   case TYPE_ARRAY: {
+      const glsl_type *element = read_type();
+      unsigned length = read_uint32();
+
+      if (element == NULL || blob->overrun)
+         return (const glsl_type *) fail();
+      return glsl_type::get_array_instance(element, length);
+   }
+
+   case TYPE_AGGREGATE:
+      break;
+   }
+
+   const glsl_type *type = NULL;
+   unsigned base_type = read_uint32();
+   const char *name = read_string();
+   unsigned packing = read_uint32();
+   unsigned length = read_uint32();
+
+   if (blob->overrun || length > (size_t) (blob->end - blob->current))
+      return (const glsl_type *) fail();
+
+   glsl_struct_field *fields = ralloc_array(NULL, glsl_struct_field, length);
+
+   for (unsigned i = 0; i < length; i++) {
+      fields[i].type = read_type();
+      fields[i].name = read_string();
+      fields[i].row_major = read_uint32();
+      fields[i].location = read_uint32();
+      fields[i].interpolation = read_uint32();
+      fields[i].centroid = read_uint32();
+      fields[i].sample = read_uint32();
+
+      if (fields[i].type == NULL)
+         fail();
+   }
+
+   if (!blob->overrun) {
+      if (base_type == GLSL_TYPE_STRUCT) {
+         type = glsl_type::get_record_instance(fields, length, name);
+      } else if (base_type == GLSL_TYPE_INTERFACE) {
+         type = glsl_type::get_interface_instance(fields, length,
+                                                  (glsl_interface_packing) packing,
+                                                  name);
+      } else {
+         fail();
+      }
+   }
+
+   ralloc_free(fields);
+
+   if (type != NULL)
+      add_type(type);
+
+   return type;
+}
+
+
+void
+ir_deserializer::add_object(ir_instruction *ir)
+{
+   if (this->num_objects == this->objects_size) {
+      this->objects_size = this->objects_size ? 2 * this->objects_size : 64;
+      this->objects = reralloc(NULL, this->objects, ir_instruction *,
+                               this->objects_size);
+   }
+
+   this->objects[this->num_objects++] = ir;
+}
+
+
+/**
+ * Look up a reference to an object without a definition.
+ */
+void *
+ir_deserializer::find_object(uint32_t ref, ir_node_type ir_type)
+{
+   uint32_t n = ref >> 1;
+
+   if (n >= this->num_objects || this->objects[n]->ir_type != ir_type)
+      return fail();
+
+   return this->objects[n];
+}
+
+
+ir_variable *
+ir_deserializer::read_variable()
+{
+   uint32_t ref = read_uint32();
+
+   if (blob->overrun)
+      return NULL;
+
+   if (!(ref & REF_HAS_DEFINITION))
+      return (ir_variable *) find_object(ref, ir_type_variable);
+
+   if ((ref >> 1) != this->num_objects)
+      return (ir_variable *) fail();
+
+   const glsl_type *type = read_type();
+   const char *name = read_optional_string();
+   ir_variable::ir_variable_data data;
+   blob_copy_bytes(blob, &data, sizeof(data));
+
+   if (type == NULL || blob->overrun)
+      return (ir_variable *) fail();
+
+   ir_variable *var =
+      new(mem_ctx) ir_variable(type, name, (ir_variable_mode) data.mode);
+   add_object(var);
+   var->data = data;
+
+   if (read_uint32()) {
+      const glsl_type *ifc_type = read_type();
+
+      if (ifc_type == NULL || !ifc_type->is_interface())
+         return (ir_variable *) fail();
+
+      /* The constructor sets up interface instances, but not members */
+      if (var->get_interface_type() == NULL)
+         var->init_interface_type(ifc_type);
+      else if (var->get_interface_type() != ifc_type)
+         return (ir_variable *) fail();
+
+      if (read_uint32()) {
+         if (var->max_ifc_array_access == NULL)
+            return (ir_variable *) fail();
+         blob_copy_bytes(blob, var->max_ifc_array_access,
+                         ifc_type->length * sizeof(unsigned));
+      }
+   }
+
+   var->num_state_slots = read_uint32();
+   if (var->num_state_slots != 0) {
+      size_t size = var->num_state_slots * sizeof(ir_state_slot);
+      const void *slots = blob_read_bytes(blob, size);
+
+      if (slots == NULL)
+         return (ir_variable *) fail();
+
+      var->state_slots = ralloc_array(var, ir_state_slot,
+                                      var->num_state_slots);
+      memcpy(var->state_slots, slots, size);
+   } else {
+      var->state_slots = NULL;
+   }
+
+   const char *warn_extension = read_optional_string();
+   if (warn_extension != NULL)
+      var->warn_extension = ralloc_strdup(var, warn_extension);
+
+   bool ok = true;
+   ir_rvalue *constant_value = read_optional_rvalue(&ok);
+   ir_rvalue *constant_initializer = read_optional_rvalue(&ok);
+   if (!ok ||
+       (constant_value && !constant_value->as_constant()) ||
+       (constant_initializer && !constant_initializer->as_constant()))
+      return (ir_variable *) fail();
+
+   var->constant_value = constant_value ? constant_value->as_constant() : NULL;
+   var->constant_initializer =
+      constant_initializer ? constant_initializer->as_constant() : NULL;
+
+   return var;
+}
+
+
+/**
+ * Availability predicate of deserialized built-in signatures.  It only has
+ * to be non-NULL: the IR has already been linked, the availability check
+ * happened before it was serialized.
+ */
+static bool
+deserialized_builtin_available(const _mesa_glsl_parse_state *)
+{
+   return true;
+}
+
+
+ir_function_signature *
+ir_deserializer::read_signature()
+{
+   uint32_t ref = read_uint32();
+
+   if (blob->overrun)
+      return NULL;
+
+   if (!(ref & REF_HAS_DEFINITION))
+      return (ir_function_signature *)
+         find_object(ref, ir_type_function_signature);
+
+   if ((ref >> 1) != this->num_objects)
+      return (ir_function_signature *) fail();
+
+   const glsl_type *return_type = read_type();
+   bool is_defined = read_uint32();
+   bool is_intrinsic = read_uint32();
+   bool is_builtin = read_uint32();
+
+   if (return_type == NULL || blob->overrun)
+      return (ir_function_signature *) fail();
+
+   ir_function_signature *sig =
+      new(mem_ctx) ir_function_signature(return_type,
+                                         is_builtin ?
+                                         deserialized_builtin_available :
+                                         NULL);
+   add_object(sig);
+   sig->is_defined = is_defined;
+   sig->is_intrinsic = is_intrinsic;
+
+   if (!read_list(&sig->parameters) || !read_list(&sig->body))
+      return NULL;
+
+   foreach_list(node, &sig->parameters) {
+      if (((ir_instruction *) node)->ir_type != ir_type_variable)
+         return (ir_function_signature *) fail();
+   }
+
+   return sig;
+}
+
+
+ir_texture *
+ir_deserializer::read_texture()
+{
+   uint32_t op = read_uint32();
+   const glsl_type *type = read_type();
+
+   if (blob->overrun || op > ir_query_levels || type == NULL)
+      return (ir_texture *) fail();
+
+   ir_texture *tex = new(mem_ctx) ir_texture((ir_texture_opcode) op);
+   bool ok = true;
+
+   ir_dereference *sampler = read_dereference();
+   if (sampler == NULL)
+      return NULL;
+   tex->set_sampler(sampler, type);
+
+   tex->coordinate = read_optional_rvalue(&ok);
+   tex->projector = read_optional_rvalue(&ok);
+   tex->shadow_comparitor = read_optional_rvalue(&ok);
+   tex->offset = read_optional_rvalue(&ok);
+   if (!ok)
+      return NULL;
+
+   switch (tex->op) {
+   case ir_tex:
+   case ir_lod:
+   case ir_query_levels:
+      break;
+   case ir_txb:
+      tex->lod_info.bias = read_rvalue();
+      break;
+   case ir_txl:
+   case ir_txf:
+   case ir_txs:
+      tex->lod_info.lod = read_rvalue();
+      break;
+   case ir_txf_ms:
+      tex->lod_info.sample_index = read_rvalue();
+      break;
+   case ir_txd:
+      tex->lod_info.grad.dPdx = read_rvalue();
+      tex->lod_info.grad.dPdy = read_rvalue();
+      break;
+   case ir_tg4:
+      tex->lod_info.component = read_rvalue();
+      break;
+   }
+
+   return blob->overrun ? NULL : tex;
+}
+
+
+ir_constant *
+ir_deserializer::read_constant()
+{
+   const glsl_type *type = read_type();
+
+   if (type == NULL)
+      return (ir_constant *) fail();
+
+   if (type->is_array() || type->is_record()) {
+      exec_list values;
+      unsigned count;
+
+      if (type->is_array()) {
+         count = type->length;
+      } else {
+         count = read_uint32();
+         if (count != type->length)
+            return (ir_constant *) fail();
+      }
+
+      for (unsigned i = 0; i < count; i++) {
+         ir_constant *value = read_constant_node();
+
+         if (value == NULL)
+            return NULL;
+         values.push_tail(value);
+      }
+
+      ir_constant *c = new(mem_ctx) ir_constant(type, &values);
+
+      /* Array constants don't keep their elements in a list */
+      if (type->is_array()) {
+         foreach_list_safe(node, &values)
+            ((exec_node *) node)->remove();
+      }
+
+      return c;
+   }
+
+   if (!type->is_scalar() && !type->is_vector() && !type->is_matrix())
+      return (ir_constant *) fail();
+
+   ir_constant_data data;
+   blob_copy_bytes(blob, &data, sizeof(data));
+
+   return new(mem_ctx) ir_constant(type, &data);
+}
+
+
+/**
+ * Read a node which must be a non-NULL rvalue.
+ */
+ir_rvalue *
+ir_deserializer::read_rvalue()
+{
+   ir_instruction *ir = read_node();
+   ir_rvalue *rvalue = ir ? ir->as_rvalue() : NULL;
+
+   if (rvalue == NULL)
+      return (ir_rvalue *) fail();
+
+   return rvalue;
+}
+
+
+/**
+ * Read a node which must be an rvalue or NULL.  *ok is cleared on
+ * failure.
+ */
+ir_rvalue *
+ir_deserializer::read_optional_rvalue(bool *ok)
+{
+   ir_instruction *ir = read_node();
+
+   if (ir == NULL) {
+      if (blob->overrun)
+         *ok = false;
+      return NULL;
+   }
+
+   if (ir->as_rvalue() == NULL) {
+      *ok = false;
+      return (ir_rvalue *) fail();
+   }
+
+   return ir->as_rvalue();
+}
+
+
+ir_constant *
+ir_deserializer::read_constant_node()
+{
+   ir_instruction *ir = read_node();
+   ir_constant *c = ir ? ir->as_constant() : NULL;
+
+   if (c == NULL)
+      return (ir_constant *) fail();
+
+   return c;
+}
+
+
+ir_dereference *
+ir_deserializer::read_dereference()
+{
+   ir_instruction *ir = read_node();
+   ir_dereference *deref = ir ? ir->as_dereference() : NULL;
+
+   if (deref == NULL)
+      return (ir_dereference *) fail();
+
+   return deref;
+}
+
+
+bool
+ir_deserializer::read_list(exec_list *list)
+{
+   uint32_t count = read_uint32();
+
+   for (uint32_t i = 0; i < count && !blob->overrun; i++) {
+      ir_instruction *ir = read_node();
+
+      if (ir == NULL) {
+         fail();
+         return false;
+      }
+
+      /* Forward references put variables in the object table before
+       * their declaration is reached, but never in a list.
+       */
+      if (ir->next != NULL) {
+         fail();
+         return false;
+      }
+
+      list->push_tail(ir);
+   }
+
+   return !blob->overrun;
+}
+
+
+/**
+ * Read a node.
+ * \return NULL for ir_type_unset, or on error with blob->overrun set
+ */
+ir_instruction *
+ir_deserializer::read_node()
+{
+   uint32_t ir_type = read_uint32();
+
+   if (blob->overrun)
+      return NULL;
+
+   switch (ir_type) {
+   case ir_type_unset:
+      return NULL;
+
+   case ir_type_variable:
+      return read_variable();
+
+   case ir_type_assignment: {
+      ir_dereference *lhs = read_dereference();
+      ir_rvalue *rhs = read_rvalue();
+      bool ok = true;
+      ir_rvalue *condition = read_optional_rvalue(&ok);
+      unsigned write_mask = read_uint32();
+
+      if (lhs == NULL || rhs == NULL || !ok || blob->overrun)
+         return NULL;
+
+      return new(mem_ctx) ir_assignment(lhs, rhs, condition, write_mask);
+   }
+
+   case ir_type_call: {
+      ir_function_signature *callee = read_signature();
+      bool ok = true;
+      ir_rvalue *return_deref = read_optional_rvalue(&ok);
+      exec_list actual_parameters;
+
+      if (callee == NULL || !ok || !read_list(&actual_parameters))
+         return NULL;
+
+      if (return_deref != NULL && !return_deref->as_dereference_variable())
+         return (ir_instruction *) fail();
+
+      ir_call *call =
+         new(mem_ctx) ir_call(callee,
+                              return_deref ?
+                              return_deref->as_dereference_variable() : NULL,
+                              &actual_parameters);
+      call->use_builtin = read_uint32();
+      return call;
+   }
+
+   case ir_type_constant:
+      return read_constant();
+
+   case ir_type_dereference_array: {
+      ir_rvalue *array = read_rvalue();
+      ir_rvalue *array_index = read_rvalue();
+
+      if (array == NULL || array_index == NULL)
+         return NULL;
+
+      return new(mem_ctx) ir_dereference_array(array, array_index);
+   }
+
+   case ir_type_dereference_record: {
+      ir_rvalue *record = read_rvalue();
+      const char *field = read_string();
+
+      if (record == NULL || field == NULL)
+         return NULL;
+
+      if (!record->type->is_record() && !record->type->is_interface())
+         return (ir_instruction *) fail();
+
+      return new(mem_ctx) ir_dereference_record(record, field);
+   }
+
+   case ir_type_dereference_variable: {
+      ir_variable *var = read_variable();
+
+      if (var == NULL)
+         return NULL;
+
+      return new(mem_ctx) ir_dereference_variable(var);
+   }
+
+   case ir_type_discard: {
+      bool ok = true;
+      ir_rvalue *condition = read_optional_rvalue(&ok);
+
+      if (!ok)
+         return NULL;
+
+      return new(mem_ctx) ir_discard(condition);
+   }
+
+   case ir_type_expression: {
+      uint32_t op = read_uint32();
+      const glsl_type *type = read_type();
+      uint32_t num_operands = read_uint32();
+      ir_rvalue *operands[4] = { NULL, NULL, NULL, NULL };
+
+      if (blob->overrun || type == NULL || op > ir_last_opcode ||
+          num_operands > 4)
+         return (ir_instruction *) fail();
+
+      for (unsigned i = 0; i < num_operands; i++) {
+         operands[i] = read_rvalue();
+         if (operands[i] == NULL)
+            return NULL;
+      }
+
+      ir_expression *expr =
+         new(mem_ctx) ir_expression(op, type, operands[0], operands[1],
+                                    operands[2], operands[3]);
+
+      if (expr->get_num_operands() != num_operands)
+         return (ir_instruction *) fail();
+
+      return expr;
+   }
+
+   case ir_type_function: {
+      const char *name = read_string();
+      uint32_t count = read_uint32();
+
+      if (name == NULL || blob->overrun)
+         return NULL;
+
+      ir_function *func = new(mem_ctx) ir_function(name);
+
+      for (uint32_t i = 0; i < count; i++) {
+         if (read_uint32() != ir_type_function_signature)
+            return (ir_instruction *) fail();
+
+         ir_function_signature *sig = read_signature();
+         if (sig == NULL)
+            return NULL;
+
+         if (sig->function() != NULL)
+            return (ir_instruction *) fail();
+
+         func->add_signature(sig);
+      }
+
+      return func;
+   }
+
+   case ir_type_if: {
+      ir_rvalue *condition = read_rvalue();
+
+      if (condition == NULL)
+         return NULL;
+
+      ir_if *iff = new(mem_ctx) ir_if(condition);
+
+      if (!read_list(&iff->then_instructions) ||
+          !read_list(&iff->else_instructions))
+         return NULL;
+
+      return iff;
+   }
+
+   case ir_type_loop: {
+      ir_loop *loop = new(mem_ctx) ir_loop();
+
+      if (!read_list(&loop->body_instructions))
+         return NULL;
+
+      return loop;
+   }
+
+   case ir_type_loop_jump: {
+      uint32_t mode = read_uint32();
+
+      if (mode != ir_loop_jump::jump_break &&
+          mode != ir_loop_jump::jump_continue)
+         return (ir_instruction *) fail();
+
+      return new(mem_ctx) ir_loop_jump((ir_loop_jump::jump_mode) mode);
+   }
+
+   case ir_type_return: {
+      bool ok = true;
+      ir_rvalue *value = read_optional_rvalue(&ok);
+
+      if (!ok)
+         return NULL;
+
+      return new(mem_ctx) ir_return(value);
+   }
+
+   case ir_type_swizzle: {
+      ir_rvalue *val = read_rvalue();
+      unsigned x = read_uint32();
+      unsigned y = read_uint32();
+      unsigned z = read_uint32();
+      unsigned w = read_uint32();
+      unsigned count = read_uint32();
+
+      if (val == NULL || blob->overrun ||
+          x > 3 || y > 3 || z > 3 || w > 3 || count < 1 || count > 4)
+         return (ir_instruction *) fail();
+
+      return new(mem_ctx) ir_swizzle(val, x, y, z, w, count);
+   }
+
+   case ir_type_texture:
+      return read_texture();
+
+   case ir_type_emit_vertex:
+      return new(mem_ctx) ir_emit_vertex();
+
+   case ir_type_end_primitive:
+      return new(mem_ctx) ir_end_primitive();
+
+   default:
+      return (ir_instruction *) fail();
+   }
+}
+
+
+bool
+serialize_ir(struct blob *blob, struct exec_list *ir)
+{
+   ir_serializer s(blob);
+
+   s.write_uint32(IR_SERIALIZE_MAGIC);
+   s.write_uint32(IR_SERIALIZE_VERSION);
+   s.write_list(ir);
+
+   return s.ok;
+}
+
+
+bool
+deserialize_ir(void *mem_ctx, struct blob_reader *blob, struct exec_list *ir)
+{
+   ir_deserializer d(mem_ctx, blob);
+
+   if (d.read_uint32() != IR_SERIALIZE_MAGIC ||
+       d.read_uint32() != IR_SERIALIZE_VERSION)
+      return false;
+
+   return d.read_list(ir);
+}
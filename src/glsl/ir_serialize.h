@@ -0,0 +1,65 @@
+/**************************************************************************
+ *
+ * Copyright 2014 The Mesa Authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * \file ir_serialize.h
+ *
+ * Serialization of GLSL IR into a flat binary blob, and back.
+ *
+ * This is the building block for caching compiled shaders, e.g. for
+ * ARB_get_program_binary: the IR of a linked shader can be written out
+ * after linking, and reconstructed later without running the compiler
+ * front-end or the linker again.
+ */
+
+#ifndef IR_SERIALIZE_H
+#define IR_SERIALIZE_H
+
+#include "blob.h"
+
+struct exec_list;
+
+/**
+ * Append the IR instructions in \c ir to the blob.
+ * \return false if out of memory
+ */
+bool
+serialize_ir(struct blob *blob, struct exec_list *ir);
+
+/**
+ * Read IR written by serialize_ir() from the blob and append it to \c ir.
+ *
+ * The new instructions are allocated out of \c mem_ctx.
+ *
+ * \return false if the data is truncated, corrupt, or was written by an
+ *         incompatible version of Mesa.  Some instructions may have been
+ *         added to \c ir in that case; they should be freed with mem_ctx.
+ */
+bool
+deserialize_ir(void *mem_ctx, struct blob_reader *blob, struct exec_list *ir);
+
+#endif /* IR_SERIALIZE_H */
@@ -74,6 +74,8 @@
 #include "link_varyings.h"
 #include "ir_optimization.h"
 #include "ir_rvalue_visitor.h"
+#include "c11/threads.h"
+#include "glsl_stats.h"
 
 extern "C" {
 #include "main/shaderobj.h"
@@ -1497,7 +1499,9 @@ link_intrastage_shaders(void *mem_ctx,
       memcpy(linking_shaders, shader_list, num_shaders * sizeof(gl_shader *));
       linking_shaders[num_shaders] = _mesa_glsl_get_builtin_function_shader();
 
+      _mesa_glsl_lock_builtin_functions();
       ok = link_function_calls(prog, linked, linking_shaders, num_shaders + 1);
+      _mesa_glsl_unlock_builtin_functions();
 
       free(linking_shaders);
    } else {
@@ -2071,11 +2075,85 @@ check_image_resources(struct gl_context *ctx, struct gl_shader_program *prog)
       linker_error(prog, "Too many combined image uniforms and fragment outputs");
 }
 
+struct optimize_stage_job {
+   exec_list *ir;
+   const struct gl_shader_compiler_options *options;
+   gl_shader_stage stage;
+   unsigned name;              /**< of the program, for MESA_GLSL=time */
+};
+
+static void
+optimize_stage(const struct optimize_stage_job *job)
+{
+   struct glsl_stats_timer timer;
+
+   glsl_stats_begin(&timer);
+   do_common_optimization_loop(job->ir, true, false,
+                               job->options->MaxUnrollIterations,
+                               job->options);
+   glsl_stats_end(&timer, GLSL_STATS_LINK_OPTIMIZE,
+                  _mesa_shader_stage_to_string(job->stage), job->name,
+                  job->ir);
+}
+
+static int
+optimize_stage_thread(void *data)
+{
+   optimize_stage((const struct optimize_stage_job *) data);
+   return 0;
+}
+
+/**
+ * Run the common optimization loop on each linked stage.
+ *
+ * Once the stages have been cross validated their IR is independent, so
+ * the stages are optimized in parallel, the first one on the calling
+ * thread.  Nothing in here may report link errors, as prog->InfoLog isn't
+ * safe to append to from several threads.
+ */
+static void
+optimize_linked_shaders(struct gl_context *ctx, struct gl_shader_program *prog)
+{
+   struct optimize_stage_job jobs[MESA_SHADER_STAGES];
+   thrd_t threads[MESA_SHADER_STAGES];
+   bool started[MESA_SHADER_STAGES];
+   unsigned n = 0;
+
+   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
+      if (prog->_LinkedShaders[i] == NULL)
+	 continue;
+
+      jobs[n].ir = prog->_LinkedShaders[i]->ir;
+      jobs[n].options = &ctx->ShaderCompilerOptions[i];
+      jobs[n].stage = (gl_shader_stage) i;
+      jobs[n].name = prog->Name;
+      n++;
+   }
+
+   for (unsigned i = 1; i < n; i++) {
+      started[i] = thrd_create(&threads[i], optimize_stage_thread,
+                               &jobs[i]) == thrd_success;
+   }
+
+   if (n > 0)
+      optimize_stage(&jobs[0]);
+
+   for (unsigned i = 1; i < n; i++) {
+      if (started[i])
+         thrd_join(threads[i], NULL);
+      else
+         optimize_stage(&jobs[i]);
+   }
+}
+
 void
 link_shaders(struct gl_context *ctx, struct gl_shader_program *prog)
 {
    tfeedback_decl *tfeedback_decls = NULL;
    unsigned num_tfeedback_decls = prog->TransformFeedback.NumVarying;
+   struct glsl_stats_timer timer;
+
+   glsl_stats_begin(&timer);
 
    void *mem_ctx = ralloc_context(NULL); // temporary linker context
 
@@ -2277,13 +2355,10 @@ link_shaders(struct gl_context *ctx, struct gl_shader_program *prog)
       if (ctx->ShaderCompilerOptions[i].LowerClipDistance) {
          lower_clip_distance(prog->_LinkedShaders[i]);
       }
-
-      unsigned max_unroll = ctx->ShaderCompilerOptions[i].MaxUnrollIterations;
-
-      while (do_common_optimization(prog->_LinkedShaders[i]->ir, true, false, max_unroll, &ctx->ShaderCompilerOptions[i]))
-	 ;
    }
 
+   optimize_linked_shaders(ctx, prog);
+
    /* Mark all generic shader inputs and outputs as unpaired. */
    if (prog->_LinkedShaders[MESA_SHADER_VERTEX] != NULL) {
       link_invalidate_variable_locations(
@@ -2479,4 +2554,6 @@ done:
    }
 
    ralloc_free(mem_ctx);
+
+   glsl_stats_end(&timer, GLSL_STATS_LINK, "program", prog->Name, NULL);
 }
@@ -24,20 +24,24 @@
 #include "glsl_types.h"
 #include "loop_analysis.h"
 #include "ir_hierarchical_visitor.h"
+#include "main/mtypes.h"
 
 namespace {
 
 class loop_unroll_visitor : public ir_hierarchical_visitor {
 public:
-   loop_unroll_visitor(loop_state *state, unsigned max_iterations)
+   loop_unroll_visitor(loop_state *state, unsigned max_iterations,
+                       const struct gl_shader_compiler_options *options)
    {
       this->state = state;
       this->progress = false;
       this->max_iterations = max_iterations;
+      this->options = options;
    }
 
    virtual ir_visitor_status visit_leave(ir_loop *ir);
    void simple_unroll(ir_loop *ir, int iterations);
+   void partial_unroll(ir_loop *ir, ir_instruction *terminator, int factor);
    void complex_unroll(ir_loop *ir, int iterations,
                        bool continue_from_then_branch);
    void splice_post_if_instructions(ir_if *ir_if, exec_list *splice_dest);
@@ -46,6 +50,7 @@ public:
 
    bool progress;
    unsigned max_iterations;
+   const struct gl_shader_compiler_options *options;
 };
 
 } /* anonymous namespace */
@@ -59,12 +64,12 @@ is_break(ir_instruction *ir)
 
 class loop_unroll_count : public ir_hierarchical_visitor {
 public:
-   int nodes;
+   struct gl_loop_body_cost cost;
    bool fail;
 
    loop_unroll_count(exec_list *list)
    {
-      nodes = 0;
+      memset(&cost, 0, sizeof(cost));
       fail = false;
 
       run(list);
@@ -72,13 +77,31 @@ public:
 
    virtual ir_visitor_status visit_enter(ir_assignment *ir)
    {
-      nodes++;
+      cost.Assignments++;
       return visit_continue;
    }
 
    virtual ir_visitor_status visit_enter(ir_expression *ir)
    {
-      nodes++;
+      cost.Alu++;
+      return visit_continue;
+   }
+
+   virtual ir_visitor_status visit_enter(ir_texture *ir)
+   {
+      cost.Texture++;
+      return visit_continue;
+   }
+
+   virtual ir_visitor_status visit_enter(ir_if *ir)
+   {
+      cost.Branches++;
+      return visit_continue;
+   }
+
+   virtual ir_visitor_status visit_enter(ir_call *ir)
+   {
+      cost.Calls++;
       return visit_continue;
    }
 
@@ -123,6 +146,50 @@ loop_unroll_visitor::simple_unroll(ir_loop *ir, int iterations)
 }
 
 
+/**
+ * Partially unroll a loop which does not contain any jumps besides its
+ * limiting terminator, by repeating the rest of its body \c factor times.
+ * For example, if the input is:
+ *
+ *     (loop (...terminator... ...instrs...))
+ *
+ * And the factor is 3, the output will be:
+ *
+ *     (loop (...terminator... ...instrs... ...instrs... ...instrs...))
+ *
+ * The factor must divide the iteration count, so that the terminator is
+ * evaluated after each whole number of iterations, the last of which it
+ * ends the loop after.  As the induction variable is now incremented
+ * several times a body, the loop won't be unrolled any further later.
+ */
+void
+loop_unroll_visitor::partial_unroll(ir_loop *ir, ir_instruction *terminator,
+                                    int factor)
+{
+   void *const mem_ctx = ralloc_parent(ir);
+   exec_node *const terminator_prev = terminator->get_prev();
+
+   terminator->remove();
+
+   exec_list copies;
+   copies.make_empty();
+
+   for (int i = 1; i < factor; i++) {
+      exec_list copy_list;
+
+      copy_list.make_empty();
+      clone_ir_list(mem_ctx, &copy_list, &ir->body_instructions);
+
+      copies.append_list(&copy_list);
+   }
+
+   ir->body_instructions.append_list(&copies);
+   terminator_prev->insert_after(terminator);
+
+   this->progress = true;
+}
+
+
 /**
  * Unroll a loop whose last statement is an ir_if.  If \c
  * continue_from_then_branch is true, the loop is repeated only when the
@@ -244,16 +311,11 @@ loop_unroll_visitor::visit_leave(ir_loop *ir)
 
    iterations = ls->limiting_terminator->iterations;
 
-   /* Don't try to unroll loops that have zillions of iterations either.
-    */
-   if (iterations > (int) max_iterations)
-      return visit_continue;
-
-   /* Don't try to unroll nested loops and loops with a huge body.
+   /* Don't try to unroll nested loops.
     */
    loop_unroll_count count(&ir->body_instructions);
 
-   if (count.fail || count.nodes * iterations > (int)max_iterations * 5)
+   if (count.fail)
       return visit_continue;
 
    /* Note: the limiting terminator contributes 1 to ls->num_loop_jumps.
@@ -265,6 +327,34 @@ loop_unroll_visitor::visit_leave(ir_loop *ir)
    if (predicted_num_loop_jumps > 1)
       return visit_continue;
 
+   const unsigned cost = options->LoopBodyCost
+      ? options->LoopBodyCost(&count.cost)
+      : count.cost.Alu + count.cost.Assignments;
+   const unsigned max_cost = max_iterations * 5;
+
+   /* Don't try to unroll loops that have zillions of iterations or a huge
+    * body either.  Loops without other jumps than the terminator may still
+    * have their body repeated several times.
+    */
+   if (iterations > (int) max_iterations ||
+       cost * iterations > max_cost) {
+      if (predicted_num_loop_jumps == 0 && iterations > 0) {
+         int factor = 1;
+
+         for (unsigned f = 2; f <= options->MaxPartialUnrollFactor; f++) {
+            if (f * cost > max_cost)
+               break;
+            if (iterations % f == 0)
+               factor = f;
+         }
+
+         if (factor > 1)
+            partial_unroll(ir, ls->limiting_terminator->ir, factor);
+      }
+
+      return visit_continue;
+   }
+
    if (predicted_num_loop_jumps == 0) {
       ls->limiting_terminator->ir->remove();
       simple_unroll(ir, iterations);
@@ -338,9 +428,10 @@ loop_unroll_visitor::visit_leave(ir_loop *ir)
 
 
 bool
-unroll_loops(exec_list *instructions, loop_state *ls, unsigned max_iterations)
+unroll_loops(exec_list *instructions, loop_state *ls, unsigned max_iterations,
+             const struct gl_shader_compiler_options *options)
 {
-   loop_unroll_visitor v(ls, max_iterations);
+   loop_unroll_visitor v(ls, max_iterations, options);
 
    v.run(instructions);
 
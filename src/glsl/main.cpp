@@ -21,6 +21,7 @@
  * DEALINGS IN THE SOFTWARE.
  */
 #include <getopt.h>
+#include <dirent.h>
 
 /** @file main.cpp
  *
@@ -37,6 +38,8 @@
 #include "program.h"
 #include "loop_analysis.h"
 #include "standalone_scaffolding.h"
+#include "glsl_stats.h"
+#include "c11/threads.h"
 
 static int glsl_version = 330;
 
@@ -262,6 +265,9 @@ const struct option compiler_opts[] = {
    { "dump-lir", no_argument, &dump_lir, 1 },
    { "link",     no_argument, &do_link,  1 },
    { "version",  required_argument, NULL, 'v' },
+   { "benchmark", required_argument, NULL, 'b' },
+   { "iterations", required_argument, NULL, 'i' },
+   { "threads",  required_argument, NULL, 't' },
    { NULL, 0, NULL, 0 }
 };
 
@@ -274,6 +280,7 @@ usage_fail(const char *name)
 
    const char *header =
       "usage: %s [options] <file.vert | file.geom | file.frag>\n"
+      "       %s [options] --benchmark <directory | manifest>\n"
       "\n"
       "Possible options are:\n";
    printf(header, name, name);
@@ -300,6 +307,402 @@ compile_shader(struct gl_context *ctx, struct gl_shader *shader)
    return;
 }
 
+/**
+ * Return the shader type for a file name's extension, or 0.
+ */
+static GLenum
+shader_type_for_file_name(const char *file_name)
+{
+   const unsigned len = strlen(file_name);
+   if (len < 6)
+      return 0;
+
+   const char *const ext = & file_name[len - 5];
+   if (strncmp(".vert", ext, 5) == 0 || strncmp(".glsl", ext, 5) == 0)
+      return GL_VERTEX_SHADER;
+   else if (strncmp(".geom", ext, 5) == 0)
+      return GL_GEOMETRY_SHADER;
+   else if (strncmp(".frag", ext, 5) == 0)
+      return GL_FRAGMENT_SHADER;
+   else if (strncmp(".comp", ext, 5) == 0)
+      return GL_COMPUTE_SHADER;
+   else
+      return 0;
+}
+
+
+/**
+ * \name Benchmark mode
+ *
+ * With --benchmark, each program of a corpus is compiled and linked
+ * --iterations times, optionally by several --threads each with a context
+ * of its own, and the throughput and the distribution of the time taken by
+ * each program are reported.
+ *
+ * The corpus is either a directory, in which all the shader files of the
+ * same name but for the extension make up a program, or a manifest listing
+ * the shader files of one program per line, relative to the manifest.
+ * Lines starting with '#' are ignored.
+ */
+/*@{*/
+
+struct benchmark_program {
+   const char *name;
+   unsigned num_shaders;
+   GLenum *types;
+   const char **sources;
+   int64_t *latency;            /**< of each iteration, in nanoseconds */
+   bool failed;
+};
+
+struct benchmark {
+   gl_api api;
+   struct benchmark_program *programs;
+   unsigned num_programs;
+   unsigned iterations;
+
+   mtx_t lock;
+   unsigned next_job;           /**< protected by lock */
+};
+
+static bool
+benchmark_add_shader(struct benchmark *b, struct benchmark_program *p,
+                     const char *file_name)
+{
+   const GLenum type = shader_type_for_file_name(file_name);
+   if (type == 0) {
+      printf("Unknown shader type of \"%s\".\n", file_name);
+      return false;
+   }
+
+   const char *source = load_text_file(b->programs, file_name);
+   if (source == NULL) {
+      printf("File \"%s\" does not exist.\n", file_name);
+      return false;
+   }
+
+   p->types = reralloc(b->programs, p->types, GLenum, p->num_shaders + 1);
+   p->sources = reralloc(b->programs, p->sources, const char *,
+                         p->num_shaders + 1);
+   p->types[p->num_shaders] = type;
+   p->sources[p->num_shaders] = source;
+   p->num_shaders++;
+   return true;
+}
+
+static struct benchmark_program *
+benchmark_add_program(struct benchmark *b, const char *name)
+{
+   b->programs = reralloc(b->programs, b->programs,
+                          struct benchmark_program, b->num_programs + 1);
+
+   struct benchmark_program *p = &b->programs[b->num_programs++];
+   memset(p, 0, sizeof(*p));
+   p->name = ralloc_strdup(b->programs, name);
+   return p;
+}
+
+static int
+compare_strings(const void *a, const void *b)
+{
+   return strcmp(*(const char *const *) a, *(const char *const *) b);
+}
+
+static bool
+benchmark_load_directory(struct benchmark *b, const char *path, DIR *dir)
+{
+   void *mem_ctx = ralloc_context(NULL);
+   const char **names = NULL;
+   unsigned num_names = 0;
+   struct dirent *entry;
+   bool ok = true;
+
+   while ((entry = readdir(dir)) != NULL) {
+      if (shader_type_for_file_name(entry->d_name) == 0)
+         continue;
+
+      names = reralloc(mem_ctx, names, const char *, num_names + 1);
+      names[num_names++] = ralloc_strdup(mem_ctx, entry->d_name);
+   }
+
+   /* Sorting puts the shaders of a program next to each other */
+   qsort(names, num_names, sizeof(names[0]), compare_strings);
+
+   struct benchmark_program *p = NULL;
+   for (unsigned i = 0; i < num_names && ok; i++) {
+      const unsigned stem_len = strlen(names[i]) - 5;
+
+      if (p == NULL || strlen(p->name) != stem_len ||
+          strncmp(p->name, names[i], stem_len) != 0) {
+         char *name = ralloc_strndup(mem_ctx, names[i], stem_len);
+         p = benchmark_add_program(b, name);
+      }
+
+      ok = benchmark_add_shader(b, p,
+                                ralloc_asprintf(mem_ctx, "%s/%s",
+                                                path, names[i]));
+   }
+
+   ralloc_free(mem_ctx);
+   return ok;
+}
+
+static bool
+benchmark_load_manifest(struct benchmark *b, const char *path)
+{
+   void *mem_ctx = ralloc_context(NULL);
+   char *text = load_text_file(mem_ctx, path);
+   bool ok = true;
+
+   if (text == NULL) {
+      printf("File \"%s\" does not exist.\n", path);
+      ralloc_free(mem_ctx);
+      return false;
+   }
+
+   /* Shader files are relative to the manifest's directory */
+   const char *slash = strrchr(path, '/');
+   const char *dir = slash ? ralloc_strndup(mem_ctx, path, slash - path) : ".";
+
+   for (char *line = strtok(text, "\n"); line && ok;
+        line = strtok(NULL, "\n")) {
+      line += strspn(line, " \t\r");
+      if (line[0] == '\0' || line[0] == '#')
+         continue;
+
+      struct benchmark_program *p = NULL;
+      char *next = line;
+      while (ok) {
+         const char *file = next + strspn(next, " \t\r");
+         const unsigned len = strcspn(file, " \t\r");
+         if (len == 0)
+            break;
+
+         char *file_name = ralloc_strndup(mem_ctx, file, len);
+         if (p == NULL)
+            p = benchmark_add_program(b, file_name);
+
+         ok = benchmark_add_shader(b, p,
+                                   file_name[0] == '/' ? file_name :
+                                   ralloc_asprintf(mem_ctx, "%s/%s",
+                                                   dir, file_name));
+         next = (char *) file + len;
+      }
+   }
+
+   ralloc_free(mem_ctx);
+   return ok;
+}
+
+/**
+ * Compile and link a program once.
+ */
+static bool
+benchmark_run_program(struct gl_context *ctx,
+                      const struct benchmark_program *p, bool print_logs)
+{
+   struct gl_shader_program *prog = rzalloc(NULL, struct gl_shader_program);
+   bool ok = true;
+
+   prog->InfoLog = ralloc_strdup(prog, "");
+   prog->Shaders = ralloc_array(prog, struct gl_shader *, p->num_shaders);
+
+   for (unsigned i = 0; i < p->num_shaders; i++) {
+      struct gl_shader *shader = rzalloc(prog, gl_shader);
+
+      shader->Type = p->types[i];
+      shader->Stage = _mesa_shader_enum_to_shader_stage(shader->Type);
+      shader->Source = p->sources[i];
+      prog->Shaders[prog->NumShaders++] = shader;
+
+      _mesa_glsl_compile_shader(ctx, shader, false, false);
+
+      if (print_logs && strlen(shader->InfoLog) > 0)
+         printf("Info log for %s shader of %s:\n%s\n",
+                _mesa_shader_stage_to_string(shader->Stage), p->name,
+                shader->InfoLog);
+
+      if (!shader->CompileStatus) {
+         ok = false;
+         break;
+      }
+   }
+
+   if (ok) {
+      link_shaders(ctx, prog);
+      ok = prog->LinkStatus;
+
+      if (print_logs && strlen(prog->InfoLog) > 0)
+         printf("Info log for linking %s:\n%s\n", p->name, prog->InfoLog);
+   }
+
+   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++)
+      ralloc_free(prog->_LinkedShaders[i]);
+
+   ralloc_free(prog);
+   return ok;
+}
+
+/**
+ * Run jobs, each an iteration of a program, until none are left.
+ */
+static int
+benchmark_thread(void *data)
+{
+   struct benchmark *b = (struct benchmark *) data;
+   const unsigned num_jobs = b->num_programs * b->iterations;
+   struct gl_context *ctx =
+      (struct gl_context *) calloc(1, sizeof(struct gl_context));
+
+   initialize_context(ctx, b->api);
+
+   for (;;) {
+      mtx_lock(&b->lock);
+      const unsigned job = b->next_job++;
+      mtx_unlock(&b->lock);
+
+      if (job >= num_jobs)
+         break;
+
+      struct benchmark_program *p = &b->programs[job % b->num_programs];
+      const unsigned iteration = job / b->num_programs;
+
+      const int64_t start = glsl_stats_time();
+      const bool ok = benchmark_run_program(ctx, p, iteration == 0);
+      p->latency[iteration] = glsl_stats_time() - start;
+
+      if (!ok)
+         p->failed = true;
+   }
+
+   free(ctx);
+   return 0;
+}
+
+static int
+compare_latencies(const void *a, const void *b)
+{
+   const int64_t x = *(const int64_t *) a;
+   const int64_t y = *(const int64_t *) b;
+   return x < y ? -1 : x > y;
+}
+
+/**
+ * Return percentile \c pct of sorted latencies, in milliseconds.
+ */
+static double
+percentile(const int64_t *sorted, unsigned count, unsigned pct)
+{
+   return sorted[(count - 1) * pct / 100] / 1000000.0;
+}
+
+static int
+run_benchmark(const char *path, gl_api api, unsigned iterations,
+              unsigned num_threads)
+{
+   struct benchmark b;
+   bool ok;
+
+   memset(&b, 0, sizeof(b));
+   b.api = api;
+   b.iterations = MAX2(iterations, 1);
+   b.programs = ralloc_array(NULL, struct benchmark_program, 0);
+   num_threads = MAX2(num_threads, 1);
+
+   DIR *dir = opendir(path);
+   if (dir) {
+      ok = benchmark_load_directory(&b, path, dir);
+      closedir(dir);
+   } else {
+      ok = benchmark_load_manifest(&b, path);
+   }
+
+   if (!ok || b.num_programs == 0) {
+      if (ok)
+         printf("No shaders found in \"%s\".\n", path);
+      ralloc_free(b.programs);
+      return EXIT_FAILURE;
+   }
+
+   unsigned num_shaders = 0;
+   for (unsigned i = 0; i < b.num_programs; i++) {
+      b.programs[i].latency =
+         rzalloc_array(b.programs, int64_t, b.iterations);
+      num_shaders += b.programs[i].num_shaders;
+   }
+
+   mtx_init(&b.lock, mtx_plain);
+
+   thrd_t *threads = (thrd_t *) calloc(num_threads, sizeof(thrd_t));
+   bool *started = (bool *) calloc(num_threads, sizeof(bool));
+
+   const int64_t start = glsl_stats_time();
+
+   for (unsigned i = 1; i < num_threads; i++) {
+      started[i] = thrd_create(&threads[i], benchmark_thread, &b) ==
+                   thrd_success;
+   }
+
+   benchmark_thread(&b);
+
+   for (unsigned i = 1; i < num_threads; i++) {
+      if (started[i])
+         thrd_join(threads[i], NULL);
+   }
+
+   const double seconds = (glsl_stats_time() - start) / 1000000000.0;
+
+   free(started);
+   free(threads);
+   mtx_destroy(&b.lock);
+
+   /* Per program and overall latency distributions */
+   const unsigned num_samples = b.num_programs * b.iterations;
+   int64_t *all = ralloc_array(b.programs, int64_t, num_samples);
+   unsigned failed = 0;
+
+   printf("%-32s %10s %10s %10s %10s\n",
+          "program", "min ms", "median ms", "90% ms", "max ms");
+
+   for (unsigned i = 0; i < b.num_programs; i++) {
+      struct benchmark_program *p = &b.programs[i];
+
+      memcpy(&all[i * b.iterations], p->latency,
+             b.iterations * sizeof(int64_t));
+      qsort(p->latency, b.iterations, sizeof(int64_t), compare_latencies);
+
+      printf("%-32s %10.3f %10.3f %10.3f %10.3f%s\n", p->name,
+             percentile(p->latency, b.iterations, 0),
+             percentile(p->latency, b.iterations, 50),
+             percentile(p->latency, b.iterations, 90),
+             percentile(p->latency, b.iterations, 100),
+             p->failed ? " (failed)" : "");
+
+      if (p->failed)
+         failed++;
+   }
+
+   qsort(all, num_samples, sizeof(int64_t), compare_latencies);
+
+   printf("\n%u programs (%u shaders), %u iterations, %u threads: "
+          "%.3f s\n", b.num_programs, num_shaders, b.iterations,
+          num_threads, seconds);
+   printf("throughput: %.1f programs/s, %.1f shaders/s\n",
+          num_samples / seconds, num_shaders * b.iterations / seconds);
+   printf("latency: min %.3f ms, median %.3f ms, 90%% %.3f ms, "
+          "99%% %.3f ms, max %.3f ms\n",
+          percentile(all, num_samples, 0), percentile(all, num_samples, 50),
+          percentile(all, num_samples, 90), percentile(all, num_samples, 99),
+          percentile(all, num_samples, 100));
+   if (failed)
+      printf("%u programs failed to compile or link\n", failed);
+
+   ralloc_free(b.programs);
+   return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/*@}*/
+
 int
 main(int argc, char **argv)
 {
@@ -307,6 +710,9 @@ main(int argc, char **argv)
    struct gl_context local_ctx;
    struct gl_context *ctx = &local_ctx;
    bool glsl_es = false;
+   const char *benchmark_path = NULL;
+   unsigned iterations = 10;
+   unsigned num_threads = 1;
 
    int c;
    int idx = 0;
@@ -333,11 +739,28 @@ main(int argc, char **argv)
             break;
          }
          break;
+      case 'b':
+         benchmark_path = optarg;
+         break;
+      case 'i':
+         iterations = strtol(optarg, NULL, 10);
+         break;
+      case 't':
+         num_threads = strtol(optarg, NULL, 10);
+         break;
       default:
          break;
       }
    }
 
+   if (benchmark_path) {
+      status = run_benchmark(benchmark_path,
+                             glsl_es ? API_OPENGLES2 : API_OPENGL_COMPAT,
+                             iterations, num_threads);
+      _mesa_glsl_release_types();
+      _mesa_glsl_release_builtin_functions();
+      return status;
+   }
 
    if (argc <= optind)
       usage_fail(argv[0]);
@@ -361,20 +784,8 @@ main(int argc, char **argv)
       whole_program->Shaders[whole_program->NumShaders] = shader;
       whole_program->NumShaders++;
 
-      const unsigned len = strlen(argv[optind]);
-      if (len < 6)
-	 usage_fail(argv[0]);
-
-      const char *const ext = & argv[optind][len - 5];
-      if (strncmp(".vert", ext, 5) == 0 || strncmp(".glsl", ext, 5) == 0)
-	 shader->Type = GL_VERTEX_SHADER;
-      else if (strncmp(".geom", ext, 5) == 0)
-	 shader->Type = GL_GEOMETRY_SHADER;
-      else if (strncmp(".frag", ext, 5) == 0)
-	 shader->Type = GL_FRAGMENT_SHADER;
-      else if (strncmp(".comp", ext, 5) == 0)
-         shader->Type = GL_COMPUTE_SHADER;
-      else
+      shader->Type = shader_type_for_file_name(argv[optind]);
+      if (shader->Type == 0)
 	 usage_fail(argv[0]);
       shader->Stage = _mesa_shader_enum_to_shader_stage(shader->Type);
 
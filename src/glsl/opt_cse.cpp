@@ -30,6 +30,13 @@
  * is generic and handles texture operations, but it's rather simple currently
  * and doesn't support modification of variables in the available expressions
  * list, so it can't do variables other than uniforms or shader inputs.
+ *
+ * Since those never change, an expression stays available in all the code
+ * it dominates.  GLSL IR control flow is structured, so the dominator tree
+ * follows the nesting of the IR: an instruction dominates the instructions
+ * after it in its block, including everything nested in them.  Expressions
+ * are thus reused across if and loop bodies when they were computed before
+ * the if or the loop, but the expressions of a body only within that body.
  */
 
 #include "ir.h"
@@ -115,6 +122,7 @@ private:
 
    ir_rvalue *try_cse(ir_rvalue *rvalue);
    void add_to_ae(ir_rvalue **rvalue);
+   void visit_dominated_block(exec_list *instructions);
 
    /** List of ae_entry: The available expressions to reuse */
    exec_list *ae;
@@ -363,18 +371,32 @@ cse_visitor::handle_rvalue(ir_rvalue **rvalue)
    }
 }
 
+/**
+ * Visits a block of instructions dominated by the current instruction.
+ *
+ * The available expressions stay available in the block, but the ones
+ * computed in the block don't dominate the code after it, so they're
+ * dropped afterwards.
+ */
+void
+cse_visitor::visit_dominated_block(exec_list *instructions)
+{
+   exec_node *const last = ae->get_tail();
+
+   visit_list_elements(this, instructions);
+
+   while (ae->get_tail() != last)
+      ae->get_tail()->remove();
+}
+
 ir_visitor_status
 cse_visitor::visit_enter(ir_if *ir)
 {
    handle_rvalue(&ir->condition);
 
-   ae->make_empty();
-   visit_list_elements(this, &ir->then_instructions);
-
-   ae->make_empty();
-   visit_list_elements(this, &ir->else_instructions);
+   visit_dominated_block(&ir->then_instructions);
+   visit_dominated_block(&ir->else_instructions);
 
-   ae->make_empty();
    return visit_continue_with_parent;
 }
 
@@ -391,10 +413,8 @@ cse_visitor::visit_enter(ir_function_signature *ir)
 ir_visitor_status
 cse_visitor::visit_enter(ir_loop *ir)
 {
-   ae->make_empty();
-   visit_list_elements(this, &ir->body_instructions);
+   visit_dominated_block(&ir->body_instructions);
 
-   ae->make_empty();
    return visit_continue_with_parent;
 }
 
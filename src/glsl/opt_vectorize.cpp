@@ -50,6 +50,21 @@
  * into a single vector operation
  *
  * (assign (xyz) (var_ref r1) (expression vec3 log2 (swiz xyz (var_ref v0))))
+ *
+ * The assignments don't need to be consecutive.  Unrelated assignments may
+ * come between them, as long as the scalar assignments can be moved past
+ * them to the last one, which becomes the vector assignment.  That is, if the
+ * unrelated assignments don't reference the variable written by the scalar
+ * assignments, and don't write a variable the scalar assignments read.  So
+ * scalarized code like
+ *
+ * r1.x = log2(v0.x);
+ * r2.x = exp2(v1.x);
+ * r1.y = log2(v0.y);
+ * r2.y = exp2(v1.y);
+ *
+ * is vectorized into r1.xy = log2(v0.xy), and in the next run of the pass,
+ * r2.xy = exp2(v1.xy).
  */
 
 #include "ir.h"
@@ -85,9 +100,13 @@ public:
    virtual ir_visitor_status visit_enter(ir_dereference_array *);
    virtual ir_visitor_status visit_enter(ir_if *);
    virtual ir_visitor_status visit_enter(ir_loop *);
+   virtual ir_visitor_status visit_enter(ir_call *);
+   virtual ir_visitor_status visit(ir_emit_vertex *);
+   virtual ir_visitor_status visit(ir_end_primitive *);
 
    virtual ir_visitor_status visit_leave(ir_assignment *);
 
+   bool interferes(ir_assignment *ir);
    void try_vectorize();
 
    ir_assignment *assignment[4];
@@ -98,8 +117,41 @@ public:
    bool progress;
 };
 
+/**
+ * Visitor to find whether an IR tree references a variable.
+ */
+class find_variable_visitor : public ir_hierarchical_visitor {
+public:
+   find_variable_visitor(ir_variable *var)
+      : var(var), found(false)
+   {
+   }
+
+   virtual ir_visitor_status visit(ir_dereference_variable *ir)
+   {
+      if (ir->var == this->var) {
+         this->found = true;
+         return visit_stop;
+      }
+      return visit_continue;
+   }
+
+   ir_variable *var;
+   bool found;
+};
+
 } /* unnamed namespace */
 
+static bool
+references_variable(ir_instruction *ir, ir_variable *var)
+{
+   find_variable_visitor v(var);
+
+   ir->accept(&v);
+
+   return v.found;
+}
+
 /**
  * Rewrites the swizzles and types of a right-hand side of an assignment.
  *
@@ -243,10 +295,26 @@ write_mask_matches_swizzle(unsigned write_mask,
            (write_mask == WRITEMASK_W && swz->mask.x == SWIZZLE_W));
 }
 
+/**
+ * Returns whether the currently tracked assignments can't be moved past an
+ * assignment, because it reads or writes the variable they write, or writes a
+ * variable they read.
+ */
+bool
+ir_vectorize_visitor::interferes(ir_assignment *ir)
+{
+   ir_variable *const dest = this->last_assignment->lhs->variable_referenced();
+   ir_variable *const written = ir->lhs->variable_referenced();
+
+   return dest == NULL || written == NULL ||
+          references_variable(ir, dest) ||
+          references_variable(this->last_assignment->rhs, written);
+}
+
 /**
  * Upon entering an ir_assignment, attempt to vectorize the currently tracked
- * assignments if the current assignment is not suitable. Keep a pointer to
- * the current assignment.
+ * assignments if the current assignment is not suitable and they can't be
+ * moved past it. Keep a pointer to the current assignment.
  */
 ir_visitor_status
 ir_vectorize_visitor::visit_enter(ir_assignment *ir)
@@ -260,7 +328,11 @@ ir_vectorize_visitor::visit_enter(ir_assignment *ir)
        this->channels >= 4 ||
        !single_channel_write_mask(ir->write_mask) ||
        (lhs && !ir->lhs->equals(lhs)) ||
-       (rhs && !ir->rhs->equals(rhs, ir_type_swizzle))) {
+       (rhs && !ir->rhs->equals(rhs, ir_type_swizzle)) ||
+       (lhs && this->assignment[write_mask_to_swizzle(ir->write_mask)])) {
+      if (this->last_assignment && this->channels < 4 && !interferes(ir))
+         return visit_continue_with_parent;
+
       try_vectorize();
    }
 
@@ -336,6 +408,35 @@ ir_vectorize_visitor::visit_enter(ir_loop *ir)
    return visit_continue_with_parent;
 }
 
+/* A call may read or write any of the variables of the tracked assignments.
+ */
+ir_visitor_status
+ir_vectorize_visitor::visit_enter(ir_call *ir)
+{
+   try_vectorize();
+
+   return visit_continue_with_parent;
+}
+
+/* Emitting a vertex reads the outputs, which may be written by the tracked
+ * assignments, so they can't be moved past it.
+ */
+ir_visitor_status
+ir_vectorize_visitor::visit(ir_emit_vertex *ir)
+{
+   try_vectorize();
+
+   return visit_continue;
+}
+
+ir_visitor_status
+ir_vectorize_visitor::visit(ir_end_primitive *ir)
+{
+   try_vectorize();
+
+   return visit_continue;
+}
+
 /**
  * Upon leaving an ir_assignment, save a pointer to it in ::assignment[] if
  * the swizzle mask(s) found were appropriate. Also save a pointer in
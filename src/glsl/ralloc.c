@@ -72,6 +72,19 @@ struct ralloc_header
 
 typedef struct ralloc_header ralloc_header;
 
+static bool count_bytes = false;
+static size_t allocated_bytes = 0;
+
+static inline void
+add_allocated_bytes(size_t size)
+{
+#if defined(__GNUC__)
+   __sync_fetch_and_add(&allocated_bytes, size);
+#else
+   allocated_bytes += size;
+#endif
+}
+
 static void unlink_block(ralloc_header *info);
 static void unsafe_free(ralloc_header *info);
 
@@ -116,6 +129,8 @@ ralloc_size(const void *ctx, size_t size)
 
    if (unlikely(block == NULL))
       return NULL;
+   if (unlikely(count_bytes))
+      add_allocated_bytes(size);
    info = (ralloc_header *) block;
    parent = ctx != NULL ? get_header(ctx) : NULL;
 
@@ -149,6 +164,9 @@ resize(void *ptr, size_t size)
    if (info == NULL)
       return NULL;
 
+   if (unlikely(count_bytes))
+      add_allocated_bytes(size);
+
    /* Update parent and sibling's links to the reallocated node. */
    if (info != old && info->parent != NULL) {
       if (info->parent->child == old)
@@ -308,6 +326,18 @@ ralloc_set_destructor(const void *ptr, void(*destructor)(void *))
    info->destructor = destructor;
 }
 
+void
+ralloc_count_bytes(bool enable)
+{
+   count_bytes = enable;
+}
+
+size_t
+ralloc_allocated_bytes(void)
+{
+   return allocated_bytes;
+}
+
 char *
 ralloc_strdup(const void *ctx, const char *str)
 {
@@ -490,3 +520,156 @@ ralloc_vasprintf_rewrite_tail(char **str, size_t *start, const char *fmt,
    *start += new_length;
    return true;
 }
+
+
+/*
+ * Linear allocator
+ *
+ * The parent allocation is preceded by the header of the first buffer.
+ * Further buffers are ralloc children of the first one, linked through
+ * their headers, and only the latest of them is allocated from.  Every
+ * buffer starts with its linear_header.
+ */
+
+#define LMAGIC 0x87b9c7d3
+#define MIN_LINEAR_BUFSIZE 2048
+#define SUBALLOC_ALIGNMENT 8
+
+struct linear_header {
+#ifdef DEBUG
+   unsigned magic;
+#endif
+   unsigned offset;                /* of the first unused byte */
+   unsigned size;                  /* of the buffer, after the header */
+   struct linear_header *next;     /* next buffer */
+   struct linear_header *latest;   /* the buffer allocated from */
+};
+
+typedef struct linear_header linear_header;
+
+#define ALIGN_LINEAR(n) (((n) + SUBALLOC_ALIGNMENT - 1) & \
+                         ~(SUBALLOC_ALIGNMENT - 1))
+#define LINEAR_HEADER_SIZE ALIGN_LINEAR(sizeof(linear_header))
+#define LINEAR_BUFFER(node) ((char *) (node) + LINEAR_HEADER_SIZE)
+#define LINEAR_PARENT_TO_HEADER(parent) \
+   ((linear_header *) ((char *) (parent) - LINEAR_HEADER_SIZE))
+
+static linear_header *
+create_linear_node(void *ralloc_ctx, unsigned min_size)
+{
+   linear_header *node;
+
+   min_size = ALIGN_LINEAR(min_size);
+   if (min_size < MIN_LINEAR_BUFSIZE)
+      min_size = MIN_LINEAR_BUFSIZE;
+
+   node = ralloc_size(ralloc_ctx, LINEAR_HEADER_SIZE + min_size);
+   if (unlikely(node == NULL))
+      return NULL;
+
+#ifdef DEBUG
+   node->magic = LMAGIC;
+#endif
+   node->offset = 0;
+   node->size = min_size;
+   node->next = NULL;
+   node->latest = node;
+   return node;
+}
+
+void *
+linear_alloc_parent(void *ralloc_ctx, unsigned size)
+{
+   linear_header *node;
+
+   if (unlikely(ralloc_ctx == NULL))
+      return NULL;
+
+   /* The parent is at the very start of the first buffer, so that its
+    * header can be found from it.
+    */
+   node = create_linear_node(ralloc_ctx, size);
+   if (unlikely(node == NULL))
+      return NULL;
+
+   node->offset = ALIGN_LINEAR(size);
+   return LINEAR_BUFFER(node);
+}
+
+void *
+linear_zalloc_parent(void *ralloc_ctx, unsigned size)
+{
+   void *ptr = linear_alloc_parent(ralloc_ctx, size);
+
+   if (likely(ptr != NULL))
+      memset(ptr, 0, size);
+   return ptr;
+}
+
+void *
+linear_alloc_child(void *parent, unsigned size)
+{
+   linear_header *first = LINEAR_PARENT_TO_HEADER(parent);
+   linear_header *latest = first->latest;
+   void *ptr;
+
+#ifdef DEBUG
+   assert(first->magic == LMAGIC);
+#endif
+
+   size = ALIGN_LINEAR(size);
+
+   if (unlikely(latest->offset + size > latest->size)) {
+      /* Big allocations get a buffer of their own */
+      linear_header *node = create_linear_node(first, size);
+      if (unlikely(node == NULL))
+         return NULL;
+
+      latest->next = node;
+      first->latest = node;
+      latest = node;
+   }
+
+   ptr = LINEAR_BUFFER(latest) + latest->offset;
+   latest->offset += size;
+   return ptr;
+}
+
+void *
+linear_zalloc_child(void *parent, unsigned size)
+{
+   void *ptr = linear_alloc_child(parent, size);
+
+   if (likely(ptr != NULL))
+      memset(ptr, 0, size);
+   return ptr;
+}
+
+void
+linear_free_parent(void *parent)
+{
+   if (unlikely(parent == NULL))
+      return;
+
+   /* The other buffers are ralloc children of the first one */
+   ralloc_free(LINEAR_PARENT_TO_HEADER(parent));
+}
+
+char *
+linear_strdup(void *parent, const char *str)
+{
+   size_t n;
+   char *ptr;
+
+   if (unlikely(str == NULL))
+      return NULL;
+
+   n = strlen(str);
+   ptr = linear_alloc_child(parent, n + 1);
+   if (unlikely(ptr == NULL))
+      return NULL;
+
+   memcpy(ptr, str, n);
+   ptr[n] = '\0';
+   return ptr;
+}
@@ -253,6 +253,19 @@ void *ralloc_autofree_context(void);
  */
 void ralloc_set_destructor(const void *ptr, void(*destructor)(void *));
 
+/**
+ * Start or stop counting the bytes allocated by ralloc, see
+ * \c ralloc_allocated_bytes.  Counting is off by default.
+ */
+void ralloc_count_bytes(bool enable);
+
+/**
+ * Return the number of bytes requested from \c ralloc_size and
+ * \c reralloc_size, and the functions built on them, in all threads while
+ * counting was enabled.
+ */
+size_t ralloc_allocated_bytes(void);
+
 /// \defgroup array String Functions @{
 /**
  * Duplicate a string, allocating the memory from the given context.
@@ -400,6 +413,55 @@ bool ralloc_asprintf_append (char **str, const char *fmt, ...)
 bool ralloc_vasprintf_append(char **str, const char *fmt, va_list args);
 /// @}
 
+/**
+ * \defgroup linear Linear Allocators @{
+ *
+ * A linear allocator hands out memory from large blocks by bumping an
+ * offset.  The allocations have no ralloc header, can't be freed, stolen
+ * or be the parent of ralloc allocations; they are all freed at once,
+ * together with the "parent" allocation which created the allocator.
+ *
+ * This is meant for the many small, short-lived objects built by a single
+ * pass, like the AST, for which the per-allocation malloc and header of
+ * ralloc_size() dominate.
+ *
+ * The parent itself is a ralloc child of \p ralloc_ctx, so freeing the
+ * ralloc context frees all the linear allocations too.
+ */
+
+/**
+ * Create a linear allocator and return its first allocation, of \p size
+ * bytes, which is the parent to pass to linear_alloc_child().
+ */
+void *linear_alloc_parent(void *ralloc_ctx, unsigned size);
+
+/**
+ * Like linear_alloc_parent(), but zero the allocation.
+ */
+void *linear_zalloc_parent(void *ralloc_ctx, unsigned size);
+
+/**
+ * Allocate \p size bytes from the linear allocator of \p parent.
+ */
+void *linear_alloc_child(void *parent, unsigned size);
+
+/**
+ * Like linear_alloc_child(), but zero the allocation.
+ */
+void *linear_zalloc_child(void *parent, unsigned size);
+
+/**
+ * Free the parent and all the allocations made from it.
+ */
+void linear_free_parent(void *parent);
+
+/**
+ * Duplicate a string, allocating the copy from the linear allocator of
+ * \p parent.
+ */
+char *linear_strdup(void *parent, const char *str);
+/// @}
+
 #ifdef __cplusplus
 } /* end of extern "C" */
 #endif
@@ -442,4 +504,27 @@ public:                                                                  \
    }
 
 
+/**
+ * Declare C++ new and delete operators which use a linear allocator.
+ *
+ * TYPE *var = new(linear_parent) TYPE(...);
+ *
+ * The memory is zeroed, like ralloc_size() does.  Destructors are never
+ * run and delete does nothing; the objects go away with the parent.
+ */
+#define DECLARE_LINEAR_ZALLOC_CXX_OPERATORS(TYPE)                        \
+public:                                                                  \
+   static void* operator new(size_t size, void *linear_parent)           \
+   {                                                                     \
+      void *p = linear_zalloc_child(linear_parent, size);                \
+      assert(p != NULL);                                                 \
+      return p;                                                          \
+   }                                                                     \
+                                                                         \
+   static void operator delete(void *p)                                  \
+   {                                                                     \
+      /* The memory is freed with the linear parent */                   \
+      (void) p;                                                          \
+   }
+
 #endif
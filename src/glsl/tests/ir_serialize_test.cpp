@@ -0,0 +1,251 @@
+/**************************************************************************
+ *
+ * Copyright 2014 The Mesa Authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+#include <gtest/gtest.h>
+#include "main/compiler.h"
+#include "main/mtypes.h"
+#include "main/macros.h"
+#include "ralloc.h"
+#include "ir.h"
+#include "ir_serialize.h"
+
+class ir_serialize_test : public ::testing::Test {
+public:
+   virtual void SetUp();
+   virtual void TearDown();
+
+   void round_trip();
+
+   void *mem_ctx;
+   exec_list ir;
+   struct blob *blob;
+   exec_list deserialized;
+};
+
+void
+ir_serialize_test::SetUp()
+{
+   this->mem_ctx = ralloc_context(NULL);
+   this->ir.make_empty();
+   this->deserialized.make_empty();
+   this->blob = blob_create(this->mem_ctx);
+}
+
+void
+ir_serialize_test::TearDown()
+{
+   ralloc_free(this->mem_ctx);
+   this->mem_ctx = NULL;
+}
+
+/**
+ * Serialize this->ir, read it back, and check that serializing the result
+ * again gives exactly the same bytes.
+ */
+void
+ir_serialize_test::round_trip()
+{
+   struct blob_reader reader;
+   struct blob *again = blob_create(this->mem_ctx);
+
+   ASSERT_TRUE(serialize_ir(this->blob, &this->ir));
+
+   blob_reader_init(&reader, this->blob->data, this->blob->size);
+   ASSERT_TRUE(deserialize_ir(this->mem_ctx, &reader, &this->deserialized));
+   EXPECT_EQ(reader.end, reader.current);
+
+   ASSERT_TRUE(serialize_ir(again, &this->deserialized));
+   ASSERT_EQ(this->blob->size, again->size);
+   EXPECT_EQ(0, memcmp(this->blob->data, again->data, again->size));
+}
+
+TEST_F(ir_serialize_test, variables_and_assignments)
+{
+   ir_variable *a =
+      new(mem_ctx) ir_variable(glsl_type::vec4_type, "a", ir_var_shader_in);
+   ir_variable *b =
+      new(mem_ctx) ir_variable(glsl_type::vec4_type, "b", ir_var_temporary);
+   ir_variable *f =
+      new(mem_ctx) ir_variable(glsl_type::float_type, "f", ir_var_uniform);
+
+   a->data.location = 3;
+   ir.push_tail(a);
+   ir.push_tail(f);
+
+   /* b is used before its declaration */
+   ir_rvalue *sum =
+      new(mem_ctx) ir_expression(ir_binop_add,
+                                 new(mem_ctx) ir_dereference_variable(a),
+                                 new(mem_ctx) ir_dereference_variable(f));
+   ir.push_tail(new(mem_ctx) ir_assignment(new(mem_ctx) ir_dereference_variable(b),
+                                           sum));
+   ir.push_tail(new(mem_ctx) ir_assignment(new(mem_ctx) ir_dereference_variable(b),
+                                           new(mem_ctx) ir_swizzle(new(mem_ctx) ir_dereference_variable(a),
+                                                                   2, 1, 0, 0, 3),
+                                           NULL, 0x7));
+   ir.push_tail(b);
+
+   round_trip();
+
+   ir_variable *a2 = ((ir_instruction *) deserialized.head)->as_variable();
+   ASSERT_TRUE(a2 != NULL);
+   EXPECT_STREQ("a", a2->name);
+   EXPECT_EQ(glsl_type::vec4_type, a2->type);
+   EXPECT_EQ(ir_var_shader_in, a2->data.mode);
+   EXPECT_EQ(3, a2->data.location);
+
+   ir_assignment *assign =
+      ((ir_instruction *) deserialized.head->next->next)->as_assignment();
+   ASSERT_TRUE(assign != NULL);
+   EXPECT_EQ(a2, assign->rhs->as_expression()->operands[0]->variable_referenced());
+
+   ir_variable *b2 = ((ir_instruction *) deserialized.tail_pred)->as_variable();
+   ASSERT_TRUE(b2 != NULL);
+   EXPECT_EQ(b2, assign->lhs->variable_referenced());
+}
+
+TEST_F(ir_serialize_test, records_and_constants)
+{
+   static const glsl_struct_field fields[] = {
+      { glsl_type::vec2_type, "v", false },
+      { glsl_type::get_array_instance(glsl_type::int_type, 2), "i", false },
+   };
+   const glsl_type *s_type =
+      glsl_type::get_record_instance(fields, ARRAY_SIZE(fields), "S");
+
+   ir_variable *s =
+      new(mem_ctx) ir_variable(s_type, "s", ir_var_temporary);
+   ir_variable *t =
+      new(mem_ctx) ir_variable(glsl_type::get_array_instance(s_type, 3),
+                               "t", ir_var_temporary);
+   ir.push_tail(s);
+   ir.push_tail(t);
+
+   exec_list values;
+   ir_constant_data v;
+   memset(&v, 0, sizeof(v));
+   v.f[0] = 1.0;
+   v.f[1] = 2.0;
+   values.push_tail(new(mem_ctx) ir_constant(glsl_type::vec2_type, &v));
+
+   exec_list elements;
+   elements.push_tail(new(mem_ctx) ir_constant(5));
+   elements.push_tail(new(mem_ctx) ir_constant(6));
+   values.push_tail(new(mem_ctx) ir_constant(fields[1].type, &elements));
+
+   s->constant_value = new(mem_ctx) ir_constant(s_type, &values);
+
+   ir_dereference *element =
+      new(mem_ctx) ir_dereference_array(t, new(mem_ctx) ir_constant(1));
+   ir.push_tail(new(mem_ctx) ir_assignment(new(mem_ctx) ir_dereference_record(element, "v"),
+                                           new(mem_ctx) ir_dereference_record(s, "v")));
+
+   round_trip();
+
+   ir_variable *s2 = ((ir_instruction *) deserialized.head)->as_variable();
+   ASSERT_TRUE(s2 != NULL);
+   EXPECT_EQ(s_type, s2->type);
+   ASSERT_TRUE(s2->constant_value != NULL);
+   EXPECT_EQ(2.0, s2->constant_value->get_record_field("v")->value.f[1]);
+   EXPECT_EQ(6, s2->constant_value->get_record_field("i")->array_elements[1]->value.i[0]);
+}
+
+TEST_F(ir_serialize_test, functions)
+{
+   ir_function *func = new(mem_ctx) ir_function("foo");
+   ir_function_signature *sig =
+      new(mem_ctx) ir_function_signature(glsl_type::float_type);
+   ir_variable *param =
+      new(mem_ctx) ir_variable(glsl_type::float_type, "x", ir_var_function_in);
+
+   sig->parameters.push_tail(param);
+   sig->is_defined = true;
+   func->add_signature(sig);
+
+   ir_if *iff = new(mem_ctx) ir_if(new(mem_ctx) ir_constant(true));
+   iff->then_instructions.push_tail(new(mem_ctx) ir_return(new(mem_ctx) ir_dereference_variable(param)));
+   sig->body.push_tail(iff);
+
+   ir_loop *loop = new(mem_ctx) ir_loop();
+   loop->body_instructions.push_tail(new(mem_ctx) ir_loop_jump(ir_loop_jump::jump_break));
+   sig->body.push_tail(loop);
+   sig->body.push_tail(new(mem_ctx) ir_return(new(mem_ctx) ir_constant(0.0f)));
+
+   ir_function *main_func = new(mem_ctx) ir_function("main");
+   ir_function_signature *main_sig =
+      new(mem_ctx) ir_function_signature(glsl_type::void_type);
+   main_sig->is_defined = true;
+   main_func->add_signature(main_sig);
+
+   ir_variable *ret =
+      new(mem_ctx) ir_variable(glsl_type::float_type, "ret", ir_var_temporary);
+   exec_list actual_parameters;
+   actual_parameters.push_tail(new(mem_ctx) ir_constant(2.0f));
+   main_sig->body.push_tail(ret);
+   main_sig->body.push_tail(new(mem_ctx) ir_call(sig,
+                                                 new(mem_ctx) ir_dereference_variable(ret),
+                                                 &actual_parameters));
+
+   /* main is first, so the call carries the definition of foo() */
+   ir.push_tail(main_func);
+   ir.push_tail(func);
+
+   round_trip();
+
+   ir_function *main2 = ((ir_instruction *) deserialized.head)->as_function();
+   ir_function *foo2 = ((ir_instruction *) deserialized.tail_pred)->as_function();
+   ASSERT_TRUE(main2 != NULL);
+   ASSERT_TRUE(foo2 != NULL);
+   EXPECT_STREQ("foo", foo2->name);
+
+   ir_function_signature *sig2 =
+      (ir_function_signature *) foo2->signatures.head;
+   ir_call *call =
+      ((ir_instruction *) ((ir_function_signature *) main2->signatures.head)->body.tail_pred)->as_call();
+   ASSERT_TRUE(call != NULL);
+   EXPECT_EQ(sig2, call->callee);
+   EXPECT_EQ(foo2, sig2->function());
+   EXPECT_STREQ("foo", call->callee_name());
+}
+
+TEST_F(ir_serialize_test, truncated)
+{
+   ir_variable *v =
+      new(mem_ctx) ir_variable(glsl_type::vec4_type, "v", ir_var_temporary);
+   ir.push_tail(v);
+   ir.push_tail(new(mem_ctx) ir_assignment(new(mem_ctx) ir_dereference_variable(v),
+                                           new(mem_ctx) ir_dereference_variable(v)));
+
+   ASSERT_TRUE(serialize_ir(blob, &ir));
+
+   for (size_t size = 0; size < blob->size; size++) {
+      struct blob_reader reader;
+      exec_list list;
+
+      blob_reader_init(&reader, blob->data, size);
+      EXPECT_FALSE(deserialize_ir(mem_ctx, &reader, &list));
+   }
+}
@@ -272,6 +272,17 @@ dri3_free_render_buffer(struct dri3_drawable *pdraw, struct dri3_buffer *buffer)
 static void
 dri3_update_num_back(struct dri3_drawable *priv)
 {
+   struct dri3_screen *psc = (struct dri3_screen *) priv->base.psc;
+
+   if (psc->num_back) {
+      priv->num_back = psc->num_back;
+      return;
+   }
+
+   /* With an interval of 0 the extra buffer gives mailbox style
+    * presentation: the X server replaces a still queued frame with the
+    * newer one, so we never have to wait for a vblank to render the next.
+    */
    priv->num_back = 1;
    if (priv->flipping)
       priv->num_back++;
@@ -1611,7 +1622,7 @@ dri3_create_screen(int screen, struct glx_display * priv)
    struct dri3_screen *psc;
    __GLXDRIscreen *psp;
    struct glx_config *configs = NULL, *visuals = NULL;
-   char *driverName, *deviceName;
+   char *driverName, *deviceName, *tmp;
    int i;
 
    psc = calloc(1, sizeof *psc);
@@ -1620,6 +1631,13 @@ dri3_create_screen(int screen, struct glx_display * priv)
 
    psc->fd = -1;
 
+   tmp = getenv("LIBGL_DRI3_NUM_BACK");
+   psc->num_back = (tmp) ? atoi(tmp) : 0;
+   if (psc->num_back < 0)
+      psc->num_back = 0;
+   else if (psc->num_back > DRI3_MAX_BACK)
+      psc->num_back = DRI3_MAX_BACK;
+
    if (!glx_screen_init(&psc->base, screen, priv)) {
       free(psc);
       return NULL;
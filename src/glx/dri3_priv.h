@@ -135,6 +135,11 @@ struct dri3_screen {
    int fd;
 
    Bool show_fps;
+
+   /* Number of back buffers forced through LIBGL_DRI3_NUM_BACK, 0 to pick
+    * it from the swap interval and whether we're flipping
+    */
+   int num_back;
 };
 
 struct dri3_context
@@ -143,7 +148,7 @@ struct dri3_context
    __DRIcontext *driContext;
 };
 
-#define DRI3_MAX_BACK   3
+#define DRI3_MAX_BACK   4
 #define DRI3_BACK_ID(i) (i)
 #define DRI3_FRONT_ID   (DRI3_MAX_BACK)
 
@@ -349,7 +349,8 @@ indirect_create_context(struct glx_screen *psc,
 			struct glx_context *shareList, int renderType)
 {
    struct glx_context *gc;
-   int bufSize;
+   int bufSize, maxBufSize, renderLimit;
+   const char *env;
    CARD8 opcode;
    __GLXattribute *state;
 
@@ -384,9 +385,23 @@ indirect_create_context(struct glx_screen *psc,
     ** of the buffer is selected so that the maximum number of GLX rendering
     ** commands can fit in a single X packet and still have room in the X
     ** packet for the GLXRenderReq header.
+    **
+    ** LIBGL_INDIRECT_BUFFER_SIZE can ask for a larger buffer, up to what
+    ** the server accepts with BIG-REQUESTS, so that fewer requests are
+    ** sent over slow connections.
     */
 
    bufSize = (XMaxRequestSize(psc->dpy) * 4) - sz_xGLXRenderReq;
+   env = getenv("LIBGL_INDIRECT_BUFFER_SIZE");
+   if (env) {
+      /* The extended length field takes 4 more bytes */
+      maxBufSize = (XExtendedMaxRequestSize(psc->dpy) * 4) - 4
+         - sz_xGLXRenderReq;
+      if (maxBufSize > (1 << 24))
+         maxBufSize = 1 << 24;
+      if (atoi(env) > bufSize)
+         bufSize = atoi(env) < maxBufSize ? atoi(env) : maxBufSize;
+   }
    gc->buf = malloc(bufSize);
    if (!gc->buf) {
       free(gc->client_state_private);
@@ -425,10 +440,16 @@ indirect_create_context(struct glx_screen *psc,
     ** Constrain the maximum drawing command size allowed to be
     ** transfered using the X_GLXRender protocol request.  First
     ** constrain by a software limit, then constrain by the protocl
-    ** limit.
+    ** limit.  LIBGL_INDIRECT_RENDER_LIMIT can raise the software limit
+    ** so that more commands are batched in the render buffer.
     */
-   if (bufSize > __GLX_RENDER_CMD_SIZE_LIMIT) {
-      bufSize = __GLX_RENDER_CMD_SIZE_LIMIT;
+   renderLimit = __GLX_RENDER_CMD_SIZE_LIMIT;
+   env = getenv("LIBGL_INDIRECT_RENDER_LIMIT");
+   if (env && atoi(env) > 0) {
+      renderLimit = atoi(env);
+   }
+   if (bufSize > renderLimit) {
+      bufSize = renderLimit;
    }
    if (bufSize > __GLX_MAX_RENDER_CMD_SIZE) {
       bufSize = __GLX_MAX_RENDER_CMD_SIZE;
@@ -67,10 +67,13 @@
 #include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #ifdef HAVE_LIBUDEV
 #include <assert.h>
 #include <dlfcn.h>
 #endif
+#include "c11/threads.h"
 #include "loader.h"
 
 #ifndef __NOT_HAVE_DRM_H
@@ -157,8 +160,8 @@ udev_device_new_from_fd(struct udev *udev, int fd)
    return device;
 }
 
-int
-loader_get_pci_id_for_fd(int fd, int *vendor_id, int *chip_id)
+static int
+get_pci_id_for_fd(int fd, int *vendor_id, int *chip_id)
 {
    struct udev *udev = NULL;
    struct udev_device *device = NULL, *parent;
@@ -209,8 +212,8 @@ out:
 /* for radeon */
 #include <radeon_drm.h>
 
-int
-loader_get_pci_id_for_fd(int fd, int *vendor_id, int *chip_id)
+static int
+get_pci_id_for_fd(int fd, int *vendor_id, int *chip_id)
 {
    drmVersionPtr version;
 
@@ -275,8 +278,8 @@ loader_get_pci_id_for_fd(int fd, int *vendor_id, int *chip_id)
 
 #else
 
-int
-loader_get_pci_id_for_fd(int fd, int *vendor_id, int *chip_id)
+static int
+get_pci_id_for_fd(int fd, int *vendor_id, int *chip_id)
 {
    return 0;
 }
@@ -284,6 +287,54 @@ loader_get_pci_id_for_fd(int fd, int *vendor_id, int *chip_id)
 #endif
 
 
+/* Looking up the PCI ID goes through udev and sysfs, which is slow compared
+ * to creating a display.  The result never changes for a device, so keep
+ * it around, keyed by device number since fds get reused.
+ */
+#define PCI_ID_CACHE_SIZE 8
+
+static struct {
+   dev_t rdev;
+   int vendor_id, chip_id;
+} pci_id_cache[PCI_ID_CACHE_SIZE];
+static unsigned pci_id_cache_count;
+static mtx_t pci_id_cache_mutex = _MTX_INITIALIZER_NP;
+
+int
+loader_get_pci_id_for_fd(int fd, int *vendor_id, int *chip_id)
+{
+   struct stat buf;
+   unsigned i;
+
+   if (fstat(fd, &buf) < 0 || !S_ISCHR(buf.st_mode))
+      return get_pci_id_for_fd(fd, vendor_id, chip_id);
+
+   mtx_lock(&pci_id_cache_mutex);
+   for (i = 0; i < pci_id_cache_count; i++) {
+      if (pci_id_cache[i].rdev == buf.st_rdev) {
+         *vendor_id = pci_id_cache[i].vendor_id;
+         *chip_id = pci_id_cache[i].chip_id;
+         mtx_unlock(&pci_id_cache_mutex);
+         return 1;
+      }
+   }
+   mtx_unlock(&pci_id_cache_mutex);
+
+   if (!get_pci_id_for_fd(fd, vendor_id, chip_id))
+      return 0;
+
+   mtx_lock(&pci_id_cache_mutex);
+   if (pci_id_cache_count < PCI_ID_CACHE_SIZE) {
+      pci_id_cache[pci_id_cache_count].rdev = buf.st_rdev;
+      pci_id_cache[pci_id_cache_count].vendor_id = *vendor_id;
+      pci_id_cache[pci_id_cache_count].chip_id = *chip_id;
+      pci_id_cache_count++;
+   }
+   mtx_unlock(&pci_id_cache_mutex);
+
+   return 1;
+}
+
 char *
 loader_get_device_name_for_fd(int fd)
 {
@@ -47,6 +47,9 @@ __asm__(".text\n"
 
 #ifndef MAPI_MODE_BRIDGE
 
+__asm__(".balign 32\n"
+        "x86_64_entry_end:");
+
 __asm__("x86_64_current_tls:\n\t"
 	"movq " ENTRY_CURRENT_TABLE "@GOTTPOFF(%rip), %rax\n\t"
 	"ret");
@@ -55,15 +58,56 @@ extern unsigned long
 x86_64_current_tls();
 
 #include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
 #include "u_execmem.h"
 
+static char
+x86_64_entry_start[];
+
+static char
+x86_64_entry_end[];
+
+/**
+ * Replace the GOT load of the TLS offset in the public entries by the
+ * offset itself, which saves a memory access per GL call.  The text is
+ * made writable only while patching.  When that is not allowed or the
+ * offset doesn't fit in 32 bits the entries are left alone, they work
+ * either way.
+ */
 void
 entry_patch_public(void)
 {
-}
+   char patch[16] = {
+      /* movq %fs:0, %r11 */
+      0x64, 0x4c, 0x8b, 0x1c, 0x25, 0x00, 0x00, 0x00, 0x00,
+      /* jmp *0x1234(%r11) */
+      0x41, 0xff, 0xa3, 0x34, 0x12, 0x00, 0x00,
+   };
+   unsigned long addr, page_size;
+   char *start, *end, *entry;
+   int slot;
 
-static char
-x86_64_entry_start[];
+   addr = x86_64_current_tls();
+   if ((addr >> 32) != 0xffffffff)
+      return;
+   *((unsigned int *) (patch + 5)) = addr & 0xffffffff;
+
+   page_size = sysconf(_SC_PAGESIZE);
+   start = (char *) ((unsigned long) x86_64_entry_start & ~(page_size - 1));
+   end = x86_64_entry_end;
+
+   if (mprotect(start, end - start, PROT_READ | PROT_WRITE | PROT_EXEC))
+      return;
+
+   for (entry = x86_64_entry_start, slot = 0; entry < end;
+        entry += 32, slot++) {
+      *((unsigned int *) (patch + 12)) = slot * sizeof(mapi_func);
+      memcpy(entry, patch, sizeof(patch));
+   }
+
+   mprotect(start, end - start, PROT_READ | PROT_EXEC);
+}
 
 mapi_func
 entry_get_public(int slot)
@@ -0,0 +1,380 @@
+#!/usr/bin/env python
+
+# Copyright (C) 2014 The Mesa Authors
+#
+# Permission is hereby granted, free of charge, to any person obtaining a
+# copy of this software and associated documentation files (the "Software"),
+# to deal in the Software without restriction, including without limitation
+# the rights to use, copy, modify, merge, publish, distribute, sublicense,
+# and/or sell copies of the Software, and to permit persons to whom the
+# Software is furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice (including the next
+# paragraph) shall be included in all copies or substantial portions of the
+# Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+# THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+# FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+# IN THE SOFTWARE.
+
+# This script generates the file marshal_generated.c, which contains the
+# marshalling dispatch table used by the GL thread (see main/marshal.h).
+#
+# Every GL function gets a marshalling stub.  Calls whose arguments can be
+# copied, i.e. scalars and arrays with a fixed or a counted size, are
+# recorded into the current batch and executed later by the GL thread.
+# Everything else, such as calls returning values, writing to client memory
+# or taking images, first waits for the GL thread to finish and is then
+# executed right away.
+
+import license
+import gl_XML
+import re
+import sys, getopt
+
+
+header = """/**
+ * \\file marshal_generated.c
+ * Marshalling and unmarshalling of GL calls for the GL thread.
+ */
+
+
+#include "main/api_exec.h"
+#include "main/context.h"
+#include "main/dispatch.h"
+#include "main/macros.h"
+#include "main/marshal.h"
+"""
+
+
+# Functions which only remember a pointer, either an offset into the bound
+# array buffer or an address in client memory which is read by later draws.
+array_pointer_re = re.compile(r'^(?!Get).*Pointer(ARB|EXT|OES|NV)?$|^InterleavedArrays$')
+
+# Functions which read the current vertex arrays and, when no element array
+# buffer is bound, indices from client memory.
+draw_re = re.compile(r'^(Multi)?(Mode)?Draw(Arrays|Elements|RangeElements|TransformFeedback)|^ArrayElement$')
+
+# Functions which are always executed synchronously.
+sync_functions = set([
+    'Finish',
+    ])
+
+# Hand-written functions in main/marshal.c tracking the client state the
+# marshalling depends on.  They're called on the application thread with
+# the parameters of the GL call.
+tracked_functions = set([
+    'BindBuffer',
+    'DeleteBuffers',
+    'BindVertexArray',
+    'BindVertexArrayAPPLE',
+    'DeleteVertexArrays',
+    'PopClientAttrib',
+    ])
+
+
+def element_size(p):
+    """C expression for the size of one counted element of an array."""
+    base = p.get_base_type_string()
+    if base == 'GLvoid':
+        size = '1'
+    else:
+        size = 'sizeof({0})'.format(base)
+    if p.count_scale != 1:
+        size = '{0} * {1}'.format(p.count_scale, size)
+    return size
+
+
+class marshal_function(object):
+    """How the parameters of a function are marshalled."""
+
+    def __init__(self, f):
+        self.f = f
+        self.params = [p for p in f.parameterIterator() if not p.is_padding]
+        self.scalars = []           # copied into the command
+        self.by_value = []          # pointers passed along unchanged
+        self.fixed_arrays = []      # arrays of a constant size
+        self.variable_arrays = []   # arrays sized by a scalar parameter
+        self.sync = not self.classify()
+
+    def classify(self):
+        f = self.f
+
+        if f.return_type != 'void' or f.name in sync_functions:
+            return False
+
+        scalar_names = [p.name for p in self.params if not p.is_pointer()]
+
+        for p in self.params:
+            if not p.is_pointer():
+                self.scalars.append(p)
+            elif p.is_output or p.is_image() or \
+                 not p.type_string().startswith('const'):
+                return False
+            elif p.name == 'pointer' and array_pointer_re.match(f.name) and \
+                 p.type_string().count('*') == 1:
+                self.by_value.append(p)
+            elif p.name in ('indices', 'indirect') and draw_re.match(f.name) \
+                 and p.type_string().count('*') == 1:
+                self.by_value.append(p)
+            elif p.count_parameter_list or p.type_string().count('*') != 1:
+                return False
+            elif p.counter:
+                if p.counter not in scalar_names:
+                    return False
+                self.variable_arrays.append(p)
+            elif p.count:
+                self.fixed_arrays.append(p)
+            else:
+                return False
+
+        return True
+
+    def has_members(self):
+        return len(self.params) != 0
+
+    def is_draw(self):
+        return draw_re.match(self.f.name) is not None
+
+    def has_indices(self):
+        return 'indices' in [p.name for p in self.by_value]
+
+    def is_array_pointer(self):
+        return 'pointer' in [p.name for p in self.by_value]
+
+
+class PrintCode(gl_XML.gl_print_base):
+
+    def __init__(self):
+        gl_XML.gl_print_base.__init__(self)
+
+        self.name = 'gl_marshal.py'
+        self.license = license.bsd_license_template % (
+            'Copyright (C) 2014 The Mesa Authors', 'The Mesa Authors')
+
+    def printRealHeader(self):
+        print header
+
+    def printRealFooter(self):
+        pass
+
+    def print_sync_call(self, m, indent):
+        f = m.f
+        call = 'CALL_{0}(ctx->GLThread->ServerDispatch, ({1}))'.format(
+            f.name, f.get_called_parameter_string())
+        print indent + '_mesa_glthread_finish(ctx);'
+        if f.return_type != 'void':
+            print indent + 'result = {0};'.format(call)
+            print indent + '_mesa_glthread_restore_dispatch(ctx);'
+            print indent + 'return result;'
+        else:
+            print indent + call + ';'
+            print indent + '_mesa_glthread_restore_dispatch(ctx);'
+
+    def print_command(self, m):
+        f = m.f
+
+        print 'struct marshal_cmd_{0}'.format(f.name)
+        print '{'
+        print '   struct marshal_cmd_base cmd_base;'
+        for p in m.scalars + m.by_value:
+            print '   {0} {1};'.format(p.type_string(), p.name)
+        for p in m.fixed_arrays:
+            print '   {0} {1}[{2}];'.format(p.get_base_type_string(), p.name,
+                                           p.count * p.count_scale)
+        for p in m.fixed_arrays + m.variable_arrays:
+            print '   GLboolean {0}_null;'.format(p.name)
+        for p in m.variable_arrays:
+            print '   /* followed by {0} * {1} bytes of {2} */'.format(
+                p.counter, element_size(p), p.name)
+        print '};'
+        print ''
+
+        print 'static inline void'
+        print '_mesa_unmarshal_{0}(struct gl_context *ctx, const struct marshal_cmd_{0} *cmd)'.format(f.name)
+        print '{'
+        if m.variable_arrays:
+            print '   const char *variable_data = (const char *) (cmd + 1);'
+        for p in m.fixed_arrays:
+            print '   {0} {1} = cmd->{1}_null ? NULL : cmd->{1};'.format(
+                p.type_string(), p.name)
+        for p in m.variable_arrays:
+            print '   {0} {1};'.format(p.type_string(), p.name)
+        for p in m.variable_arrays:
+            print '   {0} = cmd->{0}_null ? NULL : ({1}) variable_data;'.format(
+                p.name, p.type_string())
+            if p != m.variable_arrays[-1]:
+                print '   variable_data += ALIGN((size_t) cmd->{0} * {1}, 8);'.format(
+                    p.counter, element_size(p))
+        args = []
+        for p in m.params:
+            if p in m.scalars or p in m.by_value:
+                args.append('cmd->' + p.name)
+            else:
+                args.append(p.name)
+        print '   (void) ctx;'
+        print '   CALL_{0}(GET_DISPATCH(), ({1}));'.format(
+            f.name, ', '.join(args))
+        print '}'
+        print ''
+
+    def print_marshal(self, m):
+        f = m.f
+
+        print 'static {0} GLAPIENTRY'.format(f.return_type)
+        print '_mesa_marshal_{0}({1})'.format(f.name, f.get_parameter_string())
+        print '{'
+        print '   GET_CURRENT_CONTEXT(ctx);'
+        if f.return_type != 'void':
+            print '   {0} result;'.format(f.return_type)
+
+        if not m.sync:
+            for p in m.variable_arrays:
+                print '   const size_t {0}_size = _mesa_marshal_array_size({1}, {2});'.format(
+                    p.name, p.counter, element_size(p))
+            size = ['sizeof(struct marshal_cmd_{0})'.format(f.name)]
+            size += ['ALIGN({0}_size, 8)'.format(p.name)
+                     for p in m.variable_arrays]
+            print '   const size_t cmd_size = {0};'.format(' + '.join(size))
+            if m.has_members():
+                print '   struct marshal_cmd_{0} *cmd;'.format(f.name)
+            if m.variable_arrays:
+                print '   char *variable_data;'
+
+        if f.name in tracked_functions:
+            print '   _mesa_glthread_{0}({1});'.format(
+                f.name, ', '.join(['ctx'] + [p.name for p in m.params]))
+        if not m.sync and m.is_array_pointer():
+            print '   _mesa_glthread_array_pointer(ctx, pointer);'
+
+        if m.sync:
+            self.print_sync_call(m, '   ')
+            print '}'
+            print ''
+            return
+
+        conditions = []
+        if m.variable_arrays:
+            conditions.append('cmd_size > MARSHAL_MAX_CMD_SIZE')
+        if m.is_draw():
+            conditions.append('ctx->GLThread->HasUserVertexArrays')
+        if m.has_indices():
+            conditions.append('!ctx->GLThread->ElementArrayBufferBound')
+        if conditions:
+            print '   if (unlikely({0})) {{'.format(' ||\n                '.join(conditions))
+            self.print_sync_call(m, '      ')
+            print '      return;'
+            print '   }'
+            print ''
+
+        if m.has_members():
+            print '   cmd = _mesa_glthread_allocate_command(ctx, DISPATCH_CMD_{0}, cmd_size);'.format(f.name)
+        else:
+            print '   _mesa_glthread_allocate_command(ctx, DISPATCH_CMD_{0}, cmd_size);'.format(f.name)
+        for p in m.scalars + m.by_value:
+            print '   cmd->{0} = {0};'.format(p.name)
+        for p in m.fixed_arrays:
+            print '   cmd->{0}_null = {0} == NULL;'.format(p.name)
+            print '   if ({0})'.format(p.name)
+            print '      memcpy(cmd->{0}, {0}, sizeof(cmd->{0}));'.format(p.name)
+        if m.variable_arrays:
+            print '   variable_data = (char *) (cmd + 1);'
+        for p in m.variable_arrays:
+            print '   cmd->{0}_null = {0} == NULL;'.format(p.name)
+            print '   if ({0})'.format(p.name)
+            print '      memcpy(variable_data, {0}, {0}_size);'.format(p.name)
+            if p != m.variable_arrays[-1]:
+                print '   variable_data += ALIGN({0}_size, 8);'.format(p.name)
+
+        if f.name == 'Flush':
+            print '   _mesa_glthread_flush_batch(ctx);'
+        print '}'
+        print ''
+
+    def printBody(self, api):
+        functions = [marshal_function(f) for f in api.functionIterateByOffset()]
+        async = [m for m in functions if not m.sync]
+
+        print 'enum marshal_dispatch_cmd_id'
+        print '{'
+        for m in async:
+            print '   DISPATCH_CMD_{0},'.format(m.f.name)
+        print '};'
+        print ''
+
+        for m in async:
+            self.print_command(m)
+
+        print ''
+        print '/**'
+        print ' * Execute a recorded command on the GL thread.'
+        print ' * \\return the size of the command in bytes'
+        print ' */'
+        print 'size_t'
+        print '_mesa_unmarshal_dispatch_cmd(struct gl_context *ctx, const void *cmd)'
+        print '{'
+        print '   const struct marshal_cmd_base *cmd_base = cmd;'
+        print ''
+        print '   switch (cmd_base->cmd_id) {'
+        for m in async:
+            print '   case DISPATCH_CMD_{0}:'.format(m.f.name)
+            print '      _mesa_unmarshal_{0}(ctx, (const struct marshal_cmd_{0} *) cmd);'.format(m.f.name)
+            print '      break;'
+        print '   default:'
+        print '      assert(!"unknown marshalled command");'
+        print '      break;'
+        print '   }'
+        print ''
+        print '   return cmd_base->cmd_size;'
+        print '}'
+        print ''
+        print ''
+
+        for m in functions:
+            self.print_marshal(m)
+
+        print ''
+        print '/**'
+        print ' * Create a dispatch table with the marshalling functions.'
+        print ' */'
+        print 'struct _glapi_table *'
+        print '_mesa_create_marshal_table(const struct gl_context *ctx)'
+        print '{'
+        print '   struct _glapi_table *table;'
+        print ''
+        print '   table = _mesa_alloc_dispatch_table();'
+        print '   if (table == NULL)'
+        print '      return NULL;'
+        print ''
+        for m in functions:
+            print '   SET_{0}(table, _mesa_marshal_{0});'.format(m.f.name)
+        print ''
+        print '   return table;'
+        print '}'
+
+
+def show_usage():
+    print "Usage: %s [-f input_file_name]" % sys.argv[0]
+    sys.exit(1)
+
+
+if __name__ == '__main__':
+    file_name = "gl_and_es_API.xml"
+
+    try:
+        (args, trail) = getopt.getopt(sys.argv[1:], "f:")
+    except Exception,e:
+        show_usage()
+
+    for (arg,val) in args:
+        if arg == "-f":
+            file_name = val
+
+    printer = PrintCode()
+
+    api = gl_XML.parse_GL_API(file_name)
+    printer.Print(api)
@@ -33,6 +33,7 @@ intermediates := $(call local-intermediates-dir)
 sources := \
 	main/enums.c \
 	main/api_exec.c \
+	main/marshal_generated.c \
 	main/dispatch.h \
 	main/remap_helper.h \
 	main/get_hash.h
@@ -110,6 +111,12 @@ $(intermediates)/main/api_exec.c: PRIVATE_XML := -f $(glapi)/gl_and_es_API.xml
 $(intermediates)/main/api_exec.c: $(dispatch_deps)
 	$(call es-gen)
 
+$(intermediates)/main/marshal_generated.c: PRIVATE_SCRIPT := $(MESA_PYTHON2) $(glapi)/gl_marshal.py
+$(intermediates)/main/marshal_generated.c: PRIVATE_XML := -f $(glapi)/gl_and_es_API.xml
+
+$(intermediates)/main/marshal_generated.c: $(dispatch_deps)
+	$(call es-gen)
+
 GET_HASH_GEN := $(LOCAL_PATH)/main/get_hash_generator.py
 
 $(intermediates)/main/get_hash.h: $(glapi)/gl_and_es_API.xml \
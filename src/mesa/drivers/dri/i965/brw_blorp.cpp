@@ -199,8 +199,83 @@ intel_hiz_exec(struct brw_context *brw, struct intel_mipmap_tree *mt,
    brw_blorp_exec(brw, &params);
 }
 
+/**
+ * Begin a group of BLORP operations.
+ *
+ * The operations of a group are emitted back to back: the cache flushes
+ * which bracket every BLORP operation, and the re-emission of all GL state
+ * afterwards, are done once for the whole group, and the state which doesn't
+ * depend on the operation is only emitted for the first one (see
+ * brw_blorp_emit_invariant_state()).  This suits sequences of operations on
+ * different surfaces, or different slices of one, like the clears of all the
+ * color buffers or layers of a framebuffer, or the resolves before a draw.
+ *
+ * Nothing but BLORP operations may be emitted between brw_blorp_begin_group()
+ * and brw_blorp_end_group().  Groups nest; only the outermost one counts.
+ */
+void
+brw_blorp_begin_group(struct brw_context *brw)
+{
+   if (brw->blorp.group_depth++ > 0)
+      return;
+
+   brw->blorp.group_ops = 0;
+   brw->blorp.invariant_state_valid = false;
+}
+
+/**
+ * End a group of BLORP operations started with brw_blorp_begin_group().
+ */
+void
+brw_blorp_end_group(struct brw_context *brw)
+{
+   assert(brw->blorp.group_depth > 0);
+   if (--brw->blorp.group_depth > 0)
+      return;
+
+   brw->blorp.invariant_state_valid = false;
+
+   if (brw->blorp.group_ops == 0)
+      return;
+
+   /* We've smashed all state compared to what the normal 3D pipeline
+    * rendering tracks for GL.
+    */
+   brw->state.dirty.brw = ~0;
+   brw->state.dirty.cache = ~0;
+   brw->ib.type = -1;
+   intel_batchbuffer_clear_cache(brw);
+
+   /* Flush the sampler cache so any texturing from the destination is
+    * coherent.
+    */
+   intel_batchbuffer_emit_mi_flush(brw);
+}
+
 } /* extern "C" */
 
+/**
+ * Whether the operation has to emit the state which doesn't depend on the
+ * operation itself: the multisample state, STATE_BASE_ADDRESS, the URB
+ * configuration, the disabled stages and the CC viewport.  That is the case
+ * unless an earlier operation of the same group already emitted it to this
+ * batch, for the same sample count and with the same use of a WM program.
+ */
+bool
+brw_blorp_emit_invariant_state(struct brw_context *brw,
+                               const brw_blorp_params *params)
+{
+   if (brw->blorp.invariant_state_valid &&
+       brw->blorp.num_samples == params->dst.num_samples &&
+       brw->blorp.use_wm_prog == params->use_wm_prog)
+      return false;
+
+   brw->blorp.invariant_state_valid = brw->blorp.group_depth > 0;
+   brw->blorp.num_samples = params->dst.num_samples;
+   brw->blorp.use_wm_prog = params->use_wm_prog;
+   return true;
+}
+
 void
 brw_blorp_exec(struct brw_context *brw, const brw_blorp_params *params)
 {
@@ -208,14 +283,22 @@ brw_blorp_exec(struct brw_context *brw, const brw_blorp_params *params)
    uint32_t estimated_max_batch_usage = 1500;
    bool check_aperture_failed_once = false;
 
+   brw_blorp_begin_group(brw);
+
    /* Flush the sampler and render caches.  We definitely need to flush the
     * sampler cache so that we get updated contents from the render cache for
     * the glBlitFramebuffer() source.  Also, we are sometimes warned in the
     * docs to flush the cache between reinterpretations of the same surface
     * data with different formats, which blorp does for stencil and depth
     * data.
+    *
+    * The operations of a group don't read each other's results, so only
+    * the first of them needs this.
     */
-   intel_batchbuffer_emit_mi_flush(brw);
+   if (brw->blorp.group_ops++ == 0)
+      intel_batchbuffer_emit_mi_flush(brw);
+
+   brw_perf_monitor_begin_draw(brw, true);
 
 retry:
    intel_batchbuffer_require_space(brw, estimated_max_batch_usage, RENDER_RING);
@@ -251,7 +334,8 @@ retry:
 
    /* Check if the blorp op we just did would make our batch likely to fail to
     * map all the BOs into the GPU at batch exec time later.  If so, flush the
-    * batch and try again with nothing else in the batch.
+    * batch and try again with nothing else in the batch.  (Flushing starts a
+    * new batch, which the invariant state has to be emitted to again.)
     */
    if (dri_bufmgr_check_aperture_space(&brw->batch.bo, 1)) {
       if (!check_aperture_failed_once) {
@@ -266,21 +350,12 @@ retry:
       }
    }
 
+   brw_perf_monitor_end_draw(brw);
+
    if (unlikely(brw->always_flush_batch))
       intel_batchbuffer_flush(brw);
 
-   /* We've smashed all state compared to what the normal 3D pipeline
-    * rendering tracks for GL.
-    */
-   brw->state.dirty.brw = ~0;
-   brw->state.dirty.cache = ~0;
-   brw->ib.type = -1;
-   intel_batchbuffer_clear_cache(brw);
-
-   /* Flush the sampler cache so any texturing from the destination is
-    * coherent.
-    */
-   intel_batchbuffer_emit_mi_flush(brw);
+   brw_blorp_end_group(brw);
 }
 
 brw_hiz_op_params::brw_hiz_op_params(struct intel_mipmap_tree *mt,
@@ -54,6 +54,12 @@ void
 brw_blorp_resolve_color(struct brw_context *brw,
                         struct intel_mipmap_tree *mt);
 
+void
+brw_blorp_begin_group(struct brw_context *brw);
+
+void
+brw_blorp_end_group(struct brw_context *brw);
+
 #ifdef __cplusplus
 } /* end extern "C" */
 
@@ -243,6 +249,10 @@ public:
 void
 brw_blorp_exec(struct brw_context *brw, const brw_blorp_params *params);
 
+bool
+brw_blorp_emit_invariant_state(struct brw_context *brw,
+                               const brw_blorp_params *params);
+
 
 /**
  * Parameters for a HiZ or depth resolve operation.
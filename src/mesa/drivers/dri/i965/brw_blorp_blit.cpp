@@ -2249,17 +2249,18 @@ brw_blorp_blit_params::get_wm_prog(struct brw_context *brw,
                                    brw_blorp_prog_data **prog_data) const
 {
    uint32_t prog_offset = 0;
-   if (!brw_search_cache(&brw->cache, BRW_BLORP_BLIT_PROG,
-                         &this->wm_prog_key, sizeof(this->wm_prog_key),
-                         &prog_offset, prog_data)) {
+   if (!brw_search_shared_cache(brw, BRW_BLORP_BLIT_PROG,
+                                &this->wm_prog_key, sizeof(this->wm_prog_key),
+                                sizeof(brw_blorp_prog_data),
+                                &prog_offset, prog_data)) {
       brw_blorp_blit_program prog(brw, &this->wm_prog_key);
       GLuint program_size;
       const GLuint *program = prog.compile(brw, &program_size, stdout);
-      brw_upload_cache(&brw->cache, BRW_BLORP_BLIT_PROG,
-                       &this->wm_prog_key, sizeof(this->wm_prog_key),
-                       program, program_size,
-                       &prog.prog_data, sizeof(prog.prog_data),
-                       &prog_offset, prog_data);
+      brw_upload_shared_cache(brw, BRW_BLORP_BLIT_PROG,
+                              &this->wm_prog_key, sizeof(this->wm_prog_key),
+                              program, program_size,
+                              &prog.prog_data, sizeof(prog.prog_data),
+                              &prog_offset, prog_data);
    }
    return prog_offset;
 }
@@ -399,17 +399,18 @@ brw_blorp_const_color_params::get_wm_prog(struct brw_context *brw,
    const
 {
    uint32_t prog_offset = 0;
-   if (!brw_search_cache(&brw->cache, BRW_BLORP_CONST_COLOR_PROG,
-                         &this->wm_prog_key, sizeof(this->wm_prog_key),
-                         &prog_offset, prog_data)) {
+   if (!brw_search_shared_cache(brw, BRW_BLORP_CONST_COLOR_PROG,
+                                &this->wm_prog_key, sizeof(this->wm_prog_key),
+                                sizeof(brw_blorp_prog_data),
+                                &prog_offset, prog_data)) {
       brw_blorp_const_color_program prog(brw, &this->wm_prog_key);
       GLuint program_size;
       const GLuint *program = prog.compile(brw, &program_size);
-      brw_upload_cache(&brw->cache, BRW_BLORP_CONST_COLOR_PROG,
-                       &this->wm_prog_key, sizeof(this->wm_prog_key),
-                       program, program_size,
-                       &prog.prog_data, sizeof(prog.prog_data),
-                       &prog_offset, prog_data);
+      brw_upload_shared_cache(brw, BRW_BLORP_CONST_COLOR_PROG,
+                              &this->wm_prog_key, sizeof(this->wm_prog_key),
+                              program, program_size,
+                              &prog.prog_data, sizeof(prog.prog_data),
+                              &prog_offset, prog_data);
    }
    return prog_offset;
 }
@@ -562,6 +563,11 @@ bool
 brw_blorp_clear_color(struct brw_context *brw, struct gl_framebuffer *fb,
                       bool partial_clear)
 {
+   bool ok = true;
+
+   /* Clear all the buffers and layers in one group of BLORP operations. */
+   brw_blorp_begin_group(brw);
+
    for (unsigned buf = 0; buf < fb->_NumColorDrawBuffers; buf++) {
       struct gl_renderbuffer *rb = fb->_ColorDrawBuffers[buf];
       struct intel_renderbuffer *irb = intel_renderbuffer(rb);
@@ -583,19 +589,24 @@ brw_blorp_clear_color(struct brw_context *brw, struct gl_framebuffer *fb,
          for (unsigned layer = 0; layer < num_layers; layer++) {
             if (!do_single_blorp_clear(brw, fb, rb, buf, partial_clear,
                                        layer * layer_multiplier)) {
-               return false;
+               ok = false;
+               goto done;
             }
          }
       } else {
          unsigned layer = irb->mt_layer;
-         if (!do_single_blorp_clear(brw, fb, rb, buf, partial_clear, layer))
-            return false;
+         if (!do_single_blorp_clear(brw, fb, rb, buf, partial_clear, layer)) {
+            ok = false;
+            goto done;
+         }
       }
 
       intel_renderbuffer_set_needs_downsample(irb);
    }
 
-   return true;
+done:
+   brw_blorp_end_group(brw);
+   return ok;
 }
 
 void
@@ -186,10 +186,12 @@ brw_fast_clear_depth(struct gl_context *ctx)
 
    if (fb->MaxNumLayers > 0) {
       unsigned num_layers = depth_irb->mt->level[depth_irb->mt_level].depth;
+      brw_blorp_begin_group(brw);
       for (unsigned layer = 0; layer < num_layers; layer++) {
          intel_hiz_exec(brw, mt, depth_irb->mt_level, layer,
                         GEN6_HIZ_OP_DEPTH_CLEAR);
       }
+      brw_blorp_end_group(brw);
    } else {
       intel_hiz_exec(brw, mt, depth_irb->mt_level, depth_irb->mt_layer,
                      GEN6_HIZ_OP_DEPTH_CLEAR);
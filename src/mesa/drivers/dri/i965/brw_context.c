@@ -480,14 +480,19 @@ brw_initialize_context_constants(struct brw_context *brw)
       ctx->ShaderCompilerOptions[i].EmitNoIndirectInput = true;
       ctx->ShaderCompilerOptions[i].EmitNoIndirectOutput = true;
 
-      ctx->ShaderCompilerOptions[i].EmitNoIndirectUniform =
-	 (i == MESA_SHADER_FRAGMENT);
-      ctx->ShaderCompilerOptions[i].EmitNoIndirectTemp =
-	 (i == MESA_SHADER_FRAGMENT);
+      bool is_scalar = (i == MESA_SHADER_FRAGMENT ||
+                        (i == MESA_SHADER_VERTEX && brw->scalar_vs));
+
+      ctx->ShaderCompilerOptions[i].EmitNoIndirectUniform = is_scalar;
+      ctx->ShaderCompilerOptions[i].EmitNoIndirectTemp = is_scalar;
       ctx->ShaderCompilerOptions[i].LowerClipDistance = true;
    }
 
-   ctx->ShaderCompilerOptions[MESA_SHADER_VERTEX].OptimizeForAOS = true;
+   /* The scalar backend wants everything split into channels, so don't let
+    * the vectorizer undo that work.
+    */
+   ctx->ShaderCompilerOptions[MESA_SHADER_VERTEX].OptimizeForAOS =
+      !brw->scalar_vs;
    ctx->ShaderCompilerOptions[MESA_SHADER_GEOMETRY].OptimizeForAOS = true;
 
    /* ARB_viewport_array */
@@ -623,6 +628,8 @@ brwCreateContext(gl_api api,
    brw->must_use_separate_stencil = screen->hw_must_use_separate_stencil;
    brw->has_swizzling = screen->hw_has_swizzling;
 
+   brw->scalar_vs = brw->gen >= 8 && getenv("INTEL_SCALAR_VS") != NULL;
+
    if (brw->gen >= 8) {
       gen8_init_vtable_surface_functions(brw);
       gen7_init_vtable_sampler_functions(brw);
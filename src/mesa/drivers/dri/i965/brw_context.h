@@ -328,6 +328,13 @@ struct brw_shader {
    struct gl_shader base;
 
    bool compiled_once;
+
+   /**
+    * What the shader was linked from, for the keys of the on-disk program
+    * cache.  See brw_disk_cache_set_source().
+    */
+   GLubyte *cache_source;
+   unsigned cache_source_size;
 };
 
 /* Note: If adding fields that need anything besides a normal memcmp() for
@@ -614,6 +621,9 @@ struct brw_vs_prog_data {
    GLbitfield64 inputs_read;
 
    bool uses_vertexid;
+
+   /** Compiled by the scalar backend, for SIMD8 dispatch (gen >= 8). */
+   bool simd8;
 };
 
 
@@ -772,6 +782,18 @@ struct brw_cache {
    cache_aux_compare_func aux_compare[BRW_MAX_CACHE];
    /** Optional functions for freeing other pointers attached to a prog_data. */
    cache_aux_free_func aux_free[BRW_MAX_CACHE];
+
+   /** Compiled programs saved across runs, if MESA_SHADER_CACHE_DIR is set */
+   struct brw_disk_cache *disk;
+
+   /** Counters reported at context destruction for INTEL_DEBUG=cache */
+   struct {
+      unsigned uploads;          /**< items added to the cache */
+      unsigned copies;           /**< of those, sharing another's data */
+      unsigned shared_hits;      /**< kernels found in the screen's cache */
+      unsigned insns;            /**< EU instructions before compaction */
+      unsigned compacted_insns;  /**< of those, compacted */
+   } stats;
 };
 
 
@@ -786,6 +808,26 @@ struct brw_tracked_state {
    void (*emit)( struct brw_context *brw );
 };
 
+/**
+ * An entry of the per-generation lists of state atoms in
+ * brw_state_upload.c.
+ */
+struct brw_atom {
+   const struct brw_tracked_state *state;
+   const char *name;
+};
+
+/** Upper bound on the length of the atom lists, for the atom masks. */
+#define BRW_MAX_ATOMS 64
+
+struct brw_atom_stats {
+   /** Number of times the atom was emitted. */
+   uint64_t emits;
+
+   /** CPU time spent emitting it, only counted while atom_time_users > 0. */
+   uint64_t time_ns;
+};
+
 enum shader_time_shader_type {
    ST_NONE,
    ST_VS,
@@ -888,6 +930,13 @@ struct intel_batchbuffer {
    uint32_t *cpu_map;
 #define BATCH_SZ (8192*sizeof(uint32_t))
 
+   /**
+    * Batch BOs submitted before last_bo, oldest first.  They are reused for
+    * new batches once the GPU is done with them.
+    */
+   drm_intel_bo *pool[8];
+   unsigned pool_count;
+
    uint32_t state_batch_offset;
    enum brw_gpu_ring ring;
    bool needs_sol_reset;
@@ -1043,12 +1092,33 @@ struct brw_context
    struct intel_batchbuffer batch;
    bool no_batch_wrap;
 
+   /** BLORP operation groups, see brw_blorp_begin_group() */
+   struct {
+      unsigned group_depth;
+      unsigned group_ops;           /**< operations in the outermost group */
+
+      /**
+       * Whether the invariant BLORP state emitted by the last operation is
+       * still current, and with which parameters it was emitted.
+       */
+      bool invariant_state_valid;
+      unsigned num_samples;
+      bool use_wm_prog;
+   } blorp;
+
+   /** Streamed data, see intel_upload_space() */
    struct {
       drm_intel_bo *bo;
-      GLuint offset;
-      uint32_t buffer_len;
-      uint32_t buffer_offset;
-      char buffer[4096];
+      char *map;               /**< of bo, while it is current */
+      uint32_t next_offset;
+
+      /** Recent intel_upload_data() calls, for reuse within the batch */
+      struct intel_upload_range {
+         const void *ptr;      /**< client memory uploaded */
+         uint32_t size;
+         uint32_t offset;      /**< in bo */
+      } recent[8];
+      unsigned recent_next;
    } upload;
 
    /**
@@ -1136,6 +1206,13 @@ struct brw_context
     */
    bool needs_unlit_centroid_workaround;
 
+   /**
+    * Compile vertex shaders with the scalar (SIMD8) fs backend instead of
+    * the vec4 backend.  Only supported on Gen8+, and currently opt-in via
+    * INTEL_SCALAR_VS.
+    */
+   bool scalar_vs;
+
    GLuint NewGLState;
    struct {
       struct brw_state_flags dirty;
@@ -1433,6 +1510,26 @@ struct brw_context
       int unresolved_elements;
       int unresolved_array_size;
 
+      /** ID of the state atom statistics group, or -1 if there's none. */
+      int atom_group;
+
+      /** ID of the per-draw timing group, or -1 if there's none. */
+      int draw_timing_group;
+
+      /**
+       * The active monitors which bracket every draw and BLORP operation
+       * with snapshots (see brw_perf_monitor_begin_draw()).
+       */
+      struct brw_perf_monitor_object **draw_timers;
+      int draw_timers_elements;
+      int draw_timers_array_size;
+
+      /**
+       * Offset within an OA snapshot of the counter which counts render
+       * target writes, or -1 if the hardware doesn't have one.
+       */
+      int rt_writes_entry;
+
       /**
        * Mapping from a uint32_t offset within an OA snapshot to the ID of
        * the counter which MI_REPORT_PERF_COUNT stores there.
@@ -1444,7 +1541,19 @@ struct brw_context
    } perfmon;
 
    int num_atoms;
-   const struct brw_tracked_state **atoms;
+   const struct brw_atom *atoms;
+
+   /**
+    * For each bit of brw_state_flags, the mesa bits first, then the brw and
+    * the cache bits, the mask of the atoms which depend on it.
+    */
+   uint64_t atom_dispatch[3 * 32];
+
+   /** Statistics of each atom, indexed like atoms */
+   struct brw_atom_stats atom_stats[BRW_MAX_ATOMS];
+
+   /** Number of users of the atoms' CPU times (monitors, INTEL_DEBUG) */
+   int atom_time_users;
 
    /* If (INTEL_DEBUG & DEBUG_BATCH) */
    struct {
@@ -1628,9 +1737,57 @@ void brw_vec4_alloc_reg_set(struct brw_context *brw);
 /* brw_disasm.c */
 int brw_disasm (FILE *file, struct brw_instruction *inst, int gen);
 
+/* brw_disk_cache.cpp */
+void brw_disk_cache_init(struct brw_cache *cache);
+void brw_disk_cache_destroy(struct brw_cache *cache);
+void brw_disk_cache_set_source(struct brw_context *brw,
+                               const struct gl_shader_program *shProg,
+                               struct brw_shader *shader);
+const GLuint *brw_disk_cache_load(struct brw_context *brw,
+                                  enum brw_cache_id cache_id,
+                                  struct gl_shader_program *shProg,
+                                  struct gl_program *prog,
+                                  const void *key, GLuint key_size,
+                                  void *prog_data,
+                                  void *mem_ctx, GLuint *program_size);
+void brw_disk_cache_store(struct brw_context *brw,
+                          enum brw_cache_id cache_id,
+                          struct gl_shader_program *shProg,
+                          struct gl_program *prog,
+                          const void *key, GLuint key_size,
+                          const void *prog_data,
+                          const GLuint *program, GLuint program_size,
+                          GLuint num_parameters);
+void brw_disk_cache_note_variant(struct brw_context *brw,
+                                 enum brw_cache_id cache_id,
+                                 struct gl_shader_program *shProg,
+                                 struct gl_program *prog,
+                                 const void *key, GLuint key_size);
+void *brw_disk_cache_get_variants(struct brw_context *brw,
+                                  enum brw_cache_id cache_id,
+                                  struct gl_shader_program *shProg,
+                                  struct gl_program *prog,
+                                  GLuint key_size, unsigned *count);
+GLuint *brw_disk_cache_load_kernel(struct brw_context *brw,
+                                   enum brw_cache_id cache_id,
+                                   const void *key, GLuint key_size,
+                                   void *aux, GLuint aux_size,
+                                   GLuint *program_size);
+void brw_disk_cache_store_kernel(struct brw_context *brw,
+                                 enum brw_cache_id cache_id,
+                                 const void *key, GLuint key_size,
+                                 const GLuint *program, GLuint program_size,
+                                 const void *aux, GLuint aux_size);
+
 /* brw_vs.c */
 gl_clip_plane *brw_select_clip_planes(struct gl_context *ctx);
 
+/**
+ * What padding param[] entries point at.  They must all point at this one,
+ * for the on-disk program cache to tell them apart from uniforms.
+ */
+extern const float brw_zero_param;
+
 /* brw_draw_upload.c */
 unsigned brw_get_vertex_surface_type(struct brw_context *brw,
                                      const struct gl_client_array *glarray);
@@ -1672,6 +1829,8 @@ void brw_init_performance_monitors(struct brw_context *brw);
 void brw_dump_perf_monitors(struct brw_context *brw);
 void brw_perf_monitor_new_batch(struct brw_context *brw);
 void brw_perf_monitor_finish_batch(struct brw_context *brw);
+void brw_perf_monitor_begin_draw(struct brw_context *brw, bool blorp);
+void brw_perf_monitor_end_draw(struct brw_context *brw);
 
 /* intel_buffer_objects.c */
 int brw_bo_map(struct brw_context *brw, drm_intel_bo *bo, int write_enable,
@@ -821,6 +821,15 @@ enum opcode {
    FS_OPCODE_UNPACK_HALF_2x16_SPLIT_Y,
    FS_OPCODE_PLACEHOLDER_HALT,
 
+   /**
+    * Write vertex data to the URB from the scalar backend.
+    *
+    * Source 0 is unused; the header (URB handles, copied from g1) and the
+    * slot data have already been loaded into MRFs starting at base_mrf.
+    * inst->offset gives the starting VUE slot.
+    */
+   SHADER_OPCODE_URB_WRITE_SIMD8,
+
    VS_OPCODE_URB_WRITE,
    VS_OPCODE_PULL_CONSTANT_LOAD,
    VS_OPCODE_PULL_CONSTANT_LOAD_GEN7,
@@ -949,6 +958,14 @@ enum brw_urb_write_flags {
     */
    BRW_URB_WRITE_OWORD = 0x40,
 
+   /**
+    * Indicates that the data should be sent to the URB using the SIMD8
+    * URB write message used by the scalar vertex shader backend (gen >= 8).
+    * Each channel writes its own vertex, and offsets are multiples of an
+    * OWORD.
+    */
+   BRW_URB_WRITE_SIMD8 = 0x80,
+
    /**
     * Convenient combination of flags: end the thread while simultaneously
     * marking the given URB entry as complete.
@@ -1323,6 +1340,7 @@ enum brw_message_target {
 
 #define BRW_URB_OPCODE_WRITE_HWORD  0
 #define BRW_URB_OPCODE_WRITE_OWORD  1
+#define GEN8_URB_OPCODE_SIMD8_WRITE 7
 
 #define BRW_URB_SWIZZLE_NONE          0
 #define BRW_URB_SWIZZLE_INTERLEAVE    1
@@ -1484,6 +1502,8 @@ enum brw_message_target {
 # define GEN6_VS_STATISTICS_ENABLE			(1 << 10)
 # define GEN6_VS_CACHE_DISABLE				(1 << 1)
 # define GEN6_VS_ENABLE					(1 << 0)
+/* Gen8+ DW7 */
+# define GEN8_VS_SIMD8_ENABLE                           (1 << 2)
 /* Gen8+ DW8 */
 # define GEN8_VS_URB_ENTRY_OUTPUT_OFFSET_SHIFT          21
 # define GEN8_VS_URB_OUTPUT_LENGTH_SHIFT                16
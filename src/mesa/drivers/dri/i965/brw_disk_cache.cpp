@@ -0,0 +1,1060 @@
+/**************************************************************************
+ *
+ * Copyright 2014 The Mesa Authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * \file brw_disk_cache.cpp
+ *
+ * On-disk cache of compiled VS, GS and FS programs.
+ *
+ * When a program isn't in the in-memory state cache, do_vs_prog() and
+ * friends look for it here before compiling it, and store what they
+ * compile.  So do the link-time precompiles, which means that a run of an
+ * application after the first needn't compile anything it compiled before.
+ *
+ * The keys of the variants compiled at draw time, which the precompiles
+ * didn't guess, are remembered too, so that later runs can compile (or
+ * rather load) them at link time instead of hitching at draw time.
+ *
+ * Entries are keyed by the prog key, what the program was linked from
+ * (saved in the linked shader at link time, as the shaders' sources may be
+ * replaced later on) and the device and build.  They hold the assembly and
+ * the prog_data, in which the param[] and pull_param[] pointers are stored
+ * as the uniform, state parameter or clip plane component they point at.
+ *
+ * Each entry is a file of its own named after a hash of the key, which is
+ * stored in the file too and compared on lookup.  Files are written to a
+ * temporary name and renamed into place, so processes sharing the cache
+ * never see partial entries.  The cache is only enabled when
+ * MESA_SHADER_CACHE_DIR is set, the entries go to its i965 subdirectory.
+ *
+ * Kernels which only depend on their prog key, like the BLORP ones, are
+ * stored too, keyed by just the prog key, the device and the build.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+extern "C" {
+#include "main/macros.h"
+#include "main/hash_table.h"
+#include "program/prog_parameter.h"
+#include "brw_context.h"
+#include "brw_wm.h"
+#include "intel_screen.h"
+}
+#include "brw_vs.h"
+#include "brw_vec4_gs.h"
+#include "brw_vec4_gs_visitor.h"
+#include "glsl/glsl_types.h"
+#include "glsl/ir_uniform.h"
+
+#define FILE_DEBUG_FLAG DEBUG_STATE
+
+#define CACHE_MAGIC 0x69393635  /* "i965" */
+
+/**
+ * INTEL_DEBUG flags which the cache must not hide.  Shader time programs
+ * also embed the index of their shader time entry, which differs from run to
+ * run.
+ */
+#define UNCACHEABLE_DEBUG_FLAGS \
+   (DEBUG_VS | DEBUG_GS | DEBUG_WM | DEBUG_SHADER_TIME)
+
+struct brw_disk_cache {
+   char path[1024];
+};
+
+/** Header of every cache file, followed by the key and then the data */
+struct cache_entry_header {
+   uint32_t magic;
+   uint32_t key_size;
+   uint32_t data_size;
+   uint32_t data_hash;
+};
+
+/** Header of the data of an entry */
+struct program_header {
+   uint32_t program_size;
+   uint32_t prog_data_size;
+   uint32_t nr_params;
+   uint32_t nr_pull_params;
+};
+
+/** What a param[] entry points at */
+enum param_kind {
+   PARAM_NULL,
+   PARAM_ZERO,          /**< brw_zero_param */
+   PARAM_UNIFORM,       /**< a component of shProg->UniformStorage[index] */
+   PARAM_STATE,         /**< a component of prog->Parameters */
+   PARAM_CLIP_PLANE,    /**< a component of brw_select_clip_planes() */
+};
+
+/** Header of the list of the variants of a program */
+struct variants_header {
+   uint32_t prog_key_size;
+   uint32_t count;
+};
+
+/** Variants remembered per program, the most recently compiled ones */
+#define MAX_VARIANTS 16
+
+/** Set in the cache id of the keys of variant lists */
+#define VARIANTS_ID 0x100
+
+/** Set in the cache id of the keys of kernels, see make_kernel_key() */
+#define KERNEL_ID 0x200
+
+/** Header of the data of a kernel entry */
+struct kernel_header {
+   uint32_t program_size;
+   uint32_t aux_size;
+};
+
+static const char build_id[] =
+#ifdef PACKAGE_VERSION
+   PACKAGE_VERSION " "
+#endif
+   __DATE__ " " __TIME__;
+
+struct stored_param {
+   uint32_t kind;
+   uint32_t index;
+   uint32_t offset;
+};
+
+/**
+ * Where the param[] and pull_param[] pointers and their counts are in the
+ * prog_data of each cached program type.
+ */
+struct prog_data_layout {
+   gl_shader_stage stage;
+   size_t size;
+   size_t param, pull_param;
+   size_t nr_params, nr_pull_params;
+};
+
+static const struct prog_data_layout *
+get_layout(enum brw_cache_id cache_id)
+{
+#define VEC4_LAYOUT(stage, type)                                        \
+   { stage, sizeof(struct type),                                        \
+     offsetof(struct type, base.param),                                 \
+     offsetof(struct type, base.pull_param),                            \
+     offsetof(struct type, base.nr_params),                             \
+     offsetof(struct type, base.nr_pull_params) }
+
+   static const struct prog_data_layout vs_layout =
+      VEC4_LAYOUT(MESA_SHADER_VERTEX, brw_vs_prog_data);
+   static const struct prog_data_layout gs_layout =
+      VEC4_LAYOUT(MESA_SHADER_GEOMETRY, brw_gs_prog_data);
+   static const struct prog_data_layout wm_layout = {
+      MESA_SHADER_FRAGMENT, sizeof(struct brw_wm_prog_data),
+      offsetof(struct brw_wm_prog_data, param),
+      offsetof(struct brw_wm_prog_data, pull_param),
+      offsetof(struct brw_wm_prog_data, nr_params),
+      offsetof(struct brw_wm_prog_data, nr_pull_params)
+   };
+#undef VEC4_LAYOUT
+
+   switch (cache_id) {
+   case BRW_VS_PROG:
+      return &vs_layout;
+   case BRW_GS_PROG:
+      return &gs_layout;
+   case BRW_WM_PROG:
+      return &wm_layout;
+   default:
+      return NULL;
+   }
+}
+
+static const float ***
+prog_data_param(const struct prog_data_layout *layout, void *prog_data,
+                bool pull)
+{
+   return (const float ***)
+      ((char *) prog_data + (pull ? layout->pull_param : layout->param));
+}
+
+static GLuint *
+prog_data_nr_params(const struct prog_data_layout *layout, void *prog_data,
+                    bool pull)
+{
+   return (GLuint *)
+      ((char *) prog_data + (pull ? layout->nr_pull_params :
+                                    layout->nr_params));
+}
+
+
+/** A growing byte buffer, for keys and entries */
+struct byte_buffer {
+   GLubyte *data;
+   unsigned size;
+   unsigned capacity;
+   bool failed;
+};
+
+static void
+append(struct byte_buffer *buf, const void *data, unsigned size)
+{
+   if (buf->failed)
+      return;
+
+   if (buf->size + size > buf->capacity) {
+      unsigned capacity = MAX2(buf->capacity * 2, buf->size + size);
+      GLubyte *new_data = (GLubyte *) realloc(buf->data, capacity);
+      if (!new_data) {
+         buf->failed = true;
+         return;
+      }
+      buf->data = new_data;
+      buf->capacity = capacity;
+   }
+
+   memcpy(buf->data + buf->size, data, size);
+   buf->size += size;
+}
+
+static void
+append_string(struct byte_buffer *buf, const char *s)
+{
+   append(buf, s ? s : "", s ? strlen(s) + 1 : 1);
+}
+
+
+static bool
+make_path(char *path)
+{
+   for (char *p = path + 1; *p; p++) {
+      if (*p == '/') {
+         *p = '\0';
+         mkdir(path, 0755);
+         *p = '/';
+      }
+   }
+
+   return mkdir(path, 0755) == 0 || errno == EEXIST;
+}
+
+static void
+entry_filename(const struct brw_disk_cache *disk,
+               const struct byte_buffer *key, char *filename, size_t size)
+{
+   snprintf(filename, size, "%s/%08x-%x", disk->path,
+            _mesa_hash_data(key->data, key->size), key->size);
+}
+
+/**
+ * Read the entry for a key.
+ *
+ * \return the data, which the caller must free(), or NULL on a miss
+ */
+static void *
+read_entry(const struct brw_disk_cache *disk, const struct byte_buffer *key,
+           unsigned *size)
+{
+   struct cache_entry_header header;
+   char filename[1100];
+   void *stored_key = NULL, *data = NULL;
+   FILE *f;
+
+   entry_filename(disk, key, filename, sizeof(filename));
+
+   f = fopen(filename, "rb");
+   if (!f)
+      return NULL;
+
+   if (fread(&header, sizeof(header), 1, f) != 1 ||
+       header.magic != CACHE_MAGIC || header.key_size != key->size)
+      goto fail;
+
+   stored_key = malloc(key->size);
+   if (!stored_key ||
+       fread(stored_key, 1, key->size, f) != key->size ||
+       memcmp(stored_key, key->data, key->size) != 0)
+      goto fail;
+
+   data = malloc(MAX2(header.data_size, 1));
+   if (!data ||
+       fread(data, 1, header.data_size, f) != header.data_size ||
+       _mesa_hash_data(data, header.data_size) != header.data_hash) {
+      /* truncated or corrupted entry */
+      free(data);
+      data = NULL;
+      goto fail;
+   }
+
+   *size = header.data_size;
+
+fail:
+   free(stored_key);
+   fclose(f);
+   return data;
+}
+
+static void
+write_entry(const struct brw_disk_cache *disk, const struct byte_buffer *key,
+            const struct byte_buffer *data)
+{
+   struct cache_entry_header header;
+   char filename[1100];
+   char tmp_filename[1200];
+   bool ok;
+   FILE *f;
+
+   entry_filename(disk, key, filename, sizeof(filename));
+   snprintf(tmp_filename, sizeof(tmp_filename), "%s.%u.tmp",
+            filename, (unsigned) getpid());
+
+   f = fopen(tmp_filename, "wb");
+   if (!f)
+      return;
+
+   header.magic = CACHE_MAGIC;
+   header.key_size = key->size;
+   header.data_size = data->size;
+   header.data_hash = _mesa_hash_data(data->data, data->size);
+
+   ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+        fwrite(key->data, 1, key->size, f) == key->size &&
+        fwrite(data->data, 1, data->size, f) == data->size;
+
+   if (fclose(f) != 0)
+      ok = false;
+
+   if (!ok || rename(tmp_filename, filename) != 0)
+      remove(tmp_filename);
+}
+
+
+/**
+ * Copy a prog key, clearing the program string id which differs from run to
+ * run.
+ *
+ * \return the copy, which the caller must free(), or NULL
+ */
+static void *
+copy_prog_key(enum brw_cache_id cache_id,
+              const void *prog_key, GLuint prog_key_size)
+{
+   void *copy = malloc(prog_key_size);
+   if (!copy)
+      return NULL;
+
+   memcpy(copy, prog_key, prog_key_size);
+
+   switch (cache_id) {
+   case BRW_VS_PROG:
+      ((struct brw_vs_prog_key *) copy)->base.program_string_id = 0;
+      break;
+   case BRW_GS_PROG:
+      ((struct brw_gs_prog_key *) copy)->base.program_string_id = 0;
+      break;
+   case BRW_WM_PROG:
+      ((struct brw_wm_prog_key *) copy)->program_string_id = 0;
+      break;
+   default:
+      break;
+   }
+
+   return copy;
+}
+
+/**
+ * Make the key of a program, or with a NULL prog_key the key of the list of
+ * its variants.
+ *
+ * \return false if the program can't be cached
+ */
+static bool
+make_key(struct brw_context *brw, enum brw_cache_id cache_id,
+         const struct gl_shader_program *shProg,
+         const struct gl_program *prog,
+         const void *prog_key, GLuint prog_key_size,
+         struct byte_buffer *key)
+{
+   struct gl_context *ctx = &brw->ctx;
+   const struct prog_data_layout *layout = get_layout(cache_id);
+   const struct brw_shader *shader = NULL;
+   const GLuint id = prog_key ? cache_id : cache_id | VARIANTS_ID;
+
+   if (!brw->cache.disk || !layout || !prog->Parameters ||
+       (INTEL_DEBUG & UNCACHEABLE_DEBUG_FLAGS))
+      return false;
+
+   /* Only programs with a source are cached, not fixed function ones */
+   if (shProg) {
+      shader = (const struct brw_shader *)
+         shProg->_LinkedShaders[layout->stage];
+      if (!shader || !shader->cache_source)
+         return false;
+   } else if (!prog->String) {
+      return false;
+   }
+
+   memset(key, 0, sizeof(*key));
+
+   append(key, build_id, sizeof(build_id));
+   append(key, &brw->intelScreen->deviceID,
+          sizeof(brw->intelScreen->deviceID));
+   append(key, &INTEL_DEBUG, sizeof(INTEL_DEBUG));
+
+   /* Everything which affects compiling and linking */
+   append(key, &ctx->API, sizeof(ctx->API));
+   append(key, &ctx->Const.GLSLVersion, sizeof(ctx->Const.GLSLVersion));
+   append(key, &ctx->Const.NativeIntegers,
+          sizeof(ctx->Const.NativeIntegers));
+   append(key, &ctx->ShaderCompilerOptions[layout->stage],
+          sizeof(ctx->ShaderCompilerOptions[layout->stage]));
+   append(key, &ctx->Extensions,
+          offsetof(struct gl_extensions, extension_sentinel));
+
+   /* Compiling may add state parameters.  Entries are stored with the
+    * parameters there are afterwards, so they only hit when compiling would
+    * add none.
+    */
+   append(key, &prog->Target, sizeof(prog->Target));
+   append(key, &prog->Parameters->NumParameters,
+          sizeof(prog->Parameters->NumParameters));
+   append(key, &prog->InputsRead, sizeof(prog->InputsRead));
+   append(key, &prog->OutputsWritten, sizeof(prog->OutputsWritten));
+   append(key, &prog->SystemValuesRead, sizeof(prog->SystemValuesRead));
+
+   append(key, &id, sizeof(id));
+   append(key, &prog_key_size, sizeof(prog_key_size));
+   if (prog_key) {
+      void *copy = copy_prog_key(cache_id, prog_key, prog_key_size);
+      if (copy)
+         append(key, copy, prog_key_size);
+      else
+         key->failed = true;
+      free(copy);
+   }
+
+   if (shader)
+      append(key, shader->cache_source, shader->cache_source_size);
+   else
+      append_string(key, (const char *) prog->String);
+
+   if (key->failed) {
+      free(key->data);
+      return false;
+   }
+
+   return true;
+}
+
+/**
+ * Make the key of a kernel which only depends on its prog key, like the
+ * BLORP ones.
+ *
+ * \return false if the kernel can't be cached
+ */
+static bool
+make_kernel_key(struct brw_context *brw, enum brw_cache_id cache_id,
+                const void *prog_key, GLuint prog_key_size,
+                struct byte_buffer *key)
+{
+   const GLuint id = cache_id | KERNEL_ID;
+
+   if (!brw->cache.disk || (INTEL_DEBUG & DEBUG_BLORP))
+      return false;
+
+   memset(key, 0, sizeof(*key));
+
+   append(key, build_id, sizeof(build_id));
+   append(key, &brw->intelScreen->deviceID,
+          sizeof(brw->intelScreen->deviceID));
+   append(key, &INTEL_DEBUG, sizeof(INTEL_DEBUG));
+   append(key, &id, sizeof(id));
+   append(key, &prog_key_size, sizeof(prog_key_size));
+   append(key, prog_key, prog_key_size);
+
+   if (key->failed) {
+      free(key->data);
+      return false;
+   }
+
+   return true;
+}
+
+
+static unsigned
+uniform_slots(const struct gl_uniform_storage *storage)
+{
+   return storage->type->component_slots() *
+          MAX2(storage->array_elements, 1);
+}
+
+/**
+ * Find what a param[] entry points at.
+ */
+static bool
+store_param(struct brw_context *brw,
+            const struct gl_shader_program *shProg,
+            const struct gl_program *prog,
+            const float *param, struct stored_param *stored)
+{
+   const float *state =
+      prog->Parameters->NumParameters ?
+      &prog->Parameters->ParameterValues[0][0].f : NULL;
+   const float *clip_planes = brw_select_clip_planes(&brw->ctx)[0];
+
+   stored->index = 0;
+   stored->offset = 0;
+
+   if (param == NULL) {
+      stored->kind = PARAM_NULL;
+      return true;
+   }
+
+   if (param == &brw_zero_param) {
+      stored->kind = PARAM_ZERO;
+      return true;
+   }
+
+   if (state && param >= state &&
+       param < state + prog->Parameters->NumParameters * 4) {
+      stored->kind = PARAM_STATE;
+      stored->offset = param - state;
+      return true;
+   }
+
+   if (param >= clip_planes && param < clip_planes + MAX_CLIP_PLANES * 4) {
+      stored->kind = PARAM_CLIP_PLANE;
+      stored->offset = param - clip_planes;
+      return true;
+   }
+
+   for (unsigned i = 0; shProg && i < shProg->NumUserUniformStorage; i++) {
+      const struct gl_uniform_storage *storage = &shProg->UniformStorage[i];
+      const float *values = &storage->storage[0].f;
+
+      if (storage->storage && param >= values &&
+          param < values + uniform_slots(storage)) {
+         stored->kind = PARAM_UNIFORM;
+         stored->index = i;
+         stored->offset = param - values;
+         return true;
+      }
+   }
+
+   return false;
+}
+
+/**
+ * Find the param[] entry of a stored one.
+ */
+static bool
+load_param(struct brw_context *brw,
+           const struct gl_shader_program *shProg,
+           const struct gl_program *prog,
+           const struct stored_param *stored, const float **param)
+{
+   switch (stored->kind) {
+   case PARAM_NULL:
+      *param = NULL;
+      return true;
+   case PARAM_ZERO:
+      *param = &brw_zero_param;
+      return true;
+   case PARAM_STATE:
+      if (stored->offset >= prog->Parameters->NumParameters * 4)
+         return false;
+      *param = &prog->Parameters->ParameterValues[0][0].f + stored->offset;
+      return true;
+   case PARAM_CLIP_PLANE:
+      if (stored->offset >= MAX_CLIP_PLANES * 4)
+         return false;
+      *param = brw_select_clip_planes(&brw->ctx)[0] + stored->offset;
+      return true;
+   case PARAM_UNIFORM:
+      if (!shProg || stored->index >= shProg->NumUserUniformStorage)
+         return false;
+      else {
+         const struct gl_uniform_storage *storage =
+            &shProg->UniformStorage[stored->index];
+         if (!storage->storage || stored->offset >= uniform_slots(storage))
+            return false;
+         *param = &storage->storage[0].f + stored->offset;
+         return true;
+      }
+   default:
+      return false;
+   }
+}
+
+
+extern "C" {
+
+void
+brw_disk_cache_init(struct brw_cache *cache)
+{
+   const char *dir = getenv("MESA_SHADER_CACHE_DIR");
+   struct brw_disk_cache *disk;
+
+   cache->disk = NULL;
+
+   if (!dir || !*dir)
+      return;
+
+   disk = CALLOC_STRUCT(brw_disk_cache);
+   if (!disk)
+      return;
+
+   snprintf(disk->path, sizeof(disk->path), "%s/i965", dir);
+
+   if (!make_path(disk->path)) {
+      DBG("%s: failed to create %s\n", __FUNCTION__, disk->path);
+      free(disk);
+      return;
+   }
+
+   cache->disk = disk;
+}
+
+void
+brw_disk_cache_destroy(struct brw_cache *cache)
+{
+   free(cache->disk);
+   cache->disk = NULL;
+}
+
+/**
+ * Save what a shader was linked from, for making cache keys from later.
+ * Called at link time for each of the linked shaders of shProg.
+ */
+void
+brw_disk_cache_set_source(struct brw_context *brw,
+                          const struct gl_shader_program *shProg,
+                          struct brw_shader *shader)
+{
+   struct byte_buffer buf;
+
+   ralloc_free(shader->cache_source);
+   shader->cache_source = NULL;
+   shader->cache_source_size = 0;
+
+   if (!brw->cache.disk)
+      return;
+
+   memset(&buf, 0, sizeof(buf));
+
+   for (GLuint i = 0; i < shProg->NumShaders; i++) {
+      const struct gl_shader *sh = shProg->Shaders[i];
+
+      /* The source may have been replaced since it was compiled */
+      if (!sh->CompileStatus || !sh->Source) {
+         free(buf.data);
+         return;
+      }
+
+      append(&buf, &sh->Type, sizeof(sh->Type));
+      append_string(&buf, sh->Source);
+   }
+
+   append(&buf, &shProg->TransformFeedback.BufferMode,
+          sizeof(shProg->TransformFeedback.BufferMode));
+   for (GLuint i = 0; i < shProg->TransformFeedback.NumVarying; i++)
+      append_string(&buf, shProg->TransformFeedback.VaryingNames[i]);
+
+   if (!buf.failed && buf.size) {
+      shader->cache_source = (GLubyte *) ralloc_size(shader, buf.size);
+      if (shader->cache_source) {
+         memcpy(shader->cache_source, buf.data, buf.size);
+         shader->cache_source_size = buf.size;
+      }
+   }
+
+   free(buf.data);
+}
+
+/**
+ * Look up a program about to be compiled.
+ *
+ * On a hit prog_data is filled in, its param[] and pull_param[] arrays
+ * resized, and the assembly returned.
+ *
+ * \return the assembly, owned by mem_ctx, or NULL on a miss
+ */
+const GLuint *
+brw_disk_cache_load(struct brw_context *brw,
+                    enum brw_cache_id cache_id,
+                    struct gl_shader_program *shProg,
+                    struct gl_program *prog,
+                    const void *key, GLuint key_size,
+                    void *prog_data,
+                    void *mem_ctx, GLuint *program_size)
+{
+   const struct prog_data_layout *layout = get_layout(cache_id);
+   struct byte_buffer disk_key;
+   struct program_header header;
+   const float **params[2] = { NULL, NULL };
+   GLuint *program = NULL;
+   GLubyte *data, *stored_prog_data;
+   unsigned size;
+
+   if (!make_key(brw, cache_id, shProg, prog, key, key_size, &disk_key))
+      return NULL;
+
+   data = (GLubyte *) read_entry(brw->cache.disk, &disk_key, &size);
+   free(disk_key.data);
+   if (!data)
+      return NULL;
+
+   if (size < sizeof(header))
+      goto fail;
+
+   memcpy(&header, data, sizeof(header));
+   if (header.prog_data_size != layout->size ||
+       header.program_size % 4 != 0 ||
+       size != sizeof(header) + header.program_size + layout->size +
+               (header.nr_params + header.nr_pull_params) *
+               sizeof(struct stored_param))
+      goto fail;
+
+   stored_prog_data = data + sizeof(header) + header.program_size;
+   if (*prog_data_nr_params(layout, stored_prog_data, false) !=
+       header.nr_params ||
+       *prog_data_nr_params(layout, stored_prog_data, true) !=
+       header.nr_pull_params)
+      goto fail;
+
+   for (unsigned pull = 0; pull < 2; pull++) {
+      const unsigned n = pull ? header.nr_pull_params : header.nr_params;
+      const struct stored_param *stored = (const struct stored_param *)
+         (stored_prog_data + layout->size) + (pull ? header.nr_params : 0);
+
+      params[pull] = ralloc_array(NULL, const float *, MAX2(n, 1));
+      if (!params[pull])
+         goto fail;
+
+      for (unsigned i = 0; i < n; i++) {
+         if (!load_param(brw, shProg, prog, &stored[i], &params[pull][i]))
+            goto fail;
+      }
+   }
+
+   program = (GLuint *) ralloc_size(mem_ctx, MAX2(header.program_size, 4));
+   if (!program)
+      goto fail;
+
+   memcpy(program, data + sizeof(header), header.program_size);
+   *program_size = header.program_size;
+
+   /* The arrays allocated for compiling are replaced by the stored ones */
+   ralloc_free(*prog_data_param(layout, prog_data, false));
+   ralloc_free(*prog_data_param(layout, prog_data, true));
+   memcpy(prog_data, stored_prog_data, layout->size);
+   *prog_data_param(layout, prog_data, false) = params[0];
+   *prog_data_param(layout, prog_data, true) = params[1];
+
+   DBG("%s: hit\n", __FUNCTION__);
+   free(data);
+   return program;
+
+fail:
+   ralloc_free(params[0]);
+   ralloc_free(params[1]);
+   free(data);
+   return NULL;
+}
+
+/**
+ * Store a program just compiled.
+ *
+ * \param num_parameters  of prog before compiling
+ */
+void
+brw_disk_cache_store(struct brw_context *brw,
+                     enum brw_cache_id cache_id,
+                     struct gl_shader_program *shProg,
+                     struct gl_program *prog,
+                     const void *key, GLuint key_size,
+                     const void *prog_data,
+                     const GLuint *program, GLuint program_size,
+                     GLuint num_parameters)
+{
+   const struct prog_data_layout *layout = get_layout(cache_id);
+   struct byte_buffer disk_key, data;
+   struct program_header header;
+
+   /* Compiling added parameters, so this would never hit */
+   if (prog->Parameters->NumParameters != num_parameters)
+      return;
+
+   if (program_size % 4 != 0)
+      return;
+
+   if (!make_key(brw, cache_id, shProg, prog, key, key_size, &disk_key))
+      return;
+
+   void *stored_prog_data = malloc(layout->size);
+   if (!stored_prog_data) {
+      free(disk_key.data);
+      return;
+   }
+
+   /* The pointers are stored apart */
+   memcpy(stored_prog_data, prog_data, layout->size);
+   *prog_data_param(layout, stored_prog_data, false) = NULL;
+   *prog_data_param(layout, stored_prog_data, true) = NULL;
+
+   header.program_size = program_size;
+   header.prog_data_size = layout->size;
+   header.nr_params = *prog_data_nr_params(layout, stored_prog_data, false);
+   header.nr_pull_params = *prog_data_nr_params(layout, stored_prog_data, true);
+
+   memset(&data, 0, sizeof(data));
+   append(&data, &header, sizeof(header));
+   append(&data, program, program_size);
+   append(&data, stored_prog_data, layout->size);
+
+   for (unsigned pull = 0; pull < 2; pull++) {
+      const unsigned n = pull ? header.nr_pull_params : header.nr_params;
+      const float *const *params =
+         *prog_data_param(layout, (void *) prog_data, pull);
+
+      for (unsigned i = 0; i < n; i++) {
+         struct stored_param stored;
+
+         if (!store_param(brw, shProg, prog, params[i], &stored))
+            data.failed = true;
+         append(&data, &stored, sizeof(stored));
+      }
+   }
+
+   if (!data.failed)
+      write_entry(brw->cache.disk, &disk_key, &data);
+
+   free(stored_prog_data);
+   free(data.data);
+   free(disk_key.data);
+}
+
+/**
+ * Remember a variant of a program which was compiled at draw time, so that
+ * later runs compile it at link time.
+ */
+void
+brw_disk_cache_note_variant(struct brw_context *brw,
+                            enum brw_cache_id cache_id,
+                            struct gl_shader_program *shProg,
+                            struct gl_program *prog,
+                            const void *key, GLuint key_size)
+{
+   struct byte_buffer disk_key, data;
+   struct variants_header header;
+   GLubyte *old_data, *variant;
+   unsigned old_size, first = 0;
+
+   if (!make_key(brw, cache_id, shProg, prog, NULL, key_size, &disk_key))
+      return;
+
+   variant = (GLubyte *) copy_prog_key(cache_id, key, key_size);
+   if (!variant) {
+      free(disk_key.data);
+      return;
+   }
+
+   header.prog_key_size = key_size;
+   header.count = 0;
+
+   old_data = (GLubyte *) read_entry(brw->cache.disk, &disk_key, &old_size);
+   if (old_data && old_size >= sizeof(header)) {
+      memcpy(&header, old_data, sizeof(header));
+      if (header.prog_key_size != key_size ||
+          old_size != sizeof(header) + header.count * key_size)
+         header.count = 0;
+   }
+
+   const GLubyte *variants = old_data ? old_data + sizeof(header) : NULL;
+   for (unsigned i = 0; i < header.count; i++) {
+      if (memcmp(variants + i * key_size, variant, key_size) == 0)
+         goto done;
+   }
+
+   /* Forget the oldest variant once the list is full */
+   if (header.count == MAX_VARIANTS)
+      first = 1;
+
+   memset(&data, 0, sizeof(data));
+   header.count = header.count - first + 1;
+   append(&data, &header, sizeof(header));
+   if (header.count > 1)
+      append(&data, variants + first * key_size,
+             (header.count - 1) * key_size);
+   append(&data, variant, key_size);
+
+   if (!data.failed)
+      write_entry(brw->cache.disk, &disk_key, &data);
+   free(data.data);
+
+done:
+   free(old_data);
+   free(variant);
+   free(disk_key.data);
+}
+
+/**
+ * Return the variants of a program earlier runs compiled at draw time, with
+ * their program string ids cleared.
+ *
+ * \return an array of count prog keys, which the caller must free(), or NULL
+ */
+void *
+brw_disk_cache_get_variants(struct brw_context *brw,
+                            enum brw_cache_id cache_id,
+                            struct gl_shader_program *shProg,
+                            struct gl_program *prog,
+                            GLuint key_size, unsigned *count)
+{
+   struct byte_buffer disk_key;
+   struct variants_header header;
+   GLubyte *data;
+   unsigned size;
+
+   *count = 0;
+
+   if (!make_key(brw, cache_id, shProg, prog, NULL, key_size, &disk_key))
+      return NULL;
+
+   data = (GLubyte *) read_entry(brw->cache.disk, &disk_key, &size);
+   free(disk_key.data);
+   if (!data)
+      return NULL;
+
+   if (size < sizeof(header)) {
+      free(data);
+      return NULL;
+   }
+
+   memcpy(&header, data, sizeof(header));
+   if (header.prog_key_size != key_size || header.count == 0 ||
+       size != sizeof(header) + header.count * key_size) {
+      free(data);
+      return NULL;
+   }
+
+   /* Return the keys in place, at the start of the buffer */
+   memmove(data, data + sizeof(header), header.count * key_size);
+   *count = header.count;
+   return data;
+}
+
+
+/**
+ * Look up a kernel which only depends on its prog key.
+ *
+ * On a hit aux is filled in.
+ *
+ * \return the assembly, which the caller must free(), or NULL on a miss
+ */
+GLuint *
+brw_disk_cache_load_kernel(struct brw_context *brw,
+                           enum brw_cache_id cache_id,
+                           const void *key, GLuint key_size,
+                           void *aux, GLuint aux_size,
+                           GLuint *program_size)
+{
+   struct byte_buffer disk_key;
+   struct kernel_header header;
+   GLuint *program;
+   GLubyte *data;
+   unsigned size;
+
+   if (!make_kernel_key(brw, cache_id, key, key_size, &disk_key))
+      return NULL;
+
+   data = (GLubyte *) read_entry(brw->cache.disk, &disk_key, &size);
+   free(disk_key.data);
+   if (!data)
+      return NULL;
+
+   if (size < sizeof(header))
+      goto fail;
+
+   memcpy(&header, data, sizeof(header));
+   if (header.aux_size != aux_size || header.program_size % 4 != 0 ||
+       size != sizeof(header) + aux_size + header.program_size)
+      goto fail;
+
+   program = (GLuint *) malloc(MAX2(header.program_size, 4));
+   if (!program)
+      goto fail;
+
+   memcpy(aux, data + sizeof(header), aux_size);
+   memcpy(program, data + sizeof(header) + aux_size, header.program_size);
+   *program_size = header.program_size;
+
+   DBG("%s: hit\n", __FUNCTION__);
+   free(data);
+   return program;
+
+fail:
+   free(data);
+   return NULL;
+}
+
+/**
+ * Store a kernel which only depends on its prog key.
+ */
+void
+brw_disk_cache_store_kernel(struct brw_context *brw,
+                            enum brw_cache_id cache_id,
+                            const void *key, GLuint key_size,
+                            const GLuint *program, GLuint program_size,
+                            const void *aux, GLuint aux_size)
+{
+   struct byte_buffer disk_key, data;
+   struct kernel_header header;
+
+   if (program_size % 4 != 0)
+      return;
+
+   if (!make_kernel_key(brw, cache_id, key, key_size, &disk_key))
+      return;
+
+   header.program_size = program_size;
+   header.aux_size = aux_size;
+
+   memset(&data, 0, sizeof(data));
+   append(&data, &header, sizeof(header));
+   append(&data, aux, aux_size);
+   append(&data, program, program_size);
+
+   if (!data.failed)
+      write_entry(brw->cache.disk, &disk_key, &data);
+
+   free(data.data);
+   free(disk_key.data);
+}
+
+} /* extern "C" */
@@ -309,6 +309,11 @@ brw_predraw_resolve_buffers(struct brw_context *brw)
    struct intel_renderbuffer *depth_irb;
    struct intel_texture_object *tex_obj;
 
+   /* Emit all the resolves below as one group of BLORP operations, so they
+    * share the flushes and the state setup around them.
+    */
+   brw_blorp_begin_group(brw);
+
    /* Resolve the depth buffer's HiZ buffer. */
    depth_irb = intel_get_renderbuffer(ctx->DrawBuffer, BUFFER_DEPTH);
    if (depth_irb)
@@ -326,6 +331,8 @@ brw_predraw_resolve_buffers(struct brw_context *brw)
       intel_miptree_all_slices_resolve_depth(brw, tex_obj->mt);
       intel_miptree_resolve_color(brw, tex_obj->mt);
    }
+
+   brw_blorp_end_group(brw);
 }
 
 /**
@@ -433,6 +440,11 @@ static bool brw_try_draw_prims( struct gl_context *ctx,
       estimated_max_prim_size += 1024; /* gen6 WM push constants */
       estimated_max_prim_size += 512; /* misc. pad */
 
+      /* Take the per-draw timing snapshots before reserving space, as they
+       * may wrap the batch.
+       */
+      brw_perf_monitor_begin_draw(brw, false);
+
       /* Flush the batch if it's approaching full, so that we don't wrap while
        * we've got validated state that needs to be in the same batch as the
        * primitives.
@@ -491,6 +503,8 @@ retry:
 	 }
       }
 
+      brw_perf_monitor_end_draw(brw);
+
       /* Now that we know we haven't run out of aperture space, we can safely
        * reset the dirty bits.
        */
@@ -680,10 +680,15 @@ brw_compact_instructions(struct brw_compile *p)
    int src_offset;
    int offset = 0;
    int compacted_count = 0;
+   int uncompacted_count = 0;
    for (src_offset = 0; src_offset < p->nr_insn * 16;) {
       struct brw_instruction *src = store + src_offset;
       void *dst = store + offset;
 
+      /* Instructions compacted by an earlier pass were counted then */
+      if (!src->header.cmpt_control)
+         uncompacted_count++;
+
       old_ip[offset / 8] = src_offset / 8;
       compacted_counts[src_offset / 8] = compacted_count;
 
@@ -784,6 +789,16 @@ brw_compact_instructions(struct brw_compile *p)
    }
    p->nr_insn = p->next_insn_offset / 16;
 
+   brw->cache.stats.insns += uncompacted_count;
+   brw->cache.stats.compacted_insns += compacted_count;
+
+   if (unlikely(INTEL_DEBUG & DEBUG_CACHE) && uncompacted_count) {
+      fprintf(stderr, "compacted %d of %d instructions (%.1f%%), %d bytes\n",
+              compacted_count, uncompacted_count,
+              100.0 * compacted_count / uncompacted_count,
+              p->next_insn_offset);
+   }
+
    if (0) {
       fprintf(stdout, "dumping compacted program\n");
       brw_dump_compile(p, stdout, 0, p->next_insn_offset);
@@ -44,8 +44,11 @@ extern "C" {
 #include "brw_context.h"
 #include "brw_eu.h"
 #include "brw_wm.h"
+#include "intel_mipmap_tree.h"
+#include "brw_state.h"
 }
 #include "brw_fs.h"
+#include "brw_vs.h"
 #include "brw_dead_control_flow.h"
 #include "main/uniforms.h"
 #include "brw_fs_live_variables.h"
@@ -640,7 +643,7 @@ fs_visitor::emit_shader_time_write(enum shader_time_shader_type type,
                                    fs_reg value)
 {
    int shader_time_index =
-      brw_get_shader_time_index(brw, shader_prog, &fp->Base, type);
+      brw_get_shader_time_index(brw, shader_prog, prog, type);
    fs_reg offset = fs_reg(shader_time_index * SHADER_TIME_STRIDE);
 
    fs_reg payload;
@@ -667,11 +670,13 @@ fs_visitor::fail(const char *format, ...)
    va_start(va, format);
    msg = ralloc_vasprintf(mem_ctx, format, va);
    va_end(va);
-   msg = ralloc_asprintf(mem_ctx, "FS compile failed: %s\n", msg);
+   msg = ralloc_asprintf(mem_ctx, "%s compile failed: %s\n",
+                         stage == MESA_SHADER_VERTEX ? "scalar VS" : "FS",
+                         msg);
 
    this->fail_msg = msg;
 
-   if (INTEL_DEBUG & DEBUG_WM) {
+   if (INTEL_DEBUG & (stage == MESA_SHADER_VERTEX ? DEBUG_VS : DEBUG_WM)) {
       fprintf(stderr, "%s",  msg);
    }
 }
@@ -812,6 +817,7 @@ fs_visitor::implied_mrf_writes(fs_inst *inst)
       return 2;
    case SHADER_OPCODE_UNTYPED_ATOMIC:
    case SHADER_OPCODE_UNTYPED_SURFACE_READ:
+   case SHADER_OPCODE_URB_WRITE_SIMD8:
       return 0;
    default:
       assert(!"not reached");
@@ -954,7 +960,7 @@ fs_visitor::setup_builtin_uniform_values(ir_variable *ir)
       /* This state reference has already been setup by ir_to_mesa, but we'll
        * get the same index back here.
        */
-      int index = _mesa_add_state_reference(this->fp->Base.Parameters,
+      int index = _mesa_add_state_reference(this->prog->Parameters,
 					    (gl_state_index *)slots[i].tokens);
 
       /* Add each of the unique swizzles of the element as a parameter.
@@ -969,7 +975,7 @@ fs_visitor::setup_builtin_uniform_values(ir_variable *ir)
 	 last_swiz = swiz;
 
 	 c->prog_data.param[c->prog_data.nr_params++] =
-            &fp->Base.Parameters->ParameterValues[index][swiz].f;
+            &prog->Parameters->ParameterValues[index][swiz].f;
       }
    }
 }
@@ -3096,6 +3102,9 @@ fs_visitor::dump_instruction(backend_instruction *be_inst)
       case MRF:
          printf("***m%d***", inst->src[i].reg);
          break;
+      case ATTR:
+         printf("attr%d+%d", inst->src[i].reg, inst->src[i].reg_offset);
+         break;
       case UNIFORM:
          printf("u%d", inst->src[i].reg);
          if (virtual_grf_sizes[inst->src[i].reg] != 1 ||
@@ -3284,6 +3293,72 @@ fs_visitor::setup_payload_gen6()
    }
 }
 
+void
+fs_visitor::setup_vs_payload()
+{
+   /* R0: thread header, R1: URB handles */
+   c->nr_payload_regs = 2;
+}
+
+/**
+ * Maps the ATTR file onto the payload registers holding the vertex
+ * attributes, which follow the push constants.  In SIMD8 mode each
+ * attribute is four registers, one per component.
+ */
+void
+fs_visitor::assign_vs_urb_setup()
+{
+   int urb_start = c->nr_payload_regs + c->prog_data.curb_read_length;
+   int attribute_map[VERT_ATTRIB_MAX + 1];
+   int nr_attributes = 0;
+
+   for (int i = 0; i < VERT_ATTRIB_MAX; i++) {
+      if (vs_prog_data->inputs_read & BITFIELD64_BIT(i))
+         attribute_map[i] = nr_attributes++;
+      else
+         attribute_map[i] = -1;
+   }
+
+   /* VertexID and InstanceID are stored by the VF as the last vertex
+    * element, as in the vec4 backend.
+    */
+   if (vs_prog_data->uses_vertexid)
+      attribute_map[VERT_ATTRIB_MAX] = nr_attributes++;
+   else
+      attribute_map[VERT_ATTRIB_MAX] = -1;
+
+   foreach_list(node, &this->instructions) {
+      fs_inst *inst = (fs_inst *)node;
+
+      for (int i = 0; i < 3; i++) {
+         if (inst->src[i].file != ATTR)
+            continue;
+
+         int n = inst->src[i].reg + inst->src[i].reg_offset;
+         int attr = attribute_map[n / 4];
+         assert(attr >= 0);
+
+         struct brw_reg reg = brw_vec8_grf(urb_start + attr * 4 + n % 4, 0);
+         inst->src[i].file = HW_REG;
+         inst->src[i].fixed_hw_reg = retype(reg, inst->src[i].type);
+      }
+   }
+
+   /* The BSpec says we always have to read at least one thing from the VF,
+    * and it appears that the hardware wedges otherwise.
+    */
+   if (nr_attributes == 0)
+      nr_attributes = 1;
+
+   vs_prog_data->base.urb_read_length = (nr_attributes + 1) / 2;
+
+   unsigned vue_entries =
+      MAX2(nr_attributes, vs_prog_data->base.vue_map.num_slots);
+   vs_prog_data->base.urb_entry_size = ALIGN(vue_entries, 4) / 4;
+
+   this->first_non_payload_grf = urb_start + nr_attributes * 4;
+}
+
 void
 fs_visitor::assign_binding_table_offsets()
 {
@@ -3316,10 +3391,98 @@ fs_visitor::calculate_register_pressure()
    }
 }
 
+void
+fs_visitor::optimize()
+{
+   split_virtual_grfs();
+
+   move_uniform_array_access_to_pull_constants();
+   remove_dead_constants();
+   setup_pull_constants();
+
+   bool progress;
+   do {
+      progress = false;
+
+      compact_virtual_grfs();
+
+      progress = remove_duplicate_mrf_writes() || progress;
+
+      progress = opt_algebraic() || progress;
+      progress = opt_cse() || progress;
+      progress = opt_copy_propagate() || progress;
+      progress = opt_peephole_predicated_break() || progress;
+      progress = dead_code_eliminate() || progress;
+      progress = dead_code_eliminate_local() || progress;
+      progress = opt_peephole_sel() || progress;
+      progress = dead_control_flow_eliminate(this) || progress;
+      progress = opt_saturate_propagation() || progress;
+      progress = register_coalesce() || progress;
+      progress = compute_to_mrf() || progress;
+   } while (progress);
+
+   lower_uniform_pull_constant_loads();
+}
+
+/**
+ * Schedules and register allocates the program, spilling if nothing else
+ * works.  Returns whether allocation succeeded without spilling.
+ */
+bool
+fs_visitor::allocate_registers()
+{
+   bool allocated_without_spills = false;
+
+   static enum instruction_scheduler_mode pre_modes[] = {
+      SCHEDULE_PRE,
+      SCHEDULE_PRE_ADAPTIVE,
+      SCHEDULE_PRE_NON_LIFO,
+      SCHEDULE_PRE_LIFO,
+   };
+
+   /* Try each scheduling heuristic to see if it can successfully register
+    * allocate without spilling.  They should be ordered by decreasing
+    * performance but increasing likelihood of allocating.
+    */
+   for (unsigned i = 0; i < ARRAY_SIZE(pre_modes); i++) {
+      schedule_instructions(pre_modes[i]);
+
+      if (0) {
+         assign_regs_trivial();
+         allocated_without_spills = true;
+      } else {
+         allocated_without_spills = assign_regs(false);
+      }
+      if (allocated_without_spills)
+         break;
+   }
+
+   if (!allocated_without_spills) {
+      /* We assume that any spilling is worse than just dropping back to
+       * SIMD8.  There's probably actually some intermediate point where
+       * SIMD16 with a couple of spills is still better.
+       */
+      if (dispatch_width == 16) {
+         fail("Failure to register allocate.  Reduce number of "
+              "live scalar values to avoid this.");
+      }
+
+      /* Since we're out of heuristics, just go spill registers until we
+       * get an allocation.
+       */
+      while (!assign_regs(true)) {
+         if (failed)
+            break;
+      }
+   }
+
+   return allocated_without_spills;
+}
+
 bool
 fs_visitor::run()
 {
-   sanity_param_count = fp->Base.Parameters->NumParameters;
+   sanity_param_count = prog->Parameters->NumParameters;
    uint32_t orig_nr_params = c->prog_data.nr_params;
    bool allocated_without_spills;
 
@@ -3376,79 +3539,12 @@ fs_visitor::run()
 
       emit_fb_writes();
 
-      split_virtual_grfs();
-
-      move_uniform_array_access_to_pull_constants();
-      remove_dead_constants();
-      setup_pull_constants();
-
-      bool progress;
-      do {
-	 progress = false;
-
-         compact_virtual_grfs();
-
-	 progress = remove_duplicate_mrf_writes() || progress;
-
-	 progress = opt_algebraic() || progress;
-	 progress = opt_cse() || progress;
-	 progress = opt_copy_propagate() || progress;
-         progress = opt_peephole_predicated_break() || progress;
-	 progress = dead_code_eliminate() || progress;
-	 progress = dead_code_eliminate_local() || progress;
-         progress = opt_peephole_sel() || progress;
-         progress = dead_control_flow_eliminate(this) || progress;
-         progress = opt_saturate_propagation() || progress;
-         progress = register_coalesce() || progress;
-	 progress = compute_to_mrf() || progress;
-      } while (progress);
-
-      lower_uniform_pull_constant_loads();
+      optimize();
 
       assign_curb_setup();
       assign_urb_setup();
 
-      static enum instruction_scheduler_mode pre_modes[] = {
-         SCHEDULE_PRE,
-         SCHEDULE_PRE_NON_LIFO,
-         SCHEDULE_PRE_LIFO,
-      };
-
-      /* Try each scheduling heuristic to see if it can successfully register
-       * allocate without spilling.  They should be ordered by decreasing
-       * performance but increasing likelihood of allocating.
-       */
-      for (unsigned i = 0; i < ARRAY_SIZE(pre_modes); i++) {
-         schedule_instructions(pre_modes[i]);
-
-         if (0) {
-            assign_regs_trivial();
-            allocated_without_spills = true;
-         } else {
-            allocated_without_spills = assign_regs(false);
-         }
-         if (allocated_without_spills)
-            break;
-      }
-
-      if (!allocated_without_spills) {
-         /* We assume that any spilling is worse than just dropping back to
-          * SIMD8.  There's probably actually some intermediate point where
-          * SIMD16 with a couple of spills is still better.
-          */
-         if (dispatch_width == 16) {
-            fail("Failure to register allocate.  Reduce number of "
-                 "live scalar values to avoid this.");
-         }
-
-         /* Since we're out of heuristics, just go spill registers until we
-          * get an allocation.
-          */
-         while (!assign_regs(true)) {
-            if (failed)
-               break;
-         }
-      }
+      allocated_without_spills = allocate_registers();
    }
    assert(force_uncompressed_stack == 0);
 
@@ -3479,7 +3575,47 @@ fs_visitor::run()
     * _mesa_associate_uniform_storage() would point to freed memory.  Make
     * sure that didn't happen.
     */
-   assert(sanity_param_count == fp->Base.Parameters->NumParameters);
+   assert(sanity_param_count == prog->Parameters->NumParameters);
+
+   return !failed;
+}
+
+bool
+fs_visitor::run_vs()
+{
+   assert(stage == MESA_SHADER_VERTEX && shader);
+
+   sanity_param_count = prog->Parameters->NumParameters;
+
+   assign_common_binding_table_offsets(0);
+   setup_vs_payload();
+
+   /* Generate the IR for main(). */
+   foreach_list(node, &*shader->base.ir) {
+      ir_instruction *ir = (ir_instruction *)node;
+      base_ir = ir;
+      this->result = reg_undef;
+      ir->accept(this);
+   }
+   base_ir = NULL;
+   if (failed)
+      return false;
+
+   emit_urb_writes();
+
+   optimize();
+
+   assign_curb_setup();
+   assign_vs_urb_setup();
+
+   bool allocated_without_spills = allocate_registers();
+   if (failed)
+      return false;
+
+   if (!allocated_without_spills)
+      schedule_instructions(SCHEDULE_POST);
+
+   assert(sanity_param_count == prog->Parameters->NumParameters);
 
    return !failed;
 }
@@ -3572,6 +3708,58 @@ brw_wm_fs_emit(struct brw_context *brw, struct brw_wm_compile *c,
    return assembly;
 }
 
+/**
+ * Compile a GLSL vertex shader with the scalar backend.
+ *
+ * Returns NULL if the shader uses something the scalar path can't handle,
+ * in which case the caller should fall back to the vec4 backend.
+ */
+const unsigned *
+brw_vs_emit_scalar(struct brw_context *brw,
+                   struct gl_shader_program *prog,
+                   struct brw_vs_compile *c,
+                   struct brw_vs_prog_data *prog_data,
+                   void *mem_ctx,
+                   unsigned *final_assembly_size)
+{
+   assert(brw->gen >= 8 && prog);
+
+   /* fs_visitor keeps its bookkeeping in a brw_wm_compile.  Share the
+    * sampler key and the uniform arrays with the VS, and copy the results
+    * back once we know the compile succeeded.
+    */
+   struct brw_wm_compile *wm_c = rzalloc(mem_ctx, struct brw_wm_compile);
+   wm_c->key.tex = c->key.base.tex;
+   wm_c->prog_data.base = prog_data->base.base;
+   wm_c->prog_data.param = prog_data->base.param;
+   wm_c->prog_data.pull_param = prog_data->base.pull_param;
+
+   fs_visitor v(brw, wm_c, c, prog_data, prog);
+   if (!v.run_vs()) {
+      perf_debug("Scalar VS compile failed, using the vec4 backend: %s",
+                 v.fail_msg);
+      prog_data->uses_vertexid = false;
+      return NULL;
+   }
+
+   gen8_fs_generator g(brw, wm_c, prog, &c->vp->program);
+   const unsigned *assembly =
+      g.generate_assembly(&v.instructions, NULL, final_assembly_size);
+
+   prog_data->base.base = wm_c->prog_data.base;
+   prog_data->base.nr_params = wm_c->prog_data.nr_params;
+   prog_data->base.nr_pull_params = wm_c->prog_data.nr_pull_params;
+   prog_data->base.curb_read_length = wm_c->prog_data.curb_read_length;
+   prog_data->base.dispatch_grf_start_reg = wm_c->nr_payload_regs;
+   prog_data->base.total_grf = v.grf_used;
+   prog_data->simd8 = true;
+
+   /* do_vs_prog() sizes the scratch buffer in vec4 registers. */
+   c->base.last_scratch = ALIGN(wm_c->last_scratch, REG_SIZE) / REG_SIZE;
+
+   return assembly;
+}
+
 bool
 brw_fs_precompile(struct gl_context *ctx, struct gl_shader_program *prog)
 {
@@ -3644,6 +3832,20 @@ brw_fs_precompile(struct gl_context *ctx, struct gl_shader_program *prog)
 
    bool success = do_wm_prog(brw, prog, bfp, &key);
 
+   /* Also compile the variants earlier runs compiled at draw time */
+   unsigned num_variants;
+   struct brw_wm_prog_key *variants = (struct brw_wm_prog_key *)
+      brw_disk_cache_get_variants(brw, BRW_WM_PROG, prog, &fp->Base,
+                                  sizeof(key), &num_variants);
+   for (unsigned i = 0; success && i < num_variants; i++) {
+      variants[i].program_string_id = bfp->id;
+      if (!brw_search_cache(&brw->cache, BRW_WM_PROG,
+                            &variants[i], sizeof(variants[i]),
+                            &brw->wm.base.prog_offset, &brw->wm.prog_data))
+         do_wm_prog(brw, prog, bfp, &variants[i]);
+   }
+   free(variants);
+
    brw->wm.base.prog_offset = old_prog_offset;
    brw->wm.prog_data = old_prog_data;
 
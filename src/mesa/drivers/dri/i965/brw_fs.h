@@ -54,6 +54,7 @@ extern "C" {
 #define MAX_SAMPLER_MESSAGE_SIZE 11
 
 class bblock_t;
+struct brw_vs_compile;
 namespace {
    struct acp_entry;
 }
@@ -226,6 +227,8 @@ public:
  * The fragment shader front-end.
  *
  * Translates either GLSL IR or Mesa IR (for ARB_fragment_program) into FS IR.
+ * On Gen8+ it can also translate GLSL vertex shaders into SIMD8 scalar code,
+ * where each channel processes one vertex.
  */
 class fs_visitor : public backend_visitor
 {
@@ -236,8 +239,21 @@ public:
               struct gl_shader_program *shader_prog,
               struct gl_fragment_program *fp,
               unsigned dispatch_width);
+
+   /**
+    * Scalar vertex shader constructor.  \p c is scratch storage holding the
+    * sampler key and the uniform arrays of \p vs_prog_data; see
+    * brw_vs_emit_scalar().
+    */
+   fs_visitor(struct brw_context *brw,
+              struct brw_wm_compile *c,
+              struct brw_vs_compile *vs_compile,
+              struct brw_vs_prog_data *vs_prog_data,
+              struct gl_shader_program *shader_prog);
    ~fs_visitor();
 
+   void init();
+
    fs_reg *variable_storage(ir_variable *var);
    int virtual_grf_alloc(int size);
    void import_uniforms(fs_visitor *v);
@@ -322,12 +338,17 @@ public:
                                         uint32_t const_offset);
 
    bool run();
+   bool run_vs();
+   void optimize();
+   bool allocate_registers();
    void assign_binding_table_offsets();
    void setup_payload_gen4();
    void setup_payload_gen6();
    void assign_curb_setup();
    void calculate_urb_setup();
    void assign_urb_setup();
+   void setup_vs_payload();
+   void assign_vs_urb_setup();
    bool assign_regs(bool allow_spilling);
    void assign_regs_trivial();
    void get_used_mrfs(bool *mrf_used);
@@ -437,6 +458,7 @@ public:
    void emit_color_write(int target, int index, int first_color_mrf);
    void emit_alpha_test();
    void emit_fb_writes();
+   void emit_urb_writes();
 
    void emit_shader_time_begin();
    void emit_shader_time_end();
@@ -472,8 +494,13 @@ public:
 
    void visit_atomic_counter_intrinsic(ir_call *ir);
 
+   /** MESA_SHADER_FRAGMENT, or MESA_SHADER_VERTEX when compiling a scalar VS */
+   gl_shader_stage stage;
+
    struct gl_fragment_program *fp;
    struct brw_wm_compile *c;
+   struct brw_vs_compile *vs_compile;
+   struct brw_vs_prog_data *vs_prog_data;
    unsigned int sanity_param_count;
 
    int param_size[MAX_UNIFORMS * 4];
@@ -501,6 +528,8 @@ public:
    fs_reg outputs[BRW_MAX_DRAW_BUFFERS];
    unsigned output_components[BRW_MAX_DRAW_BUFFERS];
    fs_reg dual_src_output;
+   fs_reg vs_outputs[VARYING_SLOT_MAX];
+   unsigned vs_output_components[VARYING_SLOT_MAX];
    int first_non_payload_grf;
    /** Either BRW_MAX_GRF or GEN7_MRF_HACK_START */
    int max_grf;
@@ -674,6 +703,10 @@ public:
                      struct gl_shader_program *prog,
                      struct gl_fragment_program *fp,
                      bool dual_source_output);
+   gen8_fs_generator(struct brw_context *brw,
+                     struct brw_wm_compile *c,
+                     struct gl_shader_program *prog,
+                     struct gl_vertex_program *vp);
    ~gen8_fs_generator();
 
    const unsigned *generate_assembly(exec_list *simd8_instructions,
@@ -683,6 +716,7 @@ public:
 private:
    void generate_code(exec_list *instructions);
    void generate_fb_write(fs_inst *inst);
+   void generate_urb_write(fs_inst *inst);
    void generate_linterp(fs_inst *inst, struct brw_reg dst,
                          struct brw_reg *src);
    void generate_tex(fs_inst *inst, struct brw_reg dst, struct brw_reg src);
@@ -715,11 +749,15 @@ private:
 
    struct brw_wm_compile *c;
    const struct gl_fragment_program *fp;
+   const struct gl_vertex_program *vp;
 
    unsigned dispatch_width; /** 8 or 16 */
 
    bool dual_source_output;
 
+   /** INTEL_DEBUG flag that enables dumping the generated code */
+   int debug_flag;
+
    exec_list discard_halt_patches;
 };
 
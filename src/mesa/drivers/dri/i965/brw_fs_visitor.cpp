@@ -44,6 +44,7 @@ extern "C" {
 #include "brw_wm.h"
 }
 #include "brw_fs.h"
+#include "brw_vs.h"
 #include "main/uniforms.h"
 #include "glsl/glsl_types.h"
 #include "glsl/ir_optimization.h"
@@ -56,7 +57,47 @@ fs_visitor::visit(ir_variable *ir)
    if (variable_storage(ir))
       return;
 
-   if (ir->data.mode == ir_var_shader_in) {
+   if (stage == MESA_SHADER_VERTEX && ir->data.mode == ir_var_shader_in) {
+      /* Vertex attributes are pushed in by the VF; assign_vs_urb_setup()
+       * turns these into the actual payload registers.
+       */
+      const glsl_type *elem_type =
+         ir->type->is_array() ? ir->type->fields.array : ir->type;
+      if ((ir->type->is_array() || elem_type->is_matrix()) &&
+          elem_type->vector_elements != 4) {
+         /* Every attribute slot is a vec4, but our register offsets are
+          * tightly packed.
+          */
+         fail("Unsupported vertex attribute type for \"%s\"\n", ir->name);
+      }
+
+      reg = new(this->mem_ctx) fs_reg(ATTR, ir->data.location * 4);
+      reg->type = brw_type_for_base_type(ir->type);
+      hash_table_insert(this->variable_ht, reg, ir);
+      return;
+   } else if (stage == MESA_SHADER_VERTEX &&
+              ir->data.mode == ir_var_shader_out) {
+      reg = new(this->mem_ctx) fs_reg(this, ir->type);
+
+      /* Record where each VUE slot covered by the variable lives. */
+      const glsl_type *slot_type = ir->type;
+      unsigned slots = 1;
+      if (slot_type->is_array()) {
+         slots = slot_type->length;
+         slot_type = slot_type->fields.array;
+      }
+      if (slot_type->is_matrix()) {
+         slots *= slot_type->matrix_columns;
+         slot_type = slot_type->column_type();
+      }
+      for (unsigned i = 0; i < slots; i++) {
+         int location = ir->data.location + i;
+         assert(location < VARYING_SLOT_MAX);
+         this->vs_outputs[location] = *reg;
+         this->vs_outputs[location].reg_offset += i * type_size(slot_type);
+         this->vs_output_components[location] = slot_type->vector_elements;
+      }
+   } else if (ir->data.mode == ir_var_shader_in) {
       if (!strcmp(ir->name, "gl_FragCoord")) {
 	 reg = emit_fragcoord_interpolation(ir);
       } else if (!strcmp(ir->name, "gl_FrontFacing")) {
@@ -132,7 +173,17 @@ fs_visitor::visit(ir_variable *ir)
       reg->type = brw_type_for_base_type(ir->type);
 
    } else if (ir->data.mode == ir_var_system_value) {
-      if (ir->data.location == SYSTEM_VALUE_SAMPLE_POS) {
+      if (ir->data.location == SYSTEM_VALUE_VERTEX_ID ||
+          ir->data.location == SYSTEM_VALUE_INSTANCE_ID) {
+         /* The VF stores VertexID and InstanceID in the X and Y channels of
+          * an extra element after the last real attribute.
+          */
+         assert(stage == MESA_SHADER_VERTEX);
+         vs_prog_data->uses_vertexid = true;
+         int channel = ir->data.location == SYSTEM_VALUE_INSTANCE_ID;
+         reg = new(this->mem_ctx) fs_reg(ATTR, VERT_ATTRIB_MAX * 4 + channel,
+                                         BRW_REGISTER_TYPE_D);
+      } else if (ir->data.location == SYSTEM_VALUE_SAMPLE_POS) {
 	 reg = emit_samplepos_setup(ir);
       } else if (ir->data.location == SYSTEM_VALUE_SAMPLE_ID) {
 	 reg = emit_sampleid_setup(ir);
@@ -1277,6 +1328,14 @@ fs_visitor::emit_texture_gen7(ir_texture *ir, fs_reg dst, fs_reg coordinate,
    /* Set up the LOD info */
    switch (ir->op) {
    case ir_tex:
+      /* There are no derivatives outside of the fragment shader, so implicit
+       * LOD lookups sample the base level.
+       */
+      if (stage != MESA_SHADER_FRAGMENT) {
+         emit(MOV(next, fs_reg(0.0f)));
+         next.reg_offset++;
+      }
+      break;
    case ir_lod:
       break;
    case ir_txb:
@@ -1404,7 +1463,12 @@ fs_visitor::emit_texture_gen7(ir_texture *ir, fs_reg dst, fs_reg coordinate,
    /* Generate the SEND */
    fs_inst *inst = NULL;
    switch (ir->op) {
-   case ir_tex: inst = emit(SHADER_OPCODE_TEX, dst, payload); break;
+   case ir_tex:
+      if (stage != MESA_SHADER_FRAGMENT)
+         inst = emit(SHADER_OPCODE_TXL, dst, payload);
+      else
+         inst = emit(SHADER_OPCODE_TEX, dst, payload);
+      break;
    case ir_txb: inst = emit(FS_OPCODE_TXB, dst, payload); break;
    case ir_txl: inst = emit(SHADER_OPCODE_TXL, dst, payload); break;
    case ir_txd: inst = emit(SHADER_OPCODE_TXD, dst, payload); break;
@@ -2907,6 +2971,100 @@ fs_visitor::emit_fb_writes()
    this->current_annotation = NULL;
 }
 
+/**
+ * Writes the VUE for a scalar vertex shader.
+ *
+ * In SIMD8 mode each channel is a vertex, so a VUE slot takes one register
+ * per component.  We send two slots per message, with the URB handles from
+ * g1 as the header.
+ */
+void
+fs_visitor::emit_urb_writes()
+{
+   const struct brw_vue_map *vue_map = &vs_prog_data->base.vue_map;
+   const int base_mrf = 1;
+   int mrf = base_mrf + 1;
+   int starting_slot = 0;
+
+   for (int slot = 0; slot < vue_map->num_slots; slot++) {
+      int varying = vue_map->slot_to_varying[slot];
+
+      if (varying == VARYING_SLOT_PSIZ) {
+         /* PSIZ is always in slot 0, and is coupled with the layer and
+          * viewport index.
+          */
+         static const int header_varyings[3] = {
+            VARYING_SLOT_LAYER, VARYING_SLOT_VIEWPORT, VARYING_SLOT_PSIZ
+         };
+
+         current_annotation = "indices, point width, clip flags";
+         emit(MOV(fs_reg(MRF, mrf, BRW_REGISTER_TYPE_UD), fs_reg(0u)));
+         for (int i = 0; i < 3; i++) {
+            int header_varying = header_varyings[i];
+            fs_reg dst = fs_reg(MRF, mrf + 1 + i, BRW_REGISTER_TYPE_UD);
+
+            if ((vue_map->slots_valid & BITFIELD64_BIT(header_varying)) &&
+                vs_outputs[header_varying].file != BAD_FILE) {
+               dst.type = vs_outputs[header_varying].type;
+               emit(MOV(dst, vs_outputs[header_varying]));
+            } else {
+               emit(MOV(dst, fs_reg(0u)));
+            }
+         }
+      } else {
+         fs_reg src;
+         unsigned components = 0;
+         if (varying < VARYING_SLOT_MAX) {
+            src = vs_outputs[varying];
+            if (src.file != BAD_FILE)
+               components = vs_output_components[varying];
+         }
+
+         bool clamp = ((varying == VARYING_SLOT_COL0 ||
+                        varying == VARYING_SLOT_COL1 ||
+                        varying == VARYING_SLOT_BFC0 ||
+                        varying == VARYING_SLOT_BFC1) &&
+                       vs_compile->key.base.clamp_vertex_color);
+
+         current_annotation = "URB slot";
+         for (unsigned i = 0; i < 4; i++) {
+            fs_reg dst = fs_reg(MRF, mrf + i);
+
+            if (i < components) {
+               dst.type = src.type;
+               fs_inst *inst = emit(MOV(dst, src));
+               inst->saturate = clamp;
+               src.reg_offset++;
+            } else {
+               emit(MOV(dst, fs_reg(0.0f)));
+            }
+         }
+      }
+      mrf += 4;
+
+      bool last = slot == vue_map->num_slots - 1;
+      if (mrf - (base_mrf + 1) == 8 || last) {
+         current_annotation = "URB write";
+         fs_inst *header =
+            emit(MOV(fs_reg(MRF, base_mrf, BRW_REGISTER_TYPE_UD),
+                     fs_reg(retype(brw_vec8_grf(1, 0),
+                                   BRW_REGISTER_TYPE_UD))));
+         header->force_writemask_all = true;
+
+         fs_inst *inst = emit(SHADER_OPCODE_URB_WRITE_SIMD8);
+         inst->base_mrf = base_mrf;
+         inst->mlen = mrf - base_mrf;
+         inst->offset = starting_slot;
+         inst->eot = last;
+
+         mrf = base_mrf + 1;
+         starting_slot = slot + 1;
+      }
+   }
+
+   current_annotation = NULL;
+}
+
 void
 fs_visitor::resolve_ud_negate(fs_reg *reg)
 {
@@ -2937,18 +3095,45 @@ fs_visitor::fs_visitor(struct brw_context *brw,
                        unsigned dispatch_width)
    : dispatch_width(dispatch_width)
 {
+   this->stage = MESA_SHADER_FRAGMENT;
    this->c = c;
    this->brw = brw;
    this->fp = fp;
-   this->prog = &fp->Base;
+   this->vs_compile = NULL;
+   this->vs_prog_data = NULL;
    this->shader_prog = shader_prog;
    this->prog = &fp->Base;
+
+   init();
+}
+
+fs_visitor::fs_visitor(struct brw_context *brw,
+                       struct brw_wm_compile *c,
+                       struct brw_vs_compile *vs_compile,
+                       struct brw_vs_prog_data *vs_prog_data,
+                       struct gl_shader_program *shader_prog)
+   : dispatch_width(8)
+{
+   this->stage = MESA_SHADER_VERTEX;
+   this->c = c;
+   this->brw = brw;
+   this->fp = NULL;
+   this->vs_compile = vs_compile;
+   this->vs_prog_data = vs_prog_data;
+   this->shader_prog = shader_prog;
+   this->prog = &vs_compile->vp->program.Base;
+
+   init();
+}
+
+void
+fs_visitor::init()
+{
    this->stage_prog_data = &c->prog_data.base;
    this->ctx = &brw->ctx;
    this->mem_ctx = ralloc_context(NULL);
    if (shader_prog)
-      shader = (struct brw_shader *)
-         shader_prog->_LinkedShaders[MESA_SHADER_FRAGMENT];
+      shader = (struct brw_shader *) shader_prog->_LinkedShaders[stage];
    else
       shader = NULL;
    this->failed = false;
@@ -2958,6 +3143,8 @@ fs_visitor::fs_visitor(struct brw_context *brw,
 
    memset(this->outputs, 0, sizeof(this->outputs));
    memset(this->output_components, 0, sizeof(this->output_components));
+   memset(this->vs_outputs, 0, sizeof(this->vs_outputs));
+   memset(this->vs_output_components, 0, sizeof(this->vs_output_components));
    this->first_non_payload_grf = 0;
    this->max_grf = brw->gen >= 7 ? GEN7_MRF_HACK_START : BRW_MAX_GRF;
 
@@ -42,6 +42,7 @@
  * intel_perf_counters utility (which is available as part of intel-gpu-tools).
  */
 
+#include <inttypes.h>
 #include <limits.h>
 
 #include "main/bitset.h"
@@ -58,6 +59,9 @@
 
 #define FILE_DEBUG_FLAG DEBUG_PERFMON
 
+/** Number of the most recent draws whose timing a monitor keeps. */
+#define DRAW_TIMING_SLOTS 64
+
 /**
  * i965 representation of a performance monitor object.
  */
@@ -96,6 +100,42 @@ struct brw_perf_monitor_object
     * Storage for final pipeline statistics counter results.
     */
    uint64_t *pipeline_stats_results;
+
+   /**
+    * The state atom statistics when the monitor began, and once it ended,
+    * how much they grew in between.
+    */
+   struct brw_atom_stats atom_stats[BRW_MAX_ATOMS];
+
+   /** Whether the monitor is counted in brw->atom_time_users. */
+   bool atom_timing;
+
+   /**
+    * BO containing a ring of DRAW_TIMING_SLOTS records, each holding the
+    * snapshots taken before and after one draw or BLORP operation.
+    */
+   drm_intel_bo *draw_timing_bo;
+
+   /**
+    * Number of draws bracketed so far.  The next one uses the record
+    * draw_count % DRAW_TIMING_SLOTS, overwriting the oldest one.
+    */
+   unsigned draw_count;
+
+   /** Which records are for BLORP operations rather than draws. */
+   BITSET_DECLARE(draw_is_blorp, DRAW_TIMING_SLOTS);
+
+   /** Which records contain OA counter snapshots. */
+   BITSET_DECLARE(draw_has_oa, DRAW_TIMING_SLOTS);
+
+   /**
+    * Storage for the final per-draw results, oldest draw first, with
+    * DRAW_TIMING_COUNTERS_PER_DRAW values for each.
+    */
+   uint64_t *draw_timing_results;
+
+   /** Whether the monitor is in brw->perfmon.draw_timers. */
+   bool draw_timing;
 };
 
 /** Downcasting convenience macro. */
@@ -623,6 +663,64 @@ gather_statistics_results(struct brw_context *brw,
    monitor->pipeline_stats_bo = NULL;
 }
 
+/******************************************************************************/
+
+static bool
+monitor_needs_atom_stats(struct brw_context *brw,
+                         struct gl_perf_monitor_object *m)
+{
+   return brw->perfmon.atom_group >= 0 &&
+          m->ActiveGroups[brw->perfmon.atom_group];
+}
+
+static void
+stop_atom_timing(struct brw_context *brw,
+                 struct brw_perf_monitor_object *monitor)
+{
+   if (monitor->atom_timing) {
+      brw->atom_time_users--;
+      monitor->atom_timing = false;
+   }
+}
+
+/**
+ * Add a group with the number of emissions and the CPU time of each of the
+ * state atoms to the hardware counter groups.  The counters are in pairs:
+ * 2 * i counts the emissions of brw->atoms[i], 2 * i + 1 its CPU time.
+ */
+static void
+init_atom_counters(struct brw_context *brw)
+{
+   struct gl_context *ctx = &brw->ctx;
+   const int num_groups = ctx->PerfMonitor.NumGroups;
+   struct gl_perf_monitor_group *groups =
+      ralloc_array(brw, struct gl_perf_monitor_group, num_groups + 1);
+   struct gl_perf_monitor_counter *counters =
+      rzalloc_array(groups, struct gl_perf_monitor_counter,
+                    2 * brw->num_atoms);
+
+   for (int i = 0; i < 2 * brw->num_atoms; i++) {
+      const char *atom = brw->atoms[i / 2].name;
+
+      counters[i].Name = ralloc_asprintf(counters, i % 2 ? "%s CPU time (ns)"
+                                                         : "%s emits", atom);
+      counters[i].Type = GL_UNSIGNED_INT64_AMD;
+      counters[i].Minimum.u64 = 0;
+      counters[i].Maximum.u64 = ~0;
+   }
+
+   memcpy(groups, ctx->PerfMonitor.Groups, num_groups * sizeof(groups[0]));
+   groups[num_groups].Name = "Driver State Atoms";
+   groups[num_groups].MaxActiveCounters = INT_MAX;
+   groups[num_groups].Counters = counters;
+   groups[num_groups].NumCounters = 2 * brw->num_atoms;
+
+   ctx->PerfMonitor.Groups = groups;
+   ctx->PerfMonitor.NumGroups = num_groups + 1;
+   brw->perfmon.atom_group = num_groups;
+}
+
+
 /******************************************************************************/
 
 static bool
@@ -754,6 +852,284 @@ emit_mi_report_perf_count(struct brw_context *brw,
    assert(brw->batch.used - batch_used <= MI_REPORT_PERF_COUNT_BATCH_DWORDS * 4);
 }
 
+/******************************************************************************/
+
+/**
+ * Per-draw timing:  @{
+ *
+ * While a monitor with the per-draw timing group is active, every draw and
+ * BLORP operation is bracketed by a flush, a timestamp and snapshots of a few
+ * pipeline statistics registers (and of the OA counters, if some monitor has
+ * them running).  The snapshots go to a ring of records in the monitor's
+ * draw_timing_bo, so the results describe the most recent DRAW_TIMING_SLOTS
+ * operations before glEndPerfMonitorAMD().
+ *
+ * The flushes serialize the operations, so the times don't overlap and can
+ * be attributed to a single draw, at the cost of the parallelism between
+ * consecutive draws.
+ */
+
+/** The values gathered for each draw, in the order of their counters. */
+enum draw_timing_counter {
+   DRAW_GPU_TIME,
+   DRAW_PRIMITIVES,
+   DRAW_VS_INVOCATIONS,
+   DRAW_PS_INVOCATIONS,
+   DRAW_DEPTH_PASSES,
+   DRAW_RT_WRITES,
+   DRAW_IS_BLORP,
+   DRAW_TIMING_COUNTERS_PER_DRAW
+};
+
+static const char *const draw_timing_counter_names[] = {
+   [DRAW_GPU_TIME]       = "GPU time (ns)",
+   [DRAW_PRIMITIVES]     = "primitives",
+   [DRAW_VS_INVOCATIONS] = "VS invocations",
+   [DRAW_PS_INVOCATIONS] = "PS invocations",
+   [DRAW_DEPTH_PASSES]   = "depth test passes",
+   [DRAW_RT_WRITES]      = "render target writes",
+   [DRAW_IS_BLORP]       = "is a BLORP operation",
+};
+
+/** The statistics registers snapshotted around each draw. */
+static const uint32_t draw_statistics_registers[] = {
+   IA_PRIMITIVES_COUNT,
+   VS_INVOCATION_COUNT,
+   PS_INVOCATION_COUNT,
+   PS_DEPTH_COUNT,
+};
+
+/**
+ * Layout of a record in draw_timing_bo: the two timestamps, the starting and
+ * the ending statistics register values, then the two OA snapshots.
+ */
+#define DRAW_RECORD_STATS_START   2
+#define DRAW_RECORD_STATS_END     (2 + ARRAY_SIZE(draw_statistics_registers))
+#define DRAW_RECORD_OA_START_BYTES 256
+#define DRAW_RECORD_OA_END_BYTES   512
+#define DRAW_RECORD_SIZE_BYTES     768
+
+static bool
+monitor_needs_draw_timing(struct brw_context *brw,
+                          struct gl_perf_monitor_object *m)
+{
+   return brw->perfmon.draw_timing_group >= 0 &&
+          m->ActiveGroups[brw->perfmon.draw_timing_group];
+}
+
+static void
+start_draw_timing(struct brw_context *brw,
+                  struct brw_perf_monitor_object *monitor)
+{
+   const int size = DRAW_TIMING_SLOTS * DRAW_RECORD_SIZE_BYTES;
+
+   monitor->draw_timing_bo =
+      drm_intel_bo_alloc(brw->bufmgr, "perf. monitor draw timing bo",
+                         size, 64);
+
+   /* Records without OA snapshots are read as zero render target writes. */
+   drm_intel_bo_map(monitor->draw_timing_bo, true);
+   memset(monitor->draw_timing_bo->virtual, 0, size);
+   drm_intel_bo_unmap(monitor->draw_timing_bo);
+
+   monitor->draw_count = 0;
+
+   if (brw->perfmon.draw_timers_elements ==
+       brw->perfmon.draw_timers_array_size) {
+      brw->perfmon.draw_timers =
+         reralloc(brw, brw->perfmon.draw_timers,
+                  struct brw_perf_monitor_object *,
+                  brw->perfmon.draw_timers_array_size * 2);
+      brw->perfmon.draw_timers_array_size *= 2;
+   }
+
+   brw->perfmon.draw_timers[brw->perfmon.draw_timers_elements++] = monitor;
+   monitor->draw_timing = true;
+}
+
+static void
+stop_draw_timing(struct brw_context *brw,
+                 struct brw_perf_monitor_object *monitor)
+{
+   if (!monitor->draw_timing)
+      return;
+
+   for (int i = 0; i < brw->perfmon.draw_timers_elements; i++) {
+      if (brw->perfmon.draw_timers[i] == monitor) {
+         int last_elt = --brw->perfmon.draw_timers_elements;
+
+         brw->perfmon.draw_timers[i] = brw->perfmon.draw_timers[last_elt];
+         break;
+      }
+   }
+
+   monitor->draw_timing = false;
+}
+
+/**
+ * Take the snapshots before (end == false) or after a draw.
+ */
+static void
+snapshot_draw_timing(struct brw_context *brw,
+                     struct brw_perf_monitor_object *monitor,
+                     bool end)
+{
+   drm_intel_bo *bo = monitor->draw_timing_bo;
+   const int slot = monitor->draw_count % DRAW_TIMING_SLOTS;
+   const int record = slot * DRAW_RECORD_SIZE_BYTES / sizeof(uint64_t);
+   const int stats = record + (end ? DRAW_RECORD_STATS_END
+                                   : DRAW_RECORD_STATS_START);
+
+   /* Wait for the preceding rendering, so that the snapshots bound only the
+    * draw's own work.
+    */
+   intel_batchbuffer_emit_mi_flush(brw);
+
+   brw_write_timestamp(brw, bo, record + end);
+
+   for (int i = 0; i < ARRAY_SIZE(draw_statistics_registers); i++)
+      brw_store_register_mem64(brw, bo, draw_statistics_registers[i],
+                               stats + i);
+
+   if (BITSET_TEST(monitor->draw_has_oa, slot)) {
+      emit_mi_report_perf_count(brw, bo,
+                                slot * DRAW_RECORD_SIZE_BYTES +
+                                (end ? DRAW_RECORD_OA_END_BYTES
+                                     : DRAW_RECORD_OA_START_BYTES),
+                                REPORT_ID);
+   }
+}
+
+/**
+ * Gather the records from draw_timing_bo, oldest draw first, storing the
+ * final values.
+ */
+static void
+gather_draw_timing_results(struct brw_context *brw,
+                           struct brw_perf_monitor_object *monitor)
+{
+   const unsigned num_draws = MIN2(monitor->draw_count, DRAW_TIMING_SLOTS);
+   const unsigned first_draw = monitor->draw_count - num_draws;
+
+   monitor->draw_timing_results =
+      calloc(DRAW_TIMING_SLOTS * DRAW_TIMING_COUNTERS_PER_DRAW,
+             sizeof(uint64_t));
+
+   drm_intel_bo_map(monitor->draw_timing_bo, false);
+
+   for (unsigned i = 0; i < num_draws; i++) {
+      const int slot = (first_draw + i) % DRAW_TIMING_SLOTS;
+      const char *record = (const char *) monitor->draw_timing_bo->virtual +
+                           slot * DRAW_RECORD_SIZE_BYTES;
+      const uint64_t *values = (const uint64_t *) record;
+      const uint64_t *start = values + DRAW_RECORD_STATS_START;
+      const uint64_t *end = values + DRAW_RECORD_STATS_END;
+      uint64_t *results =
+         &monitor->draw_timing_results[i * DRAW_TIMING_COUNTERS_PER_DRAW];
+
+      /* The timestamp register increments every 80ns. */
+      results[DRAW_GPU_TIME] = 80 * (values[1] - values[0]);
+      results[DRAW_PRIMITIVES] = end[0] - start[0];
+      results[DRAW_VS_INVOCATIONS] = end[1] - start[1];
+      results[DRAW_PS_INVOCATIONS] = end[2] - start[2];
+      results[DRAW_DEPTH_PASSES] = end[3] - start[3];
+
+      if (BITSET_TEST(monitor->draw_has_oa, slot)) {
+         const uint32_t *oa_start =
+            (const uint32_t *) (record + DRAW_RECORD_OA_START_BYTES);
+         const uint32_t *oa_end =
+            (const uint32_t *) (record + DRAW_RECORD_OA_END_BYTES);
+         const int entry = brw->perfmon.rt_writes_entry;
+
+         /* The OA counters are 32 bits wide and may have wrapped. */
+         results[DRAW_RT_WRITES] = (uint32_t) (oa_end[entry] - oa_start[entry]);
+      }
+
+      results[DRAW_IS_BLORP] = BITSET_TEST(monitor->draw_is_blorp, slot) != 0;
+
+      DBG("Draw %u%s: %" PRIu64 " ns, %" PRIu64 " prims, %" PRIu64 " VS, "
+          "%" PRIu64 " PS, %" PRIu64 " depth, %" PRIu64 " RT writes\n",
+          first_draw + i, results[DRAW_IS_BLORP] ? " (BLORP)" : "",
+          results[DRAW_GPU_TIME], results[DRAW_PRIMITIVES],
+          results[DRAW_VS_INVOCATIONS], results[DRAW_PS_INVOCATIONS],
+          results[DRAW_DEPTH_PASSES], results[DRAW_RT_WRITES]);
+   }
+
+   drm_intel_bo_unmap(monitor->draw_timing_bo);
+   drm_intel_bo_unreference(monitor->draw_timing_bo);
+   monitor->draw_timing_bo = NULL;
+}
+
+/**
+ * Add a group with the timing of the most recent draws to the counter
+ * groups.  Counter 0 is the number of draws timed; it's followed by
+ * DRAW_TIMING_COUNTERS_PER_DRAW counters for each of the DRAW_TIMING_SLOTS
+ * draws, the oldest one first.
+ */
+static void
+init_draw_timing_counters(struct brw_context *brw)
+{
+   struct gl_context *ctx = &brw->ctx;
+   const int num_groups = ctx->PerfMonitor.NumGroups;
+   const int num_counters =
+      1 + DRAW_TIMING_SLOTS * DRAW_TIMING_COUNTERS_PER_DRAW;
+   struct gl_perf_monitor_group *groups =
+      ralloc_array(brw, struct gl_perf_monitor_group, num_groups + 1);
+   struct gl_perf_monitor_counter *counters =
+      rzalloc_array(groups, struct gl_perf_monitor_counter, num_counters);
+
+   counters[0].Name = "Draws timed";
+   for (int i = 1; i < num_counters; i++) {
+      const int draw = (i - 1) / DRAW_TIMING_COUNTERS_PER_DRAW;
+      const int value = (i - 1) % DRAW_TIMING_COUNTERS_PER_DRAW;
+
+      counters[i].Name = ralloc_asprintf(counters, "Draw %d %s", draw,
+                                         draw_timing_counter_names[value]);
+   }
+   for (int i = 0; i < num_counters; i++) {
+      counters[i].Type = GL_UNSIGNED_INT64_AMD;
+      counters[i].Minimum.u64 = 0;
+      counters[i].Maximum.u64 = ~0;
+   }
+
+   memcpy(groups, ctx->PerfMonitor.Groups, num_groups * sizeof(groups[0]));
+   groups[num_groups].Name = "Per-Draw Timing";
+   groups[num_groups].MaxActiveCounters = INT_MAX;
+   groups[num_groups].Counters = counters;
+   groups[num_groups].NumCounters = num_counters;
+
+   ctx->PerfMonitor.Groups = groups;
+   ctx->PerfMonitor.NumGroups = num_groups + 1;
+   brw->perfmon.draw_timing_group = num_groups;
+
+   brw->perfmon.draw_timers =
+      ralloc_array(brw, struct brw_perf_monitor_object *, 1);
+   brw->perfmon.draw_timers_elements = 0;
+   brw->perfmon.draw_timers_array_size = 1;
+}
+
+/**
+ * Find the OA counter which counts render target writes, for the per-draw
+ * memory traffic.
+ */
+static void
+find_rt_writes_entry(struct brw_context *brw, const char *name)
+{
+   const struct gl_perf_monitor_group *group =
+      &brw->ctx.PerfMonitor.Groups[OA_COUNTERS];
+
+   brw->perfmon.rt_writes_entry = -1;
+   for (int i = 0; i < brw->perfmon.entries_per_oa_snapshot; i++) {
+      const int counter = brw->perfmon.oa_snapshot_layout[i];
+
+      if (counter >= 0 && strcmp(group->Counters[counter].Name, name) == 0)
+         brw->perfmon.rt_writes_entry = i;
+   }
+}
+/** @} */
+
+/******************************************************************************/
+
 /**
  * Add a monitor to the global list of "unresolved monitors."
  *
@@ -1080,6 +1456,18 @@ reinitialize_perf_monitor(struct brw_context *brw,
 
    free(monitor->pipeline_stats_results);
    monitor->pipeline_stats_results = NULL;
+
+   stop_atom_timing(brw, monitor);
+
+   stop_draw_timing(brw, monitor);
+
+   if (monitor->draw_timing_bo) {
+      drm_intel_bo_unreference(monitor->draw_timing_bo);
+      monitor->draw_timing_bo = NULL;
+   }
+
+   free(monitor->draw_timing_results);
+   monitor->draw_timing_results = NULL;
 }
 
 /**
@@ -1149,6 +1537,15 @@ brw_begin_perf_monitor(struct gl_context *ctx,
       snapshot_statistics_registers(brw, monitor, 0);
    }
 
+   if (monitor_needs_atom_stats(brw, m)) {
+      memcpy(monitor->atom_stats, brw->atom_stats, sizeof(brw->atom_stats));
+      monitor->atom_timing = true;
+      brw->atom_time_users++;
+   }
+
+   if (monitor_needs_draw_timing(brw, m))
+      start_draw_timing(brw, monitor);
+
    return true;
 }
 
@@ -1202,6 +1599,20 @@ brw_end_perf_monitor(struct gl_context *ctx,
       snapshot_statistics_registers(brw, monitor,
                                     SECOND_SNAPSHOT_OFFSET_IN_BYTES);
    }
+
+   if (monitor_needs_atom_stats(brw, m)) {
+      for (int i = 0; i < brw->num_atoms; i++) {
+         monitor->atom_stats[i].emits =
+            brw->atom_stats[i].emits - monitor->atom_stats[i].emits;
+         monitor->atom_stats[i].time_ns =
+            brw->atom_stats[i].time_ns - monitor->atom_stats[i].time_ns;
+      }
+
+      stop_atom_timing(brw, monitor);
+   }
+
+   if (monitor_needs_draw_timing(brw, m))
+      stop_draw_timing(brw, monitor);
 }
 
 /**
@@ -1233,6 +1644,7 @@ brw_is_perf_monitor_result_available(struct gl_context *ctx,
 
    bool oa_available = true;
    bool stats_available = true;
+   bool draw_timing_available = true;
 
    if (monitor_needs_oa(brw, m)) {
       oa_available = !monitor->oa_bo ||
@@ -1246,7 +1658,13 @@ brw_is_perf_monitor_result_available(struct gl_context *ctx,
           !drm_intel_bo_busy(monitor->pipeline_stats_bo));
    }
 
-   return oa_available && stats_available;
+   if (monitor_needs_draw_timing(brw, m)) {
+      draw_timing_available = !monitor->draw_timing_bo ||
+         (!drm_intel_bo_references(brw->batch.bo, monitor->draw_timing_bo) &&
+          !drm_intel_bo_busy(monitor->draw_timing_bo));
+   }
+
+   return oa_available && stats_available && draw_timing_available;
 }
 
 /**
@@ -1331,6 +1749,42 @@ brw_get_perf_monitor_result(struct gl_context *ctx,
       }
    }
 
+   if (monitor_needs_atom_stats(brw, m)) {
+      const int group = brw->perfmon.atom_group;
+
+      for (int i = 0; i < 2 * brw->num_atoms; i++) {
+         const struct brw_atom_stats *stats = &monitor->atom_stats[i / 2];
+
+         if (!BITSET_TEST(m->ActiveCounters[group], i))
+            continue;
+
+         data[offset++] = group;
+         data[offset++] = i;
+         *((uint64_t *) (&data[offset])) =
+            i % 2 ? stats->time_ns : stats->emits;
+         offset += 2;
+      }
+   }
+
+   if (monitor_needs_draw_timing(brw, m)) {
+      const int group = brw->perfmon.draw_timing_group;
+      const int num_counters = ctx->PerfMonitor.Groups[group].NumCounters;
+
+      if (!monitor->draw_timing_results)
+         gather_draw_timing_results(brw, monitor);
+
+      for (int i = 0; i < num_counters; i++) {
+         if (!BITSET_TEST(m->ActiveCounters[group], i))
+            continue;
+
+         data[offset++] = group;
+         data[offset++] = i;
+         *((uint64_t *) (&data[offset])) =
+            i == 0 ? monitor->draw_count : monitor->draw_timing_results[i - 1];
+         offset += 2;
+      }
+   }
+
    if (bytes_written)
       *bytes_written = offset * sizeof(uint32_t);
 }
@@ -1413,6 +1867,50 @@ brw_perf_monitor_finish_batch(struct brw_context *brw)
    stop_oa_counters(brw);
 }
 
+/**
+ * Called before emitting a draw or a BLORP operation.
+ *
+ * Take the starting snapshots of the operation for each monitor timing draws.
+ * This must happen before the state for the operation is emitted, as the
+ * snapshots may wrap the batch.
+ */
+void
+brw_perf_monitor_begin_draw(struct brw_context *brw, bool blorp)
+{
+   for (int i = 0; i < brw->perfmon.draw_timers_elements; i++) {
+      struct brw_perf_monitor_object *monitor = brw->perfmon.draw_timers[i];
+      const int slot = monitor->draw_count % DRAW_TIMING_SLOTS;
+
+      if (blorp)
+         BITSET_SET(monitor->draw_is_blorp, slot);
+      else
+         BITSET_CLEAR(monitor->draw_is_blorp, slot);
+
+      if (brw->perfmon.oa_users > 0 && brw->perfmon.rt_writes_entry >= 0)
+         BITSET_SET(monitor->draw_has_oa, slot);
+      else
+         BITSET_CLEAR(monitor->draw_has_oa, slot);
+
+      snapshot_draw_timing(brw, monitor, false);
+   }
+}
+
+/**
+ * Called once a draw or a BLORP operation has been emitted.
+ *
+ * Take the ending snapshots, completing the operation's record.
+ */
+void
+brw_perf_monitor_end_draw(struct brw_context *brw)
+{
+   for (int i = 0; i < brw->perfmon.draw_timers_elements; i++) {
+      struct brw_perf_monitor_object *monitor = brw->perfmon.draw_timers[i];
+
+      snapshot_draw_timing(brw, monitor, true);
+      monitor->draw_count++;
+   }
+}
+
 /******************************************************************************/
 
 void
@@ -1428,6 +1926,8 @@ brw_init_performance_monitors(struct brw_context *brw)
    ctx->Driver.IsPerfMonitorResultAvailable = brw_is_perf_monitor_result_available;
    ctx->Driver.GetPerfMonitorResult = brw_get_perf_monitor_result;
 
+   brw->perfmon.rt_writes_entry = -1;
+
    if (brw->gen == 5) {
       ctx->PerfMonitor.Groups = gen5_groups;
       ctx->PerfMonitor.NumGroups = ARRAY_SIZE(gen5_groups);
@@ -1439,16 +1939,33 @@ brw_init_performance_monitors(struct brw_context *brw)
       brw->perfmon.oa_snapshot_layout = gen6_oa_snapshot_layout;
       brw->perfmon.entries_per_oa_snapshot = ARRAY_SIZE(gen6_oa_snapshot_layout);
       brw->perfmon.statistics_registers = gen6_statistics_register_addresses;
+      find_rt_writes_entry(brw, "Pixels/samples Written in the frame buffer");
    } else if (brw->gen == 7) {
       ctx->PerfMonitor.Groups = gen7_groups;
       ctx->PerfMonitor.NumGroups = ARRAY_SIZE(gen7_groups);
       brw->perfmon.oa_snapshot_layout = gen7_oa_snapshot_layout;
       brw->perfmon.entries_per_oa_snapshot = ARRAY_SIZE(gen7_oa_snapshot_layout);
       brw->perfmon.statistics_registers = gen7_statistics_register_addresses;
+      find_rt_writes_entry(brw, "3D/GPGPU Render Target Writes");
    }
 
    brw->perfmon.unresolved =
       ralloc_array(brw, struct brw_perf_monitor_object *, 1);
    brw->perfmon.unresolved_elements = 0;
    brw->perfmon.unresolved_array_size = 1;
+
+   /* The atom statistics are gathered on the CPU, but their group IDs must
+    * not clash with the fixed ones of the hardware counter groups.
+    */
+   brw->perfmon.atom_group = -1;
+   if (ctx->PerfMonitor.NumGroups > 0)
+      init_atom_counters(brw);
+
+   /* Draws are bracketed with timestamps and statistics registers, which
+    * we only snapshot on Gen6+.
+    */
+   brw->perfmon.draw_timing_group = -1;
+   brw->perfmon.draw_timers_elements = 0;
+   if (brw->perfmon.statistics_registers)
+      init_draw_timing_counters(brw);
 }
@@ -25,6 +25,8 @@
  *
  */
 
+#include <limits.h>
+
 #include "brw_fs.h"
 #include "brw_vec4.h"
 #include "glsl/glsl_types.h"
@@ -52,6 +54,13 @@ using namespace brw;
  * Note that often there will be many things which could execute
  * immediately, and there are a range of heuristic options to choose
  * from in picking among those.
+ *
+ * Before register allocation, the scheduler also tracks an estimate of
+ * the register pressure at the current point of the schedule.  In
+ * SCHEDULE_PRE_ADAPTIVE mode it schedules for latency while the pressure
+ * is comfortably below what the registers can hold, and for pressure
+ * once it gets close, so each block gets whichever of the two it can
+ * afford.
  */
 
 static bool debug = false;
@@ -404,6 +413,8 @@ public:
       this->post_reg_alloc = (mode == SCHEDULE_POST);
       this->mode = mode;
       this->time = 0;
+      this->reg_pressure = 0;
+      this->reg_pressure_limit = INT_MAX;
       if (!post_reg_alloc) {
          this->remaining_grf_uses = rzalloc_array(mem_ctx, int, grf_count);
          this->grf_active = rzalloc_array(mem_ctx, bool, grf_count);
@@ -468,6 +479,19 @@ public:
     * increase register pressure.
     */
    bool *grf_active;
+
+   /**
+    * Estimated register pressure at the current point of the schedule: the
+    * size of the VGRFs that have had an instruction scheduled that uses
+    * them, and still have uses left to be scheduled.
+    */
+   int reg_pressure;
+
+   /**
+    * Register pressure above which SCHEDULE_PRE_ADAPTIVE stops scheduling
+    * for latency, in the same units as reg_pressure.
+    */
+   int reg_pressure_limit;
 };
 
 class fs_instruction_scheduler : public instruction_scheduler
@@ -483,6 +507,7 @@ public:
 
    void count_remaining_grf_uses(backend_instruction *inst);
    void update_register_pressure(backend_instruction *inst);
+   void update_grf_pressure(int reg);
    int get_register_pressure_benefit(backend_instruction *inst);
 };
 
@@ -492,6 +517,16 @@ fs_instruction_scheduler::fs_instruction_scheduler(fs_visitor *v,
    : instruction_scheduler(v, grf_count, mode),
      v(v)
 {
+   if (mode == SCHEDULE_PRE_ADAPTIVE) {
+      /* VGRF sizes are in units of the dispatch width.  The pressure
+       * estimate ignores fragmentation and the register classes, so keep a
+       * quarter of the registers as headroom.
+       */
+      int reg_width = v->dispatch_width / 8;
+      int available = (v->max_grf - v->first_non_payload_grf) / reg_width;
+
+      reg_pressure_limit = available * 3 / 4;
+   }
 }
 
 void
@@ -521,17 +556,29 @@ fs_instruction_scheduler::update_register_pressure(backend_instruction *be)
    if (!remaining_grf_uses)
       return;
 
-   if (inst->dst.file == GRF) {
-      remaining_grf_uses[inst->dst.reg]--;
-      grf_active[inst->dst.reg] = true;
-   }
+   if (inst->dst.file == GRF)
+      update_grf_pressure(inst->dst.reg);
 
    for (int i = 0; i < 3; i++) {
-      if (inst->src[i].file == GRF) {
-         remaining_grf_uses[inst->src[i].reg]--;
-         grf_active[inst->src[i].reg] = true;
-      }
+      if (inst->src[i].file == GRF)
+         update_grf_pressure(inst->src[i].reg);
+   }
+}
+
+/**
+ * Accounts for the scheduling of one reference to a VGRF: the VGRF becomes
+ * live at its first scheduled reference and dead at its last.
+ */
+void
+fs_instruction_scheduler::update_grf_pressure(int reg)
+{
+   if (!grf_active[reg]) {
+      grf_active[reg] = true;
+      reg_pressure += v->virtual_grf_sizes[reg];
    }
+
+   if (--remaining_grf_uses[reg] == 0)
+      reg_pressure -= v->virtual_grf_sizes[reg];
 }
 
 int
@@ -614,8 +661,11 @@ schedule_node::schedule_node(backend_instruction *inst,
 
    /* We can't measure Gen6 timings directly but expect them to be much
     * closer to Gen7 than Gen4.
+    *
+    * Only the adaptive mode cares about latencies before register
+    * allocation.
     */
-   if (!sched->post_reg_alloc)
+   if (!sched->post_reg_alloc && sched->mode != SCHEDULE_PRE_ADAPTIVE)
       this->latency = 1;
    else if (brw->gen >= 6)
       set_latency_gen7(brw->is_haswell);
@@ -1140,7 +1190,9 @@ fs_instruction_scheduler::choose_instruction_to_schedule()
 {
    schedule_node *chosen = NULL;
 
-   if (mode == SCHEDULE_PRE || mode == SCHEDULE_POST) {
+   /* Schedule for latency as long as we can afford the registers. */
+   if (mode == SCHEDULE_PRE || mode == SCHEDULE_POST ||
+       (mode == SCHEDULE_PRE_ADAPTIVE && reg_pressure < reg_pressure_limit)) {
       int chosen_time = 0;
 
       /* Of the instructions ready to execute or the closest to
@@ -30,6 +30,7 @@ extern "C" {
 #include "brw_fs.h"
 #include "glsl/ir_optimization.h"
 #include "glsl/glsl_parser_extras.h"
+#include "glsl/glsl_stats.h"
 #include "main/shaderapi.h"
 
 struct gl_shader *
@@ -118,6 +119,9 @@ brw_link_shader(struct gl_context *ctx, struct gl_shader_program *shProg)
 {
    struct brw_context *brw = brw_context(ctx);
    unsigned int stage;
+   struct glsl_stats_timer timer;
+
+   glsl_stats_begin(&timer);
 
    for (stage = 0; stage < ARRAY_SIZE(shProg->_LinkedShaders); stage++) {
       struct brw_shader *shader =
@@ -126,6 +130,8 @@ brw_link_shader(struct gl_context *ctx, struct gl_shader_program *shProg)
       if (!shader)
 	 continue;
 
+      brw_disk_cache_set_source(brw, shProg, shader);
+
       struct gl_program *prog =
 	 ctx->Driver.NewProgram(ctx, _mesa_shader_stage_to_program(stage),
                                 shader->base.Name);
@@ -172,9 +178,12 @@ brw_link_shader(struct gl_context *ctx, struct gl_shader_program *shProg)
       lower_noise(shader->base.ir);
       lower_quadop_vector(shader->base.ir, false);
 
+      bool is_scalar = (stage == MESA_SHADER_FRAGMENT ||
+                        (stage == MESA_SHADER_VERTEX && brw->scalar_vs));
+
       bool input = true;
-      bool output = stage == MESA_SHADER_FRAGMENT;
-      bool temp = stage == MESA_SHADER_FRAGMENT;
+      bool output = is_scalar;
+      bool temp = is_scalar;
       bool uniform = false;
 
       bool lowered_variable_indexing =
@@ -182,8 +191,9 @@ brw_link_shader(struct gl_context *ctx, struct gl_shader_program *shProg)
                                              input, output, temp, uniform);
 
       if (unlikely(brw->perf_debug && lowered_variable_indexing)) {
-         perf_debug("Unsupported form of variable indexing in FS; falling "
-                    "back to very inefficient code generation\n");
+         perf_debug("Unsupported form of variable indexing in %s; falling "
+                    "back to very inefficient code generation\n",
+                    _mesa_shader_stage_to_string(stage));
       }
 
       /* FINISHME: Do this before the variable index lowering. */
@@ -192,7 +202,7 @@ brw_link_shader(struct gl_context *ctx, struct gl_shader_program *shProg)
       do {
 	 progress = false;
 
-	 if (stage == MESA_SHADER_FRAGMENT) {
+	 if (is_scalar) {
 	    brw_do_channel_expressions(shader->base.ir);
 	    brw_do_vector_splitting(shader->base.ir);
 	 }
@@ -278,6 +288,8 @@ brw_link_shader(struct gl_context *ctx, struct gl_shader_program *shProg)
    if (!brw_shader_precompile(ctx, shProg))
       return false;
 
+   glsl_stats_end(&timer, GLSL_STATS_BACKEND, "program", shProg->Name, NULL);
+
    return true;
 }
 
@@ -462,6 +474,9 @@ brw_instruction_name(enum opcode op)
    case SHADER_OPCODE_GEN7_SCRATCH_READ:
       return "gen7_scratch_read";
 
+   case SHADER_OPCODE_URB_WRITE_SIMD8:
+      return "urb_write_simd8";
+
    case FS_OPCODE_DDX:
       return "ddx";
    case FS_OPCODE_DDY:
@@ -189,6 +189,20 @@ void brw_state_cache_check_size( struct brw_context *brw );
 void brw_init_caches( struct brw_context *brw );
 void brw_destroy_caches( struct brw_context *brw );
 
+void brw_init_shared_cache(struct intel_screen *screen);
+void brw_destroy_shared_cache(struct intel_screen *screen);
+bool brw_search_shared_cache(struct brw_context *brw,
+                             enum brw_cache_id cache_id,
+                             const void *key, GLuint key_size,
+                             GLuint aux_size,
+                             uint32_t *inout_offset, void *out_aux);
+void brw_upload_shared_cache(struct brw_context *brw,
+                             enum brw_cache_id cache_id,
+                             const void *key, GLuint key_size,
+                             const void *data, GLuint data_size,
+                             const void *aux, GLuint aux_size,
+                             uint32_t *out_offset, void *out_aux);
+
 /***********************************************************************
  * brw_state_batch.c
  */
@@ -42,9 +42,15 @@
  *
  * Replacement is not implemented.  Instead, when the cache gets too
  * big we throw out all of the cache data and let it get regenerated.
+ *
+ * Kernels whose compile depends only on their key, like the BLORP ones, are
+ * also kept in a cache shared by all the contexts of the screen, so that
+ * each context needn't compile them again.
  */
 
+#include "c11/threads.h"
 #include "main/imports.h"
+#include "main/hash_table.h"
 #include "intel_batchbuffer.h"
 #include "brw_state.h"
 #include "brw_vs.h"
@@ -297,7 +303,10 @@ brw_upload_cache(struct brw_cache *cache,
     */
    if (!brw_try_upload_using_copy(cache, item, data, aux)) {
       brw_upload_item_data(cache, item, data);
+   } else {
+      cache->stats.copies++;
    }
+   cache->stats.uploads++;
 
    /* Set up the memory containing the key and aux_data */
    tmp = malloc(key_size + aux_size);
@@ -345,6 +354,8 @@ brw_init_caches(struct brw_context *brw)
    cache->aux_free[BRW_VS_PROG] = brw_vs_prog_data_free;
    cache->aux_free[BRW_GS_PROG] = brw_gs_prog_data_free;
    cache->aux_free[BRW_WM_PROG] = brw_wm_prog_data_free;
+
+   brw_disk_cache_init(cache);
 }
 
 static void
@@ -398,18 +409,38 @@ brw_state_cache_check_size(struct brw_context *brw)
 }
 
 
+static void
+brw_print_cache_stats(const struct brw_cache *cache)
+{
+   fprintf(stderr, "program cache: %u uploads, %u shared an existing copy, "
+           "%u kernels from the screen cache, %u bytes used\n",
+           cache->stats.uploads, cache->stats.copies,
+           cache->stats.shared_hits, cache->next_offset);
+
+   if (cache->stats.insns) {
+      fprintf(stderr, "program cache: compacted %u of %u instructions "
+              "(%.1f%%)\n",
+              cache->stats.compacted_insns, cache->stats.insns,
+              100.0 * cache->stats.compacted_insns / cache->stats.insns);
+   }
+}
+
 static void
 brw_destroy_cache(struct brw_context *brw, struct brw_cache *cache)
 {
 
    DBG("%s\n", __FUNCTION__);
 
+   if (unlikely(INTEL_DEBUG & DEBUG_CACHE))
+      brw_print_cache_stats(cache);
+
    drm_intel_bo_unreference(cache->bo);
    cache->bo = NULL;
    brw_clear_cache(brw, cache);
    free(cache->items);
    cache->items = NULL;
    cache->size = 0;
+   brw_disk_cache_destroy(cache);
 }
 
 
@@ -418,3 +449,231 @@ brw_destroy_caches(struct brw_context *brw)
 {
    brw_destroy_cache(brw, &brw->cache);
 }
+
+
+/**
+ * A kernel in the screen's cache.  Entries are never changed nor freed
+ * until the screen is destroyed, so lookups may use them unlocked.
+ */
+struct brw_shared_item {
+   enum brw_cache_id cache_id;
+   GLuint key_size;
+   GLuint aux_size;
+   GLuint data_size;
+   /** The key, then the aux data, then the kernel */
+   char storage[];
+};
+
+struct brw_shared_cache {
+   mtx_t mutex;
+   struct hash_table *items;
+};
+
+static GLuint
+shared_item_hash(enum brw_cache_id cache_id, const void *key, GLuint key_size)
+{
+   return _mesa_hash_data(key, key_size) ^ cache_id;
+}
+
+static bool
+shared_item_equals(const void *a, const void *b)
+{
+   const struct brw_shared_item *ia = a, *ib = b;
+
+   return ia->cache_id == ib->cache_id &&
+          ia->key_size == ib->key_size &&
+          memcmp(ia->storage, ib->storage, ia->key_size) == 0;
+}
+
+void
+brw_init_shared_cache(struct intel_screen *screen)
+{
+   struct brw_shared_cache *shared = CALLOC_STRUCT(brw_shared_cache);
+
+   if (!shared)
+      return;
+
+   shared->items = _mesa_hash_table_create(NULL, shared_item_equals);
+   if (!shared->items) {
+      free(shared);
+      return;
+   }
+
+   mtx_init(&shared->mutex, mtx_plain);
+   screen->kernel_cache = shared;
+}
+
+static void
+shared_item_free(struct hash_entry *entry)
+{
+   free((void *) entry->key);
+}
+
+void
+brw_destroy_shared_cache(struct intel_screen *screen)
+{
+   struct brw_shared_cache *shared = screen->kernel_cache;
+
+   if (!shared)
+      return;
+
+   _mesa_hash_table_destroy(shared->items, shared_item_free);
+   mtx_destroy(&shared->mutex);
+   free(shared);
+   screen->kernel_cache = NULL;
+}
+
+/**
+ * Only kernels which don't print their assembly when compiled are shared,
+ * so that INTEL_DEBUG=blorp keeps showing every BLORP compile.
+ */
+static struct brw_shared_cache *
+get_shared_cache(struct brw_context *brw)
+{
+   if (INTEL_DEBUG & DEBUG_BLORP)
+      return NULL;
+
+   return brw->intelScreen->kernel_cache;
+}
+
+static const struct brw_shared_item *
+search_shared_cache(struct brw_shared_cache *shared,
+                    enum brw_cache_id cache_id,
+                    const void *key, GLuint key_size)
+{
+   const GLuint hash = shared_item_hash(cache_id, key, key_size);
+   struct brw_shared_item *lookup;
+   struct hash_entry *entry;
+
+   lookup = malloc(sizeof(*lookup) + key_size);
+   if (!lookup)
+      return NULL;
+
+   lookup->cache_id = cache_id;
+   lookup->key_size = key_size;
+   memcpy(lookup->storage, key, key_size);
+
+   mtx_lock(&shared->mutex);
+   entry = _mesa_hash_table_search(shared->items, hash, lookup);
+   mtx_unlock(&shared->mutex);
+
+   free(lookup);
+
+   return entry ? entry->key : NULL;
+}
+
+static void
+insert_shared_cache(struct brw_shared_cache *shared,
+                    enum brw_cache_id cache_id,
+                    const void *key, GLuint key_size,
+                    const void *data, GLuint data_size,
+                    const void *aux, GLuint aux_size)
+{
+   const GLuint hash = shared_item_hash(cache_id, key, key_size);
+   struct brw_shared_item *item;
+
+   item = malloc(sizeof(*item) + key_size + aux_size + data_size);
+   if (!item)
+      return;
+
+   item->cache_id = cache_id;
+   item->key_size = key_size;
+   item->aux_size = aux_size;
+   item->data_size = data_size;
+   memcpy(item->storage, key, key_size);
+   memcpy(item->storage + key_size, aux, aux_size);
+   memcpy(item->storage + key_size + aux_size, data, data_size);
+
+   mtx_lock(&shared->mutex);
+   /* Another context may have compiled the same kernel meanwhile */
+   if (_mesa_hash_table_search(shared->items, hash, item)) {
+      free(item);
+   } else {
+      _mesa_hash_table_insert(shared->items, hash, item, item);
+   }
+   mtx_unlock(&shared->mutex);
+}
+
+/**
+ * Like brw_search_cache(), but on a miss the kernel is also looked for in
+ * the screen's cache and then in the disk cache.  Kernels found there are
+ * uploaded to the context's cache.
+ */
+bool
+brw_search_shared_cache(struct brw_context *brw,
+                        enum brw_cache_id cache_id,
+                        const void *key, GLuint key_size,
+                        GLuint aux_size,
+                        uint32_t *inout_offset, void *out_aux)
+{
+   struct brw_shared_cache *shared = get_shared_cache(brw);
+   const struct brw_shared_item *item;
+   GLuint *program;
+   GLuint program_size;
+   void *aux;
+
+   if (brw_search_cache(&brw->cache, cache_id, key, key_size,
+                        inout_offset, out_aux))
+      return true;
+
+   if (!shared)
+      return false;
+
+   item = search_shared_cache(shared, cache_id, key, key_size);
+   if (item) {
+      assert(item->aux_size == aux_size);
+      brw_upload_cache(&brw->cache, cache_id, key, key_size,
+                       item->storage + key_size + aux_size, item->data_size,
+                       item->storage + key_size, aux_size,
+                       inout_offset, out_aux);
+      brw->cache.stats.shared_hits++;
+      return true;
+   }
+
+   aux = malloc(MAX2(aux_size, 1));
+   if (!aux)
+      return false;
+
+   program = brw_disk_cache_load_kernel(brw, cache_id, key, key_size,
+                                        aux, aux_size, &program_size);
+   if (!program) {
+      free(aux);
+      return false;
+   }
+
+   insert_shared_cache(shared, cache_id, key, key_size,
+                       program, program_size, aux, aux_size);
+   brw_upload_cache(&brw->cache, cache_id, key, key_size,
+                    program, program_size, aux, aux_size,
+                    inout_offset, out_aux);
+
+   free(program);
+   free(aux);
+   return true;
+}
+
+/**
+ * Like brw_upload_cache(), but the kernel is also added to the screen's
+ * cache and stored in the disk cache.
+ */
+void
+brw_upload_shared_cache(struct brw_context *brw,
+                        enum brw_cache_id cache_id,
+                        const void *key, GLuint key_size,
+                        const void *data, GLuint data_size,
+                        const void *aux, GLuint aux_size,
+                        uint32_t *out_offset, void *out_aux)
+{
+   struct brw_shared_cache *shared = get_shared_cache(brw);
+
+   if (shared) {
+      insert_shared_cache(shared, cache_id, key, key_size,
+                          data, data_size, aux, aux_size);
+      brw_disk_cache_store_kernel(brw, cache_id, key, key_size,
+                                  data, data_size, aux, aux_size);
+   }
+
+   brw_upload_cache(&brw->cache, cache_id, key, key_size,
+                    data, data_size, aux, aux_size,
+                    out_offset, out_aux);
+}
@@ -31,304 +31,309 @@
 
 
 
+#include <inttypes.h>
+#include <time.h>
+
 #include "brw_context.h"
 #include "brw_state.h"
 #include "drivers/common/meta.h"
 #include "intel_batchbuffer.h"
 #include "intel_buffers.h"
 
-static const struct brw_tracked_state *gen4_atoms[] =
+#define ATOM(atom) { &atom, #atom }
+
+static const struct brw_atom gen4_atoms[] =
 {
-   &brw_vs_prog, /* must do before GS prog, state base address. */
-   &brw_ff_gs_prog, /* must do before state base address */
+   ATOM(brw_vs_prog), /* must do before GS prog, state base address. */
+   ATOM(brw_ff_gs_prog), /* must do before state base address */
 
-   &brw_interpolation_map,
+   ATOM(brw_interpolation_map),
 
-   &brw_clip_prog, /* must do before state base address */
-   &brw_sf_prog, /* must do before state base address */
-   &brw_wm_prog, /* must do before state base address */
+   ATOM(brw_clip_prog), /* must do before state base address */
+   ATOM(brw_sf_prog), /* must do before state base address */
+   ATOM(brw_wm_prog), /* must do before state base address */
 
    /* Once all the programs are done, we know how large urb entry
     * sizes need to be and can decide if we need to change the urb
     * layout.
     */
-   &brw_curbe_offsets,
-   &brw_recalculate_urb_fence,
+   ATOM(brw_curbe_offsets),
+   ATOM(brw_recalculate_urb_fence),
 
-   &brw_cc_vp,
-   &brw_cc_unit,
+   ATOM(brw_cc_vp),
+   ATOM(brw_cc_unit),
 
    /* Surface state setup.  Must come before the VS/WM unit.  The binding
     * table upload must be last.
     */
-   &brw_vs_pull_constants,
-   &brw_wm_pull_constants,
-   &brw_renderbuffer_surfaces,
-   &brw_texture_surfaces,
-   &brw_vs_binding_table,
-   &brw_wm_binding_table,
+   ATOM(brw_vs_pull_constants),
+   ATOM(brw_wm_pull_constants),
+   ATOM(brw_renderbuffer_surfaces),
+   ATOM(brw_texture_surfaces),
+   ATOM(brw_vs_binding_table),
+   ATOM(brw_wm_binding_table),
 
-   &brw_fs_samplers,
-   &brw_vs_samplers,
+   ATOM(brw_fs_samplers),
+   ATOM(brw_vs_samplers),
 
    /* These set up state for brw_psp_urb_cbs */
-   &brw_wm_unit,
-   &brw_sf_vp,
-   &brw_sf_unit,
-   &brw_vs_unit,		/* always required, enabled or not */
-   &brw_clip_unit,
-   &brw_gs_unit,
+   ATOM(brw_wm_unit),
+   ATOM(brw_sf_vp),
+   ATOM(brw_sf_unit),
+   ATOM(brw_vs_unit),		/* always required, enabled or not */
+   ATOM(brw_clip_unit),
+   ATOM(brw_gs_unit),
 
    /* Command packets:
     */
-   &brw_invariant_state,
-   &brw_state_base_address,
+   ATOM(brw_invariant_state),
+   ATOM(brw_state_base_address),
 
-   &brw_binding_table_pointers,
-   &brw_blend_constant_color,
+   ATOM(brw_binding_table_pointers),
+   ATOM(brw_blend_constant_color),
 
-   &brw_depthbuffer,
+   ATOM(brw_depthbuffer),
 
-   &brw_polygon_stipple,
-   &brw_polygon_stipple_offset,
+   ATOM(brw_polygon_stipple),
+   ATOM(brw_polygon_stipple_offset),
 
-   &brw_line_stipple,
-   &brw_aa_line_parameters,
+   ATOM(brw_line_stipple),
+   ATOM(brw_aa_line_parameters),
 
-   &brw_psp_urb_cbs,
+   ATOM(brw_psp_urb_cbs),
 
-   &brw_drawing_rect,
-   &brw_indices,
-   &brw_index_buffer,
-   &brw_vertices,
+   ATOM(brw_drawing_rect),
+   ATOM(brw_indices),
+   ATOM(brw_index_buffer),
+   ATOM(brw_vertices),
 
-   &brw_constant_buffer
+   ATOM(brw_constant_buffer)
 };
 
-static const struct brw_tracked_state *gen6_atoms[] =
+static const struct brw_atom gen6_atoms[] =
 {
-   &brw_vs_prog, /* must do before state base address */
-   &brw_ff_gs_prog, /* must do before state base address */
-   &brw_wm_prog, /* must do before state base address */
+   ATOM(brw_vs_prog), /* must do before state base address */
+   ATOM(brw_ff_gs_prog), /* must do before state base address */
+   ATOM(brw_wm_prog), /* must do before state base address */
 
-   &gen6_clip_vp,
-   &gen6_sf_vp,
+   ATOM(gen6_clip_vp),
+   ATOM(gen6_sf_vp),
 
    /* Command packets: */
 
    /* must do before binding table pointers, cc state ptrs */
-   &brw_state_base_address,
+   ATOM(brw_state_base_address),
 
-   &brw_cc_vp,
-   &gen6_viewport_state,	/* must do after *_vp stages */
+   ATOM(brw_cc_vp),
+   ATOM(gen6_viewport_state),	/* must do after *_vp stages */
 
-   &gen6_urb,
-   &gen6_blend_state,		/* must do before cc unit */
-   &gen6_color_calc_state,	/* must do before cc unit */
-   &gen6_depth_stencil_state,	/* must do before cc unit */
+   ATOM(gen6_urb),
+   ATOM(gen6_blend_state),		/* must do before cc unit */
+   ATOM(gen6_color_calc_state),	/* must do before cc unit */
+   ATOM(gen6_depth_stencil_state),	/* must do before cc unit */
 
-   &gen6_vs_push_constants, /* Before vs_state */
-   &gen6_wm_push_constants, /* Before wm_state */
+   ATOM(gen6_vs_push_constants), /* Before vs_state */
+   ATOM(gen6_wm_push_constants), /* Before wm_state */
 
    /* Surface state setup.  Must come before the VS/WM unit.  The binding
     * table upload must be last.
     */
-   &brw_vs_pull_constants,
-   &brw_vs_ubo_surfaces,
-   &brw_wm_pull_constants,
-   &brw_wm_ubo_surfaces,
-   &gen6_renderbuffer_surfaces,
-   &brw_texture_surfaces,
-   &gen6_sol_surface,
-   &brw_vs_binding_table,
-   &gen6_gs_binding_table,
-   &brw_wm_binding_table,
+   ATOM(brw_vs_pull_constants),
+   ATOM(brw_vs_ubo_surfaces),
+   ATOM(brw_wm_pull_constants),
+   ATOM(brw_wm_ubo_surfaces),
+   ATOM(gen6_renderbuffer_surfaces),
+   ATOM(brw_texture_surfaces),
+   ATOM(gen6_sol_surface),
+   ATOM(brw_vs_binding_table),
+   ATOM(gen6_gs_binding_table),
+   ATOM(brw_wm_binding_table),
 
-   &brw_fs_samplers,
-   &brw_vs_samplers,
-   &gen6_sampler_state,
-   &gen6_multisample_state,
+   ATOM(brw_fs_samplers),
+   ATOM(brw_vs_samplers),
+   ATOM(gen6_sampler_state),
+   ATOM(gen6_multisample_state),
 
-   &gen6_vs_state,
-   &gen6_gs_state,
-   &gen6_clip_state,
-   &gen6_sf_state,
-   &gen6_wm_state,
+   ATOM(gen6_vs_state),
+   ATOM(gen6_gs_state),
+   ATOM(gen6_clip_state),
+   ATOM(gen6_sf_state),
+   ATOM(gen6_wm_state),
 
-   &gen6_scissor_state,
+   ATOM(gen6_scissor_state),
 
-   &gen6_binding_table_pointers,
+   ATOM(gen6_binding_table_pointers),
 
-   &brw_depthbuffer,
+   ATOM(brw_depthbuffer),
 
-   &brw_polygon_stipple,
-   &brw_polygon_stipple_offset,
+   ATOM(brw_polygon_stipple),
+   ATOM(brw_polygon_stipple_offset),
 
-   &brw_line_stipple,
-   &brw_aa_line_parameters,
+   ATOM(brw_line_stipple),
+   ATOM(brw_aa_line_parameters),
 
-   &brw_drawing_rect,
+   ATOM(brw_drawing_rect),
 
-   &brw_indices,
-   &brw_index_buffer,
-   &brw_vertices,
+   ATOM(brw_indices),
+   ATOM(brw_index_buffer),
+   ATOM(brw_vertices),
 };
 
-static const struct brw_tracked_state *gen7_atoms[] =
+static const struct brw_atom gen7_atoms[] =
 {
-   &brw_vs_prog,
-   &brw_gs_prog,
-   &brw_wm_prog,
+   ATOM(brw_vs_prog),
+   ATOM(brw_gs_prog),
+   ATOM(brw_wm_prog),
 
    /* Command packets: */
 
    /* must do before binding table pointers, cc state ptrs */
-   &brw_state_base_address,
+   ATOM(brw_state_base_address),
 
-   &brw_cc_vp,
-   &gen7_cc_viewport_state_pointer, /* must do after brw_cc_vp */
-   &gen7_sf_clip_viewport,
+   ATOM(brw_cc_vp),
+   ATOM(gen7_cc_viewport_state_pointer), /* must do after brw_cc_vp */
+   ATOM(gen7_sf_clip_viewport),
 
-   &gen7_push_constant_space,
-   &gen7_urb,
-   &gen6_blend_state,		/* must do before cc unit */
-   &gen6_color_calc_state,	/* must do before cc unit */
-   &gen6_depth_stencil_state,	/* must do before cc unit */
+   ATOM(gen7_push_constant_space),
+   ATOM(gen7_urb),
+   ATOM(gen6_blend_state),		/* must do before cc unit */
+   ATOM(gen6_color_calc_state),	/* must do before cc unit */
+   ATOM(gen6_depth_stencil_state),	/* must do before cc unit */
 
-   &gen6_vs_push_constants, /* Before vs_state */
-   &gen7_gs_push_constants, /* Before gs_state */
-   &gen6_wm_push_constants, /* Before wm_surfaces and constant_buffer */
+   ATOM(gen6_vs_push_constants), /* Before vs_state */
+   ATOM(gen7_gs_push_constants), /* Before gs_state */
+   ATOM(gen6_wm_push_constants), /* Before wm_surfaces and constant_buffer */
 
    /* Surface state setup.  Must come before the VS/WM unit.  The binding
     * table upload must be last.
     */
-   &brw_vs_pull_constants,
-   &brw_vs_ubo_surfaces,
-   &brw_vs_abo_surfaces,
-   &brw_gs_pull_constants,
-   &brw_gs_ubo_surfaces,
-   &brw_gs_abo_surfaces,
-   &brw_wm_pull_constants,
-   &brw_wm_ubo_surfaces,
-   &brw_wm_abo_surfaces,
-   &gen6_renderbuffer_surfaces,
-   &brw_texture_surfaces,
-   &brw_vs_binding_table,
-   &brw_gs_binding_table,
-   &brw_wm_binding_table,
-
-   &brw_fs_samplers,
-   &brw_vs_samplers,
-   &brw_gs_samplers,
-   &gen6_multisample_state,
-
-   &gen7_disable_stages,
-   &gen7_vs_state,
-   &gen7_gs_state,
-   &gen7_sol_state,
-   &gen7_clip_state,
-   &gen7_sbe_state,
-   &gen7_sf_state,
-   &gen7_wm_state,
-   &gen7_ps_state,
-
-   &gen6_scissor_state,
-
-   &gen7_depthbuffer,
-
-   &brw_polygon_stipple,
-   &brw_polygon_stipple_offset,
-
-   &brw_line_stipple,
-   &brw_aa_line_parameters,
-
-   &brw_drawing_rect,
-
-   &brw_indices,
-   &brw_index_buffer,
-   &brw_vertices,
-
-   &haswell_cut_index,
+   ATOM(brw_vs_pull_constants),
+   ATOM(brw_vs_ubo_surfaces),
+   ATOM(brw_vs_abo_surfaces),
+   ATOM(brw_gs_pull_constants),
+   ATOM(brw_gs_ubo_surfaces),
+   ATOM(brw_gs_abo_surfaces),
+   ATOM(brw_wm_pull_constants),
+   ATOM(brw_wm_ubo_surfaces),
+   ATOM(brw_wm_abo_surfaces),
+   ATOM(gen6_renderbuffer_surfaces),
+   ATOM(brw_texture_surfaces),
+   ATOM(brw_vs_binding_table),
+   ATOM(brw_gs_binding_table),
+   ATOM(brw_wm_binding_table),
+
+   ATOM(brw_fs_samplers),
+   ATOM(brw_vs_samplers),
+   ATOM(brw_gs_samplers),
+   ATOM(gen6_multisample_state),
+
+   ATOM(gen7_disable_stages),
+   ATOM(gen7_vs_state),
+   ATOM(gen7_gs_state),
+   ATOM(gen7_sol_state),
+   ATOM(gen7_clip_state),
+   ATOM(gen7_sbe_state),
+   ATOM(gen7_sf_state),
+   ATOM(gen7_wm_state),
+   ATOM(gen7_ps_state),
+
+   ATOM(gen6_scissor_state),
+
+   ATOM(gen7_depthbuffer),
+
+   ATOM(brw_polygon_stipple),
+   ATOM(brw_polygon_stipple_offset),
+
+   ATOM(brw_line_stipple),
+   ATOM(brw_aa_line_parameters),
+
+   ATOM(brw_drawing_rect),
+
+   ATOM(brw_indices),
+   ATOM(brw_index_buffer),
+   ATOM(brw_vertices),
+
+   ATOM(haswell_cut_index),
 };
 
-static const struct brw_tracked_state *gen8_atoms[] =
+static const struct brw_atom gen8_atoms[] =
 {
-   &brw_vs_prog,
-   &brw_gs_prog,
-   &brw_wm_prog,
+   ATOM(brw_vs_prog),
+   ATOM(brw_gs_prog),
+   ATOM(brw_wm_prog),
 
    /* Command packets: */
-   &gen8_state_base_address,
+   ATOM(gen8_state_base_address),
 
-   &brw_cc_vp,
-   &gen7_cc_viewport_state_pointer, /* must do after brw_cc_vp */
-   &gen8_sf_clip_viewport,
+   ATOM(brw_cc_vp),
+   ATOM(gen7_cc_viewport_state_pointer), /* must do after brw_cc_vp */
+   ATOM(gen8_sf_clip_viewport),
 
-   &gen7_push_constant_space,
-   &gen7_urb,
-   &gen8_blend_state,
-   &gen6_color_calc_state,
+   ATOM(gen7_push_constant_space),
+   ATOM(gen7_urb),
+   ATOM(gen8_blend_state),
+   ATOM(gen6_color_calc_state),
 
-   &gen6_vs_push_constants, /* Before vs_state */
-   &gen7_gs_push_constants, /* Before gs_state */
-   &gen6_wm_push_constants, /* Before wm_surfaces and constant_buffer */
+   ATOM(gen6_vs_push_constants), /* Before vs_state */
+   ATOM(gen7_gs_push_constants), /* Before gs_state */
+   ATOM(gen6_wm_push_constants), /* Before wm_surfaces and constant_buffer */
 
    /* Surface state setup.  Must come before the VS/WM unit.  The binding
     * table upload must be last.
     */
-   &brw_vs_pull_constants,
-   &brw_vs_ubo_surfaces,
-   &brw_vs_abo_surfaces,
-   &brw_gs_pull_constants,
-   &brw_gs_ubo_surfaces,
-   &brw_gs_abo_surfaces,
-   &brw_wm_pull_constants,
-   &brw_wm_ubo_surfaces,
-   &brw_wm_abo_surfaces,
-   &gen6_renderbuffer_surfaces,
-   &brw_texture_surfaces,
-   &brw_vs_binding_table,
-   &brw_gs_binding_table,
-   &brw_wm_binding_table,
-
-   &brw_fs_samplers,
-   &brw_vs_samplers,
-   &brw_gs_samplers,
-   &gen8_multisample_state,
-
-   &gen8_disable_stages,
-   &gen8_vs_state,
-   &gen8_gs_state,
-   &gen8_sol_state,
-   &gen6_clip_state,
-   &gen8_raster_state,
-   &gen8_sbe_state,
-   &gen8_sf_state,
-   &gen8_ps_blend,
-   &gen8_ps_extra,
-   &gen8_ps_state,
-   &gen8_wm_depth_stencil,
-   &gen8_wm_state,
-
-   &gen6_scissor_state,
-
-   &gen7_depthbuffer,
-
-   &brw_polygon_stipple,
-   &brw_polygon_stipple_offset,
-
-   &brw_line_stipple,
-   &brw_aa_line_parameters,
-
-   &brw_drawing_rect,
-
-   &gen8_vf_topology,
-
-   &brw_indices,
-   &gen8_index_buffer,
-   &gen8_vertices,
-
-   &haswell_cut_index,
+   ATOM(brw_vs_pull_constants),
+   ATOM(brw_vs_ubo_surfaces),
+   ATOM(brw_vs_abo_surfaces),
+   ATOM(brw_gs_pull_constants),
+   ATOM(brw_gs_ubo_surfaces),
+   ATOM(brw_gs_abo_surfaces),
+   ATOM(brw_wm_pull_constants),
+   ATOM(brw_wm_ubo_surfaces),
+   ATOM(brw_wm_abo_surfaces),
+   ATOM(gen6_renderbuffer_surfaces),
+   ATOM(brw_texture_surfaces),
+   ATOM(brw_vs_binding_table),
+   ATOM(brw_gs_binding_table),
+   ATOM(brw_wm_binding_table),
+
+   ATOM(brw_fs_samplers),
+   ATOM(brw_vs_samplers),
+   ATOM(brw_gs_samplers),
+   ATOM(gen8_multisample_state),
+
+   ATOM(gen8_disable_stages),
+   ATOM(gen8_vs_state),
+   ATOM(gen8_gs_state),
+   ATOM(gen8_sol_state),
+   ATOM(gen6_clip_state),
+   ATOM(gen8_raster_state),
+   ATOM(gen8_sbe_state),
+   ATOM(gen8_sf_state),
+   ATOM(gen8_ps_blend),
+   ATOM(gen8_ps_extra),
+   ATOM(gen8_ps_state),
+   ATOM(gen8_wm_depth_stencil),
+   ATOM(gen8_wm_state),
+
+   ATOM(gen6_scissor_state),
+
+   ATOM(gen7_depthbuffer),
+
+   ATOM(brw_polygon_stipple),
+   ATOM(brw_polygon_stipple_offset),
+
+   ATOM(brw_line_stipple),
+   ATOM(brw_aa_line_parameters),
+
+   ATOM(brw_drawing_rect),
+
+   ATOM(gen8_vf_topology),
+
+   ATOM(brw_indices),
+   ATOM(gen8_index_buffer),
+   ATOM(gen8_vertices),
+
+   ATOM(haswell_cut_index),
 };
 
 static void
@@ -351,9 +356,14 @@ brw_upload_initial_gpu_state(struct brw_context *brw)
 void brw_init_state( struct brw_context *brw )
 {
    struct gl_context *ctx = &brw->ctx;
-   const struct brw_tracked_state **atoms;
+   const struct brw_atom *atoms;
    int num_atoms;
 
+   STATIC_ASSERT(ARRAY_SIZE(gen4_atoms) <= BRW_MAX_ATOMS);
+   STATIC_ASSERT(ARRAY_SIZE(gen6_atoms) <= BRW_MAX_ATOMS);
+   STATIC_ASSERT(ARRAY_SIZE(gen7_atoms) <= BRW_MAX_ATOMS);
+   STATIC_ASSERT(ARRAY_SIZE(gen8_atoms) <= BRW_MAX_ATOMS);
+
    brw_init_caches(brw);
 
    if (brw->gen >= 8) {
@@ -373,14 +383,27 @@ void brw_init_state( struct brw_context *brw )
    brw->atoms = atoms;
    brw->num_atoms = num_atoms;
 
-   while (num_atoms--) {
-      assert((*atoms)->dirty.mesa |
-	     (*atoms)->dirty.brw |
-	     (*atoms)->dirty.cache);
-      assert((*atoms)->emit);
-      atoms++;
+   memset(brw->atom_dispatch, 0, sizeof(brw->atom_dispatch));
+
+   for (int i = 0; i < num_atoms; i++) {
+      const struct brw_state_flags *dirty = &atoms[i].state->dirty;
+
+      assert(dirty->mesa | dirty->brw | dirty->cache);
+      assert(atoms[i].state->emit);
+
+      for (int b = 0; b < 32; b++) {
+         if (dirty->mesa & (1u << b))
+            brw->atom_dispatch[b] |= (uint64_t) 1 << i;
+         if (dirty->brw & (1u << b))
+            brw->atom_dispatch[32 + b] |= (uint64_t) 1 << i;
+         if (dirty->cache & (1u << b))
+            brw->atom_dispatch[64 + b] |= (uint64_t) 1 << i;
+      }
    }
 
+   if (INTEL_DEBUG & DEBUG_STATE)
+      brw->atom_time_users++;
+
    brw_upload_initial_gpu_state(brw);
 
    brw->state.dirty.mesa = ~0;
@@ -561,6 +584,70 @@ brw_print_dirty_count(struct dirty_bit_map *bit_map)
    }
 }
 
+static void
+brw_print_atom_stats(struct brw_context *brw)
+{
+   int i;
+
+   for (i = 0; i < brw->num_atoms; i++) {
+      const struct brw_atom_stats *stats = &brw->atom_stats[i];
+
+      fprintf(stderr, "%12" PRIu64 " emits, %10.3f ms (%s)\n",
+              stats->emits, stats->time_ns / 1000000.0, brw->atoms[i].name);
+   }
+}
+
+static uint64_t
+brw_atom_time_ns(void)
+{
+   struct timespec tp;
+
+   clock_gettime(CLOCK_MONOTONIC, &tp);
+
+   return tp.tv_sec * UINT64_C(1000000000) + tp.tv_nsec;
+}
+
+static void
+brw_emit_atom(struct brw_context *brw, int i)
+{
+   const struct brw_tracked_state *atom = brw->atoms[i].state;
+   struct brw_atom_stats *stats = &brw->atom_stats[i];
+
+   stats->emits++;
+
+   if (unlikely(brw->atom_time_users)) {
+      uint64_t start = brw_atom_time_ns();
+      atom->emit(brw);
+      stats->time_ns += brw_atom_time_ns() - start;
+   } else {
+      atom->emit(brw);
+   }
+}
+
+/**
+ * Returns the mask of the atoms which depend on any of the flags.
+ */
+static uint64_t
+brw_atoms_for_state(struct brw_context *brw,
+                    const struct brw_state_flags *flags)
+{
+   const GLuint bits[3] = { flags->mesa, flags->brw, flags->cache };
+   uint64_t atoms = 0;
+
+   for (int i = 0; i < 3; i++) {
+      GLuint b = bits[i];
+
+      while (b) {
+         const int bit = ffs(b) - 1;
+
+         b &= ~(1u << bit);
+         atoms |= brw->atom_dispatch[i * 32 + bit];
+      }
+   }
+
+   return atoms;
+}
+
 /***********************************************************************
  * Emit all state:
  */
@@ -619,11 +706,11 @@ void brw_upload_state(struct brw_context *brw)
       prev = *state;
 
       for (i = 0; i < brw->num_atoms; i++) {
-	 const struct brw_tracked_state *atom = brw->atoms[i];
+	 const struct brw_tracked_state *atom = brw->atoms[i].state;
 	 struct brw_state_flags generated;
 
 	 if (check_state(state, &atom->dirty)) {
-	    atom->emit(brw);
+	    brw_emit_atom(brw, i);
 	 }
 
 	 accumulate_state(&examined, &atom->dirty);
@@ -638,12 +725,28 @@ void brw_upload_state(struct brw_context *brw)
       }
    }
    else {
-      for (i = 0; i < brw->num_atoms; i++) {
-	 const struct brw_tracked_state *atom = brw->atoms[i];
+      /* Only visit the atoms which depend on the dirty flags.  As the atoms
+       * flag more state dirty, add the later atoms depending on it.  The
+       * INTEL_DEBUG path above checks that no atom flags state which an
+       * earlier one depends on.
+       */
+      uint64_t todo = brw_atoms_for_state(brw, state);
+      struct brw_state_flags prev = *state;
 
-	 if (check_state(state, &atom->dirty)) {
-	    atom->emit(brw);
-	 }
+      while (todo) {
+         struct brw_state_flags generated;
+
+         i = ffsll(todo) - 1;
+         brw_emit_atom(brw, i);
+
+         const uint64_t later_atoms = ~(uint64_t) 0 << i << 1;
+         todo &= later_atoms;
+
+         xor_states(&generated, &prev, state);
+         if (generated.mesa | generated.brw | generated.cache) {
+            todo |= brw_atoms_for_state(brw, &generated) & later_atoms;
+            prev = *state;
+         }
       }
    }
 
@@ -658,6 +761,7 @@ void brw_upload_state(struct brw_context *brw)
 	 brw_print_dirty_count(mesa_bits);
 	 brw_print_dirty_count(brw_bits);
 	 brw_print_dirty_count(cache_bits);
+	 brw_print_atom_stats(brw);
 	 fprintf(stderr, "\n");
       }
    }
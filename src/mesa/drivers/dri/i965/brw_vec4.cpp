@@ -1398,8 +1398,7 @@ vec4_visitor::setup_uniforms(int reg)
       prog_data->param = reralloc(NULL, prog_data->param, const float *, 4);
       for (unsigned int i = 0; i < 4; i++) {
 	 unsigned int slot = this->uniforms * 4 + i;
-	 static float zero = 0.0;
-	 prog_data->param[slot] = &zero;
+	 prog_data->param[slot] = &brw_zero_param;
       }
 
       this->uniforms++;
@@ -1625,6 +1624,38 @@ vec4_visitor::run()
 
 extern "C" {
 
+/**
+ * Whether the scalar backend can compile this vertex shader.  It only handles
+ * GLSL, and none of the fixups that the vec4 backend emits on its own.
+ */
+static bool
+brw_vs_use_scalar(struct brw_context *brw,
+                  struct gl_shader_program *prog,
+                  const struct brw_vs_compile *c)
+{
+   if (!brw->scalar_vs || !prog)
+      return false;
+
+   if (INTEL_DEBUG & DEBUG_SHADER_TIME)
+      return false;
+
+   if (c->key.copy_edgeflag)
+      return false;
+
+   /* Legacy user clipping computes gl_ClipDistance from the clip planes. */
+   if (c->key.base.userclip_active &&
+       !(c->vp->program.Base.OutputsWritten &
+         BITFIELD64_BIT(VARYING_SLOT_CLIP_DIST0)))
+      return false;
+
+   for (int i = 0; i < VERT_ATTRIB_MAX; i++) {
+      if (c->key.gl_attrib_wa_flags[i])
+         return false;
+   }
+
+   return true;
+}
+
 /**
  * Compile a vertex shader.
  *
@@ -1663,28 +1694,36 @@ brw_vs_emit(struct brw_context *brw,
       }
    }
 
-   vec4_vs_visitor v(brw, c, prog_data, prog, shader, mem_ctx);
-   if (!v.run()) {
-      if (prog) {
-         prog->LinkStatus = false;
-         ralloc_strcat(&prog->InfoLog, v.fail_msg);
-      }
+   const unsigned *assembly = NULL;
+   if (brw_vs_use_scalar(brw, prog, c)) {
+      assembly = brw_vs_emit_scalar(brw, prog, c, prog_data, mem_ctx,
+                                    final_assembly_size);
+   }
 
-      _mesa_problem(NULL, "Failed to compile vertex shader: %s\n",
-                    v.fail_msg);
+   if (!assembly) {
+      vec4_vs_visitor v(brw, c, prog_data, prog, shader, mem_ctx);
+      if (!v.run()) {
+         if (prog) {
+            prog->LinkStatus = false;
+            ralloc_strcat(&prog->InfoLog, v.fail_msg);
+         }
 
-      return NULL;
-   }
+         _mesa_problem(NULL, "Failed to compile vertex shader: %s\n",
+                       v.fail_msg);
 
-   const unsigned *assembly = NULL;
-   if (brw->gen >= 8) {
-      gen8_vec4_generator g(brw, prog, &c->vp->program.Base, &prog_data->base,
-                            mem_ctx, INTEL_DEBUG & DEBUG_VS);
-      assembly = g.generate_assembly(&v.instructions, final_assembly_size);
-   } else {
-      vec4_generator g(brw, prog, &c->vp->program.Base, &prog_data->base,
-                       mem_ctx, INTEL_DEBUG & DEBUG_VS);
-      assembly = g.generate_assembly(&v.instructions, final_assembly_size);
+         return NULL;
+      }
+
+      if (brw->gen >= 8) {
+         gen8_vec4_generator g(brw, prog, &c->vp->program.Base,
+                               &prog_data->base, mem_ctx,
+                               INTEL_DEBUG & DEBUG_VS);
+         assembly = g.generate_assembly(&v.instructions, final_assembly_size);
+      } else {
+         vec4_generator g(brw, prog, &c->vp->program.Base, &prog_data->base,
+                          mem_ctx, INTEL_DEBUG & DEBUG_VS);
+         assembly = g.generate_assembly(&v.instructions, final_assembly_size);
+      }
    }
 
    if (unlikely(brw->perf_debug) && shader) {
@@ -31,6 +31,7 @@
 #include "brw_context.h"
 #include "brw_vec4_gs_visitor.h"
 #include "brw_state.h"
+#include "program/prog_parameter.h"
 
 
 static bool
@@ -219,21 +220,34 @@ do_gs_prog(struct brw_context *brw,
    void *mem_ctx = ralloc_context(NULL);
    unsigned program_size;
    const unsigned *program =
-      brw_gs_emit(brw, prog, &c, mem_ctx, &program_size);
+      brw_disk_cache_load(brw, BRW_GS_PROG, prog, &gp->program.Base,
+                          &c.key, sizeof(c.key), &c.prog_data,
+                          mem_ctx, &program_size);
    if (program == NULL) {
-      ralloc_free(mem_ctx);
-      return false;
-   }
+      const GLuint num_parameters = gp->program.Base.Parameters->NumParameters;
+
+      program = brw_gs_emit(brw, prog, &c, mem_ctx, &program_size);
+      if (program == NULL) {
+         ralloc_free(mem_ctx);
+         return false;
+      }
+
+      /* Scratch space is used for register spilling */
+      if (c.base.last_scratch) {
+         perf_debug("Geometry shader triggered register spilling.  "
+                    "Try reducing the number of live vec4 values to "
+                    "improve performance.\n");
 
-   /* Scratch space is used for register spilling */
-   if (c.base.last_scratch) {
-      perf_debug("Geometry shader triggered register spilling.  "
-                 "Try reducing the number of live vec4 values to "
-                 "improve performance.\n");
+         c.prog_data.base.total_scratch
+            = brw_get_scratch_size(c.base.last_scratch*REG_SIZE);
+      }
 
-      c.prog_data.base.total_scratch
-         = brw_get_scratch_size(c.base.last_scratch*REG_SIZE);
+      brw_disk_cache_store(brw, BRW_GS_PROG, prog, &gp->program.Base,
+                           &c.key, sizeof(c.key), &c.prog_data,
+                           program, program_size, num_parameters);
+   }
 
+   if (c.prog_data.base.total_scratch) {
       brw_get_scratch_bo(brw, &stage_state->scratch_bo,
 			 c.prog_data.base.total_scratch * brw->max_gs_threads);
    }
@@ -296,10 +310,13 @@ brw_upload_gs_prog(struct brw_context *brw)
    if (!brw_search_cache(&brw->cache, BRW_GS_PROG,
                          &key, sizeof(key),
                          &stage_state->prog_offset, &brw->gs.prog_data)) {
-      bool success =
-         do_gs_prog(brw, ctx->Shader.CurrentProgram[MESA_SHADER_GEOMETRY], gp,
-                    &key);
+      struct gl_shader_program *shProg =
+         ctx->Shader.CurrentProgram[MESA_SHADER_GEOMETRY];
+      bool success = do_gs_prog(brw, shProg, gp, &key);
       assert(success);
+
+      brw_disk_cache_note_variant(brw, BRW_GS_PROG, shProg, &gp->program.Base,
+                                  &key, sizeof(key));
    }
    brw->gs.base.prog_data = &brw->gs.prog_data->base.base;
 
@@ -347,6 +364,20 @@ brw_gs_precompile(struct gl_context *ctx, struct gl_shader_program *prog)
 
    success = do_gs_prog(brw, prog, bgp, &key);
 
+   /* Also compile the variants earlier runs compiled at draw time */
+   unsigned num_variants;
+   struct brw_gs_prog_key *variants =
+      brw_disk_cache_get_variants(brw, BRW_GS_PROG, prog, &gp->Base,
+                                  sizeof(key), &num_variants);
+   for (unsigned i = 0; success && i < num_variants; i++) {
+      variants[i].base.program_string_id = bgp->id;
+      if (!brw_search_cache(&brw->cache, BRW_GS_PROG,
+                            &variants[i], sizeof(variants[i]),
+                            &brw->gs.base.prog_offset, &brw->gs.prog_data))
+         do_gs_prog(brw, prog, bgp, &variants[i]);
+   }
+   free(variants);
+
    brw->gs.base.prog_offset = old_prog_offset;
    brw->gs.prog_data = old_prog_data;
 
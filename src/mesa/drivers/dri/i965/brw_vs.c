@@ -176,6 +176,9 @@ gl_clip_plane *brw_select_clip_planes(struct gl_context *ctx)
 }
 
 
+const float brw_zero_param = 0.0f;
+
+
 bool
 brw_vs_prog_data_compare(const void *in_a, const void *in_b)
 {
@@ -241,6 +244,11 @@ do_vs_prog(struct brw_context *brw,
     */
    param_count += c.key.base.nr_userclip_plane_consts * 4;
 
+   /* The scalar backend may add rectangle texture scale factors too. */
+   if (brw->scalar_vs)
+      param_count +=
+         2 * brw->ctx.Const.Program[MESA_SHADER_VERTEX].MaxTextureImageUnits;
+
    prog_data.base.param = rzalloc_array(NULL, const float *, param_count);
    prog_data.base.pull_param = rzalloc_array(NULL, const float *, param_count);
 
@@ -287,23 +295,36 @@ do_vs_prog(struct brw_context *brw,
 			       true);
    }
 
-   /* Emit GEN4 code.
-    */
-   program = brw_vs_emit(brw, prog, &c, &prog_data, mem_ctx, &program_size);
+   program = brw_disk_cache_load(brw, BRW_VS_PROG, prog, &vp->program.Base,
+                                 &c.key, sizeof(c.key), &prog_data,
+                                 mem_ctx, &program_size);
    if (program == NULL) {
-      ralloc_free(mem_ctx);
-      return false;
-   }
+      const GLuint num_parameters = vp->program.Base.Parameters->NumParameters;
 
-   /* Scratch space is used for register spilling */
-   if (c.base.last_scratch) {
-      perf_debug("Vertex shader triggered register spilling.  "
-                 "Try reducing the number of live vec4 values to "
-                 "improve performance.\n");
+      /* Emit GEN4 code.
+       */
+      program = brw_vs_emit(brw, prog, &c, &prog_data, mem_ctx, &program_size);
+      if (program == NULL) {
+         ralloc_free(mem_ctx);
+         return false;
+      }
 
-      prog_data.base.total_scratch
-         = brw_get_scratch_size(c.base.last_scratch*REG_SIZE);
+      /* Scratch space is used for register spilling */
+      if (c.base.last_scratch) {
+         perf_debug("Vertex shader triggered register spilling.  "
+                    "Try reducing the number of live vec4 values to "
+                    "improve performance.\n");
 
+         prog_data.base.total_scratch
+            = brw_get_scratch_size(c.base.last_scratch*REG_SIZE);
+      }
+
+      brw_disk_cache_store(brw, BRW_VS_PROG, prog, &vp->program.Base,
+                           &c.key, sizeof(c.key), &prog_data,
+                           program, program_size, num_parameters);
+   }
+
+   if (prog_data.base.total_scratch) {
       brw_get_scratch_bo(brw, &brw->vs.base.scratch_bo,
 			 prog_data.base.total_scratch * brw->max_vs_threads);
    }
@@ -482,11 +503,14 @@ static void brw_upload_vs_prog(struct brw_context *brw)
    if (!brw_search_cache(&brw->cache, BRW_VS_PROG,
 			 &key, sizeof(key),
 			 &brw->vs.base.prog_offset, &brw->vs.prog_data)) {
-      bool success =
-         do_vs_prog(brw, ctx->Shader.CurrentProgram[MESA_SHADER_VERTEX], vp,
-                    &key);
+      struct gl_shader_program *prog =
+         ctx->Shader.CurrentProgram[MESA_SHADER_VERTEX];
+      bool success = do_vs_prog(brw, prog, vp, &key);
       (void) success;
       assert(success);
+
+      brw_disk_cache_note_variant(brw, BRW_VS_PROG, prog, &vp->program.Base,
+                                  &key, sizeof(key));
    }
    brw->vs.base.prog_data = &brw->vs.prog_data->base.base;
 
@@ -540,6 +564,20 @@ brw_vs_precompile(struct gl_context *ctx, struct gl_shader_program *prog)
 
    success = do_vs_prog(brw, prog, bvp, &key);
 
+   /* Also compile the variants earlier runs compiled at draw time */
+   unsigned num_variants;
+   struct brw_vs_prog_key *variants =
+      brw_disk_cache_get_variants(brw, BRW_VS_PROG, prog, &vp->Base,
+                                  sizeof(key), &num_variants);
+   for (unsigned i = 0; success && i < num_variants; i++) {
+      variants[i].base.program_string_id = bvp->id;
+      if (!brw_search_cache(&brw->cache, BRW_VS_PROG,
+                            &variants[i], sizeof(variants[i]),
+                            &brw->vs.base.prog_offset, &brw->vs.prog_data))
+         do_vs_prog(brw, prog, bvp, &variants[i]);
+   }
+   free(variants);
+
    brw->vs.base.prog_offset = old_prog_offset;
    brw->vs.prog_data = old_prog_data;
 
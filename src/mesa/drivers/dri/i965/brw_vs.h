@@ -89,6 +89,12 @@ const unsigned *brw_vs_emit(struct brw_context *brw,
                             struct brw_vs_prog_data *prog_data,
                             void *mem_ctx,
                             unsigned *program_size);
+const unsigned *brw_vs_emit_scalar(struct brw_context *brw,
+                                   struct gl_shader_program *prog,
+                                   struct brw_vs_compile *c,
+                                   struct brw_vs_prog_data *prog_data,
+                                   void *mem_ctx,
+                                   unsigned *program_size);
 bool brw_vs_precompile(struct gl_context *ctx, struct gl_shader_program *prog);
 void brw_vs_debug_recompile(struct brw_context *brw,
                             struct gl_shader_program *prog,
@@ -187,18 +187,31 @@ bool do_wm_prog(struct brw_context *brw,
                                            c->key.persample_shading,
                                            &fp->program);
 
-   program = brw_wm_fs_emit(brw, c, &fp->program, prog, &program_size);
-   if (program == NULL)
-      return false;
-
-   /* Scratch space is used for register spilling */
-   if (c->last_scratch) {
-      perf_debug("Fragment shader triggered register spilling.  "
-                 "Try reducing the number of live scalar values to "
-                 "improve performance.\n");
+   program = brw_disk_cache_load(brw, BRW_WM_PROG, prog, &fp->program.Base,
+                                 &c->key, sizeof(c->key), &c->prog_data,
+                                 c, &program_size);
+   if (program == NULL) {
+      const GLuint num_parameters = fp->program.Base.Parameters->NumParameters;
+
+      program = brw_wm_fs_emit(brw, c, &fp->program, prog, &program_size);
+      if (program == NULL)
+         return false;
+
+      /* Scratch space is used for register spilling */
+      if (c->last_scratch) {
+         perf_debug("Fragment shader triggered register spilling.  "
+                    "Try reducing the number of live scalar values to "
+                    "improve performance.\n");
+
+         c->prog_data.total_scratch = brw_get_scratch_size(c->last_scratch);
+      }
 
-      c->prog_data.total_scratch = brw_get_scratch_size(c->last_scratch);
+      brw_disk_cache_store(brw, BRW_WM_PROG, prog, &fp->program.Base,
+                           &c->key, sizeof(c->key), &c->prog_data,
+                           program, program_size, num_parameters);
+   }
 
+   if (c->prog_data.total_scratch) {
       brw_get_scratch_bo(brw, &brw->wm.base.scratch_bo,
 			 c->prog_data.total_scratch * brw->max_wm_threads);
    }
@@ -586,10 +599,13 @@ brw_upload_wm_prog(struct brw_context *brw)
    if (!brw_search_cache(&brw->cache, BRW_WM_PROG,
 			 &key, sizeof(key),
 			 &brw->wm.base.prog_offset, &brw->wm.prog_data)) {
-      bool success = do_wm_prog(brw, ctx->Shader._CurrentFragmentProgram, fp,
-				&key);
+      struct gl_shader_program *prog = ctx->Shader._CurrentFragmentProgram;
+      bool success = do_wm_prog(brw, prog, fp, &key);
       (void) success;
       assert(success);
+
+      brw_disk_cache_note_variant(brw, BRW_WM_PROG, prog, &fp->program.Base,
+                                  &key, sizeof(key));
    }
    brw->wm.base.prog_data = &brw->wm.prog_data->base;
 }
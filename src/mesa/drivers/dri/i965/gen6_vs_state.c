@@ -79,7 +79,10 @@ gen6_upload_vec4_push_constants(struct brw_context *brw,
 	 }
       }
 
-      stage_state->push_const_size = (params_uploaded + 1) / 2;
+      /* The scalar VS packs its uniforms, so nr_params needn't be a
+       * multiple of 4.
+       */
+      stage_state->push_const_size = ALIGN(prog_data->nr_params, 8) / 8;
       /* We can only push 32 registers of constants at a time. */
       assert(stage_state->push_const_size <= 32);
    }
@@ -863,13 +863,18 @@ gen7_blorp_exec(struct brw_context *brw,
    uint32_t sampler_offset = 0;
 
    uint32_t prog_offset = params->get_wm_prog(brw, &prog_data);
-   gen6_emit_3dstate_multisample(brw, params->dst.num_samples);
-   gen6_emit_3dstate_sample_mask(brw,
-                                 params->dst.num_samples > 1 ?
-                                 (1 << params->dst.num_samples) - 1 : 1);
-   gen6_blorp_emit_state_base_address(brw, params);
+   const bool emit_invariant_state =
+      brw_blorp_emit_invariant_state(brw, params);
+   if (emit_invariant_state) {
+      gen6_emit_3dstate_multisample(brw, params->dst.num_samples);
+      gen6_emit_3dstate_sample_mask(brw,
+                                    params->dst.num_samples > 1 ?
+                                    (1 << params->dst.num_samples) - 1 : 1);
+      gen6_blorp_emit_state_base_address(brw, params);
+   }
    gen6_blorp_emit_vertices(brw, params);
-   gen7_blorp_emit_urb_config(brw, params);
+   if (emit_invariant_state)
+      gen7_blorp_emit_urb_config(brw, params);
    if (params->use_wm_prog) {
       cc_blend_state_offset = gen6_blorp_emit_blend_state(brw, params);
       cc_state_offset = gen6_blorp_emit_cc_state(brw, params);
@@ -901,13 +906,15 @@ gen7_blorp_exec(struct brw_context *brw,
                                        wm_surf_offset_texture);
       sampler_offset = gen7_blorp_emit_sampler_state(brw, params);
    }
-   gen7_blorp_emit_vs_disable(brw, params);
-   gen7_blorp_emit_hs_disable(brw, params);
-   gen7_blorp_emit_te_disable(brw, params);
-   gen7_blorp_emit_ds_disable(brw, params);
-   gen7_blorp_emit_gs_disable(brw, params);
-   gen7_blorp_emit_streamout_disable(brw, params);
-   gen6_blorp_emit_clip_disable(brw, params);
+   if (emit_invariant_state) {
+      gen7_blorp_emit_vs_disable(brw, params);
+      gen7_blorp_emit_hs_disable(brw, params);
+      gen7_blorp_emit_te_disable(brw, params);
+      gen7_blorp_emit_ds_disable(brw, params);
+      gen7_blorp_emit_gs_disable(brw, params);
+      gen7_blorp_emit_streamout_disable(brw, params);
+      gen6_blorp_emit_clip_disable(brw, params);
+   }
    gen7_blorp_emit_sf_config(brw, params);
    gen7_blorp_emit_wm_config(brw, params, prog_data);
    if (params->use_wm_prog) {
@@ -919,7 +926,8 @@ gen7_blorp_exec(struct brw_context *brw,
       gen7_blorp_emit_constant_ps_disable(brw, params);
    }
    gen7_blorp_emit_ps_config(brw, params, prog_offset, prog_data);
-   gen7_blorp_emit_cc_viewport(brw, params);
+   if (emit_invariant_state)
+      gen7_blorp_emit_cc_viewport(brw, params);
 
    if (params->depth.mt)
       gen7_blorp_emit_depth_stencil_config(brw, params);
@@ -41,7 +41,16 @@ gen8_fs_generator::gen8_fs_generator(struct brw_context *brw,
                                      struct gl_fragment_program *fp,
                                      bool dual_source_output)
    : gen8_generator(brw, shader_prog, fp ? &fp->Base : NULL, c), c(c), fp(fp),
-     dual_source_output(dual_source_output)
+     vp(NULL), dual_source_output(dual_source_output), debug_flag(DEBUG_WM)
+{
+}
+
+gen8_fs_generator::gen8_fs_generator(struct brw_context *brw,
+                                     struct brw_wm_compile *c,
+                                     struct gl_shader_program *shader_prog,
+                                     struct gl_vertex_program *vp)
+   : gen8_generator(brw, shader_prog, &vp->Base, c), c(c), fp(NULL),
+     vp(vp), dual_source_output(false), debug_flag(DEBUG_VS)
 {
 }
 
@@ -129,6 +138,20 @@ gen8_fs_generator::generate_fb_write(fs_inst *ir)
    mark_surface_used(surf_index);
 }
 
+void
+gen8_fs_generator::generate_urb_write(fs_inst *ir)
+{
+   assert(vp);
+
+   gen8_instruction *inst = next_inst(BRW_OPCODE_SEND);
+   gen8_set_urb_message(brw, inst,
+                        BRW_URB_WRITE_SIMD8 |
+                        (ir->eot ? BRW_URB_WRITE_EOT : BRW_URB_WRITE_NO_FLAGS),
+                        ir->mlen, 0, ir->offset, false);
+   gen8_set_dst(brw, inst, brw_null_reg());
+   gen8_set_src0(brw, inst, brw_message_reg(ir->base_mrf));
+}
+
 void
 gen8_fs_generator::generate_linterp(fs_inst *inst,
                                     struct brw_reg dst,
@@ -589,8 +612,11 @@ gen8_fs_generator::generate_code(exec_list *instructions)
    const char *last_annotation_string = NULL;
    const void *last_annotation_ir = NULL;
 
-   if (unlikely(INTEL_DEBUG & DEBUG_WM)) {
-      if (prog) {
+   if (unlikely(INTEL_DEBUG & debug_flag)) {
+      if (vp) {
+         printf("Native code for scalar vertex shader %d:\n",
+                shader_prog->Name);
+      } else if (prog) {
          printf("Native code for fragment shader %d (SIMD%d dispatch):\n",
                 shader_prog->Name, dispatch_width);
       } else if (fp) {
@@ -603,14 +629,14 @@ gen8_fs_generator::generate_code(exec_list *instructions)
    }
 
    cfg_t *cfg = NULL;
-   if (unlikely(INTEL_DEBUG & DEBUG_WM))
+   if (unlikely(INTEL_DEBUG & debug_flag))
       cfg = new(mem_ctx) cfg_t(instructions);
 
    foreach_list(node, instructions) {
       fs_inst *ir = (fs_inst *) node;
       struct brw_reg src[3], dst;
 
-      if (unlikely(INTEL_DEBUG & DEBUG_WM)) {
+      if (unlikely(INTEL_DEBUG & debug_flag)) {
          foreach_list(node, &cfg->block_list) {
             bblock_link *link = (bblock_link *)node;
             bblock_t *block = link->block;
@@ -932,6 +958,10 @@ gen8_fs_generator::generate_code(exec_list *instructions)
          generate_fb_write(ir);
          break;
 
+      case SHADER_OPCODE_URB_WRITE_SIMD8:
+         generate_urb_write(ir);
+         break;
+
       case FS_OPCODE_MOV_DISPATCH_TO_FLAGS:
          generate_mov_dispatch_to_flags(ir);
          break;
@@ -990,7 +1020,7 @@ gen8_fs_generator::generate_code(exec_list *instructions)
          abort();
       }
 
-      if (unlikely(INTEL_DEBUG & DEBUG_WM)) {
+      if (unlikely(INTEL_DEBUG & debug_flag)) {
          disassemble(stdout, last_native_inst_offset, next_inst_offset);
 
          foreach_list(node, &cfg->block_list) {
@@ -1013,7 +1043,7 @@ gen8_fs_generator::generate_code(exec_list *instructions)
       last_native_inst_offset = next_inst_offset;
    }
 
-   if (unlikely(INTEL_DEBUG & DEBUG_WM)) {
+   if (unlikely(INTEL_DEBUG & debug_flag)) {
       printf("\n");
    }
 
@@ -381,7 +381,9 @@ gen8_set_urb_message(const struct brw_context *brw,
                                msg_length, response_length,
                                true, flags & BRW_URB_WRITE_EOT);
    gen8_set_src0(brw, inst, brw_vec8_grf(GEN7_MRF_HACK_START + 1, 0));
-   if (flags & BRW_URB_WRITE_OWORD) {
+   if (flags & BRW_URB_WRITE_SIMD8) {
+      gen8_set_urb_opcode(inst, GEN8_URB_OPCODE_SIMD8_WRITE);
+   } else if (flags & BRW_URB_WRITE_OWORD) {
       assert(msg_length == 2);
       gen8_set_urb_opcode(inst, BRW_URB_OPCODE_WRITE_OWORD);
    } else {
@@ -109,6 +109,7 @@ upload_vs_state(struct brw_context *brw)
 
    OUT_BATCH(((brw->max_vs_threads - 1) << HSW_VS_MAX_THREADS_SHIFT) |
              GEN6_VS_STATISTICS_ENABLE |
+             (brw->vs.prog_data->simd8 ? GEN8_VS_SIMD8_ENABLE : 0) |
              GEN6_VS_ENABLE);
 
    /* _NEW_TRANSFORM */
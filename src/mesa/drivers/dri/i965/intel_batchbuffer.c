@@ -78,19 +78,71 @@ intel_batchbuffer_init(struct brw_context *brw)
    }
 }
 
+/**
+ * Hands a submitted batch BO, and our reference to it, over to the pool.
+ */
+static void
+intel_batchbuffer_pool_put(struct brw_context *brw, drm_intel_bo *bo)
+{
+   struct intel_batchbuffer *batch = &brw->batch;
+
+   if (batch->pool_count == ARRAY_SIZE(batch->pool)) {
+      drm_intel_bo_unreference(batch->pool[0]);
+      memmove(&batch->pool[0], &batch->pool[1],
+              (batch->pool_count - 1) * sizeof(batch->pool[0]));
+      batch->pool_count--;
+   }
+
+   batch->pool[batch->pool_count++] = bo;
+}
+
+/**
+ * Returns a BO for a new batch: the oldest one of the pool if the GPU is
+ * done with it, so that we don't go through the allocator for every batch,
+ * and a new one otherwise.
+ */
+static drm_intel_bo *
+intel_batchbuffer_pool_get(struct brw_context *brw)
+{
+   struct intel_batchbuffer *batch = &brw->batch;
+   drm_intel_bo *bo;
+
+   if (batch->pool_count == 0 || drm_intel_bo_busy(batch->pool[0]))
+      return drm_intel_bo_alloc(brw->bufmgr, "batchbuffer", BATCH_SZ, 4096);
+
+   bo = batch->pool[0];
+   memmove(&batch->pool[0], &batch->pool[1],
+           (batch->pool_count - 1) * sizeof(batch->pool[0]));
+   batch->pool_count--;
+
+   /* Drop the relocations of its last use, and with them the references
+    * to the buffers it used.
+    */
+   drm_intel_gem_bo_clear_relocs(bo, 0);
+
+   /* Throttling on it would wait for the new batch rather than the old
+    * one, which is idle anyway.
+    */
+   if (brw->first_post_swapbuffers_batch == bo) {
+      drm_intel_bo_unreference(brw->first_post_swapbuffers_batch);
+      brw->first_post_swapbuffers_batch = NULL;
+   }
+
+   return bo;
+}
+
 static void
 intel_batchbuffer_reset(struct brw_context *brw)
 {
    if (brw->batch.last_bo != NULL) {
-      drm_intel_bo_unreference(brw->batch.last_bo);
+      intel_batchbuffer_pool_put(brw, brw->batch.last_bo);
       brw->batch.last_bo = NULL;
    }
    brw->batch.last_bo = brw->batch.bo;
 
    intel_batchbuffer_clear_cache(brw);
 
-   brw->batch.bo = drm_intel_bo_alloc(brw->bufmgr, "batchbuffer",
-					BATCH_SZ, 4096);
+   brw->batch.bo = intel_batchbuffer_pool_get(brw);
    if (brw->has_llc) {
       drm_intel_bo_map(brw->batch.bo, true);
       brw->batch.map = brw->batch.bo->virtual;
@@ -133,7 +185,11 @@ intel_batchbuffer_reset_to_saved(struct brw_context *brw)
 void
 intel_batchbuffer_free(struct brw_context *brw)
 {
+   unsigned i;
+
    free(brw->batch.cpu_map);
+   for (i = 0; i < brw->batch.pool_count; i++)
+      drm_intel_bo_unreference(brw->batch.pool[i]);
    drm_intel_bo_unreference(brw->batch.last_bo);
    drm_intel_bo_unreference(brw->batch.bo);
    drm_intel_bo_unreference(brw->batch.workaround_bo);
@@ -206,6 +262,9 @@ brw_new_batch(struct brw_context *brw)
 
    brw->state.dirty.brw |= BRW_NEW_BATCH;
 
+   /* BLORP operations have to emit all their state to the new batch. */
+   brw->blorp.invariant_state_valid = false;
+
    /* Assume that the last command before the start of our batch was a
     * primitive, for safety.
     */
@@ -35,6 +35,7 @@ extern int INTEL_DEBUG;
 
 #define DEBUG_TEXTURE	  0x1
 #define DEBUG_STATE	  0x2
+#define DEBUG_CACHE	  0x4
 #define DEBUG_BLIT	  0x8
 #define DEBUG_MIPTREE     0x10
 #define DEBUG_PERF	  0x20
@@ -1482,6 +1482,9 @@ intel_miptree_all_slices_resolve(struct brw_context *brw,
    bool did_resolve = false;
    struct intel_resolve_map *i, *next;
 
+   /* Resolve all the slices in one group of BLORP operations. */
+   brw_blorp_begin_group(brw);
+
    for (i = mt->hiz_map.next; i; i = next) {
       next = i->next;
       if (i->need != need)
@@ -1492,6 +1495,8 @@ intel_miptree_all_slices_resolve(struct brw_context *brw,
       did_resolve = true;
    }
 
+   brw_blorp_end_group(brw);
+
    return did_resolve;
 }
 
@@ -1891,12 +1896,9 @@ intel_miptree_map_movntdqa(struct brw_context *brw,
 
    assert((((uintptr_t) map->ptr) & 15) == misalignment);
 
-   for (uint32_t y = 0; y < map->h; y++) {
-      void *dst_ptr = map->ptr + y * map->stride;
-      void *src_ptr = src + y * mt->region->pitch;
-
-      _mesa_streaming_load_memcpy(dst_ptr, src_ptr, width_bytes);
-   }
+   _mesa_streaming_load_memcpy_2d(map->ptr, map->stride,
+                                  src, mt->region->pitch,
+                                  width_bytes, map->h);
 
    intel_miptree_unmap_raw(brw, mt);
 }
@@ -44,6 +44,8 @@
 #include "intel_regions.h"
 #include "intel_pixel.h"
 #include "intel_buffer_objects.h"
+#include "intel_batchbuffer.h"
+#include "intel_tiled_memcpy.h"
 
 #define FILE_DEBUG_FLAG DEBUG_PIXEL
 
@@ -155,6 +157,133 @@ do_blit_readpixels(struct gl_context * ctx,
    return true;
 }
 
+/**
+ * \brief A fast path for glReadPixels
+ *
+ * This fast path is taken when the source format is BGRA, RGBA,
+ * A or L and when the renderbuffer memory is X- or Y-tiled.  Like
+ * intel_texsubimage_tiled_memcpy(), it maps the buffer without a GTT fence,
+ * acquiring a tiled view of the memory, and copies successive spans within
+ * each tile to the linear client memory.
+ *
+ * This avoids fencing and reading back the renderbuffer through the GTT,
+ * which is uncached, and the detour through the generic readpixels code.
+ * The mapping is cacheable on LLC parts, so no streaming loads are needed.
+ */
+static bool
+intel_readpixels_tiled_memcpy(struct gl_context * ctx,
+                              GLint x, GLint y,
+                              GLsizei width, GLsizei height,
+                              GLenum format, GLenum type,
+                              GLvoid * pixels,
+                              const struct gl_pixelstore_attrib *pack)
+{
+   struct brw_context *brw = brw_context(ctx);
+   struct gl_renderbuffer *rb = ctx->ReadBuffer->_ColorReadBuffer;
+   struct intel_renderbuffer *irb = intel_renderbuffer(rb);
+   struct gl_pixelstore_attrib clipped_pack = *pack;
+   struct intel_mipmap_tree *mt;
+   drm_intel_bo *bo;
+   GLuint image_x, image_y;
+   uint32_t tx0, ty0;
+   ptrdiff_t dst_pitch;
+   char *dst;
+   bool flip;
+
+   uint32_t cpp;
+   mem_copy_fn mem_copy = NULL;
+
+   if (!brw->has_llc ||
+       pixels == NULL ||
+       _mesa_is_bufferobj(pack->BufferObj) ||
+       pack->SwapBytes ||
+       pack->LsbFirst ||
+       ctx->_ImageTransferState)
+      return false;
+
+   if (!irb || !irb->mt)
+      return false;
+
+   mt = irb->mt;
+
+   /* The algorithm is written only for X- or Y-tiled memory, and doesn't
+    * downsample.
+    */
+   if (mt->num_samples > 1 ||
+       (mt->region->tiling != I915_TILING_X &&
+        mt->region->tiling != I915_TILING_Y))
+      return false;
+
+   if (mt->format != rb->Format ||
+       !intel_get_memcpy(rb->Format, format, type, &mem_copy, &cpp,
+                         INTEL_DOWNLOAD))
+      return false;
+
+   if (!_mesa_clip_readpixels(ctx, &x, &y, &width, &height, &clipped_pack))
+      return true;
+
+   /* Since we are going to read raw data from the miptree, we need to
+    * resolve any pending fast color clears before we start.
+    */
+   intel_miptree_resolve_color(brw, mt);
+
+   bo = mt->region->bo;
+
+   if (drm_intel_bo_references(brw->batch.bo, bo)) {
+      perf_debug("Flushing before mapping a referenced bo.\n");
+      intel_batchbuffer_flush(brw);
+   }
+
+   if (brw_bo_map(brw, bo, false /* write enable */, "miptree") ||
+       bo->virtual == NULL) {
+      DBG("%s: failed to map bo\n", __FUNCTION__);
+      return false;
+   }
+
+   DBG("%s: x,y=(%d,%d) (w,h)=(%d,%d) format=0x%x type=0x%x "
+       "mesa_format=0x%x tiling=%d "
+       "pack=(alignment=%d row_length=%d skip_pixels=%d skip_rows=%d)\n",
+       __FUNCTION__, x, y, width, height,
+       format, type, rb->Format, mt->region->tiling,
+       pack->Alignment, pack->RowLength, pack->SkipPixels,
+       pack->SkipRows);
+
+   intel_miptree_get_image_offset(mt, irb->mt_level, irb->mt_layer,
+                                  &image_x, &image_y);
+
+   /* Window system buffers are stored top to bottom, so the rows come out
+    * of the miptree in the opposite order and need a negative pitch.
+    * pack->Invert is already accounted for by the packing helpers.
+    */
+   flip = _mesa_is_winsys_fbo(ctx->ReadBuffer);
+
+   tx0 = image_x + x;
+   ty0 = image_y + (flip ? rb->Height - y - height : y);
+
+   dst = (char *) _mesa_image_address2d(&clipped_pack, pixels, width, height,
+                                        format, type, 0, 0);
+   dst_pitch = _mesa_image_row_stride(&clipped_pack, width, format, type);
+
+   if (flip) {
+      dst += (height - 1) * dst_pitch;
+      dst_pitch = -dst_pitch;
+   }
+
+   tiled_to_linear(
+      tx0 * cpp, (tx0 + width) * cpp,
+      ty0, ty0 + height,
+      dst - (ptrdiff_t) ty0 * dst_pitch - (ptrdiff_t) tx0 * cpp,
+      bo->virtual,
+      dst_pitch, mt->region->pitch,
+      brw->has_swizzling,
+      mt->region->tiling,
+      mem_copy
+   );
+
+   drm_intel_bo_unmap(bo);
+   return true;
+}
+
 void
 intelReadPixels(struct gl_context * ctx,
                 GLint x, GLint y, GLsizei width, GLsizei height,
@@ -190,6 +319,12 @@ intelReadPixels(struct gl_context * ctx,
    if (ctx->NewState)
       _mesa_update_state(ctx);
 
+   if (intel_readpixels_tiled_memcpy(ctx, x, y, width, height,
+                                     format, type, pixels, pack)) {
+      brw->front_buffer_dirty = dirty;
+      return;
+   }
+
    _mesa_readpixels(ctx, x, y, width, height, format, type, pack, pixels);
 
    /* There's an intel_prepare_render() call in intelSpanRenderStart(). */
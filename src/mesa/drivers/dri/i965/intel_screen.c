@@ -102,6 +102,7 @@ DRI_CONF_END
 #include "intel_regions.h"
 
 #include "brw_context.h"
+#include "brw_state.h"
 
 #include "i915_drm.h"
 
@@ -947,6 +948,7 @@ intelDestroyScreen(__DRIscreen * sPriv)
 {
    struct intel_screen *intelScreen = sPriv->driverPrivate;
 
+   brw_destroy_shared_cache(intelScreen);
    dri_bufmgr_destroy(intelScreen->bufmgr);
    driDestroyOptionInfo(&intelScreen->optionCache);
 
@@ -1337,6 +1339,8 @@ __DRIconfig **intelInitScreen2(__DRIscreen *psp)
 
    set_max_gl_versions(intelScreen);
 
+   brw_init_shared_cache(intelScreen);
+
    /* Notification of GPU resets requires hardware contexts and a kernel new
     * enough to support DRM_IOCTL_I915_GET_RESET_STATS.  If the ioctl is
     * supported, calling it with a context of 0 will either generate EPERM or
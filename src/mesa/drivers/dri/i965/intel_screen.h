@@ -62,6 +62,11 @@ struct intel_screen
     */
    unsigned program_id;
 
+   /**
+    * Kernels shared by all contexts, see brw_search_shared_cache().
+    */
+   struct brw_shared_cache *kernel_cache;
+
    /**
    * Configuration cache with default values for all contexts
    */
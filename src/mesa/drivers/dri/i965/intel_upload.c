@@ -45,133 +45,151 @@
 
 #define INTEL_UPLOAD_SIZE (64*1024)
 
+/**
+ * Smallest intel_upload_data() size worth looking up in the recent uploads.
+ * Below this, comparing against an earlier upload saves next to nothing.
+ */
+#define INTEL_UPLOAD_REUSE_MIN_SIZE 256
+
 void
 intel_upload_finish(struct brw_context *brw)
 {
    if (!brw->upload.bo)
       return;
 
-   if (brw->upload.buffer_len) {
-      drm_intel_bo_subdata(brw->upload.bo,
-                           brw->upload.buffer_offset,
-                           brw->upload.buffer_len,
-                           brw->upload.buffer);
-      brw->upload.buffer_len = 0;
-   }
-
+   drm_intel_bo_unmap(brw->upload.bo);
    drm_intel_bo_unreference(brw->upload.bo);
    brw->upload.bo = NULL;
+   brw->upload.map = NULL;
+   brw->upload.next_offset = 0;
+   memset(brw->upload.recent, 0, sizeof(brw->upload.recent));
 }
 
-static void
-wrap_buffers(struct brw_context *brw, GLuint size)
-{
-   intel_upload_finish(brw);
-
-   if (size < INTEL_UPLOAD_SIZE)
-      size = INTEL_UPLOAD_SIZE;
-
-   brw->upload.bo = drm_intel_bo_alloc(brw->bufmgr, "upload", size, 0);
-   brw->upload.offset = 0;
-}
-
-void
-intel_upload_data(struct brw_context *brw,
-                  const void *ptr, GLuint size, GLuint align,
-                  drm_intel_bo **return_bo,
-                  GLuint *return_offset)
+/**
+ * Interface for getting memory for uploading streamed data to the GPU
+ *
+ * In most cases, streamed data (for GPU state structures, for example) is
+ * uploaded through brw_state_batch(), since that interface allows relocations
+ * from the streamed space returned to other BOs.  However, that interface has
+ * the restriction that the amount of space allocated has to be "small".
+ *
+ * This interface, on the other hand, is able to handle arbitrary sized
+ * allocation requests, though it will batch small allocations into the same
+ * BO for efficiency and reduced memory footprint.
+ *
+ * The upload BO stays mapped until it is retired at the next batch flush,
+ * so the data is written straight into it: through a cached CPU mapping on
+ * LLC parts and a write-combined GTT mapping otherwise.
+ *
+ * \note The returned pointer is valid only until intel_upload_finish(), which
+ * will happen at batch flush or the next
+ * intel_upload_space()/intel_upload_data().
+ *
+ * \param out_bo Set to the BO the data will land in, with a new reference
+ * the caller has to drop.
+ *
+ * \param out_offset Offset within the buffer object that the data will land.
+ */
+void *
+intel_upload_space(struct brw_context *brw,
+                   uint32_t size,
+                   uint32_t alignment,
+                   drm_intel_bo **out_bo,
+                   uint32_t *out_offset)
 {
-   GLuint base, delta;
+   uint32_t offset;
 
-   base = (brw->upload.offset + align - 1) / align * align;
-   if (brw->upload.bo == NULL || base + size > brw->upload.bo->size) {
-      wrap_buffers(brw, size);
-      base = 0;
+   offset = (brw->upload.next_offset + alignment - 1) / alignment * alignment;
+   if (brw->upload.bo && offset + size > brw->upload.bo->size) {
+      intel_upload_finish(brw);
+      offset = 0;
    }
 
-   drm_intel_bo_reference(brw->upload.bo);
-   *return_bo = brw->upload.bo;
-   *return_offset = base;
-
-   delta = base - brw->upload.offset;
-   if (brw->upload.buffer_len &&
-       brw->upload.buffer_len + delta + size > sizeof(brw->upload.buffer)) {
-      drm_intel_bo_subdata(brw->upload.bo,
-                           brw->upload.buffer_offset,
-                           brw->upload.buffer_len,
-                           brw->upload.buffer);
-      brw->upload.buffer_len = 0;
+   if (!brw->upload.bo) {
+      brw->upload.bo = drm_intel_bo_alloc(brw->bufmgr, "streamed data",
+                                          MAX2(INTEL_UPLOAD_SIZE, size), 4096);
+      if (brw->has_llc)
+         drm_intel_bo_map(brw->upload.bo, true);
+      else
+         drm_intel_gem_bo_map_gtt(brw->upload.bo);
+      brw->upload.map = brw->upload.bo->virtual;
    }
 
-   if (size < sizeof(brw->upload.buffer)) {
-      if (brw->upload.buffer_len == 0)
-         brw->upload.buffer_offset = base;
-      else
-         brw->upload.buffer_len += delta;
+   brw->upload.next_offset = offset + size;
 
-      memcpy(brw->upload.buffer + brw->upload.buffer_len, ptr, size);
-      brw->upload.buffer_len += size;
-   } else {
-      drm_intel_bo_subdata(brw->upload.bo, base, size, ptr);
-   }
+   drm_intel_bo_reference(brw->upload.bo);
+   *out_bo = brw->upload.bo;
+   *out_offset = offset;
 
-   brw->upload.offset = base + size;
+   return brw->upload.map + offset;
 }
 
-void *
-intel_upload_map(struct brw_context *brw, GLuint size, GLuint align)
+/**
+ * Look for an earlier upload of the same client memory to the current upload
+ * BO, and check that the memory hasn't changed since.  Comparing against the
+ * copy is exact, unlike a hash, and only reads memory.
+ *
+ * Only used on LLC parts, where the upload BO is mapped cached; reading back
+ * through the write-combined GTT mapping would cost more than the upload.
+ */
+static bool
+find_recent_upload(struct brw_context *brw,
+                   const void *ptr, uint32_t size, uint32_t alignment,
+                   uint32_t *out_offset)
 {
-   GLuint base, delta;
-   char *ptr;
+   unsigned i;
 
-   base = (brw->upload.offset + align - 1) / align * align;
-   if (brw->upload.bo == NULL || base + size > brw->upload.bo->size) {
-      wrap_buffers(brw, size);
-      base = 0;
-   }
-
-   delta = base - brw->upload.offset;
-   if (brw->upload.buffer_len &&
-       brw->upload.buffer_len + delta + size > sizeof(brw->upload.buffer)) {
-      drm_intel_bo_subdata(brw->upload.bo,
-                           brw->upload.buffer_offset,
-                           brw->upload.buffer_len,
-                           brw->upload.buffer);
-      brw->upload.buffer_len = 0;
-   }
+   if (!brw->upload.bo)
+      return false;
 
-   if (size <= sizeof(brw->upload.buffer)) {
-      if (brw->upload.buffer_len == 0)
-         brw->upload.buffer_offset = base;
-      else
-         brw->upload.buffer_len += delta;
+   for (i = 0; i < ARRAY_SIZE(brw->upload.recent); i++) {
+      const struct intel_upload_range *recent = &brw->upload.recent[i];
 
-      ptr = brw->upload.buffer + brw->upload.buffer_len;
-      brw->upload.buffer_len += size;
-   } else {
-      ptr = malloc(size);
+      if (recent->ptr == ptr && recent->size == size &&
+          recent->offset % alignment == 0 &&
+          memcmp(brw->upload.map + recent->offset, ptr, size) == 0) {
+         *out_offset = recent->offset;
+         return true;
+      }
    }
 
-   return ptr;
+   return false;
 }
 
+/**
+ * Handy interface to upload some data to temporary GPU memory quickly.
+ *
+ * References to this memory should not be retained across batch flushes.
+ *
+ * Uploading the same client memory again within a batch, unchanged, as
+ * multi-pass rendering from client arrays does, reuses the earlier copy.
+ */
 void
-intel_upload_unmap(struct brw_context *brw,
-                   const void *ptr, GLuint size, GLuint align,
-                   drm_intel_bo **return_bo,
-                   GLuint *return_offset)
+intel_upload_data(struct brw_context *brw,
+                  const void *data,
+                  uint32_t size,
+                  uint32_t alignment,
+                  drm_intel_bo **out_bo,
+                  uint32_t *out_offset)
 {
-   GLuint base;
+   const bool reuse = brw->has_llc && size >= INTEL_UPLOAD_REUSE_MIN_SIZE;
+   struct intel_upload_range *recent;
+   void *dst;
 
-   base = (brw->upload.offset + align - 1) / align * align;
-   if (size > sizeof(brw->upload.buffer)) {
-      drm_intel_bo_subdata(brw->upload.bo, base, size, ptr);
-      free((void*)ptr);
+   if (reuse && find_recent_upload(brw, data, size, alignment, out_offset)) {
+      drm_intel_bo_reference(brw->upload.bo);
+      *out_bo = brw->upload.bo;
+      return;
    }
 
-   drm_intel_bo_reference(brw->upload.bo);
-   *return_bo = brw->upload.bo;
-   *return_offset = base;
+   dst = intel_upload_space(brw, size, alignment, out_bo, out_offset);
+   memcpy(dst, data, size);
 
-   brw->upload.offset = base + size;
+   if (reuse) {
+      recent = &brw->upload.recent[brw->upload.recent_next++ %
+                                   ARRAY_SIZE(brw->upload.recent)];
+      recent->ptr = data;
+      recent->size = size;
+      recent->offset = *out_offset;
+   }
 }
@@ -81,6 +81,15 @@ void r200EmitArrays( struct gl_context *ctx, GLubyte *vimap_rev )
    GLuint vfmt0 = 0, vfmt1 = 0;
    GLuint count = VB->Count;
    GLuint i, emitsize;
+   int bytes = 0;
+
+   /* Upload all the arrays to the same DMA buffer */
+   for ( i = 0; i < 15; i++ ) {
+      if (vimap_rev[i] != 255)
+	 bytes += radeon_dma_vector_bytes(4, VB->AttribPtr[vimap_rev[i]]->stride,
+					  count);
+   }
+   radeonReserveDmaSpace(&rmesa->radeon, bytes);
 
    //   fprintf(stderr,"emit arrays\n");
    for ( i = 0; i < 15; i++ ) {
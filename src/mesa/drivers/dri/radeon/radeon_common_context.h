@@ -332,7 +332,7 @@ static INLINE GLuint radeonPackColor(GLuint cpp,
 
 #define MAX_CMD_BUF_SZ (16*1024)
 
-#define MAX_DMA_BUF_SZ (64*1024)
+#define MAX_DMA_BUF_SZ (256*1024)
 
 struct radeon_store {
 	GLuint statenr;
@@ -209,6 +209,17 @@ void radeon_init_dma(radeonContextPtr rmesa)
 	rmesa->dma.minimum_size = MAX_DMA_BUF_SZ;
 }
 
+static int radeon_bo_is_idle(struct radeon_bo* bo)
+{
+	uint32_t domain;
+	int ret = radeon_bo_is_busy(bo, &domain);
+	if (ret == -EINVAL) {
+		WARN_ONCE("Your libdrm or kernel doesn't have support for busy query.\n"
+			"This may cause small performance drop for you.\n");
+	}
+	return ret != -EBUSY;
+}
+
 void radeonRefillCurrentDmaRegion(radeonContextPtr rmesa, int size)
 {
 	struct radeon_dma_bo *dma_bo = NULL;
@@ -220,6 +231,20 @@ void radeonRefillCurrentDmaRegion(radeonContextPtr rmesa, int size)
 	radeon_print(RADEON_DMA, RADEON_NORMAL, "%s size %d minimum_size %Zi\n",
 			__FUNCTION__, size, rmesa->dma.minimum_size);
 
+	/* Recycle the oldest waiting buffer as soon as the GPU is done with
+	   it, rather than allocating a new one until the next flush moves
+	   it to the free list. */
+	if (is_empty_list(&rmesa->dma.free) && !is_empty_list(&rmesa->dma.wait)) {
+		dma_bo = first_elem(&rmesa->dma.wait);
+		if (dma_bo->bo->size >= size &&
+		    !radeon_bo_is_referenced_by_cs(dma_bo->bo, rmesa->cmdbuf.cs) &&
+		    radeon_bo_is_idle(dma_bo->bo)) {
+			remove_from_list(dma_bo);
+			insert_at_tail(&rmesa->dma.free, dma_bo);
+		}
+		dma_bo = NULL;
+	}
+
 	if (is_empty_list(&rmesa->dma.free)
 	      || last_elem(&rmesa->dma.free)->bo->size < size) {
 		dma_bo = CALLOC_STRUCT(radeon_dma_bo);
@@ -292,6 +317,24 @@ void radeonAllocDmaRegion(radeonContextPtr rmesa,
 	assert(rmesa->dma.current_used <= first_elem(&rmesa->dma.reserved)->bo->size);
 }
 
+/* Makes sure the current DMA buffer has room for bytes more, so that the
+ * radeonAllocDmaRegion() calls for all the arrays of a draw get regions of
+ * the same buffer instead of refilling it halfway through.  Requests that
+ * wouldn't fit in a DMA buffer anyway are left to radeonAllocDmaRegion().
+ */
+void radeonReserveDmaSpace(radeonContextPtr rmesa, int bytes)
+{
+	if (bytes > rmesa->dma.minimum_size)
+		return;
+
+	if (rmesa->dma.flush)
+		rmesa->dma.flush(&rmesa->glCtx);
+
+	if (is_empty_list(&rmesa->dma.reserved)
+		|| rmesa->dma.current_used + bytes > first_elem(&rmesa->dma.reserved)->bo->size)
+		radeonRefillCurrentDmaRegion(rmesa, bytes);
+}
+
 void radeonFreeDmaRegions(radeonContextPtr rmesa)
 {
 	struct radeon_dma_bo *dma_bo;
@@ -329,17 +372,6 @@ void radeonReturnDmaRegion(radeonContextPtr rmesa, int return_bytes)
 	rmesa->dma.current_vertexptr = rmesa->dma.current_used;
 }
 
-static int radeon_bo_is_idle(struct radeon_bo* bo)
-{
-	uint32_t domain;
-	int ret = radeon_bo_is_busy(bo, &domain);
-	if (ret == -EINVAL) {
-		WARN_ONCE("Your libdrm or kernel doesn't have support for busy query.\n"
-			"This may cause small performance drop for you.\n");
-	}
-	return ret != -EBUSY;
-}
-
 void radeonReleaseDmaRegions(radeonContextPtr rmesa)
 {
 	struct radeon_dma_bo *dma_bo;
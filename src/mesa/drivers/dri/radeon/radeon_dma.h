@@ -50,8 +50,17 @@ void radeonReturnDmaRegion(radeonContextPtr rmesa, int return_bytes);
 void radeonAllocDmaRegion(radeonContextPtr rmesa,
 			  struct radeon_bo **pbo, int *poffset,
 			  int bytes, int alignment);
+void radeonReserveDmaSpace(radeonContextPtr rmesa, int bytes);
 void radeonReleaseDmaRegions(radeonContextPtr rmesa);
 
+/* Upper bound of the DMA space rcommon_emit_vector() needs for an array,
+ * including alignment.
+ */
+static inline int radeon_dma_vector_bytes(int size, int stride, int count)
+{
+	return (stride ? count : 1) * size * 4 + 64;
+}
+
 void rcommon_flush_last_swtcl_prim(struct gl_context *ctx);
 
 void *rcommonAllocDmaLowVerts(radeonContextPtr rmesa, int nverts, int vsize);
@@ -149,12 +149,22 @@ void radeonEmitArrays( struct gl_context *ctx, GLuint inputs )
    GLuint vfmt = 0;
    GLuint count = VB->Count;
    GLuint vtx, unit;
+   int bytes, i;
    
 #if 0
    if (RADEON_DEBUG & RADEON_VERTS)
       _tnl_print_vert_flags( __FUNCTION__, inputs );
 #endif
 
+   /* Upload all the arrays to the same DMA buffer */
+   bytes = radeon_dma_vector_bytes(4, VB->AttribPtr[_TNL_ATTRIB_POS]->stride,
+				   count);
+   for (i = _TNL_ATTRIB_POS + 1; i < _TNL_ATTRIB_TEX0 + MAX_TEXTURE_COORD_UNITS; i++) {
+      if (inputs & VERT_BIT(i))
+	 bytes += radeon_dma_vector_bytes(4, VB->AttribPtr[i]->stride, count);
+   }
+   radeonReserveDmaSpace(&rmesa->radeon, bytes);
+
    if (1) {
       if (!rmesa->tcl.obj.buf) 
 	rcommon_emit_vector( ctx, 
@@ -161,6 +161,7 @@ struct __DRIimageRec {
 #define radeonRefillCurrentDmaRegion        r200_radeonRefillCurrentDmaRegion
 #define radeonReleaseArrays                 r200_radeonReleaseArrays
 #define radeonReleaseDmaRegions             r200_radeonReleaseDmaRegions
+#define radeonReserveDmaSpace               r200_radeonReserveDmaSpace
 #define radeonReturnDmaRegion               r200_radeonReturnDmaRegion
 #define rcommonAllocDmaLowVerts             r200_rcommonAllocDmaLowVerts
 #define rcommon_emit_vecfog                 r200_rcommon_emit_vecfog
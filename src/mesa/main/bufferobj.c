@@ -207,7 +207,7 @@ static bool
 bufferobj_range_mapped(const struct gl_buffer_object *obj,
                        GLintptr offset, GLsizeiptr size)
 {
-   if (_mesa_bufferobj_mapped(obj)) {
+   if (_mesa_check_disallowed_mapping(obj)) {
       const GLintptr end = offset + size;
       const GLintptr mapEnd = obj->Offset + obj->Length;
 
@@ -276,7 +276,7 @@ buffer_object_subdata_range_good(struct gl_context * ctx, GLenum target,
       }
    }
    else {
-      if (_mesa_bufferobj_mapped(bufObj)) {
+      if (_mesa_check_disallowed_mapping(bufObj)) {
          _mesa_error(ctx, GL_INVALID_OPERATION, "%s", caller);
          return NULL;
       }
@@ -501,6 +501,8 @@ _mesa_initialize_buffer_object( struct gl_context *ctx,
    obj->Name = name;
    obj->Usage = GL_STATIC_DRAW_ARB;
    obj->AccessFlags = 0;
+   obj->StorageFlags = GL_MAP_READ_BIT | GL_MAP_WRITE_BIT |
+                       GL_DYNAMIC_STORAGE_BIT;
 }
 
 
@@ -690,6 +692,7 @@ _mesa_buffer_clear_subdata(struct gl_context *ctx,
          }
       }
       ctx->Driver.BufferSubData(ctx, offset, size, dataStart, bufObj);
+      free(dataStart);
       return;
    }
 
@@ -955,6 +958,10 @@ bind_buffer_object(struct gl_context *ctx, GLenum target, GLuint buffer)
    /* bind new buffer */
    _mesa_reference_buffer_object(ctx, bindTarget, newBufObj);
 
+   /* glReadPixels and glGetTexImage may write into it */
+   if (target == GL_PIXEL_PACK_BUFFER && _mesa_is_bufferobj(newBufObj))
+      _mesa_bufferobj_gpu_written(newBufObj);
+
    /* Pass BindBuffer call to device driver */
    if (ctx->Driver.BindBuffer)
       ctx->Driver.BindBuffer( ctx, target, newBufObj );
@@ -1237,6 +1244,79 @@ _mesa_IsBuffer(GLuint id)
 }
 
 
+void GLAPIENTRY
+_mesa_BufferStorage(GLenum target, GLsizeiptr size, const GLvoid *data,
+                    GLbitfield flags)
+{
+   GET_CURRENT_CONTEXT(ctx);
+   struct gl_buffer_object *bufObj;
+
+   if (!ctx->Extensions.ARB_buffer_storage) {
+      _mesa_error(ctx, GL_INVALID_OPERATION,
+                  "glBufferStorage(extension not supported)");
+      return;
+   }
+
+   if (size <= 0) {
+      _mesa_error(ctx, GL_INVALID_VALUE, "glBufferStorage(size <= 0)");
+      return;
+   }
+
+   if (flags & ~(GL_MAP_READ_BIT |
+                 GL_MAP_WRITE_BIT |
+                 GL_MAP_PERSISTENT_BIT |
+                 GL_MAP_COHERENT_BIT |
+                 GL_DYNAMIC_STORAGE_BIT |
+                 GL_CLIENT_STORAGE_BIT)) {
+      _mesa_error(ctx, GL_INVALID_VALUE, "glBufferStorage(flags)");
+      return;
+   }
+
+   if (flags & GL_MAP_PERSISTENT_BIT &&
+       !(flags & (GL_MAP_READ_BIT | GL_MAP_WRITE_BIT))) {
+      _mesa_error(ctx, GL_INVALID_VALUE, "glBufferStorage(flags!=READ/WRITE)");
+      return;
+   }
+
+   if (flags & GL_MAP_COHERENT_BIT && !(flags & GL_MAP_PERSISTENT_BIT)) {
+      _mesa_error(ctx, GL_INVALID_VALUE, "glBufferStorage(flags!=PERSISTENT)");
+      return;
+   }
+
+   bufObj = get_buffer(ctx, "glBufferStorage", target, GL_INVALID_OPERATION);
+   if (!bufObj)
+      return;
+
+   if (bufObj->Immutable) {
+      _mesa_error(ctx, GL_INVALID_OPERATION, "glBufferStorage(immutable)");
+      return;
+   }
+
+   if (_mesa_bufferobj_mapped(bufObj)) {
+      /* Unmap the existing buffer.  We'll replace it now.  Not an error. */
+      ctx->Driver.UnmapBuffer(ctx, bufObj);
+      bufObj->AccessFlags = 0;
+      ASSERT(bufObj->Pointer == NULL);
+   }
+
+   FLUSH_VERTICES(ctx, _NEW_BUFFER_OBJECT);
+
+   bufObj->Written = GL_TRUE;
+   bufObj->Immutable = GL_TRUE;
+   bufObj->StorageFlags = flags;
+   _mesa_bufferobj_invalidate_index_ranges(bufObj);
+
+   /* The driver looks at bufObj->StorageFlags to pick the kind of
+    * memory the buffer is allocated in.
+    */
+   ASSERT(ctx->Driver.BufferData);
+   if (!ctx->Driver.BufferData(ctx, target, size, data, GL_DYNAMIC_DRAW,
+                               bufObj)) {
+      _mesa_error(ctx, GL_OUT_OF_MEMORY, "glBufferStorage()");
+   }
+}
+
+
 void GLAPIENTRY
 _mesa_BufferData(GLenum target, GLsizeiptrARB size,
                     const GLvoid * data, GLenum usage)
@@ -1289,6 +1369,11 @@ _mesa_BufferData(GLenum target, GLsizeiptrARB size,
    if (!bufObj)
       return;
 
+   if (bufObj->Immutable) {
+      _mesa_error(ctx, GL_INVALID_OPERATION, "glBufferData(immutable)");
+      return;
+   }
+
    if (_mesa_bufferobj_mapped(bufObj)) {
       /* Unmap the existing buffer.  We'll replace it now.  Not an error. */
       ctx->Driver.UnmapBuffer(ctx, bufObj);
@@ -1299,6 +1384,7 @@ _mesa_BufferData(GLenum target, GLsizeiptrARB size,
    FLUSH_VERTICES(ctx, _NEW_BUFFER_OBJECT);
 
    bufObj->Written = GL_TRUE;
+   _mesa_bufferobj_invalidate_index_ranges(bufObj);
 
 #ifdef VBO_DEBUG
    printf("glBufferDataARB(%u, sz %ld, from %p, usage 0x%x)\n",
@@ -1331,10 +1417,17 @@ _mesa_BufferSubData(GLenum target, GLintptrARB offset,
       return;
    }
 
+   if (bufObj->Immutable &&
+       !(bufObj->StorageFlags & GL_DYNAMIC_STORAGE_BIT)) {
+      _mesa_error(ctx, GL_INVALID_OPERATION, "glBufferSubData");
+      return;
+   }
+
    if (size == 0)
       return;
 
    bufObj->Written = GL_TRUE;
+   _mesa_bufferobj_invalidate_index_ranges(bufObj);
 
    ASSERT(ctx->Driver.BufferSubData);
    ctx->Driver.BufferSubData( ctx, offset, size, data, bufObj );
@@ -1376,7 +1469,7 @@ _mesa_ClearBufferData(GLenum target, GLenum internalformat, GLenum format,
       return;
    }
 
-   if (_mesa_bufferobj_mapped(bufObj)) {
+   if (_mesa_check_disallowed_mapping(bufObj)) {
       _mesa_error(ctx, GL_INVALID_OPERATION,
                   "glClearBufferData(buffer currently mapped)");
       return;
@@ -1397,6 +1490,8 @@ _mesa_ClearBufferData(GLenum target, GLenum internalformat, GLenum format,
       return;
    }
 
+   _mesa_bufferobj_invalidate_index_ranges(bufObj);
+
    if (data == NULL) {
       /* clear to zeros, per the spec */
       ctx->Driver.ClearBufferSubData(ctx, 0, bufObj->Size,
@@ -1448,6 +1543,8 @@ _mesa_ClearBufferSubData(GLenum target, GLenum internalformat,
       return;
    }
 
+   _mesa_bufferobj_invalidate_index_ranges(bufObj);
+
    if (data == NULL) {
       /* clear to zeros, per the spec */
       ctx->Driver.ClearBufferSubData(ctx, offset, size,
@@ -1509,6 +1606,14 @@ _mesa_MapBuffer(GLenum target, GLenum access)
       return NULL;
    }
 
+   if ((accessFlags & GL_MAP_READ_BIT &&
+        !(bufObj->StorageFlags & GL_MAP_READ_BIT)) ||
+       (accessFlags & GL_MAP_WRITE_BIT &&
+        !(bufObj->StorageFlags & GL_MAP_WRITE_BIT))) {
+      _mesa_error(ctx, GL_INVALID_OPERATION, "glMapBuffer(invalid access)");
+      return NULL;
+   }
+
    if (!bufObj->Size) {
       _mesa_error(ctx, GL_OUT_OF_MEMORY,
                   "glMapBuffer(buffer size = 0)");
@@ -1532,8 +1637,10 @@ _mesa_MapBuffer(GLenum target, GLenum access)
       bufObj->AccessFlags = accessFlags;
    }
 
-   if (access == GL_WRITE_ONLY_ARB || access == GL_READ_WRITE_ARB)
+   if (access == GL_WRITE_ONLY_ARB || access == GL_READ_WRITE_ARB) {
       bufObj->Written = GL_TRUE;
+      _mesa_bufferobj_invalidate_index_ranges(bufObj);
+   }
 
 #ifdef VBO_DEBUG
    printf("glMapBufferARB(%u, sz %ld, access 0x%x)\n",
@@ -1663,6 +1770,16 @@ _mesa_GetBufferParameteriv(GLenum target, GLenum pname, GLint *params)
          goto invalid_pname;
       *params = (GLint) bufObj->Length;
       return;
+   case GL_BUFFER_IMMUTABLE_STORAGE:
+      if (!ctx->Extensions.ARB_buffer_storage)
+         goto invalid_pname;
+      *params = bufObj->Immutable;
+      return;
+   case GL_BUFFER_STORAGE_FLAGS:
+      if (!ctx->Extensions.ARB_buffer_storage)
+         goto invalid_pname;
+      *params = bufObj->StorageFlags;
+      return;
    default:
       ; /* fall-through */
    }
@@ -1717,6 +1834,16 @@ _mesa_GetBufferParameteri64v(GLenum target, GLenum pname, GLint64 *params)
          goto invalid_pname;
       *params = bufObj->Length;
       return;
+   case GL_BUFFER_IMMUTABLE_STORAGE:
+      if (!ctx->Extensions.ARB_buffer_storage)
+         goto invalid_pname;
+      *params = bufObj->Immutable;
+      return;
+   case GL_BUFFER_STORAGE_FLAGS:
+      if (!ctx->Extensions.ARB_buffer_storage)
+         goto invalid_pname;
+      *params = bufObj->StorageFlags;
+      return;
    default:
       ; /* fall-through */
    }
@@ -1765,13 +1892,13 @@ _mesa_CopyBufferSubData(GLenum readTarget, GLenum writeTarget,
    if (!dst)
       return;
 
-   if (_mesa_bufferobj_mapped(src)) {
+   if (_mesa_check_disallowed_mapping(src)) {
       _mesa_error(ctx, GL_INVALID_OPERATION,
                   "glCopyBufferSubData(readBuffer is mapped)");
       return;
    }
 
-   if (_mesa_bufferobj_mapped(dst)) {
+   if (_mesa_check_disallowed_mapping(dst)) {
       _mesa_error(ctx, GL_INVALID_OPERATION,
                   "glCopyBufferSubData(writeBuffer is mapped)");
       return;
@@ -1824,6 +1951,8 @@ _mesa_CopyBufferSubData(GLenum readTarget, GLenum writeTarget,
       }
    }
 
+   _mesa_bufferobj_invalidate_index_ranges(dst);
+
    ctx->Driver.CopyBufferSubData(ctx, src, dst, readOffset, writeOffset, size);
 }
 
@@ -1838,6 +1967,7 @@ _mesa_MapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length,
    GET_CURRENT_CONTEXT(ctx);
    struct gl_buffer_object *bufObj;
    void *map;
+   GLbitfield allowed_access;
 
    ASSERT_OUTSIDE_BEGIN_END_WITH_RETVAL(ctx, NULL);
 
@@ -1872,12 +2002,19 @@ _mesa_MapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length,
       return NULL;
    }
 
-   if (access & ~(GL_MAP_READ_BIT |
-                  GL_MAP_WRITE_BIT |
-                  GL_MAP_INVALIDATE_RANGE_BIT |
-                  GL_MAP_INVALIDATE_BUFFER_BIT |
-                  GL_MAP_FLUSH_EXPLICIT_BIT |
-                  GL_MAP_UNSYNCHRONIZED_BIT)) {
+   allowed_access = GL_MAP_READ_BIT |
+                    GL_MAP_WRITE_BIT |
+                    GL_MAP_INVALIDATE_RANGE_BIT |
+                    GL_MAP_INVALIDATE_BUFFER_BIT |
+                    GL_MAP_FLUSH_EXPLICIT_BIT |
+                    GL_MAP_UNSYNCHRONIZED_BIT;
+
+   if (ctx->Extensions.ARB_buffer_storage) {
+      allowed_access |= GL_MAP_PERSISTENT_BIT |
+                        GL_MAP_COHERENT_BIT;
+   }
+
+   if (access & ~allowed_access) {
       /* generate an error if any undefind bit is set */
       _mesa_error(ctx, GL_INVALID_VALUE, "glMapBufferRange(access)");
       return NULL;
@@ -1921,6 +2058,19 @@ _mesa_MapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length,
       return NULL;
    }
 
+   if ((access & GL_MAP_READ_BIT &&
+        !(bufObj->StorageFlags & GL_MAP_READ_BIT)) ||
+       (access & GL_MAP_WRITE_BIT &&
+        !(bufObj->StorageFlags & GL_MAP_WRITE_BIT)) ||
+       (access & GL_MAP_PERSISTENT_BIT &&
+        !(bufObj->StorageFlags & GL_MAP_PERSISTENT_BIT)) ||
+       (access & GL_MAP_COHERENT_BIT &&
+        !(bufObj->StorageFlags & GL_MAP_COHERENT_BIT))) {
+      _mesa_error(ctx, GL_INVALID_OPERATION,
+                  "glMapBufferRange(invalid access flags)");
+      return NULL;
+   }
+
    if (!bufObj->Size) {
       _mesa_error(ctx, GL_OUT_OF_MEMORY,
                   "glMapBufferRange(buffer size = 0)");
@@ -1937,6 +2087,9 @@ _mesa_MapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length,
       return bufObj->Pointer;
    }
 
+   if (access & GL_MAP_WRITE_BIT)
+      _mesa_bufferobj_invalidate_index_ranges(bufObj);
+
    ASSERT(ctx->Driver.MapBufferRange);
    map = ctx->Driver.MapBufferRange(ctx, offset, length, access, bufObj);
    if (!map) {
@@ -2497,6 +2650,8 @@ set_atomic_buffer_binding(struct gl_context *ctx,
    }
 
    _mesa_reference_buffer_object(ctx, &ctx->AtomicBuffer, bufObj);
+   if (_mesa_is_bufferobj(bufObj))
+      _mesa_bufferobj_gpu_written(bufObj);
 
    binding = &ctx->AtomicBufferBindings[index];
    if (binding->BufferObject == bufObj &&
@@ -44,6 +44,18 @@ _mesa_bufferobj_mapped(const struct gl_buffer_object *obj)
    return obj->Pointer != NULL;
 }
 
+/**
+ * Check whether the given buffer object is illegal to use while it's
+ * mapped.  A buffer mapped with GL_MAP_PERSISTENT_BIT (GL_ARB_buffer_storage)
+ * may stay mapped while the GL reads or writes it.
+ */
+static inline GLboolean
+_mesa_check_disallowed_mapping(const struct gl_buffer_object *obj)
+{
+   return _mesa_bufferobj_mapped(obj) &&
+          !(obj->AccessFlags & GL_MAP_PERSISTENT_BIT);
+}
+
 /**
  * Is the given buffer object a user-created buffer object?
  * Mesa uses default buffer objects in several places.  Default buffers
@@ -56,6 +68,28 @@ _mesa_is_bufferobj(const struct gl_buffer_object *obj)
 }
 
 
+/**
+ * Forget the index ranges cached by vbo_get_minmax_index(), called
+ * whenever the contents of the buffer object change.
+ */
+static inline void
+_mesa_bufferobj_invalidate_index_ranges(struct gl_buffer_object *obj)
+{
+   obj->NumIndexRanges = 0;
+}
+
+/**
+ * The buffer object is bound where the GPU may write it, so index ranges
+ * can't be cached for it anymore.
+ */
+static inline void
+_mesa_bufferobj_gpu_written(struct gl_buffer_object *obj)
+{
+   obj->GPUWritten = GL_TRUE;
+   obj->NumIndexRanges = 0;
+}
+
+
 extern void
 _mesa_init_buffer_objects(struct gl_context *ctx);
 
@@ -121,6 +155,10 @@ void GLAPIENTRY
 _mesa_BufferData(GLenum target, GLsizeiptrARB size,
                  const GLvoid * data, GLenum usage);
 
+void GLAPIENTRY
+_mesa_BufferStorage(GLenum target, GLsizeiptr size, const GLvoid *data,
+                    GLbitfield flags);
+
 void GLAPIENTRY
 _mesa_BufferSubData(GLenum target, GLintptrARB offset,
                     GLsizeiptrARB size, const GLvoid * data);
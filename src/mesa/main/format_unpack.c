@@ -29,6 +29,10 @@
 #include "../../gallium/auxiliary/util/u_format_rgb9e5.h"
 #include "../../gallium/auxiliary/util/u_format_r11g11b10f.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 
 /** Helper struct for MESA_FORMAT_Z32_FLOAT_S8X24_UINT */
 struct z32f_x24s8
@@ -88,12 +92,60 @@ _mesa_nonlinear_to_linear(GLubyte cs8)
 typedef void (*unpack_rgba_func)(const void *src, GLfloat dst[][4], GLuint n);
 
 
+#if defined(__SSE2__)
+
+/**
+ * Unpack 8888 texels to float four at a time.  The shifts give the bit
+ * positions of R, G, B and A in the texels.  Dividing gives exactly the
+ * same results as UBYTE_TO_FLOAT().
+ * \return number of texels done
+ */
+static GLuint
+unpack_8888_sse2(const GLuint *s, GLfloat dst[][4], GLuint n,
+                 GLuint rshift, GLuint gshift, GLuint bshift, GLuint ashift)
+{
+   const __m128i mask = _mm_set1_epi32(0xff);
+   const __m128 scale = _mm_set1_ps(255.0f);
+   GLuint i;
+
+   for (i = 0; i + 4 <= n; i += 4) {
+      const __m128i p = _mm_loadu_si128((const __m128i *) (s + i));
+      __m128 r = _mm_cvtepi32_ps(_mm_and_si128(
+                    _mm_srl_epi32(p, _mm_cvtsi32_si128(rshift)), mask));
+      __m128 g = _mm_cvtepi32_ps(_mm_and_si128(
+                    _mm_srl_epi32(p, _mm_cvtsi32_si128(gshift)), mask));
+      __m128 b = _mm_cvtepi32_ps(_mm_and_si128(
+                    _mm_srl_epi32(p, _mm_cvtsi32_si128(bshift)), mask));
+      __m128 a = _mm_cvtepi32_ps(_mm_and_si128(
+                    _mm_srl_epi32(p, _mm_cvtsi32_si128(ashift)), mask));
+
+      r = _mm_div_ps(r, scale);
+      g = _mm_div_ps(g, scale);
+      b = _mm_div_ps(b, scale);
+      a = _mm_div_ps(a, scale);
+      _MM_TRANSPOSE4_PS(r, g, b, a);
+
+      _mm_storeu_ps(dst[i + 0], r);
+      _mm_storeu_ps(dst[i + 1], g);
+      _mm_storeu_ps(dst[i + 2], b);
+      _mm_storeu_ps(dst[i + 3], a);
+   }
+
+   return i;
+}
+
+#endif /* __SSE2__ */
+
+
 static void
 unpack_RGBA8888(const void *src, GLfloat dst[][4], GLuint n)
 {
    const GLuint *s = ((const GLuint *) src);
-   GLuint i;
-   for (i = 0; i < n; i++) {
+   GLuint i = 0;
+#if defined(__SSE2__)
+   i = unpack_8888_sse2(s, dst, n, 24, 16, 8, 0);
+#endif
+   for (; i < n; i++) {
       dst[i][RCOMP] = UBYTE_TO_FLOAT( (s[i] >> 24)        );
       dst[i][GCOMP] = UBYTE_TO_FLOAT( (s[i] >> 16) & 0xff );
       dst[i][BCOMP] = UBYTE_TO_FLOAT( (s[i] >>  8) & 0xff );
@@ -105,8 +157,11 @@ static void
 unpack_RGBA8888_REV(const void *src, GLfloat dst[][4], GLuint n)
 {
    const GLuint *s = ((const GLuint *) src);
-   GLuint i;
-   for (i = 0; i < n; i++) {
+   GLuint i = 0;
+#if defined(__SSE2__)
+   i = unpack_8888_sse2(s, dst, n, 0, 8, 16, 24);
+#endif
+   for (; i < n; i++) {
       dst[i][RCOMP] = UBYTE_TO_FLOAT( (s[i]      ) & 0xff );
       dst[i][GCOMP] = UBYTE_TO_FLOAT( (s[i] >>  8) & 0xff );
       dst[i][BCOMP] = UBYTE_TO_FLOAT( (s[i] >> 16) & 0xff );
@@ -118,8 +173,11 @@ static void
 unpack_ARGB8888(const void *src, GLfloat dst[][4], GLuint n)
 {
    const GLuint *s = ((const GLuint *) src);
-   GLuint i;
-   for (i = 0; i < n; i++) {
+   GLuint i = 0;
+#if defined(__SSE2__)
+   i = unpack_8888_sse2(s, dst, n, 16, 8, 0, 24);
+#endif
+   for (; i < n; i++) {
       dst[i][RCOMP] = UBYTE_TO_FLOAT( (s[i] >> 16) & 0xff );
       dst[i][GCOMP] = UBYTE_TO_FLOAT( (s[i] >>  8) & 0xff );
       dst[i][BCOMP] = UBYTE_TO_FLOAT( (s[i]      ) & 0xff );
@@ -131,8 +189,11 @@ static void
 unpack_ARGB8888_REV(const void *src, GLfloat dst[][4], GLuint n)
 {
    const GLuint *s = ((const GLuint *) src);
-   GLuint i;
-   for (i = 0; i < n; i++) {
+   GLuint i = 0;
+#if defined(__SSE2__)
+   i = unpack_8888_sse2(s, dst, n, 8, 16, 24, 0);
+#endif
+   for (; i < n; i++) {
       dst[i][RCOMP] = UBYTE_TO_FLOAT( (s[i] >>  8) & 0xff );
       dst[i][GCOMP] = UBYTE_TO_FLOAT( (s[i] >> 16) & 0xff );
       dst[i][BCOMP] = UBYTE_TO_FLOAT( (s[i] >> 24)        );
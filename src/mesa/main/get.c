@@ -1414,15 +1414,220 @@ _mesa_GetFloatv(GLenum pname, GLfloat *params)
    }
 }
 
+/**
+ * glGetIntegerv() of the enums that applications which shadow GL state
+ * query the most.  They are all valid in every API they're handled for
+ * here and have no extra checks, so they can be answered straight from the
+ * context, without the hash table walk and the trip through union value.
+ * The results must be kept identical to the generic path.
+ *
+ * \return GL_FALSE if pname isn't handled here
+ */
+static inline GLboolean
+get_integer_fast(struct gl_context *ctx, GLenum pname, GLint *params)
+{
+   const GLuint face = ctx->Stencil.ActiveFace;
+
+   switch (pname) {
+   /* Bindings */
+   case GL_ACTIVE_TEXTURE:
+      params[0] = GL_TEXTURE0 + ctx->Texture.CurrentUnit;
+      break;
+   case GL_TEXTURE_BINDING_2D:
+      params[0] = ctx->Texture.Unit[ctx->Texture.CurrentUnit]
+                     .CurrentTex[TEXTURE_2D_INDEX]->Name;
+      break;
+   case GL_ARRAY_BUFFER_BINDING:
+      params[0] = ctx->Array.ArrayBufferObj->Name;
+      break;
+   case GL_ELEMENT_ARRAY_BUFFER_BINDING:
+      params[0] = ctx->Array.VAO->IndexBufferObj->Name;
+      break;
+   case GL_VERTEX_ARRAY_BINDING:
+      params[0] = ctx->Array.VAO->Name;
+      break;
+   case GL_COPY_READ_BUFFER:
+      params[0] = ctx->CopyReadBuffer->Name;
+      break;
+   case GL_COPY_WRITE_BUFFER:
+      params[0] = ctx->CopyWriteBuffer->Name;
+      break;
+   case GL_FRAMEBUFFER_BINDING:
+      params[0] = ctx->DrawBuffer->Name;
+      break;
+   case GL_RENDERBUFFER_BINDING:
+      params[0] = ctx->CurrentRenderbuffer ? ctx->CurrentRenderbuffer->Name : 0;
+      break;
+   case GL_CURRENT_PROGRAM:
+      if (ctx->API == API_OPENGLES)
+         return GL_FALSE;
+      params[0] = ctx->Shader.ActiveProgram ? ctx->Shader.ActiveProgram->Name : 0;
+      break;
+
+   /* Enables */
+   case GL_BLEND:
+      params[0] = ctx->Color.BlendEnabled & 1;
+      break;
+   case GL_CULL_FACE:
+      params[0] = BOOLEAN_TO_INT(ctx->Polygon.CullFlag);
+      break;
+   case GL_DEPTH_TEST:
+      params[0] = BOOLEAN_TO_INT(ctx->Depth.Test);
+      break;
+   case GL_DITHER:
+      params[0] = BOOLEAN_TO_INT(ctx->Color.DitherFlag);
+      break;
+   case GL_POLYGON_OFFSET_FILL:
+      params[0] = BOOLEAN_TO_INT(ctx->Polygon.OffsetFill);
+      break;
+   case GL_SAMPLE_ALPHA_TO_COVERAGE:
+      params[0] = BOOLEAN_TO_INT(ctx->Multisample.SampleAlphaToCoverage);
+      break;
+   case GL_SAMPLE_COVERAGE:
+      params[0] = BOOLEAN_TO_INT(ctx->Multisample.SampleCoverage);
+      break;
+   case GL_SCISSOR_TEST:
+      params[0] = ctx->Scissor.EnableFlags & 1;
+      break;
+   case GL_STENCIL_TEST:
+      params[0] = BOOLEAN_TO_INT(ctx->Stencil.Enabled);
+      break;
+
+   /* Blending */
+   case GL_BLEND_SRC:
+   case GL_BLEND_SRC_RGB:
+      params[0] = ctx->Color.Blend[0].SrcRGB;
+      break;
+   case GL_BLEND_DST_RGB:
+      params[0] = ctx->Color.Blend[0].DstRGB;
+      break;
+   case GL_BLEND_SRC_ALPHA:
+      params[0] = ctx->Color.Blend[0].SrcA;
+      break;
+   case GL_BLEND_DST_ALPHA:
+      params[0] = ctx->Color.Blend[0].DstA;
+      break;
+   case GL_BLEND_EQUATION:
+      params[0] = ctx->Color.Blend[0].EquationRGB;
+      break;
+   case GL_BLEND_EQUATION_ALPHA:
+      params[0] = ctx->Color.Blend[0].EquationA;
+      break;
+   case GL_COLOR_WRITEMASK:
+      params[0] = ctx->Color.ColorMask[0][RCOMP] ? 1 : 0;
+      params[1] = ctx->Color.ColorMask[0][GCOMP] ? 1 : 0;
+      params[2] = ctx->Color.ColorMask[0][BCOMP] ? 1 : 0;
+      params[3] = ctx->Color.ColorMask[0][ACOMP] ? 1 : 0;
+      break;
+
+   /* Depth, stencil, rasterization */
+   case GL_DEPTH_FUNC:
+      params[0] = ctx->Depth.Func;
+      break;
+   case GL_DEPTH_WRITEMASK:
+      params[0] = BOOLEAN_TO_INT(ctx->Depth.Mask);
+      break;
+   case GL_STENCIL_FUNC:
+      params[0] = ctx->Stencil.Function[face];
+      break;
+   case GL_STENCIL_REF:
+      params[0] = _mesa_get_stencil_ref(ctx, face);
+      break;
+   case GL_STENCIL_VALUE_MASK:
+      params[0] = ctx->Stencil.ValueMask[face];
+      break;
+   case GL_STENCIL_WRITEMASK:
+      params[0] = ctx->Stencil.WriteMask[face];
+      break;
+   case GL_STENCIL_FAIL:
+      params[0] = ctx->Stencil.FailFunc[face];
+      break;
+   case GL_STENCIL_PASS_DEPTH_FAIL:
+      params[0] = ctx->Stencil.ZFailFunc[face];
+      break;
+   case GL_STENCIL_PASS_DEPTH_PASS:
+      params[0] = ctx->Stencil.ZPassFunc[face];
+      break;
+   case GL_STENCIL_CLEAR_VALUE:
+      params[0] = ctx->Stencil.Clear;
+      break;
+   case GL_CULL_FACE_MODE:
+      params[0] = ctx->Polygon.CullFaceMode;
+      break;
+   case GL_FRONT_FACE:
+      params[0] = ctx->Polygon.FrontFace;
+      break;
+   case GL_VIEWPORT:
+      params[0] = IROUND(ctx->ViewportArray[0].X);
+      params[1] = IROUND(ctx->ViewportArray[0].Y);
+      params[2] = IROUND(ctx->ViewportArray[0].Width);
+      params[3] = IROUND(ctx->ViewportArray[0].Height);
+      break;
+   case GL_SCISSOR_BOX:
+      params[0] = ctx->Scissor.ScissorArray[0].X;
+      params[1] = ctx->Scissor.ScissorArray[0].Y;
+      params[2] = ctx->Scissor.ScissorArray[0].Width;
+      params[3] = ctx->Scissor.ScissorArray[0].Height;
+      break;
+
+   /* Pixel storage */
+   case GL_PACK_ALIGNMENT:
+      params[0] = ctx->Pack.Alignment;
+      break;
+   case GL_UNPACK_ALIGNMENT:
+      params[0] = ctx->Unpack.Alignment;
+      break;
+   case GL_UNPACK_ROW_LENGTH:
+      if (ctx->API == API_OPENGLES)
+         return GL_FALSE;
+      params[0] = ctx->Unpack.RowLength;
+      break;
+
+   /* Limits */
+   case GL_MAX_TEXTURE_SIZE:
+      params[0] = 1 << (ctx->Const.MaxTextureLevels - 1);
+      break;
+   case GL_MAX_RENDERBUFFER_SIZE:
+      params[0] = ctx->Const.MaxRenderbufferSize;
+      break;
+   case GL_MAX_VIEWPORT_DIMS:
+      params[0] = ctx->Const.MaxViewportWidth;
+      params[1] = ctx->Const.MaxViewportHeight;
+      break;
+   case GL_MAX_ELEMENTS_VERTICES:
+   case GL_MAX_ELEMENTS_INDICES:
+      params[0] = ctx->Const.MaxArrayLockSize;
+      break;
+   case GL_MAX_CLIP_PLANES:
+      params[0] = ctx->Const.MaxClipPlanes;
+      break;
+   case GL_SUBPIXEL_BITS:
+      params[0] = ctx->Const.SubPixelBits;
+      break;
+   case GL_GENERATE_MIPMAP_HINT:
+      params[0] = ctx->Hint.GenerateMipmap;
+      break;
+
+   default:
+      return GL_FALSE;
+   }
+
+   return GL_TRUE;
+}
+
 void GLAPIENTRY
 _mesa_GetIntegerv(GLenum pname, GLint *params)
 {
+   GET_CURRENT_CONTEXT(ctx);
    const struct value_desc *d;
    union value v;
    GLmatrix *m;
    int shift, i;
    void *p;
 
+   if (likely(get_integer_fast(ctx, pname, params)))
+      return;
+
    d = find_value("glGetIntegerv", pname, &p, &v);
    switch (d->type) {
    case TYPE_INVALID:
@@ -53,6 +53,39 @@
  */
 #define DELETED_KEY_VALUE 1
 
+/**
+ * Keys below this are also stored in a directly indexed array, which
+ * _mesa_HashLookup() reads without taking the mutex.  Names handed out by
+ * glGen*() are small and dense, so nearly all lookups take that path.
+ */
+#define MAX_DIRECT_KEYS (1 << 16)
+
+/**
+ * Lock-free lookups need the stores to the direct array to become visible
+ * in order.  Without a way to order them, lookups take the mutex.
+ */
+#if defined(__GNUC__)
+#define HASH_LOCKLESS_LOOKUP 1
+#define hash_write_barrier() __sync_synchronize()
+#else
+#define HASH_LOCKLESS_LOOKUP 0
+#define hash_write_barrier()
+#endif
+
+/**
+ * A directly indexed array of the values of keys [0, Size).
+ *
+ * The array is only written with the table's mutex held.  When it grows
+ * the old one may still be read by other threads, so it is kept on the
+ * Prev list until the table is deleted.  As the size doubles every time,
+ * those never take more memory than the current array.
+ */
+struct hash_direct {
+   GLuint Size;
+   struct hash_direct *Prev;
+   void * volatile *Data;
+};
+
 /**
  * The hash table data structure.  
  */
@@ -64,6 +97,8 @@ struct _mesa_HashTable {
    GLboolean InDeleteAll;                /**< Debug check */
    /** Value that would be in the table for DELETED_KEY_VALUE. */
    void *deleted_key_data;
+   /** Copy of the values of small keys, for lock-free lookups */
+   struct hash_direct * volatile Direct;
 };
 
 /** @{
@@ -104,6 +139,46 @@ uint_key(GLuint id)
 }
 /** @} */
 
+/**
+ * Make sure the direct array covers key, if it should.  Mutex must be held.
+ * \return the direct array or NULL if key is too large or out of memory
+ */
+static struct hash_direct *
+grow_direct(struct _mesa_HashTable *table, GLuint key)
+{
+   struct hash_direct *old = table->Direct;
+   struct hash_direct *direct;
+   GLuint size, i;
+
+   if (old && key < old->Size)
+      return old;
+
+   if (!HASH_LOCKLESS_LOOKUP || key >= MAX_DIRECT_KEYS)
+      return NULL;
+
+   size = old ? old->Size : 64;
+   while (size <= key)
+      size *= 2;
+
+   direct = malloc(sizeof(*direct) + size * sizeof(void *));
+   if (!direct)
+      return NULL;
+
+   direct->Size = size;
+   direct->Prev = old;
+   direct->Data = (void * volatile *) (direct + 1);
+
+   for (i = 0; i < size; i++)
+      direct->Data[i] = old && i < old->Size ? old->Data[i] : NULL;
+
+   /* The contents must be visible before the array is */
+   hash_write_barrier();
+   table->Direct = direct;
+
+   return direct;
+}
+
+
 /**
  * Create a new hash table.
  * 
@@ -144,6 +219,12 @@ _mesa_DeleteHashTable(struct _mesa_HashTable *table)
 
    _mesa_hash_table_destroy(table->ht, NULL);
 
+   while (table->Direct) {
+      struct hash_direct *prev = table->Direct->Prev;
+      free(table->Direct);
+      table->Direct = prev;
+   }
+
    _glthread_DESTROY_MUTEX(table->Mutex);
    _glthread_DESTROY_MUTEX(table->WalkMutex);
    free(table);
@@ -185,8 +266,18 @@ _mesa_HashLookup_unlocked(struct _mesa_HashTable *table, GLuint key)
 void *
 _mesa_HashLookup(struct _mesa_HashTable *table, GLuint key)
 {
+   const struct hash_direct *direct;
    void *res;
    assert(table);
+
+   /* Small keys are always mirrored in the direct array, if there is one.
+    * Readers racing with a writer see either the old or the new value,
+    * just like they would when the lookup took the mutex.
+    */
+   direct = table->Direct;
+   if (direct && key < direct->Size)
+      return direct->Data[key];
+
    _glthread_LOCK_MUTEX(table->Mutex);
    res = _mesa_HashLookup_unlocked(table, key);
    _glthread_UNLOCK_MUTEX(table->Mutex);
@@ -206,6 +297,7 @@ void
 _mesa_HashInsert(struct _mesa_HashTable *table, GLuint key, void *data)
 {
    uint32_t hash = uint_hash(key);
+   struct hash_direct *direct;
    struct hash_entry *entry;
 
    assert(table);
@@ -216,6 +308,13 @@ _mesa_HashInsert(struct _mesa_HashTable *table, GLuint key, void *data)
    if (key > table->MaxKey)
       table->MaxKey = key;
 
+   direct = grow_direct(table, key);
+   if (direct) {
+      /* Publish the object only once the caller is done setting it up */
+      hash_write_barrier();
+      direct->Data[key] = data;
+   }
+
    if (key == DELETED_KEY_VALUE) {
       table->deleted_key_data = data;
    } else {
@@ -257,6 +356,8 @@ _mesa_HashRemove(struct _mesa_HashTable *table, GLuint key)
    }
 
    _glthread_LOCK_MUTEX(table->Mutex);
+   if (table->Direct && key < table->Direct->Size)
+      table->Direct->Data[key] = NULL;
    if (key == DELETED_KEY_VALUE) {
       table->deleted_key_data = NULL;
    } else {
@@ -296,6 +397,11 @@ _mesa_HashDeleteAll(struct _mesa_HashTable *table,
       callback(DELETED_KEY_VALUE, table->deleted_key_data, userData);
       table->deleted_key_data = NULL;
    }
+   if (table->Direct) {
+      GLuint i;
+      for (i = 0; i < table->Direct->Size; i++)
+         table->Direct->Data[i] = NULL;
+   }
    table->InDeleteAll = GL_FALSE;
    _glthread_UNLOCK_MUTEX(table->Mutex);
 }
@@ -89,6 +89,18 @@ _mesa_ProvokingVertex(GLenum mode)
 }
 
 
+/**
+ * Flag a change of the state of a single light.  Core Mesa only updates the
+ * derived state of that light, drivers still see _NEW_LIGHT.
+ */
+static inline void
+flush_light(struct gl_context *ctx, GLuint lnum)
+{
+   FLUSH_VERTICES(ctx, _NEW_LIGHT_SOURCES);
+   ctx->Light._DirtyLights |= 1 << lnum;
+}
+
+
 /**
  * Helper function called by _mesa_Lightfv and _mesa_PopAttrib to set
  * per-light state.
@@ -108,26 +120,26 @@ _mesa_light(struct gl_context *ctx, GLuint lnum, GLenum pname, const GLfloat *pa
    case GL_AMBIENT:
       if (TEST_EQ_4V(light->Ambient, params))
 	 return;
-      FLUSH_VERTICES(ctx, _NEW_LIGHT);
+      flush_light(ctx, lnum);
       COPY_4V( light->Ambient, params );
       break;
    case GL_DIFFUSE:
       if (TEST_EQ_4V(light->Diffuse, params))
 	 return;
-      FLUSH_VERTICES(ctx, _NEW_LIGHT);
+      flush_light(ctx, lnum);
       COPY_4V( light->Diffuse, params );
       break;
    case GL_SPECULAR:
       if (TEST_EQ_4V(light->Specular, params))
 	 return;
-      FLUSH_VERTICES(ctx, _NEW_LIGHT);
+      flush_light(ctx, lnum);
       COPY_4V( light->Specular, params );
       break;
    case GL_POSITION:
       /* NOTE: position has already been transformed by ModelView! */
       if (TEST_EQ_4V(light->EyePosition, params))
 	 return;
-      FLUSH_VERTICES(ctx, _NEW_LIGHT);
+      flush_light(ctx, lnum);
       COPY_4V(light->EyePosition, params);
       if (light->EyePosition[3] != 0.0F)
 	 light->_Flags |= LIGHT_POSITIONAL;
@@ -138,7 +150,7 @@ _mesa_light(struct gl_context *ctx, GLuint lnum, GLenum pname, const GLfloat *pa
       /* NOTE: Direction already transformed by inverse ModelView! */
       if (TEST_EQ_3V(light->SpotDirection, params))
 	 return;
-      FLUSH_VERTICES(ctx, _NEW_LIGHT);
+      flush_light(ctx, lnum);
       COPY_3V(light->SpotDirection, params);
       break;
    case GL_SPOT_EXPONENT:
@@ -146,14 +158,14 @@ _mesa_light(struct gl_context *ctx, GLuint lnum, GLenum pname, const GLfloat *pa
       ASSERT(params[0] <= ctx->Const.MaxSpotExponent);
       if (light->SpotExponent == params[0])
 	 return;
-      FLUSH_VERTICES(ctx, _NEW_LIGHT);
+      flush_light(ctx, lnum);
       light->SpotExponent = params[0];
       break;
    case GL_SPOT_CUTOFF:
       ASSERT(params[0] == 180.0 || (params[0] >= 0.0 && params[0] <= 90.0));
       if (light->SpotCutoff == params[0])
          return;
-      FLUSH_VERTICES(ctx, _NEW_LIGHT);
+      flush_light(ctx, lnum);
       light->SpotCutoff = params[0];
       light->_CosCutoff = (GLfloat) (cos(light->SpotCutoff * DEG2RAD));
       if (light->_CosCutoff < 0)
@@ -167,21 +179,21 @@ _mesa_light(struct gl_context *ctx, GLuint lnum, GLenum pname, const GLfloat *pa
       ASSERT(params[0] >= 0.0);
       if (light->ConstantAttenuation == params[0])
 	 return;
-      FLUSH_VERTICES(ctx, _NEW_LIGHT);
+      flush_light(ctx, lnum);
       light->ConstantAttenuation = params[0];
       break;
    case GL_LINEAR_ATTENUATION:
       ASSERT(params[0] >= 0.0);
       if (light->LinearAttenuation == params[0])
 	 return;
-      FLUSH_VERTICES(ctx, _NEW_LIGHT);
+      flush_light(ctx, lnum);
       light->LinearAttenuation = params[0];
       break;
    case GL_QUADRATIC_ATTENUATION:
       ASSERT(params[0] >= 0.0);
       if (light->QuadraticAttenuation == params[0])
 	 return;
-      FLUSH_VERTICES(ctx, _NEW_LIGHT);
+      flush_light(ctx, lnum);
       light->QuadraticAttenuation = params[0];
       break;
    default:
@@ -864,20 +876,14 @@ _mesa_GetMaterialiv( GLenum face, GLenum pname, GLint *params )
 
 
 /**
- * Examine current lighting parameters to determine if the optimized lighting
- * function can be used.
- * Also, precompute some lighting values such as the products of light
- * source and material ambient, diffuse and specular coefficients.
+ * Determine from the enabled lights if the optimized lighting function can
+ * be used.
  */
-void
-_mesa_update_lighting( struct gl_context *ctx )
+static void
+update_light_flags( struct gl_context *ctx )
 {
    GLbitfield flags = 0;
    struct gl_light *light;
-   ctx->Light._NeedEyeCoords = GL_FALSE;
-
-   if (!ctx->Light.Enabled)
-      return;
 
    foreach(light, &ctx->Light.EnabledList) {
       flags |= light->_Flags;
@@ -897,6 +903,24 @@ _mesa_update_lighting( struct gl_context *ctx )
     */
    if (ctx->Light._NeedVertices)
       ctx->Light._NeedEyeCoords = GL_TRUE;
+}
+
+
+/**
+ * Examine current lighting parameters to determine if the optimized lighting
+ * function can be used.
+ * Also, precompute some lighting values such as the products of light
+ * source and material ambient, diffuse and specular coefficients.
+ */
+void
+_mesa_update_lighting( struct gl_context *ctx )
+{
+   ctx->Light._NeedEyeCoords = GL_FALSE;
+
+   if (!ctx->Light.Enabled)
+      return;
+
+   update_light_flags(ctx);
 
    /* Precompute some shading values.  Although we reference
     * Light.Material here, we can get away without flushing
@@ -922,18 +946,59 @@ _mesa_update_lighting( struct gl_context *ctx )
 }
 
 
+/**
+ * Like _mesa_update_lighting(), but when only the lights in the
+ * gl_light_attrib::_DirtyLights mask changed (_NEW_LIGHT_SOURCES).
+ */
+void
+_mesa_update_light_sources( struct gl_context *ctx )
+{
+   GLfloat (*mat)[4] = ctx->Light.Material.Attrib;
+   struct gl_light *light;
+
+   if (!ctx->Light.Enabled)
+      return;
+
+   update_light_flags(ctx);
+
+   /* The same products as _mesa_update_material() computes */
+   foreach(light, &ctx->Light.EnabledList) {
+      if (!(ctx->Light._DirtyLights & (1 << (light - ctx->Light.Light))))
+         continue;
+
+      SCALE_3V( light->_MatAmbient[0], light->Ambient,
+		mat[MAT_ATTRIB_FRONT_AMBIENT]);
+      SCALE_3V( light->_MatDiffuse[0], light->Diffuse,
+		mat[MAT_ATTRIB_FRONT_DIFFUSE] );
+      SCALE_3V( light->_MatSpecular[0], light->Specular,
+		mat[MAT_ATTRIB_FRONT_SPECULAR]);
+
+      if (ctx->Light.Model.TwoSide) {
+         SCALE_3V( light->_MatAmbient[1], light->Ambient,
+		   mat[MAT_ATTRIB_BACK_AMBIENT]);
+         SCALE_3V( light->_MatDiffuse[1], light->Diffuse,
+		   mat[MAT_ATTRIB_BACK_DIFFUSE] );
+         SCALE_3V( light->_MatSpecular[1], light->Specular,
+		   mat[MAT_ATTRIB_BACK_SPECULAR]);
+      }
+   }
+}
+
+
 /**
  * Update state derived from light position, spot direction.
  * Called upon:
  *   _NEW_MODELVIEW
  *   _NEW_LIGHT
+ *   _NEW_LIGHT_SOURCES (just the dirty lights)
  *   _TNL_NEW_NEED_EYE_COORDS
  *
  * Update on (_NEW_MODELVIEW | _NEW_LIGHT) when lighting is enabled.
  * Also update on lighting space changes.
+ * \param lights  bitmask of the lights to update
  */
 static void
-compute_light_positions( struct gl_context *ctx )
+compute_light_positions( struct gl_context *ctx, GLbitfield lights )
 {
    struct gl_light *light;
    static const GLfloat eye_z[3] = { 0, 0, 1 };
@@ -950,6 +1015,9 @@ compute_light_positions( struct gl_context *ctx )
 
    foreach (light, &ctx->Light.EnabledList) {
 
+      if (!(lights & (1 << (light - ctx->Light.Light))))
+         continue;
+
       if (ctx->_NeedEyeCoords) {
          /* _Position is in eye coordinate space */
 	 COPY_4FV( light->_Position, light->EyePosition );
@@ -1060,7 +1128,7 @@ _mesa_update_tnl_spaces( struct gl_context *ctx, GLuint new_state )
       /* Recalculate all state that depends on _NeedEyeCoords.
        */
       update_modelview_scale(ctx);
-      compute_light_positions( ctx );
+      compute_light_positions( ctx, ~0 );
 
       if (ctx->Driver.LightingSpaceChange)
 	 ctx->Driver.LightingSpaceChange( ctx );
@@ -1075,7 +1143,9 @@ _mesa_update_tnl_spaces( struct gl_context *ctx, GLuint new_state )
 	 update_modelview_scale(ctx);
 
       if (new_state2 & (_NEW_LIGHT|_NEW_MODELVIEW))
-	 compute_light_positions( ctx );
+	 compute_light_positions( ctx, ~0 );
+      else if (new_state2 & _NEW_LIGHT_SOURCES)
+	 compute_light_positions( ctx, ctx->Light._DirtyLights );
    }
 }
 
@@ -92,6 +92,8 @@ extern GLuint _mesa_material_bitmask( struct gl_context *ctx,
 
 extern void _mesa_update_lighting( struct gl_context *ctx );
 
+extern void _mesa_update_light_sources( struct gl_context *ctx );
+
 extern void _mesa_update_tnl_spaces( struct gl_context *ctx, GLuint new_state );
 
 extern void _mesa_update_material( struct gl_context *ctx,
@@ -0,0 +1,323 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Copyright (C) 2014  The Mesa Authors   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file marshal.c
+ * The GL thread, see marshal.h.
+ */
+
+
+#include "main/glheader.h"
+#include "main/context.h"
+#include "main/imports.h"
+#include "main/marshal.h"
+#include "glapi/glapi.h"
+
+
+static void
+glthread_execute_batch(struct gl_context *ctx, struct glthread_batch *batch)
+{
+   size_t pos = 0;
+
+   while (pos < batch->used)
+      pos += _mesa_unmarshal_dispatch_cmd(ctx, (uint8_t *) batch->buffer + pos);
+
+   batch->used = 0;
+}
+
+
+static int
+glthread_worker(void *data)
+{
+   struct gl_context *ctx = data;
+   struct glthread_state *glthread = ctx->GLThread;
+
+   _glapi_check_multithread();
+   _glapi_set_context(ctx);
+
+   mtx_lock(&glthread->mutex);
+   while (1) {
+      struct glthread_batch *batch;
+
+      while (glthread->num_executed == glthread->num_submitted &&
+             !glthread->shutdown)
+         cnd_wait(&glthread->cond, &glthread->mutex);
+
+      if (glthread->num_executed == glthread->num_submitted)
+         break;
+
+      /* Synchronous calls on the application thread may have switched
+       * the dispatch, e.g. for display list compilation.
+       */
+      if (_glapi_get_dispatch() != glthread->ServerDispatch)
+         _glapi_set_dispatch(glthread->ServerDispatch);
+
+      batch = &glthread->batches[glthread->num_executed % MARSHAL_NUM_BATCHES];
+      mtx_unlock(&glthread->mutex);
+
+      glthread_execute_batch(ctx, batch);
+
+      mtx_lock(&glthread->mutex);
+      glthread->ServerDispatch = _glapi_get_dispatch();
+      glthread->num_executed++;
+      cnd_broadcast(&glthread->cond);
+   }
+   mtx_unlock(&glthread->mutex);
+
+   return 0;
+}
+
+
+/**
+ * Start a GL thread for the context.  If that fails, the context is used
+ * without one.
+ */
+void
+_mesa_glthread_init(struct gl_context *ctx)
+{
+   struct glthread_state *glthread;
+
+   if (ctx->GLThread)
+      return;
+
+   glthread = calloc(1, sizeof(*glthread));
+   if (!glthread)
+      return;
+
+   glthread->MarshalDispatch = _mesa_create_marshal_table(ctx);
+   if (!glthread->MarshalDispatch) {
+      free(glthread);
+      return;
+   }
+
+   glthread->ServerDispatch = ctx->CurrentDispatch;
+   glthread->ArrayBuffer = 0;
+   glthread->ElementArrayBufferBound = GL_FALSE;
+   glthread->HasUserVertexArrays = GL_FALSE;
+
+   mtx_init(&glthread->mutex, mtx_plain);
+   cnd_init(&glthread->cond);
+
+   ctx->GLThread = glthread;
+
+   if (thrd_create(&glthread->thread, glthread_worker, ctx) != thrd_success) {
+      ctx->GLThread = NULL;
+      cnd_destroy(&glthread->cond);
+      mtx_destroy(&glthread->mutex);
+      free(glthread->MarshalDispatch);
+      free(glthread);
+      return;
+   }
+
+   if (_mesa_get_current_context() == ctx)
+      _glapi_set_dispatch(glthread->MarshalDispatch);
+}
+
+
+/**
+ * Execute all recorded commands and stop the GL thread.
+ */
+void
+_mesa_glthread_destroy(struct gl_context *ctx)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   if (!glthread)
+      return;
+
+   _mesa_glthread_finish(ctx);
+
+   mtx_lock(&glthread->mutex);
+   glthread->shutdown = GL_TRUE;
+   cnd_broadcast(&glthread->cond);
+   mtx_unlock(&glthread->mutex);
+
+   thrd_join(glthread->thread, NULL);
+
+   if (_mesa_get_current_context() == ctx)
+      _glapi_set_dispatch(ctx->CurrentDispatch);
+
+   ctx->GLThread = NULL;
+   cnd_destroy(&glthread->cond);
+   mtx_destroy(&glthread->mutex);
+   free(glthread->MarshalDispatch);
+   free(glthread);
+}
+
+
+/**
+ * Hand the current batch over to the GL thread and wait for the next one
+ * to be free.
+ */
+void
+_mesa_glthread_flush_batch(struct gl_context *ctx)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   if (!glthread)
+      return;
+
+   if (!glthread->batches[glthread->num_submitted % MARSHAL_NUM_BATCHES].used)
+      return;
+
+   mtx_lock(&glthread->mutex);
+   glthread->num_submitted++;
+   cnd_broadcast(&glthread->cond);
+
+   while (glthread->num_submitted - glthread->num_executed >=
+          MARSHAL_NUM_BATCHES)
+      cnd_wait(&glthread->cond, &glthread->mutex);
+   mtx_unlock(&glthread->mutex);
+}
+
+
+/**
+ * Wait for the GL thread to execute all recorded commands.  Afterwards
+ * the application thread may use the context directly, until the next
+ * command is recorded.
+ */
+void
+_mesa_glthread_finish(struct gl_context *ctx)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   if (!glthread)
+      return;
+
+   /* Called from within the GL thread, e.g. by the driver */
+   if (thrd_equal(thrd_current(), glthread->thread))
+      return;
+
+   _mesa_glthread_flush_batch(ctx);
+
+   mtx_lock(&glthread->mutex);
+   while (glthread->num_executed != glthread->num_submitted)
+      cnd_wait(&glthread->cond, &glthread->mutex);
+   mtx_unlock(&glthread->mutex);
+}
+
+
+/**
+ * Called after a synchronous call.  If the call switched the dispatch of
+ * the application thread, make it the GL thread's and go back to
+ * marshalling.
+ */
+void
+_mesa_glthread_restore_dispatch(struct gl_context *ctx)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+   struct _glapi_table *dispatch = _glapi_get_dispatch();
+
+   if (!glthread || dispatch == glthread->MarshalDispatch)
+      return;
+
+   glthread->ServerDispatch = dispatch;
+   _glapi_set_dispatch(glthread->MarshalDispatch);
+}
+
+
+void
+_mesa_glthread_BindBuffer(struct gl_context *ctx, GLenum target,
+                          GLuint buffer)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   switch (target) {
+   case GL_ARRAY_BUFFER:
+      glthread->ArrayBuffer = buffer;
+      break;
+   case GL_ELEMENT_ARRAY_BUFFER:
+      glthread->ElementArrayBufferBound = buffer != 0;
+      break;
+   }
+}
+
+
+void
+_mesa_glthread_DeleteBuffers(struct gl_context *ctx, GLsizei n,
+                             const GLuint *buffers)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+   GLsizei i;
+
+   if (n < 0 || !buffers)
+      return;
+
+   /* Deleting a bound buffer unbinds it.  The element array buffer of the
+    * current VAO isn't known, so treat it as unbound.
+    */
+   for (i = 0; i < n; i++) {
+      if (buffers[i] && buffers[i] == glthread->ArrayBuffer)
+         glthread->ArrayBuffer = 0;
+   }
+   glthread->ElementArrayBufferBound = GL_FALSE;
+}
+
+
+void
+_mesa_glthread_BindVertexArray(struct gl_context *ctx, GLuint array)
+{
+   /* The element array buffer is part of the VAO */
+   ctx->GLThread->ElementArrayBufferBound = GL_FALSE;
+}
+
+
+void
+_mesa_glthread_BindVertexArrayAPPLE(struct gl_context *ctx, GLuint array)
+{
+   ctx->GLThread->ElementArrayBufferBound = GL_FALSE;
+}
+
+
+void
+_mesa_glthread_DeleteVertexArrays(struct gl_context *ctx, GLsizei n,
+                                  const GLuint *arrays)
+{
+   /* Deleting the bound VAO binds the default one */
+   ctx->GLThread->ElementArrayBufferBound = GL_FALSE;
+}
+
+
+void
+_mesa_glthread_PopClientAttrib(struct gl_context *ctx)
+{
+   /* The buffer bindings may be restored to anything */
+   ctx->GLThread->ArrayBuffer = 0;
+   ctx->GLThread->ElementArrayBufferBound = GL_FALSE;
+}
+
+
+/**
+ * Called for gl*Pointer calls.  Once vertex arrays are sourced from client
+ * memory, which the application may change right after a draw, all draws
+ * are executed synchronously.
+ */
+void
+_mesa_glthread_array_pointer(struct gl_context *ctx, const GLvoid *pointer)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+
+   if (!glthread->ArrayBuffer && pointer)
+      glthread->HasUserVertexArrays = GL_TRUE;
+}
@@ -0,0 +1,208 @@
+/*
+ * Mesa 3-D graphics library
+ *
+ * Copyright (C) 2014  The Mesa Authors   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR
+ * OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+ * OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * \file marshal.h
+ * The GL thread: GL command marshalling.
+ *
+ * When enabled, the application thread's dispatch table is a table of
+ * marshalling functions generated by gl_marshal.py.  They record the GL
+ * calls with copies of their arguments into batches, which a thread
+ * owned by the context executes against the real dispatch.  Calls which
+ * return values or need client memory which isn't copied flush the
+ * batches, wait for the GL thread to go idle and then execute on the
+ * application thread.
+ */
+
+
+#ifndef MARSHAL_H
+#define MARSHAL_H
+
+
+#include "c11/threads.h"
+#include "main/glheader.h"
+#include "main/macros.h"
+#include "main/mtypes.h"
+
+
+struct gl_context;
+struct _glapi_table;
+
+
+/** Size of a batch of recorded commands, in bytes */
+#define MARSHAL_BATCH_SIZE (64 * 1024)
+
+/** Number of batches, the application can run this many ahead */
+#define MARSHAL_NUM_BATCHES 4
+
+/** Larger commands, e.g. with big arrays, are executed synchronously */
+#define MARSHAL_MAX_CMD_SIZE (8 * 1024)
+
+
+/** The header of every recorded command */
+struct marshal_cmd_base
+{
+   uint16_t cmd_id;     /**< which function, see marshal_generated.c */
+   uint16_t cmd_size;   /**< in bytes, including this header */
+};
+
+
+struct glthread_batch
+{
+   size_t used;         /**< bytes of buffer used */
+   uint64_t buffer[MARSHAL_BATCH_SIZE / 8];
+};
+
+
+struct glthread_state
+{
+   thrd_t thread;
+   mtx_t mutex;
+   cnd_t cond;
+
+   /**
+    * The batches form a ring.  Batches num_executed to num_submitted - 1
+    * are waiting for or being executed by the GL thread, and commands are
+    * recorded into batch num_submitted.  Both counters are only written
+    * with the mutex held.
+    */
+   struct glthread_batch batches[MARSHAL_NUM_BATCHES];
+   unsigned num_submitted;
+   unsigned num_executed;
+   GLboolean shutdown;
+
+   /** The marshalling dispatch table of the application thread */
+   struct _glapi_table *MarshalDispatch;
+
+   /**
+    * The dispatch table of the GL thread, for calls which are executed
+    * synchronously.  Only valid when the GL thread is idle.
+    */
+   struct _glapi_table *ServerDispatch;
+
+   /*
+    * Client state tracked on the application thread.  It's conservative:
+    * when in doubt, draws are executed synchronously.
+    */
+   GLuint ArrayBuffer;                 /**< name bound to GL_ARRAY_BUFFER */
+   GLboolean ElementArrayBufferBound;  /**< known to be non-zero */
+   GLboolean HasUserVertexArrays;      /**< sticky */
+};
+
+
+extern void
+_mesa_glthread_init(struct gl_context *ctx);
+
+extern void
+_mesa_glthread_destroy(struct gl_context *ctx);
+
+extern void
+_mesa_glthread_flush_batch(struct gl_context *ctx);
+
+extern void
+_mesa_glthread_finish(struct gl_context *ctx);
+
+extern void
+_mesa_glthread_restore_dispatch(struct gl_context *ctx);
+
+
+/**
+ * Allocate a command in the current batch.
+ */
+static inline void *
+_mesa_glthread_allocate_command(struct gl_context *ctx,
+                                uint16_t cmd_id, size_t size)
+{
+   struct glthread_state *glthread = ctx->GLThread;
+   struct glthread_batch *batch =
+      &glthread->batches[glthread->num_submitted % MARSHAL_NUM_BATCHES];
+   struct marshal_cmd_base *cmd;
+
+   size = ALIGN(size, 8);
+   assert(size <= MARSHAL_MAX_CMD_SIZE);
+
+   if (unlikely(batch->used + size > MARSHAL_BATCH_SIZE)) {
+      _mesa_glthread_flush_batch(ctx);
+      batch = &glthread->batches[glthread->num_submitted % MARSHAL_NUM_BATCHES];
+   }
+
+   cmd = (struct marshal_cmd_base *) ((uint8_t *) batch->buffer + batch->used);
+   batch->used += size;
+   cmd->cmd_id = cmd_id;
+   cmd->cmd_size = size;
+   return cmd;
+}
+
+
+/**
+ * Size in bytes of count array elements, or something larger than
+ * MARSHAL_MAX_CMD_SIZE if count is negative or too large, so that the
+ * call is executed synchronously and errors are raised as usual.
+ */
+static inline size_t
+_mesa_marshal_array_size(int64_t count, size_t element_size)
+{
+   if (count < 0 || count > MARSHAL_MAX_CMD_SIZE)
+      return MARSHAL_MAX_CMD_SIZE + 1;
+   return (size_t) count * element_size;
+}
+
+
+/* Client state tracking, called by the marshalling functions */
+
+extern void
+_mesa_glthread_BindBuffer(struct gl_context *ctx, GLenum target,
+                          GLuint buffer);
+
+extern void
+_mesa_glthread_DeleteBuffers(struct gl_context *ctx, GLsizei n,
+                             const GLuint *buffers);
+
+extern void
+_mesa_glthread_BindVertexArray(struct gl_context *ctx, GLuint array);
+
+extern void
+_mesa_glthread_BindVertexArrayAPPLE(struct gl_context *ctx, GLuint array);
+
+extern void
+_mesa_glthread_DeleteVertexArrays(struct gl_context *ctx, GLsizei n,
+                                  const GLuint *arrays);
+
+extern void
+_mesa_glthread_PopClientAttrib(struct gl_context *ctx);
+
+extern void
+_mesa_glthread_array_pointer(struct gl_context *ctx, const GLvoid *pointer);
+
+
+/* In marshal_generated.c */
+
+extern size_t
+_mesa_unmarshal_dispatch_cmd(struct gl_context *ctx, const void *cmd);
+
+extern struct _glapi_table *
+_mesa_create_marshal_table(const struct gl_context *ctx);
+
+
+#endif /* MARSHAL_H */
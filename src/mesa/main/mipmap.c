@@ -39,6 +39,22 @@
 #include "macros.h"
 #include "../../gallium/auxiliary/util/u_format_rgb9e5.h"
 #include "../../gallium/auxiliary/util/u_format_r11g11b10f.h"
+#include "c11/threads.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+
+/** Max number of threads make_2d_mipmap() uses */
+#define MAX_MIPMAP_THREADS 8
+
+/** Don't split levels with fewer bytes than this among threads */
+#define MIN_THREADED_MIPMAP_SIZE (1024 * 1024)
 
 
 
@@ -137,6 +153,84 @@ bytes_per_pixel(GLenum datatype, GLuint comps)
 /*@}*/
 
 
+#if defined(__SSE2__)
+
+/**
+ * Sum the 2x2 blocks of RGBA8 pixels of two 4-pixel row segments.
+ * \return the two sums of the four channels as 16-bit values
+ */
+static inline __m128i
+sum_blocks_rgba8(__m128i a, __m128i b)
+{
+   const __m128i zero = _mm_setzero_si128();
+   __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero),
+                              _mm_unpacklo_epi8(b, zero));
+   __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero),
+                              _mm_unpackhi_epi8(b, zero));
+
+   lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+   hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+   return _mm_unpacklo_epi64(lo, hi);
+}
+
+
+/**
+ * Sum the 2x2 blocks of 8-bit pixels of two 16-pixel row segments.
+ * \return the eight sums as 16-bit values
+ */
+static inline __m128i
+sum_blocks_r8(__m128i a, __m128i b)
+{
+   const __m128i mask = _mm_set1_epi16(0xff);
+
+   return _mm_add_epi16(_mm_add_epi16(_mm_and_si128(a, mask),
+                                      _mm_srli_epi16(a, 8)),
+                        _mm_add_epi16(_mm_and_si128(b, mask),
+                                      _mm_srli_epi16(b, 8)));
+}
+
+
+/**
+ * do_row() for 1 and 4 component GL_UNSIGNED_BYTE images which are halved
+ * in both directions.  Produces exactly the same results as the scalar
+ * code: the sums are computed in 16 bits and truncated.
+ * \return number of dest pixels done, the caller does the rest
+ */
+static GLint
+do_row_ubyte_sse2(GLuint comps, const GLubyte *rowA, const GLubyte *rowB,
+                  GLint dstWidth, GLubyte *dst)
+{
+   const GLint pixelsPerIter = comps == 4 ? 4 : 16;
+   GLint i;
+
+   for (i = 0; i + pixelsPerIter <= dstWidth; i += pixelsPerIter) {
+      const GLuint src = 2 * i * comps;
+      const __m128i a0 = _mm_loadu_si128((const __m128i *) (rowA + src));
+      const __m128i a1 = _mm_loadu_si128((const __m128i *) (rowA + src + 16));
+      const __m128i b0 = _mm_loadu_si128((const __m128i *) (rowB + src));
+      const __m128i b1 = _mm_loadu_si128((const __m128i *) (rowB + src + 16));
+      __m128i lo, hi;
+
+      if (comps == 4) {
+         lo = sum_blocks_rgba8(a0, b0);
+         hi = sum_blocks_rgba8(a1, b1);
+      }
+      else {
+         lo = sum_blocks_r8(a0, b0);
+         hi = sum_blocks_r8(a1, b1);
+      }
+
+      _mm_storeu_si128((__m128i *) (dst + i * comps),
+                       _mm_packus_epi16(_mm_srli_epi16(lo, 2),
+                                        _mm_srli_epi16(hi, 2)));
+   }
+
+   return i;
+}
+
+#endif /* __SSE2__ */
+
+
 /**
  * Average together two rows of a source image to produce a single new
  * row in the dest image.  It's legal for the two source rows to point
@@ -160,6 +254,23 @@ do_row(GLenum datatype, GLuint comps, GLint srcWidth,
    assert(srcWidth == dstWidth || srcWidth == 2 * dstWidth);
    */
 
+#if defined(__SSE2__)
+   if (datatype == GL_UNSIGNED_BYTE && (comps == 4 || comps == 1) &&
+       srcWidth == 2 * dstWidth) {
+      const GLint done = do_row_ubyte_sse2(comps, srcRowA, srcRowB,
+                                           dstWidth, dstRow);
+      if (done == dstWidth)
+         return;
+
+      /* do the remaining pixels below */
+      srcRowA = (const GLubyte *) srcRowA + 2 * done * comps;
+      srcRowB = (const GLubyte *) srcRowB + 2 * done * comps;
+      dstRow = (GLubyte *) dstRow + done * comps;
+      srcWidth -= 2 * done;
+      dstWidth -= done;
+   }
+#endif
+
    if (datatype == GL_UNSIGNED_BYTE && comps == 4) {
       GLuint i, j, k;
       const GLubyte(*rowA)[4] = (const GLubyte(*)[4]) srcRowA;
@@ -1441,6 +1552,105 @@ make_1d_mipmap(GLenum datatype, GLuint comps, GLint border,
 }
 
 
+/**
+ * A band of rows of a 2D mipmap level to be generated by make_2d_rows().
+ */
+struct mipmap_rows
+{
+   GLenum datatype;
+   GLuint comps;
+   GLint srcWidth, dstWidth;
+   const GLubyte *srcA, *srcB;
+   GLint srcRowStride;     /**< from one srcA row to the next */
+   GLubyte *dst;
+   GLint dstRowStride;
+   GLint rows;
+};
+
+
+static void
+make_2d_rows(const struct mipmap_rows *band)
+{
+   const GLubyte *srcA = band->srcA, *srcB = band->srcB;
+   GLubyte *dst = band->dst;
+   GLint row;
+
+   for (row = 0; row < band->rows; row++) {
+      do_row(band->datatype, band->comps, band->srcWidth, srcA, srcB,
+             band->dstWidth, dst);
+      srcA += band->srcRowStride;
+      srcB += band->srcRowStride;
+      dst += band->dstRowStride;
+   }
+}
+
+
+static int
+make_2d_rows_thread(void *data)
+{
+   make_2d_rows((const struct mipmap_rows *) data);
+   return 0;
+}
+
+
+static GLuint
+num_mipmap_threads(void)
+{
+#if defined(_SC_NPROCESSORS_ONLN)
+   long n = sysconf(_SC_NPROCESSORS_ONLN);
+   return n > 1 ? MIN2(n, MAX_MIPMAP_THREADS) : 1;
+#else
+   return 1;
+#endif
+}
+
+
+/**
+ * Generate the rows, split into bands which are done in parallel if the
+ * level is large enough.  The first band is done by the calling thread.
+ */
+static void
+make_2d_rows_parallel(const struct mipmap_rows *rows, GLint bpt)
+{
+   struct mipmap_rows bands[MAX_MIPMAP_THREADS];
+   thrd_t threads[MAX_MIPMAP_THREADS];
+   GLboolean started[MAX_MIPMAP_THREADS];
+   GLuint n = 1, i;
+
+   if (rows->rows * rows->dstWidth * bpt >= MIN_THREADED_MIPMAP_SIZE)
+      n = MIN2(num_mipmap_threads(), (GLuint) rows->rows);
+
+   if (n < 2) {
+      make_2d_rows(rows);
+      return;
+   }
+
+   for (i = 0; i < n; i++) {
+      const GLint first = rows->rows * i / n;
+
+      bands[i] = *rows;
+      bands[i].srcA += first * rows->srcRowStride;
+      bands[i].srcB += first * rows->srcRowStride;
+      bands[i].dst += first * rows->dstRowStride;
+      bands[i].rows = rows->rows * (i + 1) / n - first;
+   }
+
+   for (i = 1; i < n; i++) {
+      started[i] = thrd_create(&threads[i], make_2d_rows_thread,
+                               &bands[i]) == thrd_success;
+   }
+
+   make_2d_rows(&bands[0]);
+
+   for (i = 1; i < n; i++) {
+      if (started[i])
+         thrd_join(threads[i], NULL);
+      else
+         make_2d_rows(&bands[i]);
+   }
+}
+
+
 static void
 make_2d_mipmap(GLenum datatype, GLuint comps, GLint border,
                GLint srcWidth, GLint srcHeight,
@@ -1455,6 +1665,7 @@ make_2d_mipmap(GLenum datatype, GLuint comps, GLint border,
    const GLubyte *srcA, *srcB;
    GLubyte *dst;
    GLint row, srcRowStep;
+   struct mipmap_rows rows;
 
    /* Compute src and dst pointers, skipping any border */
    srcA = srcPtr + border * ((srcWidth + 1) * bpt);
@@ -1471,13 +1682,17 @@ make_2d_mipmap(GLenum datatype, GLuint comps, GLint border,
 
    dst = dstPtr + border * ((dstWidth + 1) * bpt);
 
-   for (row = 0; row < dstHeightNB; row++) {
-      do_row(datatype, comps, srcWidthNB, srcA, srcB,
-             dstWidthNB, dst);
-      srcA += srcRowStep * srcRowStride;
-      srcB += srcRowStep * srcRowStride;
-      dst += dstRowStride;
-   }
+   rows.datatype = datatype;
+   rows.comps = comps;
+   rows.srcWidth = srcWidthNB;
+   rows.dstWidth = dstWidthNB;
+   rows.srcA = srcA;
+   rows.srcB = srcB;
+   rows.srcRowStride = srcRowStep * srcRowStride;
+   rows.dst = dst;
+   rows.dstRowStride = dstRowStride;
+   rows.rows = dstHeightNB;
+   make_2d_rows_parallel(&rows, bpt);
 
    /* This is ugly but probably won't be used much */
    if (border > 0) {
@@ -84,6 +84,7 @@ struct gl_program_parameter_list;
 struct set;
 struct set_entry;
 struct vbo_context;
+struct glthread_state;
 /*@}*/
 
 
@@ -863,6 +864,8 @@ struct gl_light_attrib
    GLboolean _NeedVertices;		/**< Use fast shader? */
    GLfloat _BaseColor[2][3];
    /*@}*/
+
+   GLbitfield _DirtyLights;  /**< Light[] changed, see _NEW_LIGHT_SOURCES */
 };
 
 
@@ -1212,6 +1215,8 @@ struct gl_texture_object
    GLboolean GenerateMipmap;   /**< GL_SGIS_generate_mipmap */
    GLboolean _BaseComplete;    /**< Is the base texture level valid? */
    GLboolean _MipmapComplete;  /**< Is the whole mipmap valid? */
+   GLuint _Generation;         /**< bumped when completeness may change */
+   GLuint _CompleteGeneration; /**< _Generation at the last completeness test */
    GLboolean _IsIntegerFormat; /**< Does the texture store integer values? */
    GLboolean _RenderToTexture; /**< Any rendering to this texture? */
    GLboolean Purgeable;        /**< Is the buffer purgeable under memory
@@ -1401,6 +1406,13 @@ struct gl_texture_attrib
 
    /** Bitwise-OR of all Texture.Unit[i]._GenFlags */
    GLbitfield _GenFlags;
+
+   /**
+    * Bitset of the units whose texture or sampler bindings changed, see
+    * _NEW_TEXTURE_UNITS.  Cleared by drivers which set
+    * gl_driver_flags::NewTextureUnits.
+    */
+   GLuint _DirtyUnits[(MAX_COMBINED_TEXTURE_IMAGE_UNITS + 31) / 32];
 };
 
 
@@ -1439,6 +1451,23 @@ struct gl_viewport_attrib
 };
 
 
+/** Max number of index ranges cached per buffer object */
+#define MAX_INDEX_RANGES 8
+
+/**
+ * The range of the indices of a glDrawElements from a buffer object.
+ */
+struct gl_index_range
+{
+   GLintptr Offset;          /**< of the first index, in bytes */
+   GLuint Count;
+   GLenum Type;
+   GLboolean PrimitiveRestart;
+   GLuint RestartIndex;
+   GLuint Min, Max;
+};
+
+
 /**
  * GL_ARB_vertex/pixel_buffer_object buffer object
  */
@@ -1461,6 +1490,16 @@ struct gl_buffer_object
    GLboolean DeletePending;   /**< true if buffer object is removed from the hash */
    GLboolean Written;   /**< Ever written to? (for debugging) */
    GLboolean Purgeable; /**< Is the buffer purgeable under memory pressure? */
+   GLboolean Immutable; /**< GL_ARB_buffer_storage */
+   GLbitfield StorageFlags; /**< GL_MAP_PERSISTENT_BIT, etc. */
+
+   /** Index ranges found by vbo_get_minmax_index(), protected by Mutex */
+   /*@{*/
+   struct gl_index_range IndexRanges[MAX_INDEX_RANGES];
+   GLuint NumIndexRanges;
+   GLuint NextIndexRange;     /**< to be replaced when all are used */
+   GLboolean GPUWritten;      /**< may be written by the GPU, don't cache */
+   /*@}*/
 };
 
 
@@ -2667,6 +2706,15 @@ struct gl_shader_program
    unsigned NumUserUniformStorage;
    struct gl_uniform_storage *UniformStorage;
 
+   /**
+    * Half-open range of UniformStorage entries changed by glUniform* that
+    * haven't been propagated to the driver storage yet.  Empty when
+    * UniformDirtyBegin == UniformDirtyEnd.
+    *
+    * \sa _mesa_flush_uniforms
+    */
+   unsigned UniformDirtyBegin, UniformDirtyEnd;
+
    /**
     * Size of the gl_ClipDistance array that is output from the last pipeline
     * stage before the fragment shader.
@@ -2771,6 +2819,20 @@ struct gl_shader_state
 };
 
 
+/**
+ * Instruction counts of a loop body, which the loop unroller estimates the
+ * cost of unrolling the loop from.
+ */
+struct gl_loop_body_cost
+{
+   GLuint Alu;          /**< Expression operations */
+   GLuint Texture;      /**< Texture instructions */
+   GLuint Assignments;
+   GLuint Branches;     /**< If statements */
+   GLuint Calls;        /**< Calls of functions that weren't inlined */
+};
+
+
 /**
  * Compiler options for a single GLSL shaders type
  */
@@ -2799,6 +2861,22 @@ struct gl_shader_compiler_options
    GLuint MaxIfDepth;               /**< Maximum nested IF blocks */
    GLuint MaxUnrollIterations;
 
+   /**
+    * Estimate the cost of one iteration of a loop body.
+    *
+    * A loop is only unrolled if the cost of all its iterations is at most
+    * 5 * MaxUnrollIterations.  If NULL, the cost is the number of
+    * expression operations and assignments.
+    */
+   GLuint (*LoopBodyCost)(const struct gl_loop_body_cost *cost);
+
+   /**
+    * Maximum number of copies of the body a loop which can't be unrolled
+    * completely is partially unrolled to, within the same cost limit.
+    * 0 or 1 disables partial unrolling.
+    */
+   GLuint MaxPartialUnrollFactor;
+
    /**
     * Optimize code for array of structures backends.
     *
@@ -3433,6 +3511,7 @@ struct gl_extensions
    GLboolean ARB_arrays_of_arrays;
    GLboolean ARB_base_instance;
    GLboolean ARB_blend_func_extended;
+   GLboolean ARB_buffer_storage;
    GLboolean ARB_color_buffer_float;
    GLboolean ARB_compute_shader;
    GLboolean ARB_conservative_depth;
@@ -3622,7 +3701,7 @@ struct gl_matrix_stack
 #define _NEW_TEXTURE           (1 << 16)  /**< gl_context::Texture */
 #define _NEW_TRANSFORM         (1 << 17)  /**< gl_context::Transform */
 #define _NEW_VIEWPORT          (1 << 18)  /**< gl_context::Viewport */
-/* gap, re-use for core Mesa state only; use ctx->DriverFlags otherwise */
+#define _NEW_TEXTURE_UNITS     (1 << 19)  /**< gl_texture_attrib::_DirtyUnits */
 #define _NEW_ARRAY             (1 << 20)  /**< gl_context::Array */
 #define _NEW_RENDERMODE        (1 << 21)  /**< gl_context::RenderMode, etc */
 #define _NEW_BUFFERS           (1 << 22)  /**< gl_context::Visual, DrawBuffer, */
@@ -3633,7 +3712,7 @@ struct gl_matrix_stack
 #define _NEW_PROGRAM_CONSTANTS (1 << 27)
 #define _NEW_BUFFER_OBJECT     (1 << 28)
 #define _NEW_FRAG_CLAMP        (1 << 29)
-/* gap, re-use for core Mesa state only; use ctx->DriverFlags otherwise */
+#define _NEW_LIGHT_SOURCES     (1 << 30)  /**< gl_light_attrib::_DirtyLights */
 #define _NEW_VARYING_VP_INPUTS (1 << 31) /**< gl_context::varying_vp_inputs */
 #define _NEW_ALL ~0
 /*@}*/
@@ -3644,7 +3723,9 @@ struct gl_matrix_stack
  */
 /*@{*/
 #define _MESA_NEW_NEED_EYE_COORDS         (_NEW_LIGHT |		\
+                                           _NEW_LIGHT_SOURCES |	\
                                            _NEW_TEXTURE |	\
+                                           _NEW_TEXTURE_UNITS |	\
                                            _NEW_POINT |		\
                                            _NEW_PROGRAM |	\
                                            _NEW_MODELVIEW)
@@ -3657,6 +3738,36 @@ struct gl_matrix_stack
 /*@}*/
 
 
+/**
+ * The derived state updates done by _mesa_update_state(), which are counted
+ * in gl_context::StateUpdates and printed with MESA_VERBOSE=updates.
+ */
+enum gl_state_update
+{
+   STATE_UPDATE_CALLS,
+   STATE_UPDATE_PROGRAM_ENABLES,
+   STATE_UPDATE_MODELVIEW_PROJECT,
+   STATE_UPDATE_TEXTURE_MATRICES,
+   STATE_UPDATE_TEXTURE,
+   STATE_UPDATE_TEXTURE_UNITS,
+   STATE_UPDATE_FRAMEBUFFER,
+   STATE_UPDATE_DRAW_BUFFER_BOUNDS,
+   STATE_UPDATE_LIGHTING,
+   STATE_UPDATE_LIGHT_SOURCES,
+   STATE_UPDATE_TWOSIDE,
+   STATE_UPDATE_STENCIL,
+   STATE_UPDATE_PIXEL,
+   STATE_UPDATE_VIEWPORT_MATRIX,
+   STATE_UPDATE_MULTISAMPLE,
+   STATE_UPDATE_TNL_SPACES,
+   STATE_UPDATE_PROGRAM,
+   STATE_UPDATE_CLIENT_ARRAYS,
+   STATE_UPDATE_MAX_ELEMENT,
+   STATE_UPDATE_DRIVER,
+   STATE_UPDATE_COUNT
+};
+
+
 
 
 /* This has to be included here. */
@@ -3848,6 +3959,20 @@ struct gl_driver_flags
     * gl_context::ImageUnits
     */
    GLbitfield NewImageUnits;
+
+   /**
+    * gl_texture_attrib::_DirtyUnits: the texture or sampler bindings of
+    * some units changed, nothing else.  Drivers which don't set this see
+    * _NEW_TEXTURE instead.
+    */
+   GLbitfield NewTextureUnits;
+
+   /**
+    * gl_program::Parameters of the current program of a stage, set by
+    * glUniform*().  Drivers which don't set these see
+    * _NEW_PROGRAM_CONSTANTS instead.
+    */
+   GLbitfield NewShaderConstants[MESA_SHADER_STAGES];
 };
 
 struct gl_uniform_buffer_binding
@@ -3968,6 +4093,9 @@ struct gl_context
    struct _glapi_table *CurrentDispatch;
    /*@}*/
 
+   /** The GL thread, if calls are marshalled, see marshal.h */
+   struct glthread_state *GLThread;
+
    struct gl_config Visual;
    struct gl_framebuffer *DrawBuffer;	/**< buffer for writing */
    struct gl_framebuffer *ReadBuffer;	/**< buffer for reading */
@@ -4139,6 +4267,9 @@ struct gl_context
 
    struct gl_driver_flags DriverFlags;
 
+   /** How often each derived state update ran, see enum gl_state_update */
+   GLuint StateUpdates[STATE_UPDATE_COUNT];
+
    GLboolean ViewportInitialized;  /**< has viewport size been initialized? */
 
    GLbitfield64 varying_vp_inputs;  /**< mask of VERT_BIT_* flags */
@@ -4228,7 +4359,8 @@ enum _verbose
    VERBOSE_VERTS		= 0x0800,
    VERBOSE_DISASSEM		= 0x1000,
    VERBOSE_DRAW                 = 0x2000,
-   VERBOSE_SWAPBUFFERS          = 0x4000
+   VERBOSE_SWAPBUFFERS          = 0x4000,
+   VERBOSE_STATE_UPDATES        = 0x8000
 };
 
 
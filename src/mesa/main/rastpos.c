@@ -35,6 +35,7 @@
 #include "mtypes.h"
 #include "rastpos.h"
 #include "state.h"
+#include "uniforms.h"
 #include "main/dispatch.h"
 
 
@@ -58,6 +59,8 @@ rasterpos(GLfloat x, GLfloat y, GLfloat z, GLfloat w)
    if (ctx->NewState)
       _mesa_update_state( ctx );
 
+   _mesa_flush_uniforms(ctx);
+
    ctx->Driver.RasterPos(ctx, p);
 }
 
@@ -37,6 +37,7 @@
 #include "pack.h"
 #include "pbo.h"
 #include "state.h"
+#include "streaming-load-memcpy.h"
 #include "glformats.h"
 #include "fbobject.h"
 
@@ -210,7 +211,7 @@ readpixels_memcpy(struct gl_context *ctx,
    struct gl_renderbuffer *rb =
          _mesa_get_read_renderbuffer_for_format(ctx, format);
    GLubyte *dst, *map;
-   int dstStride, stride, j, texelBytes;
+   int dstStride, stride, texelBytes;
 
    /* Fail if memcpy cannot be used. */
    if (!readpixels_can_use_memcpy(ctx, format, type, packing)) {
@@ -230,12 +231,8 @@ readpixels_memcpy(struct gl_context *ctx,
 
    texelBytes = _mesa_get_format_bytes(rb->Format);
 
-   /* memcpy*/
-   for (j = 0; j < height; j++) {
-      memcpy(dst, map, width * texelBytes);
-      dst += dstStride;
-      map += stride;
-   }
+   _mesa_memcpy_rows_from_mapping(dst, dstStride, map, stride,
+                                  width * texelBytes, height);
 
    ctx->Driver.UnmapRenderbuffer(ctx, rb);
    return GL_TRUE;
@@ -38,6 +38,7 @@
 #include "main/macros.h"
 #include "main/mtypes.h"
 #include "main/samplerobj.h"
+#include "main/texstate.h"
 
 
 struct gl_sampler_object *
@@ -276,7 +277,7 @@ _mesa_BindSampler(GLuint unit, GLuint sampler)
    }
    
    if (ctx->Texture.Unit[unit].Sampler != sampObj) {
-      FLUSH_VERTICES(ctx, _NEW_TEXTURE);
+      _mesa_flag_texture_unit(ctx, unit);
    }
 
    /* bind new sampler */
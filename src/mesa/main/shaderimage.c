@@ -340,7 +340,7 @@ validate_image_unit(struct gl_context *ctx, struct gl_image_unit *u)
        u->Level > t->_MaxLevel)
       return GL_FALSE;
 
-   _mesa_test_texobj_completeness(ctx, t);
+   _mesa_update_texobj_completeness(ctx, t);
 
    if ((u->Level == t->BaseLevel && !t->_BaseComplete) ||
        (u->Level != t->BaseLevel && !t->_MipmapComplete))
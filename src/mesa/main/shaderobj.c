@@ -286,6 +286,8 @@ _mesa_clear_shader_program_data(struct gl_context *ctx,
       shProg->NumUserUniformStorage = 0;
       shProg->UniformStorage = NULL;
       shProg->UniformLocationBaseScale = 0;
+      shProg->UniformDirtyBegin = 0;
+      shProg->UniformDirtyEnd = 0;
    }
 
    if (shProg->UniformHash) {
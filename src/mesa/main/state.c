@@ -54,6 +54,10 @@
 #include "blend.h"
 
 
+/** Count a derived state update, see _mesa_print_state_updates() */
+#define COUNT_UPDATE(ctx, update) ((ctx)->StateUpdates[update]++)
+
+
 /**
  * Update the following fields:
  *   ctx->VertexProgram._Enabled
@@ -339,6 +343,8 @@ _mesa_update_state_locked( struct gl_context *ctx )
    GLbitfield prog_flags = _NEW_PROGRAM;
    GLbitfield new_prog_state = 0x0;
 
+   ctx->StateUpdates[STATE_UPDATE_CALLS]++;
+
    if (new_state == _NEW_CURRENT_ATTRIB) 
       goto out;
 
@@ -347,54 +353,92 @@ _mesa_update_state_locked( struct gl_context *ctx )
 
    /* Determine which state flags effect vertex/fragment program state */
    if (ctx->FragmentProgram._MaintainTexEnvProgram) {
-      prog_flags |= (_NEW_BUFFERS | _NEW_TEXTURE | _NEW_FOG |
-		     _NEW_VARYING_VP_INPUTS | _NEW_LIGHT | _NEW_POINT |
-		     _NEW_RENDERMODE | _NEW_PROGRAM | _NEW_FRAG_CLAMP |
-		     _NEW_COLOR);
+      prog_flags |= (_NEW_BUFFERS | _NEW_TEXTURE | _NEW_TEXTURE_UNITS |
+		     _NEW_FOG | _NEW_VARYING_VP_INPUTS | _NEW_LIGHT |
+		     _NEW_LIGHT_SOURCES | _NEW_POINT | _NEW_RENDERMODE |
+		     _NEW_PROGRAM | _NEW_FRAG_CLAMP | _NEW_COLOR);
    }
    if (ctx->VertexProgram._MaintainTnlProgram) {
       prog_flags |= (_NEW_VARYING_VP_INPUTS | _NEW_TEXTURE |
-                     _NEW_TEXTURE_MATRIX | _NEW_TRANSFORM | _NEW_POINT |
-                     _NEW_FOG | _NEW_LIGHT |
-                     _MESA_NEW_NEED_EYE_COORDS);
+                     _NEW_TEXTURE_UNITS | _NEW_TEXTURE_MATRIX |
+                     _NEW_TRANSFORM | _NEW_POINT | _NEW_FOG | _NEW_LIGHT |
+                     _NEW_LIGHT_SOURCES | _MESA_NEW_NEED_EYE_COORDS);
    }
 
    /*
     * Now update derived state info
     */
 
-   if (new_state & prog_flags)
+   if (new_state & prog_flags) {
+      COUNT_UPDATE(ctx, STATE_UPDATE_PROGRAM_ENABLES);
       update_program_enables( ctx );
+   }
 
-   if (new_state & (_NEW_MODELVIEW|_NEW_PROJECTION))
+   if (new_state & (_NEW_MODELVIEW|_NEW_PROJECTION)) {
+      COUNT_UPDATE(ctx, STATE_UPDATE_MODELVIEW_PROJECT);
       _mesa_update_modelview_project( ctx, new_state );
+   }
 
-   if (new_state & (_NEW_PROGRAM|_NEW_TEXTURE|_NEW_TEXTURE_MATRIX))
+   /* Binding changes flagged with _NEW_TEXTURE_UNITS only need the units
+    * in gl_texture_attrib::_DirtyUnits updated.
+    */
+   if (new_state & (_NEW_PROGRAM|_NEW_TEXTURE|_NEW_TEXTURE_UNITS|
+                    _NEW_TEXTURE_MATRIX)) {
+      if (new_state & _NEW_TEXTURE_MATRIX)
+         COUNT_UPDATE(ctx, STATE_UPDATE_TEXTURE_MATRICES);
+      if (new_state & (_NEW_PROGRAM|_NEW_TEXTURE))
+         COUNT_UPDATE(ctx, STATE_UPDATE_TEXTURE);
+      else if (new_state & _NEW_TEXTURE_UNITS)
+         COUNT_UPDATE(ctx, STATE_UPDATE_TEXTURE_UNITS);
       _mesa_update_texture( ctx, new_state );
+   }
 
-   if (new_state & _NEW_BUFFERS)
+   if (new_state & _NEW_BUFFERS) {
+      COUNT_UPDATE(ctx, STATE_UPDATE_FRAMEBUFFER);
       _mesa_update_framebuffer(ctx);
+   }
 
-   if (new_state & (_NEW_SCISSOR | _NEW_BUFFERS | _NEW_VIEWPORT))
+   if (new_state & (_NEW_SCISSOR | _NEW_BUFFERS | _NEW_VIEWPORT)) {
+      COUNT_UPDATE(ctx, STATE_UPDATE_DRAW_BUFFER_BOUNDS);
       _mesa_update_draw_buffer_bounds( ctx );
+   }
 
-   if (new_state & _NEW_LIGHT)
+   /* Likewise glLight*() only flags _NEW_LIGHT_SOURCES and the light in
+    * gl_light_attrib::_DirtyLights.
+    */
+   if (new_state & _NEW_LIGHT) {
+      COUNT_UPDATE(ctx, STATE_UPDATE_LIGHTING);
       _mesa_update_lighting( ctx );
+   }
+   else if (new_state & _NEW_LIGHT_SOURCES) {
+      COUNT_UPDATE(ctx, STATE_UPDATE_LIGHT_SOURCES);
+      _mesa_update_light_sources( ctx );
+   }
 
-   if (new_state & (_NEW_LIGHT | _NEW_PROGRAM))
+   if (new_state & (_NEW_LIGHT | _NEW_PROGRAM)) {
+      COUNT_UPDATE(ctx, STATE_UPDATE_TWOSIDE);
       update_twoside( ctx );
+   }
 
-   if (new_state & (_NEW_STENCIL | _NEW_BUFFERS))
+   if (new_state & (_NEW_STENCIL | _NEW_BUFFERS)) {
+      COUNT_UPDATE(ctx, STATE_UPDATE_STENCIL);
       _mesa_update_stencil( ctx );
+   }
 
-   if (new_state & _NEW_PIXEL)
+   if (new_state & _NEW_PIXEL) {
+      COUNT_UPDATE(ctx, STATE_UPDATE_PIXEL);
       _mesa_update_pixel( ctx, new_state );
+   }
 
-   if (new_state & (_NEW_BUFFERS | _NEW_VIEWPORT))
+   if (new_state & (_NEW_BUFFERS | _NEW_VIEWPORT)) {
+      COUNT_UPDATE(ctx, STATE_UPDATE_VIEWPORT_MATRIX);
       update_viewport_matrix(ctx);
+   }
 
-   if (new_state & (_NEW_MULTISAMPLE | _NEW_BUFFERS))
+   if (new_state & (_NEW_MULTISAMPLE | _NEW_BUFFERS)) {
+      COUNT_UPDATE(ctx, STATE_UPDATE_MULTISAMPLE);
       update_multisample( ctx );
+   }
 
    /* ctx->_NeedEyeCoords is now up to date.
     *
@@ -405,25 +449,38 @@ _mesa_update_state_locked( struct gl_context *ctx )
     * If the lighting space hasn't changed, may still need to recompute
     * light positions & normal transforms for other reasons.
     */
-   if (new_state & _MESA_NEW_NEED_EYE_COORDS) 
+   if (new_state & _MESA_NEW_NEED_EYE_COORDS) {
+      COUNT_UPDATE(ctx, STATE_UPDATE_TNL_SPACES);
       _mesa_update_tnl_spaces( ctx, new_state );
+   }
 
    if (new_state & prog_flags) {
       /* When we generate programs from fixed-function vertex/fragment state
        * this call may generate/bind a new program.  If so, we need to
        * propogate the _NEW_PROGRAM flag to the driver.
        */
+      COUNT_UPDATE(ctx, STATE_UPDATE_PROGRAM);
       new_prog_state |= update_program( ctx );
    }
 
-   if (new_state & _NEW_ARRAY)
+   /* Only the arrays in gl_vertex_array_object::NewArrays are updated */
+   if (new_state & _NEW_ARRAY) {
+      COUNT_UPDATE(ctx, STATE_UPDATE_CLIENT_ARRAYS);
       _mesa_update_vao_client_arrays(ctx, ctx->Array.VAO);
+   }
 
    if (ctx->Const.CheckArrayBounds &&
        new_state & (_NEW_ARRAY | _NEW_PROGRAM | _NEW_BUFFER_OBJECT)) {
+      COUNT_UPDATE(ctx, STATE_UPDATE_MAX_ELEMENT);
       _mesa_update_vao_max_element(ctx, ctx->Array.VAO);
    }
 
+   /* Drivers aren't told which lights changed */
+   if (ctx->NewState & _NEW_LIGHT_SOURCES) {
+      ctx->NewState = (ctx->NewState & ~_NEW_LIGHT_SOURCES) | _NEW_LIGHT;
+      ctx->Light._DirtyLights = 0x0;
+   }
+
  out:
    new_prog_state |= update_program_constants(ctx);
 
@@ -438,11 +495,63 @@ _mesa_update_state_locked( struct gl_context *ctx )
     */
    new_state = ctx->NewState | new_prog_state;
    ctx->NewState = 0;
+
+   /* Only drivers which look at gl_texture_attrib::_DirtyUnits get the
+    * precise flag, the others see any binding change as _NEW_TEXTURE.
+    */
+   if (new_state & _NEW_TEXTURE_UNITS) {
+      new_state &= ~_NEW_TEXTURE_UNITS;
+      if (ctx->DriverFlags.NewTextureUnits) {
+         ctx->NewDriverState |= ctx->DriverFlags.NewTextureUnits;
+      }
+      else {
+         new_state |= _NEW_TEXTURE;
+         BITSET_ZERO(ctx->Texture._DirtyUnits);
+      }
+   }
+
+   COUNT_UPDATE(ctx, STATE_UPDATE_DRIVER);
    ctx->Driver.UpdateState(ctx, new_state);
    ctx->Array.VAO->NewArrays = 0x0;
 }
 
 
+/**
+ * Print how often each derived state update ran, for MESA_VERBOSE=updates.
+ */
+void
+_mesa_print_state_updates(const struct gl_context *ctx)
+{
+   static const char *names[STATE_UPDATE_COUNT] = {
+      "calls",
+      "program enables",
+      "modelview/project",
+      "texture matrices",
+      "texture",
+      "texture units",
+      "framebuffer",
+      "draw buffer bounds",
+      "lighting",
+      "light sources",
+      "twoside",
+      "stencil",
+      "pixel",
+      "viewport matrix",
+      "multisample",
+      "tnl spaces",
+      "program",
+      "client arrays",
+      "max element",
+      "driver",
+   };
+   GLuint i;
+
+   _mesa_debug(ctx, "Derived state updates:\n");
+   for (i = 0; i < STATE_UPDATE_COUNT; i++)
+      _mesa_debug(ctx, "  %-20s %u\n", names[i], ctx->StateUpdates[i]);
+}
+
+
 /* This is the usual entrypoint for state updates:
  */
 void
@@ -38,6 +38,10 @@ extern void
 _mesa_update_state_locked(struct gl_context *ctx);
 
 
+extern void
+_mesa_print_state_updates(const struct gl_context *ctx);
+
+
 extern void
 _mesa_set_varying_vp_inputs(struct gl_context *ctx, GLbitfield64 varying_inputs);
 
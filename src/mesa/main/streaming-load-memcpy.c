@@ -29,6 +29,9 @@
 #include "main/macros.h"
 #include "main/streaming-load-memcpy.h"
 #include <smmintrin.h>
+#ifdef __GNUC__
+#include <cpuid.h>
+#endif
 
 /* Copies memory from src to dst, using SSE 4.1's MOVNTDQA to get streaming
  * read performance from uncached memory.
@@ -83,3 +86,107 @@ _mesa_streaming_load_memcpy(void *restrict dst, void *restrict src, size_t len)
       memcpy(d, s, len);
    }
 }
+
+void
+_mesa_streaming_load_memcpy_2d(void *dst, ptrdiff_t dst_stride,
+                               const void *src, ptrdiff_t src_stride,
+                               size_t width, unsigned height)
+{
+   char *d = dst;
+   char *s = (char *) src;
+   unsigned row;
+
+   if (dst_stride == (ptrdiff_t) width && src_stride == (ptrdiff_t) width) {
+      _mesa_streaming_load_memcpy(d, s, width * height);
+      return;
+   }
+
+   for (row = 0; row < height; row++) {
+      _mesa_streaming_load_memcpy(d, s, width);
+      d += dst_stride;
+      s += src_stride;
+   }
+}
+
+/* Copies memory from src to dst with MOVNTDQ, without the final fence. */
+static void
+streaming_store_memcpy(char *restrict d, const char *restrict s, size_t len)
+{
+   /* memcpy() the header up to a 16-byte boundary of the destination. */
+   if ((uintptr_t)d & 15) {
+      uintptr_t bytes_before_alignment_boundary = 16 - ((uintptr_t)d & 15);
+      size_t bytes = MIN2(bytes_before_alignment_boundary, len);
+
+      memcpy(d, s, bytes);
+      d += bytes;
+      s += bytes;
+      len -= bytes;
+   }
+
+   while (len >= 64) {
+      __m128i *dst_cacheline = (__m128i *)d;
+      const __m128i *src_cacheline = (const __m128i *)s;
+
+      __m128i temp1 = _mm_loadu_si128(src_cacheline + 0);
+      __m128i temp2 = _mm_loadu_si128(src_cacheline + 1);
+      __m128i temp3 = _mm_loadu_si128(src_cacheline + 2);
+      __m128i temp4 = _mm_loadu_si128(src_cacheline + 3);
+
+      _mm_stream_si128(dst_cacheline + 0, temp1);
+      _mm_stream_si128(dst_cacheline + 1, temp2);
+      _mm_stream_si128(dst_cacheline + 2, temp3);
+      _mm_stream_si128(dst_cacheline + 3, temp4);
+
+      d += 64;
+      s += 64;
+      len -= 64;
+   }
+
+   /* memcpy() the tail. */
+   if (len) {
+      memcpy(d, s, len);
+   }
+}
+
+void
+_mesa_streaming_store_memcpy_2d(void *dst, ptrdiff_t dst_stride,
+                                const void *src, ptrdiff_t src_stride,
+                                size_t width, unsigned height)
+{
+   char *d = dst;
+   const char *s = src;
+   unsigned row;
+
+   if (dst_stride == (ptrdiff_t) width && src_stride == (ptrdiff_t) width) {
+      streaming_store_memcpy(d, s, width * height);
+   }
+   else {
+      for (row = 0; row < height; row++) {
+         streaming_store_memcpy(d, s, width);
+         d += dst_stride;
+         s += src_stride;
+      }
+   }
+
+   /* Make the non-temporal stores visible before anyone else looks. */
+   _mm_sfence();
+}
+
+bool
+_mesa_streaming_memcpy_supported(void)
+{
+#ifdef __GNUC__
+   static int supported = -1;
+
+   if (supported < 0) {
+      unsigned eax, ebx, ecx, edx;
+
+      supported = __get_cpuid(1, &eax, &ebx, &ecx, &edx) &&
+                  (ecx & bit_SSE4_1);
+   }
+
+   return supported;
+#else
+   return false;
+#endif
+}
@@ -26,8 +26,101 @@
  *
  */
 
+#ifndef STREAMING_LOAD_MEMCPY_H
+#define STREAMING_LOAD_MEMCPY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
 /* Copies memory from src to dst, using SSE 4.1's MOVNTDQA to get streaming
  * read performance from uncached memory.
  */
 void
 _mesa_streaming_load_memcpy(void *restrict dst, void *restrict src, size_t len);
+
+/* Copies height rows of width bytes from src to dst, like
+ * _mesa_streaming_load_memcpy().
+ */
+void
+_mesa_streaming_load_memcpy_2d(void *dst, ptrdiff_t dst_stride,
+                               const void *src, ptrdiff_t src_stride,
+                               size_t width, unsigned height);
+
+/* Copies height rows of width bytes from src to dst with non-temporal
+ * stores, for writing write-combined memory without polluting the cache.
+ */
+void
+_mesa_streaming_store_memcpy_2d(void *dst, ptrdiff_t dst_stride,
+                                const void *src, ptrdiff_t src_stride,
+                                size_t width, unsigned height);
+
+/* Does the CPU support the SSE 4.1 the functions above need? */
+bool
+_mesa_streaming_memcpy_supported(void);
+
+
+/* Copies smaller than this are left to memcpy(), which is faster when
+ * the destination is cached after all.
+ */
+#define STREAMING_STORE_MIN_SIZE (256 * 1024)
+
+static inline void
+_mesa_memcpy_rows(void *dst, ptrdiff_t dst_stride,
+            const void *src, ptrdiff_t src_stride,
+            size_t width, unsigned height)
+{
+   char *d = (char *) dst;
+   const char *s = (const char *) src;
+   unsigned row;
+
+   if (dst_stride == (ptrdiff_t) width && src_stride == (ptrdiff_t) width) {
+      memcpy(d, s, width * height);
+      return;
+   }
+
+   for (row = 0; row < height; row++) {
+      memcpy(d, s, width);
+      d += dst_stride;
+      s += src_stride;
+   }
+}
+
+/* Copies rows out of memory which may be uncached, such as a mapping of
+ * a texture or renderbuffer, with streaming loads where available.
+ */
+static inline void
+_mesa_memcpy_rows_from_mapping(void *dst, ptrdiff_t dst_stride,
+                               const void *src, ptrdiff_t src_stride,
+                               size_t width, unsigned height)
+{
+#ifdef USE_SSE41
+   if (_mesa_streaming_memcpy_supported()) {
+      _mesa_streaming_load_memcpy_2d(dst, dst_stride, src, src_stride,
+                                     width, height);
+      return;
+   }
+#endif
+   _mesa_memcpy_rows(dst, dst_stride, src, src_stride, width, height);
+}
+
+/* Copies rows into memory which may be write-combined, such as a mapping
+ * of a texture, with non-temporal stores for large copies.
+ */
+static inline void
+_mesa_memcpy_rows_to_mapping(void *dst, ptrdiff_t dst_stride,
+                             const void *src, ptrdiff_t src_stride,
+                             size_t width, unsigned height)
+{
+#ifdef USE_SSE41
+   if (width * height >= STREAMING_STORE_MIN_SIZE &&
+       _mesa_streaming_memcpy_supported()) {
+      _mesa_streaming_store_memcpy_2d(dst, dst_stride, src, src_stride,
+                                      width, height);
+      return;
+   }
+#endif
+   _mesa_memcpy_rows(dst, dst_stride, src, src_stride, width, height);
+}
+
+#endif /* STREAMING_LOAD_MEMCPY_H */
@@ -83,7 +83,7 @@ _mesa_init_texture_s3tc( struct gl_context *ctx )
       dxtlibhandle = _mesa_dlopen(DXTN_LIBNAME, 0);
       if (!dxtlibhandle) {
 	 _mesa_warning(ctx, "couldn't open " DXTN_LIBNAME ", software DXTn "
-	    "compression/decompression unavailable");
+	    "decompression unavailable");
       }
       else {
          /* the fetch functions are not per context! Might be problematic... */
@@ -104,7 +104,7 @@ _mesa_init_texture_s3tc( struct gl_context *ctx )
              !fetch_ext_rgba_dxt5 ||
              !ext_tx_compress_dxtn) {
 	    _mesa_warning(ctx, "couldn't reference all symbols in "
-	       DXTN_LIBNAME ", software DXTn compression/decompression "
+	       DXTN_LIBNAME ", software DXTn decompression "
 	       "unavailable");
             fetch_ext_rgb_dxt1 = NULL;
             fetch_ext_rgba_dxt1 = NULL;
@@ -124,6 +124,345 @@ _mesa_init_texture_s3tc( struct gl_context *ctx )
 #endif
 }
 
+/*
+ * Built-in DXTn compressor, used when the external library isn't
+ * available.  It fits the colors of each block to their principal axis,
+ * which is fast and good enough for textures compressed on upload.
+ */
+
+/** Convert an RGB888 color to RGB565, rounding to nearest */
+static GLuint
+rgb_to_565(const GLubyte *rgb)
+{
+   return (((rgb[0] * 31 + 127) / 255) << 11) |
+          (((rgb[1] * 63 + 127) / 255) << 5) |
+          ((rgb[2] * 31 + 127) / 255);
+}
+
+
+/** Expand an RGB565 color to RGB888 like decoders do */
+static void
+rgb_from_565(GLuint c, GLint *rgb)
+{
+   const GLint r = (c >> 11) & 0x1f, g = (c >> 5) & 0x3f, b = c & 0x1f;
+
+   rgb[0] = (r << 3) | (r >> 2);
+   rgb[1] = (g << 2) | (g >> 4);
+   rgb[2] = (b << 3) | (b >> 2);
+}
+
+
+static void
+write_le16(GLubyte *dst, GLuint value)
+{
+   dst[0] = value & 0xff;
+   dst[1] = (value >> 8) & 0xff;
+}
+
+
+/**
+ * Encode the 8 byte color block of 16 RGBA pixels.
+ * \param use_alpha  pixels with alpha < 128 are made transparent (DXT1 only)
+ */
+static void
+encode_color_block(GLubyte *blkaddr, GLubyte block[16][4],
+                   GLboolean use_alpha)
+{
+   GLboolean transparent[16], first = GL_TRUE;
+   GLfloat mean[3] = { 0.0f, 0.0f, 0.0f };
+   GLfloat cov[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+   GLfloat axis[3] = { 1.0f, 1.0f, 1.0f };
+   GLfloat minDot = 0.0f, maxDot = 0.0f;
+   GLint palette[4][3];
+   GLuint c0, c1, indices = 0, minPixel = 0, maxPixel = 0;
+   GLuint i, iter, n = 0, numColors;
+
+   for (i = 0; i < 16; i++) {
+      transparent[i] = use_alpha && block[i][3] < 128;
+      if (!transparent[i]) {
+         mean[0] += block[i][0];
+         mean[1] += block[i][1];
+         mean[2] += block[i][2];
+         n++;
+      }
+   }
+
+   if (n == 0) {
+      /* all transparent: three color mode with every index 3 */
+      write_le16(blkaddr, 0);
+      write_le16(blkaddr + 2, 0);
+      blkaddr[4] = blkaddr[5] = blkaddr[6] = blkaddr[7] = 0xff;
+      return;
+   }
+
+   mean[0] /= n;
+   mean[1] /= n;
+   mean[2] /= n;
+
+   for (i = 0; i < 16; i++) {
+      GLfloat r, g, b;
+
+      if (transparent[i])
+         continue;
+
+      r = block[i][0] - mean[0];
+      g = block[i][1] - mean[1];
+      b = block[i][2] - mean[2];
+      cov[0] += r * r;
+      cov[1] += r * g;
+      cov[2] += r * b;
+      cov[3] += g * g;
+      cov[4] += g * b;
+      cov[5] += b * b;
+   }
+
+   /* A few power iterations find the principal axis well enough */
+   for (iter = 0; iter < 4; iter++) {
+      const GLfloat x = axis[0] * cov[0] + axis[1] * cov[1] + axis[2] * cov[2];
+      const GLfloat y = axis[0] * cov[1] + axis[1] * cov[3] + axis[2] * cov[4];
+      const GLfloat z = axis[0] * cov[2] + axis[1] * cov[4] + axis[2] * cov[5];
+      const GLfloat len = MAX3(FABSF(x), FABSF(y), FABSF(z));
+
+      if (len < 1e-6f)
+         break;   /* all the same color, or nearly so */
+
+      axis[0] = x / len;
+      axis[1] = y / len;
+      axis[2] = z / len;
+   }
+
+   /* The end points are the colors at the extremes of the axis */
+   for (i = 0; i < 16; i++) {
+      const GLfloat dot = block[i][0] * axis[0] +
+                          block[i][1] * axis[1] +
+                          block[i][2] * axis[2];
+
+      if (transparent[i])
+         continue;
+
+      if (first || dot < minDot) {
+         minDot = dot;
+         minPixel = i;
+      }
+      if (first || dot > maxDot) {
+         maxDot = dot;
+         maxPixel = i;
+      }
+      first = GL_FALSE;
+   }
+
+   c0 = rgb_to_565(block[maxPixel]);
+   c1 = rgb_to_565(block[minPixel]);
+
+   if (use_alpha && memchr(transparent, GL_TRUE, 16)) {
+      /* three colors and transparent black need c0 <= c1 */
+      if (c0 > c1) {
+         const GLuint t = c0;
+         c0 = c1;
+         c1 = t;
+      }
+      numColors = 3;
+   }
+   else {
+      /* four colors need c0 > c1, if they're equal index 0 wins anyway */
+      if (c0 < c1) {
+         const GLuint t = c0;
+         c0 = c1;
+         c1 = t;
+      }
+      numColors = 4;
+   }
+
+   rgb_from_565(c0, palette[0]);
+   rgb_from_565(c1, palette[1]);
+   for (i = 0; i < 3; i++) {
+      if (numColors == 4) {
+         palette[2][i] = (2 * palette[0][i] + palette[1][i]) / 3;
+         palette[3][i] = (palette[0][i] + 2 * palette[1][i]) / 3;
+      }
+      else {
+         palette[2][i] = (palette[0][i] + palette[1][i]) / 2;
+      }
+   }
+
+   for (i = 0; i < 16; i++) {
+      GLuint best = 0, j;
+      GLint bestDist = INT_MAX;
+
+      if (transparent[i]) {
+         indices |= 3u << (2 * i);
+         continue;
+      }
+
+      for (j = 0; j < numColors; j++) {
+         const GLint dr = block[i][0] - palette[j][0];
+         const GLint dg = block[i][1] - palette[j][1];
+         const GLint db = block[i][2] - palette[j][2];
+         const GLint dist = dr * dr + dg * dg + db * db;
+
+         if (dist < bestDist) {
+            bestDist = dist;
+            best = j;
+         }
+      }
+
+      indices |= best << (2 * i);
+   }
+
+   write_le16(blkaddr, c0);
+   write_le16(blkaddr + 2, c1);
+   write_le16(blkaddr + 4, indices & 0xffff);
+   write_le16(blkaddr + 6, indices >> 16);
+}
+
+
+/** Encode the 8 byte explicit alpha block of DXT3 */
+static void
+encode_dxt3_alpha_block(GLubyte *blkaddr, GLubyte block[16][4])
+{
+   GLuint i;
+
+   for (i = 0; i < 8; i++) {
+      const GLuint lo = (block[2 * i][3] * 15 + 127) / 255;
+      const GLuint hi = (block[2 * i + 1][3] * 15 + 127) / 255;
+
+      blkaddr[i] = lo | (hi << 4);
+   }
+}
+
+
+/** Encode the 8 byte interpolated alpha block of DXT5 */
+static void
+encode_dxt5_alpha_block(GLubyte *blkaddr, GLubyte block[16][4])
+{
+   GLint palette[8];
+   GLuint alphaMin = 255, alphaMax = 0, i, j;
+   uint64_t indices = 0;
+
+   for (i = 0; i < 16; i++) {
+      alphaMin = MIN2(alphaMin, block[i][3]);
+      alphaMax = MAX2(alphaMax, block[i][3]);
+   }
+
+   blkaddr[0] = alphaMax;
+   blkaddr[1] = alphaMin;
+
+   if (alphaMax > alphaMin) {
+      /* eight alpha values, indices 2..7 interpolated */
+      palette[0] = alphaMax;
+      palette[1] = alphaMin;
+      for (j = 2; j < 8; j++)
+         palette[j] = ((8 - j) * alphaMax + (j - 1) * alphaMin) / 7;
+
+      for (i = 0; i < 16; i++) {
+         GLuint best = 0;
+         GLint bestDist = INT_MAX;
+
+         for (j = 0; j < 8; j++) {
+            const GLint dist = abs(block[i][3] - palette[j]);
+
+            if (dist < bestDist) {
+               bestDist = dist;
+               best = j;
+            }
+         }
+
+         indices |= (uint64_t) best << (3 * i);
+      }
+   }
+
+   for (i = 0; i < 6; i++)
+      blkaddr[2 + i] = (indices >> (8 * i)) & 0xff;
+}
+
+
+/**
+ * Compress an image of srccomps GLubyte components per pixel.  Same
+ * interface as tx_compress_dxtn() of the external library.
+ */
+static void
+compress_dxtn(GLint srccomps, GLint width, GLint height,
+              const GLubyte *srcPixData, GLenum destFormat,
+              GLubyte *dest, GLint dstRowStride)
+{
+   const GLboolean dxt1 = destFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ||
+                          destFormat == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+   const GLint blockSize = dxt1 ? 8 : 16;
+   const GLint blocksPerRow = (width + 3) / 4;
+   GLint bx, by;
+
+   if (dstRowStride < blocksPerRow * blockSize)
+      dstRowStride = blocksPerRow * blockSize;
+
+   for (by = 0; by < height; by += 4) {
+      GLubyte *blkaddr = dest + (by / 4) * dstRowStride;
+
+      for (bx = 0; bx < width; bx += 4) {
+         GLubyte block[16][4];
+         GLint x, y;
+
+         /* Partial blocks at the edges replicate the last row / column */
+         for (y = 0; y < 4; y++) {
+            const GLint sy = MIN2(by + y, height - 1);
+
+            for (x = 0; x < 4; x++) {
+               const GLint sx = MIN2(bx + x, width - 1);
+               const GLubyte *src =
+                  srcPixData + (sy * width + sx) * srccomps;
+
+               block[y * 4 + x][0] = src[0];
+               block[y * 4 + x][1] = src[1];
+               block[y * 4 + x][2] = src[2];
+               block[y * 4 + x][3] = srccomps == 4 ? src[3] : 255;
+            }
+         }
+
+         switch (destFormat) {
+         case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+            encode_color_block(blkaddr, block, GL_FALSE);
+            break;
+         case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+            encode_color_block(blkaddr, block, srccomps == 4);
+            break;
+         case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+            encode_dxt3_alpha_block(blkaddr, block);
+            encode_color_block(blkaddr + 8, block, GL_FALSE);
+            break;
+         case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+            encode_dxt5_alpha_block(blkaddr, block);
+            encode_color_block(blkaddr + 8, block, GL_FALSE);
+            break;
+         default:
+            assert(!"unexpected DXTn format");
+            return;
+         }
+
+         blkaddr += blockSize;
+      }
+   }
+}
+
+
+/**
+ * Compress with the external library if it's loaded, else with the
+ * built-in compressor.
+ */
+static void
+tx_compress_dxtn(GLint srccomps, GLint width, GLint height,
+                 const GLubyte *srcPixData, GLenum destFormat,
+                 GLubyte *dest, GLint dstRowStride)
+{
+   if (ext_tx_compress_dxtn) {
+      (*ext_tx_compress_dxtn)(srccomps, width, height, srcPixData,
+                              destFormat, dest, dstRowStride);
+   }
+   else {
+      compress_dxtn(srccomps, width, height, srcPixData,
+                    destFormat, dest, dstRowStride);
+   }
+}
+
+
 /**
  * Store user's image in rgb_dxt1 format.
  */
@@ -161,14 +500,9 @@ _mesa_texstore_rgb_dxt1(TEXSTORE_PARAMS)
 
    dst = dstSlices[0];
 
-   if (ext_tx_compress_dxtn) {
-      (*ext_tx_compress_dxtn)(3, srcWidth, srcHeight, pixels,
-                              GL_COMPRESSED_RGB_S3TC_DXT1_EXT,
-                              dst, dstRowStride);
-   }
-   else {
-      _mesa_warning(ctx, "external dxt library not available: texstore_rgb_dxt1");
-   }
+   tx_compress_dxtn(3, srcWidth, srcHeight, pixels,
+                    GL_COMPRESSED_RGB_S3TC_DXT1_EXT,
+                    dst, dstRowStride);
 
    free((void *) tempImage);
 
@@ -213,14 +547,9 @@ _mesa_texstore_rgba_dxt1(TEXSTORE_PARAMS)
 
    dst = dstSlices[0];
 
-   if (ext_tx_compress_dxtn) {
-      (*ext_tx_compress_dxtn)(4, srcWidth, srcHeight, pixels,
-                              GL_COMPRESSED_RGBA_S3TC_DXT1_EXT,
-                              dst, dstRowStride);
-   }
-   else {
-      _mesa_warning(ctx, "external dxt library not available: texstore_rgba_dxt1");
-   }
+   tx_compress_dxtn(4, srcWidth, srcHeight, pixels,
+                    GL_COMPRESSED_RGBA_S3TC_DXT1_EXT,
+                    dst, dstRowStride);
 
    free((void*) tempImage);
 
@@ -264,14 +593,9 @@ _mesa_texstore_rgba_dxt3(TEXSTORE_PARAMS)
 
    dst = dstSlices[0];
 
-   if (ext_tx_compress_dxtn) {
-      (*ext_tx_compress_dxtn)(4, srcWidth, srcHeight, pixels,
-                              GL_COMPRESSED_RGBA_S3TC_DXT3_EXT,
-                              dst, dstRowStride);
-   }
-   else {
-      _mesa_warning(ctx, "external dxt library not available: texstore_rgba_dxt3");
-   }
+   tx_compress_dxtn(4, srcWidth, srcHeight, pixels,
+                    GL_COMPRESSED_RGBA_S3TC_DXT3_EXT,
+                    dst, dstRowStride);
 
    free((void *) tempImage);
 
@@ -315,14 +639,9 @@ _mesa_texstore_rgba_dxt5(TEXSTORE_PARAMS)
 
    dst = dstSlices[0];
 
-   if (ext_tx_compress_dxtn) {
-      (*ext_tx_compress_dxtn)(4, srcWidth, srcHeight, pixels,
-                              GL_COMPRESSED_RGBA_S3TC_DXT5_EXT,
-                              dst, dstRowStride);
-   }
-   else {
-      _mesa_warning(ctx, "external dxt library not available: texstore_rgba_dxt5");
-   }
+   tx_compress_dxtn(4, srcWidth, srcHeight, pixels,
+                    GL_COMPRESSED_RGBA_S3TC_DXT5_EXT,
+                    dst, dstRowStride);
 
    free((void *) tempImage);
 
@@ -40,6 +40,7 @@
 #include "mtypes.h"
 #include "pack.h"
 #include "pbo.h"
+#include "streaming-load-memcpy.h"
 #include "texcompress.h"
 #include "texgetimage.h"
 #include "teximage.h"
@@ -587,17 +588,8 @@ get_tex_memcpy(struct gl_context *ctx, GLenum format, GLenum type,
                                   GL_MAP_READ_BIT, &src, &srcRowStride);
 
       if (src) {
-         if (bytesPerRow == dstRowStride && bytesPerRow == srcRowStride) {
-            memcpy(dst, src, bytesPerRow * texImage->Height);
-         }
-         else {
-            GLuint row;
-            for (row = 0; row < texImage->Height; row++) {
-               memcpy(dst, src, bytesPerRow);
-               dst += dstRowStride;
-               src += srcRowStride;
-            }
-         }
+         _mesa_memcpy_rows_from_mapping(dst, dstRowStride, src, srcRowStride,
+                                        bytesPerRow, texImage->Height);
 
          /* unmap src texture buffer */
          ctx->Driver.UnmapTextureImage(ctx, texImage, 0);
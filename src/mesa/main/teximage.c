@@ -594,6 +594,7 @@ set_tex_image(struct gl_texture_object *tObj,
       assert(level == 0);
 
    tObj->Image[face][level] = texImage;
+   tObj->_Generation++;
 
    /* Set the 'back' pointer */
    texImage->TexObject = tObj;
@@ -1308,6 +1309,7 @@ _mesa_init_teximage_fields(struct gl_context *ctx,
    ASSERT(depth >= 0);
 
    target = img->TexObject->Target;
+   img->TexObject->_Generation++;
    img->_BaseFormat = _mesa_base_tex_format( ctx, internalFormat );
    ASSERT(img->_BaseFormat > 0);
    img->InternalFormat = internalFormat;
@@ -1415,6 +1417,8 @@ _mesa_clear_texture_image(struct gl_context *ctx,
 {
    ctx->Driver.FreeTextureImageBuffer(ctx, texImage);
    clear_teximage_fields(texImage);
+   if (texImage->TexObject)
+      texImage->TexObject->_Generation++;
 }
 
 
@@ -4235,6 +4239,9 @@ texbufferrange(struct gl_context *ctx, GLenum target, GLenum internalFormat,
    _mesa_lock_texture(ctx, texObj);
    {
       _mesa_reference_buffer_object(ctx, &texObj->BufferObject, bufObj);
+      /* Shader images may write into it */
+      if (_mesa_is_bufferobj(bufObj))
+         _mesa_bufferobj_gpu_written(bufObj);
       texObj->BufferObjectFormat = internalFormat;
       texObj->_BufferObjectFormat = format;
       texObj->BufferOffset = offset;
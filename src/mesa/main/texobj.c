@@ -121,6 +121,7 @@ _mesa_initialize_texture_object( struct gl_context *ctx,
    obj->Target = target;
    obj->Priority = 1.0F;
    obj->BaseLevel = 0;
+   obj->_Generation = 1;
    obj->MaxLevel = 1000;
 
    /* must be one; no support for (YUV) planes in separate buffers */
@@ -286,6 +287,7 @@ _mesa_copy_texture_object( struct gl_texture_object *dest,
    dest->GenerateMipmap = src->GenerateMipmap;
    dest->_BaseComplete = src->_BaseComplete;
    dest->_MipmapComplete = src->_MipmapComplete;
+   dest->_Generation++;
    COPY_4V(dest->Swizzle, src->Swizzle);
    dest->_Swizzle = src->_Swizzle;
 
@@ -470,6 +472,8 @@ _mesa_test_texobj_completeness( const struct gl_context *ctx,
    const struct gl_texture_image *baseImage;
    GLint maxLevels = 0;
 
+   t->_CompleteGeneration = t->_Generation;
+
    /* We'll set these to FALSE if tests fail below */
    t->_BaseComplete = GL_TRUE;
    t->_MipmapComplete = GL_TRUE;
@@ -726,6 +730,7 @@ _mesa_dirty_texobj(struct gl_context *ctx, struct gl_texture_object *texObj)
 {
    texObj->_BaseComplete = GL_FALSE;
    texObj->_MipmapComplete = GL_FALSE;
+   texObj->_Generation++;
    ctx->NewState |= _NEW_TEXTURE;
 }
 
@@ -1337,7 +1342,7 @@ _mesa_BindTexture( GLenum target, GLuint texName )
    }
 
    /* flush before changing binding */
-   FLUSH_VERTICES(ctx, _NEW_TEXTURE);
+   _mesa_flag_texture_unit(ctx, ctx->Texture.CurrentUnit);
 
    /* Do the actual binding.  The refcount on the previously bound
     * texture object will be decremented.  It'll be deleted if the
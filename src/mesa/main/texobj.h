@@ -125,6 +125,19 @@ extern void
 _mesa_test_texobj_completeness( const struct gl_context *ctx,
                                 struct gl_texture_object *obj );
 
+
+/**
+ * Test the completeness of the texture object again, unless nothing it
+ * depends on has changed since the last test.
+ */
+static inline void
+_mesa_update_texobj_completeness(const struct gl_context *ctx,
+                                 struct gl_texture_object *texObj)
+{
+   if (texObj->_CompleteGeneration != texObj->_Generation)
+      _mesa_test_texobj_completeness(ctx, texObj);
+}
+
 extern GLboolean
 _mesa_cube_complete(const struct gl_texture_object *texObj);
 
@@ -522,9 +522,11 @@ update_texgen(struct gl_context *ctx)
  * flags are updated by _mesa_update_texture_matrices, above.
  *
  * \param ctx GL context.
+ * \param dirty_units  if not NULL, only the bindings of these units
+ *                     changed and the other units are up to date
  */
 static void
-update_texture_state( struct gl_context *ctx )
+update_texture_state( struct gl_context *ctx, const GLuint *dirty_units )
 {
    GLuint unit;
    struct gl_program *prog[MESA_SHADER_STAGES];
@@ -544,9 +546,11 @@ update_texture_state( struct gl_context *ctx )
    }
 
    /* TODO: only set this if there are actual changes */
-   ctx->NewState |= _NEW_TEXTURE;
+   if (ctx->NewState & (_NEW_TEXTURE | _NEW_PROGRAM))
+      ctx->NewState |= _NEW_TEXTURE;
 
-   ctx->Texture._EnabledUnits = 0x0;
+   if (!dirty_units)
+      ctx->Texture._EnabledUnits = 0x0;
    ctx->Texture._GenFlags = 0x0;
    ctx->Texture._TexMatEnabled = 0x0;
    ctx->Texture._TexGenEnabled = 0x0;
@@ -560,6 +564,11 @@ update_texture_state( struct gl_context *ctx )
       GLbitfield enabledTargets = 0x0;
       GLuint texIndex;
 
+      if (dirty_units && !BITSET_TEST(dirty_units, unit))
+         continue;
+
+      ctx->Texture._EnabledUnits &= ~(1 << unit);
+
       /* Get the bitmask of texture target enables.
        * enableBits will be a mask of the TEXTURE_*_BIT flags indicating
        * which texture targets are enabled (fixed function) or referenced
@@ -595,9 +604,7 @@ update_texture_state( struct gl_context *ctx )
             struct gl_sampler_object *sampler = texUnit->Sampler ?
                texUnit->Sampler : &texObj->Sampler;
 
-            if (!_mesa_is_texture_complete(texObj, sampler)) {
-               _mesa_test_texobj_completeness(ctx, texObj);
-            }
+            _mesa_update_texobj_completeness(ctx, texObj);
             if (_mesa_is_texture_complete(texObj, sampler)) {
                texUnit->_ReallyEnabled = 1 << texIndex;
                _mesa_reference_texobj(&texUnit->_Current, texObj);
@@ -637,9 +644,6 @@ update_texture_state( struct gl_context *ctx )
 
       ctx->Texture._EnabledUnits |= (1 << unit);
 
-      if (enabledTargetsByStage[MESA_SHADER_FRAGMENT])
-         enabledFragUnits |= (1 << unit);
-
       if (!prog[MESA_SHADER_FRAGMENT])
          update_tex_combine(ctx, texUnit);
    }
@@ -653,6 +657,12 @@ update_texture_state( struct gl_context *ctx )
          coordMask;
    }
    else {
+      /* Without a fragment program the units used are the enabled ones */
+      for (unit = 0; unit < ctx->Const.MaxCombinedTextureImageUnits; unit++) {
+         if ((ctx->Texture._EnabledUnits & (1 << unit)) &&
+             ctx->Texture.Unit[unit].Enabled)
+            enabledFragUnits |= (1 << unit);
+      }
       ctx->Texture._EnabledCoordUnits = enabledFragUnits;
    }
 
@@ -673,7 +683,9 @@ _mesa_update_texture( struct gl_context *ctx, GLuint new_state )
       update_texture_matrices( ctx );
 
    if (new_state & (_NEW_TEXTURE | _NEW_PROGRAM))
-      update_texture_state( ctx );
+      update_texture_state( ctx, NULL );
+   else if (new_state & _NEW_TEXTURE_UNITS)
+      update_texture_state( ctx, ctx->Texture._DirtyUnits );
 }
 
 
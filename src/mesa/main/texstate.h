@@ -33,6 +33,8 @@
 
 
 #include "compiler.h"
+#include "bitset.h"
+#include "context.h"
 #include "mtypes.h"
 
 
@@ -48,6 +50,18 @@ _mesa_get_current_tex_unit(struct gl_context *ctx)
 }
 
 
+/**
+ * Flag a change of the texture or sampler object bound to a unit.  This is
+ * cheaper for drivers than _NEW_TEXTURE, which may mean anything changed.
+ */
+static inline void
+_mesa_flag_texture_unit(struct gl_context *ctx, GLuint unit)
+{
+   FLUSH_VERTICES(ctx, _NEW_TEXTURE_UNITS);
+   BITSET_SET(ctx->Texture._DirtyUnits, unit);
+}
+
+
 extern void
 _mesa_copy_texture_state( const struct gl_context *src, struct gl_context *dst );
 
@@ -61,6 +61,7 @@
 #include "mtypes.h"
 #include "pack.h"
 #include "pbo.h"
+#include "streaming-load-memcpy.h"
 #include "imports.h"
 #include "texcompress.h"
 #include "texcompress_fxt1.h"
@@ -74,6 +75,12 @@
 #include "../../gallium/auxiliary/util/u_format_rgb9e5.h"
 #include "../../gallium/auxiliary/util/u_format_r11g11b10f.h"
 
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 
 enum {
    ZERO = 4, 
@@ -662,6 +669,107 @@ _mesa_make_temp_ubyte_image(struct gl_context *ctx, GLuint dims,
 }
 
 
+#if defined(__SSE2__)
+
+/**
+ * swizzle_copy() of 4 component pixels to 4 component pixels, four at a
+ * time.
+ * With SSSE3 a byte shuffle does it, otherwise each component is shifted
+ * into place separately.
+ * \return number of pixels done
+ */
+static GLuint
+swizzle_copy_4_to_4_sse2(GLubyte *dst, const GLubyte *src,
+                         const GLubyte *map, GLuint count)
+{
+   GLuint i, j;
+#if defined(__SSSE3__)
+   GLubyte shuffle[16], constant[16];
+   __m128i shuf, cons;
+
+   for (i = 0; i < 4; i++) {
+      for (j = 0; j < 4; j++) {
+         shuffle[i * 4 + j] = map[j] < 4 ? i * 4 + map[j] : 0x80;
+         constant[i * 4 + j] = map[j] == ONE ? 0xff : 0;
+      }
+   }
+   shuf = _mm_loadu_si128((const __m128i *) shuffle);
+   cons = _mm_loadu_si128((const __m128i *) constant);
+
+   for (i = 0; i + 4 <= count; i += 4) {
+      const __m128i p = _mm_loadu_si128((const __m128i *) (src + i * 4));
+      _mm_storeu_si128((__m128i *) (dst + i * 4),
+                       _mm_or_si128(_mm_shuffle_epi8(p, shuf), cons));
+   }
+#else
+   const __m128i mask = _mm_set1_epi32(0xff);
+   __m128i cons = _mm_setzero_si128();
+
+   /* computed as if little endian, so the bytes are in memory order */
+   for (j = 0; j < 4; j++) {
+      if (map[j] == ONE)
+         cons = _mm_or_si128(cons, _mm_set1_epi32(0xff << (8 * j)));
+   }
+
+   for (i = 0; i + 4 <= count; i += 4) {
+      const __m128i p = _mm_loadu_si128((const __m128i *) (src + i * 4));
+      __m128i res = cons;
+
+      for (j = 0; j < 4; j++) {
+         if (map[j] < 4) {
+            __m128i c = _mm_srl_epi32(p, _mm_cvtsi32_si128(8 * map[j]));
+            c = _mm_and_si128(c, mask);
+            res = _mm_or_si128(res, _mm_sll_epi32(c, _mm_cvtsi32_si128(8 * j)));
+         }
+      }
+
+      _mm_storeu_si128((__m128i *) (dst + i * 4), res);
+   }
+#endif
+
+   return i;
+}
+
+#endif /* __SSE2__ */
+
+
+#if defined(__SSSE3__)
+
+/**
+ * swizzle_copy() of 3 component pixels to 4 component pixels, such as
+ * GL_RGB to RGBA8888, four at a time.
+ * \return number of pixels done
+ */
+static GLuint
+swizzle_copy_3_to_4_ssse3(GLubyte *dst, const GLubyte *src,
+                          const GLubyte *map, GLuint count)
+{
+   GLubyte shuffle[16], constant[16];
+   __m128i shuf, cons;
+   GLuint i, j;
+
+   for (i = 0; i < 4; i++) {
+      for (j = 0; j < 4; j++) {
+         shuffle[i * 4 + j] = map[j] < 3 ? i * 3 + map[j] : 0x80;
+         constant[i * 4 + j] = map[j] == ONE ? 0xff : 0;
+      }
+   }
+   shuf = _mm_loadu_si128((const __m128i *) shuffle);
+   cons = _mm_loadu_si128((const __m128i *) constant);
+
+   /* Four pixels are 12 bytes but 16 are loaded, stay inside the source */
+   for (i = 0; i + 6 <= count; i += 4) {
+      const __m128i p = _mm_loadu_si128((const __m128i *) (src + i * 3));
+      _mm_storeu_si128((__m128i *) (dst + i * 4),
+                       _mm_or_si128(_mm_shuffle_epi8(p, shuf), cons));
+   }
+
+   return i;
+}
+
+#endif /* __SSSE3__ */
+
+
 /**
  * Copy GLubyte pixels from <src> to <dst> with swizzling.
  * \param dst  destination pixels
@@ -706,6 +814,23 @@ swizzle_copy(GLubyte *dst, GLuint dstComponents, const GLubyte *src,
    ASSERT(srcComponents <= 4);
    ASSERT(dstComponents <= 4);
 
+#if defined(__SSE2__)
+   if (dstComponents == 4 && srcComponents == 4) {
+      const GLuint done = swizzle_copy_4_to_4_sse2(dst, src, map, count);
+      dst += done * 4;
+      src += done * 4;
+      count -= done;
+   }
+#endif
+#if defined(__SSSE3__)
+   if (dstComponents == 4 && srcComponents == 3) {
+      const GLuint done = swizzle_copy_3_to_4_ssse3(dst, src, map, count);
+      dst += done * 4;
+      src += done * 3;
+      count -= done;
+   }
+#endif
+
    switch (dstComponents) {
    case 4:
       switch (srcComponents) {
@@ -940,29 +1065,14 @@ memcpy_texture(struct gl_context *ctx,
    const GLuint texelBytes = _mesa_get_format_bytes(dstFormat);
    const GLint bytesPerRow = srcWidth * texelBytes;
 
-   if (dstRowStride == srcRowStride &&
-       dstRowStride == bytesPerRow) {
-      /* memcpy image by image */
-      GLint img;
-      for (img = 0; img < srcDepth; img++) {
-         GLubyte *dstImage = dstSlices[img];
-         memcpy(dstImage, srcImage, bytesPerRow * srcHeight);
-         srcImage += srcImageStride;
-      }
-   }
-   else {
-      /* memcpy row by row */
-      GLint img, row;
-      for (img = 0; img < srcDepth; img++) {
-         const GLubyte *srcRow = srcImage;
-         GLubyte *dstRow = dstSlices[img];
-         for (row = 0; row < srcHeight; row++) {
-            memcpy(dstRow, srcRow, bytesPerRow);
-            dstRow += dstRowStride;
-            srcRow += srcRowStride;
-         }
-         srcImage += srcImageStride;
-      }
+   GLint img;
+
+   /* The destination may well be a write-combined mapping */
+   for (img = 0; img < srcDepth; img++) {
+      _mesa_memcpy_rows_to_mapping(dstSlices[img], dstRowStride,
+                                   srcImage, srcRowStride,
+                                   bytesPerRow, srcHeight);
+      srcImage += srcImageStride;
    }
 }
 
@@ -539,6 +539,9 @@ bind_buffer_range(struct gl_context *ctx, GLuint index,
 
    obj->BufferNames[index] = bufObj->Name;
 
+   if (_mesa_is_bufferobj(bufObj))
+      _mesa_bufferobj_gpu_written(bufObj);
+
    obj->Offset[index] = offset;
    obj->RequestedSize[index] = size;
 }
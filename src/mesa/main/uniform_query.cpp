@@ -583,6 +583,81 @@ _mesa_propagate_uniforms_to_driver_storage(struct gl_uniform_storage *uni,
    }
 }
 
+/**
+ * Flush before changing the uniforms of \p shProg, telling the driver which
+ * stages' constants change if it wants to know.
+ */
+static void
+flush_uniform_constants(struct gl_context *ctx,
+                        const struct gl_shader_program *shProg)
+{
+   GLbitfield new_driver_state = 0;
+
+   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
+      if (!shProg->_LinkedShaders[i])
+         continue;
+
+      if (!ctx->DriverFlags.NewShaderConstants[i]) {
+         FLUSH_VERTICES(ctx, _NEW_PROGRAM_CONSTANTS);
+         return;
+      }
+
+      new_driver_state |= ctx->DriverFlags.NewShaderConstants[i];
+   }
+
+   FLUSH_VERTICES(ctx, 0);
+   ctx->NewDriverState |= new_driver_state;
+}
+
+/**
+ * Record that uniform \p loc of \p shProg has to be propagated to the
+ * driver storage before the next draw.
+ */
+static inline void
+mark_uniform_dirty(struct gl_shader_program *shProg, unsigned loc)
+{
+   if (shProg->UniformDirtyBegin == shProg->UniformDirtyEnd) {
+      shProg->UniformDirtyBegin = loc;
+      shProg->UniformDirtyEnd = loc + 1;
+   } else {
+      shProg->UniformDirtyBegin = MIN2(shProg->UniformDirtyBegin, loc);
+      shProg->UniformDirtyEnd = MAX2(shProg->UniformDirtyEnd, loc + 1);
+   }
+}
+
+/**
+ * Propagate the uniforms changed since the last draw to the driver storage
+ * of the bound programs.
+ *
+ * glUniform* only updates the "actual type" backing storage, so an
+ * application setting hundreds of uniforms per draw converts and copies
+ * each value into the driver's storage once here rather than on every call.
+ * Programs that aren't bound keep their dirty range until they are.
+ *
+ * Must be called before anything reads the driver storage, i.e. before
+ * drawing; _mesa_valid_to_render() does this.
+ */
+extern "C" void
+_mesa_flush_uniforms(struct gl_context *ctx)
+{
+   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
+      struct gl_shader_program *shProg = ctx->Shader.CurrentProgram[i];
+
+      if (!shProg || shProg->UniformDirtyBegin == shProg->UniformDirtyEnd)
+         continue;
+
+      for (unsigned loc = shProg->UniformDirtyBegin;
+           loc < shProg->UniformDirtyEnd; loc++) {
+         struct gl_uniform_storage *uni = &shProg->UniformStorage[loc];
+
+         _mesa_propagate_uniforms_to_driver_storage(uni, 0,
+                                                    MAX2(1, uni->array_elements));
+      }
+
+      shProg->UniformDirtyBegin = shProg->UniformDirtyEnd = 0;
+   }
+}
+
 /**
  * Called via glUniform*() functions.
  */
@@ -767,7 +842,7 @@ _mesa_uniform(struct gl_context *ctx, struct gl_shader_program *shProg,
       count = MIN2(count, (int) (uni->array_elements - offset));
    }
 
-   FLUSH_VERTICES(ctx, _NEW_PROGRAM_CONSTANTS);
+   flush_uniform_constants(ctx, shProg);
 
    /* Store the data in the "actual type" backing storage for the uniform.
     */
@@ -792,7 +867,7 @@ _mesa_uniform(struct gl_context *ctx, struct gl_shader_program *shProg,
 
    uni->initialized = true;
 
-   _mesa_propagate_uniforms_to_driver_storage(uni, offset, count);
+   mark_uniform_dirty(shProg, loc);
 
    /* If the uniform is a sampler, do the extra magic necessary to propagate
     * the changes through.
@@ -939,7 +1014,7 @@ _mesa_uniform_matrix(struct gl_context *ctx, struct gl_shader_program *shProg,
       count = MIN2(count, (int) (uni->array_elements - offset));
    }
 
-   FLUSH_VERTICES(ctx, _NEW_PROGRAM_CONSTANTS);
+   flush_uniform_constants(ctx, shProg);
 
    /* Store the data in the "actual type" backing storage for the uniform.
     */
@@ -968,7 +1043,7 @@ _mesa_uniform_matrix(struct gl_context *ctx, struct gl_shader_program *shProg,
 
    uni->initialized = true;
 
-   _mesa_propagate_uniforms_to_driver_storage(uni, offset, count);
+   mark_uniform_dirty(shProg, loc);
 }
 
 
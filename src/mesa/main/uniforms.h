@@ -210,6 +210,9 @@ _mesa_propagate_uniforms_to_driver_storage(struct gl_uniform_storage *uni,
 					   unsigned array_index,
 					   unsigned count);
 
+extern void
+_mesa_flush_uniforms(struct gl_context *ctx);
+
 extern void
 _mesa_update_shader_textures_used(struct gl_shader_program *shProg,
 				  struct gl_program *prog);
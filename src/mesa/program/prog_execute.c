@@ -416,6 +416,13 @@ store_vector4(const struct prog_instruction *inst,
    GLfloat clampedValue[4];
    GLfloat *dst = get_dst_register_pointer(dstReg, machine);
 
+   /* Fast path for the common case of a plain, full write */
+   if (writeMask == WRITEMASK_XYZW && !clamp &&
+       dstReg->CondMask == COND_TR && !inst->CondUpdate) {
+      COPY_4V(dst, value);
+      return;
+   }
+
 #if 0
    if (value[0] > 1.0e10 ||
        IS_INF_OR_NAN(value[0]) ||
@@ -68,6 +68,13 @@
  * up front and stored in a 2-dimensional array, so that the cost of
  * coloring a node is constant with the number of registers.  We do
  * this during ra_set_finalize().
+ *
+ * Since the pq test only ever gets easier to pass as neighbors are removed
+ * from the graph, each node keeps a running sum of q(B,C) over its
+ * remaining neighbors, and simplification is driven by a worklist of the
+ * nodes that currently pass the test.  Pushing a node only touches its
+ * neighbors, so simplifying the whole graph is linear in its number of
+ * edges rather than quadratic in its number of nodes.
  */
 
 #include <stdbool.h>
@@ -121,6 +128,9 @@ struct ra_node {
     *
     * List of which nodes this node interferes with.  This should be
     * symmetric with the other node.
+    *
+    * The adjacency bitset only covers the lower-numbered nodes, see
+    * ra_nodes_interfere(), which halves the size of the graph.
     */
    BITSET_WORD *adjacency;
    unsigned int *adjacency_list;
@@ -145,6 +155,18 @@ struct ra_node {
     * approximate cost of spilling this node.
     */
    float spill_cost;
+
+   /**
+    * Sum of q(B,C) over all of this node's neighbors, see
+    * ra_compute_q_totals().  Used as the benefit of spilling the node.
+    */
+   unsigned int q_total;
+
+   /**
+    * Sum of q(B,C) over the neighbors which are not in the stack: the
+    * node is trivially colorable once this is below p(B).
+    */
+   unsigned int q_remaining;
 };
 
 struct ra_graph {
@@ -167,6 +189,12 @@ struct ra_graph {
     * spilling.
     */
    unsigned int stack_optimistic_start;
+
+   /** Scratch set of the registers ruled out for a node in ra_select() */
+   BITSET_WORD *reg_conflicts;
+
+   /** Whether the nodes' q_total are up to date with the graph */
+   GLboolean q_totals_valid;
 };
 
 /**
@@ -334,10 +362,20 @@ ra_set_finalize(struct ra_regs *regs, unsigned int **q_values)
    }
 }
 
+static GLboolean
+ra_nodes_interfere(struct ra_graph *g, unsigned int n1, unsigned int n2)
+{
+   if (n1 < n2)
+      return BITSET_TEST(g->nodes[n2].adjacency, n1);
+   else
+      return BITSET_TEST(g->nodes[n1].adjacency, n2);
+}
+
 static void
 ra_add_node_adjacency(struct ra_graph *g, unsigned int n1, unsigned int n2)
 {
-   BITSET_SET(g->nodes[n1].adjacency, n2);
+   if (n2 < n1)
+      BITSET_SET(g->nodes[n1].adjacency, n2);
 
    if (g->nodes[n1].adjacency_count >=
        g->nodes[n1].adjacency_list_size) {
@@ -363,17 +401,16 @@ ra_alloc_interference_graph(struct ra_regs *regs, unsigned int count)
    g->count = count;
 
    g->stack = rzalloc_array(g, unsigned int, count);
+   g->reg_conflicts = ralloc_array(g, BITSET_WORD, BITSET_WORDS(regs->count));
 
    for (i = 0; i < count; i++) {
-      int bitset_count = BITSET_WORDS(count);
-      g->nodes[i].adjacency = rzalloc_array(g, BITSET_WORD, bitset_count);
+      g->nodes[i].adjacency = rzalloc_array(g, BITSET_WORD, BITSET_WORDS(i));
 
       g->nodes[i].adjacency_list_size = 4;
       g->nodes[i].adjacency_list =
          ralloc_array(g, unsigned int, g->nodes[i].adjacency_list_size);
       g->nodes[i].adjacency_count = 0;
 
-      ra_add_node_adjacency(g, i, i);
       g->nodes[i].reg = NO_REG;
    }
 
@@ -385,34 +422,49 @@ ra_set_node_class(struct ra_graph *g,
 		  unsigned int n, unsigned int class)
 {
    g->nodes[n].class = class;
+   g->q_totals_valid = GL_FALSE;
 }
 
 void
 ra_add_node_interference(struct ra_graph *g,
 			 unsigned int n1, unsigned int n2)
 {
-   if (!BITSET_TEST(g->nodes[n1].adjacency, n2)) {
+   if (n1 != n2 && !ra_nodes_interfere(g, n1, n2)) {
       ra_add_node_adjacency(g, n1, n2);
       ra_add_node_adjacency(g, n2, n1);
+      g->q_totals_valid = GL_FALSE;
    }
 }
 
-static GLboolean pq_test(struct ra_graph *g, unsigned int n)
+static unsigned int
+ra_q(struct ra_graph *g, unsigned int n, unsigned int n2)
 {
-   unsigned int j;
-   unsigned int q = 0;
-   int n_class = g->nodes[n].class;
+   return g->regs->classes[g->nodes[n].class]->q[g->nodes[n2].class];
+}
 
-   for (j = 0; j < g->nodes[n].adjacency_count; j++) {
-      unsigned int n2 = g->nodes[n].adjacency_list[j];
-      unsigned int n2_class = g->nodes[n2].class;
+static void
+ra_compute_q_totals(struct ra_graph *g)
+{
+   unsigned int i, j;
 
-      if (n != n2 && !g->nodes[n2].in_stack) {
-	 q += g->regs->classes[n_class]->q[n2_class];
-      }
+   if (g->q_totals_valid)
+      return;
+
+   for (i = 0; i < g->count; i++) {
+      struct ra_node *node = &g->nodes[i];
+
+      node->q_total = 0;
+      for (j = 0; j < node->adjacency_count; j++)
+         node->q_total += ra_q(g, i, node->adjacency_list[j]);
    }
 
-   return q < g->regs->classes[n_class]->p;
+   g->q_totals_valid = GL_TRUE;
+}
+
+static GLboolean
+pq_test(struct ra_graph *g, unsigned int n)
+{
+   return g->nodes[n].q_remaining < g->regs->classes[g->nodes[n].class]->p;
 }
 
 /**
@@ -427,27 +479,62 @@ static GLboolean pq_test(struct ra_graph *g, unsigned int n)
 GLboolean
 ra_simplify(struct ra_graph *g)
 {
-   GLboolean progress = GL_TRUE;
-   int i;
+   unsigned int *worklist = ralloc_array(g, unsigned int, g->count);
+   unsigned int worklist_count = 0;
+   unsigned int i, j;
 
-   while (progress) {
-      progress = GL_FALSE;
+   ra_compute_q_totals(g);
 
-      for (i = g->count - 1; i >= 0; i--) {
-	 if (g->nodes[i].in_stack || g->nodes[i].reg != NO_REG)
-	    continue;
+   for (i = 0; i < g->count; i++) {
+      struct ra_node *node = &g->nodes[i];
 
-	 if (pq_test(g, i)) {
-	    g->stack[g->stack_count] = i;
-	    g->stack_count++;
-	    g->nodes[i].in_stack = GL_TRUE;
-	    progress = GL_TRUE;
-	 }
+      node->q_remaining = node->q_total;
+      for (j = 0; j < node->adjacency_count; j++) {
+         if (g->nodes[node->adjacency_list[j]].in_stack)
+            node->q_remaining -= ra_q(g, i, node->adjacency_list[j]);
       }
    }
 
+   /* Seed the worklist so that the highest-numbered nodes are pushed
+    * first, like the old sweeps over the graph did.
+    */
    for (i = 0; i < g->count; i++) {
-      if (!g->nodes[i].in_stack && g->nodes[i].reg == -1)
+      if (!g->nodes[i].in_stack && g->nodes[i].reg == NO_REG &&
+          pq_test(g, i))
+         worklist[worklist_count++] = i;
+   }
+
+   while (worklist_count) {
+      unsigned int n = worklist[--worklist_count];
+      struct ra_node *node = &g->nodes[n];
+
+      g->stack[g->stack_count] = n;
+      g->stack_count++;
+      node->in_stack = GL_TRUE;
+
+      /* Removing n from the graph may make its neighbors colorable.  Each
+       * node is added to the worklist only when it first passes the test,
+       * so it is never added twice.
+       */
+      for (j = 0; j < node->adjacency_count; j++) {
+         unsigned int n2 = node->adjacency_list[j];
+         struct ra_node *node2 = &g->nodes[n2];
+         GLboolean was_colorable;
+
+         if (node2->in_stack || node2->reg != NO_REG)
+            continue;
+
+         was_colorable = pq_test(g, n2);
+         node2->q_remaining -= ra_q(g, n2, n);
+         if (!was_colorable && pq_test(g, n2))
+            worklist[worklist_count++] = n2;
+      }
+   }
+
+   ralloc_free(worklist);
+
+   for (i = 0; i < g->count; i++) {
+      if (!g->nodes[i].in_stack && g->nodes[i].reg == NO_REG)
 	 return GL_FALSE;
    }
 
@@ -464,40 +551,48 @@ ra_simplify(struct ra_graph *g)
 GLboolean
 ra_select(struct ra_graph *g)
 {
-   int i;
+   unsigned int i;
    int start_search_reg = 0;
 
    while (g->stack_count != 0) {
       unsigned int ri;
       unsigned int r = -1;
       int n = g->stack[g->stack_count - 1];
-      struct ra_class *c = g->regs->classes[g->nodes[n].class];
+      struct ra_node *node = &g->nodes[n];
+      struct ra_class *c = g->regs->classes[node->class];
+
+      /* Gather the registers conflicting with those of the members of the
+       * graph adjacent to us, rather than checking every neighbor against
+       * every candidate register.
+       */
+      memset(g->reg_conflicts, 0,
+             BITSET_WORDS(g->regs->count) * sizeof(BITSET_WORD));
+      for (i = 0; i < node->adjacency_count; i++) {
+         struct ra_node *node2 = &g->nodes[node->adjacency_list[i]];
+         struct ra_reg *reg2;
+         unsigned int k;
+
+         if (node2->in_stack || node2->reg == NO_REG)
+            continue;
+
+         reg2 = &g->regs->regs[node2->reg];
+         for (k = 0; k < reg2->num_conflicts; k++)
+            BITSET_SET(g->reg_conflicts, reg2->conflict_list[k]);
+      }
 
       /* Find the lowest-numbered reg which is not used by a member
        * of the graph adjacent to us.
        */
       for (ri = 0; ri < g->regs->count; ri++) {
          r = (start_search_reg + ri) % g->regs->count;
-	 if (!c->regs[r])
-	    continue;
-
-	 /* Check if any of our neighbors conflict with this register choice. */
-	 for (i = 0; i < g->nodes[n].adjacency_count; i++) {
-	    unsigned int n2 = g->nodes[n].adjacency_list[i];
-
-	    if (!g->nodes[n2].in_stack &&
-		g->regs->regs[r].conflicts[g->nodes[n2].reg]) {
-	       break;
-	    }
-	 }
-	 if (i == g->nodes[n].adjacency_count)
+	 if (c->regs[r] && !BITSET_TEST(g->reg_conflicts, r))
 	    break;
       }
       if (ri == g->regs->count)
 	 return GL_FALSE;
 
-      g->nodes[n].reg = r;
-      g->nodes[n].in_stack = GL_FALSE;
+      node->reg = r;
+      node->in_stack = GL_FALSE;
       g->stack_count--;
 
       if (g->regs->round_robin)
@@ -568,25 +663,14 @@ ra_set_node_reg(struct ra_graph *g, unsigned int n, unsigned int reg)
 static float
 ra_get_spill_benefit(struct ra_graph *g, unsigned int n)
 {
-   int j;
-   float benefit = 0;
-   int n_class = g->nodes[n].class;
-
    /* Define the benefit of eliminating an interference between n, n2
     * through spilling as q(C, B) / p(C).  This is similar to the
     * "count number of edges" approach of traditional graph coloring,
-    * but takes classes into account.
+    * but takes classes into account.  Summed over all the neighbors,
+    * that's the node's q_total over p.
     */
-   for (j = 0; j < g->nodes[n].adjacency_count; j++) {
-      unsigned int n2 = g->nodes[n].adjacency_list[j];
-      if (n != n2) {
-	 unsigned int n2_class = g->nodes[n2].class;
-	 benefit += ((float)g->regs->classes[n_class]->q[n2_class] /
-		     g->regs->classes[n_class]->p);
-      }
-   }
-
-   return benefit;
+   return ((float)g->nodes[n].q_total /
+           g->regs->classes[g->nodes[n].class]->p);
 }
 
 /**
@@ -600,6 +684,8 @@ ra_get_best_spill_node(struct ra_graph *g)
    float best_benefit = 0.0;
    unsigned int n, i;
 
+   ra_compute_q_totals(g);
+
    /* For any registers not in the stack to be colored, consider them for
     * spilling.  This will mostly collect nodes that were being optimistally
     * colored as part of ra_allocate_no_spills() if we didn't successfully
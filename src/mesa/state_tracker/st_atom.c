@@ -27,12 +27,16 @@
 
 
 #include "main/glheader.h"
+#include "main/bitset.h"
 #include "main/context.h"
 
 #include "pipe/p_defines.h"
+#include "util/u_trace_events.h"
 #include "st_context.h"
 #include "st_atom.h"
 #include "st_cb_bitmap.h"
+#include "st_debug.h"
+#include "st_draw.h"
 #include "st_program.h"
 #include "st_manager.h"
 
@@ -76,13 +80,28 @@ static const struct st_tracked_state *atoms[] =
 
 void st_init_atoms( struct st_context *st )
 {
-   /* no-op */
+   if (ST_DEBUG & DEBUG_ATOMS)
+      st->atom_updates = calloc(Elements(atoms), sizeof(unsigned));
 }
 
 
 void st_destroy_atoms( struct st_context *st )
 {
-   /* no-op */
+   GLuint i;
+
+   if (!st->atom_updates)
+      return;
+
+   debug_printf("st: %u state validations\n", st->num_validations);
+   for (i = 0; i < Elements(atoms); i++) {
+      debug_printf("st: %-28s %10u updates, %5.2f per validation\n",
+                   atoms[i]->name, st->atom_updates[i],
+                   st->num_validations ?
+                   (float) st->atom_updates[i] / st->num_validations : 0.0f);
+   }
+
+   free(st->atom_updates);
+   st->atom_updates = NULL;
 }
 
 
@@ -155,6 +174,9 @@ void st_validate_state( struct st_context *st )
    struct st_state_flags *state = &st->dirty;
    GLuint i;
 
+   /* Draws held back for merging used the old state */
+   st_flush_pending_draw(st);
+
    /* Get Mesa driver state. */
    st->dirty.st |= st->ctx->NewDriverState;
    st->ctx->NewDriverState = 0;
@@ -171,6 +193,8 @@ void st_validate_state( struct st_context *st )
    if (state->st == 0)
       return;
 
+   util_trace_event_begin("st_validate_state");
+
    /*printf("%s %x/%x\n", __FUNCTION__, state->mesa, state->st);*/
 
 #ifdef DEBUG
@@ -200,6 +224,8 @@ void st_validate_state( struct st_context *st )
 
 	 if (check_state(state, &atom->dirty)) {
 	    atoms[i]->update( st );
+	    if (st->atom_updates)
+	       st->atom_updates[i]++;
 	    /*printf("after: %x\n", atom->dirty.mesa);*/
 	 }
 
@@ -223,7 +249,12 @@ void st_validate_state( struct st_context *st )
       }
    }
 
+   util_trace_event_end("st_validate_state");
+
+   st->num_validations++;
+
    memset(state, 0, sizeof(*state));
+   BITSET_ZERO(st->ctx->Texture._DirtyUnits);
 }
 
 
@@ -275,12 +275,15 @@ update_blend( struct st_context *st )
          blend->alpha_to_one = 1;
    }
 
-   cso_set_blend(st->cso_context, blend);
-
    {
       struct pipe_blend_color bc;
+      struct cso_state_block block;
+
       COPY_4FV(bc.color, ctx->Color.BlendColorUnclamped);
-      cso_set_blend_color(st->cso_context, &bc);
+      block.blend = blend;
+      block.blend_color = &bc;
+      cso_set_state_block(st->cso_context,
+                          CSO_BIT_BLEND | CSO_BIT_BLEND_COLOR, &block);
    }
 }
 
@@ -48,6 +48,80 @@
 #include "st_program.h"
 #include "st_cb_bufferobjects.h"
 
+/**
+ * Write the parameter values which changed since the last update into the
+ * stage's constant buffer, rather than uploading all of them into a new
+ * one.  Usually only a few uniforms or state parameters change between
+ * draws.
+ * \return FALSE if the buffer couldn't be allocated
+ */
+static boolean
+update_constant_buffer(struct st_context *st, unsigned shader_type,
+                       const struct gl_program_parameter_list *params,
+                       unsigned size, struct pipe_constant_buffer *cb)
+{
+   struct pipe_context *pipe = st->pipe;
+   gl_constant_value (*values)[4] = params->ParameterValues;
+   const unsigned num = size / sizeof(values[0]);
+   unsigned first, last;
+
+   if (size > st->constbuf[shader_type].size) {
+      pipe_resource_reference(&st->constbuf[shader_type].buffer, NULL);
+      free(st->constbuf[shader_type].values);
+      st->constbuf[shader_type].size = 0;
+
+      st->constbuf[shader_type].values = malloc(size);
+      if (!st->constbuf[shader_type].values)
+         return FALSE;
+
+      st->constbuf[shader_type].buffer =
+         pipe_buffer_create(pipe->screen, PIPE_BIND_CONSTANT_BUFFER,
+                            PIPE_USAGE_DYNAMIC, size);
+      if (!st->constbuf[shader_type].buffer) {
+         free(st->constbuf[shader_type].values);
+         st->constbuf[shader_type].values = NULL;
+         return FALSE;
+      }
+
+      st->constbuf[shader_type].size = size;
+      first = 0;
+      last = num - 1;
+   }
+   else {
+      gl_constant_value (*old)[4] =
+         (gl_constant_value (*)[4]) st->constbuf[shader_type].values;
+
+      for (first = 0; first < num; first++) {
+         if (memcmp(values[first], old[first], sizeof(values[0])))
+            break;
+      }
+      for (last = num - 1; last > first; last--) {
+         if (memcmp(values[last], old[last], sizeof(values[0])))
+            break;
+      }
+   }
+
+   if (first < num) {
+      struct pipe_box box;
+
+      u_box_1d(first * sizeof(values[0]),
+               (last - first + 1) * sizeof(values[0]), &box);
+      pipe->transfer_inline_write(pipe, st->constbuf[shader_type].buffer, 0,
+                                  PIPE_TRANSFER_WRITE |
+                                  PIPE_TRANSFER_DISCARD_RANGE,
+                                  &box, values[first], 0, 0);
+      memcpy(st->constbuf[shader_type].values + first * 4, values[first],
+             (last - first + 1) * sizeof(values[0]));
+   }
+
+   cb->buffer = NULL;
+   cb->user_buffer = NULL;
+   cb->buffer_offset = 0;
+   pipe_resource_reference(&cb->buffer, st->constbuf[shader_type].buffer);
+   return TRUE;
+}
+
+
 /**
  * Pass the given program parameters to the graphics pipe as a
  * constant buffer.
@@ -73,16 +147,21 @@ void st_upload_constants( struct st_context *st,
        */
       _mesa_load_state_parameters(st->ctx, params);
 
-      /* We always need to get a new buffer, to keep the drivers simple and
-       * avoid gratuitous rendering synchronization.
-       * Let's use a user buffer to avoid an unnecessary copy.
+      /* Let's use a user buffer to avoid an unnecessary copy.  Without
+       * user buffers, only the values which changed are written into a
+       * constant buffer we keep, and only if that fails do we upload all
+       * the values to a new buffer.
        */
       if (st->constbuf_uploader) {
-         cb.buffer = NULL;
-         cb.user_buffer = NULL;
-         u_upload_data(st->constbuf_uploader, 0, paramBytes,
-                       params->ParameterValues, &cb.buffer_offset, &cb.buffer);
-         u_upload_unmap(st->constbuf_uploader);
+         if (!update_constant_buffer(st, shader_type, params, paramBytes,
+                                     &cb)) {
+            cb.buffer = NULL;
+            cb.user_buffer = NULL;
+            u_upload_data(st->constbuf_uploader, 0, paramBytes,
+                          params->ParameterValues, &cb.buffer_offset,
+                          &cb.buffer);
+            u_upload_unmap(st->constbuf_uploader);
+         }
       } else {
          cb.buffer = NULL;
          cb.user_buffer = params->ParameterValues;
@@ -128,7 +207,7 @@ const struct st_tracked_state st_update_vs_constants = {
    "st_update_vs_constants",				/* name */
    {							/* dirty */
       _NEW_PROGRAM_CONSTANTS,                           /* mesa */
-      ST_NEW_VERTEX_PROGRAM,				/* st */
+      ST_NEW_VERTEX_PROGRAM | ST_NEW_VS_CONSTANTS,		/* st */
    },
    update_vs_constants					/* update */
 };
@@ -151,7 +230,7 @@ const struct st_tracked_state st_update_fs_constants = {
    "st_update_fs_constants",				/* name */
    {							/* dirty */
       _NEW_PROGRAM_CONSTANTS,                           /* mesa */
-      ST_NEW_FRAGMENT_PROGRAM,				/* st */
+      ST_NEW_FRAGMENT_PROGRAM | ST_NEW_FS_CONSTANTS,		/* st */
    },
    update_fs_constants					/* update */
 };
@@ -173,7 +252,7 @@ const struct st_tracked_state st_update_gs_constants = {
    "st_update_gs_constants",				/* name */
    {							/* dirty */
       _NEW_PROGRAM_CONSTANTS,                           /* mesa */
-      ST_NEW_GEOMETRY_PROGRAM,				/* st */
+      ST_NEW_GEOMETRY_PROGRAM | ST_NEW_GS_CONSTANTS,		/* st */
    },
    update_gs_constants					/* update */
 };
@@ -195,6 +274,7 @@ static void st_bind_ubos(struct st_context *st,
       binding = &st->ctx->UniformBufferBindings[shader->UniformBlocks[i].Binding];
       st_obj = st_buffer_object(binding->BufferObject);
 
+      st_bufferobj_sync(st, st_obj);
       cb.buffer = st_obj->buffer;
 
       if (cb.buffer) {
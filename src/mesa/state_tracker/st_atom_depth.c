@@ -148,8 +148,14 @@ update_depth_stencil_alpha(struct st_context *st)
       dsa->alpha.ref_value = ctx->Color.AlphaRefUnclamped;
    }
 
-   cso_set_depth_stencil_alpha(st->cso_context, dsa);
-   cso_set_stencil_ref(st->cso_context, &sr);
+   {
+      struct cso_state_block block;
+      block.depth_stencil_alpha = dsa;
+      block.stencil_ref = &sr;
+      cso_set_state_block(st->cso_context,
+                          CSO_BIT_DEPTH_STENCIL_ALPHA | CSO_BIT_STENCIL_REF,
+                          &block);
+   }
 }
 
 
@@ -32,6 +32,7 @@
   */
  
 
+#include "main/bitset.h"
 #include "main/macros.h"
 #include "main/mtypes.h"
 #include "main/glformats.h"
@@ -231,6 +232,7 @@ update_shader_samplers(struct st_context *st,
                        unsigned shader_stage,
                        const struct gl_program *prog,
                        unsigned max_units,
+                       GLboolean all_dirty,
                        struct pipe_sampler_state *samplers,
                        unsigned *num_samplers)
 {
@@ -252,10 +254,15 @@ update_shader_samplers(struct st_context *st,
       if (samplers_used & 1) {
          const GLuint texUnit = prog->SamplerUnits[unit];
 
-         convert_sampler(st, sampler, texUnit);
-
          *num_samplers = unit + 1;
 
+         /* The sampler of an unchanged unit stays */
+         if (!all_dirty &&
+             !BITSET_TEST(st->ctx->Texture._DirtyUnits, texUnit))
+            continue;
+
+         convert_sampler(st, sampler, texUnit);
+
          cso_single_sampler(st->cso_context, shader_stage, unit, sampler);
       }
       else if (samplers_used != 0 || unit < old_max) {
@@ -280,6 +287,7 @@ update_samplers(struct st_context *st)
                           PIPE_SHADER_FRAGMENT,
                           &ctx->FragmentProgram._Current->Base,
                           ctx->Const.Program[MESA_SHADER_FRAGMENT].MaxTextureImageUnits,
+                          st_all_texture_units_dirty(st, ST_NEW_FRAGMENT_PROGRAM),
                           st->state.samplers[PIPE_SHADER_FRAGMENT],
                           &st->state.num_samplers[PIPE_SHADER_FRAGMENT]);
 
@@ -287,6 +295,7 @@ update_samplers(struct st_context *st)
                           PIPE_SHADER_VERTEX,
                           &ctx->VertexProgram._Current->Base,
                           ctx->Const.Program[MESA_SHADER_VERTEX].MaxTextureImageUnits,
+                          st_all_texture_units_dirty(st, ST_NEW_VERTEX_PROGRAM),
                           st->state.samplers[PIPE_SHADER_VERTEX],
                           &st->state.num_samplers[PIPE_SHADER_VERTEX]);
 
@@ -295,6 +304,7 @@ update_samplers(struct st_context *st)
                              PIPE_SHADER_GEOMETRY,
                              &ctx->GeometryProgram._Current->Base,
                              ctx->Const.Program[MESA_SHADER_GEOMETRY].MaxTextureImageUnits,
+                             st_all_texture_units_dirty(st, ST_NEW_GEOMETRY_PROGRAM),
                              st->state.samplers[PIPE_SHADER_GEOMETRY],
                              &st->state.num_samplers[PIPE_SHADER_GEOMETRY]);
    }
@@ -305,7 +315,7 @@ const struct st_tracked_state st_update_sampler = {
    "st_update_sampler",					/* name */
    {							/* dirty */
       _NEW_TEXTURE,					/* mesa */
-      0,						/* st */
+      ST_NEW_TEXTURE_UNITS,				/* st */
    },
    update_samplers					/* update */
 };
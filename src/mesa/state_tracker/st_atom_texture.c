@@ -32,6 +32,7 @@
   */
 
 
+#include "main/bitset.h"
 #include "main/macros.h"
 #include "main/mtypes.h"
 #include "main/samplerobj.h"
@@ -46,6 +47,7 @@
 #include "pipe/p_context.h"
 #include "util/u_format.h"
 #include "util/u_inlines.h"
+#include "util/u_math.h"
 #include "cso_cache/cso_context.h"
 
 
@@ -267,11 +269,33 @@ update_single_texture(struct st_context *st,
 
 
 
+/**
+ * Whether any of the texture units sampled by prog had its bindings
+ * changed.
+ */
+static GLboolean
+texture_units_dirty(const struct gl_context *ctx,
+                    const struct gl_program *prog)
+{
+   GLbitfield samplers_used = prog->SamplersUsed;
+
+   while (samplers_used) {
+      const GLuint unit = u_bit_scan(&samplers_used);
+
+      if (BITSET_TEST(ctx->Texture._DirtyUnits, prog->SamplerUnits[unit]))
+         return GL_TRUE;
+   }
+
+   return GL_FALSE;
+}
+
+
 static void
 update_textures(struct st_context *st,
                 unsigned shader_stage,
                 const struct gl_program *prog,
                 unsigned max_units,
+                GLboolean all_dirty,
                 struct pipe_sampler_view **sampler_views,
                 unsigned *num_textures)
 {
@@ -282,6 +306,10 @@ update_textures(struct st_context *st,
    if (samplers_used == 0x0 && old_max == 0)
       return;
 
+   /* Only some bindings changed, and none that this stage uses */
+   if (!all_dirty && !texture_units_dirty(st->ctx, prog))
+      return;
+
    *num_textures = 0;
 
    /* loop over sampler units (aka tex image units) */
@@ -292,6 +320,14 @@ update_textures(struct st_context *st,
          const GLuint texUnit = prog->SamplerUnits[unit];
          GLboolean retval;
 
+         /* The view of an unchanged unit stays */
+         if (!all_dirty &&
+             !BITSET_TEST(st->ctx->Texture._DirtyUnits, texUnit)) {
+            if (sampler_views[unit])
+               *num_textures = unit + 1;
+            continue;
+         }
+
          retval = update_single_texture(st, &sampler_view, texUnit);
          if (retval == GL_FALSE)
             continue;
@@ -331,6 +367,7 @@ update_vertex_textures(struct st_context *st)
                       PIPE_SHADER_VERTEX,
                       &ctx->VertexProgram._Current->Base,
                       ctx->Const.Program[MESA_SHADER_VERTEX].MaxTextureImageUnits,
+                      st_all_texture_units_dirty(st, ST_NEW_VERTEX_PROGRAM),
                       st->state.sampler_views[PIPE_SHADER_VERTEX],
                       &st->state.num_sampler_views[PIPE_SHADER_VERTEX]);
    }
@@ -346,6 +383,7 @@ update_fragment_textures(struct st_context *st)
                    PIPE_SHADER_FRAGMENT,
                    &ctx->FragmentProgram._Current->Base,
                    ctx->Const.Program[MESA_SHADER_FRAGMENT].MaxTextureImageUnits,
+                   st_all_texture_units_dirty(st, ST_NEW_FRAGMENT_PROGRAM),
                    st->state.sampler_views[PIPE_SHADER_FRAGMENT],
                    &st->state.num_sampler_views[PIPE_SHADER_FRAGMENT]);
 }
@@ -361,6 +399,7 @@ update_geometry_textures(struct st_context *st)
                       PIPE_SHADER_GEOMETRY,
                       &ctx->GeometryProgram._Current->Base,
                       ctx->Const.Program[MESA_SHADER_FRAGMENT].MaxTextureImageUnits,
+                      st_all_texture_units_dirty(st, ST_NEW_GEOMETRY_PROGRAM),
                       st->state.sampler_views[PIPE_SHADER_GEOMETRY],
                       &st->state.num_sampler_views[PIPE_SHADER_GEOMETRY]);
    }
@@ -371,7 +410,7 @@ const struct st_tracked_state st_update_fragment_texture = {
    "st_update_texture",					/* name */
    {							/* dirty */
       _NEW_TEXTURE,					/* mesa */
-      ST_NEW_FRAGMENT_PROGRAM,				/* st */
+      ST_NEW_FRAGMENT_PROGRAM | ST_NEW_TEXTURE_UNITS,	/* st */
    },
    update_fragment_textures				/* update */
 };
@@ -381,7 +420,7 @@ const struct st_tracked_state st_update_vertex_texture = {
    "st_update_vertex_texture",				/* name */
    {							/* dirty */
       _NEW_TEXTURE,					/* mesa */
-      ST_NEW_VERTEX_PROGRAM,				/* st */
+      ST_NEW_VERTEX_PROGRAM | ST_NEW_TEXTURE_UNITS,	/* st */
    },
    update_vertex_textures				/* update */
 };
@@ -391,7 +430,7 @@ const struct st_tracked_state st_update_geometry_texture = {
    "st_update_geometry_texture",			/* name */
    {							/* dirty */
       _NEW_TEXTURE,					/* mesa */
-      ST_NEW_GEOMETRY_PROGRAM,				/* st */
+      ST_NEW_GEOMETRY_PROGRAM | ST_NEW_TEXTURE_UNITS,	/* st */
    },
    update_geometry_textures				/* update */
 };
@@ -404,6 +443,9 @@ finalize_textures(struct st_context *st)
    struct gl_context *ctx = st->ctx;
    struct gl_fragment_program *fprog = ctx->FragmentProgram._Current;
    const GLboolean prev_missing_textures = st->missing_textures;
+   /* Once a texture is missing, all need rechecking to see if it still is */
+   const GLboolean all_dirty = (st->dirty.mesa & _NEW_TEXTURE) ||
+                               st->missing_textures;
    GLuint su;
 
    st->missing_textures = GL_FALSE;
@@ -414,6 +456,9 @@ finalize_textures(struct st_context *st)
          struct gl_texture_object *texObj
             = ctx->Texture.Unit[texUnit]._Current;
 
+         if (!all_dirty && !BITSET_TEST(ctx->Texture._DirtyUnits, texUnit))
+            continue;
+
          if (texObj) {
             GLboolean retval;
 
@@ -436,7 +481,7 @@ const struct st_tracked_state st_finalize_textures = {
    "st_finalize_textures",		/* name */
    {					/* dirty */
       _NEW_TEXTURE,			/* mesa */
-      0,				/* st */
+      ST_NEW_TEXTURE_UNITS,		/* st */
    },
    finalize_textures			/* update */
 };
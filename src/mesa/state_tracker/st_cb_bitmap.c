@@ -72,22 +72,29 @@
 /**
  * The bitmap cache attempts to accumulate multiple glBitmap calls in a
  * buffer which is then rendered en mass upon a flush, state change, etc.
- * A wide, short buffer is used to target the common case of a series
- * of glBitmap calls being used to draw text.
+ * The bitmaps are packed into an atlas texture, in rows (shelves) as tall
+ * as their tallest bitmap, and drawn as one quad each with a single draw.
+ * So the window positions of the bitmaps don't matter, only their color
+ * and Z do.  That is the common case of a series of glBitmap calls being
+ * used to draw text.
  */
 static GLboolean UseBitmapCache = GL_TRUE;
 
 
-#define BITMAP_CACHE_WIDTH  512
-#define BITMAP_CACHE_HEIGHT 32
+#define BITMAP_CACHE_WIDTH  1024
+#define BITMAP_CACHE_HEIGHT 256
+#define BITMAP_CACHE_MAX_QUADS 1024
 
-struct bitmap_cache
+/** A bitmap to draw from a texture */
+struct bitmap_quad
 {
-   /** Window pos to render the cached image */
-   GLint xpos, ypos;
-   /** Bounds of region used in window coords */
-   GLint xmin, ymin, xmax, ymax;
+   GLint x, y;                /**< window pos */
+   GLsizei width, height;
+   GLint px, py;              /**< pos in the texture */
+};
 
+struct bitmap_cache
+{
    GLfloat color[4];
 
    /** Bitmap's Z position */
@@ -96,7 +103,12 @@ struct bitmap_cache
    struct pipe_resource *texture;
    struct pipe_transfer *trans;
 
-   GLboolean empty;
+   /** The shelf being filled: its pos in the texture and its height */
+   GLint shelf_x, shelf_y;
+   GLsizei shelf_height;
+
+   struct bitmap_quad quads[BITMAP_CACHE_MAX_QUADS];
+   unsigned num_quads;
 
    /** An I8 texture image: */
    ubyte *buffer;
@@ -323,70 +335,54 @@ make_bitmap_texture(struct gl_context *ctx, GLsizei width, GLsizei height,
 
 static void
 setup_bitmap_vertex_data(struct st_context *st, bool normalized,
-                         int x, int y, int width, int height,
+                         const struct pipe_resource *tex,
+                         const struct bitmap_quad *quads, unsigned num_quads,
                          float z, const float color[4],
 			 struct pipe_resource **vbuf,
 			 unsigned *vbuf_offset)
 {
    const GLfloat fb_width = (GLfloat)st->state.framebuffer.width;
    const GLfloat fb_height = (GLfloat)st->state.framebuffer.height;
-   const GLfloat x0 = (GLfloat)x;
-   const GLfloat x1 = (GLfloat)(x + width);
-   const GLfloat y0 = (GLfloat)y;
-   const GLfloat y1 = (GLfloat)(y + height);
-   GLfloat sLeft = (GLfloat)0.0, sRight = (GLfloat)1.0;
-   GLfloat tTop = (GLfloat)0.0, tBot = (GLfloat)1.0 - tTop;
-   const GLfloat clip_x0 = (GLfloat)(x0 / fb_width * 2.0 - 1.0);
-   const GLfloat clip_y0 = (GLfloat)(y0 / fb_height * 2.0 - 1.0);
-   const GLfloat clip_x1 = (GLfloat)(x1 / fb_width * 2.0 - 1.0);
-   const GLfloat clip_y1 = (GLfloat)(y1 / fb_height * 2.0 - 1.0);
-   GLuint i;
+   const GLfloat s_scale = normalized ? 1.0f / tex->width0 : 1.0f;
+   const GLfloat t_scale = normalized ? 1.0f / tex->height0 : 1.0f;
+   /* the corners of a quad, as two triangles */
+   static const unsigned corners[6][2] = {
+      { 0, 0 }, { 1, 0 }, { 1, 1 },
+      { 0, 0 }, { 1, 1 }, { 0, 1 }
+   };
+   GLuint i, j;
    float (*vertices)[3][4];  /**< vertex pos + color + texcoord */
 
-   if(!normalized)
-   {
-      sRight = (GLfloat) width;
-      tBot = (GLfloat) height;
-   }
-
-   if (u_upload_alloc(st->uploader, 0, 4 * sizeof(vertices[0]),
+   if (u_upload_alloc(st->uploader, 0, 6 * num_quads * sizeof(vertices[0]),
                       vbuf_offset, vbuf, (void **) &vertices) != PIPE_OK) {
       return;
    }
 
-   /* Positions are in clip coords since we need to do clipping in case
-    * the bitmap quad goes beyond the window bounds.
-    */
-   vertices[0][0][0] = clip_x0;
-   vertices[0][0][1] = clip_y0;
-   vertices[0][2][0] = sLeft;
-   vertices[0][2][1] = tTop;
-
-   vertices[1][0][0] = clip_x1;
-   vertices[1][0][1] = clip_y0;
-   vertices[1][2][0] = sRight;
-   vertices[1][2][1] = tTop;
-   
-   vertices[2][0][0] = clip_x1;
-   vertices[2][0][1] = clip_y1;
-   vertices[2][2][0] = sRight;
-   vertices[2][2][1] = tBot;
-   
-   vertices[3][0][0] = clip_x0;
-   vertices[3][0][1] = clip_y1;
-   vertices[3][2][0] = sLeft;
-   vertices[3][2][1] = tBot;
-   
-   /* same for all verts: */
-   for (i = 0; i < 4; i++) {
-      vertices[i][0][2] = z;
-      vertices[i][0][3] = 1.0f;
-      vertices[i][1][0] = color[0];
-      vertices[i][1][1] = color[1];
-      vertices[i][1][2] = color[2];
-      vertices[i][1][3] = color[3];
-      vertices[i][2][2] = 0.0; /*R*/
-      vertices[i][2][3] = 1.0; /*Q*/
+   for (i = 0; i < num_quads; i++) {
+      const struct bitmap_quad *quad = &quads[i];
+
+      for (j = 0; j < 6; j++) {
+         const GLint dx = corners[j][0] ? quad->width : 0;
+         const GLint dy = corners[j][1] ? quad->height : 0;
+
+         /* Positions are in clip coords since we need to do clipping in
+          * case the bitmap quad goes beyond the window bounds.
+          */
+         vertices[j][0][0] = (GLfloat)((quad->x + dx) / fb_width * 2.0 - 1.0);
+         vertices[j][0][1] = (GLfloat)((quad->y + dy) / fb_height * 2.0 - 1.0);
+         vertices[j][0][2] = z;
+         vertices[j][0][3] = 1.0f;
+         vertices[j][1][0] = color[0];
+         vertices[j][1][1] = color[1];
+         vertices[j][1][2] = color[2];
+         vertices[j][1][3] = color[3];
+         vertices[j][2][0] = (quad->px + dx) * s_scale;
+         vertices[j][2][1] = (quad->py + dy) * t_scale;
+         vertices[j][2][2] = 0.0; /*R*/
+         vertices[j][2][3] = 1.0; /*Q*/
+      }
+
+      vertices += 6;
    }
 
    u_upload_unmap(st->uploader);
@@ -395,13 +391,13 @@ setup_bitmap_vertex_data(struct st_context *st, bool normalized,
 
 
 /**
- * Render a glBitmap by drawing a textured quad
+ * Render glBitmaps by drawing textured quads
  */
 static void
-draw_bitmap_quad(struct gl_context *ctx, GLint x, GLint y, GLfloat z,
-                 GLsizei width, GLsizei height,
-                 struct pipe_sampler_view *sv,
-                 const GLfloat *color)
+draw_bitmap_quads(struct gl_context *ctx,
+                  const struct bitmap_quad *quads, unsigned num_quads,
+                  GLfloat z, struct pipe_sampler_view *sv,
+                  const GLfloat *color)
 {
    struct st_context *st = st_context(ctx);
    struct pipe_context *pipe = st->pipe;
@@ -442,8 +438,8 @@ draw_bitmap_quad(struct gl_context *ctx, GLint x, GLint y, GLfloat z,
     */
    maxSize = 1 << (pipe->screen->get_param(pipe->screen,
                                     PIPE_CAP_MAX_TEXTURE_2D_LEVELS) - 1);
-   assert(width <= (GLsizei)maxSize);
-   assert(height <= (GLsizei)maxSize);
+   assert(sv->texture->width0 <= maxSize);
+   assert(sv->texture->height0 <= maxSize);
 
    cso_save_rasterizer(cso);
    cso_save_samplers(cso, PIPE_SHADER_FRAGMENT);
@@ -518,16 +514,17 @@ draw_bitmap_quad(struct gl_context *ctx, GLint x, GLint y, GLfloat z,
    /* convert Z from [0,1] to [-1,-1] to match viewport Z scale/bias */
    z = z * 2.0f - 1.0f;
 
-   /* draw textured quad */
+   /* draw textured quads */
    setup_bitmap_vertex_data(st, sv->texture->target != PIPE_TEXTURE_RECT,
-			    x, y, width, height, z, color, &vbuf, &offset);
+                            sv->texture, quads, num_quads, z, color,
+                            &vbuf, &offset);
 
    if (vbuf) {
       util_draw_vertex_buffer(pipe, st->cso_context, vbuf,
                               cso_get_aux_vertex_buffer_slot(st->cso_context),
                               offset,
-                              PIPE_PRIM_TRIANGLE_FAN,
-                              4,  /* verts */
+                              PIPE_PRIM_TRIANGLES,
+                              6 * num_quads,  /* verts */
                               3); /* attribs/vert */
    }
 
@@ -552,13 +549,10 @@ reset_cache(struct st_context *st)
 {
    struct bitmap_cache *cache = st->bitmap.cache;
 
-   /*memset(cache->buffer, 0xff, sizeof(cache->buffer));*/
-   cache->empty = GL_TRUE;
-
-   cache->xmin = 1000000;
-   cache->xmax = -1000000;
-   cache->ymin = 1000000;
-   cache->ymax = -1000000;
+   cache->num_quads = 0;
+   cache->shelf_x = 0;
+   cache->shelf_y = 0;
+   cache->shelf_height = 0;
 
    assert(!cache->texture);
 
@@ -611,8 +605,9 @@ create_cache_trans(struct st_context *st)
                                      BITMAP_CACHE_WIDTH,
                                      BITMAP_CACHE_HEIGHT, &cache->trans);
 
-   /* init image to all 0xff */
-   memset(cache->buffer, 0xff, cache->trans->stride * BITMAP_CACHE_HEIGHT);
+   /* Only the texels of the cached bitmaps are ever sampled, they are
+    * initialized when a bitmap is added.
+    */
 }
 
 
@@ -622,18 +617,13 @@ create_cache_trans(struct st_context *st)
 void
 st_flush_bitmap_cache(struct st_context *st)
 {
-   if (!st->bitmap.cache->empty) {
+   if (st->bitmap.cache->num_quads) {
       struct bitmap_cache *cache = st->bitmap.cache;
 
       struct pipe_context *pipe = st->pipe;
       struct pipe_sampler_view *sv;
 
-      assert(cache->xmin <= cache->xmax);
-
-/*    printf("flush size %d x %d  at %d, %d\n",
-             cache->xmax - cache->xmin,
-             cache->ymax - cache->ymin,
-             cache->xpos, cache->ypos);
+/*    printf("flush %u bitmaps\n", cache->num_quads);
 */
 
       /* The texture transfer has been mapped until now.
@@ -649,13 +639,11 @@ st_flush_bitmap_cache(struct st_context *st)
 
       sv = st_create_texture_sampler_view(st->pipe, cache->texture);
       if (sv) {
-         draw_bitmap_quad(st->ctx,
-                          cache->xpos,
-                          cache->ypos,
-                          cache->zpos,
-                          BITMAP_CACHE_WIDTH, BITMAP_CACHE_HEIGHT,
-                          sv,
-                          cache->color);
+         draw_bitmap_quads(st->ctx,
+                           cache->quads, cache->num_quads,
+                           cache->zpos,
+                           sv,
+                           cache->color);
 
          pipe_sampler_view_reference(&sv, NULL);
       }
@@ -680,50 +668,51 @@ accum_bitmap(struct gl_context *ctx,
 {
    struct st_context *st = ctx->st;
    struct bitmap_cache *cache = st->bitmap.cache;
-   int px = -999, py = -999;
+   struct bitmap_quad *quad;
    const GLfloat z = st->ctx->Current.RasterPos[2];
+   GLint px, py;
 
    if (width > BITMAP_CACHE_WIDTH ||
        height > BITMAP_CACHE_HEIGHT)
       return GL_FALSE; /* too big to cache */
 
-   if (!cache->empty) {
-      px = x - cache->xpos;  /* pos in buffer */
-      py = y - cache->ypos;
-      if (px < 0 || px + width > BITMAP_CACHE_WIDTH ||
-          py < 0 || py + height > BITMAP_CACHE_HEIGHT ||
-          !TEST_EQ_4V(st->ctx->Current.RasterColor, cache->color) ||
+   if (cache->num_quads) {
+      if (!TEST_EQ_4V(st->ctx->Current.RasterColor, cache->color) ||
           ((fabs(z - cache->zpos) > Z_EPSILON))) {
-         /* This bitmap would extend beyond cache bounds, or the bitmap
-          * color is changing
-          * so flush and continue.
-          */
+         /* The bitmap color is changing, so flush and continue. */
          st_flush_bitmap_cache(st);
       }
    }
 
-   if (cache->empty) {
-      /* Initialize.  Center bitmap vertically in the buffer. */
-      px = 0;
-      py = (BITMAP_CACHE_HEIGHT - height) / 2;
-      cache->xpos = x;
-      cache->ypos = y - py;
+   /* Find room in the texture, in the current shelf or a new one */
+   if (cache->shelf_x + width > BITMAP_CACHE_WIDTH) {
+      cache->shelf_x = 0;
+      cache->shelf_y += cache->shelf_height;
+      cache->shelf_height = 0;
+   }
+   if (cache->shelf_y + height > BITMAP_CACHE_HEIGHT ||
+       cache->num_quads == BITMAP_CACHE_MAX_QUADS) {
+      /* The texture is full */
+      st_flush_bitmap_cache(st);
+   }
+
+   if (!cache->num_quads) {
       cache->zpos = z;
-      cache->empty = GL_FALSE;
       COPY_4FV(cache->color, st->ctx->Current.RasterColor);
    }
 
-   assert(px != -999);
-   assert(py != -999);
+   px = cache->shelf_x;
+   py = cache->shelf_y;
+   cache->shelf_x += width;
+   cache->shelf_height = MAX2(cache->shelf_height, height);
 
-   if (x < cache->xmin)
-      cache->xmin = x;
-   if (y < cache->ymin)
-      cache->ymin = y;
-   if (x + width > cache->xmax)
-      cache->xmax = x + width;
-   if (y + height > cache->ymax)
-      cache->ymax = y + height;
+   quad = &cache->quads[cache->num_quads++];
+   quad->x = x;
+   quad->y = y;
+   quad->width = width;
+   quad->height = height;
+   quad->px = px;
+   quad->py = py;
 
    /* create the transfer if needed */
    create_cache_trans(st);
@@ -731,11 +720,20 @@ accum_bitmap(struct gl_context *ctx,
    /* PBO source... */
    bitmap = _mesa_map_pbo_source(ctx, unpack, bitmap);
    if (!bitmap) {
+      cache->num_quads--;
       return FALSE;
    }
 
+   {
+      ubyte *dest = cache->buffer + py * cache->trans->stride + px;
+      GLsizei row;
+
+      for (row = 0; row < height; row++)
+         memset(dest + row * cache->trans->stride, 0xff, width);
+   }
+
    unpack_bitmap(st, px, py, width, height, unpack, bitmap,
-                 cache->buffer, BITMAP_CACHE_WIDTH);
+                 cache->buffer, cache->trans->stride);
 
    _mesa_unmap_pbo_source(ctx, unpack);
 
@@ -783,9 +781,17 @@ st_Bitmap(struct gl_context *ctx, GLint x, GLint y,
       assert(pt->target == PIPE_TEXTURE_2D || pt->target == PIPE_TEXTURE_RECT);
 
       if (sv) {
-         draw_bitmap_quad(ctx, x, y, ctx->Current.RasterPos[2],
-                          width, height, sv,
-                          st->ctx->Current.RasterColor);
+         struct bitmap_quad quad;
+
+         quad.x = x;
+         quad.y = y;
+         quad.width = width;
+         quad.height = height;
+         quad.px = 0;
+         quad.py = 0;
+
+         draw_bitmap_quads(ctx, &quad, 1, ctx->Current.RasterPos[2], sv,
+                           st->ctx->Current.RasterColor);
 
          pipe_sampler_view_reference(&sv, NULL);
       }
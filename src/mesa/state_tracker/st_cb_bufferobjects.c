@@ -35,10 +35,12 @@
 #include "main/mtypes.h"
 #include "main/arrayobj.h"
 #include "main/bufferobj.h"
+#include "main/streaming-load-memcpy.h"
 
 #include "st_context.h"
 #include "st_cb_bufferobjects.h"
 #include "st_debug.h"
+#include "st_draw.h"
 
 #include "pipe/p_context.h"
 #include "pipe/p_defines.h"
@@ -78,6 +80,9 @@ st_bufferobj_free(struct gl_context *ctx, struct gl_buffer_object *obj)
    assert(obj->RefCount == 0);
    assert(st_obj->transfer == NULL);
 
+   if (st_obj->readback)
+      st_discard_readback(st_obj);
+
    if (st_obj->buffer)
       pipe_resource_reference(&st_obj->buffer, NULL);
 
@@ -122,6 +127,9 @@ st_bufferobj_subdata(struct gl_context *ctx,
       return;
    }
 
+   st_flush_pending_draw(st_context(ctx));
+   st_bufferobj_sync(st_context(ctx), st_obj);
+
    /* Now that transfers are per-context, we don't have to figure out
     * flushing here.  Usually drivers won't need to flush in this case
     * even if the buffer is currently referenced by hardware - they
@@ -144,6 +152,9 @@ st_bufferobj_get_subdata(struct gl_context *ctx,
                          GLvoid * data, struct gl_buffer_object *obj)
 {
    struct st_buffer_object *st_obj = st_buffer_object(obj);
+   struct pipe_context *pipe = st_context(ctx)->pipe;
+   struct pipe_transfer *transfer;
+   const void *map;
 
    /* we may be called from VBO code, so double-check params here */
    ASSERT(offset >= 0);
@@ -158,8 +169,16 @@ st_bufferobj_get_subdata(struct gl_context *ctx,
       return;
    }
 
-   pipe_buffer_read(st_context(ctx)->pipe, st_obj->buffer,
-                    offset, size, data);
+   st_bufferobj_sync(st_context(ctx), st_obj);
+
+   /* Like pipe_buffer_read(), but the mapping may be uncached */
+   map = pipe_buffer_map_range(pipe, st_obj->buffer, offset, size,
+                               PIPE_TRANSFER_READ, &transfer);
+   if (!map)
+      return;
+
+   _mesa_memcpy_rows_from_mapping(data, size, map, size, size, 1);
+   pipe_buffer_unmap(pipe, transfer);
 }
 
 
@@ -181,7 +200,12 @@ st_bufferobj_data(struct gl_context *ctx,
    struct st_context *st = st_context(ctx);
    struct pipe_context *pipe = st->pipe;
    struct st_buffer_object *st_obj = st_buffer_object(obj);
-   unsigned bind, pipe_usage;
+   unsigned bind, pipe_usage, pipe_flags = 0;
+
+   if (st_obj->readback)
+      st_discard_readback(st_obj);
+
+   st_flush_pending_draw(st);
 
    if (size && data && st_obj->buffer &&
        st_obj->Base.Size == size && st_obj->Base.Usage == usage) {
@@ -225,23 +249,37 @@ st_bufferobj_data(struct gl_context *ctx,
       bind = 0;
    }
 
-   switch (usage) {
-   case GL_STATIC_DRAW:
-   case GL_STATIC_READ:
-   case GL_STATIC_COPY:
-   default:
-      pipe_usage = PIPE_USAGE_DEFAULT;
-      break;
-   case GL_DYNAMIC_DRAW:
-   case GL_DYNAMIC_READ:
-   case GL_DYNAMIC_COPY:
-      pipe_usage = PIPE_USAGE_DYNAMIC;
-      break;
-   case GL_STREAM_DRAW:
-   case GL_STREAM_READ:
-   case GL_STREAM_COPY:
-      pipe_usage = PIPE_USAGE_STREAM;
-      break;
+   if (st_obj->Base.Immutable) {
+      /* glBufferStorage */
+      if (st_obj->Base.StorageFlags & GL_CLIENT_STORAGE_BIT)
+         pipe_usage = PIPE_USAGE_STAGING;
+      else
+         pipe_usage = PIPE_USAGE_DEFAULT;
+
+      if (st_obj->Base.StorageFlags & GL_MAP_PERSISTENT_BIT)
+         pipe_flags |= PIPE_RESOURCE_FLAG_MAP_PERSISTENT;
+      if (st_obj->Base.StorageFlags & GL_MAP_COHERENT_BIT)
+         pipe_flags |= PIPE_RESOURCE_FLAG_MAP_COHERENT;
+   }
+   else {
+      switch (usage) {
+      case GL_STATIC_DRAW:
+      case GL_STATIC_READ:
+      case GL_STATIC_COPY:
+      default:
+         pipe_usage = PIPE_USAGE_DEFAULT;
+         break;
+      case GL_DYNAMIC_DRAW:
+      case GL_DYNAMIC_READ:
+      case GL_DYNAMIC_COPY:
+         pipe_usage = PIPE_USAGE_DYNAMIC;
+         break;
+      case GL_STREAM_DRAW:
+      case GL_STREAM_READ:
+      case GL_STREAM_COPY:
+         pipe_usage = PIPE_USAGE_STREAM;
+         break;
+      }
    }
 
    pipe_resource_reference( &st_obj->buffer, NULL );
@@ -251,8 +289,20 @@ st_bufferobj_data(struct gl_context *ctx,
    }
 
    if (size != 0) {
-      st_obj->buffer = pipe_buffer_create(pipe->screen, bind,
-                                          pipe_usage, size);
+      struct pipe_resource buffer;
+
+      memset(&buffer, 0, sizeof buffer);
+      buffer.target = PIPE_BUFFER;
+      buffer.format = PIPE_FORMAT_R8_UNORM; /* want TYPELESS or similar */
+      buffer.bind = bind;
+      buffer.usage = pipe_usage;
+      buffer.flags = pipe_flags;
+      buffer.width0 = size;
+      buffer.height0 = 1;
+      buffer.depth0 = 1;
+      buffer.array_size = 1;
+
+      st_obj->buffer = pipe->screen->resource_create(pipe->screen, &buffer);
 
       if (!st_obj->buffer) {
          /* out of memory */
@@ -305,6 +355,12 @@ st_bufferobj_map_range(struct gl_context *ctx,
    if (access & GL_MAP_UNSYNCHRONIZED_BIT)
       flags |= PIPE_TRANSFER_UNSYNCHRONIZED;
 
+   if (access & GL_MAP_PERSISTENT_BIT)
+      flags |= PIPE_TRANSFER_PERSISTENT;
+
+   if (access & GL_MAP_COHERENT_BIT)
+      flags |= PIPE_TRANSFER_COHERENT;
+
    /* ... other flags ...
     */
 
@@ -316,6 +372,15 @@ st_bufferobj_map_range(struct gl_context *ctx,
    assert(offset < obj->Size);
    assert(offset + length <= obj->Size);
 
+   st_flush_pending_draw(st_context(ctx));
+
+   if (st_obj->readback) {
+      if (access & GL_MAP_INVALIDATE_BUFFER_BIT)
+         st_discard_readback(st_obj);
+      else
+         st_finish_readback(st_context(ctx), st_obj);
+   }
+
    obj->Pointer = pipe_buffer_map_range(pipe,
                                         st_obj->buffer,
                                         offset, length,
@@ -395,8 +460,12 @@ st_copy_buffer_subdata(struct gl_context *ctx,
       return;
 
    /* buffer should not already be mapped */
-   assert(!src->Pointer);
-   assert(!dst->Pointer);
+   assert(!_mesa_check_disallowed_mapping(src));
+   assert(!_mesa_check_disallowed_mapping(dst));
+
+   st_flush_pending_draw(st_context(ctx));
+   st_bufferobj_sync(st_context(ctx), srcObj);
+   st_bufferobj_sync(st_context(ctx), dstObj);
 
    u_box_1d(readOffset, size, &box);
 
@@ -34,6 +34,7 @@
 struct dd_function_table;
 struct pipe_resource;
 struct st_context;
+struct st_readback;
 
 /**
  * State_tracker vertex/pixel buffer object, derived from Mesa's
@@ -44,6 +45,7 @@ struct st_buffer_object
    struct gl_buffer_object Base;
    struct pipe_resource *buffer;     /* GPU storage */
    struct pipe_transfer *transfer; /* In-progress map information */
+   struct st_readback *readback;   /* glReadPixels not in the buffer yet */
 };
 
 
@@ -55,6 +57,26 @@ st_buffer_object(struct gl_buffer_object *obj)
 }
 
 
+/* In st_cb_readpixels.c */
+extern void
+st_finish_readback(struct st_context *st, struct st_buffer_object *stobj);
+
+extern void
+st_discard_readback(struct st_buffer_object *stobj);
+
+
+/**
+ * Make sure the pixels of an asynchronous glReadPixels into the buffer
+ * have landed, before the buffer is accessed.
+ */
+static INLINE void
+st_bufferobj_sync(struct st_context *st, struct st_buffer_object *obj)
+{
+   if (obj->readback)
+      st_finish_readback(st, obj);
+}
+
+
 extern void
 st_bufferobj_validate_usage(struct st_context *st,
 			    struct st_buffer_object *obj,
@@ -454,23 +454,105 @@ internal_format(struct gl_context *ctx, GLenum format, GLenum type)
 
 
 /**
- * Create a temporary texture to hold an image of the given size.
- * If width, height are not POT and the driver only handles POT textures,
- * allocate the next larger size of texture that is POT.
+ * Drop a texture from the cache of glDraw/CopyPixels image textures.
+ */
+static void
+evict_texture(struct st_context *st, struct pipe_resource *pt)
+{
+   const unsigned n = Elements(st->drawpix.textures);
+   unsigned i;
+
+   for (i = 0; i < n; i++) {
+      if (st->drawpix.textures[i].texture == pt) {
+         pipe_sampler_view_reference(&st->drawpix.textures[i].view, NULL);
+         pipe_resource_reference(&st->drawpix.textures[i].texture, NULL);
+         memmove(&st->drawpix.textures[i], &st->drawpix.textures[i + 1],
+                 (n - 1 - i) * sizeof(st->drawpix.textures[0]));
+         memset(&st->drawpix.textures[n - 1], 0,
+                sizeof(st->drawpix.textures[0]));
+         return;
+      }
+   }
+}
+
+
+/**
+ * Get a texture to hold an image of the given size.  Textures are kept
+ * in a small cache, so drawing images of the same size and format over
+ * and over, like tiles, doesn't allocate a new texture every time.
+ * \return a new reference to the texture
  */
 static struct pipe_resource *
 alloc_texture(struct st_context *st, GLsizei width, GLsizei height,
               enum pipe_format texFormat, unsigned bind)
 {
-   struct pipe_resource *pt;
+   const unsigned n = Elements(st->drawpix.textures);
+   struct pipe_resource *pt = NULL;
+   struct pipe_sampler_view *view = NULL;
+   unsigned i;
+
+   for (i = 0; i < n && st->drawpix.textures[i].texture; i++) {
+      struct pipe_resource *cached = st->drawpix.textures[i].texture;
+
+      if (cached->width0 == width &&
+          cached->height0 == height &&
+          cached->format == texFormat &&
+          cached->bind == bind) {
+         pt = cached;
+         view = st->drawpix.textures[i].view;
+         break;
+      }
+   }
+
+   if (!pt) {
+      pt = st_texture_create(st, st->internal_target, texFormat, 0,
+                             width, height, 1, 1, 0, bind);
+      if (!pt)
+         return NULL;
 
-   pt = st_texture_create(st, st->internal_target, texFormat, 0,
-                          width, height, 1, 1, 0, bind);
+      /* replace the least recently used texture */
+      i = n - 1;
+      pipe_sampler_view_reference(&st->drawpix.textures[i].view, NULL);
+      pipe_resource_reference(&st->drawpix.textures[i].texture, NULL);
+   }
+
+   /* move it to the front, the cache keeps its own reference */
+   memmove(&st->drawpix.textures[1], &st->drawpix.textures[0],
+           i * sizeof(st->drawpix.textures[0]));
+   st->drawpix.textures[0].texture = pt;
+   st->drawpix.textures[0].view = view;
 
+   pt = NULL;
+   pipe_resource_reference(&pt, st->drawpix.textures[0].texture);
    return pt;
 }
 
 
+/**
+ * Get a sampler view of a texture returned by alloc_texture().
+ * \return a new reference to the sampler view
+ */
+static struct pipe_sampler_view *
+get_texture_sampler_view(struct st_context *st, struct pipe_resource *pt)
+{
+   struct pipe_sampler_view *view = NULL;
+   unsigned i;
+
+   for (i = 0; i < Elements(st->drawpix.textures); i++) {
+      if (st->drawpix.textures[i].texture == pt) {
+         if (!st->drawpix.textures[i].view)
+            st->drawpix.textures[i].view =
+               st_create_texture_sampler_view(st->pipe, pt);
+
+         pipe_sampler_view_reference(&view, st->drawpix.textures[i].view);
+         return view;
+      }
+   }
+
+   return st_create_texture_sampler_view(st->pipe, pt);
+}
+
+
 /**
  * Make texture containing an image for glDrawPixels image.
  * If 'pixels' is NULL, leave the texture image data undefined.
@@ -527,14 +609,38 @@ make_texture(struct st_context *st,
       GLubyte *dest;
       const GLbitfield imageTransferStateSave = ctx->_ImageTransferState;
 
+      /* map texture transfer, a reused texture may still be in use */
+      dest = pipe_transfer_map(pipe, pt, 0, 0,
+                               PIPE_TRANSFER_WRITE |
+                               PIPE_TRANSFER_DISCARD_WHOLE_RESOURCE |
+                               PIPE_TRANSFER_DONTBLOCK,
+                               0, 0, width, height, &transfer);
+      if (!dest) {
+         /* rather than waiting for the GPU, get a brand new texture */
+         evict_texture(st, pt);
+         pipe_resource_reference(&pt, NULL);
+
+         pt = alloc_texture(st, width, height, pipeFormat,
+                            PIPE_BIND_SAMPLER_VIEW);
+         if (!pt) {
+            _mesa_unmap_pbo_source(ctx, unpack);
+            return NULL;
+         }
+
+         dest = pipe_transfer_map(pipe, pt, 0, 0,
+                                  PIPE_TRANSFER_WRITE |
+                                  PIPE_TRANSFER_DISCARD_WHOLE_RESOURCE,
+                                  0, 0, width, height, &transfer);
+         if (!dest) {
+            pipe_resource_reference(&pt, NULL);
+            _mesa_unmap_pbo_source(ctx, unpack);
+            return NULL;
+         }
+      }
+
       /* we'll do pixel transfer in a fragment shader */
       ctx->_ImageTransferState = 0x0;
 
-      /* map texture transfer */
-      dest = pipe_transfer_map(pipe, pt, 0, 0,
-                               PIPE_TRANSFER_WRITE, 0, 0,
-                               width, height, &transfer);
-
 
       /* Put image into texture transfer.
        * Note that the image is actually going to be upside down in
@@ -1172,7 +1278,7 @@ st_DrawPixels(struct gl_context *ctx, GLint x, GLint y,
       struct pipe_resource *pt
          = make_texture(st, width, height, format, type, unpack, pixels);
       if (pt) {
-         sv[0] = st_create_texture_sampler_view(st->pipe, pt);
+         sv[0] = get_texture_sampler_view(st, pt);
 
          if (sv[0]) {
             /* Create a second sampler view to read stencil.
@@ -1622,7 +1728,7 @@ st_CopyPixels(struct gl_context *ctx, GLint srcx, GLint srcy,
    if (!pt)
       return;
 
-   sv[0] = st_create_texture_sampler_view(st->pipe, pt);
+   sv[0] = get_texture_sampler_view(st, pt);
    if (!sv[0]) {
       pipe_resource_reference(&pt, NULL);
       return;
@@ -1691,6 +1797,11 @@ st_destroy_drawpix(struct st_context *st)
          _mesa_reference_fragprog(st->ctx, &st->drawpix.shaders[i], NULL);
    }
 
+   for (i = 0; i < Elements(st->drawpix.textures); i++) {
+      pipe_sampler_view_reference(&st->drawpix.textures[i].view, NULL);
+      pipe_resource_reference(&st->drawpix.textures[i].texture, NULL);
+   }
+
    st_reference_fragprog(st, &st->pixel_xfer.combined_prog, NULL);
    if (st->drawpix.vert_shaders[0])
       cso_delete_vertex_shader(st->cso_context, st->drawpix.vert_shaders[0]);
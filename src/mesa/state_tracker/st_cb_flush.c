@@ -44,6 +44,7 @@
 #include "pipe/p_defines.h"
 #include "pipe/p_screen.h"
 #include "util/u_gen_mipmap.h"
+#include "util/u_trace_events.h"
 
 
 /** Check if we have a front color buffer and if it's been drawn to. */
@@ -79,12 +80,16 @@ void st_flush(struct st_context *st,
               struct pipe_fence_handle **fence,
               unsigned flags)
 {
+   util_trace_event_begin("st_flush");
+
    FLUSH_VERTICES(st->ctx, 0);
    FLUSH_CURRENT(st->ctx, 0);
 
    st_flush_bitmap_cache(st);
 
    st->pipe->flush(st->pipe, fence, flags);
+
+   util_trace_event_end("st_flush");
 }
 
 
@@ -98,8 +103,10 @@ void st_finish( struct st_context *st )
    st_flush(st, &fence, 0);
 
    if(fence) {
+      util_trace_event_begin("st_finish wait");
       st->pipe->screen->fence_finish(st->pipe->screen, fence,
                                      PIPE_TIMEOUT_INFINITE);
+      util_trace_event_end("st_finish wait");
       st->pipe->screen->fence_reference(st->pipe->screen, &fence, NULL);
    }
 }
@@ -132,6 +132,8 @@ st_delete_program(struct gl_context *ctx, struct gl_program *prog)
          
          if (stvp->glsl_to_tgsi)
             free_glsl_to_tgsi_visitor(stvp->glsl_to_tgsi);
+
+         free(stvp->cache_source);
       }
       break;
    case MESA_GEOMETRY_PROGRAM:
@@ -144,6 +146,8 @@ st_delete_program(struct gl_context *ctx, struct gl_program *prog)
          if (stgp->glsl_to_tgsi)
             free_glsl_to_tgsi_visitor(stgp->glsl_to_tgsi);
 
+         free(stgp->cache_source);
+
          if (stgp->tgsi.tokens) {
             st_free_tokens((void *) stgp->tgsi.tokens);
             stgp->tgsi.tokens = NULL;
@@ -159,6 +163,8 @@ st_delete_program(struct gl_context *ctx, struct gl_program *prog)
          
          if (stfp->glsl_to_tgsi)
             free_glsl_to_tgsi_visitor(stfp->glsl_to_tgsi);
+
+         free(stfp->cache_source);
       }
       break;
    default:
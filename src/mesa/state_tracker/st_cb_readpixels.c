@@ -25,6 +25,7 @@
  * 
  **************************************************************************/
 
+#include "main/bufferobj.h"
 #include "main/image.h"
 #include "main/pbo.h"
 #include "main/imports.h"
@@ -38,12 +39,149 @@
 #include "st_atom.h"
 #include "st_context.h"
 #include "st_cb_bitmap.h"
+#include "st_cb_bufferobjects.h"
 #include "st_cb_readpixels.h"
 #include "state_tracker/st_cb_texture.h"
 #include "state_tracker/st_format.h"
 #include "state_tracker/st_texture.h"
 
 
+/**
+ * A glReadPixels into a PBO which hasn't landed in the buffer yet.  The
+ * pixels have been blitted to a staging texture in the requested format and
+ * type, they only need to be copied into place.
+ */
+struct st_readback
+{
+   struct pipe_resource *texture;
+   unsigned width, height;
+   unsigned bytes_per_row;
+   GLintptr offset;     /**< of the first row in the buffer */
+   GLintptr stride;     /**< between rows in the buffer, may be negative */
+};
+
+
+/**
+ * Copy the pixels of a pending readback into the buffer.  This waits for
+ * the blit to the staging texture to finish, but by the time the buffer is
+ * accessed it usually has.
+ */
+void
+st_finish_readback(struct st_context *st, struct st_buffer_object *stobj)
+{
+   struct pipe_context *pipe = st->pipe;
+   struct st_readback *rb = stobj->readback;
+   struct pipe_transfer *tex_xfer, *buf_xfer;
+   GLintptr start, end;
+   const ubyte *src;
+   ubyte *dst;
+   unsigned row;
+
+   stobj->readback = NULL;
+
+   if (rb->stride >= 0) {
+      start = rb->offset;
+      end = rb->offset + (rb->height - 1) * rb->stride + rb->bytes_per_row;
+   }
+   else {
+      start = rb->offset + (rb->height - 1) * rb->stride;
+      end = rb->offset + rb->bytes_per_row;
+   }
+
+   src = pipe_transfer_map_3d(pipe, rb->texture, 0, PIPE_TRANSFER_READ,
+                              0, 0, 0, rb->width, rb->height, 1, &tex_xfer);
+   if (src) {
+      dst = pipe_buffer_map_range(pipe, stobj->buffer, start, end - start,
+                                  PIPE_TRANSFER_WRITE, &buf_xfer);
+      if (dst) {
+         dst += rb->offset - start;
+
+         for (row = 0; row < rb->height; row++) {
+            memcpy(dst, src, rb->bytes_per_row);
+            dst += rb->stride;
+            src += tex_xfer->stride;
+         }
+
+         pipe_buffer_unmap(pipe, buf_xfer);
+      }
+
+      pipe_transfer_unmap(pipe, tex_xfer);
+   }
+
+   pipe_resource_reference(&rb->texture, NULL);
+   free(rb);
+}
+
+
+/**
+ * Drop a pending readback, because the buffer's contents are replaced or
+ * the buffer is deleted.
+ */
+void
+st_discard_readback(struct st_buffer_object *stobj)
+{
+   struct st_readback *rb = stobj->readback;
+
+   stobj->readback = NULL;
+   pipe_resource_reference(&rb->texture, NULL);
+   free(rb);
+}
+
+
+/**
+ * Leave the pixels which were blitted to the staging texture in there, and
+ * copy them into the pack buffer when it is accessed the next time.  That
+ * way reading back into a PBO doesn't wait for the GPU.
+ * \return FALSE if the pixels have to be copied right away
+ */
+static boolean
+queue_readback(struct st_context *st,
+               const struct gl_pixelstore_attrib *pack, const GLvoid *pixels,
+               struct pipe_resource *texture,
+               GLsizei width, GLsizei height, GLenum format, GLenum type)
+{
+   struct pipe_context *pipe = st->pipe;
+   struct st_buffer_object *stobj = st_buffer_object(pack->BufferObj);
+   struct st_readback *rb;
+   const GLubyte *row0, *row1;
+
+   if (!stobj->buffer)
+      return FALSE;
+
+   rb = ST_CALLOC_STRUCT(st_readback);
+   if (!rb)
+      return FALSE;
+
+   /* An earlier readback may overlap this one */
+   if (stobj->readback)
+      st_finish_readback(st, stobj);
+
+   row0 = _mesa_image_address3d(pack, pixels, width, height,
+                                format, type, 0, 0, 0);
+   row1 = _mesa_image_address3d(pack, pixels, width, height,
+                                format, type, 0, 1, 0);
+
+   pipe_resource_reference(&rb->texture, texture);
+   rb->width = width;
+   rb->height = height;
+   rb->bytes_per_row = width * util_format_get_blocksize(texture->format);
+   rb->offset = (GLintptr) row0;
+   rb->stride = row1 - row0;
+   stobj->readback = rb;
+
+   /* The buffer may be bound as something else too, revalidating those
+    * bindings finishes the readback when needed.
+    */
+   st->dirty.st |= ST_NEW_VERTEX_ARRAYS | ST_NEW_UNIFORM_BUFFER;
+   st->dirty.mesa |= _NEW_TEXTURE;
+
+   /* Get the GPU started on the blit */
+   pipe->flush(pipe, NULL, 0);
+
+   return TRUE;
+}
+
+
 /**
  * This uses a blit to copy the read buffer to a texture format which matches
  * the format and type combo and then a fast read-back is done using memcpy.
@@ -52,6 +190,9 @@
  *
  * If such a format isn't available, we fall back to _mesa_readpixels.
  *
+ * When reading into a PBO, the copy out of the texture is deferred until
+ * the buffer is accessed, see queue_readback().
+ *
  * NOTE: Some drivers use a blit to convert between tiled and linear
  *       texture layouts during texture uploads/downloads, so the blit
  *       we do here should be free in such cases.
@@ -113,8 +254,10 @@ st_readpixels(struct gl_context *ctx, GLint x, GLint y,
 
    /* See if the texture format already matches the format and type,
     * in which case the memcpy-based fast path will likely be used and
-    * we don't have to blit. */
-   if (_mesa_format_matches_format_and_type(rb->Format, format,
+    * we don't have to blit.  Blitting still lets PBO readbacks complete
+    * asynchronously though. */
+   if (!_mesa_is_bufferobj(pack->BufferObj) &&
+       _mesa_format_matches_format_and_type(rb->Format, format,
                                             type, pack->SwapBytes)) {
       goto fallback;
    }
@@ -192,6 +335,12 @@ st_readpixels(struct gl_context *ctx, GLint x, GLint y,
    /* blit */
    st->pipe->blit(st->pipe, &blit);
 
+   if (_mesa_is_bufferobj(pack->BufferObj) &&
+       queue_readback(st, pack, pixels, dst, width, height, format, type)) {
+      pipe_resource_reference(&dst, NULL);
+      return;
+   }
+
    /* map resources */
    pixels = _mesa_map_pbo_dest(ctx, pack, pixels);
 
@@ -36,6 +36,7 @@
 #include "pipe/p_screen.h"
 #include "st_context.h"
 #include "st_cb_syncobj.h"
+#include "st_draw.h"
 
 struct st_sync_object {
    struct gl_sync_object b;
@@ -73,6 +74,7 @@ static void st_fence_sync(struct gl_context *ctx, struct gl_sync_object *obj,
    assert(condition == GL_SYNC_GPU_COMMANDS_COMPLETE && flags == 0);
    assert(so->fence == NULL);
 
+   st_flush_pending_draw(st_context(ctx));
    pipe->flush(pipe, &so->fence, 0);
 }
 
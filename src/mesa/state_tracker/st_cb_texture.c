@@ -63,6 +63,10 @@
 #include "util/u_sampler.h"
 #include "util/u_math.h"
 #include "util/u_box.h"
+#include "util/u_simple_shaders.h"
+#include "util/u_upload_mgr.h"
+#include "tgsi/tgsi_ureg.h"
+#include "cso_cache/cso_context.h"
 
 #define DBG if (0) printf
 
@@ -585,6 +589,399 @@ st_get_blit_mask(GLenum srcFormat, GLenum dstFormat)
 }
 
 
+/**
+ * Set up uploading texture images with a shader which fetches the pixels
+ * from a buffer texture, see try_pbo_upload().
+ */
+void
+st_init_pbo_upload(struct st_context *st)
+{
+   struct pipe_screen *screen = st->pipe->screen;
+
+   memset(&st->pbo_upload, 0, sizeof(st->pbo_upload));
+
+   if (!st->prefer_blit_based_texture_transfer ||
+       !screen->get_param(screen, PIPE_CAP_TEXTURE_BUFFER_OBJECTS) ||
+       !screen->get_shader_param(screen, PIPE_SHADER_FRAGMENT,
+                                 PIPE_SHADER_CAP_INTEGERS))
+      return;
+
+   st->pbo_upload.offset_align =
+      MAX2(screen->get_param(screen,
+                             PIPE_CAP_TEXTURE_BUFFER_OFFSET_ALIGNMENT), 4);
+   st->pbo_upload.max_texels =
+      screen->get_param(screen, PIPE_CAP_MAX_TEXTURE_BUFFER_SIZE);
+
+   /* Client memory is staged in here */
+   st->pbo_upload.uploader = u_upload_create(st->pipe, 1024 * 1024,
+                                             st->pbo_upload.offset_align,
+                                             PIPE_BIND_SAMPLER_VIEW);
+
+   st->pbo_upload.enabled = st->pbo_upload.uploader != NULL;
+}
+
+
+void
+st_destroy_pbo_upload(struct st_context *st)
+{
+   if (st->pbo_upload.fs) {
+      cso_delete_fragment_shader(st->cso_context, st->pbo_upload.fs);
+      st->pbo_upload.fs = NULL;
+   }
+   if (st->pbo_upload.vs) {
+      cso_delete_vertex_shader(st->cso_context, st->pbo_upload.vs);
+      st->pbo_upload.vs = NULL;
+   }
+   if (st->pbo_upload.uploader) {
+      u_upload_destroy(st->pbo_upload.uploader);
+      st->pbo_upload.uploader = NULL;
+   }
+}
+
+
+/**
+ * Make the fragment shader of the upload.  It computes the index of the
+ * pixel in the buffer from the window position, as
+ *
+ *    (pos.x - CONST[0].x) + (pos.y - CONST[0].y) * CONST[0].z + CONST[0].w
+ *
+ * in integers, with the negated offsets in CONST[0].xy, and fetches it.
+ */
+static void *
+create_pbo_upload_fs(struct st_context *st)
+{
+   struct ureg_program *ureg;
+   struct ureg_src pos, param, sampler;
+   struct ureg_dst out, temp;
+
+   ureg = ureg_create(TGSI_PROCESSOR_FRAGMENT);
+   if (!ureg)
+      return NULL;
+
+   pos = ureg_DECL_fs_input(ureg, TGSI_SEMANTIC_POSITION, 0,
+                            TGSI_INTERPOLATE_LINEAR);
+   param = ureg_DECL_constant(ureg, 0);
+   sampler = ureg_DECL_sampler(ureg, 0);
+   out = ureg_DECL_output(ureg, TGSI_SEMANTIC_COLOR, 0);
+   temp = ureg_DECL_temporary(ureg);
+
+   ureg_F2I(ureg, ureg_writemask(temp, TGSI_WRITEMASK_XY), pos);
+   ureg_UADD(ureg, ureg_writemask(temp, TGSI_WRITEMASK_XY),
+             ureg_src(temp), param);
+   ureg_UMAD(ureg, ureg_writemask(temp, TGSI_WRITEMASK_X),
+             ureg_scalar(ureg_src(temp), TGSI_SWIZZLE_Y),
+             ureg_scalar(param, TGSI_SWIZZLE_Z),
+             ureg_src(temp));
+   ureg_UADD(ureg, ureg_writemask(temp, TGSI_WRITEMASK_X),
+             ureg_src(temp), ureg_scalar(param, TGSI_SWIZZLE_W));
+   ureg_TXF(ureg, out, TGSI_TEXTURE_BUFFER,
+            ureg_scalar(ureg_src(temp), TGSI_SWIZZLE_X), sampler);
+   ureg_END(ureg);
+
+   return ureg_create_shader_and_destroy(ureg, st->pipe);
+}
+
+
+/**
+ * Store pixels by drawing into the texture with a shader which fetches
+ * them from a buffer texture.  The buffer is the unpack PBO, or a copy of
+ * client memory made with an upload manager.  That way the conversion
+ * runs on the GPU and nothing waits for a PBO to become idle.
+ * \return GL_FALSE if the pixels need to be stored some other way
+ */
+static GLboolean
+try_pbo_upload(struct gl_context *ctx, GLuint dims,
+               struct gl_texture_image *texImage,
+               GLenum format, GLenum type,
+               enum pipe_format src_format, enum pipe_format dst_format,
+               GLint xoffset, GLint yoffset, GLint zoffset,
+               GLint width, GLint height, GLint depth,
+               const void *pixels,
+               const struct gl_pixelstore_attrib *unpack)
+{
+   struct st_context *st = st_context(ctx);
+   struct st_texture_image *stImage = st_texture_image(texImage);
+   struct st_texture_object *stObj = st_texture_object(texImage->TexObject);
+   struct pipe_context *pipe = st->pipe;
+   struct pipe_screen *screen = pipe->screen;
+   struct cso_context *cso = st->cso_context;
+   struct pipe_resource *dst = stImage->pt;
+   struct pipe_resource *buffer = NULL;
+   struct pipe_sampler_view templ, *view;
+   struct pipe_sampler_state sampler;
+   struct pipe_constant_buffer cb;
+   struct pipe_vertex_buffer vb;
+   const GLenum gl_target = texImage->TexObject->Target;
+   const unsigned bytes_per_texel = util_format_get_blocksize(src_format);
+   const unsigned level = stObj->pt != stImage->pt ? 0 : texImage->Level;
+   const unsigned surf_width = u_minify(dst->width0, level);
+   const unsigned surf_height = u_minify(dst->height0, level);
+   const GLubyte *first;
+   unsigned row_stride, image_stride, size, offset, skip, num_texels;
+   int32_t params[4];
+   float (*verts)[4];
+   GLint slice;
+
+   if (!st->pbo_upload.enabled)
+      return GL_FALSE;
+
+   /* The rows of 1D array images are layers */
+   if (gl_target == GL_TEXTURE_1D_ARRAY)
+      return GL_FALSE;
+
+   if (util_format_is_pure_integer(src_format) ||
+       util_format_is_pure_integer(dst_format) ||
+       util_format_is_depth_or_stencil(dst_format))
+      return GL_FALSE;
+
+   if (!screen->is_format_supported(screen, src_format, PIPE_BUFFER, 0,
+                                    PIPE_BIND_SAMPLER_VIEW))
+      return GL_FALSE;
+
+   /* Leave recording out of bounds accesses to the fallback */
+   if (_mesa_is_bufferobj(unpack->BufferObj)) {
+      if (!_mesa_validate_pbo_access(dims, unpack, width, height, depth,
+                                     format, type, INT_MAX, pixels))
+         return GL_FALSE;
+   }
+   else if (!pixels) {
+      return GL_FALSE;
+   }
+
+   /* Where the pixels are, in texels */
+   first = _mesa_image_address3d(unpack, pixels, width, height,
+                                 format, type, 0, 0, 0);
+   row_stride = _mesa_image_row_stride(unpack, width, format, type);
+   image_stride = dims == 3 ?
+      _mesa_image_image_stride(unpack, width, height, format, type) : 0;
+   size = (depth - 1) * image_stride + (height - 1) * row_stride +
+          width * bytes_per_texel;
+
+   if (row_stride % bytes_per_texel || image_stride % bytes_per_texel)
+      return GL_FALSE;
+
+   if (_mesa_is_bufferobj(unpack->BufferObj)) {
+      struct st_buffer_object *stobj = st_buffer_object(unpack->BufferObj);
+
+      if (!stobj->buffer)
+         return GL_FALSE;
+
+      st_bufferobj_sync(st, stobj);
+      pipe_resource_reference(&buffer, stobj->buffer);
+      offset = (unsigned) (uintptr_t) first;
+   }
+   else {
+      if (u_upload_data(st->pbo_upload.uploader, 0, size, first,
+                        &offset, &buffer) != PIPE_OK)
+         return GL_FALSE;
+      u_upload_unmap(st->pbo_upload.uploader);
+   }
+
+   /* Buffer views must start at an aligned offset */
+   skip = offset % st->pbo_upload.offset_align;
+   offset -= skip;
+   num_texels = (skip + size) / bytes_per_texel;
+
+   if (skip % bytes_per_texel || offset % bytes_per_texel ||
+       num_texels > st->pbo_upload.max_texels) {
+      pipe_resource_reference(&buffer, NULL);
+      return GL_FALSE;
+   }
+
+   memset(&templ, 0, sizeof(templ));
+   templ.format = src_format;
+   templ.u.buf.first_element = offset / bytes_per_texel;
+   templ.u.buf.last_element = templ.u.buf.first_element + num_texels - 1;
+   templ.swizzle_r = PIPE_SWIZZLE_RED;
+   templ.swizzle_g = PIPE_SWIZZLE_GREEN;
+   templ.swizzle_b = PIPE_SWIZZLE_BLUE;
+   templ.swizzle_a = PIPE_SWIZZLE_ALPHA;
+
+   view = pipe->create_sampler_view(pipe, buffer, &templ);
+   pipe_resource_reference(&buffer, NULL);
+   if (!view)
+      return GL_FALSE;
+
+   if (!st->pbo_upload.vs) {
+      const uint semantic_names[] = { TGSI_SEMANTIC_POSITION };
+      const uint semantic_indexes[] = { 0 };
+
+      st->pbo_upload.vs =
+         util_make_vertex_passthrough_shader(pipe, 1, semantic_names,
+                                             semantic_indexes);
+   }
+   if (!st->pbo_upload.fs)
+      st->pbo_upload.fs = create_pbo_upload_fs(st);
+   if (!st->pbo_upload.vs || !st->pbo_upload.fs) {
+      pipe_sampler_view_reference(&view, NULL);
+      return GL_FALSE;
+   }
+
+   /* The quad covering the pixels, in clip coordinates */
+   memset(&vb, 0, sizeof(vb));
+   vb.stride = 4 * sizeof(float);
+   if (u_upload_alloc(st->uploader, 0, 4 * sizeof(verts[0]),
+                      &vb.buffer_offset, &vb.buffer,
+                      (void **) &verts) != PIPE_OK) {
+      pipe_sampler_view_reference(&view, NULL);
+      return GL_FALSE;
+   }
+
+   {
+      const float x0 = (float) xoffset / surf_width * 2.0f - 1.0f;
+      const float y0 = (float) yoffset / surf_height * 2.0f - 1.0f;
+      const float x1 = (float) (xoffset + width) / surf_width * 2.0f - 1.0f;
+      const float y1 = (float) (yoffset + height) / surf_height * 2.0f - 1.0f;
+      unsigned i;
+
+      verts[0][0] = x0;  verts[0][1] = y0;
+      verts[1][0] = x1;  verts[1][1] = y0;
+      verts[2][0] = x1;  verts[2][1] = y1;
+      verts[3][0] = x0;  verts[3][1] = y1;
+      for (i = 0; i < 4; i++) {
+         verts[i][2] = 0.0f;
+         verts[i][3] = 1.0f;
+      }
+   }
+
+   u_upload_unmap(st->uploader);
+
+   cso_save_blend(cso);
+   cso_save_depth_stencil_alpha(cso);
+   cso_save_rasterizer(cso);
+   cso_save_sample_mask(cso);
+   cso_save_viewport(cso);
+   cso_save_framebuffer(cso);
+   cso_save_render_condition(cso);
+   cso_save_samplers(cso, PIPE_SHADER_FRAGMENT);
+   cso_save_sampler_views(cso, PIPE_SHADER_FRAGMENT);
+   cso_save_constant_buffer_slot0(cso, PIPE_SHADER_FRAGMENT);
+   cso_save_fragment_shader(cso);
+   cso_save_stream_outputs(cso);
+   cso_save_vertex_shader(cso);
+   cso_save_geometry_shader(cso);
+   cso_save_vertex_elements(cso);
+   cso_save_aux_vertex_buffer_slot(cso);
+
+   {
+      struct pipe_blend_state blend;
+      struct pipe_depth_stencil_alpha_state dsa;
+      struct pipe_rasterizer_state rasterizer;
+      struct pipe_viewport_state vp;
+
+      memset(&blend, 0, sizeof(blend));
+      blend.rt[0].colormask = PIPE_MASK_RGBA;
+      cso_set_blend(cso, &blend);
+
+      memset(&dsa, 0, sizeof(dsa));
+      cso_set_depth_stencil_alpha(cso, &dsa);
+
+      memset(&rasterizer, 0, sizeof(rasterizer));
+      rasterizer.half_pixel_center = 1;
+      rasterizer.bottom_edge_rule = 1;
+      rasterizer.depth_clip = 1;
+      cso_set_rasterizer(cso, &rasterizer);
+
+      vp.scale[0] = 0.5f * surf_width;
+      vp.scale[1] = 0.5f * surf_height;
+      vp.scale[2] = 0.5f;
+      vp.scale[3] = 1.0f;
+      vp.translate[0] = 0.5f * surf_width;
+      vp.translate[1] = 0.5f * surf_height;
+      vp.translate[2] = 0.5f;
+      vp.translate[3] = 0.0f;
+      cso_set_viewport(cso, &vp);
+   }
+
+   cso_set_sample_mask(cso, ~0);
+   cso_set_render_condition(cso, NULL, FALSE, 0);
+
+   memset(&sampler, 0, sizeof(sampler));
+   sampler.min_img_filter = PIPE_TEX_FILTER_NEAREST;
+   sampler.min_mip_filter = PIPE_TEX_MIPFILTER_NONE;
+   sampler.mag_img_filter = PIPE_TEX_FILTER_NEAREST;
+   cso_single_sampler(cso, PIPE_SHADER_FRAGMENT, 0, &sampler);
+   cso_single_sampler_done(cso, PIPE_SHADER_FRAGMENT);
+   cso_set_sampler_views(cso, PIPE_SHADER_FRAGMENT, 1, &view);
+
+   cso_set_fragment_shader_handle(cso, st->pbo_upload.fs);
+   cso_set_vertex_shader_handle(cso, st->pbo_upload.vs);
+   cso_set_geometry_shader_handle(cso, NULL);
+   cso_set_stream_outputs(cso, 0, NULL, 0);
+   cso_set_vertex_elements(cso, 1, st->velems_util_draw);
+   cso_set_vertex_buffers(cso, cso_get_aux_vertex_buffer_slot(cso), 1, &vb);
+
+   params[0] = -xoffset;
+   params[1] = -yoffset;
+   params[2] = row_stride / bytes_per_texel;
+
+   memset(&cb, 0, sizeof(cb));
+   cb.buffer_size = sizeof(params);
+
+   for (slice = 0; slice < depth; slice++) {
+      struct pipe_surface surf_templ, *surf;
+      struct pipe_framebuffer_state fb;
+
+      memset(&surf_templ, 0, sizeof(surf_templ));
+      surf_templ.format = dst_format;
+      surf_templ.u.tex.level = level;
+      surf_templ.u.tex.first_layer = zoffset + texImage->Face + slice;
+      surf_templ.u.tex.last_layer = surf_templ.u.tex.first_layer;
+
+      surf = pipe->create_surface(pipe, dst, &surf_templ);
+      if (!surf)
+         break;
+
+      memset(&fb, 0, sizeof(fb));
+      fb.width = surf_width;
+      fb.height = surf_height;
+      fb.nr_cbufs = 1;
+      fb.cbufs[0] = surf;
+      cso_set_framebuffer(cso, &fb);
+
+      params[3] = (skip + slice * image_stride) / bytes_per_texel;
+
+      if (st->constbuf_uploader) {
+         cb.user_buffer = NULL;
+         u_upload_data(st->constbuf_uploader, 0, sizeof(params), params,
+                       &cb.buffer_offset, &cb.buffer);
+         u_upload_unmap(st->constbuf_uploader);
+      }
+      else {
+         cb.user_buffer = params;
+      }
+      cso_set_constant_buffer(cso, PIPE_SHADER_FRAGMENT, 0, &cb);
+      pipe_resource_reference(&cb.buffer, NULL);
+
+      cso_draw_arrays(cso, PIPE_PRIM_TRIANGLE_FAN, 0, 4);
+
+      pipe_surface_reference(&surf, NULL);
+   }
+
+   cso_restore_blend(cso);
+   cso_restore_depth_stencil_alpha(cso);
+   cso_restore_rasterizer(cso);
+   cso_restore_sample_mask(cso);
+   cso_restore_viewport(cso);
+   cso_restore_framebuffer(cso);
+   cso_restore_render_condition(cso);
+   cso_restore_samplers(cso, PIPE_SHADER_FRAGMENT);
+   cso_restore_sampler_views(cso, PIPE_SHADER_FRAGMENT);
+   cso_restore_constant_buffer_slot0(cso, PIPE_SHADER_FRAGMENT);
+   cso_restore_fragment_shader(cso);
+   cso_restore_stream_outputs(cso);
+   cso_restore_vertex_shader(cso);
+   cso_restore_geometry_shader(cso);
+   cso_restore_vertex_elements(cso);
+   cso_restore_aux_vertex_buffer_slot(cso);
+
+   pipe_resource_reference(&vb.buffer, NULL);
+   pipe_sampler_view_reference(&view, NULL);
+
+   return slice == depth;
+}
+
+
 static void
 st_TexSubImage(struct gl_context *ctx, GLuint dims,
                struct gl_texture_image *texImage,
@@ -632,9 +1029,11 @@ st_TexSubImage(struct gl_context *ctx, GLuint dims,
 
    /* See if the texture format already matches the format and type,
     * in which case the memcpy-based fast path will likely be used and
-    * we don't have to blit. */
+    * we don't have to blit.  Uploading from a PBO with a shader still
+    * saves waiting for the PBO though. */
    if (_mesa_format_matches_format_and_type(texImage->TexFormat, format,
-                                            type, unpack->SwapBytes)) {
+                                            type, unpack->SwapBytes) &&
+       !(st->pbo_upload.enabled && _mesa_is_bufferobj(unpack->BufferObj))) {
       goto fallback;
    }
 
@@ -673,6 +1072,13 @@ st_TexSubImage(struct gl_context *ctx, GLuint dims,
       goto fallback;
    }
 
+   if (try_pbo_upload(ctx, dims, texImage, format, type,
+                      src_format, dst_format,
+                      xoffset, yoffset, zoffset, width, height, depth,
+                      pixels, unpack)) {
+      return;
+   }
+
    /* TexSubImage only sets a single cubemap face. */
    if (gl_target == GL_TEXTURE_CUBE_MAP) {
       gl_target = GL_TEXTURE_2D;
@@ -1491,6 +1897,8 @@ st_finalize_texture(struct gl_context *ctx,
          return GL_TRUE;
       }
 
+      st_bufferobj_sync(st, st_obj);
+
       if (st_obj->buffer != stObj->pt) {
          pipe_resource_reference(&stObj->pt, st_obj->buffer);
          pipe_sampler_view_release(st->pipe, &stObj->sampler_view);
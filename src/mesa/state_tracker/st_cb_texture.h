@@ -50,6 +50,12 @@ st_finalize_texture(struct gl_context *ctx,
 		    struct gl_texture_object *tObj);
 
 
+extern void
+st_init_pbo_upload(struct st_context *st);
+
+extern void
+st_destroy_pbo_upload(struct st_context *st);
+
 extern void
 st_init_texture_functions(struct dd_function_table *functions);
 
@@ -27,7 +27,7 @@
 
 
 /**
- * glTextureBarrierNV function
+ * glTextureBarrierNV and glMemoryBarrier functions
  *
  * \author Marek Olšák
  */
@@ -40,6 +40,7 @@
 #include "pipe/p_defines.h"
 #include "st_context.h"
 #include "st_cb_texturebarrier.h"
+#include "st_draw.h"
 
 
 /**
@@ -50,11 +51,32 @@ st_TextureBarrier(struct gl_context *ctx)
 {
    struct pipe_context *pipe = st_context(ctx)->pipe;
 
+   st_flush_pending_draw(st_context(ctx));
    pipe->texture_barrier(pipe);
 }
 
 
+/**
+ * Called via ctx->Driver.MemoryBarrier()
+ */
+static void
+st_MemoryBarrier(struct gl_context *ctx, GLbitfield barriers)
+{
+   struct pipe_context *pipe = st_context(ctx)->pipe;
+   unsigned flags = 0;
+
+   if (barriers & GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT)
+      flags |= PIPE_BARRIER_MAPPED_BUFFER;
+
+   if (flags && pipe->memory_barrier) {
+      st_flush_pending_draw(st_context(ctx));
+      pipe->memory_barrier(pipe, flags);
+   }
+}
+
+
 void st_init_texture_barrier_functions(struct dd_function_table *functions)
 {
    functions->TextureBarrier = st_TextureBarrier;
+   functions->MemoryBarrier = st_MemoryBarrier;
 }
@@ -65,6 +65,7 @@
 #include "st_extensions.h"
 #include "st_gen_mipmap.h"
 #include "st_program.h"
+#include "st_program_cache.h"
 #include "st_vdpau.h"
 #include "pipe/p_context.h"
 #include "util/u_inlines.h"
@@ -147,6 +148,7 @@ st_create_context_priv( struct gl_context *ctx, struct pipe_context *pipe,
    st->cso_context = cso_create_context(pipe);
 
    st_init_atoms( st );
+   st_init_program_cache(st);
    st_init_bitmap(st);
    st_init_clear(st);
    st_init_draw( st );
@@ -190,6 +192,7 @@ st_create_context_priv( struct gl_context *ctx, struct pipe_context *pipe,
    st->has_shader_model3 = screen->get_param(screen, PIPE_CAP_SM3);
    st->prefer_blit_based_texture_transfer = screen->get_param(screen,
                               PIPE_CAP_PREFER_BLIT_BASED_TEXTURE_TRANSFER);
+   st_init_pbo_upload(st);
 
    st->needs_texcoord_semantic =
       screen->get_param(screen, PIPE_CAP_TGSI_TEXCOORD);
@@ -215,6 +218,10 @@ static void st_init_driver_flags(struct gl_driver_flags *f)
    f->NewArray = ST_NEW_VERTEX_ARRAYS;
    f->NewRasterizerDiscard = ST_NEW_RASTERIZER;
    f->NewUniformBuffer = ST_NEW_UNIFORM_BUFFER;
+   f->NewTextureUnits = ST_NEW_TEXTURE_UNITS;
+   f->NewShaderConstants[MESA_SHADER_VERTEX] = ST_NEW_VS_CONSTANTS;
+   f->NewShaderConstants[MESA_SHADER_FRAGMENT] = ST_NEW_FS_CONSTANTS;
+   f->NewShaderConstants[MESA_SHADER_GEOMETRY] = ST_NEW_GS_CONSTANTS;
 }
 
 struct st_context *st_create_context(gl_api api, struct pipe_context *pipe,
@@ -251,9 +258,11 @@ static void st_destroy_context_priv( struct st_context *st )
    uint shader, i;
 
    st_destroy_atoms( st );
+   st_destroy_program_cache(st);
    st_destroy_draw( st );
    st_destroy_generate_mipmap(st);
    st_destroy_clear(st);
+   st_destroy_pbo_upload(st);
    st_destroy_bitmap(st);
    st_destroy_drawpix(st);
    st_destroy_drawtex(st);
@@ -277,6 +286,10 @@ static void st_destroy_context_priv( struct st_context *st )
    if (st->constbuf_uploader) {
       u_upload_destroy(st->constbuf_uploader);
    }
+   for (shader = 0; shader < Elements(st->constbuf); shader++) {
+      pipe_resource_reference(&st->constbuf[shader].buffer, NULL);
+      free(st->constbuf[shader].values);
+   }
    free( st );
 }
 
@@ -41,6 +41,7 @@ struct gen_mipmap_state;
 struct st_context;
 struct st_fragment_program;
 struct u_upload_mgr;
+struct util_disk_cache;
 
 
 #define ST_NEW_MESA                    (1 << 0) /* Mesa state has changed */
@@ -52,6 +53,10 @@ struct u_upload_mgr;
 #define ST_NEW_VERTEX_ARRAYS           (1 << 6)
 #define ST_NEW_RASTERIZER              (1 << 7)
 #define ST_NEW_UNIFORM_BUFFER          (1 << 8)
+#define ST_NEW_TEXTURE_UNITS           (1 << 9) /* ctx->Texture._DirtyUnits */
+#define ST_NEW_VS_CONSTANTS            (1 << 10)
+#define ST_NEW_FS_CONSTANTS            (1 << 11)
+#define ST_NEW_GS_CONSTANTS            (1 << 12)
 
 
 struct st_state_flags {
@@ -77,6 +82,13 @@ struct st_context
 
    struct u_upload_mgr *uploader, *indexbuf_uploader, *constbuf_uploader;
 
+   /** Constant buffers updated in place, see st_upload_constants() */
+   struct {
+      struct pipe_resource *buffer;
+      union gl_constant_value *values;  /**< copy of the buffer's contents */
+      unsigned size;                    /**< of both, in bytes */
+   } constbuf[PIPE_SHADER_TYPES];
+
    struct draw_context *draw;  /**< For selection/feedback/rastpos only */
    struct draw_stage *feedback_stage;  /**< For GL_FEEDBACK rendermode */
    struct draw_stage *selection_stage;  /**< For GL_SELECT rendermode */
@@ -129,6 +141,13 @@ struct st_context
 
    struct st_state_flags dirty;
 
+   /** TGSI of program variants, see st_program_cache.h */
+   struct util_disk_cache *program_cache;
+
+   /** Number of updates of each atom, for ST_DEBUG=atoms */
+   unsigned *atom_updates;
+   unsigned num_validations;
+
    GLboolean missing_textures;
    GLboolean vertdata_edgeflags;
 
@@ -170,6 +189,12 @@ struct st_context
    struct {
       struct gl_fragment_program *shaders[4];
       void *vert_shaders[2];   /**< ureg shaders */
+
+      /** Image textures kept for reuse, most recently used first */
+      struct {
+         struct pipe_resource *texture;
+         struct pipe_sampler_view *view;
+      } textures[4];
    } drawpix;
 
    /** for glClear */
@@ -181,6 +206,26 @@ struct st_context
       void *vs_layered;
    } clear;
 
+   /** for glTexSubImage from buffers, see try_pbo_upload() */
+   struct {
+      boolean enabled;
+      unsigned offset_align;    /**< of buffer texture views, in bytes */
+      unsigned max_texels;      /**< in buffer texture views */
+      struct u_upload_mgr *uploader;  /**< for staging client memory */
+      void *vs;
+      void *fs;
+   } pbo_upload;
+
+   /** for coalescing consecutive glDrawArrays, see st_draw.c */
+   struct {
+      boolean enabled;
+      boolean pending;          /**< is info a draw not yet issued? */
+      GLenum mode;              /**< GL prim mode of the pending draw */
+      struct pipe_draw_info info;
+      /** vbo's ctx->Driver.FlushVertices which we wrap */
+      void (*flush_vertices)(struct gl_context *ctx, GLuint flags);
+   } merge_draws;
+
    /** used for anything using util_draw_vertex_buffer */
    struct pipe_vertex_element velems_util_draw[3];
 
@@ -211,6 +256,18 @@ static INLINE struct st_context *st_context(struct gl_context *ctx)
 }
 
 
+/**
+ * Whether the texture units used by a stage must all be revalidated, or
+ * only those flagged in ctx->Texture._DirtyUnits.
+ * \param program_flag  the stage's ST_NEW_x_PROGRAM flag
+ */
+static INLINE GLboolean
+st_all_texture_units_dirty(const struct st_context *st, GLuint program_flag)
+{
+   return (st->dirty.mesa & _NEW_TEXTURE) || (st->dirty.st & program_flag);
+}
+
+
 /**
  * Wrapper for struct gl_framebuffer.
  * This is an opaque type to the outside world.
@@ -64,6 +64,9 @@
 #include "../glsl/ir_uniform.h"
 
 
+DEBUG_GET_ONCE_BOOL_OPTION(mesa_merge_draws, "MESA_MERGE_DRAWS", FALSE)
+
+
 /**
  * This is very similar to vbo_all_varyings_in_vbos() but we are
  * only interested in per-vertex data.  See bug 38626.
@@ -100,6 +103,7 @@ setup_index_buffer(struct st_context *st,
    /* get/create the index buffer object */
    if (_mesa_is_bufferobj(bufobj)) {
       /* indices are in a real VBO */
+      st_bufferobj_sync(st, st_buffer_object(bufobj));
       ibuffer->buffer = st_buffer_object(bufobj)->buffer;
       ibuffer->offset = pointer_to_offset(ib->ptr);
    }
@@ -178,6 +182,91 @@ translate_prim(const struct gl_context *ctx, unsigned prim)
 }
 
 
+/**
+ * Issue the draw which queue_draw() held back, if any.
+ */
+void
+st_flush_pending_draw(struct st_context *st)
+{
+   if (st->merge_draws.pending) {
+      st->merge_draws.pending = FALSE;
+      cso_draw_vbo(st->cso_context, &st->merge_draws.info);
+   }
+}
+
+
+/**
+ * ctx->Driver.FlushVertices wrapper.  Mesa calls this before any state
+ * change or other operation which must not be reordered with drawing.
+ */
+static void
+st_merge_flush_vertices(struct gl_context *ctx, GLuint flags)
+{
+   struct st_context *st = st_context(ctx);
+
+   st_flush_pending_draw(st);
+   st->merge_draws.flush_vertices(ctx, flags);
+}
+
+
+/**
+ * Can the draw be held back to be merged with the following ones?
+ * Only non-indexed, non-instanced lists of independent primitives, with
+ * all vertices in buffer objects, qualify.  Client arrays may be changed
+ * by the application at any time.
+ */
+static boolean
+can_queue_draw(struct st_context *st, GLenum mode,
+               const struct pipe_draw_info *info)
+{
+   if (!st->merge_draws.enabled ||
+       info->indexed ||
+       info->count_from_stream_output ||
+       info->instance_count != 1)
+      return FALSE;
+
+   if (mode != GL_POINTS &&
+       mode != GL_LINES &&
+       mode != GL_TRIANGLES &&
+       mode != GL_QUADS)
+      return FALSE;
+
+   return all_varyings_in_vbos(st->ctx->Array._DrawArrays);
+}
+
+
+/**
+ * Hold back a draw, appending it to the pending one if it draws the same
+ * kind of primitives from the vertices which follow.  The count must have
+ * been trimmed already.  As no state was validated since the pending draw
+ * was queued, all the state is the same.
+ */
+static void
+queue_draw(struct st_context *st, GLenum mode,
+           const struct pipe_draw_info *info)
+{
+   struct pipe_draw_info *pending = &st->merge_draws.info;
+
+   if (st->merge_draws.pending &&
+       st->merge_draws.mode == mode &&
+       pending->start + pending->count == info->start &&
+       pending->start_instance == info->start_instance) {
+      pending->count += info->count;
+      pending->max_index = pending->start + pending->count - 1;
+      return;
+   }
+
+   st_flush_pending_draw(st);
+
+   st->merge_draws.pending = TRUE;
+   st->merge_draws.mode = mode;
+   *pending = *info;
+
+   /* Have FLUSH_VERTICES call st_merge_flush_vertices() */
+   st->ctx->Driver.NeedFlush |= FLUSH_STORED_VERTICES;
+}
+
+
 /**
  * This function gets plugged into the VBO module and is called when
  * we have something to render.
@@ -276,14 +365,23 @@ st_draw_vbo(struct gl_context *ctx,
       }
 
       if (info.count_from_stream_output) {
+         st_flush_pending_draw(st);
          cso_draw_vbo(st->cso_context, &info);
       }
       else if (info.primitive_restart) {
          /* don't trim, restarts might be inside index list */
+         st_flush_pending_draw(st);
          cso_draw_vbo(st->cso_context, &info);
       }
       else if (u_trim_pipe_prim(prims[i].mode, &info.count)) {
-         cso_draw_vbo(st->cso_context, &info);
+         if (can_queue_draw(st, prims[i].mode, &info)) {
+            info.max_index = info.start + info.count - 1;
+            queue_draw(st, prims[i].mode, &info);
+         }
+         else {
+            st_flush_pending_draw(st);
+            cso_draw_vbo(st->cso_context, &info);
+         }
       }
    }
 
@@ -300,6 +398,15 @@ st_init_draw(struct st_context *st)
 
    vbo_set_draw_func(ctx, st_draw_vbo);
 
+   /* Hold back glDrawArrays and the like to merge them with the following
+    * ones.  Anything which must be ordered with drawing flushes them.
+    */
+   st->merge_draws.enabled = debug_get_option_mesa_merge_draws();
+   if (st->merge_draws.enabled) {
+      st->merge_draws.flush_vertices = ctx->Driver.FlushVertices;
+      ctx->Driver.FlushVertices = st_merge_flush_vertices;
+   }
+
    st->draw = draw_create(st->pipe); /* for selection/feedback */
 
    /* Disable draw options that might convert points/lines to tris, etc.
@@ -47,6 +47,9 @@ void st_init_draw( struct st_context *st );
 
 void st_destroy_draw( struct st_context *st );
 
+extern void
+st_flush_pending_draw(struct st_context *st);
+
 extern void
 st_draw_vbo(struct gl_context *ctx,
             const struct _mesa_prim *prims,
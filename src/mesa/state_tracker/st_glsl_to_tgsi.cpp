@@ -37,6 +37,7 @@
 #include "ir_expression_flattening.h"
 #include "glsl_types.h"
 #include "glsl_parser_extras.h"
+#include "glsl_stats.h"
 #include "../glsl/program.h"
 #include "ir_optimization.h"
 #include "ast.h"
@@ -67,6 +68,7 @@ extern "C" {
 #include "st_program.h"
 #include "st_glsl_to_tgsi.h"
 #include "st_mesa_to_tgsi.h"
+#include "st_program_cache.h"
 }
 
 #define PROGRAM_IMMEDIATE PROGRAM_FILE_MAX
@@ -4698,6 +4700,40 @@ emit_edgeflags(struct st_translate *t)
    ureg_MOV(ureg, edge_dst, edge_src);
 }
 
+static void
+detach_uniform_storage(struct gl_shader_program *shProg)
+{
+   for (unsigned i = 0; i < shProg->NumUserUniformStorage; i++)
+      _mesa_uniform_detach_all_driver_storage(&shProg->UniformStorage[i]);
+}
+
+static void
+associate_uniform_storage(struct gl_context *ctx,
+                          struct gl_shader_program *shProg)
+{
+   for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
+      if (shProg->_LinkedShaders[i] == NULL)
+         continue;
+
+      _mesa_associate_uniform_storage(ctx, shProg,
+            shProg->_LinkedShaders[i]->Program->Parameters);
+   }
+}
+
+/**
+ * Link the uniforms to the program parameters, as st_translate_program()
+ * does.  For variants whose TGSI doesn't need translating.
+ */
+extern "C" void
+st_translate_program_uniforms(struct gl_context *ctx,
+                              glsl_to_tgsi_visitor *program)
+{
+   if (program->shader_program) {
+      detach_uniform_storage(program->shader_program);
+      associate_uniform_storage(ctx, program->shader_program);
+   }
+}
+
 /**
  * Translate intermediate IR (glsl_to_tgsi_instruction) to TGSI format.
  * \param program  the program to translate
@@ -4757,14 +4793,8 @@ st_translate_program(
    t->outputMapping = outputMapping;
    t->ureg = ureg;
 
-   if (program->shader_program) {
-      for (i = 0; i < program->shader_program->NumUserUniformStorage; i++) {
-         struct gl_uniform_storage *const storage =
-               &program->shader_program->UniformStorage[i];
-
-         _mesa_uniform_detach_all_driver_storage(storage);
-      }
-   }
+   if (program->shader_program)
+      detach_uniform_storage(program->shader_program);
 
    /*
     * Declare input attributes.
@@ -4990,13 +5020,7 @@ st_translate_program(
        * prog->ParameterValues to get reallocated (e.g., anything that adds a
        * program constant) has to happen before creating this linkage.
        */
-      for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
-         if (program->shader_program->_LinkedShaders[i] == NULL)
-            continue;
-
-         _mesa_associate_uniform_storage(ctx, program->shader_program,
-               program->shader_program->_LinkedShaders[i]->Program->Parameters);
-      }
+      associate_uniform_storage(ctx, program->shader_program);
    }
 
 out:
@@ -5231,8 +5255,12 @@ st_new_shader_program(struct gl_context *ctx, GLuint name)
 GLboolean
 st_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
 {
+   struct glsl_stats_timer timer;
+
    assert(prog->LinkStatus);
 
+   glsl_stats_begin(&timer);
+
    for (unsigned i = 0; i < MESA_SHADER_STAGES; i++) {
       if (prog->_LinkedShaders[i] == NULL)
          continue;
@@ -5314,6 +5342,7 @@ st_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
       if (linked_prog) {
 	 _mesa_reference_program(ctx, &prog->_LinkedShaders[i]->Program,
 				 linked_prog);
+         st_set_program_cache_source(st_context(ctx), prog, linked_prog);
          if (!ctx->Driver.ProgramStringNotify(ctx,
                                               _mesa_shader_stage_to_program(i),
                                               linked_prog)) {
@@ -5327,6 +5356,8 @@ st_link_shader(struct gl_context *ctx, struct gl_shader_program *prog)
       _mesa_reference_program(ctx, &linked_prog, NULL);
    }
 
+   glsl_stats_end(&timer, GLSL_STATS_BACKEND, "program", prog->Name, NULL);
+
    return GL_TRUE;
 }
 
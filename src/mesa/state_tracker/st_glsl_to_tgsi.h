@@ -53,6 +53,9 @@ enum pipe_error st_translate_program(
    boolean passthrough_edgeflags,
    boolean clamp_color);
 
+void st_translate_program_uniforms(struct gl_context *ctx,
+                                   struct glsl_to_tgsi_visitor *program);
+
 void free_glsl_to_tgsi_visitor(struct glsl_to_tgsi_visitor *v);
 void get_pixel_transfer_visitor(struct st_fragment_program *fp,
                                 struct glsl_to_tgsi_visitor *original,
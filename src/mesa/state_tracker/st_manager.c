@@ -35,6 +35,7 @@
 #include "main/fbobject.h"
 #include "main/renderbuffer.h"
 #include "main/version.h"
+#include "main/marshal.h"
 #include "st_texture.h"
 
 #include "st_context.h"
@@ -52,6 +53,7 @@
 #include "util/u_inlines.h"
 #include "util/u_atomic.h"
 #include "util/u_surface.h"
+#include "util/u_threaded_context.h"
 
 /**
  * Cast wrapper to convert a struct gl_framebuffer to an st_framebuffer.
@@ -453,6 +455,8 @@ st_context_flush(struct st_context_iface *stctxi, unsigned flags,
    struct st_context *st = (struct st_context *) stctxi;
    unsigned pipe_flags = 0;
 
+   _mesa_glthread_finish(st->ctx);
+
    if (flags & ST_FLUSH_END_OF_FRAME) {
       pipe_flags |= PIPE_FLUSH_END_OF_FRAME;
    }
@@ -478,6 +482,8 @@ st_context_teximage(struct st_context_iface *stctxi,
    GLuint width, height, depth;
    GLenum target;
 
+   _mesa_glthread_finish(ctx);
+
    switch (tex_type) {
    case ST_TEXTURE_1D:
       target = GL_TEXTURE_1D;
@@ -559,6 +565,8 @@ st_context_copy(struct st_context_iface *stctxi,
    struct st_context *st = (struct st_context *) stctxi;
    struct st_context *src = (struct st_context *) stsrci;
 
+   _mesa_glthread_finish(src->ctx);
+   _mesa_glthread_finish(st->ctx);
    _mesa_copy_context(src->ctx, st->ctx, mask);
 }
 
@@ -569,6 +577,8 @@ st_context_share(struct st_context_iface *stctxi,
    struct st_context *st = (struct st_context *) stctxi;
    struct st_context *src = (struct st_context *) stsrci;
 
+   _mesa_glthread_finish(src->ctx);
+   _mesa_glthread_finish(st->ctx);
    return _mesa_share_state(st->ctx, src->ctx);
 }
 
@@ -576,9 +586,14 @@ static void
 st_context_destroy(struct st_context_iface *stctxi)
 {
    struct st_context *st = (struct st_context *) stctxi;
+
+   _mesa_glthread_destroy(st->ctx);
    st_destroy_context(st);
 }
 
+DEBUG_GET_ONCE_BOOL_OPTION(gallium_thread, "GALLIUM_THREAD", FALSE)
+DEBUG_GET_ONCE_BOOL_OPTION(mesa_glthread, "MESA_GLTHREAD", FALSE)
+
 static struct st_context_iface *
 st_api_create_context(struct st_api *stapi, struct st_manager *smapi,
                       const struct st_context_attribs *attribs,
@@ -619,6 +634,15 @@ st_api_create_context(struct st_api *stapi, struct st_manager *smapi,
       return NULL;
    }
 
+   /* Run the driver on a thread of its own, if it can't be done the
+    * context is used directly.
+    */
+   if (debug_get_option_gallium_thread()) {
+      struct pipe_context *tc = u_threaded_context_create(pipe);
+      if (tc)
+         pipe = tc;
+   }
+
    st_visual_to_context_mode(&attribs->visual, &mode);
    st = st_create_context(api, pipe, &mode, shared_ctx, &attribs->options);
    if (!st) {
@@ -663,6 +687,10 @@ st_api_create_context(struct st_api *stapi, struct st_manager *smapi,
    st->iface.cso_context = st->cso_context;
    st->iface.pipe = st->pipe;
 
+   /* Marshal the GL calls to a thread of their own */
+   if (debug_get_option_mesa_glthread())
+      _mesa_glthread_init(st->ctx);
+
    *error = ST_CONTEXT_SUCCESS;
    return &st->iface;
 }
@@ -702,11 +730,18 @@ st_api_make_current(struct st_api *stapi, struct st_context_iface *stctxi,
                     struct st_framebuffer_iface *streadi)
 {
    struct st_context *st = (struct st_context *) stctxi;
+   struct st_context *old_st = (struct st_context *) st_api_get_current(stapi);
    struct st_framebuffer *stdraw, *stread;
    boolean ret;
 
    _glapi_check_multithread();
 
+   /* The GL threads must be idle while the bindings change */
+   if (old_st)
+      _mesa_glthread_finish(old_st->ctx);
+   if (st)
+      _mesa_glthread_finish(st->ctx);
+
    if (st) {
       /* reuse or create the draw fb */
       stdraw = st_framebuffer_reuse_or_create(st->ctx->WinSysDrawBuffer,
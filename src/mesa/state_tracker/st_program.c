@@ -44,17 +44,30 @@
 #include "draw/draw_context.h"
 #include "tgsi/tgsi_dump.h"
 #include "tgsi/tgsi_ureg.h"
+#include "util/u_trace_events.h"
 
 #include "st_debug.h"
 #include "st_cb_bitmap.h"
 #include "st_cb_drawpixels.h"
 #include "st_context.h"
 #include "st_program.h"
+#include "st_program_cache.h"
 #include "st_mesa_to_tgsi.h"
 #include "cso_cache/cso_context.h"
 
 
 
+/**
+ * Rough number of TGSI instruction tokens needed to translate a program,
+ * used to size the ureg token buffer up front.
+ */
+static INLINE unsigned
+tokens_hint(const struct gl_program *prog)
+{
+   return prog->NumInstructions * 8;
+}
+
+
 /**
  * Delete a vertex program variant.  Note the caller must unlink
  * the variant from the linked list.
@@ -314,7 +327,8 @@ st_translate_vertex_program(struct st_context *st,
       _mesa_remove_output_reads(&stvp->Base.Base, PROGRAM_OUTPUT);
    }
 
-   ureg = ureg_create( TGSI_PROCESSOR_VERTEX );
+   ureg = ureg_create_with_size_hint( TGSI_PROCESSOR_VERTEX,
+                                      tokens_hint(&stvp->Base.Base) );
    if (ureg == NULL) {
       free(vpv);
       return NULL;
@@ -335,6 +349,16 @@ st_translate_vertex_program(struct st_context *st,
       debug_printf("\n");
    }
 
+   if (stvp->glsl_to_tgsi) {
+      vpv->tgsi.tokens = st_program_cache_get(st, &stvp->Base.Base,
+                                              key, sizeof *key);
+      if (vpv->tgsi.tokens) {
+         st_translate_program_uniforms(st->ctx, stvp->glsl_to_tgsi);
+         ureg_destroy( ureg );
+         goto translated;
+      }
+   }
+
    if (stvp->glsl_to_tgsi)
       error = st_translate_program(st->ctx,
                                    TGSI_PROCESSOR_VERTEX,
@@ -383,6 +407,11 @@ st_translate_vertex_program(struct st_context *st,
 
    ureg_destroy( ureg );
 
+   if (stvp->glsl_to_tgsi)
+      st_program_cache_put(st, &stvp->Base.Base, key, sizeof *key,
+                           vpv->tgsi.tokens);
+
+translated:
    if (stvp->glsl_to_tgsi) {
       st_translate_stream_output_info(stvp->glsl_to_tgsi,
                                       stvp->result_to_output,
@@ -427,7 +456,9 @@ st_get_vp_variant(struct st_context *st,
 
    if (!vpv) {
       /* create now */
+      util_trace_event_begin("st compile vertex shader");
       vpv = st_translate_vertex_program(st, stvp, key);
+      util_trace_event_end("st compile vertex shader");
       if (vpv) {
          /* insert into list */
          vpv->next = stvp->variants;
@@ -705,7 +736,8 @@ st_translate_fragment_program(struct st_context *st,
       }
    }
 
-   ureg = ureg_create( TGSI_PROCESSOR_FRAGMENT );
+   ureg = ureg_create_with_size_hint( TGSI_PROCESSOR_FRAGMENT,
+                                      tokens_hint(&stfp->Base.Base) );
    if (ureg == NULL) {
       free(variant);
       return NULL;
@@ -738,6 +770,16 @@ st_translate_fragment_program(struct st_context *st,
       }
    }
 
+   if (stfp->glsl_to_tgsi && !deleteFP) {
+      variant->tgsi.tokens = st_program_cache_get(st, &stfp->Base.Base,
+                                                  key, sizeof *key);
+      if (variant->tgsi.tokens) {
+         st_translate_program_uniforms(st->ctx, stfp->glsl_to_tgsi);
+         ureg_destroy( ureg );
+         goto translated;
+      }
+   }
+
    if (stfp->glsl_to_tgsi)
       st_translate_program(st->ctx,
                            TGSI_PROCESSOR_FRAGMENT,
@@ -778,6 +820,11 @@ st_translate_fragment_program(struct st_context *st,
    variant->tgsi.tokens = ureg_get_tokens( ureg, NULL );
    ureg_destroy( ureg );
 
+   if (stfp->glsl_to_tgsi && !deleteFP && variant->tgsi.tokens)
+      st_program_cache_put(st, &stfp->Base.Base, key, sizeof *key,
+                           variant->tgsi.tokens);
+
+translated:
    /* fill in variant */
    variant->driver_shader = pipe->create_fs_state(pipe, &variant->tgsi);
    variant->key = *key;
@@ -816,7 +863,9 @@ st_get_fp_variant(struct st_context *st,
 
    if (!fpv) {
       /* create new */
+      util_trace_event_begin("st compile fragment shader");
       fpv = st_translate_fragment_program(st, stfp, key);
+      util_trace_event_end("st compile fragment shader");
       if (fpv) {
          /* insert into list */
          fpv->next = stfp->variants;
@@ -865,7 +914,8 @@ st_translate_geometry_program(struct st_context *st,
       _mesa_remove_output_reads(&stgp->Base.Base, PROGRAM_OUTPUT);
    }
 
-   ureg = ureg_create( TGSI_PROCESSOR_GEOMETRY );
+   ureg = ureg_create_with_size_hint( TGSI_PROCESSOR_GEOMETRY,
+                                      tokens_hint(&stgp->Base.Base) );
    if (ureg == NULL) {
       free(gpv);
       return NULL;
@@ -1093,6 +1143,18 @@ st_translate_geometry_program(struct st_context *st,
       stgp->tgsi.tokens = NULL;
    }
 
+   stgp->num_inputs = gs_num_inputs;
+
+   if (stgp->glsl_to_tgsi) {
+      stgp->tgsi.tokens = st_program_cache_get(st, &stgp->Base.Base,
+                                               key, sizeof *key);
+      if (stgp->tgsi.tokens) {
+         st_translate_program_uniforms(st->ctx, stgp->glsl_to_tgsi);
+         ureg_destroy( ureg );
+         goto translated;
+      }
+   }
+
    ureg_property_gs_input_prim(ureg, stgp->Base.InputType);
    ureg_property_gs_output_prim(ureg, stgp->Base.OutputType);
    ureg_property_gs_max_vertices(ureg, stgp->Base.VerticesOut);
@@ -1136,10 +1198,14 @@ st_translate_geometry_program(struct st_context *st,
                                 FALSE,
                                 FALSE);
 
-   stgp->num_inputs = gs_num_inputs;
    stgp->tgsi.tokens = ureg_get_tokens( ureg, NULL );
    ureg_destroy( ureg );
 
+   if (stgp->glsl_to_tgsi && stgp->tgsi.tokens)
+      st_program_cache_put(st, &stgp->Base.Base, key, sizeof *key,
+                           stgp->tgsi.tokens);
+
+translated:
    if (stgp->glsl_to_tgsi) {
       st_translate_stream_output_info(stgp->glsl_to_tgsi,
                                       outputMapping,
@@ -1183,7 +1249,9 @@ st_get_gp_variant(struct st_context *st,
 
    if (!gpv) {
       /* create new */
+      util_trace_event_begin("st compile geometry shader");
       gpv = st_translate_geometry_program(st, stgp, key);
+      util_trace_event_end("st compile geometry shader");
       if (gpv) {
          /* insert into list */
          gpv->next = stgp->variants;
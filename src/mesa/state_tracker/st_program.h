@@ -91,6 +91,10 @@ struct st_fragment_program
    struct gl_fragment_program Base;
    struct glsl_to_tgsi_visitor* glsl_to_tgsi;
 
+   /** What the program was linked from, see st_program_cache.h */
+   GLubyte *cache_source;
+   unsigned cache_source_size;
+
    struct st_fp_variant *variants;
 };
 
@@ -146,6 +150,10 @@ struct st_vertex_program
    struct gl_vertex_program Base;  /**< The Mesa vertex program */
    struct glsl_to_tgsi_visitor* glsl_to_tgsi;
 
+   /** What the program was linked from, see st_program_cache.h */
+   GLubyte *cache_source;
+   unsigned cache_source_size;
+
    /** maps a Mesa VERT_ATTRIB_x to a packed TGSI input index */
    GLuint input_to_index[VERT_ATTRIB_MAX];
    /** maps a TGSI input index back to a Mesa VERT_ATTRIB_x */
@@ -195,6 +203,10 @@ struct st_geometry_program
    struct gl_geometry_program Base;  /**< The Mesa geometry program */
    struct glsl_to_tgsi_visitor* glsl_to_tgsi;
 
+   /** What the program was linked from, see st_program_cache.h */
+   GLubyte *cache_source;
+   unsigned cache_source_size;
+
    /** map GP input back to VP output */
    GLuint input_map[PIPE_MAX_SHADER_INPUTS];
 
@@ -0,0 +1,311 @@
+/**************************************************************************
+ *
+ * Copyright 2014 The Mesa Authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * On-disk cache of the TGSI code of GLSL program variants.
+ *
+ * At link time the sources of all the shaders of the program and the
+ * link-time state which isn't part of them (transform feedback varyings)
+ * are saved with each of the linked programs.  Attribute and fragment data
+ * bindings only show in the inputs read and outputs written, which are
+ * part of the key too.
+ */
+
+#include "main/imports.h"
+#include "main/macros.h"
+#include "main/mtypes.h"
+#include "program/program.h"
+#include "program/prog_parameter.h"
+#include "pipe/p_context.h"
+#include "pipe/p_screen.h"
+#include "tgsi/tgsi_parse.h"
+#include "util/u_disk_cache.h"
+
+#include "st_context.h"
+#include "st_debug.h"
+#include "st_mesa_to_tgsi.h"
+#include "st_program.h"
+#include "st_program_cache.h"
+
+
+/** A growing cache key */
+struct key_buffer
+{
+   GLubyte *data;
+   unsigned size;
+   unsigned capacity;
+};
+
+
+static void
+append(struct key_buffer *buf, const void *data, unsigned size)
+{
+   if (buf->size + size > buf->capacity) {
+      unsigned capacity = MAX2(buf->capacity * 2, buf->size + size);
+      GLubyte *new_data = realloc(buf->data, capacity);
+      if (!new_data) {
+         free(buf->data);
+         buf->data = NULL;
+         buf->capacity = 0;
+      }
+      else {
+         buf->data = new_data;
+         buf->capacity = capacity;
+      }
+   }
+
+   /* Keep counting after running out of memory, the caller checks data */
+   if (buf->data)
+      memcpy(buf->data + buf->size, data, size);
+   buf->size += size;
+}
+
+
+static void
+append_string(struct key_buffer *buf, const char *s)
+{
+   append(buf, s ? s : "", s ? strlen(s) + 1 : 1);
+}
+
+
+/**
+ * Open the cache, if enabled.
+ */
+void
+st_init_program_cache(struct st_context *st)
+{
+   st->program_cache = util_disk_cache_create("st");
+}
+
+
+void
+st_destroy_program_cache(struct st_context *st)
+{
+   if (st->program_cache) {
+      util_disk_cache_destroy(st->program_cache);
+      st->program_cache = NULL;
+   }
+}
+
+
+static GLubyte **
+program_cache_source(struct gl_program *prog, unsigned **size)
+{
+   switch (prog->Target) {
+   case GL_VERTEX_PROGRAM_ARB:
+      *size = &st_vertex_program((struct gl_vertex_program *) prog)->cache_source_size;
+      return &st_vertex_program((struct gl_vertex_program *) prog)->cache_source;
+   case GL_FRAGMENT_PROGRAM_ARB:
+      *size = &st_fragment_program((struct gl_fragment_program *) prog)->cache_source_size;
+      return &st_fragment_program((struct gl_fragment_program *) prog)->cache_source;
+   case MESA_GEOMETRY_PROGRAM:
+      *size = &st_geometry_program((struct gl_geometry_program *) prog)->cache_source_size;
+      return &st_geometry_program((struct gl_geometry_program *) prog)->cache_source;
+   default:
+      return NULL;
+   }
+}
+
+
+/**
+ * Save what the program linked from, for making cache keys from later.
+ * Called at link time for each of the programs linked from shProg.
+ */
+void
+st_set_program_cache_source(struct st_context *st,
+                            const struct gl_shader_program *shProg,
+                            struct gl_program *prog)
+{
+   struct key_buffer buf = { NULL, 0, 0 };
+   GLubyte **source;
+   unsigned *source_size;
+   GLuint i;
+
+   if (!st->program_cache)
+      return;
+
+   source = program_cache_source(prog, &source_size);
+   if (!source)
+      return;
+
+   free(*source);
+   *source = NULL;
+   *source_size = 0;
+
+   for (i = 0; i < shProg->NumShaders; i++) {
+      const struct gl_shader *sh = shProg->Shaders[i];
+
+      /* The source may have been replaced since it was compiled */
+      if (!sh->CompileStatus) {
+         free(buf.data);
+         return;
+      }
+
+      append(&buf, &sh->Type, sizeof sh->Type);
+      append_string(&buf, sh->Source);
+   }
+
+   append(&buf, &shProg->TransformFeedback.BufferMode,
+          sizeof shProg->TransformFeedback.BufferMode);
+   for (i = 0; i < shProg->TransformFeedback.NumVarying; i++)
+      append_string(&buf, shProg->TransformFeedback.VaryingNames[i]);
+
+   *source = buf.data;
+   *source_size = buf.data ? buf.size : 0;
+}
+
+
+/**
+ * Make the cache key for a variant of prog.
+ *
+ * \return the key, which the caller must free(), or NULL if the program
+ * can't be cached
+ */
+static void *
+make_key(struct st_context *st,
+         const struct gl_program *prog,
+         const void *variant_key, unsigned variant_key_size,
+         unsigned *key_size)
+{
+   static const char build_id[] =
+#ifdef PACKAGE_VERSION
+      PACKAGE_VERSION " "
+#endif
+      __DATE__ " " __TIME__;
+   struct gl_context *ctx = st->ctx;
+   struct pipe_screen *screen = st->pipe->screen;
+   const gl_shader_stage stage = _mesa_program_enum_to_shader_stage(prog->Target);
+   struct key_buffer buf = { NULL, 0, 0 };
+   GLubyte **source;
+   unsigned *source_size;
+   GLuint num_params;
+
+   source = program_cache_source((struct gl_program *) prog, &source_size);
+   if (!source || !*source)
+      return NULL;
+
+   append(&buf, build_id, sizeof build_id);
+   append_string(&buf, screen->get_name(screen));
+   append_string(&buf, screen->get_vendor(screen));
+
+   /* Everything which affects compiling and linking */
+   append(&buf, &ctx->API, sizeof ctx->API);
+   append(&buf, &ctx->Const.GLSLVersion, sizeof ctx->Const.GLSLVersion);
+   append(&buf, &ctx->Const.NativeIntegers, sizeof ctx->Const.NativeIntegers);
+   append(&buf, &ctx->Shader.Flags, sizeof ctx->Shader.Flags);
+   append(&buf, &ctx->ShaderCompilerOptions[stage],
+          sizeof ctx->ShaderCompilerOptions[stage]);
+   append(&buf, &ctx->Extensions,
+          offsetof(struct gl_extensions, extension_sentinel));
+
+   /* Translating may add state parameters.  Entries are stored with the
+    * parameters there are afterwards, so they only hit when translating
+    * would add none.
+    */
+   num_params = prog->Parameters ? prog->Parameters->NumParameters : 0;
+   append(&buf, &prog->Target, sizeof prog->Target);
+   append(&buf, &num_params, sizeof num_params);
+   append(&buf, &prog->InputsRead, sizeof prog->InputsRead);
+   append(&buf, &prog->OutputsWritten, sizeof prog->OutputsWritten);
+
+   /* The variant keys start with the context pointer, which differs from
+    * run to run.
+    */
+   assert(variant_key_size >= sizeof(struct st_context *));
+   append(&buf, (const char *) variant_key + sizeof(struct st_context *),
+          variant_key_size - sizeof(struct st_context *));
+
+   append(&buf, *source, *source_size);
+
+   *key_size = buf.size;
+   return buf.data;
+}
+
+
+/**
+ * Look up the tokens of a variant.
+ *
+ * \return the tokens, to be freed with st_free_tokens(), or NULL on a miss
+ */
+const struct tgsi_token *
+st_program_cache_get(struct st_context *st,
+                     const struct gl_program *prog,
+                     const void *variant_key, unsigned variant_key_size)
+{
+   struct tgsi_token *tokens;
+   unsigned key_size, size;
+   void *key;
+
+   if (!st->program_cache)
+      return NULL;
+
+   key = make_key(st, prog, variant_key, variant_key_size, &key_size);
+   if (!key)
+      return NULL;
+
+   tokens = util_disk_cache_get(st->program_cache, key, key_size, &size);
+   free(key);
+   if (!tokens)
+      return NULL;
+
+   if (size % sizeof(struct tgsi_token) != 0 ||
+       size < sizeof(struct tgsi_header) ||
+       tgsi_num_tokens(tokens) * sizeof(struct tgsi_token) != size) {
+      st_free_tokens(tokens);
+      return NULL;
+   }
+
+   if (ST_DEBUG & DEBUG_TGSI)
+      debug_printf("%s: hit\n", __FUNCTION__);
+
+   return tokens;
+}
+
+
+/**
+ * Store the tokens of a variant just translated.
+ */
+void
+st_program_cache_put(struct st_context *st,
+                     const struct gl_program *prog,
+                     const void *variant_key, unsigned variant_key_size,
+                     const struct tgsi_token *tokens)
+{
+   unsigned key_size;
+   void *key;
+
+   if (!st->program_cache)
+      return;
+
+   key = make_key(st, prog, variant_key, variant_key_size, &key_size);
+   if (!key)
+      return;
+
+   util_disk_cache_put(st->program_cache, key, key_size, tokens,
+                       tgsi_num_tokens(tokens) * sizeof(struct tgsi_token));
+   free(key);
+}
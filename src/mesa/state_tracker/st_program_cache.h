@@ -0,0 +1,85 @@
+/**************************************************************************
+ *
+ * Copyright 2014 The Mesa Authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * On-disk cache of the TGSI code of GLSL program variants.
+ *
+ * The TGSI generated for a variant only depends on the program's sources
+ * and link-time state, the variant key, the GL options that affect
+ * compilation and the driver.  All of these make up the cache key, so the
+ * translation of the variant can be skipped on a hit.  Drivers which keep
+ * caches of their own keyed by the TGSI tokens then hit too.
+ *
+ * The variant keys passed in must start with their st_context pointer,
+ * which is left out of the cache key.
+ *
+ * The cache is only enabled when MESA_SHADER_CACHE_DIR is set.
+ */
+
+#ifndef ST_PROGRAM_CACHE_H
+#define ST_PROGRAM_CACHE_H
+
+#include "main/glheader.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct gl_program;
+struct gl_shader_program;
+struct st_context;
+struct tgsi_token;
+
+
+void
+st_init_program_cache(struct st_context *st);
+
+void
+st_destroy_program_cache(struct st_context *st);
+
+void
+st_set_program_cache_source(struct st_context *st,
+                            const struct gl_shader_program *shProg,
+                            struct gl_program *prog);
+
+const struct tgsi_token *
+st_program_cache_get(struct st_context *st,
+                     const struct gl_program *prog,
+                     const void *variant_key, unsigned variant_key_size);
+
+void
+st_program_cache_put(struct st_context *st,
+                     const struct gl_program *prog,
+                     const void *variant_key, unsigned variant_key_size,
+                     const struct tgsi_token *tokens);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ST_PROGRAM_CACHE_H */
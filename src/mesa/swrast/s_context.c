@@ -827,6 +827,7 @@ _swrast_DestroyContext( struct gl_context *ctx )
 
    free( swrast->SpanArrays );
    free( swrast->ZoomedArrays );
+   free( swrast->SpanQueue );
    free( swrast->TexelBuffer );
 
    free(swrast->stencil_temp.buf1);
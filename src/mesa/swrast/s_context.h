@@ -51,6 +51,10 @@
 #include "s_fragprog.h"
 #include "s_span.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 
 typedef void (*texture_sample_func)(struct gl_context *ctx,
                                     const struct gl_sampler_object *samp,
@@ -304,6 +308,13 @@ typedef struct
    SWspanarrays *SpanArrays;
    SWspanarrays *ZoomedArrays;  /**< For pixel zooming */
 
+   /**
+    * Rows of a triangle waiting to be written by several threads,
+    * see PARALLEL_SPANS in s_tritemp.h.
+    */
+   SWspan *SpanQueue;
+   GLuint SpanQueueSize;
+
    /**
     * Used to buffer N GL_POINTS, instead of rendering one by one.
     */
@@ -148,19 +148,50 @@ fetch_texel_deriv( struct gl_context *ctx, const GLfloat texcoord[4],
 }
 
 
+/**
+ * Initialize the parts of the virtual fragment program machine state which
+ * are the same for all the fragments of a span: the pointers to the input
+ * attributes and their derivatives, the samplers, etc.
+ * \param machine  the virtual machine state to init
+ * \param program  the fragment program we're about to run
+ * \param span  the span of pixels we'll operate on
+ */
+static void
+init_machine_span(struct gl_context *ctx, struct gl_program_machine *machine,
+                  const struct gl_fragment_program *program,
+                  const SWspan *span)
+{
+   (void) ctx;
+
+   /* Setup pointer to input attributes */
+   machine->Attribs = span->array->attribs;
+
+   machine->DerivX = (GLfloat (*)[4]) span->attrStepX;
+   machine->DerivY = (GLfloat (*)[4]) span->attrStepY;
+   machine->NumDeriv = VARYING_SLOT_MAX;
+
+   machine->Samplers = program->Base.SamplerUnits;
+
+   machine->FetchTexelLod = fetch_texel_lod;
+   machine->FetchTexelDeriv = fetch_texel_deriv;
+}
+
+
 /**
  * Initialize the virtual fragment program machine state prior to running
  * fragment program on a fragment.  This involves initializing the input
  * registers, condition codes, etc.
- * \param machine  the virtual machine state to init
+ * \param machine  the virtual machine state to init, which must have been
+ *                 set up for the span with init_machine_span()
  * \param program  the fragment program we're about to run
  * \param span  the span of pixels we'll operate on
  * \param col  which element (column) of the span we'll operate on
+ * \param isGLSL  whether a GLSL program (not ARB_fragment_program) is run
  */
-static void
+static inline void
 init_machine(struct gl_context *ctx, struct gl_program_machine *machine,
              const struct gl_fragment_program *program,
-             const SWspan *span, GLuint col)
+             const SWspan *span, GLuint col, GLboolean isGLSL)
 {
    GLfloat *wpos = span->array->attribs[VARYING_SLOT_POS][col];
 
@@ -172,17 +203,7 @@ init_machine(struct gl_context *ctx, struct gl_program_machine *machine,
       wpos[1] += 0.5F;
    }
 
-   /* Setup pointer to input attributes */
-   machine->Attribs = span->array->attribs;
-
-   machine->DerivX = (GLfloat (*)[4]) span->attrStepX;
-   machine->DerivY = (GLfloat (*)[4]) span->attrStepY;
-   machine->NumDeriv = VARYING_SLOT_MAX;
-
-   machine->Samplers = program->Base.SamplerUnits;
-
-   /* if running a GLSL program (not ARB_fragment_program) */
-   if (ctx->Shader.CurrentProgram[MESA_SHADER_FRAGMENT]) {
+   if (isGLSL) {
       /* Store front/back facing value */
       machine->Attribs[VARYING_SLOT_FACE][col][0] = 1.0F - span->facing;
    }
@@ -197,9 +218,6 @@ init_machine(struct gl_context *ctx, struct gl_program_machine *machine,
 
    /* init call stack */
    machine->StackDepth = 0;
-
-   machine->FetchTexelLod = fetch_texel_lod;
-   machine->FetchTexelDeriv = fetch_texel_deriv;
 }
 
 
@@ -213,11 +231,15 @@ run_program(struct gl_context *ctx, SWspan *span, GLuint start, GLuint end)
    const struct gl_fragment_program *program = ctx->FragmentProgram._Current;
    const GLbitfield64 outputsWritten = program->Base.OutputsWritten;
    struct gl_program_machine *machine = &swrast->FragProgMachine;
+   const GLboolean isGLSL =
+      ctx->Shader.CurrentProgram[MESA_SHADER_FRAGMENT] != NULL;
    GLuint i;
 
+   init_machine_span(ctx, machine, program, span);
+
    for (i = start; i < end; i++) {
       if (span->array->mask[i]) {
-         init_machine(ctx, machine, program, span, i);
+         init_machine(ctx, machine, program, span, i, isGLSL);
 
          if (_mesa_execute_program(ctx, &program->Base, machine)) {
 
@@ -55,6 +55,29 @@
 
 #include <stdbool.h>
 
+
+/**
+ * Return a buffer big enough to hold n spans, for the triangle functions
+ * which write their rows in parallel.  The buffer is kept in the context
+ * and only ever grows.
+ * \return NULL if out of memory, in which case the rows are rendered
+ * one after the other as usual.
+ */
+SWspan *
+_swrast_get_span_queue(struct gl_context *ctx, GLuint n)
+{
+   SWcontext *swrast = SWRAST_CONTEXT(ctx);
+
+   if (n > swrast->SpanQueueSize) {
+      free(swrast->SpanQueue);
+      swrast->SpanQueue = malloc(n * sizeof(SWspan));
+      swrast->SpanQueueSize = swrast->SpanQueue ? n : 0;
+   }
+
+   return swrast->SpanQueue;
+}
+
+
 /**
  * Set default fragment attributes for the span using the
  * current raster values.  Used prior to glDraw/CopyPixels
@@ -1240,9 +1263,14 @@ _swrast_write_rgba_span( struct gl_context *ctx, SWspan *span)
    if (ctx->Query.CurrentOcclusionObject) {
       /* update count of 'passed' fragments */
       struct gl_query_object *q = ctx->Query.CurrentOcclusionObject;
-      GLuint i;
+      GLuint i, passed = 0;
       for (i = 0; i < span->end; i++)
-         q->Result += span->array->mask[i];
+         passed += span->array->mask[i];
+      /* spans may be written by several threads at once */
+#ifdef _OPENMP
+#pragma omp atomic
+#endif
+      q->Result += passed;
    }
 
    /* We had to wait until now to check for glColorMask(0,0,0,0) because of
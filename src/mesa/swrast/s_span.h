@@ -184,6 +184,14 @@ do {						\
 
 
 
+/**
+ * Triangles shorter than this are not worth splitting between threads.
+ */
+#define SWRAST_MIN_PARALLEL_LINES 16
+
+extern SWspan *
+_swrast_get_span_queue(struct gl_context *ctx, GLuint n);
+
 extern void
 _swrast_span_default_attribs(struct gl_context *ctx, SWspan *span);
 
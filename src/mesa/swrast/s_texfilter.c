@@ -1242,6 +1242,76 @@ sample_2d_linear_repeat(struct gl_context *ctx,
 }
 
 
+/**
+ * Can sample_2d_linear_repeat_ubyte() be used for this image?
+ */
+static inline GLboolean
+is_linear_repeat_ubyte_format(mesa_format format)
+{
+   return format == MESA_FORMAT_A8B8G8R8_UNORM ||
+          format == MESA_FORMAT_BGR_UNORM8;
+}
+
+
+/**
+ * As sample_2d_linear_repeat(), for MESA_FORMAT_A8B8G8R8_UNORM and
+ * MESA_FORMAT_BGR_UNORM8 images.  The four texels are fetched straight
+ * from the image and filtered as integers converted to float, which
+ * avoids the four FetchTexel calls and their per-texel conversion.
+ */
+static inline void
+sample_2d_linear_repeat_ubyte(const struct gl_texture_image *img,
+                              const GLfloat texcoord[4],
+                              GLfloat rgba[4])
+{
+   const struct swrast_texture_image *swImg = swrast_texture_image_const(img);
+   const GLubyte *map = (const GLubyte *) swImg->ImageSlices[0];
+   const GLint rowStride = swImg->RowStride;
+   const GLfloat scale = 1.0F / 255.0F;
+   GLint i0, j0, i1, j1;
+   GLfloat wi, wj;
+
+   ASSERT(img->Border == 0);
+   ASSERT(swImg->_IsPowerOfTwo);
+
+   linear_repeat_texel_location(img->Width2,  texcoord[0], &i0, &i1, &wi);
+   linear_repeat_texel_location(img->Height2, texcoord[1], &j0, &j1, &wj);
+
+   if (img->TexFormat == MESA_FORMAT_A8B8G8R8_UNORM) {
+      const GLuint *row0 = (const GLuint *) (map + j0 * rowStride);
+      const GLuint *row1 = (const GLuint *) (map + j1 * rowStride);
+      const GLuint t00 = row0[i0], t10 = row0[i1];
+      const GLuint t01 = row1[i0], t11 = row1[i1];
+      GLuint c;
+
+      for (c = 0; c < 4; c++) {
+         const GLuint shift = 24 - 8 * c;
+         rgba[c] = scale * lerp_2d(wi, wj,
+                                   (GLfloat) ((t00 >> shift) & 0xff),
+                                   (GLfloat) ((t10 >> shift) & 0xff),
+                                   (GLfloat) ((t01 >> shift) & 0xff),
+                                   (GLfloat) ((t11 >> shift) & 0xff));
+      }
+   }
+   else {
+      const GLubyte *t00 = map + j0 * rowStride + 3 * i0;
+      const GLubyte *t10 = map + j0 * rowStride + 3 * i1;
+      const GLubyte *t01 = map + j1 * rowStride + 3 * i0;
+      const GLubyte *t11 = map + j1 * rowStride + 3 * i1;
+      GLuint c;
+
+      ASSERT(img->TexFormat == MESA_FORMAT_BGR_UNORM8);
+
+      /* bytes are stored B, G, R */
+      for (c = 0; c < 3; c++) {
+         rgba[c] = scale * lerp_2d(wi, wj, t00[2 - c], t10[2 - c],
+                                   t01[2 - c], t11[2 - c]);
+      }
+      rgba[ACOMP] = 1.0F;
+   }
+}
+
+
 static void
 sample_2d_nearest_mipmap_nearest(struct gl_context *ctx,
                                  const struct gl_sampler_object *samp,
@@ -1336,6 +1406,25 @@ sample_2d_linear_mipmap_linear_repeat(struct gl_context *ctx,
    ASSERT(lambda != NULL);
    ASSERT(samp->WrapS == GL_REPEAT);
    ASSERT(samp->WrapT == GL_REPEAT);
+   if (is_linear_repeat_ubyte_format(tObj->Image[0][tObj->BaseLevel]->TexFormat)) {
+      for (i = 0; i < n; i++) {
+         GLint level = linear_mipmap_level(tObj, lambda[i]);
+         if (level >= tObj->_MaxLevel) {
+            sample_2d_linear_repeat_ubyte(tObj->Image[0][tObj->_MaxLevel],
+                                          texcoord[i], rgba[i]);
+         }
+         else {
+            GLfloat t0[4], t1[4];  /* texels */
+            const GLfloat f = FRAC(lambda[i]);
+            sample_2d_linear_repeat_ubyte(tObj->Image[0][level  ],
+                                          texcoord[i], t0);
+            sample_2d_linear_repeat_ubyte(tObj->Image[0][level+1],
+                                          texcoord[i], t1);
+            lerp_rgba(rgba[i], f, t0, t1);
+         }
+      }
+      return;
+   }
    for (i = 0; i < n; i++) {
       GLint level = linear_mipmap_level(tObj, lambda[i]);
       if (level >= tObj->_MaxLevel) {
@@ -1388,8 +1477,15 @@ sample_linear_2d(struct gl_context *ctx,
        samp->WrapT == GL_REPEAT &&
        swImg->_IsPowerOfTwo &&
        image->Border == 0) {
-      for (i = 0; i < n; i++) {
-         sample_2d_linear_repeat(ctx, samp, image, texcoords[i], rgba[i]);
+      if (is_linear_repeat_ubyte_format(image->TexFormat)) {
+         for (i = 0; i < n; i++) {
+            sample_2d_linear_repeat_ubyte(image, texcoords[i], rgba[i]);
+         }
+      }
+      else {
+         for (i = 0; i < n; i++) {
+            sample_2d_linear_repeat(ctx, samp, image, texcoords[i], rgba[i]);
+         }
       }
    }
    else {
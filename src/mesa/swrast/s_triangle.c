@@ -870,6 +870,8 @@ fast_persp_span(struct gl_context *ctx, SWspan *span,
 #define INTERP_ALPHA 1
 #define INTERP_ATTRIBS 1
 #define RENDER_SPAN( span )   _swrast_write_rgba_span(ctx, &span);
+#define PARALLEL_SPANS  (!_swrast_use_fragment_program(ctx) && \
+                         !ctx->ATIFragmentShader._Enabled)
 #include "s_tritemp.h"
 
 
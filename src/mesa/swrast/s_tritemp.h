@@ -57,6 +57,14 @@
  * The following macro MUST be defined:
  *    RENDER_SPAN(span) - code to write a span of pixels.
  *
+ * When built with OpenMP, RENDER_SPAN may be run on several threads at
+ * once if the following macro is defined:
+ *    PARALLEL_SPANS      - condition, evaluated once per triangle, which
+ *                          says whether RENDER_SPAN is thread-safe.  The
+ *                          spans are then queued while walking the edges
+ *                          and written in parallel afterwards, each thread
+ *                          using its own span arrays.
+ *
  * This code was designed for the origin to be in the lower-left corner.
  *
  * Inspired by triangle rasterizer code written by Allen Akin.  Thanks Allen!
@@ -521,6 +529,17 @@ static void NAME(struct gl_context *ctx, const SWvertex *v0,
          GLfloat attrLeft[VARYING_SLOT_MAX][4];
          GLfloat daOuter[VARYING_SLOT_MAX][4], daInner[VARYING_SLOT_MAX][4];
 #endif
+#if defined(PARALLEL_SPANS) && defined(_OPENMP)
+         SWspan *spanQueue = NULL;
+         GLint numQueued = 0, maxQueued = 0;
+
+         if (eMaj.lines >= SWRAST_MIN_PARALLEL_LINES &&
+             omp_get_max_threads() > 1 && (PARALLEL_SPANS)) {
+            spanQueue = _swrast_get_span_queue(ctx, eMaj.lines);
+            if (spanQueue)
+               maxQueued = eMaj.lines;
+         }
+#endif
 
          for (subTriangle=0; subTriangle<=1; subTriangle++) {
             EdgeT *eLeft, *eRight;
@@ -561,7 +580,7 @@ static void NAME(struct gl_context *ctx, const SWvertex *v0,
                   setupRight = 0;
                }
                if (lines == 0)
-                  return;
+                  break;
             }
 
             if (setupLeft && eLeft->lines > 0) {
@@ -814,6 +833,11 @@ static void NAME(struct gl_context *ctx, const SWvertex *v0,
 #endif
 #ifdef INTERP_ALPHA
                   CLAMP_INTERPOLANT(alpha, alphaStep, len);
+#endif
+#if defined(PARALLEL_SPANS) && defined(_OPENMP)
+                  if (numQueued < maxQueued)
+                     spanQueue[numQueued++] = span;
+                  else
 #endif
                   {
                      RENDER_SPAN( span );
@@ -903,12 +927,29 @@ static void NAME(struct gl_context *ctx, const SWvertex *v0,
 
          } /* for subTriangle */
 
+#if defined(PARALLEL_SPANS) && defined(_OPENMP)
+         /* The rows of a triangle never overlap, so they can be written
+          * in any order.
+          */
+         if (numQueued > 0) {
+            GLint i;
+#pragma omp parallel for schedule(dynamic)
+            for (i = 0; i < numQueued; i++) {
+               SWspan *queued = spanQueue + i;
+               queued->array = SWRAST_CONTEXT(ctx)->SpanArrays +
+                               omp_get_thread_num();
+               RENDER_SPAN( (*queued) );
+            }
+         }
+#endif
+
       }
    }
 }
 
 #undef SETUP_CODE
 #undef RENDER_SPAN
+#undef PARALLEL_SPANS
 
 #undef PIXEL_TYPE
 #undef BYTES_PER_ROW
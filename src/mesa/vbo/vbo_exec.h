@@ -46,9 +46,18 @@ USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 
 /**
- * Size of the VBO to use for glBegin/glVertex/glEnd-style rendering.
+ * Default size of the VBO to use for glBegin/glVertex/glEnd-style rendering,
+ * can be changed with MESA_VBO_BUFFER_SIZE.
  */
-#define VBO_VERT_BUFFER_SIZE (1024*64)	/* bytes */
+#define VBO_VERT_BUFFER_SIZE (1024*256)	/* bytes */
+#define VBO_MIN_VERT_BUFFER_SIZE (1024*64)
+#define VBO_MAX_VERT_BUFFER_SIZE (1024*1024*16)
+
+/**
+ * Number of VBOs which glBegin/glVertex/glEnd-style rendering cycles
+ * through, see vbo_exec_vtx_map().
+ */
+#define VBO_VERT_BUFFER_COUNT 3
 
 
 /** Current vertex program mode */
@@ -91,9 +100,17 @@ struct vbo_exec_context
       struct _mesa_prim prim[VBO_MAX_PRIM];
       GLuint prim_count;
 
+      /* The ring of VBOs, bufferobj being one of them, and the fences
+       * of the draws from the others.
+       */
+      struct gl_buffer_object *ring[VBO_VERT_BUFFER_COUNT];
+      struct gl_sync_object *ring_fence[VBO_VERT_BUFFER_COUNT];
+      GLuint ring_index;
+
       GLfloat *buffer_map;
       GLfloat *buffer_ptr;              /* cursor, points into buffer */
       GLuint   buffer_used;             /* in bytes */
+      GLuint   buffer_size;             /* in bytes */
       GLfloat vertex[VBO_ATTRIB_MAX*4]; /* current vertex */
 
       GLuint vert_count;
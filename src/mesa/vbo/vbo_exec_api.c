@@ -226,31 +226,83 @@ vbo_exec_copy_from_current(struct vbo_exec_context *exec)
 }
 
 
+/**
+ * Copy a vertex from the old to the new vertex format of
+ * vbo_exec_wrap_upgrade_vertex().
+ */
+static void
+upgrade_vertex(struct vbo_exec_context *exec, GLfloat *dest,
+               const GLfloat *data, GLfloat * const *old_attrptr,
+               GLuint attr, GLuint oldSize, GLuint newSize)
+{
+   struct vbo_context *vbo = vbo_context(exec->ctx);
+   GLuint j;
+
+   for (j = 0 ; j < VBO_ATTRIB_MAX ; j++) {
+      GLuint sz = exec->vtx.attrsz[j];
+
+      if (sz) {
+         GLint old_offset = old_attrptr[j] - exec->vtx.vertex;
+         GLint new_offset = exec->vtx.attrptr[j] - exec->vtx.vertex;
+
+         if (j == attr) {
+            if (oldSize) {
+               GLfloat tmp[4];
+               COPY_CLEAN_4V_TYPE_AS_FLOAT(tmp, oldSize,
+                                           data + old_offset,
+                                           exec->vtx.attrtype[j]);
+               COPY_SZ_4V(dest + new_offset, newSize, tmp);
+            } else {
+               GLfloat *current = (GLfloat *)vbo->currval[j].Ptr;
+               COPY_SZ_4V(dest + new_offset, sz, current);
+            }
+         }
+         else {
+            COPY_SZ_4V(dest + new_offset, sz, data + old_offset);
+         }
+      }
+   }
+}
+
+
 /**
  * Flush existing data, set new attrib size, replay copied vertices.
  * This is called when we transition from a small vertex attribute size
  * to a larger one.  Ex: glTexCoord2f -> glTexCoord4f.
  * We need to go back over the previous 2-component texcoords and insert
  * zero and one values.
+ *
+ * If the vertices stored so far still fit into the buffer in the new
+ * format, they're converted in place instead of being flushed.
  */ 
 static void
 vbo_exec_wrap_upgrade_vertex(struct vbo_exec_context *exec,
                              GLuint attr, GLuint newSize )
 {
    struct gl_context *ctx = exec->ctx;
-   struct vbo_context *vbo = vbo_context(ctx);
    const GLint lastcount = exec->vtx.vert_count;
    GLfloat *old_attrptr[VBO_ATTRIB_MAX];
    const GLuint old_vtx_size = exec->vtx.vertex_size; /* floats per vertex */
    const GLuint oldSize = exec->vtx.attrsz[attr];
+   const GLuint new_vtx_size = old_vtx_size + newSize - oldSize;
+   GLboolean in_place;
    GLuint i;
 
+   /* Convert in place unless the heuristic below applies, and with room
+    * for at least one more vertex.
+    */
+   in_place = (lastcount > 0 && exec->vtx.buffer_map &&
+               (_mesa_inside_begin_end(ctx) || oldSize || lastcount <= 8) &&
+               (lastcount + 1) * new_vtx_size * sizeof(GLfloat) <=
+               exec->vtx.buffer_size - exec->vtx.buffer_used);
+
    /* Run pipeline on current vertices, copy wrapped vertices
     * to exec->vtx.copied.
     */
-   vbo_exec_wrap_buffers( exec );
+   if (!in_place)
+      vbo_exec_wrap_buffers( exec );
 
-   if (unlikely(exec->vtx.copied.nr)) {
+   if (unlikely(in_place || exec->vtx.copied.nr)) {
       /* We're in the middle of a primitive, keep the old vertex
        * format around to be able to translate the copied vertices to
        * the new format.
@@ -279,10 +331,12 @@ vbo_exec_wrap_upgrade_vertex(struct vbo_exec_context *exec,
     */
    exec->vtx.attrsz[attr] = newSize;
    exec->vtx.vertex_size += newSize - oldSize;
-   exec->vtx.max_vert = ((VBO_VERT_BUFFER_SIZE - exec->vtx.buffer_used) / 
+   exec->vtx.max_vert = ((exec->vtx.buffer_size - exec->vtx.buffer_used) / 
                          (exec->vtx.vertex_size * sizeof(GLfloat)));
-   exec->vtx.vert_count = 0;
-   exec->vtx.buffer_ptr = exec->vtx.buffer_map;
+   if (!in_place) {
+      exec->vtx.vert_count = 0;
+      exec->vtx.buffer_ptr = exec->vtx.buffer_map;
+   }
 
    if (unlikely(oldSize)) {
       /* Size changed, recalculate all the attrptr[] values
@@ -309,43 +363,36 @@ vbo_exec_wrap_upgrade_vertex(struct vbo_exec_context *exec,
 	 exec->vtx.vertex_size - newSize;
    }
 
+   if (in_place) {
+      /* The vertices only grow, so go backwards not to overwrite any
+       * before it's converted.
+       */
+      assert(new_vtx_size > old_vtx_size);
+
+      for (i = lastcount; i-- > 0; ) {
+         GLfloat data[VBO_ATTRIB_MAX * 4];
+
+         memcpy(data, exec->vtx.buffer_map + i * old_vtx_size,
+                old_vtx_size * sizeof(GLfloat));
+         upgrade_vertex(exec, exec->vtx.buffer_map + i * new_vtx_size, data,
+                        old_attrptr, attr, oldSize, newSize);
+      }
+
+      exec->vtx.buffer_ptr = exec->vtx.buffer_map + lastcount * new_vtx_size;
+   }
    /* Replay stored vertices to translate them
     * to new format here.
     *
     * -- No need to replay - just copy piecewise
     */
-   if (unlikely(exec->vtx.copied.nr)) {
+   else if (unlikely(exec->vtx.copied.nr)) {
       GLfloat *data = exec->vtx.copied.buffer;
       GLfloat *dest = exec->vtx.buffer_ptr;
-      GLuint j;
 
       assert(exec->vtx.buffer_ptr == exec->vtx.buffer_map);
 
       for (i = 0 ; i < exec->vtx.copied.nr ; i++) {
-	 for (j = 0 ; j < VBO_ATTRIB_MAX ; j++) {
-	    GLuint sz = exec->vtx.attrsz[j];
-
-	    if (sz) {
-	       GLint old_offset = old_attrptr[j] - exec->vtx.vertex;
-	       GLint new_offset = exec->vtx.attrptr[j] - exec->vtx.vertex;
-
-	       if (j == attr) {
-		  if (oldSize) {
-		     GLfloat tmp[4];
-                     COPY_CLEAN_4V_TYPE_AS_FLOAT(tmp, oldSize,
-                                                 data + old_offset,
-                                                 exec->vtx.attrtype[j]);
-		     COPY_SZ_4V(dest + new_offset, newSize, tmp);
-		  } else {
-		     GLfloat *current = (GLfloat *)vbo->currval[j].Ptr;
-		     COPY_SZ_4V(dest + new_offset, sz, current);
-		  }
-	       }
-	       else {
-		  COPY_SZ_4V(dest + new_offset, sz, data + old_offset);
-	       }
-	    }
-	 }
+         upgrade_vertex(exec, dest, data, old_attrptr, attr, oldSize, newSize);
 
 	 data += old_vtx_size;
 	 dest += exec->vtx.vertex_size;
@@ -986,7 +1033,8 @@ void vbo_use_buffer_objects(struct gl_context *ctx)
    GLuint bufName = IMM_BUFFER_NAME;
    GLenum target = GL_ARRAY_BUFFER_ARB;
    GLenum usage = GL_STREAM_DRAW_ARB;
-   GLsizei size = VBO_VERT_BUFFER_SIZE;
+   GLsizei size = exec->vtx.buffer_size;
+   GLuint i;
 
    /* Make sure this func is only used once */
    assert(exec->vtx.bufferobj == ctx->Shared->NullBufferObj);
@@ -995,9 +1043,16 @@ void vbo_use_buffer_objects(struct gl_context *ctx)
    exec->vtx.buffer_map = NULL;
    exec->vtx.buffer_ptr = NULL;
 
-   /* Allocate a real buffer object now */
-   _mesa_reference_buffer_object(ctx, &exec->vtx.bufferobj, NULL);
-   exec->vtx.bufferobj = ctx->Driver.NewBufferObject(ctx, bufName, target);
+   /* Allocate real buffer objects now, the first one's storage is
+    * allocated right away, the others' when they are first used.
+    */
+   for (i = 0; i < VBO_VERT_BUFFER_COUNT; i++) {
+      exec->vtx.ring[i] = ctx->Driver.NewBufferObject(ctx, bufName, target);
+   }
+   exec->vtx.ring_index = 0;
+
+   _mesa_reference_buffer_object(ctx, &exec->vtx.bufferobj,
+                                 exec->vtx.ring[0]);
    if (!ctx->Driver.BufferData(ctx, target, size, NULL, usage, exec->vtx.bufferobj)) {
       _mesa_error(ctx, GL_OUT_OF_MEMORY, "VBO allocation");
    }
@@ -1032,8 +1087,15 @@ void vbo_exec_vtx_init( struct vbo_exec_context *exec )
                                  &exec->vtx.bufferobj,
                                  ctx->Shared->NullBufferObj);
 
+   exec->vtx.buffer_size = VBO_VERT_BUFFER_SIZE;
+   if (_mesa_getenv("MESA_VBO_BUFFER_SIZE")) {
+      GLuint kb = atoi(_mesa_getenv("MESA_VBO_BUFFER_SIZE"));
+      exec->vtx.buffer_size = CLAMP(kb, VBO_MIN_VERT_BUFFER_SIZE / 1024,
+                                    VBO_MAX_VERT_BUFFER_SIZE / 1024) * 1024;
+   }
+
    ASSERT(!exec->vtx.buffer_map);
-   exec->vtx.buffer_map = _mesa_align_malloc(VBO_VERT_BUFFER_SIZE, 64);
+   exec->vtx.buffer_map = _mesa_align_malloc(exec->vtx.buffer_size, 64);
    exec->vtx.buffer_ptr = exec->vtx.buffer_map;
 
    vbo_exec_vtxfmt_init( exec );
@@ -1118,6 +1180,14 @@ void vbo_exec_vtx_destroy( struct vbo_exec_context *exec )
       ctx->Driver.UnmapBuffer(ctx, exec->vtx.bufferobj);
    }
    _mesa_reference_buffer_object(ctx, &exec->vtx.bufferobj, NULL);
+
+   for (i = 0; i < VBO_VERT_BUFFER_COUNT; i++) {
+      if (exec->vtx.ring_fence[i]) {
+         ctx->Driver.DeleteSyncObject(ctx, exec->vtx.ring_fence[i]);
+         exec->vtx.ring_fence[i] = NULL;
+      }
+      _mesa_reference_buffer_object(ctx, &exec->vtx.ring[i], NULL);
+   }
 }
 
 
@@ -42,7 +42,8 @@
 
 /**
  * All vertex buffers should be in an unmapped state when we're about
- * to draw.  This debug function checks that.
+ * to draw, except for persistently mapped ones.  This debug function
+ * checks that.
  */
 static void
 check_buffers_are_unmapped(const struct gl_client_array **inputs)
@@ -53,7 +54,7 @@ check_buffers_are_unmapped(const struct gl_client_array **inputs)
    for (i = 0; i < VERT_ATTRIB_MAX; i++) {
       if (inputs[i]) {
          struct gl_buffer_object *obj = inputs[i]->BufferObj;
-         assert(!_mesa_bufferobj_mapped(obj));
+         assert(!_mesa_check_disallowed_mapping(obj));
          (void) obj;
       }
    }
@@ -78,9 +79,65 @@ vbo_check_buffers_are_unmapped(struct gl_context *ctx)
 
 
 
+/**
+ * Look for the index range in the buffer object's cache.
+ * \return GL_TRUE if found
+ */
+static GLboolean
+get_cached_index_range(struct gl_buffer_object *obj,
+                       const struct gl_index_range *key,
+                       GLuint *min_index, GLuint *max_index)
+{
+   GLboolean found = GL_FALSE;
+   GLuint i;
+
+   _glthread_LOCK_MUTEX(obj->Mutex);
+   for (i = 0; i < obj->NumIndexRanges; i++) {
+      const struct gl_index_range *range = &obj->IndexRanges[i];
+
+      if (range->Offset == key->Offset &&
+          range->Count == key->Count &&
+          range->Type == key->Type &&
+          range->PrimitiveRestart == key->PrimitiveRestart &&
+          (!range->PrimitiveRestart ||
+           range->RestartIndex == key->RestartIndex)) {
+         *min_index = range->Min;
+         *max_index = range->Max;
+         found = GL_TRUE;
+         break;
+      }
+   }
+   _glthread_UNLOCK_MUTEX(obj->Mutex);
+
+   return found;
+}
+
+
+/**
+ * Add an index range to the buffer object's cache, replacing the oldest
+ * one when it's full.
+ */
+static void
+cache_index_range(struct gl_buffer_object *obj,
+                  const struct gl_index_range *range)
+{
+   _glthread_LOCK_MUTEX(obj->Mutex);
+   if (obj->NumIndexRanges < MAX_INDEX_RANGES) {
+      obj->IndexRanges[obj->NumIndexRanges++] = *range;
+   }
+   else {
+      obj->IndexRanges[obj->NextIndexRange] = *range;
+      obj->NextIndexRange = (obj->NextIndexRange + 1) % MAX_INDEX_RANGES;
+   }
+   _glthread_UNLOCK_MUTEX(obj->Mutex);
+}
+
+
 /**
  * Compute min and max elements by scanning the index buffer for
  * glDraw[Range]Elements() calls.
+ * The results for buffer objects are cached in the buffer object, so
+ * static index buffers get scanned only once.
  * If primitive restart is enabled, we need to ignore restart
  * indexes when computing min/max.
  */
@@ -95,13 +152,50 @@ vbo_get_minmax_index(struct gl_context *ctx,
    const GLuint restartIndex = _mesa_primitive_restart_index(ctx, ib->type);
    const int index_size = vbo_sizeof_ib_type(ib->type);
    const char *indices;
+   struct gl_index_range range;
+   GLboolean cache = GL_FALSE;
+   GLboolean unmap = GL_FALSE;
    GLuint i;
 
    indices = (char *) ib->ptr + prim->start * index_size;
-   if (_mesa_is_bufferobj(ib->obj)) {
+   if (_mesa_is_bufferobj(ib->obj) && _mesa_bufferobj_mapped(ib->obj)) {
+      /* The buffer is persistently mapped by the application, so its
+       * contents may change behind our back and it can't be mapped a
+       * second time.  Read the indices through the application's mapping
+       * if it covers them, otherwise report unknown bounds.
+       */
+      const GLintptr offset = (GLintptr) indices;
+      const GLsizeiptr size = count * index_size;
+
+      if (offset < ib->obj->Offset ||
+          offset + size > ib->obj->Offset + ib->obj->Length) {
+         *min_index = 0;
+         *max_index = ~0;
+         return;
+      }
+
+      indices = (char *) ib->obj->Pointer + (offset - ib->obj->Offset);
+   }
+   else if (_mesa_is_bufferobj(ib->obj)) {
       GLsizeiptr size = MIN2(count * index_size, ib->obj->Size);
+
+      if (!ib->obj->GPUWritten) {
+         memset(&range, 0, sizeof(range));
+         range.Offset = (GLintptr) indices;
+         range.Count = count;
+         range.Type = ib->type;
+         range.PrimitiveRestart = restart;
+         range.RestartIndex = restartIndex;
+
+         if (get_cached_index_range(ib->obj, &range, min_index, max_index))
+            return;
+
+         cache = GL_TRUE;
+      }
+
       indices = ctx->Driver.MapBufferRange(ctx, (GLintptr) indices, size,
                                            GL_MAP_READ_BIT, ib->obj);
+      unmap = GL_TRUE;
    }
 
    switch (ib->type) {
@@ -176,8 +270,14 @@ vbo_get_minmax_index(struct gl_context *ctx,
       break;
    }
 
-   if (_mesa_is_bufferobj(ib->obj)) {
+   if (unmap) {
       ctx->Driver.UnmapBuffer(ctx, ib->obj);
+
+      if (cache) {
+         range.Min = *min_index;
+         range.Max = *max_index;
+         cache_index_range(ib->obj, &range);
+      }
    }
 }
 
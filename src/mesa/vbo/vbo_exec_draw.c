@@ -272,7 +272,7 @@ vbo_exec_vtx_unmap( struct vbo_exec_context *exec )
       exec->vtx.buffer_used += (exec->vtx.buffer_ptr -
                                 exec->vtx.buffer_map) * sizeof(float);
 
-      assert(exec->vtx.buffer_used <= VBO_VERT_BUFFER_SIZE);
+      assert(exec->vtx.buffer_used <= exec->vtx.buffer_size);
       assert(exec->vtx.buffer_ptr != NULL);
       
       ctx->Driver.UnmapBuffer(ctx, exec->vtx.bufferobj);
@@ -283,6 +283,69 @@ vbo_exec_vtx_unmap( struct vbo_exec_context *exec )
 }
 
 
+/**
+ * Get a fence for the draws issued so far, NULL if the driver can't fence.
+ */
+static struct gl_sync_object *
+vbo_exec_fence(struct gl_context *ctx)
+{
+   struct gl_sync_object *fence;
+
+   if (!ctx->Driver.NewSyncObject)
+      return NULL;
+
+   fence = ctx->Driver.NewSyncObject(ctx, GL_SYNC_FENCE);
+   if (fence) {
+      fence->Type = GL_SYNC_FENCE;
+      fence->Name = 1;
+      fence->RefCount = 1;
+      fence->SyncCondition = GL_SYNC_GPU_COMMANDS_COMPLETE;
+      fence->Flags = 0;
+      fence->StatusFlag = 0;
+
+      ctx->Driver.FenceSync(ctx, fence, GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+   }
+
+   return fence;
+}
+
+
+/**
+ * Switch to the next VBO of the ring, as the current one is full.
+ * \return GL_TRUE if the GPU is done with the new VBO's storage, so that
+ *         it can be rewritten from the start without reallocating it.
+ */
+static GLboolean
+vbo_exec_next_buffer(struct vbo_exec_context *exec)
+{
+   struct gl_context *ctx = exec->ctx;
+   GLuint i = exec->vtx.ring_index;
+   struct gl_sync_object *fence;
+   GLboolean idle = GL_FALSE;
+
+   if (!exec->vtx.ring[i] || exec->vtx.ring[i] != exec->vtx.bufferobj)
+      return GL_FALSE;
+
+   /* Fence the draws from the VBO we're leaving */
+   exec->vtx.ring_fence[i] = vbo_exec_fence(ctx);
+
+   i = (i + 1) % VBO_VERT_BUFFER_COUNT;
+   exec->vtx.ring_index = i;
+   _mesa_reference_buffer_object(ctx, &exec->vtx.bufferobj,
+                                 exec->vtx.ring[i]);
+
+   fence = exec->vtx.ring_fence[i];
+   if (fence) {
+      ctx->Driver.CheckSync(ctx, fence);
+      idle = fence->StatusFlag;
+      ctx->Driver.DeleteSyncObject(ctx, fence);
+      exec->vtx.ring_fence[i] = NULL;
+   }
+
+   return idle;
+}
+
+
 /**
  * Map the vertex buffer to begin storing glVertex, glColor, etc data.
  */
@@ -303,13 +366,13 @@ vbo_exec_vtx_map( struct vbo_exec_context *exec )
    assert(!exec->vtx.buffer_map);
    assert(!exec->vtx.buffer_ptr);
 
-   if (VBO_VERT_BUFFER_SIZE > exec->vtx.buffer_used + 1024) {
+   if (exec->vtx.buffer_size > exec->vtx.buffer_used + 1024) {
       /* The VBO exists and there's room for more */
       if (exec->vtx.bufferobj->Size > 0) {
          exec->vtx.buffer_map =
             (GLfloat *)ctx->Driver.MapBufferRange(ctx, 
                                                   exec->vtx.buffer_used,
-                                                  (VBO_VERT_BUFFER_SIZE - 
+                                                  (exec->vtx.buffer_size - 
                                                    exec->vtx.buffer_used),
                                                   accessRange,
                                                   exec->vtx.bufferobj);
@@ -320,17 +383,29 @@ vbo_exec_vtx_map( struct vbo_exec_context *exec )
       }
    }
    
+   if (!exec->vtx.buffer_map &&
+       vbo_exec_next_buffer(exec) &&
+       exec->vtx.bufferobj->Size >= exec->vtx.buffer_size) {
+      /* Start over in the next VBO, which the GPU doesn't use anymore */
+      exec->vtx.buffer_used = 0;
+      exec->vtx.buffer_map =
+         (GLfloat *)ctx->Driver.MapBufferRange(ctx,
+                                               0, exec->vtx.buffer_size,
+                                               accessRange,
+                                               exec->vtx.bufferobj);
+   }
+
    if (!exec->vtx.buffer_map) {
       /* Need to allocate a new VBO */
       exec->vtx.buffer_used = 0;
 
       if (ctx->Driver.BufferData(ctx, GL_ARRAY_BUFFER_ARB,
-                                  VBO_VERT_BUFFER_SIZE, 
+                                  exec->vtx.buffer_size, 
                                   NULL, usage, exec->vtx.bufferobj)) {
          /* buffer allocation worked, now map the buffer */
          exec->vtx.buffer_map =
             (GLfloat *)ctx->Driver.MapBufferRange(ctx,
-                                                  0, VBO_VERT_BUFFER_SIZE,
+                                                  0, exec->vtx.buffer_size,
                                                   accessRange,
                                                   exec->vtx.bufferobj);
       }
@@ -424,7 +499,7 @@ vbo_exec_vtx_flush(struct vbo_exec_context *exec, GLboolean keepUnmapped)
    if (keepUnmapped || exec->vtx.vertex_size == 0)
       exec->vtx.max_vert = 0;
    else
-      exec->vtx.max_vert = ((VBO_VERT_BUFFER_SIZE - exec->vtx.buffer_used) / 
+      exec->vtx.max_vert = ((exec->vtx.buffer_size - exec->vtx.buffer_used) / 
                             (exec->vtx.vertex_size * sizeof(GLfloat)));
 
    exec->vtx.buffer_ptr = exec->vtx.buffer_map;
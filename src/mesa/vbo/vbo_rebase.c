@@ -131,6 +131,7 @@ void vbo_rebase_prims( struct gl_context *ctx,
    struct _mesa_prim *tmp_prims = NULL;
    const struct gl_client_array **saved_arrays = ctx->Array._DrawArrays;
    void *tmp_indices = NULL;
+   GLboolean rebased_basevertex = GL_FALSE;
    GLuint i;
 
    assert(min_index != 0);
@@ -139,10 +140,7 @@ void vbo_rebase_prims( struct gl_context *ctx,
       printf("%s %d..%d\n", __FUNCTION__, min_index, max_index);
 
 
-   /* XXX this path is disabled for now.
-    * There's rendering corruption in some apps when it's enabled.
-    */
-   if (0 && ib && ctx->Extensions.ARB_draw_elements_base_vertex) {
+   if (ib && ctx->Extensions.ARB_draw_elements_base_vertex) {
       /* If we can just tell the hardware or the TNL to interpret our
        * indices with a different base, do so.
        */
@@ -154,6 +152,7 @@ void vbo_rebase_prims( struct gl_context *ctx,
       }
 
       prim = tmp_prims;
+      rebased_basevertex = GL_TRUE;
    } else if (ib) {
       /* Unfortunately need to adjust each index individually.
        */
@@ -230,13 +229,18 @@ void vbo_rebase_prims( struct gl_context *ctx,
    ctx->Array._DrawArrays = tmp_array_pointers;
    ctx->NewDriverState |= ctx->DriverFlags.NewArray;
 
+   /* The index bounds are index values, before the base vertex is added.
+    * If the indices were left alone their real lower bound is still
+    * min_index, but zero is a valid bound too and tells the driver there
+    * is nothing left to rebase.
+    */
    draw( ctx, 
 	 prim,
 	 nr_prims, 
 	 ib, 
 	 GL_TRUE,
 	 0, 
-	 max_index - min_index,
+	 rebased_basevertex ? max_index : max_index - min_index,
 	 NULL, NULL );
 
    ctx->Array._DrawArrays = saved_arrays;
@@ -111,6 +111,9 @@ void vbo_save_destroy( struct gl_context *ctx )
    for (i = 0; i < VBO_ATTRIB_MAX; i++) {
       _mesa_reference_buffer_object(ctx, &save->arrays[i].BufferObj, NULL);
    }
+
+   free(save->run.buffer);
+   free(save->run.prim);
 }
 
 
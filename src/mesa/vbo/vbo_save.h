@@ -83,8 +83,34 @@ struct vbo_save_vertex_list {
 
    struct vbo_save_vertex_store *vertex_store;
    struct vbo_save_primitive_store *prim_store;
+
+   /* Set on the first of a run of adjacent lists drawn together: */
+   struct vbo_save_merged_list *merged;
+};
+
+
+/* The runs of vertex lists compiled back to back, with no other opcode in
+ * between and with the same vertex format, are also stored as a single
+ * indexed draw, see vbo_save_merge.c.  Strips, fans, loops, quads and
+ * polygons are converted to independent primitives where that can't be
+ * told apart at draw time, and identical vertices are shared.
+ */
+struct vbo_save_merged_list {
+   struct gl_buffer_object *bufferobj;  /**< vertices, followed by indices */
+   GLuint count;                        /**< vertex count */
+   struct _mesa_index_buffer ib;
+   struct _mesa_prim *prim;
+   GLuint prim_count;
+   GLuint num_lists;                    /**< vertex lists drawn by this */
+
+   /* Conditions under which the conversions are invisible: */
+   GLboolean split_polygons;      /**< needs GL_FILL polygon modes */
+   GLboolean split_lines;         /**< needs line stipple disabled */
+   GLboolean moved_provoking;     /**< needs smooth or last vertex flat */
 };
 
+#define VBO_SAVE_MERGE_MAX_VERTS (1 << 20)
+
 /* These buffers should be a reasonable size to support upload to
  * hardware.  Current vbo implementation will re-upload on any
  * changes, so don't make too big or apps which dynamically create
@@ -103,6 +129,9 @@ struct vbo_save_vertex_list {
 
 #define VBO_SAVE_FALLBACK    0x10000000
 
+/* An interesting VBO number/name to help with debugging */
+#define VBO_BUF_ID  12345
+
 /* Storage to be shared among several vertex_lists.
  */
 struct vbo_save_vertex_store {
@@ -157,6 +186,24 @@ struct vbo_save_context {
    
    GLfloat *current[VBO_ATTRIB_MAX]; /* points into ctx->ListState */
    GLubyte *currentsz[VBO_ATTRIB_MAX];
+
+   /* The current run of vertex lists to be merged, see vbo_save_merge.c */
+   struct {
+      GLboolean enabled;
+      struct vbo_save_vertex_list *first;
+      GLuint num_lists;
+      union gl_dlist_node *end_block;  /**< dlist position after the last */
+      GLuint end_pos;
+      GLfloat *buffer;                 /**< copy of the vertices */
+      GLuint count, max_count;
+      struct _mesa_prim *prim;         /**< copy of the primitives */
+      GLuint prim_count, max_prims;
+   } run;
+
+   /** Number of vertex lists still to be replayed which were already drawn
+    * with the merged list of a preceding one.
+    */
+   GLuint merged_skip;
 };
 
 void vbo_save_init( struct gl_context *ctx );
@@ -184,6 +231,20 @@ GLboolean vbo_save_NotifyBegin( struct gl_context *ctx, GLenum mode );
 
 void vbo_save_playback_vertex_list( struct gl_context *ctx, void *data );
 
+/* save_merge.c:
+ */
+GLboolean vbo_save_merge_is_adjacent( struct gl_context *ctx );
+void vbo_save_merge_add_list( struct gl_context *ctx,
+                              struct vbo_save_vertex_list *node,
+                              const GLfloat *buffer,
+                              GLboolean adjacent );
+void vbo_save_merge_finish( struct gl_context *ctx );
+void vbo_save_merge_reset( struct gl_context *ctx );
+GLboolean vbo_save_can_draw_merged( const struct gl_context *ctx,
+                                    const struct vbo_save_merged_list *merged );
+void vbo_save_destroy_merged_list( struct gl_context *ctx,
+                                   struct vbo_save_merged_list *merged );
+
 void vbo_save_api_init( struct vbo_save_context *save );
 
 GLfloat *
@@ -88,10 +88,6 @@ USE OR OTHER DEALINGS IN THE SOFTWARE.
 #endif
 
 
-/* An interesting VBO number/name to help with debugging */
-#define VBO_BUF_ID  12345
-
-
 /*
  * NOTE: Old 'parity' issue is gone, but copying can still be
  * wrong-footed on replay.
@@ -368,6 +364,7 @@ _save_compile_vertex_list(struct gl_context *ctx)
 {
    struct vbo_save_context *save = &vbo_context(ctx)->save;
    struct vbo_save_vertex_list *node;
+   GLboolean adjacent = vbo_save_merge_is_adjacent(ctx);
 
    /* Allocate space for this structure in the display list currently
     * being compiled.
@@ -392,6 +389,7 @@ _save_compile_vertex_list(struct gl_context *ctx)
    node->prim_count = save->prim_count;
    node->vertex_store = save->vertex_store;
    node->prim_store = save->prim_store;
+   node->merged = NULL;
 
    node->vertex_store->refcount++;
    node->prim_store->refcount++;
@@ -439,6 +437,8 @@ _save_compile_vertex_list(struct gl_context *ctx)
 
    merge_prims(ctx, node->prim, &node->prim_count);
 
+   vbo_save_merge_add_list(ctx, node, save->buffer, adjacent);
+
    /* Deal with GL_COMPILE_AND_EXECUTE:
     */
    if (ctx->ExecuteFlag) {
@@ -1442,6 +1442,7 @@ vbo_save_NewList(struct gl_context *ctx, GLuint list, GLenum mode)
 
    _save_reset_vertex(ctx);
    _save_reset_counters(ctx);
+   vbo_save_merge_reset(ctx);
    ctx->Driver.SaveNeedFlush = GL_FALSE;
 }
 
@@ -1474,6 +1475,8 @@ vbo_save_EndList(struct gl_context *ctx)
       _mesa_install_save_vtxfmt(ctx, &ctx->ListState.ListVtxfmt);
    }
 
+   vbo_save_merge_finish(ctx);
+
    vbo_save_unmap_vertex_store(ctx, save->vertex_store);
 
    assert(save->vertex_size == 0);
@@ -1498,6 +1501,7 @@ vbo_save_EndCallList(struct gl_context *ctx)
        * flag, if it is set:
        */
       save->replay_flags &= VBO_SAVE_FALLBACK;
+      save->merged_skip = 0;
    }
 }
 
@@ -1514,6 +1518,11 @@ vbo_destroy_vertex_list(struct gl_context *ctx, void *data)
    if (--node->prim_store->refcount == 0)
       free(node->prim_store);
 
+   if (node->merged) {
+      vbo_save_destroy_merged_list(ctx, node->merged);
+      node->merged = NULL;
+   }
+
    free(node->current_data);
    node->current_data = NULL;
 }
@@ -1529,6 +1538,11 @@ vbo_print_vertex_list(struct gl_context *ctx, void *data)
    printf("VBO-VERTEX-LIST, %u vertices %d primitives, %d vertsize\n",
           node->count, node->prim_count, node->vertex_size);
 
+   if (node->merged)
+      printf("   merged with %u following lists: %u vertices %u primitives\n",
+             node->merged->num_lists - 1, node->merged->count,
+             node->merged->prim_count);
+
    for (i = 0; i < node->prim_count; i++) {
       struct _mesa_prim *prim = &node->prim[i];
       printf("   prim %d: %s%s %d..%d %s %s\n",
@@ -1586,6 +1600,8 @@ vbo_save_api_init(struct vbo_save_context *save)
 
    ctx->Driver.NotifySaveBegin = vbo_save_NotifyBegin;
 
+   save->run.enabled = !_mesa_getenv("MESA_NO_DLIST_MERGE");
+
    _save_vtxfmt_init(ctx);
    _save_current_init(ctx);
    _mesa_noop_vtxfmt_init(&save->vtxfmt_noop);
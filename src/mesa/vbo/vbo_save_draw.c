@@ -34,6 +34,7 @@
 #include "main/macros.h"
 #include "main/light.h"
 #include "main/state.h"
+#include "main/uniforms.h"
 
 #include "vbo_context.h"
 
@@ -126,14 +127,19 @@ _playback_copy_to_current(struct gl_context *ctx,
 /**
  * Treat the vertex storage as a VBO, define vertex arrays pointing
  * into it:
+ * \param merged  bind the vertices of the merged list instead, if not NULL
  */
 static void vbo_bind_vertex_list(struct gl_context *ctx,
-                                 const struct vbo_save_vertex_list *node)
+                                 const struct vbo_save_vertex_list *node,
+                                 const struct vbo_save_merged_list *merged)
 {
    struct vbo_context *vbo = vbo_context(ctx);
    struct vbo_save_context *save = &vbo->save;
    struct gl_client_array *arrays = save->arrays;
-   GLuint buffer_offset = node->buffer_offset;
+   struct gl_buffer_object *bufferobj =
+      merged ? merged->bufferobj : node->vertex_store->bufferobj;
+   GLuint buffer_offset = merged ? 0 : node->buffer_offset;
+   GLuint count = merged ? merged->count : node->count;
    const GLuint *map;
    GLuint attr;
    GLubyte node_attrsz[VBO_ATTRIB_MAX];  /* copy of node->attrsz[] */
@@ -202,8 +208,8 @@ static void vbo_bind_vertex_list(struct gl_context *ctx,
          arrays[attr]._ElementSize = arrays[attr].Size * sizeof(GLfloat);
          _mesa_reference_buffer_object(ctx,
                                        &arrays[attr].BufferObj,
-                                       node->vertex_store->bufferobj);
-	 arrays[attr]._MaxElement = node->count; /* ??? */
+                                       bufferobj);
+	 arrays[attr]._MaxElement = count; /* ??? */
 	 
 	 assert(arrays[attr].BufferObj->Name);
 
@@ -251,6 +257,13 @@ vbo_save_playback_vertex_list(struct gl_context *ctx, void *data)
       (const struct vbo_save_vertex_list *) data;
    struct vbo_save_context *save = &vbo_context(ctx)->save;
    GLboolean remap_vertex_store = GL_FALSE;
+   GLboolean drawn = GL_FALSE;
+
+   /* Already drawn with the merged list of a preceding vertex list? */
+   if (save->merged_skip > 0) {
+      save->merged_skip--;
+      drawn = GL_TRUE;
+   }
 
    if (save->vertex_store && save->vertex_store->buffer) {
       /* The vertex store is currently mapped but we're about to replay
@@ -276,6 +289,9 @@ vbo_save_playback_vertex_list(struct gl_context *ctx, void *data)
                      "draw operation inside glBegin/End");
          goto end;
       }
+      else if (drawn) {
+         goto copy_to_current;
+      }
       else if (save->replay_flags) {
 	 /* Various degnerate cases: translate into immediate mode
 	  * calls rather than trying to execute in place.
@@ -288,6 +304,8 @@ vbo_save_playback_vertex_list(struct gl_context *ctx, void *data)
       if (ctx->NewState)
 	 _mesa_update_state( ctx );
 
+      _mesa_flush_uniforms(ctx);
+
       /* XXX also need to check if shader enabled, but invalid */
       if ((ctx->VertexProgram.Enabled && !ctx->VertexProgram._Enabled) ||
           (ctx->FragmentProgram.Enabled && !ctx->FragmentProgram._Enabled)) {
@@ -296,7 +314,30 @@ vbo_save_playback_vertex_list(struct gl_context *ctx, void *data)
          return;
       }
 
-      vbo_bind_vertex_list( ctx, node );
+      if (node->merged && vbo_save_can_draw_merged(ctx, node->merged)) {
+         const struct vbo_save_merged_list *merged = node->merged;
+
+         vbo_bind_vertex_list( ctx, node, merged );
+
+         vbo_draw_method(vbo_context(ctx), DRAW_DISPLAY_LIST);
+
+         if (ctx->NewState)
+            _mesa_update_state( ctx );
+
+         vbo_context(ctx)->draw_prims(ctx,
+                                      merged->prim,
+                                      merged->prim_count,
+                                      &merged->ib,
+                                      GL_TRUE,
+                                      0,
+                                      merged->count - 1,
+                                      NULL, NULL);
+
+         save->merged_skip = merged->num_lists - 1;
+         goto copy_to_current;
+      }
+
+      vbo_bind_vertex_list( ctx, node, NULL );
 
       vbo_draw_method(vbo_context(ctx), DRAW_DISPLAY_LIST);
 
@@ -317,6 +358,7 @@ vbo_save_playback_vertex_list(struct gl_context *ctx, void *data)
       }
    }
 
+copy_to_current:
    /* Copy to current?
     */
    _playback_copy_to_current( ctx, node );
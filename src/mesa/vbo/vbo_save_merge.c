@@ -0,0 +1,595 @@
+/**************************************************************************
+ *
+ * Copyright 2014 The Mesa Authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/**
+ * Merging of display list vertex lists.
+ *
+ * Big display lists are compiled into many vertex lists, as a list is
+ * started whenever the vertex or primitive store fills up, and every
+ * glBegin/End pair of a list may be drawn separately.  While compiling,
+ * the vertex lists which directly follow each other in the display list
+ * and have the same vertex format are collected into a run.  When the
+ * run ends, its vertices are deduplicated into a new buffer object and
+ * its primitives are converted to a few indexed points, lines and
+ * triangles primitives, which the first vertex list of the run draws on
+ * behalf of all of them.
+ *
+ * The vertex lists keep their own vertices and primitives, which are
+ * still used for the loopback path, for updating the current attributes
+ * and whenever the state makes the conversions visible, see
+ * vbo_save_can_draw_merged().
+ */
+
+#include "main/glheader.h"
+#include "main/bufferobj.h"
+#include "main/context.h"
+#include "main/imports.h"
+#include "main/macros.h"
+#include "main/mtypes.h"
+#include "main/transformfeedback.h"
+
+#include "vbo_context.h"
+
+
+/**
+ * Is nothing but the vertex lists of the current run in the display list
+ * being compiled?  To be called before allocating the next vertex list.
+ */
+GLboolean
+vbo_save_merge_is_adjacent(struct gl_context *ctx)
+{
+   struct vbo_save_context *save = &vbo_context(ctx)->save;
+
+   return (save->run.num_lists > 0 &&
+           save->run.end_block == ctx->ListState.CurrentBlock &&
+           save->run.end_pos == ctx->ListState.CurrentPos);
+}
+
+
+static GLboolean
+same_vertex_format(const struct vbo_save_vertex_list *a,
+                   const struct vbo_save_vertex_list *b)
+{
+   return (a->vertex_size == b->vertex_size &&
+           memcmp(a->attrsz, b->attrsz, sizeof(a->attrsz)) == 0 &&
+           memcmp(a->attrtype, b->attrtype, sizeof(a->attrtype)) == 0);
+}
+
+
+/**
+ * Add a freshly compiled vertex list to the current run, or start a new
+ * run with it.
+ * \param buffer  the vertices of the list
+ * \param adjacent  result of vbo_save_merge_is_adjacent()
+ */
+void
+vbo_save_merge_add_list(struct gl_context *ctx,
+                        struct vbo_save_vertex_list *node,
+                        const GLfloat *buffer,
+                        GLboolean adjacent)
+{
+   struct vbo_save_context *save = &vbo_context(ctx)->save;
+   const GLuint vertex_size = node->vertex_size;
+   GLuint i;
+
+   if (!save->run.enabled)
+      return;
+
+   if (!adjacent ||
+       !same_vertex_format(save->run.first, node) ||
+       save->run.count + node->count > VBO_SAVE_MERGE_MAX_VERTS)
+      vbo_save_merge_finish(ctx);
+
+   if (node->count && !buffer)
+      return;
+
+   if (save->run.count + node->count > save->run.max_count) {
+      GLuint max_count = MAX2(save->run.max_count * 2,
+                              save->run.count + node->count);
+      GLfloat *vertices = realloc(save->run.buffer,
+                                  max_count * vertex_size * sizeof(GLfloat));
+      if (!vertices) {
+         vbo_save_merge_reset(ctx);
+         return;
+      }
+      save->run.buffer = vertices;
+      save->run.max_count = max_count;
+   }
+
+   if (save->run.prim_count + node->prim_count > save->run.max_prims) {
+      GLuint max_prims = MAX2(save->run.max_prims * 2,
+                              save->run.prim_count + node->prim_count);
+      struct _mesa_prim *prims = realloc(save->run.prim,
+                                         max_prims * sizeof(*prims));
+      if (!prims) {
+         vbo_save_merge_reset(ctx);
+         return;
+      }
+      save->run.prim = prims;
+      save->run.max_prims = max_prims;
+   }
+
+   if (save->run.num_lists == 0)
+      save->run.first = node;
+
+   memcpy(save->run.buffer + save->run.count * vertex_size, buffer,
+          node->count * vertex_size * sizeof(GLfloat));
+
+   for (i = 0; i < node->prim_count; i++) {
+      struct _mesa_prim *prim = &save->run.prim[save->run.prim_count + i];
+
+      *prim = node->prim[i];
+      prim->start += save->run.count;
+   }
+
+   save->run.count += node->count;
+   save->run.prim_count += node->prim_count;
+   save->run.num_lists++;
+
+   save->run.end_block = ctx->ListState.CurrentBlock;
+   save->run.end_pos = ctx->ListState.CurrentPos;
+}
+
+
+/**
+ * Store the n vertices of size vertex_size at src, but each only once,
+ * into dst.
+ * \param remap  returns the index in dst for each vertex of src
+ * \return the number of vertices in dst
+ */
+static GLuint
+dedup_vertices(const GLfloat *src, GLuint n, GLuint vertex_size,
+               GLfloat *dst, GLuint *remap)
+{
+   const size_t bytes = vertex_size * sizeof(GLfloat);
+   GLuint table_size = 64, count = 0, i;
+   GLuint *table;
+
+   while (table_size < n * 2)
+      table_size *= 2;
+
+   /* The entries are the dst index + 1, zero being empty */
+   table = calloc(table_size, sizeof(GLuint));
+   if (!table) {
+      memcpy(dst, src, n * bytes);
+      for (i = 0; i < n; i++)
+         remap[i] = i;
+      return n;
+   }
+
+   for (i = 0; i < n; i++) {
+      const GLfloat *v = src + i * vertex_size;
+      GLuint hash = 2166136261u, slot, j;
+
+      for (j = 0; j < vertex_size; j++) {
+         fi_type word;
+         word.f = v[j];
+         hash = (hash ^ word.u) * 16777619u;
+      }
+
+      for (slot = hash & (table_size - 1); ;
+           slot = (slot + 1) & (table_size - 1)) {
+         if (table[slot] == 0) {
+            memcpy(dst + count * vertex_size, v, bytes);
+            table[slot] = ++count;
+            remap[i] = count - 1;
+            break;
+         }
+
+         if (memcmp(dst + (table[slot] - 1) * vertex_size, v, bytes) == 0) {
+            remap[i] = table[slot] - 1;
+            break;
+         }
+      }
+   }
+
+   free(table);
+   return count;
+}
+
+
+/**
+ * Upper bound of the indices emit_converted() or emit_unconverted()
+ * produce for a primitive.
+ */
+static GLuint
+max_prim_indices(const struct _mesa_prim *prim)
+{
+   const GLuint n = prim->count;
+
+   switch (prim->mode) {
+   case GL_LINE_STRIP:
+   case GL_LINE_LOOP:
+      return 2 * n;
+   case GL_TRIANGLE_STRIP:
+   case GL_TRIANGLE_FAN:
+   case GL_POLYGON:
+      return n > 2 ? 3 * (n - 2) : 0;
+   case GL_QUADS:
+   case GL_QUAD_STRIP:
+      return 2 * n;
+   default:
+      return n;
+   }
+}
+
+
+/**
+ * Emit the indices of a primitive as independent points, lines or
+ * triangles.  The triangles keep the winding and the last vertex of the
+ * triangles or quads they are part of.
+ * \return the number of indices written to out
+ */
+static GLuint
+emit_converted(const struct _mesa_prim *prim, const GLuint *remap,
+               GLuint *out)
+{
+   const GLuint *v = remap + prim->start;
+   const GLuint n = prim->count;
+   GLuint *o = out;
+   GLuint i;
+
+   switch (prim->mode) {
+   case GL_POINTS:
+      for (i = 0; i < n; i++)
+         *o++ = v[i];
+      break;
+   case GL_LINES:
+      for (i = 0; i + 1 < n; i += 2) {
+         *o++ = v[i];
+         *o++ = v[i + 1];
+      }
+      break;
+   case GL_LINE_STRIP:
+   case GL_LINE_LOOP:
+      for (i = 0; i + 1 < n; i++) {
+         *o++ = v[i];
+         *o++ = v[i + 1];
+      }
+      if (prim->mode == GL_LINE_LOOP && n >= 2) {
+         *o++ = v[n - 1];
+         *o++ = v[0];
+      }
+      break;
+   case GL_TRIANGLES:
+      for (i = 0; i + 2 < n; i += 3) {
+         *o++ = v[i];
+         *o++ = v[i + 1];
+         *o++ = v[i + 2];
+      }
+      break;
+   case GL_TRIANGLE_STRIP:
+      for (i = 0; i + 2 < n; i++) {
+         *o++ = v[i + (i & 1)];
+         *o++ = v[i + 1 - (i & 1)];
+         *o++ = v[i + 2];
+      }
+      break;
+   case GL_TRIANGLE_FAN:
+      for (i = 1; i + 1 < n; i++) {
+         *o++ = v[0];
+         *o++ = v[i];
+         *o++ = v[i + 1];
+      }
+      break;
+   case GL_POLYGON:
+      /* Rotated so that the first vertex, which provokes, comes last */
+      for (i = 1; i + 1 < n; i++) {
+         *o++ = v[i];
+         *o++ = v[i + 1];
+         *o++ = v[0];
+      }
+      break;
+   case GL_QUADS:
+      for (i = 0; i + 3 < n; i += 4) {
+         *o++ = v[i];
+         *o++ = v[i + 1];
+         *o++ = v[i + 3];
+         *o++ = v[i + 1];
+         *o++ = v[i + 2];
+         *o++ = v[i + 3];
+      }
+      break;
+   case GL_QUAD_STRIP:
+      for (i = 0; i + 3 < n; i += 2) {
+         *o++ = v[i];
+         *o++ = v[i + 1];
+         *o++ = v[i + 3];
+         *o++ = v[i + 2];
+         *o++ = v[i];
+         *o++ = v[i + 3];
+      }
+      break;
+   default:
+      assert(0);
+   }
+
+   return o - out;
+}
+
+
+static GLuint
+emit_unconverted(const struct _mesa_prim *prim, const GLuint *remap,
+                 GLuint *out)
+{
+   GLuint i;
+
+   for (i = 0; i < prim->count; i++)
+      out[i] = remap[prim->start + i];
+
+   return prim->count;
+}
+
+
+/**
+ * Build the merged list of the current run.
+ * \return NULL if that wouldn't save any draws or on allocation failure
+ */
+static struct vbo_save_merged_list *
+build_merged_list(struct gl_context *ctx)
+{
+   struct vbo_save_context *save = &vbo_context(ctx)->save;
+   const GLuint vertex_size = save->run.first->vertex_size;
+   const GLboolean has_edgeflag =
+      save->run.first->attrsz[VBO_ATTRIB_EDGEFLAG] != 0;
+   struct vbo_save_merged_list *merged = NULL;
+   GLuint *remap = NULL, *indices = NULL;
+   GLfloat *vertices = NULL;
+   GLubyte *data = NULL;
+   GLuint num_prims = 0, max_indices = 0, num_indices = 0;
+   GLuint count, i;
+   GLboolean last_converted = GL_FALSE;
+   size_t vertex_bytes, index_size;
+
+   for (i = 0; i < save->run.prim_count; i++) {
+      if (save->run.prim[i].count) {
+         num_prims++;
+         max_indices += max_prim_indices(&save->run.prim[i]);
+      }
+   }
+
+   if (num_prims < 2 || save->run.count == 0)
+      return NULL;
+
+   merged = CALLOC_STRUCT(vbo_save_merged_list);
+   remap = malloc(save->run.count * sizeof(GLuint));
+   vertices = malloc(save->run.count * vertex_size * sizeof(GLfloat));
+   indices = malloc(MAX2(max_indices, 1) * sizeof(GLuint));
+   if (merged)
+      merged->prim = malloc(num_prims * sizeof(struct _mesa_prim));
+   if (!merged || !merged->prim || !remap || !vertices || !indices)
+      goto fail;
+
+   count = dedup_vertices(save->run.buffer, save->run.count, vertex_size,
+                          vertices, remap);
+
+   for (i = 0; i < save->run.prim_count; i++) {
+      const struct _mesa_prim *prim = &save->run.prim[i];
+      struct _mesa_prim *last = merged->prim_count ?
+         &merged->prim[merged->prim_count - 1] : NULL;
+      GLboolean convert = GL_TRUE;
+      GLenum mode;
+      GLuint n;
+
+      switch (prim->mode) {
+      case GL_POINTS:
+         mode = GL_POINTS;
+         break;
+      case GL_LINES:
+         mode = GL_LINES;
+         break;
+      case GL_LINE_LOOP:
+         /* A part of a loop split over vertex lists isn't closed */
+         convert = prim->begin && prim->end;
+         /* fall-through */
+      case GL_LINE_STRIP:
+         mode = GL_LINES;
+         merged->split_lines |= convert;
+         break;
+      case GL_TRIANGLES:
+         mode = GL_TRIANGLES;
+         break;
+      case GL_TRIANGLE_STRIP:
+      case GL_TRIANGLE_FAN:
+         /* Edge flags only apply to independent triangles */
+         mode = GL_TRIANGLES;
+         merged->split_polygons |= has_edgeflag;
+         merged->moved_provoking = GL_TRUE;
+         break;
+      case GL_QUADS:
+      case GL_QUAD_STRIP:
+      case GL_POLYGON:
+         mode = GL_TRIANGLES;
+         merged->split_polygons = GL_TRUE;
+         merged->moved_provoking = GL_TRUE;
+         break;
+      default:
+         convert = GL_FALSE;
+         break;
+      }
+
+      if (convert) {
+         n = emit_converted(prim, remap, indices + num_indices);
+      }
+      else {
+         mode = prim->mode;
+         n = emit_unconverted(prim, remap, indices + num_indices);
+      }
+
+      if (n == 0)
+         continue;
+
+      if (last && convert && last_converted && last->mode == mode) {
+         last->count += n;
+      }
+      else {
+         struct _mesa_prim *p = &merged->prim[merged->prim_count++];
+
+         memset(p, 0, sizeof(*p));
+         p->mode = mode;
+         p->indexed = 1;
+         p->begin = convert ? 1 : prim->begin;
+         p->end = convert ? 1 : prim->end;
+         p->start = num_indices;
+         p->count = n;
+         p->num_instances = 1;
+      }
+
+      num_indices += n;
+      last_converted = convert;
+   }
+
+   if (merged->prim_count >= num_prims)
+      goto fail;
+
+   /* Upload the vertices and the indices to a single buffer object */
+   index_size = count <= 0xffff ? sizeof(GLushort) : sizeof(GLuint);
+   vertex_bytes = count * vertex_size * sizeof(GLfloat);
+
+   data = malloc(vertex_bytes + num_indices * index_size);
+   if (!data)
+      goto fail;
+
+   memcpy(data, vertices, vertex_bytes);
+   if (index_size == sizeof(GLushort)) {
+      GLushort *dst = (GLushort *) (data + vertex_bytes);
+      for (i = 0; i < num_indices; i++)
+         dst[i] = (GLushort) indices[i];
+   }
+   else {
+      memcpy(data + vertex_bytes, indices, num_indices * sizeof(GLuint));
+   }
+
+   merged->bufferobj = ctx->Driver.NewBufferObject(ctx, VBO_BUF_ID,
+                                                   GL_ARRAY_BUFFER_ARB);
+   if (!merged->bufferobj ||
+       !ctx->Driver.BufferData(ctx, GL_ARRAY_BUFFER_ARB,
+                               vertex_bytes + num_indices * index_size,
+                               data, GL_STATIC_DRAW_ARB, merged->bufferobj))
+      goto fail;
+
+   merged->count = count;
+   merged->num_lists = save->run.num_lists;
+   merged->ib.count = num_indices;
+   merged->ib.type = index_size == sizeof(GLushort) ?
+      GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+   merged->ib.obj = merged->bufferobj;
+   merged->ib.ptr = (const GLubyte *) NULL + vertex_bytes;
+
+   free(data);
+   free(indices);
+   free(vertices);
+   free(remap);
+   return merged;
+
+fail:
+   if (merged)
+      vbo_save_destroy_merged_list(ctx, merged);
+   free(data);
+   free(indices);
+   free(vertices);
+   free(remap);
+   return NULL;
+}
+
+
+/**
+ * End the current run, merging its vertex lists.
+ */
+void
+vbo_save_merge_finish(struct gl_context *ctx)
+{
+   struct vbo_save_context *save = &vbo_context(ctx)->save;
+
+   /* Lists with dangling references are always replayed in loopback */
+   if (save->run.num_lists > 0 &&
+       !(ctx->ListState.CurrentList->Flags & DLIST_DANGLING_REFS)) {
+      save->run.first->merged = build_merged_list(ctx);
+   }
+
+   vbo_save_merge_reset(ctx);
+}
+
+
+/**
+ * Drop the current run, if any.
+ */
+void
+vbo_save_merge_reset(struct gl_context *ctx)
+{
+   struct vbo_save_context *save = &vbo_context(ctx)->save;
+
+   save->run.first = NULL;
+   save->run.num_lists = 0;
+   save->run.count = 0;
+   save->run.prim_count = 0;
+}
+
+
+/**
+ * Would drawing the merged list look the same as drawing its vertex lists
+ * one by one with the current state?
+ */
+GLboolean
+vbo_save_can_draw_merged(const struct gl_context *ctx,
+                         const struct vbo_save_merged_list *merged)
+{
+   /* Transform feedback would capture in a different order */
+   if (_mesa_is_xfb_active_and_unpaused(ctx))
+      return GL_FALSE;
+
+   /* The edges of the split polygons */
+   if (merged->split_polygons &&
+       (ctx->Polygon.FrontMode != GL_FILL ||
+        ctx->Polygon.BackMode != GL_FILL))
+      return GL_FALSE;
+
+   /* The stipple pattern is restarted for each line */
+   if (merged->split_lines && ctx->Line.StippleFlag)
+      return GL_FALSE;
+
+   /* The triangles only keep the last vertex of the original primitives
+    * in place, for flat shading.
+    */
+   if (merged->moved_provoking &&
+       ctx->Light.ProvokingVertex != GL_LAST_VERTEX_CONVENTION_EXT &&
+       (ctx->Light.ShadeModel == GL_FLAT ||
+        ctx->Shader.CurrentProgram[MESA_SHADER_FRAGMENT]))
+      return GL_FALSE;
+
+   return GL_TRUE;
+}
+
+
+void
+vbo_save_destroy_merged_list(struct gl_context *ctx,
+                             struct vbo_save_merged_list *merged)
+{
+   _mesa_reference_buffer_object(ctx, &merged->bufferobj, NULL);
+   free(merged->prim);
+   free(merged);
+}
@@ -108,13 +108,11 @@ void vbo_split_prims( struct gl_context *ctx,
 		      vbo_draw_func draw,
 		      const struct split_limits *limits )
 {
-   GLint max_basevertex = prim->basevertex;
+   GLboolean any_basevertex = GL_FALSE;
    GLuint i;
 
-   for (i = 1; i < nr_prims; i++)
-      max_basevertex = MAX2(max_basevertex, prim[i].basevertex);
-
-   /* XXX max_basevertex is computed but not used, why? */
+   for (i = 0; i < nr_prims; i++)
+      any_basevertex |= prim[i].basevertex != 0;
 
    if (ib) {
       if (limits->max_indices == 0) {
@@ -130,12 +128,22 @@ void vbo_split_prims( struct gl_context *ctx,
       }
       else if (max_index - min_index >= limits->max_verts) {
 	 /* The vertex buffers are too large for hardware (or the
-	  * swtnl module).  Traverse the indices, re-emitting vertices
-	  * in turn.  Use a vertex cache to preserve some of the
-	  * sharing from the original index list.
+	  * swtnl module).  Usually the indices of neighbouring
+	  * primitives are close together, so batches of them only
+	  * need a smaller range of the vertex buffers.  The batches
+	  * are bounded by index values, which don't say where the
+	  * vertices are if there's a base vertex.
+	  *
+	  * Otherwise traverse the indices, re-emitting vertices in
+	  * turn.  Use a vertex cache to preserve some of the sharing
+	  * from the original index list.
 	  */
-	 vbo_split_copy(ctx, arrays, prim, nr_prims, ib,
-			draw, limits );
+	 if (!any_basevertex && !ctx->Array._PrimitiveRestart)
+	    vbo_split_range(ctx, arrays, prim, nr_prims, ib,
+			    draw, limits );
+	 else
+	    vbo_split_copy(ctx, arrays, prim, nr_prims, ib,
+			   draw, limits );
       }
       else if (ib->count > limits->max_indices) {
 	 /* The index buffer is too large for hardware.  Try to split
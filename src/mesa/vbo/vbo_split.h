@@ -69,4 +69,14 @@ void vbo_split_copy( struct gl_context *ctx,
 		     vbo_draw_func draw,
 		     const struct split_limits *limits );
 
+/* Requires ib != NULL, no base vertex and no primitive restart:
+ */
+void vbo_split_range( struct gl_context *ctx,
+                      const struct gl_client_array *arrays[],
+                      const struct _mesa_prim *prim,
+                      GLuint nr_prims,
+                      const struct _mesa_index_buffer *ib,
+                      vbo_draw_func draw,
+                      const struct split_limits *limits );
+
 #endif
@@ -0,0 +1,367 @@
+/**************************************************************************
+ *
+ * Copyright 2014 The Mesa Authors
+ * All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sub license, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the
+ * next paragraph) shall be included in all copies or substantial portions
+ * of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NON-INFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS AND/OR ITS SUPPLIERS BE LIABLE FOR
+ * ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ **************************************************************************/
+
+/* Split indexed draws which reference too many vertices, without copying
+ * any vertex data.
+ *
+ * Real world meshes have good locality: the indices of consecutive
+ * primitives refer to nearby vertices.  So instead of re-emitting the
+ * vertices through a cache like vbo_split_copy() does, scan the indices
+ * and gather the primitives, split on whole-primitive boundaries where
+ * needed, into batches which each reference a small enough range of
+ * vertices.  Every batch is drawn from a sub-range of the original index
+ * buffer with tight index bounds, so all the driver has to do is offset
+ * its vertex buffer bindings by min_index.  vbo_rebase_prims() does that
+ * with a base vertex rather than rewriting the indices if possible.
+ *
+ * Only primitives whose vertices are too far apart to fit a batch on
+ * their own are still passed to vbo_split_copy().
+ */
+
+#include "main/glheader.h"
+#include "main/bufferobj.h"
+#include "main/imports.h"
+#include "main/mtypes.h"
+#include "main/macros.h"
+#include "main/glformats.h"
+
+#include "vbo_split.h"
+
+
+#define MAX_PRIM 32
+
+
+struct range_context {
+   struct gl_context *ctx;
+   const struct gl_client_array **array;
+   const struct _mesa_index_buffer *ib;
+   const void *elts;            /**< mapped indices, at ib->ptr */
+   vbo_draw_func draw;
+   const struct split_limits *limits;
+
+   struct _mesa_prim dstprim[MAX_PRIM];
+   GLuint dstprim_nr;
+
+   /* Extent of the current batch, empty if min > max */
+   GLuint min_elt, max_elt;     /**< positions in the index buffer */
+   GLuint min_index, max_index; /**< index values */
+};
+
+
+#define BOUNDS(TYPE)                                            \
+static void bounds_##TYPE( const void *elts,                    \
+                           GLuint start, GLuint count,          \
+                           GLuint *min_index,                   \
+                           GLuint *max_index )                  \
+{                                                               \
+   const TYPE *in = (const TYPE *)elts + start;                 \
+   GLuint lo = *min_index, hi = *max_index;                     \
+   GLuint i;                                                    \
+                                                                \
+   for (i = 0; i < count; i++) {                                \
+      lo = MIN2(lo, in[i]);                                     \
+      hi = MAX2(hi, in[i]);                                     \
+   }                                                            \
+                                                                \
+   *min_index = lo;                                             \
+   *max_index = hi;                                             \
+}
+
+BOUNDS(GLuint)
+BOUNDS(GLushort)
+BOUNDS(GLubyte)
+
+
+/**
+ * Grow [*min_index, *max_index] by the index values of elements
+ * [start, start + count).
+ */
+static void
+get_bounds(const struct range_context *range, GLuint start, GLuint count,
+           GLuint *min_index, GLuint *max_index)
+{
+   switch (range->ib->type) {
+   case GL_UNSIGNED_INT:
+      bounds_GLuint(range->elts, start, count, min_index, max_index);
+      break;
+   case GL_UNSIGNED_SHORT:
+      bounds_GLushort(range->elts, start, count, min_index, max_index);
+      break;
+   default:
+      bounds_GLubyte(range->elts, start, count, min_index, max_index);
+      break;
+   }
+}
+
+
+/**
+ * Would a batch spanning these elements and index values be within the
+ * limits?  Both ranges are inclusive and must not be empty.
+ */
+static GLboolean
+fits(const struct range_context *range,
+     GLuint min_elt, GLuint max_elt, GLuint min_index, GLuint max_index)
+{
+   return max_index - min_index < range->limits->max_verts &&
+          max_elt - min_elt < range->limits->max_indices;
+}
+
+
+static void
+flush_batch(struct range_context *range)
+{
+   struct gl_context *ctx = range->ctx;
+   const struct gl_client_array **saved_arrays = ctx->Array._DrawArrays;
+   struct _mesa_index_buffer ib;
+   GLuint i;
+
+   if (!range->dstprim_nr)
+      return;
+
+   /* Draw from just the part of the index buffer used by the batch */
+   ib = *range->ib;
+   ib.count = range->max_elt - range->min_elt + 1;
+   ib.ptr = (const char *)ib.ptr +
+            range->min_elt * _mesa_sizeof_type(ib.type);
+
+   for (i = 0; i < range->dstprim_nr; i++)
+      range->dstprim[i].start -= range->min_elt;
+
+   ctx->Array._DrawArrays = range->array;
+   ctx->NewDriverState |= ctx->DriverFlags.NewArray;
+
+   range->draw(ctx,
+               range->dstprim,
+               range->dstprim_nr,
+               &ib,
+               GL_TRUE,
+               range->min_index,
+               range->max_index,
+               NULL, NULL);
+
+   ctx->Array._DrawArrays = saved_arrays;
+   ctx->NewDriverState |= ctx->DriverFlags.NewArray;
+
+   range->dstprim_nr = 0;
+   range->min_elt = range->min_index = ~0;
+   range->max_elt = range->max_index = 0;
+}
+
+
+/**
+ * Add elements [start, start + count) of prim to the batch, whose new
+ * index bounds the caller has already computed.
+ */
+static void
+add_prim(struct range_context *range, const struct _mesa_prim *prim,
+         GLuint start, GLuint count, GLboolean begin, GLboolean end,
+         GLuint min_index, GLuint max_index)
+{
+   struct _mesa_prim *outprim;
+
+   assert(range->dstprim_nr < MAX_PRIM);
+
+   outprim = &range->dstprim[range->dstprim_nr++];
+   *outprim = *prim;
+   outprim->begin = begin;
+   outprim->end = end;
+   outprim->start = start;
+   outprim->count = count;
+
+   range->min_elt = MIN2(range->min_elt, start);
+   range->max_elt = MAX2(range->max_elt, start + count - 1);
+   range->min_index = min_index;
+   range->max_index = max_index;
+}
+
+
+/**
+ * Fall back to copying for elements [start, start + count) of prim.
+ */
+static void
+copy_prim(struct range_context *range, const struct _mesa_prim *prim,
+          GLuint start, GLuint count, GLboolean begin, GLboolean end)
+{
+   struct _mesa_prim tmpprim = *prim;
+
+   flush_batch(range);
+
+   tmpprim.begin = begin;
+   tmpprim.end = end;
+   tmpprim.start = start;
+   tmpprim.count = count;
+
+   vbo_split_copy(range->ctx, range->array, &tmpprim, 1, range->ib,
+                  range->draw, range->limits);
+}
+
+
+/**
+ * Split a primitive which doesn't fit into a batch on its own at
+ * whole-primitive boundaries, like vbo_split_inplace() does.
+ * \param count  number of elements of the prim, excluding any partial
+ *               primitive at the end
+ */
+static void
+split_prim(struct range_context *range, const struct _mesa_prim *prim,
+           GLuint first, GLuint incr, GLuint count)
+{
+   const GLuint end = prim->start + count;
+   GLuint start = prim->start;
+
+   while (start < end) {
+      GLuint min_index = ~0, max_index = 0;
+      GLuint nr = first;
+
+      /* Each piece must hold at least one whole primitive.  If that's
+       * already too large, copy just this primitive, unless it's part of
+       * a strip: then the rest of the strip goes too.
+       */
+      get_bounds(range, start, first, &min_index, &max_index);
+      if (!fits(range, start, start + first - 1, min_index, max_index)) {
+         GLuint nr = first == incr ? first : end - start;
+
+         copy_prim(range, prim, start, nr,
+                   start == prim->start && prim->begin,
+                   start + nr == end && prim->end);
+         start += nr;
+         continue;
+      }
+
+      while (start + nr < end) {
+         GLuint lo = min_index, hi = max_index;
+
+         get_bounds(range, start + nr, incr, &lo, &hi);
+         if (!fits(range, start, start + nr + incr - 1, lo, hi))
+            break;
+
+         min_index = lo;
+         max_index = hi;
+         nr += incr;
+      }
+
+      add_prim(range, prim, start, nr,
+               start == prim->start && prim->begin,
+               start + nr == end && prim->end,
+               min_index, max_index);
+
+      if (start + nr == end)
+         break;
+
+      /* Wrapped the primitive, strips share vertices with the next piece */
+      flush_batch(range);
+      start += nr - (first - incr);
+   }
+}
+
+
+void vbo_split_range( struct gl_context *ctx,
+                      const struct gl_client_array *arrays[],
+                      const struct _mesa_prim *prim,
+                      GLuint nr_prims,
+                      const struct _mesa_index_buffer *ib,
+                      vbo_draw_func draw,
+                      const struct split_limits *limits )
+{
+   struct range_context range;
+   GLboolean map_ib = _mesa_is_bufferobj(ib->obj) &&
+                      !_mesa_bufferobj_mapped(ib->obj);
+   GLuint i;
+
+   memset(&range, 0, sizeof(range));
+
+   range.ctx = ctx;
+   range.array = arrays;
+   range.ib = ib;
+   range.draw = draw;
+   range.limits = limits;
+
+   /* Empty interval, makes calculations simpler. */
+   range.min_elt = range.min_index = ~0;
+   range.max_elt = range.max_index = 0;
+
+   /* Only the index values are read, that's the whole point.  The buffer
+    * stays mapped while drawing, the same as for vbo_split_copy().
+    */
+   if (map_ib)
+      ctx->Driver.MapBufferRange(ctx, 0, ib->obj->Size, GL_MAP_READ_BIT,
+                                 ib->obj);
+
+   range.elts = ADD_POINTERS(ib->obj->Pointer, ib->ptr);
+
+   for (i = 0; i < nr_prims; i++) {
+      GLuint first, incr;
+      GLboolean split_inplace = split_prim_inplace(prim[i].mode,
+                                                   &first, &incr);
+      GLuint count = prim[i].count - (prim[i].count - first) % incr;
+      GLuint min_index, max_index;
+
+      if (prim[i].count < first || count == 0)
+         continue;
+
+      if (range.dstprim_nr == MAX_PRIM)
+         flush_batch(&range);
+
+      /* Try to add the whole primitive to the current batch, otherwise
+       * to a batch of its own, otherwise split it.
+       */
+      min_index = range.min_index;
+      max_index = range.max_index;
+      get_bounds(&range, prim[i].start, count, &min_index, &max_index);
+
+      if (!fits(&range,
+                MIN2(range.min_elt, prim[i].start),
+                MAX2(range.max_elt, prim[i].start + count - 1),
+                min_index, max_index)) {
+         if (range.dstprim_nr) {
+            flush_batch(&range);
+
+            min_index = ~0;
+            max_index = 0;
+            get_bounds(&range, prim[i].start, count, &min_index, &max_index);
+         }
+
+         if (!fits(&range, prim[i].start, prim[i].start + count - 1,
+                   min_index, max_index)) {
+            if (split_inplace)
+               split_prim(&range, &prim[i], first, incr, count);
+            else
+               copy_prim(&range, &prim[i], prim[i].start, count,
+                         prim[i].begin, prim[i].end);
+            continue;
+         }
+      }
+
+      add_prim(&range, &prim[i], prim[i].start, count,
+               prim[i].begin, prim[i].end, min_index, max_index);
+   }
+
+   flush_batch(&range);
+
+   if (map_ib)
+      ctx->Driver.UnmapBuffer(ctx, ib->obj);
+}
@@ -30,8 +30,12 @@
 
 #ifdef USE_X86_64_ASM
 
+#include <xmmintrin.h>
+
 #include "main/glheader.h"
 #include "main/context.h"
+#include "main/macros.h"
+#include "math/m_matrix.h"
 #include "math/m_xform.h"
 #include "tnl/t_context.h"
 #include "x86-64.h"
@@ -46,6 +50,166 @@ extern void _mesa_x86_64_cpuid(unsigned int *regs);
 DECLARE_XFORM_GROUP( x86_64, 4 )
 DECLARE_XFORM_GROUP( 3dnow, 4 )
 
+
+/*
+ * SSE versions of the transforms of 1, 2 and 3 component vertices, which
+ * only had C versions on x86-64.  SSE is always there on x86-64, so these
+ * need no CPU check.
+ *
+ * The matrix is column major, so every output vertex is a sum of the
+ * matrix columns scaled by the input components.  The input components
+ * are loaded one by one, since a tightly packed array must not be read
+ * past its last component.  The sums are done in the same order as in
+ * m_xform_tmp.h, so the results are the same as with the C code.
+ */
+
+static void
+sse_transform_points1_general( GLvector4f *to_vec,
+                               const GLfloat m[16],
+                               const GLvector4f *from_vec )
+{
+   const GLuint stride = from_vec->stride;
+   const GLfloat *from = from_vec->start;
+   GLfloat (*to)[4] = (GLfloat (*)[4]) to_vec->start;
+   const GLuint count = from_vec->count;
+   const __m128 c0 = _mm_loadu_ps(m + 0);
+   const __m128 c3 = _mm_loadu_ps(m + 12);
+   GLuint i;
+
+   for (i = 0; i < count; i++, STRIDE_F(from, stride)) {
+      __m128 r = _mm_mul_ps(c0, _mm_set1_ps(from[0]));
+      r = _mm_add_ps(r, c3);
+      _mm_storeu_ps(to[i], r);
+   }
+   to_vec->size = 4;
+   to_vec->flags |= VEC_SIZE_4;
+   to_vec->count = from_vec->count;
+}
+
+static void
+sse_transform_points2_general( GLvector4f *to_vec,
+                               const GLfloat m[16],
+                               const GLvector4f *from_vec )
+{
+   const GLuint stride = from_vec->stride;
+   const GLfloat *from = from_vec->start;
+   GLfloat (*to)[4] = (GLfloat (*)[4]) to_vec->start;
+   const GLuint count = from_vec->count;
+   const __m128 c0 = _mm_loadu_ps(m + 0);
+   const __m128 c1 = _mm_loadu_ps(m + 4);
+   const __m128 c3 = _mm_loadu_ps(m + 12);
+   GLuint i;
+
+   for (i = 0; i < count; i++, STRIDE_F(from, stride)) {
+      __m128 r = _mm_mul_ps(c0, _mm_set1_ps(from[0]));
+      r = _mm_add_ps(r, _mm_mul_ps(c1, _mm_set1_ps(from[1])));
+      r = _mm_add_ps(r, c3);
+      _mm_storeu_ps(to[i], r);
+   }
+   to_vec->size = 4;
+   to_vec->flags |= VEC_SIZE_4;
+   to_vec->count = from_vec->count;
+}
+
+static INLINE void
+sse_transform_points3( GLvector4f *to_vec,
+                       const GLfloat m[16],
+                       const GLvector4f *from_vec )
+{
+   const GLuint stride = from_vec->stride;
+   const GLfloat *from = from_vec->start;
+   GLfloat (*to)[4] = (GLfloat (*)[4]) to_vec->start;
+   const GLuint count = from_vec->count;
+   const __m128 c0 = _mm_loadu_ps(m + 0);
+   const __m128 c1 = _mm_loadu_ps(m + 4);
+   const __m128 c2 = _mm_loadu_ps(m + 8);
+   const __m128 c3 = _mm_loadu_ps(m + 12);
+   GLuint i;
+
+   for (i = 0; i < count; i++, STRIDE_F(from, stride)) {
+      __m128 r = _mm_mul_ps(c0, _mm_set1_ps(from[0]));
+      r = _mm_add_ps(r, _mm_mul_ps(c1, _mm_set1_ps(from[1])));
+      r = _mm_add_ps(r, _mm_mul_ps(c2, _mm_set1_ps(from[2])));
+      r = _mm_add_ps(r, c3);
+      _mm_storeu_ps(to[i], r);
+   }
+   to_vec->count = from_vec->count;
+}
+
+static void
+sse_transform_points3_general( GLvector4f *to_vec,
+                               const GLfloat m[16],
+                               const GLvector4f *from_vec )
+{
+   sse_transform_points3(to_vec, m, from_vec);
+   to_vec->size = 4;
+   to_vec->flags |= VEC_SIZE_4;
+}
+
+/* The last row is (0, 0, 0, 1), so w is not part of the result.  The
+ * fourth lane is computed anyway and ends up in the unused w slot.
+ */
+static void
+sse_transform_points3_3d( GLvector4f *to_vec,
+                          const GLfloat m[16],
+                          const GLvector4f *from_vec )
+{
+   sse_transform_points3(to_vec, m, from_vec);
+   to_vec->size = 3;
+   to_vec->flags |= VEC_SIZE_3;
+}
+
+
+static normal_func c_transform_normalize_normals;
+
+/*
+ * Transform and normalize normals, for the common case without
+ * precomputed lengths.  This uses the rows of the inverse matrix, which
+ * are loaded as columns of the transposed upper 3x3.
+ */
+static void
+sse_transform_normalize_normals( const GLmatrix *mat,
+                                 GLfloat scale,
+                                 const GLvector4f *in,
+                                 const GLfloat *lengths,
+                                 GLvector4f *dest )
+{
+   GLfloat (*out)[4] = (GLfloat (*)[4]) dest->start;
+   const GLfloat *from = in->start;
+   const GLuint stride = in->stride;
+   const GLuint count = in->count;
+   const GLfloat *m = mat->inv;
+   const __m128 r0 = _mm_set_ps(0.0f, m[8], m[4], m[0]);
+   const __m128 r1 = _mm_set_ps(0.0f, m[9], m[5], m[1]);
+   const __m128 r2 = _mm_set_ps(0.0f, m[10], m[6], m[2]);
+   GLuint i;
+
+   if (lengths) {
+      /* rare, only with precomputed lengths from display lists */
+      c_transform_normalize_normals(mat, scale, in, lengths, dest);
+      return;
+   }
+
+   for (i = 0; i < count; i++, STRIDE_F(from, stride)) {
+      GLfloat t[4];
+      __m128 r = _mm_mul_ps(r0, _mm_set1_ps(from[0]));
+      r = _mm_add_ps(r, _mm_mul_ps(r1, _mm_set1_ps(from[1])));
+      r = _mm_add_ps(r, _mm_mul_ps(r2, _mm_set1_ps(from[2])));
+      _mm_storeu_ps(t, r);
+
+      {
+         GLdouble len = t[0] * t[0] + t[1] * t[1] + t[2] * t[2];
+         if (len > 1e-20) {
+            _mm_storeu_ps(out[i], _mm_mul_ps(r, _mm_set1_ps(INV_SQRTF(len))));
+         }
+         else {
+            out[i][0] = out[i][1] = out[i][2] = 0;
+         }
+      }
+   }
+   dest->count = in->count;
+}
+
 #else
 /* just to silence warning below */
 #include "x86-64.h"
@@ -90,6 +254,16 @@ void _mesa_init_all_x86_64_transform_asm(void)
    _mesa_transform_tab[4][MATRIX_3D] =
       _mesa_x86_64_transform_points4_3d;
 
+   _mesa_transform_tab[1][MATRIX_GENERAL] = sse_transform_points1_general;
+   _mesa_transform_tab[2][MATRIX_GENERAL] = sse_transform_points2_general;
+   _mesa_transform_tab[3][MATRIX_GENERAL] = sse_transform_points3_general;
+   _mesa_transform_tab[3][MATRIX_3D] = sse_transform_points3_3d;
+
+   c_transform_normalize_normals =
+      _mesa_normal_tab[NORM_TRANSFORM | NORM_NORMALIZE];
+   _mesa_normal_tab[NORM_TRANSFORM | NORM_NORMALIZE] =
+      sse_transform_normalize_normals;
+
    regs[0] = 0x80000001;
    regs[1] = 0x00000000;
    regs[2] = 0x00000000;